@@ -0,0 +1,53 @@
+#include <cstring>
+#include "BlockWriter.h"
+
+namespace OnDiskPt
+{
+
+BlockWriter::BlockWriter()
+  : m_used(0)
+  , m_flushed(0)
+{
+}
+
+void BlockWriter::Open(const std::string &path, size_t blockSize)
+{
+  m_fd.reset(util::CreateOrThrow(path.c_str()));
+  m_buffer.resize(blockSize);
+  m_used = 0;
+  m_flushed = 0;
+}
+
+void BlockWriter::Close()
+{
+  if (!IsOpen()) return;
+  Flush();
+  m_fd.reset();
+  std::vector<char>().swap(m_buffer);
+}
+
+uint64_t BlockWriter::Write(const void *data, size_t size)
+{
+  uint64_t pos = Tell();
+  if (m_used + size > m_buffer.size()) {
+    Flush();
+    if (size >= m_buffer.size()) {
+      util::WriteOrThrow(m_fd.get(), data, size);
+      m_flushed += size;
+      return pos;
+    }
+  }
+  memcpy(&m_buffer[m_used], data, size);
+  m_used += size;
+  return pos;
+}
+
+void BlockWriter::Flush()
+{
+  if (!m_used) return;
+  util::WriteOrThrow(m_fd.get(), &m_buffer[0], m_used);
+  m_flushed += m_used;
+  m_used = 0;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "util/file.hh"
+
+namespace OnDiskPt
+{
+
+/** Output file of the rule table that is only appended to, in large blocks
+ *  rather than with a seek, write and tell per node or phrase.
+ */
+class BlockWriter
+{
+  util::scoped_fd m_fd;
+  std::vector<char> m_buffer;
+  size_t m_used;
+  uint64_t m_flushed; // bytes in the file
+
+public:
+  static const size_t kDefaultBlockSize = 32 * 1024 * 1024;
+
+  BlockWriter();
+
+  //! creates path, truncating it
+  void Open(const std::string &path, size_t blockSize = kDefaultBlockSize);
+  void Close();
+
+  bool IsOpen() const {
+    return m_fd.get() != -1;
+  }
+
+  //! position of the next byte written
+  uint64_t Tell() const {
+    return m_flushed + m_used;
+  }
+
+  //! appends size bytes, returns the position of the first
+  uint64_t Write(const void *data, size_t size);
+
+  void Flush();
+};
+
+}
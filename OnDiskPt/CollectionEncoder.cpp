@@ -0,0 +1,153 @@
+#include <cstring>
+#include "CollectionEncoder.h"
+#include "BlockWriter.h"
+#include "OnDiskWrapper.h"
+#include "TargetPhrase.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+
+namespace OnDiskPt
+{
+
+namespace
+{
+// encoded collections waiting to be written, beyond which Add() blocks
+const size_t kMaxPendingBytes = 256 * 1024 * 1024;
+}
+
+#ifdef WITH_THREADS
+class CollectionEncoder::Worker
+{
+public:
+  typedef Job *Request;
+
+  explicit Worker(CollectionEncoder *encoder) : m_encoder(*encoder) {}
+
+  void operator()(Job *job) {
+    m_encoder.Encode(*job);
+    boost::mutex::scoped_lock lock(m_encoder.m_mutex);
+    job->done = true;
+    m_encoder.m_jobDone.notify_all();
+  }
+
+private:
+  CollectionEncoder &m_encoder;
+};
+#endif
+
+CollectionEncoder::CollectionEncoder(const OnDiskWrapper &onDiskWrapper
+                                     , BlockWriter &targetInd, BlockWriter &targetColl, size_t threads)
+  : m_onDiskWrapper(onDiskWrapper)
+  , m_targetInd(targetInd)
+  , m_targetColl(targetColl)
+  , m_indEnd(targetInd.Tell())
+  , m_collEnd(targetColl.Tell())
+  , m_pendingBytes(0)
+{
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    m_pool.reset(new util::ThreadPool<Worker>(threads * 4, threads, this, NULL));
+  }
+#else
+  UTIL_THROW_IF2(threads > 1, "Compiled without threads");
+#endif
+}
+
+CollectionEncoder::~CollectionEncoder()
+{
+#ifdef WITH_THREADS
+  // joins the workers
+  m_pool.reset();
+#endif
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    Moses::RemoveAllInColl(m_pending[i]->phrases);
+    delete m_pending[i];
+  }
+}
+
+uint64_t CollectionEncoder::Add(std::vector<TargetPhrase*> &phrases)
+{
+  Job *job = new Job();
+  job->phrases.swap(phrases);
+  job->done = false;
+
+  size_t indBytes = 0, collBytes = sizeof(uint64_t);
+  for (size_t i = 0; i < job->phrases.size(); ++i) {
+    indBytes += job->phrases[i]->GetMemSize(m_onDiskWrapper);
+    collBytes += job->phrases[i]->GetOtherInfoMemSize(m_onDiskWrapper);
+  }
+  job->ind.resize(indBytes);
+  job->coll.resize(collBytes);
+  job->indPos = m_indEnd;
+  uint64_t collPos = m_collEnd;
+  m_indEnd += indBytes;
+  m_collEnd += collBytes;
+  m_pendingBytes += indBytes + collBytes;
+  m_pending.push_back(job);
+
+#ifdef WITH_THREADS
+  if (m_pool) {
+    m_pool->Produce(job);
+    Write(kMaxPendingBytes);
+    return collPos;
+  }
+#endif
+  Encode(*job);
+  job->done = true;
+  Write(kMaxPendingBytes);
+  return collPos;
+}
+
+void CollectionEncoder::Finish()
+{
+  Write(0);
+}
+
+void CollectionEncoder::Encode(Job &job) const
+{
+  char *ind = job.ind.empty() ? NULL : &job.ind[0];
+  char *coll = &job.coll[0];
+  size_t indUsed = 0, collUsed = 0;
+
+  // size of coll
+  uint64_t numPhrases = job.phrases.size();
+  memcpy(coll, &numPhrases, sizeof(uint64_t));
+  collUsed += sizeof(uint64_t);
+
+  for (size_t i = 0; i < job.phrases.size(); ++i) {
+    TargetPhrase &targetPhrase = *job.phrases[i];
+    targetPhrase.SetFilePos(job.indPos + indUsed);
+    indUsed += targetPhrase.WriteToMemory(m_onDiskWrapper, ind + indUsed);
+    collUsed += targetPhrase.WriteOtherInfoToMemory(m_onDiskWrapper, coll + collUsed);
+  }
+  UTIL_THROW_IF2(indUsed != job.ind.size() || collUsed != job.coll.size(),
+                 "Encoded target phrases do not have their expected size");
+
+  Moses::RemoveAllInColl(job.phrases);
+}
+
+void CollectionEncoder::Write(size_t maxPendingBytes)
+{
+  while (!m_pending.empty()) {
+    Job *job = m_pending.front();
+#ifdef WITH_THREADS
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (!job->done && m_pendingBytes > maxPendingBytes) {
+        m_jobDone.wait(lock);
+      }
+      if (!job->done) return;
+    }
+#endif
+    UTIL_THROW_IF2(m_targetInd.Tell() != job->indPos,
+                   "Target phrases written out of order");
+    if (!job->ind.empty()) m_targetInd.Write(&job->ind[0], job->ind.size());
+    m_targetColl.Write(&job->coll[0], job->coll.size());
+
+    m_pendingBytes -= job->ind.size() + job->coll.size();
+    delete job;
+    m_pending.pop_front();
+  }
+}
+
+}
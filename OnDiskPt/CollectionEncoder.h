@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+#include <boost/scoped_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include "util/thread_pool.hh"
+#endif
+
+namespace OnDiskPt
+{
+
+class BlockWriter;
+class OnDiskWrapper;
+class TargetPhrase;
+
+/** Encodes the target phrase collections of a rule table being saved into
+ *  TargetInd.dat and TargetColl.dat, on worker threads. The positions of a
+ *  collection are assigned when it is added, from the sizes of its phrases,
+ *  so that its source node can be written right away. The encoded
+ *  collections are written in the order they were added, so the files are
+ *  the same for any number of threads.
+ */
+class CollectionEncoder
+{
+public:
+  //! encodes on the calling thread if threads < 2
+  CollectionEncoder(const OnDiskWrapper &onDiskWrapper
+                    , BlockWriter &targetInd, BlockWriter &targetColl, size_t threads);
+  ~CollectionEncoder();
+
+  /** takes the phrases of a collection, which are in their final order;
+   *  returns the position of the collection in TargetColl.dat */
+  uint64_t Add(std::vector<TargetPhrase*> &phrases);
+
+  //! writes all collections added so far
+  void Finish();
+
+  struct Job {
+    std::vector<TargetPhrase*> phrases;
+    uint64_t indPos;
+    std::vector<char> ind, coll;
+    bool done;
+  };
+
+private:
+  const OnDiskWrapper &m_onDiskWrapper;
+  BlockWriter &m_targetInd, &m_targetColl;
+
+  // the ends of the files once everything added is written
+  uint64_t m_indEnd, m_collEnd;
+
+  std::deque<Job*> m_pending;
+  size_t m_pendingBytes;
+
+  void Encode(Job &job) const;
+  //! writes the encoded jobs at the front, waiting for them while more than maxPendingBytes are pending
+  void Write(size_t maxPendingBytes);
+
+#ifdef WITH_THREADS
+  class Worker;
+  friend class Worker;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_jobDone;
+  boost::scoped_ptr<util::ThreadPool<Worker> > m_pool;
+#endif
+};
+
+}
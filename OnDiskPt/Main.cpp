@@ -43,8 +43,8 @@ int main (int argc, char * const argv[])
   Moses::ResetUserTime();
   Moses::PrintUserTime("Starting");
 
-  if (argc != 8) {
-    std::cerr << "Usage: " << argv[0] << " numSourceFactors numTargetFactors numScores tableLimit sortScoreIndex inputPath outputPath" << std::endl;
+  if (argc != 8 && argc != 9) {
+    std::cerr << "Usage: " << argv[0] << " numSourceFactors numTargetFactors numScores tableLimit sortScoreIndex inputPath outputPath [threads]" << std::endl;
     return 1;
   }
 
@@ -57,11 +57,13 @@ int main (int argc, char * const argv[])
 
   const string filePath 	= argv[6]
                             ,destPath	= argv[7];
+  // threads encoding the target phrases, the input is read on this one
+  size_t threads = (argc == 9) ? Moses::Scan<size_t>(argv[8]) : 1;
 
   Moses::InputFileStream inStream(filePath);
 
   OnDiskWrapper onDiskWrapper;
-  onDiskWrapper.BeginSave(destPath, numSourceFactors, numTargetFactors, numScores);
+  onDiskWrapper.BeginSave(destPath, numSourceFactors, numTargetFactors, numScores, threads);
 
   PhraseNode &rootNode = onDiskWrapper.GetRootSourceNode();
   size_t lineNum = 0;
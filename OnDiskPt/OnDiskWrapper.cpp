@@ -25,6 +25,7 @@
 #include "OnDiskWrapper.h"
 #include "moses/Factor.h"
 #include "util/exception.hh"
+#include "util/file.hh"
 
 using namespace std;
 
@@ -55,22 +56,36 @@ void OnDiskWrapper::BeginLoad(const std::string &filePath)
   m_rootSourceNode = new PhraseNode(rootFilePos, *this);
 }
 
+namespace
+{
+// Lookups are small random reads all over the table files; map them so
+// they don't each need a seek and a read.
+void MapForLoad(const std::string &path, util::scoped_memory &mem)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  util::MapRead(util::LAZY, fd.get(), 0, util::SizeFile(fd.get()), mem);
+}
+}
+
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
   m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
   UTIL_THROW_IF(!m_fileSource.is_open(),
                 util::FileOpenException,
                 "Couldn't open file " << filePath << "/Source.dat");
+  MapForLoad(filePath + "/Source.dat", m_memSource);
 
   m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
   UTIL_THROW_IF(!m_fileTargetInd.is_open(),
                 util::FileOpenException,
                 "Couldn't open file " << filePath << "/TargetInd.dat");
+  MapForLoad(filePath + "/TargetInd.dat", m_memTargetInd);
 
   m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
   UTIL_THROW_IF(!m_fileTargetColl.is_open(),
                 util::FileOpenException,
                 "Couldn't open file " << filePath << "/TargetColl.dat");
+  MapForLoad(filePath + "/TargetColl.dat", m_memTargetColl);
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   UTIL_THROW_IF(!m_fileVocab.is_open(),
@@ -109,7 +124,8 @@ bool OnDiskWrapper::LoadMisc()
 }
 
 void OnDiskWrapper::BeginSave(const std::string &filePath
-                              , int numSourceFactors, int	numTargetFactors, int numScores)
+                              , int numSourceFactors, int	numTargetFactors, int numScores
+                              , size_t threads)
 {
   m_numSourceFactors = numSourceFactors;
   m_numTargetFactors = numTargetFactors;
@@ -122,20 +138,9 @@ void OnDiskWrapper::BeginSave(const std::string &filePath
   mkdir(filePath.c_str(), 0777);
 #endif
 
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::out | ios::in | ios::binary | ios::ate | ios::trunc);
-  UTIL_THROW_IF(!m_fileSource.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/Source.dat");
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::out | ios::binary | ios::ate | ios::trunc);
-  UTIL_THROW_IF(!m_fileTargetInd.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetInd.dat");
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::out | ios::binary | ios::ate | ios::trunc);
-  UTIL_THROW_IF(!m_fileTargetColl.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetColl.dat");
+  m_saveSource.Open(filePath + "/Source.dat");
+  m_saveTargetInd.Open(filePath + "/TargetInd.dat");
+  m_saveTargetColl.Open(filePath + "/TargetColl.dat");
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::out | ios::ate | ios::trunc);
   UTIL_THROW_IF(!m_fileVocab.is_open(),
@@ -149,17 +154,11 @@ void OnDiskWrapper::BeginSave(const std::string &filePath
 
   // offset by 1. 0 offset is reserved
   char c = 0xff;
-  m_fileSource.write(&c, 1);
-  UTIL_THROW_IF2(1 != m_fileSource.tellp(),
-                 "Couldn't write to stream m_fileSource");
+  m_saveSource.Write(&c, 1);
+  m_saveTargetInd.Write(&c, 1);
+  m_saveTargetColl.Write(&c, 1);
 
-  m_fileTargetInd.write(&c, 1);
-  UTIL_THROW_IF2(1 != m_fileTargetInd.tellp(),
-                 "Couldn't write to stream m_fileTargetInd");
-
-  m_fileTargetColl.write(&c, 1);
-  UTIL_THROW_IF2(1 != m_fileTargetColl.tellp(),
-                 "Couldn't write to stream m_fileTargetColl");
+  m_encoder.reset(new CollectionEncoder(*this, m_saveTargetInd, m_saveTargetColl, threads));
 
   // set up root node
   UTIL_THROW_IF2(GetNumCounts() != 1,
@@ -176,16 +175,18 @@ void OnDiskWrapper::EndSave()
   bool ret = m_rootSourceNode->Saved();
   UTIL_THROW_IF2(!ret, "Root node not saved");
 
+  m_encoder->Finish();
+  m_encoder.reset();
+
   GetVocab().Save(*this);
 
   SaveMisc();
 
   m_fileMisc.close();
   m_fileVocab.close();
-  m_fileSource.close();
-  m_fileTarget.close();
-  m_fileTargetInd.close();
-  m_fileTargetColl.close();
+  m_saveSource.Close();
+  m_saveTargetInd.Close();
+  m_saveTargetColl.Close();
 }
 
 void OnDiskWrapper::SaveMisc()
@@ -222,12 +223,26 @@ Word *OnDiskWrapper::ConvertFromMoses(const std::vector<Moses::FactorType> &fact
                                       , const Moses::Word &origWord) const
 {
   bool isNonTerminal = origWord.IsNonTerminal();
-  Word *newWord = new Word(isNonTerminal);
-  stringstream strme;
 
   size_t factorType = factorsVec[0];
   const Moses::Factor *factor = origWord.GetFactor(factorType);
   UTIL_THROW_IF2(factor == NULL, "Expecting factor " << factorType);
+
+  // without building the string, unless the factor holds the delimiter
+  if (factorsVec.size() == 1 && !isNonTerminal && m_vocab.HasFactors()) {
+    uint64_t vocabId = m_vocab.GetVocabId(factor);
+    if (vocabId) {
+      Word *newWord = new Word(isNonTerminal);
+      newWord->SetVocabId(vocabId);
+      return newWord;
+    }
+    if (factor->GetString().find('|') == StringPiece::npos) {
+      return NULL;
+    }
+  }
+
+  Word *newWord = new Word(isNonTerminal);
+  stringstream strme;
   strme << factor->GetString();
 
   for (size_t ind = 1 ; ind < factorsVec.size() ; ++ind) {
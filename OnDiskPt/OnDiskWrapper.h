@@ -20,9 +20,13 @@
  ***********************************************************************/
 #include <string>
 #include <fstream>
+#include <boost/scoped_ptr.hpp>
+#include "BlockWriter.h"
+#include "CollectionEncoder.h"
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "moses/Word.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -40,6 +44,14 @@ protected:
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
 
+  // Source.dat, TargetInd.dat and TargetColl.dat mapped into memory
+  // when loading; nodes and rules are read from here, not the streams
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
+
+  // Source.dat, TargetInd.dat and TargetColl.dat when saving
+  BlockWriter m_saveSource, m_saveTargetInd, m_saveTargetColl;
+  boost::scoped_ptr<CollectionEncoder> m_encoder;
+
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
 
@@ -57,8 +69,10 @@ public:
 
   void BeginLoad(const std::string &filePath);
 
+  //! threads encode the target phrase collections
   void BeginSave(const std::string &filePath
-                 , int numSourceFactors, int	numTargetFactors, int numScores);
+                 , int numSourceFactors, int	numTargetFactors, int numScores
+                 , size_t threads = 1);
   void EndSave();
 
   Vocab &GetVocab() {
@@ -74,6 +88,33 @@ public:
   std::fstream &GetFileSource() {
     return m_fileSource;
   }
+  //! Source.dat, between BeginSave() and EndSave()
+  BlockWriter &GetSaveSource() {
+    return m_saveSource;
+  }
+  //! writes the target phrase collections, between BeginSave() and EndSave()
+  CollectionEncoder &GetCollectionEncoder() {
+    return *m_encoder;
+  }
+  //! start of the mapped source tree, NULL if not mapped
+  const char *GetMemSource() const {
+    return (const char*) m_memSource.get();
+  }
+  uint64_t GetMemSourceSize() const {
+    return m_memSource.size();
+  }
+  const char *GetMemTargetInd() const {
+    return (const char*) m_memTargetInd.get();
+  }
+  uint64_t GetMemTargetIndSize() const {
+    return m_memTargetInd.size();
+  }
+  const char *GetMemTargetColl() const {
+    return (const char*) m_memTargetColl.get();
+  }
+  uint64_t GetMemTargetCollSize() const {
+    return m_memTargetColl.size();
+  }
   std::fstream &GetFileTargetInd() {
     return m_fileTargetInd;
   }
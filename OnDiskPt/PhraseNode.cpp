@@ -17,6 +17,8 @@
  License along with this library; if not, write to the Free Software
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
+#include <algorithm>
+#include <cstring>
 #include "PhraseNode.h"
 #include "OnDiskWrapper.h"
 #include "TargetPhraseCollection.h"
@@ -29,6 +31,15 @@ using namespace std;
 namespace OnDiskPt
 {
 
+namespace
+{
+struct ChildOrder {
+  bool operator()(const std::pair<Word, uint64_t> &a, const std::pair<Word, uint64_t> &b) const {
+    return a.first < b.first;
+  }
+};
+}
+
 size_t PhraseNode::GetNodeSize(size_t numChildren, size_t wordSize, size_t countSize)
 {
   size_t ret = sizeof(uint64_t) * 2 // num children, value
@@ -39,9 +50,9 @@ size_t PhraseNode::GetNodeSize(size_t numChildren, size_t wordSize, size_t count
 
 PhraseNode::PhraseNode()
   : m_value(0)
-  ,m_currChild(NULL)
   ,m_saved(false)
   ,m_memLoad(NULL)
+  ,m_memLoadMapped(false)
 {
 }
 
@@ -52,23 +63,37 @@ PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
   m_filePos = filePos;
 
   size_t countSize = onDiskWrapper.GetNumCounts();
+  size_t memAlloc;
+
+  if (const char *memSource = onDiskWrapper.GetMemSource()) {
+    // use the node where it is in the mapped file
+    UTIL_THROW_IF2(filePos + sizeof(uint64_t) > onDiskWrapper.GetMemSourceSize(),
+                   "Source node at " << filePos << " is beyond the end of the file");
+    memcpy(&m_numChildrenLoad, memSource + filePos, sizeof(uint64_t));
+    memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
+    UTIL_THROW_IF2(filePos + memAlloc > onDiskWrapper.GetMemSourceSize(),
+                   "Source node at " << filePos << " is beyond the end of the file");
+    m_memLoad = const_cast<char*>(memSource + filePos);
+    m_memLoadMapped = true;
+  } else {
+    std::fstream &file = onDiskWrapper.GetFileSource();
+    file.seekg(filePos);
+    assert(filePos == (uint64_t)file.tellg());
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  file.seekg(filePos);
-  assert(filePos == (uint64_t)file.tellg());
-
-  file.read((char*) &m_numChildrenLoad, sizeof(uint64_t));
+    file.read((char*) &m_numChildrenLoad, sizeof(uint64_t));
 
-  size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
-  m_memLoad = (char*) malloc(memAlloc);
+    memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
+    m_memLoad = (char*) malloc(memAlloc);
+    m_memLoadMapped = false;
 
-  // go to start of node again
-  file.seekg(filePos);
-  assert(filePos == (uint64_t)file.tellg());
+    // go to start of node again
+    file.seekg(filePos);
+    assert(filePos == (uint64_t)file.tellg());
 
-  // read everything into memory
-  file.read(m_memLoad, memAlloc);
-  assert(filePos + memAlloc == (uint64_t)file.tellg());
+    // read everything into memory
+    file.read(m_memLoad, memAlloc);
+    assert(filePos + memAlloc == (uint64_t)file.tellg());
+  }
 
   // get value
   m_value = ((uint64_t*)m_memLoad)[1];
@@ -84,7 +109,7 @@ PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
 
 PhraseNode::~PhraseNode()
 {
-  free(m_memLoad);
+  if (!m_memLoadMapped) free(m_memLoad);
 }
 
 float PhraseNode::GetCount(size_t ind) const
@@ -101,6 +126,15 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
   m_targetPhraseColl.Save(onDiskWrapper);
   m_value = m_targetPhraseColl.GetFilePos();
 
+  // recursively save children
+  if (m_currChild)
+    SaveCurrChild(onDiskWrapper, pos + 1, tableLimit);
+  std::sort(m_children.begin(), m_children.end(), ChildOrder());
+  for (size_t i = 1; i < m_children.size(); ++i) {
+    UTIL_THROW_IF2(m_children[i - 1].first == m_children[i].first,
+                   "A source word is split by other rules, is the input sorted?");
+  }
+
   size_t numCounts = onDiskWrapper.GetNumCounts();
 
   size_t memAlloc = GetNodeSize(GetSize(), onDiskWrapper.GetSourceWordSize(), numCounts);
@@ -119,22 +153,16 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
   memFloat[0] = (m_counts.size() == 0) ? DEFAULT_COUNT : m_counts[0]; // if count = 0, put in very large num to make sure its still used. HACK
   memUsed += sizeof(float) * numCounts;
 
-  // recursively save chm_countsildren
   ChildColl::iterator iter;
   for (iter = m_children.begin(); iter != m_children.end(); ++iter) {
     const Word &childWord = iter->first;
-    PhraseNode &childNode = iter->second;
-
-    // recursive
-    if (!childNode.Saved())
-      childNode.Save(onDiskWrapper, pos + 1, tableLimit);
 
     char *currMem = mem + memUsed;
     size_t wordMemUsed = childWord.WriteToMemory(currMem);
     memUsed += wordMemUsed;
 
     uint64_t *memArray = (uint64_t*) (mem + memUsed);
-    memArray[0] = childNode.GetFilePos();
+    memArray[0] = iter->second;
     memUsed += sizeof(uint64_t);
 
   }
@@ -143,20 +171,21 @@ void PhraseNode::Save(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimi
   //Moses::DebugMem(mem, memAlloc);
   assert(memUsed == memAlloc);
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  m_filePos = file.tellp();
-  file.seekp(0, ios::end);
-  file.write(mem, memUsed);
-
-  uint64_t endPos = file.tellp();
-  assert(m_filePos + memUsed == endPos);
+  m_filePos = onDiskWrapper.GetSaveSource().Write(mem, memUsed);
 
   free(mem);
 
-  m_children.clear();
+  ChildColl().swap(m_children);
   m_saved = true;
 }
 
+void PhraseNode::SaveCurrChild(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimit)
+{
+  m_currChild->Save(onDiskWrapper, pos, tableLimit);
+  m_children.push_back(std::make_pair(m_currWord, m_currChild->GetFilePos()));
+  m_currChild.reset();
+}
+
 void PhraseNode::AddTargetPhrase(const SourcePhrase &sourcePhrase, TargetPhrase *targetPhrase
                                  , OnDiskWrapper &onDiskWrapper, size_t tableLimit
                                  , const std::vector<float> &counts, OnDiskPt::PhrasePtr spShort)
@@ -172,20 +201,19 @@ void PhraseNode::AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
   if (pos < phraseSize) {
     const Word &word = sourcePhrase.GetWord(pos);
 
-    PhraseNode &node = m_children[word];
-    if (m_currChild != &node) {
-      // new node
-      node.SetPos(pos);
-
+    if (!m_currChild || !(m_currWord == word)) {
+      // new node, the previous one is complete
       if (m_currChild) {
-        m_currChild->Save(onDiskWrapper, pos, tableLimit);
+        SaveCurrChild(onDiskWrapper, pos, tableLimit);
       }
 
-      m_currChild = &node;
+      m_currChild.reset(new PhraseNode());
+      m_currChild->SetPos(pos);
+      m_currWord = word;
     }
 
     // keep searching for target phrase node..
-    node.AddTargetPhrase(pos + 1, sourcePhrase, targetPhrase, onDiskWrapper, tableLimit, counts, spShort);
+    m_currChild->AddTargetPhrase(pos + 1, sourcePhrase, targetPhrase, onDiskWrapper, tableLimit, counts, spShort);
   } else {
     // drilled down to the right node
     m_counts = counts;
@@ -20,7 +20,7 @@
  ***********************************************************************/
 #include <fstream>
 #include <vector>
-#include <map>
+#include <boost/scoped_ptr.hpp>
 #include "Word.h"
 #include "TargetPhraseCollection.h"
 #include "Phrase.h"
@@ -38,9 +38,12 @@ class PhraseNode
 protected:
   uint64_t m_filePos, m_value;
 
-  typedef std::map<Word, PhraseNode> ChildColl;
+  // the input is sorted, so only the child being added to is held, and
+  // the children saved before it as their word and file position
+  typedef std::vector<std::pair<Word, uint64_t> > ChildColl;
   ChildColl m_children;
-  PhraseNode *m_currChild;
+  boost::scoped_ptr<PhraseNode> m_currChild;
+  Word m_currWord;
   bool m_saved;
   size_t m_pos;
   std::vector<float> m_counts;
@@ -48,11 +51,13 @@ protected:
   TargetPhraseCollection m_targetPhraseColl;
 
   char *m_memLoad, *m_memLoadLast;
+  bool m_memLoadMapped; // m_memLoad points into the mapped source file
   uint64_t m_numChildrenLoad;
 
   void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
                        , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
                        , size_t tableLimit, const std::vector<float> &counts, OnDiskPt::PhrasePtr spShort);
+  void SaveCurrChild(OnDiskWrapper &onDiskWrapper, size_t pos, size_t tableLimit);
   size_t ReadChild(Word &wordFound, uint64_t &childFilePos, const char *mem) const;
   void GetChild(Word &wordFound, uint64_t &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const;
 
@@ -79,6 +84,7 @@ public:
   void SetValue(uint64_t value) {
     m_value = value;
   }
+  //! the saved children
   size_t GetSize() const {
     return m_children.size();
   }
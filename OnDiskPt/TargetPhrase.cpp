@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "moses/Util.h"
 #include "moses/TargetPhrase.h"
@@ -94,89 +95,58 @@ void TargetPhrase::SortAlign()
   std::sort(m_align.begin(), m_align.end(), AlignOrderer());
 }
 
-char *TargetPhrase::WriteToMemory(OnDiskWrapper &onDiskWrapper, size_t &memUsed) const
+size_t TargetPhrase::GetMemSize(const OnDiskWrapper &onDiskWrapper) const
 {
-  size_t phraseSize = GetSize();
-  size_t targetWordSize = onDiskWrapper.GetTargetWordSize();
+  return sizeof(uint64_t)						// num of words
+         + onDiskWrapper.GetTargetWordSize() * GetSize()	// actual words. lhs as last words
+         + sizeof(uint64_t)					// num source words
+         + onDiskWrapper.GetSourceWordSize() * GetSourcePhrase()->GetSize();   // actual source words
+}
 
+size_t TargetPhrase::WriteToMemory(const OnDiskWrapper &onDiskWrapper, char *mem) const
+{
+  size_t phraseSize = GetSize();
   const PhrasePtr sp = GetSourcePhrase();
   size_t spSize = sp->GetSize();
-  size_t sourceWordSize = onDiskWrapper.GetSourceWordSize();
 
-  size_t memNeeded = sizeof(uint64_t)						// num of words
-                     + targetWordSize * phraseSize	// actual words. lhs as last words
-                     + sizeof(uint64_t)					// num source words
-                     + sourceWordSize * spSize;   // actual source words
-
-  memUsed = 0;
-  uint64_t *mem = (uint64_t*) malloc(memNeeded);
+  size_t memUsed = 0;
 
   // write size
-  mem[0] = phraseSize;
+  uint64_t tmp = phraseSize;
+  memcpy(mem, &tmp, sizeof(uint64_t));
   memUsed += sizeof(uint64_t);
 
   // write each word
   for (size_t pos = 0; pos < phraseSize; ++pos) {
     const Word &word = GetWord(pos);
-    char *currPtr = (char*)mem + memUsed;
-    memUsed += word.WriteToMemory((char*) currPtr);
+    memUsed += word.WriteToMemory(mem + memUsed);
   }
 
   // write size of source phrase and all source words
-  char *currPtr = (char*)mem + memUsed;
-  uint64_t *memTmp = (uint64_t*) currPtr;
-  memTmp[0] = spSize;
+  tmp = spSize;
+  memcpy(mem + memUsed, &tmp, sizeof(uint64_t));
   memUsed += sizeof(uint64_t);
   for (size_t pos = 0; pos < spSize; ++pos) {
     const Word &word = sp->GetWord(pos);
-    char *currPtr = (char*)mem + memUsed;
-    memUsed += word.WriteToMemory((char*) currPtr);
+    memUsed += word.WriteToMemory(mem + memUsed);
   }
 
-  assert(memUsed == memNeeded);
-  return (char *) mem;
+  assert(memUsed == GetMemSize(onDiskWrapper));
+  return memUsed;
 }
 
-void TargetPhrase::Save(OnDiskWrapper &onDiskWrapper)
+size_t TargetPhrase::GetOtherInfoMemSize(const OnDiskWrapper &onDiskWrapper) const
 {
-  // save in target ind
-  size_t memUsed;
-  char *mem = WriteToMemory(onDiskWrapper, memUsed);
-
-  std::fstream &file = onDiskWrapper.GetFileTargetInd();
-
-  uint64_t startPos = file.tellp();
-
-  file.seekp(0, ios::end);
-  file.write(mem, memUsed);
-
-#ifndef NDEBUG
-  uint64_t endPos = file.tellp();
-  assert(startPos + memUsed == endPos);
-#endif
-
-  m_filePos = startPos;
-  free(mem);
+  return sizeof(uint64_t) // file pos (phrase id)
+         + sizeof(uint64_t) + 2 * sizeof(uint64_t) * GetAlign().size() // align
+         + sizeof(float) * onDiskWrapper.GetNumScores() // scores
+         + sizeof(uint64_t) + m_sparseFeatures.size() // sparse features string
+         + sizeof(uint64_t) + m_property.size(); // property string
 }
 
-char *TargetPhrase::WriteOtherInfoToMemory(OnDiskWrapper &onDiskWrapper, size_t &memUsed) const
+size_t TargetPhrase::WriteOtherInfoToMemory(const OnDiskWrapper &onDiskWrapper, char *mem) const
 {
-  // allocate mem
-  size_t numScores = onDiskWrapper.GetNumScores()
-                     ,numAlign = GetAlign().size();
-  size_t sparseFeatureSize = m_sparseFeatures.size();
-  size_t propSize = m_property.size();
-
-  size_t memNeeded = sizeof(uint64_t) // file pos (phrase id)
-                     + sizeof(uint64_t) + 2 * sizeof(uint64_t) * numAlign // align
-                     + sizeof(float) * numScores // scores
-                     + sizeof(uint64_t) + sparseFeatureSize // sparse features string
-                     + sizeof(uint64_t) + propSize; // property string
-
-  char *mem = (char*) malloc(memNeeded);
-  //memset(mem, 0, memNeeded);
-
-  memUsed = 0;
+  size_t memUsed = 0;
 
   // phrase id
   memcpy(mem, &m_filePos, sizeof(uint64_t));
@@ -196,8 +166,8 @@ char *TargetPhrase::WriteOtherInfoToMemory(OnDiskWrapper &onDiskWrapper, size_t
   memUsed += WriteStringToMemory(mem + memUsed, m_property);
 
   //DebugMem(mem, memNeeded);
-  assert(memNeeded == memUsed);
-  return mem;
+  assert(memUsed == GetOtherInfoMemSize(onDiskWrapper));
+  return memUsed;
 }
 
 size_t TargetPhrase::WriteStringToMemory(char *mem, const std::string &str) const
@@ -396,6 +366,77 @@ uint64_t TargetPhrase::ReadFromFile(std::fstream &fileTP)
   return bytesRead;
 }
 
+namespace
+{
+template <class T> inline const char *ReadValue(const char *mem, T &value)
+{
+  memcpy(&value, mem, sizeof(T));
+  return mem + sizeof(T);
+}
+}
+
+uint64_t TargetPhrase::ReadOtherInfoFromMemory(const char *mem)
+{
+  const char *start = mem;
+  mem = ReadValue(mem, m_filePos);
+  assert(m_filePos != 0);
+
+  // alignment
+  uint64_t numAlign;
+  mem = ReadValue(mem, numAlign);
+  for (size_t ind = 0; ind < numAlign; ++ind) {
+    AlignPair alignPair;
+    mem = ReadValue(mem, alignPair.first);
+    mem = ReadValue(mem, alignPair.second);
+    m_align.push_back(alignPair);
+  }
+
+  // scores
+  UTIL_THROW_IF2(m_scores.size() == 0, "Translation rules must must have some scores");
+  for (size_t ind = 0; ind < m_scores.size(); ++ind) {
+    mem = ReadValue(mem, m_scores[ind]);
+  }
+  std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::TransformScore);
+  std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::FloorScore);
+
+  // sparse features and properties
+  uint64_t strSize;
+  mem = ReadValue(mem, strSize);
+  m_sparseFeatures.assign(mem, strSize);
+  mem += strSize;
+  mem = ReadValue(mem, strSize);
+  m_property.assign(mem, strSize);
+  mem += strSize;
+
+  return mem - start;
+}
+
+uint64_t TargetPhrase::ReadFromMemory(const char *memTargetInd)
+{
+  const char *mem = memTargetInd + m_filePos;
+
+  uint64_t numWords;
+  mem = ReadValue(mem, numWords);
+  for (size_t ind = 0; ind < numWords; ++ind) {
+    WordPtr word(new Word());
+    mem += word->ReadFromMemory(mem);
+    AddWord(word);
+  }
+
+  // read source words
+  uint64_t numSourceWords;
+  mem = ReadValue(mem, numSourceWords);
+  PhrasePtr sp(new SourcePhrase());
+  for (size_t ind = 0; ind < numSourceWords; ++ind) {
+    WordPtr word( new Word());
+    mem += word->ReadFromMemory(mem);
+    sp->AddWord(word);
+  }
+  SetSourcePhrase(sp);
+
+  return mem - (memTargetInd + m_filePos);
+}
+
 uint64_t TargetPhrase::ReadAlignFromFile(std::fstream &fileTPColl)
 {
   uint64_t bytesRead = 0;
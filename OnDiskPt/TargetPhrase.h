@@ -91,13 +91,22 @@ public:
   }
   void SortAlign();
 
-  char *WriteToMemory(OnDiskWrapper &onDiskWrapper, size_t &memUsed) const;
-  char *WriteOtherInfoToMemory(OnDiskWrapper &onDiskWrapper, size_t &memUsed) const;
-  void Save(OnDiskWrapper &onDiskWrapper);
+  //! bytes of the phrase in TargetInd.dat
+  size_t GetMemSize(const OnDiskWrapper &onDiskWrapper) const;
+  //! writes the phrase for TargetInd.dat to mem, returns GetMemSize()
+  size_t WriteToMemory(const OnDiskWrapper &onDiskWrapper, char *mem) const;
+  //! bytes of the phrase's entry in TargetColl.dat
+  size_t GetOtherInfoMemSize(const OnDiskWrapper &onDiskWrapper) const;
+  //! writes the entry for TargetColl.dat to mem, returns GetOtherInfoMemSize()
+  size_t WriteOtherInfoToMemory(const OnDiskWrapper &onDiskWrapper, char *mem) const;
 
   uint64_t GetFilePos() const {
     return m_filePos;
   }
+  //! position of the phrase in TargetInd.dat
+  void SetFilePos(uint64_t filePos) {
+    m_filePos = filePos;
+  }
   float GetScore(size_t ind) const {
     return m_scores[ind];
   }
@@ -110,6 +119,9 @@ public:
                                       , bool isSyntax) const;
   uint64_t ReadOtherInfoFromFile(uint64_t filePos, std::fstream &fileTPColl);
   uint64_t ReadFromFile(std::fstream &fileTP);
+  //! same as above, from the mapped TargetColl.dat entry / TargetInd.dat
+  uint64_t ReadOtherInfoFromMemory(const char *mem);
+  uint64_t ReadFromMemory(const char *memTargetInd);
 
   virtual void DebugPrint(std::ostream &out, const Vocab &vocab) const;
 
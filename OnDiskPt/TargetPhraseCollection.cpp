@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "moses/Util.h"
 #include "moses/TargetPhraseCollection.h"
@@ -69,49 +70,8 @@ void TargetPhraseCollection::Sort(size_t tableLimit)
 
 void TargetPhraseCollection::Save(OnDiskWrapper &onDiskWrapper)
 {
-  std::fstream &file = onDiskWrapper.GetFileTargetColl();
-
-  size_t memUsed = sizeof(uint64_t);
-  char *mem = (char*) malloc(memUsed);
-
-  // size of coll
-  uint64_t numPhrases = GetSize();
-  ((uint64_t*)mem)[0] = numPhrases;
-
-  // MAIN LOOP
-  CollType::iterator iter;
-  for (iter = m_coll.begin(); iter != m_coll.end(); ++iter) {
-    // save phrase
-    TargetPhrase &targetPhrase = **iter;
-    targetPhrase.Save(onDiskWrapper);
-
-    // save coll
-    size_t memUsedTPOtherInfo;
-    char *memTPOtherInfo = targetPhrase.WriteOtherInfoToMemory(onDiskWrapper, memUsedTPOtherInfo);
-
-    // expand existing mem
-    mem = (char*) realloc(mem, memUsed + memUsedTPOtherInfo);
-    memcpy(mem + memUsed, memTPOtherInfo, memUsedTPOtherInfo);
-    memUsed += memUsedTPOtherInfo;
-
-    free(memTPOtherInfo);
-  }
-
-  // total number of bytes
-  //((uint64_t*)mem)[0] = (uint64_t) memUsed;
-
-  uint64_t startPos = file.tellp();
-  file.seekp(0, ios::end);
-  file.write((char*) mem, memUsed);
-
-  free(mem);
-
-#ifndef NDEBUG
-  uint64_t endPos = file.tellp();
-  assert(startPos + memUsed == endPos);
-#endif
-  m_filePos = startPos;
-
+  // the phrases are encoded and freed by the encoder
+  m_filePos = onDiskWrapper.GetCollectionEncoder().Add(m_coll);
 }
 
 Moses::TargetPhraseCollection *TargetPhraseCollection::ConvertToMoses(const std::vector<Moses::FactorType> &inputFactors
@@ -150,6 +110,11 @@ Moses::TargetPhraseCollection *TargetPhraseCollection::ConvertToMoses(const std:
 
 void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper)
 {
+  if (onDiskWrapper.GetMemTargetColl() && onDiskWrapper.GetMemTargetInd()) {
+    ReadFromMemory(tableLimit, filePos, onDiskWrapper);
+    return;
+  }
+
   fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
   fstream &fileTP = onDiskWrapper.GetFileTargetInd();
 
@@ -181,6 +146,34 @@ void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, O
   }
 }
 
+void TargetPhraseCollection::ReadFromMemory(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper)
+{
+  const char *memTPColl = onDiskWrapper.GetMemTargetColl();
+  const char *memTP = onDiskWrapper.GetMemTargetInd();
+  UTIL_THROW_IF2(filePos + sizeof(uint64_t) > onDiskWrapper.GetMemTargetCollSize(),
+                 "Target phrase collection at " << filePos << " is beyond the end of the file");
+
+  size_t numScores = onDiskWrapper.GetNumScores();
+
+  uint64_t numPhrases;
+  memcpy(&numPhrases, memTPColl + filePos, sizeof(uint64_t));
+
+  // table limit
+  if (tableLimit) {
+    numPhrases = std::min(numPhrases, (uint64_t) tableLimit);
+  }
+
+  const char *mem = memTPColl + filePos + sizeof(uint64_t);
+  for (size_t ind = 0; ind < numPhrases; ++ind) {
+    TargetPhrase *tp = new TargetPhrase(numScores);
+
+    mem += tp->ReadOtherInfoFromMemory(mem);
+    tp->ReadFromMemory(memTP);
+
+    m_coll.push_back(tp);
+  }
+}
+
 uint64_t TargetPhraseCollection::GetFilePos() const
 {
   return m_filePos;
@@ -76,6 +76,7 @@ public:
       , Vocab &vocab
       , bool isSyntax) const;
   void ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper);
+  void ReadFromMemory(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper);
 
   const std::string GetDebugStr() const;
   void SetDebugStr(const std::string &str);
@@ -22,6 +22,7 @@
 #include "OnDiskWrapper.h"
 #include "Vocab.h"
 #include "util/exception.hh"
+#include "util/tokenize_piece.hh"
 
 using namespace std;
 
@@ -54,9 +55,29 @@ bool Vocab::Load(OnDiskWrapper &onDiskWrapper)
     m_lookup[vocabId] = word;
   }
 
+  BuildRemap();
   return true;
 }
 
+// The words become factors once here instead of on every lookup.
+void Vocab::BuildRemap()
+{
+  Moses::FactorCollection &factorColl = Moses::FactorCollection::Instance();
+  m_factorBegin.resize(m_lookup.size() + 1);
+  m_factors.clear();
+  for (size_t vocabId = 0; vocabId < m_lookup.size(); ++vocabId) {
+    m_factorBegin[vocabId] = m_factors.size();
+    const std::string &word = m_lookup[vocabId];
+    for (util::TokenIter<util::SingleCharacter> tok(word, '|'); tok; ++tok) {
+      m_factors.push_back(factorColl.AddFactor(*tok));
+    }
+    if (vocabId && word.find('|') == std::string::npos) {
+      m_remap.Add(word, vocabId);
+    }
+  }
+  m_factorBegin[m_lookup.size()] = m_factors.size();
+}
+
 void Vocab::Save(OnDiskWrapper &onDiskWrapper)
 {
   fstream &file = onDiskWrapper.GetFileVocab();
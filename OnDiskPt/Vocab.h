@@ -20,7 +20,9 @@
  ***********************************************************************/
 #include <string>
 #include <map>
+#include <vector>
 #include "moses/TypeDef.h"
+#include "moses/VocabRemap.h"
 
 
 namespace OnDiskPt
@@ -40,6 +42,14 @@ protected:
   std::vector<std::string> m_lookup; // opposite of m_vocabColl
   uint64_t m_nextId; // starts @ 1
 
+  // built by Load: the id of each single factor word, and the factors of
+  // each id split at | from m_factors[m_factorBegin[id]]
+  Moses::VocabRemap<uint64_t> m_remap;
+  std::vector<size_t> m_factorBegin;
+  std::vector<const Moses::Factor*> m_factors;
+
+  void BuildRemap();
+
 public:
   Vocab()
     :m_nextId(1) {
@@ -50,6 +60,19 @@ public:
     return m_lookup[vocabId];
   }
 
+  //! id of a word of one terminal factor, 0 if unknown. Needs Load.
+  uint64_t GetVocabId(const Moses::Factor *factor) const {
+    return m_remap.Lookup(factor);
+  }
+  //! whether GetFactors may be called
+  bool HasFactors() const {
+    return !m_factorBegin.empty();
+  }
+  const Moses::Factor *const *GetFactors(uint64_t vocabId, size_t &count) const {
+    count = m_factorBegin[vocabId + 1] - m_factorBegin[vocabId];
+    return m_factors.empty() ? NULL : &m_factors[0] + m_factorBegin[vocabId];
+  }
+
   bool Load(OnDiskWrapper &onDiskWrapper);
   void Save(OnDiskWrapper &onDiskWrapper);
 };
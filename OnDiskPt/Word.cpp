@@ -109,8 +109,19 @@ void Word::ConvertToMoses(
   if (m_isNonTerminal) {
     const std::string &tok = vocab.GetString(m_vocabId);
     overwrite.SetFactor(0, factorColl.AddFactor(tok, m_isNonTerminal));
+    return;
+  }
+
+  if (vocab.HasFactors()) {
+    size_t count;
+    const Moses::Factor *const *factors = vocab.GetFactors(m_vocabId, count);
+    UTIL_THROW_IF2(count < outputFactorsVec.size(), "Too few factors in \"" << vocab.GetString(m_vocabId) << "\"; was expecting " << outputFactorsVec.size());
+    UTIL_THROW_IF2(count > outputFactorsVec.size(), "Too many factors in \"" << vocab.GetString(m_vocabId) << "\"; was expecting " << outputFactorsVec.size());
+    for (size_t i = 0; i < count; ++i) {
+      overwrite.SetFactor(outputFactorsVec[i], factors[i]);
+    }
   } else {
-    // TODO: this conversion should have been done at load time.
+    // a vocabulary that wasn't loaded
     util::TokenIter<util::SingleCharacter> tok(vocab.GetString(m_vocabId), '|');
 
     for (std::vector<Moses::FactorType>::const_iterator t = outputFactorsVec.begin(); t != outputFactorsVec.end(); ++t, ++tok) {
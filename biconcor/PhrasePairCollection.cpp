@@ -24,7 +24,19 @@ PhrasePairCollection::PhrasePairCollection( SuffixArray *sa, TargetCorpus *tc, A
 {}
 
 PhrasePairCollection::~PhrasePairCollection()
-{}
+{
+  for(size_t i=0; i<m_collection.size(); i++) {
+    for(size_t j=0; j<m_collection[i].size(); j++) {
+      delete m_collection[i][j];
+    }
+  }
+  for(size_t i=0; i<m_mismatch.size(); i++) {
+    delete m_mismatch[i];
+  }
+  for(size_t i=0; i<m_unaligned.size(); i++) {
+    delete m_unaligned[i];
+  }
+}
 
 int PhrasePairCollection::GetCollection( const vector< string >& sourceString )
 {
@@ -98,20 +110,20 @@ int PhrasePairCollection::GetCollection( const vector< string >& sourceString )
   return real_count;
 }
 
-void PhrasePairCollection::Print(bool pretty) const
+void PhrasePairCollection::Print(bool pretty, ostream *out) const
 {
   vector< vector<PhrasePair*> >::const_iterator ppWithSameTarget;
   int i=0;
   for( ppWithSameTarget = m_collection.begin(); ppWithSameTarget != m_collection.end() && i<m_max_translation; i++, ppWithSameTarget++ ) {
-    (*(ppWithSameTarget->begin()))->PrintTarget( &cout );
+    (*(ppWithSameTarget->begin()))->PrintTarget( out );
     int count = ppWithSameTarget->size();
-    cout << "(" << count << ")" << endl;
+    *out << "(" << count << ")" << endl;
     vector< PhrasePair* >::const_iterator p = ppWithSameTarget->begin();
     for(int j=0; j<ppWithSameTarget->size() && j<m_max_example; j++, p++ ) {
       if (pretty) {
-        (*p)->PrintPretty( &cout, 100 );
+        (*p)->PrintPretty( out, 100 );
       } else {
-        (*p)->Print( &cout );
+        (*p)->Print( out );
       }
       if (ppWithSameTarget->size() > m_max_example) {
         p += ppWithSameTarget->size()/m_max_example-1;
@@ -120,7 +132,7 @@ void PhrasePairCollection::Print(bool pretty) const
   }
 }
 
-void PhrasePairCollection::PrintHTML() const
+void PhrasePairCollection::PrintHTML(ostream *out) const
 {
   int pp_target = 0;
   bool singleton = false;
@@ -132,17 +144,17 @@ void PhrasePairCollection::PrintHTML() const
     if (!singleton) {
       if (count == 1) {
         singleton = true;
-        cout << "<p class=\"pp_singleton_header\">singleton"
+        *out << "<p class=\"pp_singleton_header\">singleton"
              << (m_collection.end() - ppWithSameTarget==1?"":"s") << " ("
              << (m_collection.end() - ppWithSameTarget)
              << "/" << m_size << ")</p>";
       } else {
-        cout << "<p class=\"pp_target_header\">";
-        (*(ppWithSameTarget->begin()))->PrintTarget( &cout );
-        cout << " (" << count << "/" << m_size << ")" << endl;
-        cout << "<p><div id=\"pp_" << pp_target << "\">";
+        *out << "<p class=\"pp_target_header\">";
+        (*(ppWithSameTarget->begin()))->PrintTarget( out );
+        *out << " (" << count << "/" << m_size << ")" << endl;
+        *out << "<p><div id=\"pp_" << pp_target << "\">";
       }
-      cout << "<table align=\"center\">";
+      *out << "<table align=\"center\">";
     }
 
     vector< PhrasePair* >::const_iterator p;
@@ -150,7 +162,7 @@ void PhrasePairCollection::PrintHTML() const
     int pp=0;
     int i=0;
     for(p = ppWithSameTarget->begin(); i<10 && pp<count && p != ppWithSameTarget->end(); p++, pp++, i++ ) {
-      (*p)->PrintClippedHTML( &cout, 160 );
+      (*p)->PrintClippedHTML( out, 160 );
       if (count > m_max_example) {
         p += count/m_max_example-1;
         pp += count/m_max_example-1;
@@ -158,52 +170,52 @@ void PhrasePairCollection::PrintHTML() const
     }
     if (i == 10 && pp < count) {
       // extended table
-      cout << "<tr><td colspan=7 align=center class=\"pp_more\" onclick=\"javascript:document.getElementById('pp_" << pp_target << "').style.display = 'none'; document.getElementById('pp_ext_" << pp_target << "').style.display = 'block';\">(more)</td></tr></table></div>";
-      cout << "<div id=\"pp_ext_" << pp_target << "\" style=\"display:none;\";\">";
-      cout << "<table align=\"center\">";
+      *out << "<tr><td colspan=7 align=center class=\"pp_more\" onclick=\"javascript:document.getElementById('pp_" << pp_target << "').style.display = 'none'; document.getElementById('pp_ext_" << pp_target << "').style.display = 'block';\">(more)</td></tr></table></div>";
+      *out << "<div id=\"pp_ext_" << pp_target << "\" style=\"display:none;\";\">";
+      *out << "<table align=\"center\">";
       for(i=0, pp=0, p = ppWithSameTarget->begin(); i<m_max_example && pp<count && p != ppWithSameTarget->end(); p++, pp++, i++ ) {
-        (*p)->PrintClippedHTML( &cout, 160 );
+        (*p)->PrintClippedHTML( out, 160 );
         if (count > m_max_example) {
           p += count/m_max_example-1;
           pp += count/m_max_example-1;
         }
       }
     }
-    if (!singleton) cout << "</table></div>\n";
+    if (!singleton) *out << "</table></div>\n";
 
     if (!singleton && pp_target == 9) {
-      cout << "<div id=\"pp_toggle\" onclick=\"javascript:document.getElementById('pp_toggle').style.display = 'none'; document.getElementById('pp_additional').style.display = 'block';\">";
-      cout << "<p class=\"pp_target_header\">(more)</p></div>";
-      cout << "<div id=\"pp_additional\" style=\"display:none;\";\">";
+      *out << "<div id=\"pp_toggle\" onclick=\"javascript:document.getElementById('pp_toggle').style.display = 'none'; document.getElementById('pp_additional').style.display = 'block';\">";
+      *out << "<p class=\"pp_target_header\">(more)</p></div>";
+      *out << "<div id=\"pp_additional\" style=\"display:none;\";\">";
     }
   }
-  if (singleton) cout << "</table></div>\n";
-  else if (pp_target > 9)	cout << "</div>";
+  if (singleton) *out << "</table></div>\n";
+  else if (pp_target > 9)	*out << "</div>";
 
   size_t max_mismatch = m_max_example/3;
   // unaligned phrases
   if (m_unaligned.size() > 0) {
-    cout << "<p class=\"pp_singleton_header\">unaligned"
+    *out << "<p class=\"pp_singleton_header\">unaligned"
          << " (" << (m_unaligned.size()) << ")</p>";
-    cout << "<table align=\"center\">";
+    *out << "<table align=\"center\">";
     int step_size = 1;
     if (m_unaligned.size() > max_mismatch)
       step_size = (m_unaligned.size()+max_mismatch-1) / max_mismatch;
     for(size_t i=0; i<m_unaligned.size(); i+=step_size)
-      m_unaligned[i]->PrintClippedHTML( &cout, 160 );
-    cout << "</table>";
+      m_unaligned[i]->PrintClippedHTML( out, 160 );
+    *out << "</table>";
   }
 
   // mismatched phrases
   if (m_mismatch.size() > 0) {
-    cout << "<p class=\"pp_singleton_header\">mismatched"
+    *out << "<p class=\"pp_singleton_header\">mismatched"
          << " (" << (m_mismatch.size()) << ")</p>";
-    cout << "<table align=\"center\">";
+    *out << "<table align=\"center\">";
     int step_size = 1;
     if (m_mismatch.size() > max_mismatch)
       step_size = (m_mismatch.size()+max_mismatch-1) / max_mismatch;
     for(size_t i=0; i<m_mismatch.size(); i+=step_size)
-      m_mismatch[i]->PrintClippedHTML( &cout, 160 );
-    cout << "</table>";
+      m_mismatch[i]->PrintClippedHTML( out, 160 );
+    *out << "</table>";
   }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <iostream>
 #include <vector>
 #include <string>
 
@@ -34,8 +35,8 @@ public:
   ~PhrasePairCollection ();
 
   int GetCollection( const std::vector<std::string >& sourceString );
-  void Print(bool pretty) const;
-  void PrintHTML() const;
+  void Print(bool pretty, std::ostream *out) const;
+  void PrintHTML(std::ostream *out) const;
 };
 
 // sorting helper
@@ -5,11 +5,24 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 namespace
 {
 
 const int LINE_MAX_LENGTH = 10000;
 
+// don't start a thread for less than this many suffixes
+const SuffixArray::INDEX MIN_THREAD_SORT = 100000;
+
 } // namespace
 
 using namespace std;
@@ -23,10 +36,18 @@ SuffixArray::SuffixArray()
     m_sentenceLength(NULL),
     m_vcb(),
     m_size(0),
-    m_sentenceCount(0) { }
+    m_sentenceCount(0),
+    m_mapped(NULL),
+    m_mappedSize(0),
+    m_sentenceCopy(NULL) { }
 
 SuffixArray::~SuffixArray()
 {
+  if (m_mapped) {
+    munmap(m_mapped, m_mappedSize);
+    free(m_sentenceCopy);
+    return;
+  }
   free(m_array);
   free(m_index);
   free(m_wordInSentence);
@@ -34,7 +55,7 @@ SuffixArray::~SuffixArray()
   free(m_sentenceLength);
 }
 
-void SuffixArray::Create(const string& fileName )
+void SuffixArray::Create(const string& fileName, int threads )
 {
   m_vcb.StoreIfNew( "<uNk>" );
   m_endOfSentence = m_vcb.StoreIfNew( "<s>" );
@@ -109,40 +130,66 @@ void SuffixArray::Create(const string& fileName )
     exit(1);
   }
 
-  Sort( 0, m_size-1 );
+  Rank();
+  Sort( 0, m_size-1, threads );
   free( m_buffer );
   cerr << "done sorting" << endl;
 }
 
-// good ol' quick sort
-void SuffixArray::Sort(INDEX start, INDEX end)
+// sort the ranks of the vocabulary once, so that comparing words is comparing numbers
+void SuffixArray::Rank()
+{
+  m_rank.resize( m_vcb.vocab.size() );
+  WORD_ID rank = 0;
+  map< WORD, WORD_ID >::const_iterator i;
+  for( i=m_vcb.lookup.begin(); i!=m_vcb.lookup.end(); i++ ) {
+    m_rank[ i->second ] = rank++;
+  }
+}
+
+// good ol' merge sort; the halves of large ranges are sorted by separate threads
+void SuffixArray::Sort(INDEX start, INDEX end, int threads)
 {
   if (start == end) return;
   INDEX mid = (start+end+1)/2;
-  Sort( start, mid-1 );
-  Sort( mid, end );
+#ifdef WITH_THREADS
+  if (threads > 1 && end-start > MIN_THREAD_SORT) {
+    boost::thread left( boost::bind( &SuffixArray::Sort, this, start, mid-1, threads/2 ) );
+    Sort( mid, end, threads - threads/2 );
+    left.join();
+  } else
+#endif
+  {
+    Sort( start, mid-1 );
+    Sort( mid, end );
+  }
+  Merge( start, mid, end );
+}
 
-  // merge
+// merge the sorted ranges start..mid-1 and mid..end, using the same part of m_buffer
+void SuffixArray::Merge(INDEX start, INDEX mid, INDEX end)
+{
+  INDEX *buffer = m_buffer + start;
   INDEX i = start;
   INDEX j = mid;
   INDEX k = 0;
   INDEX length = end-start+1;
   while( k<length ) {
     if (i == mid ) {
-      m_buffer[ k++ ] = m_index[ j++ ];
+      buffer[ k++ ] = m_index[ j++ ];
     } else if (j > end ) {
-      m_buffer[ k++ ] = m_index[ i++ ];
+      buffer[ k++ ] = m_index[ i++ ];
     } else {
       if (CompareIndex( m_index[i], m_index[j] ) < 0) {
-        m_buffer[ k++ ] = m_index[ i++ ];
+        buffer[ k++ ] = m_index[ i++ ];
       } else {
-        m_buffer[ k++ ] = m_index[ j++ ];
+        buffer[ k++ ] = m_index[ j++ ];
       }
     }
   }
 
   memcpy( ((char*)m_index) + sizeof( INDEX ) * start,
-          ((char*)m_buffer), sizeof( INDEX ) * (end-start+1) );
+          ((char*)buffer), sizeof( INDEX ) * (end-start+1) );
 }
 
 int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
@@ -162,34 +209,35 @@ int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
 
 inline int SuffixArray::CompareWord( WORD_ID a, WORD_ID b ) const
 {
-  // cerr << "c(" << m_vcb.GetWord(a) << ":" << m_vcb.GetWord(b) << ")=" << m_vcb.GetWord(a).compare( m_vcb.GetWord(b) ) << endl;
-  return m_vcb.GetWord(a).compare( m_vcb.GetWord(b) );
+  // same order as comparing the strings
+  if (m_rank[a] == m_rank[b]) return 0;
+  return m_rank[a] < m_rank[b] ? -1 : 1;
 }
 
-int SuffixArray::Count( const vector< WORD > &phrase )
+int SuffixArray::Count( const vector< WORD > &phrase ) const
 {
   INDEX dummy;
   return LimitedCount( phrase, m_size, dummy, dummy, 0, m_size-1 );
 }
 
-bool SuffixArray::MinCount( const vector< WORD > &phrase, INDEX min )
+bool SuffixArray::MinCount( const vector< WORD > &phrase, INDEX min ) const
 {
   INDEX dummy;
   return (INDEX)LimitedCount( phrase, min, dummy, dummy, 0, m_size-1 ) >= min;
 }
 
-bool SuffixArray::Exists( const vector< WORD > &phrase )
+bool SuffixArray::Exists( const vector< WORD > &phrase ) const
 {
   INDEX dummy;
   return LimitedCount( phrase, 1, dummy, dummy, 0, m_size-1 ) == 1;
 }
 
-int SuffixArray::FindMatches( const vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
+int SuffixArray::FindMatches( const vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end ) const
 {
   return LimitedCount( phrase, m_size, firstMatch, lastMatch, search_start, search_end );
 }
 
-int SuffixArray::LimitedCount( const vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
+int SuffixArray::LimitedCount( const vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end ) const
 {
   // cerr << "FindFirst\n";
   INDEX start = search_start;
@@ -212,7 +260,7 @@ int SuffixArray::LimitedCount( const vector< WORD > &phrase, INDEX min, INDEX &f
   return matchCount;
 }
 
-SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX start, INDEX end, int direction )
+SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX start, INDEX end, int direction ) const
 {
   end += direction;
   while(true) {
@@ -231,7 +279,7 @@ SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX st
   }
 }
 
-SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &start, INDEX &end )
+SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &start, INDEX &end ) const
 {
   while(true) {
     INDEX mid = ( start + end + 1 )/2;
@@ -248,7 +296,7 @@ SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &
   }
 }
 
-int SuffixArray::Match( const vector< WORD > &phrase, INDEX index )
+int SuffixArray::Match( const vector< WORD > &phrase, INDEX index ) const
 {
   INDEX pos = m_index[ index ];
   for(INDEX i=0; i<phrase.size() && i+pos<m_size; i++) {
@@ -260,7 +308,7 @@ int SuffixArray::Match( const vector< WORD > &phrase, INDEX index )
   return 0;
 }
 
-void SuffixArray::List(INDEX start, INDEX end)
+void SuffixArray::List(INDEX start, INDEX end) const
 {
   for(INDEX i=start; i<=end; i++) {
     INDEX pos = m_index[ i ];
@@ -295,57 +343,66 @@ void SuffixArray::Save(const string& fileName ) const
 
 void SuffixArray::Load(const string& fileName )
 {
-  FILE *pFile = fopen ( fileName.c_str() , "r" );
-  if (pFile == NULL) {
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if (fd == -1) {
     cerr << "no such file or directory " << fileName << endl;
     exit(1);
   }
 
   cerr << "loading from " << fileName << endl;
 
-  fread( &m_size, sizeof(INDEX), 1, pFile );
-  cerr << "words in corpus: " << m_size << endl;
-  m_array = (WORD_ID*) calloc( sizeof( WORD_ID ), m_size );
-  m_index = (INDEX*) calloc( sizeof( INDEX ), m_size );
-  m_wordInSentence = (char*) calloc( sizeof( char ), m_size );
-  m_sentence = (INDEX*) calloc( sizeof( INDEX ), m_size );
-
-  if (m_array == NULL) {
-    cerr << "Error: cannot allocate memory to m_array" << endl;
+  struct stat st;
+  if (fstat( fd, &st ) == -1 || st.st_size < (off_t) sizeof(INDEX)) {
+    cerr << "Error: cannot read " << fileName << endl;
     exit(1);
   }
-
-  if (m_index == NULL) {
-    cerr << "Error: cannot allocate memory to m_index" << endl;
+  m_mappedSize = st.st_size;
+  m_mapped = mmap( NULL, m_mappedSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if (m_mapped == MAP_FAILED) {
+    m_mapped = NULL;
+    cerr << "Error: cannot map " << fileName << " into memory" << endl;
     exit(1);
   }
 
-  if (m_wordInSentence == NULL) {
-    cerr << "Error: cannot allocate memory to m_wordInSentence" << endl;
+  // the layout written by Save()
+  char *data = (char*) m_mapped;
+  memcpy( &m_size, data, sizeof(INDEX) );
+  cerr << "words in corpus: " << m_size << endl;
+  size_t offset = sizeof(INDEX);
+  if (m_mappedSize < offset + (size_t) m_size * (sizeof(WORD_ID) + 2*sizeof(INDEX) + sizeof(char)) + sizeof(INDEX)) {
+    cerr << "Error: " << fileName << " is truncated" << endl;
     exit(1);
   }
-
-  if (m_sentence == NULL) {
-    cerr << "Error: cannot allocate memory to m_sentence" << endl;
-    exit(1);
+  m_array = (WORD_ID*) (data + offset); // corpus
+  offset += sizeof(WORD_ID) * m_size;
+  m_index = (INDEX*) (data + offset);   // suffix array
+  offset += sizeof(INDEX) * m_size;
+  m_wordInSentence = data + offset;     // word index
+  offset += sizeof(char) * m_size;
+  if (offset % sizeof(INDEX) == 0) {
+    m_sentence = (INDEX*) (data + offset); // sentence index
+  } else {
+    // follows the word index, so it is only aligned if the corpus size is a multiple of 4
+    m_sentenceCopy = (INDEX*) malloc( sizeof( INDEX ) * m_size );
+    if (m_sentenceCopy == NULL) {
+      cerr << "Error: cannot allocate memory to m_sentence" << endl;
+      exit(1);
+    }
+    memcpy( m_sentenceCopy, data + offset, sizeof( INDEX ) * m_size );
+    m_sentence = m_sentenceCopy;
   }
+  offset += sizeof(INDEX) * m_size;
 
-  fread( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
-  fread( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
-  fread( m_wordInSentence, sizeof(char), m_size, pFile); // word index
-  fread( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
-
-  fread( &m_sentenceCount, sizeof(INDEX), 1, pFile );
+  memcpy( &m_sentenceCount, data + offset, sizeof(INDEX) );
+  offset += sizeof(INDEX);
   cerr << "sentences in corpus: " << m_sentenceCount << endl;
-  m_sentenceLength = (char*) calloc( sizeof( char ), m_sentenceCount );
-
-  if (m_sentenceLength == NULL) {
-    cerr << "Error: cannot allocate memory to m_sentenceLength" << endl;
+  if (m_mappedSize < offset + m_sentenceCount) {
+    cerr << "Error: " << fileName << " is truncated" << endl;
     exit(1);
   }
-
-  fread( m_sentenceLength, sizeof(char), m_sentenceCount, pFile); // sentence length
-  fclose( pFile );
+  m_sentenceLength = data + offset; // sentence length
 
   m_vcb.Load( fileName + ".src-vcb" );
+  Rank();
 }
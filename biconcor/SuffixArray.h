@@ -2,6 +2,8 @@
 
 #include "Vocabulary.h"
 
+#include <vector>
+
 class SuffixArray
 {
 public:
@@ -9,6 +11,7 @@ public:
 
 private:
   WORD_ID *m_array;
+  std::vector<WORD_ID> m_rank; // position of each word id in the sorted vocabulary
   INDEX *m_index;
   INDEX *m_buffer;
   char *m_wordInSentence;
@@ -18,6 +21,12 @@ private:
   Vocabulary m_vcb;
   INDEX m_size;
   INDEX m_sentenceCount;
+  void *m_mapped; // the file Load() mapped, or NULL if arrays are allocated
+  size_t m_mappedSize;
+  INDEX *m_sentenceCopy; // m_sentence, if it is not aligned in the file
+
+  void Rank();
+  void Merge(INDEX start, INDEX mid, INDEX end);
 
   // No copying allowed.
   SuffixArray(const SuffixArray&);
@@ -27,19 +36,20 @@ public:
   SuffixArray();
   ~SuffixArray();
 
-  void Create(const std::string& fileName );
-  void Sort(INDEX start, INDEX end);
+  void Create(const std::string& fileName, int threads = 1 );
+  void Sort(INDEX start, INDEX end, int threads = 1);
   int CompareIndex( INDEX a, INDEX b ) const;
   inline int CompareWord( WORD_ID a, WORD_ID b ) const;
-  int Count( const std::vector< WORD > &phrase );
-  bool MinCount( const std::vector< WORD > &phrase, INDEX min );
-  bool Exists( const std::vector< WORD > &phrase );
-  int FindMatches( const std::vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = 0, INDEX search_end = -1 );
-  int LimitedCount( const std::vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = -1, INDEX search_end = 0 );
-  INDEX FindFirst( const std::vector< WORD > &phrase, INDEX &start, INDEX &end );
-  INDEX FindLast( const std::vector< WORD > &phrase, INDEX start, INDEX end, int direction );
-  int Match( const std::vector< WORD > &phrase, INDEX index );
-  void List( INDEX start, INDEX end );
+  // queries don't change the array, so threads may share it once it is created or loaded
+  int Count( const std::vector< WORD > &phrase ) const;
+  bool MinCount( const std::vector< WORD > &phrase, INDEX min ) const;
+  bool Exists( const std::vector< WORD > &phrase ) const;
+  int FindMatches( const std::vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = 0, INDEX search_end = -1 ) const;
+  int LimitedCount( const std::vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = -1, INDEX search_end = 0 ) const;
+  INDEX FindFirst( const std::vector< WORD > &phrase, INDEX &start, INDEX &end ) const;
+  INDEX FindLast( const std::vector< WORD > &phrase, INDEX start, INDEX end, int direction ) const;
+  int Match( const std::vector< WORD > &phrase, INDEX index ) const;
+  void List( INDEX start, INDEX end ) const;
   inline INDEX GetPosition( INDEX index ) const {
     return m_index[ index ];
   }
@@ -59,5 +69,6 @@ public:
     return m_vcb.GetWord( m_array[position] );
   }
   void Save(const std::string& fileName ) const;
+  //! maps the file saved by Save() into memory instead of reading it
   void Load(const std::string& fileName );
 };
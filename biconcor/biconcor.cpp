@@ -5,8 +5,123 @@
 #include <getopt.h>
 #include "base64.h"
 
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
+namespace
+{
+
+struct Corpus {
+  SuffixArray suffixArray;
+  TargetCorpus targetCorpus;
+  Alignment alignment;
+  int max_translation;
+  int max_example;
+  bool html;
+  bool pretty;
+};
+
+// the answer to one query, as in --stdio mode
+void Lookup( Corpus &corpus, const string &query, ostream *out )
+{
+  vector< string > queryString = corpus.alignment.Tokenize( query.c_str() );
+  PhrasePairCollection ppCollection( &corpus.suffixArray, &corpus.targetCorpus, &corpus.alignment, corpus.max_translation, corpus.max_example );
+  int total = ppCollection.GetCollection( queryString );
+  *out << "TOTAL: " << total << endl;
+  if (corpus.html) {
+    ppCollection.PrintHTML( out );
+  } else {
+    ppCollection.Print( corpus.pretty, out );
+  }
+  *out << "-|||- BICONCOR END -|||-" << endl;
+}
+
+bool WriteAll( int fd, const string &data )
+{
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t put = write( fd, data.data() + written, data.size() - written );
+    if (put < 0 && errno == EINTR) continue;
+    if (put <= 0) return false;
+    written += put;
+  }
+  return true;
+}
+
+// one client of --server: queries are lines, answered in order like --stdio
+void ServeConnection( Corpus *corpus, int fd )
+{
+  string in;
+  char buf[4096];
+  if (WriteAll( fd, "-|||- BICONCOR START -|||-\n" )) {
+    while (true) {
+      ssize_t got = read( fd, buf, sizeof(buf) );
+      if (got < 0 && errno == EINTR) continue;
+      if (got <= 0) break;
+      in.append( buf, got );
+      size_t begin = 0, end;
+      bool ok = true;
+      while (ok && (end = in.find( '\n', begin )) != string::npos) {
+        string query = in.substr( begin, end - begin );
+        if (!query.empty() && query[query.size()-1] == '\r') query.erase( query.size()-1 );
+        ostringstream answer;
+        Lookup( *corpus, query, &answer );
+        ok = WriteAll( fd, answer.str() );
+        begin = end + 1;
+      }
+      if (!ok) break;
+      in.erase( 0, begin );
+    }
+  }
+  close( fd );
+}
+
+void Serve( Corpus &corpus, int port )
+{
+  int listener = socket( AF_INET, SOCK_STREAM, 0 );
+  int one = 1;
+  setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+  struct sockaddr_in addr;
+  memset( &addr, 0, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_ANY );
+  addr.sin_port = htons( port );
+  if (listener == -1 ||
+      bind( listener, (struct sockaddr*) &addr, sizeof(addr) ) == -1 ||
+      listen( listener, 64 ) == -1) {
+    cerr << "error: cannot listen on port " << port << ": " << strerror(errno) << endl;
+    exit(1);
+  }
+  cerr << "listening on port " << port << endl;
+  while (true) {
+    int fd = accept( listener, NULL, NULL );
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      cerr << "error: accept failed: " << strerror(errno) << endl;
+      exit(1);
+    }
+#ifdef WITH_THREADS
+    // queries only read the corpus, so each client gets a thread
+    boost::thread( boost::bind( &ServeConnection, &corpus, fd ) ).detach();
+#else
+    ServeConnection( &corpus, fd );
+#endif
+  }
+}
+
+} // namespace
+
 int main(int argc, char* argv[])
 {
   // handle parameters
@@ -24,7 +139,9 @@ int main(int argc, char* argv[])
   int stdioFlag = false;  // receive requests from STDIN, respond to STDOUT
   int max_translation = 20;
   int max_example = 50;
-  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n";
+  int threads = 1;        // threads to sort the suffix array with
+  int port = 0;           // serve queries on this port
+  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n\t[--server port]\n\t[--threads count]\n";
   while(1) {
     static struct option long_options[] = {
       {"load", required_argument, 0, 'l'},
@@ -38,10 +155,12 @@ int main(int argc, char* argv[])
       {"stdio", no_argument, 0, 'i'},
       {"translations", required_argument, 0, 'o'},
       {"examples", required_argument, 0, 'e'},
+      {"server", required_argument, 0, 'S'},
+      {"threads", required_argument, 0, 'T'},
       {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:", long_options, &option_index);
+    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:S:T:", long_options, &option_index);
     if (c == -1) break;
     switch (c) {
     case 'l':
@@ -85,12 +204,18 @@ int main(int argc, char* argv[])
     case 'i':
       stdioFlag = true;
       break;
+    case 'S':
+      port = atoi(optarg);
+      break;
+    case 'T':
+      threads = atoi(optarg);
+      break;
     default:
       cerr << info;
       exit(1);
     }
   }
-  if (stdioFlag) {
+  if (stdioFlag || port) {
     queryFlag = true;
   }
 
@@ -113,57 +238,53 @@ int main(int argc, char* argv[])
   }
 
   // do your thing
-  SuffixArray suffixArray;
-  TargetCorpus targetCorpus;
-  Alignment alignment;
+  Corpus corpus;
+  corpus.max_translation = max_translation;
+  corpus.max_example = max_example;
+  corpus.html = htmlFlag;
+  corpus.pretty = prettyFlag;
   if (createFlag) {
     cerr << "will create\n";
     cerr << "source corpus is in " << fileNameSource << endl;
-    suffixArray.Create( fileNameSource );
+    corpus.suffixArray.Create( fileNameSource, threads );
     cerr << "target corpus is in " << fileNameTarget << endl;
-    targetCorpus.Create( fileNameTarget );
+    corpus.targetCorpus.Create( fileNameTarget );
     cerr << "alignment is in " << fileNameAlignment << endl;
-    alignment.Create( fileNameAlignment );
+    corpus.alignment.Create( fileNameAlignment );
     if (saveFlag) {
-      suffixArray.Save( fileNameSuffix );
-      targetCorpus.Save( fileNameSuffix );
-      alignment.Save( fileNameSuffix );
+      corpus.suffixArray.Save( fileNameSuffix );
+      corpus.targetCorpus.Save( fileNameSuffix );
+      corpus.alignment.Save( fileNameSuffix );
       cerr << "will save in " << fileNameSuffix << endl;
     }
   }
   if (loadFlag) {
     cerr << "will load from " << fileNameSuffix << endl;
-    suffixArray.Load( fileNameSuffix );
-    targetCorpus.Load( fileNameSuffix );
-    alignment.Load( fileNameSuffix );
+    corpus.suffixArray.Load( fileNameSuffix );
+    corpus.targetCorpus.Load( fileNameSuffix );
+    corpus.alignment.Load( fileNameSuffix );
   }
-  if (stdioFlag) {
+  if (port) {
+    Serve( corpus, port );
+  } else if (stdioFlag) {
     cout << "-|||- BICONCOR START -|||-" << endl << flush;
     while(true) {
       string query;
       if (getline(cin, query, '\n').eof()) {
         return 0;
       }
-      vector< string > queryString = alignment.Tokenize( query.c_str() );
-      PhrasePairCollection ppCollection( &suffixArray, &targetCorpus, &alignment, max_translation, max_example );
-      int total = ppCollection.GetCollection( queryString );
-      cout << "TOTAL: " << total << endl;
-      if (htmlFlag) {
-        ppCollection.PrintHTML();
-      } else {
-        ppCollection.Print(prettyFlag);
-      }
-      cout << "-|||- BICONCOR END -|||-" << endl << flush;
+      Lookup( corpus, query, &cout );
+      cout << flush;
     }
   } else if (queryFlag) {
     cerr << "query is " << query << endl;
-    vector< string > queryString = alignment.Tokenize( query.c_str() );
-    PhrasePairCollection ppCollection( &suffixArray, &targetCorpus, &alignment, max_translation, max_example );
+    vector< string > queryString = corpus.alignment.Tokenize( query.c_str() );
+    PhrasePairCollection ppCollection( &corpus.suffixArray, &corpus.targetCorpus, &corpus.alignment, max_translation, max_example );
     ppCollection.GetCollection( queryString );
     if (htmlFlag) {
-      ppCollection.PrintHTML();
+      ppCollection.PrintHTML( &cout );
     } else {
-      ppCollection.Print(prettyFlag);
+      ppCollection.Print( prettyFlag, &cout );
     }
   }
 
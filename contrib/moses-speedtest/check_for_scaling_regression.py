@@ -0,0 +1,79 @@
+"""Compares the throughput results of the last two tested commits (see
+RESULTS_DIR in the testsuite config) and flags changes in sentences/sec,
+scaling (speedup over the fewest threads tested), p99 latency, peak RSS and
+model load time. Takes the results directory as an argument."""
+import json
+import sys
+from testsuite_common import bcolors
+
+RESULTSDIR = sys.argv[1] #Get the results directory as an argument
+PERCENTAGE = 5 #Default value for how much a test should change
+if len(sys.argv) == 3:
+    PERCENTAGE = float(sys.argv[2])
+
+#Name, key, True if higher is better
+METRICS = [('Sentences/sec', 'sentences_per_second', True),\
+    ('Speedup', 'speedup', True),\
+    ('p99 latency', 'p99_seconds', False),\
+    ('Peak RSS', 'peak_rss_kb', False),\
+    ('Load time', 'load_seconds', False)]
+
+def last_two_revisions(resultsdir):
+    """The last two commits in the history file"""
+    revisions = [line.split()[2] for line in open(resultsdir + '/history')\
+        if line.strip()]
+    if len(revisions) < 2:
+        return (None, revisions[-1] if revisions else None)
+    return (revisions[-2], revisions[-1])
+
+def add_speedup(results):
+    """Throughput relative to the smallest thread count of each test"""
+    for runs in results.values():
+        base = runs[min(runs, key=int)]['sentences_per_second']
+        for run in runs.values():
+            run['speedup'] = run['sentences_per_second'] / base if base else 0.0
+
+def change(previous, current, higher_is_better):
+    """Improvement in percent, negative for a regression"""
+    if previous == 0:
+        return 0.0
+    diff = (current - previous) / previous * 100
+    return diff if higher_is_better else -diff
+
+PREVREV, CURREV = last_two_revisions(RESULTSDIR)
+if CURREV is None:
+    print("No results in " + RESULTSDIR)
+    sys.exit(0)
+CURRENT = json.load(open(RESULTSDIR + '/' + CURREV + '.json'))
+add_speedup(CURRENT)
+PREVIOUS = {}
+if PREVREV is not None:
+    PREVIOUS = json.load(open(RESULTSDIR + '/' + PREVREV + '.json'))
+    add_speedup(PREVIOUS)
+
+REGRESSED = False
+for testname in sorted(CURRENT):
+    for threads in sorted(CURRENT[testname], key=int):
+        cur = CURRENT[testname][threads]
+        label = testname + " at " + threads + " threads"
+        if testname not in PREVIOUS or threads not in PREVIOUS[testname]:
+            print(bcolors.PURPLE + "First time test! " + label + ": " +\
+                format(cur['sentences_per_second'], '.2f') +\
+                " sentences/sec. Revision: " + CURREV + bcolors.ENDC)
+            continue
+        prev = PREVIOUS[testname][threads]
+        for name, key, higher_is_better in METRICS:
+            percent = change(prev[key], cur[key], higher_is_better)
+            if percent < -PERCENTAGE:
+                REGRESSED = True
+                colour, verdict = bcolors.RED, "REGRESSION! "
+            elif percent > PERCENTAGE:
+                colour, verdict = bcolors.GREEN, "IMPROVEMENT! "
+            else:
+                continue
+            print(colour + verdict + label + " " + name + " Was: " +\
+                format(prev[key], '.4g') + " Is: " + format(cur[key], '.4g') +\
+                " Change: " + format(abs(percent), '.2f') + "%. Revision: " +\
+                CURREV + " (was " + PREVREV + ")" + bcolors.ENDC)
+
+sys.exit(1 if REGRESSED else 0)
@@ -1,9 +1,16 @@
 """Given a config file, runs tests"""
+import json
 import os
+import re
 import subprocess
 import time
 from argparse import ArgumentParser
-from testsuite_common import processLogLine
+from testsuite_common import processLogLine, percentile
+
+#GNU time output, read by split_time. maxrss is the peak RSS in kilobytes.
+TIME_FORMAT = "real %e\nuser %U\nsys %S\nmaxrss %M"
+LOAD_TIME = re.compile(r'Created input-output object : \[([0-9.]+)\] seconds')
+SENTENCE_TIME = re.compile(r'Line \d+: Translation took ([0-9.]+) seconds total')
 
 def parse_cmd():
     """Parse the command line arguments"""
@@ -54,13 +61,15 @@ def repoinit(testconfig):
 
 class Configuration:
     """A simple class to hold all of the configuration constatns"""
-    def __init__(self, repo, drop_caches, tests, testlogs, basebranch, baserev):
+    def __init__(self, repo, drop_caches, tests, testlogs, basebranch, baserev,\
+        results=''):
         self.repo = repo
         self.drop_caches = drop_caches
         self.tests = tests
         self.testlogs = testlogs
         self.basebranch = basebranch
         self.baserev = baserev
+        self.results = results # Per commit throughput results, if set
         self.singletest = None
         self.revision = None
         self.branch = 'master' # Default branch
@@ -80,16 +89,17 @@ class Configuration:
 
 class Test:
     """A simple class to contain all information about tests"""
-    def __init__(self, name, command, ldopts, permutations):
+    def __init__(self, name, command, ldopts, permutations, threads=None):
         self.name = name
         self.command = command
         self.ldopts = ldopts.replace(' ', '').split(',') #Not tested yet
         self.permutations = permutations
+        self.threads = threads or [] # Thread counts for throughput runs
 
 def parse_configfile(conffile, testdir, moses_repo):
     """Parses the config file"""
     command, ldopts = '', ''
-    permutations = []
+    permutations, threads = [], []
     fileopen = open(conffile, 'r')
     for line in fileopen:
         line = line.split('#')[0] # Discard comments
@@ -104,17 +114,19 @@ def parse_configfile(conffile, testdir, moses_repo):
             ldopts = args.replace('\n', '')
         elif opt == 'Variants:':
             permutations = args.replace('\n', '').replace(' ', '').split(',')
+        elif opt == 'Threads:':
+            threads = args.replace('\n', '').replace(' ', '').split(',')
         else:
             raise ValueError('Unrecognized option ' + opt)
     #We use the testdir as the name.
-    testcase = Test(testdir, command, ldopts, permutations)
+    testcase = Test(testdir, command, ldopts, permutations, threads)
     fileopen.close()
     return testcase
 
 def parse_testconfig(conffile):
     """Parses the config file for the whole testsuite."""
     repo_path, drop_caches, tests_dir, testlog_dir = '', '', '', ''
-    basebranch, baserev = '', ''
+    basebranch, baserev, results = '', '', ''
     fileopen = open(conffile, 'r')
     for line in fileopen:
         line = line.split('#')[0] # Discard comments
@@ -133,10 +145,12 @@ def parse_testconfig(conffile):
             basebranch = args.replace('\n', '')
         elif opt == 'BASEREV:':
             baserev = args.replace('\n', '')
+        elif opt == 'RESULTS_DIR:':
+            results = args.replace('\n', '')
         else:
             raise ValueError('Unrecognized option ' + opt)
     config = Configuration(repo_path, drop_caches, tests_dir, testlog_dir,\
-    basebranch, baserev)
+    basebranch, baserev, results)
     fileopen.close()
     return config
 
@@ -171,6 +185,67 @@ def split_time(filename):
     return (realtime, usertime, systime)
 
 
+def parse_run(time_file, stderr_file):
+    """Throughput, peak memory, model load time and latencies of one run,
+    from the GNU time output and moses' stderr (needs -v 1, the default)."""
+    realtime = float(open(time_file).readline().split()[1])
+    maxrss = 0
+    for line in open(time_file):
+        if line.startswith('maxrss'):
+            maxrss = int(line.split()[1])
+    loadtime = 0.0
+    latencies = []
+    for line in open(stderr_file, errors='replace'):
+        match = LOAD_TIME.search(line)
+        if match:
+            loadtime = float(match.group(1))
+        match = SENTENCE_TIME.search(line)
+        if match:
+            latencies.append(float(match.group(1)))
+    decodetime = max(realtime - loadtime, 0.001)
+    return {'real': realtime, 'peak_rss_kb': maxrss, 'load_seconds': loadtime,\
+        'sentences': len(latencies),\
+        'sentences_per_second': len(latencies) / decodetime,\
+        'p50_seconds': percentile(latencies, 50),\
+        'p99_seconds': percentile(latencies, 99)}
+
+def store_results(testname, results, config):
+    """Adds the results of a test to the file of the tested commit,
+    RESULTS_DIR/<revision>.json, and the commit to RESULTS_DIR/history."""
+    if not os.path.isdir(config.results):
+        os.makedirs(config.results)
+    filename = config.results + '/' + config.revision + '.json'
+    commit = {}
+    if os.path.exists(filename):
+        commit = json.load(open(filename))
+    commit[testname] = results
+    json.dump(commit, open(filename, 'w'), indent=1, sort_keys=True)
+
+    history = config.results + '/history'
+    revisions = []
+    if os.path.exists(history):
+        revisions = [line.split()[2] for line in open(history) if line.strip()]
+    if not revisions or revisions[-1] != config.revision:
+        historyfile = open(history, 'a')
+        historyfile.write(time.strftime("%d.%m.%Y %H:%M:%S") + " " +\
+            config.revision + " " + config.branch + '\n')
+        historyfile.close()
+
+def measure_throughput(testcase, config):
+    """Runs the test once per thread count and stores what parse_run finds"""
+    results = {}
+    for threads in testcase.threads:
+        subprocess.call(['sync'], shell=True)
+        subprocess.call([config.drop_caches], shell=True)
+        command = testcase.command + ' -threads ' + threads
+        print(command)
+        stderr = open('/tmp/stderr_moses_tests', 'w')
+        subprocess.Popen(['time -f "' + TIME_FORMAT + '" -o /tmp/time_moses_tests ' +\
+            command], stdout=subprocess.DEVNULL, stderr=stderr, shell=True).communicate()
+        stderr.close()
+        results[threads] = parse_run('/tmp/time_moses_tests', '/tmp/stderr_moses_tests')
+    store_results(testcase.name, results, config)
+
 def write_log(time_file, logname, config):
     """Writes to a logfile"""
     log_write = open(config.testlogs + '/' + logname, 'a') # Open logfile
@@ -221,6 +296,10 @@ def execute_tests(testcase, cur_directory, config):
                 stderr=None, shell=True).communicate()
                 write_log('/tmp/time_moses_tests', testcase.name + '_ldpre_' +opt +'_cached', config)
 
+    #Throughput at several thread counts, recorded per commit
+    if testcase.threads and config.results:
+        measure_throughput(testcase, config)
+
 # Go through all the test directories and executes tests
 if __name__ == '__main__':
     CONFIG = get_config()
@@ -260,7 +339,7 @@ if __name__ == '__main__':
         #Create a new configuration for base version tests:
         BASECONFIG = Configuration(CONFIG.repo, CONFIG.drop_caches,\
             CONFIG.tests, CONFIG.testlogs, CONFIG.basebranch,\
-            CONFIG.baserev)
+            CONFIG.baserev, CONFIG.results)
         BASECONFIG.additional_args(None, CONFIG.baserev, CONFIG.basebranch)
         #Set up the repository and get its revision:
         REVISION = repoinit(BASECONFIG)
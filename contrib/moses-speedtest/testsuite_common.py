@@ -42,6 +42,14 @@ def processLogLine(logline):
         float(logline[6]), float(logline[8]), float(logline[10]), logline[12])
     return log
 
+def percentile(values, percent):
+    """Nearest-rank percentile, 0 for no values"""
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = int(len(ordered) * percent / 100.0 + 0.5)
+    return ordered[min(max(rank, 1), len(ordered)) - 1]
+
 def getLastTwoLines(filename, logdir):
     """Just a call to tail to get the diff between the last two runs"""
     try:
@@ -7,7 +7,7 @@ use POSIX;
 my $line_start = 0;
 my $line_end = LONG_MAX;
 my $tmp_dir = "";
-my $dec_size = LONG_MAX;
+my $threads = 1;
 $_HELP = 1 if (@ARGV < 1 or !GetOptions ("moses_ini=s" => \$moses_ini, #moses conf file
 "start:i" => \$line_start, #fisrt phrase to process
 "end:i" => \$line_end, #last sentence to process (not including)
@@ -18,7 +18,7 @@ $_HELP = 1 if (@ARGV < 1 or !GetOptions ("moses_ini=s" => \$moses_ini, #moses co
 "sig_bin=s" => \$sig_bin, #binary files to calculate significance
 "moses_scripts=s" => \$moses_scripts, #dir with the moses scripts
 "tmp_dir:s" => \$tmp_dir, #dir with the moses scripts
-"dec_size:i" => \$dec_size, #dir with the moses scripts
+"threads:i" => \$threads, #number of threads to score phrase pairs with
 "workdir=s" => \$workdir)); #directory to put all the output files
 
 # help message if arguments are not correct
@@ -37,7 +37,7 @@ PARAMS:
   -moses_scripts : path to the moses training scripts (where filter-model-given-input.pl is)
   -workdir : directory to produce the output
   -tmp_dir : directory to store temporary files (improve performance if stored in a local disk), omit to store in workdir
-  -dec_size : number of phrase pairs to be decoded at a time, omit to decode all selected phrase pairs at once
+  -threads : number of threads to score the phrase pairs with (default 1)
   -start and -end : starting and ending phrase pairs to process, to be used if you want to launch multiple processes in parallel for different parts of the phrase table. If specified the process will process the phrase pairs from <start> to <end-1>
 
 For any questions contact lingwang at cs dot cmu dot edu
@@ -51,7 +51,6 @@ if ($tmp_dir eq ""){
    $TMP_DIR = "$workdir/tmp";
 }
 my $SCORE_DIR = "$workdir/scores";
-my $FILTER_DIR = "$TMP_DIR/filter";
 
 # files for divergence module
 my $SOURCE_FILE = "$TMP_DIR/source.txt";
@@ -75,7 +74,6 @@ my $RM = "rm";
 my $SORT_EXEC = "sort";
 my $PRUNE_EXEC = "$prune_bin/calcDivergence";
 my $SIG_EXEC = "$sig_bin/filter-pt";
-my $FILTER_EXEC = "perl $moses_scripts/filter-model-given-input.pl";
 my $CALC_EMP_EXEC ="perl $prune_scripts/calcEmpiricalDistribution.pl";
 my $INT_TABLE_EXEC = "perl $prune_scripts/interpolateScores.pl";
 
@@ -194,12 +192,7 @@ sub calc_div {
     print STDERR "(3.1) calculating empirical distribution".`date`;
     &calculate_empirical_distribution();
     print STDERR "(3.2) calculating divergence (this might take a while)".`date`;
-    if($N_PHRASES_TO_PROCESS > $dec_size) {
-       &calculate_divergence_shared("$FILTER_DIR");
-    }
-    else{
-       &calculate_divergence($moses_ini);
-    }
+    &calculate_divergence($moses_ini);
     print STDERR "(3.3) calculating relative entropy from empirical and divergence distributions".`date`;
     &calculate_relative_entropy();
 }
@@ -209,47 +202,13 @@ sub calculate_empirical_distribution {
     safesystem("$emp_cmd") or die("ERROR: could not run:\n $emp_cmd");
 }
 
-sub get_fragmented_file_name {
-    my ($name, $frag, $interval) = @_;
-    return "$name-$frag-".($frag+$interval);
-}    
-
 sub calculate_divergence {
     my $moses_ini_file = $_[0];
-    print STDERR "force decoding phrase pairs\n";
-    my $prune_cmd = "cat $SOURCE_FILE | $PRUNE_EXEC -f $moses_ini_file -constraint $CONSTRAINT_FILE -early-discarding-threshold 0 -s 100000 -ttable-limit 0 > $DIVERGENCE_FILE 2> /dev/null";
+    print STDERR "scoring phrase pairs against their decompositions\n";
+    my $prune_cmd = "$PRUNE_EXEC -f $moses_ini_file -i $SIG_TABLE_FILE -threads $threads > $DIVERGENCE_FILE";
     safesystem("$prune_cmd") or die("ERROR: could not run:\n $prune_cmd");
 }
 
-sub calculate_divergence_shared {
-    my $filter_dir = $_[0];
-
-    &split_file_into_chunks($SOURCE_FILE, $dec_size, $N_PHRASES_TO_PROCESS);
-    &split_file_into_chunks($CONSTRAINT_FILE, $dec_size, $N_PHRASES_TO_PROCESS);
-
-    for(my $i = 0; $i < $N_PHRASES_TO_PROCESS; $i = $i + $dec_size) {
-        my $filter_cmd = "$FILTER_EXEC ".&get_fragmented_file_name($FILTER_DIR, $i, $dec_size)." $moses_ini ".&get_fragmented_file_name($SOURCE_FILE, $i, $dec_size);
-        safesystem("$filter_cmd") or die("ERROR: could not run:\n $filter_cmd");
-
-        my $moses_ini_file = &get_fragmented_file_name($filter_dir, $i, $dec_size)."/moses.ini";
-        my $source_file = &get_fragmented_file_name($SOURCE_FILE, $i, $dec_size);
-        my $constraint_file = &get_fragmented_file_name($CONSTRAINT_FILE, $i, $dec_size);
-        my $prune_cmd;
-	print STDERR "force decoding phrase pairs $i to ".($i + $dec_size)."\n";
-	if($i == 0){
-            $prune_cmd = "cat $source_file | $PRUNE_EXEC -f $moses_ini_file -constraint $constraint_file -early-discarding-threshold 0 -s 100000 -ttable-limit 0 > $DIVERGENCE_FILE 2> /dev/null";
-	}
-	else{
-            $prune_cmd = "cat $source_file | $PRUNE_EXEC -f $moses_ini_file -constraint $constraint_file -early-discarding-threshold 0 -s 100000 -ttable-limit 0 >> $DIVERGENCE_FILE 2> /dev/null";
-	}
-        safesystem("$prune_cmd") or die("ERROR: could not run:\n $prune_cmd");
-
-	my $rm_cmd = "$RM -r ".&get_fragmented_file_name($FILTER_DIR, $i, $dec_size);
-        safesystem("$rm_cmd") or die("ERROR: could not run:\n $rm_cmd");
-
-    }
-}
-
 sub calculate_relative_entropy {
     my $int_cmd = "$INT_TABLE_EXEC -files \"$EMP_DIST_FILE $DIVERGENCE_FILE\" -weights \"1 1\" -operation \"*\" > $REL_ENT_FILE";
     safesystem("$int_cmd") or die("ERROR: could not run:\n $int_cmd");
@@ -330,22 +289,3 @@ sub get_number_of_phrases {
    close (TABLE_READER);
    return $ret;
 }
-
-sub split_file_into_chunks {
-    my ($file_to_split, $chunk_size, $number_of_phrases_to_process) = @_;
-    open(SOURCE_READER, &open_compressed($file_to_split)) or die "ERROR: Can't read $file_to_split";
-    my $FRAG_SOURCE_WRITER;
-    for(my $i = 0; $i < $number_of_phrases_to_process && !eof(SOURCE_READER); $i++) {
-       if(($i % $chunk_size) == 0){ # open fragmented file to write
-          my $frag_file = &get_fragmented_file_name($file_to_split, $i, $chunk_size);
-          open(FRAG_SOURCE_WRITER, ">".$frag_file) or die "ERROR: Can't write $frag_file";
-       }
-       my $line = <SOURCE_READER>;
-       print FRAG_SOURCE_WRITER $line;
-       if((%i % $chunk_size) == $chunk_size - 1 || (%i % $chunk_size) == $number_of_phrases_to_process - 1){ # close fragmented file before opening a new one
-          close(FRAG_SOURCE_WRITER);
-       }
-    }
-}
-
-
@@ -0,0 +1,110 @@
+#include "lm/model.hh"
+#include "util/file_piece.hh"
+#include "util/getopt.hh"
+#include "util/tokenize_piece.hh"
+#include "util/usage.hh"
+
+#include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+
+/* Measures raw query speed so the data structures can be compared on the
+ * same text: build the same ARPA as probing, trie, quantized trie, etc. and
+ * run this on each.  The text is converted to vocabulary ids before timing,
+ * so only FullScore is measured.
+ */
+
+void Usage(const char *name) {
+  std::cerr <<
+    "KenLM was compiled with maximum order " << KENLM_MAX_ORDER << ".\n"
+    "Usage: " << name << " [-i iterations] lm_file <text\n"
+    "Scores the text, one sentence per line, iterations times (default 10) and\n"
+    "reports queries per second.\n";
+  exit(1);
+}
+
+template <class Model> void Benchmark(const char *file, unsigned int iterations) {
+  lm::ngram::Config config;
+  config.messages = NULL;
+  Model model(file, config);
+  const typename Model::Vocabulary &vocab = model.GetVocabulary();
+
+  // Vocabulary ids with end of sentence after each line.
+  std::vector<lm::WordIndex> text;
+  util::FilePiece in(0, NULL);
+  StringPiece line;
+  while (in.ReadLineOrEOF(line)) {
+    for (util::TokenIter<util::BoolCharacter, true> word(line, util::kSpaces); word; ++word) {
+      text.push_back(vocab.Index(*word));
+    }
+    text.push_back(vocab.EndSentence());
+  }
+
+  double start = util::WallTime();
+  float total = 0.0;
+  lm::ngram::State state[2];
+  for (unsigned int i = 0; i < iterations; ++i) {
+    const lm::ngram::State *in_state = &model.BeginSentenceState();
+    for (std::vector<lm::WordIndex>::const_iterator w = text.begin(); w != text.end(); ++w) {
+      lm::ngram::State *out_state = &state[(w - text.begin()) & 1];
+      total += model.FullScore(*in_state, *w, *out_state).prob;
+      in_state = (*w == vocab.EndSentence()) ? &model.BeginSentenceState() : out_state;
+    }
+  }
+  double elapsed = util::WallTime() - start;
+  uint64_t queries = static_cast<uint64_t>(text.size()) * iterations;
+  // Print the total so the compiler can't drop the queries.
+  std::cout << "Queries: " << queries << "\tSeconds: " << elapsed << "\tQueries/s: " << (elapsed > 0.0 ? queries / elapsed : 0.0) << "\tTotal: " << total << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int iterations = 10;
+  int opt;
+  while ((opt = getopt(argc, argv, "hi:")) != -1) {
+    switch (opt) {
+      case 'i':
+        iterations = atoi(optarg);
+        break;
+      case 'h':
+      default:
+        Usage(argv[0]);
+    }
+  }
+  if (optind + 1 != argc)
+    Usage(argv[0]);
+  const char *file = argv[optind];
+  try {
+    using namespace lm::ngram;
+    ModelType model_type;
+    if (!RecognizeBinary(file, model_type)) model_type = PROBING;
+    switch(model_type) {
+      case PROBING:
+        Benchmark<ProbingModel>(file, iterations);
+        break;
+      case REST_PROBING:
+        Benchmark<RestProbingModel>(file, iterations);
+        break;
+      case TRIE:
+        Benchmark<TrieModel>(file, iterations);
+        break;
+      case QUANT_TRIE:
+        Benchmark<QuantTrieModel>(file, iterations);
+        break;
+      case ARRAY_TRIE:
+        Benchmark<ArrayTrieModel>(file, iterations);
+        break;
+      case QUANT_ARRAY_TRIE:
+        Benchmark<QuantArrayTrieModel>(file, iterations);
+        break;
+      default:
+        std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
+        abort();
+    }
+    util::PrintUsage(std::cerr);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
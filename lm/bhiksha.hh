@@ -76,11 +76,18 @@ class ArrayBhiksha {
     void ReadNext(const void *base, uint64_t bit_offset, uint64_t index, uint8_t total_bits, NodeRange &out) const {
       // Some assertions are commented out because they are expensive.
       // assert(*offset_begin_ == 0);
-      // std::upper_bound returns the first element that is greater.  Want the
-      // last element that is <= to the index.
-      const uint64_t *begin_it = std::upper_bound(offset_begin_, offset_end_, index) - 1;
-      // Since *offset_begin_ == 0, the position should be in range.
-      // assert(begin_it >= offset_begin_);
+      // Want the last element that is <= to the index.  This runs on every
+      // trie lookup, so search without branches (the compiler emits a
+      // conditional move) instead of std::upper_bound, whose unpredictable
+      // branches dominate on large tables.  Since *offset_begin_ == 0, the
+      // answer is always in [begin_it, begin_it + remaining).
+      const uint64_t *begin_it = offset_begin_;
+      for (std::size_t remaining = offset_end_ - offset_begin_; remaining > 1;) {
+        const std::size_t half = remaining / 2;
+        begin_it = (begin_it[half] <= index) ? begin_it + half : begin_it;
+        remaining -= half;
+      }
+      // assert(begin_it == std::upper_bound(offset_begin_, offset_end_, index) - 1);
       const uint64_t *end_it;
       for (end_it = begin_it + 1; (end_it < offset_end_) && (*end_it <= index + 1); ++end_it) {}
       // assert(end_it == std::upper_bound(offset_begin_, offset_end_, index + 1));
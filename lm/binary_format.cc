@@ -137,7 +137,7 @@ const std::size_t kInvalidSize = static_cast<std::size_t>(-1);
 
 BinaryFormat::BinaryFormat(const Config &config) 
   : write_method_(config.write_method), write_mmap_(config.write_mmap), load_method_(config.load_method),
-    header_size_(kInvalidSize), vocab_size_(kInvalidSize), vocab_string_offset_(kInvalidOffset) {}
+    progress_(config.ProgressMessages()), header_size_(kInvalidSize), vocab_size_(kInvalidSize), vocab_string_offset_(kInvalidOffset) {}
 
 void BinaryFormat::InitializeBinary(int fd, ModelType model_type, unsigned int search_version, Parameters &params) {
   file_.reset(fd);
@@ -159,7 +159,7 @@ void *BinaryFormat::LoadBinary(std::size_t size) {
   uint64_t total_map = static_cast<uint64_t>(header_size_) + static_cast<uint64_t>(size);
   UTIL_THROW_IF(file_size != util::kBadSize && file_size < total_map, FormatLoadException, "Binary file has size " << file_size << " but the headers say it should be at least " << total_map);
 
-  util::MapRead(load_method_, file_.get(), 0, util::CheckOverflow(total_map), mapping_);
+  util::MapRead(load_method_, file_.get(), 0, util::CheckOverflow(total_map), mapping_, progress_);
 
   vocab_string_offset_ = total_map;
   return reinterpret_cast<uint8_t*>(mapping_.get()) + header_size_;
@@ -71,6 +71,11 @@ class BinaryFormat {
     // Write the header at the beginning of the file.
     void FinishFile(const Config &config, ModelType model_type, unsigned int search_version, const std::vector<uint64_t> &counts);
 
+    // Memory holding the model: the mapping of a binary file, or the separate
+    // allocations of vocabulary and search when built in memory.
+    const util::scoped_memory &Mapping() const { return mapping_; }
+    std::size_t AllocatedSize() const { return memory_vocab_.size() + memory_search_.size(); }
+
   private:
     void MapFile(void *&vocab_base, void *&search_base);
 
@@ -78,6 +83,7 @@ class BinaryFormat {
     const Config::WriteMethod write_method_;
     const char *write_mmap_;
     util::LoadMethod load_method_;
+    std::ostream *progress_;
 
     // File behind memory, if any.  
     util::scoped_fd file_;
@@ -8,12 +8,15 @@
 #include "util/file.hh"
 #include "util/file_piece.hh"
 #include "util/murmur_hash.hh"
+#include "util/pcqueue.hh"
 #include "util/probing_hash_table.hh"
 #include "util/scoped.hh"
 #include "util/stream/chain.hh"
 #include "util/stream/timer.hh"
 #include "util/tokenize_piece.hh"
 
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 
@@ -164,6 +167,83 @@ class Writer {
     const std::size_t block_size_;
 };
 
+// Word ids are handed from the tokenizing thread to the n-gram writer in
+// batches.  kBOS (never a corpus word) marks the start of a sentence.
+const std::size_t kTokenBatchSize = 1 << 16;
+const std::size_t kTokenBatchCount = 8;
+
+typedef util::PCQueue<std::vector<WordIndex> *> TokenQueue;
+
+void ComplainDisallowed(StringPiece word, WarningAction &action) {
+  switch (action) {
+    case SILENT:
+      return;
+    case COMPLAIN:
+      std::cerr << "Warning: " << word << " appears in the input.  All instances of <s>, </s>, and <unk> will be interpreted as whitespace." << std::endl;
+      action = SILENT;
+      return;
+    case THROW_UP:
+      UTIL_THROW(FormatLoadException, "Special word " << word << " is not allowed in the corpus.  I plan to support models containing <unk> in the future.  Pass --skip_symbols to convert these symbols to whitespace.");
+  }
+}
+
+// Reads and tokenizes the corpus and looks up the vocabulary while the
+// n-gram writer deduplicates, so the two run on separate cores.  An
+// exception ends the input and is reported by CorpusCount::Run.
+class TokenReader {
+  public:
+    TokenReader(util::FilePiece &from, ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab, WarningAction &disallowed_symbol_action, TokenQueue &full, TokenQueue &empty)
+      : from_(from), vocab_(vocab), disallowed_symbol_action_(disallowed_symbol_action), full_(full), empty_(empty), count_(0) {}
+
+    void operator()() {
+      const WordIndex end_sentence = vocab_.FindOrInsert("</s>");
+      bool delimiters[256];
+      util::BoolCharacter::Build("\0\t\n\r ", delimiters);
+      std::vector<WordIndex> *batch = empty_.Consume();
+      try {
+        while (true) {
+          StringPiece line(from_.ReadLine());
+          Add(kBOS, batch);
+          for (util::TokenIter<util::BoolCharacter, true> w(line, delimiters); w; ++w) {
+            WordIndex word = vocab_.FindOrInsert(*w);
+            if (word <= 2) {
+              ComplainDisallowed(*w, disallowed_symbol_action_);
+              continue;
+            }
+            Add(word, batch);
+            ++count_;
+          }
+          Add(end_sentence, batch);
+        }
+      } catch (const util::EndOfFileException &e) {
+      } catch (const std::exception &e) {
+        error_ = e.what();
+      }
+      full_.Produce(batch);
+      full_.Produce(NULL);
+    }
+
+    uint64_t Count() const { return count_; }
+
+    const std::string &Error() const { return error_; }
+
+  private:
+    void Add(WordIndex word, std::vector<WordIndex> *&batch) {
+      batch->push_back(word);
+      if (batch->size() == kTokenBatchSize) {
+        full_.Produce(batch);
+        batch = empty_.Consume();
+      }
+    }
+
+    util::FilePiece &from_;
+    ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab_;
+    WarningAction &disallowed_symbol_action_;
+    TokenQueue &full_, &empty_;
+    uint64_t count_;
+    std::string error_;
+};
+
 } // namespace
 
 float CorpusCount::DedupeMultiplier(std::size_t order) {
@@ -174,6 +254,10 @@ std::size_t CorpusCount::VocabUsage(std::size_t vocab_estimate) {
   return ngram::GrowableVocab<ngram::WriteUniqueWords>::MemUsage(vocab_estimate);
 }
 
+std::size_t CorpusCount::TokenBufferUsage() {
+  return kTokenBatchSize * kTokenBatchCount * sizeof(WordIndex);
+}
+
 CorpusCount::CorpusCount(util::FilePiece &from, int vocab_write, uint64_t &token_count, WordIndex &type_count, std::vector<bool> &prune_words, const std::string& prune_vocab_filename, std::size_t entries_per_block, WarningAction disallowed_symbol)
   : from_(from), vocab_write_(vocab_write), token_count_(token_count), type_count_(type_count),
     prune_words_(prune_words), prune_vocab_filename_(prune_vocab_filename),
@@ -182,48 +266,40 @@ CorpusCount::CorpusCount(util::FilePiece &from, int vocab_write, uint64_t &token
     disallowed_symbol_action_(disallowed_symbol) {
 }
 
-namespace {
-  void ComplainDisallowed(StringPiece word, WarningAction &action) {
-    switch (action) {
-      case SILENT:
-        return;
-      case COMPLAIN:
-        std::cerr << "Warning: " << word << " appears in the input.  All instances of <s>, </s>, and <unk> will be interpreted as whitespace." << std::endl;
-        action = SILENT;
-        return;
-      case THROW_UP:
-        UTIL_THROW(FormatLoadException, "Special word " << word << " is not allowed in the corpus.  I plan to support models containing <unk> in the future.  Pass --skip_symbols to convert these symbols to whitespace.");
-    }
-  }
-} // namespace
-
 void CorpusCount::Run(const util::stream::ChainPosition &position) {
   ngram::GrowableVocab<ngram::WriteUniqueWords> vocab(type_count_, vocab_write_);
   token_count_ = 0;
   type_count_ = 0;
-  const WordIndex end_sentence = vocab.FindOrInsert("</s>");
-  Writer writer(NGram::OrderFromSize(position.GetChain().EntrySize()), position, dedupe_mem_.get(), dedupe_mem_size_);
-  uint64_t count = 0;
-  bool delimiters[256];
-  util::BoolCharacter::Build("\0\t\n\r ", delimiters);
-  try {
-    while(true) {
-      StringPiece line(from_.ReadLine());
-      writer.StartSentence();
-      for (util::TokenIter<util::BoolCharacter, true> w(line, delimiters); w; ++w) {
-        WordIndex word = vocab.FindOrInsert(*w);
-        if (word <= 2) {
-          ComplainDisallowed(*w, disallowed_symbol_action_);
-          continue;
+  std::vector<std::vector<WordIndex> > batches(kTokenBatchCount);
+  TokenQueue full(kTokenBatchCount + 1), empty(kTokenBatchCount);
+  for (std::size_t i = 0; i < kTokenBatchCount; ++i) {
+    batches[i].reserve(kTokenBatchSize);
+    empty.Produce(&batches[i]);
+  }
+  TokenReader reader(from_, vocab, disallowed_symbol_action_, full, empty);
+  {
+    Writer writer(NGram::OrderFromSize(position.GetChain().EntrySize()), position, dedupe_mem_.get(), dedupe_mem_size_);
+    boost::thread reader_thread(boost::ref(reader));
+    std::vector<WordIndex> *batch;
+    while ((batch = full.Consume())) {
+      for (std::vector<WordIndex>::const_iterator i = batch->begin(); i != batch->end(); ++i) {
+        if (*i == kBOS) {
+          writer.StartSentence();
+        } else {
+          writer.Append(*i);
         }
-        writer.Append(word);
-        ++count;
       }
-      writer.Append(end_sentence);
+      batch->clear();
+      empty.Produce(batch);
     }
-  } catch (const util::EndOfFileException &e) {}
-  token_count_ = count;
+    reader_thread.join();
+  }
+  UTIL_THROW_IF(!reader.Error().empty(), FormatLoadException, reader.Error());
+  token_count_ = reader.Count();
   type_count_ = vocab.Size();
+
+  bool delimiters[256];
+  util::BoolCharacter::Build("\0\t\n\r ", delimiters);
   
   // Create list of unigrams that are supposed to be pruned
   if (!prune_vocab_filename_.empty()) {
@@ -28,6 +28,9 @@ class CorpusCount {
     // How much memory vocabulary will use based on estimated size of the vocab.
     static std::size_t VocabUsage(std::size_t vocab_estimate);
 
+    // Memory used by the batches passed from the tokenizing thread.
+    static std::size_t TokenBufferUsage();
+
     // token_count: out.
     // type_count aka vocabulary size.  Initialize to an estimate.  It is set to the exact value.
     CorpusCount(util::FilePiece &from, int vocab_write, uint64_t &token_count, WordIndex &type_count, std::vector<bool> &prune_words, const std::string& prune_vocab_filename, std::size_t entries_per_block, WarningAction disallowed_symbol);
@@ -40,7 +43,7 @@ class CorpusCount {
     uint64_t &token_count_;
     WordIndex &type_count_;
     std::vector<bool>& prune_words_;
-    const std::string& prune_vocab_filename_; 
+    const std::string prune_vocab_filename_;
 
     std::size_t dedupe_mem_size_;
     util::scoped_malloc dedupe_mem_;
@@ -2,16 +2,23 @@
 #include "lm/builder/pipeline.hh"
 #include "lm/builder/print.hh"
 #include "lm/lm_exception.hh"
+#include "lm/model.hh"
 #include "util/file.hh"
 #include "util/file_piece.hh"
 #include "util/usage.hh"
 
 #include <iostream>
+#include <sstream>
 
 #include <boost/program_options.hpp>
+#include <boost/ref.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/version.hpp>
 #include <vector>
 
+#include <unistd.h>
+
 namespace {
 class SizeNotify {
   public:
@@ -66,6 +73,44 @@ std::vector<uint64_t> ParsePruning(const std::vector<std::string> &param, std::s
   return prune_thresholds;
 }
 
+// Builds a binary model from the ARPA that lmplz writes into a pipe, so the
+// ARPA text never goes to disk.  This is what build_binary does with default
+// options for the probing and trie structures.
+class BinaryBuilder {
+  public:
+    BinaryBuilder(int arpa_fd, const std::string &file, const std::string &type, const std::string &temp_prefix)
+      : arpa_fd_(arpa_fd), file_(file), type_(type), temp_prefix_(temp_prefix) {}
+
+    void operator()() {
+      try {
+        std::ostringstream name;
+        name << "/dev/fd/" << arpa_fd_.get();
+        lm::ngram::Config config;
+        config.write_mmap = file_.c_str();
+        config.temporary_directory_prefix = temp_prefix_;
+        if (type_ == "trie") {
+          config.write_method = lm::ngram::Config::WRITE_MMAP;
+          lm::ngram::TrieModel(name.str().c_str(), config);
+        } else {
+          config.write_method = lm::ngram::Config::WRITE_AFTER;
+          lm::ngram::ProbingModel(name.str().c_str(), config);
+        }
+      } catch (const std::exception &e) {
+        error_ = e.what();
+        // Drain the pipe so lmplz does not block or die of SIGPIPE.
+        char buf[4096];
+        while (util::ReadOrEOF(arpa_fd_.get(), buf, sizeof(buf))) {}
+      }
+    }
+
+    const std::string &Error() const { return error_; }
+
+  private:
+    util::scoped_fd arpa_fd_;
+    std::string file_, type_, temp_prefix_;
+    std::string error_;
+};
+
 lm::builder::Discount ParseDiscountFallback(const std::vector<std::string> &param) {
   lm::builder::Discount ret;
   UTIL_THROW_IF(param.size() > 3, util::Exception, "Specify at most three fallback discounts: 1, 2, and 3+");
@@ -87,7 +132,7 @@ int main(int argc, char *argv[]) {
     po::options_description options("Language model building options");
     lm::builder::PipelineConfig pipeline;
 
-    std::string text, arpa;
+    std::string text, arpa, binary, binary_type;
     std::vector<std::string> pruning;
     std::vector<std::string> discount_fallback;
     std::vector<std::string> discount_fallback_default;
@@ -116,6 +161,8 @@ int main(int argc, char *argv[]) {
       ("verbose_header", po::bool_switch(&verbose_header), "Add a verbose header to the ARPA file that includes information such as token count, smoothing type, etc.")
       ("text", po::value<std::string>(&text), "Read text from a file instead of stdin")
       ("arpa", po::value<std::string>(&arpa), "Write ARPA to a file instead of stdout")
+      ("binary", po::value<std::string>(&binary), "Build a KenLM binary file directly, without writing an ARPA file (unless --arpa is also given)")
+      ("binary_type", po::value<std::string>(&binary_type)->default_value("probing"), "Data structure for --binary: probing or trie")
       ("collapse_values", po::bool_switch(&pipeline.output_q), "Collapse probability and backoff into a single value, q that yields the same sentence-level probabilities.  See http://kheafield.com/professional/edinburgh/rest_paper.pdf for more details, including a proof.")
       ("prune", po::value<std::vector<std::string> >(&pruning)->multitoken(), "Prune n-grams with count less than or equal to the given threshold.  Specify one value for each order i.e. 0 0 1 to prune singleton trigrams and above.  The sequence of values must be non-decreasing and the last value applies to any remaining orders. Default is to not prune, which is equivalent to --prune 0.")
       ("limit_vocab_file", po::value<std::string>(&pipeline.prune_vocab_file)->default_value(""), "Read allowed vocabulary separated by whitespace. N-grams that contain vocabulary items not in this list will be pruned. Can be combined with --prune arg")
@@ -167,6 +214,11 @@ int main(int argc, char *argv[]) {
       return 1;
     }
 
+    if (binary_type != "probing" && binary_type != "trie") {
+      std::cerr << "--binary_type must be probing or trie" << std::endl;
+      return 1;
+    }
+
     if (vm["skip_symbols"].as<bool>()) {
       pipeline.disallowed_symbol_action = lm::COMPLAIN;
     } else {
@@ -211,15 +263,37 @@ int main(int argc, char *argv[]) {
       out.reset(util::CreateOrThrow(arpa.c_str()));
     }
 
+    boost::scoped_ptr<BinaryBuilder> builder;
+    boost::thread builder_thread;
+    bool out_of_memory = false;
     try {
       lm::builder::Output output;
-      output.Add(new lm::builder::PrintARPA(out.release(), verbose_header));
+      if (!binary.empty()) {
+        int fds[2];
+        UTIL_THROW_IF(pipe(fds), util::ErrnoException, "Could not create a pipe for the binary builder");
+        builder.reset(new BinaryBuilder(fds[0], binary, binary_type, pipeline.sort.temp_prefix));
+        builder_thread = boost::thread(boost::ref(*builder));
+        // Both hooks read the same chains, so the ARPA file is optional.
+        output.Add(new lm::builder::PrintARPA(fds[1], verbose_header));
+        if (vm.count("arpa")) output.Add(new lm::builder::PrintARPA(out.release(), verbose_header));
+      } else {
+        output.Add(new lm::builder::PrintARPA(out.release(), verbose_header));
+      }
       lm::builder::Pipeline(pipeline, in.release(), output);
     } catch (const util::MallocException &e) {
       std::cerr << e.what() << std::endl;
       std::cerr << "Try rerunning with a more conservative -S setting than " << vm["memory"].as<std::string>() << std::endl;
-      return 1;
+      out_of_memory = true;
+    }
+    // Output's destructor closed the pipe, so the builder sees EOF.
+    if (builder) {
+      builder_thread.join();
+      if (!out_of_memory && !builder->Error().empty()) {
+        std::cerr << builder->Error() << std::endl;
+        return 1;
+      }
     }
+    if (out_of_memory) return 1;
     util::PrintUsage(std::cerr);
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
@@ -58,7 +58,7 @@ class Master {
       const std::size_t min_chains = (config_.order - 1) * each_order_min +
         std::min(types * NGram::TotalSize(1), each_order_min);
       // Do merge sort with calculated laziness.
-      const std::size_t merge_using = ngrams.Merge(std::min(config_.TotalMemory() - min_chains, ngrams.DefaultLazy()));
+      const std::size_t merge_using = MergeWithin(ngrams, std::min(config_.TotalMemory() - min_chains, ngrams.DefaultLazy()));
 
       std::vector<uint64_t> count_bounds(1, types);
       CreateChains(config_.TotalMemory() - merge_using, count_bounds);
@@ -102,8 +102,7 @@ class Master {
       std::vector<std::size_t> laziness;
       // Prioritize longer n-grams.
       for (util::stream::Sort<SuffixOrder> *i = sorts.end() - 1; i >= sorts.begin(); --i) {
-        laziness.push_back(i->Merge(for_merge));
-        assert(for_merge >= laziness.back());
+        laziness.push_back(MergeWithin(*i, for_merge));
         for_merge -= laziness.back();
       }
       std::reverse(laziness.begin(), laziness.end());
@@ -141,6 +140,16 @@ class Master {
     }
 
   private:
+    /* Sort::Merge may report that the lazy merge needs one buffer even
+     * when asked for less.  Merge all the way in that case so that lazy
+     * merging never takes memory beyond -S.
+     */
+    template <class Sort> static std::size_t MergeWithin(Sort &sort, std::size_t lazy_memory) {
+      std::size_t needed = sort.Merge(lazy_memory);
+      if (needed > lazy_memory) needed = sort.Merge(0);
+      return needed;
+    }
+
     // Create chains, allocating memory to them.  Totally heuristic.  Count
     // bounds are upper bounds on the counts or not present.
     void CreateChains(std::size_t remaining_mem, const std::vector<uint64_t> &count_bounds) {
@@ -212,7 +221,7 @@ void CountText(int text_file /* input */, int vocab_file /* output */, Master &m
   const PipelineConfig &config = master.Config();
   std::cerr << "=== 1/5 Counting and sorting n-grams ===" << std::endl;
 
-  const std::size_t vocab_usage = CorpusCount::VocabUsage(config.vocab_estimate);
+  const std::size_t vocab_usage = CorpusCount::VocabUsage(config.vocab_estimate) + CorpusCount::TokenBufferUsage();
   UTIL_THROW_IF(config.TotalMemory() < vocab_usage, util::Exception, "Vocab hash size estimate " << vocab_usage << " exceeds total memory " << config.TotalMemory());
   std::size_t memory_for_chain = 
     // This much memory to work with after vocab hash table.
@@ -0,0 +1,153 @@
+#ifndef LM_FILTER_BINARY_IO_H
+#define LM_FILTER_BINARY_IO_H
+/* Input from KenLM binary files so they can be copied or filtered without
+ * keeping the ARPA around.  The n-grams are regenerated as ARPA lines and fed
+ * to the same outputs and filters as ReadARPA.  Only the trie data structures
+ * can be read back: probing files store hashes of n-grams, not their words.
+ * The binary must also have been built with its vocabulary (the default).
+ */
+
+#include "lm/enumerate_vocab.hh"
+#include "lm/filter/arpa_io.hh"
+#include "lm/lm_exception.hh"
+#include "lm/model.hh"
+#include "util/double-conversion/double-conversion.h"
+#include "util/double-conversion/utils.h"
+#include "util/exception.hh"
+#include "util/string_piece.hh"
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace lm {
+
+class VocabStrings : public EnumerateVocab {
+  public:
+    void Add(WordIndex index, const StringPiece &str) {
+      if (index >= words_.size()) words_.resize(index + 1);
+      words_[index].assign(str.data(), str.size());
+    }
+
+    const std::vector<std::string> &Words() const { return words_; }
+
+  private:
+    std::vector<std::string> words_;
+};
+
+// Names a binary file to be read by ReadBinary.
+class BinaryInput {
+  public:
+    explicit BinaryInput(const char *file) : file_(file) {}
+
+    const char *File() const { return file_; }
+
+  private:
+    const char *file_;
+};
+
+namespace detail {
+
+struct CountNGrams {
+  CountNGrams() : count(0) {}
+  void operator()(const WordIndex * /*reversed*/, float /*prob*/, float /*backoff*/) { ++count; }
+  uint64_t count;
+};
+
+// Formats n-grams visited in the trie as ARPA lines and hands them to out.
+template <class Output> class ARPALineMaker {
+  public:
+    ARPALineMaker(const std::vector<std::string> &words, unsigned char length, bool highest, Output &out)
+      : words_(words), length_(length), highest_(highest), out_(out),
+        convert_(double_conversion::DoubleToStringConverter::NO_FLAGS, "inf", "NaN", 'e', -6, 21, 6, 0) {}
+
+    void operator()(const WordIndex *reversed, float prob, float backoff) {
+      line_.clear();
+      AppendFloat(prob);
+      line_ += '\t';
+      std::size_t ngram_begin = line_.size();
+      for (const WordIndex *i = reversed + length_ - 1; ; --i) {
+        line_ += words_[*i];
+        if (i == reversed) break;
+        line_ += ' ';
+      }
+      std::size_t ngram_end = line_.size();
+      if (!highest_) {
+        line_ += '\t';
+        // Drop the sign of -0.0, which only marks that the n-gram does not extend.
+        AppendFloat(backoff == 0.0 ? 0.0 : backoff);
+      }
+      out_.AddNGram(StringPiece(line_.data() + ngram_begin, ngram_end - ngram_begin), StringPiece(line_));
+    }
+
+  private:
+    void AppendFloat(float value) {
+      double_conversion::StringBuilder builder(float_, sizeof(float_));
+      convert_.ToShortestSingle(value, &builder);
+      line_.append(float_, builder.position());
+    }
+
+    const std::vector<std::string> &words_;
+    const unsigned char length_;
+    const bool highest_;
+    Output &out_;
+
+    double_conversion::DoubleToStringConverter convert_;
+    char float_[double_conversion::DoubleToStringConverter::kMaxPrecisionDigits + 8];
+    std::string line_;
+};
+
+template <class Search, class Output> void ReadTrie(const Search &search, unsigned char order, const std::vector<std::string> &words, Output &out) {
+  std::vector<uint64_t> number(order);
+  for (unsigned char length = 1; length <= order; ++length) {
+    CountNGrams counter;
+    search.VisitOrder(length, words.size(), counter);
+    number[length - 1] = counter.count;
+  }
+  out.ReserveForCounts(SizeNeededForCounts(number));
+  for (unsigned char length = 1; length <= order; ++length) {
+    out.BeginLength(length);
+    ARPALineMaker<Output> maker(words, length, length == order, out);
+    search.VisitOrder(length, words.size(), maker);
+    out.EndLength(length);
+  }
+  out.Finish();
+}
+
+template <class Model, class Output> void ReadTrieModel(const char *file, Output &out) {
+  VocabStrings strings;
+  ngram::Config config;
+  config.enumerate_vocab = &strings;
+  config.messages = NULL;
+  Model model(file, config);
+  UTIL_THROW_IF(strings.Words().size() != model.GetVocabulary().Bound(), FormatLoadException, "The binary file " << file << " does not contain its vocabulary strings, so n-grams cannot be recovered from it.");
+  ReadTrie(model.GetSearch(), model.Order(), strings.Words(), out);
+}
+
+} // namespace detail
+
+template <class Output> void ReadBinary(const char *file, Output &out) {
+  ngram::ModelType type;
+  UTIL_THROW_IF(!ngram::RecognizeBinary(file, type), FormatLoadException, file << " is not a KenLM binary file.");
+  switch (type) {
+    case ngram::TRIE:
+      detail::ReadTrieModel<ngram::TrieModel>(file, out);
+      break;
+    case ngram::QUANT_TRIE:
+      detail::ReadTrieModel<ngram::QuantTrieModel>(file, out);
+      break;
+    case ngram::ARRAY_TRIE:
+      detail::ReadTrieModel<ngram::ArrayTrieModel>(file, out);
+      break;
+    case ngram::QUANT_ARRAY_TRIE:
+      detail::ReadTrieModel<ngram::QuantArrayTrieModel>(file, out);
+      break;
+    default:
+      UTIL_THROW(FormatLoadException, "The binary file " << file << " uses the probing data structure, which stores hashes instead of words.  Only trie binaries can be filtered.");
+  }
+}
+
+} // namespace lm
+
+#endif // LM_FILTER_BINARY_IO_H
@@ -38,7 +38,9 @@ void DisplayHelp(const char *name) {
     "The file format is set by [raw|arpa] with default arpa:\n"
     "raw means space-separated tokens, optionally followed by a tab and arbitrary\n"
     "    text.  This is useful for ngram count files.\n"
-    "arpa means the ARPA file format for n-gram language models.\n\n"
+    "arpa means the ARPA file format for n-gram language models.  A KenLM trie\n"
+    "    binary given as the model file is also accepted; it is read back and the\n"
+    "    output is written in ARPA format.\n\n"
 #ifndef NTHREAD
     "threads:m sets m threads (default: conccurrency detected by boost)\n"
     "batch_size:m sets the batch size for threading.  Expect memory usage from this\n"
@@ -82,7 +84,7 @@ struct Config {
   Format format;
 };
 
-template <class Format, class Filter, class OutputBuffer, class Output> void RunThreadedFilter(const Config &config, util::FilePiece &in_lm, Filter &filter, Output &output) {
+template <class Format, class Filter, class OutputBuffer, class Output> void RunThreadedFilter(const Config &config, typename Format::Input &in_lm, Filter &filter, Output &output) {
 #ifndef NTHREAD
   if (config.threads == 1) {
 #endif
@@ -96,7 +98,7 @@ template <class Format, class Filter, class OutputBuffer, class Output> void Run
 #endif
 }
 
-template <class Format, class Filter, class OutputBuffer, class Output> void RunContextFilter(const Config &config, util::FilePiece &in_lm, Filter filter, Output &output) {
+template <class Format, class Filter, class OutputBuffer, class Output> void RunContextFilter(const Config &config, typename Format::Input &in_lm, Filter filter, Output &output) {
   if (config.context) {
     ContextFilter<Filter> context_filter(filter);
     RunThreadedFilter<Format, ContextFilter<Filter>, OutputBuffer, Output>(config, in_lm, context_filter, output);
@@ -105,12 +107,12 @@ template <class Format, class Filter, class OutputBuffer, class Output> void Run
   }
 }
 
-template <class Format, class Binary> void DispatchBinaryFilter(const Config &config, util::FilePiece &in_lm, const Binary &binary, typename Format::Output &out) {
+template <class Format, class Binary> void DispatchBinaryFilter(const Config &config, typename Format::Input &in_lm, const Binary &binary, typename Format::Output &out) {
   typedef BinaryFilter<Binary> Filter;
   RunContextFilter<Format, Filter, BinaryOutputBuffer, typename Format::Output>(config, in_lm, Filter(binary), out);
 }
 
-template <class Format> void DispatchFilterModes(const Config &config, std::istream &in_vocab, util::FilePiece &in_lm, const char *out_name) {
+template <class Format> void DispatchFilterModes(const Config &config, std::istream &in_vocab, typename Format::Input &in_lm, const char *out_name) {
   if (config.mode == MODE_MULTIPLE) {
     if (config.phrase) {
       typedef phrase::Multiple Filter;
@@ -238,6 +240,13 @@ int main(int argc, char *argv[]) {
       vocab = &cmd_file;
     }
 
+    lm::ngram::ModelType binary_type;
+    if (config.format == lm::FORMAT_ARPA && cmd_is_model && lm::ngram::RecognizeBinary(cmd_input, binary_type)) {
+      lm::BinaryInput model(cmd_input);
+      lm::DispatchFilterModes<lm::KenLMBinaryFormat>(config, *vocab, model, argv[argc - 1]);
+      return 0;
+    }
+
     util::FilePiece model(cmd_is_model ? util::OpenReadOrThrow(cmd_input) : 0, cmd_is_model ? cmd_input : NULL, &std::cerr);
 
     if (config.format == lm::FORMAT_ARPA) {
@@ -2,6 +2,7 @@
 #define LM_FILTER_FORMAT_H
 
 #include "lm/filter/arpa_io.hh"
+#include "lm/filter/binary_io.hh"
 #include "lm/filter/count_io.hh"
 
 #include <boost/lexical_cast.hpp>
@@ -109,6 +110,7 @@ template <class Filter, class Output> class DispatchARPAInput : public DispatchI
 };
 
 struct ARPAFormat {
+  typedef util::FilePiece Input;
   typedef ARPAOutput Output;
   typedef MultipleARPAOutput Multiple;
   static void Copy(util::FilePiece &in, Output &out) {
@@ -120,7 +122,22 @@ struct ARPAFormat {
   }
 };
 
+// Trie binaries read back as ARPA and written as ARPA.
+struct KenLMBinaryFormat {
+  typedef BinaryInput Input;
+  typedef ARPAOutput Output;
+  typedef MultipleARPAOutput Multiple;
+  static void Copy(Input &in, Output &out) {
+    ReadBinary(in.File(), out);
+  }
+  template <class Filter, class Out> static void RunFilter(Input &in, Filter &filter, Out &output) {
+    DispatchARPAInput<Filter, Out> dispatcher(filter, output);
+    ReadBinary(in.File(), dispatcher);
+  }
+};
+
 struct CountFormat {
+  typedef util::FilePiece Input;
   typedef CountOutput Output;
   typedef MultipleOutput<Output> Multiple;
   static void Copy(util::FilePiece &in, Output &out) {
@@ -0,0 +1,219 @@
+#include "lm/model.hh"
+#include "util/exception.hh"
+#include "util/getopt.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+#include "util/usage.hh"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Serves n-gram queries over TCP, for the RemoteLM feature in Moses.
+ *
+ * A request is a line "prob w h1 h2 ...", where h1 is the word right before
+ * w, h2 the one before that, and so on.  Each request is answered, in order,
+ * with a line "log10prob ngram_length oov", oov being 1 if w is not in the
+ * vocabulary.  Clients can send many requests before reading the replies.
+ * All connections are served by a single thread with poll(), so every client
+ * sees the same model without locking.
+ */
+
+void Usage(const char *name) {
+  std::cerr <<
+    "KenLM was compiled with maximum order " << KENLM_MAX_ORDER << ".\n"
+    "Usage: " << name << " [-p port] lm_file\n"
+    "Serves queries of lm_file on port (default 9090).\n";
+  exit(1);
+}
+
+namespace {
+
+// stop reading from a client that doesn't read its replies
+const std::size_t kMaxPendingOutput = 1 << 22;
+
+struct Connection {
+  explicit Connection(int f) : fd(f), written(0) {}
+  int fd;
+  std::string in, out;
+  std::size_t written;
+};
+
+class Server {
+  public:
+    explicit Server(const lm::base::Model &model)
+      : model_(model), vocab_(model.BaseVocabulary()), state_(model.StateSize()) {}
+
+    // Answers all complete lines in conn.in.
+    void Process(Connection &conn) {
+      std::size_t begin = 0, end;
+      while ((end = conn.in.find('\n', begin)) != std::string::npos) {
+        Answer(StringPiece(conn.in.data() + begin, end - begin), conn.out);
+        begin = end + 1;
+      }
+      conn.in.erase(0, begin);
+    }
+
+  private:
+    void Answer(StringPiece line, std::string &out) {
+      if (!line.empty() && line[line.size() - 1] == '\r') line = StringPiece(line.data(), line.size() - 1);
+      util::TokenIter<util::SingleCharacter, true> it(line, ' ');
+      if (!it || *it != "prob" || !++it) {
+        out += "0 0 1\n";
+        return;
+      }
+      lm::WordIndex word = vocab_.Index(*it);
+      context_.clear();
+      for (++it; it && context_.size() + 1 < model_.Order(); ++it) {
+        context_.push_back(vocab_.Index(*it));
+      }
+      lm::FullScoreReturn ret = model_.BaseFullScoreForgotState(
+          context_.empty() ? NULL : &context_[0],
+          context_.empty() ? NULL : &context_[0] + context_.size(),
+          word, &state_[0]);
+      char buf[64];
+      int len = snprintf(buf, sizeof(buf), "%.7g %u %d\n", ret.prob, static_cast<unsigned>(ret.ngram_length), word == vocab_.NotFound() ? 1 : 0);
+      out.append(buf, len);
+    }
+
+    const lm::base::Model &model_;
+    const lm::base::Vocabulary &vocab_;
+    std::vector<lm::WordIndex> context_;
+    std::vector<char> state_;
+};
+
+void SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  UTIL_THROW_IF(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1, util::ErrnoException, "fcntl failed");
+}
+
+int Listen(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  UTIL_THROW_IF(fd == -1, util::ErrnoException, "socket failed");
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  UTIL_THROW_IF(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1, util::ErrnoException, "bind to port " << port << " failed");
+  UTIL_THROW_IF(listen(fd, 64) == -1, util::ErrnoException, "listen failed");
+  SetNonBlocking(fd);
+  return fd;
+}
+
+// Returns false if the connection should be closed.
+bool Read(Connection &conn, Server &server) {
+  char buf[65536];
+  while (true) {
+    ssize_t got = read(conn.fd, buf, sizeof(buf));
+    if (got > 0) {
+      conn.in.append(buf, got);
+      server.Process(conn);
+      if (conn.out.size() > kMaxPendingOutput) return true;
+    } else if (got == 0) {
+      return false;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+  }
+}
+
+bool Write(Connection &conn) {
+  while (conn.written < conn.out.size()) {
+    ssize_t put = write(conn.fd, conn.out.data() + conn.written, conn.out.size() - conn.written);
+    if (put < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    conn.written += put;
+  }
+  conn.out.clear();
+  conn.written = 0;
+  return true;
+}
+
+void Serve(const lm::base::Model &model, int port) {
+  Server server(model);
+  int listener = Listen(port);
+  std::cerr << "Listening on port " << port << std::endl;
+  std::vector<Connection> conns;
+  std::vector<struct pollfd> fds;
+  while (true) {
+    fds.resize(conns.size() + 1);
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    for (std::size_t i = 0; i < conns.size(); ++i) {
+      fds[i + 1].fd = conns[i].fd;
+      fds[i + 1].events = (conns[i].out.size() > kMaxPendingOutput ? 0 : POLLIN) | (conns[i].out.empty() ? 0 : POLLOUT);
+    }
+    if (poll(&fds[0], fds.size(), -1) == -1) {
+      UTIL_THROW_IF(errno != EINTR, util::ErrnoException, "poll failed");
+      continue;
+    }
+    // go backwards so that closed connections can be swapped out
+    for (std::size_t i = conns.size(); i > 0; --i) {
+      short revents = fds[i].revents;
+      Connection &conn = conns[i - 1];
+      bool keep = true;
+      if (revents & POLLIN) keep = Read(conn, server);
+      // answer right away; most replies fit in the socket buffer
+      if (keep && !conn.out.empty()) keep = Write(conn);
+      if (revents & (POLLERR | POLLNVAL)) keep = false;
+      if (!keep || ((revents & POLLHUP) && !(revents & POLLIN))) {
+        close(conn.fd);
+        std::swap(conn, conns.back());
+        conns.pop_back();
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(listener, NULL, NULL)) != -1) {
+        SetNonBlocking(fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        conns.push_back(Connection(fd));
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int port = 9090;
+  int opt;
+  while ((opt = getopt(argc, argv, "hp:")) != -1) {
+    switch (opt) {
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'h':
+      default:
+        Usage(argv[0]);
+    }
+  }
+  if (optind + 1 != argc)
+    Usage(argv[0]);
+  signal(SIGPIPE, SIG_IGN);
+  try {
+    lm::ngram::Config config;
+    lm::base::Model *model = lm::ngram::LoadVirtual(argv[optind], config);
+    util::PrintUsage(std::cerr);
+    Serve(*model, port);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -65,6 +65,16 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     FullScoreReturn FullScoreForgotState(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word, State &out_state) const;
 
+    /* Start loading the entries that FullScoreForgotState (or FullScore with
+     * the matching state) would read for this query, without blocking.
+     * Issue it for several queries before scoring them so their memory
+     * latency overlaps.  The context is in reverse order as above.  Does
+     * nothing for the trie.
+     */
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word) const {
+      search_.Prefetch(context_rbegin, std::min(context_rend, context_rbegin + P::Order() - 1), new_word);
+    }
+
     /* Get the state for a context.  Don't use this if you can avoid it.  Use
      * BeginSentenceState or NullContextState and extend from those.  If
      * you're only going to use this state to call FullScore once, use
@@ -102,6 +112,12 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
       return Search::kDifferentRest ? InternalUnRest(pointers_begin, pointers_end, first_length) : 0.0;
     }
 
+    // Direct access to the underlying structure, e.g. to enumerate n-grams.
+    const Search &GetSearch() const { return search_; }
+
+    // Where the model lives in memory, e.g. to report its size.
+    const BinaryFormat &GetBacking() const { return backing_; }
+
   private:
     FullScoreReturn ScoreExceptBackoff(const WordIndex *const context_rbegin, const WordIndex *const context_rend, const WordIndex new_word, State &out_state) const;
 
@@ -13,7 +13,8 @@ void Usage(const char *name) {
     "Usage: " << name << " [-n] [-s] lm_file\n"
     "-n: Do not wrap the input in <s> and </s>.\n"
     "-s: Sentence totals only.\n"
-    "-l lazy|populate|read|parallel: Load lazily, with populate, or malloc+read\n"
+    "-l lazy|populate|read|parallel|parallel_populate: Load lazily, with populate,\n"
+    "   malloc+read, malloc+read in parallel or populate in parallel\n"
     "The default loading method is populate on Linux and read on others.\n";
   exit(1);
 }
@@ -44,6 +45,8 @@ int main(int argc, char *argv[]) {
           config.load_method = util::READ;
         } else if (!strcmp(optarg, "parallel")) {
           config.load_method = util::PARALLEL_READ;
+        } else if (!strcmp(optarg, "parallel_populate")) {
+          config.load_method = util::PARALLEL_POPULATE;
         } else {
           Usage(argv[0]);
         }
@@ -2,6 +2,7 @@
 #define LM_SEARCH_TRIE_H
 
 #include "lm/config.hh"
+#include "lm/max_order.hh"
 #include "lm/model_type.hh"
 #include "lm/return.hh"
 #include "lm/trie.hh"
@@ -88,6 +89,30 @@ template <class Quant, class Bhiksha> class TrieSearch {
       return LongestPointer(quant_, longest_.Find(word, node));
     }
 
+    // Trie lookups depend on the result of the previous order, so there is
+    // nothing to fetch ahead of time.
+    void Prefetch(const WordIndex *, const WordIndex *, WordIndex) const {}
+
+    /* Calls visitor(words, prob, backoff) for every n-gram of the given
+     * length, in trie order.  words holds the n-gram in reverse: words[0] is
+     * the last word.  The highest order passes a backoff of 0.  Blanks that
+     * were inserted for missing context appear as ordinary n-grams carrying
+     * the probability the model would back off to.
+     */
+    template <class Visitor> void VisitOrder(unsigned char length, WordIndex vocab_size, Visitor &visitor) const {
+      WordIndex words[KENLM_MAX_ORDER];
+      for (WordIndex w = 0; w < vocab_size; ++w) {
+        Node node;
+        UnigramPointer unigram(unigram_.Find(w, node));
+        words[0] = w;
+        if (length == 1) {
+          visitor(words, unigram.Prob(), unigram.Backoff());
+        } else {
+          VisitBelow(2, length, node, words, visitor);
+        }
+      }
+    }
+
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
       assert(begin != end);
       bool independent_left;
@@ -100,6 +125,26 @@ template <class Quant, class Bhiksha> class TrieSearch {
     }
 
   private:
+    template <class Visitor> void VisitBelow(unsigned char at, unsigned char length, const Node &node, WordIndex *words, Visitor &visitor) const {
+      for (uint64_t pointer = node.begin; pointer < node.end; ++pointer) {
+        if (at == Order()) {
+          words[at - 1] = longest_.ReadWord(pointer);
+          LongestPointer longest(quant_, longest_.ReadEntry(pointer));
+          visitor(words, longest.Prob(), 0.0f);
+          continue;
+        }
+        const Middle &middle = middle_begin_[at - 2];
+        words[at - 1] = middle.ReadWord(pointer);
+        Node next;
+        MiddlePointer value(quant_, at - 2, middle.ReadEntry(pointer, next));
+        if (at == length) {
+          visitor(words, value.Prob(), value.Backoff());
+        } else {
+          VisitBelow(at + 1, length, next, words, visitor);
+        }
+      }
+    }
+
     friend void BuildTrie<Quant, Bhiksha>(SortedFiles &files, std::vector<uint64_t> &counts, const Config &config, TrieSearch<Quant, Bhiksha> &out, Quant &quant, SortedVocabulary &vocab, BinaryFormat &backing);
 
     // Middles are managed manually so we can delay construction and they don't have to be copyable.
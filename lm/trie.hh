@@ -81,6 +81,11 @@ class BitPacked {
       return insert_index_;
     }
 
+    // The word stored in an entry.
+    WordIndex ReadWord(uint64_t pointer) const {
+      return static_cast<WordIndex>(util::ReadInt57(base_, pointer * total_bits_, word_bits_, word_mask_));
+    }
+
   protected:
     static uint64_t BaseSize(uint64_t entries, uint64_t max_vocab, uint8_t remaining_bits);
 
@@ -108,7 +113,7 @@ template <class Bhiksha> class BitPackedMiddle : public BitPacked {
 
     util::BitAddress Find(WordIndex word, NodeRange &range, uint64_t &pointer) const;
 
-    util::BitAddress ReadEntry(uint64_t pointer, NodeRange &range) {
+    util::BitAddress ReadEntry(uint64_t pointer, NodeRange &range) const {
       uint64_t addr = pointer * total_bits_;
       addr += word_bits_;
       bhiksha_.ReadNext(base_, addr + quant_bits_, pointer, total_bits_, range);
@@ -137,6 +142,10 @@ class BitPackedLongest : public BitPacked {
     util::BitAddress Insert(WordIndex word);
 
     util::BitAddress Find(WordIndex word, const NodeRange &node) const;
+
+    util::BitAddress ReadEntry(uint64_t pointer) const {
+      return util::BitAddress(base_, pointer * total_bits_ + word_bits_);
+    }
 };
 
 } // namespace trie
@@ -42,6 +42,11 @@ public:
     return 2 * kBleuNgramOrder + 1;
   }
 
+  // candidates are only looked up in the vocabulary, never added to it
+  virtual bool isThreadSafe() const {
+    return !hasFilter();
+  }
+
   int CalcReferenceLength(std::size_t sentence_id, std::size_t length);
 
   ReferenceLengthType GetReferenceLengthType() const {
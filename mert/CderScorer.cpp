@@ -60,7 +60,7 @@ void CderScorer::prepareStats(size_t sid, const string& text, ScoreStats& entry)
 void CderScorer::prepareStatsVector(size_t sid, const string& text, vector<ScoreStatsType>& stats)
 {
   sent_t cand;
-  TokenizeAndEncode(text, cand);
+  TokenizeAndEncodeTesting(text, cand);
 
   float max = -2;
   vector<ScoreStatsType> tmp;
@@ -96,47 +96,46 @@ void CderScorer::computeCD(const sent_t& cand, const sent_t& ref,
 
   int l = 0;
   // row[i] stores cost of cheapest path from (0,0) to (i,l) in CDER aligment grid.
-  vector<int>* row = new vector<int>(I);
+  // The two rows are reused for every l.
+  vector<int> row(I);
+  vector<int> nextRow(I);
 
   // Initialization of first row
-  for (int i = 0; i < I; ++i) (*row)[i] = i;
+  for (int i = 0; i < I; ++i) row[i] = i;
 
   // For CDER metric, the initialization is different
   if (m_allowed_long_jumps) {
-    for (int i = 1; i < I; ++i) (*row)[i] = 1;
+    for (int i = 1; i < I; ++i) row[i] = 1;
   }
 
   // Calculating costs for next row using costs from the previous row.
   while (++l < L) {
-    vector<int>* nextRow = new vector<int>(I);
-    for (int i = 0; i < I; ++i) {
-      vector<int> possibleCosts;
-      if (i > 0) {
-        possibleCosts.push_back((*nextRow)[i-1] + 1); // Deletion
-        possibleCosts.push_back((*row)[i-1] + CalcDistance(ref[l-1], cand[i-1])); // Substitution/Identity
-      }
-      possibleCosts.push_back((*row)[i] + 1); // Insertion
-      (*nextRow)[i] = *min_element(possibleCosts.begin(), possibleCosts.end());
+    const int refWord = ref[l-1];
+    nextRow[0] = row[0] + 1; // Insertion
+    int rowMin = nextRow[0];
+    for (int i = 1; i < I; ++i) {
+      const int deletion = nextRow[i-1] + 1;
+      const int substitution = row[i-1] + CalcDistance(refWord, cand[i-1]); // Substitution/Identity
+      const int insertion = row[i] + 1;
+      nextRow[i] = min(min(deletion, substitution), insertion);
+      rowMin = min(rowMin, nextRow[i]);
     }
 
     if (m_allowed_long_jumps) {
       // Cost of LongJumps is the same for all in the row
-      int LJ = 1 + *min_element(nextRow->begin(), nextRow->end());
+      int LJ = 1 + rowMin;
 
       for (int i = 0; i < I; ++i) {
-        (*nextRow)[i] = min((*nextRow)[i], LJ); // LongJumps
+        nextRow[i] = min(nextRow[i], LJ); // LongJumps
       }
     }
 
-    delete row;
-    row = nextRow;
+    row.swap(nextRow);
   }
 
   stats.resize(2);
-  stats[0] = *(row->rbegin());  // CD distance is the cost of path from (0,0) to (I,L)
+  stats[0] = row.back();  // CD distance is the cost of path from (0,0) to (I,L)
   stats[1] = ref.size();
-
-  delete row;
 }
 
 }
@@ -21,17 +21,51 @@
 #include "util/string_piece.hh"
 #include "FeatureDataIterator.h"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
 namespace MosesTuning
 {
 
+namespace
+{
+
+// One n-best entry waiting for its score statistics.
+struct Candidate {
+  int sentence_index;
+  string sentence;
+  string feature_str;
+  ScoreStats stats;
+};
+
+#ifdef WITH_THREADS
+void PrepareStats(Scorer* scorer, vector<Candidate>& candidates,
+                  size_t begin, size_t end, string* error)
+{
+  try {
+    for (size_t i = begin; i < end; ++i) {
+      Candidate& c = candidates[i];
+      scorer->prepareStats(c.sentence_index, c.sentence, c.stats);
+    }
+  } catch (const exception& e) {
+    *error = e.what();
+  }
+}
+#endif
+
+} // namespace
+
 Data::Data(Scorer* scorer, const string& sparse_weights_file)
   : m_scorer(scorer),
     m_score_type(m_scorer->getName()),
     m_num_scores(0),
     m_score_data(new ScoreData(m_scorer)),
-    m_feature_data(new FeatureData)
+    m_feature_data(new FeatureData),
+    m_num_threads(1)
 {
   TRACE_ERR("Data::m_score_type " << m_score_type << endl);
   TRACE_ERR("Data::Scorer type from Scorer: " << m_scorer->getName() << endl);
@@ -140,58 +174,94 @@ void Data::loadNBest(const string &file, bool oneBest)
   TRACE_ERR("loading nbest from " << file << endl);
   util::FilePiece in(file.c_str());
 
-  ScoreStats scoreentry;
-  string sentence, feature_str, alignment;
-  int sentence_index;
-
-  while (true) {
-    try {
-      StringPiece line = in.ReadLine();
-      if (line.empty()) continue;
-      // adding statistics for error measures
-      scoreentry.clear();
-
-      util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
-
-      sentence_index = ParseInt(*it);
-      if (oneBest && m_score_data->exists(sentence_index)) continue;
-      ++it;
-      sentence = it->as_string();
-      ++it;
-      feature_str = it->as_string();
-      ++it;
-
-      if (it) {
-        ++it;                             // skip model score.
+  // Candidates are scored in batches, the blocks of a batch in parallel if
+  // the scorer allows it, and then added in file order.  In oneBest mode
+  // each entry has to see the previous ones in m_score_data.
+  size_t num_threads = m_scorer->isThreadSafe() ? m_num_threads : 1;
+  if (oneBest) num_threads = 1;
+  const size_t batch_size = num_threads > 1 ? 1000 * num_threads : 1;
+  vector<Candidate> batch;
+  batch.reserve(batch_size);
+
+  string alignment;
+  bool eof = false;
+  while (!eof) {
+    batch.clear();
+    while (batch.size() < batch_size) {
+      try {
+        StringPiece line = in.ReadLine();
+        if (line.empty()) continue;
+
+        util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
+
+        const int sentence_index = ParseInt(*it);
+        if (oneBest && m_score_data->exists(sentence_index)) continue;
+        batch.push_back(Candidate());
+        Candidate& c = batch.back();
+        c.sentence_index = sentence_index;
+        ++it;
+        c.sentence = it->as_string();
+        ++it;
+        c.feature_str = it->as_string();
+        ++it;
 
         if (it) {
-          alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
-          ++it;
+          ++it;                             // skip model score.
+
           if (it) {
-            alignment = it->as_string(); //sixth field (if present) is word alignment
+            alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
+            ++it;
+            if (it) {
+              alignment = it->as_string(); //sixth field (if present) is word alignment
+            }
           }
         }
+        //TODO check alignment exists if scorers need it
+
+        if (m_scorer->useAlignment()) {
+          c.sentence += "|||";
+          c.sentence += alignment;
+        }
+      } catch (util::EndOfFileException &e) {
+        eof = true;
+        break;
       }
-      //TODO check alignment exists if scorers need it
+    }
 
-      if (m_scorer->useAlignment()) {
-        sentence += "|||";
-        sentence += alignment;
+    // adding statistics for error measures
+    const size_t num_blocks = min(num_threads, batch.size());
+#ifdef WITH_THREADS
+    if (num_blocks > 1) {
+      vector<string> errors(num_blocks);
+      boost::thread_group threads;
+      for (size_t i = 1; i < num_blocks; ++i) {
+        threads.create_thread(boost::bind(&PrepareStats, m_scorer, boost::ref(batch),
+                                          batch.size() * i / num_blocks,
+                                          batch.size() * (i + 1) / num_blocks, &errors[i]));
+      }
+      PrepareStats(m_scorer, batch, 0, batch.size() / num_blocks, &errors[0]);
+      threads.join_all();
+      for (size_t i = 0; i < num_blocks; ++i) {
+        if (!errors[i].empty()) throw runtime_error(errors[i]);
+      }
+    } else
+#endif
+      for (size_t i = 0; i < batch.size(); ++i) {
+        m_scorer->prepareStats(batch[i].sentence_index, batch[i].sentence, batch[i].stats);
       }
-      m_scorer->prepareStats(sentence_index, sentence, scoreentry);
 
-      m_score_data->add(scoreentry, sentence_index);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      const Candidate& c = batch[i];
+      m_score_data->add(c.stats, c.sentence_index);
 
       // examine first line for name of features
       if (!existsFeatureNames()) {
-        InitFeatureMap(feature_str);
+        InitFeatureMap(c.feature_str);
       }
-      AddFeatures(feature_str, sentence_index);
-    } catch (util::EndOfFileException &e) {
-      PrintUserTime("Loaded N-best lists");
-      break;
+      AddFeatures(c.feature_str, c.sentence_index);
     }
   }
+  PrintUserTime("Loaded N-best lists");
 }
 
 void Data::save(const std::string &featfile, const std::string &scorefile, bool bin)
@@ -35,6 +35,7 @@ private:
   ScoreDataHandle m_score_data;
   FeatureDataHandle m_feature_data;
   SparseVector m_sparse_weights;
+  std::size_t m_num_threads;
 
 public:
   explicit Data(Scorer* scorer, const std::string& sparseweightsfile="");
@@ -67,6 +68,14 @@ public:
     m_feature_data->Features(f);
   }
 
+  /**
+   * Number of threads loadNBest() may use to score the candidates, if the
+   * scorer is thread-safe.
+   */
+  void setThreadCount(std::size_t num_threads) {
+    m_num_threads = num_threads;
+  }
+
   void loadNBest(const std::string &file, bool oneBest=false);
 
   void load(const std::string &featfile, const std::string &scorefile);
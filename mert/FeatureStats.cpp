@@ -8,6 +8,7 @@
 
 #include "FeatureStats.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cmath>
 #include <stdexcept>
@@ -249,22 +250,32 @@ void FeatureStats::addSparse(const string& name, FeatureStatsType v)
   m_map.set(name,v);
 }
 
-void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
+void FeatureStats::set(const string &theString, const SparseVector& sparseWeights )
 {
-  string substring, stringBuf;
   reset();
 
-  while (!theString.empty()) {
-    getNextPound(theString, substring);
+  // walk the line once; atof stops at the space after each value
+  const char *current = theString.c_str();
+  const char *end = current + theString.size();
+  while (current != end) {
+    if (*current == ' ') {
+      ++current;
+      continue;
+    }
+    const char *tokenEnd = std::find(current, end, ' ');
+    const char *separator = tokenEnd;
+    for (const char *i = current; i != tokenEnd; ++i) {
+      if (*i == '=') separator = i;
+    }
     // regular feature
-    if (substring.find("=") == string::npos) {
-      add(ConvertStringToFeatureStatsType(substring));
+    if (separator == tokenEnd) {
+      add(ConvertCharToFeatureStatsType(current));
     }
     // sparse feature
     else {
-      size_t separator = substring.find_last_of("=");
-      addSparse(substring.substr(0,separator), atof(substring.substr(separator+1).c_str()) );
+      addSparse(string(current, separator), atof(separator + 1));
     }
+    current = tokenEnd;
   }
 
   if (sparseWeights.size()) {
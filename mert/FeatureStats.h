@@ -117,7 +117,7 @@ public:
     return m_map;
   }
 
-  void set(std::string &theString, const SparseVector& sparseWeights);
+  void set(const std::string &theString, const SparseVector& sparseWeights);
 
   inline std::size_t bytes() const {
     return GetArraySizeWithBytes();
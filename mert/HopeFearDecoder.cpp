@@ -194,10 +194,7 @@ HypergraphHopeFearDecoder::HypergraphHopeFearDecoder
     //  cerr << "Reading " << hgpath.filename() << endl;
     Graph graph(vocab_);
     size_t id = boost::lexical_cast<size_t>(hgpath.stem().string());
-    util::scoped_fd fd(util::OpenReadOrThrow(hgpath.string().c_str()));
-    //util::FilePiece file(di->path().string().c_str());
-    util::FilePiece file(fd.release());
-    ReadGraph(file,graph);
+    ReadGraphFile(hgpath.string(), graph);
 
     //cerr << "ref length " << references_.Length(id) << endl;
     size_t edgeCount = hg_pruning * references_.Length(id);
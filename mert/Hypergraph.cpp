@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/lexical_cast.hpp>
 
 #include "util/double-conversion/double-conversion.h"
+#include "util/file.hh"
+#include "util/mmap.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
 
@@ -30,6 +32,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 using namespace std;
 static const string kBOS = "<s>";
 static const string kEOS = "</s>";
+static const char kBinaryMagic[] = "MosesHG1";
+static const size_t kBinaryMagicSize = 8;
 
 namespace MosesTuning
 {
@@ -320,4 +324,111 @@ void ReadGraph(util::FilePiece &from, Graph &graph)
   }
 }
 
+namespace
+{
+class BinaryReader
+{
+public:
+  BinaryReader(const char *begin, const char *end) : current_(begin), end_(end) {}
+
+  size_t Varint() {
+    size_t value = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+      UTIL_THROW_IF(current_ == end_, HypergraphException, "Truncated binary hypergraph");
+      const unsigned char byte = static_cast<unsigned char>(*current_++);
+      value |= static_cast<size_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) return value;
+    }
+  }
+
+  float Float() {
+    UTIL_THROW_IF(end_ - current_ < static_cast<ptrdiff_t>(sizeof(float)), HypergraphException, "Truncated binary hypergraph");
+    float value;
+    memcpy(&value, current_, sizeof(float));
+    current_ += sizeof(float);
+    return value;
+  }
+
+  // Look up a symbol id, reading the string if it is the next new one.
+  StringPiece Symbol(size_t id, vector<StringPiece> &symbols) {
+    if (id == symbols.size()) {
+      size_t length = Varint();
+      UTIL_THROW_IF(static_cast<size_t>(end_ - current_) < length, HypergraphException, "Truncated binary hypergraph");
+      symbols.push_back(StringPiece(current_, length));
+      current_ += length;
+    }
+    UTIL_THROW_IF(id >= symbols.size(), HypergraphException, "Bad symbol id " << id << " in binary hypergraph");
+    return symbols[id];
+  }
+
+private:
+  const char *current_, *end_;
+};
+}
+
+void ReadBinaryGraph(const char *data, std::size_t size, Graph &graph)
+{
+  UTIL_THROW_IF(size < kBinaryMagicSize || memcmp(data, kBinaryMagic, kBinaryMagicSize), HypergraphException, "Not a binary hypergraph");
+  BinaryReader from(data + kBinaryMagicSize, data + size);
+  size_t vertices = from.Varint();
+  size_t edges = from.Varint();
+  graph.SetCounts(vertices, edges);
+
+  // Words are mapped to vocab entries once per file; feature names point into the data.
+  vector<StringPiece> wordStrings, featureNames;
+  vector<const Vocab::Entry*> words;
+  for (size_t v = 0; v < vertices; ++v) {
+    size_t edgeCount = from.Varint();
+    Vertex* vertex = graph.NewVertex();
+    for (size_t e = 0; e < edgeCount; ++e) {
+      Edge* edge = graph.NewEdge();
+      size_t tokens = from.Varint();
+      for (size_t t = 0; t < tokens; ++t) {
+        size_t token = from.Varint();
+        if (token & 1) {
+          size_t child = token >> 1;
+          UTIL_THROW_IF(child >= graph.VertexSize(), HypergraphException, "Reference to vertex " << child << " but we only have " << graph.VertexSize() << " vertices.  Is the file in bottom-up format?");
+          edge->AddWord(NULL);
+          edge->AddChild(child);
+        } else {
+          size_t id = token >> 1;
+          if (id == words.size()) {
+            words.push_back(&graph.MutableVocab().FindOrAdd(from.Symbol(id, wordStrings)));
+          }
+          UTIL_THROW_IF(id >= words.size(), HypergraphException, "Bad word id " << id << " in binary hypergraph");
+          edge->AddWord(words[id]);
+        }
+      }
+      size_t features = from.Varint();
+      for (size_t f = 0; f < features; ++f) {
+        StringPiece name = from.Symbol(from.Varint(), featureNames);
+        edge->AddFeature(name, from.Float());
+      }
+      size_t sourceCovered = from.Varint();
+      vertex->AddEdge(edge);
+      if (!e) {
+        vertex->SetSourceCovered(sourceCovered);
+      }
+    }
+  }
+}
+
+void ReadGraphFile(const string &path, Graph &graph)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeFile(fd.get());
+  char magic[kBinaryMagicSize];
+  if (size != util::kBadSize && size >= kBinaryMagicSize) {
+    util::ErsatzPRead(fd.get(), magic, kBinaryMagicSize, 0);
+    if (!memcmp(magic, kBinaryMagic, kBinaryMagicSize)) {
+      util::scoped_memory mem;
+      util::MapRead(util::POPULATE_OR_READ, fd.get(), 0, size, mem);
+      ReadBinaryGraph(static_cast<const char*>(mem.get()), size, graph);
+      return;
+    }
+  }
+  util::FilePiece file(fd.release());
+  ReadGraph(file, graph);
+}
+
 };
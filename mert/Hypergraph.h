@@ -272,6 +272,15 @@ public:
 
 void ReadGraph(util::FilePiece &from, Graph &graph);
 
+/**
+ * Read a graph in the binary hypergraph format written by the chart decoder
+ * (see ChartSearchGraphWriterBinaryHypergraph in moses/HypergraphOutput.h).
+**/
+void ReadBinaryGraph(const char *data, std::size_t size, Graph &graph);
+
+/** Read a graph from a file in either the text or the binary format. */
+void ReadGraphFile(const std::string &path, Graph &graph);
+
 
 };
 
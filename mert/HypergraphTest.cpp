@@ -149,3 +149,37 @@ BOOST_AUTO_TEST_CASE(prune)
 
 
 }
+
+BOOST_AUTO_TEST_CASE(read_binary)
+{
+  // two vertices: "<s>" and "[0] a b" with features foo=0.5 bar=-1
+  const char data[] = "MosesHG1"
+                      "\x02\x02"
+                      "\x01" "\x01\x00\x03<s>" "\x00" "\x00"
+                      "\x01" "\x03\x01\x02\x01" "a" "\x04\x01" "b"
+                      "\x02" "\x00\x03" "foo" "\x00\x00\x00\x3f"
+                      "\x01\x03" "bar" "\x00\x00\x80\xbf" "\x02";
+  Vocab vocab;
+  Graph graph(vocab);
+  ReadBinaryGraph(data, sizeof(data) - 1, graph);
+
+  BOOST_CHECK_EQUAL(2, graph.VertexSize());
+  BOOST_CHECK_EQUAL(2, graph.EdgeSize());
+  BOOST_CHECK_EQUAL(2, graph.GetVertex(1).SourceCovered());
+
+  const Edge* edge = graph.GetVertex(0).GetIncoming()[0];
+  BOOST_CHECK_EQUAL(1, edge->Words().size());
+  BOOST_CHECK_EQUAL(vocab.Bos().second, edge->Words()[0]->second);
+
+  edge = graph.GetVertex(1).GetIncoming()[0];
+  BOOST_CHECK_EQUAL(3, edge->Words().size());
+  BOOST_CHECK_EQUAL((Vocab::Entry*)NULL, edge->Words()[0]);
+  BOOST_CHECK_EQUAL(0, edge->Children()[0]);
+  BOOST_CHECK_EQUAL(string("a"), edge->Words()[1]->first);
+  BOOST_CHECK_EQUAL(string("b"), edge->Words()[2]->first);
+  BOOST_CHECK_EQUAL(0.5, edge->Features()->get("foo"));
+  BOOST_CHECK_EQUAL(-1, edge->Features()->get("bar"));
+
+  Graph truncated(vocab);
+  BOOST_CHECK_THROW(ReadBinaryGraph(data, sizeof(data) - 3, truncated), HypergraphException);
+}
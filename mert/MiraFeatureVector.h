@@ -47,6 +47,10 @@ public:
 
   friend bool operator==(const MiraFeatureVector& a,const MiraFeatureVector& b);
 
+  // dot products walk the dense and sparse arrays directly
+  friend class MiraWeightVector;
+  friend class AvgWeightVector;
+
 private:
   //Ignore any sparse features with id < ignoreLimit
   void InitSparse(const SparseVector& sparse, size_t ignoreLimit = 0);
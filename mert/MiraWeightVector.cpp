@@ -1,5 +1,6 @@
 #include "MiraWeightVector.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -58,9 +59,15 @@ void MiraWeightVector::tick()
  */
 ValType MiraWeightVector::score(const MiraFeatureVector& fv) const
 {
+  // Same order of summation as iterating fv.feat(i)/fv.val(i), without the
+  // dense/sparse test on every element (dense weights past the end are 0)
   ValType toRet = 0.0;
-  for(size_t i=0; i<fv.size(); i++) {
-    toRet += weight(fv.feat(i)) * fv.val(i);
+  const size_t numDense = min(fv.m_dense.size(), m_weights.size());
+  for(size_t i=0; i<numDense; i++) {
+    toRet += m_weights[i] * fv.m_dense[i];
+  }
+  for(size_t i=0; i<fv.m_sparseFeats.size(); i++) {
+    toRet += weight(fv.m_sparseFeats[i]) * fv.m_sparseVals[i];
   }
   return toRet;
 }
@@ -161,8 +168,11 @@ ValType AvgWeightVector::weight(size_t index) const
 ValType AvgWeightVector::score(const MiraFeatureVector& fv) const
 {
   ValType toRet = 0.0;
-  for(size_t i=0; i<fv.size(); i++) {
-    toRet += weight(fv.feat(i)) * fv.val(i);
+  for(size_t i=0; i<fv.m_dense.size(); i++) {
+    toRet += weight(i) * fv.m_dense[i];
+  }
+  for(size_t i=0; i<fv.m_sparseFeats.size(); i++) {
+    toRet += weight(fv.m_sparseFeats[i]) * fv.m_sparseVals[i];
   }
   return toRet;
 }
@@ -8,6 +8,12 @@
 #include <cfloat>
 #include <iostream>
 #include <stdint.h>
+#include <algorithm>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include "Point.h"
 #include "Util.h"
@@ -32,6 +38,134 @@ inline float intersect(float m1, float b1, float m2, float b2)
   return isect;
 }
 
+/**
+ * A point on the line where the 1best of one sentence changes.
+ */
+struct Crossing {
+  float x;
+  unsigned sentence;
+  unsigned best;
+};
+
+inline bool CrossingBefore(const Crossing& a, const Crossing& b)
+{
+  return a.x < b.x;
+}
+
+/**
+ * Sweep the upper envelope of the candidates of sentence S along the line
+ * origin+x*direction, storing the 1best at x=-inf in first1best and
+ * appending the points where the 1best changes to crossings.
+ */
+void SentenceEnvelope(const MosesTuning::FeatureArray& candidates, unsigned S,
+                      const MosesTuning::Point& origin, const MosesTuning::Point& direction,
+                      unsigned& first1best, std::vector<Crossing>& crossings)
+{
+  const float min_int = 0.0001;
+  const std::size_t first = crossings.size();
+
+  // First, we determine the translation with the best feature score
+  // for each sentence and each value of x.
+  std::multimap<float, unsigned> gradient;
+  std::vector<float> f0(candidates.size());
+  for (unsigned j = 0; j < candidates.size(); j++) {
+    // gradient of the feature function for this particular target sentence
+    gradient.insert(std::pair<float, unsigned>(direction * candidates.get(j), j));
+    // compute the feature function at the origin point
+    f0[j] = origin * candidates.get(j);
+  }
+
+  std::multimap<float,unsigned>::iterator gradientit = gradient.begin();
+  std::multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
+
+  float smallest = gradientit->first;//smallest gradient
+  // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
+
+  gradientit++;
+  while (gradientit != gradient.end() && gradientit->first == smallest) {
+    if (f0[gradientit->second] > f0[highest_f0->second])
+      highest_f0 = gradientit;//the highest line is the one with he highest f0
+    gradientit++;
+  }
+
+  gradientit = highest_f0;
+  first1best = highest_f0->second;
+
+  // Now we look for the intersections points indicating a change of 1 best.
+  // We use the fact that the function is convex, which means that the gradient can only go up.
+  while (gradientit != gradient.end()) {
+    std::multimap<float,unsigned>::iterator leftmost = gradientit;
+    float m = gradientit->first;
+    float b = f0[gradientit->second];
+    std::multimap<float,unsigned>::iterator gradientit2 = gradientit;
+    gradientit2++;
+    float leftmostx = MAX_FLOAT;
+    for (; gradientit2 != gradient.end(); gradientit2++) {
+      // Look for all candidate with a gradient bigger than the current one, and
+      // find the one with the leftmost intersection.
+      if (m != gradientit2->first) {
+        float curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
+        if (curintersect<=leftmostx) {
+          // We have found an intersection to the left of the leftmost we had so far.
+          // We might have curintersect==leftmostx for example is 2 candidates are the same
+          // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
+          leftmostx = curintersect;
+          leftmost = gradientit2; // this is the new reference
+        }
+      }
+    }
+    if (leftmost == gradientit) {
+      // We didn't find any more intersections.
+      // The rightmost bestindex is the one with the highest slope.
+
+      // They should be equal but there might be.
+      UTIL_THROW_IF(std::abs(leftmost->first-gradient.rbegin()->first) >= 0.0001,
+                    util::Exception, "Error");
+      // A small difference due to rounding error
+      break;
+    }
+    // We have found the next intersection!
+    Crossing crossing = { leftmostx, S, leftmost->second };
+
+    if (crossings.size() > first && leftmostx - crossings.back().x < min_int) {
+      // Require that the intersection Point be at least min_int to the right of the previous
+      // one (for this sentence). If not, we replace the previous intersection Point with
+      // this one.
+      // Yes, it can even happen that the new intersection Point is slightly to the left of
+      // the old one, because of numerical imprecision. We do not check that we are to the
+      // right of the penultimate point also. It this happen the 1best the interval will
+      // be wrong we are going to replace the previous one by the new one because we do not want to keep
+      // 2 very close threshold: if the minima is there it could be an artifact.
+      crossings.back() = crossing;
+    } else {
+      crossings.push_back(crossing);
+    }
+    gradientit = leftmost;
+  }
+}
+
+/**
+ * Compute the envelopes of sentences [begin,end) and sort their crossings
+ * along the line. Crossings at the same x stay in sentence order.
+ */
+void CollectCrossings(const MosesTuning::FeatureData& data, unsigned begin, unsigned end,
+                      const MosesTuning::Point& origin, const MosesTuning::Point& direction,
+                      std::vector<unsigned>& first1best, std::vector<Crossing>& crossings)
+{
+  for (unsigned S = begin; S < end; S++) {
+    SentenceEnvelope(data.get(S), S, origin, direction, first1best[S], crossings);
+  }
+  std::stable_sort(crossings.begin(), crossings.end(), CrossingBefore);
+}
+
+void MergeCrossings(const std::vector<Crossing>& left, const std::vector<Crossing>& right,
+                    std::vector<Crossing>& merged)
+{
+  merged.resize(left.size() + right.size());
+  std::merge(left.begin(), left.end(), right.begin(), right.end(),
+             merged.begin(), CrossingBefore);
+}
+
 } // namespace
 
 namespace MosesTuning
@@ -39,7 +173,7 @@ namespace MosesTuning
 
 
 Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool>& pos, const vector<parameter_t>& start, unsigned int nrandom)
-  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_positive(pos)
+  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_num_threads(1), m_positive(pos)
 {
   // Warning: the init vector is a full set of parameters, of dimension m_pdim!
   Point::m_pdim = Pd;
@@ -71,196 +205,84 @@ statscore_t Optimizer::GetStatScore(const Point& param) const
   return score;
 }
 
-map<float,diff_t >::iterator AddThreshold(map<float,diff_t >& thresholdmap, float newt, const pair<unsigned,unsigned>& newdiff)
-{
-  map<float,diff_t>::iterator it = thresholdmap.find(newt);
-  if (it != thresholdmap.end()) {
-    // the threshold already exists!! this is very unlikely
-    if (it->second.back().first == newdiff.first)
-      // there was already a diff for this sentence, we change the 1 best;
-      it->second.back().second = newdiff.second;
-    else
-      it->second.push_back(newdiff);
-  } else {
-    // normal case
-    pair<map<float,diff_t>::iterator, bool> ins = thresholdmap.insert(threshold(newt, diff_t(1, newdiff)));
-    UTIL_THROW_IF(!ins.second, util::Exception, "Error");                // we really inserted something
-    it = ins.first;
-  }
-  return it;
-}
-
 statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
 {
   // We are looking for the best Point on the line y=Origin+x*direction
-  float min_int = 0.0001;
-  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
-  //list<threshold> thresholdlist;
-
-  map<float,diff_t> thresholdmap;
-  thresholdmap[MIN_FLOAT] = diff_t();
-  vector<unsigned> first1best;       // the vector of nbests for x=-inf
-  for (unsigned int S = 0; S < size(); S++) {
-    map<float,diff_t >::iterator previnserted = thresholdmap.begin();
-    // First, we determine the translation with the best feature score
-    // for each sentence and each value of x.
-    //cerr << "Sentence " << S << endl;
-    multimap<float, unsigned> gradient;
-    vector<float> f0;
-    f0.resize(m_feature_data->get(S).size());
-    for (unsigned j = 0; j < m_feature_data->get(S).size(); j++) {
-      // gradient of the feature function for this particular target sentence
-      gradient.insert(pair<float, unsigned>(direction * (m_feature_data->get(S,j)), j));
-      // compute the feature function at the origin point
-      f0[j] = origin * m_feature_data->get(S, j);
-    }
-    // Now let's compute the 1best for each value of x.
-
-    //    vector<pair<float,unsigned> > onebest;
-
-
-    multimap<float,unsigned>::iterator gradientit = gradient.begin();
-    multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
-
-    float smallest = gradientit->first;//smallest gradient
-    // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
-
-    gradientit++;
-    while (gradientit != gradient.end() && gradientit->first == smallest) {
-      //   cerr<<"ni"<<gradientit->second<<endl;;
-      //cerr<<"fos"<<f0[gradientit->second]<<" "<<f0[index]<<" "<<index<<endl;
-      if (f0[gradientit->second] > f0[highest_f0->second])
-        highest_f0 = gradientit;//the highest line is the one with he highest f0
-      gradientit++;
+  vector<unsigned> first1best(size());       // the vector of nbests for x=-inf
+
+  // Each sentence's envelope is independent of the others, so the sentences
+  // are split into contiguous blocks, one per thread, and the sorted
+  // crossings of the blocks are then merged pairwise.
+  const unsigned num_blocks = max(1u, min<unsigned>(m_num_threads, size()));
+  vector<vector<Crossing> > blocks(num_blocks);
+  const FeatureData& data = *m_feature_data;
+#ifdef WITH_THREADS
+  if (num_blocks > 1) {
+    boost::thread_group threads;
+    for (unsigned i = 1; i < num_blocks; ++i) {
+      threads.create_thread(boost::bind(&CollectCrossings, boost::cref(data),
+                                        size() * i / num_blocks, size() * (i + 1) / num_blocks,
+                                        boost::cref(origin), boost::cref(direction),
+                                        boost::ref(first1best), boost::ref(blocks[i])));
     }
-
-    gradientit = highest_f0;
-    first1best.push_back(highest_f0->second);
-
-    // Now we look for the intersections points indicating a change of 1 best.
-    // We use the fact that the function is convex, which means that the gradient can only go up.
-    while (gradientit != gradient.end()) {
-      map<float,unsigned>::iterator leftmost = gradientit;
-      float m = gradientit->first;
-      float b = f0[gradientit->second];
-      multimap<float,unsigned>::iterator gradientit2 = gradientit;
-      gradientit2++;
-      float leftmostx = MAX_FLOAT;
-      for (; gradientit2 != gradient.end(); gradientit2++) {
-        //cerr<<"--"<<d++<<' '<<gradientit2->first<<' '<<gradientit2->second<<endl;
-        // Look for all candidate with a gradient bigger than the current one, and
-        // find the one with the leftmost intersection.
-        float curintersect;
-        if (m != gradientit2->first) {
-          curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
-          //cerr << "curintersect: " << curintersect << " leftmostx: " << leftmostx << endl;
-          if (curintersect<=leftmostx) {
-            // We have found an intersection to the left of the leftmost we had so far.
-            // We might have curintersect==leftmostx for example is 2 candidates are the same
-            // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
-            leftmostx = curintersect;
-            leftmost = gradientit2; // this is the new reference
-          }
-        }
+    CollectCrossings(data, 0, size() / num_blocks, origin, direction, first1best, blocks[0]);
+    threads.join_all();
+
+    while (blocks.size() > 1) {
+      vector<vector<Crossing> > merged((blocks.size() + 1) / 2);
+      for (size_t i = 0; i + 1 < blocks.size(); i += 2) {
+        threads.create_thread(boost::bind(&MergeCrossings, boost::cref(blocks[i]),
+                                          boost::cref(blocks[i + 1]), boost::ref(merged[i / 2])));
       }
-      if (leftmost == gradientit) {
-        // We didn't find any more intersections.
-        // The rightmost bestindex is the one with the highest slope.
-
-        // They should be equal but there might be.
-        UTIL_THROW_IF(abs(leftmost->first-gradient.rbegin()->first) >= 0.0001,
-                      util::Exception, "Error");
-        // A small difference due to rounding error
-        break;
-      }
-      // We have found the next intersection!
-
-      pair<unsigned,unsigned> newd(S, leftmost->second);//new onebest for Sentence S is leftmost->second
-
-      if (leftmostx-previnserted->first < min_int) {
-        // Require that the intersection Point be at least min_int to the right of the previous
-        // one (for this sentence). If not, we replace the previous intersection Point with
-        // this one.
-        // Yes, it can even happen that the new intersection Point is slightly to the left of
-        // the old one, because of numerical imprecision. We do not check that we are to the
-        // right of the penultimate point also. It this happen the 1best the interval will
-        // be wrong we are going to replace previnsert by the new one because we do not want to keep
-        // 2 very close threshold: if the minima is there it could be an artifact.
-
-        map<float,diff_t>::iterator tit = thresholdmap.find(leftmostx);
-        if (tit == previnserted) {
-          // The threshold is the same as before can happen if 2 candidates are the same for example.
-          UTIL_THROW_IF(previnserted->second.back().first != newd.first,
-                        util::Exception,
-                        "Error");
-          previnserted->second.back()=newd; // just replace the 1 best for sentence S
-          // previnsert doesn't change
-        } else {
-
-          if (tit == thresholdmap.end()) {
-            thresholdmap[leftmostx]=previnserted->second; // We keep the diffs at previnsert
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = thresholdmap.find(leftmostx); // point previnsert to the new threshold
-            previnserted->second.back()=newd; // We update the diff for sentence S
-            // Threshold already exists but is not the previous one.
-          } else {
-            // We append the diffs in previnsert to tit before destroying previnsert.
-            tit->second.insert(tit->second.end(),previnserted->second.begin(),previnserted->second.end());
-            UTIL_THROW_IF(tit->second.back().first != newd.first,
-                          util::Exception,
-                          "Error");
-            tit->second.back()=newd;    // change diff for sentence S
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = tit;  // point previnsert to the new threshold
-          }
-        }
-
-        UTIL_THROW_IF(previnserted == thresholdmap.end(),
-                      util::Exception,
-                      "Error");
-      } else { //normal insertion process
-        previnserted = AddThreshold(thresholdmap, leftmostx, newd);
-      }
-      gradientit = leftmost;
-    } // while (gradientit!=gradient.end()){
-  }   // loop on S
-
-  // Now the thresholdlist is up to date: it contains a list of all the parameter_ts where
-  // the function changed its value, along with the nbest list for the interval after each threshold.
+      if (blocks.size() % 2) merged.back().swap(blocks.back());
+      threads.join_all();
+      blocks.swap(merged);
+    }
+  } else
+#endif
+    CollectCrossings(data, 0, size(), origin, direction, first1best, blocks[0]);
+  const vector<Crossing>& crossings = blocks[0];
+
+  // Group the crossings by position: thresholds holds all the parameter_ts where
+  // the function changes its value, and diffs the nbest changes at each of them.
+  vector<float> thresholds(1, MIN_FLOAT);
+  diffs_t diffs;
+  for (size_t i = 0; i < crossings.size(); ++i) {
+    if (crossings[i].x != thresholds.back()) {
+      thresholds.push_back(crossings[i].x);
+      diffs.push_back(diff_t());
+    }
+    diffs.back().push_back(make_pair(crossings[i].sentence, crossings[i].best));
+  }
 
-  map<float,diff_t >::iterator thrit;
   if (verboselevel() > 6) {
-    cerr << "Thresholds:(" << thresholdmap.size() << ")" << endl;
-    for (thrit = thresholdmap.begin(); thrit != thresholdmap.end(); thrit++) {
-      cerr << "x: " << thrit->first << " diffs";
-      for (size_t j = 0; j < thrit->second.size(); ++j) {
-        cerr << " " <<thrit->second[j].first << "," << thrit->second[j].second;
+    cerr << "Thresholds:(" << thresholds.size() << ")" << endl;
+    cerr << "x: " << thresholds[0] << " diffs" << endl;
+    for (size_t i = 0; i < diffs.size(); ++i) {
+      cerr << "x: " << thresholds[i + 1] << " diffs";
+      for (size_t j = 0; j < diffs[i].size(); ++j) {
+        cerr << " " << diffs[i][j].first << "," << diffs[i][j].second;
       }
       cerr << endl;
     }
   }
 
   // Last thing to do is compute the Stat score (i.e., BLEU) and find the minimum.
-  thrit = thresholdmap.begin();
-  ++thrit;       // first diff corrrespond to MIN_FLOAT and first1best
-  diffs_t diffs;
-  for (; thrit != thresholdmap.end(); thrit++)
-    diffs.push_back(thrit->second);
+  // first diff corrrespond to MIN_FLOAT and first1best
   vector<statscore_t> scores = GetIncStatScore(first1best, diffs);
 
-  thrit = thresholdmap.begin();
   statscore_t bestscore = MIN_FLOAT;
   float bestx = MIN_FLOAT;
 
-  // We skipped the first el of thresholdlist but GetIncStatScore return 1 more for first1best.
-  UTIL_THROW_IF(scores.size() != thresholdmap.size(),
+  // We skipped the first threshold but GetIncStatScore return 1 more for first1best.
+  UTIL_THROW_IF(scores.size() != thresholds.size(),
                 util::Exception,
                 "Error");
   for (unsigned int sc = 0; sc != scores.size(); sc++) {
-    //cerr << "x=" << thrit->first << " => " << scores[sc] << endl;
+    //cerr << "x=" << thresholds[sc] << " => " << scores[sc] << endl;
 
     //enforce positivity
-    Point respoint = origin + direction * thrit->first;
+    Point respoint = origin + direction * thresholds[sc];
     bool is_valid = true;
     for (unsigned int k=0; k < respoint.getdim(); k++) {
       if (m_positive[k] && respoint[k] <= 0.0)
@@ -278,16 +300,8 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       // take x to be the last interval boundary + 0.1, and for the leftmost
       // interval, take x to be the first interval boundary - 1000.
       // These values are taken from cmert.
-      float leftx = thrit->first;
-      if (thrit == thresholdmap.begin()) {
-        leftx = MIN_FLOAT;
-      }
-      ++thrit;
-      float rightx = MAX_FLOAT;
-      if (thrit != thresholdmap.end()) {
-        rightx = thrit->first;
-      }
-      --thrit;
+      float leftx = sc == 0 ? MIN_FLOAT : thresholds[sc];
+      float rightx = sc + 1 < thresholds.size() ? thresholds[sc + 1] : MAX_FLOAT;
       //cerr << "leftx: " << leftx << " rightx: " << rightx << endl;
       if (leftx == MIN_FLOAT) {
         bestx = rightx-1000;
@@ -298,7 +312,6 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       }
       //cerr << "x = " << "set new bestx to: " << bestx << endl;
     }
-    ++thrit;
   }
 
   if (abs(bestx) < 0.00015) {
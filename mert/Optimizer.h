@@ -25,6 +25,7 @@ protected:
   Scorer *m_scorer;      // no accessor for them only child can use them
   FeatureDataHandle m_feature_data;  // no accessor for them only child can use them
   unsigned int m_num_random_directions;
+  std::size_t m_num_threads;
 
   const std::vector<bool>& m_positive;
 
@@ -37,6 +38,12 @@ public:
   void SetFeatureData(FeatureDataHandle feature_data) {
     m_feature_data = feature_data;
   }
+  /**
+   * Number of threads sweeping the sentences within one line search.
+   */
+  void SetThreadCount(std::size_t num_threads) {
+    m_num_threads = num_threads;
+  }
   virtual ~Optimizer();
 
   unsigned size() const {
@@ -8,6 +8,7 @@
 
 #include "Util.h"
 #include "ScoreStats.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -77,11 +78,16 @@ void ScoreStats::add(ScoreStatsType v)
 void ScoreStats::set(const string& str)
 {
   reset();
-  vector<string> out;
-  Tokenize(str.c_str(), ' ', &out);
-  for (vector<string>::const_iterator it = out.begin();
-       it != out.end(); ++it) {
-    add(ConvertStringToScoreStatsType(*it));
+  // the conversion stops at the space after each value
+  const char *current = str.c_str();
+  const char *end = current + str.size();
+  while (current != end) {
+    if (*current == ' ') {
+      ++current;
+      continue;
+    }
+    add(ConvertCharToScoreStatsType(current));
+    current = std::find(current, end, ' ');
   }
 }
 
@@ -131,6 +131,15 @@ public:
     return false;
   };
 
+  /**
+   * Whether prepareStats() may run for several candidates at once. Only
+   * scorers that leave the scorer (and its vocabulary) untouched while
+   * scoring a candidate can return true.
+   */
+  virtual bool isThreadSafe() const {
+    return false;
+  }
+
   /**
    * Set the factors, which should be used for this metric
    */
@@ -171,6 +180,17 @@ protected:
   ScoreData* m_score_data;
   bool m_enable_preserve_case;
 
+  /**
+   * Whether sentences are passed through an external filter command.
+   */
+  bool hasFilter() const {
+#if defined(__GLIBCXX__) || defined(__GLIBCPP__)
+    return m_filter != NULL;
+#else
+    return false;
+#endif
+  }
+
   /**
    * Get value of config variable. If not provided, return default.
    */
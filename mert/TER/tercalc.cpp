@@ -165,10 +165,9 @@ terAlignment terCalc::minimizeDistanceEdition ( vector< string >& hyp, vector< s
   hyp_size=( int ) hyp.size();
   double cost, icost, dcost;
   double score;
-  delete(S);
-  delete(P);
-  S = new vector < vector < double > >(ref_size+1, std::vector<double>(hyp_size+1,-1.0));
-  P = new vector < vector < char > >(ref_size+1, std::vector<char>(hyp_size+1,'0'));
+  // called for every candidate shift, reuse the rows' storage
+  S->assign(ref_size+1, std::vector<double>(hyp_size+1,-1.0));
+  P->assign(ref_size+1, std::vector<char>(hyp_size+1,'0'));
 
 
 
@@ -329,10 +328,9 @@ void terCalc::minimizeDistanceEdition ( vector< string >& hyp, vector< string >&
   hyp_size=( int ) hyp.size();
   double cost, icost, dcost;
   double score;
-  delete(S);
-  delete(P);
-  S = new vector < vector < double > >(ref_size+1, std::vector<double>(hyp_size+1,-1.0));
-  P = new vector < vector < char > >(ref_size+1, std::vector<char>(hyp_size+1,'0'));
+  // called for every candidate shift, reuse the rows' storage
+  S->assign(ref_size+1, std::vector<double>(hyp_size+1,-1.0));
+  P->assign(ref_size+1, std::vector<char>(hyp_size+1,'0'));
 
   NBR_BS_APPELS++;
 // 	cerr << "Appels : " << NBR_BS_APPELS << endl;
@@ -486,8 +484,8 @@ terAlignment terCalc::TER ( vector<string>& hyp, vector<string>& ref )
   double edits = 0;
 //         int numshifts = 0;
 
-  vector<terShift> * allshifts=new vector<terShift>(0);
-  bestShiftStruct * returns=new bestShiftStruct();
+  vector<terShift> allshifts;
+  bestShiftStruct * returns=NULL;
 
 //     cerr << "Initial Alignment:" << endl << cur_align.toString() <<endl;
   if ( PRINT_DEBUG ) {
@@ -498,6 +496,7 @@ terAlignment terCalc::TER ( vector<string>& hyp, vector<string>& ref )
     returns=findBestShift ( cur, hyp, ref, rloc, cur_align );
 //             cerr << "****************************************************************** " <<  returns->getEmpty() << endl;
     if ( returns->getEmpty()) {
+      delete(returns);
       break;
     }
     terShift bestShift = (*(returns->m_best_shift));
@@ -505,7 +504,7 @@ terAlignment terCalc::TER ( vector<string>& hyp, vector<string>& ref )
     edits += bestShift.cost;
     bestShift.alignment = cur_align.alignment;
     bestShift.aftershift = cur_align.aftershift;
-    allshifts->push_back ( bestShift );
+    allshifts.push_back ( bestShift );
     cur = cur_align.aftershift;
     delete(returns);
   }
@@ -514,7 +513,7 @@ terAlignment terCalc::TER ( vector<string>& hyp, vector<string>& ref )
   }
   terAlignment to_return;
   to_return = cur_align;
-  to_return.allshifts = (*(allshifts));
+  to_return.allshifts = allshifts;
   to_return.numEdits += edits;
   NBR_SEGS_EVALUATED++;
   return to_return;
@@ -537,7 +536,7 @@ bestShiftStruct * terCalc::findBestShift ( vector<string>& cur, vector<string>&
     ralign->at(i)=-1;
   }
   calculateTerAlignment ( med_align, herr, rerr, ralign );
-  vector<vecTerShift> * poss_shifts = new vector< vector<terShift> >(0) ;
+  vector<vecTerShift> * poss_shifts = NULL;
   terAlignment * cur_best_align = new terAlignment();
   terShift * cur_best_shift = new terShift();
   double cur_best_shift_cost = 0.0;
@@ -678,6 +677,9 @@ bestShiftStruct * terCalc::findBestShift ( vector<string>& cur, vector<string>&
   }
 // // 		cerr << to_return->toString() << endl;
   delete(poss_shifts);
+  delete(herr);
+  delete(rerr);
+  delete(ralign);
   delete(cur_best_align);
   delete(cur_best_shift);
   delete(curshift);
@@ -61,6 +61,9 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
   result.numWords = 0.0 ;
   result.averageWords = 0.0;
 
+  vector<int> testtokens;
+  TokenizeAndEncodeTesting(sentence, testtokens);
+
   for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
     if ( sid >= m_multi_references.at(incRefs).size() ) {
       stringstream msg;
@@ -68,7 +71,6 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
       throw runtime_error ( msg.str() );
     }
 
-    vector<int> testtokens;
     vector<int> reftokens;
     reftokens = m_multi_references.at ( incRefs ).at ( sid );
     double averageLength=0.0;
@@ -81,7 +83,6 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
       averageLength+=(double)m_multi_references.at ( incRefsBis ).at ( sid ).size();
     }
     averageLength=averageLength/( double ) m_multi_references.size();
-    TokenizeAndEncode(sentence, testtokens);
     terCalc * evaluation=new terCalc();
     evaluation->setDebugMode ( false );
     terAlignment tmp_result = evaluation->TER ( reftokens, testtokens );
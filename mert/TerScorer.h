@@ -33,6 +33,12 @@ public:
 
   virtual float calculateScore(const std::vector<ScoreStatsType>& comps) const;
 
+  // Candidates are only looked up in the vocabulary. A word the references
+  // don't contain can't match any of them, whatever id it gets.
+  virtual bool isThreadSafe() const {
+    return !hasFilter();
+  }
+
 private:
   const int kLENGTH;
 
@@ -39,6 +39,9 @@ void usage()
   cerr << "[--factors|-f] list of factors passed to the scorer (e.g. 0|2)" << endl;
   cerr << "[--filter|-l] filter command used to preprocess the sentences" << endl;
   cerr << "[--allow-duplicates|-d] omit the duplicate removal step" << endl;
+#ifdef WITH_THREADS
+  cerr << "[--threads|-T] use multiple threads to score the nbest (default 1)" << endl;
+#endif
   cerr << "[-v] verbose level" << endl;
   cerr << "[--help|-h] print this message and exit" << endl;
   exit(1);
@@ -59,6 +62,7 @@ static struct option long_options[] = {
   {"verbose", required_argument, 0, 'v'},
   {"help", no_argument, 0, 'h'},
   {"allow-duplicates", no_argument, 0, 'd'},
+  {"threads", required_argument, 0, 'T'},
   {0, 0, 0, 0}
 };
 
@@ -77,6 +81,7 @@ struct ProgramOption {
   bool binmode;
   bool allowDuplicates;
   int verbosity;
+  size_t numThreads;
 
   ProgramOption()
     : scorerType("BLEU"),
@@ -91,7 +96,8 @@ struct ProgramOption {
       prevFeatureDataFile(""),
       binmode(false),
       allowDuplicates(false),
-      verbosity(0) { }
+      verbosity(0),
+      numThreads(1) { }
 };
 
 void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
@@ -99,7 +105,7 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:T:hbd", long_options, &option_index)) != -1) {
     switch (c) {
     case 's':
       opt->scorerType = string(optarg);
@@ -140,6 +146,12 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
     case 'd':
       opt->allowDuplicates = true;
       break;
+#ifdef WITH_THREADS
+    case 'T':
+      opt->numThreads = strtol(optarg, NULL, 10);
+      if (opt->numThreads < 1) opt->numThreads = 1;
+      break;
+#endif
     default:
       usage();
     }
@@ -217,6 +229,7 @@ int main(int argc, char** argv)
 //    PrintUserTime("References loaded");
 
     Data data(scorer.get());
+    data.setThreadCount(option.numThreads);
 
     // load old data
     for (size_t i = 0; i < prevScoreDataFiles.size(); i++) {
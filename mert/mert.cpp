@@ -2,6 +2,7 @@
  * \description This is the main for the new version of the mert algorithm developed during the 2nd MT marathon
 */
 
+#include <algorithm>
 #include <limits>
 #include <unistd.h>
 #include <cstdlib>
@@ -470,6 +471,10 @@ int main(int argc, char **argv)
     Optimizer *optimizer = OptimizerFactory::BuildOptimizer(option.pdim, to_optimize, positive, start_list[0], option.optimize_type, option.nrandom);
     optimizer->SetScorer(data_ref.getScorer());
     optimizer->SetFeatureData(data_ref.getFeatureData());
+#ifdef WITH_THREADS
+    // threads not taken by the starting points split up each line search
+    optimizer->SetThreadCount(std::max<size_t>(1, option.num_threads / std::max<size_t>(1, startingPoints.size() * allTasks.size())));
+#endif
     // A task for each start point
     for (size_t j = 0; j < startingPoints.size(); ++j) {
       boost::shared_ptr<OptimizationTask>
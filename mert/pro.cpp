@@ -206,6 +206,13 @@ int main(int argc, char** argv)
       }
     }
 
+    //each hypothesis is drawn n_candidates*2/n_translations times on average,
+    //so score them all once up front
+    vector<float> bleus(hypotheses.size());
+    for (size_t i = 0; i < hypotheses.size(); ++i) {
+      bleus[i] = smoothedSentenceBleu(scoreDataIters[hypotheses[i].first]->operator[](hypotheses[i].second), bleuSmoothing, smoothBP);
+    }
+
     //collect the candidates
     vector<SampledPair> samples;
     vector<float> scores;
@@ -213,11 +220,11 @@ int main(int argc, char** argv)
     for(size_t  i=0; i<n_candidates; i++) {
       size_t rand1 = rand() % n_translations;
       pair<size_t,size_t> translation1 = hypotheses[rand1];
-      float bleu1 = smoothedSentenceBleu(scoreDataIters[translation1.first]->operator[](translation1.second), bleuSmoothing, smoothBP);
+      float bleu1 = bleus[rand1];
 
       size_t rand2 = rand() % n_translations;
       pair<size_t,size_t> translation2 = hypotheses[rand2];
-      float bleu2 = smoothedSentenceBleu(scoreDataIters[translation2.first]->operator[](translation2.second), bleuSmoothing, smoothBP);
+      float bleu2 = bleus[rand2];
 
       /*
       cerr << "t(" << translation1.first << "," << translation1.second << ") = " << bleu1 <<
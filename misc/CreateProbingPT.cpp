@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <string>
+
 #include "util/usage.hh"
 #include "moses/TranslationModel/ProbingPT/storing.hh"
 
@@ -8,20 +11,36 @@ int main(int argc, char* argv[])
 
   const char * is_reordering = "false";
 
-  if (!(argc == 5 || argc == 4)) {
+  //--threads N may come anywhere, the other arguments are positional
+  size_t threads = 1;
+  int positional = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+      threads = std::max(atoi(argv[++i]), 1);
+    } else {
+      argv[positional++] = argv[i];
+    }
+  }
+  argc = positional;
+
+  if (argc < 4 || argc > 7) {
     // Tell the user how to run the program
-    std::cerr << "Provided " << argc << " arguments, needed 4 or 5." << std::endl;
-    std::cerr << "Usage: " << argv[0] << " path_to_phrasetable output_dir num_scores is_reordering" << std::endl;
+    std::cerr << "Provided " << argc << " arguments, needed 4 to 7." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " [--threads N] path_to_phrasetable output_dir num_scores [is_reordering [lm [lm_factor]]]" << std::endl;
     std::cerr << "is_reordering should be either true or false, but it is currently a stub feature." << std::endl;
+    std::cerr << "lm is a KenLM model whose phrase-internal scores of target factor lm_factor (default 0) are stored." << std::endl;
+    std::cerr << "With --threads, the lines of the phrase table are counted and encoded on N threads." << std::endl;
     //std::cerr << "Usage: " << argv[0] << " path_to_phrasetable number_of_uniq_lines output_bin_file output_hash_table output_vocab_id" << std::endl;
     return 1;
   }
 
-  if (argc == 5) {
+  if (argc >= 5) {
     is_reordering = argv[4];
   }
+  const char * lm_path = (argc >= 6) ? argv[5] : NULL;
+  size_t lm_factor = (argc == 7) ? atoi(argv[6]) : 0;
 
-  createProbingPT(argv[1], argv[2], argv[3], is_reordering);
+  createProbingPT(argv[1], argv[2], argv[3], is_reordering, lm_path, lm_factor, threads);
 
   util::PrintUsage(std::cout);
   return 0;
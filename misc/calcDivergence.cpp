@@ -0,0 +1,375 @@
+// $Id$
+// vim:tabstop=2
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+
+/**
+  Divergence scores for relative entropy pruning (Ling et al, 2012), as
+  computed by contrib/relent-filter by force decoding every phrase pair.
+
+  For each line of the phrase table, prints the difference between the
+  model score of the phrase pair itself and that of the best derivation of
+  its target phrase from smaller phrase pairs of the table, at most 100.
+  Both derivations produce the same target string, so the language model
+  and word penalty cancel; only the stateless scores of the phrase pairs
+  (translation model, phrase penalty) and the distortion cost differ, and
+  the best derivation is found exactly by search over the source coverage.
+  Lexicalized reordering is not taken into account.
+
+  The models are loaded once from the moses.ini; the table is split by
+  source phrase and scored on the decoder's thread pool (-threads), with
+  the output in table order.
+**/
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "moses/FF/DistortionScoreProducer.h"
+#include "moses/OutputCollector.h"
+#include "moses/Parameter.h"
+#include "moses/Sentence.h"
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TargetPhraseCollection.h"
+#include "moses/ThreadPool.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
+
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+#include "util/exception.hh"
+
+
+using namespace Moses;
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+//! divergence of pairs that can't be decomposed, which are never pruned
+const float MAX_DIVERGENCE = 100;
+
+//! longer source phrases are not searched, and get MAX_DIVERGENCE
+const size_t MAX_SOURCE_LENGTH = 12;
+
+const float NO_SCORE = -numeric_limits<float>::infinity();
+
+void usage(const po::options_description& desc, char** argv)
+{
+  cerr << "Usage: " + string(argv[0]) +  " [options] [decoder options]" << endl;
+  cerr << desc << endl;
+  cerr << "Other options, e.g. -threads, are passed on to the decoder." << endl;
+}
+
+//! target phrases of one source span, where they occur in the target
+struct Edge {
+  size_t start;   // span of the source phrase
+  size_t end;
+  size_t targetPos;
+  size_t targetSize;
+  float score;
+};
+
+/** Scores the translation options of one source phrase.
+ */
+class DivergenceTask : public Task
+{
+public:
+  DivergenceTask(size_t id, const vector<string> &lines,
+                 PhraseDictionary &phraseTable, float distortionWeight,
+                 OutputCollector &collector)
+    : m_id(id), m_lines(lines), m_phraseTable(phraseTable),
+      m_distortionWeight(distortionWeight), m_collector(collector) {}
+
+  void Run();
+
+private:
+  float BestDerivation(const Phrase &target, size_t sourceSize,
+                       const vector<Edge> &edges) const;
+
+  size_t m_id;
+  vector<string> m_lines;
+  PhraseDictionary &m_phraseTable;
+  float m_distortionWeight;
+  OutputCollector &m_collector;
+};
+
+void DivergenceTask::Run()
+{
+  const StaticData &staticData = StaticData::Instance();
+  ostringstream out;
+  out << fixed << setprecision(3);
+
+  util::TokenIter<util::MultiCharacter> pipes(m_lines[0], "|||");
+  Phrase source(0);
+  source.CreateFromString(Input, staticData.GetInputFactorOrder(), pipes->as_string(), NULL);
+  const size_t sourceSize = source.GetSize();
+
+  // the translations of the proper sub-phrases of the source phrase
+  vector<pair<WordsRange, const TargetPhraseCollection*> > spans;
+  if (sourceSize <= MAX_SOURCE_LENGTH) {
+    for (size_t start = 0; start < sourceSize; ++start) {
+      for (size_t end = start + 1; end <= sourceSize; ++end) {
+        if (start == 0 && end == sourceSize) continue;
+        WordsRange range(start, end - 1);
+        Phrase subPhrase = source.GetSubString(range);
+        spans.push_back(make_pair(range, m_phraseTable.GetTargetPhraseCollectionLEGACY(subPhrase)));
+      }
+    }
+  }
+  const TargetPhraseCollection *whole = m_phraseTable.GetTargetPhraseCollectionLEGACY(source);
+
+  vector<Edge> edges;
+  for (size_t l = 0; l < m_lines.size(); ++l) {
+    util::TokenIter<util::MultiCharacter> pipes(m_lines[l], "|||");
+    Phrase target(0);
+    target.CreateFromString(Output, staticData.GetOutputFactorOrder(), (++pipes)->as_string(), NULL);
+
+    float direct = NO_SCORE;
+    if (whole) {
+      for (TargetPhraseCollection::const_iterator tp = whole->begin(); tp != whole->end(); ++tp) {
+        if ((*tp)->Compare(target) == 0) {
+          direct = (*tp)->GetScoreBreakdown().GetWeightedScore();
+          break;
+        }
+      }
+    }
+
+    // where the translations of the spans occur in this target phrase
+    edges.clear();
+    for (size_t s = 0; s < spans.size() && direct != NO_SCORE; ++s) {
+      if (!spans[s].second) continue;
+      const TargetPhraseCollection &tpc = *spans[s].second;
+      for (TargetPhraseCollection::const_iterator tp = tpc.begin(); tp != tpc.end(); ++tp) {
+        const size_t size = (*tp)->GetSize();
+        for (size_t pos = 0; size && pos + size <= target.GetSize(); ++pos) {
+          size_t i = 0;
+          while (i < size && (*tp)->GetWord(i) == target.GetWord(pos + i)) ++i;
+          if (i < size) continue;
+          Edge edge;
+          edge.start = spans[s].first.GetStartPos();
+          edge.end = spans[s].first.GetEndPos() + 1;
+          edge.targetPos = pos;
+          edge.targetSize = size;
+          edge.score = (*tp)->GetScoreBreakdown().GetWeightedScore();
+          edges.push_back(edge);
+        }
+      }
+    }
+
+    // the pair itself isn't in the table (e.g. cut by the table limit), or
+    // can't be made from smaller ones: keep it
+    float divergence = MAX_DIVERGENCE;
+    if (direct != NO_SCORE) {
+      const float pruned = BestDerivation(target, sourceSize, edges);
+      if (pruned != NO_SCORE) {
+        divergence = std::min(MAX_DIVERGENCE, std::max(direct, pruned) - pruned);
+      }
+    }
+    out << divergence << "\n";
+  }
+
+  m_phraseTable.CleanUpAfterSentenceProcessing(Sentence());
+  m_collector.Write(m_id, out.str());
+}
+
+float DivergenceTask::BestDerivation(const Phrase &target, size_t sourceSize,
+                                     const vector<Edge> &edges) const
+{
+  if (edges.empty()) return NO_SCORE;
+
+  // best score of the states (source coverage, target words produced, end
+  // of the last source phrase); coverage only grows, so visiting the
+  // coverages in increasing order visits every state after its predecessors
+  const size_t targetSize = target.GetSize();
+  const size_t masks = size_t(1) << sourceSize;
+  const size_t full = masks - 1;
+  const int maxDistortion = StaticData::Instance().GetMaxDistortion();
+  vector<float> best(masks * (targetSize + 1) * (sourceSize + 1), NO_SCORE);
+  best[0] = 0;
+#define STATE(mask, pos, last) (((mask) * (targetSize + 1) + (pos)) * (sourceSize + 1) + (last))
+
+  for (size_t mask = 0; mask < full; ++mask) {
+    for (size_t pos = 0; pos < targetSize; ++pos) {
+      for (size_t last = 0; last <= sourceSize; ++last) {
+        const float score = best[STATE(mask, pos, last)];
+        if (score == NO_SCORE) continue;
+        for (size_t e = 0; e < edges.size(); ++e) {
+          const Edge &edge = edges[e];
+          if (edge.targetPos != pos) continue;
+          const size_t span = ((size_t(1) << edge.end) - 1) & ~((size_t(1) << edge.start) - 1);
+          if (mask & span) continue;
+          const int distortion = abs(int(edge.start) - int(last));
+          if (maxDistortion >= 0 && distortion > maxDistortion) continue;
+          float &next = best[STATE(mask | span, pos + edge.targetSize, edge.end)];
+          // the distortion score is minus the distance jumped
+          next = std::max(next, score + edge.score - m_distortionWeight * distortion);
+        }
+      }
+    }
+  }
+
+  float ret = NO_SCORE;
+  for (size_t last = 0; last <= sourceSize; ++last) {
+    ret = std::max(ret, best[STATE(full, targetSize, last)]);
+  }
+#undef STATE
+  return ret;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  bool help;
+  string input_file;
+  string config_file;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+  ("help,h", po::value(&help)->zero_tokens()->default_value(false), "Print this help message and exit")
+  ("input-file,i", po::value<string>(&input_file), "Phrase table to score, sorted by source phrase")
+  ("config-file,f", po::value<string>(&config_file), "Config file with the models of the phrase table")
+  ;
+
+  po::options_description cmdline_options;
+  cmdline_options.add(desc);
+  po::variables_map vm;
+  po::parsed_options parsed = po::command_line_parser(argc,argv).
+                              options(cmdline_options).allow_unregistered().run();
+  po::store(parsed, vm);
+  po::notify(vm);
+  if (help) {
+    usage(desc, argv);
+    exit(0);
+  }
+  if (input_file.empty()) {
+    cerr << "ERROR: Please specify an input file" << endl << endl;
+    usage(desc, argv);
+    exit(1);
+  }
+  if (config_file.empty()) {
+    cerr << "ERROR: Please specify a config file" << endl << endl;
+    usage(desc, argv);
+    exit(1);
+  }
+
+  vector<string> mosesargs;
+  mosesargs.push_back(argv[0]);
+  mosesargs.push_back("-f");
+  mosesargs.push_back(config_file);
+  vector<string> unrecognized = po::collect_unrecognized(parsed.options, po::include_positional);
+  mosesargs.insert(mosesargs.end(), unrecognized.begin(), unrecognized.end());
+
+  boost::scoped_ptr<Parameter> params(new Parameter());
+  char** mosesargv = new char*[mosesargs.size()];
+  for (size_t i = 0; i < mosesargs.size(); ++i) {
+    mosesargv[i] = new char[mosesargs[i].length() + 1];
+    strcpy(mosesargv[i], mosesargs[i].c_str());
+  }
+
+  if (!params->LoadParam(mosesargs.size(), mosesargv)) {
+    params->Explain();
+    exit(1);
+  }
+
+  if (!StaticData::LoadDataStatic(params.get(),argv[0])) {
+    exit(1);
+  }
+
+  const StaticData &staticData = StaticData::Instance();
+
+  //Find the phrase table, and the weight of the distortion cost
+  PhraseDictionary* phraseTable = NULL;
+  float distortionWeight = 0;
+  const vector<FeatureFunction*>& ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    PhraseDictionary* maybePhraseTable = dynamic_cast< PhraseDictionary*>(ffs[i]);
+    if (maybePhraseTable) {
+      UTIL_THROW_IF(phraseTable,util::Exception,"Can only score translations with one phrase table");
+      phraseTable = maybePhraseTable;
+    }
+    if (dynamic_cast<DistortionScoreProducer*>(ffs[i])) {
+      distortionWeight = staticData.GetWeights(ffs[i])[0];
+    }
+  }
+  UTIL_THROW_IF(!phraseTable,util::Exception,"Unable to find scoring phrase table");
+
+  std::ostream *progress = NULL;
+  IFVERBOSE(1) progress = &std::cerr;
+  util::FilePiece in(input_file.c_str(), progress);
+
+  OutputCollector collector;
+  // bound the source phrases waiting behind a slow one
+  const size_t outputWindow = staticData.GetOutputWindow()
+                              ? staticData.GetOutputWindow() : 100 * staticData.ThreadCount();
+#ifdef WITH_THREADS
+  ThreadPool pool(staticData.ThreadCount());
+#endif
+
+  vector<string> lines;
+  string previous;
+  size_t id = 0;
+  while(true) {
+    StringPiece line;
+    bool eof = false;
+    try {
+      line = in.ReadLine();
+    } catch (const util::EndOfFileException &e) {
+      eof = true;
+    }
+
+    StringPiece sourcePhraseString;
+    if (!eof) sourcePhraseString = *util::TokenIter<util::MultiCharacter>(line, "|||");
+    if ((eof || sourcePhraseString != previous) && !lines.empty()) {
+      boost::shared_ptr<DivergenceTask> task(new DivergenceTask(id, lines, *phraseTable, distortionWeight, collector));
+#ifdef WITH_THREADS
+      collector.WaitForTurn(id, outputWindow);
+      pool.Submit(task);
+#else
+      task->Run();
+#endif
+      ++id;
+      lines.clear();
+    }
+    if (eof) break;
+    previous = sourcePhraseString.as_string();
+    lines.push_back(line.as_string());
+  }
+
+#ifdef WITH_THREADS
+  pool.Stop(true);
+#endif
+
+  return 0;
+}
@@ -20,6 +20,8 @@ void printHelp(char **argv)
             "\t-T string         -- path to temporary directory (uses /tmp by default)\n"
             "\t-nscores int      -- number of score components in phrase table\n"
             "\t-no-alignment-info   -- do not include alignment info in the binary phrase table\n"
+            "\t-lm string        -- KenLM model whose phrase-internal scores are stored\n"
+            "\t-lm-factor int    -- target factor of the LM (default 0)\n"
 #ifdef WITH_THREADS
             "\t-threads int|all  -- number of threads used for conversion\n"
 #endif
@@ -68,6 +70,8 @@ int main(int argc, char **argv)
   size_t sortScoreIndex = 2;
   bool warnMe = true;
   size_t threads = 1;
+  std::string lmPath;
+  size_t lmFactor = 0;
 
   if(1 >= argc) {
     printHelp(argv);
@@ -105,6 +109,12 @@ int main(int argc, char **argv)
       ++i;
       sortScoreIndex = atoi(argv[i]);
       sortScoreIndexSet = true;
+    } else if("-lm" == arg && i+1 < argc) {
+      ++i;
+      lmPath = argv[i];
+    } else if("-lm-factor" == arg && i+1 < argc) {
+      ++i;
+      lmFactor = atoi(argv[i]);
     } else if("-no-alignment-info" == arg) {
       useAlignmentInfo = false;
     } else if("-landmark" == arg && i+1 < argc) {
@@ -162,7 +172,8 @@ int main(int argc, char **argv)
                      numScoreComponent, sortScoreIndex,
                      coding, orderBits, fingerprintBits,
                      useAlignmentInfo, multipleScoreTrees,
-                     quantize, maxRank, warnMe
+                     quantize, maxRank, warnMe,
+                     lmPath, lmFactor
 #ifdef WITH_THREADS
                      , threads
 #endif
@@ -182,6 +182,9 @@ int main(int argc, char* argv[])
       manager.Decode();
       TrellisPathList nBestList;
       manager.CalcNBest(nBestSize, nBestList,true);
+      // the posteriors only depend on pruning and scale, so compute them
+      // once per pair and reuse them for every p and r
+      map<pair<size_t, float>, NgramPosteriors> posteriors;
       //grid search
       BOOST_FOREACH(float const& p, pgrid)
 	{
@@ -199,7 +202,13 @@ int main(int argc, char* argv[])
 		      cout << lineCount << " ||| " << p << " " 
 			   << r << " " << size_t(prune_i) << " " << scale_i
 			   << " ||| ";
-		      vector<Word> mbrBestHypo = doLatticeMBR(manager,nBestList);
+		      pair<size_t, float> key(size_t(prune_i), scale_i);
+		      map<pair<size_t, float>, NgramPosteriors>::iterator post = posteriors.find(key);
+		      if (post == posteriors.end()) {
+			post = posteriors.insert(make_pair(key, NgramPosteriors())).first;
+			calcLatticeMBRPosteriors(manager, post->second);
+		      }
+		      vector<Word> mbrBestHypo = doLatticeMBR(post->second,nBestList);
 		      manager.OutputBestHypo(mbrBestHypo, lineCount, 
 					     SD.GetReportSegmentation(),
 					     SD.GetReportAllFactors(),cout);
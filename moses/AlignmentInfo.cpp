@@ -143,6 +143,39 @@ std::vector< const std::pair<size_t,size_t>* > AlignmentInfo::GetSortedAlignment
 
 }
 
+namespace
+{
+struct CompareTarget {
+  bool operator()(const std::pair<size_t,size_t> &a, const std::pair<size_t,size_t> &b) const {
+    return a.second < b.second || (a.second == b.second && a.first < b.first);
+  }
+};
+}
+
+void AlignmentInfo::AppendSortedAlignments(std::vector<std::pair<size_t,size_t> > &out,
+    size_t sourceOffset, size_t targetOffset) const
+{
+  const size_t begin = out.size();
+  CollType::const_iterator iter;
+  for (iter = m_collection.begin(); iter != m_collection.end(); ++iter) {
+    out.push_back(std::make_pair(iter->first + sourceOffset, iter->second + targetOffset));
+  }
+
+  WordAlignmentSort wordAlignmentSort = StaticData::Instance().GetWordAlignmentSort();
+  switch (wordAlignmentSort) {
+  case NoSort:
+    break;
+
+  case TargetOrder:
+    // the offsets don't change the order
+    std::sort(out.begin() + begin, out.end(), CompareTarget());
+    break;
+
+  default:
+    UTIL_THROW(util::Exception, "Unknown alignment sort option: " << wordAlignmentSort);
+  }
+}
+
 std::vector<size_t> AlignmentInfo::GetSourceIndex2PosMap() const
 {
   std::set<size_t> sourcePoses;
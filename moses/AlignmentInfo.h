@@ -85,6 +85,11 @@ public:
 
   std::vector< const std::pair<size_t,size_t>* > GetSortedAlignments() const;
 
+  /** append the alignment points in the order of GetSortedAlignments(),
+   *  with the offsets added, to out (which the caller can reuse) */
+  void AppendSortedAlignments(std::vector<std::pair<size_t,size_t> > &out,
+                              size_t sourceOffset, size_t targetOffset) const;
+
   std::vector<size_t> GetSourceIndex2PosMap() const;
 
   bool operator==(const AlignmentInfo& rhs) const {
@@ -19,9 +19,49 @@
 
 #include "AlignmentInfoCollection.h"
 
+#include <algorithm>
+
+#include "util/murmur_hash.hh"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 namespace Moses
 {
 
+namespace
+{
+#ifdef WITH_THREADS
+// recently used keys of this thread
+struct FrontCache {
+  static const size_t kSize = 1024;
+  std::string keys[kSize];
+  const AlignmentInfo *infos[kSize];
+
+  FrontCache() {
+    std::fill(infos, infos + kSize, static_cast<const AlignmentInfo*>(NULL));
+  }
+};
+
+boost::thread_specific_ptr<FrontCache> &Front()
+{
+  static boost::thread_specific_ptr<FrontCache> front;
+  return front;
+}
+
+FrontCache &GetFront()
+{
+  FrontCache *front = Front().get();
+  if (!front) {
+    front = new FrontCache;
+    Front().reset(front);
+  }
+  return *front;
+}
+#endif
+}
+
 AlignmentInfoCollection AlignmentInfoCollection::s_instance;
 
 AlignmentInfoCollection::AlignmentInfoCollection()
@@ -31,30 +71,80 @@ AlignmentInfoCollection::AlignmentInfoCollection()
 }
 
 AlignmentInfoCollection::~AlignmentInfoCollection()
-{}
+{
+  for (size_t i = 0; i < kShards; ++i) {
+    AlignmentInfoMap &collection = m_shards[i].collection;
+    for (AlignmentInfoMap::iterator it = collection.begin(); it != collection.end(); ++it) {
+      delete it->second;
+    }
+  }
+}
 
 const AlignmentInfo &AlignmentInfoCollection::GetEmptyAlignmentInfo() const
 {
   return *m_emptyAlignmentInfo;
 }
 
-AlignmentInfo const *
+const AlignmentInfo *AlignmentInfoCollection::Add(const std::vector<unsigned char> &aln)
+{
+  std::vector<std::pair<size_t, size_t> > pairs;
+  pairs.reserve(aln.size() / 2);
+  for (size_t i = 0; i + 1 < aln.size(); i += 2) {
+    pairs.push_back(std::make_pair(size_t(aln[i]), size_t(aln[i+1])));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  return Intern(Pack(pairs.begin(), pairs.end()), aln);
+}
+
+AlignmentInfoCollection::Shard &
+AlignmentInfoCollection::
+GetShard(const std::string &key, size_t &hash) const
+{
+  hash = util::MurmurHashNative(key.data(), key.size());
+  return m_shards[hash % kShards];
+}
+
+const AlignmentInfo *
 AlignmentInfoCollection::
-Add(AlignmentInfo const& ainfo)
+Find(const std::string &key) const
 {
+  size_t hash;
+  const Shard &shard = GetShard(key, hash);
 #ifdef WITH_THREADS
-  {
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-    AlignmentInfoSet::const_iterator i = m_collection.find(ainfo);
-    if (i != m_collection.end())
-      return &*i;
+  FrontCache &front = GetFront();
+  const size_t slot = (hash / kShards) % FrontCache::kSize;
+  if (front.infos[slot] && front.keys[slot] == key) {
+    return front.infos[slot];
   }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+  boost::shared_lock<boost::shared_mutex> read_lock(shard.accessLock);
 #endif
-  std::pair<AlignmentInfoSet::iterator, bool> ret = m_collection.insert(ainfo);
-  return &(*ret.first);
+  AlignmentInfoMap::const_iterator i = shard.collection.find(key);
+  if (i == shard.collection.end()) {
+    return NULL;
+  }
+#ifdef WITH_THREADS
+  front.keys[slot] = key;
+  front.infos[slot] = i->second;
+#endif
+  return i->second;
 }
 
-
+const AlignmentInfo *
+AlignmentInfoCollection::
+Insert(const std::string &key, AlignmentInfo *ainfo)
+{
+  size_t hash;
+  Shard &shard = GetShard(key, hash);
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(shard.accessLock);
+#endif
+  std::pair<AlignmentInfoMap::iterator, bool> ret
+    = shard.collection.insert(std::make_pair(key, ainfo));
+  if (!ret.second) {
+    delete ainfo;
+  }
+  return ret.first->second;
+}
 
 }
@@ -22,6 +22,10 @@
 #include "AlignmentInfo.h"
 
 #include <set>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
@@ -33,6 +37,12 @@ namespace Moses
 
 /** Singleton collection of all AlignmentInfo objects.
  *  Used as a cache of all alignment info to save space.
+ *
+ *  Alignments are interned by a packed key, a byte pair per alignment
+ *  point, in a hash table split into independently locked shards. Each
+ *  thread also keeps a small direct-mapped cache of recent keys in front
+ *  of the table, so that the alignments phrase tables decode over and over
+ *  are found without taking any lock.
  */
 class AlignmentInfoCollection
 {
@@ -46,22 +56,76 @@ public:
     * contains such an object then returns a pointer to it; otherwise a new
     * one is inserted.
    */
-private:
-  const AlignmentInfo* Add(AlignmentInfo const& ainfo);
+  const AlignmentInfo *Add(const std::set<std::pair<size_t,size_t> > &pairs) {
+    return Intern(Pack(pairs.begin(), pairs.end()), pairs);
+  }
+
+  //! alignment points as source, target bytes, as stored by mmsapt
+  const AlignmentInfo *Add(const std::vector<unsigned char> &aln);
 
-public:
   template<typename ALNREP>
   AlignmentInfo const *
   Add(ALNREP const & aln) {
-    return this->Add(AlignmentInfo(aln));
+    // no packed form without building the alignment info first
+    AlignmentInfo *ainfo = new AlignmentInfo(aln);
+    return Insert(Pack(ainfo->begin(), ainfo->end()), ainfo);
   }
 
   //! Returns a pointer to an empty AlignmentInfo object.
   const AlignmentInfo &GetEmptyAlignmentInfo() const;
 
 private:
-  typedef std::set<AlignmentInfo, AlignmentInfoOrderer> AlignmentInfoSet;
+  typedef boost::unordered_map<std::string, const AlignmentInfo*> AlignmentInfoMap;
 
+  struct Shard {
+#ifdef WITH_THREADS
+    //reader-writer lock
+    mutable boost::shared_mutex accessLock;
+#endif
+    AlignmentInfoMap collection;
+  };
+  static const size_t kShards = 64;
+
+  //! the key of sorted, unique alignment points: a byte each for source and
+  //! target position, or 4 bytes each after a 0xff marker if they don't fit
+  template <class Iterator>
+  static std::string Pack(Iterator begin, Iterator end) {
+    std::string key;
+    bool narrow = true;
+    for (Iterator p = begin; p != end && narrow; ++p) {
+      narrow = p->first < 0xff && p->second < 0xff;
+    }
+    if (!narrow) {
+      key += char(0xff);
+    }
+    for (Iterator p = begin; p != end; ++p) {
+      AppendPosition(key, p->first, narrow);
+      AppendPosition(key, p->second, narrow);
+    }
+    return key;
+  }
+
+  static void AppendPosition(std::string &key, size_t pos, bool narrow) {
+    key += char(pos);
+    if (!narrow) {
+      key += char(pos >> 8);
+      key += char(pos >> 16);
+      key += char(pos >> 24);
+    }
+  }
+
+  template <class ALNREP>
+  const AlignmentInfo *Intern(const std::string &key, const ALNREP &aln) {
+    const AlignmentInfo *ret = Find(key);
+    return ret ? ret : Insert(key, new AlignmentInfo(aln));
+  }
+
+  //! NULL if the key isn't in the collection yet
+  const AlignmentInfo *Find(const std::string &key) const;
+  //! takes ownership of ainfo, which is deleted if key was inserted meanwhile
+  const AlignmentInfo *Insert(const std::string &key, AlignmentInfo *ainfo);
+
+  Shard &GetShard(const std::string &key, size_t &hash) const;
 
   //! Only a single static variable should be created.
   AlignmentInfoCollection();
@@ -69,12 +133,7 @@ private:
 
   static AlignmentInfoCollection s_instance;
 
-#ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
-#endif
-
-  AlignmentInfoSet m_collection;
+  mutable Shard m_shards[kShards];
   const AlignmentInfo *m_emptyAlignmentInfo;
 };
 
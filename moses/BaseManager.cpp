@@ -4,11 +4,50 @@
 #include "BaseManager.h"
 #include "moses/FF/StatelessFeatureFunction.h"
 #include "moses/FF/StatefulFeatureFunction.h"
+#include "util/usage.hh"
 
 using namespace std;
 
 namespace Moses
 {
+BaseManager::BaseManager(const InputType &source)
+  :m_source(source)
+  ,m_startTime(util::WallTime())
+  ,m_deadline(0)
+  ,m_degraded(false)
+  ,m_optionsTime(0)
+  ,m_searchTime(0)
+{
+  const double budget = StaticData::Instance().GetTimeBudget();
+  if (budget > 0) {
+    m_deadline = m_startTime + budget;
+  }
+}
+
+void BaseManager::SetDeadline(double deadline)
+{
+  if (deadline > 0 && (m_deadline == 0 || deadline < m_deadline)) {
+    m_deadline = deadline;
+  }
+}
+
+size_t BaseManager::TightenLimit(size_t limit)
+{
+  if (m_deadline == 0) return limit;
+  const double used = (util::WallTime() - m_startTime) / (m_deadline - m_startTime);
+  if (used < 0.5) return limit;
+  size_t ret = 1;
+  if (used < 1.0 && limit > 0) {
+    ret = std::max(size_t(1), size_t(limit * 2 * (1.0 - used)));
+  }
+  if (ret != limit && !m_degraded) {
+    VERBOSE(1,"Time budget " << (used < 1.0 ? "running out" : "used up")
+            << ", tightening search limits" << endl);
+    m_degraded = true;
+  }
+  return ret;
+}
+
 /***
  * print surface factor only for the given phrase
  */
@@ -16,9 +16,15 @@ class BaseManager
 protected:
   const InputType &m_source; /**< source sentence to be translated */
 
-  BaseManager(const InputType &source)
-    :m_source(source) {
-  }
+  // time budget, in util::WallTime() seconds
+  double m_startTime;
+  double m_deadline; /**< 0 for none */
+  bool m_degraded; /**< whether some limit had to be tightened */
+
+  // seconds spent collecting translation options and searching
+  double m_optionsTime, m_searchTime;
+
+  BaseManager(const InputType &source);
 
   // output
   typedef std::vector<std::pair<Moses::Word, Moses::WordsRange> > ApplicationContext;
@@ -54,6 +60,32 @@ public:
   }
 
   virtual void Decode() = 0;
+
+  /** Sets a wall-clock deadline (util::WallTime() seconds), if it is earlier
+   *  than the one from -time-budget.
+   */
+  void SetDeadline(double deadline);
+
+  /** Beam, stack or pop limit to use now, given the time budget: limit for
+   *  the first half of the budget, then less and less, down to 1 (a greedy
+   *  search that completes quickly) once the budget is used up.
+   *  0 (no limit) is only tightened then.
+   */
+  size_t TightenLimit(size_t limit);
+
+  //! whether the time budget forced the search to tighten its limits
+  bool WasDegraded() const {
+    return m_degraded;
+  }
+
+  //! wall-clock seconds Decode() spent collecting translation options
+  double GetOptionsTime() const {
+    return m_optionsTime;
+  }
+  //! wall-clock seconds Decode() spent in the search proper
+  double GetSearchTime() const {
+    return m_searchTime;
+  }
   // outputs
   virtual void OutputBest(OutputCollector *collector) const = 0;
   virtual void OutputNBest(OutputCollector *collector) const = 0;
@@ -0,0 +1,18 @@
+#include "BatchTranslationTask.h"
+
+#include "moses/TranslationTask.h"
+
+namespace Moses
+{
+
+void BatchTranslationTask::Run()
+{
+  for (size_t i = 0; i < m_tasks.size(); ++i) {
+    m_tasks[i]->Run();
+    // the task may be referenced by feature functions until it is gone
+    m_tasks[i].reset();
+  }
+  m_tasks.clear();
+}
+
+}
@@ -0,0 +1,35 @@
+// -*- c++ -*-
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "moses/ThreadPool.h"
+
+namespace Moses
+{
+class TranslationTask;
+
+/** Several (short) sentences translated one after another as one task of the
+ *  thread pool, with -batch-sentences. A batch goes through the pool only
+ *  once, and its sentences find the caches of the thread and its recycled
+ *  search memory (see Manager::Storage) warm.
+ */
+class BatchTranslationTask : public Task
+{
+public:
+  void Add(const boost::shared_ptr<TranslationTask> &task) {
+    m_tasks.push_back(task);
+  }
+
+  size_t GetSize() const {
+    return m_tasks.size();
+  }
+
+  void Run();
+
+private:
+  std::vector<boost::shared_ptr<TranslationTask> > m_tasks;
+};
+
+}
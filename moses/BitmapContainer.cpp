@@ -182,8 +182,6 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
 
 BackwardsEdge::~BackwardsEdge()
 {
-  m_seenPosition.clear();
-  m_hypotheses.clear();
 }
 
 
@@ -219,17 +217,21 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
 bool
 BackwardsEdge::SeenPosition(const size_t x, const size_t y)
 {
-  boost::unordered_set< int >::iterator iter = m_seenPosition.find((x<<16) + y);
-  return (iter != m_seenPosition.end());
+  const size_t pos = x * m_translations.size() + y;
+  return pos < m_seenPosition.size() && m_seenPosition[pos];
 }
 
 void
 BackwardsEdge::SetSeenPosition(const size_t x, const size_t y)
 {
-  UTIL_THROW_IF2(x >= (1<<17), "Error");
-  UTIL_THROW_IF2(y >= (1<<17), "Error");
+  UTIL_THROW_IF2(x >= m_hypotheses.size() || y >= m_translations.size(),
+                 "Position (" << x << ", " << y << ") outside the cube");
 
-  m_seenPosition.insert((x<<16) + y);
+  const size_t pos = x * m_translations.size() + y;
+  if (pos >= m_seenPosition.size()) {
+    m_seenPosition.resize((x + 1) * m_translations.size(), false);
+  }
+  m_seenPosition[pos] = true;
 }
 
 
@@ -288,11 +290,8 @@ BitmapContainer::~BitmapContainer()
   // As we have created the square position objects we clean up now.
 
   while (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
+    FREEHYPO( m_queue.top().GetHypothesis() );
     m_queue.pop();
-
-    FREEHYPO( item->GetHypothesis() );
-    delete item;
   }
 
   // Delete all edges.
@@ -309,36 +308,28 @@ BitmapContainer::Enqueue(int hypothesis_pos
                          , Hypothesis *hypothesis
                          , BackwardsEdge *edge)
 {
-  HypothesisQueueItem *item = new HypothesisQueueItem(hypothesis_pos
-      , translation_pos
-      , hypothesis
-      , edge);
   IFVERBOSE(2) {
-    item->GetHypothesis()->GetManager().GetSentenceStats().StartTimeManageCubes();
+    hypothesis->GetManager().GetSentenceStats().StartTimeManageCubes();
   }
-  m_queue.push(item);
+  m_queue.push(HypothesisQueueItem(hypothesis_pos
+                                   , translation_pos
+                                   , hypothesis
+                                   , edge));
   IFVERBOSE(2) {
-    item->GetHypothesis()->GetManager().GetSentenceStats().StopTimeManageCubes();
+    hypothesis->GetManager().GetSentenceStats().StopTimeManageCubes();
   }
 }
 
-HypothesisQueueItem*
-BitmapContainer::Dequeue(bool keepValue)
+HypothesisQueueItem
+BitmapContainer::Dequeue()
 {
-  if (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
-
-    if (!keepValue) {
-      m_queue.pop();
-    }
-
-    return item;
-  }
-
-  return NULL;
+  UTIL_THROW_IF2(m_queue.empty(), "Dequeue from an empty cube");
+  HypothesisQueueItem item = m_queue.top();
+  m_queue.pop();
+  return item;
 }
 
-HypothesisQueueItem*
+const HypothesisQueueItem&
 BitmapContainer::Top() const
 {
   return m_queue.top();
@@ -404,7 +395,7 @@ BitmapContainer::AddHypothesis(Hypothesis *hypothesis)
 void
 BitmapContainer::AddBackwardsEdge(BackwardsEdge *edge)
 {
-  m_edges.insert(edge);
+  m_edges.push_back(edge);
 }
 
 void
@@ -437,27 +428,24 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Get the currently best hypothesis from the queue.
-  HypothesisQueueItem *item = Dequeue();
-
-  // If the priority queue is exhausted, we are done and should have exited
-  UTIL_THROW_IF2(item == NULL, "Null object");
+  const HypothesisQueueItem item = Dequeue();
 
   // check we are pulling things off of priority queue in right order
   if (!Empty()) {
-    HypothesisQueueItem *check = Dequeue(true);
-    UTIL_THROW_IF2(item->GetHypothesis()->GetTotalScore() < check->GetHypothesis()->GetTotalScore(),
+    const HypothesisQueueItem &check = Top();
+    UTIL_THROW_IF2(item.GetHypothesis()->GetTotalScore() < check.GetHypothesis()->GetTotalScore(),
                    "Non-monotonic total score: "
-                   << item->GetHypothesis()->GetTotalScore() << " vs. "
-                   << check->GetHypothesis()->GetTotalScore());
+                   << item.GetHypothesis()->GetTotalScore() << " vs. "
+                   << check.GetHypothesis()->GetTotalScore());
   }
 
   // Logging for the criminally insane
   IFVERBOSE(3) {
-    item->GetHypothesis()->PrintHypothesis();
+    item.GetHypothesis()->PrintHypothesis();
   }
 
   // Add best hypothesis to hypothesis stack.
-  const bool newstackentry = m_stack.AddPrune(item->GetHypothesis());
+  const bool newstackentry = m_stack.AddPrune(item.GetHypothesis());
   if (newstackentry)
     m_numStackInsertions++;
 
@@ -466,10 +454,7 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Create new hypotheses for the two successors of the hypothesis just added.
-  item->GetBackwardsEdge()->PushSuccessors(item->GetHypothesisPos(), item->GetTranslationPos());
-
-  // We are done with the queue item, we delete it.
-  delete item;
+  item.GetBackwardsEdge()->PushSuccessors(item.GetHypothesisPos(), item.GetTranslationPos());
 }
 
 void
@@ -33,8 +33,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "WordsBitmap.h"
 
-#include <boost/unordered_set.hpp>
-
 namespace Moses
 {
 
@@ -47,8 +45,10 @@ class QueueItemOrderer;
 class TranslationOptionList;
 
 typedef std::vector< Hypothesis* > HypothesisSet;
-typedef std::set< BackwardsEdge* > BackwardsEdgeSet;
-typedef std::priority_queue< HypothesisQueueItem*, std::vector< HypothesisQueueItem* >, QueueItemOrderer> HypothesisQueue;
+// edges in insertion order, so that expansion does not depend on heap addresses
+typedef std::vector< BackwardsEdge* > BackwardsEdgeSet;
+// queue items are small and held by value, the heap is one flat array per container
+typedef std::priority_queue< HypothesisQueueItem, std::vector< HypothesisQueueItem >, QueueItemOrderer> HypothesisQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Hypothesis Priority Queue Code
@@ -62,8 +62,6 @@ private:
   Hypothesis *m_hypothesis;
   BackwardsEdge *m_edge;
 
-  HypothesisQueueItem();
-
 public:
   HypothesisQueueItem(const size_t hypothesis_pos
                       , const size_t translation_pos
@@ -78,19 +76,19 @@ public:
   ~HypothesisQueueItem() {
   }
 
-  int GetHypothesisPos() {
+  int GetHypothesisPos() const {
     return m_hypothesis_pos;
   }
 
-  int GetTranslationPos() {
+  int GetTranslationPos() const {
     return m_translation_pos;
   }
 
-  Hypothesis *GetHypothesis() {
+  Hypothesis *GetHypothesis() const {
     return m_hypothesis;
   }
 
-  BackwardsEdge *GetBackwardsEdge() {
+  BackwardsEdge *GetBackwardsEdge() const {
     return m_edge;
   }
 };
@@ -99,9 +97,9 @@ public:
 class QueueItemOrderer
 {
 public:
-  bool operator()(HypothesisQueueItem* itemA, HypothesisQueueItem* itemB) const {
-    float scoreA = itemA->GetHypothesis()->GetTotalScore();
-    float scoreB = itemB->GetHypothesis()->GetTotalScore();
+  bool operator()(const HypothesisQueueItem &itemA, const HypothesisQueueItem &itemB) const {
+    float scoreA = itemA.GetHypothesis()->GetTotalScore();
+    float scoreB = itemB.GetHypothesis()->GetTotalScore();
 
     return (scoreA < scoreB);
 
@@ -167,7 +165,9 @@ private:
   const SquareMatrix &m_futurescore;
 
   std::vector< const Hypothesis* > m_hypotheses;
-  boost::unordered_set< int > m_seenPosition;
+  // one bit per (hypothesis, translation) cell, row-major; rows are added
+  // only as the search reaches them
+  std::vector< bool > m_seenPosition;
 
   // We don't want to instantiate "empty" objects.
   BackwardsEdge();
@@ -223,8 +223,8 @@ public:
   ~BitmapContainer();
 
   void Enqueue(int hypothesis_pos, int translation_pos, Hypothesis *hypothesis, BackwardsEdge *edge);
-  HypothesisQueueItem *Dequeue(bool keepValue=false);
-  HypothesisQueueItem *Top() const;
+  HypothesisQueueItem Dequeue();
+  const HypothesisQueueItem &Top() const;
   size_t Size();
   bool Empty() const;
 
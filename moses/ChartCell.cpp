@@ -20,6 +20,8 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <functional>
+#include <queue>
 #include "ChartCell.h"
 #include "ChartCellCollection.h"
 #include "HypergraphOutput.h"
@@ -31,6 +33,7 @@
 #include "ChartTranslationOptions.h"
 #include "ChartTranslationOptionList.h"
 #include "ChartManager.h"
+#include "ThreadPool.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -84,6 +87,47 @@ void ChartCell::PruneToSize()
  * \param transOptList list of applicable rules to create hypotheses for the cell
  * \param allChartCells entire chart - needed to look up underlying hypotheses
  */
+#ifdef WITH_THREADS
+namespace
+{
+//! scores the first item of a slice of rule cubes on a pool thread
+class RuleCubeEvaluationTask : public Task
+{
+public:
+  RuleCubeEvaluationTask(const std::vector<RuleCube*> &cubes, size_t begin, size_t end)
+    : m_cubes(cubes), m_begin(begin), m_end(end), m_done(false) {}
+
+  void Run() {
+    try {
+      for (size_t i = m_begin; i < m_end; ++i) {
+        m_cubes[i]->EvaluatePending();
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  //! returns the error message if scoring threw
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
+  }
+
+private:
+  const std::vector<RuleCube*> &m_cubes;
+  size_t m_begin, m_end;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+} // namespace
+#endif
+
 void ChartCell::Decode(const ChartTranslationOptionList &transOptList
                        , const ChartCellCollection &allChartCells)
 {
@@ -92,19 +136,98 @@ void ChartCell::Decode(const ChartTranslationOptionList &transOptList
   // priority queue for applicable rules with selected hypotheses
   RuleCubeQueue queue(m_manager);
 
-  // add all trans opt into queue. using only 1st child node.
-  for (size_t i = 0; i < transOptList.GetSize(); ++i) {
-    const ChartTranslationOptions &transOpt = transOptList.Get(i);
-    RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager);
-    queue.Add(ruleCube);
+#ifdef WITH_THREADS
+  // Scoring the first hypothesis of every rule cube dominates on long
+  // sentences, and each cube is independent. Hypotheses are still created
+  // here, in order, so that hypothesis ids do not depend on the schedule.
+  ThreadPool *pool = m_manager.GetCubeThreadPool();
+  if (pool && transOptList.GetSize() > 1 && !staticData.GetCubePruningLazyScoring()) {
+    std::vector<RuleCube*> cubes;
+    cubes.reserve(transOptList.GetSize());
+    for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+      cubes.push_back(new RuleCube(transOptList.Get(i), allChartCells, m_manager, false));
+    }
+
+    const size_t numTasks = std::min(cubes.size(), staticData.GetCubePruningThreads() * 4);
+    std::vector<boost::shared_ptr<RuleCubeEvaluationTask> > tasks;
+    for (size_t t = 0; t < numTasks; ++t) {
+      tasks.push_back(boost::shared_ptr<RuleCubeEvaluationTask>(
+                        new RuleCubeEvaluationTask(cubes, cubes.size() * t / numTasks,
+                            cubes.size() * (t + 1) / numTasks)));
+      pool->Submit(tasks.back());
+    }
+    // wait for every task before reporting, they all reference cubes
+    std::string error;
+    for (size_t t = 0; t < numTasks; ++t) {
+      const std::string &taskError = tasks[t]->Wait();
+      if (error.empty()) error = taskError;
+    }
+    UTIL_THROW_IF2(!error.empty(), error);
+
+    for (size_t i = 0; i < cubes.size(); ++i) {
+      queue.Add(cubes[i]);
+    }
+  } else
+#endif
+  {
+    // add all trans opt into queue. using only 1st child node.
+    for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+      const ChartTranslationOptions &transOpt = transOptList.Get(i);
+      RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager);
+      queue.Add(ruleCube);
+    }
   }
 
   // pluck things out of queue and add to hypo collection
-  const size_t popLimit = staticData.GetCubePruningPopLimit();
-  for (size_t numPops = 0; numPops < popLimit && !queue.IsEmpty(); ++numPops) {
+  const size_t popLimit = m_manager.TightenLimit(staticData.GetCubePruningPopLimit());
+  const float earlyStop = staticData.GetCubePruningEarlyStop();
+  size_t numPops = 0;
+  if (earlyStop < 0) {
+    for (; numPops < popLimit && !queue.IsEmpty(); ++numPops) {
+      ChartHypothesis *hypo = queue.Pop();
+      AddHypothesis(hypo);
+    }
+    m_manager.GetSentenceStats().AddPopped(numPops);
+    VERBOSE(3, "Cell " << m_coverage << ": " << numPops << " pops of " << popLimit << std::endl);
+    return;
+  }
+
+  // Early stopping: once the cell has k hypotheses (k the stack size) and
+  // the best remaining estimate is more than earlyStop below the k-th best,
+  // further pops rarely survive pruning. Cubes are then only popped if their
+  // label has fewer than cube-pruning-diversity hypotheses, the others are
+  // dropped without being expanded.
+  const size_t beamSize = m_manager.TightenLimit(staticData.GetMaxHypoStackSize());
+  const size_t diversity = staticData.GetCubePruningDiversity();
+  std::priority_queue<float, std::vector<float>, std::greater<float> > bestScores; // the k best so far
+  std::vector<size_t> popsByLabel; // by id of the left hand side
+  bool stopped = false;
+  while (numPops < popLimit && !queue.IsEmpty()) {
+    const size_t label = queue.GetTopLabel()[0]->GetId();
+    if (label >= popsByLabel.size()) {
+      popsByLabel.resize(label + 1, 0);
+    }
+    if (beamSize && bestScores.size() >= beamSize
+        && queue.GetTopScore() < bestScores.top() - earlyStop) {
+      stopped = true;
+      if (popsByLabel[label] >= diversity) {
+        queue.DiscardTop();
+        continue;
+      }
+    }
+
     ChartHypothesis *hypo = queue.Pop();
+    ++numPops;
+    ++popsByLabel[label];
+    bestScores.push(hypo->GetTotalScore());
+    if (bestScores.size() > beamSize) {
+      bestScores.pop();
+    }
     AddHypothesis(hypo);
   }
+  m_manager.GetSentenceStats().AddPopped(numPops);
+  VERBOSE(3, "Cell " << m_coverage << ": " << numPops << " pops of " << popLimit
+          << (stopped ? " (stopped early)" : "") << std::endl);
 }
 
 //! call SortHypotheses() in each hypo collection in this cell
@@ -197,7 +320,7 @@ const HypoList *ChartCell::GetAllSortedHypotheses() const
 }
 
 //! call WriteSearchGraph() for each hypo collection
-void ChartCell::WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::map<unsigned, bool> &reachable) const
+void ChartCell::WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::vector<bool> &reachable) const
 {
   MapType::const_iterator iterOutside;
   for (iterOutside = m_hypoColl.begin(); iterOutside != m_hypoColl.end(); ++iterOutside) {
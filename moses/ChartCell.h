@@ -125,7 +125,7 @@ public:
     return m_coverage < compare.m_coverage;
   }
 
-  void WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::map<unsigned,bool> &reachable) const;
+  void WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::vector<bool> &reachable) const;
 
 };
 
@@ -29,8 +29,7 @@ namespace Moses
 ChartCellCollectionBase::~ChartCellCollectionBase()
 {
   m_source.clear();
-  for (std::vector<std::vector<ChartCellBase*> >::iterator i = m_cells.begin(); i != m_cells.end(); ++i)
-    RemoveAllInColl(*i);
+  RemoveAllInColl(m_cells);
 }
 
 class CubeCellFactory
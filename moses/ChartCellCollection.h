@@ -35,20 +35,19 @@ class ChartCellCollectionBase
 {
 public:
   template <class Factory> ChartCellCollectionBase(const InputType &input, const Factory &factory) :
-    m_cells(input.GetSize()) {
+    m_size(input.GetSize()) {
 
     size_t size = input.GetSize();
+    m_cells.reserve(size * (size + 1) / 2);
     for (size_t startPos = 0; startPos < size; ++startPos) {
-      std::vector<ChartCellBase*> &inner = m_cells[startPos];
-      inner.reserve(size - startPos);
       for (size_t endPos = startPos; endPos < size; ++endPos) {
-        inner.push_back(factory(startPos, endPos));
+        m_cells.push_back(factory(startPos, endPos));
       }
       /* Hack: ChartCellLabel shouldn't need to know its span, but the parser
        * gets it from there :-(.  The span is actually stored as a reference,
        * which needs to point somewhere, so I have it refer to the ChartCell.
        */
-      const WordsRange &range = inner[0]->GetCoverage();
+      const WordsRange &range = m_cells[GetIndex(startPos, startPos)]->GetCoverage();
 
       m_source.push_back(new ChartCellLabel(range, input.GetWord(startPos)));
     }
@@ -58,11 +57,11 @@ public:
 
 
   const ChartCellBase &GetBase(const WordsRange &coverage) const {
-    return *m_cells[coverage.GetStartPos()][coverage.GetEndPos() - coverage.GetStartPos()];
+    return *m_cells[GetIndex(coverage.GetStartPos(), coverage.GetEndPos())];
   }
 
   ChartCellBase &MutableBase(const WordsRange &coverage) {
-    return *m_cells[coverage.GetStartPos()][coverage.GetEndPos() - coverage.GetStartPos()];
+    return *m_cells[GetIndex(coverage.GetStartPos(), coverage.GetEndPos())];
   }
 
 
@@ -71,7 +70,13 @@ public:
   }
 
 private:
-  std::vector<std::vector<ChartCellBase*> > m_cells;
+  //! position of span [startPos, endPos] in the row-major upper triangle
+  size_t GetIndex(size_t startPos, size_t endPos) const {
+    return startPos * m_size - startPos * (startPos - 1) / 2 + (endPos - startPos);
+  }
+
+  size_t m_size;
+  std::vector<ChartCellBase*> m_cells; /**< all spans in a flat triangular array, see GetIndex() */
 
   boost::ptr_vector<ChartCellLabel> m_source;
 
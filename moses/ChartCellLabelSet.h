@@ -27,6 +27,9 @@
 #include <boost/unordered_map.hpp>
 #include <boost/version.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace Moses
 {
 
@@ -46,8 +49,7 @@ public:
 
   ChartCellLabelSet(const WordsRange &coverage)
     : m_coverage(coverage)
-    , m_map(FactorCollection::Instance().GetNumNonTerminals(), NULL)
-    , m_size(0) { }
+    , m_map(FactorCollection::Instance().GetNumNonTerminals(), NULL) { }
 
   ~ChartCellLabelSet() {
     RemoveAllInColl(m_map);
@@ -71,10 +73,7 @@ public:
   void AddWord(const Word &w) {
     size_t idx = w[0]->GetId();
     if (! ChartCellExists(idx)) {
-      m_size++;
-
-
-      m_map[idx] = new ChartCellLabel(m_coverage, w);
+      Insert(idx, new ChartCellLabel(m_coverage, w));
     }
   }
 
@@ -87,61 +86,57 @@ public:
     } else {
       ChartCellLabel::Stack s;
       s.cube = stack;
-      m_size++;
-      m_map[idx] = new ChartCellLabel(m_coverage, w, s);
+      Insert(idx, new ChartCellLabel(m_coverage, w, s));
     }
   }
 
   // grow vector if necessary
   bool ChartCellExists(size_t idx) {
-    try {
-      if (m_map.at(idx) != NULL) {
-        return true;
-      }
-    } catch (const std::out_of_range& oor) {
-      m_map.resize(FactorCollection::Instance().GetNumNonTerminals(), NULL);
+    if (idx >= m_map.size()) {
+      m_map.resize(std::max(idx + 1, FactorCollection::Instance().GetNumNonTerminals()), NULL);
+      return false;
     }
-    return false;
+    return m_map[idx] != NULL;
   }
 
   bool Empty() const {
-    return m_size == 0;
+    return m_labelIds.empty();
   }
 
   size_t GetSize() const {
-    return m_size;
+    return m_labelIds.size();
+  }
+
+  //! non-terminal ids of the labels in this set, in order of insertion
+  const std::vector<size_t> &GetLabelIds() const {
+    return m_labelIds;
   }
 
   const ChartCellLabel *Find(const Word &w) const {
-    size_t idx = w[0]->GetId();
-    try {
-      return m_map.at(idx);
-    } catch (const std::out_of_range& oor) {
-      return NULL;
-    }
+    return Find(w[0]->GetId());
   }
 
   const ChartCellLabel *Find(size_t idx) const {
-    try {
-      return m_map.at(idx);
-    } catch (const std::out_of_range& oor) {
-      return NULL;
-    }
+    return idx < m_map.size() ? m_map[idx] : NULL;
   }
 
   ChartCellLabel::Stack &FindOrInsert(const Word &w) {
     size_t idx = w[0]->GetId();
     if (! ChartCellExists(idx)) {
-      m_size++;
-      m_map[idx] = new ChartCellLabel(m_coverage, w);
+      Insert(idx, new ChartCellLabel(m_coverage, w));
     }
     return m_map[idx]->MutableStack();
   }
 
 private:
+  void Insert(size_t idx, ChartCellLabel *label) {
+    m_map[idx] = label;
+    m_labelIds.push_back(idx);
+  }
+
   const WordsRange &m_coverage;
-  MapType m_map;
-  size_t m_size;
+  MapType m_map; /**< indexed by non-terminal id, NULL where there is no label */
+  std::vector<size_t> m_labelIds;
 };
 
 }
@@ -31,15 +31,36 @@
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
+#include "DecodeProfile.h"
 
 using namespace std;
 
 namespace Moses
 {
 
-#ifdef USE_HYPO_POOL
-ObjectPool<ChartHypothesis> ChartHypothesis::s_objectPool("ChartHypothesis", 300000);
-#endif
+ChartHypothesis *ChartHypothesis::Create(const ChartTranslationOptions &transOpt,
+                                         const RuleCubeItem &item,
+                                         ChartManager &manager)
+{
+  ChartHypothesis *ptr = manager.GetHypothesisPool().getPtr();
+  return new(ptr) ChartHypothesis(transOpt, item, manager);
+}
+
+ChartHypothesis *ChartHypothesis::Create(const ChartHypothesis &pred,
+                                         const ChartKBestExtractor &extractor)
+{
+  ChartHypothesis *ptr = pred.m_manager.GetHypothesisPool().getPtr();
+  return new(ptr) ChartHypothesis(pred, extractor);
+}
+
+/** Hypotheses live in the object pool of the ChartManager of the sentence.
+ * They are destroyed lazily, either when their slot is reused or when the
+ * manager goes away, which releases all of them at once.
+ */
+void ChartHypothesis::Delete(ChartHypothesis *hypo)
+{
+  hypo->m_manager.GetHypothesisPool().freeObject(hypo);
+}
 
 /** Create a hypothesis from a rule
  * \param transOpt wrapper around the rule
@@ -218,6 +239,7 @@ void ChartHypothesis::EvaluateWhenApplied()
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *sfs[i] )) {
+      DecodeProfile::Scope scope(*sfs[i], DecodeProfile::WhenApplied);
       sfs[i]->EvaluateWhenApplied(*this,&m_currScoreBreakdown);
     }
   }
@@ -226,6 +248,7 @@ void ChartHypothesis::EvaluateWhenApplied()
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *ffs[i] )) {
+      DecodeProfile::Scope scope(*ffs[i], DecodeProfile::WhenApplied);
       m_ffStates[i] = ffs[i]->EvaluateWhenApplied(*this,i,&m_currScoreBreakdown);
     }
   }
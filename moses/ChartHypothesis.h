@@ -49,10 +49,6 @@ class ChartHypothesis
 //  friend class ChartKBestExtractor;
 
 protected:
-#ifdef USE_HYPO_POOL
-  static ObjectPool<ChartHypothesis> s_objectPool;
-#endif
-
   boost::shared_ptr<ChartTranslationOption> m_transOpt;
 
   WordsRange					m_currSourceWordsRange;
@@ -81,22 +77,17 @@ protected:
   ChartHypothesis(const ChartHypothesis &copy);
 
 public:
-#ifdef USE_HYPO_POOL
-  void *operator new(size_t /* num_bytes */) {
-    void *ptr = s_objectPool.getPtr();
-    return ptr;
-  }
+  //! create a hypothesis in the object pool of \param manager
+  static ChartHypothesis *Create(const ChartTranslationOptions &transOpt,
+                                 const RuleCubeItem &item,
+                                 ChartManager &manager);
 
-  //! delete \param hypo. Works with object pool too
-  static void Delete(ChartHypothesis *hypo) {
-    s_objectPool.freeObject(hypo);
-  }
-#else
-  //! delete \param hypo. Works with object pool too
-  static void Delete(ChartHypothesis *hypo) {
-    delete hypo;
-  }
-#endif
+  //! only used by ChartKBestExtractor
+  static ChartHypothesis *Create(const ChartHypothesis &pred,
+                                 const ChartKBestExtractor &extractor);
+
+  //! return \param hypo to the object pool of its manager
+  static void Delete(ChartHypothesis *hypo);
 
   ChartHypothesis(const ChartTranslationOptions &, const RuleCubeItem &item,
                   ChartManager &manager);
@@ -192,8 +192,9 @@ void ChartHypothesisCollection::Remove(const HCType::iterator &iter)
 void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
 {
   if (m_maxHypoStackSize == 0) return; // no limit
+  const size_t maxHypoStackSize = manager.TightenLimit(m_maxHypoStackSize);
 
-  if (GetSize() > m_maxHypoStackSize) { // ok, if not over the limit
+  if (GetSize() > maxHypoStackSize) { // ok, if not over the limit
     priority_queue<float> bestScores;
 
     // push all scores to a heap
@@ -211,7 +212,7 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
 
     // pop the top newSize scores (and ignore them, these are the scores of hyps that will remain)
     //  ensure to never pop beyond heap size
-    size_t minNewSizeHeapSize = m_maxHypoStackSize > bestScores.size() ? bestScores.size() : m_maxHypoStackSize;
+    size_t minNewSizeHeapSize = maxHypoStackSize > bestScores.size() ? bestScores.size() : maxHypoStackSize;
     for (size_t i = 1 ; i < minNewSizeHeapSize ; i++)
       bestScores.pop();
 
@@ -243,7 +244,7 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
     }
 
     // desperation pruning
-    if (m_hypos.size() > m_maxHypoStackSize * 2) {
+    if (m_hypos.size() > maxHypoStackSize * 2) {
       std::vector<ChartHypothesis*> hyposOrdered;
 
       // sort hypos
@@ -252,7 +253,7 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
 
       //keep only |size|. delete the rest
       std::vector<ChartHypothesis*>::iterator iter;
-      for (iter = hyposOrdered.begin() + (m_maxHypoStackSize * 2); iter != hyposOrdered.end(); ++iter) {
+      for (iter = hyposOrdered.begin() + (maxHypoStackSize * 2); iter != hyposOrdered.end(); ++iter) {
         ChartHypothesis *hypo = *iter;
         HCType::iterator iterFindHypo = m_hypos.find(hypo);
         UTIL_THROW_IF2(iterFindHypo == m_hypos.end(),
@@ -292,9 +293,9 @@ void ChartHypothesisCollection::CleanupArcList()
  * @todo this is a useful function. Make sure it outputs everything required, especially scores.
  * \param translationId unique, contiguous id for the input sentence
  * \param outputSearchGraphStream stream to output the info to
- * \param reachable @todo don't know
+ * \param reachable which hypotheses to write, by id
  */
-void ChartHypothesisCollection::WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::map<unsigned, bool> &reachable) const
+void ChartHypothesisCollection::WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::vector<bool> &reachable) const
 {
   writer.WriteHypos(*this,reachable);
 }
@@ -119,7 +119,7 @@ public:
     return m_bestScore;
   }
 
-  void WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::map<unsigned,bool> &reachable) const;
+  void WriteSearchGraph(const ChartSearchGraphWriter& writer, const std::vector<bool> &reachable) const;
 
 };
 
@@ -23,8 +23,9 @@
 #include "ScoreComponentCollection.h"
 #include "StaticData.h"
 
-#include <boost/scoped_ptr.hpp>
+#include <boost/make_shared.hpp>
 
+#include <set>
 #include <vector>
 
 using namespace std;
@@ -35,7 +36,7 @@ namespace Moses
 // Extract the k-best list from the search graph.
 void ChartKBestExtractor::Extract(
   const std::vector<const ChartHypothesis*> &topLevelHypos, std::size_t k,
-  KBestVec &kBestList)
+  KBestVec &kBestList, bool onlyDistinct, std::size_t maxDerivations)
 {
   kBestList.clear();
   if (topLevelHypos.empty()) {
@@ -46,8 +47,8 @@ void ChartKBestExtractor::Extract(
   // top-level hypothesis as its predecessor and has the same score.
   std::vector<const ChartHypothesis*>::const_iterator p = topLevelHypos.begin();
   const ChartHypothesis &bestTopLevelHypo = **p;
-  boost::scoped_ptr<ChartHypothesis> supremeHypo(
-    new ChartHypothesis(bestTopLevelHypo, *this));
+  ChartHypothesis *supremeHypo =
+    ChartHypothesis::Create(bestTopLevelHypo, *this);
 
   // Do the same for each alternative top-level hypothesis, but add the new
   // ChartHypothesis objects as arcs from supremeHypo, as if they had been
@@ -58,25 +59,46 @@ void ChartKBestExtractor::Extract(
                    "top-level hypotheses are not correctly sorted");
     // Note: there's no need for a smart pointer here: supremeHypo will take
     // ownership of altHypo.
-    ChartHypothesis *altHypo = new ChartHypothesis(**p, *this);
+    ChartHypothesis *altHypo = ChartHypothesis::Create(**p, *this);
     supremeHypo->AddArc(altHypo);
   }
 
-  // Create the target vertex then lazily fill its k-best list.
+  // Create the target vertex.
   boost::shared_ptr<Vertex> targetVertex = FindOrCreateVertex(*supremeHypo);
-  LazyKthBest(*targetVertex, k, k);
-
-  // Copy the k-best list from the target vertex, but drop the top edge from
-  // each derivation.
-  kBestList.reserve(targetVertex->kBestList.size());
-  for (std::vector<boost::weak_ptr<Derivation> >::const_iterator
-       q = targetVertex->kBestList.begin();
-       q != targetVertex->kBestList.end(); ++q) {
-    const boost::shared_ptr<Derivation> d(*q);
-    assert(d);
-    assert(d->subderivations.size() == 1);
-    kBestList.push_back(d->subderivations[0]);
+
+  if (!onlyDistinct) {
+    // Lazily fill the target vertex's k-best list then copy it, but drop the
+    // top edge from each derivation.
+    LazyKthBest(*targetVertex, k, k);
+    kBestList.reserve(targetVertex->kBestList.size());
+    for (std::vector<boost::weak_ptr<Derivation> >::const_iterator
+         q = targetVertex->kBestList.begin();
+         q != targetVertex->kBestList.end(); ++q) {
+      const boost::shared_ptr<Derivation> d(*q);
+      assert(d);
+      assert(d->subderivations.size() == 1);
+      kBestList.push_back(d->subderivations[0]);
+    }
+  } else {
+    // Grow the target vertex's k-best list one derivation at a time and stop
+    // as soon as there are k distinct translations.
+    const std::size_t limit = (maxDerivations == 0) ? k*1000 : maxDerivations;
+    std::set<Phrase> distinct;
+    for (std::size_t i = 0; kBestList.size() < k && i < limit; ++i) {
+      LazyKthBest(*targetVertex, i+1, limit);
+      if (targetVertex->kBestList.size() <= i) {
+        break;  // derivations have been exhausted.
+      }
+      const boost::shared_ptr<Derivation> d(targetVertex->kBestList[i]);
+      assert(d);
+      assert(d->subderivations.size() == 1);
+      if (distinct.insert(GetOutputPhrase(*d->subderivations[0])).second) {
+        kBestList.push_back(d->subderivations[0]);
+      }
+    }
   }
+
+  ChartHypothesis::Delete(supremeHypo);
 }
 
 // Generate the target-side yield of the derivation d.
@@ -201,7 +223,7 @@ ChartKBestExtractor::FindOrCreateVertex(const ChartHypothesis &h)
   if (!p.second) {
     return sp;  // Vertex was already in m_vertexMap.
   }
-  sp.reset(new Vertex(h));
+  sp = boost::make_shared<Vertex>(h);
   // Create the 1-best derivation and add it to the vertex's kBestList.
   UnweightedHyperarc bestEdge;
   bestEdge.head = sp;
@@ -211,7 +233,8 @@ ChartKBestExtractor::FindOrCreateVertex(const ChartHypothesis &h)
     const ChartHypothesis *prevHypo = prevHypos[i];
     bestEdge.tail[i] = FindOrCreateVertex(*prevHypo);
   }
-  boost::shared_ptr<Derivation> bestDerivation(new Derivation(bestEdge));
+  boost::shared_ptr<Derivation> bestDerivation =
+    boost::make_shared<Derivation>(bestEdge);
 #ifndef NDEBUG
   std::pair<DerivationSet::iterator, bool> q =
 #endif
@@ -286,7 +309,7 @@ void ChartKBestExtractor::LazyNext(Vertex &v, const Derivation &d,
       continue;
     }
     // Create the neighbour.
-    boost::shared_ptr<Derivation> next(new Derivation(d, i));
+    boost::shared_ptr<Derivation> next = boost::make_shared<Derivation>(d, i);
     // Check if it has been created before.
     std::pair<DerivationSet::iterator, bool> p = m_derivations.insert(next);
     if (p.second) {
@@ -85,9 +85,12 @@ public:
   typedef std::vector<boost::shared_ptr<Derivation> > KBestVec;
 
   // Extract the k-best list from the search hypergraph given the full, sorted
-  // list of top-level vertices.
+  // list of top-level vertices.  If onlyDistinct is set then derivations with
+  // a repeated target string are skipped, visiting at most maxDerivations
+  // derivations (0 means no limit) to find k distinct ones.
   void Extract(const std::vector<const ChartHypothesis*> &topHypos,
-               std::size_t k, KBestVec &);
+               std::size_t k, KBestVec &, bool onlyDistinct = false,
+               std::size_t maxDerivations = 0);
 
   static Phrase GetOutputPhrase(const Derivation &);
   static boost::shared_ptr<ScoreComponentCollection> GetOutputScoreBreakdown(const Derivation &);
@@ -28,12 +28,15 @@
 #include "HypergraphOutput.h"
 #include "StaticData.h"
 #include "DecodeStep.h"
+#include "Timer.h"
 #include "TreeInput.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/WordPenaltyProducer.h"
 #include "moses/OutputCollector.h"
 #include "moses/ChartKBestExtractor.h"
 #include "moses/HypergraphOutput.h"
+#include "moses/ThreadPool.h"
+#include "util/usage.hh"
 
 using namespace std;
 
@@ -47,16 +50,47 @@ extern bool g_mosesDebug;
  */
 ChartManager::ChartManager(InputType const& source)
   :BaseManager(source)
+  ,m_hypothesisPool("ChartHypothesis", 1000)
   ,m_hypoStackColl(source, *this)
   ,m_start(clock())
   ,m_hypothesisId(0)
   ,m_parser(source, m_hypoStackColl)
   ,m_translationOptionList(StaticData::Instance().GetRuleLimit(), source)
 {
+  // the weight setting and own weights of the input
+  // (with threads this only affects the decoding thread)
+  StaticData::Instance().SelectWeights(source);
+
+#ifdef WITH_THREADS
+  const size_t threads = StaticData::Instance().GetCubePruningThreads();
+  // the weight setting is selected per thread, the pool wouldn't see it
+  if (threads > 1 && !StaticData::Instance().GetHasAlternateWeightSettings()
+      && !source.GetRequestWeights()) {
+    bool threadSafe = true;
+    const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+    for (size_t i = 0; i < ffs.size(); ++i) {
+      if (!ffs[i]->CanEvaluateOnAnyThread()) {
+        VERBOSE(2, ffs[i]->GetScoreProducerDescription()
+                << " must be evaluated on the decoding thread, not using cube-pruning-threads" << endl);
+        threadSafe = false;
+        break;
+      }
+    }
+    if (threadSafe) {
+      m_cubeThreads.reset(new ThreadPool(threads));
+    }
+  }
+#endif
 }
 
 ChartManager::~ChartManager()
 {
+#ifdef WITH_THREADS
+  if (m_cubeThreads) {
+    m_cubeThreads->Stop();
+  }
+#endif
+
   clock_t end = clock();
   float et = (end - m_start);
   et /= (float)CLOCKS_PER_SEC;
@@ -84,12 +118,15 @@ void ChartManager::Decode()
       WordsRange range(startPos, endPos);
 
       // create trans opt
+      double start = util::WallTime();
       m_translationOptionList.Clear();
       m_parser.Create(range, m_translationOptionList);
       m_translationOptionList.ApplyThreshold();
 
       const InputPath &inputPath = m_parser.GetInputPath(range);
       m_translationOptionList.EvaluateWithSourceContext(m_source, inputPath);
+      double collected = util::WallTime();
+      m_optionsTime += collected - start;
 
       // decode
       ChartCell &cell = m_hypoStackColl.Get(range);
@@ -99,11 +136,13 @@ void ChartManager::Decode()
       cell.PruneToSize();
       cell.CleanupArcList();
       cell.SortHypotheses();
+      m_searchTime += util::WallTime() - collected;
     }
   }
 
   IFVERBOSE(1) {
 
+    cerr << "Hypotheses popped: " << GetSentenceStats().GetNumHyposPopped() << endl;
     for (size_t startPos = 0; startPos < size; ++startPos) {
       cerr.width(3);
       cerr << startPos << " ";
@@ -144,7 +183,7 @@ void ChartManager::AddXmlChartOptions()
     const WordsRange &range = opt->GetSourceWordsRange();
 
     RuleCubeItem* item = new RuleCubeItem( *opt, m_hypoStackColl );
-    ChartHypothesis* hypo = new ChartHypothesis(*opt, *item, *this);
+    ChartHypothesis* hypo = ChartHypothesis::Create(*opt, *item, *this);
     hypo->EvaluateWhenApplied();
 
 
@@ -194,36 +233,20 @@ void ChartManager::CalcNBest(
 
   ChartKBestExtractor extractor;
 
-  if (!onlyDistinct) {
-    // Return the n-best list as is, including duplicate translations.
-    extractor.Extract(*topLevelHypos, n, nBestList);
-    return;
-  }
-
   // Determine how many derivations to extract.  If the n-best list is
   // restricted to distinct translations then this limit should be bigger
   // than n.  The n-best factor determines how much bigger the limit should be,
   // with 0 being 'unlimited.'  This actually sets a large-ish limit in case
   // too many translations are identical.
-  const StaticData &staticData = StaticData::Instance();
-  const std::size_t nBestFactor = staticData.GetNBestFactor();
-  std::size_t numDerivations = (nBestFactor == 0) ? n*1000 : n*nBestFactor;
-
-  // Extract the derivations.
-  ChartKBestExtractor::KBestVec bigList;
-  bigList.reserve(numDerivations);
-  extractor.Extract(*topLevelHypos, numDerivations, bigList);
-
-  // Copy derivations into nBestList, skipping ones with repeated translations.
-  std::set<Phrase> distinct;
-  for (ChartKBestExtractor::KBestVec::const_iterator p = bigList.begin();
-       nBestList.size() < n && p != bigList.end(); ++p) {
-    boost::shared_ptr<ChartKBestExtractor::Derivation> derivation = *p;
-    Phrase translation = ChartKBestExtractor::GetOutputPhrase(*derivation);
-    if (distinct.insert(translation).second) {
-      nBestList.push_back(derivation);
-    }
+  std::size_t numDerivations = n;
+  if (onlyDistinct) {
+    const std::size_t nBestFactor = StaticData::Instance().GetNBestFactor();
+    numDerivations = (nBestFactor == 0) ? n*1000 : n*nBestFactor;
   }
+
+  // Extract the derivations, skipping ones with repeated translations if
+  // onlyDistinct is set.
+  extractor.Extract(*topLevelHypos, n, nBestList, onlyDistinct, numDerivations);
 }
 
 void ChartManager::WriteSearchGraph(const ChartSearchGraphWriter& writer) const
@@ -232,7 +255,7 @@ void ChartManager::WriteSearchGraph(const ChartSearchGraphWriter& writer) const
   size_t size = m_source.GetSize();
 
   // which hypotheses are reachable?
-  std::map<unsigned,bool> reachable;
+  std::vector<bool> reachable(m_hypothesisId, false); // by hypothesis id
   WordsRange fullRange(0, size-1);
   const ChartCell &lastCell = m_hypoStackColl.Get(fullRange);
   const ChartHypothesis *hypo = lastCell.GetBestHypothesis();
@@ -260,10 +283,10 @@ void ChartManager::WriteSearchGraph(const ChartSearchGraphWriter& writer) const
 }
 
 void ChartManager::FindReachableHypotheses(
-  const ChartHypothesis *hypo, std::map<unsigned,bool> &reachable, size_t* winners, size_t* losers) const
+  const ChartHypothesis *hypo, std::vector<bool> &reachable, size_t* winners, size_t* losers) const
 {
   // do not recurse, if already visited
-  if (reachable.find(hypo->GetId()) != reachable.end()) {
+  if (reachable[hypo->GetId()]) {
     return;
   }
 
@@ -290,10 +313,15 @@ void ChartManager::FindReachableHypotheses(
   }
 }
 
-void ChartManager::OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream) const
+void ChartManager::OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream, bool binary) const
 {
-  ChartSearchGraphWriterHypergraph writer(&outputSearchGraphStream);
-  WriteSearchGraph(writer);
+  if (binary) {
+    ChartSearchGraphWriterBinaryHypergraph writer(&outputSearchGraphStream);
+    WriteSearchGraph(writer);
+  } else {
+    ChartSearchGraphWriterHypergraph writer(&outputSearchGraphStream);
+    WriteSearchGraph(writer);
+  }
 }
 
 void ChartManager::OutputSearchGraphMoses(std::ostream &outputSearchGraphStream) const
@@ -321,7 +349,11 @@ void ChartManager::OutputNBest(OutputCollector *collector) const
 
     VERBOSE(2,"WRITING " << nBestSize << " TRANSLATION ALTERNATIVES TO " << staticData.GetNBestFilePath() << endl);
     std::vector<boost::shared_ptr<ChartKBestExtractor::Derivation> > nBestList;
+    Timer nBestTime;
+    nBestTime.start();
     CalcNBest(nBestSize, nBestList,staticData.GetDistinctNBest());
+    VERBOSE(1, "Line " << translationId << ": Extracting " << nBestList.size()
+            << "-best list took " << nBestTime << " seconds" << endl);
     OutputNBestList(collector, nBestList, translationId);
     IFVERBOSE(2) {
       PrintUserTime("N-Best Hypotheses Generation Time:");
@@ -31,21 +31,25 @@
 #include "ChartParser.h"
 #include "ChartKBestExtractor.h"
 #include "BaseManager.h"
+#include "ObjectPool.h"
 #include "moses/Syntax/KBestExtractor.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace Moses
 {
 
 class ChartHypothesis;
 class ChartSearchGraphWriter;
+class ThreadPool;
 
 /** Holds everything you need to decode 1 sentence with the hierachical/syntax decoder
  */
 class ChartManager : public BaseManager
 {
 private:
+  ObjectPool<ChartHypothesis> m_hypothesisPool; /**< storage for all hypotheses of this sentence, released at once */
   ChartCellCollection m_hypoStackColl;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   clock_t m_start; /**< starting time, used for logging */
@@ -54,10 +58,13 @@ private:
   ChartParser m_parser;
 
   ChartTranslationOptionList m_translationOptionList; /**< pre-computed list of translation options for the phrases in this sentence */
+#ifdef WITH_THREADS
+  boost::scoped_ptr<ThreadPool> m_cubeThreads; /**< scores rule cubes within a cell, see -cube-pruning-threads */
+#endif
 
   /* auxilliary functions for SearchGraphs */
   void FindReachableHypotheses(
-    const ChartHypothesis *hypo, std::map<unsigned,bool> &reachable , size_t* winners, size_t* losers) const;
+    const ChartHypothesis *hypo, std::vector<bool> &reachable , size_t* winners, size_t* losers) const;
   void WriteSearchGraph(const ChartSearchGraphWriter& writer) const;
 
   // output
@@ -114,7 +121,7 @@ public:
   void OutputSearchGraphMoses(std::ostream &outputSearchGraphStream) const;
 
   /** Output in (modified) Kenneth hypergraph format */
-  void OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream) const;
+  void OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream, bool binary = false) const;
 
   //! debug data collected when decoding sentence
   SentenceStats& GetSentenceStats() const {
@@ -134,10 +141,23 @@ public:
   }
 
   //! contigious hypo id for each input sentence. For debugging purposes
+  ObjectPool<ChartHypothesis> &GetHypothesisPool() {
+    return m_hypothesisPool;
+  }
+
   unsigned GetNextHypoId() {
     return m_hypothesisId++;
   }
 
+  //! pool for scoring the rule cubes of one cell concurrently, or NULL
+  ThreadPool *GetCubeThreadPool() const {
+#ifdef WITH_THREADS
+    return m_cubeThreads.get();
+#else
+    return NULL;
+#endif
+  }
+
   const ChartParser &GetParser() const {
     return m_parser;
   }
@@ -1,6 +1,7 @@
 #include "ChartTranslationOptions.h"
 #include "InputType.h"
 #include "InputPath.h"
+#include "DecodeProfile.h"
 
 namespace Moses
 {
@@ -18,6 +19,7 @@ void ChartTranslationOption::EvaluateWithSourceContext(const InputType &input,
 
   for (size_t i = 0; i < ffs.size(); ++i) {
     const FeatureFunction &ff = *ffs[i];
+    DecodeProfile::Scope scope(ff, DecodeProfile::WithSourceContext);
     ff.EvaluateWithSourceContext(input, inputPath, m_targetPhrase, &stackVec, m_scoreBreakdown);
   }
 }
@@ -34,16 +34,23 @@ ChartTranslationOptions::ChartTranslationOptions(const TargetPhraseCollection &t
     const WordsRange &wordsRange,
     float score)
   : m_stackVec(stackVec)
+  , m_targetPhraseColl(&targetPhraseColl)
   , m_wordsRange(&wordsRange)
   , m_estimateOfBestScore(score)
 {
+}
+
+void ChartTranslationOptions::CreateTranslationOptions() const
+{
+  m_collection.reserve(m_targetPhraseColl->GetSize());
   TargetPhraseCollection::const_iterator iter;
-  for (iter = targetPhraseColl.begin(); iter != targetPhraseColl.end(); ++iter) {
+  for (iter = m_targetPhraseColl->begin(); iter != m_targetPhraseColl->end(); ++iter) {
     const TargetPhrase *origTP = *iter;
 
     boost::shared_ptr<ChartTranslationOption> ptr(new ChartTranslationOption(*origTP));
     m_collection.push_back(ptr);
   }
+  m_targetPhraseColl = NULL;
 }
 
 ChartTranslationOptions::~ChartTranslationOptions()
@@ -65,6 +72,9 @@ public:
 
 void ChartTranslationOptions::EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath)
 {
+  if (m_targetPhraseColl) {
+    CreateTranslationOptions();
+  }
   SetInputPath(&inputPath);
   if (StaticData::Instance().GetPlaceholderFactor() != NOT_FOUND) {
     CreateSourceRuleFromInputPath();
@@ -155,8 +165,9 @@ void ChartTranslationOptions::CreateSourceRuleFromInputPath()
 
 std::ostream& operator<<(std::ostream &out, const ChartTranslationOptions &obj)
 {
-  for (size_t i = 0; i < obj.m_collection.size(); ++i) {
-    const ChartTranslationOption &transOpt = *obj.m_collection[i];
+  const ChartTranslationOptions::CollType &coll = obj.GetTargetPhrases();
+  for (size_t i = 0; i < coll.size(); ++i) {
+    const ChartTranslationOption &transOpt = *coll[i];
     out << transOpt << endl;
   }
 
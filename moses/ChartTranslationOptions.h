@@ -60,7 +60,7 @@ public:
                                        const StackVec &);
 
   size_t GetSize() const {
-    return m_collection.size();
+    return GetTargetPhrases().size();
   }
 
   //! @todo dunno
@@ -70,6 +70,7 @@ public:
 
   //! @todo isn't the translation suppose to just contain 1 target phrase, not a whole collection of them?
   const CollType &GetTargetPhrases() const {
+    if (m_targetPhraseColl) CreateTranslationOptions();
     return m_collection;
   }
 
@@ -95,7 +96,13 @@ public:
 private:
 
   StackVec m_stackVec; //! vector of hypothesis list!
-  CollType m_collection;
+
+  // The options of the target phrases are made when they are first needed,
+  // so the rules that the list prunes on their estimate never get any.
+  mutable const TargetPhraseCollection *m_targetPhraseColl;
+  mutable CollType m_collection;
+
+  void CreateTranslationOptions() const;
 
   const WordsRange *m_wordsRange;
   float m_estimateOfBestScore;
@@ -0,0 +1,103 @@
+#include "ContextScope.h"
+
+#include <utility>
+
+#include "util/usage.hh"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Moses
+{
+
+namespace
+{
+
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<boost::shared_ptr<ContextScope> > &CurrentScope()
+{
+  static boost::thread_specific_ptr<boost::shared_ptr<ContextScope> > current;
+  return current;
+}
+#else
+boost::shared_ptr<ContextScope> s_current;
+#endif
+
+struct Session {
+  boost::shared_ptr<ContextScope> scope;
+  double lastUsed;
+};
+
+std::map<std::string, Session> s_sessions;
+double s_lastSweep = 0;
+#ifdef WITH_THREADS
+boost::mutex s_sessionsMutex;
+#endif
+
+}
+
+void ContextScope::SetContextWeights(const std::map<std::string, float> &weights)
+{
+  boost::shared_ptr<const std::map<std::string, float> > copy(new std::map<std::string, float>(weights));
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  m_contextWeights = copy;
+}
+
+boost::shared_ptr<const std::map<std::string, float> > ContextScope::GetContextWeights() const
+{
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  return m_contextWeights;
+}
+
+boost::shared_ptr<ContextScope> ContextScope::Current()
+{
+#ifdef WITH_THREADS
+  boost::shared_ptr<ContextScope> *current = CurrentScope().get();
+  return current ? *current : boost::shared_ptr<ContextScope>();
+#else
+  return s_current;
+#endif
+}
+
+void ContextScope::SetCurrent(const boost::shared_ptr<ContextScope> &scope)
+{
+#ifdef WITH_THREADS
+  CurrentScope().reset(new boost::shared_ptr<ContextScope>(scope));
+#else
+  s_current = scope;
+#endif
+}
+
+boost::shared_ptr<ContextScope> ContextScope::ForSession(const std::string &id, double timeout)
+{
+  const double now = util::WallTime();
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_sessionsMutex);
+#endif
+  // forget idle sessions, at most once per timeout
+  if (now - s_lastSweep > timeout) {
+    s_lastSweep = now;
+    std::map<std::string, Session>::iterator it = s_sessions.begin();
+    while (it != s_sessions.end()) {
+      if (now - it->second.lastUsed > timeout) {
+        s_sessions.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  Session &session = s_sessions[id];
+  if (!session.scope) {
+    session.scope.reset(new ContextScope);
+  }
+  session.lastUsed = now;
+  return session.scope;
+}
+
+}
@@ -0,0 +1,80 @@
+// -*- c++ -*-
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** State that outlives a sentence: a document of moses-cmd input, or a
+ *  session of the server. Every input of the scope points to it, so
+ *  components keep document-level data here (keyed by their own address)
+ *  instead of in one cache shared by all documents, or one that is cleared
+ *  after every sentence.
+ *
+ *  Sentences of one scope may be decoded at the same time, so whatever is
+ *  kept here must be safe to share between threads.
+ */
+class ContextScope
+{
+public:
+  ContextScope() {}
+
+  //! the data kept for key, NULL if there is none and create is false
+  template<typename T>
+  boost::shared_ptr<T> Get(const void *key, bool create = false) {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+    boost::shared_ptr<void> &entry = m_scratchpad[key];
+    if (!entry && create) {
+      entry.reset(new T);
+    }
+    return boost::static_pointer_cast<T>(entry);
+  }
+
+  template<typename T>
+  void Set(const void *key, const boost::shared_ptr<T> &value) {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+    m_scratchpad[key] = value;
+  }
+
+  //! weights of the documents of the training data that the scope
+  //! resembles, e.g. for biased sampling from a suffix array
+  void SetContextWeights(const std::map<std::string, float> &weights);
+  boost::shared_ptr<const std::map<std::string, float> > GetContextWeights() const;
+
+  //! the scope of the input decoded on this thread, NULL if none; set by
+  //! StaticData::InitializeForInput(), so worker threads of the search
+  //! don't see it
+  static boost::shared_ptr<ContextScope> Current();
+  static void SetCurrent(const boost::shared_ptr<ContextScope> &scope);
+
+  //! the scope of the server session with this id, created if needed;
+  //! sessions not used for timeout seconds are forgotten
+  static boost::shared_ptr<ContextScope> ForSession(const std::string &id, double timeout);
+
+private:
+  std::map<const void*, boost::shared_ptr<void> > m_scratchpad;
+  boost::shared_ptr<const std::map<std::string, float> > m_contextWeights;
+#ifdef WITH_THREADS
+  mutable boost::shared_mutex m_lock;
+#endif
+
+  // not copyable
+  ContextScope(const ContextScope &);
+  void operator=(const ContextScope &);
+};
+
+}
@@ -0,0 +1,265 @@
+#include "DecodeProfile.h"
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/scoped_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
+#include "moses/FF/FeatureFunction.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+bool DecodeProfile::s_enabled = false;
+
+namespace
+{
+const char *kPhaseNames[DecodeProfile::NumPhases] = {
+  "in_isolation", "with_source_context", "when_applied", "lookup"
+};
+
+const char *kOverheadNames[DecodeProfile::NumOverheads] = {
+  "setup", "cleanup"
+};
+
+uint64_t Now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+string Escape(const string &str)
+{
+  string ret;
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] == '"' || str[i] == '\\') ret += '\\';
+    ret += str[i];
+  }
+  return ret;
+}
+
+double Seconds(uint64_t nanoseconds)
+{
+  return nanoseconds * 1e-9;
+}
+
+// process-wide state, touched once per sentence
+#ifdef WITH_THREADS
+boost::mutex s_totalsMutex;
+#endif
+boost::scoped_ptr<ostream> s_out;
+DecodeProfile *s_totals = NULL;
+uint64_t s_sentences = 0;
+double s_seconds = 0;
+}
+
+DecodeProfile::DecodeProfile()
+{
+  Clear();
+}
+
+void DecodeProfile::Enable(const string &path)
+{
+  if (path == "-") {
+    s_out.reset(new ostream(cerr.rdbuf()));
+  } else if (!path.empty()) {
+    ofstream *file = new ofstream(path.c_str());
+    UTIL_THROW_IF2(!*file, "Cannot write profile to " << path);
+    s_out.reset(file);
+  }
+  s_enabled = true;
+}
+
+DecodeProfile &DecodeProfile::Current()
+{
+#ifdef WITH_THREADS
+  static boost::thread_specific_ptr<DecodeProfile> profile;
+  if (profile.get() == NULL) profile.reset(new DecodeProfile);
+  return *profile;
+#else
+  static DecodeProfile profile;
+  return profile;
+#endif
+}
+
+void DecodeProfile::Clear()
+{
+  // all feature functions are known by now, so Scopes never see a reallocation
+  m_entries.assign(FeatureFunction::GetFeatureFunctions().size() * NumPhases, Entry());
+  for (size_t i = 0; i < NumCounters; ++i) {
+    m_counters[i] = 0;
+  }
+  for (size_t i = 0; i < NumOverheads; ++i) {
+    m_overheads[i] = 0;
+  }
+}
+
+void DecodeProfile::Scope::Start(const FeatureFunction &ff, Phase phase)
+{
+  vector<Entry> &entries = Current().m_entries;
+  size_t i = ff.GetIndex() * NumPhases + phase;
+  if (i < entries.size()) {
+    m_entry = &entries[i];
+    m_start = Now();
+  }
+}
+
+void DecodeProfile::Scope::Stop()
+{
+  m_entry->nanoseconds += Now() - m_start;
+  m_entry->calls++;
+}
+
+void DecodeProfile::OverheadScope::Start(Overhead overhead)
+{
+  m_overhead = overhead;
+  m_start = Now();
+}
+
+void DecodeProfile::OverheadScope::Stop()
+{
+  Current().m_overheads[m_overhead] += Now() - m_start;
+}
+
+void DecodeProfile::BeginSentence()
+{
+  if (s_enabled) Current().Clear();
+}
+
+void DecodeProfile::AddTo(DecodeProfile &totals) const
+{
+  if (totals.m_entries.size() < m_entries.size()) {
+    totals.m_entries.resize(m_entries.size());
+  }
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    totals.m_entries[i].calls += m_entries[i].calls;
+    totals.m_entries[i].nanoseconds += m_entries[i].nanoseconds;
+  }
+  for (size_t i = 0; i < NumCounters; ++i) {
+    totals.m_counters[i] += m_counters[i];
+  }
+  for (size_t i = 0; i < NumOverheads; ++i) {
+    totals.m_overheads[i] += m_overheads[i];
+  }
+}
+
+string DecodeProfile::ToJson(long translationId, double seconds) const
+{
+  ostringstream out;
+  out << "{\"id\":" << translationId << ",\"seconds\":" << seconds
+      << ",\"hypotheses\":{\"created\":" << m_counters[HyposCreated]
+      << ",\"recombined\":" << m_counters[HyposRecombined]
+      << ",\"pruned\":" << m_counters[HyposPruned]
+      << ",\"discarded\":" << m_counters[HyposDiscarded]
+      << "},\"caches\":{\"phrase_table\":{\"hits\":" << m_counters[PhraseTableCacheHits]
+      << ",\"misses\":" << m_counters[PhraseTableCacheMisses]
+      << "},\"translation\":{\"hits\":" << m_counters[TranslationCacheHits]
+      << ",\"misses\":" << m_counters[TranslationCacheMisses]
+      << "},\"translation_options\":{\"hits\":" << m_counters[OptionCacheHits]
+      << ",\"misses\":" << m_counters[OptionCacheMisses]
+      << "}},\"overhead\":{";
+  for (size_t i = 0; i < NumOverheads; ++i) {
+    out << (i ? "," : "") << "\"" << kOverheadNames[i] << "\":" << Seconds(m_overheads[i]);
+  }
+  out << "},\"features\":{";
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  bool firstFF = true;
+  for (size_t f = 0; f < ffs.size() && (f + 1) * NumPhases <= m_entries.size(); ++f) {
+    bool first = true;
+    for (size_t p = 0; p < NumPhases; ++p) {
+      const Entry &entry = m_entries[f * NumPhases + p];
+      if (entry.calls == 0) continue;
+      if (first) {
+        out << (firstFF ? "" : ",") << "\"" << Escape(ffs[f]->GetScoreProducerDescription()) << "\":{";
+        firstFF = false;
+      }
+      out << (first ? "" : ",") << "\"" << kPhaseNames[p] << "\":{\"calls\":" << entry.calls
+          << ",\"seconds\":" << Seconds(entry.nanoseconds) << "}";
+      first = false;
+    }
+    if (!first) out << "}";
+  }
+  out << "}}";
+  return out.str();
+}
+
+string DecodeProfile::EndSentence(long translationId, double seconds)
+{
+  if (!s_enabled) return "";
+  const DecodeProfile &profile = Current();
+  string json = profile.ToJson(translationId, seconds);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_totalsMutex);
+#endif
+  if (s_totals == NULL) s_totals = new DecodeProfile;
+  profile.AddTo(*s_totals);
+  s_sentences++;
+  s_seconds += seconds;
+  if (s_out) {
+    *s_out << json << endl;
+  }
+  return json;
+}
+
+string DecodeProfile::GetTotals()
+{
+  ostringstream out;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_totalsMutex);
+#endif
+  out << "# TYPE moses_sentences_total counter\n"
+      << "moses_sentences_total " << s_sentences << "\n"
+      << "# TYPE moses_sentence_seconds_total counter\n"
+      << "moses_sentence_seconds_total " << s_seconds << "\n";
+  if (s_totals == NULL) return out.str();
+
+  const uint64_t *counters = s_totals->m_counters;
+  out << "# TYPE moses_hypotheses_total counter\n"
+      << "moses_hypotheses_total{event=\"created\"} " << counters[HyposCreated] << "\n"
+      << "moses_hypotheses_total{event=\"recombined\"} " << counters[HyposRecombined] << "\n"
+      << "moses_hypotheses_total{event=\"pruned\"} " << counters[HyposPruned] << "\n"
+      << "moses_hypotheses_total{event=\"discarded\"} " << counters[HyposDiscarded] << "\n"
+      << "# TYPE moses_cache_lookups_total counter\n"
+      << "moses_cache_lookups_total{cache=\"phrase_table\",result=\"hit\"} " << counters[PhraseTableCacheHits] << "\n"
+      << "moses_cache_lookups_total{cache=\"phrase_table\",result=\"miss\"} " << counters[PhraseTableCacheMisses] << "\n"
+      << "moses_cache_lookups_total{cache=\"translation\",result=\"hit\"} " << counters[TranslationCacheHits] << "\n"
+      << "moses_cache_lookups_total{cache=\"translation\",result=\"miss\"} " << counters[TranslationCacheMisses] << "\n"
+      << "moses_cache_lookups_total{cache=\"translation_options\",result=\"hit\"} " << counters[OptionCacheHits] << "\n"
+      << "moses_cache_lookups_total{cache=\"translation_options\",result=\"miss\"} " << counters[OptionCacheMisses] << "\n";
+
+  out << "# TYPE moses_sentence_overhead_seconds_total counter\n";
+  for (size_t i = 0; i < NumOverheads; ++i) {
+    out << "moses_sentence_overhead_seconds_total{phase=\"" << kOverheadNames[i] << "\"} "
+        << Seconds(s_totals->m_overheads[i]) << "\n";
+  }
+
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  const vector<Entry> &entries = s_totals->m_entries;
+  ostringstream calls, seconds;
+  for (size_t f = 0; f < ffs.size() && (f + 1) * NumPhases <= entries.size(); ++f) {
+    for (size_t p = 0; p < NumPhases; ++p) {
+      const Entry &entry = entries[f * NumPhases + p];
+      if (entry.calls == 0) continue;
+      string labels = "{feature=\"" + Escape(ffs[f]->GetScoreProducerDescription())
+                      + "\",phase=\"" + kPhaseNames[p] + "\"} ";
+      calls << "moses_feature_calls_total" << labels << entry.calls << "\n";
+      seconds << "moses_feature_seconds_total" << labels << Seconds(entry.nanoseconds) << "\n";
+    }
+  }
+  out << "# TYPE moses_feature_calls_total counter\n" << calls.str()
+      << "# TYPE moses_feature_seconds_total counter\n" << seconds.str();
+  return out.str();
+}
+
+}
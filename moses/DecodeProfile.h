@@ -0,0 +1,132 @@
+// -*- c++ -*-
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace Moses
+{
+class FeatureFunction;
+
+/** Per-sentence profile of the decoder, switched on with -profile: time and
+ *  calls of every feature function per evaluation phase, phrase table lookup
+ *  time, cache hit counts and hypothesis counts.
+ *
+ *  Each thread records into its own profile, so recording takes no locks.
+ *  At the end of a sentence the profile is written as one JSON object per
+ *  line (if -profile names a file) and added to process-wide totals, which
+ *  the server reports in Prometheus text format ("metrics" method). When
+ *  profiling is off, every hook is a test of one static flag.
+ *
+ *  Times are inclusive: a phrase table lookup that scores the phrases it
+ *  loads also counts the time of EvaluateInIsolation.
+ */
+class DecodeProfile
+{
+public:
+  enum Phase {
+    InIsolation,
+    WithSourceContext,
+    WhenApplied,
+    Lookup, //!< phrase table lookups
+    NumPhases
+  };
+
+  enum Counter {
+    HyposCreated,
+    HyposRecombined,
+    HyposPruned,
+    HyposDiscarded,
+    PhraseTableCacheHits,
+    PhraseTableCacheMisses,
+    TranslationCacheHits,
+    TranslationCacheMisses,
+    OptionCacheHits, //!< source spans
+    OptionCacheMisses,
+    NumCounters
+  };
+
+  //! per-sentence work around the search
+  enum Overhead {
+    Setup, //!< making the manager, with InitializeForInput() of the features
+    Cleanup, //!< destroying it, with CleanUpAfterSentenceProcessing()
+    NumOverheads
+  };
+
+  struct Entry {
+    uint64_t calls, nanoseconds;
+    Entry() : calls(0), nanoseconds(0) {}
+  };
+
+  static bool IsEnabled() {
+    return s_enabled;
+  }
+
+  //! switch profiling on; sentence profiles go to path ("-" for stderr) unless it is empty
+  static void Enable(const std::string &path);
+
+  static void Count(Counter counter, size_t n = 1) {
+    if (s_enabled) Current().m_counters[counter] += n;
+  }
+
+  //! times a call of a feature function while in scope
+  class Scope
+  {
+  public:
+    Scope(const FeatureFunction &ff, Phase phase) : m_entry(NULL) {
+      if (s_enabled) Start(ff, phase);
+    }
+    ~Scope() {
+      if (m_entry) Stop();
+    }
+  private:
+    Entry *m_entry;
+    uint64_t m_start;
+    void Start(const FeatureFunction &ff, Phase phase);
+    void Stop();
+  };
+
+  //! times an overhead of the sentence while in scope
+  class OverheadScope
+  {
+  public:
+    explicit OverheadScope(Overhead overhead) : m_overhead(NumOverheads) {
+      if (s_enabled) Start(overhead);
+    }
+    ~OverheadScope() {
+      if (m_overhead != NumOverheads) Stop();
+    }
+  private:
+    Overhead m_overhead;
+    uint64_t m_start;
+    void Start(Overhead overhead);
+    void Stop();
+  };
+
+  //! the calling thread starts on a new sentence
+  static void BeginSentence();
+
+  //! the calling thread is done with its sentence: writes its profile and
+  //! adds it to the totals. Returns the profile as JSON.
+  static std::string EndSentence(long translationId, double seconds);
+
+  //! totals over all sentences so far, in Prometheus text format
+  static std::string GetTotals();
+
+private:
+  static bool s_enabled;
+
+  std::vector<Entry> m_entries; //!< NumPhases per feature function, by GetIndex()
+  uint64_t m_counters[NumCounters];
+  uint64_t m_overheads[NumOverheads]; //!< nanoseconds
+
+  DecodeProfile();
+  void Clear();
+  void AddTo(DecodeProfile &totals) const;
+  std::string ToJson(long translationId, double seconds) const;
+
+  static DecodeProfile &Current();
+};
+
+}
@@ -25,6 +25,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOptionCollection.h"
 #include "PartialTranslOptColl.h"
 #include "FactorCollection.h"
+#include "LazyProduct.h"
+
+#include <map>
+#include <numeric>
 
 namespace Moses
 {
@@ -37,30 +41,6 @@ DecodeStepGeneration::DecodeStepGeneration(GenerationDictionary* dict,
 {
 }
 
-// helpers
-typedef pair<Word, ScoreComponentCollection> WordPair;
-typedef list< WordPair > WordList;
-// 1st = word
-// 2nd = score
-typedef list< WordPair >::const_iterator WordListIterator;
-
-/** used in generation: increases iterators when looping through the exponential number of generation expansions */
-inline void IncrementIterators(vector< WordListIterator > &wordListIterVector
-                               , const vector< WordList > &wordListVector)
-{
-  for (size_t currPos = 0 ; currPos < wordListVector.size() ; currPos++) {
-    WordListIterator &iter = wordListIterVector[currPos];
-    iter++;
-    if (iter != wordListVector[currPos].end()) {
-      // eg. 4 -> 5
-      return;
-    } else {
-      //  eg 9 -> 10
-      iter = wordListVector[currPos].begin();
-    }
-  }
-}
-
 void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOpt
                                    , const DecodeStep &decodeStep
                                    , PartialTranslOptColl &outputPartialTranslOptColl
@@ -80,90 +60,181 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
   const GenerationDictionary* generationDictionary  = decodeStep.GetGenerationDictionaryFeature();
 
   const Phrase &targetPhrase  = inputPartialTranslOpt.GetTargetPhrase();
-  const InputPath &inputPath = inputPartialTranslOpt.GetInputPath();
   size_t targetLength         = targetPhrase.GetSize();
 
-  // generation list for each word in phrase
-  vector< WordList > wordListVector(targetLength);
-
-  // create generation list
-  int wordListVectorPos = 0;
+  // range of dictionary entries generatable for each word in phrase
+  vector<size_t> begin(targetLength), end(targetLength);
+  size_t numIteration = 1;
   for (size_t currPos = 0 ; currPos < targetLength ; currPos++) { // going thorugh all words
-    // generatable factors for this word to be put in wordList
-    WordList &wordList = wordListVector[wordListVectorPos];
     const Word &word = targetPhrase.GetWord(currPos);
 
     // consult dictionary for possible generations for this word
-    const OutputWordCollection *wordColl = generationDictionary->FindWord(word);
-
-    if (wordColl == NULL) {
+    if (!generationDictionary->FindWord(word, begin[currPos], end[currPos])) {
       // word not found in generation dictionary
       //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
       return; // can't be part of a phrase, special handling
-    } else {
-      // sort(*wordColl, CompareWordCollScore);
-      OutputWordCollection::const_iterator iterWordColl;
-      for (iterWordColl = wordColl->begin() ; iterWordColl != wordColl->end(); ++iterWordColl) {
-        const Word &outputWord = (*iterWordColl).first;
-        const ScoreComponentCollection& score = (*iterWordColl).second;
-        // enter into word list generated factor(s) and its(their) score(s)
-        wordList.push_back(WordPair(outputWord, score));
-      }
-
-      wordListVectorPos++; // done, next word
     }
+    numIteration *= end[currPos] - begin[currPos];
   }
 
-  // use generation list (wordList)
-  // set up iterators (total number of expansions)
-  size_t numIteration = 1;
-  vector< WordListIterator >  wordListIterVector(targetLength);
-  vector< const Word* >       mergeWords(targetLength);
-  for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
-    wordListIterVector[currPos] = wordListVector[currPos].begin();
-    numIteration *= wordListVector[currPos].size();
-  }
+  // current entry of each word (total number of expansions)
+  vector<size_t> entries(begin);
 
   // go thru each possible factor for each word & create hypothesis
   for (size_t currIter = 0 ; currIter < numIteration ; currIter++) {
-    ScoreComponentCollection generationScore; // total score for this string of words
+    TranslationOption *newTransOpt = Extend(inputPartialTranslOpt, entries);
 
-    // create vector of words with new factors for last phrase
+    // next expansion, eg. 9 -> 10
     for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
-      const WordPair &wordPair = *wordListIterVector[currPos];
-      mergeWords[currPos] = &(wordPair.first);
-      generationScore.PlusEquals(wordPair.second);
+      if (++entries[currPos] != end[currPos]) break;
+      entries[currPos] = begin[currPos];
     }
 
-    // merge with existing trans opt
-    Phrase genPhrase( mergeWords);
+    if (newTransOpt) {
+      outputPartialTranslOptColl.Add(newTransOpt);
+    }
+  }
+}
 
-    if (IsFilteringStep()) {
-      if (!inputPartialTranslOpt.IsCompatible(genPhrase, m_conflictFactors))
-        continue;
+TranslationOption *DecodeStepGeneration::Extend(const TranslationOption &inputPartialTranslOpt
+    , const vector<size_t> &entries) const
+{
+  const GenerationDictionary* generationDictionary  = GetGenerationDictionaryFeature();
+  const InputPath &inputPath = inputPartialTranslOpt.GetInputPath();
+  const size_t targetLength   = entries.size();
+  const size_t numScores      = generationDictionary->GetNumScoreComponents();
+
+  vector<Word> outputWords(targetLength);
+  vector<const Word*> mergeWords(targetLength);
+  vector<float> generationScore(numScores); // total score for this string of words
+
+  // create vector of words with new factors for last phrase
+  for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
+    mergeWords[currPos] = &outputWords[currPos];
+    generationDictionary->SetOutputFactors(entries[currPos], outputWords[currPos]);
+    const float *scores = generationDictionary->GetScores(entries[currPos]);
+    for (size_t i = 0; i < numScores; ++i) {
+      generationScore[i] += scores[i];
     }
+  }
 
-    const TargetPhrase &inPhrase = inputPartialTranslOpt.GetTargetPhrase();
-    TargetPhrase outPhrase(inPhrase);
-    outPhrase.GetScoreBreakdown().PlusEquals(generationScore);
+  // merge with existing trans opt
+  Phrase genPhrase( mergeWords);
 
-    outPhrase.MergeFactors(genPhrase, m_newOutputFactors);
-    outPhrase.EvaluateInIsolation(inputPath.GetPhrase(), m_featuresToApply);
+  if (IsFilteringStep()) {
+    if (!inputPartialTranslOpt.IsCompatible(genPhrase, m_conflictFactors))
+      return NULL;
+  }
 
-    const WordsRange &sourceWordsRange = inputPartialTranslOpt.GetSourceWordsRange();
+  const TargetPhrase &inPhrase = inputPartialTranslOpt.GetTargetPhrase();
+  TargetPhrase outPhrase(inPhrase);
+  outPhrase.GetScoreBreakdown().PlusEquals(generationDictionary, generationScore);
 
-    TranslationOption *newTransOpt = new TranslationOption(sourceWordsRange, outPhrase);
-    assert(newTransOpt);
+  outPhrase.MergeFactors(genPhrase, m_newOutputFactors);
+  outPhrase.EvaluateInIsolation(inputPath.GetPhrase(), m_featuresToApply);
 
-    newTransOpt->SetInputPath(inputPath);
+  const WordsRange &sourceWordsRange = inputPartialTranslOpt.GetSourceWordsRange();
 
-    outputPartialTranslOptColl.Add(newTransOpt);
+  TranslationOption *newTransOpt = new TranslationOption(sourceWordsRange, outPhrase);
+  newTransOpt->SetInputPath(inputPath);
+  return newTransOpt;
+}
 
-    // increment iterators
-    IncrementIterators(wordListIterVector, wordListVector);
+namespace
+{
+// the generations of a word, best first by weighted score
+struct SortedGenerations {
+  vector<size_t> entries;
+  vector<float> scores;
+};
+
+struct CompareGeneration {
+  const vector<float> &scores;
+  CompareGeneration(const vector<float> &s) : scores(s) {}
+  bool operator()(size_t a, size_t b) const {
+    return scores[a] > scores[b];
   }
+};
 }
 
+void DecodeStepGeneration::ProcessLazy(const PartialTranslOptColl &inputPartialTranslOptColl
+                                       , PartialTranslOptColl &outputPartialTranslOptColl) const
+{
+  const GenerationDictionary* generationDictionary  = GetGenerationDictionaryFeature();
+  const vector<float> weights = StaticData::Instance().GetWeights(generationDictionary);
+  const size_t numScores = generationDictionary->GetNumScoreComponents();
+  const vector<TranslationOption*> &inputs = inputPartialTranslOptColl.GetList();
+  const size_t limit = StaticData::Instance().GetMaxNoPartTransOpt();
+
+  // by first dictionary entry of the word; map nodes don't move
+  std::map<size_t, SortedGenerations> generations;
+  vector<vector<const SortedGenerations*> > choices(inputs.size());
+
+  size_t created = 0;
+  LazyProductMerger merger;
+  const vector<float> none;
+  vector<const vector<float>*> lists;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const TranslationOption &input = *inputs[i];
+    const Phrase &targetPhrase = input.GetTargetPhrase();
+    lists.clear();
+    if (targetPhrase.GetSize() == 0) {
+      // word deletion
+      outputPartialTranslOptColl.Add(new TranslationOption(input));
+      ++created;
+      merger.Add(0, new LazyProduct(vector<const vector<float>*>(1, &none)));
+      continue;
+    }
+
+    bool found = true;
+    for (size_t currPos = 0 ; currPos < targetPhrase.GetSize() ; currPos++) {
+      size_t begin, end;
+      found = generationDictionary->FindWord(targetPhrase.GetWord(currPos), begin, end);
+      if (!found) break;
+
+      std::map<size_t, SortedGenerations>::iterator iter = generations.find(begin);
+      if (iter == generations.end()) {
+        vector<float> weighted(end - begin);
+        vector<size_t> order(end - begin);
+        for (size_t entry = begin; entry < end; ++entry) {
+          const float *scores = generationDictionary->GetScores(entry);
+          weighted[entry - begin] = std::inner_product(scores, scores + numScores, weights.begin(), 0.0f);
+          order[entry - begin] = entry - begin;
+        }
+        std::stable_sort(order.begin(), order.end(), CompareGeneration(weighted));
+
+        SortedGenerations &sorted = generations[begin];
+        for (size_t j = 0; j < order.size(); ++j) {
+          sorted.entries.push_back(begin + order[j]);
+          sorted.scores.push_back(weighted[order[j]]);
+        }
+        iter = generations.find(begin);
+      }
+      choices[i].push_back(&iter->second);
+      lists.push_back(&iter->second.scores);
+    }
+    if (!found) {
+      // can't be part of a phrase
+      merger.Add(0, new LazyProduct(vector<const vector<float>*>(1, &none)));
+      continue;
+    }
+    merger.Add(input.GetFutureScore(), new LazyProduct(lists));
+  }
+
+  size_t input;
+  vector<size_t> choice, entries;
+  while (created < limit && merger.Pop(input, choice)) {
+    entries.resize(choice.size());
+    for (size_t currPos = 0; currPos < choice.size(); ++currPos) {
+      entries[currPos] = choices[input][currPos]->entries[choice[currPos]];
+    }
+    TranslationOption *newTransOpt = Extend(*inputs[input], entries);
+    if (newTransOpt) {
+      outputPartialTranslOptColl.Add(newTransOpt);
+      ++created;
+    }
+  }
 }
 
+}
 
@@ -46,7 +46,18 @@ public:
                , TranslationOptionCollection *toc
                , bool adhereTableLimit) const;
 
+  /*! like Process() for all partial translation options at once, but
+   *  combining them with the generations of their words best-first by the
+   *  sum of future and weighted generation scores, until
+   *  max-partial-trans-opt options are created
+   */
+  void ProcessLazy(const PartialTranslOptColl &inputPartialTranslOptColl
+                   , PartialTranslOptColl &outputPartialTranslOptColl) const;
+
 private:
+  //! options with the given dictionary entry for each word, NULL if they conflict
+  TranslationOption *Extend(const TranslationOption &inputPartialTranslOpt
+                            , const std::vector<size_t> &entries) const;
 };
 
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOptionCollection.h"
 #include "PartialTranslOptColl.h"
 #include "FactorCollection.h"
+#include "LazyProduct.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -59,7 +60,6 @@ void DecodeStepTranslation::Process(const TranslationOption &inputPartialTranslO
 
   // normal trans step
   const WordsRange &sourceWordsRange        = inputPartialTranslOpt.GetSourceWordsRange();
-  const InputPath &inputPath = inputPartialTranslOpt.GetInputPath();
   const PhraseDictionary* phraseDictionary  =
     decodeStep.GetPhraseDictionaryFeature();
   const TargetPhrase &inPhrase = inputPartialTranslOpt.GetTargetPhrase();
@@ -76,27 +76,90 @@ void DecodeStepTranslation::Process(const TranslationOption &inputPartialTranslO
       // skip if the
       if (targetPhrase.GetSize() != currSize) continue;
 
-      TargetPhrase outPhrase(inPhrase);
-
-      if (IsFilteringStep()) {
-        if (!inputPartialTranslOpt.IsCompatible(targetPhrase, m_conflictFactors))
-          continue;
+      TranslationOption *newTransOpt = Extend(inputPartialTranslOpt, targetPhrase);
+      if (newTransOpt) {
+        outputPartialTranslOptColl.Add(newTransOpt);
       }
+    }
+  } else if (sourceWordsRange.GetNumWordsCovered() == 1) {
+    // unknown handler
+    //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
+  }
+}
 
-      outPhrase.Merge(targetPhrase, m_newOutputFactors);
-      outPhrase.EvaluateInIsolation(inputPath.GetPhrase(), m_featuresToApply); // need to do this as all non-transcores would be screwed up
+TranslationOption *DecodeStepTranslation::Extend(const TranslationOption &inputPartialTranslOpt
+    , const TargetPhrase &targetPhrase) const
+{
+  if (IsFilteringStep()) {
+    if (!inputPartialTranslOpt.IsCompatible(targetPhrase, m_conflictFactors))
+      return NULL;
+  }
 
-      TranslationOption *newTransOpt = new TranslationOption(sourceWordsRange, outPhrase);
-      assert(newTransOpt != NULL);
+  const InputPath &inputPath = inputPartialTranslOpt.GetInputPath();
+  TargetPhrase outPhrase(inputPartialTranslOpt.GetTargetPhrase());
+  outPhrase.Merge(targetPhrase, m_newOutputFactors);
+  outPhrase.EvaluateInIsolation(inputPath.GetPhrase(), m_featuresToApply); // need to do this as all non-transcores would be screwed up
 
-      newTransOpt->SetInputPath(inputPath);
+  TranslationOption *newTransOpt = new TranslationOption(inputPartialTranslOpt.GetSourceWordsRange(), outPhrase);
+  newTransOpt->SetInputPath(inputPath);
+  return newTransOpt;
+}
 
-      outputPartialTranslOptColl.Add(newTransOpt );
+void DecodeStepTranslation::ProcessLazy(const PartialTranslOptColl &inputPartialTranslOptColl
+                                        , PartialTranslOptColl &outputPartialTranslOptColl
+                                        , bool adhereTableLimit
+                                        , const TargetPhraseCollection *phraseColl) const
+{
+  const std::vector<TranslationOption*> &inputs = inputPartialTranslOptColl.GetList();
+  const size_t limit = StaticData::Instance().GetMaxNoPartTransOpt();
 
+  // the target phrases of each length, best first
+  std::vector<std::vector<const TargetPhrase*> > phrases;
+  std::vector<std::vector<float> > scores;
+  if (phraseColl != NULL) {
+    const size_t tableLimit = GetPhraseDictionaryFeature()->GetTableLimit();
+    TargetPhraseCollection::const_iterator iterTargetPhrase, iterEnd;
+    iterEnd = (!adhereTableLimit || tableLimit == 0 || phraseColl->GetSize() < tableLimit) ? phraseColl->end() : phraseColl->begin() + tableLimit;
+    for (iterTargetPhrase = phraseColl->begin(); iterTargetPhrase != iterEnd; ++iterTargetPhrase) {
+      size_t size = (*iterTargetPhrase)->GetSize();
+      if (phrases.size() <= size) phrases.resize(size + 1);
+      phrases[size].push_back(*iterTargetPhrase);
+    }
+    scores.resize(phrases.size());
+    for (size_t size = 0; size < phrases.size(); ++size) {
+      std::stable_sort(phrases[size].begin(), phrases[size].end(), CompareTargetPhrase());
+      for (size_t i = 0; i < phrases[size].size(); ++i) {
+        scores[size].push_back(phrases[size][i]->GetFutureScore());
+      }
+    }
+  }
+
+  size_t created = 0;
+  LazyProductMerger merger;
+  const std::vector<float> none;
+  std::vector<const std::vector<float>*> lists(1);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const TranslationOption &input = *inputs[i];
+    size_t size = input.GetTargetPhrase().GetSize();
+    if (size == 0) {
+      // word deletion
+      outputPartialTranslOptColl.Add(new TranslationOption(input));
+      ++created;
+    }
+    lists[0] = (size > 0 && size < scores.size()) ? &scores[size] : &none;
+    merger.Add(input.GetFutureScore(), new LazyProduct(lists));
+  }
+
+  size_t input;
+  std::vector<size_t> choice;
+  while (created < limit && merger.Pop(input, choice)) {
+    const TranslationOption &inputPartialTranslOpt = *inputs[input];
+    const TargetPhrase &targetPhrase = *phrases[inputPartialTranslOpt.GetTargetPhrase().GetSize()][choice[0]];
+    TranslationOption *newTransOpt = Extend(inputPartialTranslOpt, targetPhrase);
+    if (newTransOpt) {
+      outputPartialTranslOptColl.Add(newTransOpt);
+      ++created;
     }
-  } else if (sourceWordsRange.GetNumWordsCovered() == 1) {
-    // unknown handler
-    //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
   }
 }
 
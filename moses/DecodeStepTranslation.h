@@ -50,6 +50,15 @@ public:
                        , bool adhereTableLimit
                        , const TargetPhraseCollection *phraseColl) const;
 
+  /*! like Process() for all partial translation options at once, but
+   *  combining them with the target phrases best-first by the sum of their
+   *  future scores, until max-partial-trans-opt options are created
+   */
+  void ProcessLazy(const PartialTranslOptColl &inputPartialTranslOptColl
+                   , PartialTranslOptColl &outputPartialTranslOptColl
+                   , bool adhereTableLimit
+                   , const TargetPhraseCollection *phraseColl) const;
+
 
   /*! initialize list of partial translation options by applying the first translation step
   * Ideally, this function should be in DecodeStepTranslation class
@@ -72,6 +81,10 @@ public:
                      , bool adhereTableLimit) const;
 
 private:
+  //! merge a target phrase into a partial translation option, NULL if they conflict
+  TranslationOption *Extend(const TranslationOption &inputPartialTranslOpt
+                            , const TargetPhrase &targetPhrase) const;
+
   // I'm not sure whether this actually works or not for binary phrase table.
   // The source phrase only appears to contain the 1st word, therefore, this function
   // only compares the 1st word
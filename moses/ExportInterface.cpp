@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 /**
  * Moses interface for main function, for single-threaded and multi-threaded.
  **/
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <sstream>
@@ -41,10 +42,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "Util.h"
 #include "Timer.h"
+#include "ContextScope.h"
+#include "MemoryReport.h"
+#include "TranslationCache.h"
+#include "TranslationOptionCache.h"
 #include "TranslationModel/PhraseDictionary.h"
 #include "FF/StatefulFeatureFunction.h"
 #include "FF/StatelessFeatureFunction.h"
 #include "TranslationTask.h"
+#include "BatchTranslationTask.h"
+#include "TrellisPathList.h"
+#include "Sentence.h"
+#include "ChartManager.h"
+#include "ChartKBestExtractor.h"
+#include "FactorCollection.h"
 #include "ExportInterface.h"
 
 #ifdef HAVE_PROTOBUF
@@ -63,6 +74,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <xmlrpc-c/registry.hpp>
 #include <xmlrpc-c/server_abyss.hpp>
 #include "server/Translator.h"
+#include "server/BatchTranslator.h"
+#include "server/BinaryServer.h"
+#include "server/ServerStats.h"
+#include "server/ModelReloader.h"
+#include "server/Metrics.h"
 #include "server/Optimizer.h"
 #include "server/Updater.h"
 #endif
@@ -129,6 +145,107 @@ string SimpleTranslationInterface::translate(const string &inputString)
   return output.erase(end + 1);
 }
 
+const Factor *SimpleTranslationInterface::getWordId(const StringPiece &word) const
+{
+  return FactorCollection::Instance().AddFactor(word);
+}
+
+namespace
+{
+void AppendWords(const Phrase &phrase, FactorType factorType,
+                 size_t begin, size_t end, vector<const Factor*> &words)
+{
+  for (size_t i = begin; i < end; ++i) {
+    words.push_back(phrase.GetFactor(i, factorType));
+  }
+}
+
+void AppendWords(const Hypothesis &hypo, FactorType factorType, vector<const Factor*> &words)
+{
+  if (!hypo.GetPrevHypo()) return;
+  AppendWords(*hypo.GetPrevHypo(), factorType, words);
+  const TargetPhrase &phrase = hypo.GetCurrTargetPhrase();
+  AppendWords(phrase, factorType, 0, phrase.GetSize(), words);
+}
+}
+
+void SimpleTranslationInterface::translate(const vector<const Factor*> &input, const Options &options,
+    vector<Translation> &results, long translationId) const
+{
+  const StaticData &staticData = StaticData::Instance();
+  const FactorType inputFactor = staticData.GetInputFactorOrder()[0];
+  const FactorType outputFactor = staticData.GetOutputFactorOrder()[0];
+
+  Phrase words(input.size());
+  for (size_t i = 0; i < input.size(); ++i) {
+    words.AddWord().SetFactor(inputFactor, input[i]);
+  }
+  boost::shared_ptr<InputType> source(new Sentence(translationId, words));
+  FeatureFunction::CallChangeSource(&*source);
+
+  const size_t nBestSize = std::max<size_t>(options.nBestSize, 1);
+  if (!staticData.IsSyntax()) {
+    Manager manager(*source);
+    manager.Decode();
+    if (nBestSize == 1) {
+      const Hypothesis *hypo = manager.GetBestHypothesis();
+      results.resize(hypo ? 1 : 0);
+      if (hypo) {
+        Translation &translation = results[0];
+        translation.words.clear();
+        AppendWords(*hypo, outputFactor, translation.words);
+        translation.alignment.clear();
+        if (options.wordAlignment) hypo->GetWordAlignment(translation.alignment);
+        translation.score = hypo->GetTotalScore();
+      }
+      return;
+    }
+
+    TrellisPathList nBestList;
+    manager.CalcNBest(nBestSize, nBestList, staticData.GetDistinctNBest());
+    results.resize(nBestList.GetSize());
+    size_t i = 0;
+    for (TrellisPathList::const_iterator iter = nBestList.begin(); iter != nBestList.end(); ++iter, ++i) {
+      const TrellisPath &path = **iter;
+      const vector<const Hypothesis*> &edges = path.GetEdges();
+      Translation &translation = results[i];
+      translation.words.clear();
+      translation.alignment.clear();
+      // the edges run from the last phrase to the first
+      size_t targetOffset = 0;
+      for (size_t e = edges.size(); e-- > 0; ) {
+        const TargetPhrase &phrase = edges[e]->GetCurrTargetPhrase();
+        AppendWords(phrase, outputFactor, 0, phrase.GetSize(), translation.words);
+        if (options.wordAlignment) {
+          phrase.GetAlignTerm().AppendSortedAlignments(translation.alignment,
+              edges[e]->GetCurrSourceWordsRange().GetStartPos(), targetOffset);
+        }
+        targetOffset += phrase.GetSize();
+      }
+      translation.score = path.GetTotalScore();
+    }
+  } else {
+    UTIL_THROW_IF2(staticData.GetSearchAlgorithm() != CYKPlus,
+                   "Translating word ids supports phrase-based and chart (CYK+) decoding only");
+    ChartManager manager(*source);
+    manager.Decode();
+    vector<boost::shared_ptr<ChartKBestExtractor::Derivation> > nBestList;
+    manager.CalcNBest(nBestSize, nBestList, staticData.GetDistinctNBest());
+    results.resize(nBestList.size());
+    for (size_t i = 0; i < nBestList.size(); ++i) {
+      const Phrase phrase = ChartKBestExtractor::GetOutputPhrase(*nBestList[i]);
+      Translation &translation = results[i];
+      translation.words.clear();
+      translation.alignment.clear();
+      // without <s> and </s>
+      if (phrase.GetSize() >= 2) {
+        AppendWords(phrase, outputFactor, 1, phrase.GetSize() - 1, translation.words);
+      }
+      translation.score = nBestList[i]->score;
+    }
+  }
+}
+
 Moses::StaticData& SimpleTranslationInterface::getStaticData()
 {
   return StaticData::InstanceNonConst();
@@ -150,19 +267,39 @@ run_as_server()
   bool isSerial; params.SetParameter(isSerial, "serial", false);
   string logfile; params.SetParameter(logfile, "server-log", string(""));
   size_t num_threads; params.SetParameter(num_threads, "threads", size_t(10));
+  size_t max_queued; params.SetParameter(max_queued, "server-max-queue", size_t(0));
+  int binary_port; params.SetParameter(binary_port, "server-binary-port", 0);
   if (isSerial) VERBOSE(1,"Running server in serial mode." << endl);
   
   xmlrpc_c::registry myRegistry;
   
-  xmlrpc_c::methodPtr const translator(new MosesServer::Translator(num_threads));
+  MosesServer::Translator* t = new MosesServer::Translator(num_threads, max_queued);
+  xmlrpc_c::methodPtr const translator(t);
+  xmlrpc_c::methodPtr const batch_translator(new MosesServer::BatchTranslator(*t));
+  xmlrpc_c::methodPtr const stats(new MosesServer::ServerStats(*t));
   xmlrpc_c::methodPtr const updater(new MosesServer::Updater);
   xmlrpc_c::methodPtr const optimizer(new MosesServer::Optimizer);
+  xmlrpc_c::methodPtr const reloader(new MosesServer::ModelReloader);
+  xmlrpc_c::methodPtr const metrics(new MosesServer::Metrics(*t));
   
   myRegistry.addMethod("translate", translator);
+  myRegistry.addMethod("translate_batch", batch_translator);
+  myRegistry.addMethod("stats", stats);
   myRegistry.addMethod("updater", updater);
   myRegistry.addMethod("optimize", optimizer);
+  myRegistry.addMethod("reload", reloader);
+  myRegistry.addMethod("metrics", metrics);
   
   xmlrpc_c::serverAbyss myAbyssServer(myRegistry, port, logfile);
+
+  if (binary_port > 0)
+    {
+      // next to the XML-RPC server, on the same decoder threads
+      MosesServer::BinaryServer* binary 
+	= new MosesServer::BinaryServer(*t, binary_port);
+      boost::thread(boost::bind(&MosesServer::BinaryServer::Run, binary)).detach();
+      XVERBOSE(1,"Binary protocol on port " << binary_port << endl);
+    }
   
   XVERBOSE(1,"Listening on port " << port << endl);
   if (isSerial) { while(1) myAbyssServer.runOnce(); } 
@@ -178,6 +315,136 @@ run_as_server()
 
 }
 
+namespace
+{
+
+/** Hands the translation tasks of batch_run() to the thread pool, or runs
+ *  them without threads. Consecutive short sentences go in batches of
+ *  -batch-sentences. With -schedule-window, the tasks of that many inputs
+ *  are held back and handed on longest first, so that a long sentence does
+ *  not start last and keep the others waiting; the output collectors put
+ *  the translations back in order.
+ */
+class TaskScheduler
+{
+public:
+#ifdef WITH_THREADS
+  TaskScheduler(ThreadPool &pool, OutputCollector *windowCollector, size_t outputWindow)
+    : m_pool(pool), m_windowCollector(windowCollector), m_outputWindow(outputWindow) {
+    Init();
+  }
+#else
+  TaskScheduler() {
+    Init();
+  }
+#endif
+
+  void Add(const boost::shared_ptr<TranslationTask> &task, const InputType &source) {
+    Pending pending;
+    pending.task = task;
+    pending.id = source.GetTranslationId();
+    pending.length = source.GetSize();
+    if (m_scheduleWindow <= 1) {
+      Dispatch(pending, true);
+      return;
+    }
+    m_pending.push_back(pending);
+    if (m_pending.size() == m_scheduleWindow) Flush();
+  }
+
+  //! all tasks have been added
+  void Finish() {
+    Flush();
+    SubmitBatch();
+  }
+
+private:
+  struct Pending {
+    boost::shared_ptr<TranslationTask> task;
+    long id;
+    size_t length;
+
+    // longest first, then in input order
+    bool operator<(const Pending &other) const {
+      return length != other.length ? length > other.length : id < other.id;
+    }
+  };
+
+#ifdef WITH_THREADS
+  ThreadPool &m_pool;
+  OutputCollector *m_windowCollector;
+  size_t m_outputWindow;
+#endif
+  size_t m_batchSentences, m_batchMaxLength, m_scheduleWindow;
+  boost::shared_ptr<BatchTranslationTask> m_batch;
+  std::vector<Pending> m_pending;
+
+  void Init() {
+    const StaticData &staticData = StaticData::Instance();
+    m_batchSentences = staticData.GetBatchSentences();
+    m_batchMaxLength = staticData.GetBatchMaxLength();
+#ifdef WITH_THREADS
+    m_scheduleWindow = staticData.GetScheduleWindow();
+#else
+    m_scheduleWindow = 0; // one sentence after another all the same
+#endif
+  }
+
+  void WaitForTurn(long id) {
+#ifdef WITH_THREADS
+    if (m_windowCollector) m_windowCollector->WaitForTurn(id, m_outputWindow);
+#endif
+  }
+
+  void Submit(const boost::shared_ptr<Task> &task) {
+#ifdef WITH_THREADS
+    m_pool.Submit(task);
+#else
+    task->Run();
+#endif
+  }
+
+  void SubmitBatch() {
+    if (!m_batch) return;
+    Submit(m_batch);
+    m_batch.reset();
+  }
+
+  // all inputs before the task have been dispatched, unless !wait
+  void Dispatch(const Pending &pending, bool wait) {
+    if (m_batchSentences > 1 && pending.length <= m_batchMaxLength) {
+      if (!m_batch) {
+        // the sentences of a batch are translated in order, so a batch
+        // waits for the turn of its first one
+        if (wait) WaitForTurn(pending.id);
+        m_batch.reset(new BatchTranslationTask);
+      }
+      m_batch->Add(pending.task);
+      if (m_batch->GetSize() == m_batchSentences) SubmitBatch();
+    } else {
+      // keep the order of the input as far as possible
+      SubmitBatch();
+      if (wait) WaitForTurn(pending.id);
+      Submit(pending.task);
+    }
+  }
+
+  void Flush() {
+    if (m_pending.empty()) return;
+    // everything before the window has been handed on, so this is the
+    // last point to wait for the output without risking a deadlock
+    WaitForTurn(m_pending.front().id);
+    std::sort(m_pending.begin(), m_pending.end());
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+      Dispatch(m_pending[i], false);
+    }
+    SubmitBatch();
+    m_pending.clear();
+  }
+};
+
+}
+
 int
 batch_run()
 {
@@ -187,7 +454,10 @@ batch_run()
   //initialise random numbers
   srand(time(NULL));
 
-  IFVERBOSE(1) PrintUserTime("Created input-output object");
+  IFVERBOSE(1) {
+    PrintUserTime("Created input-output object");
+    MemoryReport::Print(std::cerr);
+  }
     
   // set up read/writing class:
   boost::shared_ptr<IOWrapper> ioWrapper(new IOWrapper); 
@@ -205,15 +475,28 @@ batch_run()
 
 #ifdef WITH_THREADS
   ThreadPool pool(staticData.ThreadCount());
+
+  // bound the outputs held back behind a slow sentence
+  const size_t outputWindow = staticData.GetOutputWindow();
+  OutputCollector *windowCollector = NULL;
+  if (outputWindow > 0) {
+    windowCollector = ioWrapper->GetSingleBestOutputCollector();
+    if (!windowCollector) windowCollector = ioWrapper->GetNBestOutputCollector();
+  }
+  TaskScheduler scheduler(pool, windowCollector, outputWindow);
+#else
+  TaskScheduler scheduler;
 #endif
 
-  // main loop over set of input sentences
+  // main loop over set of input sentences; the input is one document
 
+  boost::shared_ptr<ContextScope> scope(new ContextScope);
   boost::shared_ptr<InputType> source;
   while ((source = ioWrapper->ReadInput()) != NULL)
     {
       IFVERBOSE(1) ResetUserTime();
       
+      source->SetScope(scope);
       FeatureFunction::CallChangeSource(source.get());
       
       // set up task of translating one sentence
@@ -226,8 +509,7 @@ batch_run()
       FeatureFunction::SetupAll(*task);
 
       // execute task
-#ifdef WITH_THREADS
-#ifdef PT_UG
+#if defined(WITH_THREADS) && defined(PT_UG)
       // simulated post-editing requires threads (within the dynamic phrase tables)
       // but runs all sentences serially, to allow updating of the bitext.
       bool spe = params.isParamSpecified("spe-src");
@@ -251,19 +533,23 @@ batch_run()
 	      VERBOSE(1,"[" << HERE << " added aln] " << aln << endl);
 	    }
 	} 
-      else pool.Submit(task);
-#else
-      pool.Submit(task);
-
+      else {
 #endif
-#else
-      task->Run();
+      scheduler.Add(task, *source);
+#if defined(WITH_THREADS) && defined(PT_UG)
+      }
 #endif
     }
   
   // we are done, finishing up
+  scheduler.Finish();
 #ifdef WITH_THREADS
   pool.Stop(true); //flush remaining jobs
+  IFVERBOSE(1) {
+    TRACE_ERR("Thread pool: " << pool.GetExecutedCount() << " tasks, "
+              << pool.GetStealCount() << " stolen, "
+              << pool.GetIdleSeconds() << "s idle" << endl);
+  }
 #endif
 
   FeatureFunction::Destroy();
@@ -278,6 +564,89 @@ batch_run()
 #endif
 }
 
+/** Decodes the input file again for every command read from stdin, with
+ *  new weights and output files, without loading the models again. Once a
+ *  pass is complete the n-best file name is written to stdout. **/
+int
+tuning_loop()
+{
+  StaticData& staticData = StaticData::InstanceNonConst();
+  UTIL_THROW_IF2(!params.GetParam("input-file"),
+                 "tuning-loop needs an input-file");
+  UTIL_THROW_IF2(staticData.GetNBestSize() == 0,
+                 "tuning-loop needs an n-best-list");
+
+  string line;
+  while (getline(cin, line)) {
+    if (Trim(line).empty()) continue;
+    vector<string> fields = TokenizeMultiCharSeparator(line, "|||");
+    UTIL_THROW_IF2(fields.size() < 3 || fields.size() > 4,
+                   "Expected 'output-file ||| n-best-file ||| weights [||| sparse-weight-file]'"
+                   << " but got: " << line);
+    const string &nBestFilePath = fields[1];
+    staticData.ResetWeights(fields[2], fields.size() == 4 ? fields[3] : "");
+    staticData.SetNBestFilePath(nBestFilePath);
+
+    // translations cached so far were scored with the old weights
+    TranslationCache* cache = staticData.GetTranslationCache();
+    if (cache) cache->Invalidate("tuning-loop");
+    TranslationOptionCache* optionCache = staticData.GetTranslationOptionCache();
+    if (optionCache) optionCache->Invalidate();
+    const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
+    for (size_t i = 0; i < pts.size(); ++i) {
+      pts[i]->ClearCache();
+    }
+
+    IFVERBOSE(1) {
+      TRACE_ERR("Tuning pass, n-best list " << nBestFilePath << ", weights: ");
+      TRACE_ERR(staticData.GetAllWeights());
+      TRACE_ERR(endl);
+    }
+
+    std::ofstream output(fields[0].c_str());
+    UTIL_THROW_IF2(!output, "Cannot write " << fields[0]);
+    boost::shared_ptr<IOWrapper> ioWrapper(new IOWrapper);
+    ioWrapper->SetOutputStream2SingleBestOutputCollector(&output);
+    {
+#ifdef WITH_THREADS
+      // new threads each pass, the thread-local phrase table caches go with
+      // the old ones
+      ThreadPool pool(staticData.ThreadCount());
+#endif
+      boost::shared_ptr<ContextScope> scope(new ContextScope);
+      boost::shared_ptr<InputType> source;
+      while ((source = ioWrapper->ReadInput()) != NULL) {
+        source->SetScope(scope);
+        FeatureFunction::CallChangeSource(source.get());
+        boost::shared_ptr<TranslationTask>
+        task = TranslationTask::create(source, ioWrapper);
+        FeatureFunction::SetupAll(*task);
+#ifdef WITH_THREADS
+        pool.Submit(task);
+#else
+        task->Run();
+#endif
+      }
+#ifdef WITH_THREADS
+      pool.Stop(true);
+#endif
+    }
+    // closes the n-best file
+    ioWrapper.reset();
+    output.close();
+    cout << nBestFilePath << endl;
+  }
+
+  FeatureFunction::Destroy();
+
+#ifndef EXIT_RETURN
+  //This avoids that destructors are called (it can take a long time)
+  exit(EXIT_SUCCESS);
+#else
+  return EXIT_SUCCESS;
+#endif
+}
+
 /** Called by main function of the command line version of the decoder **/
 int decoder_main(int argc, char** argv)
 {
@@ -319,6 +688,8 @@ int decoder_main(int argc, char** argv)
     
       if (params.GetParam("server"))
 	return run_as_server();
+      else if (params.isParamSpecified("tuning-loop"))
+	return tuning_loop();
       else
 	return batch_run();
     
@@ -33,6 +33,9 @@ POSSIBILITY OF SUCH DAMAGE.
 
 // example file on how to use moses library
 
+#include <utility>
+#include <vector>
+
 #include "StaticData.h"
 #include "IOWrapper.h"
 #include "TypeDef.h"
@@ -40,10 +43,35 @@ POSSIBILITY OF SUCH DAMAGE.
 class SimpleTranslationInterface
 {
 public:
+  //! per-call options of translate() on word ids
+  struct Options {
+    Options() : nBestSize(1), wordAlignment(false) {}
+    size_t nBestSize;   //!< more than one needs n-best support in the configuration
+    bool wordAlignment; //!< fill Translation::alignment (phrase-based models only)
+  };
+
+  /** One translation. The words are the decoder's factors, which live as
+   *  long as the process: Factor::GetString() is a view, not a copy. */
+  struct Translation {
+    std::vector<const Moses::Factor*> words;
+    std::vector<std::pair<size_t,size_t> > alignment; //!< (source, target) word positions
+    float score;
+  };
+
   static void DestroyFeatureFunctionStatic();
   SimpleTranslationInterface(const std::string &mosesIni);
   ~SimpleTranslationInterface();
   std::string translate(const std::string &input);
+
+  //! the id of a word for translate(), valid as long as the process lives
+  const Moses::Factor *getWordId(const StringPiece &word) const;
+
+  /** translate a tokenized sentence of word ids (surface factors) on the
+   *  calling thread; several threads may translate at once. Skips the input
+   *  and output formatting: no markup, the best translation first in results,
+   *  whose vectors are reused from the previous call. */
+  void translate(const std::vector<const Moses::Factor*> &input, const Options &options,
+                 std::vector<Translation> &results, long translationId = 0) const;
   Moses::StaticData& getStaticData();
   Moses::Parameter& getParameters(){ return m_params; }
 private:
@@ -4,6 +4,7 @@
 #include "moses/ChartHypothesis.h"
 #include "moses/ChartManager.h"
 #include "moses/StaticData.h"
+#include "moses/TranslationOptionList.h"
 #include "moses/InputFileStream.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
@@ -81,23 +82,97 @@ std::vector<float> ConstrainedDecoding::DefaultWeights() const
   return ret;
 }
 
-template <class H, class M>
-const std::vector<Phrase> *GetConstraint(const std::map<long,std::vector<Phrase> > &constraints, const H &hypo)
+const std::vector<Phrase> *ConstrainedDecoding::GetConstraint(long translationId) const
 {
-  const M &mgr = hypo.GetManager();
-  const InputType &input = mgr.GetSource();
-  long id = input.GetTranslationId();
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+#endif
+    map<long,std::vector<Phrase> >::const_iterator iter = m_sentenceConstraints.find(translationId);
+    if (iter != m_sentenceConstraints.end()) {
+      // elements of a map stay where they are until erased
+      return &iter->second;
+    }
+  }
 
-  map<long,std::vector<Phrase> >::const_iterator iter;
-  iter = constraints.find(id);
+  map<long,std::vector<Phrase> >::const_iterator iter = m_constraints.find(translationId);
+  UTIL_THROW_IF2(iter == m_constraints.end(), "Couldn't find reference " << translationId);
+  return &iter->second;
+}
 
-  if (iter == constraints.end()) {
-    UTIL_THROW(util::Exception, "Couldn't find reference " << id);
+void ConstrainedDecoding::SetConstraints(long translationId, const std::vector<Phrase> &constraints) const
+{
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+  m_sentenceConstraints[translationId] = constraints;
+}
 
-    return NULL;
-  } else {
-    return &iter->second;
+void ConstrainedDecoding::ClearConstraints(long translationId) const
+{
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+  m_sentenceConstraints.erase(translationId);
+}
+
+const ConstrainedDecoding *ConstrainedDecoding::GetForcing()
+{
+  const StaticData &staticData = StaticData::Instance();
+  const std::vector<const StatefulFeatureFunction*> &sfs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (size_t i = 0; i < sfs.size(); ++i) {
+    const ConstrainedDecoding *cd = dynamic_cast<const ConstrainedDecoding*>(sfs[i]);
+    if (cd && cd->IsForcing() && !staticData.IsFeatureFunctionIgnored(*cd)) {
+      return cd;
+    }
+  }
+  return NULL;
+}
+
+namespace
+{
+struct Unreachable {
+  const std::vector<Phrase> *refs;
+  bool operator()(const TranslationOption *option) const {
+    const Phrase &target = option->GetTargetPhrase();
+    for (size_t i = 0; i < refs->size(); ++i) {
+      if ((*refs)[i].Find(target, 0) != NOT_FOUND) return false;
+    }
+    return true;
+  }
+};
+
+// whether phrase is in ref at pos
+bool MatchesAt(const Phrase &ref, size_t pos, const Phrase &phrase)
+{
+  if (pos + phrase.GetSize() > ref.GetSize()) return false;
+  for (size_t i = 0; i < phrase.GetSize(); ++i) {
+    if (!(phrase.GetWord(i) == ref.GetWord(pos + i))) return false;
+  }
+  return true;
+}
+}
+
+size_t ConstrainedDecoding::RemoveUnreachable(const std::vector<Phrase> &refs, TranslationOptionList &options)
+{
+  Unreachable unreachable;
+  unreachable.refs = &refs;
+  return options.RemoveIf(unreachable);
+}
+
+bool ConstrainedDecoding::Extends(const std::vector<Phrase> &refs, const Hypothesis &hypo, const Phrase &phrase)
+{
+  // GetSize() is the length of the output, 0 for the initial hypothesis
+  const size_t pos = hypo.GetSize();
+  for (size_t r = 0; r < refs.size(); ++r) {
+    if (!MatchesAt(refs[r], pos, phrase)) continue;
+    bool match = true;
+    for (const Hypothesis *h = &hypo; refs.size() > 1 && match && h->GetPrevHypo(); h = h->GetPrevHypo()) {
+      match = MatchesAt(refs[r], h->GetCurrTargetWordsRange().GetStartPos(), h->GetCurrTargetPhrase());
+    }
+    if (match) return true;
   }
+  return false;
 }
 
 FFState* ConstrainedDecoding::EvaluateWhenApplied(
@@ -105,7 +180,7 @@ FFState* ConstrainedDecoding::EvaluateWhenApplied(
   const FFState* prev_state,
   ScoreComponentCollection* accumulator) const
 {
-  const std::vector<Phrase> *ref = GetConstraint<Hypothesis, Manager>(m_constraints, hypo);
+  const std::vector<Phrase> *ref = GetConstraint(hypo.GetManager().GetSource().GetTranslationId());
   assert(ref);
 
   ConstrainedDecodingState *ret = new ConstrainedDecodingState(hypo);
@@ -146,7 +221,7 @@ FFState* ConstrainedDecoding::EvaluateWhenApplied(
   int /* featureID - used to index the state in the previous hypotheses */,
   ScoreComponentCollection* accumulator) const
 {
-  const std::vector<Phrase> *ref = GetConstraint<ChartHypothesis, ChartManager>(m_constraints, hypo);
+  const std::vector<Phrase> *ref = GetConstraint(hypo.GetManager().GetSource().GetTranslationId());
   assert(ref);
 
   const ChartManager &mgr = hypo.GetManager();
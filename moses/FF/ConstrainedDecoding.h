@@ -6,8 +6,14 @@
 #include "FFState.h"
 #include "moses/Phrase.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 namespace Moses
 {
+class TranslationOptionList;
+
 class ConstrainedDecodingState : public FFState
 {
 public:
@@ -77,9 +83,56 @@ public:
 
   void SetParameter(const std::string& key, const std::string& value);
 
+  /** Constrain the translation of a sentence to the given phrases, in
+   *  addition to the ones read from the reference files. Used for the
+   *  second pass of coarse-to-fine decoding. */
+  void SetConstraints(long translationId, const std::vector<Phrase> &constraints) const;
+  void ClearConstraints(long translationId) const;
+
+  /** Forced decoding: if the constraint is hard (not soft, negated or
+   *  allowing unknowns), the output of a phrase-based hypothesis can only
+   *  end up matching a reference if it is the start of one. Then the
+   *  options whose translation is in no reference are dropped
+   *  (RemoveUnreachable()) and hypotheses are only extended by phrases
+   *  that continue a reference where their output ends (Extends()), so
+   *  the search only builds hypotheses along the references.
+   *
+   *  This is stricter than the feature, which scores 0 any partial output
+   *  found anywhere in a reference. Such hypotheses can't reach the
+   *  reference but take up room in the stacks and the option limits, and
+   *  may push out the ones that do, so the output can differ from
+   *  decoding without the filters: the reference is found more often.
+   */
+  bool IsForcing() const {
+    return !m_negate && !m_soft && m_maxUnknowns == 0;
+  }
+
+  //! the forcing ConstrainedDecoding of the current weight setting, NULL if
+  //! there is none
+  static const ConstrainedDecoding *GetForcing();
+
+  //! the references of a sentence; throws if there are none
+  const std::vector<Phrase> &GetReferences(long translationId) const {
+    return *GetConstraint(translationId);
+  }
+
+  //! deletes the options whose translations are in none of refs; returns
+  //! their number
+  static size_t RemoveUnreachable(const std::vector<Phrase> &refs, TranslationOptionList &options);
+
+  //! whether the output of hypo followed by phrase starts one of refs;
+  //! with a single reference, hypo is taken to start it already
+  static bool Extends(const std::vector<Phrase> &refs, const Hypothesis &hypo, const Phrase &phrase);
+
 protected:
   std::vector<std::string> m_paths;
   std::map<long, std::vector<Phrase> > m_constraints;
+  mutable std::map<long, std::vector<Phrase> > m_sentenceConstraints; //!< see SetConstraints()
+#ifdef WITH_THREADS
+  mutable boost::shared_mutex m_accessLock;
+#endif
+
+  const std::vector<Phrase> *GetConstraint(long translationId) const;
   int m_maxUnknowns;
   bool m_negate; // only keep translations which DON'T match the reference
   bool m_soft;
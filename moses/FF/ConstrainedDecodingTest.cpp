@@ -0,0 +1,125 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ConstrainedDecoding.h"
+#include "moses/Hypothesis.h"
+#include "moses/Manager.h"
+#include "moses/MockHypothesis.h"
+#include "moses/ScoreComponentCollection.h"
+
+using namespace Moses;
+using namespace MosesTest;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(constrained_decoding)
+
+namespace
+{
+const string source = "x y z";
+
+Phrase MakePhrase(const string &str)
+{
+  vector<FactorType> factors(1, 0);
+  Phrase phrase(0);
+  phrase.CreateFromString(Output, factors, str, NULL);
+  return phrase;
+}
+
+float ScoreOf(const ConstrainedDecoding &cd, const Hypothesis &hypo)
+{
+  ScoreComponentCollection scores;
+  const FFState *state = cd.EvaluateWhenApplied(hypo, NULL, &scores);
+  delete state;
+  return scores.GetScoreForProducer(&cd);
+}
+}
+
+/* With the reference "a b c" for "x y z", the hypotheses "a b" (x y) and
+ * "b c" (y z) cover two source words each and the feature scores both 0,
+ * as their output is somewhere in the reference. A beam that keeps only
+ * "b c" has lost the reference: its one completion, "b c a", is -inf.
+ * The forcing search never builds "b c", so "a b" is left and completed
+ * to the reference. */
+BOOST_AUTO_TEST_CASE(forcing_keeps_reference_beam_loses)
+{
+  ConstrainedDecoding cd("ConstrainedDecoding");
+  BOOST_REQUIRE(cd.IsForcing());
+  const vector<Phrase> refs(1, MakePhrase("a b c"));
+
+  vector<Alignment> alignments;
+  vector<string> targets;
+  MockHypothesisGuard empty(source, alignments, targets);
+  const long translationId = (*empty)->GetManager().GetSource().GetTranslationId();
+  cd.SetConstraints(translationId, refs);
+
+  alignments.push_back(Alignment(0, 1));
+  targets.push_back("a b");
+  MockHypothesisGuard prefix(source, alignments, targets);
+  alignments.push_back(Alignment(2, 2));
+  targets.push_back("c");
+  MockHypothesisGuard reference(source, alignments, targets);
+
+  alignments.assign(1, Alignment(1, 2));
+  targets.assign(1, "b c");
+  MockHypothesisGuard infix(source, alignments, targets);
+  alignments.push_back(Alignment(0, 0));
+  targets.push_back("a");
+  MockHypothesisGuard lost(source, alignments, targets);
+
+  // baseline: the feature can't tell the two partial hypotheses apart ...
+  BOOST_CHECK_EQUAL(ScoreOf(cd, **prefix), 0);
+  BOOST_CHECK_EQUAL(ScoreOf(cd, **infix), 0);
+  // ... but only one of them leads to the reference
+  BOOST_CHECK_EQUAL(ScoreOf(cd, **reference), 0);
+  BOOST_CHECK_EQUAL(ScoreOf(cd, **lost), -numeric_limits<float>::infinity());
+
+  // forcing: "b c" is not built, "a b" is, and is completed
+  BOOST_CHECK(!ConstrainedDecoding::Extends(refs, **empty, MakePhrase("b c")));
+  BOOST_CHECK(ConstrainedDecoding::Extends(refs, **empty, MakePhrase("a b")));
+  BOOST_CHECK(ConstrainedDecoding::Extends(refs, **prefix, MakePhrase("c")));
+
+  cd.ClearConstraints(translationId);
+}
+
+BOOST_AUTO_TEST_CASE(forcing_several_references)
+{
+  ConstrainedDecoding cd("ConstrainedDecoding");
+  vector<Phrase> refs;
+  refs.push_back(MakePhrase("a b c"));
+  refs.push_back(MakePhrase("d b e"));
+
+  vector<Alignment> alignments(1, Alignment(0, 0));
+  vector<string> targets(1, "a");
+  MockHypothesisGuard a(source, alignments, targets);
+  alignments.push_back(Alignment(1, 1));
+  targets.push_back("b");
+  MockHypothesisGuard ab(source, alignments, targets);
+
+  // "a b" starts the first reference only
+  BOOST_CHECK(ConstrainedDecoding::Extends(refs, **a, MakePhrase("b")));
+  BOOST_CHECK(ConstrainedDecoding::Extends(refs, **ab, MakePhrase("c")));
+  BOOST_CHECK(!ConstrainedDecoding::Extends(refs, **ab, MakePhrase("e")));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
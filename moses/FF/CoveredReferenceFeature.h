@@ -44,6 +44,10 @@ public:
 
   void Load();
 
+  bool DependsOnSourceContext() const {
+    return true; // compares with the reference of the sentence
+  }
+
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
@@ -1,6 +1,6 @@
 
 #include "DistortionScoreProducer.h"
-#include "FFState.h"
+#include "DistortionState.h"
 #include "moses/WordsRange.h"
 #include "moses/StaticData.h"
 #include "moses/Hypothesis.h"
@@ -9,19 +9,6 @@ using namespace std;
 
 namespace Moses
 {
-struct DistortionState_traditional : public FFState {
-  WordsRange range;
-  int first_gap;
-  DistortionState_traditional(const WordsRange& wr, int fg) : range(wr), first_gap(fg) {}
-  int Compare(const FFState& other) const {
-    const DistortionState_traditional& o =
-      static_cast<const DistortionState_traditional&>(other);
-    if (range.GetEndPos() < o.range.GetEndPos()) return -1;
-    if (range.GetEndPos() > o.range.GetEndPos()) return 1;
-    return 0;
-  }
-};
-
 std::vector<const DistortionScoreProducer*> DistortionScoreProducer::s_staticColl;
 
 DistortionScoreProducer::DistortionScoreProducer(const std::string &line)
@@ -41,9 +28,7 @@ const FFState* DistortionScoreProducer::EmptyHypothesisState(const InputType &in
     start = 0;
     end = input.m_frontSpanCoveredLength -1;
   }
-  return new DistortionState_traditional(
-           WordsRange(start, end),
-           NOT_FOUND);
+  return new DistortionState(WordsRange(start, end));
 }
 
 float DistortionScoreProducer::CalculateDistortionScore(const Hypothesis& hypo,
@@ -95,17 +80,29 @@ FFState* DistortionScoreProducer::EvaluateWhenApplied(
   const FFState* prev_state,
   ScoreComponentCollection* out) const
 {
-  const DistortionState_traditional* prev = static_cast<const DistortionState_traditional*>(prev_state);
+  const DistortionState* prev = static_cast<const DistortionState*>(prev_state);
+  // the first gap when the previous phrase was added; only the early
+  // distortion cost needs it, and nothing was covered before the first
+  int firstGap = NOT_FOUND;
+  const Hypothesis *prevHypo = hypo.GetPrevHypo();
+  if (StaticData::Instance().UseEarlyDistortionCost() && prevHypo && prevHypo->GetPrevHypo()) {
+    firstGap = prevHypo->GetWordsBitmap().GetFirstGapPos();
+  }
   const float distortionScore = CalculateDistortionScore(
                                   hypo,
-                                  prev->range,
+                                  prev->GetRange(),
                                   hypo.GetCurrSourceWordsRange(),
-                                  prev->first_gap);
+                                  firstGap);
   out->PlusEquals(this, distortionScore);
-  DistortionState_traditional* res = new DistortionState_traditional(
-    hypo.GetCurrSourceWordsRange(),
-    hypo.GetWordsBitmap().GetFirstGapPos());
-  return res;
+  // the state is the range of this hypothesis, which it holds already;
+  // Hypothesis never deletes it
+  return const_cast<DistortionState*>(&hypo.GetDistortionState());
+}
+
+void DistortionScoreProducer::WriteStateKey(const FFState &state, uint32_t *key) const
+{
+  // states compare by the end of the last translated phrase only
+  key[0] = static_cast<const DistortionState&>(state).GetRange().GetEndPos();
 }
 
 
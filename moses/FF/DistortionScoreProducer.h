@@ -47,6 +47,16 @@ public:
     throw std::logic_error("DistortionScoreProducer not supported in chart decoder, yet");
   }
 
+  size_t GetStateKeySize() const {
+    return 1;
+  }
+
+  void WriteStateKey(const FFState &state, uint32_t *key) const;
+
+  bool HasStateHash() const {
+    return true;
+  }
+
   void EvaluateWithSourceContext(const InputType &input
                                  , const InputPath &inputPath
                                  , const TargetPhrase &targetPhrase
@@ -0,0 +1,39 @@
+// -*- c++ -*-
+#pragma once
+
+#include "FFState.h"
+#include "moses/WordsRange.h"
+
+namespace Moses
+{
+
+/** State of DistortionScoreProducer: the source range of the last phrase.
+ *  Every Hypothesis holds one, set from its own range when it is created,
+ *  so the feature does not allocate a state per hypothesis; only the state
+ *  of the initial hypothesis comes from EmptyHypothesisState().
+ */
+class DistortionState : public FFState
+{
+public:
+  explicit DistortionState(const WordsRange &range) : m_range(range) {}
+
+  const WordsRange &GetRange() const {
+    return m_range;
+  }
+
+  int Compare(const FFState& other) const {
+    const DistortionState &o = static_cast<const DistortionState&>(other);
+    if (m_range.GetEndPos() < o.m_range.GetEndPos()) return -1;
+    if (m_range.GetEndPos() > o.m_range.GetEndPos()) return 1;
+    return 0;
+  }
+
+  size_t hash() const {
+    return m_range.GetEndPos();
+  }
+
+private:
+  WordsRange m_range;
+};
+
+}
@@ -17,6 +17,8 @@ DynamicCacheBasedLanguageModel::DynamicCacheBasedLanguageModel(const std::string
   m_query_type = CBLM_QUERY_TYPE_ALLSUBSTRINGS;
   m_score_type = CBLM_SCORE_TYPE_HYPERBOLA;
   m_maxAge = 1000;
+  m_clock = 0;
+  m_lastPurge = 0;
   m_name = "default";
   m_constant = false;
 
@@ -33,7 +35,7 @@ DynamicCacheBasedLanguageModel::~DynamicCacheBasedLanguageModel() {};
 void DynamicCacheBasedLanguageModel::SetPreComputedScores()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   precomputedScores.clear();
   for (unsigned int i=0; i<m_maxAge; i++) {
@@ -52,7 +54,7 @@ void DynamicCacheBasedLanguageModel::SetPreComputedScores()
   VERBOSE(3, "SetPreComputedScores(): lower_age:|" << m_maxAge << "| lower_score:|" << m_lower_score << "|" << std::endl);
 }
 
-float DynamicCacheBasedLanguageModel::GetPreComputedScores(const unsigned int age)
+float DynamicCacheBasedLanguageModel::GetPreComputedScores(const unsigned int age) const
 {
   VERBOSE(2, "float DynamicCacheBasedLanguageModel::GetPreComputedScores" << std::endl);
   VERBOSE(2, "age:|"<< age << "|" << std::endl);
@@ -65,6 +67,12 @@ float DynamicCacheBasedLanguageModel::GetPreComputedScores(const unsigned int ag
   }
 }
 
+float DynamicCacheBasedLanguageModel::GetScore(decaying_cache_t::const_iterator it) const
+{
+  // an entry past m_maxAge scores m_lower_score, as if it had been removed
+  return GetPreComputedScores(m_clock - it->second);
+}
+
 void DynamicCacheBasedLanguageModel::SetParameter(const std::string& key, const std::string& value)
 {
   VERBOSE(2, "DynamicCacheBasedLanguageModel::SetParameter key:|" << key << "| value:|" << value << "|" << std::endl);
@@ -90,6 +98,9 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
     , ScoreComponentCollection &scoreBreakdown
     , ScoreComponentCollection &estimatedFutureScore) const
 {
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+#endif
   float score = m_lower_score;
   switch(m_query_type) {
   case CBLM_QUERY_TYPE_WHOLESTRING:
@@ -126,7 +137,7 @@ float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase&
 
   VERBOSE(4,"cblm::Evaluate_Whole_String: searching w:|" << w << "|" << std::endl);
   if (it != m_cache.end()) { //found!
-    score = ((*it).second).second;
+    score = GetScore(it);
     VERBOSE(4,"cblm::Evaluate_Whole_String: found w:|" << w << "|" << std::endl);
   }
 
@@ -150,8 +161,9 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
       it = m_cache.find(w);
 
       if (it != m_cache.end()) { //found!
-        score += ((*it).second).second;
-        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << ((*it).second).second << "| score:|" << score << "|" << std::endl);
+        float actual = GetScore(it);
+        score += actual;
+        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << actual << "| score:|" << score << "|" << std::endl);
       } else {
         score += m_lower_score;
       }
@@ -175,29 +187,24 @@ void DynamicCacheBasedLanguageModel::Print() const
   std::cout << "Content of the cache of Cache-Based Language Model" << std::endl;
   std::cout << "Size of the cache of Cache-Based Language Model:|" << m_cache.size() << "|" << std::endl;
   for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    std::cout << "word:|" << (*it).first << "| age:|" << ((*it).second).first << "| score:|" << ((*it).second).second << "|" << std::endl;
+    std::cout << "word:|" << (*it).first << "| age:|" << m_clock - (*it).second << "| score:|" << GetScore(it) << "|" << std::endl;
   }
 }
 
 void DynamicCacheBasedLanguageModel::Decay()
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  decaying_cache_t::iterator it;
-
-  unsigned int age;
-  float score;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    age=((*it).second).first + 1;
-    if (age > m_maxAge) {
-      m_cache.erase(it);
-      it--;
+  ++m_clock;
+  if (m_clock - m_lastPurge < (long) m_maxAge) {
+    return;
+  }
+  // every entry is swept at most once per m_maxAge insertions
+  m_lastPurge = m_clock;
+  decaying_cache_t::iterator it = m_cache.begin();
+  while (it != m_cache.end()) {
+    if (m_clock - it->second > (long) m_maxAge) {
+      it = m_cache.erase(it);
     } else {
-      score = GetPreComputedScores(age);
-//      score = decaying_score(age);
-      decaying_cache_value_t p (age, score);
-      (*it).second = p;
+      ++it;
     }
   }
 }
@@ -205,18 +212,18 @@ void DynamicCacheBasedLanguageModel::Decay()
 void DynamicCacheBasedLanguageModel::Update(std::vector<std::string> words, int age)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
+  UpdateLocked(words, age);
+}
+
+void DynamicCacheBasedLanguageModel::UpdateLocked(std::vector<std::string> &words, int age)
+{
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
-//    VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " decaying_score(age):" << decaying_score(age) << std::endl);
-//    decaying_cache_value_t p (age,decaying_score(age));
     VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " GetPreComputedScores(age):" << GetPreComputedScores(age) << std::endl);
-    decaying_cache_value_t p (age,GetPreComputedScores(age));
-    std::pair<std::string, decaying_cache_value_t> e (words[j],p);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
-    m_cache.insert(e); //insert the entry
+    m_cache[words[j]] = m_clock - age; //overwrite the entry if it exists
   }
 }
 
@@ -233,7 +240,7 @@ void DynamicCacheBasedLanguageModel::ClearEntries(std::string &entries)
 void DynamicCacheBasedLanguageModel::ClearEntries(std::vector<std::string> words)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
@@ -256,10 +263,16 @@ void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
 void DynamicCacheBasedLanguageModel::Insert(std::vector<std::string> ngrams)
 {
   VERBOSE(3,"DynamicCacheBasedLanguageModel Insert ngrams.size():|" << ngrams.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
+  {
+#ifdef WITH_THREADS
+    // the whole batch is one update
+    boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
+#endif
+    if (m_constant == false) {
+      Decay();
+    }
+    UpdateLocked(ngrams,1);
   }
-  Update(ngrams,1);
   IFVERBOSE(3) Print();
 }
 
@@ -318,7 +331,7 @@ void DynamicCacheBasedLanguageModel::Execute_Single_Command(std::string command)
 void DynamicCacheBasedLanguageModel::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   m_cache.clear();
 }
@@ -384,7 +397,7 @@ void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
 void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
 
   m_query_type = type;
@@ -400,7 +413,7 @@ void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   m_score_type = type;
   if ( m_score_type != CBLM_SCORE_TYPE_HYPERBOLA
@@ -419,7 +432,7 @@ void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 void DynamicCacheBasedLanguageModel::SetMaxAge(unsigned int age)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   m_maxAge = age;
   VERBOSE(2, "CacheBasedLanguageModel MaxAge:  " << m_maxAge << std::endl);
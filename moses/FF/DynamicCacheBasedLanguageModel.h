@@ -6,13 +6,15 @@
 #include "moses/Util.h"
 #include "FeatureFunction.h"
 
+#include <boost/unordered_map.hpp>
+
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/locks.hpp>
 #endif
 
-typedef std::pair<int, float> decaying_cache_value_t;
-typedef std::map<std::string, decaying_cache_value_t > decaying_cache_t;
+// the n-gram, and the value of the cache clock when its age was 0
+typedef boost::unordered_map<std::string, long> decaying_cache_t;
 
 #define CBLM_QUERY_TYPE_UNDEFINED (-1)
 #define CBLM_QUERY_TYPE_ALLSUBSTRINGS 0
@@ -38,8 +40,12 @@ class WordsRange;
 class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
 {
   // data structure for the cache;
-  // the key is the word and the value is the decaying score
+  // the age of an entry is m_clock minus its value: ages are not rewritten
+  // on each insertion, and entries older than m_maxAge are dropped by an
+  // occasional sweep
   decaying_cache_t m_cache;
+  long m_clock;
+  long m_lastPurge;
   size_t m_query_type; //way of querying the cache
   size_t m_score_type; //way of scoring entries of the cache
   std::string m_initfiles; // vector of files loaded in the initialization phase
@@ -56,13 +62,16 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
 
   float decaying_score(unsigned int age);
   void SetPreComputedScores();
-  float GetPreComputedScores(const unsigned int age);
+  float GetPreComputedScores(const unsigned int age) const;
+  float GetScore(decaying_cache_t::const_iterator it) const;
 
   float Evaluate_Whole_String( const TargetPhrase&) const;
   float Evaluate_All_Substrings( const TargetPhrase&) const;
 
+  // the caller holds m_cacheLock for writing
   void Decay();
   void Update(std::vector<std::string> words, int age);
+  void UpdateLocked(std::vector<std::string> &words, int age);
 
   void ClearEntries(std::vector<std::string> entries);
 
@@ -115,6 +124,10 @@ public:
     return *s_instance;
   }
 
+  bool DependsOnSourceContext() const {
+    return true; // the cache is updated between inputs
+  }
+
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
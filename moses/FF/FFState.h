@@ -1,6 +1,7 @@
 #ifndef moses_FFState_h
 #define moses_FFState_h
 
+#include <cstddef>
 #include <vector>
 
 
@@ -12,6 +13,14 @@ class FFState
 public:
   virtual ~FFState();
   virtual int Compare(const FFState& other) const = 0;
+
+  /** Hash for recombination in hashed hypothesis stacks: states for
+   *  which Compare() returns 0 must hash equally. The default, 0, is
+   *  always correct but leaves it to the other states to tell
+   *  hypotheses apart. */
+  virtual std::size_t hash() const {
+    return 0;
+  }
 };
 
 class DummyState : public FFState
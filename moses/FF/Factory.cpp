@@ -59,6 +59,7 @@
 #include "moses/FF/SkeletonStatelessFF.h"
 #include "moses/FF/SkeletonStatefulFF.h"
 #include "moses/LM/SkeletonLM.h"
+#include "moses/LM/Remote.h"
 #include "moses/FF/SkeletonTranslationOptionListFeature.h"
 #include "moses/LM/BilingualLM.h"
 #include "SkeletonChangeInput.h"
@@ -91,6 +92,7 @@
 #endif
 
 #include "moses/LM/Ken.h"
+#include "moses/LM/FusedKen.h"
 #ifdef LM_IRST
 #include "moses/LM/IRST.h"
 #endif
@@ -181,6 +183,14 @@ public:
   }
 };
 
+class FusedKenFactory : public FeatureFactory
+{
+public:
+  void Create(const std::string &line) {
+    DefaultSetup(ConstructFusedKenLM(line));
+  }
+};
+
 } // namespace
 
 FeatureRegistry::FeatureRegistry()
@@ -249,6 +259,7 @@ FeatureRegistry::FeatureRegistry()
   MOSES_FNAME(SkeletonStatelessFF);
   MOSES_FNAME(SkeletonStatefulFF);
   MOSES_FNAME(SkeletonLM);
+  MOSES_FNAME2("RemoteLM", LanguageModelRemote);
   MOSES_FNAME(SkeletonChangeInput);
   MOSES_FNAME(SkeletonTranslationOptionListFeature);
   MOSES_FNAME(SkeletonPT);
@@ -310,6 +321,7 @@ FeatureRegistry::FeatureRegistry()
 #endif
 
   Add("KENLM", new KenFactory());
+  Add("FusedKENLM", new FusedKenFactory());
 }
 
 FeatureRegistry::~FeatureRegistry()
@@ -87,6 +87,7 @@ Initialize(const std::string &line)
   ParseLine(line);
 
   ScoreComponentCollection::RegisterScoreProducer(this);
+  m_index = s_staticColl.size();
   s_staticColl.push_back(this);
 }
 
@@ -161,6 +162,11 @@ void FeatureFunction::ReadParameters()
   }
 }
 
+void FeatureFunction::Reload(const std::string &path)
+{
+  UTIL_THROW2(GetScoreProducerDescription() << " cannot be reloaded");
+}
+
 std::vector<float> FeatureFunction::DefaultWeights() const
 {
   UTIL_THROW2(GetScoreProducerDescription() << ": No default weights");
@@ -28,6 +28,7 @@ class InputPath;
 class StackVec;
 class DistortionScoreProducer;
 class TranslationTask; 
+struct MemoryUsage;
 
 /** base class for all feature functions.
  */
@@ -45,6 +46,7 @@ protected:
   size_t m_numScoreComponents;
   std::vector<bool> m_tuneableComponents;
   size_t m_numTuneableComponents;
+  size_t m_index; //!< position in GetFeatureFunctions()
   //In case there's multiple producers with the same description
   static std::multiset<std::string> description_counts;
 
@@ -57,6 +59,10 @@ public:
   }
 
   static FeatureFunction &FindFeatureFunction(const std::string& name);
+
+  size_t GetIndex() const {
+    return m_index;
+  }
   static void Destroy();
 
   static void CallChangeSource(InputType * const&input);
@@ -71,6 +77,41 @@ public:
   virtual void Load() {
   }
 
+  /** Replace the model by the one in path (the file it was loaded from if
+   *  path is empty) while decoding goes on. Sentences already being decoded
+   *  keep using the old model, which is freed after the last of them.
+   *  Throws unless overridden.
+   */
+  virtual void Reload(const std::string &path);
+
+  //! false if Load() looks at other feature functions, so it must not run
+  //! concurrently with them (see -parallel-load)
+  virtual bool LoadsIndependently() const {
+    return true;
+  }
+
+  //! false if any of the Evaluate*() functions called during decoding
+  //! (EvaluateWithSourceContext(),
+  //! EvaluateTranslationOptionListWithSourceContext(), EvaluateWhenApplied())
+  //! rely on state that InitializeForInput() keeps per thread, e.g. in a
+  //! boost::thread_specific_ptr, so they must run on the thread decoding the
+  //! sentence (see -cube-pruning-threads, -search-threads)
+  virtual bool CanEvaluateOnAnyThread() const {
+    return true;
+  }
+
+  //! true if the scores of a translation option depend on more than its
+  //! source span, e.g. on the rest of the sentence, or if the options
+  //! themselves change between inputs (see -translation-option-cache)
+  virtual bool DependsOnSourceContext() const {
+    return false;
+  }
+
+  //! adds the memory the feature holds to usage (see MemoryReport); the
+  //! caches of other threads are not counted
+  virtual void ReportMemory(MemoryUsage &/*usage*/) const {
+  }
+
   static void ResetDescriptionCounts() {
     description_counts.clear();
   }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include "GlobalLexicalModel.h"
 #include "moses/StaticData.h"
@@ -5,6 +6,7 @@
 #include "moses/TranslationOption.h"
 #include "moses/FactorCollection.h"
 #include "util/exception.hh"
+#include "util/murmur_hash.hh"
 
 using namespace std;
 
@@ -18,10 +20,10 @@ GlobalLexicalModel::GlobalLexicalModel(const std::string &line)
 
   // define bias word
   FactorCollection &factorCollection = FactorCollection::Instance();
-  m_bias = new Word();
+  Word bias;
   const Factor* factor = factorCollection.AddFactor( Input, m_inputFactorsVec[0], "**BIAS**" );
-  m_bias->SetFactor( m_inputFactorsVec[0], factor );
-
+  bias.SetFactor( m_inputFactorsVec[0], factor );
+  m_bias = HashWord( bias, m_inputFactorsVec );
 }
 
 void GlobalLexicalModel::SetParameter(const std::string& key, const std::string& value)
@@ -39,15 +41,21 @@ void GlobalLexicalModel::SetParameter(const std::string& key, const std::string&
 
 GlobalLexicalModel::~GlobalLexicalModel()
 {
-  // delete words in the hash data structure
-  DoubleHash::const_iterator iter;
-  for(iter = m_hash.begin(); iter != m_hash.end(); iter++ ) {
-    map< const Word*, float, WordComparer >::const_iterator iter2;
-    for(iter2 = iter->second.begin(); iter2 != iter->second.end(); iter2++ ) {
-      delete iter2->first; // delete input word
-    }
-    delete iter->first; // delete output word
+}
+
+uint64_t GlobalLexicalModel::HashWord(const Word &word, const std::vector<FactorType> &factors)
+{
+  const Factor *used[MAX_NUM_FACTORS];
+  for (size_t i = 0; i < factors.size(); ++i) {
+    used[i] = word[factors[i]];
   }
+  return util::MurmurHashNative(used, factors.size() * sizeof(const Factor*));
+}
+
+uint64_t GlobalLexicalModel::MakeKey(uint64_t outWord, uint64_t inWord)
+{
+  uint64_t key = util::MurmurHashNative(&inWord, sizeof(inWord), outWord);
+  return key ? key : 1; // 0 is the empty bucket
 }
 
 void GlobalLexicalModel::Load()
@@ -62,6 +70,7 @@ void GlobalLexicalModel::Load()
   InputFileStream inFile(m_filePath);
 
   // reading in data one line at a time
+  std::vector<Entry> entries;
   size_t lineNum = 0;
   string line;
   while(getline(inFile, line)) {
@@ -73,79 +82,91 @@ void GlobalLexicalModel::Load()
     }
 
     // create the output word
-    Word *outWord = new Word();
+    Word outWord;
     vector<string> factorString = Tokenize( token[0], factorDelimiter );
     for (size_t i=0 ; i < m_outputFactorsVec.size() ; i++) {
       const FactorDirection& direction = Output;
       const FactorType& factorType = m_outputFactorsVec[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      outWord->SetFactor( factorType, factor );
+      outWord.SetFactor( factorType, factor );
     }
 
     // create the input word
-    Word *inWord = new Word();
+    Word inWord;
     factorString = Tokenize( token[1], factorDelimiter );
     for (size_t i=0 ; i < m_inputFactorsVec.size() ; i++) {
       const FactorDirection& direction = Input;
       const FactorType& factorType = m_inputFactorsVec[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      inWord->SetFactor( factorType, factor );
+      inWord.SetFactor( factorType, factor );
     }
 
     // maximum entropy feature score
     float score = Scan<float>(token[2]);
 
-    // std::cerr << "storing word " << *outWord << " " << *inWord << " " << score << endl;
-
     // store feature in hash
-    DoubleHash::iterator keyOutWord = m_hash.find( outWord );
-    if( keyOutWord == m_hash.end() ) {
-      m_hash[outWord][inWord] = score;
-    } else { // already have hash for outword, delete the word to avoid leaks
-      (keyOutWord->second)[inWord] = score;
-      delete outWord;
-    }
+    Entry entry;
+    entry.key = MakeKey( HashWord( outWord, m_outputFactorsVec ), HashWord( inWord, m_inputFactorsVec ) );
+    entry.weight = score;
+    entries.push_back( entry );
+  }
+
+  Entry empty;
+  empty.key = 0;
+  empty.weight = 0;
+  m_buckets.assign( Table::Size( entries.size(), 1.5 ) / sizeof(Entry), empty );
+  m_table = Table( &m_buckets[0], m_buckets.size() * sizeof(Entry) );
+  for (size_t i = 0; i < entries.size(); ++i) {
+    Table::MutableIterator it;
+    // later lines win, as they did with the std::map
+    if (m_table.FindOrInsert( entries[i], it )) it->weight = entries[i].weight;
   }
 }
 
 void GlobalLexicalModel::InitializeForInput( Sentence const& in )
 {
   m_local.reset(new ThreadLocalStorage);
-  m_local->input = &in;
+
+  // do not score an input word twice
+  std::vector<uint64_t> &inputWords = m_local->inputWords;
+  inputWords.push_back( m_bias );
+  for(size_t inputIndex = 0; inputIndex < in.GetSize(); inputIndex++ ) {
+    inputWords.push_back( HashWord( in.GetWord( inputIndex ), m_inputFactorsVec ) );
+  }
+  std::sort( inputWords.begin(), inputWords.end() );
+  inputWords.erase( std::unique( inputWords.begin(), inputWords.end() ), inputWords.end() );
+}
+
+float GlobalLexicalModel::ScoreWord( uint64_t outWord ) const
+{
+  WordCache &wordCache = m_local->wordCache;
+  const WordCache::const_iterator query = wordCache.find( outWord );
+  if ( query != wordCache.end() ) {
+    return query->second;
+  }
+
+  const std::vector<uint64_t> &inputWords = m_local->inputWords;
+  float sum = 0;
+  for(size_t i = 0; i < inputWords.size(); i++ ) {
+    Table::ConstIterator it;
+    if ( m_table.Find( MakeKey( outWord, inputWords[i] ), it ) ) {
+      sum += it->weight;
+    }
+  }
+  // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
+  float score = FloorScore( log(1/(1+exp(-sum))) );
+  wordCache.insert( std::make_pair( outWord, score ) );
+  return score;
 }
 
 float GlobalLexicalModel::ScorePhrase( const TargetPhrase& targetPhrase ) const
 {
-  const Sentence& input = *(m_local->input);
   float score = 0;
   for(size_t targetIndex = 0; targetIndex < targetPhrase.GetSize(); targetIndex++ ) {
-    float sum = 0;
     const Word& targetWord = targetPhrase.GetWord( targetIndex );
-    VERBOSE(2,"glm " << targetWord << ": ");
-    const DoubleHash::const_iterator targetWordHash = m_hash.find( &targetWord );
-    if( targetWordHash != m_hash.end() ) {
-      SingleHash::const_iterator inputWordHash = targetWordHash->second.find( m_bias );
-      if( inputWordHash != targetWordHash->second.end() ) {
-        VERBOSE(2,"*BIAS* " << inputWordHash->second);
-        sum += inputWordHash->second;
-      }
-
-      set< const Word*, WordComparer > alreadyScored; // do not score a word twice
-      for(size_t inputIndex = 0; inputIndex < input.GetSize(); inputIndex++ ) {
-        const Word& inputWord = input.GetWord( inputIndex );
-        if ( alreadyScored.find( &inputWord ) == alreadyScored.end() ) {
-          SingleHash::const_iterator inputWordHash = targetWordHash->second.find( &inputWord );
-          if( inputWordHash != targetWordHash->second.end() ) {
-            VERBOSE(2," " << inputWord << " " << inputWordHash->second);
-            sum += inputWordHash->second;
-          }
-          alreadyScored.insert( &inputWord );
-        }
-      }
-    }
-    // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
-    VERBOSE(2," p=" << FloorScore( log(1/(1+exp(-sum))) ) << endl);
-    score += FloorScore( log(1/(1+exp(-sum))) );
+    float wordScore = ScoreWord( HashWord( targetWord, m_outputFactorsVec ) );
+    VERBOSE(2,"glm " << targetWord << ": p=" << wordScore << endl);
+    score += wordScore;
   }
   return score;
 }
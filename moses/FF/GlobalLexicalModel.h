@@ -14,6 +14,10 @@
 #include "moses/FactorTypeSet.h"
 #include "moses/Sentence.h"
 
+#include <boost/unordered_map.hpp>
+
+#include "util/probing_hash_table.hh"
+
 #ifdef WITH_THREADS
 #include <boost/thread/tss.hpp>
 #endif
@@ -33,23 +37,40 @@ class InputType;
  */
 class GlobalLexicalModel : public StatelessFeatureFunction
 {
-  typedef std::map< const Word*, std::map< const Word*, float, WordComparer >, WordComparer > DoubleHash;
-  typedef std::map< const Word*, float, WordComparer > SingleHash;
-  typedef std::map< const TargetPhrase*, float > LexiconCache;
+  // A weight, keyed by a hash of the (output word, input word) pair.
+  struct Entry {
+    typedef uint64_t Key;
+    uint64_t key; //!< 0 marks an empty bucket
+    float weight;
+    Key GetKey() const {
+      return key;
+    }
+    void SetKey(Key k) {
+      key = k;
+    }
+  };
+  typedef util::ProbingHashTable<Entry, util::IdentityHash> Table;
+
+  typedef boost::unordered_map< const TargetPhrase*, float > LexiconCache;
+  typedef boost::unordered_map< uint64_t, float > WordCache;
 
   struct ThreadLocalStorage {
+    //! hashes of the distinct input words of the sentence, and the bias
+    std::vector<uint64_t> inputWords;
+    //! score of an output word given the sentence, by hash of the word
+    WordCache wordCache;
     LexiconCache cache;
-    const Sentence *input;
   };
 
 private:
-  DoubleHash m_hash;
+  std::vector<Entry> m_buckets;
+  Table m_table;
 #ifdef WITH_THREADS
   boost::thread_specific_ptr<ThreadLocalStorage> m_local;
 #else
   std::auto_ptr<ThreadLocalStorage> m_local;
 #endif
-  Word *m_bias;
+  uint64_t m_bias;
 
   FactorMask m_inputFactors, m_outputFactors;
   std::vector<FactorType> m_inputFactorsVec, m_outputFactorsVec;
@@ -57,6 +78,11 @@ private:
 
   void Load();
 
+  //! hash of the given factors of a word
+  static uint64_t HashWord(const Word &word, const std::vector<FactorType> &factors);
+  static uint64_t MakeKey(uint64_t outWord, uint64_t inWord);
+
+  float ScoreWord( uint64_t outWord ) const;
   float ScorePhrase( const TargetPhrase& targetPhrase ) const;
   float GetFromCacheOrScorePhrase( const TargetPhrase& targetPhrase ) const;
 
@@ -68,6 +94,10 @@ public:
 
   void InitializeForInput( Sentence const& in );
 
+  bool CanEvaluateOnAnyThread() const {
+    return false; // sentence data is thread-local
+  }
+
   bool IsUseable(const FactorMask &mask) const;
 
   void EvaluateInIsolation(const Phrase &source
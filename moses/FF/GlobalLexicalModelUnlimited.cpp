@@ -126,13 +126,20 @@ void GlobalLexicalModelUnlimited::EvaluateWhenApplied(const Hypothesis& cur_hypo
         continue;
     }
 
+    const Factor *targetFactor = targetPhrase.GetWord(targetIndex).GetFactor(0);
     if (m_biasFeature) {
-      stringstream feature;
-      feature << "glm_";
-      feature << targetString;
-      feature << "~";
-      feature << "**BIAS**";
-      accumulator->SparsePlusEquals(feature.str(), 1);
+      SparseFeatureNames::Key key(0);
+      key.Add(targetFactor);
+      const FName *name = m_names.Find(key);
+      if (name == NULL) {
+        stringstream feature;
+        feature << "glm_";
+        feature << targetString;
+        feature << "~";
+        feature << "**BIAS**";
+        name = &m_names.Add(key, feature.str());
+      }
+      accumulator->SparsePlusEquals(*name, 1);
     }
 
     boost::unordered_set<uint64_t> alreadyScored;
@@ -300,12 +307,19 @@ void GlobalLexicalModelUnlimited::EvaluateWhenApplied(const Hypothesis& cur_hypo
               }
             }
           } else {
-            stringstream feature;
-            feature << "glm_";
-            feature << targetString;
-            feature << "~";
-            feature << sourceString;
-            accumulator->SparsePlusEquals(feature.str(), 1);
+            SparseFeatureNames::Key key(1);
+            key.Add(targetFactor);
+            key.Add(input.GetWord(sourceIndex).GetFactor(0));
+            const FName *name = m_names.Find(key);
+            if (name == NULL) {
+              stringstream feature;
+              feature << "glm_";
+              feature << targetString;
+              feature << "~";
+              feature << sourceString;
+              name = &m_names.Add(key, feature.str());
+            }
+            accumulator->SparsePlusEquals(*name, 1);
             alreadyScored.insert(sourceHash);
 
           }
@@ -17,6 +17,7 @@
 #include "moses/Sentence.h"
 
 #include "moses/FF/FFState.h"
+#include "moses/FF/SparseFeatureNames.h"
 
 #ifdef WITH_THREADS
 #include <boost/thread/tss.hpp>
@@ -53,6 +54,7 @@ private:
 #endif
 
   CharHash m_punctuationHash;
+  SparseFeatureNames m_names;
 
   std::vector< FactorType > m_inputFactors;
   std::vector< FactorType > m_outputFactors;
@@ -75,6 +77,10 @@ public:
 
   void InitializeForInput( Sentence const& in );
 
+  bool CanEvaluateOnAnyThread() const {
+    return false; // sentence data is thread-local
+  }
+
   const FFState* EmptyHypothesisState(const InputType &) const {
     return new DummyState();
   }
@@ -36,6 +36,8 @@ LexicalReordering(const std::string &line)
       m_factorsE =Tokenize<FactorType>(args[1]);
     else if (args[0] == "path")
       m_filePath = args[1];
+    else if (args[0] == "image")
+      m_imagePath = args[1];
     else if (starts_with(args[0], "sparse-"))
       sparseArgs[args[0].substr(7)] = args[1];
     else if (args[0] == "default-scores") {
@@ -72,6 +74,7 @@ LexicalReordering(const std::string &line)
                  << m_configuration->GetNumScoreComponents() << ")");
 
   m_configuration->ConfigureSparse(sparseArgs, this);
+  m_scoreIndex = ScoreComponentCollection::GetIndexes(this).first;
 }
 
 LexicalReordering::
@@ -84,7 +87,8 @@ Load()
 {
   typedef LexicalReorderingTable LRTable;
   m_table.reset(LRTable::LoadAvailable(m_filePath, m_factorsF,
-                                       m_factorsE, std::vector<FactorType>()));
+                                       m_factorsE, std::vector<FactorType>(),
+                                       m_imagePath));
 }
 
 Scores
@@ -101,11 +105,9 @@ EvaluateWhenApplied(const Hypothesis& hypo,
                     ScoreComponentCollection* out) const
 {
   VERBOSE(3,"LexicalReordering::Evaluate(const Hypothesis& hypo,...) START" << std::endl);
-  Scores score(GetNumScoreComponents(), 0);
-  const LRState *prev = dynamic_cast<const LRState *>(prev_state);
+  const LRState *prev = static_cast<const LRState *>(prev_state);
   LRState *next_state = prev->Expand(hypo.GetTranslationOption(), hypo.GetInput(), out);
 
-  out->PlusEquals(this, score);
   VERBOSE(3,"LexicalReordering::Evaluate(const Hypothesis& hypo,...) END" << std::endl);
 
   return next_state;
@@ -141,8 +143,20 @@ void
 LexicalReordering::
 SetCache(TranslationOptionList& tol) const
 {
-  BOOST_FOREACH(TranslationOption* to, tol) 
-    this->SetCache(*to);
+  // look up all options with the same source phrase in one call
+  std::vector<const Phrase*> tphrases;
+  std::vector<Scores> scores;
+  TranslationOptionList::iterator i = tol.begin();
+  while (i != tol.end()) {
+    Phrase const& sphrase = (*i)->GetInputPath().GetPhrase();
+    TranslationOptionList::iterator end = i;
+    tphrases.clear();
+    for (; end != tol.end() && &(*end)->GetInputPath().GetPhrase() == &sphrase; ++end)
+      tphrases.push_back(&(*end)->GetTargetPhrase());
+    m_table->GetScores(sphrase, tphrases, scores);
+    for (size_t k = 0; i != end; ++i, ++k)
+      (*i)->CacheLexReorderingScores(*this, scores[k]);
+  }
 }
 
 
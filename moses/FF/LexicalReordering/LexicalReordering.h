@@ -48,6 +48,11 @@ public:
     m_table->InitializeForInput(i);
   }
 
+  bool
+  CanEvaluateOnAnyThread() const {
+    return m_table->CanBeUsedOnAnyThread();
+  }
+
   Scores
   GetProb(const Phrase& f, const Phrase& e) const;
 
@@ -57,6 +62,27 @@ public:
                       const FFState* prev_state,
                       ScoreComponentCollection* accumulator) const;
 
+  //! the states of phrase-based and forward hierarchical models have a
+  //! fixed size, see LRModel::GetStateKeySize()
+  virtual
+  size_t
+  GetStateKeySize() const {
+    return m_configuration->GetStateKeySize();
+  }
+
+  virtual
+  void
+  WriteStateKey(const FFState &state, uint32_t *key) const {
+    static_cast<const LRState&>(state).WriteStateKey(key);
+  }
+
+  //! every LRState implements hash()
+  virtual
+  bool
+  HasStateHash() const {
+    return true;
+  }
+
   virtual
   FFState*
   EvaluateWhenApplied(const ChartHypothesis&, int featureID,
@@ -96,6 +122,12 @@ public:
     return m_defaultScores[i];
   }
 
+  //! index of the first score of the feature in the dense score vector
+  size_t
+  GetScoreIndex() const {
+    return m_scoreIndex;
+  }
+
   virtual
   void
   SetCache(TranslationOption& to) const;
@@ -116,8 +148,10 @@ private:
   std::vector<LRModel::Condition> m_condition;
   std::vector<FactorType> m_factorsE, m_factorsF;
   std::string m_filePath;
+  std::string m_imagePath; //!< image of an in-memory table, shared across processes
   bool m_haveDefaultScores;
   Scores m_defaultScores;
+  size_t m_scoreIndex;
 };
 
 }
@@ -1,6 +1,8 @@
 // -*- c++ -*-
 #include <vector>
 #include <string>
+#include <cstring>
+#include <boost/functional/hash.hpp>
 
 #include "moses/FF/FFState.h"
 #include "moses/Hypothesis.h"
@@ -51,6 +53,19 @@ GetNumScoreComponents() const
           : score_per_dir + m_additionalScoreComponents);
 }
 
+size_t
+LRModel::
+GetStateKeySize() const
+{
+  // backward states remember the last range, forward states the last range
+  // and the scores of the last option
+  size_t bwd = m_phraseBased ? LRState::RANGE_KEY_SIZE : 0;
+  size_t fwd = LRState::RANGE_KEY_SIZE + 1 + GetNumberOfTypes();
+  return ((m_direction == Forward) ? fwd :
+          (bwd == 0) ? 0 :
+          (m_direction == Backward) ? bwd : bwd + fwd);
+}
+
 void
 LRModel::
 ConfigureSparse(const std::map<std::string,std::string>& sparseArgs,
@@ -238,8 +253,7 @@ CopyScores(ScoreComponentCollection*  accum,
   LexicalReordering* producer = m_configuration.GetScoreProducer();
   Scores const* cached = relevantOpt->GetLexReorderingScores(producer);
 
-  // The approach here is bizarre! Why create a whole vector and do
-  // vector addition (acumm->PlusEquals) to update a single value? - UG
+  // only one score changes, add it in place
   size_t off_remote = m_offset + reoType;
   size_t off_local  = m_configuration.CollapseScores() ? m_offset : off_remote;
 
@@ -248,16 +262,13 @@ CopyScores(ScoreComponentCollection*  accum,
 
   // look up applicable score from vectore of scores
   if(cached) {
-    Scores scores(producer->GetNumScoreComponents(),0);
-    scores[off_local ] = (*cached)[off_remote];
-    accum->PlusEquals(producer, scores);
+    accum->PlusEquals(producer->GetScoreIndex() + off_local, (*cached)[off_remote]);
   }
 
   // else: use default scores (if specified)
   else if (producer->GetHaveDefaultScores()) {
-    Scores scores(producer->GetNumScoreComponents(),0);
-    scores[off_local] = producer->GetDefaultScore(off_remote);
-    accum->PlusEquals(m_configuration.GetScoreProducer(), scores);
+    accum->PlusEquals(producer->GetScoreIndex() + off_local,
+                      producer->GetDefaultScore(off_remote));
   }
   // note: if no default score, no cost
 
@@ -289,6 +300,23 @@ ComparePrevScores(const TranslationOption *other) const
   return 0;
 }
 
+void
+LRState::
+WritePrevScoresKey(uint32_t *key) const
+{
+  const size_t n = m_configuration.GetNumberOfTypes();
+  const Scores* scores = m_prevOption
+                         ? m_prevOption->GetLexReorderingScores(m_configuration.GetScoreProducer())
+                         : NULL;
+  // options without scores are only equal to each other
+  key[0] = scores ? 1 : 0;
+  for (size_t i = 0; i < n; ++i) {
+    float score = scores ? (*scores)[m_offset + i] : 0;
+    if (score == 0) score = 0; // -0 compares equal to 0
+    memcpy(key + 1 + i, &score, sizeof(uint32_t));
+  }
+}
+
 // ===========================================================================
 // PHRASE BASED REORDERING STATE
 // ===========================================================================
@@ -331,6 +359,24 @@ Compare(const FFState& o) const
   return 1;
 }
 
+size_t
+PhraseBasedReorderingState::
+hash() const
+{
+  // the forward scores only matter between states with equal ranges
+  size_t seed = m_prevRange.GetStartPos();
+  boost::hash_combine(seed, m_prevRange.GetEndPos());
+  return seed;
+}
+
+void
+PhraseBasedReorderingState::
+WriteStateKey(uint32_t *key) const
+{
+  WriteRangeKey(m_prevRange, key);
+  if (m_direction == LRModel::Forward) WritePrevScoresKey(key + RANGE_KEY_SIZE);
+}
+
 LRState*
 PhraseBasedReorderingState::
 Expand(const TranslationOption& topt, const InputType& input,
@@ -365,6 +411,24 @@ Compare(FFState const& o) const
   return (cmp < 0) ? -1 : cmp ? 1 : m_forward->Compare(*other.m_forward);
 }
 
+size_t
+BidirectionalReorderingState::
+hash() const
+{
+  size_t seed = m_backward->hash();
+  boost::hash_combine(seed, m_forward->hash());
+  return seed;
+}
+
+void
+BidirectionalReorderingState::
+WriteStateKey(uint32_t *key) const
+{
+  // the backward part is a phrase-based state: its range
+  m_backward->WriteStateKey(key);
+  m_forward->WriteStateKey(key + RANGE_KEY_SIZE);
+}
+
 LRState*
 BidirectionalReorderingState::
 Expand(const TranslationOption& topt, const InputType& input,
@@ -400,6 +464,13 @@ Compare(const FFState& o) const
   return m_reoStack.Compare(other.m_reoStack);
 }
 
+size_t
+HReorderingBackwardState::
+hash() const
+{
+  return m_reoStack.hash();
+}
+
 LRState*
 HReorderingBackwardState::
 Expand(const TranslationOption& topt, const InputType& input,
@@ -451,6 +522,23 @@ Compare(const FFState& o) const
           : (m_prevRange < other.m_prevRange) ? -1 : 1);
 }
 
+size_t
+HReorderingForwardState::
+hash() const
+{
+  size_t seed = m_prevRange.GetStartPos();
+  boost::hash_combine(seed, m_prevRange.GetEndPos());
+  return seed;
+}
+
+void
+HReorderingForwardState::
+WriteStateKey(uint32_t *key) const
+{
+  WriteRangeKey(m_prevRange, key);
+  WritePrevScoresKey(key + RANGE_KEY_SIZE);
+}
+
 // For compatibility with the phrase-based reordering model, scoring is one
 // step delayed.
 // The forward model takes determines orientations heuristically as follows:
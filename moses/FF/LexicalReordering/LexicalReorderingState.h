@@ -3,7 +3,9 @@
 
 #include <vector>
 #include <string>
+#include <limits>
 
+#include <stdint.h>
 #include <boost/scoped_ptr.hpp>
 
 #include "moses/Hypothesis.h"
@@ -85,6 +87,9 @@ public:
 
   size_t GetNumberOfTypes() const;
   size_t GetNumScoreComponents() const;
+  //! words of LRState::WriteStateKey(), 0 if the states don't have a
+  //! fixed size (hierarchical backward states)
+  size_t GetStateKeySize() const;
   void SetAdditionalScoreComponents(size_t number);
 
   LexicalReordering*
@@ -155,6 +160,13 @@ public:
   Expand(const TranslationOption& hypo, const InputType& input,
          ScoreComponentCollection* scores) const = 0;
 
+  //! writes LRModel::GetStateKeySize() words that are equal exactly when
+  //! Compare() returns 0
+  virtual
+  void
+  WriteStateKey(uint32_t *key) const {
+  }
+
   static
   LRState*
   CreateLRState(const std::vector<std::string>& config,
@@ -200,6 +212,28 @@ protected:
 
   int
   ComparePrevScores(const TranslationOption *other) const;
+
+  //! the key of ComparePrevScores(): 1 + GetNumberOfTypes() words
+  void
+  WritePrevScoresKey(uint32_t *key) const;
+
+public:
+  //! words of WriteRangeKey()
+  static const size_t RANGE_KEY_SIZE = 2;
+
+protected:
+  //! a range in two words, start and end; NOT_FOUND (the range before the
+  //! first phrase) is the largest word, which no position reaches
+  static void
+  WriteRangeKey(const WordsRange &range, uint32_t *key) {
+    key[0] = PositionKey(range.GetStartPos());
+    key[1] = PositionKey(range.GetEndPos());
+  }
+
+  static uint32_t
+  PositionKey(size_t pos) {
+    return pos == NOT_FOUND ? std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(pos);
+  }
 };
 
 //! @todo what is this?
@@ -229,10 +263,18 @@ public:
   int
   Compare(const FFState& o) const;
 
+  virtual
+  size_t
+  hash() const;
+
   virtual
   LRState*
   Expand(const TranslationOption& topt, const InputType& input,
          ScoreComponentCollection*  scores) const;
+
+  virtual
+  void
+  WriteStateKey(uint32_t *key) const;
 };
 
 //! State for the standard Moses implementation of lexical reordering models
@@ -256,11 +298,19 @@ public:
   int
   Compare(const FFState& o) const;
 
+  virtual
+  size_t
+  hash() const;
+
   virtual
   LRState*
   Expand(const TranslationOption& topt,const InputType& input,
          ScoreComponentCollection*  scores) const;
 
+  virtual
+  void
+  WriteStateKey(uint32_t *key) const;
+
   ReorderingType GetOrientationTypeMSD(WordsRange currRange) const;
   ReorderingType GetOrientationTypeMSLR(WordsRange currRange) const;
   ReorderingType GetOrientationTypeMonotonic(WordsRange currRange) const;
@@ -281,6 +331,7 @@ public:
                            ReorderingStack reoStack);
 
   virtual int Compare(const FFState& o) const;
+  virtual size_t hash() const;
   virtual LRState* Expand(const TranslationOption& hypo, const InputType& input,
                           ScoreComponentCollection*  scores) const;
 
@@ -307,9 +358,11 @@ public:
                           const TranslationOption &topt);
 
   virtual int Compare(const FFState& o) const;
+  virtual size_t hash() const;
   virtual LRState* Expand(const TranslationOption& hypo,
                           const InputType& input,
                           ScoreComponentCollection* scores) const;
+  virtual void WriteStateKey(uint32_t *key) const;
 };
 }
 
@@ -7,6 +7,11 @@
 #include "moses/GenerationDictionary.h"
 #include "moses/TargetPhrase.h"
 #include "moses/TargetPhraseCollection.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+
+#include <unistd.h>
 
 #if !defined WIN32 || defined __MINGW32__ || defined HAVE_CMPH
 #include "moses/TranslationModel/CompactPT/LexicalReorderingTableCompact.h"
@@ -49,7 +54,8 @@ LexicalReorderingTable::
 LoadAvailable(const std::string& filePath,
               const FactorList& f_factors,
               const FactorList& e_factors,
-              const FactorList& c_factors)
+              const FactorList& c_factors,
+              const std::string& imagePath)
 {
   //decide use Compact or Tree or Memory table
 #ifdef HAVE_CMPH
@@ -64,97 +70,128 @@ LoadAvailable(const std::string& filePath,
                                          e_factors, c_factors);
   else
     ret = new LexicalReorderingTableMemory(filePath, f_factors,
-                                           e_factors, c_factors);
+                                           e_factors, c_factors, imagePath);
   return ret;
 }
 
+void
+LexicalReorderingTable::
+GetScores(const Phrase& f, const std::vector<const Phrase*>& e,
+          std::vector<Scores>& scores)
+{
+  scores.resize(e.size());
+  Phrase c(ARRAY_SIZE_INCR);
+  for (size_t i = 0; i < e.size(); ++i)
+    scores[i] = GetScore(f, *e[i], c);
+}
+
 LexicalReorderingTableMemory::
 LexicalReorderingTableMemory(const std::string& filePath,
                              const std::vector<FactorType>& f_factors,
                              const std::vector<FactorType>& e_factors,
-                             const std::vector<FactorType>& c_factors)
+                             const std::vector<FactorType>& c_factors,
+                             const std::string& imagePath)
   : LexicalReorderingTable(f_factors, e_factors, c_factors)
+  , m_Buckets(NULL)
+  , m_NumBuckets(0)
+  , m_Scores(NULL)
+  , m_NumScores(0)
 {
-  LoadFromFile(filePath);
+  if (!imagePath.empty() && FileExists(imagePath)) {
+    LoadImage(imagePath);
+  } else {
+    LoadFromFile(filePath);
+    if (!imagePath.empty()) SaveImage(imagePath);
+  }
 }
 
 LexicalReorderingTableMemory::
 ~LexicalReorderingTableMemory() { }
 
+Scores
+LexicalReorderingTableMemory::
+Find(uint64_t key) const
+{
+  TableType::ConstIterator i;
+  if (!m_Table.Find(key, i)) return Scores();
+  const float *s = m_Scores + i->offset;
+  return Scores(s, s + m_NumScores);
+}
+
 std::vector<float>
 LexicalReorderingTableMemory::GetScore(const Phrase& f,
                                        const Phrase& e,
                                        const Phrase& c)
 {
-  //rather complicated because of const can't use []... as [] might enter new things into std::map
-  //also can't have to be careful with words range if c is empty can't use c.GetSize()-1 will underflow and be large
-  TableType::const_iterator r;
-  std::string key;
+  //be careful with words range if c is empty can't use c.GetSize()-1 will underflow and be large
   if(0 == c.GetSize()) {
-    key = MakeKey(f,e,c);
-    r = m_Table.find(key);
-    if(m_Table.end() != r) {
-      return r->second;
-    }
+    return Find(MakeKey(f,e,c));
   } else {
     //right try from large to smaller context
     for(size_t i = 0; i <= c.GetSize(); ++i) {
       Phrase sub_c(c.GetSubString(WordsRange(i,c.GetSize()-1)));
-      key = MakeKey(f,e,sub_c);
-      r = m_Table.find(key);
-      if(m_Table.end() != r) {
-        return r->second;
-      }
+      Scores ret = Find(MakeKey(f,e,sub_c));
+      if (!ret.empty()) return ret;
     }
   }
   return Scores();
 }
 
+void
+LexicalReorderingTableMemory::
+GetScores(const Phrase& f, const std::vector<const Phrase*>& e,
+          std::vector<Scores>& scores)
+{
+  // the f part of the key is the same for all targets
+  uint64_t fHash = HashF(auxClearString(f.GetStringRep(m_FactorsF)));
+  scores.resize(e.size());
+  for (size_t i = 0; i < e.size(); ++i)
+    scores[i] = Find(MakeKey(fHash, auxClearString(e[i]->GetStringRep(m_FactorsE)), ""));
+}
+
 void
 LexicalReorderingTableMemory::
 DbgDump(std::ostream* out) const
 {
-  TableType::const_iterator i;
-  for(i = m_Table.begin(); i != m_Table.end(); ++i) {
-    *out << " key: '" << i->first << "' score: ";
-    *out << "(num scores: " << (i->second).size() << ")";
-    for(size_t j = 0; j < (i->second).size(); ++j)
-      *out << (i->second)[j] << " ";
+  for(const Entry *i = m_Buckets; i != m_Buckets + m_NumBuckets; ++i) {
+    if (!i->key) continue;
+    *out << " key: " << i->key << " score: ";
+    *out << "(num scores: " << m_NumScores << ")";
+    for(size_t j = 0; j < m_NumScores; ++j)
+      *out << m_Scores[i->offset + j] << " ";
 
     *out << "\n";
   }
 };
 
-std::string
-LexicalReorderingTableMemory::MakeKey(const Phrase& f,
-                                      const Phrase& e,
-                                      const Phrase& c) const
+uint64_t
+LexicalReorderingTableMemory::HashF(const std::string& f) const
 {
-  return MakeKey(auxClearString(f.GetStringRep(m_FactorsF)),
-                 auxClearString(e.GetStringRep(m_FactorsE)),
-                 auxClearString(c.GetStringRep(m_FactorsC)));
+  return m_FactorsF.empty() ? 0 : util::MurmurHashNative(f.data(), f.size());
 }
 
-std::string
-LexicalReorderingTableMemory::MakeKey(const std::string& f,
+uint64_t
+LexicalReorderingTableMemory::MakeKey(uint64_t fHash,
                                       const std::string& e,
                                       const std::string& c) const
 {
-  std::string key;
-  if(!f.empty()) key += f;
-  if(!m_FactorsE.empty()) {
-    if(!key.empty()) {
-      key += "|||";
-    }
-    key += e;
-  }
-  if(!m_FactorsC.empty()) {
-    if(!key.empty()) {
-      key += "|||";
-    }
-    key += c;
-  }
-  return key;
+  // chain the hashes of the parts that are used, via the seed
+  uint64_t key = fHash;
+  if(!m_FactorsE.empty())
+    key = util::MurmurHashNative(e.data(), e.size(), key + 1);
+  if(!m_FactorsC.empty())
+    key = util::MurmurHashNative(c.data(), c.size(), key + 2);
+  return key ? key : 1; // 0 marks empty buckets
+}
+
+uint64_t
+LexicalReorderingTableMemory::MakeKey(const Phrase& f,
+                                      const Phrase& e,
+                                      const Phrase& c) const
+{
+  return MakeKey(HashF(auxClearString(f.GetStringRep(m_FactorsF))),
+                 auxClearString(e.GetStringRep(m_FactorsE)),
+                 auxClearString(c.GetStringRep(m_FactorsC)));
 }
 
 void
@@ -166,7 +203,8 @@ LoadFromFile(const std::string& filePath)
     fileName += ".gz";
 
   InputFileStream file(fileName);
-  std::string line(""), key("");
+  std::string line("");
+  std::vector<Entry> entries;
   int numScores = -1;
   std::cerr << "Loading table into memory...";
   while(!getline(file, line).eof()) {
@@ -202,12 +240,103 @@ LoadFromFile(const std::string& filePath)
     }
     std::transform(p.begin(),p.end(),p.begin(),TransformScore);
     std::transform(p.begin(),p.end(),p.begin(),FloorScore);
-    //save it all into our map
-    m_Table[MakeKey(f,e,c)] = p;
+    //save it all into our arrays
+    Entry entry;
+    entry.key = MakeKey(HashF(f),e,c);
+    entry.offset = m_OwnScores.size();
+    entries.push_back(entry);
+    m_OwnScores.insert(m_OwnScores.end(), p.begin(), p.end());
+  }
+  m_NumScores = std::max(numScores, 0);
+
+  Entry empty;
+  empty.key = 0;
+  empty.offset = 0;
+  m_OwnBuckets.assign(TableType::Size(entries.size(), 1.5) / sizeof(Entry), empty);
+  m_Table = TableType(&m_OwnBuckets[0], m_OwnBuckets.size() * sizeof(Entry), 0);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    TableType::MutableIterator it;
+    // later lines win, as they did with the std::map
+    if (m_Table.FindOrInsert(entries[i], it)) it->offset = entries[i].offset;
   }
+  m_Buckets = &m_OwnBuckets[0];
+  m_NumBuckets = m_OwnBuckets.size();
+  m_Scores = m_OwnScores.empty() ? NULL : &m_OwnScores[0];
   std::cerr << "done.\n";
 }
 
+namespace
+{
+// layout of an image: this header, the buckets, then the scores
+struct ImageHeader {
+  char magic[8];
+  uint64_t keyParts;
+  uint64_t numScores;
+  uint64_t numBuckets;
+  uint64_t numFloats;
+};
+const char kImageMagic[8] = {'m', 'l', 'e', 'x', 'r', 'i', 'm', '1'};
+}
+
+uint64_t
+LexicalReorderingTableMemory::KeyParts() const
+{
+  return (m_FactorsF.empty() ? 0 : 1) | (m_FactorsE.empty() ? 0 : 2)
+         | (m_FactorsC.empty() ? 0 : 4);
+}
+
+void
+LexicalReorderingTableMemory::
+LoadImage(const std::string& imagePath)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(imagePath.c_str()));
+  uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(ImageHeader), imagePath << " is not a lexical reordering image");
+  util::MapRead(util::POPULATE_OR_LAZY, fd.get(), 0, size, m_Image);
+
+  const ImageHeader &header = *reinterpret_cast<const ImageHeader*>(m_Image.get());
+  UTIL_THROW_IF2(memcmp(header.magic, kImageMagic, sizeof(kImageMagic)),
+                 imagePath << " is not a lexical reordering image");
+  UTIL_THROW_IF2(header.keyParts != KeyParts(),
+                 imagePath << " was built with different factors");
+  UTIL_THROW_IF2(size != sizeof(ImageHeader) + header.numBuckets * sizeof(Entry)
+                 + header.numFloats * sizeof(float),
+                 imagePath << " is truncated");
+
+  m_NumScores = header.numScores;
+  m_NumBuckets = header.numBuckets;
+  m_Buckets = reinterpret_cast<const Entry*>(&header + 1);
+  m_Scores = reinterpret_cast<const float*>(m_Buckets + m_NumBuckets);
+  // lookups don't write to the buckets, so they may stay read-only
+  m_Table = TableType(const_cast<Entry*>(m_Buckets), m_NumBuckets * sizeof(Entry));
+  VERBOSE(1, "Mapped lexical reordering image " << imagePath << std::endl);
+}
+
+void
+LexicalReorderingTableMemory::
+SaveImage(const std::string& imagePath) const
+{
+  ImageHeader header;
+  memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.keyParts = KeyParts();
+  header.numScores = m_NumScores;
+  header.numBuckets = m_NumBuckets;
+  header.numFloats = m_OwnScores.size();
+
+  // write next to the image and rename, so that other processes never
+  // map a half-written one
+  std::string tmpPath = imagePath + ".tmp." + SPrint(getpid());
+  {
+    util::scoped_fd fd(util::CreateOrThrow(tmpPath.c_str()));
+    util::WriteOrThrow(fd.get(), &header, sizeof(header));
+    util::WriteOrThrow(fd.get(), m_Buckets, m_NumBuckets * sizeof(Entry));
+    util::WriteOrThrow(fd.get(), m_Scores, m_OwnScores.size() * sizeof(float));
+  }
+  UTIL_THROW_IF2(rename(tmpPath.c_str(), imagePath.c_str()),
+                 "Cannot rename " << tmpPath << " to " << imagePath);
+  VERBOSE(1, "Wrote lexical reordering image " << imagePath << std::endl);
+}
+
 LexicalReorderingTableTree::
 LexicalReorderingTableTree(const std::string& filePath,
                            const std::vector<FactorType>& f_factors,
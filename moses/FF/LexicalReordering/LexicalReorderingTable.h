@@ -18,6 +18,8 @@
 #include "moses/ConfusionNet.h"
 #include "moses/Sentence.h"
 #include "moses/PrefixTreeMap.h"
+#include "util/mmap.hh"
+#include "util/probing_hash_table.hh"
 
 namespace Moses
 {
@@ -46,18 +48,33 @@ public:
   LoadAvailable(const std::string& filePath,
                 const FactorList& f_factors,
                 const FactorList& e_factors,
-                const FactorList& c_factors);
+                const FactorList& c_factors,
+                const std::string& imagePath = "");
 
   virtual
   Scores
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c) = 0;
 
+  //! scores of (f, *e[i]) without context, for all target phrases of f;
+  //! override if work can be shared across the targets
+  virtual
+  void
+  GetScores(const Phrase& f, const std::vector<const Phrase*>& e,
+            std::vector<Scores>& scores);
+
   virtual
   void
   InitializeForInput(const InputType&) {
     /* override for on-demand loading */
   };
 
+  //! false if InitializeForInput() sets up the table for the calling thread only
+  virtual
+  bool
+  CanBeUsedOnAnyThread() const {
+    return true;
+  }
+
   virtual
   void
   InitializeForInputPhrase(const Phrase&) { }
@@ -90,16 +107,44 @@ protected:
 class LexicalReorderingTableMemory
   : public LexicalReorderingTable
 {
-  typedef std::map< std::string, std::vector<float> > TableType;
+  //implements LexicalReorderingTable for non binary tables: a probing hash
+  //table maps a 64-bit hash of (f,e,c) to the entry's scores, which are
+  //stored back to back in one array.
+  //Both arrays only hold offsets, so they can be written to an image file
+  //and mapped back in as they are: processes that map the same image (e.g.
+  //one under /dev/shm) share a single copy of the table in memory.
+  struct Entry {
+    typedef uint64_t Key;
+    uint64_t key;    //!< hash of the phrases; 0 marks an empty bucket
+    uint64_t offset; //!< of the scores in m_Scores
+    Key GetKey() const {
+      return key;
+    }
+    void SetKey(Key k) {
+      key = k;
+    }
+  };
+  typedef util::ProbingHashTable<Entry, util::IdentityHash> TableType;
+  const Entry *m_Buckets;
+  size_t m_NumBuckets;
   TableType m_Table;
+  const float *m_Scores;
+  size_t m_NumScores;
+
+  // backing store: either the arrays built from the text table, or a
+  // read-only mapping of an image
+  std::vector<Entry> m_OwnBuckets;
+  std::vector<float> m_OwnScores;
+  util::scoped_memory m_Image;
 
-  //implements LexicalReorderingTable saving all scores in one large std::map<> thingy
-  //to be used for non binary tables... uses a LOT of memory
 public:
+  //! imagePath, if given, is mapped if it exists, else written after
+  //! loading filePath
   LexicalReorderingTableMemory(const std::string& filePath,
                                const std::vector<FactorType>& f_factors,
                                const std::vector<FactorType>& e_factors,
-                               const std::vector<FactorType>& c_factors);
+                               const std::vector<FactorType>& c_factors,
+                               const std::string& imagePath = "");
 
   virtual
   ~LexicalReorderingTableMemory();
@@ -109,19 +154,44 @@ public:
   std::vector<float>
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
+  virtual
+  void
+  GetScores(const Phrase& f, const std::vector<const Phrase*>& e,
+            std::vector<Scores>& scores);
+
   void
   DbgDump(std::ostream* out) const;
 
 private:
 
-  std::string
+  //! hash of the f part of a key, to be extended by the e and c parts
+  uint64_t
+  HashF(const std::string& f) const;
+
+  uint64_t
+  MakeKey(uint64_t fHash, const std::string& e, const std::string& c) const;
+
+  uint64_t
   MakeKey(const Phrase& f, const Phrase& e, const Phrase& c) const;
 
-  std::string
-  MakeKey(const std::string& f, const std::string& e, const std::string& c) const;
+  //! scores of the entry with the given key, empty if there is none
+  Scores
+  Find(uint64_t key) const;
 
   void
   LoadFromFile(const std::string& filePath);
+
+  //! map an image written by SaveImage
+  void
+  LoadImage(const std::string& imagePath);
+
+  //! write the table to imagePath, atomically
+  void
+  SaveImage(const std::string& imagePath) const;
+
+  //! which parts the keys are made of, stored in the image for checking
+  uint64_t
+  KeyParts() const;
 };
 
 class LexicalReorderingTableTree
@@ -179,6 +249,13 @@ public:
   void
   InitializeForInput(const InputType& input);
 
+  // the table is loaded per thread and the cache is not locked
+  virtual
+  bool
+  CanBeUsedOnAnyThread() const {
+    return false;
+  }
+
   virtual
   void
   InitializeForInputPhrase(const Phrase& f) {
@@ -5,17 +5,30 @@
 */
 
 #include "ReorderingStack.h"
-#include <vector>
+#include <boost/functional/hash.hpp>
+#include <boost/make_shared.hpp>
 
 namespace Moses
 {
+ReorderingStack::Node::Node(const WordsRange &s, const boost::shared_ptr<const Node> &n)
+  : span(s), next(n), hash(n ? n->hash : 0)
+{
+  boost::hash_combine(hash, s.GetStartPos());
+  boost::hash_combine(hash, s.GetEndPos());
+}
+
 int ReorderingStack::Compare(const ReorderingStack& o)  const
 {
-  const ReorderingStack& other = static_cast<const ReorderingStack&>(o);
-  if (other.m_stack > m_stack) {
-    return 1;
-  } else if (other.m_stack < m_stack) {
-    return -1;
+  // walk down from the top; stacks share their bottoms, so stop at the
+  // first common node
+  const Node *a = m_top.get(), *b = o.m_top.get();
+  while (a != b) {
+    if (!a) return 1;
+    if (!b) return -1;
+    if (a->hash != b->hash) return a->hash < b->hash ? 1 : -1;
+    if (!(a->span == b->span)) return a->span < b->span ? 1 : -1;
+    a = a->next.get();
+    b = b->next.get();
   }
   return 0;
 }
@@ -26,13 +39,13 @@ int ReorderingStack::ShiftReduce(WordsRange input_span)
   int distance;  // value to return: the initial distance between this and previous span
 
   // stack is empty
-  if(m_stack.empty()) {
-    m_stack.push_back(input_span);
+  if(!m_top) {
+    m_top = boost::make_shared<const Node>(input_span, m_top);
     return input_span.GetStartPos() + 1; // - (-1)
   }
 
   // stack is non-empty
-  WordsRange prev_span = m_stack.back(); //access last element added
+  WordsRange prev_span = m_top->span; //access last element added
 
   //calculate the distance we are returning
   if(input_span.GetStartPos() > prev_span.GetStartPos()) {
@@ -42,15 +55,15 @@ int ReorderingStack::ShiftReduce(WordsRange input_span)
   }
 
   if(distance == 1) { //monotone
-    m_stack.pop_back();
+    m_top = m_top->next;
     WordsRange new_span(prev_span.GetStartPos(), input_span.GetEndPos());
     Reduce(new_span);
   } else if(distance == -1) { //swap
-    m_stack.pop_back();
+    m_top = m_top->next;
     WordsRange new_span(input_span.GetStartPos(), prev_span.GetEndPos());
     Reduce(new_span);
   } else {      // discontinuous
-    m_stack.push_back(input_span);
+    m_top = boost::make_shared<const Node>(input_span, m_top);
   }
 
   return distance;
@@ -61,16 +74,16 @@ void ReorderingStack::Reduce(WordsRange current)
 {
   bool cont_loop = true;
 
-  while (cont_loop && m_stack.size() > 0) {
+  while (cont_loop && m_top) {
 
-    WordsRange previous = m_stack.back();
+    WordsRange previous = m_top->span;
 
     if(current.GetStartPos() - previous.GetEndPos() == 1) { //mono&merge
-      m_stack.pop_back();
+      m_top = m_top->next;
       WordsRange t(previous.GetStartPos(), current.GetEndPos());
       current = t;
     } else if(previous.GetStartPos() - current.GetEndPos() == 1) { //swap&merge
-      m_stack.pop_back();
+      m_top = m_top->next;
       WordsRange t(current.GetStartPos(), previous.GetEndPos());
       current = t;
     } else { // discontinuous, no more merging
@@ -79,8 +92,7 @@ void ReorderingStack::Reduce(WordsRange current)
   } // finished reducing, exit
 
   // add to stack
-  m_stack.push_back(current);
+  m_top = boost::make_shared<const Node>(current, m_top);
 }
 
 }
-
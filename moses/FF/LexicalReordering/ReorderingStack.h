@@ -6,28 +6,37 @@
 
 #pragma once
 
-//#include <string>
-#include <vector>
-//#include "Factor.h"
-//#include "Phrase.h"
-//#include "TypeDef.h"
-//#include "Util.h"
+#include <boost/shared_ptr.hpp>
 #include "moses/WordsRange.h"
 
 namespace Moses
 {
 
-/** @todo what is this?
+/** Shift-reduce stack of the source spans translated so far, for the
+ *  hierarchical reordering model. The stack is persistent: the states of
+ *  a hypothesis and its extensions share the nodes below the top, so
+ *  copying a stack copies one pointer and a ShiftReduce() allocates at most
+ *  one node.
  */
 class ReorderingStack
 {
 private:
+  struct Node {
+    Node(const WordsRange &span, const boost::shared_ptr<const Node> &next);
 
-  std::vector<WordsRange> m_stack;
+    WordsRange span;
+    boost::shared_ptr<const Node> next;
+    size_t hash; //!< of the spans from here to the bottom
+  };
+
+  boost::shared_ptr<const Node> m_top;
 
 public:
 
   int Compare(const ReorderingStack& o) const;
+  size_t hash() const {
+    return m_top ? m_top->hash : 0;
+  }
   int ShiftReduce(WordsRange input_span);
 
 private:
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <fstream>
+#include <set>
 
 #include "moses/FactorCollection.h"
 #include "moses/InputPath.h"
@@ -57,6 +59,9 @@ const std::string& SparseReorderingFeatureKey::Name (const string& wordListId)
 
 SparseReordering::SparseReordering(const map<string,string>& config, const LexicalReordering* producer)
   : m_producer(producer)
+  , m_usePhrase(false)
+  , m_useBetween(false)
+  , m_useStack(false)
 {
   static const string kSource= "source";
   static const string kTarget = "target";
@@ -65,18 +70,18 @@ SparseReordering::SparseReordering(const map<string,string>& config, const Lexic
     if (fields[0] == "words") {
       UTIL_THROW_IF(!(fields.size() == 3), util::Exception, "Sparse reordering word list name should be sparse-words-(source|target)-<id>");
       if (fields[1] == kSource) {
-        ReadWordList(i->second,fields[2], SparseReorderingFeatureKey::Source, &m_sourceWordLists);
+        ReadWordList(i->second,fields[2], SparseReorderingFeatureKey::Source);
       } else if (fields[1] == kTarget) {
-        ReadWordList(i->second,fields[2],SparseReorderingFeatureKey::Target, &m_targetWordLists);
+        ReadWordList(i->second,fields[2],SparseReorderingFeatureKey::Target);
       } else {
         UTIL_THROW(util::Exception, "Sparse reordering requires source or target, not " << fields[1]);
       }
     } else if (fields[0] == "clusters") {
       UTIL_THROW_IF(!(fields.size() == 3), util::Exception, "Sparse reordering cluster name should be sparse-clusters-(source|target)-<id>");
       if (fields[1] == kSource) {
-        ReadClusterMap(i->second,fields[2], SparseReorderingFeatureKey::Source, &m_sourceClusterMaps);
+        ReadClusterMap(i->second,fields[2], SparseReorderingFeatureKey::Source);
       } else if (fields[1] == kTarget) {
-        ReadClusterMap(i->second,fields[2],SparseReorderingFeatureKey::Target, &m_targetClusterMaps);
+        ReadClusterMap(i->second,fields[2],SparseReorderingFeatureKey::Target);
       } else {
         UTIL_THROW(util::Exception, "Sparse reordering requires source or target, not " << fields[1]);
       }
@@ -92,46 +97,64 @@ SparseReordering::SparseReordering(const map<string,string>& config, const Lexic
     }
   }
 
+  m_tables[SparseReorderingFeatureKey::Source].Compile();
+  m_tables[SparseReorderingFeatureKey::Target].Compile();
 }
 
-void SparseReordering::PreCalculateFeatureNames(size_t index, const string& id, SparseReorderingFeatureKey::Side side, const Factor* factor, bool isCluster)
+void SparseReordering::WordTable::Compile()
 {
+  sort(m_pending.begin(), m_pending.end());
+  const size_t size = m_pending.empty() ? 0 : m_pending.back().first + 1;
+  m_offsets.assign(size + 1, 0);
+  m_blocks.resize(m_pending.size());
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    ++m_offsets[m_pending[i].first + 1];
+    m_blocks[i] = m_pending[i].second;
+  }
+  for (size_t i = 1; i < m_offsets.size(); ++i) {
+    m_offsets[i] += m_offsets[i - 1];
+  }
+  vector<pair<size_t, uint32_t> >().swap(m_pending);
+}
+
+uint32_t SparseReordering::AddBlock(const string& id, SparseReorderingFeatureKey::Side side, const Factor* factor, bool isCluster)
+{
+  const uint32_t block = m_names.size() / kBlockSize;
   for (size_t type = SparseReorderingFeatureKey::Stack;
        type <= SparseReorderingFeatureKey::Between; ++type) {
     for (size_t position = SparseReorderingFeatureKey::First;
          position <= SparseReorderingFeatureKey::Last; ++position) {
       for (int reoType = 0; reoType <= LRModel::MAX; ++reoType) {
-        SparseReorderingFeatureKey 
-	  key(index, static_cast<SparseReorderingFeatureKey::Type>(type), 
-	      factor, isCluster, 
-	      static_cast<SparseReorderingFeatureKey::Position>(position), 
-	      side, static_cast<LRModel::ReorderingType>(reoType));
-        m_featureMap.insert(pair<SparseReorderingFeatureKey, FName>(key,m_producer->GetFeatureName(key.Name(id))));
+        SparseReorderingFeatureKey
+        key(block, static_cast<SparseReorderingFeatureKey::Type>(type),
+            factor, isCluster,
+            static_cast<SparseReorderingFeatureKey::Position>(position),
+            side, static_cast<LRModel::ReorderingType>(reoType));
+        m_names.push_back(m_producer->GetFeatureName(key.Name(id)));
       }
     }
   }
+  return block;
 }
 
-void SparseReordering::ReadWordList(const string& filename, const string& id, SparseReorderingFeatureKey::Side side, vector<WordList>* pWordLists)
+void SparseReordering::ReadWordList(const string& filename, const string& id, SparseReorderingFeatureKey::Side side)
 {
   ifstream fh(filename.c_str());
   UTIL_THROW_IF(!fh, util::Exception, "Unable to open: " << filename);
   string line;
-  pWordLists->push_back(WordList());
-  pWordLists->back().first = id;
+  set<const Factor*> seen;
   while (getline(fh,line)) {
     //TODO: StringPiece
     const Factor* factor = FactorCollection::Instance().AddFactor(line);
-    pWordLists->back().second.insert(factor);
-    PreCalculateFeatureNames(pWordLists->size()-1, id, side, factor, false);
-
+    if (!seen.insert(factor).second) continue;
+    m_tables[side].m_pending.push_back(make_pair(factor->GetId(), AddBlock(id, side, factor, false)));
   }
 }
 
-void SparseReordering::ReadClusterMap(const string& filename, const string& id, SparseReorderingFeatureKey::Side side, vector<ClusterMap>* pClusterMaps)
+void SparseReordering::ReadClusterMap(const string& filename, const string& id, SparseReorderingFeatureKey::Side side)
 {
-  pClusterMaps->push_back(ClusterMap());
-  pClusterMaps->back().first = id;
+  map<const Factor*, const Factor*> clusters; // the last cluster of a word counts
+  map<const Factor*, uint32_t> blocks;
   util::FilePiece file(filename.c_str());
   StringPiece line;
   while (true) {
@@ -146,8 +169,13 @@ void SparseReordering::ReadClusterMap(const string& filename, const string& id,
     ++lineIter;
     if (!lineIter) UTIL_THROW(util::Exception, "Malformed cluster line (missing cluster id): '" << line << "'");
     const Factor* idFactor = FactorCollection::Instance().AddFactor(*lineIter);
-    pClusterMaps->back().second[wordFactor] = idFactor;
-    PreCalculateFeatureNames(pClusterMaps->size()-1, id, side, idFactor, true);
+    clusters[wordFactor] = idFactor;
+    if (blocks.find(idFactor) == blocks.end()) {
+      blocks[idFactor] = AddBlock(id, side, idFactor, true);
+    }
+  }
+  for (map<const Factor*, const Factor*>::const_iterator i = clusters.begin(); i != clusters.end(); ++i) {
+    m_tables[side].m_pending.push_back(make_pair(i->first->GetId(), blocks[i->second]));
   }
 }
 
@@ -157,39 +185,13 @@ void SparseReordering::AddFeatures(
   LRModel::ReorderingType reoType,
   ScoreComponentCollection* scores) const
 {
-
-  const Factor*  wordFactor = word.GetFactor(0);
-
-  const vector<WordList>* wordLists;
-  const vector<ClusterMap>* clusterMaps;
-  if (side == SparseReorderingFeatureKey::Source) {
-    wordLists = &m_sourceWordLists;
-    clusterMaps = &m_sourceClusterMaps;
-  } else {
-    wordLists = &m_targetWordLists;
-    clusterMaps = &m_targetClusterMaps;
-  }
-
-  for (size_t id = 0; id < wordLists->size(); ++id) {
-    if ((*wordLists)[id].second.find(wordFactor) == (*wordLists)[id].second.end()) continue;
-    SparseReorderingFeatureKey key(id, type, wordFactor, false, position, side, reoType);
-    FeatureMap::const_iterator fmi = m_featureMap.find(key);
-    assert(fmi != m_featureMap.end());
-    scores->SparsePlusEquals(fmi->second, 1.0);
+  const WordTable& table = m_tables[side];
+  const size_t id = word.GetFactor(0)->GetId();
+  if (id + 1 >= table.m_offsets.size()) return;
+  const size_t offset = BlockOffset(type, position, reoType);
+  for (size_t i = table.m_offsets[id]; i < table.m_offsets[id + 1]; ++i) {
+    scores->SparsePlusEquals(m_names[table.m_blocks[i] * kBlockSize + offset], 1.0);
   }
-
-  for (size_t id = 0; id < clusterMaps->size(); ++id) {
-    const ClusterMap& clusterMap = (*clusterMaps)[id];
-    boost::unordered_map<const Factor*, const Factor*>::const_iterator clusterIter
-    = clusterMap.second.find(wordFactor);
-    if (clusterIter != clusterMap.second.end()) {
-      SparseReorderingFeatureKey key(id, type, clusterIter->second, true, position, side, reoType);
-      FeatureMap::const_iterator fmi = m_featureMap.find(key);
-      assert(fmi != m_featureMap.end());
-      scores->SparsePlusEquals(fmi->second, 1.0);
-    }
-  }
-
 }
 
 void SparseReordering::CopyScores(
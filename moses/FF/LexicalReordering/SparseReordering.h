@@ -11,10 +11,8 @@
 #include <string>
 #include <vector>
 
-#include <boost/unordered_set.hpp>
+#include <stdint.h>
 
-#include "util/murmur_hash.hh"
-#include "util/pool.hh"
 #include "util/string_piece.hh"
 
 #include "moses/FeatureVector.h"
@@ -39,7 +37,7 @@ namespace Moses
 {
 
 /**
- * Used to store pre-calculated feature names.
+ * Describes a pre-calculated feature name.
 **/
 struct SparseReorderingFeatureKey {
   size_t id;
@@ -59,32 +57,6 @@ struct SparseReorderingFeatureKey {
   const std::string& Name(const std::string& wordListId) ;
 };
 
-struct HashSparseReorderingFeatureKey : public std::unary_function<SparseReorderingFeatureKey, std::size_t> {
-  std::size_t operator()(const SparseReorderingFeatureKey& key) const {
-    //TODO: can we just hash the memory?
-    //not sure, there could be random padding
-    std::size_t seed = 0;
-    seed = util::MurmurHashNative(&key.id, sizeof(key.id), seed);
-    seed = util::MurmurHashNative(&key.type, sizeof(key.type), seed);
-    seed = util::MurmurHashNative(&key.word, sizeof(key.word), seed);
-    seed = util::MurmurHashNative(&key.isCluster, sizeof(key.isCluster), seed);
-    seed = util::MurmurHashNative(&key.position, sizeof(key.position), seed);
-    seed = util::MurmurHashNative(&key.side, sizeof(key.side), seed);
-    seed = util::MurmurHashNative(&key.reoType, sizeof(key.reoType), seed);
-    return seed;
-  }
-};
-
-struct EqualsSparseReorderingFeatureKey :
-  public std::binary_function<SparseReorderingFeatureKey, SparseReorderingFeatureKey, bool> {
-  bool operator()(const SparseReorderingFeatureKey& left, const SparseReorderingFeatureKey& right) const {
-    //TODO: Can we just compare the memory?
-    return left.id == right.id &&  left.type == right.type && left.word == right.word &&
-           left.position == right.position && left.side == right.side &&
-           left.reoType == right.reoType;
-  }
-};
-
 class SparseReordering
 {
 public:
@@ -99,23 +71,42 @@ public:
                   ScoreComponentCollection* scores) const ;
 
 private:
+  //! names of the features of one word of a list, or one cluster of a map,
+  //! by type, position and orientation
+  static const size_t kBlockSize = 3 * 2 * (LRModel::MAX + 1);
+  static size_t BlockOffset(SparseReorderingFeatureKey::Type type,
+                            SparseReorderingFeatureKey::Position position,
+                            LRModel::ReorderingType reoType) {
+    return (type * 2 + position) * (LRModel::MAX + 1) + reoType;
+  }
+
+  /** Which blocks fire for a word, by the id of its factor, in compressed
+   *  rows: the blocks of factor id i are m_blocks[m_offsets[i]] up to
+   *  m_blocks[m_offsets[i+1]]. Factors created after loading have larger
+   *  ids than any in the lists and fire nothing.
+   */
+  struct WordTable {
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_blocks;
+    //! (factor id, block) pairs collected while loading
+    std::vector<std::pair<size_t, uint32_t> > m_pending;
+
+    void Compile();
+  };
+
   const LexicalReordering* m_producer;
-  typedef std::pair<std::string, boost::unordered_set<const Factor*> > WordList; //id and list
-  std::vector<WordList> m_sourceWordLists;
-  std::vector<WordList> m_targetWordLists;
-  typedef std::pair<std::string, boost::unordered_map<const Factor*, const Factor*> > ClusterMap; //id and map
-  std::vector<ClusterMap> m_sourceClusterMaps;
-  std::vector<ClusterMap> m_targetClusterMaps;
+  WordTable m_tables[2]; //!< by side
+  std::vector<FName> m_names; //!< kBlockSize names per block
   bool m_usePhrase;
   bool m_useBetween;
   bool m_useStack;
-  typedef boost::unordered_map<SparseReorderingFeatureKey, FName, HashSparseReorderingFeatureKey, EqualsSparseReorderingFeatureKey> FeatureMap;
-  FeatureMap m_featureMap;
 
   void ReadWordList(const std::string& filename, const std::string& id,
-                    SparseReorderingFeatureKey::Side side, std::vector<WordList>* pWordLists);
-  void ReadClusterMap(const std::string& filename, const std::string& id, SparseReorderingFeatureKey::Side side, std::vector<ClusterMap>* pClusterMaps);
-  void PreCalculateFeatureNames(size_t index, const std::string& id, SparseReorderingFeatureKey::Side side, const Factor* factor, bool isCluster);
+                    SparseReorderingFeatureKey::Side side);
+  void ReadClusterMap(const std::string& filename, const std::string& id,
+                      SparseReorderingFeatureKey::Side side);
+  uint32_t AddBlock(const std::string& id, SparseReorderingFeatureKey::Side side,
+                    const Factor* factor, bool isCluster);
 
   void AddFeatures(
     SparseReorderingFeatureKey::Type type, SparseReorderingFeatureKey::Side side,
@@ -4,6 +4,8 @@
 #include "moses/ScoreComponentCollection.h"
 #include "moses/FactorCollection.h"
 
+#include <algorithm>
+
 
 using namespace std;
 
@@ -115,30 +117,53 @@ void Model1LexicalTable::Load(const std::string &fileName, const Model1Vocabular
     const Factor* wordT = vcbT.GetWord(idT);
     float prob = Scan<float>(tokens[2]);
     if ( (wordS != NULL) && (wordT != NULL) ) {
-      m_ltable[ wordS ][ wordT ] = prob;
+      m_ltable[ wordT ][ wordS ] = prob;
     }
     UTIL_THROW_IF2((wordS == NULL) || (wordT == NULL), "Line " << i << " in " << fileName << " has unknown vocabulary."); // TODO: can we assume that the vocabulary is know and filter the model on loading? Then remove this line.
   }
   inFile.Close();
 }
 
+void Model1LexicalTable::LoadMapped(const std::string &fileName)
+{
+  m_mapped.Load(fileName);
+  m_isMapped = true;
+}
+
 // p( wordT | wordS )
 float Model1LexicalTable::GetProbability(const Factor* wordS, const Factor* wordT) const
 {
   float prob = m_floor;
- 
-  boost::unordered_map< const Factor*, boost::unordered_map< const Factor*, float > >::const_iterator iter1 = m_ltable.find( wordS ); 
-
-  if ( iter1 != m_ltable.end() ) {
-    boost::unordered_map< const Factor*, float >::const_iterator iter2 = iter1->second.find( wordT );
-    if ( iter2 != iter1->second.end() ) {
-      prob = iter2->second;
-      if ( prob < m_floor ) {
-        prob = m_floor;
+  GetProbabilities(std::vector<const Factor*>(1, wordS), wordT, &prob);
+  return prob;
+}
+
+void Model1LexicalTable::GetProbabilities(const std::vector<const Factor*>& wordsS, const Factor* wordT, float* probs) const
+{
+  std::fill(probs, probs + wordsS.size(), m_floor);
+
+  if (m_isMapped) {
+    uint64_t hashT = MappedLexicalTable::HashWord(wordT->GetString());
+    for (size_t i = 0; i < wordsS.size(); ++i) {
+      float prob;
+      if (m_mapped.Find(MappedLexicalTable::Key(MappedLexicalTable::HashWord(wordsS[i]->GetString()), hashT), prob)
+          && prob > m_floor) {
+        probs[i] = prob;
       }
     }
+    return;
+  }
+
+  boost::unordered_map< const Factor*, boost::unordered_map< const Factor*, float > >::const_iterator iter1 = m_ltable.find( wordT );
+  if ( iter1 == m_ltable.end() ) {
+    return;
+  }
+  for (size_t i = 0; i < wordsS.size(); ++i) {
+    boost::unordered_map< const Factor*, float >::const_iterator iter2 = iter1->second.find( wordsS[i] );
+    if ( iter2 != iter1->second.end() && iter2->second > m_floor ) {
+      probs[i] = iter2->second;
+    }
   }
-  return prob;
 }
 
 
@@ -165,6 +190,13 @@ void Model1Feature::SetParameter(const std::string& key, const std::string& valu
 
 void Model1Feature::Load()
 {
+  if (MappedLexicalTable::IsMapped(m_fileNameModel1)) {
+    FEATUREVERBOSE(2, GetScoreProducerDescription() << ": Mapping binary model 1 lexical translation table " << m_fileNameModel1 << " ...");
+    m_model1.LoadMapped(m_fileNameModel1);
+    FEATUREVERBOSE2(2, " Done." << std::endl);
+    m_emptyWord = FactorCollection::Instance().AddFactor(Model1Vocabulary::GIZANULL,false);
+    return;
+  }
   FEATUREVERBOSE(2, GetScoreProducerDescription() << ": Loading source vocabulary from file " << m_fileNameVcbS << " ...");
   Model1Vocabulary vcbS;
   vcbS.Load(m_fileNameVcbS);
@@ -182,6 +214,52 @@ void Model1Feature::Load()
                  << ": Factor for GIZA empty word does not exist.");
 }
 
+Model1Feature::SentenceCache &Model1Feature::GetSentenceCache(const InputType& input) const
+{
+  {
+    #ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+    #endif
+    boost::unordered_map<const InputType*, SentenceCache>::iterator sentenceCache = m_cache.find(&input);
+    if (sentenceCache != m_cache.end()) {
+      return sentenceCache->second;
+    }
+  }
+
+  const Sentence& sentence = static_cast<const Sentence&>(input);
+  std::vector<const Factor*> words;
+  for (size_t posS=1; posS+1<sentence.GetSize(); ++posS) { // ignore <s> and </s>
+    words.push_back(sentence.GetWord(posS)[0]);
+  }
+  std::sort(words.begin(), words.end());
+
+  #ifdef WITH_THREADS
+  // need to update cache; write lock
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+  #endif
+  std::pair<boost::unordered_map<const InputType*, SentenceCache>::iterator, bool> inserted
+    = m_cache.insert(std::make_pair(&input, SentenceCache()));
+  SentenceCache &cache = inserted.first->second;
+  if (inserted.second) {
+    for (size_t i = 0; i < words.size(); ++i) {
+      if (i && words[i] == words[i-1]) {
+        cache.sourceCounts.back() += 1;
+      } else {
+        cache.sourceWords.push_back(words[i]);
+        cache.sourceCounts.push_back(1);
+      }
+    }
+    cache.norm = TransformScore(1+sentence.GetSize());
+  }
+  // elements of an unordered_map stay where they are on insertion
+  return cache;
+}
+
+void Model1Feature::InitializeForInput(const InputType& source)
+{
+  GetSentenceCache(source);
+}
+
 void Model1Feature::EvaluateWithSourceContext(const InputType &input
                                  , const InputPath &inputPath
                                  , const TargetPhrase &targetPhrase
@@ -189,53 +267,53 @@ void Model1Feature::EvaluateWithSourceContext(const InputType &input
                                  , ScoreComponentCollection &scoreBreakdown
                                  , ScoreComponentCollection *estimatedFutureScore) const
 {
-  const Sentence& sentence = static_cast<const Sentence&>(input);
+  SentenceCache &sentenceCache = GetSentenceCache(input);
   float score = 0.0;
-  float norm = TransformScore(1+sentence.GetSize());
 
+  std::vector<float> probs;
   for (size_t posT=0; posT<targetPhrase.GetSize(); ++posT) 
   {
     const Word &wordT = targetPhrase.GetWord(posT);
     if ( !wordT.IsNonTerminal() ) 
     {
-      float thisWordProb = m_model1.GetProbability(m_emptyWord,wordT[0]); // probability conditioned on empty word
-
       // cache lookup
       bool foundInCache = false;
       {
         #ifdef WITH_THREADS
         boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
         #endif
-        boost::unordered_map<const InputType*, boost::unordered_map<const Factor*, float> >::const_iterator sentenceCache = m_cache.find(&input);
-        if (sentenceCache != m_cache.end())
+        boost::unordered_map<const Factor*, float>::const_iterator cacheHit = sentenceCache.scores.find(wordT[0]);
+        if (cacheHit != sentenceCache.scores.end())
         {
-          boost::unordered_map<const Factor*, float>::const_iterator cacheHit = sentenceCache->second.find(wordT[0]);
-          if (cacheHit != sentenceCache->second.end())
-          {
-            foundInCache = true;
-            score += cacheHit->second;
-            FEATUREVERBOSE(3, "Cached score( " << wordT << " ) = " << cacheHit->second << std::endl);
-          }
+          foundInCache = true;
+          score += cacheHit->second;
+          FEATUREVERBOSE(3, "Cached score( " << wordT << " ) = " << cacheHit->second << std::endl);
         }
       }
 
       if (!foundInCache)
       {
-        for (size_t posS=1; posS<sentence.GetSize()-1; ++posS) // ignore <s> and </s>
+        // gather the column of p( wordT | wordS ) over the sentence, then sum it
+        const std::vector<const Factor*> &sourceWords = sentenceCache.sourceWords;
+        const std::vector<float> &sourceCounts = sentenceCache.sourceCounts;
+        probs.resize(sourceWords.size());
+        if (!probs.empty()) {
+          m_model1.GetProbabilities(sourceWords, wordT[0], &probs[0]);
+        }
+        float thisWordProb = m_model1.GetProbability(m_emptyWord,wordT[0]); // probability conditioned on empty word
+        for (size_t i=0; i<probs.size(); ++i)
         {
-          const Word &wordS = sentence.GetWord(posS);
-          float modelProb = m_model1.GetProbability(wordS[0],wordT[0]);
-          FEATUREVERBOSE(4, "p( " << wordT << " | " << wordS << " ) = " << modelProb << std::endl);
-          thisWordProb += modelProb;
+          FEATUREVERBOSE(4, "p( " << wordT << " | " << *sourceWords[i] << " ) = " << probs[i] << std::endl);
+          thisWordProb += sourceCounts[i] * probs[i];
         }
-        float thisWordScore = TransformScore(thisWordProb) - norm;
+        float thisWordScore = TransformScore(thisWordProb) - sentenceCache.norm;
         FEATUREVERBOSE(3, "score( " << wordT << " ) = " << thisWordScore << std::endl);
         {
           #ifdef WITH_THREADS 
           // need to update cache; write lock
           boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
           #endif
-          m_cache[&input][wordT[0]] = thisWordScore;
+          sentenceCache.scores[wordT[0]] = thisWordScore;
         }
         score += thisWordScore;
       }
@@ -252,12 +330,7 @@ void Model1Feature::CleanUpAfterSentenceProcessing(const InputType& source)
   boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
   #endif
   // clear cache
-  boost::unordered_map<const InputType*, boost::unordered_map<const Factor*, float> >::iterator sentenceCache = m_cache.find(&source);
-  if (sentenceCache != m_cache.end())
-  {
-    sentenceCache->second.clear();
-    m_cache.erase(sentenceCache);
-  }
+  m_cache.erase(&source);
 }
 
 }
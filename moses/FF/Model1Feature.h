@@ -3,6 +3,7 @@
 #include <string>
 #include <limits>
 #include <boost/unordered_map.hpp>
+#include "moses/MappedLexicalTable.h"
 #include "StatelessFeatureFunction.h"
 #include "moses/Factor.h"
 
@@ -37,17 +38,26 @@ protected:
 class Model1LexicalTable
 {
 public:
-  Model1LexicalTable(float floor=1e-7) : m_floor(floor) 
+  Model1LexicalTable(float floor=1e-7) : m_floor(floor), m_isMapped(false)
   {}
 
   void Load(const std::string& fileName, const Model1Vocabulary& vcbS, const Model1Vocabulary& vcbT);
 
+  // binary table written by binarize-lex with the vocabularies, which aren't needed then
+  void LoadMapped(const std::string& fileName);
+
   // p( wordT | wordS )
   float GetProbability(const Factor* wordS, const Factor* wordT) const;
 
+  // p( wordT | wordsS[i] ) into probs[i], with one lookup of wordT
+  void GetProbabilities(const std::vector<const Factor*>& wordsS, const Factor* wordT, float* probs) const;
+
 protected:
+  // by target word, then source word
   boost::unordered_map< const Factor*, boost::unordered_map< const Factor*, float > > m_ltable;
   const float m_floor;
+  MappedLexicalTable m_mapped; // keyed by source word, then target word
+  bool m_isMapped;
 };
 
 
@@ -57,6 +67,10 @@ class Model1Feature : public StatelessFeatureFunction
 public:
   Model1Feature(const std::string &line);
 
+  bool DependsOnSourceContext() const {
+    return true; // looks at the whole sentence
+  }
+
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
@@ -90,6 +104,8 @@ public:
     ScoreComponentCollection* accumulator) const
   {}
 
+  void InitializeForInput(const InputType& source);
+
   void CleanUpAfterSentenceProcessing(const InputType& source);
 
 private:
@@ -100,9 +116,21 @@ private:
   const Factor* m_emptyWord;
 
   void Load();
-  
+
+  struct SentenceCache {
+    // distinct source words of the sentence without <s> and </s>, and how
+    // often each occurs
+    std::vector<const Factor*> sourceWords;
+    std::vector<float> sourceCounts;
+    float norm;
+    // score of each target word seen so far
+    boost::unordered_map<const Factor*, float> scores;
+  };
+
+  SentenceCache &GetSentenceCache(const InputType& input) const;
+
   // cache
-  mutable boost::unordered_map<const InputType*, boost::unordered_map<const Factor*, float> > m_cache;
+  mutable boost::unordered_map<const InputType*, SentenceCache> m_cache;
   #ifdef WITH_THREADS
   // reader-writer lock
   mutable boost::shared_mutex m_accessLock;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "lm/model.hh"
 #include <boost/shared_ptr.hpp>
 
@@ -15,6 +16,12 @@ public:
   virtual float Score(const lm::ngram::State&, const std::string&,
                       lm::ngram::State&) const = 0;
 
+  //! score a sequence of operations, in one call
+  virtual float Score(const lm::ngram::State&, const std::vector<lm::WordIndex>&,
+                      lm::ngram::State&) const = 0;
+
+  virtual lm::WordIndex Index(const std::string&) const = 0;
+
   virtual const lm::ngram::State &BeginSentenceState() const = 0;
 
   virtual const lm::ngram::State &NullContextState() const = 0;
@@ -34,6 +41,25 @@ public:
                           out_state);
   }
 
+  virtual float Score(const lm::ngram::State &in_state,
+                      const std::vector<lm::WordIndex> &words,
+                      lm::ngram::State &out_state) const {
+    float ret = 0;
+    lm::ngram::State states[2];
+    const lm::ngram::State *from = &in_state;
+    for (size_t i = 0; i < words.size(); ++i) {
+      lm::ngram::State &to = states[i & 1];
+      ret += m_kenlm->Score(*from, words[i], to);
+      from = &to;
+    }
+    out_state = *from;
+    return ret;
+  }
+
+  virtual lm::WordIndex Index(const std::string &word) const {
+    return m_kenlm->GetVocabulary().Index(word);
+  }
+
   virtual const lm::ngram::State &BeginSentenceState() const {
     return m_kenlm->BeginSentenceState();
   }
@@ -1,6 +1,7 @@
 #include <fstream>
 #include "OpSequenceModel.h"
 #include "osmHyp.h"
+#include "moses/InputPath.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
 
@@ -32,6 +33,7 @@ void OpSequenceModel :: readLanguageModel(const char *lmFile)
   State startState = OSM->NullContextState();
   State endState;
   unkOpProb = OSM->Score(startState,unkOp,endState);
+  m_reorderingOps.Load(*OSM);
 }
 
 
@@ -42,21 +44,14 @@ void OpSequenceModel::Load()
 
 
 
-void OpSequenceModel:: EvaluateInIsolation(const Phrase &source
-    , const TargetPhrase &targetPhrase
-    , ScoreComponentCollection &scoreBreakdown
-    , ScoreComponentCollection &estimatedFutureScore) const
+void OpSequenceModel::MakeOps(const std::vector <std::string> &source
+                              , const TargetPhrase &targetPhrase
+                              , osmPhraseOps &ops) const
 {
-
   osmHypothesis obj;
-  obj.setState(OSM->NullContextState());
-  WordsBitmap myBitmap(source.GetSize());
-  vector <string> mySourcePhrase;
+  vector <string> mySourcePhrase = source;
   vector <string> myTargetPhrase;
-  vector<float> scores;
   vector <int> alignments;
-  int startIndex = 0;
-  int endIndex = source.GetSize();
 
   const AlignmentInfo &align = targetPhrase.GetAlignTerm();
   AlignmentInfo::const_iterator iter;
@@ -73,19 +68,56 @@ void OpSequenceModel:: EvaluateInIsolation(const Phrase &source
       myTargetPhrase.push_back(targetPhrase.GetWord(i).GetFactor(tFactor)->GetString().as_string());
   }
 
+  obj.setPhrases(mySourcePhrase , myTargetPhrase);
+  obj.constructCepts(alignments,0,source.size()-1,targetPhrase.GetSize());
+  obj.constructOps(*OSM,ops);
+}
+
+void OpSequenceModel:: EvaluateInIsolation(const Phrase &source
+    , const TargetPhrase &targetPhrase
+    , ScoreComponentCollection &scoreBreakdown
+    , ScoreComponentCollection &estimatedFutureScore) const
+{
+
+  osmHypothesis obj;
+  obj.setState(OSM->NullContextState());
+  WordsBitmap myBitmap(source.GetSize());
+  vector <string> mySourcePhrase;
+  vector<float> scores;
+  osmPhraseOps ops;
+
   for (size_t i = 0; i < source.GetSize(); i++) {
     mySourcePhrase.push_back(source.GetWord(i).GetFactor(sFactor)->GetString().as_string());
   }
 
-  obj.setPhrases(mySourcePhrase , myTargetPhrase);
-  obj.constructCepts(alignments,startIndex,endIndex-1,targetPhrase.GetSize());
-  obj.computeOSMFeature(startIndex,myBitmap);
+  MakeOps(mySourcePhrase, targetPhrase, ops);
+  obj.computeOSMFeature(0,myBitmap,ops,m_reorderingOps);
   obj.calculateOSMProb(*OSM);
   obj.populateScores(scores,numFeatures);
   estimatedFutureScore.PlusEquals(this, scores);
 
 }
 
+void OpSequenceModel::EvaluateWithSourceContext(const InputType &input
+    , const InputPath &inputPath
+    , const TargetPhrase &targetPhrase
+    , const StackVec *stackVec
+    , ScoreComponentCollection &scoreBreakdown
+    , ScoreComponentCollection *estimatedFutureScore) const
+{
+  const WordsRange &sourceRange = inputPath.GetWordsRange();
+  vector <string> mySourcePhrase;
+
+  // the words the hypothesis will see, see EvaluateWhenApplied()
+  for (size_t i = sourceRange.GetStartPos(); i <= sourceRange.GetEndPos(); i++) {
+    mySourcePhrase.push_back(input.GetWord(i).GetFactor(sFactor)->GetString().as_string());
+  }
+
+  osmPhraseOps *ops = new osmPhraseOps;
+  MakeOps(mySourcePhrase, targetPhrase, *ops);
+  // a phrase that is evaluated again keeps the operations it has
+  targetPhrase.SetData(GetScoreProducerDescription(), boost::shared_ptr<void>(ops));
+}
 
 FFState* OpSequenceModel::EvaluateWhenApplied(
   const Hypothesis& cur_hypo,
@@ -95,103 +127,39 @@ FFState* OpSequenceModel::EvaluateWhenApplied(
   const TargetPhrase &target = cur_hypo.GetCurrTargetPhrase();
   const WordsBitmap &bitmap = cur_hypo.GetWordsBitmap();
   WordsBitmap myBitmap = bitmap;
-  const Manager &manager = cur_hypo.GetManager();
-  const InputType &source = manager.GetSource();
-  // const Sentence &sourceSentence = static_cast<const Sentence&>(source);
   osmHypothesis obj;
-  vector <string> mySourcePhrase;
-  vector <string> myTargetPhrase;
   vector<float> scores;
 
-
-  //target.GetWord(0)
-
-  //cerr << target <<" --- "<<target.GetSourcePhrase()<< endl;  // English ...
-
-  //cerr << align << endl;   // Alignments ...
-  //cerr << cur_hypo.GetCurrSourceWordsRange() << endl;
-
-  //cerr << source <<endl;
-
-// int a = sourceRange.GetStartPos();
-// cerr << source.GetWord(a);
-  //cerr <<a<<endl;
-
-  //const Sentence &sentence = static_cast<const Sentence&>(curr_hypo.GetManager().GetSource());
-
-
   const WordsRange & sourceRange = cur_hypo.GetCurrSourceWordsRange();
   int startIndex  = sourceRange.GetStartPos();
   int endIndex = sourceRange.GetEndPos();
-  const AlignmentInfo &align = cur_hypo.GetCurrTargetPhrase().GetAlignTerm();
-  // osmState * statePtr;
-
-  vector <int> alignments;
-
-
-
-  AlignmentInfo::const_iterator iter;
-
-  for (iter = align.begin(); iter != align.end(); ++iter) {
-    //cerr << iter->first << "----" << iter->second << " ";
-    alignments.push_back(iter->first);
-    alignments.push_back(iter->second);
-  }
-
-
-  //cerr<<bitmap<<endl;
-  //cerr<<startIndex<<" "<<endIndex<<endl;
-
 
   for (int i = startIndex; i <= endIndex; i++) {
     myBitmap.SetValue(i,0); // resetting coverage of this phrase ...
-    mySourcePhrase.push_back(source.GetWord(i).GetFactor(sFactor)->GetString().as_string());
-    // cerr<<mySourcePhrase[i]<<endl;
   }
 
-  for (size_t i = 0; i < target.GetSize(); i++) {
-
-    if (target.GetWord(i).IsOOV() && sFactor == 0 && tFactor == 0)
-      myTargetPhrase.push_back("_TRANS_SLF_");
-    else
-      myTargetPhrase.push_back(target.GetWord(i).GetFactor(tFactor)->GetString().as_string());
-
+  // normally built by EvaluateWithSourceContext()
+  const boost::shared_ptr<void> data = target.GetData(GetScoreProducerDescription());
+  const osmPhraseOps *ops = static_cast<const osmPhraseOps*>(data.get());
+  osmPhraseOps localOps;
+  if (ops == NULL) {
+    const InputType &source = cur_hypo.GetManager().GetSource();
+    vector <string> mySourcePhrase;
+    for (int i = startIndex; i <= endIndex; i++) {
+      mySourcePhrase.push_back(source.GetWord(i).GetFactor(sFactor)->GetString().as_string());
+    }
+    MakeOps(mySourcePhrase, target, localOps);
+    ops = &localOps;
   }
 
-
-  //cerr<<myBitmap<<endl;
-
   obj.setState(prev_state);
-  obj.constructCepts(alignments,startIndex,endIndex,target.GetSize());
-  obj.setPhrases(mySourcePhrase , myTargetPhrase);
-  obj.computeOSMFeature(startIndex,myBitmap);
+  obj.computeOSMFeature(startIndex,myBitmap,*ops,m_reorderingOps);
   obj.calculateOSMProb(*OSM);
   obj.populateScores(scores,numFeatures);
-  //obj.print();
-
-  /*
-    if (bitmap.GetFirstGapPos() == NOT_FOUND)
-    {
-
-      int xx;
-  	 cerr<<bitmap<<endl;
-  	 int a = bitmap.GetFirstGapPos();
-  	 obj.print();
-      cin>>xx;
-    }
-    */
-
-
 
   accumulator->PlusEquals(this, scores);
 
   return obj.saveState();
-
-
-
-
-  //return statePtr;
-// return NULL;
 }
 
 FFState* OpSequenceModel::EvaluateWhenApplied(
@@ -37,13 +37,13 @@ public:
     int /* featureID - used to index the state in the previous hypotheses */,
     ScoreComponentCollection* accumulator) const;
 
+  //! builds the phrase pair's operations, see osmPhraseOps
   void EvaluateWithSourceContext(const InputType &input
                                  , const InputPath &inputPath
                                  , const TargetPhrase &targetPhrase
                                  , const StackVec *stackVec
                                  , ScoreComponentCollection &scoreBreakdown
-                                 , ScoreComponentCollection *estimatedFutureScore = NULL) const {
-  }
+                                 , ScoreComponentCollection *estimatedFutureScore = NULL) const;
 
   void EvaluateTranslationOptionListWithSourceContext(const InputType &input
       , const TranslationOptionList &translationOptionList) const {
@@ -56,6 +56,10 @@ public:
 
   virtual const FFState* EmptyHypothesisState(const InputType &input) const;
 
+  bool HasStateHash() const {
+    return true;
+  }
+
   virtual std::string GetScoreProducerWeightShortName(unsigned idx=0) const;
 
   std::vector<float> GetFutureScores(const Phrase &source, const Phrase &target) const;
@@ -71,6 +75,9 @@ protected:
   std::vector < std::pair < std::set <int> , std::set <int> > > ceptsInPhrase;
   std::set <int> targetNullWords;
   std::string m_lmPath;
+  osmReorderingOps m_reorderingOps;
+
+  void MakeOps(const std::vector <std::string> &source, const TargetPhrase &target, osmPhraseOps &ops) const;
 
 
 };
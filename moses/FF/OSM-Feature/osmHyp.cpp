@@ -1,11 +1,45 @@
 #include "osmHyp.h"
 #include <sstream>
+#include <boost/functional/hash.hpp>
 
 using namespace std;
 using namespace lm::ngram;
 
 namespace Moses
 {
+
+namespace
+{
+// jumps back over more gaps than this are looked up when they happen
+const int kMaxJumpBack = 256;
+
+string intToString(int num)
+{
+  std::ostringstream stm;
+  stm<<num;
+  return stm.str();
+}
+}
+
+void osmReorderingOps::Load(const OSMLM &model)
+{
+  lm = &model;
+  insGap = model.Index("_INS_GAP_");
+  jmpFwd = model.Index("_JMP_FWD_");
+  contCept = model.Index("_CONT_CEPT_");
+  jmpBck.resize(kMaxJumpBack + 1);
+  for (int n = 0; n <= kMaxJumpBack; n++) {
+    jmpBck[n] = model.Index("_JMP_BCK_" + intToString(n));
+  }
+}
+
+lm::WordIndex osmReorderingOps::JumpBack(int n) const
+{
+  if (n >= 0 && n < (int) jmpBck.size())
+    return jmpBck[n];
+  return lm->Index("_JMP_BCK_" + intToString(n));
+}
+
 osmState::osmState(const State & val)
   :j(0)
   ,E(0)
@@ -14,7 +48,7 @@ osmState::osmState(const State & val)
 
 }
 
-void osmState::saveState(int jVal, int eVal, map <int , string> & gapVal)
+void osmState::saveState(int jVal, int eVal, const osmGaps & gapVal)
 {
   gap.clear();
   gap = gapVal;
@@ -39,6 +73,20 @@ int osmState::Compare(const FFState& otherBase) const
   return 0;
 }
 
+size_t osmState::hash() const
+{
+  // what Compare() looks at
+  size_t seed = 0;
+  boost::hash_combine(seed, j);
+  boost::hash_combine(seed, E);
+  for (osmGaps::const_iterator i = gap.begin(); i != gap.end(); ++i) {
+    boost::hash_combine(seed, i->first);
+    boost::hash_combine(seed, i->second);
+  }
+  boost::hash_combine(seed, lmState.length);
+  return seed;
+}
+
 
 std::string osmState :: getName() const
 {
@@ -81,59 +129,9 @@ osmState * osmHypothesis :: saveState()
   return statePtr;
 }
 
-int osmHypothesis :: isTranslationOperation(int x)
+void osmHypothesis :: calculateOSMProb(const OSMLM& ptrOp)
 {
-  if (operations[x].find("_JMP_BCK_") != -1)
-    return 0;
-
-  if (operations[x].find("_JMP_FWD_") != -1)
-    return 0;
-
-  if (operations[x].find("_CONT_CEPT_") != -1)
-    return 0;
-
-  if (operations[x].find("_INS_GAP_") != -1)
-    return 0;
-
-  return 1;
-
-}
-
-void osmHypothesis :: removeReorderingOperations()
-{
-  gapCount = 0;
-  deletionCount = 0;
-  openGapCount = 0;
-  gapWidth = 0;
-
-  std::vector <std::string> tupleSequence;
-
-  for (int x = 0; x < operations.size(); x++) {
-    // cout<<operations[x]<<endl;
-
-    if(isTranslationOperation(x) == 1) {
-      tupleSequence.push_back(operations[x]);
-    }
-
-  }
-
-  operations.clear();
-  operations = tupleSequence;
-}
-
-void osmHypothesis :: calculateOSMProb(OSMLM& ptrOp)
-{
-
-  opProb = 0;
-  State currState = lmState;
-  State temp;
-
-  for (int i = 0; i<operations.size(); i++) {
-    temp = currState;
-    opProb += ptrOp.Score(temp,operations[i],currState);
-  }
-
-  lmState = currState;
+  opProb = ptrOp.Score(lmState,operations,lmState);
 
   //print();
 }
@@ -155,17 +153,7 @@ int osmHypothesis :: firstOpenGap(vector <int> & coverageVector)
 
 }
 
-string osmHypothesis :: intToString(int num)
-{
-
-  std::ostringstream stm;
-  stm<<num;
-
-  return stm.str();
-
-}
-
-void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFlag , WordsBitmap & coverageVector , string english , string german , set <int> & targetNullWords , vector <string> & currF)
+void osmHypothesis :: generateOperations(int startIndex , int j1 , int contFlag , WordsBitmap & coverageVector , lm::WordIndex op , const osmPhraseOps & ops , const osmReorderingOps & reo)
 {
 
   int gFlag = 0;
@@ -174,72 +162,52 @@ void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFla
 
 
   if ( j < j1) { // j1 is the index of the source word we are about to generate ...
-    //if(coverageVector[j]==0) // if source word at j is not generated yet ...
     if(coverageVector.GetValue(j)==0) { // if source word at j is not generated yet ...
-      operations.push_back("_INS_GAP_");
+      operations.push_back(reo.insGap);
       gFlag++;
-      gap[j]="Unfilled";
+      gap[j]=true;
     }
     if (j == E) {
       j = j1;
     } else {
-      operations.push_back("_JMP_FWD_");
+      operations.push_back(reo.jmpFwd);
       j=E;
     }
   }
 
   if (j1 < j) {
-    // if(j < E && coverageVector[j]==0)
     if(j < E && coverageVector.GetValue(j)==0) {
-      operations.push_back("_INS_GAP_");
+      operations.push_back(reo.insGap);
       gFlag++;
-      gap[j]="Unfilled";
+      gap[j]=true;
     }
 
     j=closestGap(gap,j1,gp);
-    operations.push_back("_JMP_BCK_"+ intToString(gp));
-
-    //cout<<"I am j "<<j<<endl;
-    //cout<<"I am j1 "<<j1<<endl;
+    operations.push_back(reo.JumpBack(gp));
 
     if(j==j1)
-      gap[j]="Filled";
+      gap[j]=false;
   }
 
   if (j < j1) {
-    operations.push_back("_INS_GAP_");
-    gap[j] = "Unfilled";
+    operations.push_back(reo.insGap);
+    gap[j] = true;
     gFlag++;
     j=j1;
   }
 
-  if(contFlag == 0) { // First words of the multi-word cept ...
-
-    if(english == "_TRANS_SLF_") { // Unknown word ...
-      operations.push_back("_TRANS_SLF_");
-    } else {
-      operations.push_back("_TRANS_" + english + "_TO_" + german);
-    }
-
-    //ans = firstOpenGap(coverageVector);
-    ans = coverageVector.GetFirstGapPos();
-
-    if (ans != -1)
-      gapWidth += j - ans;
-
-  } else if (contFlag == 2) {
+  // the translation, insertion (contFlag 2) or _CONT_CEPT_ (contFlag 1)
+  operations.push_back(op);
 
-    operations.push_back("_INS_" + german);
+  if (contFlag != 1) {
     ans = coverageVector.GetFirstGapPos();
 
     if (ans != -1)
       gapWidth += j - ans;
-    deletionCount++;
-  } else {
-    operations.push_back("_CONT_CEPT_");
   }
+  if (contFlag == 2)
+    deletionCount++;
 
-  //coverageVector[j]=1;
   coverageVector.SetValue(j,1);
   j+=1;
 
@@ -251,13 +219,11 @@ void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFla
 
   openGapCount += getOpenGaps();
 
-  //if (coverageVector[j] == 0 && targetNullWords.find(j) != targetNullWords.end())
-  if (j < coverageVector.GetSize()) {
-    if (coverageVector.GetValue(j) == 0 && targetNullWords.find(j) != targetNullWords.end()) {
-      j1 = j;
-      german = currF[j1-startIndex];
-      english = "_INS_";
-      generateOperations(startIndex, j1, 2 , coverageVector , english , german , targetNullWords , currF);
+  // the next source word is unaligned, insert it right away
+  size_t next = j - startIndex;
+  if (static_cast<size_t>(j) < coverageVector.GetSize() && next < ops.unalignedSource.size()) {
+    if (coverageVector.GetValue(j) == 0 && ops.unalignedSource[next]) {
+      generateOperations(startIndex, j, 2 , coverageVector , ops.insert[next] , ops , reo);
     }
   }
 
@@ -281,7 +247,7 @@ void osmHypothesis :: print()
   cerr<<"_______________"<<endl;
 }
 
-int osmHypothesis :: closestGap(map <int,string> gap, int j1, int & gp)
+int osmHypothesis :: closestGap(const osmGaps & gap, int j1, int & gp)
 {
 
   int dist=1172;
@@ -290,22 +256,21 @@ int osmHypothesis :: closestGap(map <int,string> gap, int j1, int & gp)
   gp=0;
   int opGap=0;
 
-  map <int,string> :: iterator iter;
+  osmGaps :: const_iterator iter;
 
   iter=gap.end();
 
   do {
     iter--;
-    //cout<<"Trapped "<<iter->first<<endl;
 
-    if(iter->first==j1 && iter->second== "Unfilled") {
+    if(iter->first==j1 && iter->second) {
       opGap++;
       gp = opGap;
       return j1;
 
     }
 
-    if(iter->second =="Unfilled") {
+    if(iter->second) {
       opGap++;
       temp = iter->first - j1;
 
@@ -329,11 +294,11 @@ int osmHypothesis :: closestGap(map <int,string> gap, int j1, int & gp)
 
 int osmHypothesis :: getOpenGaps()
 {
-  map <int,string> :: iterator iter;
+  osmGaps :: const_iterator iter;
 
   int nd = 0;
   for (iter = gap.begin(); iter!=gap.end(); iter++) {
-    if(iter->second == "Unfilled")
+    if(iter->second)
       nd++;
   }
 
@@ -341,10 +306,10 @@ int osmHypothesis :: getOpenGaps()
 
 }
 
-void osmHypothesis :: generateDeleteOperations(std::string english, int currTargetIndex, std::set <int> doneTargetIndexes)
+void osmHypothesis :: generateDeleteOperations(const OSMLM & lm, int currTargetIndex, const std::set <int> & doneTargetIndexes, std::vector <lm::WordIndex> & deletes)
 {
 
-  operations.push_back("_DEL_" + english);
+  deletes.push_back(lm.Index("_DEL_" + currE[currTargetIndex]));
   currTargetIndex++;
 
   while(doneTargetIndexes.find(currTargetIndex) != doneTargetIndexes.end()) {
@@ -352,55 +317,40 @@ void osmHypothesis :: generateDeleteOperations(std::string english, int currTarg
   }
 
   if (sourceNullWords.find(currTargetIndex) != sourceNullWords.end()) {
-    english = currE[currTargetIndex];
-    generateDeleteOperations(english,currTargetIndex,doneTargetIndexes);
+    generateDeleteOperations(lm,currTargetIndex,doneTargetIndexes,deletes);
   }
 
 }
 
-void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageVector)
+void osmHypothesis :: constructOps(const OSMLM & lm, osmPhraseOps & ops)
 {
 
   set <int> doneTargetIndexes;
-  set <int> eSide;
-  set <int> fSide;
-  set <int> :: iterator iter;
+  set <int> :: const_iterator iter;
   string english;
   string source;
-  int j1;
-  int start = 0;
   int targetIndex = 0;
-  doneTargetIndexes.clear();
-
-
-  if (targetNullWords.size() != 0) { // Source words to be deleted in the start of this phrase ...
-    iter = targetNullWords.begin();
 
-    if (*iter == startIndex) {
-
-      j1 = startIndex;
-      source = currF[j1-startIndex];
-      english = "_INS_";
-      generateOperations(startIndex, j1, 2 , coverageVector , english , source , targetNullWords , currF);
-    }
+  ops.unalignedSource.assign(currF.size(), false);
+  ops.insert.resize(currF.size());
+  for (size_t i = 0; i < currF.size(); i++) {
+    ops.unalignedSource[i] = targetNullWords.find(i) != targetNullWords.end();
+    ops.insert[i] = lm.Index("_INS_" + currF[i]);
   }
 
   if (sourceNullWords.find(targetIndex) != sourceNullWords.end()) { // first word has to be deleted ...
-    english = currE[targetIndex];
-    generateDeleteOperations(english,targetIndex, doneTargetIndexes);
+    generateDeleteOperations(lm,targetIndex,doneTargetIndexes,ops.deletes);
   }
 
-
+  ops.cepts.resize(ceptsInPhrase.size());
   for (int i = 0; i < ceptsInPhrase.size(); i++) {
-    source = "";
-    english = "";
-
-    fSide = ceptsInPhrase[i].first;
-    eSide = ceptsInPhrase[i].second;
+    const set <int> & fSide = ceptsInPhrase[i].first;
+    const set <int> & eSide = ceptsInPhrase[i].second;
+    osmPhraseOps::Cept & cept = ops.cepts[i];
 
     iter = eSide.begin();
     targetIndex = *iter;
-    english += currE[*iter];
+    english = currE[*iter];
     iter++;
 
     for (; iter != eSide.end(); iter++) {
@@ -414,7 +364,7 @@ void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageV
     }
 
     iter = fSide.begin();
-    source += currF[*iter];
+    source = currF[*iter];
     iter++;
 
     for (; iter != fSide.end(); iter++) {
@@ -422,17 +372,12 @@ void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageV
       source += currF[*iter];
     }
 
-    iter = fSide.begin();
-    j1 = *iter + startIndex;
-    iter++;
-
-    generateOperations(startIndex, j1, 0 , coverageVector , english , source , targetNullWords , currF);
-
-
-    for (; iter != fSide.end(); iter++) {
-      j1 = *iter + startIndex;
-      generateOperations(startIndex, j1, 1 , coverageVector , english , source , targetNullWords , currF);
+    if(english == "_TRANS_SLF_") { // Unknown word ...
+      cept.op = lm.Index("_TRANS_SLF_");
+    } else {
+      cept.op = lm.Index("_TRANS_" + english + "_TO_" + source);
     }
+    cept.source.assign(fSide.begin(), fSide.end());
 
     targetIndex++; // Check whether the next target word is unaligned ...
 
@@ -441,14 +386,32 @@ void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageV
     }
 
     if(sourceNullWords.find(targetIndex) != sourceNullWords.end()) {
-      english = currE[targetIndex];
-      generateDeleteOperations(english,targetIndex, doneTargetIndexes);
+      generateDeleteOperations(lm,targetIndex,doneTargetIndexes,cept.deletes);
     }
   }
 
-  //removeReorderingOperations();
+}
 
-  //print();
+void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageVector , const osmPhraseOps & ops , const osmReorderingOps & reo)
+{
+
+  if (!ops.unalignedSource.empty() && ops.unalignedSource[0]) { // Source words to be deleted in the start of this phrase ...
+    generateOperations(startIndex, startIndex, 2 , coverageVector , ops.insert[0] , ops , reo);
+  }
+
+  operations.insert(operations.end(), ops.deletes.begin(), ops.deletes.end());
+
+  for (size_t i = 0; i < ops.cepts.size(); i++) {
+    const osmPhraseOps::Cept & cept = ops.cepts[i];
+
+    generateOperations(startIndex, cept.source[0] + startIndex, 0 , coverageVector , cept.op , ops , reo);
+
+    for (size_t k = 1; k < cept.source.size(); k++) {
+      generateOperations(startIndex, cept.source[k] + startIndex, 1 , coverageVector , reo.contCept , ops , reo);
+    }
+
+    operations.insert(operations.end(), cept.deletes.begin(), cept.deletes.end());
+  }
 
 }
 
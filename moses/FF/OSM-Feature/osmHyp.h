@@ -12,23 +12,53 @@
 namespace Moses
 {
 
+//! source position -> true while the gap there is unfilled
+typedef std::map <int, bool> osmGaps;
+
+//! Ids of the gap and jump operations
+struct osmReorderingOps {
+  lm::WordIndex insGap, jmpFwd, contCept;
+  std::vector <lm::WordIndex> jmpBck; // jmpBck[n] is _JMP_BCK_n
+  const OSMLM *lm;
+
+  void Load(const OSMLM &model);
+  lm::WordIndex JumpBack(int n) const;
+};
+
+/** The operations of a phrase pair that don't depend on where it is applied,
+ *  as ids. Built once per translation option, so that search only has to
+ *  add the gap and jump operations in between.
+ */
+struct osmPhraseOps {
+  struct Cept {
+    std::vector <int> source; // source positions, relative to the phrase
+    lm::WordIndex op; // _TRANS_e_TO_f
+    std::vector <lm::WordIndex> deletes; // unaligned target words that follow
+  };
+  std::vector <bool> unalignedSource;
+  std::vector <lm::WordIndex> insert; // _INS_f for each source position
+  std::vector <lm::WordIndex> deletes; // unaligned target words at the start
+  std::vector <Cept> cepts;
+};
+
 class osmState : public FFState
 {
 public:
   osmState(const lm::ngram::State & val);
   int Compare(const FFState& other) const;
-  void saveState(int jVal, int eVal, std::map <int , std::string> & gapVal);
+  size_t hash() const;
+  void saveState(int jVal, int eVal, const osmGaps & gapVal);
   int getJ()const {
     return j;
   }
   int getE()const {
     return E;
   }
-  std::map <int , std::string> getGap() const {
+  const osmGaps & getGap() const {
     return gap;
   }
 
-  lm::ngram::State getLMState() const {
+  const lm::ngram::State & getLMState() const {
     return lmState;
   }
 
@@ -37,7 +67,7 @@ public:
 
 protected:
   int j, E;
-  std::map <int,std::string> gap;
+  osmGaps gap;
   lm::ngram::State lmState;
 };
 
@@ -47,8 +77,8 @@ class osmHypothesis
 private:
 
 
-  std::vector <std::string> operations;	// List of operations required to generated this hyp ...
-  std::map <int,std::string> gap;	// Maintains gap history ...
+  std::vector <lm::WordIndex> operations;	// List of operations required to generated this hyp ...
+  osmGaps gap;	// Maintains gap history ...
   int j;	// Position after the last source word generated ...
   int E; // Position after the right most source word so far generated ...
   lm::ngram::State lmState; // KenLM's Model State ...
@@ -65,12 +95,11 @@ private:
   std::set <int> targetNullWords;
   std::set <int> sourceNullWords;
 
-  int closestGap(std::map <int,std::string> gap,int j1, int & gp);
+  int closestGap(const osmGaps & gap,int j1, int & gp);
   int firstOpenGap(std::vector <int> & coverageVector);
-  std::string intToString(int);
   int  getOpenGaps();
-  int isTranslationOperation(int j);
-  void removeReorderingOperations();
+  void generateOperations(int startIndex, int j1 , int contFlag , WordsBitmap & coverageVector , lm::WordIndex op , const osmPhraseOps & ops , const osmReorderingOps & reo);
+  void generateDeleteOperations(const OSMLM & lm, int currTargetIndex, const std::set <int> & doneTargetIndexes, std::vector <lm::WordIndex> & deletes);
 
   void getMeCepts ( std::set <int> & eSide , std::set <int> & fSide , std::map <int , std::vector <int> > & tS , std::map <int , std::vector <int> > & sT);
 
@@ -78,11 +107,11 @@ public:
 
   osmHypothesis();
   ~osmHypothesis() {};
-  void generateOperations(int & startIndex, int j1 , int contFlag , WordsBitmap & coverageVector , std::string english , std::string german , std::set <int> & targetNullWords , std::vector <std::string> & currF);
-  void generateDeleteOperations(std::string english, int currTargetIndex, std::set <int> doneTargetIndexes);
-  void calculateOSMProb(OSMLM& ptrOp);
-  void computeOSMFeature(int startIndex , WordsBitmap & coverageVector);
+  void calculateOSMProb(const OSMLM& ptrOp);
+  void computeOSMFeature(int startIndex , WordsBitmap & coverageVector , const osmPhraseOps & ops , const osmReorderingOps & reo);
   void constructCepts(std::vector <int> & align , int startIndex , int endIndex, int targetPhraseLength);
+  // after setPhrases() and constructCepts() with startIndex 0
+  void constructOps(const OSMLM & lm, osmPhraseOps & ops);
   void setPhrases(std::vector <std::string> & val1 , std::vector <std::string> & val2) {
     currF = val1;
     currE = val2;
@@ -37,9 +37,11 @@ PhraseOrientationFeature::PhraseOrientationFeature(const std::string &line)
   , m_offsetR2LScores(m_numScoreComponents/2)
   , m_useTargetWordList(false)
   , m_useSourceWordList(false)
+  , m_orientationKey(PhrasePropertyFactory::GetKeyId("Orientation"))
 {
   VERBOSE(1, "Initializing feature " << GetScoreProducerDescription() << " ...");
   ReadParameters();
+  PhrasePropertyFactory::DecodeOnLoad("Orientation");
   FactorCollection &factorCollection = FactorCollection::Instance();
   m_glueTargetLHS = factorCollection.AddFactor(m_glueTargetLHSStr, true);
   VERBOSE(1, " Done." << std::endl);
@@ -104,7 +106,7 @@ void PhraseOrientationFeature::EvaluateInIsolation(const Phrase &source,
 {
   targetPhrase.SetRuleSource(source);
 
-  if (const PhraseProperty *property = targetPhrase.GetProperty("Orientation")) {
+  if (const PhraseProperty *property = targetPhrase.GetProperty(m_orientationKey)) {
     const OrientationPhraseProperty *orientationPhraseProperty = static_cast<const OrientationPhraseProperty*>(property);
     LookaheadScore(orientationPhraseProperty, scoreBreakdown);
   } else {
@@ -313,7 +315,7 @@ FFState* PhraseOrientationFeature::EvaluateWhenApplied(
     const TargetPhrase &prevTarPhr = prevHypo->GetCurrTargetPhrase();
     const Factor* prevTarPhrLHS = prevTarPhr.GetTargetLHS()[0];
 
-    if (const PhraseProperty *property = prevTarPhr.GetProperty("Orientation")) {
+    if (const PhraseProperty *property = prevTarPhr.GetProperty(m_orientationKey)) {
       const OrientationPhraseProperty *orientationPhraseProperty = static_cast<const OrientationPhraseProperty*>(property);
 
       FEATUREVERBOSE(5, "orientationPhraseProperty: "
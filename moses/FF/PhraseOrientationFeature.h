@@ -18,6 +18,7 @@
 #include "moses/Factor.h"
 #include "phrase-extract/extract-ghkm/PhraseOrientation.h"
 #include "moses/PP/OrientationPhraseProperty.h"
+#include "moses/PP/Factory.h"
 #include <boost/unordered_set.hpp>
 
 
@@ -420,6 +421,7 @@ protected:
   std::string m_filenameSourceWordList;
   boost::unordered_set<const Factor*> m_sourceWordList;
   bool m_useSourceWordList;
+  size_t m_orientationKey; //!< id of the "Orientation" property
 
 };
 
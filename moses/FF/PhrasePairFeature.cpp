@@ -115,23 +115,43 @@ void PhrasePairFeature::EvaluateWithSourceContext(const InputType &input
 {
   const Phrase& source = inputPath.GetPhrase();
   if (m_simple) {
-    ostringstream namestr;
-    namestr << "pp_";
-    namestr << source.GetWord(0).GetFactor(m_sourceFactorId)->GetString();
-    for (size_t i = 1; i < source.GetSize(); ++i) {
-      const Factor* sourceFactor = source.GetWord(i).GetFactor(m_sourceFactorId);
-      namestr << ",";
-      namestr << sourceFactor->GetString();
+    // the source length tells where the target words start
+    SparseFeatureNames::Key key(source.GetSize());
+    bool cacheable = true;
+    for (size_t i = 0; cacheable && i < source.GetSize(); ++i) {
+      cacheable = key.Add(source.GetWord(i).GetFactor(m_sourceFactorId));
     }
-    namestr << "~";
-    namestr << targetPhrase.GetWord(0).GetFactor(m_targetFactorId)->GetString();
-    for (size_t i = 1; i < targetPhrase.GetSize(); ++i) {
-      const Factor* targetFactor = targetPhrase.GetWord(i).GetFactor(m_targetFactorId);
-      namestr << ",";
-      namestr << targetFactor->GetString();
+    for (size_t i = 0; cacheable && i < targetPhrase.GetSize(); ++i) {
+      cacheable = key.Add(targetPhrase.GetWord(i).GetFactor(m_targetFactorId));
     }
+    const FName *name = cacheable ? m_names.Find(key) : NULL;
+    if (name == NULL) {
+      ostringstream namestr;
+      namestr << "pp_";
+      namestr << source.GetWord(0).GetFactor(m_sourceFactorId)->GetString();
+      for (size_t i = 1; i < source.GetSize(); ++i) {
+        const Factor* sourceFactor = source.GetWord(i).GetFactor(m_sourceFactorId);
+        namestr << ",";
+        namestr << sourceFactor->GetString();
+      }
+      namestr << "~";
+      namestr << targetPhrase.GetWord(0).GetFactor(m_targetFactorId)->GetString();
+      for (size_t i = 1; i < targetPhrase.GetSize(); ++i) {
+        const Factor* targetFactor = targetPhrase.GetWord(i).GetFactor(m_targetFactorId);
+        namestr << ",";
+        namestr << targetFactor->GetString();
+      }
 
-    scoreBreakdown.SparsePlusEquals(namestr.str(),1);
+      if (cacheable) {
+        name = &m_names.Add(key, namestr.str());
+      } else {
+        // too long to be cached
+        scoreBreakdown.SparsePlusEquals(namestr.str(),1);
+      }
+    }
+    if (name) {
+      scoreBreakdown.SparsePlusEquals(*name,1);
+    }
   }
   if (m_domainTrigger) {
     const Sentence& input = static_cast<const Sentence&>(input);
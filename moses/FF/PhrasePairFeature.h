@@ -5,6 +5,7 @@
 #include <boost/unordered_set.hpp>
 
 #include "StatelessFeatureFunction.h"
+#include "SparseFeatureNames.h"
 #include "moses/Factor.h"
 #include "moses/Sentence.h"
 
@@ -31,6 +32,7 @@ class PhrasePairFeature: public StatelessFeatureFunction
   bool m_ignorePunctuation;
   CharHash m_punctuationHash;
   std::string m_filePathSource;
+  SparseFeatureNames m_names;
 
 public:
   PhrasePairFeature(const std::string &line);
@@ -39,6 +41,9 @@ public:
   void SetParameter(const std::string& key, const std::string& value);
 
   bool IsUseable(const FactorMask &mask) const;
+  bool DependsOnSourceContext() const {
+    return m_sourceContext || m_domainTrigger;
+  }
 
   void EvaluateInIsolation(const Phrase &source
                            , const TargetPhrase &targetPhrase
@@ -80,8 +80,7 @@ void SoftMatchingFeature::EvaluateWhenApplied(const ChartHypothesis& hypo,
       const ChartHypothesis* prevHypo = hypo.GetPrevHypo(nonTermInd);
       const Word& prevLHS = prevHypo->GetTargetLHS();
 
-      const std::string &name = GetOrSetFeatureName(word, prevLHS);
-      accumulator->PlusEquals(this,name,1);
+      accumulator->SparsePlusEquals(GetOrSetFeatureName(word, prevLHS), 1);
     }
   }
 }
@@ -94,37 +93,39 @@ void SoftMatchingFeature::ResizeCache() const
 
   m_nameCache.resize(numNonTerminals);
   for (size_t i = 0; i < numNonTerminals; i++) {
-    m_nameCache[i].resize(numNonTerminals);
+    m_nameCache[i].resize(numNonTerminals, NULL);
   }
 }
 
 
-const std::string& SoftMatchingFeature::GetOrSetFeatureName(const Word& RHS, const Word& LHS) const
+FName SoftMatchingFeature::GetOrSetFeatureName(const Word& RHS, const Word& LHS) const
 {
-  try {
+  const size_t rhsId = RHS[0]->GetId();
+  const size_t lhsId = LHS[0]->GetId();
+  {
 #ifdef WITH_THREADS //try read-only lock
     boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
 #endif
-    const std::string &name = m_nameCache.at(RHS[0]->GetId()).at(LHS[0]->GetId());
-    if (!name.empty()) {
-      return name;
+    if (rhsId < m_nameCache.size() && lhsId < m_nameCache[rhsId].size()
+        && m_nameCache[rhsId][lhsId]) {
+      return *m_nameCache[rhsId][lhsId];
     }
-  } catch (const std::out_of_range& oor) {
-#ifdef WITH_THREADS //need to resize cache; write lock
-    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif
-    ResizeCache();
   }
 #ifdef WITH_THREADS //need to update cache; write lock
   boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
 #endif
-  std::string &name = m_nameCache[RHS[0]->GetId()][LHS[0]->GetId()];
-  const std::vector<FactorType> &outputFactorOrder = StaticData::Instance().GetOutputFactorOrder();
-  std::string LHS_string = LHS.GetString(outputFactorOrder, false);
-  std::string RHS_string = RHS.GetString(outputFactorOrder, false);
-  name = LHS_string + "->" + RHS_string;
-  return name;
+  if (rhsId >= m_nameCache.size() || lhsId >= m_nameCache[rhsId].size()) {
+    ResizeCache();
+  }
+  const FName *&name = m_nameCache[rhsId][lhsId];
+  if (!name) {
+    const std::vector<FactorType> &outputFactorOrder = StaticData::Instance().GetOutputFactorOrder();
+    std::string LHS_string = LHS.GetString(outputFactorOrder, false);
+    std::string RHS_string = RHS.GetString(outputFactorOrder, false);
+    m_names.push_back(FName(GetScoreProducerDescription(), LHS_string + "->" + RHS_string));
+    name = &m_names.back();
+  }
+  return *name;
 }
 
 }
-
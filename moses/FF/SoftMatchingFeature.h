@@ -1,6 +1,8 @@
 #pragma once
 
+#include <deque>
 #include "moses/Word.h"
+#include "moses/FeatureVector.h"
 #include "StatelessFeatureFunction.h"
 
 #ifdef WITH_THREADS
@@ -48,13 +50,15 @@ public:
 
   void ResizeCache() const;
 
-  const std::string& GetOrSetFeatureName(const Word& RHS, const Word& LHS) const;
+  FName GetOrSetFeatureName(const Word& RHS, const Word& LHS) const;
   void SetParameter(const std::string& key, const std::string& value);
 
 
 private:
   mutable std::vector<std::vector<Word> > m_softMatches; // map RHS of new rule to list of possible LHS of old rule (subtree)
-  mutable std::vector<std::vector<std::string> > m_nameCache;
+  // feature names by id of the RHS and LHS label; NULL if not made yet
+  mutable std::vector<std::vector<const FName*> > m_nameCache;
+  mutable std::deque<FName> m_names; // deque: pointers stay valid as it grows
 
 #ifdef WITH_THREADS
   //reader-writer lock
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include <limits>
 #include <cassert>
@@ -11,6 +12,7 @@
 #include "moses/FactorCollection.h"
 #include "moses/TreeInput.h"
 #include "moses/PP/SourceLabelsPhraseProperty.h"
+#include "moses/PP/Factory.h"
 
 
 using namespace std;
@@ -27,9 +29,11 @@ SoftSourceSyntacticConstraintsFeature::SoftSourceSyntacticConstraintsFeature(con
   , m_useSparseLabelPairs(false)
   , m_noMismatches(false)
   , m_floor(1e-7)
+  , m_sourceLabelsKey(PhrasePropertyFactory::GetKeyId("SourceLabels"))
 {
   VERBOSE(1, "Initializing feature " << GetScoreProducerDescription() << " ...");
   ReadParameters();
+  PhrasePropertyFactory::DecodeOnLoad("SourceLabels");
   VERBOSE(1, " Done.");
   VERBOSE(1, " Config:");
   VERBOSE(1, " Log probabilities");
@@ -115,7 +119,7 @@ void SoftSourceSyntacticConstraintsFeature::LoadSourceLabelSet()
   m_sourceLabelsByIndex_RHS_0.clear();
   m_sourceLabelsByIndex_LHS_1.clear();
   m_sourceLabelsByIndex_LHS_0.clear();
-  m_sourceLabelIndexesByFactor.clear();
+  m_sourceLabelIndexesByFactorId.clear();
   while (getline(inFile, line)) {
     std::istringstream tokenizer(line);
     std::string label;
@@ -132,22 +136,27 @@ void SoftSourceSyntacticConstraintsFeature::LoadSourceLabelSet()
 
     if (index >= m_sourceLabelsByIndex.size()) {
       m_sourceLabelsByIndex.resize(index+1);
-      m_sourceLabelsByIndex_RHS_1.resize(index+1);
-      m_sourceLabelsByIndex_RHS_0.resize(index+1);
-      m_sourceLabelsByIndex_LHS_1.resize(index+1);
-      m_sourceLabelsByIndex_LHS_0.resize(index+1);
     }
     m_sourceLabelsByIndex[index] = label;
-    m_sourceLabelsByIndex_RHS_1[index] = "RHS_1_" + label;
-    m_sourceLabelsByIndex_RHS_0[index] = "RHS_0_" + label;
-    m_sourceLabelsByIndex_LHS_1[index] = "LHS_1_" + label;
-    m_sourceLabelsByIndex_LHS_0[index] = "LHS_0_" + label;
     const Factor* sourceLabelFactor = factorCollection.AddFactor(label,true);
-    m_sourceLabelIndexesByFactor[sourceLabelFactor] = index;
+    if (sourceLabelFactor->GetId() >= m_sourceLabelIndexesByFactorId.size()) {
+      m_sourceLabelIndexesByFactorId.resize(sourceLabelFactor->GetId()+1, NOT_FOUND);
+    }
+    m_sourceLabelIndexesByFactorId[sourceLabelFactor->GetId()] = index;
   }
 
   inFile.Close();
 
+  // sparse feature names, so that scoring doesn't assemble strings
+  const std::string &description = GetScoreProducerDescription();
+  for (size_t index = 0; index < m_sourceLabelsByIndex.size(); ++index) {
+    const std::string &label = m_sourceLabelsByIndex[index];
+    m_sourceLabelsByIndex_RHS_1.push_back(FName(description, "RHS_1_" + label));
+    m_sourceLabelsByIndex_RHS_0.push_back(FName(description, "RHS_0_" + label));
+    m_sourceLabelsByIndex_LHS_1.push_back(FName(description, "LHS_1_" + label));
+    m_sourceLabelsByIndex_LHS_0.push_back(FName(description, "LHS_0_" + label));
+  }
+
   std::list<std::string> specialLabels;
   specialLabels.push_back("GlueTop");
   specialLabels.push_back("GlueX");
@@ -174,23 +183,23 @@ void SoftSourceSyntacticConstraintsFeature::LoadCoreSourceLabelSet()
 {
   FEATUREVERBOSE(2, "Loading core source label set from file " << m_coreSourceLabelSetFile << " ...");
   // read core source label set
-  LoadLabelSet(m_coreSourceLabelSetFile, m_coreSourceLabels);
+  LoadLabelSet(m_coreSourceLabelSetFile, m_isCoreSourceLabel);
   FEATUREVERBOSE2(2, " Done." << std::endl);
 }
 
 void SoftSourceSyntacticConstraintsFeature::LoadLabelSet(std::string &filename,
-    boost::unordered_set<size_t> &labelSet)
+    std::vector<bool> &labelSet)
 {
   InputFileStream inFile(filename);
   std::string line;
-  labelSet.clear();
+  labelSet.assign(m_sourceLabelsByIndex.size(), false);
   while (getline(inFile, line)) {
     istringstream tokenizer(line);
     std::string label;
     tokenizer >> label;
     boost::unordered_map<std::string,size_t>::iterator foundSourceLabelIndex = m_sourceLabels.find( label );
     if ( foundSourceLabelIndex != m_sourceLabels.end() ) {
-      labelSet.insert(foundSourceLabelIndex->second);
+      labelSet[foundSourceLabelIndex->second] = true;
     } else {
       FEATUREVERBOSE(2, "Ignoring unknown source label \"" << label << "\" "
                      << "from core source label set file " << filename << "."
@@ -207,17 +216,13 @@ void SoftSourceSyntacticConstraintsFeature::LoadTargetSourceLeftHandSideJointCou
   FEATUREVERBOSE(2, "Loading target/source label joint counts from file " << m_targetSourceLHSJointCountFile << " ...");
   InputFileStream inFile(m_targetSourceLHSJointCountFile);
 
-  for (boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::iterator iter=m_labelPairProbabilities.begin();
-       iter!=m_labelPairProbabilities.end(); ++iter) {
-    delete iter->second;
-  }
   m_labelPairProbabilities.clear();
 
   // read joint counts
   std::string line;
   FactorCollection &factorCollection = FactorCollection::Instance();
-  boost::unordered_map<const Factor*,float> targetLHSCounts;
-  std::vector<float> sourceLHSCounts(m_sourceLabels.size(),0.0);
+  std::vector<float> targetLHSCounts;
+  std::vector<float> sourceLHSCounts(m_sourceLabelsByIndex.size(),0.0);
 
   while (getline(inFile, line)) {
     istringstream tokenizer(line);
@@ -233,38 +238,26 @@ void SoftSourceSyntacticConstraintsFeature::LoadTargetSourceLeftHandSideJointCou
                    << ": Target/source label joint count file " << m_targetSourceLHSJointCountFile
                    << " contains unknown source label \"" << sourceLabel << "\".");
 
-    const Factor* targetLabelFactor = factorCollection.AddFactor(targetLabel,true);
+    const size_t targetLabelId = factorCollection.AddFactor(targetLabel,true)->GetId();
+    if (targetLabelId >= m_labelPairProbabilities.size()) {
+      m_labelPairProbabilities.resize(targetLabelId+1);
+      targetLHSCounts.resize(targetLabelId+1, 0.0);
+    }
+    std::vector< std::pair<float,float> > &sourceVector = m_labelPairProbabilities[targetLabelId];
+    if (sourceVector.empty()) {
+      sourceVector.resize(m_sourceLabelsByIndex.size(), std::pair<float,float>(0.0,0.0));
+    }
 
     sourceLHSCounts[foundSourceLabelIndex->second] += count;
-    std::pair< boost::unordered_map<const Factor*,float >::iterator, bool > insertedTargetLHSCount =
-      targetLHSCounts.insert( std::pair<const Factor*,float>(targetLabelFactor,count) );
-    if (!insertedTargetLHSCount.second) {
-      (insertedTargetLHSCount.first)->second += count;
-      boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::iterator jointCountIt =
-        m_labelPairProbabilities.find( targetLabelFactor );
-      assert(jointCountIt != m_labelPairProbabilities.end());
-      (jointCountIt->second)->at(foundSourceLabelIndex->second).first += count;
-      (jointCountIt->second)->at(foundSourceLabelIndex->second).second += count;
-    } else {
-      std::pair<float,float> init(0.0,0.0);
-      std::vector< std::pair<float,float> >* sourceVector = new std::vector< std::pair<float,float> >(m_sourceLabels.size(),init);
-      sourceVector->at(foundSourceLabelIndex->second) = std::pair<float,float>(count,count);
-      std::pair< boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::iterator, bool > insertedJointCount =
-        m_labelPairProbabilities.insert( std::pair<const Factor*, std::vector< std::pair<float,float> >* >(targetLabelFactor,sourceVector) );
-      UTIL_THROW_IF2(!insertedJointCount.second, GetScoreProducerDescription()
-                     << ": Loading target/source label joint counts from file " << m_targetSourceLHSJointCountFile << " failed.");
-    }
+    targetLHSCounts[targetLabelId] += count;
+    sourceVector[foundSourceLabelIndex->second].first += count;
+    sourceVector[foundSourceLabelIndex->second].second += count;
   }
 
   // normalization
-  for (boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::iterator iter=m_labelPairProbabilities.begin();
-       iter!=m_labelPairProbabilities.end(); ++iter) {
-    float targetLHSCount = 0;
-    boost::unordered_map<const Factor*,float >::const_iterator targetLHSCountIt = targetLHSCounts.find( iter->first );
-    if ( targetLHSCountIt != targetLHSCounts.end() ) {
-      targetLHSCount = targetLHSCountIt->second;
-    }
-    std::vector< std::pair<float,float> > &probabilities = *(iter->second);
+  for (size_t targetLabelId=0; targetLabelId<m_labelPairProbabilities.size(); ++targetLabelId) {
+    float targetLHSCount = targetLHSCounts[targetLabelId];
+    std::vector< std::pair<float,float> > &probabilities = m_labelPairProbabilities[targetLabelId];
     for (size_t index=0; index<probabilities.size(); ++index) {
 
       if ( probabilities[index].first != 0 ) {
@@ -283,6 +276,70 @@ void SoftSourceSyntacticConstraintsFeature::LoadTargetSourceLeftHandSideJointCou
 }
 
 
+const SoftSourceSyntacticConstraintsFeature::SentenceLabels &SoftSourceSyntacticConstraintsFeature::GetSentenceLabels(const InputType& input) const
+{
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+#endif
+    boost::unordered_map<const InputType*, SentenceLabels>::const_iterator found = m_cache.find(&input);
+    if (found != m_cache.end()) {
+      return found->second;
+    }
+  }
+
+  const TreeInput& treeInput = static_cast<const TreeInput&>(input);
+  const Word& outputDefaultNonTerminal = StaticData::Instance().GetOutputDefaultNonTerminal();
+  SentenceLabels labels;
+  labels.size = treeInput.GetSize();
+  labels.spans.resize(labels.size * labels.size);
+  for (size_t startPos = 0; startPos < labels.size; ++startPos) {
+    for (size_t endPos = startPos; endPos < labels.size; ++endPos) {
+      const NonTerminalSet& treeInputLabels = treeInput.GetLabelSet(startPos,endPos);
+      std::vector<size_t> &span = labels.spans[startPos * labels.size + endPos];
+      for (NonTerminalSet::const_iterator treeInputLabelsIt = treeInputLabels.begin();
+           treeInputLabelsIt != treeInputLabels.end(); ++treeInputLabelsIt) {
+        if (*treeInputLabelsIt != outputDefaultNonTerminal) {
+          size_t treeInputLabelIndex = GetSourceLabelIndex((*treeInputLabelsIt)[0]);
+          if (treeInputLabelIndex != NOT_FOUND) {
+            span.push_back(treeInputLabelIndex);
+          }
+        }
+      }
+      std::sort(span.begin(), span.end());
+      span.erase(std::unique(span.begin(), span.end()), span.end());
+    }
+  }
+
+#ifdef WITH_THREADS
+  // need to update cache; write lock
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+  std::pair<boost::unordered_map<const InputType*, SentenceLabels>::iterator, bool> inserted
+    = m_cache.insert(std::make_pair(&input, SentenceLabels()));
+  if (inserted.second) {
+    inserted.first->second.size = labels.size;
+    inserted.first->second.spans.swap(labels.spans);
+  }
+  // elements of an unordered_map stay where they are on insertion
+  return inserted.first->second;
+}
+
+void SoftSourceSyntacticConstraintsFeature::InitializeForInput(const InputType& source)
+{
+  GetSentenceLabels(source);
+}
+
+void SoftSourceSyntacticConstraintsFeature::CleanUpAfterSentenceProcessing(const InputType& source)
+{
+#ifdef WITH_THREADS
+  // need to update cache; write lock
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+  m_cache.erase(&source);
+}
+
+
 void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const InputType &input
     , const InputPath &inputPath
     , const TargetPhrase &targetPhrase
@@ -310,7 +367,6 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
   // dense scores
   std::vector<float> newScores(m_numScoreComponents,0);
 
-  const TreeInput& treeInput = static_cast<const TreeInput&>(input);
   const StaticData& staticData = StaticData::Instance();
   const Word& outputDefaultNonTerminal = staticData.GetOutputDefaultNonTerminal();
 
@@ -327,83 +383,34 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
   bool isGlueGrammarRule = false;
   bool isUnkRule = false;
 
-  if (const PhraseProperty *property = targetPhrase.GetProperty("SourceLabels")) {
+  if (const PhraseProperty *property = targetPhrase.GetProperty(m_sourceLabelsKey)) {
 
     const SourceLabelsPhraseProperty *sourceLabelsPhraseProperty = static_cast<const SourceLabelsPhraseProperty*>(property);
 
     nNTs = sourceLabelsPhraseProperty->GetNumberOfNonTerminals();
     float totalCount = sourceLabelsPhraseProperty->GetTotalCount();
 
-    // prepare for input tree label matching
-    std::vector< boost::unordered_set<size_t> > treeInputLabelsRHS(nNTs-1);
-    boost::unordered_set<size_t> treeInputLabelsLHS;
+    // source labels of the spans of the rule's non-terminals and left-hand side
+    const SentenceLabels &sentenceLabels = GetSentenceLabels(input);
+    std::vector<const std::vector<size_t>*> treeInputLabelsRHS(nNTs-1);
 
-    // get index map for underlying hypotheses
     const WordsRange& wordsRange = inputPath.GetWordsRange();
     size_t startPos = wordsRange.GetStartPos();
     size_t endPos = wordsRange.GetEndPos();
-    const Phrase *sourcePhrase = targetPhrase.GetRuleSource();
-
-    if (nNTs > 1) { // rule has right-hand side non-terminals, i.e. it's a hierarchical rule
-      size_t nonTerminalNumber = 0;
-      size_t sourceSentPos = startPos;
-
-      for (size_t sourcePhrasePos=0; sourcePhrasePos<sourcePhrase->GetSize(); ++sourcePhrasePos) {
-        // consult rule for either word or non-terminal
-        const Word &word = sourcePhrase->GetWord(sourcePhrasePos);
-        size_t symbolStartPos = sourceSentPos;
-        size_t symbolEndPos = sourceSentPos;
-        if ( word.IsNonTerminal() ) {
-          // retrieve information that is required for input tree label matching (RHS)
-          const ChartCellLabel &cell = *stackVec->at(nonTerminalNumber);
-          const WordsRange& prevWordsRange = cell.GetCoverage();
-          symbolStartPos = prevWordsRange.GetStartPos();
-          symbolEndPos = prevWordsRange.GetEndPos();
-        }
-
-        const NonTerminalSet& treeInputLabels = treeInput.GetLabelSet(symbolStartPos,symbolEndPos);
+    const std::vector<size_t> &treeInputLabelsLHS = sentenceLabels.Get(startPos,endPos);
 
-        for (NonTerminalSet::const_iterator treeInputLabelsIt = treeInputLabels.begin();
-             treeInputLabelsIt != treeInputLabels.end(); ++treeInputLabelsIt) {
-          if (*treeInputLabelsIt != outputDefaultNonTerminal) {
-            boost::unordered_map<const Factor*,size_t>::const_iterator foundTreeInputLabel
-            = m_sourceLabelIndexesByFactor.find((*treeInputLabelsIt)[0]);
-            if (foundTreeInputLabel != m_sourceLabelIndexesByFactor.end()) {
-              size_t treeInputLabelIndex = foundTreeInputLabel->second;
-              treeInputLabelsRHS[sourcePhrasePos].insert(treeInputLabelIndex);
-            }
-          }
-        }
-
-        if ( word.IsNonTerminal() ) {
-          ++nonTerminalNumber;
-        }
-        sourceSentPos = symbolEndPos + 1;
-      }
-    }
-
-    // retrieve information that is required for input tree label matching (LHS)
-    const NonTerminalSet& treeInputLabels = treeInput.GetLabelSet(startPos,endPos);
-
-    for (NonTerminalSet::const_iterator treeInputLabelsIt = treeInputLabels.begin();
-         treeInputLabelsIt != treeInputLabels.end(); ++treeInputLabelsIt) {
-      if (*treeInputLabelsIt != outputDefaultNonTerminal) {
-        boost::unordered_map<const Factor*,size_t>::const_iterator foundTreeInputLabel
-        = m_sourceLabelIndexesByFactor.find((*treeInputLabelsIt)[0]);
-        if (foundTreeInputLabel != m_sourceLabelIndexesByFactor.end()) {
-          size_t treeInputLabelIndex = foundTreeInputLabel->second;
-          treeInputLabelsLHS.insert(treeInputLabelIndex);
-        }
-      }
+    for (size_t nonTerminalNumber = 0; nonTerminalNumber < nNTs-1; ++nonTerminalNumber) {
+      const WordsRange& prevWordsRange = stackVec->at(nonTerminalNumber)->GetCoverage();
+      treeInputLabelsRHS[nonTerminalNumber] = &sentenceLabels.Get(prevWordsRange.GetStartPos(),prevWordsRange.GetEndPos());
     }
 
 
     // inspect source-labelled rule items
 
-    std::vector< boost::unordered_set<size_t> > sparseScoredTreeInputLabelsRHS(nNTs-1);
-    boost::unordered_set<size_t> sparseScoredTreeInputLabelsLHS;
+    // labels whose sparse match feature was scored, by non-terminal
+    std::vector< std::vector<size_t> > sparseScoredTreeInputLabelsRHS(nNTs-1);
+    std::vector<size_t> sparseScoredTreeInputLabelsLHS;
 
-    std::vector<bool> sourceLabelSeenAsLHS(m_sourceLabels.size(),false);
     std::vector<bool> treeInputMatchRHSCountByNonTerminal(nNTs-1,false);
     std::vector<float> treeInputMatchProbRHSByNonTerminal(nNTs-1,0.0);
 
@@ -424,21 +431,21 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
       for (std::list<size_t>::const_iterator sourceLabelsRHSIt = sourceLabelsRHS.begin();
            sourceLabelsRHSIt != sourceLabelsRHS.end(); ++sourceLabelsRHSIt, ++nonTerminalNumber) {
 
-        if (treeInputLabelsRHS[nonTerminalNumber].find(*sourceLabelsRHSIt) != treeInputLabelsRHS[nonTerminalNumber].end()) {
+        const std::vector<size_t> &treeInputLabels = *treeInputLabelsRHS[nonTerminalNumber];
+        if (std::binary_search(treeInputLabels.begin(), treeInputLabels.end(), *sourceLabelsRHSIt)) {
 
           treeInputMatchRHSCountByNonTerminal[nonTerminalNumber] = true;
           treeInputMatchProbRHSByNonTerminal[nonTerminalNumber] += sourceLabelsRHSCount; // to be normalized later on
 
-          if ( m_useSparse &&
-               (!m_useCoreSourceLabels || m_coreSourceLabels.find(*sourceLabelsRHSIt) != m_coreSourceLabels.end()) ) {
+          if ( m_useSparse && IsCoreSourceLabel(*sourceLabelsRHSIt) ) {
             // score sparse features: RHS match
-            if (sparseScoredTreeInputLabelsRHS[nonTerminalNumber].find(*sourceLabelsRHSIt) == sparseScoredTreeInputLabelsRHS[nonTerminalNumber].end()) {
+            std::vector<size_t> &sparseScored = sparseScoredTreeInputLabelsRHS[nonTerminalNumber];
+            if (std::find(sparseScored.begin(), sparseScored.end(), *sourceLabelsRHSIt) == sparseScored.end()) {
               // (only if no match has been scored for this tree input label and rule non-terminal with a previous sourceLabelItem)
-              float score_RHS_1 = (float)1/treeInputLabelsRHS[nonTerminalNumber].size();
-              scoreBreakdown.PlusEquals(this,
-                                        m_sourceLabelsByIndex_RHS_1[*sourceLabelsRHSIt],
-                                        score_RHS_1);
-              sparseScoredTreeInputLabelsRHS[nonTerminalNumber].insert(*sourceLabelsRHSIt);
+              float score_RHS_1 = (float)1/treeInputLabels.size();
+              scoreBreakdown.SparsePlusEquals(m_sourceLabelsByIndex_RHS_1[*sourceLabelsRHSIt],
+                                              score_RHS_1);
+              sparseScored.push_back(*sourceLabelsRHSIt);
             }
           }
 
@@ -456,21 +463,19 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
           isGlueGrammarRule = true;
         }
 
-        if (treeInputLabelsLHS.find(sourceLabelsLHSIt->first) != treeInputLabelsLHS.end()) {
+        if (std::binary_search(treeInputLabelsLHS.begin(), treeInputLabelsLHS.end(), sourceLabelsLHSIt->first)) {
 
           treeInputMismatchLHSBinary = false;
           treeInputMatchProbLHS += sourceLabelsLHSIt->second; // to be normalized later on
 
-          if ( m_useSparse &&
-               (!m_useCoreSourceLabels || m_coreSourceLabels.find(sourceLabelsLHSIt->first) != m_coreSourceLabels.end()) ) {
+          if ( m_useSparse && IsCoreSourceLabel(sourceLabelsLHSIt->first) ) {
             // score sparse features: LHS match
-            if (sparseScoredTreeInputLabelsLHS.find(sourceLabelsLHSIt->first) == sparseScoredTreeInputLabelsLHS.end()) {
+            if (std::find(sparseScoredTreeInputLabelsLHS.begin(), sparseScoredTreeInputLabelsLHS.end(), sourceLabelsLHSIt->first) == sparseScoredTreeInputLabelsLHS.end()) {
               // (only if no match has been scored for this tree input label and rule non-terminal with a previous sourceLabelItem)
               float score_LHS_1 = (float)1/treeInputLabelsLHS.size();
-              scoreBreakdown.PlusEquals(this,
-                                        m_sourceLabelsByIndex_LHS_1[sourceLabelsLHSIt->first],
-                                        score_LHS_1);
-              sparseScoredTreeInputLabelsLHS.insert(sourceLabelsLHSIt->first);
+              scoreBreakdown.SparsePlusEquals(m_sourceLabelsByIndex_LHS_1[sourceLabelsLHSIt->first],
+                                              score_LHS_1);
+              sparseScoredTreeInputLabelsLHS.push_back(sourceLabelsLHSIt->first);
             }
           }
 
@@ -513,17 +518,18 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
       for (size_t nonTerminalNumber = 0; nonTerminalNumber < nNTs-1; ++nonTerminalNumber) {
         // nNTs-1 because nNTs also counts the left-hand side non-terminal
 
-        float score_RHS_0 = (float)1/treeInputLabelsRHS[nonTerminalNumber].size();
-        for (boost::unordered_set<size_t>::const_iterator treeInputLabelsRHSIt = treeInputLabelsRHS[nonTerminalNumber].begin();
-             treeInputLabelsRHSIt != treeInputLabelsRHS[nonTerminalNumber].end(); ++treeInputLabelsRHSIt) {
+        const std::vector<size_t> &treeInputLabels = *treeInputLabelsRHS[nonTerminalNumber];
+        const std::vector<size_t> &sparseScored = sparseScoredTreeInputLabelsRHS[nonTerminalNumber];
+        float score_RHS_0 = (float)1/treeInputLabels.size();
+        for (std::vector<size_t>::const_iterator treeInputLabelsRHSIt = treeInputLabels.begin();
+             treeInputLabelsRHSIt != treeInputLabels.end(); ++treeInputLabelsRHSIt) {
 
-          if ( !m_useCoreSourceLabels || m_coreSourceLabels.find(*treeInputLabelsRHSIt) != m_coreSourceLabels.end() ) {
+          if ( IsCoreSourceLabel(*treeInputLabelsRHSIt) ) {
 
-            if (sparseScoredTreeInputLabelsRHS[nonTerminalNumber].find(*treeInputLabelsRHSIt) == sparseScoredTreeInputLabelsRHS[nonTerminalNumber].end()) {
+            if (std::find(sparseScored.begin(), sparseScored.end(), *treeInputLabelsRHSIt) == sparseScored.end()) {
               // score sparse features: RHS mismatch
-              scoreBreakdown.PlusEquals(this,
-                                        m_sourceLabelsByIndex_RHS_0[*treeInputLabelsRHSIt],
-                                        score_RHS_0);
+              scoreBreakdown.SparsePlusEquals(m_sourceLabelsByIndex_RHS_0[*treeInputLabelsRHSIt],
+                                              score_RHS_0);
             }
           }
         }
@@ -532,16 +538,15 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
       // LHS
 
       float score_LHS_0 = (float)1/treeInputLabelsLHS.size();
-      for (boost::unordered_set<size_t>::const_iterator treeInputLabelsLHSIt = treeInputLabelsLHS.begin();
+      for (std::vector<size_t>::const_iterator treeInputLabelsLHSIt = treeInputLabelsLHS.begin();
            treeInputLabelsLHSIt != treeInputLabelsLHS.end(); ++treeInputLabelsLHSIt) {
 
-        if ( !m_useCoreSourceLabels || m_coreSourceLabels.find(*treeInputLabelsLHSIt) != m_coreSourceLabels.end() ) {
+        if ( IsCoreSourceLabel(*treeInputLabelsLHSIt) ) {
 
-          if (sparseScoredTreeInputLabelsLHS.find(*treeInputLabelsLHSIt) == sparseScoredTreeInputLabelsLHS.end()) {
+          if (std::find(sparseScoredTreeInputLabelsLHS.begin(), sparseScoredTreeInputLabelsLHS.end(), *treeInputLabelsLHSIt) == sparseScoredTreeInputLabelsLHS.end()) {
             // score sparse features: RHS mismatch
-            scoreBreakdown.PlusEquals(this,
-                                      m_sourceLabelsByIndex_LHS_0[*treeInputLabelsLHSIt],
-                                      score_LHS_0);
+            scoreBreakdown.SparsePlusEquals(m_sourceLabelsByIndex_LHS_0[*treeInputLabelsLHSIt],
+                                            score_LHS_0);
           }
         }
       }
@@ -553,7 +558,7 @@ void SoftSourceSyntacticConstraintsFeature::EvaluateWithSourceContext(const Inpu
       // left-hand side label pairs (target NT, source NT)
       float t2sLabelsScore = 0.0;
       float s2tLabelsScore = 0.0;
-      for (boost::unordered_set<size_t>::const_iterator treeInputLabelsLHSIt = treeInputLabelsLHS.begin();
+      for (std::vector<size_t>::const_iterator treeInputLabelsLHSIt = treeInputLabelsLHS.begin();
            treeInputLabelsLHSIt != treeInputLabelsLHS.end(); ++treeInputLabelsLHSIt) {
 
         scoreBreakdown.PlusEquals(this, 
@@ -631,12 +636,11 @@ std::pair<float,float> SoftSourceSyntacticConstraintsFeature::GetLabelPairProbab
   const Factor* target,
   const size_t source) const
 {
-  boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::const_iterator found =
-    m_labelPairProbabilities.find(target);
-  if ( found == m_labelPairProbabilities.end() ) {
+  size_t targetLabelId = target->GetId();
+  if ( targetLabelId >= m_labelPairProbabilities.size() || m_labelPairProbabilities[targetLabelId].empty() ) {
     return std::pair<float,float>(m_floor,m_floor); // floor values
   }
-  std::pair<float,float> ret = found->second->at(source);
+  std::pair<float,float> ret = m_labelPairProbabilities[targetLabelId][source];
   if ( ret == std::pair<float,float>(0,0) ) {
     return std::pair<float,float>(m_floor,m_floor); // floor values
   }
@@ -6,6 +6,11 @@
 #include "StatelessFeatureFunction.h"
 #include "FFState.h"
 #include "moses/Factor.h"
+#include "moses/FeatureVector.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
 
 namespace Moses
 {
@@ -18,17 +23,16 @@ public:
 
   SoftSourceSyntacticConstraintsFeature(const std::string &line);
 
-  ~SoftSourceSyntacticConstraintsFeature() {
-    for (boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* >::iterator iter=m_labelPairProbabilities.begin();
-         iter!=m_labelPairProbabilities.end(); ++iter) {
-      delete iter->second;
-    }
-  }
 
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
 
+  bool DependsOnSourceContext() const {
+    // scores depend on the syntax labels of the input
+    return true;
+  }
+
   void SetParameter(const std::string& key, const std::string& value);
 
   void Load();
@@ -47,6 +51,10 @@ public:
                                  , ScoreComponentCollection &scoreBreakdown
                                  , ScoreComponentCollection *estimatedFutureScore = NULL) const;
 
+  void InitializeForInput(const InputType& source);
+
+  void CleanUpAfterSentenceProcessing(const InputType& source);
+
   void EvaluateTranslationOptionListWithSourceContext(const InputType &input
       , const TranslationOptionList &translationOptionList) const
   {}
@@ -74,20 +82,24 @@ protected:
   bool m_useSparseLabelPairs;
   bool m_noMismatches;
   float m_floor;
+  size_t m_sourceLabelsKey; //!< id of the "SourceLabels" property
 
   boost::unordered_map<std::string,size_t> m_sourceLabels;
   std::vector<std::string> m_sourceLabelsByIndex;
-  std::vector<std::string> m_sourceLabelsByIndex_RHS_1;
-  std::vector<std::string> m_sourceLabelsByIndex_RHS_0;
-  std::vector<std::string> m_sourceLabelsByIndex_LHS_1;
-  std::vector<std::string> m_sourceLabelsByIndex_LHS_0;
-  boost::unordered_set<size_t> m_coreSourceLabels;
-  boost::unordered_map<const Factor*,size_t> m_sourceLabelIndexesByFactor;
+  // sparse feature names by label index
+  std::vector<FName> m_sourceLabelsByIndex_RHS_1;
+  std::vector<FName> m_sourceLabelsByIndex_RHS_0;
+  std::vector<FName> m_sourceLabelsByIndex_LHS_1;
+  std::vector<FName> m_sourceLabelsByIndex_LHS_0;
+  std::vector<bool> m_isCoreSourceLabel; //!< by label index
+  //! label index by id of the non-terminal factor, NOT_FOUND if not a source label
+  std::vector<size_t> m_sourceLabelIndexesByFactorId;
   size_t m_GlueTopLabel;
 //  mutable size_t m_XRHSLabel;
 //  mutable size_t m_XLHSLabel;
 
-  boost::unordered_map<const Factor*, std::vector< std::pair<float,float> >* > m_labelPairProbabilities;
+  //! by id of the target label, then by source label index; empty if the target label was not seen
+  std::vector< std::vector< std::pair<float,float> > > m_labelPairProbabilities;
   boost::unordered_map<size_t,float> m_unknownLHSProbabilities;
   float m_smoothingWeight;
   float m_unseenLHSSmoothingFactorForUnknowns;
@@ -96,11 +108,41 @@ protected:
   void LoadCoreSourceLabelSet();
   void LoadTargetSourceLeftHandSideJointCountFile();
 
-  void LoadLabelSet(std::string &filename, boost::unordered_set<size_t> &labelSet);
+  void LoadLabelSet(std::string &filename, std::vector<bool> &labelSet);
 
   std::pair<float,float> GetLabelPairProbabilities(const Factor* target,
       const size_t source) const;
 
+  bool IsCoreSourceLabel(size_t index) const {
+    return !m_useCoreSourceLabels || (index < m_isCoreSourceLabel.size() && m_isCoreSourceLabel[index]);
+  }
+
+  size_t GetSourceLabelIndex(const Factor *label) const {
+    size_t id = label->GetId();
+    return id < m_sourceLabelIndexesByFactorId.size() ? m_sourceLabelIndexesByFactorId[id] : NOT_FOUND;
+  }
+
+  /** Indexes of the source labels of every span of a parse tree input,
+   *  sorted and without the default non-terminal. Built once per sentence
+   *  so that a rule only reads the spans of its symbols. */
+  struct SentenceLabels {
+    size_t size;
+    std::vector< std::vector<size_t> > spans; //!< by start * size + end
+
+    const std::vector<size_t> &Get(size_t startPos, size_t endPos) const {
+      return spans[startPos * size + endPos];
+    }
+  };
+
+  const SentenceLabels &GetSentenceLabels(const InputType& input) const;
+
+  // cache
+  mutable boost::unordered_map<const InputType*, SentenceLabels> m_cache;
+#ifdef WITH_THREADS
+  // reader-writer lock
+  mutable boost::shared_mutex m_accessLock;
+#endif
+
 };
 
 
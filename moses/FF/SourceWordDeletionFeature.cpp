@@ -91,14 +91,20 @@ void SourceWordDeletionFeature::ComputeFeatures(const Phrase &source,
     if (!aligned[i]) {
       const Word &w = source.GetWord(i);
       if (!w.IsNonTerminal()) {
-        const StringPiece word = w.GetFactor(m_factorType)->GetString();
-        if (word != "<s>" && word != "</s>") {
+        const Factor *factor = w.GetFactor(m_factorType);
+        SparseFeatureNames::Key key(0);
+        key.Add(factor);
+        const FName *name = m_names.Find(key);
+        if (name == NULL) {
+          const StringPiece word = factor->GetString();
+          if (word == "<s>" || word == "</s>") continue;
           if (!m_unrestricted && FindStringPiece(m_vocab, word ) == m_vocab.end()) {
-            accumulator->PlusEquals(this, StringPiece("OTHER"),1);
+            name = &m_names.Add(key, GetScoreProducerDescription() + FName::SEP + "OTHER");
           } else {
-            accumulator->PlusEquals(this,word,1);
+            name = &m_names.Add(key, GetScoreProducerDescription() + FName::SEP + word.as_string());
           }
         }
+        accumulator->SparsePlusEquals(*name, 1);
       }
     }
   }
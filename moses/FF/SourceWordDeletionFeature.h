@@ -4,6 +4,7 @@
 #include <boost/unordered_set.hpp>
 
 #include "StatelessFeatureFunction.h"
+#include "SparseFeatureNames.h"
 #include "moses/FactorCollection.h"
 #include "moses/AlignmentInfo.h"
 
@@ -19,6 +20,7 @@ private:
   FactorType m_factorType;
   bool m_unrestricted;
   std::string m_filename;
+  SparseFeatureNames m_names;
 
 public:
   SourceWordDeletionFeature(const std::string &line);
@@ -8,6 +8,7 @@
 #include "moses/TargetPhrase.h"
 #include "moses/PP/PhraseProperty.h"
 #include "moses/PP/SpanLengthPhraseProperty.h"
+#include "moses/PP/Factory.h"
 
 using namespace std;
 
@@ -17,8 +18,10 @@ SpanLength::SpanLength(const std::string &line)
   :StatelessFeatureFunction(1, line)
   ,m_smoothingMethod(None)
   ,m_const(0)
+  ,m_spanLengthKey(PhrasePropertyFactory::GetKeyId("SpanLength"))
 {
   ReadParameters();
+  PhrasePropertyFactory::DecodeOnLoad("SpanLength");
 }
 
 void SpanLength::EvaluateInIsolation(const Phrase &source
@@ -38,7 +41,7 @@ void SpanLength::EvaluateWithSourceContext(const InputType &input
 {
   assert(stackVec);
 
-  const PhraseProperty *property = targetPhrase.GetProperty("SpanLength");
+  const PhraseProperty *property = targetPhrase.GetProperty(m_spanLengthKey);
   if (property == NULL) {
     return;
   }
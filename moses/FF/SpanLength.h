@@ -50,6 +50,7 @@ protected:
   SmoothingMethod m_smoothingMethod;
 
   float m_const;
+  size_t m_spanLengthKey; //!< id of the "SpanLength" property
 };
 
 }
@@ -0,0 +1,61 @@
+#include <boost/functional/hash.hpp>
+#include "SparseFeatureNames.h"
+
+namespace Moses
+{
+
+namespace
+{
+// names are only ever added, start over rather than grow without bound
+const size_t MAX_NAMES_PER_THREAD = 1000000;
+const size_t INITIAL_BUCKETS = 4096;
+}
+
+bool SparseFeatureNames::Key::operator==(const Key &other) const
+{
+  if (m_template != other.m_template || m_size != other.m_size) return false;
+  for (size_t i = 0; i < m_size; ++i) {
+    if (m_parts[i] != other.m_parts[i]) return false;
+  }
+  return true;
+}
+
+size_t SparseFeatureNames::KeyHash::operator()(const Key &key) const
+{
+  size_t seed = key.m_template;
+  boost::hash_combine(seed, key.m_size);
+  for (size_t i = 0; i < key.m_size; ++i) {
+    boost::hash_combine(seed, key.m_parts[i]);
+  }
+  return seed;
+}
+
+SparseFeatureNames::Coll &SparseFeatureNames::GetColl() const
+{
+  Coll *coll = m_coll.get();
+  if (coll == NULL) {
+    coll = new Coll;
+    coll->rehash(INITIAL_BUCKETS);
+    m_coll.reset(coll);
+  }
+  return *coll;
+}
+
+const FName *SparseFeatureNames::Find(const Key &key) const
+{
+  const Coll &coll = GetColl();
+  Coll::const_iterator iter = coll.find(key);
+  return iter == coll.end() ? NULL : &iter->second;
+}
+
+const FName &SparseFeatureNames::Add(const Key &key, const std::string &fullName) const
+{
+  Coll &coll = GetColl();
+  if (coll.size() >= MAX_NAMES_PER_THREAD) {
+    coll.clear();
+  }
+  // node based, the reference stays valid when the map grows
+  return coll.insert(std::make_pair(key, FName(fullName))).first->second;
+}
+
+}
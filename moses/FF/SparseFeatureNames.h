@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <boost/unordered_map.hpp>
+#include "moses/FeatureVector.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <memory>
+#endif
+
+namespace Moses
+{
+
+/** Ids of sparse feature names assembled from a template and a few
+ *  factors, e.g. "wt_" + source word + "~" + target word. Factors are
+ *  unique per string, so the template number and the factor pointers
+ *  identify the name. Each thread keeps its own map, so once a name has
+ *  been seen neither a string is built nor the global name dictionary
+ *  locked. Templates are small numbers chosen by the owning feature; a
+ *  NULL part stands for a placeholder such as "OTHER".
+ */
+class SparseFeatureNames
+{
+public:
+  static const size_t MAX_PARTS = 8;
+
+  struct Key {
+    explicit Key(size_t tmpl)
+      : m_template(tmpl), m_size(0) {
+    }
+    //! false if the key is full, the name can't be cached then
+    bool Add(const void *part) {
+      if (m_size == MAX_PARTS) return false;
+      m_parts[m_size++] = part;
+      return true;
+    }
+    bool operator==(const Key &other) const;
+
+    size_t m_template;
+    size_t m_size;
+    const void *m_parts[MAX_PARTS];
+  };
+
+  SparseFeatureNames() {}
+
+  //! NULL if this thread has not seen the name yet
+  const FName *Find(const Key &key) const;
+
+  //! remember the fully assembled name of key
+  const FName &Add(const Key &key, const std::string &fullName) const;
+
+private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+  typedef boost::unordered_map<Key, FName, KeyHash> Coll;
+
+  Coll &GetColl() const;
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<Coll> m_coll;
+#else
+  mutable std::auto_ptr<Coll> m_coll;
+#endif
+
+  // not copyable
+  SparseFeatureNames(const SparseFeatureNames &);
+  void operator=(const SparseFeatureNames &);
+};
+
+}
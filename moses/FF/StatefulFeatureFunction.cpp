@@ -17,5 +17,17 @@ StatefulFeatureFunction::StatefulFeatureFunction(size_t numScoreComponents, cons
   m_statefulFFs.push_back(this);
 }
 
+void StatefulFeatureFunction::EvaluateWhenAppliedBatch(
+  const std::vector<const Hypothesis*> &hypos,
+  const std::vector<const FFState*> &prev_states,
+  const std::vector<ScoreComponentCollection*> &accumulators,
+  std::vector<FFState*> &out_states) const
+{
+  out_states.resize(hypos.size());
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    out_states[i] = EvaluateWhenApplied(*hypos[i], prev_states[i], accumulators[i]);
+  }
+}
+
 }
 
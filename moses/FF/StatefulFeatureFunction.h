@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include "FeatureFunction.h"
 
 #include "moses/Syntax/SHyperedge.h"
@@ -50,9 +51,52 @@ public:
     return 0; /* FIXME */
   }
 
+  /**
+   * \brief Evaluate several phrase-based hypotheses in one call.
+   * The batch search (search-algorithm 4) uses this for features whose
+   * IsBatchable() returns true, eg. neural models that can score a whole
+   * batch with one matrix multiply instead of one per hypothesis.
+   * prev_states[i] is the state of hypos[i]'s predecessor, scores go into
+   * accumulators[i] and the new state into out_states[i].
+   * The default calls EvaluateWhenApplied() on each hypothesis.
+   */
+  virtual void EvaluateWhenAppliedBatch(
+    const std::vector<const Hypothesis*> &hypos,
+    const std::vector<const FFState*> &prev_states,
+    const std::vector<ScoreComponentCollection*> &accumulators,
+    std::vector<FFState*> &out_states) const;
+
+  //! whether the batch search should hand this feature whole batches
+  virtual bool IsBatchable() const {
+    return false;
+  }
+
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
+  /**
+   * \brief Fixed-size summary of phrase-based states for recombination.
+   * Features whose states fit into a few 32 bit words can return their
+   * number here; the hypothesis then keeps the summaries of all such
+   * features inline and compares them with one memcmp instead of calling
+   * FFState::Compare. WriteStateKey() must write equal words exactly when
+   * Compare() would return 0. The default, 0, keeps using Compare().
+   */
+  virtual size_t GetStateKeySize() const {
+    return 0;
+  }
+
+  virtual void WriteStateKey(const FFState &state, uint32_t *key) const {
+  }
+
+  /** true if the phrase-based states of the feature implement
+   *  FFState::hash(). Hypothesis stacks are only hashed if every stateful
+   *  feature has a state key or a state hash, see
+   *  Hypothesis::IsRecombinationHashed(). */
+  virtual bool HasStateHash() const {
+    return false;
+  }
+
   bool IsStateless() const {
     return false;
   }
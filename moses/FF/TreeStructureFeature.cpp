@@ -44,9 +44,9 @@ FFState* TreeStructureFeature::EvaluateWhenApplied(const ChartHypothesis& cur_hy
     , int featureID /* used to index the state in the previous hypotheses */
     , ScoreComponentCollection* accumulator) const
 {
-  if (const PhraseProperty *property = cur_hypo.GetCurrTargetPhrase().GetProperty("Tree")) {
-    const std::string *tree = property->GetValueString();
-    TreePointer mytree (boost::make_shared<InternalTree>(*tree));
+  if (const PhraseProperty *property = cur_hypo.GetCurrTargetPhrase().GetProperty(m_treeKey)) {
+    // built from the rule's fragment, no string to parse
+    TreePointer mytree (static_cast<const TreeStructurePhraseProperty*>(property)->GetTree());
 
     if (m_labelset) {
       AddNTLabels(mytree);
@@ -5,6 +5,7 @@
 #include "StatefulFeatureFunction.h"
 #include "FFState.h"
 #include "InternalTree.h"
+#include "moses/PP/Factory.h"
 
 namespace Moses
 {
@@ -35,11 +36,14 @@ class TreeStructureFeature : public StatefulFeatureFunction
   SyntaxConstraints* m_constraints;
   LabelSet* m_labelset;
   bool m_binarized;
+  size_t m_treeKey; //!< id of the "Tree" property
 public:
   TreeStructureFeature(const std::string &line)
     :StatefulFeatureFunction(0, line)
-    , m_binarized(false) {
+    , m_binarized(false)
+    , m_treeKey(PhrasePropertyFactory::GetKeyId("Tree")) {
     ReadParameters();
+    PhrasePropertyFactory::DecodeOnLoad("Tree");
   }
   ~TreeStructureFeature() {
     delete m_constraints;
@@ -17,6 +17,7 @@
 #include "Normalizer.h"
 #include "Classifier.h"
 #include "VWFeatureBase.h"
+#include "VWFeatureCache.h"
 #include "TabbedSentence.h"
 #include "ThreadLocalByFeatureStorage.h"
 #include "TrainingLoss.h"
@@ -100,6 +101,8 @@ typedef ThreadLocalByFeatureStorage<Discriminative::Classifier, Discriminative::
 
 typedef ThreadLocalByFeatureStorage<VWTargetSentence> TLSTargetSentence;
 
+typedef ThreadLocalByFeatureStorage<VWFeatureCache> TLSFeatureCache;
+
 class VW : public StatelessFeatureFunction, public TLSTargetSentence
 {
 public:
@@ -113,6 +116,7 @@ public:
         : new Discriminative::ClassifierFactory(m_modelPath, m_vwOptions);
 
     m_tlsClassifier = new TLSClassifier(this, *classifierFactory);
+    m_tlsFeatureCache = new TLSFeatureCache(this);
 
     if (! m_normalizer) {
       VERBOSE(1, "VW :: No loss function specified, assuming logistic loss.\n");
@@ -127,13 +131,23 @@ public:
 
   virtual ~VW() {
     delete m_tlsClassifier;
+    delete m_tlsFeatureCache;
     delete m_normalizer;
   }
 
+  bool DependsOnSourceContext() const {
+    return true; // classifies the translation options of a span together
+  }
+
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
 
+  bool CanEvaluateOnAnyThread() const {
+    // the classifier, feature cache and target sentence are thread-local
+    return false;
+  }
+
   void EvaluateInIsolation(const Phrase &source
                            , const TargetPhrase &targetPhrase
                            , ScoreComponentCollection &scoreBreakdown
@@ -227,18 +241,23 @@ public:
       //
       
       std::vector<float> losses(translationOptionList.size());
+      VWFeatureCache &cache = *m_tlsFeatureCache->GetStored();
 
-      // extract source side features
-      for(size_t i = 0; i < sourceFeatures.size(); ++i)
-        (*sourceFeatures[i])(input, inputPath, sourceRange, classifier);
+      // extract source side features, or take them from the cache
+      const VWFeatureList &sourceFeatureList
+        = cache.GetSourceFeatures(input, inputPath, sourceRange, sourceFeatures);
+      for (VWFeatureList::const_iterator it = sourceFeatureList.begin(); it != sourceFeatureList.end(); ++it)
+        classifier.AddLabelIndependentFeature(it->first, it->second);
 
       for (size_t toptIdx = 0; toptIdx < translationOptionList.size(); toptIdx++) {
         const TranslationOption *topt = translationOptionList.Get(toptIdx);
         const TargetPhrase &targetPhrase = topt->GetTargetPhrase();
 
-        // extract target-side features for each topt
-        for(size_t i = 0; i < targetFeatures.size(); ++i)
-          (*targetFeatures[i])(input, inputPath, targetPhrase, classifier);
+        // extract target-side features for each topt, or take them from the cache
+        const VWFeatureList &targetFeatureList
+          = cache.GetTargetFeatures(input, inputPath, targetPhrase, targetFeatures);
+        for (VWFeatureList::const_iterator it = targetFeatureList.begin(); it != targetFeatureList.end(); ++it)
+          classifier.AddLabelDependentFeature(it->first, it->second);
 
         // get classifier score
         losses[toptIdx] = classifier.Predict(MakeTargetLabel(targetPhrase));
@@ -303,6 +322,8 @@ public:
   }
 
   virtual void InitializeForInput(InputType const& source) {
+    m_tlsFeatureCache->GetStored()->Clear();
+
     // tabbed sentence is assumed only in training
     if (! m_train)
       return;
@@ -485,6 +506,7 @@ private:
 
   Discriminative::Normalizer *m_normalizer = NULL;
   TLSClassifier *m_tlsClassifier;
+  TLSFeatureCache *m_tlsFeatureCache;
 };
 
 }
@@ -25,6 +25,12 @@ public:
     return true;
   }
 
+  // VW calls the classifier features on its own thread; some keep sentence
+  // data in thread-local storage
+  bool CanEvaluateOnAnyThread() const {
+    return false;
+  }
+
   // Official hooks should do nothing. This is a hack to be able to define
   // classifier features in the moses.ini configuration file.
   void EvaluateInIsolation(const Phrase &source
@@ -91,6 +97,12 @@ public:
                           , const TargetPhrase &targetPhrase
                           , Discriminative::Classifier &classifier) const = 0;
 
+  // true if a target feature only looks at the words of the target
+  // phrase, so that its features may be cached by target phrase
+  virtual bool DependsOnTargetWordsOnly() const {
+    return false;
+  }
+
 protected:
   std::vector<FactorType> m_sourceFactors, m_targetFactors;
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "Classifier.h"
+#include "VWFeatureBase.h"
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/WordsRange.h"
+
+namespace Moses
+{
+
+typedef std::vector<std::pair<std::string, float> > VWFeatureList;
+
+/**
+ * Classifier that only records the features it is given, so that they can
+ * be passed to the real classifier as often as needed.
+ */
+class VWFeatureRecorder : public Discriminative::Classifier
+{
+public:
+  explicit VWFeatureRecorder(VWFeatureList &features) : m_features(features) {}
+
+  virtual void AddLabelIndependentFeature(const StringPiece &name, float value) {
+    m_features.push_back(std::make_pair(name.as_string(), value));
+  }
+
+  virtual void AddLabelDependentFeature(const StringPiece &name, float value) {
+    m_features.push_back(std::make_pair(name.as_string(), value));
+  }
+
+  virtual void Train(const StringPiece &label, float loss) {
+    throw std::logic_error("VWFeatureRecorder does not train");
+  }
+
+  virtual float Predict(const StringPiece &label) {
+    throw std::logic_error("VWFeatureRecorder does not predict");
+  }
+
+private:
+  VWFeatureList &m_features;
+};
+
+/**
+ * VW thread-specific cache of extracted features: source features of the
+ * spans of the current sentence, and target features of target phrases,
+ * which recur across spans and sentences. Target features are only cached
+ * if all target feature extractors look at nothing but the target words.
+ */
+class VWFeatureCache
+{
+public:
+  VWFeatureCache() : m_maxTargetPhrases(100000) {}
+
+  //! new sentence: source features of the last one are no use
+  void Clear() {
+    m_source.clear();
+  }
+
+  const VWFeatureList &GetSourceFeatures(const InputType &input
+                                         , const InputPath &inputPath
+                                         , const WordsRange &sourceRange
+                                         , const std::vector<VWFeatureBase*> &sourceFeatures) {
+    std::pair<size_t, size_t> key(sourceRange.GetStartPos(), sourceRange.GetEndPos());
+    std::map<std::pair<size_t, size_t>, VWFeatureList>::iterator it = m_source.find(key);
+    if (it != m_source.end())
+      return it->second;
+
+    VWFeatureList &features = m_source[key];
+    VWFeatureRecorder recorder(features);
+    for(size_t i = 0; i < sourceFeatures.size(); ++i)
+      (*sourceFeatures[i])(input, inputPath, sourceRange, recorder);
+    return features;
+  }
+
+  const VWFeatureList &GetTargetFeatures(const InputType &input
+                                         , const InputPath &inputPath
+                                         , const TargetPhrase &targetPhrase
+                                         , const std::vector<VWFeatureBase*> &targetFeatures) {
+    bool cacheable = true;
+    for(size_t i = 0; i < targetFeatures.size() && cacheable; ++i)
+      cacheable = targetFeatures[i]->DependsOnTargetWordsOnly();
+
+    if (!cacheable) {
+      m_uncached.clear();
+      VWFeatureRecorder recorder(m_uncached);
+      for(size_t i = 0; i < targetFeatures.size(); ++i)
+        (*targetFeatures[i])(input, inputPath, targetPhrase, recorder);
+      return m_uncached;
+    }
+
+    std::string key = targetPhrase.GetStringRep(StaticData::Instance().GetOutputFactorOrder());
+    TargetCache::iterator it = m_target.find(key);
+    if (it != m_target.end())
+      return it->second;
+
+    if (m_target.size() >= m_maxTargetPhrases)
+      m_target.clear();
+    VWFeatureList &features = m_target[key];
+    VWFeatureRecorder recorder(features);
+    for(size_t i = 0; i < targetFeatures.size(); ++i)
+      (*targetFeatures[i])(input, inputPath, targetPhrase, recorder);
+    return features;
+  }
+
+private:
+  typedef boost::unordered_map<std::string, VWFeatureList> TargetCache;
+
+  std::map<std::pair<size_t, size_t>, VWFeatureList> m_source;
+  TargetCache m_target;
+  VWFeatureList m_uncached;
+  size_t m_maxTargetPhrases;
+};
+
+}
@@ -23,6 +23,10 @@ public:
     classifier.AddLabelDependentFeature("tind^" + targetPhrase.GetStringRep(m_targetFactors));
   }
 
+  bool DependsOnTargetWordsOnly() const {
+    return true;
+  }
+
   virtual void SetParameter(const std::string& key, const std::string& value) {
     VWFeatureTarget::SetParameter(key, value);
   }
@@ -25,6 +25,10 @@ public:
     }
   }
 
+  bool DependsOnTargetWordsOnly() const {
+    return true;
+  }
+
   virtual void SetParameter(const std::string& key, const std::string& value) {
     VWFeatureTarget::SetParameter(key, value);
   }
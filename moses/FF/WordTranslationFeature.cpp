@@ -169,21 +169,34 @@ void WordTranslationFeature::EvaluateWithSourceContext(const InputType &input
         continue;
     }
 
+    const Factor *sourceFactor = ws.GetFactor(m_factorTypeSource);
+    const Factor *targetFactor = wt.GetFactor(m_factorTypeTarget);
     if (!m_unrestricted) {
-      if (FindStringPiece(m_vocabSource, sourceWord) == m_vocabSource.end())
+      if (FindStringPiece(m_vocabSource, sourceWord) == m_vocabSource.end()) {
         sourceWord = "OTHER";
-      if (FindStringPiece(m_vocabTarget, targetWord) == m_vocabTarget.end())
+        sourceFactor = NULL;
+      }
+      if (FindStringPiece(m_vocabTarget, targetWord) == m_vocabTarget.end()) {
         targetWord = "OTHER";
+        targetFactor = NULL;
+      }
     }
 
     if (m_simple) {
-      // construct feature name
-      stringstream featureName;
-      featureName << m_description << "_";
-      featureName << sourceWord;
-      featureName << "~";
-      featureName << targetWord;
-      scoreBreakdown.SparsePlusEquals(featureName.str(), 1);
+      SparseFeatureNames::Key key(0);
+      key.Add(sourceFactor);
+      key.Add(targetFactor);
+      const FName *name = m_names.Find(key);
+      if (name == NULL) {
+        // construct feature name
+        stringstream featureName;
+        featureName << m_description << "_";
+        featureName << sourceWord;
+        featureName << "~";
+        featureName << targetWord;
+        name = &m_names.Add(key, featureName.str());
+      }
+      scoreBreakdown.SparsePlusEquals(*name, 1);
     }
     if (m_domainTrigger && !m_sourceContext) {
       const bool use_topicid = sentence.GetUseTopicId();
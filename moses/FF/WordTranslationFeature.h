@@ -7,6 +7,7 @@
 #include "moses/Sentence.h"
 #include "FFState.h"
 #include "StatelessFeatureFunction.h"
+#include "SparseFeatureNames.h"
 
 namespace Moses
 {
@@ -34,12 +35,16 @@ private:
   CharHash m_punctuationHash;
   std::string m_filePathSource;
   std::string m_filePathTarget;
+  SparseFeatureNames m_names;
 
 public:
   WordTranslationFeature(const std::string &line);
 
   void SetParameter(const std::string& key, const std::string& value);
   bool IsUseable(const FactorMask &mask) const;
+  bool DependsOnSourceContext() const {
+    return m_sourceContext || m_domainTrigger;
+  }
 
   void Load();
 
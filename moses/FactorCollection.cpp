@@ -37,6 +37,12 @@ FactorCollection FactorCollection::s_instance;
 
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+#ifdef WITH_THREADS
+  // lock-free path: this thread has seen the factor before
+  LocalCache &cache = GetLocalCache(isNonTerminal);
+  LocalCache::ConstIterator c;
+  if (cache.Find(factorString, c)) return c->factor;
+#endif
   FactorFriend to_ins;
   to_ins.in.m_string = factorString;
   to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
@@ -47,7 +53,9 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool
     // read=lock scope
     boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
     Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
+    if (i != set.end()) {
+      return Remember(cache, &i->in);
+    }
   }
   boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
 #endif // WITH_THREADS
@@ -63,7 +71,11 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool
       m_factorId++;
     }
   }
+#ifdef WITH_THREADS
+  return Remember(cache, &ret.first->in);
+#else
   return &ret.first->in;
+#endif
 }
 
 const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
@@ -72,13 +84,24 @@ const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool
   to_find.in.m_string = factorString;
   to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
   Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
+#ifdef WITH_THREADS
+  LocalCache &cache = GetLocalCache(isNonTerminal);
+  LocalCache::ConstIterator c;
+  if (cache.Find(factorString, c)) return c->factor;
+#endif
   {
     // read=lock scope
 #ifdef WITH_THREADS
     boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
 #endif // WITH_THREADS
     Set::const_iterator i = set.find(to_find);
-    if (i != set.end()) return &i->in;
+    if (i != set.end()) {
+#ifdef WITH_THREADS
+      return Remember(cache, &i->in);
+#else
+      return &i->in;
+#endif
+    }
   }
   return NULL;
 }
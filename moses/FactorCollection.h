@@ -29,9 +29,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
-#include "util/murmur_hash.hh"
+#include "util/fast_hash.hh"
+#include "util/group_probing_hash_table.hh"
 #include <boost/unordered_set.hpp>
 
 #include <functional>
@@ -69,7 +71,7 @@ class FactorCollection
 
   struct HashFactor : public std::unary_function<const FactorFriend &, std::size_t> {
     std::size_t operator()(const FactorFriend &factor) const {
-      return util::MurmurHashNative(factor.in.m_string.data(), factor.in.m_string.size());
+      return util::FastHash(factor.in.m_string.data(), factor.in.m_string.size());
     }
   };
   struct EqualsFactor : public std::binary_function<const FactorFriend &, const FactorFriend &, bool> {
@@ -87,6 +89,42 @@ class FactorCollection
 #ifdef WITH_THREADS
   //reader-writer lock
   mutable boost::shared_mutex m_accessLock;
+
+  /** Factors are never removed and their strings live in m_string_backing,
+   *  so each thread can remember the factors it has looked up before and
+   *  find them again without touching m_accessLock.
+   */
+  struct CacheEntry {
+    typedef StringPiece Key;
+    StringPiece key;
+    const Factor *factor;
+    StringPiece GetKey() const {
+      return key;
+    }
+  };
+  typedef util::GroupProbingHashTable<CacheEntry, util::FastHashPiece> LocalCache;
+  struct LocalCaches {
+    LocalCache terminals;
+    LocalCache nonTerminals;
+  };
+  boost::thread_specific_ptr<LocalCaches> m_localCaches;
+
+  LocalCache &GetLocalCache(bool isNonTerminal) {
+    LocalCaches *caches = m_localCaches.get();
+    if (caches == NULL) {
+      caches = new LocalCaches;
+      m_localCaches.reset(caches);
+    }
+    return isNonTerminal ? caches->nonTerminals : caches->terminals;
+  }
+
+  static const Factor *Remember(LocalCache &cache, const Factor *factor) {
+    CacheEntry entry;
+    entry.key = factor->GetString();
+    entry.factor = factor;
+    cache.Insert(entry);
+    return factor;
+  }
 #endif
 
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
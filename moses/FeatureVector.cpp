@@ -30,6 +30,7 @@
 #endif // WITH_THREADS
 
 #include "FeatureVector.h"
+#include "TypeDef.h"
 #include "util/string_piece_hash.hh"
 
 using namespace std;
@@ -39,53 +40,84 @@ namespace Moses
 {
 
 const string FName::SEP = "_";
-FName::Name2Id FName::name2id;
-vector<string> FName::id2name;
+deque<string> FName::id2name;
 FName::Id2Count FName::id2hopeCount;
 FName::Id2Count FName::id2fearCount;
+FName::Shard FName::s_shards[FName::NUM_SHARDS];
 #ifdef WITH_THREADS
 boost::shared_mutex FName::m_idLock;
 #endif
 
+namespace
+{
+//! hands the precomputed hash to the hash table of a shard
+struct PrecomputedHash {
+  size_t hash;
+  explicit PrecomputedHash(size_t h) : hash(h) {}
+  size_t operator()(const StringPiece &) const {
+    return hash;
+  }
+};
+}
+
 void FName::init(const StringPiece &name)
 {
+  const size_t hash = hash_value(name);
+  Shard &shard = GetShard(hash);
+  {
 #ifdef WITH_THREADS
-  //reader lock
-  boost::shared_lock<boost::shared_mutex> lock(m_idLock);
+    //reader lock
+    boost::shared_lock<boost::shared_mutex> lock(shard.lock);
+#endif
+    Name2Id::const_iterator i = shard.name2id.find(name, PrecomputedHash(hash), StringPieceCompatibleEquals());
+    if (i != shard.name2id.end()) {
+      m_id = i->second;
+      return;
+    }
+  }
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> write_lock(shard.lock);
 #endif
-  Name2Id::iterator i = FindStringPiece(name2id, name);
-  if (i != name2id.end()) {
+  // somebody may have inserted it in between
+  Name2Id::const_iterator i = shard.name2id.find(name, PrecomputedHash(hash), StringPieceCompatibleEquals());
+  if (i != shard.name2id.end()) {
     m_id = i->second;
-  } else {
+    return;
+  }
+  std::string key(name.data(), name.size());
+  {
 #ifdef WITH_THREADS
-    //release the reader lock, and upgrade to writer lock
-    lock.unlock();
-    boost::unique_lock<boost::shared_mutex> write_lock(m_idLock);
+    boost::unique_lock<boost::shared_mutex> id_lock(m_idLock);
 #endif
-    std::pair<std::string, size_t> to_ins;
-    to_ins.first.assign(name.data(), name.size());
-    to_ins.second = name2id.size();
-    std::pair<Name2Id::iterator, bool> res(name2id.insert(to_ins));
-    if (res.second) {
-      // TODO this should be string pointers backed by the hash table.
-      id2name.push_back(to_ins.first);
-    }
-    m_id = res.first->second;
+    // TODO this should be string pointers backed by the hash table.
+    m_id = id2name.size();
+    id2name.push_back(key);
   }
+  shard.name2id.insert(std::make_pair(key, m_id));
+}
+
+size_t FName::findId(const StringPiece &name)
+{
+  const size_t hash = hash_value(name);
+  Shard &shard = GetShard(hash);
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(shard.lock);
+#endif
+  Name2Id::const_iterator i = shard.name2id.find(name, PrecomputedHash(hash), StringPieceCompatibleEquals());
+  return (i == shard.name2id.end()) ? NOT_FOUND : i->second;
 }
 
 size_t FName::getId(const string& name)
 {
-  Name2Id::iterator i = name2id.find(name);
-  assert (i != name2id.end());
-  return i->second;
+  size_t id = findId(name);
+  assert (id != NOT_FOUND);
+  return id;
 }
 
 size_t FName::getHopeIdCount(const string& name)
 {
-  Name2Id::iterator i = name2id.find(name);
-  if (i != name2id.end()) {
-    float id = i->second;
+  size_t id = findId(name);
+  if (id != NOT_FOUND) {
     return id2hopeCount[id];
   }
   return 0;
@@ -93,9 +125,8 @@ size_t FName::getHopeIdCount(const string& name)
 
 size_t FName::getFearIdCount(const string& name)
 {
-  Name2Id::iterator i = name2id.find(name);
-  if (i != name2id.end()) {
-    float id = i->second;
+  size_t id = findId(name);
+  if (id != NOT_FOUND) {
     return id2fearCount[id];
   }
   return 0;
@@ -103,26 +134,26 @@ size_t FName::getFearIdCount(const string& name)
 
 void FName::incrementHopeId(const string& name)
 {
-  Name2Id::iterator i = name2id.find(name);
-  assert(i != name2id.end());
+  size_t id = findId(name);
+  assert(id != NOT_FOUND);
 #ifdef WITH_THREADS
   // get upgradable lock and upgrade to writer lock
   boost::upgrade_lock<boost::shared_mutex> upgradeLock(m_idLock);
   boost::upgrade_to_unique_lock<boost::shared_mutex> uniqueLock(upgradeLock);
 #endif
-  id2hopeCount[i->second] += 1;
+  id2hopeCount[id] += 1;
 }
 
 void FName::incrementFearId(const string& name)
 {
-  Name2Id::iterator i = name2id.find(name);
-  assert(i != name2id.end());
+  size_t id = findId(name);
+  assert(id != NOT_FOUND);
 #ifdef WITH_THREADS
   // get upgradable lock and upgrade to writer lock
   boost::upgrade_lock<boost::shared_mutex> upgradeLock(m_idLock);
   boost::upgrade_to_unique_lock<boost::shared_mutex> uniqueLock(upgradeLock);
 #endif
-  id2fearCount[i->second] += 1;
+  id2fearCount[id] += 1;
 }
 
 void FName::eraseId(size_t id)
@@ -149,6 +180,10 @@ size_t FName::hash() const
 
 const std::string& FName::name() const
 {
+#ifdef WITH_THREADS
+  // id2name may be reallocated by a concurrent init()
+  boost::shared_lock<boost::shared_mutex> lock(m_idLock);
+#endif
   return id2name[m_id];
 }
 
@@ -163,6 +198,61 @@ bool FName::operator!=(const FName& rhs) const
   return ! (*this == rhs);
 }
 
+void SparseFeatureMap::PlusEquals(const SparseFeatureMap &rhs)
+{
+  if (rhs.empty()) return;
+  if (empty()) {
+    m_data = rhs.m_data;
+    return;
+  }
+  const std::vector<value_type> &lhsData = m_data;
+  std::vector<value_type> merged;
+  merged.reserve(lhsData.size() + rhs.m_data.size());
+  const_iterator l = lhsData.begin(), r = rhs.m_data.begin();
+  while (l != lhsData.end() && r != rhs.m_data.end()) {
+    if (l->first < r->first) {
+      merged.push_back(*l++);
+    } else if (r->first < l->first) {
+      merged.push_back(*r++);
+    } else {
+      merged.push_back(value_type(l->first, l->second + r->second));
+      ++l;
+      ++r;
+    }
+  }
+  merged.insert(merged.end(), l, lhsData.end());
+  merged.insert(merged.end(), r, rhs.m_data.end());
+  m_data.swap(merged);
+}
+
+FValue SparseFeatureMap::InnerProduct(const SparseFeatureMap &rhs) const
+{
+  const SparseFeatureMap &small = (size() <= rhs.size()) ? *this : rhs;
+  const SparseFeatureMap &large = (size() <= rhs.size()) ? rhs : *this;
+  FValue product = 0.0;
+  if (small.size() * 16 < large.size()) {
+    // a few features against e.g. a large weight vector: binary search
+    for (const_iterator i = small.begin(); i != small.end(); ++i) {
+      const_iterator j = large.find(i->first);
+      if (j != large.end()) product += i->second * j->second;
+    }
+    return product;
+  }
+  const_iterator l = small.begin(), r = large.begin();
+  while (l != small.end() && r != large.end()) {
+    if (l->first < r->first) {
+      ++l;
+    } else if (r->first < l->first) {
+      ++r;
+    } else {
+      product += l->second * r->second;
+      ++l;
+      ++r;
+    }
+  }
+  return product;
+}
+
 FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
 
 void FVector::resize(size_t newsize)
@@ -371,18 +461,21 @@ FVector& FVector::operator+= (const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) + i->second);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  m_features.PlusEquals(rhs.m_features);
+  const size_t coreSize = rhs.m_coreFeatures.size();
+  if (coreSize) {
+    FValue *lhsCore = &m_coreFeatures[0];
+    const FValue *rhsCore = &rhs.m_coreFeatures[0];
+    for (size_t i = 0; i < coreSize; ++i)
+      lhsCore[i] += rhsCore[i];
+  }
   return *this;
 }
 
 // add only sparse features
 void FVector::sparsePlusEquals(const FVector& rhs)
 {
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) + i->second);
+  m_features.PlusEquals(rhs.m_features);
 }
 
 // add only core features
@@ -806,12 +899,17 @@ FValue FVector::sum() const
 FValue FVector::inner_product(const FVector& rhs) const
 {
   assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
-  FValue product = 0.0;
-  for (const_iterator i = cbegin(); i != cend(); ++i) {
-    product += ((i->second)*(rhs.get(i->first)));
-  }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
+  FValue product = m_features.InnerProduct(rhs.m_features);
+  // plain loop over the raw arrays so that the compiler can vectorise it
+  const size_t coreSize = m_coreFeatures.size();
+  if (coreSize) {
+    const FValue *lhsCore = &m_coreFeatures[0];
+    const FValue *rhsCore = &rhs.m_coreFeatures[0];
+    FValue coreProduct = 0.0;
+    for (size_t i = 0; i < coreSize; ++i) {
+      coreProduct += lhsCore[i]*rhsCore[i];
+    }
+    product += coreProduct;
   }
   return product;
 }
@@ -22,6 +22,9 @@
 #ifndef FEATUREVECTOR_H
 #define FEATUREVECTOR_H
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -61,9 +64,7 @@ struct FName {
 
   typedef boost::unordered_map<std::string,size_t> Name2Id;
   typedef boost::unordered_map<size_t,size_t> Id2Count;
-  //typedef std::map<std::string, size_t> Name2Id;
-  static Name2Id name2id;
-  static std::vector<std::string> id2name;
+  static std::deque<std::string> id2name; // deque: references stay valid as it grows
   static Id2Count id2hopeCount;
   static Id2Count id2fearCount;
 
@@ -71,10 +72,20 @@ struct FName {
   //which will be concatenated with a SEP between them, or as
   //a single string, which will be used as-is.
   FName(const StringPiece &root, const StringPiece &name) {
-    std::string assembled(root.data(), root.size());
-    assembled += SEP;
-    assembled.append(name.data(), name.size());
-    init(assembled);
+    // assemble short names on the stack, only long ones go to the heap
+    const size_t size = root.size() + SEP.size() + name.size();
+    char buffer[256];
+    if (size <= sizeof(buffer)) {
+      std::memcpy(buffer, root.data(), root.size());
+      std::memcpy(buffer + root.size(), SEP.data(), SEP.size());
+      std::memcpy(buffer + root.size() + SEP.size(), name.data(), name.size());
+      init(StringPiece(buffer, size));
+    } else {
+      std::string assembled(root.data(), root.size());
+      assembled += SEP;
+      assembled.append(name.data(), name.size());
+      init(assembled);
+    }
   }
   explicit FName(const StringPiece &name) {
     init(name);
@@ -87,6 +98,9 @@ struct FName {
 
   bool operator==(const FName& rhs) const ;
   bool operator!=(const FName& rhs) const ;
+  bool operator<(const FName& rhs) const {
+    return m_id < rhs.m_id;
+  }
 
   static size_t getId(const std::string& name);
   static size_t getHopeIdCount(const std::string& name);
@@ -98,8 +112,29 @@ struct FName {
 private:
   void init(const StringPiece& name);
   size_t m_id;
+
+  /** The name to id dictionary is split into shards by the hash of the
+   *  name, each with its own lock, so that threads looking up different
+   *  sparse features do not contend. The hash is computed once and reused
+   *  for the lookup within the shard.
+   **/
+  static const size_t NUM_SHARDS = 64;
+  struct Shard {
+    Name2Id name2id;
+#ifdef WITH_THREADS
+    boost::shared_mutex lock;
+#endif
+  };
+  static Shard s_shards[NUM_SHARDS];
+  static Shard &GetShard(size_t hash) {
+    // the low bits select the bucket within the shard
+    return s_shards[(hash >> 16) % NUM_SHARDS];
+  }
+  //! id of name if it is known, otherwise NOT_FOUND
+  static size_t findId(const StringPiece &name);
+
 #ifdef WITH_THREADS
-  //reader-writer lock
+  //guards id2name
   static boost::shared_mutex m_idLock;
 #endif
 };
@@ -121,6 +156,103 @@ struct FNameHash
 
 class ProxyFVector;
 
+/**
+ * Sparse part of a feature vector: (name, value) pairs kept sorted by
+ * feature id in one contiguous array. Copying is a single allocation and
+ * a memcpy, and addition and inner products between two maps are linear
+ * merges rather than hash lookups.
+ **/
+class SparseFeatureMap
+{
+public:
+  typedef std::pair<FName,FValue> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+  iterator begin() {
+    return m_data.begin();
+  }
+  iterator end() {
+    return m_data.end();
+  }
+  const_iterator begin() const {
+    return m_data.begin();
+  }
+  const_iterator end() const {
+    return m_data.end();
+  }
+  const_iterator cbegin() const {
+    return m_data.begin();
+  }
+  const_iterator cend() const {
+    return m_data.end();
+  }
+  size_t size() const {
+    return m_data.size();
+  }
+  bool empty() const {
+    return m_data.empty();
+  }
+  void clear() {
+    m_data.clear();
+  }
+  void swap(SparseFeatureMap &other) {
+    m_data.swap(other.m_data);
+  }
+
+  iterator find(const FName &name) {
+    iterator i = LowerBound(name);
+    return (i != m_data.end() && i->first == name) ? i : m_data.end();
+  }
+  const_iterator find(const FName &name) const {
+    const_iterator i = LowerBound(name);
+    return (i != m_data.end() && i->first == name) ? i : m_data.end();
+  }
+
+  //! value of name, inserting 0 if not present
+  FValue &operator[](const FName &name) {
+    iterator i = LowerBound(name);
+    if (i == m_data.end() || !(i->first == name)) {
+      i = m_data.insert(i, value_type(name, 0));
+    }
+    return i->second;
+  }
+
+  size_t erase(const FName &name) {
+    iterator i = find(name);
+    if (i == m_data.end()) return 0;
+    m_data.erase(i);
+    return 1;
+  }
+
+  //! element-wise addition, one merge over both maps
+  void PlusEquals(const SparseFeatureMap &rhs);
+
+  //! sum over the features present in both maps of the product of their values
+  FValue InnerProduct(const SparseFeatureMap &rhs) const;
+
+private:
+  struct CompareName {
+    bool operator()(const value_type &lhs, const FName &rhs) const {
+      return lhs.first < rhs;
+    }
+  };
+
+  iterator LowerBound(const FName &name) {
+    return std::lower_bound(m_data.begin(), m_data.end(), name, CompareName());
+  }
+  const_iterator LowerBound(const FName &name) const {
+    return std::lower_bound(m_data.begin(), m_data.end(), name, CompareName());
+  }
+
+  std::vector<value_type> m_data;
+};
+
+inline void swap(SparseFeatureMap &first, SparseFeatureMap &second)
+{
+  first.swap(second);
+}
+
 /**
  * A sparse feature (or weight) vector.
  **/
@@ -141,7 +273,7 @@ public:
   **/
   void resize(size_t newsize);
 
-  typedef boost::unordered_map<FName,FValue,FNameHash, FNameEquals> FNVmap;
+  typedef SparseFeatureMap FNVmap;
   /** Iterators */
   typedef FNVmap::iterator iterator;
   typedef FNVmap::const_iterator const_iterator;
@@ -193,6 +325,10 @@ public:
   bool operator!= (const FVector& rhs) const;
 
   FValue inner_product(const FVector& rhs) const;
+  //! the part of inner_product() over the sparse features
+  FValue sparse_inner_product(const FVector& rhs) const {
+    return m_features.InnerProduct(rhs.m_features);
+  }
 
   friend class ProxyFVector;
 
@@ -1,4 +1,22 @@
-
 #include "File.h"
 
+#include "util/file.hh"
+#include "util/mmap.hh"
+
+namespace Moses
+{
+
+MapCursor fMapRead(const std::string& fn,util::scoped_memory& mem)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(fn.c_str()));
+  uint64_t size=util::SizeOrThrow(fd.get());
+  if(!size) {
+    mem.reset();
+    return MapCursor();
+  }
+  util::MapRead(util::LAZY,fd.get(),0,size,mem);
+  const char* begin=static_cast<const char*>(mem.get());
+  return MapCursor(begin,begin+size);
+}
 
+}
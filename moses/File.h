@@ -7,7 +7,9 @@
 #ifndef moses_File_h
 #define moses_File_h
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -15,6 +17,11 @@
 #include "TypeDef.h"
 #include "Util.h"
 
+namespace util
+{
+class scoped_memory;
+}
+
 namespace Moses
 {
 
@@ -168,6 +175,76 @@ inline void fClose(FILE* f)
   fclose(f); // for consistent function names only
 }
 
+template<typename T> inline void fReadArray(FILE* f,T* t,size_t n)
+{
+  if(fread(t,sizeof(T),n,f)!=n) {
+    UTIL_THROW2("ERROR: fread!");
+  }
+}
+
+/** read position in a memory mapped file: the fRead*() functions below read
+ *  what the fWrite*() functions above wrote, without seeking and copying
+ *  through stdio
+ */
+struct MapCursor {
+  const char *begin, *end, *pos;
+
+  MapCursor(const char *b=0,const char *e=0) : begin(b),end(e),pos(b) {}
+};
+
+//! maps file fn read-only into mem, for as long as mem lives
+MapCursor fMapRead(const std::string& fn,util::scoped_memory& mem);
+
+inline void fReadBytes(MapCursor& c,void* to,size_t bytes)
+{
+  UTIL_THROW_IF2(static_cast<size_t>(c.end-c.pos)<bytes,
+                 "ERROR: read past the end of a mapped file!");
+  memcpy(to,c.pos,bytes);
+  c.pos+=bytes;
+}
+
+template<typename T> inline void fRead(MapCursor& c,T& t)
+{
+  fReadBytes(c,&t,sizeof(t));
+}
+
+template<typename T> inline void fReadArray(MapCursor& c,T* t,size_t n)
+{
+  fReadBytes(c,t,sizeof(T)*n);
+}
+
+template<typename C> inline void fReadVector(MapCursor& c,C& v)
+{
+  uint32_t s;
+  fRead(c,s);
+  v.resize(s);
+  if(s) fReadBytes(c,&(*v.begin()),sizeof(typename C::value_type)*s);
+}
+
+inline void fReadString(MapCursor& c,std::string& e)
+{
+  uint32_t s;
+  fRead(c,s);
+  UTIL_THROW_IF2(static_cast<size_t>(c.end-c.pos)<s,
+                 "ERROR: read past the end of a mapped file!");
+  // as the FILE* version, which stops at a 0 byte
+  e.assign(c.pos,std::find(c.pos,c.pos+s,'\0'));
+  c.pos+=s;
+}
+
+inline OFF_T fTell(const MapCursor& c)
+{
+  return c.pos-c.begin;
+}
+
+inline void fSeek(MapCursor& c,OFF_T o)
+{
+  UTIL_THROW_IF2(o<0 || o>c.end-c.begin,
+                 "ERROR: position " << o << " is outside of a mapped file of "
+                 << (c.end-c.begin) << " bytes!");
+  c.pos=c.begin+o;
+}
+
 }
 
 #endif
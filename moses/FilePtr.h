@@ -14,7 +14,8 @@ namespace Moses
 {
 
 /** smart pointer for on-demand loading from file
- *  requirement: T has a constructor T(FILE*)
+ *  requirement: T has a constructor T(FILE*), and T(MapCursor&) for
+ *  pointers into a mapped file
  */
 template<typename T> class FilePtr
 {
@@ -22,14 +23,24 @@ public:
   typedef T* Ptr;
 private:
   FILE* f;
+  // the mapped file, if not read from f
+  const char *mapBegin, *mapEnd;
   OFF_T pos;
   mutable Ptr t;
 public:
-  FilePtr(FILE* f_=0,OFF_T p=0) : f(f_),pos(p),t(0) {}
+  FilePtr(FILE* f_=0,OFF_T p=0) : f(f_),mapBegin(0),mapEnd(0),pos(p),t(0) {}
+  FilePtr(const MapCursor& m,OFF_T p) : f(0),mapBegin(m.begin),mapEnd(m.end),pos(p),t(0) {}
   ~FilePtr() {}
 
   void set(FILE* f_,OFF_T p) {
     f=f_;
+    mapBegin=mapEnd=0;
+    pos=p;
+  }
+  void set(const MapCursor& m,OFF_T p) {
+    f=0;
+    mapBegin=m.begin;
+    mapEnd=m.end;
     pos=p;
   }
   void free() {
@@ -72,14 +83,19 @@ public:
   }
 
   operator bool() const {
-    return (f && pos!=InvalidOffT);
+    return ((f || mapBegin) && pos!=InvalidOffT);
   }
 
   void load() const {
     if(t) return;
-    if(f && pos!=InvalidOffT) {
+    if(pos==InvalidOffT) return;
+    if(f) {
       fSeek(f,pos);
       t=new T(f);
+    } else if(mapBegin) {
+      MapCursor c(mapBegin,mapEnd);
+      fSeek(c,pos);
+      t=new T(c);
     }
   }
 };
@@ -19,8 +19,11 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <unistd.h>
+#include <boost/unordered_map.hpp>
 #include "GenerationDictionary.h"
 #include "FactorCollection.h"
 #include "Word.h"
@@ -28,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
 
 using namespace std;
 
@@ -35,8 +40,30 @@ namespace Moses
 {
 std::vector<GenerationDictionary*> GenerationDictionary::s_staticColl;
 
+namespace
+{
+// layout of an image: this header, the buckets, the target ids, the
+// scores, then the output vocabulary as NUL-terminated strings
+struct ImageHeader {
+  char magic[8];
+  uint64_t numInputFactors;
+  uint64_t numOutputFactors;
+  uint64_t numScores;
+  uint64_t numInputs;
+  uint64_t numBuckets;
+  uint64_t numEntries;
+  uint64_t vocabBytes;
+};
+const char kImageMagic[8] = {'m', 'g', 'e', 'n', 'i', 'm', 'g', '1'};
+}
+
 GenerationDictionary::GenerationDictionary(const std::string &line)
   : DecodeFeature(line)
+  , m_buckets(NULL)
+  , m_numBuckets(0)
+  , m_numInputs(0)
+  , m_targets(NULL)
+  , m_scores(NULL)
 {
   s_staticColl.push_back(this);
 
@@ -44,11 +71,43 @@ GenerationDictionary::GenerationDictionary(const std::string &line)
 }
 
 void GenerationDictionary::Load()
+{
+  if (!m_imagePath.empty() && FileExists(m_imagePath)) {
+    LoadImage();
+    return;
+  }
+  LoadText();
+  if (!m_imagePath.empty()) SaveImage();
+}
+
+uint64_t GenerationDictionary::MakeKey(const Word &word) const
+{
+  // chain the hashes of the input factors, via the seed
+  const vector<FactorType> &input = GetInput();
+  uint64_t key = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    const Factor *factor = word[input[i]];
+    if (factor == NULL) return 0;
+    StringPiece str = factor->GetString();
+    key = util::MurmurHashNative(str.data(), str.size(), key + i);
+  }
+  return key ? key : 1; // 0 marks empty buckets
+}
+
+void GenerationDictionary::LoadText()
 {
   FactorCollection &factorCollection = FactorCollection::Instance();
 
   const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
+  const size_t numOutputFactors = GetOutput().size();
 
+  // lines of the same input, in order of first appearance: the targets of
+  // each line are numOutputFactors vocabulary ids, followed by its scores
+  vector<uint64_t> keys;
+  vector<vector<uint32_t> > targets;
+  vector<vector<float> > scores;
+  boost::unordered_map<uint64_t, size_t> inputIndex;
+  boost::unordered_map<const Factor*, uint32_t> vocabIndex;
 
   // data from file
   InputFileStream inFile(m_filePath);
@@ -56,30 +115,32 @@ void GenerationDictionary::Load()
 
   string line;
   size_t lineNum = 0;
+  size_t numEntries = 0;
   while(getline(inFile, line)) {
     ++lineNum;
     vector<string> token = Tokenize( line );
 
-    // add each line in generation file into class
-    Word *inputWord = new Word();  // deleted in destructor
-    Word outputWord;
-
     // create word with certain factors filled out
 
     // inputs
+    Word inputWord;
     vector<string> factorString = Tokenize( token[0], "|" );
     for (size_t i = 0 ; i < GetInput().size() ; i++) {
       FactorType factorType = GetInput()[i];
       const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      inputWord->SetFactor(factorType, factor);
+      inputWord.SetFactor(factorType, factor);
     }
 
+    vector<uint32_t> outputIds(numOutputFactors);
     factorString = Tokenize( token[1], "|" );
-    for (size_t i = 0 ; i < GetOutput().size() ; i++) {
+    for (size_t i = 0 ; i < numOutputFactors ; i++) {
       FactorType factorType = GetOutput()[i];
 
       const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      outputWord.SetFactor(factorType, factor);
+      pair<boost::unordered_map<const Factor*, uint32_t>::iterator, bool> vocab
+        = vocabIndex.insert(make_pair(factor, uint32_t(m_vocab.size())));
+      if (vocab.second) m_vocab.push_back(factor);
+      outputIds[i] = vocab.first->second;
     }
 
     size_t numFeaturesInFile = token.size() - 2;
@@ -89,49 +150,156 @@ void GenerationDictionary::Load()
             << " feature values, but found " << numFeaturesInFile << std::endl;
       throw strme.str();
     }
-    std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
+    std::vector<float> lineScores(numFeatureValuesInConfig, 0.0f);
     for (size_t i = 0; i < numFeatureValuesInConfig; i++)
-      scores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
+      lineScores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
 
-    Collection::iterator iterWord = m_collection.find(inputWord);
-    if (iterWord == m_collection.end()) {
-      m_collection[inputWord][outputWord].Assign(this, scores);
+    uint64_t key = MakeKey(inputWord);
+    pair<boost::unordered_map<uint64_t, size_t>::iterator, bool> input
+      = inputIndex.insert(make_pair(key, keys.size()));
+    if (input.second) {
+      keys.push_back(key);
+      targets.push_back(vector<uint32_t>());
+      scores.push_back(vector<float>());
+    }
+    vector<uint32_t> &inputTargets = targets[input.first->second];
+    vector<float> &inputScores = scores[input.first->second];
+
+    // a repeated (input, output) pair overwrites the earlier scores
+    size_t entry = 0;
+    while (entry * numOutputFactors < inputTargets.size()
+           && !equal(outputIds.begin(), outputIds.end(), inputTargets.begin() + entry * numOutputFactors))
+      ++entry;
+    if (entry * numOutputFactors == inputTargets.size() && (numOutputFactors || inputScores.empty())) {
+      inputTargets.insert(inputTargets.end(), outputIds.begin(), outputIds.end());
+      inputScores.insert(inputScores.end(), lineScores.begin(), lineScores.end());
+      ++numEntries;
     } else {
-      // source word already in there. delete input word to avoid mem leak
-      (iterWord->second)[outputWord].Assign(this, scores);
-      delete inputWord;
+      copy(lineScores.begin(), lineScores.end(), inputScores.begin() + entry * numFeatureValuesInConfig);
     }
   }
 
   inFile.Close();
+
+  // flatten
+  Entry empty;
+  empty.key = 0;
+  empty.begin = empty.end = 0;
+  m_ownBuckets.assign(TableType::Size(keys.size(), 1.5) / sizeof(Entry), empty);
+  m_table = TableType(&m_ownBuckets[0], m_ownBuckets.size() * sizeof(Entry), 0);
+  m_ownTargets.reserve(numEntries * numOutputFactors);
+  m_ownScores.reserve(numEntries * numFeatureValuesInConfig);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Entry entry;
+    entry.key = keys[i];
+    entry.begin = numOutputFactors ? m_ownTargets.size() / numOutputFactors : i;
+    m_ownTargets.insert(m_ownTargets.end(), targets[i].begin(), targets[i].end());
+    m_ownScores.insert(m_ownScores.end(), scores[i].begin(), scores[i].end());
+    entry.end = numOutputFactors ? m_ownTargets.size() / numOutputFactors : i + 1;
+    m_table.Insert(entry);
+  }
+  m_buckets = &m_ownBuckets[0];
+  m_numBuckets = m_ownBuckets.size();
+  m_numInputs = keys.size();
+  m_targets = m_ownTargets.empty() ? NULL : &m_ownTargets[0];
+  m_scores = m_ownScores.empty() ? NULL : &m_ownScores[0];
 }
 
-GenerationDictionary::~GenerationDictionary()
+void GenerationDictionary::LoadImage()
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(m_imagePath.c_str()));
+  uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(ImageHeader), m_imagePath << " is not a generation table image");
+  util::MapRead(util::POPULATE_OR_LAZY, fd.get(), 0, size, m_image);
+
+  const ImageHeader &header = *reinterpret_cast<const ImageHeader*>(m_image.get());
+  UTIL_THROW_IF2(memcmp(header.magic, kImageMagic, sizeof(kImageMagic)),
+                 m_imagePath << " is not a generation table image");
+  UTIL_THROW_IF2(header.numInputFactors != GetInput().size()
+                 || header.numOutputFactors != GetOutput().size()
+                 || header.numScores != GetNumScoreComponents(),
+                 m_imagePath << " was built with different factors or number of scores");
+  const uint64_t vocabOffset = sizeof(ImageHeader) + header.numBuckets * sizeof(Entry)
+                               + header.numEntries * header.numOutputFactors * sizeof(uint32_t)
+                               + header.numEntries * header.numScores * sizeof(float);
+  UTIL_THROW_IF2(size != vocabOffset + header.vocabBytes, m_imagePath << " is truncated");
+
+  m_numInputs = header.numInputs;
+  m_numBuckets = header.numBuckets;
+  m_buckets = reinterpret_cast<const Entry*>(&header + 1);
+  m_targets = reinterpret_cast<const uint32_t*>(m_buckets + m_numBuckets);
+  m_scores = reinterpret_cast<const float*>(m_targets + header.numEntries * header.numOutputFactors);
+  // lookups don't write to the buckets, so they may stay read-only
+  m_table = TableType(const_cast<Entry*>(m_buckets), m_numBuckets * sizeof(Entry));
+
+  // factors are per process, so the vocabulary is looked up again
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  const char *vocab = m_image.begin() + vocabOffset;
+  for (const char *end = m_image.end(); vocab < end; vocab += strlen(vocab) + 1) {
+    m_vocab.push_back(factorCollection.AddFactor(StringPiece(vocab)));
+  }
+  VERBOSE(1, "Mapped generation table image " << m_imagePath << std::endl);
+}
+
+void GenerationDictionary::SaveImage() const
 {
-  Collection::const_iterator iter;
-  for (iter = m_collection.begin() ; iter != m_collection.end() ; ++iter) {
-    delete iter->first;
+  string vocab;
+  for (size_t i = 0; i < m_vocab.size(); ++i) {
+    StringPiece str = m_vocab[i]->GetString();
+    vocab.append(str.data(), str.size());
+    vocab += '\0';
+  }
+
+  ImageHeader header;
+  memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.numInputFactors = GetInput().size();
+  header.numOutputFactors = GetOutput().size();
+  header.numScores = GetNumScoreComponents();
+  header.numInputs = m_numInputs;
+  header.numBuckets = m_numBuckets;
+  header.numEntries = header.numScores ? m_ownScores.size() / header.numScores
+                      : (header.numOutputFactors ? m_ownTargets.size() / header.numOutputFactors : 0);
+  header.vocabBytes = vocab.size();
+
+  // write next to the image and rename, so that other processes never
+  // map a half-written one
+  std::string tmpPath = m_imagePath + ".tmp." + SPrint(getpid());
+  {
+    util::scoped_fd fd(util::CreateOrThrow(tmpPath.c_str()));
+    util::WriteOrThrow(fd.get(), &header, sizeof(header));
+    util::WriteOrThrow(fd.get(), m_buckets, m_numBuckets * sizeof(Entry));
+    util::WriteOrThrow(fd.get(), m_targets, m_ownTargets.size() * sizeof(uint32_t));
+    util::WriteOrThrow(fd.get(), m_scores, m_ownScores.size() * sizeof(float));
+    util::WriteOrThrow(fd.get(), vocab.data(), vocab.size());
   }
+  UTIL_THROW_IF2(rename(tmpPath.c_str(), m_imagePath.c_str()),
+                 "Cannot rename " << tmpPath << " to " << m_imagePath);
+  VERBOSE(1, "Wrote generation table image " << m_imagePath << std::endl);
 }
 
-const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) const
+GenerationDictionary::~GenerationDictionary()
 {
-  const OutputWordCollection *ret;
+}
 
-  Collection::const_iterator iter = m_collection.find(&word);
-  if (iter == m_collection.end()) {
+bool GenerationDictionary::FindWord(const Word &word, size_t &begin, size_t &end) const
+{
+  uint64_t key = MakeKey(word);
+  TableType::ConstIterator it;
+  if (m_numBuckets == 0 || key == 0 || !m_table.Find(key, it)) {
     // can't find source phrase
-    ret = NULL;
-  } else {
-    ret = &iter->second;
+    return false;
   }
-  return ret;
+  begin = it->begin;
+  end = it->end;
+  return true;
 }
 
 void GenerationDictionary::SetParameter(const std::string& key, const std::string& value)
 {
   if (key == "path") {
     m_filePath = value;
+  } else if (key == "image") {
+    m_imagePath = value;
   } else {
     DecodeFeature::SetParameter(key, value);
   }
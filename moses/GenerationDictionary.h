@@ -22,36 +22,74 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_GenerationDictionary_h
 #define moses_GenerationDictionary_h
 
-#include <list>
-#include <map>
-#include <stdexcept>
+#include <string>
 #include <vector>
-#include "ScoreComponentCollection.h"
-#include "Phrase.h"
+#include <stdint.h>
 #include "TypeDef.h"
+#include "Word.h"
 #include "moses/FF/DecodeFeature.h"
+#include "util/mmap.hh"
+#include "util/probing_hash_table.hh"
 
 namespace Moses
 {
 
-class FactorCollection;
-
-typedef std::map < Word , ScoreComponentCollection > OutputWordCollection;
-// 1st = output phrase
-// 2nd = log probability (score)
-
-/** Implementation of a generation table in a trie.
+class Factor;
+
+/** Generation table: a probing hash table maps a 64-bit hash of the input
+ *  factors of a word to a run of entries, each an output word (one
+ *  vocabulary id per output factor) and its scores. The entries and their
+ *  scores are stored back to back in flat arrays.
+ *
+ *  Like the in-memory lexical reordering table, the arrays only hold
+ *  offsets and ids, so with image=file they are written to an image after
+ *  loading the text table and mapped back in as they are the next time;
+ *  only the output vocabulary is looked up again on load.
  */
 class GenerationDictionary : public DecodeFeature
 {
-  typedef std::map<const Word* , OutputWordCollection, WordComparer> Collection;
+  struct Entry {
+    typedef uint64_t Key;
+    uint64_t key;   //!< hash of the input factors; 0 marks an empty bucket
+    uint32_t begin; //!< first entry of this input in m_targets
+    uint32_t end;
+    Key GetKey() const {
+      return key;
+    }
+    void SetKey(Key k) {
+      key = k;
+    }
+  };
+  typedef util::ProbingHashTable<Entry, util::IdentityHash> TableType;
+
 protected:
   static std::vector<GenerationDictionary*> s_staticColl;
 
-  Collection m_collection;
-  // 1st = source
-  // 2nd = target
-  std::string						m_filePath;
+  std::string m_filePath;
+  std::string m_imagePath;
+
+  const Entry *m_buckets;
+  size_t m_numBuckets;
+  TableType m_table;
+  size_t m_numInputs;
+  //! GetOutput().size() vocabulary ids per entry
+  const uint32_t *m_targets;
+  //! GetNumScoreComponents() per entry
+  const float *m_scores;
+  //! output factor of each vocabulary id
+  std::vector<const Factor*> m_vocab;
+
+  // backing store: either the arrays built from the text table, or a
+  // read-only mapping of an image
+  std::vector<Entry> m_ownBuckets;
+  std::vector<uint32_t> m_ownTargets;
+  std::vector<float> m_ownScores;
+  util::scoped_memory m_image;
+
+  uint64_t MakeKey(const Word &word) const;
+  void LoadText();
+  void LoadImage();
+  void SaveImage() const;
 
 public:
   static const std::vector<GenerationDictionary*>& GetColl() {
@@ -68,12 +106,28 @@ public:
   * NOT the number of lines in the generation table
   */
   size_t GetSize() const {
-    return m_collection.size();
+    return m_numInputs;
   }
-  /** returns a bag of output words, OutputWordCollection, for a particular input word.
-  *	Or NULL if the input word isn't found. The search function used is the WordComparer functor
-  */
-  const OutputWordCollection *FindWord(const Word &word) const;
+
+  /** the generations of word are the entries [begin, end). Returns false
+   *  if the input word isn't found.
+   */
+  bool FindWord(const Word &word, size_t &begin, size_t &end) const;
+
+  //! set the output factors of an entry on word
+  void SetOutputFactors(size_t entry, Word &word) const {
+    const std::vector<FactorType> &output = GetOutput();
+    const uint32_t *ids = m_targets + entry * output.size();
+    for (size_t i = 0; i < output.size(); ++i) {
+      word.SetFactor(output[i], m_vocab[ids[i]]);
+    }
+  }
+
+  //! the GetNumScoreComponents() scores of an entry
+  const float *GetScores(size_t entry) const {
+    return m_scores + entry * GetNumScoreComponents();
+  }
+
   void SetParameter(const std::string& key, const std::string& value);
 
 };
@@ -38,12 +38,28 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ChartManager.h"
 #include "HypergraphOutput.h"
 #include "Manager.h"
+#include "moses/FF/FeatureFunction.h"
 
 using namespace std;
 
 namespace Moses
 {
 
+namespace
+{
+void WriteHypergraph(const Manager &manager, std::ostream &out, bool binary)
+{
+  UTIL_THROW_IF(binary, util::Exception,
+                "Binary hypergraph output is only implemented for the chart decoder");
+  manager.OutputSearchGraphAsHypergraph(out);
+}
+
+void WriteHypergraph(const ChartManager &manager, std::ostream &out, bool binary)
+{
+  manager.OutputSearchGraphAsHypergraph(out, binary);
+}
+}
+
 template<class M>
 HypergraphOutput<M>::HypergraphOutput(size_t precision) :
   m_precision(precision)
@@ -67,7 +83,7 @@ HypergraphOutput<M>::HypergraphOutput(size_t precision) :
   } else {
     m_compression = "txt";
   }
-  UTIL_THROW_IF(m_compression != "txt" && m_compression != "gz" && m_compression != "bz2",
+  UTIL_THROW_IF(m_compression != "txt" && m_compression != "gz" && m_compression != "bz2" && m_compression != "bin",
                 util::Exception, "Unknown compression type: " << m_compression);
 
   if ( hypergraphParameters.size() > 2 ) {
@@ -143,12 +159,12 @@ void HypergraphOutput<M>::Write(const M& manager) const
     file.push( boost::iostreams::bzip2_compressor() );
   }
 
-  file.push( boost::iostreams::file_sink(fileName.str(), ios_base::out) );
+  file.push( boost::iostreams::file_sink(fileName.str(), ios_base::out | ios_base::binary) );
 
   if (file.is_complete() && file.good()) {
     file.setf(std::ios::fixed);
     file.precision(m_precision);
-    manager.OutputSearchGraphAsHypergraph(file);
+    WriteHypergraph(manager, file, m_compression == "bin");
     file.flush();
   } else {
     TRACE_ERR("Cannot output hypergraph for line " << manager.GetSource().GetTranslationId()
@@ -164,14 +180,14 @@ template class HypergraphOutput<ChartManager>;
 
 
 void ChartSearchGraphWriterMoses::WriteHypos
-(const ChartHypothesisCollection& hypos, const map<unsigned, bool> &reachable) const
+(const ChartHypothesisCollection& hypos, const std::vector<bool> &reachable) const
 {
 
   ChartHypothesisCollection::const_iterator iter;
   for (iter = hypos.begin() ; iter != hypos.end() ; ++iter) {
     ChartHypothesis &mainHypo = **iter;
     if (StaticData::Instance().GetUnprunedSearchGraph() ||
-        reachable.find(mainHypo.GetId()) != reachable.end()) {
+        reachable[mainHypo.GetId()]) {
       (*m_out) << m_lineNumber << " " << mainHypo << endl;
     }
 
@@ -180,7 +196,7 @@ void ChartSearchGraphWriterMoses::WriteHypos
       ChartArcList::const_iterator iterArc;
       for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
         const ChartHypothesis &arc = **iterArc;
-        if (reachable.find(arc.GetId()) != reachable.end()) {
+        if (reachable[arc.GetId()]) {
           (*m_out) << m_lineNumber << " " << arc << endl;
         }
       }
@@ -197,14 +213,14 @@ void ChartSearchGraphWriterHypergraph::WriteHeader(size_t winners, size_t losers
 }
 
 void ChartSearchGraphWriterHypergraph::WriteHypos(const ChartHypothesisCollection& hypos,
-    const map<unsigned, bool> &reachable) const
+    const std::vector<bool> &reachable) const
 {
 
   ChartHypothesisCollection::const_iterator iter;
   for (iter = hypos.begin() ; iter != hypos.end() ; ++iter) {
     const ChartHypothesis* mainHypo = *iter;
     if (!StaticData::Instance().GetUnprunedSearchGraph() &&
-        reachable.find(mainHypo->GetId()) == reachable.end()) {
+        !reachable[mainHypo->GetId()]) {
       //Ignore non reachable nodes
       continue;
     }
@@ -218,7 +234,7 @@ void ChartSearchGraphWriterHypergraph::WriteHypos(const ChartHypothesisCollectio
       ChartArcList::const_iterator iterArc;
       for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
         const ChartHypothesis* arc = *iterArc;
-        if (reachable.find(arc->GetId()) != reachable.end()) {
+        if (reachable[arc->GetId()]) {
           edges.push_back(arc);
         }
       }
@@ -253,6 +269,118 @@ void ChartSearchGraphWriterHypergraph::WriteHypos(const ChartHypothesisCollectio
   }
 }
 
+ChartSearchGraphWriterBinaryHypergraph::ChartSearchGraphWriterBinaryHypergraph(std::ostream* out) :
+  m_out(out), m_nodeId(0) {}
+
+void ChartSearchGraphWriterBinaryHypergraph::WriteVarint(size_t value) const
+{
+  while (value >= 0x80) {
+    m_out->put(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  m_out->put(static_cast<char>(value));
+}
+
+void ChartSearchGraphWriterBinaryHypergraph::WriteSymbol(SymbolMap &symbols, const std::string &symbol,
+    size_t shift) const
+{
+  std::pair<SymbolMap::iterator, bool> inserted =
+    symbols.insert(SymbolMap::value_type(symbol, symbols.size()));
+  WriteVarint(inserted.first->second << shift);
+  if (inserted.second) {
+    WriteVarint(symbol.size());
+    m_out->write(symbol.data(), symbol.size());
+  }
+}
+
+void ChartSearchGraphWriterBinaryHypergraph::WriteHeader(size_t winners, size_t losers) const
+{
+  m_out->write("MosesHG1", 8);
+  WriteVarint(winners);
+  WriteVarint(winners + losers);
+}
+
+void ChartSearchGraphWriterBinaryHypergraph::WriteHypos(const ChartHypothesisCollection& hypos,
+    const std::vector<bool> &reachable) const
+{
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+
+  ChartHypothesisCollection::const_iterator iter;
+  for (iter = hypos.begin() ; iter != hypos.end() ; ++iter) {
+    const ChartHypothesis* mainHypo = *iter;
+    if (!StaticData::Instance().GetUnprunedSearchGraph() &&
+        !reachable[mainHypo->GetId()]) {
+      //Ignore non reachable nodes
+      continue;
+    }
+    m_hypoIdToNodeId[mainHypo->GetId()] = m_nodeId;
+    ++m_nodeId;
+    vector<const ChartHypothesis*> edges;
+    edges.push_back(mainHypo);
+    const ChartArcList *arcList = (*iter)->GetArcList();
+    if (arcList) {
+      ChartArcList::const_iterator iterArc;
+      for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
+        const ChartHypothesis* arc = *iterArc;
+        if (reachable[arc->GetId()]) {
+          edges.push_back(arc);
+        }
+      }
+    }
+    WriteVarint(edges.size());
+    for (vector<const ChartHypothesis*>::const_iterator ei = edges.begin(); ei != edges.end(); ++ei) {
+      const ChartHypothesis* hypo = *ei;
+      const TargetPhrase& target = hypo->GetCurrTargetPhrase();
+      WriteVarint(target.GetSize());
+      size_t ntIndex = 0;
+      for (size_t i = 0; i < target.GetSize(); ++i) {
+        const Word& word = target.GetWord(i);
+        if (word.IsNonTerminal()) {
+          size_t hypoId = hypo->GetPrevHypos()[ntIndex++]->GetId();
+          WriteVarint((m_hypoIdToNodeId[hypoId] << 1) | 1);
+        } else {
+          WriteSymbol(m_words, word.GetFactor(0)->GetString().as_string(), 1);
+        }
+      }
+
+      ScoreComponentCollection scores = hypo->GetScoreBreakdown();
+      HypoList::const_iterator hi;
+      for (hi = hypo->GetPrevHypos().begin(); hi != hypo->GetPrevHypos().end(); ++hi) {
+        scores.MinusEquals((*hi)->GetScoreBreakdown());
+      }
+      // same names as ScoreComponentCollection::Save
+      std::vector<std::pair<std::string, float> > features;
+      for (size_t fi = 0; fi < ffs.size(); ++fi) {
+        const size_t components = ffs[fi]->GetNumScoreComponents();
+        if (components == 0) {
+          continue;
+        }
+        const std::string &name = ffs[fi]->GetScoreProducerDescription();
+        std::vector<float> values = scores.GetScoresForProducer(ffs[fi]);
+        if (components == 1) {
+          features.push_back(std::make_pair(name, values[0]));
+        } else {
+          for (size_t i = 0; i < components; ++i) {
+            ostringstream fullname;
+            fullname << name << "_" << (i + 1);
+            features.push_back(std::make_pair(fullname.str(), values[i]));
+          }
+        }
+      }
+      const FVector &sparse = scores.GetScoresVector();
+      for (FVector::const_iterator si = sparse.cbegin(); si != sparse.cend(); ++si) {
+        features.push_back(std::make_pair(si->first.name(), static_cast<float>(si->second)));
+      }
+      WriteVarint(features.size());
+      for (size_t i = 0; i < features.size(); ++i) {
+        WriteSymbol(m_features, features[i].first, 0);
+        m_out->write(reinterpret_cast<const char*>(&features[i].second), sizeof(float));
+      }
+
+      WriteVarint(hypo->GetCurrSourceRange().GetNumWordsCovered());
+    }
+  }
+}
 
 } //namespace Moses
 
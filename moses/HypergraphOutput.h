@@ -23,7 +23,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_Hypergraph_Output_h
 #define moses_Hypergraph_Output_h
 
+#include <map>
 #include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
 
 /**
 * Manage the output of hypergraphs.
@@ -61,7 +66,7 @@ class ChartSearchGraphWriter
 public:
   virtual void WriteHeader(size_t winners, size_t losers) const = 0;
   virtual void WriteHypos(const ChartHypothesisCollection& hypos,
-                          const std::map<unsigned, bool> &reachable) const = 0;
+                          const std::vector<bool> &reachable) const = 0;
 
 };
 
@@ -75,7 +80,7 @@ public:
     /* do nothing */
   }
   virtual void WriteHypos(const ChartHypothesisCollection& hypos,
-                          const std::map<unsigned, bool> &reachable) const;
+                          const std::vector<bool> &reachable) const;
 
 private:
   std::ostream* m_out;
@@ -90,7 +95,7 @@ public:
     m_out(out), m_nodeId(0) {}
   virtual void WriteHeader(size_t winners, size_t losers) const;
   virtual void WriteHypos(const ChartHypothesisCollection& hypos,
-                          const std::map<unsigned, bool> &reachable) const;
+                          const std::vector<bool> &reachable) const;
 
 private:
   std::ostream* m_out;
@@ -98,5 +103,45 @@ private:
   mutable std::map<size_t,size_t> m_hypoIdToNodeId;
 };
 
+/**
+ * Binary version of the hypergraph format, selected with "bin" as the
+ * compression type of -output-search-graph-hypergraph. It holds the same
+ * vertices and edges, in the same bottom-up order, but needs no tokenising
+ * or number parsing to read back (see ReadGraph in mert/Hypergraph.h).
+ *
+ * The file starts with the 8 bytes "MosesHG1". All the other integers are
+ * unsigned LEB128 varints:
+ *   vertices edges
+ *   for each vertex: incoming-edge-count, then for each edge
+ *     token-count token*        token = (child << 1) | 1 for a non-terminal,
+ *                               (word-id << 1) for a terminal
+ *     feature-count (name-id value)*   value is a native 4-byte float
+ *     source-covered
+ * Word and feature name ids are numbered separately, in the order of their
+ * first use. An id equal to the number of ids used so far introduces a new
+ * symbol, and is followed by the length of the string and its bytes.
+ **/
+class ChartSearchGraphWriterBinaryHypergraph : public virtual ChartSearchGraphWriter
+{
+public:
+  ChartSearchGraphWriterBinaryHypergraph(std::ostream* out);
+  virtual void WriteHeader(size_t winners, size_t losers) const;
+  virtual void WriteHypos(const ChartHypothesisCollection& hypos,
+                          const std::vector<bool> &reachable) const;
+
+private:
+  typedef boost::unordered_map<std::string, size_t> SymbolMap;
+
+  void WriteVarint(size_t value) const;
+  //! write the id of symbol shifted left by shift, followed by the string if it is new
+  void WriteSymbol(SymbolMap &symbols, const std::string &symbol, size_t shift) const;
+
+  std::ostream* m_out;
+  mutable size_t m_nodeId;
+  mutable std::map<size_t,size_t> m_hypoIdToNodeId;
+  mutable SymbolMap m_words;
+  mutable SymbolMap m_features;
+};
+
 }
 #endif
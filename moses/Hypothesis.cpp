@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <vector>
@@ -36,17 +37,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
+#include "DecodeProfile.h"
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+#include "util/murmur_hash.hh"
 
 using namespace std;
 
 namespace Moses
 {
-
-#ifdef USE_HYPO_POOL
-  ObjectPool<Hypothesis> Hypothesis::s_objectPool("Hypothesis", 300000);
-#endif
+  std::vector<std::pair<size_t, size_t> > Hypothesis::s_keyedStates;
+  std::vector<size_t> Hypothesis::s_comparedStates;
+  size_t Hypothesis::s_stateKeySize = 0;
+  bool Hypothesis::s_recombinationHashed = false;
 
   Hypothesis::
   Hypothesis(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt)
@@ -57,10 +61,14 @@ namespace Moses
 			     m_sourceCompleted.GetFirstGapPos()>0 ? 0 : NOT_FOUND,
 			     m_sourceCompleted.GetFirstGapPos()>0 ? m_sourceCompleted.GetFirstGapPos()-1 : NOT_FOUND)
     , m_currTargetWordsRange(NOT_FOUND, NOT_FOUND)
+    , m_distortionState(m_currSourceWordsRange)
     , m_wordDeleted(false)
     , m_totalScore(0.0f)
     , m_futureScore(0.0f)
+    , m_currScoreBreakdownReleased(false)
     , m_ffStates(StatefulFeatureFunction::GetStatefulFeatureFunctions().size())
+    , m_stateKeyFilled(false)
+    , m_recombinationHash(0)
     , m_arcList(NULL)
     , m_transOpt(initialTransOpt)
     , m_manager(manager)
@@ -88,10 +96,14 @@ namespace Moses
     , m_currTargetWordsRange(prevHypo.m_currTargetWordsRange.GetEndPos() + 1,
 			     prevHypo.m_currTargetWordsRange.GetEndPos() 
 			     + transOpt.GetTargetPhrase().GetSize())
+    , m_distortionState(m_currSourceWordsRange)
     , m_wordDeleted(false)
     , m_totalScore(0.0f)
     , m_futureScore(0.0f)
+    , m_currScoreBreakdownReleased(false)
     , m_ffStates(prevHypo.m_ffStates.size())
+    , m_stateKeyFilled(false)
+    , m_recombinationHash(0)
     , m_arcList(NULL)
     , m_transOpt(transOpt)
     , m_manager(prevHypo.GetManager())
@@ -113,12 +125,15 @@ namespace Moses
   ~Hypothesis()
   {
     for (unsigned i = 0; i < m_ffStates.size(); ++i)
-      delete m_ffStates[i];
+      DeleteFFState(m_ffStates[i]);
 
     if (m_arcList) {
+      // go through our own manager: the arcs may already have been
+      // destroyed if the whole pool is being torn down
+      ObjectPool<Hypothesis> &pool = m_manager.GetHypothesisPool();
       ArcList::iterator iter;
       for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
-	FREEHYPO(*iter);
+	pool.freeObject(*iter);
       }
       m_arcList->clear();
 
@@ -150,9 +165,59 @@ namespace Moses
 	// DO NOTHING
       }
     }
+
+    // apply the limit of CleanupArcList() as the arcs come in, so that
+    // the arc lists of a long sentence don't hold all recombined hypotheses.
+    // loserHypo itself may still be in a stack, so it is added afterwards
+    const size_t nBestSize = StaticData::Instance().GetNBestSize();
+    if (nBestSize && m_arcList->size() >= nBestSize * 5 && !KeepAllArcs())
+      PruneArcList(nBestSize);
+
+    loserHypo->ReleaseFFStates();
     m_arcList->push_back(loserHypo);
   }
 
+  bool
+  Hypothesis::
+  KeepAllArcs()
+  {
+    const StaticData &staticData = StaticData::Instance();
+    return (staticData.GetDistinctNBest() ||
+	    staticData.GetLatticeSamplesSize() ||
+	    staticData.UseMBR() ||
+	    staticData.GetOutputSearchGraph() ||
+	    staticData.GetOutputSearchGraphSLF() ||
+	    staticData.GetOutputSearchGraphHypergraph() ||
+	    staticData.UseLatticeMBR());
+  }
+
+  void
+  Hypothesis::
+  PruneArcList(size_t nBestSize)
+  {
+    NTH_ELEMENT4(m_arcList->begin(), m_arcList->begin() + nBestSize - 1,
+		 m_arcList->end(), CompareHypothesisTotalScore());
+
+    // delete bad ones
+    ArcList::iterator iter;
+    for (iter = m_arcList->begin() + nBestSize; iter != m_arcList->end() ; ++iter)
+      FREEHYPO(*iter);
+    m_arcList->erase(m_arcList->begin() + nBestSize, m_arcList->end());
+  }
+
+  void
+  Hypothesis::
+  ReleaseFFStates()
+  {
+    // the recombination key stays cached, the stack may still hash us
+    FillStateKey();
+    GetRecombinationHash();
+    for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+      DeleteFFState(m_ffStates[i]);
+      m_ffStates[i] = NULL;
+    }
+  }
+
   /***
    * return the subclass of Hypothesis most appropriate to the given translation option
    */
@@ -170,13 +235,8 @@ namespace Moses
   Hypothesis::
   Create(const Hypothesis &prevHypo, const TranslationOption &transOpt)
   {
-
-#ifdef USE_HYPO_POOL
-    Hypothesis *ptr = s_objectPool.getPtr();
+    Hypothesis *ptr = prevHypo.GetManager().GetHypothesisPool().getPtr();
     return new(ptr) Hypothesis(prevHypo, transOpt);
-#else
-    return new Hypothesis(prevHypo, transOpt);
-#endif
   }
   /***
    * return the subclass of Hypothesis most appropriate to the given target phrase
@@ -187,12 +247,20 @@ namespace Moses
   Create(Manager& manager, InputType const& m_source, 
 	 const TranslationOption &initialTransOpt)
   {
-#ifdef USE_HYPO_POOL
-    Hypothesis *ptr = s_objectPool.getPtr();
+    Hypothesis *ptr = manager.GetHypothesisPool().getPtr();
     return new(ptr) Hypothesis(manager, m_source, initialTransOpt);
-#else
-    return new Hypothesis(manager, m_source, initialTransOpt);
-#endif
+  }
+
+  /***
+   * Hypotheses live in the object pool of the Manager of the sentence. They
+   * are destroyed lazily, either when their slot is reused or when the
+   * Manager goes away, which releases all of them at once.
+   */
+  void
+  Hypothesis::
+  Free(Hypothesis *hypo)
+  {
+    hypo->GetManager().GetHypothesisPool().freeObject(hypo);
   }
 
   /** check, if two hypothesis can be recombined.
@@ -211,7 +279,26 @@ namespace Moses
     if (comp != 0)
       return comp;
 
-    for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+    if (s_stateKeySize == 0) {
+      for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+	if (m_ffStates[i] == NULL || compare.m_ffStates[i] == NULL) {
+	  comp = m_ffStates[i] - compare.m_ffStates[i];
+	} else {
+	  comp = m_ffStates[i]->Compare(*compare.m_ffStates[i]);
+	}
+	if (comp != 0) return comp;
+      }
+      return 0;
+    }
+
+    // the keyed states in one go, the rest one by one
+    if (!m_stateKeyFilled) FillStateKey();
+    if (!compare.m_stateKeyFilled) compare.FillStateKey();
+    comp = memcmp(m_stateKey, compare.m_stateKey, s_stateKeySize * sizeof(uint32_t));
+    if (comp != 0) return comp;
+
+    for (size_t j = 0; j < s_comparedStates.size(); ++j) {
+      const size_t i = s_comparedStates[j];
       if (m_ffStates[i] == NULL || compare.m_ffStates[i] == NULL) {
 	comp = m_ffStates[i] - compare.m_ffStates[i];
       } else {
@@ -223,6 +310,77 @@ namespace Moses
     return 0;
   }
 
+  size_t
+  Hypothesis::
+  GetRecombinationHash() const
+  {
+    if (m_recombinationHash) return m_recombinationHash;
+
+    size_t seed = m_sourceCompleted.hash();
+    if (s_stateKeySize == 0) {
+      for (size_t i = 0; i < m_ffStates.size(); ++i) {
+	if (m_ffStates[i]) boost::hash_combine(seed, m_ffStates[i]->hash());
+      }
+    } else {
+      if (!m_stateKeyFilled) FillStateKey();
+      seed = util::MurmurHashNative(m_stateKey, s_stateKeySize * sizeof(uint32_t), seed);
+      for (size_t j = 0; j < s_comparedStates.size(); ++j) {
+	const FFState *state = m_ffStates[s_comparedStates[j]];
+	if (state) boost::hash_combine(seed, state->hash());
+      }
+    }
+    m_recombinationHash = seed ? seed : 1;
+    return m_recombinationHash;
+  }
+
+  void
+  Hypothesis::
+  FillStateKey() const
+  {
+    const vector<const StatefulFeatureFunction*>& ffs =
+      StatefulFeatureFunction::GetStatefulFeatureFunctions();
+    uint32_t *key = m_stateKey;
+    for (size_t j = 0; j < s_keyedStates.size(); ++j) {
+      const size_t i = s_keyedStates[j].first;
+      const size_t size = s_keyedStates[j].second;
+      // the first word tells a missing state (ignored feature) apart
+      if (m_ffStates[i]) {
+	key[0] = 1;
+	ffs[i]->WriteStateKey(*m_ffStates[i], key + 1);
+      } else {
+	std::fill(key, key + 1 + size, 0);
+      }
+      key += 1 + size;
+    }
+    m_stateKeyFilled = true;
+  }
+
+  void
+  Hypothesis::
+  InitStateKeyLayout()
+  {
+    s_keyedStates.clear();
+    s_comparedStates.clear();
+    s_stateKeySize = 0;
+    s_recombinationHashed = true;
+    const vector<const StatefulFeatureFunction*>& ffs =
+      StatefulFeatureFunction::GetStatefulFeatureFunctions();
+    for (size_t i = 0; i < ffs.size(); ++i) {
+      const size_t size = ffs[i]->GetStateKeySize();
+      if (size && s_stateKeySize + 1 + size <= MAX_STATE_KEY_SIZE) {
+	s_keyedStates.push_back(std::make_pair(i, size));
+	s_stateKeySize += 1 + size;
+      } else {
+	s_comparedStates.push_back(i);
+	// states hashing to 0 would put hypotheses of a coverage in one bucket
+	s_recombinationHashed = s_recombinationHashed && ffs[i]->HasStateHash();
+      }
+    }
+    VERBOSE(2, "Recombination: " << s_keyedStates.size() << " stateful features keyed inline ("
+	    << s_stateKeySize << " words), " << s_comparedStates.size() << " compared through their states, "
+	    << (s_recombinationHashed ? "hashed" : "ordered") << " stacks" << endl);
+  }
+
   void 
   Hypothesis::
   EvaluateWhenApplied(StatefulFeatureFunction const& sfff,
@@ -231,6 +389,7 @@ namespace Moses
     const StaticData &staticData = StaticData::Instance();
     if (! staticData.IsFeatureFunctionIgnored( sfff )) 
       {
+	DecodeProfile::Scope scope(sfff, DecodeProfile::WhenApplied);
 	m_ffStates[state_idx] 
 	  = sfff.EvaluateWhenApplied
 	  (*this, m_prevHypo ? m_prevHypo->m_ffStates[state_idx] : NULL,
@@ -238,12 +397,42 @@ namespace Moses
     }
   }
 
+  void
+  Hypothesis::
+  EvaluateWhenAppliedBatch(StatefulFeatureFunction const& sfff, int state_idx,
+                           std::vector<Hypothesis*> const& hypos)
+  {
+    if (hypos.empty() || StaticData::Instance().IsFeatureFunctionIgnored(sfff))
+      return;
+
+    std::vector<const Hypothesis*> batch(hypos.size());
+    std::vector<const FFState*> prevStates(hypos.size());
+    std::vector<ScoreComponentCollection*> accumulators(hypos.size());
+    for (size_t i = 0; i < hypos.size(); ++i) {
+      Hypothesis *hypo = hypos[i];
+      batch[i] = hypo;
+      prevStates[i] = hypo->m_prevHypo ? hypo->m_prevHypo->m_ffStates[state_idx] : NULL;
+      accumulators[i] = &hypo->m_currScoreBreakdown;
+    }
+
+    std::vector<FFState*> outStates;
+    DecodeProfile::Scope scope(sfff, DecodeProfile::WhenApplied);
+    sfff.EvaluateWhenAppliedBatch(batch, prevStates, accumulators, outStates);
+    UTIL_THROW_IF2(outStates.size() != hypos.size(),
+                   sfff.GetScoreProducerDescription()
+                   << " returned " << outStates.size() << " states for a batch of "
+                   << hypos.size() << " hypotheses");
+    for (size_t i = 0; i < hypos.size(); ++i)
+      hypos[i]->m_ffStates[state_idx] = outStates[i];
+  }
+
   void 
   Hypothesis::
   EvaluateWhenApplied(const StatelessFeatureFunction& slff)
   {
     const StaticData &staticData = StaticData::Instance();
     if (! staticData.IsFeatureFunctionIgnored( slff )) {
+      DecodeProfile::Scope scope(slff, DecodeProfile::WhenApplied);
       slff.EvaluateWhenApplied(*this, &m_currScoreBreakdown);
     }
   }
@@ -258,6 +447,92 @@ namespace Moses
     IFVERBOSE(2) {
       m_manager.GetSentenceStats().StartTimeOtherScore();
     }
+    EvaluateFeatureFunctions();
+    IFVERBOSE(2) {
+      m_manager.GetSentenceStats().StopTimeOtherScore();
+      m_manager.GetSentenceStats().StartTimeEstimateScore();
+    }
+
+    // FUTURE COST
+    m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+
+    // TOTAL
+    m_totalScore = m_currScoreBreakdown.GetWeightedScore() + m_futureScore;
+    if (m_prevHypo) m_totalScore += m_prevHypo->GetScore();
+    ReleaseScoreBreakdown();
+
+    IFVERBOSE(2) {
+      m_manager.GetSentenceStats().StopTimeEstimateScore();
+    }
+  }
+
+  void
+  Hypothesis::
+  CalcTotalScores(const std::vector<Hypothesis*> &hypos, const SquareMatrix &futureScore)
+  {
+    std::vector<const ScoreComponentCollection*> scores(hypos.size());
+    for (size_t i = 0; i < hypos.size(); ++i) {
+      scores[i] = &hypos[i]->m_currScoreBreakdown;
+    }
+    std::vector<float> weighted(hypos.size());
+    if (!hypos.empty()) {
+      ScoreComponentCollection::GetWeightedScores(&scores[0], scores.size(), &weighted[0]);
+    }
+    for (size_t i = 0; i < hypos.size(); ++i) {
+      Hypothesis &hypo = *hypos[i];
+      hypo.m_futureScore = futureScore.CalcFutureScore( hypo.m_sourceCompleted );
+      hypo.m_totalScore = weighted[i] + hypo.m_futureScore;
+      if (hypo.m_prevHypo) hypo.m_totalScore += hypo.m_prevHypo->GetScore();
+      hypo.ReleaseScoreBreakdown();
+    }
+  }
+
+  void
+  Hypothesis::
+  ReleaseScoreBreakdown()
+  {
+    if (!StaticData::Instance().IsLazyScoreBreakdown() || !m_prevHypo)
+      return;
+    // clearing also frees the score vectors
+    m_currScoreBreakdown.ZeroAll();
+    m_currScoreBreakdownReleased = true;
+  }
+
+  /***
+   * redo the scoring of EvaluateFeatureFunctions() for a hypothesis whose
+   * scores were released. The previous hypotheses still hold their states,
+   * the states computed here are thrown away.
+   */
+  void
+  Hypothesis::
+  ReplayScoreBreakdown() const
+  {
+    const StaticData &staticData = StaticData::Instance();
+    m_currScoreBreakdown = m_transOpt.GetScoreBreakdown();
+
+    const vector<const StatelessFeatureFunction*>& sfs =
+      StatelessFeatureFunction::GetStatelessFeatureFunctions();
+    for (unsigned i = 0; i < sfs.size(); ++i) {
+      if (! staticData.IsFeatureFunctionIgnored(*sfs[i])) {
+	sfs[i]->EvaluateWhenApplied(*this, &m_currScoreBreakdown);
+      }
+    }
+
+    const vector<const StatefulFeatureFunction*>& ffs =
+      StatefulFeatureFunction::GetStatefulFeatureFunctions();
+    for (unsigned i = 0; i < ffs.size(); ++i) {
+      if (! staticData.IsFeatureFunctionIgnored(*ffs[i])) {
+	DeleteFFState(ffs[i]->EvaluateWhenApplied(*this, m_prevHypo->m_ffStates[i],
+						  &m_currScoreBreakdown));
+      }
+    }
+    m_currScoreBreakdownReleased = false;
+  }
+
+  void
+  Hypothesis::
+  EvaluateFeatureFunctions()
+  {
     // some stateless score producers cache their values in the translation
     // option: add these here
     // language model scores for n-grams completely contained within a target
@@ -278,27 +553,12 @@ namespace Moses
       const StatefulFeatureFunction &ff = *ffs[i];
       const StaticData &staticData = StaticData::Instance();
       if (! staticData.IsFeatureFunctionIgnored(ff)) {
+	DecodeProfile::Scope scope(ff, DecodeProfile::WhenApplied);
 	m_ffStates[i] = ff.EvaluateWhenApplied(*this,
 					       m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL,
 					       &m_currScoreBreakdown);
       }
     }
-
-    IFVERBOSE(2) {
-      m_manager.GetSentenceStats().StopTimeOtherScore();
-      m_manager.GetSentenceStats().StartTimeEstimateScore();
-    }
-
-    // FUTURE COST
-    m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
-
-    // TOTAL
-    m_totalScore = m_currScoreBreakdown.GetWeightedScore() + m_futureScore;
-    if (m_prevHypo) m_totalScore += m_prevHypo->GetScore();
-
-    IFVERBOSE(2) {
-      m_manager.GetSentenceStats().StopTimeEstimateScore();
-    }
   }
 
   const Hypothesis* Hypothesis::GetPrevHypo()const
@@ -342,7 +602,7 @@ namespace Moses
     //	TRACE_ERR( "\tlanguage model cost "); // <<m_score[ScoreType::LanguageModelScore]<<endl;
     //	TRACE_ERR( "\tword penalty "); // <<(m_score[ScoreType::WordPenalty]*weightWordPenalty)<<endl;
     TRACE_ERR( "\tscore "<<m_totalScore - m_futureScore<<" + future cost "<<m_futureScore<<" = "<<m_totalScore<<endl);
-    TRACE_ERR(  "\tunweighted feature scores: " << m_currScoreBreakdown << endl);
+    TRACE_ERR(  "\tunweighted feature scores: " << GetCurrScoreBreakdown() << endl);
     //PrintLMScores();
   }
 
@@ -359,28 +619,9 @@ namespace Moses
      * However, may not be enough if only unique candidates are needed,
      * so we'll keep all of arc list if nedd distinct n-best list
      */
-    const StaticData &staticData = StaticData::Instance();
-    size_t nBestSize = staticData.GetNBestSize();
-    bool distinctNBest = (staticData.GetDistinctNBest() || 
-			  staticData.GetLatticeSamplesSize() ||  
-			  staticData.UseMBR() || 
-			  staticData.GetOutputSearchGraph() || 
-			  staticData.GetOutputSearchGraphSLF() || 
-			  staticData.GetOutputSearchGraphHypergraph() || 
-			  staticData.UseLatticeMBR());
-
-    if (!distinctNBest && m_arcList->size() > nBestSize * 5) 
-      {
-	// prune arc list only if there too many arcs
-	NTH_ELEMENT4(m_arcList->begin(), m_arcList->begin() + nBestSize - 1,
-		     m_arcList->end(), CompareHypothesisTotalScore());
-	
-	// delete bad ones
-	ArcList::iterator iter;
-	for (iter = m_arcList->begin() + nBestSize; iter != m_arcList->end() ; ++iter) 
-	  FREEHYPO(*iter);
-	m_arcList->erase(m_arcList->begin() + nBestSize, m_arcList->end());
-      }
+    size_t nBestSize = StaticData::Instance().GetNBestSize();
+    if (!KeepAllArcs() && m_arcList->size() > nBestSize * 5)
+      PruneArcList(nBestSize); // prune arc list only if there too many arcs
     
     // set all arc's main hypo variable to this hypo
     ArcList::iterator iter = m_arcList->begin();
@@ -458,21 +699,34 @@ namespace Moses
   Hypothesis::
   OutputAlignment(std::ostream &out) const
   {
-    std::vector<const Hypothesis *> edges;
-    const Hypothesis *currentHypo = this;
-    while (currentHypo) {
-      edges.push_back(currentHypo);
-      currentHypo = currentHypo->GetPrevHypo();
-    }
-    
-    OutputAlignment(out, edges);
-    
+    std::vector<std::pair<size_t,size_t> > alignment;
+    if (m_prevHypo) // about two points per target word
+      alignment.reserve(2 * (m_currTargetWordsRange.GetEndPos() + 1));
+    GetWordAlignment(alignment);
+    OutputAlignment(out, alignment);
+    // Removing std::endl here breaks -alignment-output-file, so stop doing that, please :)
+    // Or fix it somewhere else.
+    out << std::endl;
   }
-  
+
+  void
+  Hypothesis::
+  GetWordAlignment(std::vector<std::pair<size_t,size_t> > &alignment) const
+  {
+    if (!m_prevHypo) return;
+    m_prevHypo->GetWordAlignment(alignment);
+    // on a single path the target range starts where the previous one ended
+    GetCurrTargetPhrase().GetAlignTerm().AppendSortedAlignments
+      (alignment, m_currSourceWordsRange.GetStartPos(), m_currTargetWordsRange.GetStartPos());
+  }
+
   void 
   Hypothesis::
   OutputAlignment(ostream &out, const vector<const Hypothesis *> &edges)
   {
+    // the edges of an n-best path come from different paths, so the target
+    // offsets are counted here
+    std::vector<std::pair<size_t,size_t> > alignment;
     size_t targetOffset = 0;
     
     for (int currEdge = (int)edges.size() - 1 ; currEdge >= 0 ; currEdge--) {
@@ -480,10 +734,11 @@ namespace Moses
       const TargetPhrase &tp = edge.GetCurrTargetPhrase();
       size_t sourceOffset = edge.GetCurrSourceWordsRange().GetStartPos();
       
-      OutputAlignment(out, tp.GetAlignTerm(), sourceOffset, targetOffset);
+      tp.GetAlignTerm().AppendSortedAlignments(alignment, sourceOffset, targetOffset);
       
       targetOffset += tp.GetSize();
     }
+    OutputAlignment(out, alignment);
     // Removing std::endl here breaks -alignment-output-file, so stop doing that, please :)
     // Or fix it somewhere else.
     out << std::endl;
@@ -494,15 +749,19 @@ namespace Moses
   OutputAlignment(ostream &out, const AlignmentInfo &ai, 
 		  size_t sourceOffset, size_t targetOffset)
   {
-    typedef std::vector< const std::pair<size_t,size_t>* > AlignVec;
-    AlignVec alignments = ai.GetSortedAlignments();
+    std::vector<std::pair<size_t,size_t> > alignment;
+    ai.AppendSortedAlignments(alignment, sourceOffset, targetOffset);
+    OutputAlignment(out, alignment);
+  }
 
-    AlignVec::const_iterator it;
-    for (it = alignments.begin(); it != alignments.end(); ++it) {
-      const std::pair<size_t,size_t> &alignment = **it;
-      out << alignment.first + sourceOffset << "-" << alignment.second + targetOffset << " ";
+  void
+  Hypothesis::
+  OutputAlignment(ostream &out, const std::vector<std::pair<size_t,size_t> > &alignment)
+  {
+    std::vector<std::pair<size_t,size_t> >::const_iterator it;
+    for (it = alignment.begin(); it != alignment.end(); ++it) {
+      out << it->first << '-' << it->second << ' ';
     }
-    
   }
 
   void 
@@ -649,14 +908,15 @@ namespace Moses
     WordsRange const& src = this->GetCurrSourceWordsRange();
     WordsRange const& trg = this->GetCurrTargetWordsRange();
     
-    vector<pair<size_t,size_t> const* > a 
-      = this->GetCurrTargetPhrase().GetAlignTerm().GetSortedAlignments();
+    vector<pair<size_t,size_t> > a;
+    this->GetCurrTargetPhrase().GetAlignTerm()
+      .AppendSortedAlignments(a, src.GetStartPos(), trg.GetStartPos());
     typedef pair<size_t,size_t> item;
     map<string, xmlrpc_c::value> M;
-    BOOST_FOREACH(item const* p, a)
+    BOOST_FOREACH(item const& p, a)
       {
-	M["source-word"] = xmlrpc_c::value_int(src.GetStartPos() + p->first);
-	M["target-word"] = xmlrpc_c::value_int(trg.GetStartPos() + p->second);
+	M["source-word"] = xmlrpc_c::value_int(p.first);
+	M["target-word"] = xmlrpc_c::value_int(p.second);
 	dest.push_back(xmlrpc_c::value_struct(M));
       }
   }
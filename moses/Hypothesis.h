@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/scoped_ptr.hpp>
 
 #include <vector>
+#include <stdint.h>
 #include "Phrase.h"
 #include "TypeDef.h"
 #include "WordsBitmap.h"
@@ -38,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "moses/FF/DistortionState.h"
 
 #ifdef HAVE_XMLRPC_C
 #include <xmlrpc-c/base.hpp>
@@ -71,8 +73,6 @@ class Hypothesis
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 
 protected:
-  static ObjectPool<Hypothesis> s_objectPool;
-
   const Hypothesis* m_prevHypo; /*! backpointer to previous hypothesis (from which this one was created) */
 //	const Phrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
   WordsBitmap				m_sourceCompleted; /*! keeps track of which words have been translated so far */
@@ -81,13 +81,20 @@ protected:
   InputType const&  m_sourceInput;
   WordsRange				m_currSourceWordsRange; /*! source word positions of the last phrase that was used to create this hypothesis */
   WordsRange        m_currTargetWordsRange; /*! target word positions of the last phrase that was used to create this hypothesis */
+  DistortionState   m_distortionState; /*! the feature state of DistortionScoreProducer, kept here instead of allocated */
   bool							m_wordDeleted;
   float							m_totalScore;  /*! score so far */
   float							m_futureScore; /*! estimated future cost to translate rest of sentence */
   /*! sum of scores of this hypothesis, and previous hypotheses. Lazily initialised.  */
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
-  ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
+  mutable ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
+  mutable bool m_currScoreBreakdownReleased; /*! true if m_currScoreBreakdown was dropped after scoring (lazy-score-breakdown) */
   std::vector<const FFState*> m_ffStates;
+  /*! recombination keys of the features that provide them, filled on the first comparison */
+  static const size_t MAX_STATE_KEY_SIZE = 16;
+  mutable uint32_t m_stateKey[MAX_STATE_KEY_SIZE];
+  mutable bool m_stateKeyFilled;
+  mutable size_t m_recombinationHash; /*! 0 until computed */
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption &m_transOpt;
@@ -95,18 +102,55 @@ protected:
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
+  //! which stateful features are compared through m_stateKey, with their key sizes
+  static std::vector<std::pair<size_t, size_t> > s_keyedStates;
+  //! the others, compared through FFState::Compare
+  static std::vector<size_t> s_comparedStates;
+  static size_t s_stateKeySize;
+  static bool s_recombinationHashed;
+
+  void FillStateKey() const;
+  //! delete a feature state unless it is m_distortionState
+  void DeleteFFState(const FFState *state) const {
+    if (state != &m_distortionState) delete state;
+  }
+
+  //! drop the feature scores once the total is known, if lazy-score-breakdown is on
+  void ReleaseScoreBreakdown();
+  //! recompute m_currScoreBreakdown by evaluating the features again
+  void ReplayScoreBreakdown() const;
+
+  //! true if the arc lists must be kept whole (distinct n-best, lattices, search graphs)
+  static bool KeepAllArcs();
+  //! free all but the nBestSize best arcs
+  void PruneArcList(size_t nBestSize);
+  //! free the feature states of a recombined hypothesis, which is never extended
+  void ReleaseFFStates();
+
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt);
   /*! used when creating a new hypothesis using a translation option (phrase translation) */
   Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt);
 
 public:
-  static ObjectPool<Hypothesis> &GetObjectPool() {
-    return s_objectPool;
-  }
-
   ~Hypothesis();
 
+  /** return a hypothesis to the pool of the manager that created it */
+  static void Free(Hypothesis *hypo);
+
+  /** decide which stateful features keep recombination keys inline,
+   *  see StatefulFeatureFunction::GetStateKeySize(). Called once all
+   *  feature functions are loaded; until then every state is compared
+   *  through FFState::Compare. */
+  static void InitStateKeyLayout();
+
+  /** whether GetRecombinationHash() tells hypotheses apart well enough for
+   *  hashed stacks: every stateful feature has a state key or a state hash
+   *  (StatefulFeatureFunction::HasStateHash()) */
+  static bool IsRecombinationHashed() {
+    return s_recombinationHashed;
+  }
+
   /** return the subclass of Hypothesis most appropriate to the given translation option */
   static Hypothesis* Create(const Hypothesis &prevHypo, const TranslationOption &transOpt);
 
@@ -146,7 +190,14 @@ public:
     return m_currTargetWordsRange.GetNumWordsCovered();
   }
 
+  //! evaluate all feature functions, then the future and total score
   void EvaluateWhenApplied(const SquareMatrix &futureScore);
+  //! evaluate the feature functions that are not cached in the translation option
+  void EvaluateFeatureFunctions();
+  /** future and total scores of hypotheses whose feature functions have
+   *  been evaluated, with the weighted scores of the whole batch taken in
+   *  one pass (ScoreComponentCollection::GetWeightedScores) */
+  static void CalcTotalScores(const std::vector<Hypothesis*> &hypos, const SquareMatrix &futureScore);
 
   int GetId()const {
     return m_id;
@@ -199,6 +250,9 @@ public:
 
   int RecombineCompare(const Hypothesis &compare) const;
 
+  //! equal for hypotheses that RecombineCompare() finds equal, computed once
+  size_t GetRecombinationHash() const;
+
   void GetOutputPhrase(Phrase &out) const;
 
   void ToStream(std::ostream& out) const {
@@ -236,10 +290,17 @@ public:
   inline const ArcList* GetArcList() const {
     return m_arcList;
   }
+  //! scores of this hypothesis only, excluding the previous hypotheses
+  const ScoreComponentCollection& GetCurrScoreBreakdown() const {
+    if (m_currScoreBreakdownReleased) {
+      ReplayScoreBreakdown();
+    }
+    return m_currScoreBreakdown;
+  }
   const ScoreComponentCollection& GetScoreBreakdown() const {
     if (!m_scoreBreakdown.get()) {
       m_scoreBreakdown.reset(new ScoreComponentCollection());
-      m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
+      m_scoreBreakdown->PlusEquals(GetCurrScoreBreakdown());
       if (m_prevHypo) {
         m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
       }
@@ -255,13 +316,21 @@ public:
   const FFState* GetFFState(int idx) const {
     return m_ffStates[idx];
   }
+  const DistortionState &GetDistortionState() const {
+    return m_distortionState;
+  }
   void SetFFState(int idx, FFState* state) {
     m_ffStates[idx] = state;
+    m_stateKeyFilled = false;
+    m_recombinationHash = 0;
   }
 
   // Added by oliver.wilson@ed.ac.uk for async lm stuff.
   void EvaluateWhenApplied(const StatefulFeatureFunction &sfff, int state_idx);
   void EvaluateWhenApplied(const StatelessFeatureFunction &slff);
+  //! evaluate one stateful feature on a batch of hypotheses through its batch interface
+  static void EvaluateWhenAppliedBatch(const StatefulFeatureFunction &sfff, int state_idx,
+                                       const std::vector<Hypothesis*> &hypos);
 
   //! target span that trans opt would populate if applied to this hypo. Used for alignment check
   size_t GetNextStartPos(const TranslationOption &transOpt) const;
@@ -277,6 +346,9 @@ public:
   void OutputAlignment(std::ostream &out) const;
   static void OutputAlignment(std::ostream &out, const std::vector<const Hypothesis *> &edges);
   static void OutputAlignment(std::ostream &out, const Moses::AlignmentInfo &ai, size_t sourceOffset, size_t targetOffset);
+  static void OutputAlignment(std::ostream &out, const std::vector<std::pair<size_t,size_t> > &alignment);
+  //! append the word alignment of the translation up to this hypothesis to alignment
+  void GetWordAlignment(std::vector<std::pair<size_t,size_t> > &alignment) const;
 
   void OutputInput(std::ostream& os) const;
   static void OutputInput(std::vector<const Phrase*>& map, const Hypothesis* hypo);
@@ -306,17 +378,7 @@ struct CompareHypothesisTotalScore {
   }
 };
 
-#ifdef USE_HYPO_POOL
-
-#define FREEHYPO(hypo) \
-{ \
-	ObjectPool<Hypothesis> &pool = Hypothesis::GetObjectPool(); \
-	pool.freeObject(hypo); \
-} \
- 
-#else
-#define FREEHYPO(hypo) delete hypo
-#endif
+#define FREEHYPO(hypo) Hypothesis::Free(hypo)
 
 /** defines less-than relation on hypotheses.
 * The particular order is not important for us, we need just to figure out
@@ -335,5 +397,23 @@ public:
   }
 };
 
+//! hash and equality of hypotheses that can be recombined, for hashed stacks
+class HypothesisRecombinationHasher
+{
+public:
+  size_t operator()(const Hypothesis* hypo) const {
+    return hypo->GetRecombinationHash();
+  }
+};
+
+class HypothesisRecombinationEquals
+{
+public:
+  bool operator()(const Hypothesis* hypoA, const Hypothesis* hypoB) const {
+    return hypoA->GetRecombinationHash() == hypoB->GetRecombinationHash()
+           && hypoA->RecombineCompare(*hypoB) == 0;
+  }
+};
+
 }
 #endif
@@ -1,8 +1,11 @@
 #ifndef moses_HypothesisStack_h
 #define moses_HypothesisStack_h
 
-#include <vector>
+#include <cstddef>
+#include <iterator>
 #include <set>
+#include <vector>
+#include <boost/unordered_set.hpp>
 #include "Hypothesis.h"
 #include "WordsBitmap.h"
 
@@ -11,6 +14,101 @@ namespace Moses
 
 class Manager;
 
+/** The hypotheses of a stack, unique up to recombination. Hashed if the
+ *  hypotheses hash well (Hypothesis::IsRecombinationHashed()), so that an
+ *  insertion costs one hash and, on a match, one RecombineCompare; ordered
+ *  otherwise, as with states that all hash to 0 every insertion would
+ *  compare against all hypotheses of the same coverage.
+ */
+class HypothesisRecombinationSet
+{
+  typedef std::set<Hypothesis*, HypothesisRecombinationOrderer> Ordered;
+  typedef boost::unordered_set<Hypothesis*, HypothesisRecombinationHasher, HypothesisRecombinationEquals> Hashed;
+
+public:
+  //! both kinds of sets only give constant access to their elements
+  class iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Hypothesis *value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Hypothesis *const *pointer;
+    typedef Hypothesis *const &reference;
+
+    iterator() : m_hashed(false), m_ordered(), m_hash() {}
+
+    reference operator*() const {
+      return m_hashed ? *m_hash : *m_ordered;
+    }
+    pointer operator->() const {
+      return &**this;
+    }
+    iterator &operator++() {
+      if (m_hashed) ++m_hash;
+      else ++m_ordered;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator ret(*this);
+      ++*this;
+      return ret;
+    }
+    bool operator==(const iterator &other) const {
+      return m_hashed ? m_hash == other.m_hash : m_ordered == other.m_ordered;
+    }
+    bool operator!=(const iterator &other) const {
+      return !(*this == other);
+    }
+
+  private:
+    friend class HypothesisRecombinationSet;
+    explicit iterator(Ordered::const_iterator it) : m_hashed(false), m_ordered(it), m_hash() {}
+    explicit iterator(Hashed::const_iterator it) : m_hashed(true), m_ordered(), m_hash(it) {}
+
+    bool m_hashed;
+    Ordered::const_iterator m_ordered;
+    Hashed::const_iterator m_hash;
+  };
+  typedef iterator const_iterator;
+
+  HypothesisRecombinationSet() : m_hashed(Hypothesis::IsRecombinationHashed()) {}
+
+  iterator begin() const {
+    return m_hashed ? iterator(m_hash.begin()) : iterator(m_ordered.begin());
+  }
+  iterator end() const {
+    return m_hashed ? iterator(m_hash.end()) : iterator(m_ordered.end());
+  }
+  size_t size() const {
+    return m_hashed ? m_hash.size() : m_ordered.size();
+  }
+  bool empty() const {
+    return size() == 0;
+  }
+
+  std::pair<iterator, bool> insert(Hypothesis *hypo) {
+    if (m_hashed) {
+      std::pair<Hashed::iterator, bool> ret = m_hash.insert(hypo);
+      return std::make_pair(iterator(Hashed::const_iterator(ret.first)), ret.second);
+    }
+    std::pair<Ordered::iterator, bool> ret = m_ordered.insert(hypo);
+    return std::make_pair(iterator(Ordered::const_iterator(ret.first)), ret.second);
+  }
+  iterator find(Hypothesis *hypo) const {
+    return m_hashed ? iterator(m_hash.find(hypo)) : iterator(m_ordered.find(hypo));
+  }
+  void erase(const iterator &iter) {
+    if (m_hashed) m_hash.erase(iter.m_hash);
+    else m_ordered.erase(iter.m_ordered);
+  }
+
+private:
+  bool m_hashed;
+  Ordered m_ordered;
+  Hashed m_hash;
+};
+
 /** abstract unique set of hypotheses that cover a certain number of words,
  *  ie. a stack in phrase-based decoding
  */
@@ -18,7 +116,7 @@ class HypothesisStack
 {
 
 protected:
-  typedef std::set< Hypothesis*, HypothesisRecombinationOrderer > _HCType;
+  typedef HypothesisRecombinationSet _HCType;
   _HCType m_hypos; /**< contains hypotheses */
   Manager& m_manager;
 
@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
+#include <functional>
 #include <set>
 #include <queue>
 #include "HypothesisStackNormal.h"
@@ -49,7 +50,25 @@ void HypothesisStackNormal::RemoveAll()
   }
 }
 
-pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesis *hypo)
+void HypothesisStackNormal::UpdateWorstScore(float score)
+{
+  if (m_maxHypoStackSize == 0) return;
+
+  if (m_topScores.size() < m_maxHypoStackSize) {
+    m_topScores.push_back(score);
+    std::push_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+  } else if (score > m_topScores.front()) {
+    std::pop_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+    m_topScores.back() = score;
+    std::push_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+  }
+
+  // anything below the stack-size-th best score would be pruned anyway
+  if (m_topScores.size() == m_maxHypoStackSize && m_topScores.front() > m_worstScore)
+    m_worstScore = m_topScores.front();
+}
+
+pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesis *hypo, bool newScore)
 {
   std::pair<iterator, bool> ret = m_hypos.insert(hypo);
   if (ret.second) {
@@ -70,6 +89,11 @@ pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesi
       SetWorstScoreForBitmap( hypo->GetWordsBitmap().GetID(), hypo->GetTotalScore() );
     }
 
+    // a replacement for a recombined hypothesis must not be counted twice,
+    // or the threshold would overtake the real stack-size-th best score
+    if (newScore)
+      UpdateWorstScore(hypo->GetTotalScore());
+
     VERBOSE(3,", now size " << m_hypos.size());
 
     // prune only if stack is twice as big as needed (lazy pruning)
@@ -133,7 +157,7 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
       Remove(iterExisting);
     }
 
-    bool added = Add(hypo).second;
+    bool added = Add(hypo, false).second;
     if (!added) {
       iterExisting = m_hypos.find(hypo);
       UTIL_THROW2("Offending hypo = " << **iterExisting);
@@ -156,10 +180,17 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   if ( newSize == 0) return; // no limit
   if ( size() <= newSize ) return; // ok, if not over the limit
 
-  // we need to store a temporary list of hypotheses
-  vector< Hypothesis* > hypos = GetSortedListNOTCONST();
-  bool* included = (bool*) malloc(sizeof(bool) * hypos.size());
-  for(size_t i=0; i<hypos.size(); i++) included[i] = false;
+  // we need to store a temporary list of hypotheses. Stack diversity needs
+  // them all in order, otherwise selecting the best newSize is enough.
+  vector< Hypothesis* > hypos;
+  if ( m_minHypoStackDiversity > 0 ) {
+    hypos = GetSortedListNOTCONST();
+  } else {
+    hypos.assign(m_hypos.begin(), m_hypos.end());
+    std::nth_element(hypos.begin(), hypos.begin() + newSize - 1, hypos.end(), CompareHypothesisTotalScore());
+    std::sort(hypos.begin(), hypos.begin() + newSize, CompareHypothesisTotalScore());
+  }
+  std::vector<bool> included(hypos.size(), false);
 
   // clear out original set
   for( iterator iter = m_hypos.begin(); iter != m_hypos.end(); ) {
@@ -209,7 +240,12 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
       m_manager.GetSentenceStats().AddPruning();
     }
   }
-  free(included);
+
+  // restart the incremental threshold from what survived
+  m_topScores.clear();
+  for(iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    UpdateWorstScore((*iter)->GetTotalScore());
+  }
 
   // some reporting....
   VERBOSE(3,", pruned to size " << size() << endl);
@@ -47,11 +47,16 @@ protected:
   size_t m_maxHypoStackSize; /**< maximum number of hypothesis allowed in this stack */
   size_t m_minHypoStackDiversity; /**< minimum number of hypothesis with different source word coverage */
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
+  std::vector<float> m_topScores; /**< min-heap of the best m_maxHypoStackSize scores added since the last pruning */
 
   /** add hypothesis to stack. Prune if necessary.
    * Returns false if equiv hypo exists in collection, otherwise returns true
+   * \param newScore false if hypothesis replaces a recombined one, whose score is already counted
    */
-  std::pair<HypothesisStackNormal::iterator, bool> Add(Hypothesis *hypothesis);
+  std::pair<HypothesisStackNormal::iterator, bool> Add(Hypothesis *hypothesis, bool newScore = true);
+
+  /** keep m_worstScore at the score of the m_maxHypoStackSize-th best hypothesis */
+  void UpdateWorstScore(float score);
 
   /** destroy all instances of Hypothesis in this collection */
   void RemoveAll();
@@ -61,6 +61,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
 
 #include "IOWrapper.h"
 
@@ -101,7 +103,8 @@ IOWrapper::IOWrapper()
     m_inputStream = &cin;
   } else {
     VERBOSE(2,"IO from File" << endl);
-    m_inputFile = new InputFileStream(m_inputFilePath);
+    // read and decompressed ahead on a background thread
+    m_inputFile = new util::LineBatchStream(util::OpenReadOrThrow(m_inputFilePath.c_str()));
     m_inputStream = m_inputFile;
   }
 
@@ -200,6 +203,7 @@ IOWrapper::IOWrapper()
 
   if (!m_surpressSingleBestOutput) {
     m_singleBestOutputCollector.reset(new Moses::OutputCollector(&std::cout));
+    m_singleBestOutputCollector->SetTextProcessing(&staticData.GetOutputProcessing());
   }
 
   if (staticData.GetParameter().GetParam("spe-src")) {
@@ -264,6 +268,28 @@ IOWrapper::ReadInput()
   default:
     TRACE_ERR("Unknown input type: " << m_inputType << "\n");
   }
+
+  const TextProcessorChain &inputProcessing = StaticData::Instance().GetInputProcessing();
+  if (m_inputType == SentenceInput && !inputProcessing.Empty()) {
+    // only the reading is serialised; the line is processed outside the lock
+    string line;
+    long translationId;
+    {
+#ifdef WITH_THREADS
+      boost::lock_guard<boost::mutex> lock(m_lock);
+#endif
+      if (getline(*m_inputStream, line, '\n').eof()) {
+        return boost::shared_ptr<InputType>();
+      }
+      translationId = m_currentLine++;
+    }
+    inputProcessing.Process(line);
+    istringstream in(line + "\n");
+    source->Read(in, *m_inputFactorOrder);
+    source->SetTranslationId(translationId);
+    return source;
+  }
+
 #ifdef WITH_THREADS
   boost::lock_guard<boost::mutex> lock(m_lock);
 #endif
@@ -80,7 +80,7 @@ class IOWrapper
 protected:
   const std::vector<Moses::FactorType>	*m_inputFactorOrder;
   std::string m_inputFilePath;
-  Moses::InputFileStream *m_inputFile;
+  std::istream *m_inputFile;
   std::istream *m_inputStream;
   std::ostream *m_nBestStream;
   std::ostream *m_outputWordGraphStream;
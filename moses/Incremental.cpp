@@ -4,6 +4,7 @@
 
 #include "moses/ChartCell.h"
 #include "moses/ChartParserCallback.h"
+#include "moses/DecodeProfile.h"
 #include "moses/FeatureVector.h"
 #include "moses/StaticData.h"
 #include "moses/Util.h"
@@ -72,13 +73,25 @@ private:
   boost::object_pool<Gen> generator_pool_;
 };
 
+// Features that score a rule in its source context, eg. soft source syntactic
+// constraints, and where the rescored copies of the target phrases live until
+// the sentence has been output.
+struct SourceContext {
+  SourceContext(const InputType &in, std::deque<TargetPhrase> &store)
+    : input(in), phrases(store) {}
+
+  const InputType &input;
+  std::vector<const FeatureFunction*> features;
+  std::deque<TargetPhrase> &phrases;
+};
+
 // This is called by the moses parser to collect hypotheses.  It converts to my
 // edges (search::PartialEdge).
 template <class Model> class Fill : public ChartParserCallback
 {
 public:
-  Fill(search::Context<Model> &context, const std::vector<lm::WordIndex> &vocab_mapping, search::Score oov_weight)
-    : context_(context), vocab_mapping_(vocab_mapping), oov_weight_(oov_weight) {}
+  Fill(search::Context<Model> &context, const std::vector<lm::WordIndex> &vocab_mapping, search::Score oov_weight, SourceContext &source_context, const InputPath &input_path)
+    : context_(context), vocab_mapping_(vocab_mapping), oov_weight_(oov_weight), source_context_(source_context), input_path_(input_path) {}
 
   void Add(const TargetPhraseCollection &targets, const StackVec &nts, const WordsRange &ignored);
 
@@ -109,6 +122,9 @@ public:
 private:
   lm::WordIndex Convert(const Word &word) const;
 
+  // Copy of phrase with the scores of the source context features.
+  const TargetPhrase &Rescore(const TargetPhrase &phrase, const StackVec &nts);
+
   search::Context<Model> &context_;
 
   const std::vector<lm::WordIndex> &vocab_mapping_;
@@ -116,6 +132,10 @@ private:
   search::EdgeGenerator edges_;
 
   const search::Score oov_weight_;
+
+  SourceContext &source_context_;
+
+  const InputPath &input_path_;
 };
 
 template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targets, const StackVec &nts, const WordsRange &range)
@@ -131,7 +151,8 @@ template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targe
   std::vector<lm::WordIndex> words;
   for (TargetPhraseCollection::const_iterator p(targets.begin()); p != targets.end(); ++p) {
     words.clear();
-    const TargetPhrase &phrase = **p;
+    const TargetPhrase &phrase = source_context_.features.empty() ? **p : Rescore(**p, nts);
+    if (phrase.GetFutureScore() == -std::numeric_limits<float>::infinity()) continue;
     const AlignmentInfo::NonTermIndexMap &align = phrase.GetAlignNonTerm().GetNonTermIndexMap();
     search::PartialEdge edge(edges_.AllocateEdge(nts.size()));
 
@@ -159,8 +180,9 @@ template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targe
   }
 }
 
-template <class Model> void Fill<Model>::AddPhraseOOV(TargetPhrase &phrase, std::list<TargetPhraseCollection*> &, const WordsRange &range)
+template <class Model> void Fill<Model>::AddPhraseOOV(TargetPhrase &oov, std::list<TargetPhraseCollection*> &, const WordsRange &range)
 {
+  const TargetPhrase &phrase = source_context_.features.empty() ? oov : Rescore(oov, StackVec());
   std::vector<lm::WordIndex> words;
   UTIL_THROW_IF2(phrase.GetSize() > 1,
                  "OOV target phrase should be 0 or 1 word in length");
@@ -188,6 +210,20 @@ template <class Model> float Fill<Model>::GetBestScore(const ChartCellLabel *cha
   return vertex.Bound();
 }
 
+template <class Model> const TargetPhrase &Fill<Model>::Rescore(const TargetPhrase &phrase, const StackVec &nts)
+{
+  source_context_.phrases.push_back(phrase);
+  TargetPhrase &rescored = source_context_.phrases.back();
+  ScoreComponentCollection futureScores;
+  for (size_t i = 0; i < source_context_.features.size(); ++i) {
+    const FeatureFunction &ff = *source_context_.features[i];
+    DecodeProfile::Scope scope(ff, DecodeProfile::WithSourceContext);
+    ff.EvaluateWithSourceContext(source_context_.input, input_path_, rescored, &nts, rescored.GetScoreBreakdown(), &futureScores);
+  }
+  rescored.UpdateScore(&futureScores);
+  return rescored;
+}
+
 // TODO: factors (but chart doesn't seem to support factors anyway).
 template <class Model> lm::WordIndex Fill<Model>::Convert(const Word &word) const
 {
@@ -224,6 +260,14 @@ template <class Model, class Best> search::History Manager::PopulateBest(const M
   size_t size = m_source.GetSize();
   boost::object_pool<search::Vertex> vertex_pool(std::max<size_t>(size * size / 2, 32));
 
+  contextual_phrases_.clear();
+  SourceContext source_context(m_source, contextual_phrases_);
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    if (ffs[i]->DependsOnSourceContext() && !data.IsFeatureFunctionIgnored(*ffs[i]))
+      source_context.features.push_back(ffs[i]);
+  }
+
   for (int startPos = size-1; startPos >= 0; --startPos) {
     for (size_t width = 1; width <= size-startPos; ++width) {
       // full range uses RootSearch
@@ -231,14 +275,16 @@ template <class Model, class Best> search::History Manager::PopulateBest(const M
         break;
       }
       WordsRange range(startPos, startPos + width - 1);
-      Fill<Model> filler(context, words, oov_weight);
+      context.SetPopLimit(TightenLimit(data.GetCubePruningPopLimit()));
+      Fill<Model> filler(context, words, oov_weight, source_context, parser_.GetInputPath(range));
       parser_.Create(range, filler);
       filler.Search(out, cells_.MutableBase(range).MutableTargetLabelSet(), vertex_pool);
     }
   }
 
   WordsRange range(0, size - 1);
-  Fill<Model> filler(context, words, oov_weight);
+  context.SetPopLimit(TightenLimit(data.GetCubePruningPopLimit()));
+  Fill<Model> filler(context, words, oov_weight, source_context, parser_.GetInputPath(range));
   parser_.Create(range, filler);
   return filler.RootSearch(out);
 }
@@ -6,9 +6,11 @@
 
 #include "moses/ChartCellCollection.h"
 #include "moses/ChartParser.h"
+#include "moses/TargetPhrase.h"
 
 #include "BaseManager.h"
 
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -75,6 +77,9 @@ private:
 
   const std::vector<search::Applied> *completed_nbest_;
 
+  // target phrases rescored by source context features, see Fill::Rescore
+  std::deque<TargetPhrase> contextual_phrases_;
+
   // outputs
   void OutputDetailedTranslationReport(
     OutputCollector *collector,
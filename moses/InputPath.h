@@ -7,6 +7,7 @@
 #include "WordsRange.h"
 #include "NonTerminal.h"
 #include "moses/FactorCollection.h"
+#include "moses/SentenceArena.h"
 
 namespace Moses
 {
@@ -50,6 +51,14 @@ protected:
 
 
 public:
+  // from the sentence's arena, see SentenceArena
+  static void *operator new(std::size_t size) {
+    return SentenceArena::Allocate(size);
+  }
+  static void operator delete(void *ptr) {
+    SentenceArena::Free(ptr);
+  }
+
   explicit InputPath()
     : m_prevPath(NULL)
     , m_range(NOT_FOUND, NOT_FOUND)
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_InputType_h
 
 #include <string>
+#include <boost/shared_ptr.hpp>
 #include "TypeDef.h"
 #include "Phrase.h"
 #include "TargetPhraseCollection.h"
@@ -39,6 +40,8 @@ class PhraseDictionary;
 class TranslationOptionCollection;
 class ChartTranslationOptions;
 class TranslationTask;
+class ContextScope;
+class ScoreComponentCollection;
 /** base class for all types of inputs to the decoder,
  *  eg. sentences, confusion networks, lattices and tree
  */
@@ -58,6 +61,8 @@ protected:
   ReorderingConstraint m_reorderingConstraint; /**< limits on reordering specified either by "-mp" switch or xml tags */
   std::string m_textType;
   std::string m_passthrough;
+  boost::shared_ptr<ContextScope> m_scope; //< document or session of the input
+  boost::shared_ptr<const ScoreComponentCollection> m_requestWeights; //< own weights of the input
 
 public:
 
@@ -84,6 +89,13 @@ public:
   void SetDocumentId(long documentId) {
     m_documentId = documentId;
   }
+  //! NULL if the input was not given a scope
+  const boost::shared_ptr<ContextScope> &GetScope() const {
+    return m_scope;
+  }
+  void SetScope(const boost::shared_ptr<ContextScope> &scope) {
+    m_scope = scope;
+  }
   long GetTopicId() const {
     return m_topicId;
   }
@@ -123,6 +135,13 @@ public:
   std::string GetWeightSetting() const {
     return m_weightSetting;
   }
+  //! NULL unless the input is decoded with its own weights (see StaticData::CreateRequestWeights)
+  const boost::shared_ptr<const ScoreComponentCollection> &GetRequestWeights() const {
+    return m_requestWeights;
+  }
+  void SetRequestWeights(const boost::shared_ptr<const ScoreComponentCollection> &weights) {
+    m_requestWeights = weights;
+  }
   void SetTextType(std::string type) {
     m_textType = type;
   }
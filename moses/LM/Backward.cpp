@@ -40,7 +40,7 @@ namespace Moses
 {
 
 /** Constructs a new backward language model. */
-template <class Model> BackwardLanguageModel<Model>::BackwardLanguageModel(const std::string &line, const std::string &file, FactorType factorType, bool lazy) : LanguageModelKen<Model>(line,file,factorType,lazy)
+template <class Model> BackwardLanguageModel<Model>::BackwardLanguageModel(const std::string &line, const std::string &file, FactorType factorType, bool lazy) : LanguageModelKen<Model>(line,file,factorType,lazy ? util::LAZY : util::POPULATE_OR_READ)
 {
   //
   // This space intentionally left blank
@@ -61,9 +61,10 @@ template <class Model> BackwardLanguageModel<Model>::BackwardLanguageModel(const
  */
 template <class Model> const FFState *BackwardLanguageModel<Model>::EmptyHypothesisState(const InputType &/*input*/) const
 {
+  typename LanguageModelKen<Model>::ScopedPin pin(*this);
   BackwardLMState *ret = new BackwardLMState();
-  lm::ngram::RuleScore<Model> ruleScore(*m_ngram, ret->state);
-  ruleScore.Terminal(m_ngram->GetVocabulary().EndSentence());
+  lm::ngram::RuleScore<Model> ruleScore(this->GetModel(), ret->state);
+  ruleScore.Terminal(this->GetModel().GetVocabulary().EndSentence());
   //    float score =
   ruleScore.Finish();
   //    VERBOSE(1, "BackwardLM EmptyHypothesisState has score " << score);
@@ -73,7 +74,7 @@ template <class Model> const FFState *BackwardLanguageModel<Model>::EmptyHypothe
 template <class Model> double BackwardLanguageModel<Model>::Score(FFState *ffState) {
   BackwardLMState *lmState = static_cast< BackwardLMState* >(ffState);
   lm::ngram::ChartState &state = lmState->state;
-  lm::ngram::RuleScore<Model> ruleScore(*m_ngram, lmState);
+  lm::ngram::RuleScore<Model> ruleScore(this->GetModel(), lmState);
   return ruleScore.Finish();
 }
 */
@@ -121,6 +122,7 @@ template <class Model> double BackwardLanguageModel<Model>::Score(FFState *ffSta
  */
 template <class Model> void BackwardLanguageModel<Model>::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
 {
+  typename LanguageModelKen<Model>::ScopedPin pin(*this);
   fullScore = 0;
   ngramScore = 0;
   oovCount = 0;
@@ -128,7 +130,7 @@ template <class Model> void BackwardLanguageModel<Model>::CalcScore(const Phrase
   if (!phrase.GetSize()) return;
 
   lm::ngram::ChartState discarded_sadly;
-  lm::ngram::RuleScore<Model> scorer(*m_ngram, discarded_sadly);
+  lm::ngram::RuleScore<Model> scorer(this->GetModel(), discarded_sadly);
 
   UTIL_THROW_IF2(m_beginSentenceFactor == phrase.GetWord(0).GetFactor(m_factorType),
                  "BackwardLanguageModel does not currently support rules that include <s>"
@@ -137,7 +139,7 @@ template <class Model> void BackwardLanguageModel<Model>::CalcScore(const Phrase
   float before_boundary = 0.0f;
 
   int lastWord = phrase.GetSize() - 1;
-  int ngramBoundary = m_ngram->Order() - 1;
+  int ngramBoundary = this->GetModel().Order() - 1;
   int boundary = ( lastWord < ngramBoundary ) ? 0 : ngramBoundary;
 
   int position;
@@ -217,6 +219,7 @@ template <class Model> void BackwardLanguageModel<Model>::CalcScore(const Phrase
  */
 template <class Model> FFState *BackwardLanguageModel<Model>::Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
 {
+  typename LanguageModelKen<Model>::ScopedPin pin(*this);
 
   // If the current hypothesis contains zero target words
   if (!hypo.GetCurrTargetLength()) {
@@ -242,6 +245,7 @@ template <class Model> FFState *BackwardLanguageModel<Model>::Evaluate(const Hyp
 
 template <class Model> FFState *BackwardLanguageModel<Model>::Evaluate(const Phrase &phrase, const FFState *ps, float &returnedScore) const
 {
+  typename LanguageModelKen<Model>::ScopedPin pin(*this);
 
   returnedScore = 0.0f;
 
@@ -249,9 +253,9 @@ template <class Model> FFState *BackwardLanguageModel<Model>::Evaluate(const Phr
 
   std::auto_ptr<BackwardLMState> ret(new BackwardLMState());
 
-  lm::ngram::RuleScore<Model> scorer(*m_ngram, ret->state);
+  lm::ngram::RuleScore<Model> scorer(this->GetModel(), ret->state);
 
-  int ngramBoundary = m_ngram->Order() - 1;
+  int ngramBoundary = this->GetModel().Order() - 1;
   int lastWord = phrase.GetSize() - 1;
 
   // Get scores for words at the end of the previous phrase
@@ -49,6 +49,11 @@ public:
 
   virtual const FFState *EmptyHypothesisState(const InputType &/*input*/) const;
 
+  //! the empty hypothesis has a BackwardLMState, compare through FFState
+  virtual size_t GetStateKeySize() const {
+    return 0;
+  }
+
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
   virtual FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
@@ -58,7 +63,7 @@ public:
 private:
 
   // These lines are required to make the parent class's protected members visible to this class
-  using LanguageModelKen<Model>::m_ngram;
+  using LanguageModelKen<Model>::GetModel;
   using LanguageModelKen<Model>::m_beginSentenceFactor;
   using LanguageModelKen<Model>::m_factorType;
   using LanguageModelKen<Model>::TranslateID;
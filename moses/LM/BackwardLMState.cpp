@@ -31,4 +31,9 @@ int BackwardLMState::Compare(const FFState &o) const
   return state.left.Compare(other.state.left);
 }
 
+std::size_t BackwardLMState::hash() const
+{
+  return lm::ngram::hash_value(state.left);
+}
+
 }
@@ -55,6 +55,9 @@ public:
   */
   int Compare(const FFState &o) const;
 
+  //! of the left state, which is all that Compare() looks at
+  std::size_t hash() const;
+
   // Allow BackwardLanguageModel to access the private members of this class
   template <class Model> friend class BackwardLanguageModel;
 
@@ -79,6 +79,13 @@ void LanguageModel::EvaluateInIsolation(const Phrase &source
   size_t oovCount;
 
   CalcScore(targetPhrase, fullScore, nGramScore, oovCount);
+  AssignScores(fullScore, nGramScore, oovCount, scoreBreakdown, estimatedFutureScore);
+}
+
+void LanguageModel::AssignScores(float fullScore, float nGramScore, size_t oovCount
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection &estimatedFutureScore) const
+{
   float estimateScore = fullScore - nGramScore;
 
   if (StaticData::Instance().GetLMEnableOOVFeature()) {
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <cstddef>
+#include <vector>
 
 #include "moses/FF/StatefulFeatureFunction.h"
 
@@ -49,6 +50,11 @@ protected:
 
   bool m_enableOOVFeature;
 
+  //! fill the LM (and optional OOV) scores from the results of CalcScore()
+  void AssignScores(float fullScore, float nGramScore, std::size_t oovCount
+                    , ScoreComponentCollection &scoreBreakdown
+                    , ScoreComponentCollection &estimatedFutureScore) const;
+
 public:
   static const LanguageModel &GetFirstLM();
 
@@ -75,6 +81,12 @@ public:
   virtual void CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, std::size_t &oovCount) const {
   }
 
+  /* score several phrases in one go so that later CalcScoreFromCache() calls
+   * for them are answered from the cache. Default does nothing.
+   */
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases) const {
+  }
+
   virtual void IssueRequestsFor(Hypothesis& hypo,
                                 const FFState* input_state) {
   }
@@ -0,0 +1,437 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "lm/binary_format.hh"
+#include "lm/enumerate_vocab.hh"
+#include "lm/left.hh"
+#include "lm/model.hh"
+#include "util/exception.hh"
+#include "util/tokenize_piece.hh"
+
+#include "FusedKen.h"
+#include "moses/FF/FFState.h"
+#include "moses/FactorCollection.h"
+#include "moses/Hypothesis.h"
+#include "moses/Phrase.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+struct FusedKenLMState : public FFState {
+  lm::ngram::State states[kMaxFusedModels];
+  size_t numModels;
+
+  int Compare(const FFState &o) const {
+    const FusedKenLMState &other = static_cast<const FusedKenLMState &>(o);
+    for (size_t m = 0; m < numModels; ++m) {
+      const lm::ngram::State &a = states[m], &b = other.states[m];
+      if (a.length < b.length) return -1;
+      if (a.length > b.length) return 1;
+      int ret = std::memcmp(a.words, b.words, sizeof(lm::WordIndex) * a.length);
+      if (ret) return ret;
+    }
+    return 0;
+  }
+
+  size_t hash() const {
+    uint64_t seed = 0;
+    for (size_t m = 0; m < numModels; ++m) {
+      seed = lm::ngram::hash_value(states[m], seed + states[m].length);
+    }
+    return seed;
+  }
+};
+
+// fills column model of the fused lookup table
+class FusedMappingBuilder : public lm::EnumerateVocab
+{
+public:
+  FusedMappingBuilder(std::vector<lm::WordIndex> &mapping, size_t model, size_t numModels)
+    : m_mapping(mapping), m_model(model), m_numModels(numModels) {}
+
+  void Add(lm::WordIndex index, const StringPiece &str) {
+    std::size_t factorId = FactorCollection::Instance().AddFactor(str)->GetId();
+    if (m_mapping.size() <= (factorId + 1) * m_numModels) {
+      // 0 is <unk>
+      m_mapping.resize((factorId + 1) * m_numModels);
+    }
+    m_mapping[factorId * m_numModels + m_model] = index;
+  }
+
+private:
+  std::vector<lm::WordIndex> &m_mapping;
+  size_t m_model, m_numModels;
+};
+
+} // namespace
+
+template <class Model> FusedKenLM<Model>::FusedKenLM(const std::string &line, size_t numModels)
+  :StatefulFeatureFunction(numModels, line)
+  ,m_loadMethod(util::POPULATE_OR_READ)
+  ,m_maxOrder(0)
+{
+  ReadParameters();
+
+  UTIL_THROW_IF2(m_files.empty() || m_files.size() > kMaxFusedModels,
+                 GetScoreProducerDescription() << ": needs 1 to " << kMaxFusedModels << " models");
+  if (m_factorTypes.empty()) {
+    m_factorTypes.resize(m_files.size(), 0);
+  }
+  UTIL_THROW_IF2(m_factorTypes.size() != m_files.size(),
+                 GetScoreProducerDescription() << ": needs one factor per model");
+
+  m_beginSentenceFactor = FactorCollection::Instance().AddFactor(BOS_);
+}
+
+template <class Model> void FusedKenLM<Model>::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "path") {
+    m_files = Tokenize(value, ",");
+  } else if (key == "factor") {
+    m_factorTypes = Tokenize<FactorType>(value, ",");
+  } else if (key == "load") {
+    if (value == "lazy") {
+      m_loadMethod = util::LAZY;
+    } else if (value == "populate_or_lazy") {
+      m_loadMethod = util::POPULATE_OR_LAZY;
+    } else if (value == "populate_or_read" || value == "populate") {
+      m_loadMethod = util::POPULATE_OR_READ;
+    } else if (value == "read") {
+      m_loadMethod = util::READ;
+    } else if (value == "parallel_read") {
+      m_loadMethod = util::PARALLEL_READ;
+    } else if (value == "parallel_populate") {
+      m_loadMethod = util::PARALLEL_POPULATE;
+    } else {
+      UTIL_THROW2("Unknown KenLM load method " << value);
+    }
+  } else {
+    StatefulFeatureFunction::SetParameter(key, value);
+  }
+}
+
+template <class Model> void FusedKenLM<Model>::Load()
+{
+  const size_t numModels = m_files.size();
+  for (size_t m = 0; m < numModels; ++m) {
+    lm::ngram::ModelType type = lm::ngram::PROBING;
+    lm::ngram::RecognizeBinary(m_files[m].c_str(), type);
+    UTIL_THROW_IF2(type != Model::kModelType, GetScoreProducerDescription()
+                   << ": all models must be of the same type, " << m_files[m] << " is not");
+
+    lm::ngram::Config config;
+    IFVERBOSE(1) {
+      config.messages = &std::cerr;
+    }
+    else {
+      config.messages = NULL;
+    }
+    FusedMappingBuilder builder(m_lookup, m, numModels);
+    config.enumerate_vocab = &builder;
+    config.load_method = m_loadMethod;
+
+    m_models.push_back(boost::shared_ptr<Model>(new Model(m_files[m].c_str(), config)));
+    m_maxOrder = std::max(m_maxOrder, m_models.back()->Order());
+  }
+}
+
+template <class Model> bool FusedKenLM<Model>::IsUseable(const FactorMask &mask) const
+{
+  for (size_t m = 0; m < m_factorTypes.size(); ++m) {
+    if (!mask[m_factorTypes[m]]) return false;
+  }
+  return true;
+}
+
+template <class Model> lm::WordIndex FusedKenLM<Model>::TranslateID(const Word &word, size_t model) const
+{
+  const Factor *factor = word[m_factorTypes[model]];
+  const size_t index = factor ? factor->GetId() * m_models.size() + model : m_lookup.size();
+  return index < m_lookup.size() ? m_lookup[index] : 0;
+}
+
+template <class Model> void FusedKenLM<Model>::TranslateIDs(const Word &word, lm::WordIndex *ids) const
+{
+  // models of the same factor read the same row
+  for (size_t m = 0; m < m_models.size(); ++m) {
+    ids[m] = TranslateID(word, m);
+  }
+}
+
+template <class Model> void FusedKenLM<Model>::LastIDs(const Hypothesis &hypo, lm::WordIndex ids[][KENLM_MAX_ORDER], size_t *ends) const
+{
+  const size_t numModels = m_models.size();
+  size_t open = numModels;
+  for (size_t m = 0; m < numModels; ++m) {
+    ends[m] = m_models[m]->Order() - 1;
+  }
+
+  lm::WordIndex row[kMaxFusedModels];
+  int position = hypo.GetCurrTargetWordsRange().GetEndPos();
+  for (size_t k = 0; open && k + 1 < m_maxOrder; ++k, --position) {
+    if (position == -1) {
+      for (size_t m = 0; m < numModels; ++m) {
+        if (k < ends[m]) {
+          ids[m][k] = m_models[m]->GetVocabulary().BeginSentence();
+          ends[m] = k + 1;
+        }
+      }
+      return;
+    }
+    TranslateIDs(hypo.GetWord(position), row);
+    for (size_t m = 0; m < numModels; ++m) {
+      if (k < ends[m]) {
+        ids[m][k] = row[m];
+        if (k + 1 == ends[m]) --open;
+      }
+    }
+  }
+}
+
+template <class Model> const FFState *FusedKenLM<Model>::EmptyHypothesisState(const InputType &/*input*/) const
+{
+  FusedKenLMState *ret = new FusedKenLMState();
+  ret->numModels = m_models.size();
+  for (size_t m = 0; m < m_models.size(); ++m) {
+    ret->states[m] = m_models[m]->BeginSentenceState();
+  }
+  return ret;
+}
+
+template <class Model> void FusedKenLM<Model>::CalcScore(size_t model, const Phrase &phrase, float &fullScore, float &ngramScore) const
+{
+  // as LanguageModelKen::CalcScore, for one of the models
+  fullScore = 0;
+  ngramScore = 0;
+  if (!phrase.GetSize()) return;
+
+  const Model &lm = *m_models[model];
+  const FactorType factorType = m_factorTypes[model];
+  lm::ngram::ChartState discarded_sadly;
+  lm::ngram::RuleScore<Model> scorer(lm, discarded_sadly);
+
+  size_t position;
+  if (m_beginSentenceFactor == phrase.GetWord(0).GetFactor(factorType)) {
+    scorer.BeginSentence();
+    position = 1;
+  } else {
+    position = 0;
+  }
+
+  const size_t ngramBoundary = lm.Order() - 1;
+  size_t end_loop = std::min(ngramBoundary, phrase.GetSize());
+  for (; position < end_loop; ++position) {
+    const Word &word = phrase.GetWord(position);
+    if (word.IsNonTerminal()) {
+      fullScore += scorer.Finish();
+      scorer.Reset();
+    } else {
+      scorer.Terminal(TranslateID(word, model));
+    }
+  }
+  float before_boundary = fullScore + scorer.Finish();
+  for (; position < phrase.GetSize(); ++position) {
+    const Word &word = phrase.GetWord(position);
+    if (word.IsNonTerminal()) {
+      fullScore += scorer.Finish();
+      scorer.Reset();
+    } else {
+      scorer.Terminal(TranslateID(word, model));
+    }
+  }
+  fullScore += scorer.Finish();
+
+  ngramScore = TransformLMScore(fullScore - before_boundary);
+  fullScore = TransformLMScore(fullScore);
+}
+
+template <class Model> void FusedKenLM<Model>::EvaluateInIsolation(const Phrase &source
+    , const TargetPhrase &targetPhrase
+    , ScoreComponentCollection &scoreBreakdown
+    , ScoreComponentCollection &estimatedFutureScore) const
+{
+  std::vector<float> scores(m_models.size()), estimates(m_models.size());
+  for (size_t m = 0; m < m_models.size(); ++m) {
+    float fullScore, ngramScore;
+    CalcScore(m, targetPhrase, fullScore, ngramScore);
+    scores[m] = ngramScore;
+    estimates[m] = fullScore - ngramScore;
+  }
+  scoreBreakdown.Assign(this, scores);
+  estimatedFutureScore.Assign(this, estimates);
+}
+
+template <class Model> FFState *FusedKenLM<Model>::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
+{
+  const FusedKenLMState &in = static_cast<const FusedKenLMState&>(*ps);
+  std::auto_ptr<FusedKenLMState> ret(new FusedKenLMState(in));
+  if (!hypo.GetCurrTargetLength()) {
+    return ret.release();
+  }
+
+  const size_t numModels = m_models.size();
+  const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
+  //[begin, end) in STL-like fashion.
+  const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
+  const TargetPhrase &phrase = hypo.GetCurrTargetPhrase();
+
+  // ids of the words any of the models scores with the incoming state,
+  // translated once for all models
+  const std::size_t maxScored = std::min(end - begin, std::size_t(m_maxOrder - 1));
+  lm::WordIndex ids[KENLM_MAX_ORDER][kMaxFusedModels];
+  for (std::size_t i = 0; i < maxScored; ++i) {
+    TranslateIDs(phrase.GetWord(i), ids[i]);
+  }
+
+  // per model, the context of every scored word in reverse order (as in
+  // LanguageModelKen); the lookups of all models are prefetched in turn so
+  // that their cache misses overlap
+  lm::WordIndex context[kMaxFusedModels][2 * KENLM_MAX_ORDER];
+  const lm::WordIndex *contextEnd[kMaxFusedModels];
+  std::size_t scored[kMaxFusedModels];
+  for (size_t m = 0; m < numModels; ++m) {
+    const lm::ngram::State &in_state = in.states[m];
+    scored[m] = std::min(end - begin, std::size_t(m_models[m]->Order() - 1));
+    for (std::size_t i = 0; i < scored[m]; ++i) {
+      context[m][scored[m] - 1 - i] = ids[i][m];
+    }
+    std::copy(in_state.words, in_state.words + in_state.length, context[m] + scored[m]);
+    contextEnd[m] = context[m] + scored[m] + in_state.length;
+  }
+  for (std::size_t j = 0; j < maxScored; ++j) {
+    for (size_t m = 0; m < numModels; ++m) {
+      if (j < scored[m]) {
+        const std::size_t i = scored[m] - j;
+        m_models[m]->Prefetch(context[m] + i, contextEnd[m], context[m][i - 1]);
+      }
+    }
+  }
+
+  lm::WordIndex lastIds[kMaxFusedModels][KENLM_MAX_ORDER];
+  std::size_t lastEnds[kMaxFusedModels];
+  bool haveLastIds = false;
+
+  std::vector<float> scores(numModels);
+  for (size_t m = 0; m < numModels; ++m) {
+    const Model &model = *m_models[m];
+    const lm::ngram::State &in_state = in.states[m];
+    const std::size_t adjust_end = begin + scored[m];
+    const lm::WordIndex *words = context[m];
+
+    typename Model::State aux_state;
+    typename Model::State *state0 = &ret->states[m], *state1 = &aux_state;
+
+    float score = model.Score(in_state, words[scored[m] - 1], *state0);
+    for (std::size_t position = begin + 1; position < adjust_end; ++position) {
+      score += model.Score(*state0, words[adjust_end - 1 - position], *state1);
+      std::swap(state0, state1);
+    }
+
+    if (hypo.IsSourceCompleted() || adjust_end < end) {
+      if (!haveLastIds) {
+        LastIDs(hypo, lastIds, lastEnds);
+        haveLastIds = true;
+      }
+      if (hypo.IsSourceCompleted()) {
+        // Score end of sentence.
+        score += model.FullScoreForgotState(lastIds[m], lastIds[m] + lastEnds[m], model.GetVocabulary().EndSentence(), ret->states[m]).prob;
+      } else {
+        // Get state after adding a long phrase.
+        model.GetState(lastIds[m], lastIds[m] + lastEnds[m], ret->states[m]);
+      }
+    } else if (state0 != &ret->states[m]) {
+      // Short enough phrase that we can just reuse the state.
+      ret->states[m] = *state0;
+    }
+
+    scores[m] = TransformLMScore(score);
+  }
+  out->PlusEquals(this, scores);
+
+  return ret.release();
+}
+
+template <class Model> FFState *FusedKenLM<Model>::EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection* accumulator) const
+{
+  UTIL_THROW2(GetScoreProducerDescription() << ": FusedKENLM is only implemented for phrase-based decoding, use one KENLM feature per model");
+}
+
+template <class Model> void FusedKenLM<Model>::WriteStateKey(const FFState &state, uint32_t *key) const
+{
+  const FusedKenLMState &fused = static_cast<const FusedKenLMState&>(state);
+  for (size_t m = 0; m < m_models.size(); ++m, key += KENLM_MAX_ORDER) {
+    const lm::ngram::State &ngram = fused.states[m];
+    key[0] = ngram.length;
+    // words past the length are not part of the state
+    std::copy(ngram.words, ngram.words + ngram.length, key + 1);
+    std::fill(key + 1 + ngram.length, key + KENLM_MAX_ORDER, 0);
+  }
+}
+
+StatefulFeatureFunction *ConstructFusedKenLM(const std::string &line)
+{
+  // the type of the first model decides the template, the others must match
+  std::string firstFile;
+  size_t numModels = 0;
+  util::TokenIter<util::SingleCharacter, true> argument(line, ' ');
+  for (++argument; argument; ++argument) {
+    if (argument->starts_with("path=")) {
+      util::TokenIter<util::SingleCharacter, true> file(argument->substr(5), ',');
+      firstFile = file ? file->as_string() : std::string();
+      for (; file; ++file) ++numModels;
+    }
+  }
+  UTIL_THROW_IF2(!numModels, "FusedKENLM needs path=file1,file2,...");
+
+  lm::ngram::ModelType model_type;
+  if (lm::ngram::RecognizeBinary(firstFile.c_str(), model_type)) {
+    switch(model_type) {
+    case lm::ngram::PROBING:
+      return new FusedKenLM<lm::ngram::ProbingModel>(line, numModels);
+    case lm::ngram::REST_PROBING:
+      return new FusedKenLM<lm::ngram::RestProbingModel>(line, numModels);
+    case lm::ngram::TRIE:
+      return new FusedKenLM<lm::ngram::TrieModel>(line, numModels);
+    case lm::ngram::QUANT_TRIE:
+      return new FusedKenLM<lm::ngram::QuantTrieModel>(line, numModels);
+    case lm::ngram::ARRAY_TRIE:
+      return new FusedKenLM<lm::ngram::ArrayTrieModel>(line, numModels);
+    case lm::ngram::QUANT_ARRAY_TRIE:
+      return new FusedKenLM<lm::ngram::QuantArrayTrieModel>(line, numModels);
+    default:
+      UTIL_THROW2("Unrecognized kenlm model type " << model_type);
+    }
+  } else {
+    return new FusedKenLM<lm::ngram::ProbingModel>(line, numModels);
+  }
+}
+
+}
@@ -0,0 +1,124 @@
+// -*- c++ -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "lm/word_index.hh"
+#include "lm/max_order.hh"
+#include "lm/state.hh"
+#include "util/mmap.hh"
+
+#include "moses/FF/StatefulFeatureFunction.h"
+#include "moses/TypeDef.h"
+
+namespace Moses
+{
+
+class Phrase;
+class Word;
+
+//! the most models one FusedKENLM feature can hold
+const size_t kMaxFusedModels = 4;
+
+//! Returns a FusedKenLM of the type of the first model.
+StatefulFeatureFunction *ConstructFusedKenLM(const std::string &line);
+
+/** Several KenLM models of the same binary type (say a word, a POS and a
+ *  cluster LM) as one phrase-based feature with one score per model:
+ *
+ *    FusedKENLM path=word.binlm,pos.binlm factor=0,1 [load=...]
+ *
+ *  The state holds the n-gram states of all models inline, and each target
+ *  word is mapped to the vocabulary ids of all models through one table,
+ *  indexed by factor id with a column per model. The lookups of all models
+ *  for an extension are prefetched before any of them is scored.
+ */
+template <class Model> class FusedKenLM : public StatefulFeatureFunction
+{
+public:
+  FusedKenLM(const std::string &line, size_t numModels);
+
+  void SetParameter(const std::string& key, const std::string& value);
+  void Load();
+
+  bool IsUseable(const FactorMask &mask) const;
+
+  const FFState* EmptyHypothesisState(const InputType &input) const;
+
+  void EvaluateInIsolation(const Phrase &source
+                           , const TargetPhrase &targetPhrase
+                           , ScoreComponentCollection &scoreBreakdown
+                           , ScoreComponentCollection &estimatedFutureScore) const;
+  void EvaluateWithSourceContext(const InputType &input
+                                 , const InputPath &inputPath
+                                 , const TargetPhrase &targetPhrase
+                                 , const StackVec *stackVec
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection *estimatedFutureScore = NULL) const {
+  }
+  void EvaluateTranslationOptionListWithSourceContext(const InputType &input
+      , const TranslationOptionList &translationOptionList) const {
+  }
+
+  FFState* EvaluateWhenApplied(const Hypothesis& cur_hypo,
+                               const FFState* prev_state,
+                               ScoreComponentCollection* accumulator) const;
+  FFState* EvaluateWhenApplied(const ChartHypothesis& cur_hypo,
+                               int featureID,
+                               ScoreComponentCollection* accumulator) const;
+
+  //! length and words of each model's n-gram state
+  size_t GetStateKeySize() const {
+    return m_models.size() * KENLM_MAX_ORDER;
+  }
+  void WriteStateKey(const FFState &state, uint32_t *key) const;
+  bool HasStateHash() const {
+    return true;
+  }
+
+private:
+  std::vector<std::string> m_files;
+  std::vector<FactorType> m_factorTypes;
+  util::LoadMethod m_loadMethod;
+
+  std::vector<boost::shared_ptr<Model> > m_models;
+  unsigned char m_maxOrder;
+
+  //! vocabulary id of factor f in model m at f * m_models.size() + m, 0 is <unk>
+  std::vector<lm::WordIndex> m_lookup;
+  const Factor *m_beginSentenceFactor;
+
+  //! the id of word in a model, NULL factors are <unk>
+  lm::WordIndex TranslateID(const Word &word, size_t model) const;
+  //! the ids of word in all models
+  void TranslateIDs(const Word &word, lm::WordIndex *ids) const;
+
+  /** the ids of the last words of the hypothesis, most recent first, as
+   *  many as each model's order needs; ends[m] is the end of model m's */
+  void LastIDs(const Hypothesis &hypo, lm::WordIndex ids[][KENLM_MAX_ORDER], size_t *ends) const;
+
+  void CalcScore(size_t model, const Phrase &phrase, float &fullScore, float &ngramScore) const;
+};
+
+}
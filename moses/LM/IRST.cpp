@@ -71,6 +71,9 @@ LanguageModelIRST::LanguageModelIRST(const std::string &line)
 
   ReadParameters();
 
+  // each query goes through the IRSTLM container, remember phrase scores
+  m_cacheScores = true;
+
   VERBOSE(4, GetScoreProducerDescription() << " LanguageModelIRST::LanguageModelIRST() m_lmtb_dub:|" << m_lmtb_dub << "|" << std::endl);
   VERBOSE(4, GetScoreProducerDescription() << " LanguageModelIRST::LanguageModelIRST() m_filePath:|" << m_filePath << "|" << std::endl);
   VERBOSE(4, GetScoreProducerDescription() << " LanguageModelIRST::LanguageModelIRST() m_factorType:|" << m_factorType << "|" << std::endl);
@@ -296,7 +299,7 @@ FFState* LanguageModelIRST::EvaluateWhenApplied(const Hypothesis &hypo, const FF
   int codes[m_lmtb_size];
   int idx=m_lmtb_size-1;
   int position = (const int) begin;
-  while (position >= 0) {
+  while (position >= 0 && idx >= 0) {
     codes[idx] =  GetLmID(hypo.GetWord(position));
     --idx;
     --position;
@@ -341,7 +344,7 @@ FFState* LanguageModelIRST::EvaluateWhenApplied(const Hypothesis &hypo, const FF
 
     if (adjust_end < end)   { //the LMstate of this target phrase refers to the last m_lmtb_size-1 words
       position = (const int) end - 1;
-      for (idx=m_lmtb_size-1; idx>0; --idx) {
+      for (idx=m_lmtb_size-1; idx>0; --idx, --position) {
         codes[idx] =  GetLmID(hypo.GetWord(position));
       }
       codes[idx] = m_lmtb_sentenceStart;
@@ -35,13 +35,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "Ken.h"
 #include "Base.h"
+#include "PrecomputedScores.h"
 #include "moses/FF/FFState.h"
 #include "moses/TypeDef.h"
 #include "moses/Util.h"
 #include "moses/FactorCollection.h"
 #include "moses/Phrase.h"
 #include "moses/InputFileStream.h"
+#include "moses/MemoryReport.h"
 #include "moses/StaticData.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/ChartHypothesis.h"
 #include "moses/Incremental.h"
 #include "moses/Syntax/SVertex.h"
@@ -61,6 +64,9 @@ struct KenLMState : public FFState {
     if (state.length > other.state.length) return 1;
     return std::memcmp(state.words, other.state.words, sizeof(lm::WordIndex) * state.length);
   }
+  size_t hash() const {
+    return lm::ngram::hash_value(state, state.length);
+  }
 };
 
 ///*
@@ -69,7 +75,7 @@ struct KenLMState : public FFState {
 //template <class Model> class LanguageModelKen : public LanguageModel
 //{
 //public:
-//  LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, bool lazy);
+//  LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, util::LoadMethod load_method);
 //
 //  const FFState *EmptyHypothesisState(const InputType &/*input*/) const {
 //    KenLMState *ret = new KenLMState();
@@ -142,12 +148,37 @@ private:
 
 } // namespace
 
-template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, bool lazy)
+template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, util::LoadMethod load_method)
   :LanguageModel(line)
   ,m_factorType(factorType)
+  ,m_file(file)
+  ,m_loadMethod(load_method)
+  ,m_reloadable(false)
 {
   ReadParameters();
 
+  m_loaded = Load(file);
+
+  m_beginSentenceFactor = FactorCollection::Instance().AddFactor(BOS_);
+}
+
+template <class Model> LanguageModelKen<Model>::LanguageModelKen(const LanguageModelKen<Model> &copy_from)
+  :LanguageModel(copy_from.GetArgLine()),
+// TODO: don't copy this.
+   m_beginSentenceFactor(copy_from.m_beginSentenceFactor),
+   m_factorType(copy_from.m_factorType),
+   m_file(copy_from.m_file),
+   m_loadMethod(copy_from.m_loadMethod),
+   m_reloadable(copy_from.m_reloadable),
+   m_loaded(copy_from.GetCurrent())
+{
+}
+
+template <class Model> boost::shared_ptr<typename LanguageModelKen<Model>::Loaded> LanguageModelKen<Model>::Load(const std::string &file) const
+{
+  boost::shared_ptr<Loaded> ret(new Loaded());
+  ret->generation = 1;
+
   lm::ngram::Config config;
   IFVERBOSE(1) {
     config.messages = &std::cerr;
@@ -156,34 +187,95 @@ template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::stri
     config.messages = NULL;
   }
   FactorCollection &collection = FactorCollection::Instance();
-  MappingBuilder builder(collection, m_lmIdLookup);
+  MappingBuilder builder(collection, ret->lmIdLookup);
   config.enumerate_vocab = &builder;
-  config.load_method = lazy ? util::LAZY : util::POPULATE_OR_READ;
+  config.load_method = m_loadMethod;
 
-  m_ngram.reset(new Model(file.c_str(), config));
+  ret->ngram.reset(new Model(file.c_str(), config));
+  ret->fingerprint = PrecomputedLMScorer::Fingerprint(file, m_factorType);
+  return ret;
+}
 
-  m_beginSentenceFactor = collection.AddFactor(BOS_);
+template <class Model> boost::shared_ptr<const typename LanguageModelKen<Model>::Loaded> LanguageModelKen<Model>::GetCurrent() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_loadedMutex);
+#endif
+  return m_loaded;
 }
 
-template <class Model> LanguageModelKen<Model>::LanguageModelKen(const LanguageModelKen<Model> &copy_from)
-  :LanguageModel(copy_from.GetArgLine()),
-   m_ngram(copy_from.m_ngram),
-// TODO: don't copy this.
-   m_beginSentenceFactor(copy_from.m_beginSentenceFactor),
-   m_factorType(copy_from.m_factorType),
-   m_lmIdLookup(copy_from.m_lmIdLookup)
+template <class Model> void LanguageModelKen<Model>::SetParameter(const std::string& key, const std::string& value)
 {
+  if (key == "reloadable") {
+    m_reloadable = Scan<bool>(value);
+  } else {
+    LanguageModel::SetParameter(key, value);
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::ReportMemory(MemoryUsage &usage) const
+{
+  boost::shared_ptr<const Loaded> loaded = GetCurrent();
+  if (loaded && loaded->ngram) {
+    const lm::ngram::BinaryFormat &backing = loaded->ngram->GetBacking();
+    const util::scoped_memory &mapping = backing.Mapping();
+    if (mapping.source() == util::scoped_memory::MMAP_ALLOCATED) {
+      usage.AddMapped(mapping.get(), mapping.size());
+    } else {
+      usage.heap += mapping.size();
+    }
+    usage.heap += backing.AllocatedSize() + loaded->lmIdLookup.size() * sizeof(lm::WordIndex);
+  }
+
+  for (size_t i = 0; i < kScoreCacheShards; ++i) {
+    ScoreCacheShard &shard = m_scoreCache[i];
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+    for (typename ScoreCacheMap::const_iterator entry = shard.scores.begin(); entry != shard.scores.end(); ++entry) {
+      usage.cache += sizeof(typename ScoreCacheMap::value_type) + 2 * sizeof(void*)
+                     + entry->first.size() * sizeof(lm::WordIndex);
+    }
+    usage.cacheEntries += shard.scores.size();
+    usage.cacheHits += shard.hits;
+    usage.cacheMisses += shard.misses;
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::Reload(const std::string &path)
+{
+  UTIL_THROW_IF2(!m_reloadable, GetScoreProducerDescription()
+                 << " cannot be reloaded without reloadable=true");
+  const std::string &file = path.empty() ? m_file : path;
+  // load outside the lock, decoding goes on with the current model
+  boost::shared_ptr<Loaded> loaded = Load(file);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_loadedMutex);
+#endif
+  loaded->generation = m_loaded->generation + 1;
+  m_loaded = loaded;
+  m_file = file;
+  VERBOSE(1, GetScoreProducerDescription() << " reloaded from " << file << std::endl);
+}
+
+template <class Model> void LanguageModelKen<Model>::InitializeForInput(InputType const& source)
+{
+  if (m_reloadable) {
+    m_pinned.reset(new boost::shared_ptr<const Loaded>(GetCurrent()));
+  }
 }
 
 template <class Model> const FFState * LanguageModelKen<Model>::EmptyHypothesisState(const InputType &/*input*/) const
 {
+  ScopedPin pin(*this);
   KenLMState *ret = new KenLMState();
-  ret->state = m_ngram->BeginSentenceState();
+  ret->state = GetModel().BeginSentenceState();
   return ret;
 }
 
 template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
 {
+  ScopedPin pin(*this);
   fullScore = 0;
   ngramScore = 0;
   oovCount = 0;
@@ -191,7 +283,7 @@ template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phr
   if (!phrase.GetSize()) return;
 
   lm::ngram::ChartState discarded_sadly;
-  lm::ngram::RuleScore<Model> scorer(*m_ngram, discarded_sadly);
+  lm::ngram::RuleScore<Model> scorer(GetModel(), discarded_sadly);
 
   size_t position;
   if (m_beginSentenceFactor == phrase.GetWord(0).GetFactor(m_factorType)) {
@@ -201,7 +293,7 @@ template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phr
     position = 0;
   }
 
-  size_t ngramBoundary = m_ngram->Order() - 1;
+  size_t ngramBoundary = GetModel().Order() - 1;
 
   size_t end_loop = std::min(ngramBoundary, phrase.GetSize());
   for (; position < end_loop; ++position) {
@@ -233,8 +325,149 @@ template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phr
   fullScore = TransformLMScore(fullScore);
 }
 
+namespace
+{
+// A shard of the score cache is dropped wholesale once it holds this many
+// phrases. Also bounds the per-sentence extension memo.
+const size_t kMaxScoreCacheSize = 1 << 20;
+const size_t kMaxScoreCacheShardSize = kMaxScoreCacheSize / 16;
+// Stands in for non-terminals in score cache keys.
+const lm::WordIndex kNonTerminalKey = static_cast<lm::WordIndex>(-1);
+} // namespace
+
+template <class Model> std::vector<lm::WordIndex> &LanguageModelKen<Model>::GetScoreKey() const
+{
+  std::vector<lm::WordIndex> *key = m_scoreKey.get();
+  if (!key) {
+    key = new std::vector<lm::WordIndex>();
+    m_scoreKey.reset(key);
+  }
+  return *key;
+}
+
+template <class Model> typename LanguageModelKen<Model>::ScoreCacheShard &LanguageModelKen<Model>::GetScoreCacheShard(const std::vector<lm::WordIndex> &key) const
+{
+  return m_scoreCache[boost::hash_value(key) % kScoreCacheShards];
+}
+
+template <class Model> typename LanguageModelKen<Model>::ExtensionMemo &LanguageModelKen<Model>::GetExtensionMemo() const
+{
+  ExtensionMemo *memo = m_extensionMemo.get();
+  if (!memo) {
+    memo = new ExtensionMemo();
+    m_extensionMemo.reset(memo);
+  }
+  return *memo;
+}
+
+template <class Model> size_t LanguageModelKen<Model>::ExtensionKeyHasher::operator()(const ExtensionKey &key) const
+{
+  size_t seed = hash_value(key.state);
+  boost::hash_combine(seed, key.targetPhrase);
+  boost::hash_combine(seed, key.sourceCompleted);
+  return seed;
+}
+
+template <class Model> void LanguageModelKen<Model>::CleanUpAfterSentenceProcessing(const InputType& source)
+{
+  // keys hold target phrase pointers, which are only valid for one sentence
+  if (m_extensionMemo.get()) {
+    m_extensionMemo->clear();
+  }
+  // release this sentence's model, which frees it if it was replaced
+  if (m_reloadable) {
+    m_pinned.reset();
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::PhraseKey(const Phrase &phrase, std::vector<lm::WordIndex> &key) const
+{
+  key.resize(phrase.GetSize());
+  for (size_t i = 0; i < phrase.GetSize(); ++i) {
+    const Word &word = phrase.GetWord(i);
+    key[i] = word.IsNonTerminal() ? kNonTerminalKey : TranslateID(word);
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
+{
+  ScopedPin pin(*this);
+  // scores are keyed on vocab ids, which change with the model
+  const size_t generation = GetLoaded().generation;
+  std::vector<lm::WordIndex> &key = GetScoreKey();
+  PhraseKey(phrase, key);
+  ScoreCacheShard &shard = GetScoreCacheShard(key);
+
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+    typename ScoreCacheMap::const_iterator iter = shard.scores.find(key);
+    if (iter != shard.scores.end() && iter->second.generation == generation) {
+      ++shard.hits;
+      fullScore = iter->second.fullScore;
+      ngramScore = iter->second.ngramScore;
+      oovCount = iter->second.oovCount;
+      return;
+    }
+    ++shard.misses;
+  }
+
+  // score outside the lock
+  CalcScore(phrase, fullScore, ngramScore, oovCount);
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  if (shard.scores.size() >= kMaxScoreCacheShardSize) {
+    shard.scores.clear();
+  }
+  ScoreCacheEntry &entry = shard.scores[key];
+  entry.fullScore = fullScore;
+  entry.ngramScore = ngramScore;
+  entry.oovCount = oovCount;
+  entry.generation = generation;
+}
+
+template <class Model> void LanguageModelKen<Model>::CalcScoreBatch(const std::vector<const Phrase*> &phrases) const
+{
+  ScopedPin pin(*this);
+  // CalcScoreFromCache() drops the phrases already scored, by this or other
+  // threads, and those repeated within the batch
+  float fullScore, ngramScore;
+  size_t oovCount;
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    CalcScoreFromCache(*phrases[i], fullScore, ngramScore, oovCount);
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::EvaluateInIsolation(const Phrase &source
+    , const TargetPhrase &targetPhrase
+    , ScoreComponentCollection &scoreBreakdown
+    , ScoreComponentCollection &estimatedFutureScore) const
+{
+  ScopedPin pin(*this);
+  float fullScore, nGramScore;
+  size_t oovCount;
+
+  // scores stored in a table binarized for this model
+  const PhraseDictionary *table = targetPhrase.GetContainer();
+  if (table && table->GetLMFingerprint() == GetLoaded().fingerprint) {
+    const Scores *lmScores = targetPhrase.GetExtraScores(table);
+    if (lmScores) {
+      AssignScores((*lmScores)[0], (*lmScores)[1], static_cast<size_t>((*lmScores)[2]),
+                   scoreBreakdown, estimatedFutureScore);
+      return;
+    }
+  }
+
+  CalcScoreFromCache(targetPhrase, fullScore, nGramScore, oovCount);
+  AssignScores(fullScore, nGramScore, oovCount, scoreBreakdown, estimatedFutureScore);
+}
+
 template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
 {
+  ScopedPin pin(*this);
   const lm::ngram::State &in_state = static_cast<const KenLMState&>(*ps).state;
 
   std::auto_ptr<KenLMState> ret(new KenLMState());
@@ -244,35 +477,71 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
     return ret.release();
   }
 
-  const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
-  //[begin, end) in STL-like fashion.
-  const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
-  const std::size_t adjust_end = std::min(end, begin + m_ngram->Order() - 1);
+  ExtensionMemo &memo = GetExtensionMemo();
+  ExtensionKey key;
+  key.targetPhrase = &hypo.GetCurrTargetPhrase();
+  key.state = in_state;
+  key.sourceCompleted = hypo.IsSourceCompleted();
+
+  float score;
+  typename ExtensionMemo::const_iterator memoIter = memo.find(key);
+  if (memoIter != memo.end()) {
+    score = memoIter->second.score;
+    ret->state = memoIter->second.state;
+  } else {
+    const Model &model = GetModel();
+    const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
+    //[begin, end) in STL-like fashion.
+    const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
+    const std::size_t adjust_end = std::min(end, begin + model.Order() - 1);
+
+    // Context for every scored word in reverse order: the phrase words
+    // [begin, adjust_end) backwards followed by the incoming state.  The
+    // lookups for all of them are prefetched before scoring so their cache
+    // misses overlap rather than being taken one after another.
+    lm::WordIndex context[2 * KENLM_MAX_ORDER];
+    const std::size_t scored = adjust_end - begin;
+    for (std::size_t i = 0; i < scored; ++i) {
+      context[scored - 1 - i] = TranslateID(hypo.GetWord(begin + i));
+    }
+    std::copy(in_state.words, in_state.words + in_state.length, context + scored);
+    const lm::WordIndex *context_end = context + scored + in_state.length;
+    for (std::size_t i = scored; i > 0; --i) {
+      model.Prefetch(context + i, context_end, context[i - 1]);
+    }
+
+    std::size_t position = begin;
+    typename Model::State aux_state;
+    typename Model::State *state0 = &ret->state, *state1 = &aux_state;
 
-  std::size_t position = begin;
-  typename Model::State aux_state;
-  typename Model::State *state0 = &ret->state, *state1 = &aux_state;
+    score = model.Score(in_state, context[scored - 1], *state0);
+    ++position;
+    for (; position < adjust_end; ++position) {
+      score += model.Score(*state0, context[adjust_end - 1 - position], *state1);
+      std::swap(state0, state1);
+    }
 
-  float score = m_ngram->Score(in_state, TranslateID(hypo.GetWord(position)), *state0);
-  ++position;
-  for (; position < adjust_end; ++position) {
-    score += m_ngram->Score(*state0, TranslateID(hypo.GetWord(position)), *state1);
-    std::swap(state0, state1);
-  }
+    if (hypo.IsSourceCompleted()) {
+      // Score end of sentence.
+      std::vector<lm::WordIndex> indices(model.Order() - 1);
+      const lm::WordIndex *last = LastIDs(hypo, &indices.front());
+      score += model.FullScoreForgotState(&indices.front(), last, model.GetVocabulary().EndSentence(), ret->state).prob;
+    } else if (adjust_end < end) {
+      // Get state after adding a long phrase.
+      std::vector<lm::WordIndex> indices(model.Order() - 1);
+      const lm::WordIndex *last = LastIDs(hypo, &indices.front());
+      model.GetState(&indices.front(), last, ret->state);
+    } else if (state0 != &ret->state) {
+      // Short enough phrase that we can just reuse the state.
+      ret->state = *state0;
+    }
 
-  if (hypo.IsSourceCompleted()) {
-    // Score end of sentence.
-    std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
-    const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), ret->state).prob;
-  } else if (adjust_end < end) {
-    // Get state after adding a long phrase.
-    std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
-    const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    m_ngram->GetState(&indices.front(), last, ret->state);
-  } else if (state0 != &ret->state) {
-    // Short enough phrase that we can just reuse the state.
-    ret->state = *state0;
+    if (memo.size() >= kMaxScoreCacheSize) {
+      memo.clear();
+    }
+    ExtensionResult &result = memo[key];
+    result.score = score;
+    result.state = ret->state;
   }
 
   score = TransformLMScore(score);
@@ -311,10 +580,20 @@ private:
   lm::ngram::ChartState m_state;
 };
 
+template <class Model> void LanguageModelKen<Model>::WriteStateKey(const FFState &state, uint32_t *key) const
+{
+  const lm::ngram::State &ngram = static_cast<const KenLMState&>(state).state;
+  key[0] = ngram.length;
+  // words past the length are not part of the state
+  std::copy(ngram.words, ngram.words + ngram.length, key + 1);
+  std::fill(key + 1 + ngram.length, key + KENLM_MAX_ORDER, 0);
+}
+
 template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(const ChartHypothesis& hypo, int featureID, ScoreComponentCollection *accumulator) const
 {
+  ScopedPin pin(*this);
   LanguageModelChartStateKenLM *newState = new LanguageModelChartStateKenLM();
-  lm::ngram::RuleScore<Model> ruleScore(*m_ngram, newState->GetChartState());
+  lm::ngram::RuleScore<Model> ruleScore(GetModel(), newState->GetChartState());
   const TargetPhrase &target = hypo.GetCurrTargetPhrase();
   const AlignmentInfo::NonTermIndexMap &nonTermIndexMap =
     target.GetAlignNonTerm().GetNonTermIndexMap();
@@ -365,8 +644,9 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
 
 template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(const Syntax::SHyperedge& hyperedge, int featureID, ScoreComponentCollection *accumulator) const
 {
+  ScopedPin pin(*this);
   LanguageModelChartStateKenLM *newState = new LanguageModelChartStateKenLM();
-  lm::ngram::RuleScore<Model> ruleScore(*m_ngram, newState->GetChartState());
+  lm::ngram::RuleScore<Model> ruleScore(GetModel(), newState->GetChartState());
   const TargetPhrase &target = *hyperedge.label.translation;
   const AlignmentInfo::NonTermIndexMap &nonTermIndexMap =
     target.GetAlignNonTerm().GetNonTermIndexMap2();
@@ -412,22 +692,25 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
 
 template <class Model> void LanguageModelKen<Model>::IncrementalCallback(Incremental::Manager &manager) const
 {
-  manager.LMCallback(*m_ngram, m_lmIdLookup);
+  ScopedPin pin(*this);
+  const Loaded &loaded = GetLoaded();
+  manager.LMCallback(*loaded.ngram, loaded.lmIdLookup);
 }
 
 template <class Model> void LanguageModelKen<Model>::ReportHistoryOrder(std::ostream &out, const Phrase &phrase) const
 {
+  ScopedPin pin(*this);
   out << "|lm=(";
   if (!phrase.GetSize()) return;
 
   typename Model::State aux_state;
-  typename Model::State start_of_sentence_state = m_ngram->BeginSentenceState();
+  typename Model::State start_of_sentence_state = GetModel().BeginSentenceState();
   typename Model::State *state0 = &start_of_sentence_state;
   typename Model::State *state1 = &aux_state;
 
   for (std::size_t position=0; position<phrase.GetSize(); position++) {
     const lm::WordIndex idx = TranslateID(phrase.GetWord(position));
-    lm::FullScoreReturn ret(m_ngram->FullScore(*state0, idx, *state1));
+    lm::FullScoreReturn ret(GetModel().FullScore(*state0, idx, *state1));
     if (position) out << ",";
     out << (int) ret.ngram_length << ":" << TransformLMScore(ret.prob);
     if (idx == 0) out << ":unk";
@@ -461,7 +744,7 @@ LanguageModel *ConstructKenLM(const std::string &lineOrig)
 {
   FactorType factorType = 0;
   string filePath;
-  bool lazy = false;
+  util::LoadMethod load_method = util::POPULATE_OR_READ;
 
   util::TokenIter<util::SingleCharacter, true> argument(lineOrig, ' ');
   ++argument; // KENLM
@@ -482,38 +765,55 @@ LanguageModel *ConstructKenLM(const std::string &lineOrig)
     } else if (name == "path") {
       filePath.assign(value.data(), value.size());
     } else if (name == "lazyken") {
-      lazy = boost::lexical_cast<bool>(value);
+      // deprecated: use load=lazy
+      load_method = boost::lexical_cast<bool>(value) ? util::LAZY : util::POPULATE_OR_READ;
+    } else if (name == "load") {
+      if (value == "lazy") {
+        load_method = util::LAZY;
+      } else if (value == "populate_or_lazy") {
+        load_method = util::POPULATE_OR_LAZY;
+      } else if (value == "populate_or_read" || value == "populate") {
+        load_method = util::POPULATE_OR_READ;
+      } else if (value == "read") {
+        load_method = util::READ;
+      } else if (value == "parallel_read") {
+        load_method = util::PARALLEL_READ;
+      } else if (value == "parallel_populate") {
+        load_method = util::PARALLEL_POPULATE;
+      } else {
+        UTIL_THROW2("Unknown KenLM load method " << value);
+      }
     } else {
       // pass to base class to interpret
       line << " " << name << "=" << value;
     }
   }
 
-  return ConstructKenLM(line.str(), filePath, factorType, lazy);
+  return ConstructKenLM(line.str(), filePath, factorType, load_method);
 }
 
-LanguageModel *ConstructKenLM(const std::string &line, const std::string &file, FactorType factorType, bool lazy)
+LanguageModel *ConstructKenLM(const std::string &line, const std::string &file, FactorType factorType, util::LoadMethod load_method)
 {
   lm::ngram::ModelType model_type;
   if (lm::ngram::RecognizeBinary(file.c_str(), model_type)) {
     switch(model_type) {
     case lm::ngram::PROBING:
-      return new LanguageModelKen<lm::ngram::ProbingModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::ProbingModel>(line, file, factorType, load_method);
     case lm::ngram::REST_PROBING:
-      return new LanguageModelKen<lm::ngram::RestProbingModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::RestProbingModel>(line, file, factorType, load_method);
     case lm::ngram::TRIE:
-      return new LanguageModelKen<lm::ngram::TrieModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::TrieModel>(line, file, factorType, load_method);
     case lm::ngram::QUANT_TRIE:
-      return new LanguageModelKen<lm::ngram::QuantTrieModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::QuantTrieModel>(line, file, factorType, load_method);
     case lm::ngram::ARRAY_TRIE:
-      return new LanguageModelKen<lm::ngram::ArrayTrieModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::ArrayTrieModel>(line, file, factorType, load_method);
     case lm::ngram::QUANT_ARRAY_TRIE:
-      return new LanguageModelKen<lm::ngram::QuantArrayTrieModel>(line, file, factorType, lazy);
+      return new LanguageModelKen<lm::ngram::QuantArrayTrieModel>(line, file, factorType, load_method);
     default:
       UTIL_THROW2("Unrecognized kenlm model type " << model_type);
     }
   } else {
-    return new LanguageModelKen<lm::ngram::ProbingModel>(line, file, factorType, lazy);
+    return new LanguageModelKen<lm::ngram::ProbingModel>(line, file, factorType, load_method);
   }
 }
 
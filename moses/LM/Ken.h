@@ -23,9 +23,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_LanguageModelKen_h
 
 #include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
 
 #include "lm/word_index.hh"
+#include "lm/max_order.hh"
+#include "lm/state.hh"
+#include "util/exception.hh"
+#include "util/mmap.hh"
 
 #include "moses/LM/Base.h"
 #include "moses/Hypothesis.h"
@@ -41,7 +54,7 @@ class FFState;
 LanguageModel *ConstructKenLM(const std::string &line);
 
 //! This will also load. Returns a templated KenLM class
-LanguageModel *ConstructKenLM(const std::string &line, const std::string &file, FactorType factorType, bool lazy);
+LanguageModel *ConstructKenLM(const std::string &line, const std::string &file, FactorType factorType, util::LoadMethod load_method);
 
 /*
  * An implementation of single factor LM using Kenneth's code.
@@ -49,33 +62,113 @@ LanguageModel *ConstructKenLM(const std::string &line, const std::string &file,
 template <class Model> class LanguageModelKen : public LanguageModel
 {
 public:
-  LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, bool lazy);
+  LanguageModelKen(const std::string &line, const std::string &file, FactorType factorType, util::LoadMethod load_method);
 
   virtual const FFState *EmptyHypothesisState(const InputType &/*input*/) const;
 
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
+  virtual void CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
+
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases) const;
+
+  virtual void EvaluateInIsolation(const Phrase &source
+                                   , const TargetPhrase &targetPhrase
+                                   , ScoreComponentCollection &scoreBreakdown
+                                   , ScoreComponentCollection &estimatedFutureScore) const;
+
   virtual FFState *EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
+  //! length and words of the n-gram state
+  virtual size_t GetStateKeySize() const {
+    return KENLM_MAX_ORDER;
+  }
+
+  virtual void WriteStateKey(const FFState &state, uint32_t *key) const;
+
+  virtual bool HasStateHash() const {
+    return true;
+  }
+
   virtual FFState *EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
   virtual FFState *EvaluateWhenApplied(const Syntax::SHyperedge& hyperedge, int featureID, ScoreComponentCollection *accumulator) const;
 
+  virtual void InitializeForInput(InputType const& source);
+
+  virtual void CleanUpAfterSentenceProcessing(const InputType& source);
+
+  //! needs reloadable=true; the new file must be of the same model type
+  virtual void Reload(const std::string &path);
+
+  virtual bool CanEvaluateOnAnyThread() const {
+    // other threads don't see which model the sentence was started with
+    return !m_reloadable;
+  }
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+  //! the current model and the score cache
+  virtual void ReportMemory(MemoryUsage &usage) const;
+
   virtual void IncrementalCallback(Incremental::Manager &manager) const;
   virtual void ReportHistoryOrder(std::ostream &out,const Phrase &phrase) const;
 
   virtual bool IsUseable(const FactorMask &mask) const;
 
 protected:
-  boost::shared_ptr<Model> m_ngram;
+  //! a model and its vocabulary mapping, replaced together by Reload()
+  struct Loaded {
+    boost::shared_ptr<Model> ngram;
+    std::vector<lm::WordIndex> lmIdLookup;
+    size_t generation;
+    uint64_t fingerprint; //!< of the model file on our factor, see PrecomputedScores.h
+  };
+
+  /** Pins the current model for the calling thread while it lives, unless
+   *  the thread is decoding a sentence, which has pinned one already. The
+   *  entry points make one, as they may also be called between sentences
+   *  (e.g. scoring phrases while a table loads), so that a concurrent
+   *  Reload() can't free the model they use.
+   */
+  class ScopedPin
+  {
+  public:
+    explicit ScopedPin(const LanguageModelKen &lm) : m_lm(lm), m_owned(false) {
+      if (lm.m_reloadable && !lm.m_pinned.get()) {
+        lm.m_pinned.reset(new boost::shared_ptr<const Loaded>(lm.GetCurrent()));
+        m_owned = true;
+      }
+    }
+    ~ScopedPin() {
+      if (m_owned) m_lm.m_pinned.reset();
+    }
+  private:
+    const LanguageModelKen &m_lm;
+    bool m_owned;
+  };
+
+  //! the model pinned by the sentence this thread is decoding, or by a
+  //! ScopedPin
+  const Loaded &GetLoaded() const {
+    if (!m_reloadable) return *m_loaded;
+    boost::shared_ptr<const Loaded> *pinned = m_pinned.get();
+    UTIL_THROW_IF2(pinned == NULL, GetScoreProducerDescription()
+                   << ": reloadable model used without pinning it");
+    return **pinned;
+  }
+  const Model &GetModel() const {
+    return *GetLoaded().ngram;
+  }
 
   const Factor *m_beginSentenceFactor;
 
   FactorType m_factorType;
 
   lm::WordIndex TranslateID(const Word &word) const {
+    const std::vector<lm::WordIndex> &lookup = GetLoaded().lmIdLookup;
     std::size_t factor = word.GetFactor(m_factorType)->GetId();
-    return (factor >= m_lmIdLookup.size() ? 0 : m_lmIdLookup[factor]);
+    return (factor >= lookup.size() ? 0 : lookup[factor]);
   }
 
 private:
@@ -84,19 +177,102 @@ private:
   // Convert last words of hypothesis into vocab ids, returning an end pointer.
   lm::WordIndex *LastIDs(const Hypothesis &hypo, lm::WordIndex *indices) const {
     lm::WordIndex *index = indices;
-    lm::WordIndex *end = indices + m_ngram->Order() - 1;
+    const Model &model = GetModel();
+    lm::WordIndex *end = indices + model.Order() - 1;
     int position = hypo.GetCurrTargetWordsRange().GetEndPos();
     for (; ; ++index, --position) {
       if (index == end) return index;
       if (position == -1) {
-        *index = m_ngram->GetVocabulary().BeginSentence();
+        *index = model.GetVocabulary().BeginSentence();
         return index + 1;
       }
       *index = TranslateID(hypo.GetWord(position));
     }
   }
 
-  std::vector<lm::WordIndex> m_lmIdLookup;
+  boost::shared_ptr<Loaded> Load(const std::string &file) const;
+  boost::shared_ptr<const Loaded> GetCurrent() const;
+
+  std::string m_file;
+  util::LoadMethod m_loadMethod;
+  bool m_reloadable;
+
+  // The current model. Once reloadable, a sentence pins the model that was
+  // current when it started, so a reload never changes it mid-sentence.
+  boost::shared_ptr<const Loaded> m_loaded;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_loadedMutex;
+  mutable boost::thread_specific_ptr<boost::shared_ptr<const Loaded> > m_pinned;
+#else
+  mutable boost::scoped_ptr<boost::shared_ptr<const Loaded> > m_pinned;
+#endif
+
+  /* Scores of phrases seen before by any thread, keyed on their vocab ids.
+   * Target phrases recur across sentences (and across tables), this saves
+   * probing the model again for each of them. The cache is split into
+   * shards with a lock each so that threads rarely wait for each other; a
+   * full shard is emptied. Entries of an earlier model (see Reload) are
+   * misses.
+   */
+  struct ScoreCacheEntry {
+    float fullScore, ngramScore;
+    size_t oovCount;
+    size_t generation; //!< of the model the scores are from
+  };
+  typedef boost::unordered_map<std::vector<lm::WordIndex>, ScoreCacheEntry> ScoreCacheMap;
+  struct ScoreCacheShard {
+    ScoreCacheMap scores;
+    uint64_t hits, misses;
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+#endif
+    ScoreCacheShard() : hits(0), misses(0) {}
+  };
+  static const size_t kScoreCacheShards = 16;
+  mutable ScoreCacheShard m_scoreCache[kScoreCacheShards];
+
+  // buffer for the key of a phrase, per thread
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<std::vector<lm::WordIndex> > m_scoreKey;
+#else
+  mutable boost::scoped_ptr<std::vector<lm::WordIndex> > m_scoreKey;
+#endif
+
+  /* Per-sentence memo of phrase-based extensions. Hypotheses that recombine
+   * on the LM state are often extended with the same target phrase; the
+   * score and resulting state only depend on that pair (and on whether the
+   * sentence end gets scored), so they are computed once.
+   */
+  struct ExtensionKey {
+    const TargetPhrase *targetPhrase;
+    lm::ngram::State state;
+    bool sourceCompleted;
+
+    bool operator==(const ExtensionKey &other) const {
+      return targetPhrase == other.targetPhrase
+             && sourceCompleted == other.sourceCompleted
+             && state == other.state;
+    }
+  };
+  struct ExtensionKeyHasher {
+    size_t operator()(const ExtensionKey &key) const;
+  };
+  struct ExtensionResult {
+    float score;
+    lm::ngram::State state;
+  };
+  typedef boost::unordered_map<ExtensionKey, ExtensionResult, ExtensionKeyHasher> ExtensionMemo;
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ExtensionMemo> m_extensionMemo;
+#else
+  mutable boost::scoped_ptr<ExtensionMemo> m_extensionMemo;
+#endif
+
+  std::vector<lm::WordIndex> &GetScoreKey() const;
+  ScoreCacheShard &GetScoreCacheShard(const std::vector<lm::WordIndex> &key) const;
+  ExtensionMemo &GetExtensionMemo() const;
+  void PhraseKey(const Phrase &phrase, std::vector<lm::WordIndex> &key) const;
 
 };
 
@@ -11,6 +11,7 @@ namespace Moses
 {
 NeuralLMWrapper::NeuralLMWrapper(const std::string &line)
   :LanguageModelSingleFactor(line)
+  ,m_batch(false)
 {
   ReadParameters();
 }
@@ -46,14 +47,28 @@ void NeuralLMWrapper::Load()
 }
 
 
-LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+void NeuralLMWrapper::SetParameter(const std::string& key, const std::string& value)
 {
+  if (key == "batch") {
+    m_batch = Scan<bool>(value);
+  } else {
+    LanguageModelSingleFactor::SetParameter(key, value);
+  }
+}
 
+nplm::neuralLM &NeuralLMWrapper::GetThreadLM() const
+{
   if (!m_neuralLM.get()) {
     m_neuralLM.reset(new nplm::neuralLM(*m_neuralLM_shared));
     //TODO: config option?
     m_neuralLM->set_cache(1000000);
   }
+  return *m_neuralLM;
+}
+
+LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+{
+  nplm::neuralLM &neuralLM = GetThreadLM();
   size_t hashCode = 0;
 
   vector<int> words(contextFactor.size());
@@ -61,23 +76,59 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
     const Word* word = contextFactor[i];
     const Factor* factor = word->GetFactor(m_factorType);
     const std::string string = factor->GetString().as_string();
-    int neuralLM_wordID = m_neuralLM->lookup_word(string);
+    int neuralLM_wordID = neuralLM.lookup_word(string);
     words[i] = neuralLM_wordID;
     boost::hash_combine(hashCode, neuralLM_wordID);
   }
 
-  double value = m_neuralLM->lookup_ngram(words);
-
   // Create a new struct to hold the result
   LMResult ret;
-  ret.score = FloorScore(value);
   ret.unknown = (words.back() == m_unk);
 
+  if (m_scoreCache.IsRecording()) {
+    // first pass of a batch: only note what has to be scored
+    m_scoreCache.Record(words);
+    ret.score = 0;
+  } else if (!m_scoreCache.Find(words, ret.score)) {
+    ret.score = FloorScore(neuralLM.lookup_ngram(words));
+    m_scoreCache.Add(words, ret.score);
+  }
+
   (*finalState) = (State*) hashCode;
 
   return ret;
 }
 
-}
+void NeuralLMWrapper::EvaluateWhenAppliedBatch(
+  const std::vector<const Hypothesis*> &hypos,
+  const std::vector<const FFState*> &prev_states,
+  const std::vector<ScoreComponentCollection*> &accumulators,
+  std::vector<FFState*> &out_states) const
+{
+  std::vector<NeuralScoreCache::NGram> pending;
+  m_scoreCache.CollectBatch(*this, hypos, prev_states, m_nGramOrder, pending);
+
+  if (!pending.empty()) {
+    // one forward pass over all new n-grams, one per column
+    nplm::neuralLM &neuralLM = GetThreadLM();
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> ngrams(m_nGramOrder, pending.size());
+    for (size_t j = 0; j < pending.size(); ++j) {
+      for (size_t i = 0; i < m_nGramOrder; ++i) {
+        ngrams(i, j) = pending[j][i];
+      }
+    }
+    Eigen::Matrix<double, 1, Eigen::Dynamic> logProbs(pending.size());
+    neuralLM.set_width(pending.size());
+    neuralLM.lookup_ngram(ngrams, logProbs);
+    neuralLM.set_width(1);
+
+    for (size_t j = 0; j < pending.size(); ++j) {
+      m_scoreCache.Add(pending[j], FloorScore(logProbs(j)));
+    }
+  }
 
+  // now every full n-gram is cached
+  LanguageModelSingleFactor::EvaluateWhenAppliedBatch(hypos, prev_states, accumulators, out_states);
+}
 
+}
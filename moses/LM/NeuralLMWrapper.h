@@ -1,6 +1,7 @@
 #pragma once
 
 #include "SingleFactor.h"
+#include "NeuralScoreCache.h"
 
 #include <boost/thread/tss.hpp>
 
@@ -20,6 +21,11 @@ protected:
   // thread-specific nplm for thread-safety
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
   int m_unk;
+  // scores shared by all threads, also used to batch up network queries
+  mutable NeuralScoreCache m_scoreCache;
+  bool m_batch;
+
+  nplm::neuralLM &GetThreadLM() const;
 
 public:
   NeuralLMWrapper(const std::string &line);
@@ -27,6 +33,18 @@ public:
 
   virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
 
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+  virtual bool IsBatchable() const {
+    return m_batch;
+  }
+
+  virtual void EvaluateWhenAppliedBatch(
+    const std::vector<const Hypothesis*> &hypos,
+    const std::vector<const FFState*> &prev_states,
+    const std::vector<ScoreComponentCollection*> &accumulators,
+    std::vector<FFState*> &out_states) const;
+
   virtual void Load();
 
 };
@@ -0,0 +1,86 @@
+#include <boost/functional/hash.hpp>
+#include "NeuralScoreCache.h"
+#include "moses/FF/StatefulFeatureFunction.h"
+#include "moses/FF/FFState.h"
+#include "moses/ScoreComponentCollection.h"
+
+namespace Moses
+{
+
+NeuralScoreCache::NeuralScoreCache(size_t maxSize)
+  :m_maxShardSize(maxSize / NumShards + 1)
+{
+}
+
+NeuralScoreCache::Shard &NeuralScoreCache::GetShard(const NGram &ngram) const
+{
+  return m_shards[boost::hash_range(ngram.begin(), ngram.end()) % NumShards];
+}
+
+bool NeuralScoreCache::Find(const NGram &ngram, float &score) const
+{
+  const Shard &shard = GetShard(ngram);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  boost::unordered_map<NGram, float>::const_iterator iter = shard.scores.find(ngram);
+  if (iter == shard.scores.end()) {
+    return false;
+  }
+  score = iter->second;
+  return true;
+}
+
+void NeuralScoreCache::Add(const NGram &ngram, float score)
+{
+  Shard &shard = GetShard(ngram);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  if (shard.scores.size() >= m_maxShardSize) {
+    shard.scores.clear();
+  }
+  shard.scores[ngram] = score;
+}
+
+void NeuralScoreCache::Record(const NGram &ngram)
+{
+  Recording &rec = *m_recording;
+  if (ngram.size() != rec.order) {
+    // partial n-grams (sentence start) are scored one by one later
+    return;
+  }
+  float ignored;
+  if (!rec.seen.insert(ngram).second || Find(ngram, ignored)) {
+    return;
+  }
+  rec.ngrams.push_back(ngram);
+}
+
+void NeuralScoreCache::CollectBatch(const StatefulFeatureFunction &ff
+                                    , const std::vector<const Hypothesis*> &hypos
+                                    , const std::vector<const FFState*> &prev_states
+                                    , size_t order
+                                    , std::vector<NGram> &pending)
+{
+  if (!m_recording.get()) {
+    m_recording.reset(new Recording());
+  }
+  Recording &rec = *m_recording;
+  rec.active = true;
+  rec.order = order;
+
+  // states only depend on the words, so this pass yields the same n-grams
+  // the real evaluation will ask for; its scores are thrown away
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    ScoreComponentCollection scratch;
+    delete ff.EvaluateWhenApplied(*hypos[i], prev_states[i], &scratch);
+  }
+
+  rec.active = false;
+  pending.swap(rec.ngrams);
+  rec.ngrams.clear();
+  rec.seen.clear();
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/thread/tss.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+class FFState;
+class Hypothesis;
+class StatefulFeatureFunction;
+
+/** n-gram scores of a neural LM, shared by all decoding threads.
+ *  It also supports batched scoring: while a thread is recording, the
+ *  model's score function registers the n-grams it would need instead of
+ *  running the network, so they can all be put through the network in one
+ *  matrix product and the normal evaluation then finds them here.
+ */
+class NeuralScoreCache
+{
+public:
+  typedef std::vector<int> NGram;
+
+  explicit NeuralScoreCache(size_t maxSize = 1000000);
+
+  bool Find(const NGram &ngram, float &score) const;
+  void Add(const NGram &ngram, float score);
+
+  //! whether the calling thread is in the recording pass of a batch
+  bool IsRecording() const {
+    return m_recording.get() && m_recording->active;
+  }
+  //! remember ngram for the current batch unless it is already known
+  void Record(const NGram &ngram);
+
+  /** Run ff over the batch with scoring switched off and return the distinct
+   *  n-grams of length order that are not cached yet.
+   */
+  void CollectBatch(const StatefulFeatureFunction &ff
+                    , const std::vector<const Hypothesis*> &hypos
+                    , const std::vector<const FFState*> &prev_states
+                    , size_t order
+                    , std::vector<NGram> &pending);
+
+private:
+  static const size_t NumShards = 16;
+
+  struct Shard {
+    boost::unordered_map<NGram, float> scores;
+#ifdef WITH_THREADS
+    mutable boost::mutex mutex;
+#endif
+  };
+
+  struct Recording {
+    bool active;
+    size_t order;
+    boost::unordered_set<NGram> seen;
+    std::vector<NGram> ngrams;
+    Recording() : active(false), order(0) {}
+  };
+
+  Shard &GetShard(const NGram &ngram) const;
+
+  mutable Shard m_shards[NumShards];
+  size_t m_maxShardSize;
+  boost::thread_specific_ptr<Recording> m_recording;
+};
+
+}
@@ -95,13 +95,37 @@ LMResult LanguageModelORLM::GetValue(const std::vector<const Word*> &contextFact
 }
 bool LanguageModelORLM::UpdateORLM(const std::vector<string>& ngram, const int value)
 {
-  /*cerr << "Inserting into ORLM: \"";
-  iterate(ngram, nit)
-    cerr << *nit << " ";
-  cerr << "\"\t" << value << endl; */
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_pendingMutex);
+#endif
+  m_pendingUpdates.push_back(std::make_pair(ngram, value));
+  return true;
+}
+size_t LanguageModelORLM::ApplyUpdates()
+{
+  std::vector<std::pair<std::vector<string>, int> > updates;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_pendingMutex);
+#endif
+    updates.swap(m_pendingUpdates);
+  }
+  if (updates.empty()) return 0;
+
+  // open the vocabulary once for the whole batch
+  size_t inserted = 0;
   m_lm->vocab_->MakeOpen();
-  bool res = m_lm->update(ngram, value);
+  for (size_t i = 0; i < updates.size(); ++i) {
+    if (m_lm->update(updates[i].first, updates[i].second)) ++inserted;
+  }
   m_lm->vocab_->MakeClosed();
-  return res;
+  VERBOSE(2, "ORLM: inserted " << inserted << " of " << updates.size() << " n-grams" << std::endl);
+  return inserted;
+}
+void LanguageModelORLM::CleanUpAfterSentenceProcessing(const InputType& source)
+{
+  // the cache has scores from before the updates
+  ApplyUpdates();
+  m_lm->clearCache();
 }
 }
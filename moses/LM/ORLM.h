@@ -2,6 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
 #include "moses/Factor.h"
 #include "moses/Util.h"
 #include "SingleFactor.h"
@@ -35,11 +39,15 @@ public:
     fout.close();
     delete m_lm;
   }
-  void CleanUpAfterSentenceProcessing() {
-    m_lm->clearCache(); // clear caches
-  }
+  // the queued updates are applied here, between sentences
+  void CleanUpAfterSentenceProcessing(const InputType& source);
 
+  /** queue an n-gram count. Queries and updates go through the same
+   *  filters and cache (which holds the LM states), so updates from other
+   *  threads are only applied between sentences. */
   bool UpdateORLM(const std::vector<string>& ngram, const int value);
+  //! apply the queued updates, returns how many n-grams were inserted
+  size_t ApplyUpdates();
 protected:
   OnlineRLM<T>* m_lm;
   //MultiOnlineRLM<T>* m_lm;
@@ -48,6 +56,11 @@ protected:
   void CreateFactors();
   wordID_t GetLmID(const std::string &str) const;
   wordID_t GetLmID(const Factor *factor) const;
+
+  std::vector<std::pair<std::vector<string>, int> > m_pendingUpdates;
+#ifdef WITH_THREADS
+  boost::mutex m_pendingMutex;
+#endif
 };
 } // end namespace
 
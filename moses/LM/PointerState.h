@@ -1,5 +1,7 @@
 #pragma once
 
+#include <boost/functional/hash.hpp>
+
 #include "moses/FF/FFState.h"
 
 namespace Moses
@@ -16,6 +18,9 @@ struct PointerState : public FFState {
     else if (other.lmstate < lmstate) return -1;
     return 0;
   }
+  std::size_t hash() const {
+    return boost::hash<const void*>()(lmstate);
+  }
 };
 
 } // namespace
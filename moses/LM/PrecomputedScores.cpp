@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <vector>
+
+#include "lm/binary_format.hh"
+#include "lm/left.hh"
+#include "lm/model.hh"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+#include "util/tokenize_piece.hh"
+
+#include "PrecomputedScores.h"
+#include "moses/TypeDef.h"
+#include "moses/Util.h"
+
+namespace Moses
+{
+
+class PrecomputedLMScorer::Impl
+{
+public:
+  virtual ~Impl() {}
+  //! words of the target, NULL data for non-terminals
+  virtual void Score(const std::vector<StringPiece> &words, float *scores) const = 0;
+};
+
+namespace
+{
+
+// How much of the model file goes into its fingerprint, besides its size:
+// the headers of ARPA and binary files, which hold the n-gram counts.
+const size_t kFingerprintBytes = 1 << 20;
+
+template <class Model> class ScorerImpl : public PrecomputedLMScorer::Impl
+{
+public:
+  explicit ScorerImpl(const std::string &path) {
+    lm::ngram::Config config;
+    config.messages = NULL;
+    m_model.reset(new Model(path.c_str(), config));
+  }
+
+  // as LanguageModelKen::CalcScore()
+  void Score(const std::vector<StringPiece> &words, float *scores) const {
+    float fullScore = 0;
+    size_t oovCount = 0;
+    scores[0] = scores[1] = scores[2] = 0;
+    if (words.empty()) return;
+
+    lm::ngram::ChartState discarded;
+    lm::ngram::RuleScore<Model> scorer(*m_model, discarded);
+
+    size_t position = 0;
+    if (words[0].data() && words[0] == StringPiece(BOS_)) {
+      scorer.BeginSentence();
+      position = 1;
+    }
+
+    size_t endLoop = std::min<size_t>(m_model->Order() - 1, words.size());
+    for (; position < endLoop; ++position) {
+      Terminal(scorer, words[position], fullScore, oovCount);
+    }
+    float beforeBoundary = fullScore + scorer.Finish();
+    for (; position < words.size(); ++position) {
+      Terminal(scorer, words[position], fullScore, oovCount);
+    }
+    fullScore += scorer.Finish();
+
+    scores[0] = TransformLMScore(fullScore);
+    scores[1] = TransformLMScore(fullScore - beforeBoundary);
+    scores[2] = oovCount;
+  }
+
+private:
+  boost::scoped_ptr<Model> m_model;
+
+  void Terminal(lm::ngram::RuleScore<Model> &scorer, const StringPiece &word, float &fullScore, size_t &oovCount) const {
+    if (!word.data()) {
+      fullScore += scorer.Finish();
+      scorer.Reset();
+    } else {
+      lm::WordIndex index = m_model->GetVocabulary().Index(word);
+      scorer.Terminal(index);
+      if (!index) ++oovCount;
+    }
+  }
+};
+
+PrecomputedLMScorer::Impl *CreateScorer(const std::string &path)
+{
+  lm::ngram::ModelType type;
+  if (!lm::ngram::RecognizeBinary(path.c_str(), type)) {
+    return new ScorerImpl<lm::ngram::ProbingModel>(path);
+  }
+  switch (type) {
+  case lm::ngram::PROBING:
+    return new ScorerImpl<lm::ngram::ProbingModel>(path);
+  case lm::ngram::REST_PROBING:
+    return new ScorerImpl<lm::ngram::RestProbingModel>(path);
+  case lm::ngram::TRIE:
+    return new ScorerImpl<lm::ngram::TrieModel>(path);
+  case lm::ngram::QUANT_TRIE:
+    return new ScorerImpl<lm::ngram::QuantTrieModel>(path);
+  case lm::ngram::ARRAY_TRIE:
+    return new ScorerImpl<lm::ngram::ArrayTrieModel>(path);
+  case lm::ngram::QUANT_ARRAY_TRIE:
+    return new ScorerImpl<lm::ngram::QuantArrayTrieModel>(path);
+  default:
+    UTIL_THROW2("Unrecognized kenlm model type " << type);
+  }
+}
+
+} // namespace
+
+PrecomputedLMScorer::PrecomputedLMScorer(const std::string &path, size_t factor, bool hierarchical)
+  : m_impl(CreateScorer(path))
+  , m_fingerprint(Fingerprint(path, factor))
+  , m_factor(factor)
+  , m_hierarchical(hierarchical)
+{
+}
+
+PrecomputedLMScorer::~PrecomputedLMScorer() {}
+
+void PrecomputedLMScorer::Score(const StringPiece &target, float *scores) const
+{
+  std::vector<StringPiece> words;
+  for (util::TokenIter<util::AnyCharacter, true> word(target, util::AnyCharacter(" \t")); word; ++word) {
+    if (m_hierarchical && word->size() >= 2 && (*word)[0] == '[' && (*word)[word->size() - 1] == ']') {
+      words.push_back(StringPiece());
+      continue;
+    }
+    // a missing factor is unknown to the model, as in the decoder
+    StringPiece factor("", 0);
+    util::TokenIter<util::SingleCharacter> f(*word, util::SingleCharacter('|'));
+    for (size_t i = 0; f && i < m_factor; ++i) ++f;
+    if (f) factor = *f;
+    words.push_back(factor);
+  }
+  // the left hand side label
+  if (m_hierarchical && !words.empty()) {
+    words.pop_back();
+  }
+  m_impl->Score(words, scores);
+}
+
+uint64_t PrecomputedLMScorer::Fingerprint(const std::string &path, size_t factor)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeFile(file.get());
+  UTIL_THROW_IF2(size == util::kBadSize, "Cannot get the size of " << path);
+
+  std::vector<char> head(std::min<uint64_t>(size, kFingerprintBytes));
+  if (!head.empty()) {
+    util::ErsatzPRead(file.get(), &head[0], head.size(), 0);
+  }
+  uint64_t fingerprint = util::MurmurHashNative(head.empty() ? NULL : &head[0], head.size(), size);
+  fingerprint = util::MurmurHashNative(&factor, sizeof(factor), fingerprint);
+  return fingerprint ? fingerprint : 1;
+}
+
+}
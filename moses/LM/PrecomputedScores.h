@@ -0,0 +1,52 @@
+// -*- c++ -*-
+#pragma once
+
+#include <string>
+#include <boost/scoped_ptr.hpp>
+#include <stdint.h>
+
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** Scores the target sides of a text phrase table with a KenLM model the way
+ *  LanguageModelKen scores target phrases in EvaluateInIsolation(), so that
+ *  binarizers can store the scores with the table (see -lm of
+ *  processPhraseTableMin and CreateProbingPT). The scores are, in this
+ *  order, the full score, the score of the n-grams with full context and the
+ *  number of OOVs. No decoder needs to be set up, and Score() may be called
+ *  by several threads at once.
+ */
+class PrecomputedLMScorer
+{
+public:
+  //! how many scores Score() gives
+  static const size_t kNumScores = 3;
+
+  /** hierarchical: targets end with the left hand side label, which isn't
+   *  scored, and words in brackets are non-terminals */
+  PrecomputedLMScorer(const std::string &path, size_t factor, bool hierarchical = false);
+  ~PrecomputedLMScorer();
+
+  //! target as in the table, with factors separated by |
+  void Score(const StringPiece &target, float *scores) const;
+
+  uint64_t GetFingerprint() const {
+    return m_fingerprint;
+  }
+
+  /** identifies the model in path used on a factor; tables hold the scores
+   *  of the LM with their fingerprint. Never 0. */
+  static uint64_t Fingerprint(const std::string &path, size_t factor);
+
+  class Impl;
+
+private:
+  boost::scoped_ptr<Impl> m_impl;
+  uint64_t m_fingerprint;
+  size_t m_factor;
+  bool m_hierarchical;
+};
+
+}
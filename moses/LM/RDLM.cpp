@@ -3,6 +3,7 @@
 #include "moses/StaticData.h"
 #include "moses/ScoreComponentCollection.h"
 #include "moses/ChartHypothesis.h"
+#include "moses/PP/TreeStructurePhraseProperty.h"
 #include "moses/InputFileStream.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
@@ -773,9 +774,9 @@ FFState* RDLM::EvaluateWhenApplied(const ChartHypothesis& cur_hypo
                                    , int featureID /* used to index the state in the previous hypotheses */
                                    , ScoreComponentCollection* accumulator) const
 {
-  if (const PhraseProperty *property = cur_hypo.GetCurrTargetPhrase().GetProperty("Tree")) {
-    const std::string *tree = property->GetValueString();
-    TreePointer mytree (boost::make_shared<InternalTree>(*tree));
+  if (const PhraseProperty *property = cur_hypo.GetCurrTargetPhrase().GetProperty(m_treeKey)) {
+    // built from the rule's fragment, no string to parse
+    TreePointer mytree (static_cast<const TreeStructurePhraseProperty*>(property)->GetTree());
 
     //get subtrees (in target order)
     std::vector<TreePointer> previous_trees;
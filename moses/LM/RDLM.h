@@ -3,6 +3,7 @@
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/FFState.h"
 #include "moses/FF/InternalTree.h"
+#include "moses/PP/Factory.h"
 
 #include <boost/thread/tss.hpp>
 #include <boost/array.hpp>
@@ -80,6 +81,7 @@ class RDLM : public StatefulFeatureFunction
   std::string m_debugPath; // score all trees in the provided file, then exit
   int m_binarized;
   int m_cacheSize;
+  size_t m_treeKey; //!< id of the "Tree" property
 
   size_t offset_up_head;
   size_t offset_up_label;
@@ -122,8 +124,10 @@ public:
     , m_sharedVocab(false)
     , m_binarized(0)
     , m_cacheSize(1000000)
+    , m_treeKey(PhrasePropertyFactory::GetKeyId("Tree"))
     {
       ReadParameters();
+      PhrasePropertyFactory::DecodeOnLoad("Tree");
     }
 
   ~RDLM();
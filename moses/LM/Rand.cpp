@@ -45,6 +45,8 @@ LanguageModelRandLM::LanguageModelRandLM(const std::string &line)
   :LanguageModelSingleFactor(line)
   , m_lm(0)
 {
+  // remember phrase scores, the filters are probed once per n-gram
+  m_cacheScores = true;
 }
 
 LanguageModelRandLM::~LanguageModelRandLM()
@@ -1,144 +1,301 @@
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include "Remote.h"
+#include "moses/FF/FFState.h"
 #include "moses/Factor.h"
+#include "moses/FactorCollection.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
+#include "util/tokenize_piece.hh"
+
+using namespace std;
 
 namespace Moses
 {
 
-const Factor* LanguageModelRemote::BOS = NULL;
-const Factor* LanguageModelRemote::EOS = (LanguageModelRemote::BOS + 1);
+namespace
+{
+// points per server on the hash ring
+const size_t kVirtualNodes = 64;
+// queries sent to one server before reading its replies, so that neither
+// side's socket buffers fill up while the other isn't reading
+const size_t kMaxInFlight = 20000;
+
+uint64_t HashString(const string &str)
+{
+  return util::MurmurHashNative(str.data(), str.size());
+}
+
+void WriteAll(int sock, const string &data)
+{
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t put = write(sock, data.data() + done, data.size() - done);
+    UTIL_THROW_IF2(put < 0, "Writing to the LM server failed: " << strerror(errno));
+    done += put;
+  }
+}
+}
+
+LanguageModelRemote::ThreadData::~ThreadData()
+{
+  for (size_t i = 0; i < sockets.size(); ++i) {
+    if (sockets[i] != -1) close(sockets[i]);
+  }
+}
+
+LanguageModelRemote::LanguageModelRemote(const std::string &line)
+  :LanguageModelSingleFactor(line)
+{
+  ReadParameters();
+
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_sentenceStart = factorCollection.AddFactor(Output, m_factorType, BOS_);
+  m_sentenceStartWord[m_factorType] = m_sentenceStart;
+  m_sentenceEnd = factorCollection.AddFactor(Output, m_factorType, EOS_);
+  m_sentenceEndWord[m_factorType] = m_sentenceEnd;
+
+  util::TokenIter<util::SingleCharacter, true> it(m_filePath, ',');
+  for (; it; ++it) {
+    size_t cutAt = it->rfind(':');
+    UTIL_THROW_IF2(cutAt == StringPiece::npos, "RemoteLM needs path=host:port[,host:port...], got " << m_filePath);
+    m_servers.push_back(make_pair(it->substr(0, cutAt).as_string(), it->substr(cutAt + 1).as_string()));
+    for (size_t v = 0; v < kVirtualNodes; ++v) {
+      m_ring.push_back(make_pair(HashString(it->as_string() + "#" + SPrint(v)), m_servers.size() - 1));
+    }
+  }
+  UTIL_THROW_IF2(m_servers.empty(), "RemoteLM needs path=host:port[,host:port...]");
+  std::sort(m_ring.begin(), m_ring.end());
+}
 
-bool LanguageModelRemote::Load(const std::string &filePath
-                               , FactorType factorType
-                               , size_t nGramOrder)
+LanguageModelRemote::~LanguageModelRemote()
 {
-  m_factorType    = factorType;
-  m_nGramOrder    = nGramOrder;
+}
 
-  int cutAt = filePath.find(':',0);
-  std::string host = filePath.substr(0,cutAt);
-  //std::cerr << "port string = '" << filePath.substr(cutAt+1,filePath.size()-cutAt) << "'\n";
-  int port = atoi(filePath.substr(cutAt+1,filePath.size()-cutAt).c_str());
-  bool good = start(host,port);
-  if (!good) {
-    std::cerr << "failed to connect to lm server on " << host << " on port " << port << std::endl;
+void LanguageModelRemote::Load()
+{
+  // fail early if a server is unreachable
+  ThreadData &data = GetThreadData();
+  for (size_t i = 0; i < m_servers.size(); ++i) {
+    data.sockets[i] = Connect(i);
   }
-  ClearSentenceCache();
-  return good;
 }
 
+LanguageModelRemote::ThreadData &LanguageModelRemote::GetThreadData() const
+{
+  ThreadData *data = m_threadData.get();
+  if (data == NULL) {
+    data = new ThreadData(m_servers.size());
+    m_threadData.reset(data);
+  }
+  return *data;
+}
+
+size_t LanguageModelRemote::GetServer(const std::string &query) const
+{
+  vector<pair<uint64_t, size_t> >::const_iterator it
+    = std::lower_bound(m_ring.begin(), m_ring.end(), make_pair(HashString(query), size_t(0)));
+  return (it == m_ring.end() ? m_ring.front() : *it).second;
+}
 
-bool LanguageModelRemote::start(const std::string& host, int port)
+int LanguageModelRemote::Connect(size_t server) const
 {
-  //std::cerr << "host = " << host << ", port = " << port << "\n";
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-  hp = gethostbyname(host.c_str());
-  if (hp==NULL) {
-    herror("gethostbyname failed");
-    exit(1);
+  const string &host = m_servers[server].first;
+  const string &port = m_servers[server].second;
+  struct addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+  UTIL_THROW_IF2(err, "Cannot resolve LM server " << host << ": " << gai_strerror(err));
+
+  int sock = -1;
+  for (int attempt = 0; sock == -1 && attempt < 5; ++attempt) {
+    if (attempt) sleep(1);
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+      sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (sock == -1) continue;
+      if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) break;
+      close(sock);
+      sock = -1;
+    }
   }
+  freeaddrinfo(res);
+  UTIL_THROW_IF2(sock == -1, "Failed to connect to LM server on " << host << " port " << port);
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return sock;
+}
 
-  bzero((char *)&server, sizeof(server));
-  bcopy(hp->h_addr, (char *)&server.sin_addr, hp->h_length);
-  server.sin_family = hp->h_addrtype;
-  server.sin_port = htons(port);
-
-  int errors = 0;
-  while (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
-    //std::cerr << "Error: connect()\n";
-    sleep(1);
-    errors++;
-    if (errors > 5) return false;
+void LanguageModelRemote::Flush(ThreadData &data) const
+{
+  vector<size_t> sent(m_servers.size(), 0);
+  bool more = true;
+  string buffer;
+  while (more) {
+    // send a round of queries to every server, then collect the replies
+    vector<size_t> end(m_servers.size());
+    for (size_t s = 0; s < m_servers.size(); ++s) {
+      end[s] = std::min(data.queued[s].size(), sent[s] + kMaxInFlight);
+      if (sent[s] == end[s]) continue;
+      if (data.sockets[s] == -1) data.sockets[s] = Connect(s);
+      buffer.clear();
+      for (size_t i = sent[s]; i < end[s]; ++i) {
+        buffer += data.queued[s][i].second;
+      }
+      WriteAll(data.sockets[s], buffer);
+    }
+    more = false;
+    for (size_t s = 0; s < m_servers.size(); ++s) {
+      size_t next = sent[s];
+      buffer.clear();
+      while (next < end[s]) {
+        char chunk[65536];
+        ssize_t got = read(data.sockets[s], chunk, sizeof(chunk));
+        UTIL_THROW_IF2(got <= 0, "Reading from the LM server failed");
+        buffer.append(chunk, got);
+        size_t begin = 0, nl;
+        while (next < end[s] && (nl = buffer.find('\n', begin)) != string::npos) {
+          Node &node = *data.queued[s][next++].first;
+          float prob;
+          unsigned int length;
+          int oov;
+          UTIL_THROW_IF2(sscanf(buffer.c_str() + begin, "%f %u %d", &prob, &length, &oov) != 3,
+                         "Bad reply from the LM server: " << buffer.substr(begin, nl - begin));
+          node.prob = FloorScore(TransformLMScore(prob));
+          node.length = std::max(1u, length);
+          node.unknown = oov;
+          node.pending = false;
+          begin = nl + 1;
+        }
+        buffer.erase(0, begin);
+      }
+      sent[s] = end[s];
+      if (sent[s] < data.queued[s].size()) more = true;
+    }
+  }
+  for (size_t s = 0; s < m_servers.size(); ++s) {
+    data.queued[s].clear();
   }
-  return true;
 }
 
 LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFactor, State* finalState) const
 {
   LMResult ret;
   ret.unknown = false;
-  size_t count = contextFactor.size();
+  ret.score = 0.0;
+  const size_t count = std::min(contextFactor.size(), m_nGramOrder);
   if (count == 0) {
     if (finalState) *finalState = NULL;
-    ret.score = 0.0;
     return ret;
   }
-  //std::cerr << "contextFactor.size() = " << count << "\n";
-  size_t max = m_nGramOrder;
   const FactorType factor = GetFactorType();
-  if (max > count) max = count;
+  ThreadData &data = GetThreadData();
 
-  Cache* cur = &m_cache;
-  int pc = static_cast<int>(count) - 1;
-  for (int i = 0; i < pc; ++i) {
-    const Factor* f = contextFactor[i]->GetFactor(factor);
-    cur = &cur->tree[f ? f : BOS];
+  // the nodes of the last 1, 2, ... words
+  Node *path[MAX_NGRAM_SIZE];
+  Node *cur = &data.cache;
+  for (size_t i = 0; i < count; ++i) {
+    const Factor *f = contextFactor[contextFactor.size() - 1 - i]->GetFactor(factor);
+    cur = path[i] = &cur->tree[f];
   }
-  const Factor* event_word = contextFactor[pc]->GetFactor(factor);
-  cur = &cur->tree[event_word ? event_word : EOS];
-  if (cur->prob) {
-    if (finalState) *finalState = cur->boState;
-    ret.score = cur->prob;
-    return ret;
-  }
-  cur->boState = *reinterpret_cast<const State*>(&m_curId);
-  ++m_curId;
-
-  std::ostringstream os;
-  os << "prob ";
-  if (event_word == NULL) {
-    os << "</s>";
-  } else {
-    os << event_word->GetString();
-  }
-  for (size_t i=1; i<max; i++) {
-    const Factor* f = contextFactor[count-1-i]->GetFactor(factor);
-    if (f == NULL) {
-      os << " <s>";
-    } else {
-      os << ' ' << f->GetString();
+
+  if (cur->length == 0) {
+    if (!cur->pending) {
+      string query = "prob";
+      for (size_t i = 0; i < count; ++i) {
+        const Factor *f = contextFactor[contextFactor.size() - 1 - i]->GetFactor(factor);
+        query += ' ';
+        query += f ? f->GetString().as_string() : string(i ? BOS_ : EOS_);
+      }
+      query += '\n';
+      cur->pending = true;
+      data.queued[GetServer(query)].push_back(make_pair(cur, query));
     }
-  }
-  os << std::endl;
-  std::string out = os.str();
-  write(sock, out.c_str(), out.size());
-  char res[6];
-  int r = read(sock, res, 6);
-  int errors = 0;
-  int cnt = 0;
-  while (1) {
-    if (r < 0) {
-      errors++;
-      sleep(1);
-      //std::cerr << "Error: read()\n";
-      if (errors > 5) exit(1);
-    } else if (r==0 || res[cnt] == '\n') {
-      break;
-    } else {
-      cnt += r;
-      if (cnt==6) break;
-      read(sock, &res[cnt], 6-cnt);
+    if (data.collecting) {
+      // score and state don't matter, this pass is thrown away
+      if (finalState) *finalState = &data.cache;
+      return ret;
     }
+    Flush(data);
   }
-  cur->prob = FloorScore(TransformLMScore(*reinterpret_cast<float*>(res)));
+
+  ret.score = cur->prob;
+  ret.unknown = cur->unknown;
   if (finalState) {
-    *finalState = cur->boState;
+    size_t stateLength = std::min<size_t>(cur->length, m_nGramOrder - 1);
+    *finalState = stateLength ? path[stateLength - 1] : &data.cache;
   }
-  ret.score = cur->prob;
   return ret;
 }
 
-LanguageModelRemote::~LanguageModelRemote()
+void LanguageModelRemote::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
+{
+  ThreadData &data = GetThreadData();
+  data.collecting = true;
+  LanguageModelSingleFactor::CalcScore(phrase, fullScore, ngramScore, oovCount);
+  data.collecting = false;
+  Flush(data);
+  LanguageModelSingleFactor::CalcScore(phrase, fullScore, ngramScore, oovCount);
+}
+
+FFState *LanguageModelRemote::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
+{
+  ThreadData &data = GetThreadData();
+  data.collecting = true;
+  ScoreComponentCollection scratch;
+  delete LanguageModelSingleFactor::EvaluateWhenApplied(hypo, ps, &scratch);
+  data.collecting = false;
+  Flush(data);
+  return LanguageModelSingleFactor::EvaluateWhenApplied(hypo, ps, out);
+}
+
+FFState *LanguageModelRemote::EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const
+{
+  ThreadData &data = GetThreadData();
+  data.collecting = true;
+  ScoreComponentCollection scratch;
+  delete LanguageModelSingleFactor::EvaluateWhenApplied(cur_hypo, featureID, &scratch);
+  data.collecting = false;
+  Flush(data);
+  return LanguageModelSingleFactor::EvaluateWhenApplied(cur_hypo, featureID, accumulator);
+}
+
+void LanguageModelRemote::EvaluateWhenAppliedBatch(
+  const std::vector<const Hypothesis*> &hypos,
+  const std::vector<const FFState*> &prev_states,
+  const std::vector<ScoreComponentCollection*> &accumulators,
+  std::vector<FFState*> &out_states) const
+{
+  ThreadData &data = GetThreadData();
+  data.collecting = true;
+  ScoreComponentCollection scratch;
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    delete LanguageModelSingleFactor::EvaluateWhenApplied(*hypos[i], prev_states[i], &scratch);
+  }
+  data.collecting = false;
+  Flush(data);
+  out_states.resize(hypos.size());
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    out_states[i] = LanguageModelSingleFactor::EvaluateWhenApplied(*hypos[i], prev_states[i], accumulators[i]);
+  }
+}
+
+void LanguageModelRemote::CleanUpAfterSentenceProcessing(const InputType& source)
 {
-  // Step 8 When finished send all lingering transmissions and close the connection
-  close(sock);
+  ThreadData &data = GetThreadData();
+  data.cache.tree.clear();
 }
 
 }
@@ -1,46 +1,99 @@
 #ifndef moses_LanguageModelRemote_h
 #define moses_LanguageModelRemote_h
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
 #include "SingleFactor.h"
 #include "moses/TypeDef.h"
 #include "moses/Factor.h"
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <netinet/in.h>
 
 namespace Moses
 {
 
-/** @todo ask miles
+/** Language model queried over TCP from one or more lm_server processes
+ *  (lm/lm_server_main.cc), e.g.
+ *    RemoteLM path=host1:9090,host2:9090 order=5 factor=0
+ *  Every server must hold the whole model; queries are spread over them by
+ *  consistent hashing, so that adding a server moves few of them.
+ *
+ *  Queries are not sent one by one: scoring a phrase or hypothesis first
+ *  collects all n-grams that aren't cached, sends them to the servers in one
+ *  go and reads all replies, then scores from the cache. With the batch
+ *  search (-search-algorithm 5) whole batches of hypotheses are collected
+ *  at once. Each thread has its own connections and per-sentence cache.
  */
 class LanguageModelRemote : public LanguageModelSingleFactor
 {
 private:
-  struct Cache {
-    std::map<const Factor*, Cache> tree;
+  // Cache of n-gram scores, a trie from the predicted word backwards. The
+  // node of the last k words of an n-gram also serves as LM state.
+  struct Node {
+    std::map<const Factor*, Node> tree;
     float prob;
-    State boState;
-    Cache() : prob(0) {}
+    unsigned char length; //!< n-gram length the server matched; 0 until known
+    bool pending, unknown;
+    Node() : prob(0), length(0), pending(false), unknown(false) {}
+  };
+
+  struct ThreadData {
+    Node cache;
+    bool collecting; //!< only queue queries for uncached n-grams
+    std::vector<int> sockets; //!< per server, -1 until connected
+    std::vector<std::vector<std::pair<Node*, std::string> > > queued; //!< per server
+    ThreadData(size_t servers)
+      : collecting(false), sockets(servers, -1), queued(servers) {}
+    ~ThreadData();
   };
 
-  int sock, port;
-  struct hostent *hp;
-  struct sockaddr_in server;
-  mutable size_t m_curId;
-  mutable Cache m_cache;
-  bool start(const std::string& host, int port);
-  static const Factor* BOS;
-  static const Factor* EOS;
+  std::vector<std::pair<std::string, std::string> > m_servers; //!< host, port
+  std::vector<std::pair<uint64_t, size_t> > m_ring; //!< hash, server
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ThreadData> m_threadData;
+#else
+  mutable boost::scoped_ptr<ThreadData> m_threadData;
+#endif
+
+  ThreadData &GetThreadData() const;
+  size_t GetServer(const std::string &query) const;
+  int Connect(size_t server) const;
+  //! send all queued queries and store the replies in the cache
+  void Flush(ThreadData &data) const;
+
 public:
+  LanguageModelRemote(const std::string &line);
   ~LanguageModelRemote();
-  void ClearSentenceCache() {
-    m_cache.tree.clear();
-    m_curId = 1000;
+
+  void Load();
+
+  bool CanEvaluateOnAnyThread() const {
+    return false;
+  }
+  bool IsBatchable() const {
+    return true;
   }
+
+  void CleanUpAfterSentenceProcessing(const InputType& source);
+
   virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
-  bool Load(const std::string &filePath
-            , FactorType factorType
-            , size_t nGramOrder);
+
+  // each of these collects the uncached n-grams first, see above
+  void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
+  FFState *EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
+  FFState *EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
+  void EvaluateWhenAppliedBatch(const std::vector<const Hypothesis*> &hypos,
+                                const std::vector<const FFState*> &prev_states,
+                                const std::vector<ScoreComponentCollection*> &accumulators,
+                                std::vector<FFState*> &out_states) const;
 };
 
 }
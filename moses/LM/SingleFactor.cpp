@@ -41,6 +41,7 @@ namespace Moses
 LanguageModelSingleFactor::LanguageModelSingleFactor(const std::string &line)
   :LanguageModelImplementation(line)
   ,m_factorType(0)
+  ,m_cacheScores(false)
 {
   m_nullContextState = new PointerState(NULL);
   m_beginSentenceState = new PointerState(NULL);
@@ -98,8 +99,89 @@ std::string LanguageModelSingleFactor::DebugContextFactor(const std::vector<cons
   return ret;
 }
 
+namespace
+{
+const size_t kMaxScoreCacheSize = 1 << 20;
+}
+
+LanguageModelSingleFactor::ScoreCache &LanguageModelSingleFactor::GetScoreCache() const
+{
+  ScoreCache *cache = m_scoreCache.get();
+  if (!cache) {
+    cache = new ScoreCache();
+    m_scoreCache.reset(cache);
+  }
+  return *cache;
+}
+
+void LanguageModelSingleFactor::PhraseKey(const Phrase &phrase, std::vector<const Factor*> &key) const
+{
+  key.resize(phrase.GetSize());
+  for (size_t i = 0; i < phrase.GetSize(); ++i) {
+    const Word &word = phrase.GetWord(i);
+    key[i] = word.IsNonTerminal() ? NULL : word[m_factorType];
+  }
+}
+
+void LanguageModelSingleFactor::CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
+{
+  ScoreCache &cache = GetScoreCache();
+  PhraseKey(phrase, cache.key);
+
+  ScoreCacheMap::const_iterator iter = cache.scores.find(cache.key);
+  if (iter != cache.scores.end()) {
+    fullScore = iter->second.fullScore;
+    ngramScore = iter->second.ngramScore;
+    oovCount = iter->second.oovCount;
+    return;
+  }
+
+  CalcScore(phrase, fullScore, ngramScore, oovCount);
+
+  if (cache.scores.size() >= kMaxScoreCacheSize) {
+    cache.scores.clear();
+  }
+  ScoreCacheEntry &entry = cache.scores[cache.key];
+  entry.fullScore = fullScore;
+  entry.ngramScore = ngramScore;
+  entry.oovCount = oovCount;
 }
 
+void LanguageModelSingleFactor::CalcScoreBatch(const std::vector<const Phrase*> &phrases) const
+{
+  // drop the phrases already scored (or repeated within the batch) so that
+  // each distinct phrase is queried once
+  ScoreCache &cache = GetScoreCache();
+  if (cache.scores.size() + phrases.size() > kMaxScoreCacheSize) {
+    cache.scores.clear();
+  }
 
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    PhraseKey(*phrases[i], cache.key);
+    std::pair<ScoreCacheMap::iterator, bool> ins
+      = cache.scores.insert(std::make_pair(cache.key, ScoreCacheEntry()));
+    if (ins.second) {
+      ScoreCacheEntry &entry = ins.first->second;
+      CalcScore(*phrases[i], entry.fullScore, entry.ngramScore, entry.oovCount);
+    }
+  }
+}
 
+void LanguageModelSingleFactor::EvaluateInIsolation(const Phrase &source
+    , const TargetPhrase &targetPhrase
+    , ScoreComponentCollection &scoreBreakdown
+    , ScoreComponentCollection &estimatedFutureScore) const
+{
+  if (!m_cacheScores) {
+    LanguageModelImplementation::EvaluateInIsolation(source, targetPhrase, scoreBreakdown, estimatedFutureScore);
+    return;
+  }
+
+  float fullScore, nGramScore;
+  size_t oovCount;
 
+  CalcScoreFromCache(targetPhrase, fullScore, nGramScore, oovCount);
+  AssignScores(fullScore, nGramScore, oovCount, scoreBreakdown, estimatedFutureScore);
+}
+
+}
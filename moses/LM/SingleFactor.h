@@ -22,6 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_LanguageModelSingleFactor_h
 #define moses_LanguageModelSingleFactor_h
 
+#include <vector>
+#include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
 #include "Implementation.h"
 #include "moses/Phrase.h"
 
@@ -45,6 +53,30 @@ protected:
 
   LanguageModelSingleFactor(const std::string &line);
 
+  /* Scores of phrases seen before by this thread, keyed on their factors
+   * (NULL for non-terminals), for LMs whose queries are expensive. Set
+   * m_cacheScores in the constructor to use it for EvaluateInIsolation().
+   */
+  bool m_cacheScores;
+  struct ScoreCacheEntry {
+    float fullScore, ngramScore;
+    size_t oovCount;
+  };
+  typedef boost::unordered_map<std::vector<const Factor*>, ScoreCacheEntry> ScoreCacheMap;
+  struct ScoreCache {
+    ScoreCacheMap scores;
+    std::vector<const Factor*> key;
+  };
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ScoreCache> m_scoreCache;
+#else
+  mutable boost::scoped_ptr<ScoreCache> m_scoreCache;
+#endif
+
+  ScoreCache &GetScoreCache() const;
+  void PhraseKey(const Phrase &phrase, std::vector<const Factor*> &key) const;
+
 public:
   virtual ~LanguageModelSingleFactor();
   bool IsUseable(const FactorMask &mask) const;
@@ -64,11 +96,24 @@ public:
   virtual const FFState *GetBeginSentenceState() const;
   virtual FFState *NewState(const FFState *from = NULL) const;
 
+  //! the states are PointerStates
+  virtual bool HasStateHash() const {
+    return true;
+  }
+
   virtual LMResult GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const;
 
   virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = NULL) const = 0;
 
   std::string DebugContextFactor(const std::vector<const Word*> &contextFactor) const;
+
+  virtual void CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases) const;
+
+  virtual void EvaluateInIsolation(const Phrase &source
+                                   , const TargetPhrase &targetPhrase
+                                   , ScoreComponentCollection &scoreBreakdown
+                                   , ScoreComponentCollection &estimatedFutureScore) const;
 };
 
 
@@ -9,6 +9,7 @@ BilingualLM_NPLM::BilingualLM_NPLM(const std::string &line)
   : BilingualLM(line),
     premultiply(true),
     factored(false),
+    batch(false),
     neuralLM_cache(1000000)
 {
 
@@ -22,7 +23,51 @@ float BilingualLM_NPLM::Score(std::vector<int>& source_words, std::vector<int>&
 {
   source_words.reserve(source_ngrams+target_ngrams+1);
   source_words.insert( source_words.end(), target_words.begin(), target_words.end() );
-  return FloorScore(m_neuralLM->lookup_ngram(source_words));
+
+  if (m_scoreCache.IsRecording()) {
+    // first pass of a batch: only note what has to be scored
+    m_scoreCache.Record(source_words);
+    return 0;
+  }
+  float score;
+  if (!m_scoreCache.Find(source_words, score)) {
+    score = FloorScore(m_neuralLM->lookup_ngram(source_words));
+    m_scoreCache.Add(source_words, score);
+  }
+  return score;
+}
+
+void BilingualLM_NPLM::EvaluateWhenAppliedBatch(
+  const std::vector<const Hypothesis*> &hypos,
+  const std::vector<const FFState*> &prev_states,
+  const std::vector<ScoreComponentCollection*> &accumulators,
+  std::vector<FFState*> &out_states) const
+{
+  const size_t order = source_ngrams + target_ngrams + 1;
+  std::vector<NeuralScoreCache::NGram> pending;
+  m_scoreCache.CollectBatch(*this, hypos, prev_states, order, pending);
+
+  if (!pending.empty()) {
+    // one forward pass over all new n-grams, one per column
+    initSharedPointer();
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> ngrams(order, pending.size());
+    for (size_t j = 0; j < pending.size(); ++j) {
+      for (size_t i = 0; i < order; ++i) {
+        ngrams(i, j) = pending[j][i];
+      }
+    }
+    Eigen::Matrix<double, 1, Eigen::Dynamic> logProbs(pending.size());
+    m_neuralLM->set_width(pending.size());
+    m_neuralLM->lookup_ngram(ngrams, logProbs);
+    m_neuralLM->set_width(1);
+
+    for (size_t j = 0; j < pending.size(); ++j) {
+      m_scoreCache.Add(pending[j], FloorScore(logProbs(j)));
+    }
+  }
+
+  // now every n-gram is cached
+  BilingualLM::EvaluateWhenAppliedBatch(hypos, prev_states, accumulators, out_states);
 }
 
 const Word& BilingualLM_NPLM::getNullWord() const
@@ -82,6 +127,8 @@ void BilingualLM_NPLM::SetParameter(const std::string& key, const std::string& v
     source_ngrams = Scan<int>(value)*2+1;
   } else if (key == "factored") {
     factored = Scan<bool>(value);
+  } else if (key == "batch") {
+    batch = Scan<bool>(value);
   } else if (key == "pos_factor") {
     pos_factortype = Scan<FactorType>(value);
   } else if (key == "source_vocab") {
@@ -1,4 +1,5 @@
 #include "moses/LM/BilingualLM.h"
+#include "moses/LM/NeuralScoreCache.h"
 #include <boost/unordered_map.hpp>
 #include <utility> //make_pair
 #include <fstream> //Read vocabulary files
@@ -16,6 +17,16 @@ class BilingualLM_NPLM : public BilingualLM
 public:
   BilingualLM_NPLM(const std::string &line);
 
+  bool IsBatchable() const {
+    return batch;
+  }
+
+  void EvaluateWhenAppliedBatch(
+    const std::vector<const Hypothesis*> &hypos,
+    const std::vector<const FFState*> &prev_states,
+    const std::vector<ScoreComponentCollection*> &accumulators,
+    std::vector<FFState*> &out_states) const;
+
 private:
   float Score(std::vector<int>& source_words, std::vector<int>& target_words) const;
 
@@ -31,6 +42,8 @@ private:
 
   nplm::neuralLM *m_neuralLM_shared;
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
+  // scores shared by all threads, also used to batch up network queries
+  mutable NeuralScoreCache m_scoreCache;
 
   mutable boost::unordered_map<const Factor*, int> target_neuralLMids;
   mutable boost::unordered_map<const Factor*, int> source_neuralLMids;
@@ -44,6 +57,7 @@ private:
   std::string target_vocab_path;
   bool premultiply;
   bool factored;
+  bool batch;
   int neuralLM_cache;
   int source_unknown_word_id;
   int target_unknown_word_id;
@@ -34,6 +34,11 @@ public:
 
   virtual void CleanUpAfterSentenceProcessing(const InputType& source);
 
+  virtual bool CanEvaluateOnAnyThread() const {
+    // the persistent cache of the sentence is thread-local
+    return !persistentCache;
+  }
+
 private:
   double GetScore(int word, const vector<int>& context) const;
 
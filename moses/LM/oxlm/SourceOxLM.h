@@ -35,6 +35,11 @@ private:
 
   void CleanUpAfterSentenceProcessing(const InputType& source);
 
+  bool CanEvaluateOnAnyThread() const {
+    // the persistent cache of the sentence is thread-local
+    return !persistentCache;
+  }
+
 protected:
   oxlm::SourceFactoredLM model;
   boost::shared_ptr<OxLMParallelMapper> mapper;
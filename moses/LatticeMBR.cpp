@@ -9,6 +9,7 @@
 
 #include "LatticeMBR.h"
 #include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
 #include <algorithm>
 #include <set>
 
@@ -52,16 +53,10 @@ void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngr
 
 void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
 {
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
+  const Phrase* key = &*m_ngrams.insert(ngram).first;
+  std::pair<NodeScores::iterator, bool> ins = m_scores[node].insert(make_pair(key, score));
+  if (!ins.second) {
+    ins.first->second = log_sum(score, ins.first->second);
   }
 }
 
@@ -97,7 +92,7 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+void LatticeMBRSolution::CalcScore(const NgramPosteriors& finalNgramScores, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
@@ -110,7 +105,7 @@ void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const v
   //Calculate the ngramScores, working in log space at first
   for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
     float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
+    NgramPosteriors::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
     if (ngramPosteriorIt != finalNgramScores.end()) {
       ngramPosterior = ngramPosteriorIt->second;
     }
@@ -276,7 +271,7 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 }
 
 void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+                           NgramPosteriors& finalNgramScores, bool posteriors)
 {
 
   sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
@@ -369,11 +364,9 @@ void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector
     const Hypothesis* hyp = *finalHyp;
 
     for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
-      } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+      std::pair<NgramPosteriors::iterator, bool> ins = finalNgramScores.insert(make_pair(*it->first, it->second));
+      if (!ins.second) {
+        ins.first->second = log_sum(it->second, ins.first->second);
       }
     }
 
@@ -386,7 +379,7 @@ void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector
 
   //Z *= scale;  //scale the score
 
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
+  for (NgramPosteriors::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
     finalScoresIt->second =  finalScoresIt->second - Z;
     IFVERBOSE(2) {
       VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
@@ -499,20 +492,58 @@ bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
   return a->GetWordsBitmap().GetNumWordsCovered() <  b->GetWordsBitmap().GetNumWordsCovered();
 }
 
-void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList,
-                        vector<LatticeMBRSolution>& solutions, size_t n)
+void calcLatticeMBRPosteriors(const Manager& manager, NgramPosteriors& ngramPosteriors)
 {
   const StaticData& staticData = StaticData::Instance();
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
   map<const Hypothesis*, vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
   manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores, manager.GetBestHypothesis(), staticData.GetLatticeMBRPruningFactor(),staticData.GetMBRScale());
   calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
+}
+
+namespace
+{
+//! scores a slice of the n-best list against the n-gram posteriors
+class LatticeMBRScoreTask : public Task
+{
+public:
+  LatticeMBRScoreTask(std::vector<LatticeMBRSolution>& solutions, size_t begin, size_t end,
+                      const NgramPosteriors& ngramPosteriors, const vector<float>& thetas,
+                      float mapWeight)
+    : m_solutions(solutions), m_begin(begin), m_end(end)
+    , m_ngramPosteriors(ngramPosteriors), m_thetas(thetas), m_mapWeight(mapWeight) {}
+
+  void Run() {
+    for (size_t i = m_begin; i < m_end; ++i) {
+      m_solutions[i].CalcScore(m_ngramPosteriors, m_thetas, m_mapWeight);
+    }
+  }
+
+private:
+  std::vector<LatticeMBRSolution>& m_solutions;
+  size_t m_begin, m_end;
+  const NgramPosteriors& m_ngramPosteriors;
+  const vector<float>& m_thetas;
+  float m_mapWeight;
+};
+}
+
+void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList,
+                        vector<LatticeMBRSolution>& solutions, size_t n)
+{
+  NgramPosteriors ngramPosteriors;
+  calcLatticeMBRPosteriors(manager, ngramPosteriors);
+  getLatticeMBRNBest(ngramPosteriors, nBestList, solutions, n);
+}
 
+void getLatticeMBRNBest(const NgramPosteriors& ngramPosteriors, const TrellisPathList& nBestList,
+                        vector<LatticeMBRSolution>& solutions, size_t n)
+{
+  const StaticData& staticData = StaticData::Instance();
   vector<float> mbrThetas = staticData.GetLatticeMBRThetas();
   float p = staticData.GetLatticeMBRPrecision();
   float r = staticData.GetLatticeMBRPRatio();
@@ -531,17 +562,40 @@ void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList
     }
     VERBOSE(2,endl);
   }
+
+  // score all candidates (in parallel with -search-threads), then keep the
+  // n best; ties stay in n-best list order
+  const size_t offset = solutions.size();
   TrellisPathList::const_iterator iter;
-  size_t ctr = 0;
-  LatticeMBRSolutionComparator comparator;
-  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter, ++ctr) {
-    const TrellisPath &path = **iter;
-    solutions.push_back(LatticeMBRSolution(path,iter==nBestList.begin()));
-    solutions.back().CalcScore(ngramPosteriors,mbrThetas,mapWeight);
-    sort(solutions.begin(), solutions.end(), comparator);
-    while (solutions.size() > n) {
-      solutions.pop_back();
+  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
+    solutions.push_back(LatticeMBRSolution(**iter,iter==nBestList.begin()));
+  }
+  const size_t size = solutions.size() - offset;
+  size_t numTasks = 1;
+#ifdef WITH_THREADS
+  numTasks = std::max<size_t>(1, std::min(staticData.GetSearchThreads(), size / 16));
+#endif
+  vector<boost::shared_ptr<LatticeMBRScoreTask> > tasks;
+  for (size_t t = 0; t < numTasks; ++t) {
+    tasks.push_back(boost::shared_ptr<LatticeMBRScoreTask>(
+                      new LatticeMBRScoreTask(solutions, offset + size * t / numTasks, offset + size * (t + 1) / numTasks,
+                                              ngramPosteriors, mbrThetas, mapWeight)));
+  }
+#ifdef WITH_THREADS
+  if (numTasks > 1) {
+    ThreadPool pool(numTasks);
+    for (size_t t = 0; t < numTasks; ++t) {
+      pool.Submit(tasks[t]);
     }
+    pool.Stop(true);
+  } else
+#endif
+    tasks[0]->Run();
+
+  LatticeMBRSolutionComparator comparator;
+  stable_sort(solutions.begin(), solutions.end(), comparator);
+  if (solutions.size() > n) {
+    solutions.erase(solutions.begin() + n, solutions.end());
   }
   VERBOSE(2,"LMBR Score: " << solutions[0].GetScore() << endl);
 }
@@ -554,6 +608,13 @@ vector<Word> doLatticeMBR(const Manager& manager, const TrellisPathList& nBestLi
   return solutions.at(0).GetWords();
 }
 
+vector<Word> doLatticeMBR(const NgramPosteriors& ngramPosteriors, const TrellisPathList& nBestList)
+{
+  vector<LatticeMBRSolution> solutions;
+  getLatticeMBRNBest(ngramPosteriors, nBestList, solutions,1);
+  return solutions.at(0).GetWords();
+}
+
 const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathList& nBestList)
 {
   static const int BLEU_ORDER = 4;
@@ -563,7 +624,7 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   const StaticData& staticData = StaticData::Instance();
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
+  NgramPosteriors ngramExpectations;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
   map<const Hypothesis*, vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
@@ -574,7 +635,7 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   //expected length is sum of expected unigram counts
   //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
   float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
+  for (NgramPosteriors::const_iterator ref_iter = ngramExpectations.begin();
        ref_iter != ngramExpectations.end(); ++ref_iter) {
     //cerr << "Ngram: " << ref_iter->first << " score: " <<
     //    ref_iter->second << endl;
@@ -614,7 +675,7 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
 
     for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
          hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
+      NgramPosteriors::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
       if (ref_iter != ngramExpectations.end()) {
         comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
       }
@@ -13,6 +13,8 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #include "moses/Hypothesis.h"
 #include "moses/Manager.h"
 #include "moses/TrellisPathList.h"
@@ -28,6 +30,8 @@ typedef std::vector< const Moses::Hypothesis *> Lattice;
 typedef std::vector<const Edge*> Path;
 typedef std::map<Path, size_t> PathCounts;
 typedef std::map<Moses::Phrase, PathCounts > NgramHistory;
+//! log posterior (or expected count) of each n-gram in the lattice
+typedef boost::unordered_map<Moses::Phrase, float> NgramPosteriors;
 
 class Edge
 {
@@ -88,13 +92,14 @@ public:
   void addScore(const Moses::Hypothesis* node, const Moses::Phrase& ngram, float score);
 
   /** Iterate through ngrams for selected node */
-  typedef std::map<const Moses::Phrase*, float>::const_iterator NodeScoreIterator;
+  typedef boost::unordered_map<const Moses::Phrase*, float> NodeScores;
+  typedef NodeScores::const_iterator NodeScoreIterator;
   NodeScoreIterator nodeBegin(const Moses::Hypothesis* node);
   NodeScoreIterator nodeEnd(const Moses::Hypothesis* node);
 
 private:
-  std::set<Moses::Phrase> m_ngrams;
-  std::map<const Moses::Hypothesis*, std::map<const Moses::Phrase*, float> > m_scores;
+  boost::unordered_set<Moses::Phrase> m_ngrams; //!< elements don't move, nodes point to them
+  boost::unordered_map<const Moses::Hypothesis*, NodeScores> m_scores;
 };
 
 
@@ -118,7 +123,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Moses::Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(const NgramPosteriors& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Moses::Word> m_words;
@@ -138,13 +143,17 @@ void pruneLatticeFB(Lattice & connectedHyp, std::map < const Moses::Hypothesis*,
 
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
+//as above, with posteriors from calcLatticeMBRPosteriors, e.g. to try several thetas on them
+void getLatticeMBRNBest(const NgramPosteriors& ngramPosteriors, const Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
+//ngram posteriors of the search graph, pruned with the current lmbr-pruning-factor and mbr-scale
+void calcLatticeMBRPosteriors(const Moses::Manager& manager, NgramPosteriors& ngramPosteriors);
 //calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Moses::Phrase,
-                           float>& finalNgramScores, bool posteriors);
+void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, NgramPosteriors& finalNgramScores, bool posteriors);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <Moses::Word> &translation);
 void extract_ngrams(const std::vector<Moses::Word >& sentence, std::map < Moses::Phrase, int >  & allngrams);
 bool ascendingCoverageCmp(const Moses::Hypothesis* a, const Moses::Hypothesis* b);
 std::vector<Moses::Word> doLatticeMBR(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
+std::vector<Moses::Word> doLatticeMBR(const NgramPosteriors& ngramPosteriors, const Moses::TrellisPathList& nBestList);
 const Moses::TrellisPath doConsensusDecoding(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 //std::vector<Moses::Word> doConsensusDecoding(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
 
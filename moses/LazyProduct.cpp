@@ -0,0 +1,72 @@
+#include "LazyProduct.h"
+
+namespace Moses
+{
+
+LazyProduct::LazyProduct(const std::vector<const std::vector<float>*> &lists)
+  : m_lists(lists)
+{
+  Item first;
+  first.score = 0;
+  for (size_t i = 0; i < m_lists.size(); ++i) {
+    if (m_lists[i]->empty()) return;
+    first.score += (*m_lists[i])[0];
+  }
+  first.indices.resize(m_lists.size(), 0);
+  m_queue.push(first);
+}
+
+void LazyProduct::Pop()
+{
+  Item item = m_queue.top();
+  m_queue.pop();
+
+  // successors increment a list at or after the last non-zero index
+  size_t last = item.indices.size();
+  while (last > 0 && item.indices[last - 1] == 0) --last;
+  if (last > 0) --last;
+
+  for (size_t i = last; i < item.indices.size(); ++i) {
+    const std::vector<float> &list = *m_lists[i];
+    size_t index = item.indices[i];
+    if (index + 1 >= list.size()) continue;
+    Item next(item);
+    next.indices[i] = index + 1;
+    next.score += list[index + 1] - list[index];
+    m_queue.push(next);
+  }
+}
+
+LazyProductMerger::~LazyProductMerger()
+{
+  for (size_t i = 0; i < m_products.size(); ++i) {
+    delete m_products[i];
+  }
+}
+
+void LazyProductMerger::Add(float offset, LazyProduct *product)
+{
+  size_t id = m_products.size();
+  m_products.push_back(product);
+  m_offsets.push_back(offset);
+  if (!product->Empty()) {
+    m_heads.push(Head(offset + product->BestScore(), id));
+  }
+}
+
+bool LazyProductMerger::Pop(size_t &product, std::vector<size_t> &indices)
+{
+  if (m_heads.empty()) return false;
+  product = m_heads.top().second;
+  m_heads.pop();
+
+  LazyProduct &best = *m_products[product];
+  indices = best.Best();
+  best.Pop();
+  if (!best.Empty()) {
+    m_heads.push(Head(m_offsets[product] + best.BestScore(), product));
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <queue>
+#include <vector>
+
+namespace Moses
+{
+
+/** Enumerates the combinations of one item from each of several lists in
+ *  order of decreasing total score, without building the cartesian product.
+ *  Each list holds the item scores sorted in decreasing order; the lists are
+ *  not copied and must outlive the object.
+ *
+ *  A combination is reached from a single predecessor (the one with the last
+ *  non-zero index decremented), so no combination is queued twice.
+ */
+class LazyProduct
+{
+public:
+  explicit LazyProduct(const std::vector<const std::vector<float>*> &lists);
+
+  bool Empty() const {
+    return m_queue.empty();
+  }
+
+  //! total score of the next combination
+  float BestScore() const {
+    return m_queue.top().score;
+  }
+
+  //! the next combination, an index into each list
+  const std::vector<std::size_t> &Best() const {
+    return m_queue.top().indices;
+  }
+
+  void Pop();
+
+private:
+  struct Item {
+    float score;
+    std::vector<std::size_t> indices;
+
+    bool operator<(const Item &other) const {
+      return score < other.score;
+    }
+  };
+
+  std::vector<const std::vector<float>*> m_lists;
+  std::priority_queue<Item> m_queue;
+};
+
+/** Merges the combinations of several LazyProducts, each offset by a score
+ *  (of the partial translation option it would extend), best first. */
+class LazyProductMerger
+{
+public:
+  ~LazyProductMerger();
+
+  //! takes ownership of product
+  void Add(float offset, LazyProduct *product);
+
+  /** next combination over all products: the index of its product in the
+   *  order they were added and the combination; false when all are done */
+  bool Pop(std::size_t &product, std::vector<std::size_t> &indices);
+
+private:
+  typedef std::pair<float, std::size_t> Head;
+
+  std::vector<LazyProduct*> m_products;
+  std::vector<float> m_offsets;
+  std::priority_queue<Head> m_heads;
+};
+
+}
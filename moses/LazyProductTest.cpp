@@ -0,0 +1,100 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2010 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "LazyProduct.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(lazy_product)
+
+BOOST_AUTO_TEST_CASE(all_combinations_best_first)
+{
+  const float a[] = {0, -1, -1.5, -4};
+  const float b[] = {-0.5, -0.75, -3};
+  const float c[] = {-0.25, -2};
+  vector<float> la(a, a + 4), lb(b, b + 3), lc(c, c + 2);
+  vector<const vector<float>*> lists;
+  lists.push_back(&la);
+  lists.push_back(&lb);
+  lists.push_back(&lc);
+
+  vector<float> expected;
+  for (size_t i = 0; i < la.size(); ++i)
+    for (size_t j = 0; j < lb.size(); ++j)
+      for (size_t k = 0; k < lc.size(); ++k)
+        expected.push_back(la[i] + lb[j] + lc[k]);
+  sort(expected.begin(), expected.end(), greater<float>());
+
+  LazyProduct product(lists);
+  set<vector<size_t> > seen;
+  vector<float> got;
+  while (!product.Empty()) {
+    const vector<size_t> &indices = product.Best();
+    BOOST_CHECK(seen.insert(indices).second);
+    BOOST_CHECK_CLOSE(la[indices[0]] + lb[indices[1]] + lc[indices[2]], product.BestScore(), 1e-4);
+    got.push_back(product.BestScore());
+    product.Pop();
+  }
+  BOOST_REQUIRE_EQUAL(expected.size(), got.size());
+  for (size_t i = 0; i < got.size(); ++i) {
+    BOOST_CHECK_CLOSE(expected[i], got[i], 1e-4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(empty_list)
+{
+  vector<float> full(2, 0.0f), none;
+  vector<const vector<float>*> lists;
+  lists.push_back(&full);
+  lists.push_back(&none);
+  BOOST_CHECK(LazyProduct(lists).Empty());
+}
+
+BOOST_AUTO_TEST_CASE(merger)
+{
+  vector<float> scores;
+  scores.push_back(0);
+  scores.push_back(-2);
+  vector<const vector<float>*> lists(1, &scores);
+
+  LazyProductMerger merger;
+  merger.Add(-1, new LazyProduct(lists));
+  merger.Add(0, new LazyProduct(vector<const vector<float>*>(1, &scores)));
+
+  size_t product;
+  vector<size_t> indices;
+  const size_t expectedProduct[] = {1, 0, 1, 0};
+  const size_t expectedIndex[] = {0, 0, 1, 1};
+  for (size_t i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(merger.Pop(product, indices));
+    BOOST_CHECK_EQUAL(expectedProduct[i], product);
+    BOOST_CHECK_EQUAL(expectedIndex[i], indices[0]);
+  }
+  BOOST_CHECK(!merger.Pop(product, indices));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
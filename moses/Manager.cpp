@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <map>
 #include <set>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
@@ -53,23 +54,48 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "rule.pb.h"
 #endif
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 #include "util/exception.hh"
+#include "util/usage.hh"
 
 using namespace std;
 
 namespace Moses
 {
+
+namespace
+{
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<Manager::Storage> s_threadStorage;
+#else
+boost::scoped_ptr<Manager::Storage> s_threadStorage;
+#endif
+}
+
 Manager::Manager(InputType const& source)
   :BaseManager(source)
-  ,m_transOptColl(source.CreateTranslationOptionCollection())
+  ,m_storage(AcquireStorage())
+  ,m_transOptColl(NULL)
   ,interrupted_flag(0)
   ,m_hypoId(0)
 {
-  const StaticData &staticData = StaticData::Instance();
-  SearchAlgorithm searchAlgorithm = staticData.GetSearchAlgorithm();
-  m_search = Search::CreateSearch(*this, source, searchAlgorithm, *m_transOptColl);
+  SentenceArena::Scope arena(&m_storage->arena);
+  try {
+    m_transOptColl = source.CreateTranslationOptionCollection();
+
+    const StaticData &staticData = StaticData::Instance();
+    SearchAlgorithm searchAlgorithm = staticData.GetSearchAlgorithm();
+    m_search = Search::CreateSearch(*this, source, searchAlgorithm, *m_transOptColl);
 
-  StaticData::Instance().InitializeForInput(m_source);
+    StaticData::Instance().InitializeForInput(m_source);
+  } catch (...) {
+    // the destructor won't run; let the next sentence have the storage
+    ReleaseStorage();
+    throw;
+  }
 }
 
 Manager::~Manager()
@@ -79,6 +105,35 @@ Manager::~Manager()
   // this is a comment ...
 
   StaticData::Instance().CleanUpAfterSentenceProcessing(m_source);
+
+  ReleaseStorage();
+}
+
+Manager::Storage *Manager::AcquireStorage()
+{
+  if (StaticData::Instance().GetRecycleSearchMemory()) {
+    if (s_threadStorage.get() == NULL) s_threadStorage.reset(new Storage);
+    Storage *storage = s_threadStorage.get();
+    if (!storage->inUse) {
+      storage->inUse = true;
+      return storage;
+    }
+  }
+  m_ownStorage.reset(new Storage);
+  return m_ownStorage.get();
+}
+
+void Manager::ReleaseStorage()
+{
+  if (m_ownStorage) return;
+  // as if the storage had been destroyed, but keeping its memory
+  m_storage->hypothesisPool.reset();
+  m_storage->arena.Reset();
+  m_storage->inUse = false;
+  // one long sentence should not hold on to memory for good
+  if (m_storage->GetAllocatedBytes() > StaticData::Instance().GetRecycleSearchMemory()) {
+    s_threadStorage.reset();
+  }
 }
 
 /**
@@ -87,27 +142,25 @@ Manager::~Manager()
  */
 void Manager::Decode()
 {
+  SentenceArena::Scope arena(&m_storage->arena);
+
   // initialize statistics
   ResetSentenceStats(m_source);
   IFVERBOSE(2) {
     GetSentenceStats().StartTimeTotal();
   }
 
-  // check if alternate weight setting is used
-  // this is not thread safe! it changes StaticData
-  if (StaticData::Instance().GetHasAlternateWeightSettings()) {
-    if (m_source.GetSpecifiesWeightSetting()) {
-      StaticData::Instance().SetWeightSetting(m_source.GetWeightSetting());
-    } else {
-      StaticData::Instance().SetWeightSetting("default");
-    }
-  }
+  // the weight setting and own weights of the input
+  // (with threads this only affects the decoding thread)
+  StaticData::Instance().SelectWeights(m_source);
 
   // get translation options
   IFVERBOSE(1) {
     GetSentenceStats().StartTimeCollectOpts();
   }
+  double start = util::WallTime();
   m_transOptColl->CreateTranslationOptions();
+  m_optionsTime = util::WallTime() - start;
 
   // some reporting on how long this took
   IFVERBOSE(1) {
@@ -120,7 +173,9 @@ void Manager::Decode()
   // search for best translation with the specified algorithm
   Timer searchTime;
   searchTime.start();
+  start = util::WallTime();
   m_search->Decode();
+  m_searchTime = util::WallTime() - start;
   VERBOSE(1, "Line " << m_source.GetTranslationId() << ": Search took " << searchTime << " seconds" << endl);
   IFVERBOSE(2) {
     GetSentenceStats().StopTimeTotal();
@@ -242,7 +297,8 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
 
   TrellisPathCollection contenders;
 
-  set<Phrase> distinctHyps;
+  // surface strings already in ret, hashed
+  boost::unordered_set<Phrase> distinctHyps;
 
   // add all pure paths
   vector<const Hypothesis*>::const_iterator iterBestHypo;
@@ -615,15 +671,37 @@ void Manager::GetWordGraph(long translationId, std::ostream &outputWordGraphStre
   } // for (iterStack
 }
 
+namespace
+{
+struct SearchGraphCollector : public SearchGraphVisitor {
+  std::vector<SearchGraphNode> &searchGraph;
+  SearchGraphCollector(std::vector<SearchGraphNode> &theSearchGraph)
+    : searchGraph(theSearchGraph) {}
+  void Visit(const SearchGraphNode &node) {
+    searchGraph.push_back(node);
+  }
+};
+}
+
 void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
 {
-  std::map < int, bool > connected;
-  std::map < int, int > forward;
-  std::map < int, double > forwardScore;
+  SearchGraphCollector collector(searchGraph);
+  VisitSearchGraph(collector);
+}
+
+void Manager::VisitSearchGraph(SearchGraphVisitor &visitor) const
+{
+  // hypothesis ids are handed out consecutively, so everything known about
+  // a hypothesis is kept in vectors indexed by id
+  std::vector<bool> connected(m_hypoId, false);
+  std::vector<int> forward(m_hypoId, -1);
+  std::vector<double> forwardScore(m_hypoId, -std::numeric_limits<double>::infinity());
 
   // *** find connected hypotheses ***
-  std::vector< const Hypothesis *> connectedList;
-  GetConnectedGraph(&connected, &connectedList);
+  {
+    std::vector< const Hypothesis *> connectedList;
+    FindConnectedHypotheses(connected, connectedList, false);
+  }
 
   // ** compute best forward path for each hypothesis *** //
 
@@ -644,13 +722,12 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
     HypothesisStack::const_iterator iterHypo;
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
-      if (connected.find( hypo->GetId() ) != connected.end()) {
+      if (connected[ hypo->GetId() ]) {
         // make a play for previous hypothesis
         const Hypothesis *prevHypo = hypo->GetPrevHypo();
         double fscore = forwardScore[ hypo->GetId() ] +
                         hypo->GetScore() - prevHypo->GetScore();
-        if (forwardScore.find( prevHypo->GetId() ) == forwardScore.end()
-            || forwardScore.find( prevHypo->GetId() )->second < fscore) {
+        if (forwardScore[ prevHypo->GetId() ] < fscore) {
           forwardScore[ prevHypo->GetId() ] = fscore;
           forward[ prevHypo->GetId() ] = hypo->GetId();
         }
@@ -664,8 +741,7 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
             const Hypothesis *loserPrevHypo = loserHypo->GetPrevHypo();
             double fscore = forwardScore[ hypo->GetId() ] +
                             loserHypo->GetScore() - loserPrevHypo->GetScore();
-            if (forwardScore.find( loserPrevHypo->GetId() ) == forwardScore.end()
-                || forwardScore.find( loserPrevHypo->GetId() )->second < fscore) {
+            if (forwardScore[ loserPrevHypo->GetId() ] < fscore) {
               forwardScore[ loserPrevHypo->GetId() ] = fscore;
               forward[ loserPrevHypo->GetId() ] = loserHypo->GetId();
             }
@@ -683,17 +759,17 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
     HypothesisStack::const_iterator iterHypo;
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
-      if (connected.find( hypo->GetId() ) != connected.end()) {
-        searchGraph.push_back(SearchGraphNode(hypo,NULL,forward[hypo->GetId()],
-                                              forwardScore[hypo->GetId()]));
+      if (connected[ hypo->GetId() ]) {
+        visitor.Visit(SearchGraphNode(hypo,NULL,forward[hypo->GetId()],
+                                      forwardScore[hypo->GetId()]));
 
         const ArcList *arcList = hypo->GetArcList();
         if (arcList != NULL) {
           ArcList::const_iterator iterArcList;
           for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
             const Hypothesis *loserHypo = *iterArcList;
-            searchGraph.push_back(SearchGraphNode(loserHypo,hypo,
-                                                  forward[hypo->GetId()], forwardScore[hypo->GetId()]));
+            visitor.Visit(SearchGraphNode(loserHypo,hypo,
+                                          forward[hypo->GetId()], forwardScore[hypo->GetId()]));
           }
         } // end if arcList empty
       } // end if connected
@@ -1163,42 +1239,10 @@ void Manager::GetConnectedGraph(
   std::map< int, bool >* pConnected,
   std::vector< const Hypothesis* >* pConnectedList) const
 {
-  std::map < int, bool >& connected = *pConnected;
-  std::vector< const Hypothesis *>& connectedList = *pConnectedList;
-
-  // start with the ones in the final stack
-  const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
-  const HypothesisStack &finalStack = *hypoStackColl.back();
-  HypothesisStack::const_iterator iterHypo;
-  for (iterHypo = finalStack.begin() ; iterHypo != finalStack.end() ; ++iterHypo) {
-    const Hypothesis *hypo = *iterHypo;
-    connected[ hypo->GetId() ] = true;
-    connectedList.push_back( hypo );
-  }
-  // move back from known connected hypotheses
-  for(size_t i=0; i<connectedList.size(); i++) {
-    const Hypothesis *hypo = connectedList[i];
-
-    // add back pointer
-    const Hypothesis *prevHypo = hypo->GetPrevHypo();
-    if (prevHypo && prevHypo->GetId() > 0 // don't add empty hypothesis
-        && connected.find( prevHypo->GetId() ) == connected.end()) { // don't add already added
-      connected[ prevHypo->GetId() ] = true;
-      connectedList.push_back( prevHypo );
-    }
-
-    // add arcs
-    const ArcList *arcList = hypo->GetArcList();
-    if (arcList != NULL) {
-      ArcList::const_iterator iterArcList;
-      for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-        const Hypothesis *loserHypo = *iterArcList;
-        if (connected.find( loserHypo->GetId() ) == connected.end()) { // don't add already added
-          connected[ loserHypo->GetId() ] = true;
-          connectedList.push_back( loserHypo );
-        }
-      }
-    }
+  std::vector<bool> connected(m_hypoId, false);
+  FindConnectedHypotheses(connected, *pConnectedList, false);
+  for (size_t i = 0; i < pConnectedList->size(); ++i) {
+    (*pConnected)[ (*pConnectedList)[i]->GetId() ] = true;
   }
 }
 
@@ -1206,9 +1250,18 @@ void Manager::GetWinnerConnectedGraph(
   std::map< int, bool >* pConnected,
   std::vector< const Hypothesis* >* pConnectedList) const
 {
-  std::map < int, bool >& connected = *pConnected;
-  std::vector< const Hypothesis *>& connectedList = *pConnectedList;
+  std::vector<bool> connected(m_hypoId, false);
+  FindConnectedHypotheses(connected, *pConnectedList, true);
+  for (size_t i = 0; i < pConnectedList->size(); ++i) {
+    (*pConnected)[ (*pConnectedList)[i]->GetId() ] = true;
+  }
+}
 
+void Manager::FindConnectedHypotheses(
+  std::vector<bool> &connected,
+  std::vector< const Hypothesis* > &connectedList,
+  bool viaWinners) const
+{
   // start with the ones in the final stack
   const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
   const HypothesisStack &finalStack = *hypoStackColl.back();
@@ -1225,21 +1278,25 @@ void Manager::GetWinnerConnectedGraph(
 
     // add back pointer
     const Hypothesis *prevHypo = hypo->GetPrevHypo();
-    if (prevHypo->GetId() > 0 // don't add empty hypothesis
-        && connected.find( prevHypo->GetId() ) == connected.end()) { // don't add already added
+    if (prevHypo && prevHypo->GetId() > 0 // don't add empty hypothesis
+        && !connected[ prevHypo->GetId() ]) { // don't add already added
       connected[ prevHypo->GetId() ] = true;
       connectedList.push_back( prevHypo );
     }
 
-    // add arcs
+    // add arcs, or what they extend
     const ArcList *arcList = hypo->GetArcList();
     if (arcList != NULL) {
       ArcList::const_iterator iterArcList;
       for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-        const Hypothesis *loserHypo = *iterArcList;
-        if (connected.find( loserHypo->GetPrevHypo()->GetId() ) == connected.end() && loserHypo->GetPrevHypo()->GetId() > 0) { // don't add already added & don't add hyp 0
-          connected[ loserHypo->GetPrevHypo()->GetId() ] = true;
-          connectedList.push_back( loserHypo->GetPrevHypo() );
+        const Hypothesis *arc = *iterArcList;
+        if (viaWinners) {
+          arc = arc->GetPrevHypo();
+          if (arc->GetId() == 0) continue; // don't add hyp 0
+        }
+        if (!connected[ arc->GetId() ]) { // don't add already added
+          connected[ arc->GetId() ] = true;
+          connectedList.push_back( arc );
         }
       }
     }
@@ -1349,13 +1406,24 @@ void Manager::SerializeSearchGraphPB(
 }
 #endif
 
-void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const
+namespace
 {
-  vector<SearchGraphNode> searchGraph;
-  GetSearchGraph(searchGraph);
-  for (size_t i = 0; i < searchGraph.size(); ++i) {
-    OutputSearchNode(translationId,outputSearchGraphStream,searchGraph[i]);
+struct SearchGraphPrinter : public SearchGraphVisitor {
+  long translationId;
+  std::ostream &out;
+  SearchGraphPrinter(long theTranslationId, std::ostream &theOut)
+    : translationId(theTranslationId), out(theOut) {}
+  void Visit(const SearchGraphNode &node) {
+    OutputSearchNode(translationId, out, node);
   }
+};
+}
+
+void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const
+{
+  // write the nodes as they are found instead of collecting the graph first
+  SearchGraphPrinter printer(translationId, outputSearchGraphStream);
+  VisitSearchGraph(printer);
 }
 
 void Manager::GetForwardBackwardSearchGraph(std::map< int, bool >* pConnected,
@@ -1765,15 +1833,7 @@ void Manager::OutputSurface(std::ostream &out, const Hypothesis &edge, const std
 
 void Manager::OutputAlignment(ostream &out, const AlignmentInfo &ai, size_t sourceOffset, size_t targetOffset) const
 {
-  typedef std::vector< const std::pair<size_t,size_t>* > AlignVec;
-  AlignVec alignments = ai.GetSortedAlignments();
-
-  AlignVec::const_iterator it;
-  for (it = alignments.begin(); it != alignments.end(); ++it) {
-    const std::pair<size_t,size_t> &alignment = **it;
-    out << alignment.first + sourceOffset << "-" << alignment.second + targetOffset << " ";
-  }
-
+  Hypothesis::OutputAlignment(out, ai, sourceOffset, targetOffset);
 }
 
 void Manager::OutputInput(std::ostream& os, const Hypothesis* hypo) const
@@ -1836,14 +1896,14 @@ void Manager::OutputAlignment(OutputCollector *collector) const
   if (!m_alignmentOut.str().empty()) {
     collector->Write(m_source.GetTranslationId(), m_alignmentOut.str());
   } else {
-    std::vector<const Hypothesis *> edges;
-    const Hypothesis *currentHypo = GetBestHypothesis();
-    while (currentHypo) {
-      edges.push_back(currentHypo);
-      currentHypo = currentHypo->GetPrevHypo();
+    ostringstream out;
+    const Hypothesis *bestHypo = GetBestHypothesis();
+    if (bestHypo) {
+      bestHypo->OutputAlignment(out);
+    } else {
+      out << std::endl;
     }
-
-    OutputAlignment(collector,m_source.GetTranslationId(), edges);
+    collector->Write(m_source.GetTranslationId(), out.str());
   }
 }
 
@@ -1857,20 +1917,7 @@ void Manager::OutputAlignment(OutputCollector* collector, size_t lineNo , const
 
 void Manager::OutputAlignment(ostream &out, const vector<const Hypothesis *> &edges) const
 {
-  size_t targetOffset = 0;
-
-  for (int currEdge = (int)edges.size() - 1 ; currEdge >= 0 ; currEdge--) {
-    const Hypothesis &edge = *edges[currEdge];
-    const TargetPhrase &tp = edge.GetCurrTargetPhrase();
-    size_t sourceOffset = edge.GetCurrSourceWordsRange().GetStartPos();
-
-    OutputAlignment(out, tp.GetAlignTerm(), sourceOffset, targetOffset);
-
-    targetOffset += tp.GetSize();
-  }
-  // Removing std::endl here breaks -alignment-output-file, so stop doing that, please :)
-  // Or fix it somewhere else.
-  out << std::endl;
+  Hypothesis::OutputAlignment(out, edges);
 }
 
 void Manager::OutputDetailedTranslationReport(OutputCollector *collector) const
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <vector>
 #include <list>
+#include <boost/scoped_ptr.hpp>
 #include "InputType.h"
 #include "Hypothesis.h"
 #include "StaticData.h"
@@ -35,6 +36,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Search.h"
 #include "SearchCubePruning.h"
 #include "BaseManager.h"
+#include "ObjectPool.h"
+#include "SentenceArena.h"
 
 namespace Moses
 {
@@ -64,6 +67,14 @@ struct SearchGraphNode {
 
 };
 
+/** Receives the nodes of the search graph one at a time (see Manager::VisitSearchGraph()) */
+class SearchGraphVisitor
+{
+public:
+  virtual ~SearchGraphVisitor() {}
+  virtual void Visit(const SearchGraphNode &node) = 0;
+};
+
 /** The Manager class implements a stack decoding algorithm for phrase-based decoding
  * Hypotheses are organized in stacks. One stack contains all hypothesis that have
  * the same number of foreign words translated.  The data structure for hypothesis
@@ -95,6 +106,29 @@ struct SearchGraphNode {
 
 class Manager : public BaseManager
 {
+public:
+  /** the arena and hypothesis pool of a sentence. Each thread keeps one
+   *  for its Managers, which is reset at the end of a sentence and keeps its
+   *  memory for the next one, up to -recycle-search-memory */
+  class Storage
+  {
+  public:
+    Storage() : hypothesisPool("Hypothesis", 1000), inUse(false) {}
+
+    SentenceArena arena;
+    ObjectPool<Hypothesis> hypothesisPool;
+    bool inUse; //!< by a Manager of the thread
+
+    size_t GetAllocatedBytes() const {
+      return arena.GetAllocatedBytes() + hypothesisPool.allocatedBytes();
+    }
+
+  private:
+    Storage(const Storage &);
+    void operator=(const Storage &);
+  };
+
+private:
   Manager();
   Manager(Manager const&);
   void operator=(Manager const&);
@@ -112,6 +146,8 @@ private:
 
 protected:
   // data
+  boost::scoped_ptr<Storage> m_ownStorage; /**< if the thread's storage is in use or not kept */
+  Storage *m_storage; /**< arena for the translation options and input paths, and the hypotheses of this sentence */
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
 
@@ -126,6 +162,10 @@ protected:
   void GetWinnerConnectedGraph(
     std::map< int, bool >* pConnected,
     std::vector< const Hypothesis* >* pConnectedList) const;
+  //! hypotheses connected to the final stack, by id. Through the previous hypotheses of arcs only if viaWinners
+  void FindConnectedHypotheses(std::vector<bool> &connected,
+                               std::vector< const Hypothesis* > &connectedList,
+                               bool viaWinners) const;
 
   // output
   // nbest
@@ -148,6 +188,10 @@ protected:
 
   void OutputWordGraph(std::ostream &outputWordGraphStream, const Hypothesis *hypo, size_t &linkId) const;
 
+  //! the storage of the thread if it is free, else m_ownStorage
+  Storage *AcquireStorage();
+  void ReleaseStorage();
+
   void OutputAlignment(std::ostringstream &out, const TrellisPath &path) const;
 
 public:
@@ -166,6 +210,9 @@ public:
   void GetOutputLanguageModelOrder( std::ostream &out, const Hypothesis *hypo ) const;
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
+  ObjectPool<Hypothesis> &GetHypothesisPool() {
+    return m_storage->hypothesisPool;
+  }
 
   void OutputLatticeMBRNBest(std::ostream& out, const std::vector<LatticeMBRSolution>& solutions,long translationId) const;
   void OutputBestHypo(const std::vector<Moses::Word>&  mbrBestHypo, long /*translationId*/,
@@ -180,6 +227,8 @@ public:
   void OutputSearchGraphAsSLF(long translationId, std::ostream &outputSearchGraphStream) const;
   void OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream) const;
   void GetSearchGraph(std::vector<SearchGraphNode>& searchGraph) const;
+  //! pass the nodes of GetSearchGraph() to visitor without collecting them
+  void VisitSearchGraph(SearchGraphVisitor &visitor) const;
   const InputType& GetSource() const {
     return m_source;
   }
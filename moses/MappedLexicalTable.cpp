@@ -0,0 +1,126 @@
+#include "MappedLexicalTable.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/murmur_hash.hh"
+#include "util/tokenize_piece.hh"
+
+namespace Moses
+{
+
+namespace
+{
+const char kMagic[8] = {'M', 'o', 's', 'e', 's', 'L', 'e', 'x'};
+const uint32_t kVersion = 1;
+
+uint64_t ColumnHash(const StringPiece &token, const std::vector<std::string> *vocab,
+                    const std::string &file, uint64_t lineNum)
+{
+  if (!vocab) return MappedLexicalTable::HashWord(token);
+  char *end;
+  std::string id(token.data(), token.size());
+  unsigned long i = std::strtoul(id.c_str(), &end, 10);
+  UTIL_THROW_IF2(*end || i >= vocab->size() || (*vocab)[i].empty(),
+                 "Line " << lineNum << " in " << file << " has unknown vocabulary id " << id);
+  return MappedLexicalTable::HashWord((*vocab)[i]);
+}
+}
+
+bool MappedLexicalTable::IsMapped(const std::string &path)
+{
+  util::scoped_fd fd;
+  try {
+    fd.reset(util::OpenReadOrThrow(path.c_str()));
+  } catch (const util::ErrnoException &) {
+    return false; // let the text reader report it
+  }
+  char magic[sizeof(kMagic)];
+  if (util::ReadOrEOF(fd.get(), magic, sizeof(magic)) != sizeof(magic)) return false;
+  return !std::memcmp(magic, kMagic, sizeof(kMagic));
+}
+
+uint64_t MappedLexicalTable::HashWord(const StringPiece &word)
+{
+  return util::MurmurHashNative(word.data(), word.size());
+}
+
+void MappedLexicalTable::InitHeader(Header &header)
+{
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.entrySize = sizeof(Entry);
+}
+
+void MappedLexicalTable::Load(const std::string &path, util::LoadMethod method)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  Header header, expected;
+  util::ReadOrThrow(fd.get(), &header, sizeof(header));
+  InitHeader(expected);
+  UTIL_THROW_IF2(std::memcmp(header.magic, expected.magic, sizeof(kMagic)),
+                 path << " is not a binary lexical table");
+  UTIL_THROW_IF2(header.version != expected.version || header.entrySize != expected.entrySize,
+                 path << " was binarized by an incompatible version of binarize-lex");
+  UTIL_THROW_IF2(util::SizeOrThrow(fd.get()) < sizeof(header) + header.tableBytes,
+                 path << " is truncated");
+
+  util::MapRead(method, fd.get(), 0, sizeof(header) + header.tableBytes, m_memory);
+  m_table = Table(static_cast<char*>(m_memory.get()) + sizeof(header), header.tableBytes);
+  m_size = header.entries;
+}
+
+void MappedLexicalTable::Create(const std::string &in, const std::string &out,
+                                const std::vector<std::string> *firstVocab,
+                                const std::vector<std::string> *secondVocab)
+{
+  uint64_t lines = 0;
+  {
+    util::FilePiece count(in.c_str());
+    StringPiece line;
+    while (count.ReadLineOrEOF(line)) ++lines;
+  }
+
+  Header header;
+  InitHeader(header);
+  header.tableBytes = Table::Size(lines, 1.5);
+
+  util::scoped_fd fd;
+  util::scoped_mmap mem(util::MapZeroedWrite(out.c_str(), sizeof(header) + header.tableBytes, fd),
+                        sizeof(header) + header.tableBytes);
+  Table table(static_cast<char*>(mem.get()) + sizeof(header), header.tableBytes);
+
+  util::FilePiece input(in.c_str());
+  StringPiece line;
+  std::string prob;
+  uint64_t lineNum = 0;
+  while (input.ReadLineOrEOF(line)) {
+    ++lineNum;
+    StringPiece tokens[3];
+    util::TokenIter<util::AnyCharacter, true> it(line, util::AnyCharacter(" \t"));
+    size_t numTokens = 0;
+    for (; it && numTokens < 3; ++it) tokens[numTokens++] = *it;
+    UTIL_THROW_IF2(numTokens != 3 || it, "Line " << lineNum << " in " << in << " has wrong number of tokens.");
+
+    Entry entry;
+    entry.key = Key(ColumnHash(tokens[0], firstVocab, in, lineNum),
+                    ColumnHash(tokens[1], secondVocab, in, lineNum));
+    prob.assign(tokens[2].data(), tokens[2].size());
+    entry.prob = std::atof(prob.c_str());
+
+    Table::MutableIterator found;
+    if (table.FindOrInsert(entry, found)) {
+      found->prob = entry.prob;
+    } else {
+      ++header.entries;
+    }
+  }
+
+  std::memcpy(mem.get(), &header, sizeof(header));
+}
+
+}
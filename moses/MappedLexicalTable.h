@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "util/mmap.hh"
+#include "util/probing_hash_table.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** Lexical translation probabilities in a binary probing hash table that is
+ *  mapped instead of parsed (see binarize-lex in phrase-extract).
+ *
+ *  The text tables have lines "first second prob", e.g. lex.e2f with the
+ *  target word first and the source word second.  An entry is keyed by the
+ *  hashes of both words in that order, so a reader that keeps the hashes of
+ *  its vocabulary needs one probe per lookup.  Entries take 12 bytes.
+ */
+class MappedLexicalTable
+{
+public:
+  MappedLexicalTable() : m_size(0) {}
+
+  //! true if path is a binary table (only the header is read)
+  static bool IsMapped(const std::string &path);
+
+  void Load(const std::string &path, util::LoadMethod method = util::POPULATE_OR_READ);
+
+  static uint64_t HashWord(const StringPiece &word);
+
+  static uint64_t Key(uint64_t firstHash, uint64_t secondHash) {
+    uint64_t key = firstHash ^ (secondHash + 0x9e3779b97f4a7c15ULL + (firstHash << 6) + (firstHash >> 2));
+    return key ? key : 1; // 0 marks empty buckets
+  }
+
+  bool Find(uint64_t key, float &prob) const {
+    Table::ConstIterator it;
+    if (!m_table.Find(key, it)) return false;
+    prob = it->prob;
+    return true;
+  }
+
+  bool Find(const StringPiece &first, const StringPiece &second, float &prob) const {
+    return Find(Key(HashWord(first), HashWord(second)), prob);
+  }
+
+  uint64_t Size() const {
+    return m_size;
+  }
+
+  /** Binarize the text table in (which may be compressed).  If a vocabulary
+   *  is given for a column, that column holds word ids (as in GIZA++ model 1
+   *  tables) and the words are looked up in it.  Later duplicates win, as
+   *  when loading the text. */
+  static void Create(const std::string &in, const std::string &out,
+                     const std::vector<std::string> *firstVocab = NULL,
+                     const std::vector<std::string> *secondVocab = NULL);
+
+private:
+#pragma pack(push)
+#pragma pack(4)
+  struct Entry {
+    typedef uint64_t Key;
+    uint64_t key;
+    float prob;
+
+    uint64_t GetKey() const {
+      return key;
+    }
+    void SetKey(uint64_t to) {
+      key = to;
+    }
+  };
+#pragma pack(pop)
+
+  typedef util::ProbingHashTable<Entry, util::IdentityHash> Table;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t entries;
+    uint64_t tableBytes;
+  };
+
+  static void InitHeader(Header &header);
+
+  util::scoped_memory m_memory;
+  Table m_table;
+  uint64_t m_size;
+};
+
+}
@@ -0,0 +1,106 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2010 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "MappedLexicalTable.h"
+#include "util/file.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+string WriteTemp(const string &contents)
+{
+  char name[] = "tempXXXXXX";
+  util::scoped_fd fd(mkstemp(name));
+  BOOST_REQUIRE(fd.get() > 0);
+  util::WriteOrThrow(fd.get(), contents.data(), contents.size());
+  return name;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(mapped_lexical_table)
+
+BOOST_AUTO_TEST_CASE(words)
+{
+  string text(WriteTemp("das the 0.5\nhaus house 0.25\nhaus the 0.125\nhaus house 0.75\nNULL the\t0.0625\n"));
+  string binary(WriteTemp(""));
+  MappedLexicalTable::Create(text, binary);
+
+  BOOST_CHECK(!MappedLexicalTable::IsMapped(text));
+  BOOST_CHECK(MappedLexicalTable::IsMapped(binary));
+  BOOST_CHECK(!MappedLexicalTable::IsMapped("does-not-exist"));
+
+  MappedLexicalTable table;
+  table.Load(binary);
+  BOOST_CHECK_EQUAL(static_cast<uint64_t>(4), table.Size());
+
+  float prob;
+  BOOST_REQUIRE(table.Find("das", "the", prob));
+  BOOST_CHECK_EQUAL(0.5, prob);
+  BOOST_REQUIRE(table.Find("haus", "house", prob)); // the later line wins
+  BOOST_CHECK_EQUAL(0.75, prob);
+  BOOST_REQUIRE(table.Find("NULL", "the", prob));
+  BOOST_CHECK_EQUAL(0.0625, prob);
+  BOOST_CHECK(!table.Find("the", "das", prob));
+  BOOST_CHECK(!table.Find("haus", "das", prob));
+
+  remove(text.c_str());
+  remove(binary.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(giza_ids)
+{
+  vector<string> source, target;
+  source.push_back("GIZANULL");
+  source.push_back("das");
+  target.push_back("GIZANULL");
+  target.push_back("");
+  target.push_back("the");
+
+  string text(WriteTemp("0 2 0.25\n1 2 0.5\n"));
+  string binary(WriteTemp(""));
+  MappedLexicalTable::Create(text, binary, &source, &target);
+
+  MappedLexicalTable table;
+  table.Load(binary);
+  float prob;
+  BOOST_REQUIRE(table.Find("GIZANULL", "the", prob));
+  BOOST_CHECK_EQUAL(0.25, prob);
+  BOOST_REQUIRE(table.Find("das", "the", prob));
+  BOOST_CHECK_EQUAL(0.5, prob);
+
+  string unknown(WriteTemp("1 1 0.5\n"));
+  BOOST_CHECK_THROW(MappedLexicalTable::Create(unknown, binary, &source, &target), util::Exception);
+
+  remove(text.c_str());
+  remove(binary.c_str());
+  remove(unknown.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
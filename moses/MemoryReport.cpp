@@ -0,0 +1,119 @@
+#include "MemoryReport.h"
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "moses/FF/FeatureFunction.h"
+#include "util/mmap.hh"
+#include "util/usage.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+string Escape(const string &str)
+{
+  string ret;
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] == '"' || str[i] == '\\') ret += '\\';
+    ret += str[i];
+  }
+  return ret;
+}
+
+double MB(uint64_t bytes)
+{
+  return bytes / (1024.0 * 1024.0);
+}
+
+void PrintUsage(ostream &out, const string &name, const MemoryUsage &usage)
+{
+  out << "Memory of " << name << ": heap " << MB(usage.heap) << " MB";
+  if (usage.mapped) {
+    out << ", mapped " << MB(usage.mapped) << " MB (" << MB(usage.resident) << " MB resident)";
+  }
+  if (usage.cache || usage.cacheEntries) {
+    out << ", cache " << MB(usage.cache) << " MB in " << usage.cacheEntries << " entries";
+  }
+  if (usage.cacheHits || usage.cacheMisses) {
+    out << ", " << 100.0 * usage.cacheHits / (usage.cacheHits + usage.cacheMisses)
+        << "% of " << (usage.cacheHits + usage.cacheMisses) << " lookups hit";
+  }
+  out << "\n";
+}
+
+}
+
+void MemoryUsage::AddMapped(const void *start, size_t size)
+{
+  if (!start || !size) return;
+  mapped += size;
+  resident += util::ResidentBytes(start, size);
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other)
+{
+  heap += other.heap;
+  mapped += other.mapped;
+  resident += other.resident;
+  cache += other.cache;
+  cacheEntries += other.cacheEntries;
+  cacheHits += other.cacheHits;
+  cacheMisses += other.cacheMisses;
+  return *this;
+}
+
+void MemoryReport::Print(ostream &out)
+{
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  MemoryUsage total;
+  ostringstream lines;
+  lines << fixed << setprecision(1);
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    MemoryUsage usage;
+    ffs[i]->ReportMemory(usage);
+    if (usage.Empty()) continue;
+    PrintUsage(lines, ffs[i]->GetScoreProducerDescription(), usage);
+    total += usage;
+  }
+  PrintUsage(lines, "all features", total);
+  lines << "Memory of the process: " << MB(util::ResidentMemory()) << " MB resident\n";
+  out << lines.str();
+}
+
+string MemoryReport::GetMetrics()
+{
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  ostringstream bytes, entries, lookups;
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    MemoryUsage usage;
+    ffs[i]->ReportMemory(usage);
+    if (usage.Empty()) continue;
+    const string feature = "feature=\"" + Escape(ffs[i]->GetScoreProducerDescription()) + "\"";
+    bytes << "moses_feature_memory_bytes{" << feature << ",kind=\"heap\"} " << usage.heap << "\n"
+          << "moses_feature_memory_bytes{" << feature << ",kind=\"mapped\"} " << usage.mapped << "\n"
+          << "moses_feature_memory_bytes{" << feature << ",kind=\"resident\"} " << usage.resident << "\n"
+          << "moses_feature_memory_bytes{" << feature << ",kind=\"cache\"} " << usage.cache << "\n";
+    entries << "moses_feature_cache_entries{" << feature << "} " << usage.cacheEntries << "\n";
+    if (usage.cacheHits || usage.cacheMisses) {
+      lookups << "moses_feature_cache_lookups_total{" << feature << ",result=\"hit\"} " << usage.cacheHits << "\n"
+              << "moses_feature_cache_lookups_total{" << feature << ",result=\"miss\"} " << usage.cacheMisses << "\n";
+    }
+  }
+
+  ostringstream out;
+  out << "# TYPE moses_resident_memory_bytes gauge\n"
+      << "moses_resident_memory_bytes " << util::ResidentMemory() << "\n"
+      << "# TYPE moses_feature_memory_bytes gauge\n" << bytes.str()
+      << "# TYPE moses_feature_cache_entries gauge\n" << entries.str()
+      << "# TYPE moses_feature_cache_lookups_total counter\n" << lookups.str();
+  return out.str();
+}
+
+}
@@ -0,0 +1,53 @@
+// -*- c++ -*-
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <stdint.h>
+
+namespace Moses
+{
+
+/** Memory held by one feature function, or by all of them, filled in by
+ *  FeatureFunction::ReportMemory(). Sizes are in bytes, and estimates
+ *  where a model can't know exactly (e.g. the nodes of a hash map).
+ */
+struct MemoryUsage {
+  uint64_t heap;          //!< allocated for the model itself
+  uint64_t mapped;        //!< files mapped into memory
+  uint64_t resident;      //!< the part of mapped in physical memory now
+  uint64_t cache;         //!< kept by caches, e.g. of phrase table lookups
+  uint64_t cacheEntries;
+  uint64_t cacheHits;     //!< lookups answered by the cache since loading
+  uint64_t cacheMisses;
+
+  MemoryUsage() : heap(0), mapped(0), resident(0), cache(0), cacheEntries(0)
+    , cacheHits(0), cacheMisses(0) {}
+
+  //! counts a mapping, and how much of it is resident
+  void AddMapped(const void *start, size_t size);
+
+  bool Empty() const {
+    return !heap && !mapped && !cache && !cacheEntries && !cacheHits && !cacheMisses;
+  }
+
+  MemoryUsage &operator+=(const MemoryUsage &other);
+};
+
+/** Where the memory of the decoder goes: what every feature function says
+ *  it holds, and the resident set size of the process, which also covers
+ *  what no feature accounts for (hypotheses, translation options, stacks).
+ *  Moses-cmd prints it after loading at -v 1 and after every sentence at
+ *  -v 2; the server reports it with the "metrics" method.
+ */
+class MemoryReport
+{
+public:
+  //! one line per feature function that holds any memory, and the totals
+  static void Print(std::ostream &out);
+
+  //! the same as gauges in Prometheus text format
+  static std::string GetMetrics();
+};
+
+}
@@ -106,6 +106,13 @@ public:
     if(mode & cleanUpOnDestruction) cleanUp();
   }
 
+  // memory allocated for objects, in bytes
+  size_t allocatedBytes() const {
+    size_t n=0;
+    for(size_t i=0; i<dataSize.size(); ++i) n+=dataSize[i];
+    return n*sizeof(Object);
+  }
+
   void printInfo(std::ostream& out) const {
     out<<"OPOOL ("<<name<<") info: "<<data.size()<<" "<<dataSize.size()<<" "
        <<freeObj.size()<<"\n"<<idx<<" "<<dIdx<<" "<<N<<"\n";
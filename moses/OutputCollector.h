@@ -22,6 +22,7 @@
 #define moses_OutputCollector_h
 
 #ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #endif
 
@@ -33,6 +34,9 @@
 #include <map>
 #include <ostream>
 #include <string>
+#include <utility>
+
+#include "moses/TextProcessing/TextProcessor.h"
 
 namespace Moses
 {
@@ -44,7 +48,8 @@ class OutputCollector
 public:
   OutputCollector(std::ostream* outStream= &std::cout, std::ostream* debugStream=&std::cerr) :
     m_nextOutput(0),m_outStream(outStream),m_debugStream(debugStream),
-    m_isHoldingOutputStream(false), m_isHoldingDebugStream(false) {}
+    m_isHoldingOutputStream(false), m_isHoldingDebugStream(false),
+    m_textProcessing(NULL) {}
 
   ~OutputCollector() {
     if (m_isHoldingOutputStream)
@@ -61,52 +66,91 @@ public:
     m_isHoldingDebugStream = true;
   }
 
+  //! expect sourceId to be written first, rather than 0
+  void SetNextOutput(int sourceId) {
+    m_nextOutput = sourceId;
+  }
+
   bool OutputIsCout() const {
     return (m_outStream == &std::cout);
   }
 
+  //! applied to every line written, on the writing thread; NULL for none
+  void SetTextProcessing(const TextProcessorChain *textProcessing) {
+    m_textProcessing = textProcessing;
+  }
+
   /**
     * Write or cache the output, as appropriate.
     **/
   void Write(int sourceId,const std::string& output,const std::string& debug="") {
+    if (m_textProcessing && !m_textProcessing->Empty()) {
+      std::string processed(output);
+      m_textProcessing->ProcessLines(processed);
+      WriteProcessed(sourceId, processed, debug);
+    } else {
+      WriteProcessed(sourceId, output, debug);
+    }
+  }
+
+  /**
+    * Block until sourceId is fewer than window outputs ahead of the next one
+    * to be written. Called before a sentence is handed to the thread pool,
+    * this bounds the number of outputs waiting behind a slow sentence.
+    **/
+  void WaitForTurn(int sourceId, size_t window) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (sourceId >= m_nextOutput + static_cast<int>(window)) {
+      m_written.wait(lock);
+    }
+#endif
+  }
+
+
+private:
+  void WriteProcessed(int sourceId,const std::string& output,const std::string& debug) {
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_mutex);
 #endif
     if (sourceId == m_nextOutput) {
       //This is the one we were expecting
-      *m_outStream << output << std::flush;
-      *m_debugStream << debug << std::flush;
+      *m_outStream << output;
+      *m_debugStream << debug;
       ++m_nextOutput;
       //see if there's any more
-      std::map<int,std::string>::iterator iter;
-      while ((iter = m_outputs.find(m_nextOutput)) != m_outputs.end()) {
-        *m_outStream << iter->second << std::flush;
+      std::map<int,Pending>::iterator iter;
+      while ((iter = m_pending.find(m_nextOutput)) != m_pending.end()) {
+        *m_outStream << iter->second.first;
+        *m_debugStream << iter->second.second;
+        m_pending.erase(iter);
         ++m_nextOutput;
-        std::map<int,std::string>::iterator debugIter = m_debugs.find(iter->first);
-        m_outputs.erase(iter);
-        if (debugIter != m_debugs.end()) {
-          *m_debugStream << debugIter->second << std::flush;
-          m_debugs.erase(debugIter);
-        }
       }
+      *m_outStream << std::flush;
+      *m_debugStream << std::flush;
+#ifdef WITH_THREADS
+      m_written.notify_all();
+#endif
     } else {
       //save for later
-      m_outputs[sourceId] = output;
-      m_debugs[sourceId] = debug;
+      Pending &pending = m_pending[sourceId];
+      pending.first = output;
+      pending.second = debug;
     }
   }
 
+  typedef std::pair<std::string, std::string> Pending; //!< output and debug output
 
-private:
-  std::map<int,std::string> m_outputs;
-  std::map<int,std::string> m_debugs;
+  std::map<int,Pending> m_pending;
   int m_nextOutput;
   std::ostream* m_outStream;
   std::ostream* m_debugStream;
   bool m_isHoldingOutputStream;
   bool m_isHoldingDebugStream;
+  const TextProcessorChain *m_textProcessing;
 #ifdef WITH_THREADS
   boost::mutex m_mutex;
+  boost::condition_variable m_written;
 #endif
 
 public:
@@ -67,11 +67,29 @@ void PDTAimp::CleanUp()
   m_tgtColls.clear();
   m_cache.clear();
   m_rangeCache.clear();
+  m_prefixes.clear();
   uniqSrcPhr.clear();
 }
 
+PDTAimp::PPtr const*
+PDTAimp::ExtendPrefix(PPtr const* prefix, Word const& word) const
+{
+  assert(m_dict);
+  PPtr root;
+  if (!prefix) {
+    root = m_dict->GetRoot();
+    prefix = &root;
+  }
+  std::string s;
+  Factors2String(word, s);
+  PPtr next = m_dict->Extend(*prefix, s);
+  if (!next) return NULL;
+  m_prefixes.push_back(next);
+  return &m_prefixes.back();
+}
+
 TargetPhraseCollectionWithSourcePhrase const*
-PDTAimp::GetTargetPhraseCollection(Phrase const &src) const
+PDTAimp::GetTargetPhraseCollection(Phrase const &src, PPtr const* prefix) const
 {
 
   assert(m_dict);
@@ -86,16 +104,19 @@ PDTAimp::GetTargetPhraseCollection(Phrase const &src) const
     return (i!=m_cache.end() ? i->second : 0);
   }
 
-  std::vector<std::string> srcString(src.GetSize());
-  // convert source Phrase into vector of strings
-  for(size_t i=0; i<srcString.size(); ++i) {
-    Factors2String(src.GetWord(i),srcString[i]);
-  }
-
   // get target phrases in string representation
   std::vector<StringTgtCand> cands;
   std::vector<std::string> wacands;
-  m_dict->GetTargetCandidates(srcString,cands,wacands);
+  if (prefix) {
+    m_dict->GetTargetCandidates(*prefix,cands,wacands);
+  } else {
+    std::vector<std::string> srcString(src.GetSize());
+    // convert source Phrase into vector of strings
+    for(size_t i=0; i<srcString.size(); ++i) {
+      Factors2String(src.GetWord(i),srcString[i]);
+    }
+    m_dict->GetTargetCandidates(srcString,cands,wacands);
+  }
   if(cands.empty()) {
     return 0;
   }
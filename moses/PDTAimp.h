@@ -16,6 +16,8 @@
 #include "moses/FF/InputFeature.h"
 #include "util/exception.hh"
 
+#include <deque>
+
 namespace Moses
 {
 
@@ -69,8 +71,6 @@ public:
 
   void CleanUp();
 
-  TargetPhraseCollectionWithSourcePhrase const*
-  GetTargetPhraseCollection(Phrase const &src) const;
 
   void Create(const std::vector<FactorType> &input
               , const std::vector<FactorType> &output
@@ -79,6 +79,17 @@ public:
 
 
   typedef PhraseDictionaryTree::PrefixPtr PPtr;
+
+  //! target candidates of src, looked up from prefix if it is given, which
+  //! must be the node of src
+  TargetPhraseCollectionWithSourcePhrase const*
+  GetTargetPhraseCollection(Phrase const &src, PPtr const* prefix = NULL) const;
+
+  //! the node of prefix extended by word, NULL if the table has no entry
+  //! starting with the result; a NULL prefix stands for the root. Valid
+  //! until CleanUp()
+  PPtr const* ExtendPrefix(PPtr const* prefix, Word const& word) const;
+  mutable std::deque<PPtr> m_prefixes;
   typedef unsigned short Position;
   typedef std::pair<Position,Position> Range;
   struct State {
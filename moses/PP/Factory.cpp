@@ -2,8 +2,14 @@
 #include "moses/PP/Factory.h"
 #include "util/exception.hh"
 #include <iostream>
+#include <map>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 #include "moses/PP/CountsPhraseProperty.h"
 #include "moses/PP/SourceLabelsPhraseProperty.h"
 #include "moses/PP/TreeStructurePhraseProperty.h"
@@ -35,6 +41,22 @@ template <class P> boost::shared_ptr<P> PhrasePropertyCreator::Create(P *propert
 namespace
 {
 
+// interned property keys, shared by all phrase tables
+struct KeyTable {
+  std::map<std::string, size_t> ids;
+  std::vector<std::string> names;
+  std::vector<bool> onLoad;
+#ifdef WITH_THREADS
+  boost::shared_mutex lock;
+#endif
+};
+
+KeyTable &Keys()
+{
+  static KeyTable keys;
+  return keys;
+}
+
 template <class P> class DefaultPhrasePropertyCreator : public PhrasePropertyCreator
 {
 public:
@@ -85,6 +107,57 @@ boost::shared_ptr<PhraseProperty> PhrasePropertyFactory::ProduceProperty(const s
   return i->second->CreateProperty(value);
 }
 
+size_t PhrasePropertyFactory::GetKeyId(const std::string &key)
+{
+  KeyTable &keys = Keys();
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(keys.lock);
+#endif
+    std::map<std::string, size_t>::const_iterator i = keys.ids.find(key);
+    if (i != keys.ids.end()) return i->second;
+  }
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(keys.lock);
+#endif
+  std::pair<std::map<std::string, size_t>::iterator, bool> inserted
+    = keys.ids.insert(std::make_pair(key, keys.names.size()));
+  if (inserted.second) {
+    keys.names.push_back(key);
+    keys.onLoad.push_back(false);
+  }
+  return inserted.first->second;
+}
+
+std::string PhrasePropertyFactory::GetKeyName(size_t id)
+{
+  KeyTable &keys = Keys();
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(keys.lock);
+#endif
+  UTIL_THROW_IF2(id >= keys.names.size(), "Unknown phrase property key id " << id);
+  return keys.names[id];
+}
+
+void PhrasePropertyFactory::DecodeOnLoad(const std::string &key)
+{
+  size_t id = GetKeyId(key);
+  KeyTable &keys = Keys();
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(keys.lock);
+#endif
+  keys.onLoad[id] = true;
+}
+
+bool PhrasePropertyFactory::IsDecodedOnLoad(size_t id)
+{
+  KeyTable &keys = Keys();
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(keys.lock);
+#endif
+  return id < keys.onLoad.size() && keys.onLoad[id];
+}
+
 void PhrasePropertyFactory::PrintPP() const
 {
   std::cerr << "Registered phrase properties:" << std::endl;
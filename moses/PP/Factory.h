@@ -19,6 +19,16 @@ public:
   ~PhrasePropertyFactory();
 
   boost::shared_ptr<PhraseProperty> ProduceProperty(const std::string &key, const std::string &value) const;
+
+  //! small, dense id of a property key, the same for the whole run
+  static size_t GetKeyId(const std::string &key);
+  static std::string GetKeyName(size_t id);
+
+  //! decode properties with this key as phrases are loaded. Features that
+  //! read a property during search call this in their constructor; other
+  //! properties are kept as strings and decoded on first access.
+  static void DecodeOnLoad(const std::string &key);
+  static bool IsDecodedOnLoad(size_t id);
   void PrintPP() const;
 
 private:
@@ -0,0 +1,81 @@
+#include "moses/PP/TreeStructurePhraseProperty.h"
+#include "moses/FactorCollection.h"
+#include "util/exception.hh"
+
+#include <limits>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+namespace
+{
+#ifdef WITH_THREADS
+boost::mutex s_stringMutex;
+#endif
+
+std::string Label(const Factor *factor)
+{
+  return factor ? factor->GetString().as_string() : std::string();
+}
+}
+
+void TreeStructurePhraseProperty::ProcessValue(const std::string &value)
+{
+  InternalTree tree(value);
+  m_nodes.clear();
+  Flatten(tree);
+  std::vector<Node>(m_nodes).swap(m_nodes);
+}
+
+void TreeStructurePhraseProperty::Flatten(InternalTree &tree)
+{
+  std::vector<TreePointer> &children = tree.GetChildren();
+  UTIL_THROW_IF2(children.size() > (std::numeric_limits<uint32_t>::max() >> 1), "Too many children in tree node " << tree.GetLabel());
+
+  Node node;
+  node.label = tree.GetLabel().empty() ? NULL : FactorCollection::Instance().AddFactor(tree.GetLabel());
+  node.info = (uint32_t(children.size()) << 1) | (tree.IsTerminal() ? 1 : 0);
+  m_nodes.push_back(node);
+
+  for (size_t i = 0; i < children.size(); ++i) {
+    Flatten(*children[i]);
+  }
+}
+
+size_t TreeStructurePhraseProperty::Build(InternalTree &tree, size_t pos) const
+{
+  const size_t numChildren = m_nodes[pos++].info >> 1;
+  for (size_t i = 0; i < numChildren; ++i) {
+    const Node &child = m_nodes[pos];
+    const std::string label = Label(child.label);
+    tree.GetChildren().push_back(boost::make_shared<InternalTree>(label, 0, label.size(), (child.info & 1) != 0));
+    pos = Build(*tree.GetChildren().back(), pos);
+  }
+  return pos;
+}
+
+TreePointer TreeStructurePhraseProperty::GetTree() const
+{
+  UTIL_THROW_IF2(m_nodes.empty(), "Empty tree property");
+  const std::string label = Label(m_nodes[0].label);
+  TreePointer tree(boost::make_shared<InternalTree>(label, 0, label.size(), (m_nodes[0].info & 1) != 0));
+  Build(*tree, 0);
+  return tree;
+}
+
+const std::string *TreeStructurePhraseProperty::GetValueString() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_stringMutex);
+#endif
+  if (!m_string && !m_nodes.empty()) {
+    m_string.reset(new std::string(GetTree()->GetString()));
+  }
+  return m_string.get();
+}
+
+} // namespace Moses
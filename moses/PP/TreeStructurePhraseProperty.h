@@ -1,17 +1,44 @@
-
 #pragma once
 
 #include "moses/PP/PhraseProperty.h"
+#include "moses/FF/InternalTree.h"
 #include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <stdint.h>
 
 namespace Moses
 {
 
+class Factor;
+
+/** the "Tree" property: the target tree fragment of a rule, kept as its
+ *  nodes in preorder with interned labels instead of the string, which is
+ *  only made again if asked for (e.g. for output).
+ */
 class TreeStructurePhraseProperty : public PhraseProperty
 {
 public:
   TreeStructurePhraseProperty() {};
 
+  void ProcessValue(const std::string &value);
+
+  //! the fragment as a string, made on first call
+  const std::string *GetValueString() const;
+
+  //! a new tree of the fragment, for a hypothesis to combine with others
+  TreePointer GetTree() const;
+
+protected:
+  struct Node {
+    const Factor *label; //!< NULL for an empty label
+    uint32_t info;       //!< number of children << 1 | terminal
+  };
+  std::vector<Node> m_nodes;
+  mutable boost::scoped_ptr<std::string> m_string;
+
+  void Flatten(InternalTree &tree);
+  size_t Build(InternalTree &tree, size_t pos) const;
 };
 
 } // namespace Moses
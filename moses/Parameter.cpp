@@ -53,6 +53,8 @@ Parameter::Parameter()
   AddParam(main_opts,"verbose", "v", "verbosity level of the logging");
   AddParam(main_opts,"show-weights", "print feature weights and exit");
   AddParam(main_opts,"time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
+  AddParam(main_opts,"time-budget", "wall-clock seconds per sentence; beams are tightened once half of it is used up, and the search turns greedy when it is gone (default 0=unlimited)");
+  AddParam(main_opts,"profile", "record time and calls of each feature function, phrase table lookups, cache hits and hypothesis counts per sentence; written as one JSON line per sentence to the given file ('-' for stderr). Totals are served by the server's 'metrics' method");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // factorization options
@@ -89,11 +91,15 @@ Parameter::Parameter()
 
   po::options_description tune_opts("Options used in tuning.");
   AddParam(tune_opts,"weight-overwrite", "special parameter for mert. All on 1 line. Overrides weights specified in 'weights' argument");
+  AddParam(tune_opts,"tuning-loop", "keep the models loaded and decode the input file once for every line 'output-file ||| n-best-file ||| weights [||| sparse-weight-file]' read from stdin. The weights, given as for weight-overwrite, replace all weights. Tables that prune by weighted score when loading (in-memory, frozen-weights) keep their initial pruning");
   AddParam(tune_opts,"feature-add", "Add a feature function on the command line. Used by mira to add BLEU feature");
   AddParam(tune_opts,"weight-add", "Add weight for FF if it doesn't exist, i.e weights here are added 1st, and can be override by the ini file or on the command line. Used to specify initial weights for FF that was also specified on the copmmand line");
 
   // phrase table limitations:
   AddParam(search_opts,"max-partial-trans-opt", "maximum number of partial translation options per input span (during mapping steps)");
+  AddParam(search_opts,"coarse-to-fine", "decode every sentence twice: first with the given alternate weight setting (typically ignoring expensive features), then with the full model, constrained by the ConstrainedDecoding feature to the first pass's n-best translations. Arguments: weight-setting [n-best-size] (default size 100)");
+  AddParam(search_opts,"lazy-factor-expansion", "expand partial translation options best-first in each mapping step, creating at most max-partial-trans-opt of them instead of all combinations (factored models)");
+  AddParam(search_opts,"lazy-score-breakdown", "phrase-based search: keep only the weighted score of a hypothesis during search and recompute its feature scores when they are output (n-best lists, search graphs, score reports)");
   AddParam(search_opts,"max-trans-opt-per-coverage", "maximum number of translation options per input span (after applying mapping steps)");
   AddParam(search_opts,"max-phrase-length", "maximum phrase length (default 20)");
   AddParam(search_opts,"translation-option-threshold", "tot", "threshold for translation options relative to best for input phrase");
@@ -102,6 +108,18 @@ Parameter::Parameter()
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"search-threads", "phrase-based search: score translation options, by start position, and the expansions of each stack on this many threads (default = 1)");
+  AddParam(search_opts,"translation-cache", "megabytes of single-best translations of whole sentences to keep and reuse for identical inputs (default 0 = no cache); not used when n-best lists, search graphs, alignments or other extra output is requested");
+  AddParam(search_opts,"translation-cache-dir", "directory to share the translation cache through, e.g. between servers");
+  AddParam(search_opts,"translation-cache-version", "model version, part of every translation cache key; change it when models change under a shared cache directory");
+  AddParam(search_opts,"translation-option-cache", "number of source spans whose translation options to keep and reuse for later inputs (default 0 = no cache); not used if a feature function depends on the source context");
+  AddParam(search_opts,"output-window", "with threads, do not start a sentence until the output of the sentence this many lines before it has been written (default 0 = no limit)");
+  AddParam(search_opts,"recycle-search-memory", "megabytes of hypotheses and translation options each decoding thread keeps allocated for its next sentence (default 64, 0 = free them after every sentence)");
+  AddParam(search_opts,"schedule-window", "with threads, hold back this many inputs and start the longest first, so that a long sentence does not delay the end of the job (default 0 = in input order)");
+  AddParam(search_opts,"search-threads-min-length", "use -search-threads only for sentences of at least this many words (default 0 = for all)");
+  AddParam(search_opts,"batch-sentences", "translate this many consecutive short sentences as one task (default 1 = each sentence on its own)");
+  AddParam(search_opts,"batch-max-length", "words of the longest sentence that goes into a batch of -batch-sentences (default 20)");
+  AddParam(search_opts,"parallel-load", "load independent models concurrently, using the decoding threads (default false)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -115,6 +133,8 @@ Parameter::Parameter()
   AddParam(cube_opts,"cube-pruning-pop-limit", "cbp", "How many hypotheses should be popped for each stack. (default = 1000)");
   AddParam(cube_opts,"cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam(cube_opts,"cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
+  AddParam(cube_opts,"cube-pruning-early-stop", "Chart decoding: stop popping a cell once the best remaining rule cube is this much below the k-th best hypothesis of the cell, k being the stack size (default = off)");
+  AddParam(cube_opts,"cube-pruning-threads", "Chart decoding: score the rule cubes of a cell on this many threads (default = 1)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // minimum bayes risk decoding
@@ -151,6 +171,7 @@ Parameter::Parameter()
   AddParam(input_opts,"xml-input", "xi", "allows markup of input with desired translations and probabilities. values can be 'pass-through' (default), 'inclusive', 'exclusive', 'constraint', 'ignore'");
   AddParam(input_opts,"xml-brackets", "xb", "specify strings to be used as xml tags opening and closing, e.g. \"{{ }}\" (default \"< >\"). Avoid square brackets because of configuration file format. Valid only with text input mode" );
   AddParam(input_opts,"start-translation-id", "Id of 1st input. Default = 0");
+  AddParam(input_opts,"input-processing", "steps applied to text input before decoding, one per line, e.g. 'Tokenize lang=en', 'Escape', 'Truecase model=PATH'");
   AddParam(input_opts,"alternate-weight-setting", "aws", "alternate set of weights to used per xml specification");
 
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -158,6 +179,7 @@ Parameter::Parameter()
   po::options_description output_opts("Output Options"); 
   AddParam(output_opts,"report-all-factors", "report all factors in output, not just first");
   AddParam(output_opts,"output-factors", "list if factors in the output");
+  AddParam(output_opts,"output-processing", "steps applied to the single-best output, one per line, e.g. 'Detruecase', 'Unescape', 'Detokenize lang=en'");
   AddParam(output_opts,"print-id", "prefix translations with id. Default if false");
   AddParam(output_opts,"print-passthrough", "output the sgml tag <passthrough> without any computation on that. Default is false");
   AddParam(output_opts,"print-passthrough-in-n-best", "output the sgml tag <passthrough> without any computation on that in each entry of the n-best-list. Default is false");
@@ -187,7 +209,7 @@ Parameter::Parameter()
 #ifdef HAVE_PROTOBUF
   AddParam(osg_opts,"output-search-graph-pb", "pb", "Write phrase lattice to protocol buffer objects in the specified path.");
 #endif
-  AddParam(osg_opts,"output-search-graph-hypergraph", "DEPRECATED! Output connected hypotheses of search into specified directory, one file per sentence, in a hypergraph format (see Kenneth Heafield's lazy hypergraph decoder). This flag is followed by 3 values: 'true (gz|txt|bz) directory-name'");
+  AddParam(osg_opts,"output-search-graph-hypergraph", "DEPRECATED! Output connected hypotheses of search into specified directory, one file per sentence, in a hypergraph format (see Kenneth Heafield's lazy hypergraph decoder). This flag is followed by 3 values: 'true (gz|txt|bz2|bin) directory-name', where bin is a binary format (chart decoder only)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // nbest-options
@@ -209,7 +231,10 @@ Parameter::Parameter()
   po::options_description server_opts("Moses Server Options"); 
   AddParam(server_opts,"server", "Run moses as a translation server.");
   AddParam(server_opts,"server-port", "Port for moses server");
+  AddParam(server_opts,"server-max-queue", "Maximum number of queued requests; lower-priority or new requests are dropped beyond it (default 0: no limit)");
   AddParam(server_opts,"server-log", "Log destination for moses server");
+  AddParam(server_opts,"server-binary-port", "Also serve translate requests on this port with the binary protocol of moses/server/BinaryServer.h, which skips XML and HTTP (default 0: off)");
+  AddParam(server_opts,"session-timeout", "Seconds after which the state of an idle server session (\"session-id\" of a request) is dropped (default 1800)");
   AddParam(server_opts,"serial", "Run server in serial mode, processing only one request at a time.");
 
   po::options_description irstlm_opts("IRSTLM Options"); 
@@ -229,6 +254,7 @@ Parameter::Parameter()
   AddParam(misc_opts,"no-cache", "Disable all phrase-table caching. Default = false (ie. enable caching)");
   AddParam(misc_opts,"default-non-term-for-empty-range-only", "Don't add [X] to all ranges, just ranges where there isn't a source non-term. Default = false (ie. add [X] everywhere)");
   AddParam(misc_opts,"s2t-parsing-algorithm", "Which S2T parsing algorithm to use. 0=recursive CYK+, 1=scope-3 (default = 0)");
+  AddParam(misc_opts,"s2t-max-cell-categories", "S2T: keep parse vertices for at most this many LHS categories per span, the ones with the best hyperedges. 0=unlimited (default = 0)");
 
   //AddParam(o,"continue-partial-translation", "cpt", "start from nonempty hypothesis");
   AddParam(misc_opts,"decoding-graph-backoff", "dpb", "only use subsequent decoding paths for unknown spans of given length");
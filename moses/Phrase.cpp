@@ -36,14 +36,14 @@ using namespace std;
 namespace Moses
 {
 
-Phrase::Phrase() {}
+Phrase::Phrase() : m_hash(0) {}
 
-Phrase::Phrase(size_t reserveSize)
+Phrase::Phrase(size_t reserveSize) : m_hash(0)
 {
   m_words.reserve(reserveSize);
 }
 
-Phrase::Phrase(const vector< const Word* > &mergeWords)
+Phrase::Phrase(const vector< const Word* > &mergeWords) : m_hash(0)
 {
   m_words.reserve(mergeWords.size());
   for (size_t currPos = 0 ; currPos < mergeWords.size() ; currPos++) {
@@ -130,6 +130,7 @@ std::string Phrase::GetStringRep(const vector<FactorType> factorsToPrint) const
 
 Word &Phrase::AddWord()
 {
+  InvalidateHash();
   m_words.push_back(Word());
   return m_words.back();
 }
@@ -227,6 +228,16 @@ void Phrase::CreateFromString(FactorDirection direction
   }
 }
 
+size_t Phrase::ComputeHash() const
+{
+  size_t seed = 0;
+  for (size_t i = 0; i < GetSize(); ++i) {
+    boost::hash_combine(seed, GetWord(i));
+  }
+  // 0 marks a hash not computed yet
+  return seed ? seed : 1;
+}
+
 int Phrase::Compare(const Phrase &other) const
 {
 #ifdef min
@@ -50,6 +50,13 @@ class Phrase
   // private:
 protected:
   std::vector<Word>			m_words;
+  //! hash of m_words, 0 until computed; reset by every non-const access.
+  //! Threads racing to compute it store the same value.
+  mutable size_t m_hash;
+
+  void InvalidateHash() {
+    m_hash = 0;
+  }
 
 public:
   /** No longer does anything as not using mem pool for Phrase class anymore */
@@ -68,6 +75,7 @@ public:
    */
   void SwapWords(Phrase &other) {
     swap(m_words, other.m_words);
+    std::swap(m_hash, other.m_hash);
   }
 
   /** destructor */
@@ -110,14 +118,17 @@ public:
     return m_words[pos];
   }
   inline Word &GetWord(size_t pos) {
+    InvalidateHash();
     return m_words[pos];
   }
 
   inline Word &Front() {
+    InvalidateHash();
     return m_words[0];
   }
 
   inline Word &Back() {
+    InvalidateHash();
     return m_words[GetSize() - 1];
   }
 
@@ -135,6 +146,7 @@ public:
     return ptr[factorType];
   }
   inline void SetFactor(size_t pos, FactorType factorType, const Factor *factor) {
+    InvalidateHash();
     Word &ptr = m_words[pos];
     ptr[factorType] = factor;
   }
@@ -163,12 +175,14 @@ public:
 
   void Clear() {
     m_words.clear();
+    InvalidateHash();
   }
 
   void RemoveWord(size_t pos) {
     UTIL_THROW_IF2(pos >= m_words.size(),
                    "Referencing position " << pos << " out of bound");
     m_words.erase(m_words.begin() + pos);
+    InvalidateHash();
   }
 
   void InitStartEndWord();
@@ -185,6 +199,12 @@ public:
 
   int Compare(const Phrase &other) const;
 
+  //! hash of the words, kept until the phrase is changed
+  size_t hash() const {
+    if (!m_hash) m_hash = ComputeHash();
+    return m_hash;
+  }
+
   /** transitive comparison between 2 phrases
    *		used to insert & find phrase in dictionary
    */
@@ -198,15 +218,13 @@ public:
 
   void OnlyTheseFactors(const FactorMask &factors);
 
+private:
+  size_t ComputeHash() const;
 };
 
 inline size_t hash_value(const Phrase& phrase)
 {
-  size_t  seed = 0;
-  for (size_t i = 0; i < phrase.GetSize(); ++i) {
-    boost::hash_combine(seed, phrase.GetWord(i));
-  }
-  return seed;
+  return phrase.hash();
 }
 
 struct PhrasePtrComparator {
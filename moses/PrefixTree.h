@@ -161,21 +161,30 @@ public:
     if(f) read();
   }
 
+  //! a node of a mapped file, read from c
+  PrefixTreeF(MapCursor& c) : f(0) {
+    read(c);
+  }
+
   ~PrefixTreeF() {
     free();
   }
 
   void read() {
-    startPos=fTell(f);
-    fReadVector(f,keys);
-    fReadVector(f,data);
+    read(f);
+  }
+
+  // in is a FILE* or a MapCursor
+  template<typename In> void read(In& in) {
+    startPos=fTell(in);
+    fReadVector(in,keys);
+    fReadVector(in,data);
     ptr.clear();
     ptr.resize(keys.size());
     std::vector<OFF_T> rawOffs(keys.size());
-    size_t bytes_read = fread(&rawOffs[0], sizeof(OFF_T), keys.size(), f);
-    UTIL_THROW_IF2(bytes_read != keys.size(), "Read error at " << HERE);
+    if(!rawOffs.empty()) fReadArray(in,&rawOffs[0],rawOffs.size());
     for(size_t i=0; i<ptr.size(); ++i)
-      if (rawOffs[i]) ptr[i].set(f, rawOffs[i]);
+      if (rawOffs[i]) ptr[i].set(in, rawOffs[i]);
   }
 
   void free() {
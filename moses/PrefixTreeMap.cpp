@@ -10,6 +10,16 @@ using namespace std;
 namespace Moses
 {
 void GenericCandidate::readBin(FILE* f)
+{
+  read(f);
+}
+
+void GenericCandidate::readBin(MapCursor& c)
+{
+  read(c);
+}
+
+template<typename In> void GenericCandidate::read(In& f)
 {
   m_PhraseList.clear();
   m_ScoreList.clear();
@@ -53,6 +63,16 @@ void Candidates::writeBin(FILE* f) const
 }
 
 void Candidates::readBin(FILE* f)
+{
+  read(f);
+}
+
+void Candidates::readBin(MapCursor& c)
+{
+  read(c);
+}
+
+template<typename In> void Candidates::read(In& f)
 {
   uint32_t s;
   fRead(f,s);
@@ -67,12 +87,6 @@ const LabelId PrefixTreeMap::MagicWord = std::numeric_limits<LabelId>::max() - 1
 //////////////////////////////////////////////////////////////////
 PrefixTreeMap::~PrefixTreeMap()
 {
-  if(m_FileSrc) {
-    fClose(m_FileSrc);
-  }
-  if(m_FileTgt) {
-    fClose(m_FileTgt);
-  }
   FreeMemory();
 }
 
@@ -117,14 +131,9 @@ int PrefixTreeMap::Read(const std::string& fileNameStem, int numVocs)
   fReadVector(ii,srcOffsets);
   fClose(ii);
 
-  if (m_FileSrc) {
-    fClose(m_FileSrc);
-  }
-  m_FileSrc = fOpen(ifs.c_str(),"rb");
-  if (m_FileTgt) {
-    fClose(m_FileTgt);
-  }
-  m_FileTgt = fOpen(ift.c_str(),"rb");
+  FreeMemory();
+  m_FileSrc = fMapRead(ifs, m_SrcMem);
+  m_FileTgt = fMapRead(ift, m_TgtMem);
 
   m_Data.resize(srcOffsets.size());
 
@@ -168,8 +177,9 @@ void PrefixTreeMap::GetCandidates(const IPhrase& key, Candidates* cands)
   if(candOffset == InvalidOffT) {
     return;
   }
-  fSeek(m_FileTgt,candOffset);
-  cands->readBin(m_FileTgt);
+  MapCursor c(m_FileTgt);
+  fSeek(c,candOffset);
+  cands->readBin(c);
 }
 
 void PrefixTreeMap::GetCandidates(const PPimp& p, Candidates* cands)
@@ -182,8 +192,9 @@ void PrefixTreeMap::GetCandidates(const PPimp& p, Candidates* cands)
   if(candOffset == InvalidOffT) {
     return;
   }
-  fSeek(m_FileTgt,candOffset);
-  cands->readBin(m_FileTgt);
+  MapCursor c(m_FileTgt);
+  fSeek(c,candOffset);
+  cands->readBin(c);
 }
 
 std::vector< std::string const * > PrefixTreeMap::ConvertPhrase(const IPhrase& p, unsigned int voc) const
@@ -11,6 +11,7 @@
 #include "File.h"
 #include "LVoc.h"
 #include "ObjectPool.h"
+#include "util/mmap.hh"
 
 namespace Moses
 {
@@ -53,8 +54,11 @@ public:
     return m_ScoreList.at(i);
   }
   void readBin(FILE* f);
+  void readBin(MapCursor& c);
   void writeBin(FILE* f) const;
 private:
+  template<typename In> void read(In& f);
+
   PhraseList m_PhraseList;
   ScoreList  m_ScoreList;
 };
@@ -91,12 +95,15 @@ public:
   };
   void writeBin(FILE* f) const;
   void readBin(FILE* f);
+  void readBin(MapCursor& c);
+private:
+  template<typename In> void read(In& f);
 };
 
 class PrefixTreeMap
 {
 public:
-  PrefixTreeMap() : m_FileSrc(0), m_FileTgt(0) {
+  PrefixTreeMap() {
     PTF::setDefault(InvalidOffT);
   }
   ~PrefixTreeMap();
@@ -123,8 +130,10 @@ public: //low level
   }
 private:
   Data  m_Data;
-  FILE* m_FileSrc;
-  FILE* m_FileTgt;
+  // the source tree and the candidates, mapped
+  util::scoped_memory m_SrcMem, m_TgtMem;
+  MapCursor m_FileSrc;
+  MapCursor m_FileTgt;
 
   std::vector<WordVoc*> m_Voc;
   ObjectPool<PPimp>     m_PtrPool;
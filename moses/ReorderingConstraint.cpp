@@ -28,6 +28,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 namespace Moses
 {
 
+ReorderingConstraint::~ReorderingConstraint()
+{
+  if (m_wall != NULL) free(m_wall);
+  if (m_localWall != NULL) free(m_localWall);
+  delete m_wallMask;
+  RemoveAllInColl(m_localWallMask);
+}
+
 //! allocate memory for reordering walls
 void ReorderingConstraint::InitializeWalls(size_t size)
 {
@@ -72,6 +80,18 @@ void ReorderingConstraint::FinalizeWalls()
       }
     }
   }
+
+  // the same as bitmaps
+  delete m_wallMask;
+  RemoveAllInColl(m_localWallMask);
+  m_wallMask = new WordsBitmap(m_size);
+  for(size_t z = 0; z < m_zone.size(); z++ ) {
+    m_localWallMask.push_back(new WordsBitmap(m_size));
+  }
+  for( size_t pos = 0; pos < m_size; pos++ ) {
+    if (m_wall[ pos ]) m_wallMask->SetValue(pos, true);
+    if (m_localWall[ pos ] != NOT_A_ZONE) m_localWallMask[ m_localWall[ pos ] ]->SetValue(pos, true);
+  }
 }
 
 //! set walls based on "-monotone-at-punctuation" flag
@@ -119,11 +139,9 @@ bool ReorderingConstraint::Check( const WordsBitmap &bitmap, size_t startPos, si
     // if there is a wall before the last word,
     // we created a gap while moving through wall
     // -> violation
-    for( size_t pos = firstGapPos; pos < endPos; pos++ ) {
-      if( GetWall( pos ) ) {
-        VERBOSE(3," hitting wall " << pos << std::endl);
-        return false;
-      }
+    if (endPos > firstGapPos && m_wallMask->GetNumWordsCovered(firstGapPos, endPos-1)) {
+      VERBOSE(3," hitting wall " << m_wallMask->GetFirstCoveredPos(firstGapPos) << std::endl);
+      return false;
     }
   }
 
@@ -155,11 +173,7 @@ bool ReorderingConstraint::Check( const WordsBitmap &bitmap, size_t startPos, si
     // let's look closer if some are in the zone
     size_t numWordsInZoneTranslated = 0;
     if (lastPos >= startZone) {
-      for(size_t pos = startZone; pos <= endZone; pos++ ) {
-        if( bitmap.GetValue( pos ) ) {
-          numWordsInZoneTranslated++;
-        }
-      }
+      numWordsInZoneTranslated = bitmap.GetNumWordsCovered(startZone, endZone);
     }
 
     // all words in zone translated, no violation possible
@@ -212,18 +226,14 @@ bool ReorderingConstraint::Check( const WordsBitmap &bitmap, size_t startPos, si
     }
 
     // now we are down to phrases that are completely inside the zone
-    // we have to check local walls
-    bool seenUntranslatedBeforeStartPos = false;
-    for(size_t pos = startZone; pos < endZone && pos < endPos; pos++ ) {
-      // be careful when there is a gap before phrase
-      if( !bitmap.GetValue( pos ) // untranslated word
-          && pos < startPos ) {   // before startPos
-        seenUntranslatedBeforeStartPos = true;
-      }
-      if( seenUntranslatedBeforeStartPos && GetLocalWall( pos, z ) ) {
-        VERBOSE(3," local wall violation" << std::endl);
-        return false;
-      }
+    // we have to check local walls from the first untranslated word before
+    // the phrase (if any) up to the end of the phrase or zone
+    size_t untranslated = bitmap.GetFirstGapPos(startZone);
+    size_t endCheck = std::min(endZone, endPos);
+    if (untranslated < startPos && untranslated < endCheck &&
+        m_localWallMask[z]->GetNumWordsCovered(untranslated, endCheck-1)) {
+      VERBOSE(3," local wall violation" << std::endl);
+      return false;
     }
 
     // passed all checks for this zone, on to the next one
@@ -52,22 +52,21 @@ protected:
   size_t *m_localWall;	/**< flag for each word if it is a local wall */
   std::vector< std::vector< size_t > > m_zone; /** zones that limit reordering */
   bool   m_active; /**< flag indicating, if there are any active constraints */
+  WordsBitmap *m_wallMask; /**< walls as a bitmap, for word-parallel checks */
+  std::vector< WordsBitmap* > m_localWallMask; /**< local walls of each zone */
 
 public:
 
   //! create ReorderingConstraint of length size and initialise to zero
-  ReorderingConstraint() :m_wall(NULL),m_localWall(NULL),m_active(false) {}
+  ReorderingConstraint() :m_wall(NULL),m_localWall(NULL),m_active(false),m_wallMask(NULL) {}
 
   //! destructer
-  ~ReorderingConstraint() {
-    if (m_wall != NULL) free(m_wall);
-    if (m_localWall != NULL) free(m_localWall);
-  }
+  ~ReorderingConstraint();
 
   //! allocate memory for memory for a sentence of a given size
   void InitializeWalls(size_t size);
 
-  //! changes walls in zones into local walls
+  //! changes walls in zones into local walls; has to be called before Check()
   void FinalizeWalls();
 
   //! set value at a particular position
@@ -39,19 +39,34 @@ extern bool g_mosesDebug;
 // initialise the RuleCube by creating the top-left corner item
 RuleCube::RuleCube(const ChartTranslationOptions &transOpt,
                    const ChartCellCollection &allChartCells,
-                   ChartManager &manager)
+                   ChartManager &manager,
+                   bool evaluate)
   : m_transOpt(transOpt)
+  , m_pending(NULL)
 {
   RuleCubeItem *item = new RuleCubeItem(transOpt, allChartCells);
   m_covered.insert(item);
   if (StaticData::Instance().GetCubePruningLazyScoring()) {
     item->EstimateScore();
+  } else if (!evaluate) {
+    item->CreateHypothesis(transOpt, manager, false);
+    m_pending = item;
+    return;
   } else {
     item->CreateHypothesis(transOpt, manager);
   }
   m_queue.push(item);
 }
 
+void RuleCube::EvaluatePending()
+{
+  if (m_pending) {
+    m_pending->EvaluateHypothesis();
+    m_queue.push(m_pending);
+    m_pending = NULL;
+  }
+}
+
 RuleCube::~RuleCube()
 {
   RemoveAllInColl(m_covered);
@@ -86,8 +86,10 @@ class RuleCube
   friend std::ostream& operator<<(std::ostream &out, const RuleCube &obj);
 
 public:
+  //! if evaluate is false, the first item is not scored or queued until
+  //! EvaluatePending() is called, which is safe to do on another thread
   RuleCube(const ChartTranslationOptions &, const ChartCellCollection &,
-           ChartManager &);
+           ChartManager &, bool evaluate = true);
 
   ~RuleCube();
 
@@ -97,8 +99,16 @@ public:
     return item->GetScore();
   }
 
+  //! the next item to pop, scored unless lazy scoring is on
+  const RuleCubeItem &GetTopItem() const {
+    UTIL_THROW_IF2(m_queue.empty(), "Empty queue, nothing to pop");
+    return *m_queue.top();
+  }
+
   RuleCubeItem *Pop(ChartManager &);
 
+  void EvaluatePending();
+
   bool IsEmpty() const {
     return m_queue.empty();
   }
@@ -131,6 +141,7 @@ private:
   const ChartTranslationOptions &m_transOpt;
   ItemSet m_covered;
   Queue m_queue;
+  RuleCubeItem *m_pending;
 };
 
 }
@@ -62,7 +62,9 @@ RuleCubeItem::RuleCubeItem(const RuleCubeItem &copy, int hypoDimensionIncr)
 
 RuleCubeItem::~RuleCubeItem()
 {
-  delete m_hypothesis;
+  if (m_hypothesis) {
+    ChartHypothesis::Delete(m_hypothesis);
+  }
 }
 
 void RuleCubeItem::EstimateScore()
@@ -76,9 +78,16 @@ void RuleCubeItem::EstimateScore()
 }
 
 void RuleCubeItem::CreateHypothesis(const ChartTranslationOptions &transOpt,
-                                    ChartManager &manager)
+                                    ChartManager &manager, bool evaluate)
+{
+  m_hypothesis = ChartHypothesis::Create(transOpt, *this, manager);
+  if (evaluate) {
+    EvaluateHypothesis();
+  }
+}
+
+void RuleCubeItem::EvaluateHypothesis()
 {
-  m_hypothesis = new ChartHypothesis(transOpt, *this, manager);
   m_hypothesis->EvaluateWhenApplied();
   m_score = m_hypothesis->GetTotalScore();
 }
@@ -131,7 +131,11 @@ public:
 
   void EstimateScore();
 
-  void CreateHypothesis(const ChartTranslationOptions &, ChartManager &);
+  //! if evaluate is false, call EvaluateHypothesis() before using the score
+  void CreateHypothesis(const ChartTranslationOptions &, ChartManager &,
+                        bool evaluate = true);
+
+  void EvaluateHypothesis();
 
   ChartHypothesis *ReleaseHypothesis();
 
@@ -22,7 +22,9 @@
 #include "RuleCubeQueue.h"
 
 #include "RuleCubeItem.h"
+#include "ChartTranslationOption.h"
 #include "StaticData.h"
+#include "TargetPhrase.h"
 
 namespace Moses
 {
@@ -41,6 +43,19 @@ void RuleCubeQueue::Add(RuleCube *ruleCube)
   m_queue.push(ruleCube);
 }
 
+const Word &RuleCubeQueue::GetTopLabel() const
+{
+  const RuleCubeItem &item = m_queue.top()->GetTopItem();
+  return item.GetTranslationDimension().GetTranslationOption()->GetPhrase().GetTargetLHS();
+}
+
+void RuleCubeQueue::DiscardTop()
+{
+  RuleCube *cube = m_queue.top();
+  m_queue.pop();
+  delete cube;
+}
+
 ChartHypothesis *RuleCubeQueue::Pop()
 {
   // pop the most promising rule cube
@@ -30,6 +30,7 @@ namespace Moses
 {
 
 class ChartManager;
+class Word;
 
 /** Define an ordering between RuleCube based on their best item scores.  This
  * is used to order items in the priority queue.
@@ -51,6 +52,16 @@ public:
 
   void Add(RuleCube *);
   ChartHypothesis *Pop();
+
+  //! estimated score of the item that Pop() returns next
+  float GetTopScore() const {
+    return m_queue.top()->GetTopScore();
+  }
+  //! left hand side label of the item that Pop() returns next
+  const Word &GetTopLabel() const;
+  //! drop the most promising rule cube without popping any of its items
+  void DiscardTop();
+
   bool IsEmpty() const {
     return m_queue.empty();
   }
@@ -77,6 +77,44 @@ GetWeightedScore() const
   return m_scores.inner_product(StaticData::Instance().GetAllWeights().m_scores);
 }
 
+void
+ScoreComponentCollection::
+GetWeightedScores(const ScoreComponentCollection *const *scores, size_t count, float *out)
+{
+  if (!count) return;
+  const FVector &weights = StaticData::Instance().GetAllWeights().m_scores;
+  const std::valarray<FValue> &coreWeights = weights.getCoreFeatures();
+
+  std::vector<size_t> active; // features with a weight
+  for (size_t d = 0; d < coreWeights.size(); ++d) {
+    if (coreWeights[d] != 0) active.push_back(d);
+  }
+
+  // structure of arrays: row j holds feature active[j] of every collection
+  std::vector<FValue> buffer(active.size() * count);
+  for (size_t i = 0; i < count; ++i) {
+    const std::valarray<FValue> &core = scores[i]->m_scores.getCoreFeatures();
+    assert(core.size() == coreWeights.size());
+    for (size_t j = 0; j < active.size(); ++j) {
+      buffer[j * count + i] = core[active[j]];
+    }
+  }
+
+  std::vector<FValue> coreProducts(count, 0.0);
+  for (size_t j = 0; j < active.size(); ++j) {
+    const FValue weight = coreWeights[active[j]];
+    const FValue *row = &buffer[j * count];
+    FValue *product = &coreProducts[0];
+    for (size_t i = 0; i < count; ++i) {
+      product[i] += row[i] * weight;
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = scores[i]->m_scores.sparse_inner_product(weights) + coreProducts[i];
+  }
+}
+
 void ScoreComponentCollection::MultiplyEquals(float scalar)
 {
   m_scores *= scalar;
@@ -387,6 +387,13 @@ public:
 
   float GetWeightedScore() const;
 
+  /** GetWeightedScore() of count collections at once, written to out.
+   *  The dense scores are transposed into a buffer with one row per
+   *  feature, so that each weight is applied to the whole batch in one loop
+   *  and features of weight 0 are skipped. Sums are taken in the same order
+   *  as by GetWeightedScore(). */
+  static void GetWeightedScores(const ScoreComponentCollection *const *scores, size_t count, float *out);
+
   void ZeroDenseFeatures(const FeatureFunction* sp);
   void InvertDenseFeatures(const FeatureFunction* sp);
   void L1Normalise();
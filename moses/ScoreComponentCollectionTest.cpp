@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "moses/FF/StatelessFeatureFunction.h"
 #include "ScoreComponentCollection.h"
+#include "StaticData.h"
 
 using namespace Moses;
 using namespace std;
@@ -141,6 +142,39 @@ BOOST_FIXTURE_TEST_CASE(sparse_feature, MockProducers)
   BOOST_CHECK_EQUAL( scc.GetScoreForProducer(&sparse,"first"), -3.8f);
 }
 
+BOOST_FIXTURE_TEST_CASE(weighted_scores, MockProducers)
+{
+  const ScoreComponentCollection oldWeights = StaticData::Instance().GetAllWeights();
+  ScoreComponentCollection weights;
+  weights.Assign(&single, 3.0f);
+  float weightArr[] = {1,0,2,0.5,0};
+  weights.Assign(&multi, std::vector<float>(weightArr,weightArr+5));
+  weights.Assign(&sparse, "first", 2.0f);
+  StaticData::InstanceNonConst().SetAllWeights(weights);
+
+  std::vector<ScoreComponentCollection> scores(3);
+  for (size_t i = 0; i < scores.size(); ++i) {
+    float arr[] = {0.1f*i,-1.7f,3.3f+i,-0.25f,9};
+    scores[i].Assign(&single, -0.3f*i);
+    scores[i].Assign(&multi, std::vector<float>(arr,arr+5));
+  }
+  scores[1].Assign(&sparse, "first", 1.5f);
+  scores[2].Assign(&sparse, "second", 4.0f);
+
+  std::vector<const ScoreComponentCollection*> batch;
+  for (size_t i = 0; i < scores.size(); ++i) {
+    batch.push_back(&scores[i]);
+  }
+  std::vector<float> weighted(batch.size());
+  ScoreComponentCollection::GetWeightedScores(&batch[0], batch.size(), &weighted[0]);
+  for (size_t i = 0; i < scores.size(); ++i) {
+    BOOST_CHECK_EQUAL(weighted[i], scores[i].GetWeightedScore());
+  }
+  BOOST_CHECK_CLOSE(weighted[1], 3*-0.3f + 0.1f + 2*4.3f - 0.125f + 3.0f, 1e-4);
+
+  StaticData::InstanceNonConst().SetAllWeights(oldWeights);
+}
+
 /*
  Doesn't work because of the static registration of ScoreProducers
  in ScoreComponentCollection.
@@ -24,8 +24,8 @@ public:
     }
 
     // Compare the top hypothesis of each bitmap container using the TotalScore, which includes future cost
-    const float scoreA = A->Top()->GetHypothesis()->GetTotalScore();
-    const float scoreB = B->Top()->GetHypothesis()->GetTotalScore();
+    const float scoreA = A->Top().GetHypothesis()->GetTotalScore();
+    const float scoreB = B->Top().GetHypothesis()->GetTotalScore();
 
     if (scoreA < scoreB) {
       return true;
@@ -112,16 +112,16 @@ void SearchCubePruning::Decode()
       // bmIter->second->EnsureMinStackHyps(PopLimit);
     }
 
-    // main search loop, pop k best hyps
-    for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
+    // main search loop, pop k best hyps (fewer if the time budget runs out)
+    const size_t popLimit = m_manager.TightenLimit(PopLimit);
+    const bool degraded = popLimit < PopLimit;
+    for (size_t numpops = 1; numpops <= popLimit && !BCQueue.empty(); numpops++) {
       // get currently best hypothesis in queue
       m_manager.GetSentenceStats().StartTimeManageCubes();
       BitmapContainer *bc = BCQueue.top();
       BCQueue.pop();
       m_manager.GetSentenceStats().StopTimeManageCubes();
-      IFVERBOSE(2) {
-        m_manager.GetSentenceStats().AddPopped();
-      }
+      m_manager.GetSentenceStats().AddPopped();
       // push on stack and create successors
       bc->ProcessBestHypothesis();
       // if there are any hypothesis left in this specific container, add back to queue
@@ -133,7 +133,7 @@ void SearchCubePruning::Decode()
 
     // ensure diversity, a minimum number of inserted hyps for each bitmap container;
     //    NOTE: diversity doesn't ensure they aren't pruned at some later point
-    if (Diversity > 0) {
+    if (Diversity > 0 && !degraded) {
       for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
         bmIter->second->EnsureMinStackHyps(Diversity);
       }
@@ -144,7 +144,7 @@ void SearchCubePruning::Decode()
     IFVERBOSE(2) {
       m_manager.GetSentenceStats().StartTimeStack();
     }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(m_manager.TightenLimit(staticData.GetMaxHypoStackSize()));
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
     IFVERBOSE(2) {
@@ -2,6 +2,9 @@
 #include "Timer.h"
 #include "SearchNormal.h"
 #include "SentenceStats.h"
+#include "ThreadPool.h"
+#include "moses/FF/ConstrainedDecoding.h"
+#include "moses/FF/FeatureFunction.h"
 
 #include <boost/foreach.hpp>
 
@@ -21,6 +24,8 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
   ,m_hypoStackColl(source.GetSize() + 1)
   ,interrupted_flag(0)
   ,m_transOptColl(transOptColl)
+  ,m_staging(NULL)
+  ,m_references(NULL)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
   const StaticData &staticData = StaticData::Instance();
@@ -38,11 +43,30 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
 
     m_hypoStackColl[ind] = sourceHypoColl;
   }
+
+  // the jumps the reordering limit allows, once per sentence rather than
+  // for every hypothesis. The distortion distance depends on the previous
+  // phrase only through its end, or whether there is one at all
+  const int maxDistortion = staticData.GetMaxDistortion();
+  if (maxDistortion >= 0) {
+    const size_t size = source.GetSize();
+    m_allowedStarts.resize(size + 1);
+    for (size_t prev = 0; prev <= size; ++prev) {
+      const WordsRange prevRange = prev ? WordsRange(prev - 1, prev - 1) : WordsRange(NOT_FOUND, NOT_FOUND);
+      WordsBitmap *allowed = new WordsBitmap(size);
+      for (size_t startPos = 0; startPos < size; ++startPos) {
+        if (m_source.ComputeDistortionDistance(prevRange, WordsRange(startPos, startPos)) <= maxDistortion)
+          allowed->SetValue(startPos, true);
+      }
+      m_allowedStarts[prev] = allowed;
+    }
+  }
 }
 
 SearchNormal::~SearchNormal()
 {
   RemoveAllInColl(m_hypoStackColl);
+  RemoveAllInColl(m_allowedStarts);
 }
 
 /**
@@ -54,10 +78,31 @@ void SearchNormal::Decode()
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
 
+  // the weight setting of the sentence is selected by now
+  const ConstrainedDecoding *forcing = ConstrainedDecoding::GetForcing();
+  if (forcing) {
+    m_references = &forcing->GetReferences(m_source.GetTranslationId());
+  }
+
   // initial seed hypothesis: nothing translated, no words produced
   Hypothesis *hypo = Hypothesis::Create(m_manager,m_source, m_initialTransOpt);
   m_hypoStackColl[0]->AddPrune(hypo);
 
+#ifdef WITH_THREADS
+  // the per-sentence timers in SentenceStats are not thread-safe
+  ThreadPool *pool = NULL;
+  // and the weight setting is selected per decoding thread
+  bool threadSafe = staticData.UseSearchThreads(m_source.GetSize()) && staticData.GetVerboseLevel() < 2
+                    && !staticData.GetHasAlternateWeightSettings() && !m_source.GetRequestWeights();
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; threadSafe && i < ffs.size(); ++i) {
+    threadSafe = ffs[i]->CanEvaluateOnAnyThread();
+  }
+  if (threadSafe) {
+    pool = &ThreadPool::ForCurrentThread(staticData.GetSearchThreads());
+  }
+#endif
+
   // go through each stack
   std::vector < HypothesisStack* >::iterator iterStack;
   for (iterStack = m_hypoStackColl.begin() ; iterStack != m_hypoStackColl.end() ; ++iterStack) {
@@ -75,7 +120,7 @@ void SearchNormal::Decode()
     IFVERBOSE(2) {
       stats.StartTimeStack();
     }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(m_manager.TightenLimit(staticData.GetMaxHypoStackSize()));
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
     IFVERBOSE(2) {
@@ -83,10 +128,17 @@ void SearchNormal::Decode()
     }
 
     // go through each hypothesis on the stack and try to expand it
-    HypothesisStackNormal::const_iterator iterHypo;
-    for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
-      Hypothesis &hypothesis = **iterHypo;
-      ProcessOneHypothesis(hypothesis); // expand the hypothesis
+#ifdef WITH_THREADS
+    if (pool) {
+      ProcessStackInParallel(sourceHypoColl, *pool);
+    } else
+#endif
+    {
+      HypothesisStackNormal::const_iterator iterHypo;
+      for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
+        Hypothesis &hypothesis = **iterHypo;
+        ProcessOneHypothesis(hypothesis); // expand the hypothesis
+      }
     }
     // some logging
     IFVERBOSE(2) {
@@ -124,14 +176,16 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
   // no limit of reordering: only check for overlap
   if (maxDistortion < 0) {
 
-    for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ; ++startPos) {
+    for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ;
+         startPos = hypoBitmap.GetFirstGapPos(startPos + 1)) {
+      // phrases end before the next translated word
+      const size_t endLimit = std::min(sourceSize, hypoBitmap.GetFirstCoveredPos(startPos));
       TranslationOptionList const* tol;
       size_t endPos = startPos;
       for (tol = m_transOptColl.GetTranslationOptionList(startPos, endPos);
-           tol && endPos < sourceSize;
+           tol && endPos < endLimit;
            tol = m_transOptColl.GetTranslationOptionList(startPos, ++endPos)) {
         if (tol->size() == 0
-            || hypoBitmap.Overlap(WordsRange(startPos, endPos))
             || !ReoConstraint.Check(hypoBitmap, startPos, endPos)) {
           continue;
         }
@@ -146,15 +200,12 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
   // There are reordering limits. Make sure they are not violated.
 
   WordsRange prevRange = hypothesis.GetCurrSourceWordsRange();
-  for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ; ++startPos) {
-
-    // don't bother expanding phrases if the first position is already taken
-    if(hypoBitmap.GetValue(startPos)) continue;
-
-    size_t maxSize = sourceSize - startPos;
-    size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-    maxSize = (maxSize < maxSizePhrase) ? maxSize : maxSizePhrase;
-    size_t closestLeft = hypoBitmap.GetEdgeToTheLeftOf(startPos);
+  // the untranslated positions the limit allows to jump to, from the
+  // table made for the sentence
+  const size_t prevIndex = prevRange.GetStartPos() == NOT_FOUND ? 0 : prevRange.GetEndPos() + 1;
+  const WordsBitmap &allowed = *m_allowedStarts[std::min(prevIndex, sourceSize)];
+  for (size_t startPos = hypoBitmap.GetFirstGapPos(hypoFirstGapPos, allowed) ; startPos < sourceSize ;
+       startPos = hypoBitmap.GetFirstGapPos(startPos + 1, allowed)) {
 
     if (isWordLattice) {
       // first question: is there a path from the closest translated word to the left
@@ -166,6 +217,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       // closestLeft is exclusive: a value of 3 means 2 is covered, our
       // arc is currently ENDING at 3 and can start at 3 implicitly
+      size_t closestLeft = hypoBitmap.GetEdgeToTheLeftOf(startPos);
       if (closestLeft != 0 && closestLeft != startPos
           && !m_source.CanIGetFromAToB(closestLeft, startPos))
         continue;
@@ -176,19 +228,14 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
         continue;
     }
 
-    WordsRange currentStartRange(startPos, startPos);
-    if(m_source.ComputeDistortionDistance(prevRange, currentStartRange)
-        > maxDistortion)
-      continue;
-
+    const size_t endLimit = std::min(sourceSize, hypoBitmap.GetFirstCoveredPos(startPos));
     TranslationOptionList const* tol;
     size_t endPos = startPos;
     for (tol = m_transOptColl.GetTranslationOptionList(startPos, endPos);
-         tol && endPos < sourceSize;
+         tol && endPos < endLimit;
          tol = m_transOptColl.GetTranslationOptionList(startPos, ++endPos)) {
       WordsRange extRange(startPos, endPos);
       if (tol->size() == 0
-          || hypoBitmap.Overlap(extRange)
           || !ReoConstraint.Check(hypoBitmap, startPos, endPos)
           || (isWordLattice && !m_source.IsCoveragePossible(extRange))) {
         continue;
@@ -203,8 +250,8 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
       // right than our (inclusive) end? can our end reach it?
       bool isLeftMostEdge = (hypoFirstGapPos == startPos);
 
-      size_t closestRight = hypoBitmap.GetEdgeToTheRightOf(endPos);
       if (isWordLattice) {
+        size_t closestRight = hypoBitmap.GetEdgeToTheRightOf(endPos);
         if (closestRight != endPos
             && ((closestRight + 1) < sourceSize)
             && !m_source.CanIGetFromAToB(endPos + 1, closestRight + 1)) {
@@ -267,6 +314,14 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
   if (!tol) return;
   TranslationOptionList::const_iterator iter;
   for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
+    // forced decoding: only build hypotheses whose output starts a
+    // reference. The feature would keep some of the others (any part of a
+    // reference scores 0), so this changes the search, see
+    // ConstrainedDecoding::IsForcing()
+    if (m_references
+        && !ConstrainedDecoding::Extends(*m_references, hypothesis, (*iter)->GetTargetPhrase())) {
+      continue;
+    }
     ExpandHypothesis(hypothesis, **iter, expectedScore);
   }
 }
@@ -286,6 +341,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
   SentenceStats &stats = m_manager.GetSentenceStats();
 
   Hypothesis *newHypo;
+  float allowedScore = -std::numeric_limits<float>::infinity();
   if (! staticData.UseEarlyDiscarding()) {
     // simple build, no questions asked
     IFVERBOSE(2) {
@@ -296,19 +352,10 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
       stats.StopTimeBuildHyp();
     }
     if (newHypo==NULL) return;
-    newHypo->EvaluateWhenApplied(m_transOptColl.GetFutureScore());
   } else
     // early discarding: check if hypothesis is too bad to build
   {
-    // worst possible score may have changed -> recompute
-    size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
-    float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
-    if (staticData.GetMinHypoStackDiversity()) {
-      WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
-      float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
-      allowedScore = std::min( allowedScore, allowedScoreForBitmap );
-    }
-    allowedScore += staticData.GetEarlyDiscardingThreshold();
+    allowedScore = GetEarlyDiscardingLimit(hypothesis, transOpt);
 
     // add expected score of translation option
     expectedScore += transOpt.GetFutureScore();
@@ -330,16 +377,46 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
     IFVERBOSE(2) {
       stats.StopTimeBuildHyp();
     }
+  }
 
-    // ... and check if that is below the limit
-    if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddEarlyDiscarded();
-      }
-      FREEHYPO( newHypo );
-      return;
-    }
+  // scored and added once the whole stack has been expanded
+  if (m_staging) {
+    m_staging->push_back(newHypo);
+    return;
+  }
+
+  newHypo->EvaluateWhenApplied(m_transOptColl.GetFutureScore());
+  AddHypothesis(newHypo, allowedScore);
+}
+
+//! worst score a new hypothesis may have under early discarding
+float SearchNormal::GetEarlyDiscardingLimit(const Hypothesis &hypothesis, const TranslationOption &transOpt)
+{
+  const StaticData &staticData = StaticData::Instance();
 
+  // worst possible score may have changed -> recompute
+  size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
+  float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
+  if (staticData.GetMinHypoStackDiversity()) {
+    WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
+    float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
+    allowedScore = std::min( allowedScore, allowedScoreForBitmap );
+  }
+  return allowedScore + staticData.GetEarlyDiscardingThreshold();
+}
+
+//! add a scored hypothesis to its stack, unless early discarding rejects it
+void SearchNormal::AddHypothesis(Hypothesis *newHypo, float allowedScore)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+
+  // check if the full score is below the limit
+  if (newHypo->GetTotalScore() < allowedScore) {
+    IFVERBOSE(2) {
+      stats.AddEarlyDiscarded();
+    }
+    FREEHYPO( newHypo );
+    return;
   }
 
   // logging for the curious
@@ -358,6 +435,108 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
   }
 }
 
+#ifdef WITH_THREADS
+namespace
+{
+//! evaluates the feature functions of a slice of staged hypotheses on a pool thread
+class EvaluateHypothesesTask : public Task
+{
+public:
+  EvaluateHypothesesTask(const std::vector<Hypothesis*> &hypos, size_t begin, size_t end)
+    : m_hypos(hypos), m_begin(begin), m_end(end), m_done(false) {}
+
+  void Run() {
+    try {
+      for (size_t i = m_begin; i < m_end; ++i) {
+        m_hypos[i]->EvaluateFeatureFunctions();
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  //! returns the error message if scoring threw
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
+  }
+
+private:
+  const std::vector<Hypothesis*> &m_hypos;
+  size_t m_begin, m_end;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+} // namespace
+
+/** Expand every hypothesis of a stack, score the new hypotheses on the pool
+ * and then add them to their stacks in the order the serial search would.
+ * Creating hypotheses stays on this thread, so ids and the pool do not race.
+ *
+ * With early discarding, hypotheses are built against the stack thresholds
+ * of when the stack started, which the serial search would have raised by
+ * then, so more get built. Each is checked again when it is added, against
+ * the thresholds at that point, with the same test the serial search makes
+ * before building it, so the same hypotheses end up in the stacks.
+ */
+void SearchNormal::ProcessStackInParallel(const HypothesisStackNormal &sourceHypoColl, ThreadPool &pool)
+{
+  std::vector<Hypothesis*> staged;
+  m_staging = &staged;
+  HypothesisStackNormal::const_iterator iterHypo;
+  for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
+    ProcessOneHypothesis(**iterHypo);
+  }
+  m_staging = NULL;
+  if (staged.empty()) return;
+
+  const size_t numTasks = std::min(staged.size(), StaticData::Instance().GetSearchThreads() * 4);
+  std::vector<boost::shared_ptr<EvaluateHypothesesTask> > tasks;
+  for (size_t t = 0; t < numTasks; ++t) {
+    tasks.push_back(boost::shared_ptr<EvaluateHypothesesTask>(
+                      new EvaluateHypothesesTask(staged, staged.size() * t / numTasks,
+                          staged.size() * (t + 1) / numTasks)));
+    pool.Submit(tasks.back());
+  }
+  // wait for every task before reporting, they all reference staged
+  std::string error;
+  for (size_t t = 0; t < numTasks; ++t) {
+    const std::string &taskError = tasks[t]->Wait();
+    if (error.empty()) error = taskError;
+  }
+  UTIL_THROW_IF2(!error.empty(), error);
+  Hypothesis::CalcTotalScores(staged, m_transOptColl.GetFutureScore());
+
+  const bool earlyDiscarding = StaticData::Instance().UseEarlyDiscarding();
+  for (size_t i = 0; i < staged.size(); ++i) {
+    Hypothesis *newHypo = staged[i];
+    float allowedScore = -std::numeric_limits<float>::infinity();
+    if (earlyDiscarding) {
+      const Hypothesis &prevHypo = *newHypo->GetPrevHypo();
+      const TranslationOption &transOpt = newHypo->GetTranslationOption();
+      allowedScore = GetEarlyDiscardingLimit(prevHypo, transOpt);
+      // as ExpandAllHypotheses() and ExpandHypothesis() add it up
+      float expectedScore = prevHypo.GetScore();
+      expectedScore += m_transOptColl.GetFutureScore()
+                       .CalcFutureScore(prevHypo.GetWordsBitmap(), transOpt.GetStartPos(), transOpt.GetEndPos());
+      expectedScore += transOpt.GetFutureScore();
+      if (expectedScore < allowedScore) {
+        // the serial search would not have built it
+        FREEHYPO(newHypo);
+        continue;
+      }
+    }
+    AddHypothesis(newHypo, allowedScore);
+  }
+}
+#endif
+
 const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() const
 {
   return m_hypoStackColl;
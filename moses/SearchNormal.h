@@ -13,6 +13,8 @@ namespace Moses
 class Manager;
 class InputType;
 class TranslationOptionCollection;
+class ThreadPool;
+class Phrase;
 
 /** Functions and variables you need to decoder an input using the phrase-based decoder (NO cube-pruning)
  *  Instantiated by the Manager class
@@ -26,11 +28,20 @@ protected:
   size_t interrupted_flag; /**< flag indicating that decoder ran out of time (see switch -time-out) */
   HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  std::vector<Hypothesis*> *m_staging; /**< if set, new hypotheses are collected here unscored, see -search-threads */
+  const std::vector<Phrase> *m_references; /**< forced decoding: the output must be one of these, see ConstrainedDecoding::IsForcing() */
+  /** with a reordering limit, the start positions it allows after a
+   *  phrase ending at i are set in m_allowedStarts[i + 1], those at the
+   *  start of the sentence in m_allowedStarts[0] */
+  std::vector<WordsBitmap*> m_allowedStarts;
 
   // functions for creating hypotheses
   void ProcessOneHypothesis(const Hypothesis &hypothesis);
   void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
   virtual void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore);
+  float GetEarlyDiscardingLimit(const Hypothesis &hypothesis, const TranslationOption &transOpt);
+  void AddHypothesis(Hypothesis *newHypo, float allowedScore);
+  void ProcessStackInParallel(const HypothesisStackNormal &sourceHypoColl, ThreadPool &pool);
 
 public:
   SearchNormal(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl);
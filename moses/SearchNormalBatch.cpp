@@ -17,13 +17,15 @@ SearchNormalBatch::SearchNormalBatch(Manager& manager, const InputType &source,
   m_max_stack_size = StaticData::Instance().GetMaxHypoStackSize();
 
   // Split the feature functions into sets of stateless, stateful
-  // distributed lm, and stateful non-distributed.
+  // distributed lm, stateful batched and stateful non-distributed.
   const vector<const StatefulFeatureFunction*>& ffs =
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
     if (ffs[i]->GetScoreProducerDescription() == "DLM_5gram") { // TODO WFT
       m_dlm_ffs[i] = const_cast<LanguageModel*>(static_cast<const LanguageModel* const>(ffs[i]));
       m_dlm_ffs[i]->SetFFStateIdx(i);
+    } else if (ffs[i]->IsBatchable()) {
+      m_batch_ffs[i] = const_cast<StatefulFeatureFunction*>(ffs[i]);
     } else {
       m_stateful_ffs[i] = const_cast<StatefulFeatureFunction*>(ffs[i]);
     }
@@ -66,7 +68,7 @@ void SearchNormalBatch::Decode()
     IFVERBOSE(2) {
       stats.StartTimeStack();
     }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(m_manager.TightenLimit(staticData.GetMaxHypoStackSize()));
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
     IFVERBOSE(2) {
@@ -169,6 +171,14 @@ void SearchNormalBatch::EvalAndMergePartialHypos()
     }
   }
 
+  // Batched stateful ffs see all partial hypotheses at once.
+  std::map<int, StatefulFeatureFunction*>::iterator batch_iter;
+  for (batch_iter = m_batch_ffs.begin();
+       batch_iter != m_batch_ffs.end();
+       ++batch_iter) {
+    Hypothesis::EvaluateWhenAppliedBatch(*batch_iter->second, batch_iter->first, m_partial_hypos);
+  }
+
   // Wait for all requests from the distributed LM to come back.
   std::map<int, LanguageModel*>::iterator dlm_iter;
   for (dlm_iter = m_dlm_ffs.begin();
@@ -177,8 +187,7 @@ void SearchNormalBatch::EvalAndMergePartialHypos()
     (*dlm_iter).second->sync();
   }
 
-  // Incorporate the DLM scores into all hypotheses and put into their
-  // stacks.
+  // Incorporate the DLM scores into all hypotheses.
   for (partial_hypo_iter = m_partial_hypos.begin();
        partial_hypo_iter != m_partial_hypos.end();
        ++partial_hypo_iter) {
@@ -192,6 +201,15 @@ void SearchNormalBatch::EvalAndMergePartialHypos()
       LanguageModel &lm = *(dlm_iter->second);
       hypo->EvaluateWhenApplied(lm, (*dlm_iter).first);
     }
+  }
+
+  // Total scores of the whole batch, then put the hypotheses onto their
+  // stacks.
+  Hypothesis::CalcTotalScores(m_partial_hypos, m_transOptColl.GetFutureScore());
+  for (partial_hypo_iter = m_partial_hypos.begin();
+       partial_hypo_iter != m_partial_hypos.end();
+       ++partial_hypo_iter) {
+    Hypothesis* hypo = *partial_hypo_iter;
 
     // Put completed hypothesis onto its stack.
     size_t wordsTranslated = hypo->GetWordsBitmap().GetNumWordsCovered();
@@ -14,6 +14,8 @@ class TranslationOptionCollection;
 /** Implements the phrase-based stack decoding algorithm (no cube pruning) with a twist...
  *  Language model requests are batched together, duplicate requests are removed, and requests are sent together.
  *  Useful for distributed LM where network latency is an issue.
+ *  Stateful features that declare themselves batchable are likewise handed
+ *  all partial hypotheses of a batch in one EvaluateWhenAppliedBatch() call.
  */
 class SearchNormalBatch: public SearchNormal
 {
@@ -23,6 +25,7 @@ protected:
   std::vector<const StatelessFeatureFunction*> m_stateless_ffs;
   std::map<int, LanguageModel*> m_dlm_ffs;
   std::map<int, StatefulFeatureFunction*> m_stateful_ffs;
+  std::map<int, StatefulFeatureFunction*> m_batch_ffs;
   std::vector<Hypothesis*> m_partial_hypos;
   uint32_t m_batch_size;
   int m_max_stack_size;
@@ -40,7 +40,7 @@ namespace Moses
 {
 
 Sentence::
-Sentence() : Phrase(0) , InputType()
+Sentence() : Phrase(0) , InputType(), m_hasMarkup(false)
 {
   const StaticData& SD = StaticData::Instance();
   if (SD.IsSyntax()) 
@@ -193,6 +193,7 @@ init(string line, std::vector<FactorType> const& factorOrder)
     aux_init_partial_translation(line);
 
   line = Trim(line);
+  m_hasMarkup = line.find('<') != string::npos;
   aux_interpret_sgml_markup(line); // for "<seg id=..." markup
   aux_interpret_dlt(line); // some poorly documented cache-based stuff
   
@@ -211,6 +212,15 @@ init(string line, std::vector<FactorType> const& factorOrder)
 
   ProcessPlaceholders(placeholders);
 
+  aux_init_constraints(xmlWalls);
+}
+
+void
+Sentence::
+aux_init_constraints(std::vector<size_t> const& xmlWalls)
+{
+  const StaticData &SD = StaticData::Instance();
+
   if (SD.IsSyntax()) InitStartEndWord();
   
   // now that we have final word positions in phrase (from
@@ -389,5 +399,16 @@ Sentence(size_t const transId, string const& stext) : InputType(transId)
   init(stext, IFO);
 }
 
+Sentence::
+Sentence(size_t const transId, Phrase const& words)
+  : Phrase(words), InputType(transId), m_hasMarkup(false)
+{
+  const StaticData& SD = StaticData::Instance();
+  if (SD.IsSyntax())
+    m_defaultLabelSet.insert(SD.GetInputDefaultNonTerminal());
+  m_frontSpanCoveredLength = 0;
+  aux_init_constraints(vector<size_t>());
+}
+
 }
 
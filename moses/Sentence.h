@@ -55,6 +55,7 @@ namespace Moses
      */
     std::vector<XmlOption*> m_xmlOptions;
     std::vector <bool> m_xmlCoverageMap;
+    bool m_hasMarkup; //!< the input line had XML or SGML markup
 
     NonTerminalSet m_defaultLabelSet;
 
@@ -64,6 +65,8 @@ namespace Moses
   public:
     Sentence();
     Sentence(size_t const transId, std::string const& stext);
+    //! a sentence of words that need no parsing (no markup)
+    Sentence(size_t const transId, Phrase const& words);
     ~Sentence();
 
     InputTypeEnum GetType() const {
@@ -85,6 +88,10 @@ namespace Moses
       return Phrase::GetSize();
     }
 
+    bool HasMarkup() const {
+      return m_hasMarkup;
+    }
+
     //! Returns true if there were any XML tags parsed that at least partially covered the range passed
     bool XmlOverlap(size_t startPos, size_t endPos) const;
 
@@ -131,6 +138,10 @@ namespace Moses
     void
     aux_init_partial_translation(std::string& line);
 
+    //! the part of init() that follows the parsing of the words
+    void
+    aux_init_constraints(std::vector<size_t> const& xmlWalls);
+
   };
   
 
@@ -0,0 +1,95 @@
+#include "SentenceArena.h"
+
+#include <new>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Moses
+{
+
+namespace
+{
+
+// in front of every allocation: the arena it came from, NULL for the heap
+union Header {
+  SentenceArena *arena;
+  double align;
+};
+
+#ifdef WITH_THREADS
+void KeepArena(SentenceArena *)
+{
+  // the arena belongs to its Manager
+}
+
+boost::thread_specific_ptr<SentenceArena> &CurrentArena()
+{
+  static boost::thread_specific_ptr<SentenceArena> current(&KeepArena);
+  return current;
+}
+
+SentenceArena *GetCurrent()
+{
+  return CurrentArena().get();
+}
+
+void SetCurrent(SentenceArena *arena)
+{
+  CurrentArena().reset(arena);
+}
+#else
+SentenceArena *s_current = NULL;
+
+SentenceArena *GetCurrent()
+{
+  return s_current;
+}
+
+void SetCurrent(SentenceArena *arena)
+{
+  s_current = arena;
+}
+#endif
+
+}
+
+SentenceArena::Scope::Scope(SentenceArena *arena)
+  : m_previous(GetCurrent())
+{
+  SetCurrent(arena);
+}
+
+SentenceArena::Scope::~Scope()
+{
+  SetCurrent(m_previous);
+}
+
+void *SentenceArena::Allocate(std::size_t size)
+{
+  // keep every allocation aligned like the header
+  size = (size + sizeof(Header) - 1) / sizeof(Header) * sizeof(Header);
+  SentenceArena *arena = GetCurrent();
+  Header *header = static_cast<Header*>(arena
+                                        ? arena->m_pool.Allocate(sizeof(Header) + size)
+                                        : ::operator new(sizeof(Header) + size));
+  header->arena = arena;
+  return header + 1;
+}
+
+void SentenceArena::Free(void *ptr)
+{
+  if (ptr == NULL) return;
+  Header *header = static_cast<Header*>(ptr) - 1;
+  if (header->arena == NULL) {
+    ::operator delete(header);
+  }
+}
+
+void SentenceArena::Reset()
+{
+  m_pool.Reset();
+}
+
+}
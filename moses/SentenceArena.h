@@ -0,0 +1,61 @@
+// -*- c++ -*-
+#pragma once
+
+#include <cstddef>
+
+#include "util/pool.hh"
+
+namespace Moses
+{
+
+/** Storage for the translation options and input paths of one sentence,
+ *  owned by its Manager and released at once with it.
+ *
+ *  TranslationOption and InputPath allocate from the arena that is current
+ *  on the thread (see Scope); deleting one runs its destructor but gives no
+ *  memory back. Objects made while no arena is current, e.g. on the threads
+ *  of -search-threads, come from the heap as before, so both may be kept in
+ *  one list and deleted alike. Memory of options pruned during the sentence
+ *  is not reused, but an arena may be Reset() for the next sentence.
+ */
+class SentenceArena
+{
+public:
+  /** makes an arena the current one of this thread, or none if NULL; the
+   *  previous one is current again at the end of the scope. Objects that
+   *  outlive the sentence must be made with no arena current. */
+  class Scope
+  {
+  public:
+    explicit Scope(SentenceArena *arena);
+    ~Scope();
+
+  private:
+    SentenceArena *m_previous;
+  };
+
+  SentenceArena() {}
+
+  //! size bytes from the current arena, or from the heap if there is none
+  static void *Allocate(std::size_t size);
+  //! frees ptr if it came from the heap
+  static void Free(void *ptr);
+
+  /** forgets all objects made from the arena, which must all have been
+   *  deleted, and keeps (most of) its memory for the next sentence */
+  void Reset();
+
+  //! bytes of memory the arena holds
+  std::size_t GetAllocatedBytes() const {
+    return m_pool.Allocated();
+  }
+
+private:
+  util::Pool m_pool;
+
+  // not copyable
+  SentenceArena(const SentenceArena &);
+  void operator=(const SentenceArena &);
+};
+
+}
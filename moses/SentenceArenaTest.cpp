@@ -0,0 +1,109 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "SentenceArena.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+struct Counted {
+  static int alive;
+  int value;
+  explicit Counted(int v) : value(v) {
+    ++alive;
+  }
+  ~Counted() {
+    --alive;
+  }
+  static void *operator new(size_t size) {
+    return SentenceArena::Allocate(size);
+  }
+  static void operator delete(void *ptr) {
+    SentenceArena::Free(ptr);
+  }
+};
+
+int Counted::alive = 0;
+
+}
+
+BOOST_AUTO_TEST_SUITE(sentence_arena)
+
+BOOST_AUTO_TEST_CASE(mixed_ownership)
+{
+  Counted *fromHeap = new Counted(-1);
+  {
+    SentenceArena arena;
+    SentenceArena::Scope scope(&arena);
+    vector<Counted*> objects;
+    for (int i = 0; i < 1000; ++i) {
+      objects.push_back(new Counted(i));
+    }
+    {
+      SentenceArena::Scope noArena(NULL);
+      objects.push_back(new Counted(1000));
+    }
+    for (size_t i = 0; i < objects.size(); ++i) {
+      BOOST_CHECK_EQUAL(objects[i]->value, static_cast<int>(i));
+      BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(objects[i]) % sizeof(void*), 0);
+    }
+    BOOST_CHECK_EQUAL(Counted::alive, 1002);
+    for (size_t i = 0; i < objects.size(); ++i) {
+      delete objects[i];
+    }
+    BOOST_CHECK_EQUAL(Counted::alive, 1);
+  }
+  // no arena is current after the scope
+  delete fromHeap;
+  BOOST_CHECK_EQUAL(Counted::alive, 0);
+}
+
+BOOST_AUTO_TEST_CASE(reset_reuses_memory)
+{
+  SentenceArena arena;
+  SentenceArena::Scope scope(&arena);
+  vector<Counted*> objects;
+  for (int sentence = 0; sentence < 3; ++sentence) {
+    for (int i = 0; i < 1000; ++i) {
+      objects.push_back(new Counted(i));
+    }
+    for (size_t i = 0; i < objects.size(); ++i) {
+      BOOST_CHECK_EQUAL(objects[i]->value, static_cast<int>(i));
+      delete objects[i];
+    }
+    BOOST_CHECK_EQUAL(Counted::alive, 0);
+    // the first object of the next sentence goes where the newest block begins
+    Counted *last = objects.back();
+    objects.clear();
+    arena.Reset();
+    Counted *first = new Counted(0);
+    BOOST_CHECK(first <= last);
+    delete first;
+    arena.Reset();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
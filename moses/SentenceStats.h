@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h" //FactorArray
 #include "InputType.h"
 #include "Util.h" //Join()
+#include "DecodeProfile.h"
 
 namespace Moses
 {
@@ -144,24 +145,32 @@ public:
   void AddRecombination(const Hypothesis& worseHypo, const Hypothesis& betterHypo) {
     m_recombinationInfos.push_back(RecombinationInfo(worseHypo.GetWordsBitmap().GetNumWordsCovered(),
                                    betterHypo.GetTotalScore(), worseHypo.GetTotalScore()));
+    DecodeProfile::Count(DecodeProfile::HyposRecombined);
   }
   void AddCreated() {
     m_numHyposCreated++;
+    DecodeProfile::Count(DecodeProfile::HyposCreated);
   }
   void AddPopped() {
     m_numHyposPopped++;
   }
+  void AddPopped(size_t numPopped) {
+    m_numHyposPopped += numPopped;
+  }
   void AddPruning() {
     m_numHyposPruned++;
+    DecodeProfile::Count(DecodeProfile::HyposPruned);
   }
   void AddEarlyDiscarded() {
     m_numHyposEarlyDiscarded++;
+    DecodeProfile::Count(DecodeProfile::HyposDiscarded);
   }
   void AddNotBuilt() {
     m_numHyposNotBuilt++;
   }
   void AddDiscarded() {
     m_numHyposDiscarded++;
+    DecodeProfile::Count(DecodeProfile::HyposDiscarded);
   }
 
   void StartTimeCollectOpts() {
@@ -28,6 +28,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/WordPenaltyProducer.h"
 #include "moses/FF/UnknownWordPenaltyProducer.h"
 #include "moses/FF/InputFeature.h"
+#include "moses/FF/ConstrainedDecoding.h"
+#include "moses/FF/StatefulFeatureFunction.h"
+#include "moses/ContextScope.h"
 #include "moses/FF/DynamicCacheBasedLanguageModel.h"
 #include "moses/TranslationModel/PhraseDictionaryDynamicCacheBased.h"
 
@@ -38,9 +41,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "FactorCollection.h"
 #include "Timer.h"
+#include "ThreadPool.h"
+#include "TranslationCache.h"
+#include "TranslationOptionCache.h"
+#include "DecodeProfile.h"
 #include "TranslationOption.h"
+#include "Hypothesis.h"
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
+#include "InputType.h"
 #include "ScoreComponentCollection.h"
 #include "DecodeGraph.h"
 #include "TranslationModel/PhraseDictionary.h"
@@ -186,6 +195,20 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_parameter->SetParameter<size_t>(m_nBestFactor, "n-best-factor", 20);
 
+  // coarse-to-fine decoding
+  params = m_parameter->GetParam("coarse-to-fine");
+  m_coarseToFineNBestSize = 100;
+  if (params && params->size()) {
+    if (params->size() > 2) {
+      std::cerr << "wrong format for switch -coarse-to-fine weight-setting [n-best-size]";
+      return false;
+    }
+    m_coarseToFineWeightSetting = params->at(0);
+    if (params->size() == 2) {
+      m_coarseToFineNBestSize = Scan<size_t>(params->at(1));
+    }
+  }
+
   //lattice samples
   params = m_parameter->GetParam("lattice-samples");
   if (params) {
@@ -347,11 +370,21 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_parameter->SetParameter(m_maxNoTransOptPerCoverage, "max-trans-opt-per-coverage", DEFAULT_MAX_TRANS_OPT_SIZE);
   m_parameter->SetParameter(m_maxNoPartTransOpt, "max-partial-trans-opt", DEFAULT_MAX_PART_TRANS_OPT_SIZE);
+  m_parameter->SetParameter(m_lazyFactorExpansion, "lazy-factor-expansion", false);
+  m_parameter->SetParameter(m_lazyScoreBreakdown, "lazy-score-breakdown", false);
   m_parameter->SetParameter(m_maxPhraseLength, "max-phrase-length", DEFAULT_MAX_PHRASE_LENGTH);
   m_parameter->SetParameter(m_cubePruningPopLimit, "cube-pruning-pop-limit", DEFAULT_CUBE_PRUNING_POP_LIMIT);
   m_parameter->SetParameter(m_cubePruningDiversity, "cube-pruning-diversity", DEFAULT_CUBE_PRUNING_DIVERSITY);
 
   m_parameter->SetParameter(m_cubePruningLazyScoring, "cube-pruning-lazy-scoring", false);
+  m_parameter->SetParameter<float>(m_cubePruningEarlyStop, "cube-pruning-early-stop", -1);
+  m_parameter->SetParameter<size_t>(m_cubePruningThreads, "cube-pruning-threads", 1);
+#ifndef WITH_THREADS
+  if (m_cubePruningThreads > 1) {
+    std::cerr << "Error: cube-pruning-threads of " << m_cubePruningThreads << " but moses not built with thread support";
+    return false;
+  }
+#endif
 
   // early distortion cost
   m_parameter->SetParameter(m_useEarlyDistortionCost, "early-distortion-cost", false );
@@ -404,6 +437,7 @@ bool StaticData::LoadData(Parameter *parameter)
 
   // S2T decoder
   m_parameter->SetParameter(m_s2tParsingAlgorithm, "s2t-parsing-algorithm", RecursiveCYKPlus);
+  m_parameter->SetParameter<size_t>(m_s2tMaxCellCategories, "s2t-max-cell-categories", 0);
 
   // Compact phrase table and reordering model
   m_parameter->SetParameter(m_minphrMemory, "minphr-memory", false );
@@ -411,9 +445,53 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_parameter->SetParameter<size_t>(m_timeout_threshold, "time-out", -1);
   m_timeout = (GetTimeoutThreshold() == (size_t)-1) ? false : true;
+  m_parameter->SetParameter<double>(m_timeBudget, "time-budget", 0);
+  params = m_parameter->GetParam("profile");
+  if (params) {
+    DecodeProfile::Enable(params->size() ? params->at(0) : "");
+  }
 
   m_parameter->SetParameter<size_t>(m_lmcache_cleanup_threshold, "clean-lm-cache", 1);
 
+  m_parameter->SetParameter(m_parallelLoad, "parallel-load", false);
+  m_parameter->SetParameter<size_t>(m_searchThreads, "search-threads", 1);
+  m_parameter->SetParameter<size_t>(m_outputWindow, "output-window", 0);
+  m_parameter->SetParameter<size_t>(m_recycleSearchMemory, "recycle-search-memory", 64);
+  m_recycleSearchMemory <<= 20;
+  m_parameter->SetParameter<size_t>(m_scheduleWindow, "schedule-window", 0);
+  m_parameter->SetParameter<size_t>(m_searchThreadsMinLength, "search-threads-min-length", 0);
+  m_parameter->SetParameter<size_t>(m_batchSentences, "batch-sentences", 1);
+  m_parameter->SetParameter<size_t>(m_batchMaxLength, "batch-max-length", 20);
+
+  size_t translationCacheSize;
+  m_parameter->SetParameter<size_t>(translationCacheSize, "translation-cache", 0);
+  string translationCacheDir, translationCacheVersion;
+  m_parameter->SetParameter<string>(translationCacheDir, "translation-cache-dir", "");
+  m_parameter->SetParameter<string>(translationCacheVersion, "translation-cache-version", "");
+  if (translationCacheSize || !translationCacheDir.empty()) {
+    m_translationCache.reset(new TranslationCache(translationCacheSize << 20, translationCacheDir,
+                             translationCacheVersion));
+  }
+
+  params = m_parameter->GetParam("input-processing");
+  if (params) {
+    for (size_t i = 0; i < params->size(); ++i) {
+      m_inputProcessing.Add(params->at(i));
+    }
+  }
+  params = m_parameter->GetParam("output-processing");
+  if (params) {
+    for (size_t i = 0; i < params->size(); ++i) {
+      m_outputProcessing.Add(params->at(i));
+    }
+  }
+#ifndef WITH_THREADS
+  if (m_searchThreads > 1) {
+    std::cerr << "Error: search-threads of " << m_searchThreads << " but moses not built with thread support";
+    return false;
+  }
+#endif
+
   m_threadCount = 1;
   params = m_parameter->GetParam("threads");
   if (params && params->size()) {
@@ -500,7 +578,46 @@ bool StaticData::LoadData(Parameter *parameter)
   }
 
   LoadDecodeGraphs();
+  Hypothesis::InitStateKeyLayout();
 
+  if (m_searchAlgorithm == ChartIncremental) {
+    // the other stateful features would silently not be scored
+    const vector<const StatefulFeatureFunction*> &sfs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+    UTIL_THROW_IF2(sfs.size() > 1, "Incremental search scores a single language model, "
+                   << sfs[1]->GetScoreProducerDescription() << " is a second stateful feature");
+  }
+
+  size_t translationOptionCacheSize;
+  m_parameter->SetParameter<size_t>(translationOptionCacheSize, "translation-option-cache", 0);
+  if (translationOptionCacheSize) {
+    const FeatureFunction *contextual = NULL;
+    const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+    for (size_t i = 0; i < ffs.size() && contextual == NULL; ++i) {
+      if (ffs[i]->DependsOnSourceContext()) contextual = ffs[i];
+    }
+    if (contextual) {
+      VERBOSE(1, "Not caching translation options: " << contextual->GetScoreProducerDescription()
+              << " depends on the source context" << endl);
+    } else {
+      m_translationOptionCache.reset(new TranslationOptionCache(translationOptionCacheSize));
+    }
+  }
+
+  // nor whole translations, if they depend on more than the sentence: its
+  // place in a document, or its reference for forced decoding
+  if (m_translationCache) {
+    const FeatureFunction *contextual = NULL;
+    const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+    for (size_t i = 0; i < ffs.size() && contextual == NULL; ++i) {
+      if (ffs[i]->DependsOnSourceContext() || dynamic_cast<const ConstrainedDecoding*>(ffs[i]))
+        contextual = ffs[i];
+    }
+    if (contextual) {
+      VERBOSE(1, "Not caching translations: " << contextual->GetScoreProducerDescription()
+              << " depends on more than the input sentence" << endl);
+      m_translationCache.reset();
+    }
+  }
 
   if (!CheckWeights()) {
     return false;
@@ -530,6 +647,15 @@ bool StaticData::LoadData(Parameter *parameter)
       return false;
     }
   }
+  if (IsCoarseToFine() && IsSyntax() && m_searchAlgorithm != CYKPlus) {
+    std::cerr << "ERROR: -coarse-to-fine is only supported by phrase-based and CYK+ chart decoding" << std::endl;
+    return false;
+  }
+  if (IsCoarseToFine() && !m_weightSetting.count(m_coarseToFineWeightSetting)) {
+    std::cerr << "ERROR: -coarse-to-fine uses weight setting " << m_coarseToFineWeightSetting
+              << ", which is not defined by -alternate-weight-setting" << std::endl;
+    return false;
+  }
   return true;
 }
 
@@ -848,6 +974,7 @@ float StaticData::GetWeightWordPenalty() const
 
 void StaticData::InitializeForInput(const InputType& source) const
 {
+  ContextScope::SetCurrent(source.GetScope());
   const std::vector<FeatureFunction*> &producers = FeatureFunction::GetFeatureFunctions();
   for(size_t i=0; i<producers.size(); ++i) {
     FeatureFunction &ff = *producers[i];
@@ -871,35 +998,102 @@ void StaticData::CleanUpAfterSentenceProcessing(const InputType& source) const
   }
 }
 
+namespace
+{
+//! Load() one feature function, reporting the time taken. Errors are kept
+//! for the caller since they cannot propagate out of a pool thread.
+class LoadTask : public Task
+{
+public:
+  explicit LoadTask(FeatureFunction &ff) : m_ff(ff) {}
+
+  void Run() {
+    Timer timer;
+    timer.start();
+    VERBOSE(1, "Loading " << m_ff.GetScoreProducerDescription() << endl);
+    try {
+      m_ff.Load();
+    } catch (const std::exception &e) {
+      m_error = e.what();
+      return;
+    }
+    VERBOSE(1, "Loaded " << m_ff.GetScoreProducerDescription() << " in "
+            << timer.get_elapsed_time() << " seconds" << endl);
+  }
+
+  const std::string &GetError() const {
+    return m_error;
+  }
+
+private:
+  FeatureFunction &m_ff;
+  std::string m_error;
+};
+
+void LoadAll(const std::vector<FeatureFunction*> &ffs, size_t threads)
+{
+  std::vector<boost::shared_ptr<LoadTask> > tasks;
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    tasks.push_back(boost::shared_ptr<LoadTask>(new LoadTask(*ffs[i])));
+  }
+
+#ifdef WITH_THREADS
+  if (threads > 1 && tasks.size() > 1) {
+    ThreadPool pool(std::min(threads, tasks.size()));
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      pool.Submit(tasks[i]);
+    }
+    pool.Stop(true);
+  } else
+#endif
+  {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]->Run();
+      UTIL_THROW_IF2(!tasks[i]->GetError().empty(), tasks[i]->GetError());
+    }
+  }
+
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    UTIL_THROW_IF2(!tasks[i]->GetError().empty(), tasks[i]->GetError());
+  }
+}
+} // namespace
+
 void StaticData::LoadFeatureFunctions()
 {
+  // Phrase tables are loaded last since loading them may evaluate other
+  // features on the target phrases. Within each group, features whose Load()
+  // looks at other features are loaded serially after the rest.
+  std::vector<FeatureFunction*> independent, dependent;
+
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
   std::vector<FeatureFunction*>::const_iterator iter;
   for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
     FeatureFunction *ff = *iter;
-    bool doLoad = true;
 
     if (ff->RequireSortingAfterSourceContext()) {
       m_requireSortingAfterSourceContext = true;
     }
 
-    // if (PhraseDictionary *ffCast = dynamic_cast<PhraseDictionary*>(ff)) {
     if (dynamic_cast<PhraseDictionary*>(ff)) {
-      doLoad = false;
-    }
-
-    if (doLoad) {
-      VERBOSE(1, "Loading " << ff->GetScoreProducerDescription() << endl);
-      ff->Load();
+      continue;
     }
+    (ff->LoadsIndependently() ? independent : dependent).push_back(ff);
   }
 
+  const size_t threads = m_parallelLoad ? m_threadCount : 1;
+  LoadAll(independent, threads);
+  LoadAll(dependent, 1);
+
+  independent.clear();
+  dependent.clear();
   const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
   for (size_t i = 0; i < pts.size(); ++i) {
     PhraseDictionary *pt = pts[i];
-    VERBOSE(1, "Loading " << pt->GetScoreProducerDescription() << endl);
-    pt->Load();
+    (pt->LoadsIndependently() ? independent : dependent).push_back(pt);
   }
+  LoadAll(independent, threads);
+  LoadAll(dependent, 1);
 
   CheckLEGACYPT();
 }
@@ -976,10 +1170,8 @@ void StaticData::LoadSparseWeightsFromConfig()
 /**! Read in settings for alternative weights */
 bool StaticData::LoadAlternateWeightSettings()
 {
-  if (m_threadCount > 1) {
-    cerr << "ERROR: alternative weight settings currently not supported with multi-threading.";
-    return false;
-  }
+  // with threads each decoding thread selects its own setting
+  // (see SetWeightSetting), so threads may decode different systems
 
   vector<string> weightSpecification;
   const PARAM_VEC *params = m_parameter->GetParam("alternate-weight-setting");
@@ -1081,6 +1273,81 @@ bool StaticData::LoadAlternateWeightSettings()
   return true;
 }
 
+boost::shared_ptr<const ScoreComponentCollection>
+StaticData::CreateRequestWeights(const std::string &settingName,
+                                 const std::map<std::string, std::vector<float> > &weights) const
+{
+  const ScoreComponentCollection *base = &m_allWeights;
+  if (!settingName.empty() && settingName != "default") {
+    std::map< std::string, ScoreComponentCollection* >::const_iterator i = m_weightSetting.find(settingName);
+    UTIL_THROW_IF2(i == m_weightSetting.end(), "Unknown weight setting " << settingName);
+    base = i->second;
+  }
+  ScoreComponentCollection *ret = new ScoreComponentCollection(*base);
+  boost::shared_ptr<const ScoreComponentCollection> retPtr(ret);
+
+  // dense weights of the features given by name, the rest are sparse
+  map<string,FeatureFunction*> nameToFF;
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    nameToFF[ ffs[i]->GetScoreProducerDescription() ] = ffs[i];
+  }
+  std::map<std::string, std::vector<float> >::const_iterator iter;
+  for (iter = weights.begin(); iter != weights.end(); ++iter) {
+    map<string,FeatureFunction*>::const_iterator ff = nameToFF.find(iter->first);
+    if (ff != nameToFF.end()) {
+      UTIL_THROW_IF2(iter->second.size() != ff->second->GetNumScoreComponents(),
+                     "Feature " << iter->first << " has " << ff->second->GetNumScoreComponents()
+                     << " weights, not " << iter->second.size());
+      ret->Assign(ff->second, iter->second);
+    } else {
+      UTIL_THROW_IF2(iter->second.size() != 1, "ERROR: only one weight per sparse feature allowed: " << iter->first);
+      ret->Assign(iter->first, iter->second[0]);
+    }
+  }
+  return retPtr;
+}
+
+void StaticData::SetRequestWeights(const boost::shared_ptr<const ScoreComponentCollection> &weights) const
+{
+#ifdef WITH_THREADS
+  ThreadWeightSetting *setting = m_threadWeightSetting.get();
+  if (!weights) {
+    // back to the weights of the weight setting
+    if (setting && setting->requestWeights) {
+      if (setting->name == "default") {
+        m_threadWeightSetting.reset();
+      } else {
+        setting->requestWeights.reset();
+        setting->weights = m_weightSetting.find(setting->name)->second;
+      }
+    }
+    return;
+  }
+  if (!setting) {
+    setting = new ThreadWeightSetting;
+    setting->name = m_currentWeightSetting;
+    m_threadWeightSetting.reset(setting);
+  }
+  setting->requestWeights = weights;
+  setting->weights = weights.get();
+#else
+  m_requestWeights = weights;
+#endif
+}
+
+void StaticData::SelectWeights(const InputType &source) const
+{
+  if (GetHasAlternateWeightSettings()) {
+    if (source.GetSpecifiesWeightSetting()) {
+      SetWeightSetting(source.GetWeightSetting());
+    } else {
+      SetWeightSetting("default");
+    }
+  }
+  SetRequestWeights(source.GetRequestWeights());
+}
+
 void StaticData::NoCache()
 {
   bool noCache;
@@ -1169,10 +1436,11 @@ void StaticData::CheckLEGACYPT()
 
 void StaticData::ResetWeights(const std::string &denseWeights, const std::string &sparseFile)
 {
+  const ScoreComponentCollection oldWeights = m_allWeights;
   m_allWeights = ScoreComponentCollection();
 
-  // dense weights
-  string name("");
+  // dense weights, "x" keeps the previous weight
+  const FeatureFunction *ff = NULL;
   vector<float> weights;
   vector<string> toks = Tokenize(denseWeights);
   for (size_t i = 0; i < toks.size(); ++i) {
@@ -1181,23 +1449,32 @@ void StaticData::ResetWeights(const std::string &denseWeights, const std::string
     if (ends_with(tok, "=")) {
       // start of new feature
 
-      if (name != "") {
+      if (ff) {
         // save previous ff
-        const FeatureFunction &ff = FeatureFunction::FindFeatureFunction(name);
-        m_allWeights.Assign(&ff, weights);
+        m_allWeights.Assign(ff, weights);
         weights.clear();
       }
 
-      name = tok.substr(0, tok.size() - 1);
+      ff = &FeatureFunction::FindFeatureFunction(tok.substr(0, tok.size() - 1));
+    } else if (tok == "x") {
+      UTIL_THROW_IF2(ff == NULL || weights.size() >= ff->GetNumScoreComponents(),
+                     "Keeping previous weight failed in " << denseWeights);
+      weights.push_back(oldWeights.GetScoresForProducer(ff)[weights.size()]);
     } else {
       // a weight for curr ff
-      float weight = Scan<float>(toks[i]);
+      UTIL_THROW_IF2(ff == NULL, "Weight without a feature name in " << denseWeights);
+      float weight = Scan<float>(tok);
       weights.push_back(weight);
     }
   }
 
-  const FeatureFunction &ff = FeatureFunction::FindFeatureFunction(name);
-  m_allWeights.Assign(&ff, weights);
+  if (ff) {
+    m_allWeights.Assign(ff, weights);
+  }
+
+  if (sparseFile.empty()) {
+    return;
+  }
 
   // sparse weights
   InputFileStream sparseStrme(sparseFile);
@@ -1206,11 +1483,12 @@ void StaticData::ResetWeights(const std::string &denseWeights, const std::string
     vector<string> toks = Tokenize(line);
     UTIL_THROW_IF2(toks.size() != 2, "Incorrect sparse weight format. Should be FFName_spareseName weight");
 
-    vector<string> names = Tokenize(toks[0], "_");
-    UTIL_THROW_IF2(names.size() != 2, "Incorrect sparse weight name. Should be FFName_spareseName");
+    // the sparse name itself may contain underscores
+    size_t split = toks[0].find('_');
+    UTIL_THROW_IF2(split == string::npos || split == 0, "Incorrect sparse weight name. Should be FFName_spareseName");
 
-    const FeatureFunction &ff = FeatureFunction::FindFeatureFunction(names[0]);
-    m_allWeights.Assign(&ff, names[1], Scan<float>(toks[1]));
+    const FeatureFunction &ff = FeatureFunction::FindFeatureFunction(toks[0].substr(0, split));
+    m_allWeights.Assign(&ff, toks[0].substr(split + 1), Scan<float>(toks[1]));
   }
 }
 
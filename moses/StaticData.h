@@ -37,11 +37,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/thread/mutex.hpp>
 #endif
 
+#include <boost/shared_ptr.hpp>
+
 #include "Parameter.h"
 #include "SentenceStats.h"
 #include "ScoreComponentCollection.h"
 #include "moses/FF/Factory.h"
 #include "moses/PP/Factory.h"
+#include "moses/TextProcessing/TextProcessor.h"
 
 namespace Moses
 {
@@ -50,6 +53,8 @@ class InputType;
 class DecodeGraph;
 class DecodeStep;
 
+class TranslationCache;
+class TranslationOptionCache;
 class DynamicCacheBasedLanguageModel;
 class PhraseDictionaryDynamicCacheBased;
 
@@ -100,6 +105,8 @@ protected:
   , m_maxPhraseLength;
 
   std::string		m_nBestFilePath, m_latticeSamplesFilePath;
+  std::string m_coarseToFineWeightSetting; //! weight setting of the first pass, empty if off
+  size_t m_coarseToFineNBestSize; //! translations of the first pass that the second may produce
   bool                  m_labeledNBestList,m_nBestIncludesSegmentation;
   bool m_dropUnknown; //! false = treat unknown words as unknowns, and translate them as themselves; true = drop (ignore) them
   bool m_markUnknown; //! false = treat unknown words as unknowns, and translate them as themselves; true = mark and (ignore) them
@@ -163,6 +170,7 @@ protected:
 
   bool m_timeout; //! use timeout
   size_t m_timeout_threshold; //! seconds after which time out is activated
+  double m_timeBudget; //! wall-clock seconds per sentence, 0 for no limit
 
   bool m_isAlwaysCreateDirectTranslationOption;
   //! constructor. only the 1 static variable can be created
@@ -182,6 +190,10 @@ protected:
   size_t m_cubePruningPopLimit;
   size_t m_cubePruningDiversity;
   bool m_cubePruningLazyScoring;
+  float m_cubePruningEarlyStop; //! margin for early stopping in chart cells, negative if off
+  bool m_lazyFactorExpansion;
+  bool m_lazyScoreBreakdown; //! drop hypothesis feature scores after search scoring, see Hypothesis::GetScoreBreakdown()
+  size_t m_cubePruningThreads;
   size_t m_ruleLimit;
 
   // Whether to load compact phrase table and reordering table into memory
@@ -196,10 +208,31 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  size_t m_searchThreads;
+  size_t m_outputWindow;
+  size_t m_batchSentences, m_batchMaxLength;
+  size_t m_scheduleWindow, m_searchThreadsMinLength;
+  size_t m_recycleSearchMemory;
+  bool m_parallelLoad;
+  boost::shared_ptr<TranslationCache> m_translationCache;
+  TextProcessorChain m_inputProcessing, m_outputProcessing;
+  boost::shared_ptr<TranslationOptionCache> m_translationOptionCache;
   long m_startTranslationId;
 
   // alternate weight settings
   mutable std::string m_currentWeightSetting;
+#ifdef WITH_THREADS
+  // with threads the setting is chosen per decoding thread, so that
+  // sentences of different systems can be translated at the same time
+  struct ThreadWeightSetting {
+    std::string name;
+    const ScoreComponentCollection *weights;
+    boost::shared_ptr<const ScoreComponentCollection> requestWeights;
+  };
+  mutable boost::thread_specific_ptr<ThreadWeightSetting> m_threadWeightSetting;
+#else
+  mutable boost::shared_ptr<const ScoreComponentCollection> m_requestWeights;
+#endif
   std::map< std::string, ScoreComponentCollection* > m_weightSetting; // core weights
   std::map< std::string, std::set< std::string > > m_weightSettingIgnoreFF; // feature function
   std::map< std::string, std::set< size_t > > m_weightSettingIgnoreDP; // decoding path
@@ -208,6 +241,7 @@ protected:
   bool m_useLegacyPT;
   bool m_defaultNonTermOnlyForEmptyRange;
   S2TParsingAlgorithm m_s2tParsingAlgorithm;
+  size_t m_s2tMaxCellCategories;
   bool m_printNBestTrees;
 
   FeatureRegistry m_registry;
@@ -299,6 +333,12 @@ public:
   inline size_t GetMaxNoPartTransOpt() const {
     return m_maxNoPartTransOpt;
   }
+  bool GetLazyFactorExpansion() const {
+    return m_lazyFactorExpansion;
+  }
+  bool IsLazyScoreBreakdown() const {
+    return m_lazyScoreBreakdown;
+  }
   inline size_t GetMaxPhraseLength() const {
     return m_maxPhraseLength;
   }
@@ -320,6 +360,13 @@ public:
   bool GetCubePruningLazyScoring() const {
     return m_cubePruningLazyScoring;
   }
+  //! margin below the k-th best hypothesis of a chart cell at which to stop popping, negative if off
+  float GetCubePruningEarlyStop() const {
+    return m_cubePruningEarlyStop;
+  }
+  size_t GetCubePruningThreads() const {
+    return m_cubePruningThreads;
+  }
   size_t IsPathRecoveryEnabled() const {
     return m_recoverPath;
   }
@@ -417,8 +464,21 @@ public:
   const std::string &GetNBestFilePath() const {
     return m_nBestFilePath;
   }
+  void SetNBestFilePath(const std::string &path) {
+    m_nBestFilePath = path;
+  }
+  //! decode in two passes, see -coarse-to-fine
+  bool IsCoarseToFine() const {
+    return !m_coarseToFineWeightSetting.empty();
+  }
+  const std::string &GetCoarseToFineWeightSetting() const {
+    return m_coarseToFineWeightSetting;
+  }
+  size_t GetCoarseToFineNBestSize() const {
+    return m_coarseToFineNBestSize;
+  }
   bool IsNBestEnabled() const {
-    return (!m_nBestFilePath.empty()) || m_mbr || m_useLatticeMBR || m_mira || m_outputSearchGraph || m_outputSearchGraphSLF || m_outputSearchGraphHypergraph || m_useConsensusDecoding || !m_latticeSamplesFilePath.empty()
+    return (!m_nBestFilePath.empty()) || IsCoarseToFine() || m_mbr || m_useLatticeMBR || m_mira || m_outputSearchGraph || m_outputSearchGraphSLF || m_outputSearchGraphHypergraph || m_useConsensusDecoding || !m_latticeSamplesFilePath.empty()
 #ifdef HAVE_PROTOBUF
            || m_outputSearchGraphPB
 #endif
@@ -456,6 +516,16 @@ public:
   }
 
   const ScoreComponentCollection& GetAllWeights() const {
+#ifdef WITH_THREADS
+    const ThreadWeightSetting *setting = m_threadWeightSetting.get();
+    if (setting) {
+      return *setting->weights;
+    }
+#else
+    if (m_requestWeights) {
+      return *m_requestWeights;
+    }
+#endif
     return m_allWeights;
   }
 
@@ -465,7 +535,7 @@ public:
 
   //Weight for a single-valued feature
   float GetWeight(const FeatureFunction* sp) const {
-    return m_allWeights.GetScoreForProducer(sp);
+    return GetAllWeights().GetScoreForProducer(sp);
   }
 
   //Weight for a single-valued feature
@@ -474,7 +544,7 @@ public:
 
   //Weights for feature with fixed number of values
   std::vector<float> GetWeights(const FeatureFunction* sp) const {
-    return m_allWeights.GetScoresForProducer(sp);
+    return GetAllWeights().GetScoresForProducer(sp);
   }
 
   //Weights for feature with fixed number of values
@@ -542,6 +612,9 @@ public:
   size_t GetTimeoutThreshold() const {
     return m_timeout_threshold;
   }
+  double GetTimeBudget() const {
+    return m_timeBudget;
+  }
 
   size_t GetLMCacheCleanupThreshold() const {
     return m_lmcache_cleanup_threshold;
@@ -638,6 +711,59 @@ public:
     return m_threadCount;
   }
 
+  //! threads used within one sentence by the phrase-based search
+  size_t GetSearchThreads() const {
+    return m_searchThreads;
+  }
+
+  //! whether a sentence of this many words is long enough for -search-threads
+  bool UseSearchThreads(size_t sentenceLength) const {
+    return m_searchThreads > 1 && sentenceLength >= m_searchThreadsMinLength;
+  }
+
+  //! how far decoding may run ahead of the output, 0 if unlimited
+  size_t GetOutputWindow() const {
+    return m_outputWindow;
+  }
+
+  //! bytes of search memory a thread keeps between sentences, 0 for none
+  size_t GetRecycleSearchMemory() const {
+    return m_recycleSearchMemory;
+  }
+
+  //! inputs the command-line decoder reorders longest first, 0 or 1 for none
+  size_t GetScheduleWindow() const {
+    return m_scheduleWindow;
+  }
+
+  //! sentences translated by one task of the command-line decoder
+  size_t GetBatchSentences() const {
+    return m_batchSentences;
+  }
+
+  //! longest sentence (in words) that is batched
+  size_t GetBatchMaxLength() const {
+    return m_batchMaxLength;
+  }
+
+  //! cache of whole-sentence translations, NULL if disabled
+  TranslationCache *GetTranslationCache() const {
+    return m_translationCache.get();
+  }
+
+  //! [input-processing] and [output-processing]
+  const TextProcessorChain &GetInputProcessing() const {
+    return m_inputProcessing;
+  }
+  const TextProcessorChain &GetOutputProcessing() const {
+    return m_outputProcessing;
+  }
+
+  //! cache of the translation options of source spans, NULL if disabled
+  TranslationOptionCache *GetTranslationOptionCache() const {
+    return m_translationOptionCache.get();
+  }
+
   long GetStartTranslationId() const {
     return m_startTranslationId;
   }
@@ -669,6 +795,17 @@ public:
     return m_weightSetting.size() > 0;
   }
 
+  //! the weight setting of the sentence being decoded (on this thread)
+  const std::string &GetCurrentWeightSetting() const {
+#ifdef WITH_THREADS
+    const ThreadWeightSetting *setting = m_threadWeightSetting.get();
+    if (setting) {
+      return setting->name;
+    }
+#endif
+    return m_currentWeightSetting;
+  }
+
   /** Alternate weight settings allow the wholesale ignoring of
       feature functions. This function checks if a feature function
       should be evaluated given the current weight setting */
@@ -677,7 +814,7 @@ public:
       return false;
     }
     std::map< std::string, std::set< std::string > >::const_iterator lookupIgnoreFF
-    =  m_weightSettingIgnoreFF.find( m_currentWeightSetting );
+    =  m_weightSettingIgnoreFF.find( GetCurrentWeightSetting() );
     if (lookupIgnoreFF == m_weightSettingIgnoreFF.end()) {
       return false;
     }
@@ -695,7 +832,7 @@ public:
       return false;
     }
     std::map< std::string, std::set< size_t > >::const_iterator lookupIgnoreDP
-    =  m_weightSettingIgnoreDP.find( m_currentWeightSetting );
+    =  m_weightSettingIgnoreDP.find( GetCurrentWeightSetting() );
     if (lookupIgnoreDP == m_weightSettingIgnoreDP.end()) {
       return false;
     }
@@ -704,11 +841,13 @@ public:
   }
 
   /** process alternate weight settings
-    * (specified with [alternate-weight-setting] in config file) */
+    * (specified with [alternate-weight-setting] in config file).
+    * With threads, this only changes the setting of the calling thread;
+    * the feature functions are shared by all settings. */
   void SetWeightSetting(const std::string &settingName) const {
 
     // if no change in weight setting, do nothing
-    if (m_currentWeightSetting == settingName) {
+    if (GetCurrentWeightSetting() == settingName) {
       return;
     }
 
@@ -719,7 +858,7 @@ public:
     }
 
     // find the setting
-    m_currentWeightSetting = settingName;
+    std::string name = settingName;
     std::map< std::string, ScoreComponentCollection* >::const_iterator i =
       m_weightSetting.find( settingName );
 
@@ -728,13 +867,41 @@ public:
       std::cerr << "Warning: Specified weight setting " << settingName
                 << " does not exist in model, using default weight setting instead";
       i = m_weightSetting.find( "default" );
-      m_currentWeightSetting = "default";
+      name = "default";
     }
 
+#ifdef WITH_THREADS
+    // the default setting is the main weights, which may be updated online
+    if (name == "default") {
+      m_threadWeightSetting.reset();
+    } else {
+      if (!m_threadWeightSetting.get()) {
+        m_threadWeightSetting.reset(new ThreadWeightSetting);
+      }
+      m_threadWeightSetting->name = name;
+      m_threadWeightSetting->weights = i->second;
+      m_threadWeightSetting->requestWeights.reset();
+    }
+#else
     // set weights
+    m_currentWeightSetting = name;
     m_allWeights = *(i->second);
+#endif
   }
 
+  /** weights of the given setting (or the main weights if it is empty)
+    * with those of some features replaced, e.g. a tuned profile sent with
+    * a request. Features are given by name, sparse features as "ff_name". */
+  boost::shared_ptr<const ScoreComponentCollection>
+  CreateRequestWeights(const std::string &settingName,
+                       const std::map<std::string, std::vector<float> > &weights) const;
+
+  //! decode with these weights instead of those of the weight setting (NULL to stop)
+  void SetRequestWeights(const boost::shared_ptr<const ScoreComponentCollection> &weights) const;
+
+  //! select the weight setting and own weights of an input before decoding it
+  void SelectWeights(const InputType &source) const;
+
   float GetWeightWordPenalty() const;
 
   const std::vector<DecodeGraph*>& GetDecodeGraphs() const {
@@ -801,6 +968,10 @@ public:
     return m_s2tParsingAlgorithm;
   }
 
+  size_t GetS2TMaxCellCategories() const {
+    return m_s2tMaxCellCategories;
+  }
+
   bool PrintNBestTrees() const {
     return m_printNBestTrees;
   }
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "StreamingDecoder.h"
+#include "ContextScope.h"
+#include "Hypothesis.h"
+#include "Manager.h"
+#include "Sentence.h"
+#include "StaticData.h"
+#include "util/tokenize_piece.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+void StreamingDecoder::AddWords(const string &words)
+{
+  for (util::TokenIter<util::AnyCharacter, true> it(words, " \t"); it; ++it) {
+    m_words.push_back(it->as_string());
+  }
+}
+
+void StreamingDecoder::Decode(const Settings &settings, Segments &best) const
+{
+  best.clear();
+  if (m_words.empty()) return;
+  string text;
+  for (size_t i = 0; i < m_words.size(); ++i) {
+    if (i) text += ' ';
+    text += m_words[i];
+  }
+  Sentence sentence(0, text);
+  if (settings.scope) sentence.SetScope(settings.scope);
+  if (!settings.weightSetting.empty()) {
+    sentence.SetWeightSetting(settings.weightSetting);
+    sentence.SetSpecifiesWeightSetting(true);
+  }
+  sentence.SetRequestWeights(settings.weights);
+
+  Manager manager(sentence);
+  manager.Decode();
+  const vector<FactorType> &factors = StaticData::Instance().GetOutputFactorOrder();
+  for (const Hypothesis *hypo = manager.GetBestHypothesis();
+       hypo && hypo->GetPrevHypo(); hypo = hypo->GetPrevHypo()) {
+    Segment segment;
+    segment.start = hypo->GetCurrSourceWordsRange().GetStartPos();
+    segment.end = hypo->GetCurrSourceWordsRange().GetEndPos() + 1;
+    segment.target = hypo->GetCurrTargetPhrase().GetStringRep(factors);
+    best.push_back(segment);
+  }
+  reverse(best.begin(), best.end());
+}
+
+string StreamingDecoder::Join(Segments::const_iterator begin, Segments::const_iterator end)
+{
+  string ret;
+  for (; begin != end; ++begin) {
+    if (begin->target.empty()) continue;
+    if (!ret.empty()) ret += ' ';
+    ret += begin->target;
+  }
+  return ret;
+}
+
+string StreamingDecoder::Add(const string &words, const Settings &settings)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  AddWords(words);
+  Segments best;
+  Decode(settings, best);
+
+  // the longest agreeing prefix of phrases that covers the first words
+  // without gaps: then the number of words covered is one past the last
+  size_t commit = 0, committedWords = 0;
+  size_t covered = 0, last = 0;
+  for (size_t i = 0; i < best.size() && i < m_previous.size() && best[i] == m_previous[i]; ++i) {
+    covered += best[i].end - best[i].start;
+    last = max(last, best[i].end);
+    if (covered == last) {
+      commit = i + 1;
+      committedWords = covered;
+    }
+  }
+  string ret = Join(best.begin(), best.begin() + commit);
+
+  m_words.erase(m_words.begin(), m_words.begin() + committedWords);
+  m_previous.assign(best.begin() + commit, best.end());
+  for (size_t i = 0; i < m_previous.size(); ++i) {
+    m_previous[i].start -= committedWords;
+    m_previous[i].end -= committedWords;
+  }
+  return ret;
+}
+
+string StreamingDecoder::Finish(const string &words, const Settings &settings)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  AddWords(words);
+  Segments best;
+  Decode(settings, best);
+  m_words.clear();
+  m_previous.clear();
+  return Join(best.begin(), best.end());
+}
+
+string StreamingDecoder::GetPending() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  return Join(m_previous.begin(), m_previous.end());
+}
+
+}
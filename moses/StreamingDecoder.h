@@ -0,0 +1,84 @@
+// -*- c++ -*-
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+class ContextScope;
+class ScoreComponentCollection;
+
+/** Translates a sentence while it is still arriving, for simultaneous
+ *  translation such as live captions: the words come in chunks, and output
+ *  is committed as soon as it is stable.
+ *
+ *  After every chunk the words not committed yet are decoded. The leading
+ *  phrases of the best translation that led the best translation after the
+ *  previous chunk too ("local agreement"), and that cover the first of these
+ *  words, are committed: their translation is final and their source words
+ *  are left out of later decodes. Each decode thus covers the words since
+ *  the last commit, not the whole sentence, and with
+ *  -translation-option-cache only the spans with new words are looked up.
+ *  The search after a commit starts afresh, at the start of a sentence for
+ *  the language model.
+ *
+ *  Phrase-based decoding only. The calls for one sentence are serialized,
+ *  so a server session can keep one in its ContextScope.
+ */
+class StreamingDecoder
+{
+public:
+  //! how to decode, given with every chunk
+  struct Settings {
+    boost::shared_ptr<ContextScope> scope;
+    std::string weightSetting; //!< empty for the default weights
+    boost::shared_ptr<const ScoreComponentCollection> weights;
+  };
+
+  /** Adds words (space separated, with factors as in the input) to the
+   *  sentence; returns the output they allowed to commit, possibly empty.
+   */
+  std::string Add(const std::string &words, const Settings &settings);
+
+  /** Adds the last words and ends the sentence: translates the rest and
+   *  commits it all. The next Add() starts a new sentence.
+   */
+  std::string Finish(const std::string &words, const Settings &settings);
+
+  //! the best translation of the words not committed yet, as of the
+  //! last Add()
+  std::string GetPending() const;
+
+private:
+  //! a phrase of a translation; source positions count from the first
+  //! word not committed
+  struct Segment {
+    size_t start, end; //!< end is one past the last word
+    std::string target;
+    bool operator==(const Segment &other) const {
+      return start == other.start && end == other.end && target == other.target;
+    }
+  };
+  typedef std::vector<Segment> Segments;
+
+  void AddWords(const std::string &words);
+  void Decode(const Settings &settings, Segments &best) const;
+  static std::string Join(Segments::const_iterator begin, Segments::const_iterator end);
+
+  std::vector<std::string> m_words; //!< not committed
+  Segments m_previous; //!< best translation of them after the previous chunk
+
+#ifdef WITH_THREADS
+  mutable boost::mutex m_mutex;
+#endif
+};
+
+}
@@ -0,0 +1,114 @@
+#include "CubePruningJobs.h"
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include "moses/StaticData.h"
+#include "moses/FF/FeatureFunction.h"
+#include "util/exception.hh"
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+namespace Syntax
+{
+
+#ifdef WITH_THREADS
+namespace
+{
+
+// Cube prunes a slice of the jobs on a pool thread.
+class CubePruningTask : public Task
+{
+public:
+  CubePruningTask(std::vector<CubePruningJob> &jobs, std::size_t begin,
+                  std::size_t end, const CubePruningFunction &prune)
+    : m_jobs(jobs), m_begin(begin), m_end(end), m_prune(prune), m_done(false) {}
+
+  void Run() {
+    try {
+      for (std::size_t i = m_begin; i < m_end; ++i) {
+        m_prune(m_jobs[i]);
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  // Returns the error message if pruning threw.
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
+  }
+
+private:
+  std::vector<CubePruningJob> &m_jobs;
+  std::size_t m_begin, m_end;
+  const CubePruningFunction &m_prune;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+
+}  // namespace
+#endif
+
+CubePruningJobRunner::CubePruningJobRunner()
+{
+#ifdef WITH_THREADS
+  const StaticData &staticData = StaticData::Instance();
+  bool threadSafe = staticData.GetSearchThreads() > 1 &&
+                    staticData.GetVerboseLevel() < 2;
+  const std::vector<FeatureFunction*> &ffs =
+    FeatureFunction::GetFeatureFunctions();
+  for (std::size_t i = 0; threadSafe && i < ffs.size(); ++i) {
+    threadSafe = ffs[i]->CanEvaluateOnAnyThread();
+  }
+  if (threadSafe) {
+    m_pool.reset(new ThreadPool(staticData.GetSearchThreads()));
+  }
+#endif
+}
+
+void CubePruningJobRunner::Run(std::vector<CubePruningJob> &jobs,
+                               const CubePruningFunction &prune)
+{
+#ifdef WITH_THREADS
+  if (m_pool && jobs.size() > 1) {
+    const std::size_t numTasks = std::min(jobs.size(),
+                                          StaticData::Instance().GetSearchThreads() * 4);
+    std::vector<boost::shared_ptr<CubePruningTask> > tasks;
+    for (std::size_t t = 0; t < numTasks; ++t) {
+      tasks.push_back(boost::shared_ptr<CubePruningTask>(
+                        new CubePruningTask(jobs, jobs.size() * t / numTasks,
+                                            jobs.size() * (t + 1) / numTasks, prune)));
+      m_pool->Submit(tasks.back());
+    }
+    // wait for every task before reporting, they all reference jobs
+    std::string error;
+    for (std::size_t t = 0; t < numTasks; ++t) {
+      const std::string &taskError = tasks[t]->Wait();
+      if (error.empty()) error = taskError;
+    }
+    UTIL_THROW_IF2(!error.empty(), error);
+    return;
+  }
+#endif
+  for (std::vector<CubePruningJob>::iterator p = jobs.begin();
+       p != jobs.end(); ++p) {
+    prune(*p);
+  }
+}
+
+}  // Syntax
+}  // Moses
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "moses/ThreadPool.h"
+
+#include "PVertex.h"
+#include "SHyperedgeBundle.h"
+#include "SVertexStack.h"
+
+namespace Moses
+{
+namespace Syntax
+{
+
+// The matched rules of one vertex, waiting to be cube pruned into its stack.
+struct CubePruningJob {
+  const PVertex *pvertex;
+  SVertexStack *stack;
+  std::vector<SHyperedgeBundle> bundles;
+};
+
+typedef boost::function<void (CubePruningJob &)> CubePruningFunction;
+
+// Runs the cube pruning of a batch of vertices that don't depend on each
+// other, eg. one level of a forest in bottom-up topological order.  Rule
+// matching (which updates the matchers and the glue rule trie) stays on the
+// manager's thread; only the jobs are spread over the threads.  If
+// search-threads is 1, or some feature must be evaluated on the thread that
+// decodes the sentence, the jobs run one after the other in order.
+class CubePruningJobRunner
+{
+public:
+  CubePruningJobRunner();
+
+  // Calls prune on every job and returns once all of them are done.
+  void Run(std::vector<CubePruningJob> &jobs, const CubePruningFunction &prune);
+
+private:
+#ifdef WITH_THREADS
+  boost::scoped_ptr<ThreadPool> m_pool;
+#endif
+};
+
+}  // Syntax
+}  // Moses
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "moses/DecodeGraph.h"
 #include "moses/ForestInput.h"
 #include "moses/StaticData.h"
 #include "moses/Syntax/BoundedPriorityContainer.h"
+#include "moses/Syntax/CubePruningJobs.h"
 #include "moses/Syntax/CubeQueue.h"
 #include "moses/Syntax/PHyperedge.h"
 #include "moses/Syntax/RuleTable.h"
@@ -77,65 +83,113 @@ void Manager<RuleMatcher>::Decode()
   TopologicalSorter sorter;
   sorter.Sort(*m_forest, sortedVertices);
 
-  // Visit each vertex of the input forest in topological order.
+  // Group the vertices into levels: a vertex depends only on vertices of
+  // lower levels, so the vertices of one level can be cube pruned together.
+  boost::unordered_map<const Forest::Vertex *, std::size_t> levelOf;
+  std::vector<std::vector<const Forest::Vertex *> > levels;
   for (std::vector<const Forest::Vertex *>::const_iterator
        p = sortedVertices.begin(); p != sortedVertices.end(); ++p) {
     const Forest::Vertex &vertex = **p;
-
-    // Skip terminal vertices.
-    if (vertex.incoming.empty()) {
-      continue;
+    std::size_t level = 0;
+    for (std::vector<Forest::Hyperedge *>::const_iterator q =
+           vertex.incoming.begin(); q != vertex.incoming.end(); ++q) {
+      const std::vector<Forest::Vertex *> &tail = (*q)->tail;
+      for (std::vector<Forest::Vertex *>::const_iterator r = tail.begin();
+           r != tail.end(); ++r) {
+        level = std::max(level, levelOf[*r] + 1);
+      }
     }
-
-    // Call the rule matchers to generate PHyperedges for this vertex and
-    // convert each one to a SHyperedgeBundle (via the callback).  The
-    // callback prunes the SHyperedgeBundles and keeps the best ones (up
-    // to ruleLimit).
-    callback.ClearContainer();
-    for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
-         q = m_mainRuleMatchers.begin(); q != m_mainRuleMatchers.end(); ++q) {
-      (*q)->EnumerateHyperedges(vertex, callback);
+    levelOf[&vertex] = level;
+    if (level >= levels.size()) {
+      levels.resize(level + 1);
     }
+    levels[level].push_back(&vertex);
+  }
 
-    // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
-    const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
-      callback.GetContainer();
+  CubePruningJobRunner runner;
+  const CubePruningFunction prune =
+    boost::bind(&Manager<RuleMatcher>::CubePrune, this, _1, popLimit,
+                stackLimit);
+
+  // Visit each level of the input forest bottom-up, the vertices of a level
+  // in topological order.
+  for (std::size_t level = 0; level < levels.size(); ++level) {
+    std::vector<CubePruningJob> jobs;
+    jobs.reserve(levels[level].size());
+    for (std::vector<const Forest::Vertex *>::const_iterator
+         p = levels[level].begin(); p != levels[level].end(); ++p) {
+      const Forest::Vertex &vertex = **p;
+
+      // Skip terminal vertices.
+      if (vertex.incoming.empty()) {
+        continue;
+      }
 
-    // Check if any rules were matched.  If not then for each incoming
-    // hyperedge, synthesize a glue rule that is guaranteed to match.
-    if (bundles.Size() == 0) {
-      for (std::vector<Forest::Hyperedge *>::const_iterator p =
-             vertex.incoming.begin(); p != vertex.incoming.end(); ++p) {
-        glueRuleSynthesizer.SynthesizeRule(**p);
+      // Call the rule matchers to generate PHyperedges for this vertex and
+      // convert each one to a SHyperedgeBundle (via the callback).  The
+      // callback prunes the SHyperedgeBundles and keeps the best ones (up
+      // to ruleLimit).
+      callback.ClearContainer();
+      for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
+           q = m_mainRuleMatchers.begin(); q != m_mainRuleMatchers.end(); ++q) {
+        (*q)->EnumerateHyperedges(vertex, callback);
+      }
+
+      // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
+      const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
+        callback.GetContainer();
+
+      // Check if any rules were matched.  If not then for each incoming
+      // hyperedge, synthesize a glue rule that is guaranteed to match.
+      if (bundles.Size() == 0) {
+        for (std::vector<Forest::Hyperedge *>::const_iterator p =
+               vertex.incoming.begin(); p != vertex.incoming.end(); ++p) {
+          glueRuleSynthesizer.SynthesizeRule(**p);
+        }
+        m_glueRuleMatcher->EnumerateHyperedges(vertex, callback);
+        // FIXME This assertion occasionally fails -- why?
+        // assert(bundles.Size() == vertex.incoming.size());
       }
-      m_glueRuleMatcher->EnumerateHyperedges(vertex, callback);
-      // FIXME This assertion occasionally fails -- why?
-      // assert(bundles.Size() == vertex.incoming.size());
-    }
 
-    // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
-    // collect the SHyperedges in a buffer.
-    CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-    std::size_t count = 0;
-    std::vector<SHyperedge*> buffer;
-    while (count < popLimit && !cubeQueue.IsEmpty()) {
-      SHyperedge *hyperedge = cubeQueue.Pop();
-      // FIXME See corresponding code in S2T::Manager
-      // BEGIN{HACK}
-      hyperedge->head->pvertex = &(vertex.pvertex);
-      // END{HACK}
-      buffer.push_back(hyperedge);
-      ++count;
+      // Keep the bundles for cube pruning, the callback is reused.
+      jobs.push_back(CubePruningJob());
+      CubePruningJob &job = jobs.back();
+      job.pvertex = &(vertex.pvertex);
+      job.stack = &m_stackMap[&(vertex.pvertex)];
+      job.bundles.assign(bundles.Begin(), bundles.End());
     }
 
-    // Recombine SVertices and sort into a stack.
-    SVertexStack &stack = m_stackMap[&(vertex.pvertex)];
-    RecombineAndSort(buffer, stack);
+    runner.Run(jobs, prune);
+  }
+}
 
-    // Prune stack.
-    if (stackLimit > 0 && stack.size() > stackLimit) {
-      stack.resize(stackLimit);
-    }
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::CubePrune(CubePruningJob &job,
+                                     std::size_t popLimit,
+                                     std::size_t stackLimit)
+{
+  // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
+  // collect the SHyperedges in a buffer.
+  CubeQueue cubeQueue(job.bundles.begin(), job.bundles.end());
+  std::size_t count = 0;
+  std::vector<SHyperedge*> buffer;
+  while (count < popLimit && !cubeQueue.IsEmpty()) {
+    SHyperedge *hyperedge = cubeQueue.Pop();
+    // FIXME See corresponding code in S2T::Manager
+    // BEGIN{HACK}
+    hyperedge->head->pvertex = job.pvertex;
+    // END{HACK}
+    buffer.push_back(hyperedge);
+    ++count;
+  }
+
+  // Recombine SVertices and sort into a stack.
+  SVertexStack &stack = *job.stack;
+  RecombineAndSort(buffer, stack);
+
+  // Prune stack.
+  if (stackLimit > 0 && stack.size() > stackLimit) {
+    stack.resize(stackLimit);
   }
 }
 
@@ -219,36 +273,20 @@ void Manager<RuleMatcher>::ExtractKBest(
 
   KBestExtractor extractor;
 
-  if (!onlyDistinct) {
-    // Return the k-best list as is, including duplicate translations.
-    extractor.Extract(stack, k, kBestList);
-    return;
-  }
-
   // Determine how many derivations to extract.  If the k-best list is
   // restricted to distinct translations then this limit should be bigger
   // than k.  The k-best factor determines how much bigger the limit should be,
   // with 0 being 'unlimited.'  This actually sets a large-ish limit in case
   // too many translations are identical.
-  const StaticData &staticData = StaticData::Instance();
-  const std::size_t nBestFactor = staticData.GetNBestFactor();
-  std::size_t numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
-
-  // Extract the derivations.
-  KBestExtractor::KBestVec bigList;
-  bigList.reserve(numDerivations);
-  extractor.Extract(stack, numDerivations, bigList);
-
-  // Copy derivations into kBestList, skipping ones with repeated translations.
-  std::set<Phrase> distinct;
-  for (KBestExtractor::KBestVec::const_iterator p = bigList.begin();
-       kBestList.size() < k && p != bigList.end(); ++p) {
-    boost::shared_ptr<KBestExtractor::Derivation> derivation = *p;
-    Phrase translation = KBestExtractor::GetOutputPhrase(*derivation);
-    if (distinct.insert(translation).second) {
-      kBestList.push_back(derivation);
-    }
+  std::size_t numDerivations = k;
+  if (onlyDistinct) {
+    const std::size_t nBestFactor = StaticData::Instance().GetNBestFactor();
+    numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
   }
+
+  // Extract the derivations, skipping ones with repeated translations if
+  // onlyDistinct is set.
+  extractor.Extract(stack, k, kBestList, onlyDistinct, numDerivations);
 }
 
 // TODO Move this function into parent directory (Recombiner class?) and
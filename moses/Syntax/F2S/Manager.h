@@ -7,6 +7,7 @@
 #include <boost/unordered_map.hpp>
 
 #include "moses/InputType.h"
+#include "moses/Syntax/CubePruningJobs.h"
 #include "moses/Syntax/KBestExtractor.h"
 #include "moses/Syntax/Manager.h"
 #include "moses/Syntax/SVertexStack.h"
@@ -51,6 +52,8 @@ private:
 
   void InitializeStacks();
 
+  void CubePrune(CubePruningJob &, std::size_t, std::size_t);
+
   void RecombineAndSort(const std::vector<SHyperedge*> &, SVertexStack &);
 
   boost::shared_ptr<const Forest> m_forest;
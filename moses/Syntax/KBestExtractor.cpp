@@ -3,8 +3,10 @@
 #include "moses/ScoreComponentCollection.h"
 #include "moses/StaticData.h"
 
+#include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <set>
 #include <vector>
 
 namespace Moses
@@ -15,7 +17,8 @@ namespace Syntax
 // Extract the k-best list from the search graph.
 void KBestExtractor::Extract(
   const std::vector<boost::shared_ptr<SVertex> > &topLevelVertices,
-  std::size_t k, KBestVec &kBestList)
+  std::size_t k, KBestVec &kBestList, bool onlyDistinct,
+  std::size_t maxDerivations)
 {
   kBestList.clear();
   if (topLevelVertices.empty()) {
@@ -54,20 +57,39 @@ void KBestExtractor::Extract(
     supremeVertex->recombined.push_back(altEdge);
   }
 
-  // Create the target vertex then lazily fill its k-best list.
+  // Create the target vertex.
   boost::shared_ptr<KVertex> targetVertex = FindOrCreateVertex(*supremeVertex);
-  LazyKthBest(targetVertex, k, k);
 
-  // Copy the k-best list from the target vertex, but drop the top edge from
-  // each derivation.
-  kBestList.reserve(targetVertex->kBestList.size());
-  for (std::vector<boost::weak_ptr<Derivation> >::const_iterator
-       q = targetVertex->kBestList.begin();
-       q != targetVertex->kBestList.end(); ++q) {
-    const boost::shared_ptr<Derivation> d(*q);
-    assert(d);
-    assert(d->subderivations.size() == 1);
-    kBestList.push_back(d->subderivations[0]);
+  if (!onlyDistinct) {
+    // Lazily fill the target vertex's k-best list then copy it, but drop the
+    // top edge from each derivation.
+    LazyKthBest(targetVertex, k, k);
+    kBestList.reserve(targetVertex->kBestList.size());
+    for (std::vector<boost::weak_ptr<Derivation> >::const_iterator
+         q = targetVertex->kBestList.begin();
+         q != targetVertex->kBestList.end(); ++q) {
+      const boost::shared_ptr<Derivation> d(*q);
+      assert(d);
+      assert(d->subderivations.size() == 1);
+      kBestList.push_back(d->subderivations[0]);
+    }
+  } else {
+    // Grow the target vertex's k-best list one derivation at a time and stop
+    // as soon as there are k distinct translations.
+    const std::size_t limit = (maxDerivations == 0) ? k*1000 : maxDerivations;
+    std::set<Phrase> distinct;
+    for (std::size_t i = 0; kBestList.size() < k && i < limit; ++i) {
+      LazyKthBest(targetVertex, i+1, limit);
+      if (targetVertex->kBestList.size() <= i) {
+        break;  // derivations have been exhausted.
+      }
+      const boost::shared_ptr<Derivation> d(targetVertex->kBestList[i]);
+      assert(d);
+      assert(d->subderivations.size() == 1);
+      if (distinct.insert(GetOutputPhrase(*d->subderivations[0])).second) {
+        kBestList.push_back(d->subderivations[0]);
+      }
+    }
   }
 }
 
@@ -160,7 +182,7 @@ KBestExtractor::FindOrCreateVertex(const SVertex &v)
   if (!p.second) {
     return sp;  // KVertex was already in m_vertexMap.
   }
-  sp.reset(new KVertex(v));
+  sp = boost::make_shared<KVertex>(v);
   // Create the 1-best derivation and add it to the vertex's kBestList.
   boost::shared_ptr<KHyperedge> bestEdge(new KHyperedge(*(v.best)));
   bestEdge->head = sp;
@@ -178,7 +200,8 @@ KBestExtractor::FindOrCreateVertex(const SVertex &v)
       bestEdge->tail.push_back(FindOrCreateVertex(*pred));
     }
   }
-  boost::shared_ptr<Derivation> bestDerivation(new Derivation(bestEdge));
+  boost::shared_ptr<Derivation> bestDerivation =
+    boost::make_shared<Derivation>(bestEdge);
 #ifndef NDEBUG
   std::pair<DerivationSet::iterator, bool> q =
 #endif
@@ -213,7 +236,8 @@ void KBestExtractor::GetCandidates(boost::shared_ptr<KVertex> v, std::size_t k)
         bestEdge->tail.push_back(FindOrCreateVertex(*pred));
       }
     }
-    boost::shared_ptr<Derivation> derivation(new Derivation(bestEdge));
+    boost::shared_ptr<Derivation> derivation =
+      boost::make_shared<Derivation>(bestEdge);
 #ifndef NDEBUG
     std::pair<DerivationSet::iterator, bool> q =
 #endif
@@ -269,7 +293,7 @@ void KBestExtractor::LazyNext(KVertex &v, const Derivation &d,
       continue;
     }
     // Create the neighbour.
-    boost::shared_ptr<Derivation> next(new Derivation(d, i));
+    boost::shared_ptr<Derivation> next = boost::make_shared<Derivation>(d, i);
     // Check if it has been created before.
     std::pair<DerivationSet::iterator, bool> p = m_derivations.insert(next);
     if (p.second) {
@@ -75,9 +75,12 @@ public:
   typedef std::vector<boost::shared_ptr<Derivation> > KBestVec;
 
   // Extract the k-best list from the search hypergraph given the full, sorted
-  // list of top-level SVertices.
+  // list of top-level SVertices.  If onlyDistinct is set then derivations with
+  // a repeated target string are skipped, visiting at most maxDerivations
+  // derivations (0 means no limit) to find k distinct ones.
   void Extract(const std::vector<boost::shared_ptr<SVertex> > &, std::size_t,
-               KBestVec &);
+               KBestVec &, bool onlyDistinct = false,
+               std::size_t maxDerivations = 0);
 
   static Phrase GetOutputPhrase(const Derivation &);
   static TreePointer GetOutputTree(const Derivation &);
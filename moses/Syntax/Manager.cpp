@@ -4,6 +4,7 @@
 
 #include "moses/OutputCollector.h"
 #include "moses/StaticData.h"
+#include "moses/Timer.h"
 
 #include "PVertex.h"
 
@@ -53,8 +54,12 @@ void Manager::OutputNBest(OutputCollector *collector) const
     long translationId = m_source.GetTranslationId();
 
     KBestExtractor::KBestVec nBestList;
+    Timer nBestTime;
+    nBestTime.start();
     ExtractKBest(staticData.GetNBestSize(), nBestList,
                  staticData.GetDistinctNBest());
+    VERBOSE(1, "Line " << translationId << ": Extracting " << nBestList.size()
+            << "-best list took " << nBestTime << " seconds" << std::endl);
     OutputNBestList(collector, nBestList, translationId);
   }
 }
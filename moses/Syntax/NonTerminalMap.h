@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/unordered_map.hpp>
@@ -20,6 +21,8 @@ namespace Syntax
 // the main differences being that:
 //   1. Find() is implemented using vector indexing to make it fast.
 //   2. Once a value has been inserted it can be modified but can't be removed.
+// The index vector is only allocated by the first Insert(): charts hold one
+// map per span and most of them stay empty.
 template<typename T>
 class NonTerminalMap
 {
@@ -31,8 +34,7 @@ public:
   typedef typename Map::iterator Iterator;
   typedef typename Map::const_iterator ConstIterator;
 
-  NonTerminalMap()
-    : m_vec(FactorCollection::Instance().GetNumNonTerminals(), NULL) {}
+  NonTerminalMap() {}
 
   Iterator Begin() {
     return m_map.begin();
@@ -59,7 +61,8 @@ public:
   std::pair<Iterator, bool> Insert(const Word &, const T &);
 
   T *Find(const Word &w) const {
-    return m_vec[w[0]->GetId()];
+    const std::size_t i = w[0]->GetId();
+    return i < m_vec.size() ? m_vec[i] : NULL;
   }
 
 private:
@@ -76,6 +79,11 @@ std::pair<typename NonTerminalMap<T>::Iterator, bool> NonTerminalMap<T>::Insert(
   if (result.second) {
     T *p = &(result.first->second);
     std::size_t i = key[0]->GetId();
+    if (i >= m_vec.size()) {
+      m_vec.resize(std::max(i+1,
+                            FactorCollection::Instance().GetNumNonTerminals()),
+                   NULL);
+    }
     m_vec[i] = p;
   }
   return result;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 #include "moses/DecodeGraph.h"
@@ -165,6 +168,7 @@ void Manager<Parser>::Decode()
   const std::size_t popLimit = staticData.GetCubePruningPopLimit();
   const std::size_t ruleLimit = staticData.GetRuleLimit();
   const std::size_t stackLimit = staticData.GetMaxHypoStackSize();
+  const std::size_t maxCategories = staticData.GetS2TMaxCellCategories();
 
   // Initialise the PChart and SChart.
   InitializeCharts();
@@ -203,25 +207,72 @@ void Manager<Parser>::Decode()
       // Collect the SHyperedges into buffers, one for each category.
       CubeQueue cubeQueue(bundles.Begin(), bundles.End());
       std::size_t count = 0;
+      const std::size_t cellPopLimit = TightenLimit(popLimit);
       typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
               SymbolHasher, SymbolEqualityPred > BufferMap;
       BufferMap buffers;
-      while (count < popLimit && !cubeQueue.IsEmpty()) {
+      while (count < cellPopLimit && !cubeQueue.IsEmpty()) {
         SHyperedge *hyperedge = cubeQueue.Pop();
-        // BEGIN{HACK}
-        // The way things currently work, the LHS of each hyperedge is not
-        // determined until just before the point of its creation, when a
-        // target phrase is selected from the list of possible phrases (which
-        // happens during cube pruning).  The cube pruning code doesn't (and
-        // shouldn't) know about the contents of PChart and so creation of
-        // the PVertex is deferred until this point.
         const Word &lhs = hyperedge->label.translation->GetTargetLHS();
-        hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
-        // END{HACK}
         buffers[lhs].push_back(hyperedge);
         ++count;
       }
 
+      // Drop the categories whose best hyperedge scores below the best
+      // hyperedges of maxCategories other categories (ties are kept).  Each
+      // category that survives becomes a PVertex that the parsers extend in
+      // every larger span, so this bounds the growth of the parse chart.
+      if (maxCategories > 0 && buffers.size() > maxCategories) {
+        std::vector<float> bestScores;
+        bestScores.reserve(buffers.size());
+        for (BufferMap::const_iterator p = buffers.begin();
+             p != buffers.end(); ++p) {
+          float best = -std::numeric_limits<float>::infinity();
+          for (std::vector<SHyperedge*>::const_iterator q = p->second.begin();
+               q != p->second.end(); ++q) {
+            best = std::max(best, (*q)->label.score);
+          }
+          bestScores.push_back(best);
+        }
+        std::vector<float> ranked(bestScores);
+        std::nth_element(ranked.begin(), ranked.begin() + maxCategories - 1,
+                         ranked.end(), std::greater<float>());
+        const float threshold = ranked[maxCategories - 1];
+        // erasing doesn't reorder the remaining elements, so bestScores
+        // stays in step with the iteration
+        std::size_t i = 0;
+        BufferMap::iterator p = buffers.begin();
+        while (p != buffers.end()) {
+          if (bestScores[i++] >= threshold) {
+            ++p;
+            continue;
+          }
+          // The head vertices own their (sole) incoming hyperedges.
+          for (std::vector<SHyperedge*>::const_iterator q = p->second.begin();
+               q != p->second.end(); ++q) {
+            delete (*q)->head;
+          }
+          p = buffers.erase(p);
+        }
+      }
+
+      // BEGIN{HACK}
+      // The way things currently work, the LHS of each hyperedge is not
+      // determined until just before the point of its creation, when a
+      // target phrase is selected from the list of possible phrases (which
+      // happens during cube pruning).  The cube pruning code doesn't (and
+      // shouldn't) know about the contents of PChart and so creation of
+      // the PVertex is deferred until this point.
+      for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
+           ++p) {
+        const PVertex &pvertex = m_pchart.AddVertex(PVertex(range, p->first));
+        for (std::vector<SHyperedge*>::const_iterator q = p->second.begin();
+             q != p->second.end(); ++q) {
+          (*q)->head->pvertex = &pvertex;
+        }
+      }
+      // END{HACK}
+
       // Recombine SVertices and sort into stacks.
       for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
            ++p) {
@@ -235,12 +286,13 @@ void Manager<Parser>::Decode()
       }
 
       // Prune stacks.
-      if (stackLimit > 0) {
+      const std::size_t cellStackLimit = TightenLimit(stackLimit);
+      if (cellStackLimit > 0) {
         for (SChart::Cell::NMap::Iterator p = scell.nonTerminalStacks.Begin();
              p != scell.nonTerminalStacks.End(); ++p) {
           SVertexStack &stack = p->second;
-          if (stack.size() > stackLimit) {
-            stack.resize(stackLimit);
+          if (stack.size() > cellStackLimit) {
+            stack.resize(cellStackLimit);
           }
         }
       }
@@ -290,36 +342,20 @@ void Manager<Parser>::ExtractKBest(
 
   KBestExtractor extractor;
 
-  if (!onlyDistinct) {
-    // Return the k-best list as is, including duplicate translations.
-    extractor.Extract(stack, k, kBestList);
-    return;
-  }
-
   // Determine how many derivations to extract.  If the k-best list is
   // restricted to distinct translations then this limit should be bigger
   // than k.  The k-best factor determines how much bigger the limit should be,
   // with 0 being 'unlimited.'  This actually sets a large-ish limit in case
   // too many translations are identical.
-  const StaticData &staticData = StaticData::Instance();
-  const std::size_t nBestFactor = staticData.GetNBestFactor();
-  std::size_t numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
-
-  // Extract the derivations.
-  KBestExtractor::KBestVec bigList;
-  bigList.reserve(numDerivations);
-  extractor.Extract(stack, numDerivations, bigList);
-
-  // Copy derivations into kBestList, skipping ones with repeated translations.
-  std::set<Phrase> distinct;
-  for (KBestExtractor::KBestVec::const_iterator p = bigList.begin();
-       kBestList.size() < k && p != bigList.end(); ++p) {
-    boost::shared_ptr<KBestExtractor::Derivation> derivation = *p;
-    Phrase translation = KBestExtractor::GetOutputPhrase(*derivation);
-    if (distinct.insert(translation).second) {
-      kBestList.push_back(derivation);
-    }
+  std::size_t numDerivations = k;
+  if (onlyDistinct) {
+    const std::size_t nBestFactor = StaticData::Instance().GetNBestFactor();
+    numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
   }
+
+  // Extract the derivations, skipping ones with repeated translations if
+  // onlyDistinct is set.
+  extractor.Extract(stack, k, kBestList, onlyDistinct, numDerivations);
 }
 
 template<typename Parser>
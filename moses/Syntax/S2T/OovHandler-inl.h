@@ -38,6 +38,8 @@ boost::shared_ptr<RuleTrie> OovHandler<RuleTrie>::SynthesizeRuleTrie(
     }
   }
 
+  SortAndPrune(*trie, 0);
+
   return trie;
 }
 
@@ -55,24 +55,22 @@ void RecursiveCYKPlusParser<Callback>::GetNonTerminalExtensions(
   std::size_t maxEnd)
 {
   // Non-terminal labels in node's outgoing edge set.
-  const RuleTrie::Node::SymbolMap &nonTermMap = node.GetNonTerminalMap();
+  const RuleTrie::Node::NonTerminalEdges &nonTermEdges =
+    node.GetNonTerminalEdges();
 
   // Compressed matrix from PChart.
   const PChart::CompressedMatrix &matrix =
     Base::m_chart.GetCompressedMatrix(start);
 
   // Loop over possible expansions of the rule.
-  RuleTrie::Node::SymbolMap::const_iterator p;
-  RuleTrie::Node::SymbolMap::const_iterator p_end = nonTermMap.end();
-  for (p = nonTermMap.begin(); p != p_end; ++p) {
-    const Word &nonTerm = p->first;
-    const std::vector<PChart::CompressedItem> &items =
-      matrix[nonTerm[0]->GetId()];
+  RuleTrie::Node::NonTerminalEdges::const_iterator p;
+  RuleTrie::Node::NonTerminalEdges::const_iterator p_end = nonTermEdges.end();
+  for (p = nonTermEdges.begin(); p != p_end; ++p) {
+    const std::vector<PChart::CompressedItem> &items = matrix[p->label];
     for (std::vector<PChart::CompressedItem>::const_iterator q = items.begin();
          q != items.end(); ++q) {
       if (q->end >= minEnd && q->end <= maxEnd) {
-        const RuleTrie::Node &child = p->second;
-        AddAndExtend(child, q->end, *(q->vertex));
+        AddAndExtend(*p->child, q->end, *(q->vertex));
       }
     }
   }
@@ -93,26 +91,25 @@ void RecursiveCYKPlusParser<Callback>::GetTerminalExtension(
     return;
   }
 
-  const RuleTrie::Node::SymbolMap &terminals = node.GetTerminalMap();
+  const RuleTrie::Node::TerminalEdges &terminals = node.GetTerminalEdges();
 
   for (PChart::Cell::TMap::const_iterator p = vertexMap.begin();
        p != vertexMap.end(); ++p) {
-    const Word &terminal = p->first;
+    const Factor *terminal = p->first[0];
     const PVertex &vertex = p->second;
 
-    // if node has small number of terminal edges, test word equality for each.
+    // if node has small number of terminal edges, test each, else do a binary
+    // search (the edges are sorted by label).
     if (terminals.size() < 5) {
-      for (RuleTrie::Node::SymbolMap::const_iterator iter = terminals.begin();
-           iter != terminals.end(); ++iter) {
-        const Word &word = iter->first;
-        if (word == terminal) {
-          const RuleTrie::Node *child = & iter->second;
-          AddAndExtend(*child, end, vertex);
+      for (RuleTrie::Node::TerminalEdges::const_iterator iter =
+             terminals.begin(); iter != terminals.end(); ++iter) {
+        if (iter->label == terminal) {
+          AddAndExtend(*iter->child, end, vertex);
           break;
         }
       }
-    } else { // else, do hash lookup
-      const RuleTrie::Node *child = node.GetChild(terminal);
+    } else {
+      const RuleTrie::Node *child = node.FindTerminalEdge(terminal);
       if (child != NULL) {
         AddAndExtend(*child, end, vertex);
       }
@@ -141,12 +138,12 @@ void RecursiveCYKPlusParser<Callback>::AddAndExtend(
   // Get all further extensions of rule (until reaching end of sentence or
   // max-chart-span).
   if (end < m_maxEnd) {
-    if (!node.GetTerminalMap().empty()) {
+    if (!node.GetTerminalEdges().empty()) {
       for (std::size_t newEndPos = end+1; newEndPos <= m_maxEnd; newEndPos++) {
         GetTerminalExtension(node, end+1, newEndPos);
       }
     }
-    if (!node.GetNonTerminalMap().empty()) {
+    if (!node.GetNonTerminalEdges().empty()) {
       GetNonTerminalExtensions(node, end+1, end+1, m_maxEnd);
     }
   }
@@ -1,5 +1,6 @@
 #include "RuleTrieCYKPlus.h"
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -52,6 +53,63 @@ void RuleTrieCYKPlus::Node::Sort(std::size_t tableLimit)
   m_targetPhraseCollection.Sort(true, tableLimit);
 }
 
+namespace
+{
+
+bool TerminalEdgeOrder(const RuleTrieCYKPlus::Node::TerminalEdge &a,
+                       const RuleTrieCYKPlus::Node::TerminalEdge &b)
+{
+  return a.label < b.label;
+}
+
+bool NonTerminalEdgeOrder(const RuleTrieCYKPlus::Node::NonTerminalEdge &a,
+                          const RuleTrieCYKPlus::Node::NonTerminalEdge &b)
+{
+  return a.label < b.label;
+}
+
+}  // namespace
+
+void RuleTrieCYKPlus::Node::Freeze()
+{
+  // The maps are node-based and not modified after this, so the child
+  // pointers stay valid.
+  m_terminalEdges.clear();
+  m_terminalEdges.reserve(m_sourceTermMap.size());
+  for (SymbolMap::iterator p = m_sourceTermMap.begin();
+       p != m_sourceTermMap.end(); ++p) {
+    p->second.Freeze();
+    TerminalEdge edge;
+    edge.label = p->first[0];
+    edge.child = &p->second;
+    m_terminalEdges.push_back(edge);
+  }
+  std::sort(m_terminalEdges.begin(), m_terminalEdges.end(), TerminalEdgeOrder);
+
+  m_nonTermEdges.clear();
+  m_nonTermEdges.reserve(m_nonTermMap.size());
+  for (SymbolMap::iterator p = m_nonTermMap.begin();
+       p != m_nonTermMap.end(); ++p) {
+    p->second.Freeze();
+    NonTerminalEdge edge;
+    edge.label = p->first[0]->GetId();
+    edge.child = &p->second;
+    m_nonTermEdges.push_back(edge);
+  }
+  std::sort(m_nonTermEdges.begin(), m_nonTermEdges.end(),
+            NonTerminalEdgeOrder);
+}
+
+const RuleTrieCYKPlus::Node *RuleTrieCYKPlus::Node::FindTerminalEdge(
+  const Factor *label) const
+{
+  TerminalEdge key;
+  key.label = label;
+  TerminalEdges::const_iterator p = std::lower_bound(
+    m_terminalEdges.begin(), m_terminalEdges.end(), key, TerminalEdgeOrder);
+  return (p == m_terminalEdges.end() || p->label != label) ? NULL : p->child;
+}
+
 RuleTrieCYKPlus::Node *RuleTrieCYKPlus::Node::GetOrCreateChild(
   const Word &sourceTerm)
 {
@@ -129,6 +187,7 @@ void RuleTrieCYKPlus::SortAndPrune(std::size_t tableLimit)
   if (tableLimit) {
     m_root.Sort(tableLimit);
   }
+  m_root.Freeze();
 }
 
 bool RuleTrieCYKPlus::HasPreterminalRule(const Word &w) const
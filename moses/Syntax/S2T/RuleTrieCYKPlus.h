@@ -33,6 +33,23 @@ public:
     typedef boost::unordered_map<Word, Node, SymbolHasher,
             SymbolEqualityPred> SymbolMap;
 
+    // Flat copies of the child maps for the parser, built by Freeze() once
+    // the trie is complete.  Terminal edges are sorted by the label's factor
+    // and non-terminal edges by the factor's id (the index into the PChart's
+    // compressed matrix).
+    struct TerminalEdge {
+      const Factor *label;
+      const Node *child;
+    };
+
+    struct NonTerminalEdge {
+      std::size_t label;
+      const Node *child;
+    };
+
+    typedef std::vector<TerminalEdge> TerminalEdges;
+    typedef std::vector<NonTerminalEdge> NonTerminalEdges;
+
     bool IsLeaf() const {
       return m_sourceTermMap.empty() && m_nonTermMap.empty();
     }
@@ -43,6 +60,7 @@ public:
 
     void Prune(std::size_t tableLimit);
     void Sort(std::size_t tableLimit);
+    void Freeze();
 
     Node *GetOrCreateChild(const Word &sourceTerm);
     Node *GetOrCreateNonTerminalChild(const Word &targetNonTerm);
@@ -66,9 +84,23 @@ public:
       return m_nonTermMap;
     }
 
+    const TerminalEdges &GetTerminalEdges() const {
+      return m_terminalEdges;
+    }
+
+    const NonTerminalEdges &GetNonTerminalEdges() const {
+      return m_nonTermEdges;
+    }
+
+    // Returns the child reached by terminal edge label or NULL.  Only valid
+    // after Freeze().
+    const Node *FindTerminalEdge(const Factor *label) const;
+
   private:
     SymbolMap m_sourceTermMap;
     SymbolMap m_nonTermMap;
+    TerminalEdges m_terminalEdges;
+    NonTerminalEdges m_nonTermEdges;
     TargetPhraseCollection m_targetPhraseCollection;
   };
 
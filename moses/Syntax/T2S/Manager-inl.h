@@ -1,8 +1,13 @@
 #pragma once
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
 #include "moses/DecodeGraph.h"
 #include "moses/StaticData.h"
 #include "moses/Syntax/BoundedPriorityContainer.h"
+#include "moses/Syntax/CubePruningJobs.h"
 #include "moses/Syntax/CubeQueue.h"
 #include "moses/Syntax/F2S/DerivationWriter.h"
 #include "moses/Syntax/F2S/RuleMatcherCallback.h"
@@ -112,62 +117,106 @@ void Manager<RuleMatcher>::Decode()
   // Create a glue rule synthesizer.
   GlueRuleSynthesizer glueRuleSynthesizer(*m_glueRuleTrie);
 
-  // Visit each node of the input tree in post-order.
-  for (std::vector<InputTree::Node>::const_iterator p =
-         m_inputTree.nodes.begin(); p != m_inputTree.nodes.end(); ++p) {
-
-    const InputTree::Node &node = *p;
-
-    // Skip terminal nodes.
-    if (node.children.empty()) {
-      continue;
+  // Group the nodes into levels by height: a node depends only on nodes of
+  // lower levels, so the nodes of one level can be cube pruned together.
+  const std::vector<InputTree::Node> &nodes = m_inputTree.nodes;
+  std::vector<std::size_t> levelOf(nodes.size(), 0);
+  std::vector<std::vector<const InputTree::Node *> > levels;
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    const InputTree::Node &node = nodes[i];
+    std::size_t level = 0;
+    for (std::vector<InputTree::Node*>::const_iterator q =
+           node.children.begin(); q != node.children.end(); ++q) {
+      level = std::max(level, levelOf[*q - &nodes[0]] + 1);
     }
-
-    // Call the rule matchers to generate PHyperedges for this node and
-    // convert each one to a SHyperedgeBundle (via the callback).  The
-    // callback prunes the SHyperedgeBundles and keeps the best ones (up
-    // to ruleLimit).
-    callback.ClearContainer();
-    for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
-         q = m_ruleMatchers.begin(); q != m_ruleMatchers.end(); ++q) {
-      (*q)->EnumerateHyperedges(node, callback);
+    levelOf[i] = level;
+    if (level >= levels.size()) {
+      levels.resize(level + 1);
     }
+    levels[level].push_back(&node);
+  }
 
-    // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
-    const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
-      callback.GetContainer();
-
-    // Check if any rules were matched.  If not then synthesize a glue rule
-    // that is guaranteed to match.
-    if (bundles.Size() == 0) {
-      glueRuleSynthesizer.SynthesizeRule(node);
-      m_glueRuleMatcher->EnumerateHyperedges(node, callback);
-      assert(bundles.Size() == 1);
+  CubePruningJobRunner runner;
+  const CubePruningFunction prune =
+    boost::bind(&Manager<RuleMatcher>::CubePrune, this, _1, popLimit,
+                stackLimit);
+
+  // Visit each level of the input tree bottom-up, the nodes of a level in
+  // post-order.
+  for (std::size_t level = 0; level < levels.size(); ++level) {
+    std::vector<CubePruningJob> jobs;
+    jobs.reserve(levels[level].size());
+    for (std::vector<const InputTree::Node *>::const_iterator p =
+           levels[level].begin(); p != levels[level].end(); ++p) {
+
+      const InputTree::Node &node = **p;
+
+      // Skip terminal nodes.
+      if (node.children.empty()) {
+        continue;
+      }
+
+      // Call the rule matchers to generate PHyperedges for this node and
+      // convert each one to a SHyperedgeBundle (via the callback).  The
+      // callback prunes the SHyperedgeBundles and keeps the best ones (up
+      // to ruleLimit).
+      callback.ClearContainer();
+      for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
+           q = m_ruleMatchers.begin(); q != m_ruleMatchers.end(); ++q) {
+        (*q)->EnumerateHyperedges(node, callback);
+      }
+
+      // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
+      const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
+        callback.GetContainer();
+
+      // Check if any rules were matched.  If not then synthesize a glue rule
+      // that is guaranteed to match.
+      if (bundles.Size() == 0) {
+        glueRuleSynthesizer.SynthesizeRule(node);
+        m_glueRuleMatcher->EnumerateHyperedges(node, callback);
+        assert(bundles.Size() == 1);
+      }
+
+      // Keep the bundles for cube pruning, the callback is reused.
+      jobs.push_back(CubePruningJob());
+      CubePruningJob &job = jobs.back();
+      job.pvertex = &(node.pvertex);
+      job.stack = &m_stackMap[&(node.pvertex)];
+      job.bundles.assign(bundles.Begin(), bundles.End());
     }
 
-    // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
-    // collect the SHyperedges in a buffer.
-    CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-    std::size_t count = 0;
-    std::vector<SHyperedge*> buffer;
-    while (count < popLimit && !cubeQueue.IsEmpty()) {
-      SHyperedge *hyperedge = cubeQueue.Pop();
-      // FIXME See corresponding code in S2T::Manager
-      // BEGIN{HACK}
-      hyperedge->head->pvertex = &(node.pvertex);
-      // END{HACK}
-      buffer.push_back(hyperedge);
-      ++count;
-    }
+    runner.Run(jobs, prune);
+  }
+}
 
-    // Recombine SVertices and sort into a stack.
-    SVertexStack &stack = m_stackMap[&(node.pvertex)];
-    RecombineAndSort(buffer, stack);
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::CubePrune(CubePruningJob &job,
+                                     std::size_t popLimit,
+                                     std::size_t stackLimit)
+{
+  // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
+  // collect the SHyperedges in a buffer.
+  CubeQueue cubeQueue(job.bundles.begin(), job.bundles.end());
+  std::size_t count = 0;
+  std::vector<SHyperedge*> buffer;
+  while (count < popLimit && !cubeQueue.IsEmpty()) {
+    SHyperedge *hyperedge = cubeQueue.Pop();
+    // FIXME See corresponding code in S2T::Manager
+    // BEGIN{HACK}
+    hyperedge->head->pvertex = job.pvertex;
+    // END{HACK}
+    buffer.push_back(hyperedge);
+    ++count;
+  }
 
-    // Prune stack.
-    if (stackLimit > 0 && stack.size() > stackLimit) {
-      stack.resize(stackLimit);
-    }
+  // Recombine SVertices and sort into a stack.
+  SVertexStack &stack = *job.stack;
+  RecombineAndSort(buffer, stack);
+
+  // Prune stack.
+  if (stackLimit > 0 && stack.size() > stackLimit) {
+    stack.resize(stackLimit);
   }
 }
 
@@ -202,36 +251,20 @@ void Manager<RuleMatcher>::ExtractKBest(
 
   KBestExtractor extractor;
 
-  if (!onlyDistinct) {
-    // Return the k-best list as is, including duplicate translations.
-    extractor.Extract(stack, k, kBestList);
-    return;
-  }
-
   // Determine how many derivations to extract.  If the k-best list is
   // restricted to distinct translations then this limit should be bigger
   // than k.  The k-best factor determines how much bigger the limit should be,
   // with 0 being 'unlimited.'  This actually sets a large-ish limit in case
   // too many translations are identical.
-  const StaticData &staticData = StaticData::Instance();
-  const std::size_t nBestFactor = staticData.GetNBestFactor();
-  std::size_t numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
-
-  // Extract the derivations.
-  KBestExtractor::KBestVec bigList;
-  bigList.reserve(numDerivations);
-  extractor.Extract(stack, numDerivations, bigList);
-
-  // Copy derivations into kBestList, skipping ones with repeated translations.
-  std::set<Phrase> distinct;
-  for (KBestExtractor::KBestVec::const_iterator p = bigList.begin();
-       kBestList.size() < k && p != bigList.end(); ++p) {
-    boost::shared_ptr<KBestExtractor::Derivation> derivation = *p;
-    Phrase translation = KBestExtractor::GetOutputPhrase(*derivation);
-    if (distinct.insert(translation).second) {
-      kBestList.push_back(derivation);
-    }
+  std::size_t numDerivations = k;
+  if (onlyDistinct) {
+    const std::size_t nBestFactor = StaticData::Instance().GetNBestFactor();
+    numDerivations = (nBestFactor == 0) ? k*1000 : k*nBestFactor;
   }
+
+  // Extract the derivations, skipping ones with repeated translations if
+  // onlyDistinct is set.
+  extractor.Extract(stack, k, kBestList, onlyDistinct, numDerivations);
 }
 
 // TODO Move this function into parent directory (Recombiner class?) and
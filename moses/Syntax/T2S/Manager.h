@@ -6,6 +6,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 
+#include "moses/Syntax/CubePruningJobs.h"
 #include "moses/Syntax/F2S/PVertexToStackMap.h"
 #include "moses/Syntax/KBestExtractor.h"
 #include "moses/Syntax/Manager.h"
@@ -49,6 +50,8 @@ private:
 
   void InitializeStacks();
 
+  void CubePrune(CubePruningJob &, std::size_t, std::size_t);
+
   void RecombineAndSort(const std::vector<SHyperedge*> &, SVertexStack &);
 
   InputTree m_inputTree;
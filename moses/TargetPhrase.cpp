@@ -24,21 +24,54 @@
 #include "util/exception.hh"
 #include "util/tokenize_piece.hh"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "TargetPhrase.h"
 #include "GenerationDictionary.h"
 #include "LM/Base.h"
 #include "StaticData.h"
 #include "ScoreComponentCollection.h"
 #include "Util.h"
+#include "moses/PP/Factory.h"
 #include "AlignmentInfoCollection.h"
 #include "InputPath.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
+#include "DecodeProfile.h"
 #include <boost/foreach.hpp>
 
 using namespace std;
 
 namespace Moses
 {
+
+namespace
+{
+#ifdef WITH_THREADS
+boost::mutex s_decodeMutex;
+#endif
+}
+
+TargetPhrase::SideData *TargetPhrase::CopySide(const SideData &side)
+{
+  SideData *copy = new SideData;
+  copy->data = side.data;
+  copy->cachedScores = side.cachedScores;
+  // a property decoded on first access may be being decoded right now,
+  // so the copy decodes it again itself
+  copy->properties.resize(side.properties.size());
+  for (size_t i = 0; i < side.properties.size(); ++i) {
+    const PropertyEntry &entry = side.properties[i];
+    PropertyEntry &target = copy->properties[i];
+    target.key = entry.key;
+    target.onLoad = entry.onLoad;
+    target.value = entry.value;
+    if (entry.onLoad) target.decoded = entry.decoded;
+  }
+  return copy;
+}
+
 TargetPhrase::TargetPhrase( std::string out_string, const PhraseDictionary *pt)
   :Phrase(0)
   , m_fullScore(0.0)
@@ -48,6 +81,7 @@ TargetPhrase::TargetPhrase( std::string out_string, const PhraseDictionary *pt)
   , m_lhsTarget(NULL)
   , m_ruleSource(NULL)
   , m_container(pt)
+  , m_side(NULL)
 {
 
   //ACAT
@@ -67,6 +101,7 @@ TargetPhrase::TargetPhrase(const PhraseDictionary *pt)
   , m_lhsTarget(NULL)
   , m_ruleSource(NULL)
   , m_container(pt)
+  , m_side(NULL)
 {
 }
 
@@ -79,19 +114,19 @@ TargetPhrase::TargetPhrase(const Phrase &phrase, const PhraseDictionary *pt)
   , m_lhsTarget(NULL)
   , m_ruleSource(NULL)
   , m_container(pt)
+  , m_side(NULL)
 {
 }
 
 TargetPhrase::TargetPhrase(const TargetPhrase &copy)
   : Phrase(copy)
-  , m_cached_scores(copy.m_cached_scores)
   , m_fullScore(copy.m_fullScore)
   , m_futureScore(copy.m_futureScore)
   , m_scoreBreakdown(copy.m_scoreBreakdown)
   , m_alignTerm(copy.m_alignTerm)
   , m_alignNonTerm(copy.m_alignNonTerm)
-  , m_properties(copy.m_properties)
   , m_container(copy.m_container)
+  , m_side(copy.m_side ? CopySide(*copy.m_side) : NULL)
 {
   if (copy.m_lhsTarget) {
     m_lhsTarget = new Word(*copy.m_lhsTarget);
@@ -106,12 +141,24 @@ TargetPhrase::TargetPhrase(const TargetPhrase &copy)
   }
 }
 
+TargetPhrase &TargetPhrase::operator=(const TargetPhrase &copy)
+{
+  if (this != &copy) {
+    TargetPhrase tmp(copy);
+    swap(*this, tmp);
+    std::swap(m_ruleSource, tmp.m_ruleSource);
+    m_container = copy.m_container;
+  }
+  return *this;
+}
+
 TargetPhrase::~TargetPhrase()
 {
   //cerr << "m_lhsTarget=" << m_lhsTarget << endl;
 
   delete m_lhsTarget;
   delete m_ruleSource;
+  delete m_side;
 }
 
 #ifdef HAVE_PROTOBUF
@@ -137,6 +184,7 @@ void TargetPhrase::EvaluateInIsolation(const Phrase &source, const std::vector<F
     for (size_t i = 0; i < ffs.size(); ++i) {
       const FeatureFunction &ff = *ffs[i];
       if (! staticData.IsFeatureFunctionIgnored( ff )) {
+        DecodeProfile::Scope scope(ff, DecodeProfile::InIsolation);
         ff.EvaluateInIsolation(source, *this, m_scoreBreakdown, futureScoreBreakdown);
       }
     }
@@ -155,6 +203,7 @@ void TargetPhrase::EvaluateWithSourceContext(const InputType &input, const Input
   for (size_t i = 0; i < ffs.size(); ++i) {
     const FeatureFunction &ff = *ffs[i];
     if (! staticData.IsFeatureFunctionIgnored( ff )) {
+      DecodeProfile::Scope scope(ff, DecodeProfile::WithSourceContext);
       ff.EvaluateWithSourceContext(input, inputPath, *this, NULL, m_scoreBreakdown, &futureScoreBreakdown);
     }
   }
@@ -253,9 +302,10 @@ Merge(const TargetPhrase &copy, const std::vector<FactorType>& factorVec)
   m_fullScore += copy.m_fullScore;
   typedef ScoreCache_t::iterator iter;
   typedef ScoreCache_t::value_type item;
-  BOOST_FOREACH(item const& s, copy.m_cached_scores)
+  if (!copy.m_side) return;
+  BOOST_FOREACH(item const& s, copy.m_side->cachedScores)
     {
-      pair<iter,bool> foo = m_cached_scores.insert(s);
+      pair<iter,bool> foo = GetSide().cachedScores.insert(s);
       if (foo.second == false) 
 	foo.first->second = mergescores(foo.first->second, s.second);
     }
@@ -265,22 +315,24 @@ TargetPhrase::ScoreCache_t const&
 TargetPhrase::
 GetExtraScores() const
 {
-  return m_cached_scores;
+  static const ScoreCache_t empty;
+  return m_side ? m_side->cachedScores : empty;
 }
 
 Scores const*
 TargetPhrase::
 GetExtraScores(FeatureFunction const* ff) const
 {
-  ScoreCache_t::const_iterator m = m_cached_scores.find(ff);
-  return m != m_cached_scores.end() ? m->second.get() : NULL;
+  if (!m_side) return NULL;
+  ScoreCache_t::const_iterator m = m_side->cachedScores.find(ff);
+  return m != m_side->cachedScores.end() ? m->second.get() : NULL;
 }
 
 void
 TargetPhrase::
 SetExtraScores(FeatureFunction const* ff, 
 	       boost::shared_ptr<Scores> const& s) 
-{ m_cached_scores[ff] = s; }
+{ GetSide().cachedScores[ff] = s; }
 
 
 void TargetPhrase::SetProperties(const StringPiece &str)
@@ -309,18 +361,50 @@ void TargetPhrase::SetProperties(const StringPiece &str)
 
 void TargetPhrase::SetProperty(const std::string &key, const std::string &value)
 {
-  const StaticData &staticData = StaticData::Instance();
-  const PhrasePropertyFactory& phrasePropertyFactory = staticData.GetPhrasePropertyFactory();
-  m_properties[key] = phrasePropertyFactory.ProduceProperty(key,value);
+  PropertyEntry entry;
+  entry.key = PhrasePropertyFactory::GetKeyId(key);
+  entry.onLoad = PhrasePropertyFactory::IsDecodedOnLoad(entry.key);
+  if (entry.onLoad) {
+    const PhrasePropertyFactory& phrasePropertyFactory = StaticData::Instance().GetPhrasePropertyFactory();
+    entry.decoded = phrasePropertyFactory.ProduceProperty(key, value);
+  } else {
+    entry.value = value;
+  }
+
+  std::vector<PropertyEntry> &properties = GetSide().properties;
+  for (size_t i = 0; i < properties.size(); ++i) {
+    if (properties[i].key == entry.key) {
+      properties[i] = entry;
+      return;
+    }
+  }
+  properties.push_back(entry);
 }
 
 const PhraseProperty *TargetPhrase::GetProperty(const std::string &key) const
 {
-  std::map<std::string, boost::shared_ptr<PhraseProperty> >::const_iterator iter;
-  iter = m_properties.find(key);
-  if (iter != m_properties.end()) {
-    const boost::shared_ptr<PhraseProperty> &pp = iter->second;
-    return pp.get();
+  if (!m_side) return NULL;
+  return GetProperty(PhrasePropertyFactory::GetKeyId(key));
+}
+
+const PhraseProperty *TargetPhrase::GetProperty(size_t keyId) const
+{
+  if (!m_side) return NULL;
+  const std::vector<PropertyEntry> &properties = m_side->properties;
+  for (size_t i = 0; i < properties.size(); ++i) {
+    const PropertyEntry &entry = properties[i];
+    if (entry.key != keyId) continue;
+    if (entry.onLoad) return entry.decoded.get();
+
+    // decode on first access; the phrase may be shared by several threads
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s_decodeMutex);
+#endif
+    if (!entry.decoded) {
+      const PhrasePropertyFactory& phrasePropertyFactory = StaticData::Instance().GetPhrasePropertyFactory();
+      entry.decoded = phrasePropertyFactory.ProduceProperty(PhrasePropertyFactory::GetKeyName(keyId), entry.value);
+    }
+    return entry.decoded.get();
   }
   return NULL;
 }
@@ -341,7 +425,7 @@ void swap(TargetPhrase &first, TargetPhrase &second)
   std::swap(first.m_alignTerm, second.m_alignTerm);
   std::swap(first.m_alignNonTerm, second.m_alignNonTerm);
   std::swap(first.m_lhsTarget, second.m_lhsTarget);
-  std::swap(first.m_cached_scores, second.m_cached_scores);
+  std::swap(first.m_side, second.m_side);
 }
 
 TO_STRING_BODY(TargetPhrase);
@@ -364,16 +448,18 @@ std::ostream& operator<<(std::ostream& os, const TargetPhrase& tp)
     os << " sourcePhrase=" << *sourcePhrase << flush;
   }
 
-  if (tp.m_properties.size()) {
+  if (tp.m_side && tp.m_side->properties.size()) {
     os << " properties: " << flush;
 
-    TargetPhrase::Properties::const_iterator iter;
-    for (iter = tp.m_properties.begin(); iter != tp.m_properties.end(); ++iter) {
-      const string &key = iter->first;
-      const PhraseProperty *prop = iter->second.get();
-      assert(prop);
-
-      os << key << "=" << *prop << " ";
+    for (size_t i = 0; i < tp.m_side->properties.size(); ++i) {
+      const TargetPhrase::PropertyEntry &entry = tp.m_side->properties[i];
+      os << PhrasePropertyFactory::GetKeyName(entry.key) << "=";
+      if (entry.onLoad) {
+        assert(entry.decoded);
+        os << *entry.decoded << " ";
+      } else {
+        os << entry.value << " ";
+      }
     }
   }
 
@@ -59,9 +59,6 @@ class TargetPhrase: public Phrase
   void SetExtraScores(FeatureFunction const* ff, 
 		      boost::shared_ptr<Scores> const& scores);
   
- private:
-  ScoreCache_t m_cached_scores; 
-  
 private:
   friend std::ostream& operator<<(std::ostream&, const TargetPhrase&);
   friend void swap(TargetPhrase &first, TargetPhrase &second);
@@ -73,17 +70,36 @@ private:
   const Word *m_lhsTarget;
   mutable Phrase *m_ruleSource; // to be set by the feature function that needs it.
 
-  typedef std::map<std::string, boost::shared_ptr<PhraseProperty> > Properties;
-  Properties m_properties;
-
   const PhraseDictionary *m_container;
 
-  mutable boost::unordered_map<const std::string, boost::shared_ptr<void> > m_data;
+  //! a property, by interned key (PhrasePropertyFactory::GetKeyId())
+  struct PropertyEntry {
+    size_t key;
+    bool onLoad;
+    std::string value; //!< until decoded, for properties not decoded on load
+    mutable boost::shared_ptr<PhraseProperty> decoded;
+  };
+
+  //! what most phrases don't have, allocated when first needed
+  struct SideData {
+    std::vector<PropertyEntry> properties;
+    boost::unordered_map<const std::string, boost::shared_ptr<void> > data;
+    ScoreCache_t cachedScores;
+  };
+  mutable SideData *m_side;
+
+  static SideData *CopySide(const SideData &side);
+
+  SideData &GetSide() const {
+    if (!m_side) m_side = new SideData;
+    return *m_side;
+  }
 
 public:
   TargetPhrase(const PhraseDictionary *pt = NULL);
   TargetPhrase(std::string out_string, const PhraseDictionary *pt = NULL);
   TargetPhrase(const TargetPhrase &copy);
+  TargetPhrase &operator=(const TargetPhrase &copy);
   explicit TargetPhrase(const Phrase &targetPhrase, const PhraseDictionary *pt);
   ~TargetPhrase();
 
@@ -183,7 +199,7 @@ public:
 
   bool SetData(const std::string& key, boost::shared_ptr<void> value) const {
     std::pair< boost::unordered_map<const std::string, boost::shared_ptr<void> >::iterator, bool > inserted =
-      m_data.insert( std::pair<const std::string, boost::shared_ptr<void> >(key,value) );
+      GetSide().data.insert( std::pair<const std::string, boost::shared_ptr<void> >(key,value) );
     if (!inserted.second) {
       return false;
     }
@@ -191,8 +207,11 @@ public:
   }
 
   boost::shared_ptr<void> GetData(const std::string& key) const {
-    boost::unordered_map<const std::string, boost::shared_ptr<void> >::const_iterator found = m_data.find(key);
-    if (found == m_data.end()) {
+    if (!m_side) {
+      return boost::shared_ptr<void>();
+    }
+    boost::unordered_map<const std::string, boost::shared_ptr<void> >::const_iterator found = m_side->data.find(key);
+    if (found == m_side->data.end()) {
       return boost::shared_ptr<void>();
     }
     return found->second;
@@ -207,6 +226,8 @@ public:
   void SetProperties(const StringPiece &str);
   void SetProperty(const std::string &key, const std::string &value);
   const PhraseProperty *GetProperty(const std::string &key) const;
+  //! by the id of PhrasePropertyFactory::GetKeyId(), no string lookup
+  const PhraseProperty *GetProperty(size_t keyId) const;
 
   void Merge(const TargetPhrase &copy, const std::vector<FactorType>& factorVec);
 
@@ -0,0 +1,57 @@
+// compiled with -std=c++0x, for contrib/c++tokenizer (see the Jamfile)
+#include "CxxTokenizer.h"
+
+#include "contrib/c++tokenizer/tokenizer.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+CxxTokenizer::CxxTokenizer(bool detokenize, const TextProcessorArgs &args)
+  : m_detokenize(detokenize)
+  , m_lang(GetArg(args, "lang", "en"))
+  , m_configDir(GetArg(args, "config-dir"))
+  , m_aggressive(GetArg(args, "aggressive", "false") == "true")
+  , m_escape(GetArg(args, "escape", "true") == "true")
+  , m_penn(GetArg(args, "penn", "false") == "true")
+{
+  // fail on a bad configuration now rather than in the first sentence
+  GetTokenizer();
+}
+
+CxxTokenizer::~CxxTokenizer() {}
+
+ctok::Tokenizer &CxxTokenizer::GetTokenizer() const
+{
+  ctok::Tokenizer *tokenizer = m_tokenizer.get();
+  if (!tokenizer) {
+    ctok::Parameters params;
+    params.lang_iso = m_lang;
+    params.nthreads = 1;
+    params.aggro_p = m_aggressive;
+    params.escape_p = m_escape;
+    params.unescape_p = m_detokenize && m_escape;
+    params.penn_p = m_penn;
+    tokenizer = new ctok::Tokenizer(params);
+    tokenizer->init(m_configDir.empty() ? NULL : m_configDir.c_str());
+    m_tokenizer.reset(tokenizer);
+  }
+  return *tokenizer;
+}
+
+void CxxTokenizer::Process(string &text) const
+{
+  ctok::Tokenizer &tokenizer = GetTokenizer();
+  if (m_detokenize) {
+    text = tokenizer.detokenize(text);
+  } else {
+    text = tokenizer.tokenize(text);
+  }
+  // the tokenizer may end the segment with a newline
+  while (!text.empty() && (text[text.size() - 1] == '\n' || text[text.size() - 1] == ' ')) {
+    text.erase(text.size() - 1);
+  }
+}
+
+}
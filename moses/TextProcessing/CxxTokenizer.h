@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+
+#include "moses/TextProcessing/TextProcessor.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
+namespace ctok
+{
+class Tokenizer;
+}
+
+namespace Moses
+{
+
+/** Tokenize and Detokenize, by contrib/c++tokenizer; only built with
+ *  --with-re2. Arguments:
+ *    lang=<iso code>     language of the nonbreaking prefixes, default en
+ *    config-dir=<dir>    where they are, default that of the tokenizer
+ *    aggressive=true     split hyphens (tokenizer.perl -a)
+ *    escape=false        don't escape special characters (-no-escape)
+ *    penn=true           Penn treebank tokenization (-penn)
+ *
+ *  The tokenizer isn't meant to be shared between threads, so every
+ *  decoding thread gets its own.
+ */
+class CxxTokenizer : public TextProcessor
+{
+public:
+  CxxTokenizer(bool detokenize, const TextProcessorArgs &args);
+  ~CxxTokenizer();
+
+  void Process(std::string &text) const;
+
+private:
+  ctok::Tokenizer &GetTokenizer() const;
+
+  bool m_detokenize;
+  std::string m_lang, m_configDir;
+  bool m_aggressive, m_escape, m_penn;
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ctok::Tokenizer> m_tokenizer;
+#else
+  mutable boost::scoped_ptr<ctok::Tokenizer> m_tokenizer;
+#endif
+};
+
+}
@@ -0,0 +1,150 @@
+#include "TextProcessor.h"
+
+#include <cstring>
+
+#include "moses/Util.h"
+#include "moses/TextProcessing/Truecaser.h"
+#include "util/exception.hh"
+
+#ifdef HAVE_CXX_TOKENIZER
+#include "moses/TextProcessing/CxxTokenizer.h"
+#endif
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+// the escaping of tokenizer.perl, for the characters that have a meaning
+// to the decoder: factor separator, markup and brackets
+const char *const kEscapes[][2] = {
+  { "&", "&amp;" },
+  { "|", "&#124;" },
+  { "<", "&lt;" },
+  { ">", "&gt;" },
+  { "'", "&apos;" },
+  { "\"", "&quot;" },
+  { "[", "&#91;" },
+  { "]", "&#93;" }
+};
+const size_t kNumEscapes = sizeof(kEscapes) / sizeof(kEscapes[0]);
+
+class Escaper : public TextProcessor
+{
+public:
+  void Process(string &text) const {
+    string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+      size_t e = 0;
+      while (e < kNumEscapes && text[i] != kEscapes[e][0][0]) ++e;
+      if (e < kNumEscapes) {
+        out += kEscapes[e][1];
+      } else {
+        out += text[i];
+      }
+    }
+    text.swap(out);
+  }
+};
+
+// deescape-special-chars.perl
+class Unescaper : public TextProcessor
+{
+public:
+  void Process(string &text) const {
+    if (text.find('&') == string::npos) return;
+    string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+      size_t e = kNumEscapes;
+      if (text[i] == '&') {
+        // &amp; last, so that "&amp;lt;" becomes "&lt;"
+        for (e = 1; e < kNumEscapes; ++e) {
+          if (text.compare(i, strlen(kEscapes[e][1]), kEscapes[e][1]) == 0) break;
+        }
+        if (e == kNumEscapes && text.compare(i, 5, "&amp;") == 0) e = 0;
+      }
+      if (e < kNumEscapes) {
+        out += kEscapes[e][0];
+        i += strlen(kEscapes[e][1]) - 1;
+      } else {
+        out += text[i];
+      }
+    }
+    text.swap(out);
+  }
+};
+
+TextProcessor *CreateProcessor(const string &name, const TextProcessorArgs &args)
+{
+  if (name == "Escape") {
+    return new Escaper();
+  } else if (name == "Unescape") {
+    return new Unescaper();
+  } else if (name == "Truecase") {
+    return new Truecaser(GetArg(args, "model"));
+  } else if (name == "Detruecase") {
+    return new Detruecaser();
+  }
+#ifdef HAVE_CXX_TOKENIZER
+  else if (name == "Tokenize" || name == "Detokenize") {
+    return new CxxTokenizer(name == "Detokenize", args);
+  }
+#else
+  UTIL_THROW_IF2(name == "Tokenize" || name == "Detokenize",
+                 name << " needs the C++ tokenizer; build with --with-re2");
+#endif
+  UTIL_THROW2("Unknown text processor: " << name);
+}
+
+}
+
+string GetArg(const TextProcessorArgs &args, const string &key, const string &def)
+{
+  TextProcessorArgs::const_iterator i = args.find(key);
+  return i == args.end() ? def : i->second;
+}
+
+void TextProcessorChain::Add(const string &line)
+{
+  vector<string> toks = Tokenize(line);
+  if (toks.empty()) return;
+  TextProcessorArgs args;
+  for (size_t i = 1; i < toks.size(); ++i) {
+    vector<string> keyValue = TokenizeFirstOnly(toks[i], "=");
+    UTIL_THROW_IF2(keyValue.size() != 2,
+                   "Text processor arguments must be key=value: " << line);
+    args[keyValue[0]] = keyValue[1];
+  }
+  m_processors.push_back(CreateProcessor(toks[0], args));
+}
+
+void TextProcessorChain::Process(string &text) const
+{
+  for (size_t i = 0; i < m_processors.size(); ++i) {
+    m_processors[i].Process(text);
+  }
+}
+
+void TextProcessorChain::ProcessLines(string &text) const
+{
+  if (Empty()) return;
+  string out, line;
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    line = text.substr(begin, end == string::npos ? string::npos : end - begin);
+    Process(line);
+    out += line;
+    if (end == string::npos) break;
+    out += '\n';
+    begin = end + 1;
+  }
+  text.swap(out);
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+namespace Moses
+{
+
+/** One step of the text processing around the decoder, e.g. tokenizing
+ *  or truecasing the input, or detokenizing the output, so that the
+ *  perl pre- and post-processing scripts need not run as separate
+ *  processes.
+ *
+ *  Process() is called from the threads that decode, for several segments
+ *  at once, so it must not change the processor.
+ */
+class TextProcessor
+{
+public:
+  virtual ~TextProcessor() {}
+
+  //! rewrites one segment, a line without the newline
+  virtual void Process(std::string &text) const = 0;
+};
+
+/** The steps configured by [input-processing] or [output-processing] in
+ *  moses.ini, one per line, e.g.
+ *
+ *    [input-processing]
+ *    Tokenize lang=en
+ *    Escape
+ *    Truecase model=/path/to/truecase-model.en
+ *
+ *  and applied in that order.
+ */
+class TextProcessorChain
+{
+public:
+  //! adds the step described by "Name key=value ..."
+  void Add(const std::string &line);
+
+  bool Empty() const {
+    return m_processors.empty();
+  }
+
+  void Process(std::string &text) const;
+
+  //! processes every line of text on its own, keeping the newlines
+  void ProcessLines(std::string &text) const;
+
+private:
+  boost::ptr_vector<TextProcessor> m_processors;
+};
+
+//! key=value arguments of a processor
+typedef std::map<std::string, std::string> TextProcessorArgs;
+
+//! the value of key, def if it isn't given
+std::string GetArg(const TextProcessorArgs &args, const std::string &key, const std::string &def = "");
+
+}
@@ -0,0 +1,228 @@
+#include "Truecaser.h"
+
+#include "moses/InputFileStream.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+// words after which a sentence starts, and words that don't end the
+// sentence start, as in truecase.perl
+bool IsSentenceEnd(const string &word)
+{
+  return word == "." || word == ":" || word == "?" || word == "!";
+}
+
+bool IsDelayedSentenceStart(const string &word)
+{
+  return word == "(" || word == "[" || word == "\"" || word == "'"
+         || word == "&apos;" || word == "&quot;" || word == "&#91;" || word == "&#93;";
+}
+
+bool IsMarkup(const string &word)
+{
+  return word.size() >= 2 && word[0] == '<' && word[word.size() - 1] == '>';
+}
+
+// -1 if the string doesn't start with valid UTF-8 at pos
+int DecodeUtf8(const string &str, size_t pos, size_t &len)
+{
+  const unsigned char c = str[pos];
+  int cp;
+  if (c < 0x80) {
+    len = 1;
+    return c;
+  } else if ((c & 0xe0) == 0xc0) {
+    len = 2;
+    cp = c & 0x1f;
+  } else if ((c & 0xf0) == 0xe0) {
+    len = 3;
+    cp = c & 0x0f;
+  } else if ((c & 0xf8) == 0xf0) {
+    len = 4;
+    cp = c & 0x07;
+  } else {
+    len = 1;
+    return -1;
+  }
+  if (pos + len > str.size()) {
+    len = 1;
+    return -1;
+  }
+  for (size_t i = 1; i < len; ++i) {
+    const unsigned char cc = str[pos + i];
+    if ((cc & 0xc0) != 0x80) {
+      len = 1;
+      return -1;
+    }
+    cp = (cp << 6) | (cc & 0x3f);
+  }
+  return cp;
+}
+
+void EncodeUtf8(int cp, string &out)
+{
+  if (cp < 0x80) {
+    out += char(cp);
+  } else if (cp < 0x800) {
+    out += char(0xc0 | (cp >> 6));
+    out += char(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    out += char(0xe0 | (cp >> 12));
+    out += char(0x80 | ((cp >> 6) & 0x3f));
+    out += char(0x80 | (cp & 0x3f));
+  } else {
+    out += char(0xf0 | (cp >> 18));
+    out += char(0x80 | ((cp >> 12) & 0x3f));
+    out += char(0x80 | ((cp >> 6) & 0x3f));
+    out += char(0x80 | (cp & 0x3f));
+  }
+}
+
+// Latin Extended-A pairs an upper case letter with the lower case one
+// after it, starting on an even code point in most blocks and on an odd
+// one in two
+bool InOddPairBlock(int cp)
+{
+  return (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17e);
+}
+
+bool IsPairedLatin(int cp)
+{
+  return (cp >= 0x100 && cp <= 0x137) || InOddPairBlock(cp) || (cp >= 0x14a && cp <= 0x177);
+}
+
+int ToLower(int cp)
+{
+  if ((cp >= 'A' && cp <= 'Z') || (cp >= 0xc0 && cp <= 0xde && cp != 0xd7)
+      || (cp >= 0x391 && cp <= 0x3a9 && cp != 0x3a2) || (cp >= 0x410 && cp <= 0x42f)) {
+    return cp + 0x20;
+  } else if (cp >= 0x400 && cp <= 0x40f) {
+    return cp + 0x50;
+  } else if (IsPairedLatin(cp) && (cp % 2 == 0) != InOddPairBlock(cp)) {
+    return cp + 1;
+  }
+  return cp;
+}
+
+int ToUpper(int cp)
+{
+  if ((cp >= 'a' && cp <= 'z') || (cp >= 0xe0 && cp <= 0xfe && cp != 0xf7)
+      || (cp >= 0x3b1 && cp <= 0x3c9 && cp != 0x3c2) || (cp >= 0x430 && cp <= 0x44f)) {
+    return cp - 0x20;
+  } else if (cp == 0x3c2) {
+    return 0x3a3; // final sigma
+  } else if (cp >= 0x450 && cp <= 0x45f) {
+    return cp - 0x50;
+  } else if (IsPairedLatin(cp) && (cp % 2 == 1) != InOddPairBlock(cp)) {
+    return cp - 1;
+  }
+  return cp;
+}
+
+}
+
+string LowerCaseUtf8(const string &str)
+{
+  string out;
+  out.reserve(str.size());
+  for (size_t pos = 0, len; pos < str.size(); pos += len) {
+    int cp = DecodeUtf8(str, pos, len);
+    if (cp < 0) {
+      out += str[pos];
+    } else {
+      EncodeUtf8(ToLower(cp), out);
+    }
+  }
+  return out;
+}
+
+string UpperCaseFirstUtf8(const string &str)
+{
+  if (str.empty()) return str;
+  size_t len;
+  int cp = DecodeUtf8(str, 0, len);
+  if (cp < 0) return str;
+  string out;
+  EncodeUtf8(ToUpper(cp), out);
+  out.append(str, len, string::npos);
+  return out;
+}
+
+Truecaser::Truecaser(const string &modelPath)
+{
+  UTIL_THROW_IF2(modelPath.empty(), "Truecase needs model=<truecase model>");
+  InputFileStream in(modelPath);
+  string line;
+  while (getline(in, line)) {
+    // best (count/total) other (count) ...
+    vector<string> toks = Tokenize(line);
+    if (toks.empty()) continue;
+    m_best[LowerCaseUtf8(toks[0])] = toks[0];
+    for (size_t i = 0; i < toks.size(); i += 2) {
+      m_known.insert(toks[i]);
+    }
+  }
+}
+
+void Truecaser::Process(string &text) const
+{
+  vector<string> words = Tokenize(text);
+  bool sentenceStart = true;
+  string out;
+  for (size_t i = 0; i < words.size(); ++i) {
+    if (i) out += ' ';
+    const string &token = words[i];
+    if (IsMarkup(token)) {
+      out += token;
+      continue;
+    }
+    const size_t bar = token.find('|');
+    const string word = token.substr(0, bar);
+
+    boost::unordered_map<string, string>::const_iterator best = m_best.find(LowerCaseUtf8(word));
+    if (best != m_best.end() && (sentenceStart || !m_known.count(word))) {
+      out += best->second;
+    } else {
+      out += word;
+    }
+    if (bar != string::npos) out.append(token, bar, string::npos);
+
+    if (IsSentenceEnd(word)) {
+      sentenceStart = true;
+    } else if (!IsDelayedSentenceStart(word)) {
+      sentenceStart = false;
+    }
+  }
+  text.swap(out);
+}
+
+void Detruecaser::Process(string &text) const
+{
+  vector<string> words = Tokenize(text);
+  bool sentenceStart = true;
+  string out;
+  for (size_t i = 0; i < words.size(); ++i) {
+    if (i) out += ' ';
+    const string &word = words[i];
+    if (IsMarkup(word)) {
+      out += word;
+      continue;
+    }
+    out += sentenceStart ? UpperCaseFirstUtf8(word) : word;
+    if (IsSentenceEnd(word)) {
+      sentenceStart = true;
+    } else if (!IsDelayedSentenceStart(word)) {
+      sentenceStart = false;
+    }
+  }
+  text.swap(out);
+}
+
+}
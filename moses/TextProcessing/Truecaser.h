@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "moses/TextProcessing/TextProcessor.h"
+
+namespace Moses
+{
+
+/** truecase.perl: the first word of a sentence gets its most frequent
+ *  casing in the model of train-truecaser.perl, other words keep their
+ *  casing if the model has seen it. Markup and factors other than the
+ *  first are left alone.
+ */
+class Truecaser : public TextProcessor
+{
+public:
+  explicit Truecaser(const std::string &modelPath);
+
+  void Process(std::string &text) const;
+
+private:
+  //! lowercased word -> its most frequent casing
+  boost::unordered_map<std::string, std::string> m_best;
+  //! casings seen in training
+  boost::unordered_set<std::string> m_known;
+};
+
+/** detruecase.perl: upper-cases the first letter of every sentence.
+ */
+class Detruecaser : public TextProcessor
+{
+public:
+  void Process(std::string &text) const;
+};
+
+//! UTF-8 case mapping of Latin, Greek and Cyrillic letters; other
+//! characters are unchanged
+std::string LowerCaseUtf8(const std::string &str);
+std::string UpperCaseFirstUtf8(const std::string &str);
+
+}
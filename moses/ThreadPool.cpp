@@ -20,8 +20,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 
+#include <algorithm>
+
 #include "ThreadPool.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 #ifdef WITH_THREADS
 
 using namespace std;
@@ -31,36 +37,135 @@ namespace Moses
 {
 
 ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false), m_queueLimit(0)
+  : m_nextWorker(0), m_idleThreads(0)
+  , m_stopped(false), m_stopping(false), m_queueLimit(0)
 {
+  // always keep at least one deque so that Submit() has somewhere to go
+  size_t numWorkers = std::max(numThreads, (size_t) 1);
+  for (size_t i = 0; i < numWorkers; ++i) {
+    m_workers.push_back(new Worker);
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+ThreadPool &ThreadPool::ForCurrentThread(size_t numThreads)
+{
+  static boost::thread_specific_ptr<ThreadPool> pools;
+  ThreadPool *pool = pools.get();
+  if (pool == NULL || pool->m_threads.size() != numThreads) {
+    pool = new ThreadPool(numThreads);
+    pools.reset(pool);
+  }
+  return *pool;
+}
+
+bool ThreadPool::TryGetTask(size_t id, boost::shared_ptr<Task> &task, Worker *&owner)
+{
+  // own deque first, oldest task first
+  {
+    Worker &self = *m_workers[id];
+    boost::mutex::scoped_lock lock(self.mutex);
+    if (!self.tasks.empty()) {
+      task = self.tasks.front();
+      self.tasks.pop_front();
+      ++self.running;
+      owner = &self;
+      return true;
+    }
+  }
+  // steal the newest task of some other worker
+  for (size_t i = 1; i < m_workers.size(); ++i) {
+    Worker &victim = *m_workers[(id + i) % m_workers.size()];
+    boost::mutex::scoped_lock lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      ++victim.running;
+      owner = &victim;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t ThreadPool::QueuedCount() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    ret += m_workers[i]->tasks.size();
+  }
+  return ret;
+}
+
+size_t ThreadPool::PendingCount() const
+{
+  // a task moves from a deque to the running count of its worker under the
+  // worker's mutex, so it is never missed in between
+  size_t ret = 0;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    ret += m_workers[i]->tasks.size() + m_workers[i]->running;
   }
+  return ret;
 }
 
-void ThreadPool::Execute()
+void ThreadPool::Execute(size_t id)
 {
+  Worker &self = *m_workers[id];
   do {
     boost::shared_ptr<Task> task;
-    {
-      // Find a job to perform
+    Worker *owner = NULL;
+    boost::posix_time::time_duration idle;
+    if (!TryGetTask(id, task, owner)) {
+      // Nothing to do. Check again while holding the pool mutex: Submit()
+      // pushes while holding it, so no task can slip in before we sleep.
+      boost::posix_time::ptime idleStart
+        = boost::posix_time::microsec_clock::universal_time();
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      while (!m_stopped && !TryGetTask(id, task, owner)) {
+        ++m_idleThreads;
         m_threadNeeded.wait(lock);
+        --m_idleThreads;
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
+      idle = boost::posix_time::microsec_clock::universal_time() - idleStart;
     }
-    //Execute job
+    // Execute job. One taken from a deque always runs, even if Stop() has
+    // set m_stopped meanwhile: it is no longer queued, and Stop(true)
+    // waits for it through the running count.
     if (task) {
       // must read from task before run. otherwise task may be deleted by main thread
       // race condition
       task->DeleteAfterExecution();
       task->Run();
     }
-    m_threadAvailable.notify_all();
+    if (owner) {
+      boost::mutex::scoped_lock lock(owner->mutex);
+      --owner->running;
+    }
+    {
+      boost::mutex::scoped_lock lock(self.mutex);
+      self.idle += idle;
+      if (task) {
+        ++self.executed;
+        if (owner != &self) ++self.steals;
+      }
+    }
+    // only Submit() with a queue limit and Stop() ever wait for this
+    if (m_queueLimit > 0 || m_stopping) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_threadAvailable.notify_all();
+    }
   } while (!m_stopped);
 }
 
@@ -70,11 +175,18 @@ void ThreadPool::Submit(boost::shared_ptr<Task> task)
   if (m_stopping) {
     throw runtime_error("ThreadPool stopping - unable to accept new jobs");
   }
-  while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
+  while (m_queueLimit > 0 && QueuedCount() >= m_queueLimit) {
     m_threadAvailable.wait(lock);
   }
-  m_tasks.push(task);
-  m_threadNeeded.notify_all();
+  Worker &worker = *m_workers[m_nextWorker];
+  m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+  {
+    boost::mutex::scoped_lock workerLock(worker.mutex);
+    worker.tasks.push_back(task);
+  }
+  if (m_idleThreads > 0) {
+    m_threadNeeded.notify_all();
+  }
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -87,8 +199,8 @@ void ThreadPool::Stop(bool processRemainingJobs)
   }
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
-    //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    //wait for the queued and running jobs to finish
+    while (PendingCount() > 0 && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
   }
@@ -102,6 +214,36 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threads.join_all();
 }
 
+size_t ThreadPool::GetExecutedCount() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    ret += m_workers[i]->executed;
+  }
+  return ret;
+}
+
+size_t ThreadPool::GetStealCount() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    ret += m_workers[i]->steals;
+  }
+  return ret;
+}
+
+double ThreadPool::GetIdleSeconds() const
+{
+  boost::posix_time::time_duration ret;
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    ret += m_workers[i]->idle;
+  }
+  return ret.total_microseconds() / 1000000.0;
+}
+
 }
 #endif //WITH_THREADS
 
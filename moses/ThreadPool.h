@@ -22,8 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_ThreadPool_h
 #define moses_ThreadPool_h
 
+#include <deque>
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #endif
 
 #ifdef BOOST_HAS_PTHREADS
@@ -61,6 +62,13 @@ public:
 
 #ifdef WITH_THREADS
 
+/** A work-stealing thread pool.
+ *  Each worker owns a deque of tasks which it serves from the front. Submit()
+ *  distributes tasks round-robin over the workers; a worker that runs out of
+ *  work steals from the back of the other workers' deques before going to
+ *  sleep. The pool-wide mutex is only taken by Submit(), Stop() and by workers
+ *  that have found no work at all, so busy workers do not contend on it.
+ */
 class ThreadPool
 {
 public:
@@ -69,9 +77,15 @@ public:
    **/
   explicit ThreadPool(size_t numThreads);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
+
+  /**
+   * A pool of numThreads threads owned by the calling thread, created on
+   * first use and kept until the thread exits, so that the helpers of a
+   * decoding thread are not started anew for every sentence. Only the
+   * calling thread may use it.
+   **/
+  static ThreadPool &ForCurrentThread(size_t numThreads);
 
   /**
    * Add a job to the threadpool.
@@ -79,8 +93,9 @@ public:
   void Submit(boost::shared_ptr<Task> task);
 
   /**
-   * Wait until all queued jobs have completed, and shut down
-   * the ThreadPool.
+   * Shut down the ThreadPool. With processRemainingJobs, first wait until
+   * all jobs submitted so far have completed, including those a worker is
+   * running; otherwise only the running ones complete.
    **/
   void Stop(bool processRemainingJobs = false);
 
@@ -91,17 +106,53 @@ public:
     m_queueLimit = limit;
   }
 
+  //! number of tasks executed so far
+  size_t GetExecutedCount() const;
+
+  //! number of tasks a worker took from another worker's deque
+  size_t GetStealCount() const;
+
+  //! total time, summed over all workers, spent waiting for work
+  double GetIdleSeconds() const;
+
 private:
+  /** Per-worker state: the task deque and some counters, all guarded by the
+   *  worker's own mutex.
+   **/
+  struct Worker {
+    boost::mutex mutex;
+    std::deque<boost::shared_ptr<Task> > tasks;
+    size_t running; //!< tasks taken from this deque that have not finished yet
+    size_t executed;
+    size_t steals;
+    boost::posix_time::time_duration idle;
+    Worker() : running(0), executed(0), steals(0) {}
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t id);
+
+  /**
+   * Take a task from worker id's own deque, or steal one from another worker.
+   * owner is the worker it was taken from, whose running count now includes it.
+   **/
+  bool TryGetTask(size_t id, boost::shared_ptr<Task> &task, Worker *&owner);
+
+  //! number of tasks waiting in all deques
+  size_t QueuedCount() const;
+
+  //! number of tasks waiting or running
+  size_t PendingCount() const;
 
-  std::queue<boost::shared_ptr<Task> > m_tasks;
+  std::vector<Worker*> m_workers;
   boost::thread_group m_threads;
   boost::mutex m_mutex;
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
+  size_t m_nextWorker;
+  size_t m_idleThreads;
   bool m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "TranslationCache.h"
+#include "Util.h"
+#include "DecodeProfile.h"
+#include "util/murmur_hash.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+// rough per-entry overhead of the list node and index
+const size_t kEntryOverhead = 96;
+}
+
+TranslationCache::TranslationCache(size_t maxBytes, const std::string &sharedDir,
+                                   const std::string &version)
+  : m_bytes(0)
+  , m_maxBytes(maxBytes)
+  , m_sharedDir(sharedDir)
+  , m_version(version)
+{
+}
+
+std::string TranslationCache::Normalize(const std::string &text)
+{
+  string ret;
+  ret.reserve(text.size());
+  bool space = false;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      space = !ret.empty();
+    } else {
+      if (space) ret += ' ';
+      space = false;
+      ret += c;
+    }
+  }
+  return ret;
+}
+
+std::string TranslationCache::FullKey(const std::string &key) const
+{
+  return m_version + '\t' + key;
+}
+
+std::string TranslationCache::SharedPath(const std::string &fullKey) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx",
+           static_cast<unsigned long long>(util::MurmurHashNative(fullKey.data(), fullKey.size())));
+  return m_sharedDir + "/" + name;
+}
+
+void TranslationCache::Insert(const std::string &fullKey, const std::string &value)
+{
+  Index::iterator found = m_index.find(fullKey);
+  if (found != m_index.end()) {
+    m_bytes -= found->second->first.size() + found->second->second.size() + kEntryOverhead;
+    m_entries.erase(found->second);
+    m_index.erase(found);
+  }
+  m_entries.push_front(make_pair(fullKey, value));
+  m_index[fullKey] = m_entries.begin();
+  m_bytes += fullKey.size() + value.size() + kEntryOverhead;
+  while (m_bytes > m_maxBytes && !m_entries.empty()) {
+    const pair<string, string> &last = m_entries.back();
+    m_bytes -= last.first.size() + last.second.size() + kEntryOverhead;
+    m_index.erase(last.first);
+    m_entries.pop_back();
+  }
+}
+
+bool TranslationCache::Get(const std::string &key, std::string &value)
+{
+  string fullKey;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    fullKey = FullKey(key);
+    Index::iterator found = m_index.find(fullKey);
+    if (found != m_index.end()) {
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+      value = found->second->second;
+      DecodeProfile::Count(DecodeProfile::TranslationCacheHits);
+      return true;
+    }
+  }
+  if (m_sharedDir.empty()) {
+    DecodeProfile::Count(DecodeProfile::TranslationCacheMisses);
+    return false;
+  }
+
+  // a file holds the full key on its first line, then the translation
+  ifstream in(SharedPath(fullKey).c_str(), ios::binary);
+  string stored;
+  if (!in || !getline(in, stored) || stored != fullKey) {
+    DecodeProfile::Count(DecodeProfile::TranslationCacheMisses);
+    return false;
+  }
+  ostringstream rest;
+  rest << in.rdbuf();
+  value = rest.str();
+  DecodeProfile::Count(DecodeProfile::TranslationCacheHits);
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Insert(fullKey, value);
+  return true;
+}
+
+void TranslationCache::Put(const std::string &key, const std::string &value)
+{
+  string fullKey;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    fullKey = FullKey(key);
+    Insert(fullKey, value);
+  }
+  if (m_sharedDir.empty()) return;
+
+  // write and rename, so that readers never see half a file
+  string path = SharedPath(fullKey);
+  ostringstream tmpPath;
+  tmpPath << path << ".tmp." << getpid() << "." << &value;
+  {
+    ofstream out(tmpPath.str().c_str(), ios::binary);
+    out << fullKey << '\n' << value;
+    if (!out) {
+      remove(tmpPath.str().c_str());
+      return;
+    }
+  }
+  if (rename(tmpPath.str().c_str(), path.c_str())) {
+    remove(tmpPath.str().c_str());
+  }
+}
+
+void TranslationCache::Invalidate(const std::string &reason)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+  m_version += "|" + Normalize(reason);
+}
+
+}
@@ -0,0 +1,65 @@
+// -*- c++ -*-
+#pragma once
+
+#include <list>
+#include <string>
+#include <utility>
+
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Cache of single-best translations of whole sentences, for inputs that
+ *  recur verbatim (UI strings, boilerplate, retried requests). Keys are the
+ *  whitespace-normalized input plus whatever options the caller knows to
+ *  change the output; the model version is added here.
+ *
+ *  Entries are evicted least recently used first once they take up more
+ *  than the configured number of bytes. If a directory is given, entries
+ *  are also written there, one file each, so that decoders sharing the
+ *  directory share their translations. The model version (the
+ *  translation-cache-version setting plus any reloads since startup) keeps
+ *  them apart when models differ.
+ */
+class TranslationCache
+{
+public:
+  TranslationCache(size_t maxBytes, const std::string &sharedDir,
+                   const std::string &version);
+
+  //! trim and collapse runs of whitespace into single spaces
+  static std::string Normalize(const std::string &text);
+
+  //! true and sets value if key is cached
+  bool Get(const std::string &key, std::string &value);
+
+  void Put(const std::string &key, const std::string &value);
+
+  //! drop all entries; reason (e.g. the file a model was reloaded from)
+  //! becomes part of the model version
+  void Invalidate(const std::string &reason);
+
+private:
+  typedef std::list<std::pair<std::string, std::string> > Entries;
+  typedef boost::unordered_map<std::string, Entries::iterator> Index;
+
+  std::string FullKey(const std::string &key) const;
+  std::string SharedPath(const std::string &fullKey) const;
+  void Insert(const std::string &fullKey, const std::string &value);
+
+  Entries m_entries; //!< most recently used first
+  Index m_index;
+  size_t m_bytes, m_maxBytes;
+  std::string m_sharedDir, m_version;
+
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
+}
@@ -7,14 +7,67 @@
 #include "moses/TranslationModel/UG/generic/sorting/NBestList.h"
 #include "moses/TranslationModel/UG/generic/sampling/Sampling.h"
 
+#include "util/murmur_hash.hh"
+
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
+#include <unistd.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 
 using namespace std;
 
 namespace Moses
 {
 
+namespace
+{
+// Image of the suffix arrays: this header, then the source and target
+// arrays as written by DynSuffixArray::Save(). The corpora are hashed, so
+// an image is only used with the corpora it was built from.
+const char kImageMagic[8] = "mosesSA";
+
+struct ImageHeader {
+  char magic[8];
+  uint64_t srcSize, trgSize;
+  uint64_t srcHash, trgHash;
+};
+
+ImageHeader MakeImageHeader(const vector<wordID_t> &src, const vector<wordID_t> &trg)
+{
+  ImageHeader header;
+  memcpy(header.magic, kImageMagic, sizeof(header.magic));
+  header.srcSize = src.size();
+  header.trgSize = trg.size();
+  header.srcHash = src.empty() ? 0 : util::MurmurHashNative(&src[0], src.size() * sizeof(wordID_t));
+  header.trgHash = trg.empty() ? 0 : util::MurmurHashNative(&trg[0], trg.size() * sizeof(wordID_t));
+  return header;
+}
+
+typedef boost::function<void()> Step;
+
+// runs a loading step, keeping its error for the thread that waits for it
+void RunStep(Step step, string *error)
+{
+  try {
+    step();
+  } catch (const std::exception &e) {
+    *error = e.what();
+  }
+}
+
+void BuildSA(DynSuffixArray **sa, vector<wordID_t> *corpus)
+{
+  *sa = new DynSuffixArray(corpus);
+}
+}
+
 BilingualDynSuffixArray::
 BilingualDynSuffixArray():
   m_maxPhraseLength(StaticData::Instance().GetMaxPhraseLength()),
@@ -47,34 +100,62 @@ Load(
   const vector<FactorType>& inputFactors,
   const vector<FactorType>& outputFactors,
   string source, string target, string alignments,
-  const vector<float> &weight)
+  const vector<float> &weight, const string &imagePath)
 {
   m_inputFactors = inputFactors;
   m_outputFactors = outputFactors;
 
   // m_scoreCmp = new ScoresComp(weight);
-  InputFileStream sourceStrme(source);
-  InputFileStream targetStrme(target);
-  cerr << "Loading source corpus...\n";
+  // the three files are independent: read them at the same time
+  cerr << "Loading source and target corpus and alignment file...\n";
   // Input and Output are 'Factor directions' (whatever that is) defined in Typedef.h
-  LoadCorpus(Input, sourceStrme, m_inputFactors, *m_srcCorpus, m_srcSntBreaks, m_srcVocab);
-  cerr << "Loading target corpus...\n";
-  LoadCorpus(Output, targetStrme, m_outputFactors,*m_trgCorpus, m_trgSntBreaks, m_trgVocab);
+  string errors[3];
+#ifdef WITH_THREADS
+  boost::thread_group readers;
+  readers.create_thread(boost::bind(&RunStep,
+                                    Step(boost::bind(&BilingualDynSuffixArray::LoadCorpusFile, this, Input, source)),
+                                    &errors[0]));
+  readers.create_thread(boost::bind(&RunStep,
+                                    Step(boost::bind(&BilingualDynSuffixArray::LoadCorpusFile, this, Output, target)),
+                                    &errors[1]));
+  readers.create_thread(boost::bind(&RunStep,
+                                    Step(boost::bind(&BilingualDynSuffixArray::LoadAlignmentFile, this, alignments)),
+                                    &errors[2]));
+  readers.join_all();
+#else
+  LoadCorpusFile(Input, source);
+  LoadCorpusFile(Output, target);
+  LoadAlignmentFile(alignments);
+#endif
+  for (size_t i = 0; i < 3; ++i) {
+    UTIL_THROW_IF2(!errors[i].empty(), errors[i]);
+  }
 
   UTIL_THROW_IF2(m_srcSntBreaks.size() != m_trgSntBreaks.size(),
                  "Source and target arrays aren't the same size");
 
   // build suffix arrays and auxilliary arrays
-  cerr << "Building Source Suffix Array...\n";
-  m_srcSA = new DynSuffixArray(m_srcCorpus);
-  if(!m_srcSA) return false;
-  cerr << "Building Target Suffix Array...\n";
-  m_trgSA = new DynSuffixArray(m_trgCorpus);
-  if(!m_trgSA) return false;
-
-  InputFileStream alignStrme(alignments);
-  cerr << "Loading Alignment File...\n";
-  LoadRawAlignments(alignStrme);
+  if (!imagePath.empty() && LoadImage(imagePath)) {
+    cerr << "Loaded suffix arrays from " << imagePath << "\n";
+  } else {
+    cerr << "Building Source and Target Suffix Arrays...\n";
+#ifdef WITH_THREADS
+    boost::thread_group builders;
+    builders.create_thread(boost::bind(&RunStep,
+                                       Step(boost::bind(&BuildSA, &m_srcSA, m_srcCorpus)), &errors[0]));
+    builders.create_thread(boost::bind(&RunStep,
+                                       Step(boost::bind(&BuildSA, &m_trgSA, m_trgCorpus)), &errors[1]));
+    builders.join_all();
+    for (size_t i = 0; i < 2; ++i) {
+      UTIL_THROW_IF2(!errors[i].empty(), errors[i]);
+    }
+#else
+    BuildSA(&m_srcSA, m_srcCorpus);
+    BuildSA(&m_trgSA, m_trgCorpus);
+#endif
+    if (!imagePath.empty()) SaveImage(imagePath);
+  }
+
   cerr << m_srcSntBreaks.size() << " "
        << m_trgSntBreaks.size() << " "
        << m_rawAlignments.size() << endl;
@@ -106,6 +187,72 @@ Load(
   return true;
 }
 
+void
+BilingualDynSuffixArray::
+LoadCorpusFile(FactorDirection direction, const string &path)
+{
+  InputFileStream strme(path);
+  if (direction == Input) {
+    LoadCorpus(Input, strme, m_inputFactors, *m_srcCorpus, m_srcSntBreaks, m_srcVocab);
+  } else {
+    LoadCorpus(Output, strme, m_outputFactors, *m_trgCorpus, m_trgSntBreaks, m_trgVocab);
+  }
+}
+
+void
+BilingualDynSuffixArray::
+LoadAlignmentFile(const string &path)
+{
+  InputFileStream strme(path);
+  LoadRawAlignments(strme);
+}
+
+bool
+BilingualDynSuffixArray::
+LoadImage(const string &path)
+{
+  if (access(path.c_str(), R_OK) != 0) return false;
+  FILE *fin = fopen(path.c_str(), "rb");
+  if (!fin) return false;
+  const ImageHeader expected = MakeImageHeader(*m_srcCorpus, *m_trgCorpus);
+  ImageHeader header;
+  if (fread(&header, sizeof(header), 1, fin) != 1
+      || memcmp(&header, &expected, sizeof(header))) {
+    cerr << "Suffix array image " << path << " does not match the corpus, rebuilding it\n";
+    fclose(fin);
+    return false;
+  }
+  m_srcSA = new DynSuffixArray(m_srcCorpus, fin);
+  m_trgSA = new DynSuffixArray(m_trgCorpus, fin);
+  fclose(fin);
+  return true;
+}
+
+void
+BilingualDynSuffixArray::
+SaveImage(const string &path) const
+{
+  // write to a temporary file first, so that a concurrent reader never
+  // sees half an image
+  ostringstream tmp;
+  tmp << path << ".tmp." << getpid();
+  FILE *fout = fopen(tmp.str().c_str(), "wb");
+  if (!fout) {
+    cerr << "Could not write suffix array image " << path << "\n";
+    return;
+  }
+  const ImageHeader header = MakeImageHeader(*m_srcCorpus, *m_trgCorpus);
+  bool ok = fwrite(&header, sizeof(header), 1, fout) == 1;
+  m_srcSA->Save(fout);
+  m_trgSA->Save(fout);
+  ok = !ferror(fout) && ok;
+  ok = fclose(fout) == 0 && ok;
+  if (!ok || rename(tmp.str().c_str(), path.c_str()) != 0) {
+    cerr << "Could not write suffix array image " << path << "\n";
+    remove(tmp.str().c_str());
+  }
+}
+
 int
 BilingualDynSuffixArray::
 LoadRawAlignments(InputFileStream& align)
@@ -115,7 +115,8 @@ public:
   bool Load( const vector<FactorType>& inputFactors,
              const vector<FactorType>& outputTactors,
              string source, string target, string alignments,
-             const vector<float> &weight);
+             const vector<float> &weight,
+             const string &imagePath = "");
   // bool LoadTM( const vector<FactorType>& inputFactors,
   // 	     const vector<FactorType>& outputTactors,
   // 	     string source, string target, string alignments,
@@ -158,6 +159,11 @@ private:
                  vector<wordID_t>&, vector<wordID_t>&,
                  Vocab*);
   int LoadAlignments(InputFileStream& aligs);
+  void LoadCorpusFile(FactorDirection direction, const string &path);
+  void LoadAlignmentFile(const string &path);
+  //! the suffix arrays saved by SaveImage(), false if there are none for this corpus
+  bool LoadImage(const string &path);
+  void SaveImage(const string &path) const;
   int LoadRawAlignments(InputFileStream& aligs);
   int LoadRawAlignments(string& aligs);
 
@@ -21,6 +21,7 @@
 #include "ChartRuleLookupManagerMemory.h"
 
 #include "moses/ChartParser.h"
+#include "moses/ContextScope.h"
 #include "moses/InputType.h"
 #include "moses/Terminal.h"
 #include "moses/ChartParserCallback.h"
@@ -49,6 +50,51 @@ ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
   m_completedRules.resize(sourceSize);
 
   m_isSoftMatching = !m_softMatchingMap.empty();
+
+  // the parser is created on the thread that decodes the input
+  boost::shared_ptr<ContextScope> scope = ContextScope::Current();
+  if (ruleTable.GetDocumentCacheSize() && scope) {
+    // keyed by the root node: the table's own address is its to use
+    m_documentCache = scope->Get<TerminalMatchCache>(&ruleTable.GetRootNode(), true);
+    m_documentCache->SetMaxSize(ruleTable.GetDocumentCacheSize());
+  }
+}
+
+size_t TerminalMatchCache::WordsHasher::operator()(const std::vector<Word> &words) const
+{
+  size_t seed = 0;
+  for (size_t i = 0; i < words.size(); ++i) {
+    boost::hash_combine(seed, TerminalHasher()(words[i]));
+  }
+  return seed;
+}
+
+bool TerminalMatchCache::WordsEqualityPred::operator()(const std::vector<Word> &a, const std::vector<Word> &b) const
+{
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (!TerminalEqualityPred()(a[i], b[i])) return false;
+  }
+  return true;
+}
+
+boost::shared_ptr<const TerminalMatchCache::Nodes> TerminalMatchCache::Get(const std::vector<Word> &words) const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Map::const_iterator iter = m_matches.find(words);
+  return iter == m_matches.end() ? boost::shared_ptr<const Nodes>() : iter->second;
+}
+
+void TerminalMatchCache::Put(const std::vector<Word> &words, const boost::shared_ptr<const Nodes> &nodes)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  if (m_matches.size() < m_maxSize) {
+    m_matches.insert(std::make_pair(words, nodes));
+  }
 }
 
 void ChartRuleLookupManagerMemory::GetChartRuleCollection(
@@ -72,7 +118,12 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   const PhraseDictionaryNodeMemory &rootNode = m_ruleTable.GetRootNode();
 
   // all rules starting with terminal
-  if (startPos == absEndPos) {
+  if (startPos == absEndPos && m_documentCache) {
+    boost::shared_ptr<const TerminalMatchCache::Nodes> nodes = GetTerminalMatches(startPos);
+    if (!nodes->empty()) {
+      AddAndExtendMatches(*nodes, 0, startPos);
+    }
+  } else if (startPos == absEndPos) {
     GetTerminalExtension(&rootNode, startPos);
   }
   // all rules starting with nonterminal
@@ -151,12 +202,11 @@ void ChartRuleLookupManagerMemory::UpdateCompressedMatrix(size_t startPos,
     }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+    const std::vector<size_t> &labelIds = targetNonTerms.GetLabelIds();
+    for (std::vector<size_t>::const_iterator i = labelIds.begin(); i != labelIds.end(); ++i) {
+      const ChartCellLabel *cellLabel = targetNonTerms.Find(*i);
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[*i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
@@ -185,13 +235,10 @@ void ChartRuleLookupManagerMemory::AddAndExtend(
 }
 
 
-// search all possible terminal extensions of a partial rule (pointed at by node) at a given position
-// recursively try to expand partial rules into full rules up to m_lastPos.
-void ChartRuleLookupManagerMemory::GetTerminalExtension(
+const PhraseDictionaryNodeMemory *ChartRuleLookupManagerMemory::FindTerminalChild(
   const PhraseDictionaryNodeMemory *node,
-  size_t pos)
+  size_t pos) const
 {
-
   const Word &sourceWord = GetSourceAt(pos).GetLabel();
   const PhraseDictionaryNodeMemory::TerminalMap & terminals = node->GetTerminalMap();
 
@@ -200,17 +247,67 @@ void ChartRuleLookupManagerMemory::GetTerminalExtension(
     for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator iter = terminals.begin(); iter != terminals.end(); ++iter) {
       const Word & word = iter->first;
       if (TerminalEqualityPred()(word, sourceWord)) {
-        const PhraseDictionaryNodeMemory *child = & iter->second;
-        AddAndExtend(child, pos);
-        break;
+        return & iter->second;
       }
     }
+    return NULL;
   }
   // else, do hash lookup
-  else {
-    const PhraseDictionaryNodeMemory *child = node->GetChild(sourceWord);
-    if (child != NULL) {
-      AddAndExtend(child, pos);
+  return node->GetChild(sourceWord);
+}
+
+// search all possible terminal extensions of a partial rule (pointed at by node) at a given position
+// recursively try to expand partial rules into full rules up to m_lastPos.
+void ChartRuleLookupManagerMemory::GetTerminalExtension(
+  const PhraseDictionaryNodeMemory *node,
+  size_t pos)
+{
+  const PhraseDictionaryNodeMemory *child = FindTerminalChild(node, pos);
+  if (child != NULL) {
+    AddAndExtend(child, pos);
+  }
+}
+
+boost::shared_ptr<const TerminalMatchCache::Nodes> ChartRuleLookupManagerMemory::GetTerminalMatches(size_t startPos)
+{
+  std::vector<Word> words;
+  for (size_t pos = startPos; pos <= m_lastPos; ++pos) {
+    words.push_back(GetSourceAt(pos).GetLabel());
+  }
+  boost::shared_ptr<const TerminalMatchCache::Nodes> ret = m_documentCache->Get(words);
+  if (ret) return ret;
+
+  TerminalMatchCache::Nodes *nodes = new TerminalMatchCache::Nodes;
+  ret.reset(nodes);
+  const PhraseDictionaryNodeMemory *node = &m_ruleTable.GetRootNode();
+  for (size_t pos = startPos; pos <= m_lastPos; ++pos) {
+    node = FindTerminalChild(node, pos);
+    if (node == NULL) break;
+    nodes->push_back(node);
+  }
+  m_documentCache->Put(words, ret);
+  return ret;
+}
+
+// same order of rules as AddAndExtend()
+void ChartRuleLookupManagerMemory::AddAndExtendMatches(
+  const TerminalMatchCache::Nodes &nodes,
+  size_t i,
+  size_t startPos)
+{
+  const PhraseDictionaryNodeMemory *node = nodes[i];
+  const size_t endPos = startPos + i;
+  const TargetPhraseCollection &tpc = node->GetTargetPhraseCollection();
+  if (!tpc.IsEmpty()) {
+    m_completedRules[endPos].Add(tpc, m_stackVec, m_stackScores, *m_outColl);
+  }
+
+  if (endPos < m_lastPos) {
+    if (i + 1 < nodes.size()) {
+      AddAndExtendMatches(nodes, i + 1, startPos);
+    }
+    if (!node->GetNonTerminalMap().empty()) {
+      GetNonTerminalExtension(node, endPos+1);
     }
   }
 }
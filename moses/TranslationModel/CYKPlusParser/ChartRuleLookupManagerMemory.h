@@ -23,6 +23,13 @@
 
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "ChartRuleLookupManagerCYKPlus.h"
 #include "CompletedRuleCollection.h"
 #include "moses/NonTerminal.h"
@@ -36,6 +43,48 @@ namespace Moses
 class ChartParserCallback;
 class WordsRange;
 
+/** Terminal-only rule matches of one PhraseDictionaryMemory for the
+ *  sentences of a document (ContextScope), see document-cache: for the
+ *  source words from a start position to the last position the lookup
+ *  considers, the trie nodes reached from the root by the first one, two,
+ *  ... of them, up to the first that has no match. Repeated n-grams then
+ *  need no trie walk; the non-terminal extensions of the nodes still depend
+ *  on the chart and are looked up for every sentence. Shared by the
+ *  threads decoding sentences of the document.
+ */
+class TerminalMatchCache
+{
+public:
+  typedef std::vector<const PhraseDictionaryNodeMemory*> Nodes;
+
+  TerminalMatchCache() : m_maxSize(0) {}
+
+  void SetMaxSize(size_t maxSize) {
+    m_maxSize = maxSize;
+  }
+
+  //! the nodes for words, NULL if they are not cached
+  boost::shared_ptr<const Nodes> Get(const std::vector<Word> &words) const;
+  //! remembers nodes for words, unless the cache is full
+  void Put(const std::vector<Word> &words, const boost::shared_ptr<const Nodes> &nodes);
+
+private:
+  struct WordsHasher {
+    size_t operator()(const std::vector<Word> &words) const;
+  };
+  struct WordsEqualityPred {
+    bool operator()(const std::vector<Word> &a, const std::vector<Word> &b) const;
+  };
+  typedef boost::unordered_map<std::vector<Word>, boost::shared_ptr<const Nodes>,
+          WordsHasher, WordsEqualityPred> Map;
+
+  Map m_matches;
+  size_t m_maxSize;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_mutex;
+#endif
+};
+
 //! Implementation of ChartRuleLookupManager for in-memory rule tables.
 class ChartRuleLookupManagerMemory : public ChartRuleLookupManagerCYKPlus
 {
@@ -61,6 +110,19 @@ private:
     const PhraseDictionaryNodeMemory *node,
     size_t pos);
 
+  //! the child of node for the source word at pos, NULL if none
+  const PhraseDictionaryNodeMemory *FindTerminalChild(
+    const PhraseDictionaryNodeMemory *node,
+    size_t pos) const;
+
+  //! the terminal-only matches starting at startPos, from m_documentCache
+  boost::shared_ptr<const TerminalMatchCache::Nodes> GetTerminalMatches(size_t startPos);
+
+  //! AddAndExtend() for nodes[i], ending at startPos + i, taking the
+  //! terminal extensions from nodes
+  void AddAndExtendMatches(const TerminalMatchCache::Nodes &nodes,
+                           size_t i, size_t startPos);
+
   void GetNonTerminalExtension(
     const PhraseDictionaryNodeMemory *node,
     size_t startPos);
@@ -92,6 +154,9 @@ private:
 
   std::vector<CompressedMatrix> m_compressedMatrixVec;
 
+  //! NULL unless document-cache is set and the input has a scope
+  boost::shared_ptr<TerminalMatchCache> m_documentCache;
+
 
 };
 
@@ -151,12 +151,11 @@ void ChartRuleLookupManagerMemoryPerSentence::UpdateCompressedMatrix(size_t star
     }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+    const std::vector<size_t> &labelIds = targetNonTerms.GetLabelIds();
+    for (std::vector<size_t>::const_iterator i = labelIds.begin(); i != labelIds.end(); ++i) {
+      const ChartCellLabel *cellLabel = targetNonTerms.Find(*i);
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[*i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
@@ -76,13 +76,11 @@ GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
 
   size_t index = m_hash[key];
   if(m_hash.GetSize() != index) {
-    std::string scoresString;
-    if(m_inMemory)
-      scoresString = m_scoresMemory[index];
-    else
-      scoresString = m_scoresMapped[index];
+    // decode straight from the table's memory instead of a copy of it
+    ValueIteratorRange<const unsigned char *> scoresString
+      = m_inMemory ? m_scoresMemory[index] : m_scoresMapped[index];
 
-    BitWrapper<> bitStream(scoresString);
+    BitWrapper<ValueIteratorRange<const unsigned char *> > bitStream(scoresString);
     for(size_t i = 0; i < m_numScoreComponent; i++)
       scores.push_back(m_scoreTrees[m_multipleScoreTrees ? i : 0]->Read(bitStream));
 
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "PhraseDecoder.h"
 #include "moses/StaticData.h"
+#include "moses/LM/PrecomputedScores.h"
 
 using namespace std;
 
@@ -38,6 +39,7 @@ PhraseDecoder::PhraseDecoder(
 )
   : m_coding(None), m_numScoreComponent(numScoreComponent),
     m_containsAlignmentInfo(true), m_maxRank(0),
+    m_sourceRemap(unsigned(-1)),
     m_symbolTree(0), m_multipleScoreTrees(false),
     m_scoreTrees(1), m_alignTree(0),
     m_phraseDictionary(phraseDictionary), m_input(input), m_output(output),
@@ -47,6 +49,14 @@ PhraseDecoder::PhraseDecoder(
 
 PhraseDecoder::~PhraseDecoder()
 {
+  IFVERBOSE(2) {
+    size_t hits = m_decodingCache.GetHits();
+    size_t misses = m_decodingCache.GetMisses();
+    if(hits + misses)
+      TRACE_ERR("Compact phrase table decoding cache: " << hits << " hits, "
+                << misses << " misses" << std::endl);
+  }
+
   if(m_symbolTree)
     delete m_symbolTree;
 
@@ -70,6 +80,17 @@ inline unsigned PhraseDecoder::GetSourceSymbolId(std::string& symbol)
   return idx;
 }
 
+inline unsigned PhraseDecoder::GetSourceSymbolId(const Word &word)
+{
+  if(!m_sourceRemap.Empty()) {
+    unsigned idx = m_sourceRemap.Lookup(word[(*m_input)[0]]);
+    if(idx != m_sourceRemap.GetUnknown())
+      return idx;
+  }
+  std::string sourceWord = word.GetString(*m_input, false);
+  return GetSourceSymbolId(sourceWord);
+}
+
 inline std::string PhraseDecoder::GetTargetSymbol(unsigned idx) const
 {
   if(idx < m_targetSymbols.size())
@@ -77,6 +98,45 @@ inline std::string PhraseDecoder::GetTargetSymbol(unsigned idx) const
   return std::string("##ERROR##");
 }
 
+inline void PhraseDecoder::AddTargetWord(TargetPhrase &phrase, unsigned idx) const
+{
+  const size_t numFactors = m_output->size();
+  if(idx < m_targetSymbols.size() && m_targetFactors[idx * numFactors]) {
+    Word &word = phrase.AddWord();
+    for(size_t i = 0; i < numFactors; i++)
+      word.SetFactor((*m_output)[i], m_targetFactors[idx * numFactors + i]);
+    return;
+  }
+  Word word;
+  word.CreateFromString(Output, *m_output, GetTargetSymbol(idx), false);
+  phrase.AddWord(word);
+}
+
+// The symbols become factors once here instead of on every decoding.
+void PhraseDecoder::BuildRemaps()
+{
+  if(m_coding == REnc && m_input->size() == 1) {
+    for(size_t i = 0; i < m_sourceSymbols.size(); i++) {
+      std::string symbol = m_sourceSymbols[i];
+      m_sourceRemap.Add(symbol, i);
+    }
+  }
+
+  const size_t numFactors = m_output->size();
+  m_targetFactors.resize(m_targetSymbols.size() * numFactors);
+  for(size_t i = 0; i < m_targetSymbols.size(); i++) {
+    Word word;
+    try {
+      word.CreateFromString(Output, *m_output, GetTargetSymbol(i), false);
+    } catch (const util::Exception &) {
+      // left NULL: decoding it throws as before
+      continue;
+    }
+    for(size_t k = 0; k < numFactors; k++)
+      m_targetFactors[i * numFactors + k] = word[(*m_output)[k]];
+  }
+}
+
 inline size_t PhraseDecoder::GetREncType(unsigned encodedSymbol)
 {
   return (encodedSymbol >> 30) + 1;
@@ -181,6 +241,8 @@ size_t PhraseDecoder::Load(std::FILE* in)
   if(m_containsAlignmentInfo)
     m_alignTree = new CanonicalHuffman<AlignPoint>(in);
 
+  BuildRemaps();
+
   size_t end = std::ftell(in);
   return end - start;
 }
@@ -190,6 +252,12 @@ std::string PhraseDecoder::MakeSourceKey(std::string &source)
   return source + m_separator;
 }
 
+size_t PhraseDecoder::GetSourcePhraseId(const Phrase &sourcePhrase)
+{
+  std::string sourcePhraseString = sourcePhrase.GetStringRep(*m_input);
+  return m_phraseDictionary.m_hash[MakeSourceKey(sourcePhraseString)];
+}
+
 TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &sourcePhrase, bool topLevel, bool eval)
 {
 
@@ -217,18 +285,17 @@ TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &
   }
 
   // Retrieve source phrase identifier
-  std::string sourcePhraseString = sourcePhrase.GetStringRep(*m_input);
-  size_t sourcePhraseId = m_phraseDictionary.m_hash[MakeSourceKey(sourcePhraseString)];
+  size_t sourcePhraseId = GetSourcePhraseId(sourcePhrase);
 
   if(sourcePhraseId != m_phraseDictionary.m_hash.GetSize()) {
-    // Retrieve compressed and encoded target phrase collection
-    std::string encodedPhraseCollection;
-    if(m_phraseDictionary.m_inMemory)
-      encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMemory[sourcePhraseId];
-    else
-      encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMapped[sourcePhraseId];
-
-    BitWrapper<> encodedBitStream(encodedPhraseCollection);
+    // Retrieve compressed and encoded target phrase collection, decoding
+    // straight from the table's memory instead of a copy of it
+    EncodedRange encodedPhraseCollection
+      = m_phraseDictionary.m_inMemory
+        ? m_phraseDictionary.m_targetPhrasesMemory[sourcePhraseId]
+        : m_phraseDictionary.m_targetPhrasesMapped[sourcePhraseId];
+
+    BitWrapper<EncodedRange> encodedBitStream(encodedPhraseCollection);
     if(m_coding == PREnc && bitsLeft)
       encodedBitStream.SeekFromEnd(bitsLeft);
 
@@ -242,7 +309,7 @@ TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &
 }
 
 TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
-  TargetPhraseVectorPtr tpv, BitWrapper<> &encodedBitStream,
+  TargetPhraseVectorPtr tpv, BitWrapper<EncodedRange> &encodedBitStream,
   const Phrase &sourcePhrase, bool topLevel, bool eval)
 {
 
@@ -253,12 +320,8 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
 
   std::vector<int> sourceWords;
   if(m_coding == REnc) {
-    for(size_t i = 0; i < sourcePhrase.GetSize(); i++) {
-      std::string sourceWord
-      = sourcePhrase.GetWord(i).GetString(*m_input, false);
-      unsigned idx = GetSourceSymbolId(sourceWord);
-      sourceWords.push_back(idx);
-    }
+    for(size_t i = 0; i < sourcePhrase.GetSize(); i++)
+      sourceWords.push_back(GetSourceSymbolId(sourcePhrase.GetWord(i)));
   }
 
   unsigned phraseStopSymbol = 0;
@@ -291,12 +354,11 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
         state = Score;
       } else {
         if(m_coding == REnc) {
-          std::string wordString;
+          unsigned targetSymbol = 0;
           size_t type = GetREncType(symbol);
 
           if(type == 1) {
-            unsigned decodedSymbol = DecodeREncSymbol1(symbol);
-            wordString = GetTargetSymbol(decodedSymbol);
+            targetSymbol = DecodeREncSymbol1(symbol);
           } else if (type == 2) {
             size_t rank = DecodeREncSymbol2Rank(symbol);
             size_t srcPos = DecodeREncSymbol2Position(symbol);
@@ -304,7 +366,7 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
             if(srcPos >= sourceWords.size())
               return TargetPhraseVectorPtr();
 
-            wordString = GetTargetSymbol(GetTranslation(sourceWords[srcPos], rank));
+            targetSymbol = GetTranslation(sourceWords[srcPos], rank);
             if(m_phraseDictionary.m_useAlignmentInfo) {
               size_t trgPos = targetPhrase->GetSize();
               alignment.insert(AlignPoint(srcPos, trgPos));
@@ -316,25 +378,21 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
             if(srcPos >= sourceWords.size())
               return TargetPhraseVectorPtr();
 
-            wordString = GetTargetSymbol(GetTranslation(sourceWords[srcPos], rank));
+            targetSymbol = GetTranslation(sourceWords[srcPos], rank);
             if(m_phraseDictionary.m_useAlignmentInfo) {
               size_t trgPos = srcPos;
               alignment.insert(AlignPoint(srcPos, trgPos));
             }
+          } else {
+            // never written by the encoder
+            return TargetPhraseVectorPtr();
           }
 
-          Word word;
-          word.CreateFromString(Output, *m_output, wordString, false);
-          targetPhrase->AddWord(word);
+          AddTargetWord(*targetPhrase, targetSymbol);
         } else if(m_coding == PREnc) {
           // if the symbol is just a word
           if(GetPREncType(symbol) == 1) {
-            unsigned decodedSymbol = DecodePREncSymbol1(symbol);
-
-            Word word;
-            word.CreateFromString(Output, *m_output,
-                                  GetTargetSymbol(decodedSymbol), false);
-            targetPhrase->AddWord(word);
+            AddTargetWord(*targetPhrase, DecodePREncSymbol1(symbol));
           }
           // if the symbol is a subphrase pointer
           else {
@@ -383,10 +441,7 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
               return TargetPhraseVectorPtr();
           }
         } else {
-          Word word;
-          word.CreateFromString(Output, *m_output,
-                                GetTargetSymbol(symbol), false);
-          targetPhrase->AddWord(word);
+          AddTargetWord(*targetPhrase, symbol);
         }
       }
     } else if(state == Score) {
@@ -395,6 +450,11 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
       scores.push_back(score);
 
       if(scores.size() == m_numScoreComponent) {
+        if(m_phraseDictionary.m_lmFingerprint) {
+          size_t numTableScores = m_numScoreComponent - PrecomputedLMScorer::kNumScores;
+          m_phraseDictionary.SetLMScores(*targetPhrase, &scores[numTableScores]);
+          scores.resize(numTableScores);
+        }
         targetPhrase->GetScoreBreakdown().Assign(&m_phraseDictionary, scores);
 
         if(m_containsAlignmentInfo)
@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "moses/TypeDef.h"
 #include "moses/FactorCollection.h"
+#include "moses/VocabRemap.h"
 #include "moses/Word.h"
 #include "moses/Util.h"
 #include "moses/InputFileStream.h"
@@ -57,6 +58,8 @@ protected:
 
   typedef std::pair<unsigned char, unsigned char> AlignPoint;
   typedef std::pair<unsigned, unsigned> SrcTrg;
+  // read-only view of one encoded target phrase collection
+  typedef ValueIteratorRange<const unsigned char *> EncodedRange;
 
   enum Coding { None, REnc, PREnc } m_coding;
 
@@ -69,6 +72,12 @@ protected:
   StringVector<unsigned char, unsigned, std::allocator> m_sourceSymbols;
   StringVector<unsigned char, unsigned, std::allocator> m_targetSymbols;
 
+  // source symbol of each factor, built at load with a single input factor
+  VocabRemap<unsigned> m_sourceRemap;
+  /** the factors of target symbol i in the order of m_output, from
+   *  i * m_output->size(); NULL for symbols that fail to parse */
+  std::vector<const Factor*> m_targetFactors;
+
   std::vector<size_t> m_lexicalTableIndex;
   std::vector<SrcTrg> m_lexicalTable;
 
@@ -94,7 +103,11 @@ protected:
   // ***********************************************
 
   unsigned GetSourceSymbolId(std::string& s);
+  unsigned GetSourceSymbolId(const Word &word);
   std::string GetTargetSymbol(unsigned id) const;
+  //! appends target symbol id to phrase
+  void AddTargetWord(TargetPhrase &phrase, unsigned id) const;
+  void BuildRemaps();
 
   size_t GetREncType(unsigned encodedSymbol);
   size_t GetPREncType(unsigned encodedSymbol);
@@ -129,11 +142,14 @@ public:
 
   size_t Load(std::FILE* in);
 
+  //! index of the source phrase in the table, the size of the hash if absent
+  size_t GetSourcePhraseId(const Phrase &sourcePhrase);
+
   TargetPhraseVectorPtr CreateTargetPhraseCollection(const Phrase &sourcePhrase,
       bool topLevel = false, bool eval = true);
 
   TargetPhraseVectorPtr DecodeCollection(TargetPhraseVectorPtr tpv,
-                                         BitWrapper<> &encodedBitStream,
+                                         BitWrapper<EncodedRange> &encodedBitStream,
                                          const Phrase &sourcePhrase,
                                          bool topLevel,
                                          bool eval);
@@ -33,9 +33,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/Util.h"
 #include "moses/InputFileStream.h"
 #include "moses/StaticData.h"
+#include "moses/MemoryReport.h"
 #include "moses/WordsRange.h"
 #include "moses/ThreadPool.h"
 #include "util/exception.hh"
+#include "util/mmap.hh"
 
 using namespace std;
 using namespace boost::algorithm;
@@ -50,6 +52,7 @@ PhraseDictionaryCompact::PhraseDictionaryCompact(const std::string &line)
   ,m_hash(10, 16)
   ,m_phraseDecoder(0)
   ,m_weight(0)
+  ,m_loadedBytes(0)
 {
   ReadParameters();
 }
@@ -69,6 +72,12 @@ void PhraseDictionaryCompact::Load()
   if (!FileExists(tFilePath))
     throw runtime_error("Error: File " + tFilePath + " does not exist.");
 
+  // written by processPhraseTableMin -lm, their scores follow those of the table
+  std::ifstream lmFile((tFilePath + ".lm").c_str());
+  if (lmFile) {
+    lmFile >> m_lmFingerprint;
+  }
+
   m_phraseDecoder = new PhraseDecoder(*this, &m_input, &m_output,
                                       m_numScoreComponents, &m_weight);
 
@@ -88,12 +97,33 @@ void PhraseDictionaryCompact::Load()
   if(m_inMemory)
     // Load target phrase collections into memory
     phraseSize = m_targetPhrasesMemory.load(pFile, false);
-  else
+  else {
     // Keep target phrase collections on disk
     phraseSize = m_targetPhrasesMapped.load(pFile, true);
+    if(m_targetPhrasesMapped.size())
+      util::AdviseMapping(m_targetPhrasesMapped.begin(0),
+                          m_targetPhrasesMapped.size2(), m_mmapAdvice);
+  }
 
   UTIL_THROW_IF2(indexSize == 0 || coderSize == 0 || phraseSize == 0,
                  "Not successfully loaded");
+
+  m_loadedBytes = indexSize + coderSize + (m_inMemory ? phraseSize : 0);
+}
+
+void PhraseDictionaryCompact::ReportMemory(MemoryUsage &usage) const
+{
+  PhraseDictionary::ReportMemory(usage);
+  usage.heap += m_loadedBytes;
+  if(!m_inMemory && m_targetPhrasesMapped.size())
+    usage.AddMapped(m_targetPhrasesMapped.begin(0), m_targetPhrasesMapped.size2());
+
+  usage.cache += m_frozenCache.GetBytes();
+  usage.cacheEntries += m_frozenCache.GetSize();
+  if(m_phraseDecoder) {
+    usage.cache += m_phraseDecoder->m_decodingCache.GetBytes();
+    usage.cacheEntries += m_phraseDecoder->m_decodingCache.GetSize();
+  }
 }
 
 // now properly declared in TargetPhraseCollection.h
@@ -113,6 +143,27 @@ PhraseDictionaryCompact::GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &s
   if(sourcePhrase.GetSize() > m_phraseDecoder->GetMaxSourcePhraseLength())
     return NULL;
 
+  if(m_frozenWeights) {
+    // Future scores don't change, so select and sort the best phrases
+    // once, and only copy them from then on
+    TargetPhraseVectorPtr best = m_frozenCache.Retrieve(sourcePhrase).first;
+    if(best == NULL) {
+      TargetPhraseVectorPtr decodedPhraseColl
+      = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, true);
+      best = decodedPhraseColl != NULL ? SelectBest(*decodedPhraseColl)
+             : TargetPhraseVectorPtr(new TargetPhraseVector());
+      m_frozenCache.Cache(sourcePhrase, best);
+    }
+    if(best->empty())
+      return NULL;
+
+    TargetPhraseCollection* phraseColl = new TargetPhraseCollection();
+    for(TargetPhraseVector::const_iterator it = best->begin(); it != best->end(); it++)
+      phraseColl->Add(new TargetPhrase(*it));
+    const_cast<PhraseDictionaryCompact*>(this)->CacheForCleanup(phraseColl);
+    return phraseColl;
+  }
+
   // Retrieve target phrase collection from phrase table
   TargetPhraseVectorPtr decodedPhraseColl
   = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, true);
@@ -139,6 +190,65 @@ PhraseDictionaryCompact::GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &s
     return NULL;
 }
 
+void
+PhraseDictionaryCompact::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
+{
+  // (source phrase id, path); the target phrases are stored by id
+  std::vector<std::pair<size_t, InputPath*> > found;
+  InputPathList::const_iterator iter;
+  for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
+    InputPath &inputPath = **iter;
+
+    // backoff
+    if (!SatisfyBackoff(inputPath)) {
+      continue;
+    }
+
+    const Phrase &phrase = inputPath.GetPhrase();
+    size_t sourcePhraseId = phrase.GetSize() > m_phraseDecoder->GetMaxSourcePhraseLength()
+                            ? m_hash.GetSize() : m_phraseDecoder->GetSourcePhraseId(phrase);
+    if (sourcePhraseId == m_hash.GetSize()) {
+      inputPath.SetTargetPhrases(*this, NULL, NULL);
+      continue;
+    }
+    if (m_inMemory) {
+      __builtin_prefetch(m_targetPhrasesMemory[sourcePhraseId].begin());
+    } else {
+      PhraseDecoder::EncodedRange range = m_targetPhrasesMapped[sourcePhraseId];
+      util::AdviseMapping(range.begin(), range.end() - range.begin(), util::ADVISE_WILLNEED);
+    }
+    found.push_back(std::make_pair(sourcePhraseId, &inputPath));
+  }
+
+  std::sort(found.begin(), found.end());
+  for (size_t i = 0; i < found.size(); ++i) {
+    InputPath &inputPath = *found[i].second;
+    const TargetPhraseCollection *targetPhrases = GetTargetPhraseCollectionLEGACY(inputPath.GetPhrase());
+    inputPath.SetTargetPhrases(*this, targetPhrases, NULL);
+  }
+}
+
+TargetPhraseVectorPtr
+PhraseDictionaryCompact::SelectBest(const TargetPhraseVector &tpv) const
+{
+  // sort pointers rather than copies of all phrases
+  std::vector<const TargetPhrase*> sorted;
+  sorted.reserve(tpv.size());
+  for(TargetPhraseVector::const_iterator it = tpv.begin(); it != tpv.end(); it++)
+    sorted.push_back(&*it);
+
+  std::vector<const TargetPhrase*>::iterator middle =
+    (m_tableLimit == 0 || sorted.size() < m_tableLimit) ?
+    sorted.end() : sorted.begin() + m_tableLimit;
+  std::partial_sort(sorted.begin(), middle, sorted.end(), CompareTargetPhrase());
+
+  TargetPhraseVectorPtr best(new TargetPhraseVector());
+  best->reserve(middle - sorted.begin());
+  for(std::vector<const TargetPhrase*>::iterator it = sorted.begin(); it != middle; it++)
+    best->push_back(**it);
+  return best;
+}
+
 TargetPhraseVectorPtr
 PhraseDictionaryCompact::GetTargetPhraseCollectionRaw(const Phrase &sourcePhrase) const
 {
@@ -180,6 +290,7 @@ void PhraseDictionaryCompact::CleanUpAfterSentenceProcessing(const InputType &so
     m_hash.KeepNLastRanges(0.01, 0.2);
 
   m_phraseDecoder->PruneCache();
+  m_frozenCache.Prune();
 
 #ifdef WITH_THREADS
   boost::mutex::scoped_lock lock(m_sentenceMutex);
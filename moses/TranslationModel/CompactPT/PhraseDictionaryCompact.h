@@ -67,6 +67,15 @@ protected:
   StringVector<unsigned char, size_t, std::allocator> m_targetPhrasesMemory;
 
   std::vector<float> m_weight;
+
+  //! bytes of the index, coder and in-memory phrases read by Load()
+  size_t m_loadedBytes;
+
+  //! with frozen-weights, the sorted table-limit best target phrases of
+  //! source phrases, empty if there are none
+  mutable TargetPhraseCollectionCache m_frozenCache;
+
+  TargetPhraseVectorPtr SelectBest(const TargetPhraseVector &tpv) const;
 public:
   PhraseDictionaryCompact(const std::string &line);
 
@@ -74,11 +83,17 @@ public:
 
   void Load();
 
+  //! finds all source phrases first and asks for their target phrases from
+  //! disk, then decodes them in the order they are stored
+  void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
+
   const TargetPhraseCollection* GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &source) const;
   TargetPhraseVectorPtr GetTargetPhraseCollectionRaw(const Phrase &source) const;
 
   void AddEquivPhrase(const Phrase &source, const TargetPhrase &targetPhrase);
 
+  void ReportMemory(MemoryUsage &usage) const;
+
   void CacheForCleanup(TargetPhraseCollection* tpc);
   void CleanUpAfterSentenceProcessing(const InputType &source);
 
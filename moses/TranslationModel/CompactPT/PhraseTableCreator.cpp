@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <cstdio>
+#include <fstream>
 
 #include "PhraseTableCreator.h"
 #include "ConsistentPhrases.h"
@@ -52,7 +53,9 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
                                        bool multipleScoreTrees,
                                        size_t quantize,
                                        size_t maxRank,
-                                       bool warnMe
+                                       bool warnMe,
+                                       std::string lmPath,
+                                       size_t lmFactor
 #ifdef WITH_THREADS
                                        , size_t threads
 #endif
@@ -64,9 +67,11 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_useAlignmentInfo(useAlignmentInfo),
     m_multipleScoreTrees(multipleScoreTrees),
     m_quantize(quantize), m_maxRank(maxRank),
+    m_lmScorer(lmPath.empty() ? NULL : new PrecomputedLMScorer(lmPath, lmFactor)),
+    m_numLMScores(lmPath.empty() ? 0 : PrecomputedLMScorer::kNumScores),
 #ifdef WITH_THREADS
     m_threads(threads),
-    m_srcHash(m_orderBits, m_fingerPrintBits, 1),
+    m_srcHash(m_orderBits, m_fingerPrintBits, m_threads),
     m_rnkHash(10, 24, m_threads),
 #else
     m_srcHash(m_orderBits, m_fingerPrintBits),
@@ -85,11 +90,11 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
   if(m_coding == PREnc)
     all_passes = 3;
 
-  m_scoreCounters.resize(m_multipleScoreTrees ? m_numScoreComponent : 1);
+  m_scoreCounters.resize(m_multipleScoreTrees ? m_numScoreComponent + m_numLMScores : 1);
   for(std::vector<ScoreCounter*>::iterator it = m_scoreCounters.begin();
       it != m_scoreCounters.end(); it++)
     *it = new ScoreCounter();
-  m_scoreTrees.resize(m_multipleScoreTrees ? m_numScoreComponent : 1);
+  m_scoreTrees.resize(m_multipleScoreTrees ? m_numScoreComponent + m_numLMScores : 1);
 
   // 0th pass
   if(m_coding == REnc) {
@@ -136,6 +141,11 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
 
   std::cerr << "Saving to " << m_outPath << std::endl;
   Save();
+  if(m_lmScorer) {
+    // read by PhraseDictionaryCompact, the LM uses the scores if it matches
+    std::ofstream lmFile((m_outPath + ".lm").c_str());
+    lmFile << m_lmScorer->GetFingerprint() << std::endl;
+  }
   std::cerr << "Done" << std::endl;
   std::fclose(m_outFile);
 }
@@ -172,6 +182,7 @@ void PhraseTableCreator::PrintInfo()
       std::cerr << m_maxRank << std::endl;
   }
   std::cerr << "\tNumber of score components in phrase table: " << m_numScoreComponent << std::endl;
+  std::cerr << "\tPhrase-internal LM scores stored after them: " << (m_lmScorer ? "yes" : "no") << std::endl;
   std::cerr << "\tSingle Huffman code set for score components: " << (m_multipleScoreTrees ? "no" : "yes") << std::endl;
   std::cerr << "\tUsing score quantization: ";
   if(m_quantize)
@@ -190,7 +201,9 @@ void PhraseTableCreator::Save()
 {
   // Save type of encoding
   ThrowingFwrite(&m_coding, sizeof(m_coding), 1, m_outFile);
-  ThrowingFwrite(&m_numScoreComponent, sizeof(m_numScoreComponent), 1, m_outFile);
+  // the LM scores are read as scores of the table
+  size_t numScores = m_numScoreComponent + m_numLMScores;
+  ThrowingFwrite(&numScores, sizeof(numScores), 1, m_outFile);
   ThrowingFwrite(&m_useAlignmentInfo, sizeof(m_useAlignmentInfo), 1, m_outFile);
   ThrowingFwrite(&m_maxRank, sizeof(m_maxRank), 1, m_outFile);
   ThrowingFwrite(&m_maxPhraseLength, sizeof(m_maxPhraseLength), 1, m_outFile);
@@ -377,11 +390,43 @@ void PhraseTableCreator::CompressTargetPhrases()
   FlushCompressedQueue(true);
 }
 
-void PhraseTableCreator::CalcHuffmanCodes()
+#ifdef WITH_THREADS
+namespace
 {
-  std::cerr << "\tCreating Huffman codes for " << m_symbolCounter.Size()
-            << " target phrase symbols" << std::endl;
+// Quantizes a counter if asked and builds its Huffman code set. The code
+// sets do not depend on each other, so each can be built on its own thread.
+template <class Tree, class Count>
+class HuffmanTask
+{
+public:
+  HuffmanTask(Tree *&tree, Count &counter, size_t quantize = 0)
+    : m_tree(tree), m_counter(counter), m_quantize(quantize) {}
+
+  void operator()() {
+    if(m_quantize)
+      m_counter.Quantize(m_quantize);
+    m_tree = new Tree(m_counter.Begin(), m_counter.End());
+  }
+
+private:
+  Tree *&m_tree;
+  Count &m_counter;
+  size_t m_quantize;
+};
+}
+#endif
 
+void PhraseTableCreator::CalcHuffmanCodes()
+{
+#ifdef WITH_THREADS
+  boost::thread_group threads;
+  threads.create_thread(HuffmanTask<SymbolTree, SymbolCounter>(m_symbolTree, m_symbolCounter));
+  for(size_t i = 0; i < m_scoreCounters.size(); i++)
+    threads.create_thread(HuffmanTask<ScoreTree, ScoreCounter>(m_scoreTrees[i], *m_scoreCounters[i], m_quantize));
+  if(m_useAlignmentInfo)
+    threads.create_thread(HuffmanTask<AlignTree, AlignCounter>(m_alignTree, m_alignCounter));
+  threads.join_all();
+#else
   m_symbolTree = new SymbolTree(m_symbolCounter.Begin(),
                                 m_symbolCounter.End());
 
@@ -391,18 +436,23 @@ void PhraseTableCreator::CalcHuffmanCodes()
     if(m_quantize)
       (*it)->Quantize(m_quantize);
 
-    std::cerr << "\tCreating Huffman codes for " << (*it)->Size()
-              << " scores" << std::endl;
-
     *treeIt = new ScoreTree((*it)->Begin(), (*it)->End());
     treeIt++;
   }
 
-  if(m_useAlignmentInfo) {
-    std::cerr << "\tCreating Huffman codes for " << m_alignCounter.Size()
-              << " alignment points" << std::endl;
+  if(m_useAlignmentInfo)
     m_alignTree = new AlignTree(m_alignCounter.Begin(), m_alignCounter.End());
-  }
+#endif
+
+  std::cerr << "\tCreated Huffman codes for " << m_symbolCounter.Size()
+            << " target phrase symbols" << std::endl;
+  for(std::vector<ScoreCounter*>::iterator it = m_scoreCounters.begin();
+      it != m_scoreCounters.end(); it++)
+    std::cerr << "\tCreated Huffman codes for " << (*it)->Size()
+              << " scores" << std::endl;
+  if(m_useAlignmentInfo)
+    std::cerr << "\tCreated Huffman codes for " << m_alignCounter.Size()
+              << " alignment points" << std::endl;
   std::cerr << std::endl;
 }
 
@@ -692,6 +742,17 @@ void PhraseTableCreator::EncodeScores(std::vector<float>& scores, std::ostream&
   }
 }
 
+void PhraseTableCreator::EncodeLMScores(const std::string& targetPhrase, std::ostream& os)
+{
+  // already log probabilities, as the decoder's LM gives them
+  float scores[PrecomputedLMScorer::kNumScores];
+  m_lmScorer->Score(targetPhrase, scores);
+  for(size_t c = 0; c < m_numLMScores; c++) {
+    os.write((char*)&scores[c], sizeof(scores[c]));
+    m_scoreCounters[m_multipleScoreTrees ? m_numScoreComponent + c : 0]->Increase(scores[c]);
+  }
+}
+
 void PhraseTableCreator::EncodeAlignment(std::set<AlignPoint>& alignment,
     std::ostream& os)
 {
@@ -751,6 +812,8 @@ std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, siz
   }
 
   EncodeScores(scores, encodedTargetPhrase);
+  if(m_lmScorer)
+    EncodeLMScores(targetPhraseStr, encodedTargetPhrase);
 
   if(m_useAlignmentInfo)
     EncodeAlignment(a, encodedTargetPhrase);
@@ -793,7 +856,7 @@ std::string PhraseTableCreator::CompressEncodedCollection(std::string encodedCol
       state = EncodeSymbol;
       break;
     case ReadScore:
-      if(currScore == m_numScoreComponent) {
+      if(currScore == m_numScoreComponent + m_numLMScores) {
         currScore = 0;
         if(m_useAlignmentInfo)
           state = ReadAlignment;
@@ -28,10 +28,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <vector>
 #include <set>
 #include <boost/unordered_map.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "moses/InputFileStream.h"
 #include "moses/ThreadPool.h"
 #include "moses/Util.h"
+#include "moses/LM/PrecomputedScores.h"
 
 #include "BlockHashIndex.h"
 #include "StringVector.h"
@@ -199,6 +201,10 @@ private:
   size_t m_quantize;
   size_t m_maxRank;
 
+  // phrase-internal LM scores stored after those of the table, if any
+  boost::scoped_ptr<PrecomputedLMScorer> m_lmScorer;
+  size_t m_numLMScores;
+
   static std::string m_phraseStopSymbol;
   static std::string m_separator;
 
@@ -305,6 +311,7 @@ private:
                                std::ostream& os);
 
   void EncodeScores(std::vector<float>& scores, std::ostream& os);
+  void EncodeLMScores(const std::string& targetPhrase, std::ostream& os);
   void EncodeAlignment(std::set<AlignPoint>& alignment, std::ostream& os);
 
   std::string MakeSourceKey(std::string&);
@@ -342,7 +349,9 @@ public:
                      bool multipleScoreTrees = true,
                      size_t quantize = 0,
                      size_t maxRank = 100,
-                     bool warnMe = true
+                     bool warnMe = true,
+                     std::string lmPath = "",
+                     size_t lmFactor = 0
 #ifdef WITH_THREADS
                                    , size_t threads = 2
 #endif
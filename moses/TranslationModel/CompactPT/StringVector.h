@@ -48,6 +48,11 @@ private:
   ValueIteratorT m_end;
 
 public:
+  // Lets a range stand in for a read-only container, e.g. to run a
+  // BitWrapper directly over mapped memory without copying it.
+  typedef ValueIteratorT iterator;
+  typedef typename std::iterator_traits<ValueIteratorT>::value_type value_type;
+
   ValueIteratorRange(ValueIteratorT begin, ValueIteratorT end);
 
   const ValueIteratorT& begin() const;
@@ -57,7 +62,7 @@ public:
     return str();
   }
 
-  size_t size() {
+  size_t size() const {
     return std::distance(m_begin, m_end);
   }
 
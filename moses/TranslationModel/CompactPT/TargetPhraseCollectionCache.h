@@ -22,8 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_TargetPhraseCollectionCache_h
 #define moses_TargetPhraseCollectionCache_h
 
-#include <map>
-#include <set>
+#include <algorithm>
+#include <functional>
 #include <vector>
 
 #ifdef WITH_THREADS
@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "moses/Phrase.h"
 #include "moses/TargetPhraseCollection.h"
@@ -44,125 +45,242 @@ namespace Moses
 typedef std::vector<TargetPhrase> TargetPhraseVector;
 typedef boost::shared_ptr<TargetPhraseVector> TargetPhraseVectorPtr;
 
-/** Implementation of Persistent Cache **/
+/** Implementation of Persistent Cache.
+ *  Entries are hashed on the source phrase and spread over a fixed number of
+ *  independently locked shards, so concurrent lookups for different phrases
+ *  rarely contend. Each shard keeps its own share of the entry and byte
+ *  limits and is pruned on its own, least recently used entries first.
+ **/
 class TargetPhraseCollectionCache
 {
 private:
-  size_t m_max;
-  float m_tolerance;
+  static const size_t NumShards = 16;
 
   struct LastUsed {
-    clock_t m_clock;
+    size_t m_clock;
     TargetPhraseVectorPtr m_tpv;
     size_t m_bitsLeft;
+    size_t m_bytes;
 
-    LastUsed() : m_clock(0), m_bitsLeft(0) {}
+    LastUsed() : m_clock(0), m_bitsLeft(0), m_bytes(0) {}
 
-    LastUsed(clock_t clock, TargetPhraseVectorPtr tpv, size_t bitsLeft = 0)
-      : m_clock(clock), m_tpv(tpv), m_bitsLeft(bitsLeft) {}
+    LastUsed(size_t clock, TargetPhraseVectorPtr tpv, size_t bitsLeft,
+             size_t bytes)
+      : m_clock(clock), m_tpv(tpv), m_bitsLeft(bitsLeft), m_bytes(bytes) {}
   };
 
-  typedef std::map<Phrase, LastUsed> CacheMap;
+  //! hasher that hands back a hash computed once for shard selection
+  struct PrecomputedHash {
+    size_t m_hash;
+    PrecomputedHash(size_t hash) : m_hash(hash) {}
+    size_t operator()(const Phrase &) const {
+      return m_hash;
+    }
+  };
 
-  CacheMap m_phraseCache;
+  typedef boost::unordered_map<Phrase, LastUsed> CacheMap;
 
+  struct Shard {
+    CacheMap m_phraseCache;
+    size_t m_clock;
+    size_t m_bytes;
+    size_t m_hits;
+    size_t m_misses;
 #ifdef WITH_THREADS
-  boost::mutex m_mutex;
+    boost::mutex m_mutex;
 #endif
+    Shard() : m_clock(0), m_bytes(0), m_hits(0), m_misses(0) {}
+  };
 
-public:
-
-  typedef CacheMap::iterator iterator;
-  typedef CacheMap::const_iterator const_iterator;
+  size_t m_max;
+  float m_tolerance;
+  size_t m_maxBytes;
+  Shard m_shards[NumShards];
 
-  TargetPhraseCollectionCache(size_t max = 5000, float tolerance = 0.2)
-    : m_max(max), m_tolerance(tolerance) {
+  Shard &GetShard(size_t hash) {
+    return m_shards[(hash >> 8) % NumShards];
   }
 
-  iterator Begin() {
-    return m_phraseCache.begin();
+  static size_t EstimateSize(const Phrase &sourcePhrase,
+                             const TargetPhraseVector &tpv) {
+    size_t bytes = sizeof(LastUsed) + sizeof(Phrase)
+                   + sourcePhrase.GetSize() * sizeof(Word)
+                   + tpv.size() * sizeof(TargetPhrase);
+    for(TargetPhraseVector::const_iterator it = tpv.begin(); it != tpv.end(); ++it)
+      bytes += it->GetSize() * sizeof(Word);
+    return bytes;
   }
 
-  const_iterator Begin() const {
-    return m_phraseCache.begin();
-  }
+  //! shrink one shard to the lower end of its limits; caller holds the lock
+  void PruneShard(Shard &shard) {
+    size_t maxEntries = m_max / NumShards + 1;
+    size_t maxBytes = m_maxBytes / NumShards + 1;
+
+    bool overEntries = shard.m_phraseCache.size() > maxEntries * (1 + m_tolerance);
+    bool overBytes = m_maxBytes && shard.m_bytes > maxBytes * (1 + m_tolerance);
+    if(!overEntries && !overBytes)
+      return;
+
+    std::vector<size_t> clocks;
+    clocks.reserve(shard.m_phraseCache.size());
+    for(CacheMap::const_iterator it = shard.m_phraseCache.begin();
+        it != shard.m_phraseCache.end(); ++it)
+      clocks.push_back(it->second.m_clock);
+
+    // keep the most recently used entries, dropping by age until both
+    // limits are back under their lower bounds
+    size_t keep = std::min(clocks.size(),
+                           static_cast<size_t>(maxEntries * (1 - m_tolerance)));
+    if(overBytes && shard.m_bytes > 0) {
+      size_t targetBytes = static_cast<size_t>(maxBytes * (1 - m_tolerance));
+      size_t byBytes = clocks.size() * (double(targetBytes) / shard.m_bytes);
+      keep = std::min(keep, byBytes);
+    }
 
-  iterator End() {
-    return m_phraseCache.end();
+    if(keep == 0) {
+      shard.m_phraseCache.clear();
+      shard.m_bytes = 0;
+      return;
+    }
+
+    std::nth_element(clocks.begin(), clocks.end() - keep, clocks.end());
+    size_t threshold = *(clocks.end() - keep);
+
+    for(CacheMap::iterator it = shard.m_phraseCache.begin();
+        it != shard.m_phraseCache.end();) {
+      if(it->second.m_clock < threshold) {
+        shard.m_bytes -= it->second.m_bytes;
+        it = shard.m_phraseCache.erase(it);
+      } else
+        ++it;
+    }
   }
 
-  const_iterator End() const {
-    return m_phraseCache.end();
+public:
+
+  /** max is the total number of cached source phrases, maxBytes an optional
+   *  approximate memory budget (0 disables it) **/
+  TargetPhraseCollectionCache(size_t max = 5000, float tolerance = 0.2,
+                              size_t maxBytes = 0)
+    : m_max(max), m_tolerance(tolerance), m_maxBytes(maxBytes) {
   }
 
   /** retrieve translations for source phrase from persistent cache **/
   void Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
              size_t bitsLeft = 0, size_t maxRank = 0) {
+    size_t hash = hash_value(sourcePhrase);
+    Shard &shard = GetShard(hash);
+
+    // truncate outside of the lock
+    if(maxRank && tpv->size() > maxRank) {
+      TargetPhraseVectorPtr tpv_temp(new TargetPhraseVector());
+      tpv_temp->resize(maxRank);
+      std::copy(tpv->begin(), tpv->begin() + maxRank, tpv_temp->begin());
+      tpv = tpv_temp;
+    }
+
 #ifdef WITH_THREADS
-    boost::mutex::scoped_lock lock(m_mutex);
+    boost::mutex::scoped_lock lock(shard.m_mutex);
 #endif
 
     // check if source phrase is already in cache
-    iterator it = m_phraseCache.find(sourcePhrase);
-    if(it != m_phraseCache.end())
+    CacheMap::iterator it = shard.m_phraseCache.find(sourcePhrase,
+                            PrecomputedHash(hash), std::equal_to<Phrase>());
+    if(it != shard.m_phraseCache.end())
       // if found, just update clock
-      it->second.m_clock = clock();
+      it->second.m_clock = ++shard.m_clock;
     else {
       // else, add to cache
-      if(maxRank && tpv->size() > maxRank) {
-        TargetPhraseVectorPtr tpv_temp(new TargetPhraseVector());
-        tpv_temp->resize(maxRank);
-        std::copy(tpv->begin(), tpv->begin() + maxRank, tpv_temp->begin());
-        m_phraseCache[sourcePhrase] = LastUsed(clock(), tpv_temp, bitsLeft);
-      } else
-        m_phraseCache[sourcePhrase] = LastUsed(clock(), tpv, bitsLeft);
+      size_t bytes = EstimateSize(sourcePhrase, *tpv);
+      shard.m_phraseCache[sourcePhrase] = LastUsed(++shard.m_clock, tpv,
+                                          bitsLeft, bytes);
+      shard.m_bytes += bytes;
     }
   }
 
   std::pair<TargetPhraseVectorPtr, size_t> Retrieve(const Phrase &sourcePhrase) {
+    size_t hash = hash_value(sourcePhrase);
+    Shard &shard = GetShard(hash);
 #ifdef WITH_THREADS
-    boost::mutex::scoped_lock lock(m_mutex);
+    boost::mutex::scoped_lock lock(shard.m_mutex);
 #endif
 
-    iterator it = m_phraseCache.find(sourcePhrase);
-    if(it != m_phraseCache.end()) {
+    CacheMap::iterator it = shard.m_phraseCache.find(sourcePhrase,
+                            PrecomputedHash(hash), std::equal_to<Phrase>());
+    if(it != shard.m_phraseCache.end()) {
+      ++shard.m_hits;
       LastUsed &lu = it->second;
-      lu.m_clock = clock();
+      lu.m_clock = ++shard.m_clock;
       return std::make_pair(lu.m_tpv, lu.m_bitsLeft);
-    } else
+    } else {
+      ++shard.m_misses;
       return std::make_pair(TargetPhraseVectorPtr(), 0);
+    }
   }
 
   // if cache full, reduce
   void Prune() {
+    for(size_t i = 0; i < NumShards; ++i) {
 #ifdef WITH_THREADS
-    boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
 #endif
-
-    if(m_phraseCache.size() > m_max * (1 + m_tolerance)) {
-      typedef std::set<std::pair<clock_t, Phrase> > Cands;
-      Cands cands;
-      for(CacheMap::iterator it = m_phraseCache.begin();
-          it != m_phraseCache.end(); it++) {
-        LastUsed &lu = it->second;
-        cands.insert(std::make_pair(lu.m_clock, it->first));
-      }
-
-      for(Cands::iterator it = cands.begin(); it != cands.end(); it++) {
-        const Phrase& p = it->second;
-        m_phraseCache.erase(p);
-
-        if(m_phraseCache.size() < (m_max * (1 - m_tolerance)))
-          break;
-      }
+      PruneShard(m_shards[i]);
     }
   }
 
   void CleanUp() {
+    for(size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
+#endif
+      m_shards[i].m_phraseCache.clear();
+      m_shards[i].m_bytes = 0;
+    }
+  }
+
+  size_t GetHits() {
+    size_t hits = 0;
+    for(size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
+#endif
+      hits += m_shards[i].m_hits;
+    }
+    return hits;
+  }
+
+  size_t GetMisses() {
+    size_t misses = 0;
+    for(size_t i = 0; i < NumShards; ++i) {
 #ifdef WITH_THREADS
-    boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
 #endif
-    m_phraseCache.clear();
+      misses += m_shards[i].m_misses;
+    }
+    return misses;
+  }
+
+  //! estimated bytes of the cached phrases
+  size_t GetBytes() {
+    size_t bytes = 0;
+    for(size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
+#endif
+      bytes += m_shards[i].m_bytes;
+    }
+    return bytes;
+  }
+
+  size_t GetSize() {
+    size_t size = 0;
+    for(size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_shards[i].m_mutex);
+#endif
+      size += m_shards[i].m_phraseCache.size();
+    }
+    return size;
   }
 
 };
@@ -1,12 +1,146 @@
 #include "DynSuffixArray.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <boost/foreach.hpp>
+#include "util/exception.hh"
 
 using namespace std;
 
 namespace Moses
 {
 
+namespace
+{
+// Suffix sorting by induced sorting (SA-IS; Nong, Zhang and Chan, 2009),
+// linear in the length of the text. s[0..n) has the values 0..K, and
+// s[n-1] == 0 is a sentinel that occurs nowhere else.
+
+template<typename T>
+void GetBuckets(const T *s, int *bkt, int n, int K, bool end)
+{
+  std::fill(bkt, bkt + K + 1, 0);
+  for (int i = 0; i < n; ++i) ++bkt[s[i]];
+  int sum = 0;
+  for (int i = 0; i <= K; ++i) {
+    sum += bkt[i];
+    bkt[i] = end ? sum : sum - bkt[i];
+  }
+}
+
+template<typename T>
+void InduceL(const vector<bool> &t, int *SA, const T *s, int *bkt, int n, int K)
+{
+  GetBuckets(s, bkt, n, K, false);
+  for (int i = 0; i < n; ++i) {
+    int j = SA[i] - 1;
+    if (SA[i] > 0 && !t[j]) SA[bkt[s[j]]++] = j;
+  }
+}
+
+template<typename T>
+void InduceS(const vector<bool> &t, int *SA, const T *s, int *bkt, int n, int K)
+{
+  GetBuckets(s, bkt, n, K, true);
+  for (int i = n - 1; i >= 0; --i) {
+    int j = SA[i] - 1;
+    if (SA[i] > 0 && t[j]) SA[--bkt[s[j]]] = j;
+  }
+}
+
+template<typename T>
+void SAIS(const T *s, int *SA, int n, int K)
+{
+  // t[i]: suffix i is S-type (smaller than suffix i+1)
+  vector<bool> t(n);
+  t[n-1] = true;
+  for (int i = n - 2; i >= 0; --i)
+    t[i] = s[i] < s[i+1] || (s[i] == s[i+1] && t[i+1]);
+#define IS_LMS(i) ((i) > 0 && t[i] && !t[(i)-1])
+
+  // sort the LMS substrings
+  vector<int> bkt(K + 1);
+  GetBuckets(s, &bkt[0], n, K, true);
+  std::fill(SA, SA + n, -1);
+  for (int i = 1; i < n; ++i)
+    if (IS_LMS(i)) SA[--bkt[s[i]]] = i;
+  InduceL(t, SA, s, &bkt[0], n, K);
+  InduceS(t, SA, s, &bkt[0], n, K);
+
+  // name them, equal substrings get equal names
+  int n1 = 0;
+  for (int i = 0; i < n; ++i)
+    if (IS_LMS(SA[i])) SA[n1++] = SA[i];
+  std::fill(SA + n1, SA + n, -1);
+  int name = 0, prev = -1;
+  for (int i = 0; i < n1; ++i) {
+    int pos = SA[i];
+    bool diff = false;
+    for (int d = 0; ; ++d) {
+      if (prev == -1 || s[pos+d] != s[prev+d] || t[pos+d] != t[prev+d]) {
+        diff = true;
+        break;
+      } else if (d > 0 && (IS_LMS(pos+d) || IS_LMS(prev+d))) {
+        break;
+      }
+    }
+    if (diff) {
+      ++name;
+      prev = pos;
+    }
+    SA[n1 + pos / 2] = name - 1;
+  }
+  for (int i = n - 1, j = n - 1; i >= n1; --i)
+    if (SA[i] >= 0) SA[j--] = SA[i];
+
+  // sort the reduced problem, recursively if names repeat
+  int *s1 = SA + n - n1, *SA1 = SA;
+  if (name < n1) {
+    SAIS(s1, SA1, n1, name - 1);
+  } else {
+    for (int i = 0; i < n1; ++i) SA1[s1[i]] = i;
+  }
+
+  // induce the order of all suffixes from the sorted LMS suffixes
+  GetBuckets(s, &bkt[0], n, K, true);
+  for (int i = 1, j = 0; i < n; ++i)
+    if (IS_LMS(i)) s1[j++] = i;
+  for (int i = 0; i < n1; ++i) SA1[i] = s1[SA1[i]];
+  std::fill(SA + n1, SA + n, -1);
+  for (int i = n1 - 1; i >= 0; --i) {
+    int j = SA[i];
+    SA[i] = -1;
+    SA[--bkt[s[j]]] = j;
+  }
+  InduceL(t, SA, s, &bkt[0], n, K);
+  InduceS(t, SA, s, &bkt[0], n, K);
+#undef IS_LMS
+}
+}
+
+void
+BuildSuffixArray(const vuint_t &corpus, vuint_t &sa)
+{
+  UTIL_THROW_IF2(corpus.size() >= size_t(std::numeric_limits<int>::max()),
+                 "Corpus too large for a suffix array: " << corpus.size() << " words");
+  const int n = corpus.size();
+  sa.clear();
+  if (n == 0) return;
+
+  // word ids + 1 and a sentinel, so that a suffix that is a prefix of
+  // another sorts first
+  vector<int> s(n + 1);
+  int K = 0;
+  for (int i = 0; i < n; ++i) {
+    s[i] = corpus[i] + 1;
+    K = std::max(K, s[i]);
+  }
+  s[n] = 0;
+  vector<int> SA(n + 1);
+  SAIS(&s[0], &SA[0], n + 1, K);
+  sa.assign(SA.begin() + 1, SA.end());
+}
+
 DynSuffixArray::DynSuffixArray()
 {
   m_SA = new vuint_t();
@@ -26,23 +160,25 @@ DynSuffixArray::~DynSuffixArray()
 
 DynSuffixArray::DynSuffixArray(vuint_t* crp)
 {
-  // make native int array and pass to SA builder
   m_corpus = crp;
-  int size = m_corpus->size();
-  int* tmpArr = new int[size];
-  for(int i=0 ; i < size; ++i) tmpArr[i] = i;
-
-  Qsort(tmpArr, 0, size-1);
-
-  m_SA = new vuint_t(tmpArr, tmpArr + size);
-  //std::cerr << "printing SA " << std::endl;
-  //for(int i=0; i < size; ++i) std::cerr << m_SA->at(i) << std::endl;
-  delete[] tmpArr;
-  std::cerr << "DYNAMIC SUFFIX ARRAY CLASS INSTANTIATED WITH SIZE " << size << std::endl;
+  m_SA = new vuint_t();
+  BuildSuffixArray(*m_corpus, *m_SA);
+  std::cerr << "DYNAMIC SUFFIX ARRAY CLASS INSTANTIATED WITH SIZE " << m_SA->size() << std::endl;
   BuildAuxArrays();
   //printAuxArrays();
 }
 
+DynSuffixArray::DynSuffixArray(vuint_t* crp, FILE* fin)
+{
+  m_corpus = crp;
+  m_SA = new vuint_t();
+  fReadVector(fin, *m_SA);
+  UTIL_THROW_IF2(m_SA->size() != m_corpus->size(),
+                 "Saved suffix array has " << m_SA->size() << " entries for a corpus of "
+                 << m_corpus->size() << " words");
+  BuildAuxArrays();
+}
+
 void DynSuffixArray::BuildAuxArrays()
 {
   int size = m_SA->size();
@@ -50,11 +186,11 @@ void DynSuffixArray::BuildAuxArrays()
   m_F = new vuint_t(size);
   m_L = new vuint_t(size);
 
+  const vuint_t &sa = *m_SA, &corpus = *m_corpus;
   for(int i=0; i < size; ++i) {
-    m_ISA->at(m_SA->at(i)) = i;
-    //(*m_ISA)[(*m_SA)[i]] = i;
-    (*m_F)[i] = (*m_corpus)[m_SA->at(i)];
-    (*m_L)[i] = (*m_corpus)[(m_SA->at(i) == 0 ? size-1 : m_SA->at(i)-1)];
+    (*m_ISA)[sa[i]] = i;
+    (*m_F)[i] = corpus[sa[i]];
+    (*m_L)[i] = corpus[(sa[i] == 0 ? size-1 : sa[i]-1)];
   }
 }
 
@@ -301,53 +437,4 @@ void DynSuffixArray::Load(FILE* fin)
   fReadVector(fin, *m_SA);
 }
 
-int DynSuffixArray::Compare(int pos1, int pos2, int max)
-{
-  for (size_t i = 0; i < (unsigned)max; ++i) {
-    if((pos1 + i < m_corpus->size()) && (pos2 + i >= m_corpus->size()))
-      return 1;
-    if((pos2 + i < m_corpus->size()) && (pos1 + i >= m_corpus->size()))
-      return -1;
-
-    int diff = m_corpus->at(pos1+i) - m_corpus->at(pos2+i);
-    if(diff != 0) return diff;
-  }
-  return 0;
-}
-
-void DynSuffixArray::Qsort(int* array, int begin, int end)
-{
-  if(end > begin) {
-    int index;
-    {
-      index = begin + (rand() % (end - begin + 1));
-      int pivot = array[index];
-      {
-        int tmp = array[index];
-        array[index] = array[end];
-        array[end] = tmp;
-      }
-      for(int i=index=begin; i < end; ++i) {
-        if (Compare(array[i], pivot, 20) <= 0) {
-          {
-            int tmp = array[index];
-            array[index] = array[i];
-            array[i] = tmp;
-            index++;
-          }
-        }
-      }
-      {
-        int tmp = array[index];
-        array[index] = array[end];
-        array[end] = tmp;
-      }
-    }
-    Qsort(array, begin, index - 1);
-    Qsort(array, index + 1,  end);
-  }
-}
-
-
-
 } // end namespace
@@ -14,6 +14,9 @@ namespace Moses
 using namespace std;
 typedef std::vector<unsigned> vuint_t;
 
+//! sorts the suffixes of corpus into sa, in linear time (SA-IS)
+void BuildSuffixArray(const vuint_t &corpus, vuint_t &sa);
+
 
 /// compare position /i/ in the suffix array /m_sfa/ into corpus /m_crp/
 /// against reference phrase /phrase/
@@ -38,6 +41,8 @@ class DynSuffixArray
 public:
   DynSuffixArray();
   DynSuffixArray(vuint_t*);
+  //! with the suffix array written by Save()
+  DynSuffixArray(vuint_t*, FILE*);
   ~DynSuffixArray();
   bool GetCorpusIndex(const vuint_t*, vuint_t*);
   void Load(FILE*);
@@ -55,8 +60,6 @@ private:
   vuint_t* m_L;
   vuint_t* m_corpus;
   void BuildAuxArrays();
-  void Qsort(int* array, int begin, int end);
-  int Compare(int, int, int);
   void Reorder(unsigned, unsigned);
   int LastFirstFunc(unsigned);
   int Rank(unsigned, unsigned);
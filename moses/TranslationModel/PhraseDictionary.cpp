@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <queue>
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/StaticData.h"
@@ -27,7 +28,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/DecodeStep.h"
 #include "moses/DecodeGraph.h"
 #include "moses/InputPath.h"
+#include "moses/DecodeProfile.h"
+#include "moses/MemoryReport.h"
+#include "moses/LM/PrecomputedScores.h"
 #include "util/exception.hh"
+#include "util/mmap.hh"
 
 using namespace std;
 
@@ -42,12 +47,18 @@ CacheColl::~CacheColl()
     const TargetPhraseCollection *tps = key.first;
     delete tps;
   }
+  RemoveAllInColl(m_replaced);
 }
 
 PhraseDictionary::PhraseDictionary(const std::string &line)
   :DecodeFeature(line)
   ,m_tableLimit(20) // default
+  ,m_frozenWeights(false)
+  ,m_mmapAdvice(util::ADVISE_NONE)
+  ,m_lmFingerprint(0)
   ,m_maxCacheSize(DEFAULT_MAX_TRANS_OPT_CACHE_SIZE)
+  ,m_sharedCache(false)
+  ,m_maxCacheMemory(256 * 1024 * 1024)
 {
   m_id = s_staticColl.size();
   s_staticColl.push_back(this);
@@ -64,28 +75,17 @@ const TargetPhraseCollection *PhraseDictionary::GetTargetPhraseCollectionLEGACY(
 {
   const TargetPhraseCollection *ret;
   if (m_maxCacheSize) {
-    CacheColl &cache = GetCache();
-
     size_t hash = hash_value(src);
 
-    CacheColl::iterator iter;
-    iter = cache.find(hash);
-
-    if (iter == cache.end()) {
+    bool found;
+    ret = GetFromCache(hash, found);
+    if (!found) {
       // not in cache, need to look up from phrase table
       ret = GetTargetPhraseCollectionNonCacheLEGACY(src);
       if (ret) {
         ret = new TargetPhraseCollection(*ret);
       }
-
-      std::pair<const TargetPhraseCollection*, clock_t> value(ret, clock());
-      cache[hash] = value;
-    } else {
-      // in cache. just use it
-      std::pair<const TargetPhraseCollection*, clock_t> &value = iter->second;
-      value.second = clock();
-
-      ret = value.first;
+      AddToCache(hash, ret);
     }
   } else {
     // don't use cache. look up from phrase table
@@ -116,10 +116,26 @@ SetParameter(const std::string& key, const std::string& value)
 {
   if (key == "cache-size") {
     m_maxCacheSize = Scan<size_t>(value);
+  } else if (key == "cache-shared") {
+    m_sharedCache = Scan<bool>(value);
+  } else if (key == "cache-memory") {
+    // in MB
+    m_maxCacheMemory = Scan<size_t>(value) * 1024 * 1024;
   } else if (key == "path") {
     m_filePath = value;
   } else if (key == "table-limit") {
     m_tableLimit = Scan<size_t>(value);
+  } else if (key == "frozen-weights") {
+    m_frozenWeights = Scan<bool>(value);
+  } else if (key == "mmap-advice") {
+    // comma-separated list of huge, populate, lock
+    std::vector<std::string> toks = Tokenize(value, ",");
+    for (size_t i = 0; i < toks.size(); ++i) {
+      if (toks[i] == "huge") m_mmapAdvice |= util::ADVISE_HUGE;
+      else if (toks[i] == "populate") m_mmapAdvice |= util::ADVISE_POPULATE;
+      else if (toks[i] == "lock") m_mmapAdvice |= util::ADVISE_LOCK;
+      else UTIL_THROW2("Unknown mmap-advice " << toks[i] << " for " << GetScoreProducerDescription());
+    }
   } else {
     DecodeFeature::SetParameter(key, value);
   }
@@ -129,6 +145,11 @@ void
 PhraseDictionary::
 SetFeaturesToApply()
 {
+  // all parameters are known by now
+  if (m_sharedCache && m_maxCacheSize && !m_sharedCacheColl) {
+    m_sharedCacheColl.reset(new SharedCacheColl(m_maxCacheMemory));
+  }
+
   // find out which feature function can be applied in this decode step
   const std::vector<FeatureFunction*> &allFeatures = FeatureFunction::GetFeatureFunctions();
   for (size_t i = 0; i < allFeatures.size(); ++i) {
@@ -139,6 +160,15 @@ SetFeaturesToApply()
   }
 }
 
+void
+PhraseDictionary::
+SetLMScores(TargetPhrase &targetPhrase, const float *scores) const
+{
+  // keyed on the table, the LM checks GetLMFingerprint() before using them
+  boost::shared_ptr<Scores> lmScores(new Scores(scores, scores + PrecomputedLMScorer::kNumScores));
+  targetPhrase.SetExtraScores(this, lmScores);
+}
+
 
 // tell the Phrase Dictionary that the TargetPhraseCollection is not needed any more
 void
@@ -203,22 +233,31 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 // reduce presistent cache by half of maximum size
 void PhraseDictionary::ReduceCache() const
 {
+  if (m_sharedCacheColl) {
+    // eviction happens on insertion, this only releases retired collections
+    m_sharedCacheColl->EndOfSentence();
+    VERBOSE(2, "Shared translation option cache: " << m_sharedCacheColl->GetHits() << " hits, "
+            << m_sharedCacheColl->GetMisses() << " misses, "
+            << m_sharedCacheColl->GetBytes() << " bytes" << std::endl);
+    return;
+  }
+
   Timer reduceCacheTime;
   reduceCacheTime.start();
   CacheColl &cache = GetCache();
+  RemoveAllInColl(cache.m_replaced);
   if (cache.size() <= m_maxCacheSize) return; // not full
 
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
+  // find cutoff for last used time, keeping the most recent half
+  vector< clock_t > lastUsedTimes;
+  lastUsedTimes.reserve(cache.size());
   CacheColl::iterator iter;
-  iter = cache.begin();
-  while( iter != cache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
+  for (iter = cache.begin(); iter != cache.end(); ++iter) {
+    lastUsedTimes.push_back( iter->second.second );
   }
-  for( size_t i=0; i < lastUsedTimes.size()-m_maxCacheSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
+  vector< clock_t >::iterator cutoff = lastUsedTimes.begin() + (lastUsedTimes.size() - m_maxCacheSize/2);
+  nth_element(lastUsedTimes.begin(), cutoff, lastUsedTimes.end());
+  clock_t cutoffLastUsedTime = *cutoff;
 
   // remove all old entries
   iter = cache.begin();
@@ -232,6 +271,30 @@ void PhraseDictionary::ReduceCache() const
   VERBOSE(2,"Reduced persistent translation option cache in " << reduceCacheTime << " seconds." << std::endl);
 }
 
+void PhraseDictionary::ClearCache() const
+{
+  m_cache.reset();
+  if (m_sharedCacheColl) {
+    m_sharedCacheColl.reset(new SharedCacheColl(m_maxCacheMemory));
+  }
+}
+
+void PhraseDictionary::ReportMemory(MemoryUsage &usage) const
+{
+  if (m_sharedCacheColl) {
+    usage.cache += m_sharedCacheColl->GetBytes();
+    usage.cacheEntries += m_sharedCacheColl->GetSize();
+    return;
+  }
+
+  const CacheColl *cache = m_cache.get();
+  if (cache == NULL) return;
+  for (CacheColl::const_iterator iter = cache->begin(); iter != cache->end(); ++iter) {
+    usage.cache += SharedCacheColl::EstimateSize(iter->second.first);
+  }
+  usage.cacheEntries += cache->size();
+}
+
 CacheColl &PhraseDictionary::GetCache() const
 {
   CacheColl *cache;
@@ -244,6 +307,47 @@ CacheColl &PhraseDictionary::GetCache() const
   return *cache;
 }
 
+const TargetPhraseCollection *PhraseDictionary::GetFromCache(size_t hash, bool &found) const
+{
+  if (m_sharedCacheColl) {
+    const TargetPhraseCollection *ret = m_sharedCacheColl->Get(hash, found);
+    DecodeProfile::Count(found ? DecodeProfile::PhraseTableCacheHits : DecodeProfile::PhraseTableCacheMisses);
+    return ret;
+  }
+
+  CacheColl &cache = GetCache();
+  CacheColl::iterator iter = cache.find(hash);
+  if (iter == cache.end()) {
+    DecodeProfile::Count(DecodeProfile::PhraseTableCacheMisses);
+    found = false;
+    return NULL;
+  }
+  // in cache. just use it
+  DecodeProfile::Count(DecodeProfile::PhraseTableCacheHits);
+  std::pair<const TargetPhraseCollection*, clock_t> &value = iter->second;
+  value.second = clock();
+  found = true;
+  return value.first;
+}
+
+void PhraseDictionary::AddToCache(size_t hash, const TargetPhraseCollection *tpc) const
+{
+  if (m_sharedCacheColl) {
+    m_sharedCacheColl->Add(hash, tpc);
+    return;
+  }
+
+  CacheColl &cache = GetCache();
+  std::pair<const TargetPhraseCollection*, clock_t> value(tpc, clock());
+  std::pair<CacheColl::iterator, bool> ret = cache.insert(std::make_pair(hash, value));
+  if (!ret.second) {
+    if (ret.first->second.first && ret.first->second.first != tpc) {
+      cache.m_replaced.push_back(ret.first->second.first);
+    }
+    ret.first->second = value;
+  }
+}
+
 bool PhraseDictionary::SatisfyBackoff(const InputPath &inputPath) const
 {
   const Phrase &sourcePhrase = inputPath.GetPhrase();
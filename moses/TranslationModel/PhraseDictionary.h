@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <stdexcept>
 #include <vector>
 #include <string>
+#include <boost/scoped_ptr.hpp>
 #include <boost/unordered_map.hpp>
 
 #ifdef WITH_THREADS
@@ -44,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/TargetPhraseCollection.h"
 #include "moses/InputPath.h"
 #include "moses/FF/DecodeFeature.h"
+#include "moses/TranslationModel/SharedCacheColl.h"
 
 namespace Moses
 {
@@ -63,6 +65,10 @@ class CacheColl : public boost::unordered_map<size_t, std::pair<const TargetPhra
 
 public:
   ~CacheColl();
+
+  // collections replaced by a newer entry for the same key; they may still
+  // be used by the current sentence, so are only deleted by ReduceCache()
+  std::vector<const TargetPhraseCollection*> m_replaced;
 };
 
 /**
@@ -138,6 +144,19 @@ public:
 
   void SetParameter(const std::string& key, const std::string& value);
 
+  //! PrecomputedLMScorer::Fingerprint() of the LM whose scores the target
+  //! phrases carry as extra scores of the table (see SetLMScores()), 0 if none
+  uint64_t GetLMFingerprint() const {
+    return m_lmFingerprint;
+  }
+
+  //! drop the translations cached by this thread and the shared cache,
+  //! eg. after the weights changed. No sentence may be in flight.
+  void ClearCache() const;
+
+  //! the cache of lookups; subclasses add the memory of their tables
+  virtual void ReportMemory(MemoryUsage &usage) const;
+
   // LEGACY
   //! find list of translations that can translates a portion of src. Used by confusion network decoding
   virtual const TargetPhraseCollectionWithSourcePhrase* GetTargetPhraseCollectionLEGACY(InputType const& src,WordsRange const& range) const;
@@ -148,6 +167,19 @@ protected:
   size_t m_tableLimit;
   std::string m_filePath;
 
+  // weights don't change after loading (frozen-weights), so the weighted
+  // scores of target phrases and the table-limit best of them may be kept
+  // from one sentence to the next
+  bool m_frozenWeights;
+
+  // util::Advice flags for binarized tables that are memory mapped
+  int m_mmapAdvice;
+
+  uint64_t m_lmFingerprint;
+
+  //! the scores of PrecomputedLMScorer for targetPhrase, stored in the table
+  void SetLMScores(TargetPhrase &targetPhrase, const float *scores) const;
+
   // features to apply evaluate target phrase when loading.
   // NOT when creating translation options. Those are in DecodeStep
   std::vector<FeatureFunction*> m_featuresToApply;
@@ -159,6 +191,8 @@ protected:
 
   // cache
   size_t m_maxCacheSize; // 0 = no caching
+  bool m_sharedCache; // one cache for all threads, bounded by m_maxCacheMemory
+  size_t m_maxCacheMemory; // bytes
 
 #ifdef WITH_THREADS
   //reader-writer lock
@@ -166,12 +200,19 @@ protected:
 #else
   mutable boost::scoped_ptr<CacheColl> m_cache;
 #endif
+  mutable boost::scoped_ptr<SharedCacheColl> m_sharedCacheColl;
 
   virtual const TargetPhraseCollection *GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const;
   void ReduceCache() const;
 
 protected:
   CacheColl &GetCache() const;
+
+  //! cached collection for hash, found is false if there is none
+  const TargetPhraseCollection *GetFromCache(size_t hash, bool &found) const;
+  //! the cache takes ownership of tpc
+  void AddToCache(size_t hash, const TargetPhraseCollection *tpc) const;
+
   size_t m_id;
 
 };
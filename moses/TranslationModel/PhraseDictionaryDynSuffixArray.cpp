@@ -24,7 +24,7 @@ Load()
   SetFeaturesToApply();
 
   vector<float> weight = StaticData::Instance().GetWeights(this);
-  m_biSA->Load(m_input, m_output, m_source, m_target, m_alignments, weight);
+  m_biSA->Load(m_input, m_output, m_source, m_target, m_alignments, weight, m_image);
 }
 
 PhraseDictionaryDynSuffixArray::
@@ -43,6 +43,8 @@ SetParameter(const std::string& key, const std::string& value)
     m_target = value;
   } else if (key == "alignment") {
     m_alignments = value;
+  } else if (key == "image") {
+    m_image = value;
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
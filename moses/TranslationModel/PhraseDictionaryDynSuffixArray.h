@@ -29,6 +29,8 @@ public:
 private:
   BilingualDynSuffixArray *m_biSA;
   std::string m_source, m_target, m_alignments;
+  //! where the suffix arrays are cached between runs, optional
+  std::string m_image;
 
   std::vector<float> m_weight;
 };
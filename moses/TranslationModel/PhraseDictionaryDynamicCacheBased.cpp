@@ -45,6 +45,8 @@ PhraseDictionaryDynamicCacheBased::PhraseDictionaryDynamicCacheBased(const std::
 
   m_score_type = CBTM_SCORE_TYPE_HYPERBOLA;
   m_maxAge = 1000;
+  m_clock = 0;
+  m_lastPurge = 0;
   m_entries = 0;
   m_name = "default";
   m_constant = false;
@@ -158,13 +160,23 @@ const TargetPhraseCollection *PhraseDictionaryDynamicCacheBased::GetTargetPhrase
   TargetPhraseCollection* tpc = NULL;
   cacheMap::const_iterator it = m_cacheTM.find(source);
   if(it != m_cacheTM.end()) {
-    tpc = new TargetPhraseCollection(*(it->second).first);
-
-    std::vector<const TargetPhrase*>::const_iterator it2 = tpc->begin();
-
-    while (it2 != tpc->end()) {
-      ((TargetPhrase*) *it2)->EvaluateInIsolation(source, GetFeaturesToApply());
-      it2++;
+    const TargetPhraseCollection* cached = (it->second).first;
+    const AgeCollection* ac = (it->second).second;
+    tpc = new TargetPhraseCollection();
+
+    for (size_t tp_pos = 0; tp_pos < cached->GetSize(); ++tp_pos) {
+      long tp_age = m_clock - ac->at(tp_pos);
+      if (tp_age > (long) m_maxAge) {
+        continue; // expired, not yet purged
+      }
+      TargetPhrase* tp = new TargetPhrase(*cached->GetTargetPhrase(tp_pos));
+      tp->GetScoreBreakdown().Assign(this, GetPreComputedScores(tp_age));
+      tp->EvaluateInIsolation(source, GetFeaturesToApply());
+      tpc->Add(tp);
+    }
+    if (tpc->IsEmpty()) {
+      delete tpc;
+      tpc = NULL;
     }
   }
   if (tpc)  {
@@ -194,7 +206,7 @@ ChartRuleLookupManager* PhraseDictionaryDynamicCacheBased::CreateRuleLookupManag
 void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
 
   m_score_type = type;
@@ -216,7 +228,7 @@ void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 void PhraseDictionaryDynamicCacheBased::SetMaxAge(unsigned int age)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   m_maxAge = age;
   VERBOSE(2, "PhraseDictionaryCache MaxAge:  " << m_maxAge << std::endl);
@@ -264,7 +276,7 @@ void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int
 {
   VERBOSE(2, "PhraseDictionaryDynamicCacheBased SetPreComputedScores:  " << m_maxAge << std::endl);
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   float sc;
   for (size_t i=0; i<=m_maxAge; i++) {
@@ -290,7 +302,7 @@ void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int
   VERBOSE(3, "SetPreComputedScores(const unsigned int): lower_age:|" << m_maxAge << "| lower_score:|" << m_lower_score << "|" << std::endl);
 }
 
-Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age)
+const Scores &PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age) const
 {
   if (age < m_maxAge) {
     return precomputedScores.at(age);
@@ -353,7 +365,7 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)" << std::endl);
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   VERBOSE(3, "PhraseDictionaryCache deleting sp:|" << sp << "| tp:|" << tp << "|" << std::endl);
 
@@ -387,6 +399,7 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)
     } else {
       VERBOSE(3,"tp:|" << tp << "| FOUND" << std::endl);
 
+      delete tp_ptr;
       tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
       ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
       m_entries--;
@@ -445,6 +458,9 @@ void PhraseDictionaryDynamicCacheBased::ClearSource(std::vector<std::string> ent
 void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp)
 {
   VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp) sp:|" << sp << "|" << std::endl);
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
+#endif
   cacheMap::const_iterator it = m_cacheTM.find(sp);
   if (it != m_cacheTM.end()) {
     VERBOSE(3,"found:|" << sp << "|" << std::endl);
@@ -479,74 +495,62 @@ void PhraseDictionaryDynamicCacheBased::Insert(std::string &entries)
 void PhraseDictionaryDynamicCacheBased::Insert(std::vector<std::string> entries)
 {
   VERBOSE(3,"entries.size():|" << entries.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
-  }
-  Update(entries, "1");
+  Update(entries, "1", m_constant == false);
   IFVERBOSE(3) Print();
 }
 
 
-void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)
+void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString, bool decay)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)" << std::endl);
+  const StaticData &staticData = StaticData::Instance();
   std::vector<std::string> pp;
 
   VERBOSE(3,"ageString:|" << ageString << "|" << std::endl);
-  std::vector<std::string>::iterator it;
-  for(it = entries.begin(); it!=entries.end(); it++) {
-    pp.clear();
-    pp = TokenizeMultiCharSeparator((*it), "|||");
-    VERBOSE(3,"pp[0]:|" << pp[0] << "|" << std::endl);
-    VERBOSE(3,"pp[1]:|" << pp[1] << "|" << std::endl);
-
-    if (pp.size() > 2) {
-      VERBOSE(3,"pp[2]:|" << pp[2] << "|" << std::endl);
-      Update(pp[0], pp[1], ageString, pp[2]);
-    } else {
-      Update(pp[0], pp[1], ageString);
-    }
-  }
-}
-
-void PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)
-{
-  VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)" << std::endl);
-  const StaticData &staticData = StaticData::Instance();
-  // const std::string& factorDelimiter = staticData.GetFactorDelimiter();
-  Phrase sourcePhrase(0);
-  TargetPhrase targetPhrase(0);
-
-  VERBOSE(3, "ageString:|" << ageString << "|" << std::endl);
   char *err_ind_temp;
   ageString = Trim(ageString);
   int age = strtod(ageString.c_str(), &err_ind_temp);
   VERBOSE(3, "age:|" << age << "|" << std::endl);
 
-  //target
-  targetPhrase.Clear();
-  VERBOSE(3, "targetPhraseString:|" << targetPhraseString << "|" << std::endl);
-  targetPhrase.CreateFromString(Output, staticData.GetOutputFactorOrder(), targetPhraseString, /*factorDelimiter,*/ NULL);
-  VERBOSE(3, "targetPhrase:|" << targetPhrase << "|" << std::endl);
+  // parse the whole batch before taking the lock
+  std::vector<Phrase> sourcePhrases(entries.size(), Phrase(0));
+  std::vector<TargetPhrase> targetPhrases(entries.size(), TargetPhrase(0));
+  std::vector<std::string> waStrings(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    pp.clear();
+    pp = TokenizeMultiCharSeparator(entries[i], "|||");
+    VERBOSE(3,"pp[0]:|" << pp[0] << "|" << std::endl);
+    VERBOSE(3,"pp[1]:|" << pp[1] << "|" << std::endl);
 
-  //TODO: Would be better to reuse source phrases, but ownership has to be
-  //consistent across phrase table implementations
-  sourcePhrase.Clear();
-  VERBOSE(3, "sourcePhraseString:|" << sourcePhraseString << "|" << std::endl);
-  sourcePhrase.CreateFromString(Input, staticData.GetInputFactorOrder(), sourcePhraseString, /*factorDelimiter,*/ NULL);
-  VERBOSE(3, "sourcePhrase:|" << sourcePhrase << "|" << std::endl);
+    //target
+    targetPhrases[i].CreateFromString(Output, staticData.GetOutputFactorOrder(), pp[1], /*factorDelimiter,*/ NULL);
+    VERBOSE(3, "targetPhrase:|" << targetPhrases[i] << "|" << std::endl);
 
-  if (!waString.empty()) VERBOSE(3, "waString:|" << waString << "|" << std::endl);
+    //TODO: Would be better to reuse source phrases, but ownership has to be
+    //consistent across phrase table implementations
+    sourcePhrases[i].CreateFromString(Input, staticData.GetInputFactorOrder(), pp[0], /*factorDelimiter,*/ NULL);
+    VERBOSE(3, "sourcePhrase:|" << sourcePhrases[i] << "|" << std::endl);
 
-  Update(sourcePhrase, targetPhrase, age, waString);
+    if (pp.size() > 2) {
+      waStrings[i] = pp[2];
+      VERBOSE(3, "waString:|" << waStrings[i] << "|" << std::endl);
+    }
+  }
+
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
+#endif
+  if (decay) {
+    Decay();
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    Update(sourcePhrases[i], targetPhrases[i], age, waStrings[i]);
+  }
 }
 
-void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)
+void PhraseDictionaryDynamicCacheBased::Update(const Phrase &sp, const TargetPhrase &tp, int age, const std::string &waString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3, "PhraseDictionaryCache inserting sp:|" << sp << "| tp:|" << tp << "| age:|" << age << "| word-alignment |" << waString << "|" << std::endl);
 
   cacheMap::const_iterator it = m_cacheTM.find(sp);
@@ -578,19 +582,17 @@ void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int a
       VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
       std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
 
-      targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
       if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
 
       tpc->Add(targetPhrase.release());
 
       tp_pos = tpc->GetSize()-1;
-      ac->push_back(age);
+      ac->push_back(m_clock - age);
       m_entries++;
       VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| INSERTED" << std::endl);
     } else {
-      tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
       if (!waString.empty()) tp_ptr->SetAlignmentInfo(waString);
-      ac->at(tp_pos) = age;
+      ac->at(tp_pos) = m_clock - age;
       VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| UPDATED" << std::endl);
     }
   } else {
@@ -605,11 +607,10 @@ void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int a
 
     //tp is not found
     std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
-    targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
     if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
 
     tpc->Add(targetPhrase.release());
-    ac->push_back(age);
+    ac->push_back(m_clock - age);
     m_entries++;
     VERBOSE(3,"sp:|" << sp << "| tp:|" << tp << "| INSERTED" << std::endl);
   }
@@ -617,59 +618,40 @@ void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int a
 
 void PhraseDictionaryDynamicCacheBased::Decay()
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  cacheMap::iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
-    Decay((*it).first);
+  ++m_clock;
+  // every entry is swept at most once per m_maxAge insertions
+  if (m_clock - m_lastPurge >= (long) m_maxAge) {
+    Purge();
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp)
+void PhraseDictionaryDynamicCacheBased::Purge()
 {
-  VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp) sp:|" << sp << "|" << std::endl);
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
-  if (it != m_cacheTM.end()) {
-    VERBOSE(3,"found:|" << sp << "|" << std::endl);
-    //sp is found
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection* tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
+  m_lastPurge = m_clock;
+  cacheMap::iterator it = m_cacheTM.begin();
+  while (it != m_cacheTM.end()) {
+    TargetPhraseCollection* tpc = (it->second).first;
+    AgeCollection* ac = (it->second).second;
 
     //loop in inverted order to allow a correct deletion of std::vectors tpc and ac
     for (int tp_pos = tpc->GetSize() - 1 ; tp_pos >= 0; tp_pos--) {
-      unsigned int tp_age = ac->at(tp_pos); //increase the age by 1
-      tp_age++; //increase the age by 1
-      VERBOSE(3,"sp:|" << sp << "| " << " new tp_age:|" << tp_age << "|" << std::endl);
-
-      TargetPhrase* tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-
-      if (tp_age > m_maxAge) {
-        VERBOSE(3,"tp_age:|" << tp_age << "| TOO BIG" << std::endl);
+      if (m_clock - ac->at(tp_pos) > (long) m_maxAge) {
+        VERBOSE(3,"sp:|" << it->first << "| tp_age:|" << m_clock - ac->at(tp_pos) << "| TOO BIG" << std::endl);
+        delete tpc->GetTargetPhrase(tp_pos);
         tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
         ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
         m_entries--;
-      } else {
-        VERBOSE(3,"tp_age:|" << tp_age << "| STILL GOOD" << std::endl);
-        tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(tp_age));
-        ac->at(tp_pos) = tp_age;
       }
     }
     if (tpc->GetSize() == 0) {
       // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-      (((*it).second).second)->clear();
-      delete ((*it).second).second;
-      delete ((*it).second).first;
-      m_cacheTM.erase(sp);
+      delete ac;
+      delete tpc;
+      it = m_cacheTM.erase(it);
+    } else {
+      ++it;
     }
-  } else {
-    //do nothing
-    VERBOSE(3,"sp:|" << sp << "| NOT FOUND" << std::endl);
   }
-
-  //put here the removal of entries with age greater than m_maxAge
 }
 
 void PhraseDictionaryDynamicCacheBased::Execute(std::string command)
@@ -701,7 +683,7 @@ void PhraseDictionaryDynamicCacheBased::Execute_Single_Command(std::string comma
 void PhraseDictionaryDynamicCacheBased::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::shared_mutex> lock(m_cacheLock);
 #endif
   cacheMap::const_iterator it;
   for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
@@ -25,6 +25,8 @@
 #include "moses/TypeDef.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 
+#include <boost/unordered_map.hpp>
+
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/locks.hpp>
@@ -52,12 +54,18 @@ class ChartRuleLookupManager;
 class PhraseDictionaryDynamicCacheBased : public PhraseDictionary
 {
 
-  typedef std::vector<unsigned int> AgeCollection;
+  // for each target phrase, the value of m_clock when its age was 0
+  typedef std::vector<long> AgeCollection;
   typedef std::pair<TargetPhraseCollection*, AgeCollection*> TargetCollectionAgePair;
-  typedef std::map<Phrase, TargetCollectionAgePair> cacheMap;
+  typedef boost::unordered_map<Phrase, TargetCollectionAgePair> cacheMap;
 
-  // data structure for the cache
+  // data structure for the cache;
+  // ages are not rewritten on each insertion: the scores are assigned when
+  // a collection is looked up, and entries older than m_maxAge are dropped
+  // by an occasional sweep
   cacheMap m_cacheTM;
+  long m_clock;
+  long m_lastPurge;
   std::vector<Scores> precomputedScores;
   unsigned int m_maxAge;
   size_t m_score_type; //scoring type of the match
@@ -109,6 +117,9 @@ public:
   }
 
   void Load();
+  bool DependsOnSourceContext() const {
+    return true; // the cache is updated between inputs
+  }
   void Load(const std::string files);
 
   const TargetPhraseCollection* GetTargetPhraseCollection(const Phrase &src) const;
@@ -148,11 +159,11 @@ protected:
   float decaying_score(const int age);  // calculates the decay score given the age
   void Insert(std::vector<std::string> entries);
 
-  void Decay();   // traverse through the cache and decay each entry
-  void Decay(Phrase p);   // traverse through the cache and decay each entry for a given Phrase
-  void Update(std::vector<std::string> entries, std::string ageString);
-  void Update(std::string sourceString, std::string targetString, std::string ageString, std::string waString="");
-  void Update(Phrase p, TargetPhrase tp, int age, std::string waString="");
+  // the caller holds m_cacheLock for writing
+  void Decay();   // increase the age of all entries by 1
+  void Purge();   // remove the entries older than m_maxAge
+  void Update(std::vector<std::string> entries, std::string ageString, bool decay=false);
+  void Update(const Phrase &p, const TargetPhrase &tp, int age, const std::string &waString="");
 
   void ClearEntries(std::vector<std::string> entries);
   void ClearEntries(std::string sourceString, std::string targetString);
@@ -166,7 +177,7 @@ protected:
 
 
   void SetPreComputedScores(const unsigned int numScoreComponent);
-  Scores GetPreComputedScores(const unsigned int age);
+  const Scores &GetPreComputedScores(const unsigned int age) const;
 
   void Load_Multiple_Files(std::vector<std::string> files);
   void Load_Single_File(const std::string file);
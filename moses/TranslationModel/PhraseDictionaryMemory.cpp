@@ -23,6 +23,7 @@
 #include <string>
 #include <iterator>
 #include <algorithm>
+#include <numeric>
 #include "PhraseDictionaryMemory.h"
 #include "moses/FactorCollection.h"
 #include "moses/Word.h"
@@ -41,6 +42,8 @@ namespace Moses
 {
 PhraseDictionaryMemory::PhraseDictionaryMemory(const std::string &line)
   : RuleTableTrie(line)
+  , m_quantizeBits(0)
+  , m_documentCacheSize(0)
 {
   ReadParameters();
 
@@ -49,6 +52,19 @@ PhraseDictionaryMemory::PhraseDictionaryMemory(const std::string &line)
 
 }
 
+void PhraseDictionaryMemory::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "quantize") {
+    m_quantizeBits = Scan<size_t>(value);
+    UTIL_THROW_IF2(m_quantizeBits < 1 || m_quantizeBits > 16,
+                   GetScoreProducerDescription() << ": quantize must be between 1 and 16 bits");
+  } else if (key == "document-cache") {
+    m_documentCacheSize = Scan<size_t>(value);
+  } else {
+    RuleTableTrie::SetParameter(key, value);
+  }
+}
+
 TargetPhraseCollection &PhraseDictionaryMemory::GetOrCreateTargetPhraseCollection(
   const Phrase &source
   , const TargetPhrase &target
@@ -79,6 +95,21 @@ GetTargetPhraseCollectionLEGACY(const Phrase& sourceOrig) const
   return &currNode->GetTargetPhraseCollection();
 }
 
+bool PhraseDictionaryMemory::PrefixExists(const Phrase &phraseOrig) const
+{
+  Phrase phrase(phraseOrig);
+  phrase.OnlyTheseFactors(m_inputFactors);
+
+  const PhraseDictionaryNodeMemory *currNode = &m_collection;
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    currNode = currNode->GetChild(phrase.GetWord(pos));
+    if (currNode == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
 PhraseDictionaryNodeMemory &PhraseDictionaryMemory::GetOrCreateNode(const Phrase &source
     , const TargetPhrase &target
     , const Word *sourceLHS)
@@ -133,11 +164,80 @@ ChartRuleLookupManager *PhraseDictionaryMemory::CreateRuleLookupManager(
 
 void PhraseDictionaryMemory::SortAndPrune()
 {
+  if (m_quantizeBits) {
+    // the pruned phrases shouldn't take up bins
+    if (GetTableLimit()) {
+      m_collection.Prune(GetTableLimit());
+    }
+    Quantize();
+  }
   if (GetTableLimit()) {
     m_collection.Sort(GetTableLimit());
   }
 }
 
+namespace
+{
+
+//! the upper bounds and centers of equally filled bins of values (sorted)
+void MakeBins(const std::vector<float> &values, size_t bins,
+              std::vector<float> &bounds, std::vector<float> &centers)
+{
+  std::vector<float>::const_iterator start = values.begin(), finish;
+  for (size_t i = 0; i < bins; ++i, start = finish) {
+    finish = values.begin() + (values.size() * static_cast<uint64_t>(i + 1)) / bins;
+    if (finish == start) continue;
+    bounds.push_back(*(finish - 1));
+    centers.push_back(std::accumulate(start, finish, 0.0) / static_cast<float>(finish - start));
+  }
+}
+
+}
+
+void PhraseDictionaryMemory::Quantize()
+{
+  std::vector<TargetPhraseCollection*> colls;
+  m_collection.GetTargetPhraseCollections(colls);
+
+  const size_t numScores = GetNumScoreComponents();
+  std::vector<std::vector<float> > values(numScores);
+  for (size_t i = 0; i < colls.size(); ++i) {
+    const TargetPhraseCollection &coll = *colls[i];
+    for (size_t j = 0; j < coll.GetSize(); ++j) {
+      std::vector<float> scores = coll.GetTargetPhrase(j)->GetScoreBreakdown().GetScoresForProducer(this);
+      for (size_t s = 0; s < numScores; ++s) {
+        values[s].push_back(scores[s]);
+      }
+    }
+  }
+  const size_t phrases = numScores ? values[0].size() : 0;
+
+  std::vector<std::vector<float> > bounds(numScores), centers(numScores);
+  for (size_t s = 0; s < numScores; ++s) {
+    std::sort(values[s].begin(), values[s].end());
+    MakeBins(values[s], size_t(1) << m_quantizeBits, bounds[s], centers[s]);
+    std::vector<float>().swap(values[s]);
+  }
+
+  for (size_t i = 0; i < colls.size(); ++i) {
+    TargetPhraseCollection::iterator iter;
+    for (iter = colls[i]->begin(); iter != colls[i]->end(); ++iter) {
+      // the collection holds them as const, but they are ours
+      TargetPhrase &phrase = const_cast<TargetPhrase&>(**iter);
+      std::vector<float> scores = phrase.GetScoreBreakdown().GetScoresForProducer(this);
+      for (size_t s = 0; s < numScores; ++s) {
+        size_t bin = std::lower_bound(bounds[s].begin(), bounds[s].end(), scores[s]) - bounds[s].begin();
+        scores[s] = centers[s][std::min(bin, centers[s].size() - 1)];
+      }
+      phrase.GetScoreBreakdown().Assign(this, scores);
+      phrase.UpdateScore();
+    }
+  }
+
+  VERBOSE(1, GetScoreProducerDescription() << ": quantized " << numScores
+          << " scores of " << phrases << " phrases to " << m_quantizeBits << " bits" << endl);
+}
+
 void
 PhraseDictionaryMemory::
 GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
@@ -39,7 +39,9 @@ class PhraseDictionaryMemory : public RuleTableTrie
 
 protected:
   PhraseDictionaryMemory(int type, const std::string &line)
-    : RuleTableTrie(line) {
+    : RuleTableTrie(line)
+    , m_quantizeBits(0)
+    , m_documentCacheSize(0) {
   }
 
 public:
@@ -59,6 +61,21 @@ public:
   const TargetPhraseCollection *GetTargetPhraseCollectionLEGACY(const Phrase& src) const;
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
+  // the trie answers prefix queries, confusion network and lattice inputs
+  // use them to stop extending dead input paths
+  bool ProvidesPrefixCheck() const {
+    return true;
+  }
+  bool PrefixExists(const Phrase &phrase) const;
+
+  void SetParameter(const std::string& key, const std::string& value);
+
+  //! max number of terminal-only matches remembered per document
+  //! (ContextScope) by the chart rule lookup, 0 if none (document-cache)
+  size_t GetDocumentCacheSize() const {
+    return m_documentCacheSize;
+  }
+
   TO_STRING();
 
 protected:
@@ -71,7 +88,14 @@ protected:
 
   void SortAndPrune();
 
+  /** replaces every score of this table by the center of its bin, where
+   *  each score has its own 2^m_quantizeBits bins of equally many phrases
+   *  (as lm/quantize does for n-gram probabilities) */
+  void Quantize();
+
   PhraseDictionaryNodeMemory m_collection;
+  size_t m_quantizeBits; //!< 0 if scores are kept as they are
+  size_t m_documentCacheSize;
 };
 
 }  // namespace Moses
@@ -20,6 +20,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "moses/TranslationModel/PhraseDictionaryMultiModel.h"
 
+#include <boost/functional/hash.hpp>
+
 using namespace std;
 
 namespace Moses
@@ -28,6 +30,7 @@ namespace Moses
 PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(const std::string &line)
   :PhraseDictionary(line)
 {
+  m_maxCacheSize = 0;
   ReadParameters();
 
   if (m_mode == "interpolate") {
@@ -56,6 +59,7 @@ PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(const std::string &line)
 PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(int type, const std::string &line)
   :PhraseDictionary(line)
 {
+  m_maxCacheSize = 0;
   if (type == 1) {
     // PhraseDictionaryMultiModelCounts
     UTIL_THROW_IF2(m_pdStr.size() != m_multimodelweights.size() &&
@@ -106,6 +110,16 @@ const TargetPhraseCollection *PhraseDictionaryMultiModel::GetTargetPhraseCollect
     multimodelweights = getWeights(m_numScoreComponents, true);
   }
 
+  size_t key = 0;
+  if (m_maxCacheSize) {
+    key = GetCombinedCacheKey(src, multimodelweights);
+    bool found;
+    const TargetPhraseCollection *cached = GetFromCache(key, found);
+    if (found) {
+      return cached;
+    }
+  }
+
   TargetPhraseCollection *ret = NULL;
 
   if (m_mode == "interpolate") {
@@ -121,7 +135,7 @@ const TargetPhraseCollection *PhraseDictionaryMultiModel::GetTargetPhraseCollect
   }
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryMultiModel*>(this)->CacheForCleanup(ret);
+  StoreCombined(key, ret);
 
   return ret;
 }
@@ -364,6 +378,24 @@ void PhraseDictionaryMultiModel::CacheForCleanup(TargetPhraseCollection* tpc)
 }
 
 
+size_t PhraseDictionaryMultiModel::GetCombinedCacheKey(const Phrase& src, const std::vector<std::vector<float> > &weights) const
+{
+  size_t key = hash_value(src);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    boost::hash_range(key, weights[i].begin(), weights[i].end());
+  }
+  return key;
+}
+
+void PhraseDictionaryMultiModel::StoreCombined(size_t key, TargetPhraseCollection* ret) const
+{
+  if (m_maxCacheSize) {
+    AddToCache(key, ret);
+  } else {
+    const_cast<PhraseDictionaryMultiModel*>(this)->CacheForCleanup(ret);
+  }
+}
+
 void PhraseDictionaryMultiModel::CleanUpAfterSentenceProcessing(const InputType &source)
 {
   PhraseCache &ref = GetPhraseCache();
@@ -374,6 +406,9 @@ void PhraseDictionaryMultiModel::CleanUpAfterSentenceProcessing(const InputType
   PhraseCache temp;
   temp.swap(ref);
 
+  if (m_maxCacheSize) {
+    ReduceCache();
+  }
   CleanUpComponentModels(source);
 
   std::vector<float> empty_vector;
@@ -59,6 +59,10 @@ struct multiModelPhrase {
 };
 
 /** Implementation of a virtual phrase table constructed from multiple component phrase tables.
+ *  Combined collections are cached if cache-size is set (off by default, since
+ *  component tables may change), keyed on the source phrase and the weights
+ *  in use; with cache-shared=true all threads share them. For fixed weights,
+ *  contrib/tmcombine can write the combined table offline instead.
  */
 class PhraseDictionaryMultiModel: public PhraseDictionary
 {
@@ -71,12 +75,19 @@ public:
   PhraseDictionaryMultiModel(int type, const std::string &line);
   ~PhraseDictionaryMultiModel();
   void Load();
+  bool LoadsIndependently() const {
+    return false; // looks up the component tables
+  }
   virtual void CollectSufficientStatistics(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats) const;
   virtual TargetPhraseCollection* CreateTargetPhraseCollectionLinearInterpolation(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats, std::vector<std::vector<float> > &multimodelweights) const;
   virtual TargetPhraseCollection* CreateTargetPhraseCollectionAll(const Phrase& src, const bool restricted = false) const;
   std::vector<std::vector<float> > getWeights(size_t numWeights, bool normalize) const;
   std::vector<float> normalizeWeights(std::vector<float> &weights) const;
   void CacheForCleanup(TargetPhraseCollection* tpc);
+  //! cache key of the collection for src combined with weights
+  size_t GetCombinedCacheKey(const Phrase& src, const std::vector<std::vector<float> > &weights) const;
+  //! keeps ret for this sentence, or in the cache under key if caching
+  void StoreCombined(size_t key, TargetPhraseCollection* ret) const;
   void CleanUpAfterSentenceProcessing(const InputType &source);
   virtual void CleanUpComponentModels(const InputType &source);
 #ifdef WITH_DLIB
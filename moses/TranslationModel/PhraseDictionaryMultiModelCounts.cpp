@@ -148,6 +148,16 @@ const TargetPhraseCollection *PhraseDictionaryMultiModelCounts::GetTargetPhraseC
   normalize = (m_mode == "interpolate") ? true : false;
   multimodelweights = getWeights(4,normalize);
 
+  size_t key = 0;
+  if (m_maxCacheSize) {
+    key = GetCombinedCacheKey(src, multimodelweights);
+    bool found;
+    const TargetPhraseCollection *cached = GetFromCache(key, found);
+    if (found) {
+      return cached;
+    }
+  }
+
   //source phrase frequency is shared among all phrase pairs
   vector<float> fs(m_numModels);
 
@@ -158,7 +168,7 @@ const TargetPhraseCollection *PhraseDictionaryMultiModelCounts::GetTargetPhraseC
   TargetPhraseCollection *ret = CreateTargetPhraseCollectionCounts(src, fs, allStats, multimodelweights);
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryMultiModelCounts*>(this)->CacheForCleanup(ret);
+  StoreCombined(key, ret);
   return ret;
 }
 
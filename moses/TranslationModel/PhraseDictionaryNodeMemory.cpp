@@ -56,6 +56,19 @@ void PhraseDictionaryNodeMemory::Sort(size_t tableLimit)
   m_targetPhraseCollection.Sort(true, tableLimit);
 }
 
+void PhraseDictionaryNodeMemory::GetTargetPhraseCollections(std::vector<TargetPhraseCollection*> &colls)
+{
+  for (TerminalMap::iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
+    p->second.GetTargetPhraseCollections(colls);
+  }
+  for (NonTerminalMap::iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
+    p->second.GetTargetPhraseCollections(colls);
+  }
+  if (!m_targetPhraseCollection.IsEmpty()) {
+    colls.push_back(&m_targetPhraseCollection);
+  }
+}
+
 PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetOrCreateChild(const Word &sourceTerm)
 {
   return &m_sourceTermMap[sourceTerm];
@@ -142,6 +142,8 @@ public:
 
   void Prune(size_t tableLimit);
   void Sort(size_t tableLimit);
+  //! the target phrase collections of this node and all below it
+  void GetTargetPhraseCollections(std::vector<TargetPhraseCollection*> &colls);
   PhraseDictionaryNodeMemory *GetOrCreateChild(const Word &sourceTerm);
   const PhraseDictionaryNodeMemory *GetChild(const Word &sourceTerm) const;
 #if defined(UNLABELLED_SOURCE)
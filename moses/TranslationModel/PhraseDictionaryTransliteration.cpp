@@ -59,15 +59,12 @@ void PhraseDictionaryTransliteration::GetTargetPhraseCollection(InputPath &input
   const Phrase &sourcePhrase = inputPath.GetPhrase();
   size_t hash = hash_value(sourcePhrase);
 
-  CacheColl &cache = GetCache();
+  bool found;
+  const TargetPhraseCollection *cached = GetFromCache(hash, found);
 
-  CacheColl::iterator iter;
-  iter = cache.find(hash);
-
-  if (iter != cache.end()) {
+  if (found) {
     // already in cache
-    const TargetPhraseCollection *tpColl = iter->second.first;
-    inputPath.SetTargetPhrases(*this, tpColl, NULL);
+    inputPath.SetTargetPhrases(*this, cached, NULL);
   } else {
     // TRANSLITERATE
     const boost::filesystem::path
@@ -98,8 +95,7 @@ void PhraseDictionaryTransliteration::GetTargetPhraseCollection(InputPath &input
       tpColl->Add(tp);
     }
 
-    std::pair<const TargetPhraseCollection*, clock_t> value(tpColl, clock());
-    cache[hash] = value;
+    AddToCache(hash, tpColl);
 
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
 
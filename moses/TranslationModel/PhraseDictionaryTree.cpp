@@ -4,7 +4,10 @@
 #include "moses/TranslationModel/PhraseDictionaryTree.h"
 #include "util/exception.hh"
 #include "moses/StaticData.h"
+#include "util/mmap.hh"
 
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <sstream>
 #include <iostream>
@@ -69,7 +72,8 @@ public:
     }
   }
 
-  void readBin(FILE* f) {
+  // f is a FILE* or a MapCursor
+  template<typename In> void readBin(In& f) {
     fReadVector(f,e);
     fReadVector(f,sc);
     if (sc.back() == 100) {
@@ -84,7 +88,7 @@ public:
     fWriteString(f, m_alignment.c_str(), m_alignment.size());
   }
 
-  void readBinWithAlignment(FILE* f) {
+  template<typename In> void readBinWithAlignment(In& f) {
     readBin(f);
     fReadString(f, m_alignment);
   }
@@ -135,14 +139,14 @@ public:
     for(size_t i=0; i<s; ++i) MyBase::operator[](i).writeBinWithAlignment(f);
   }
 
-  void readBin(FILE* f) {
+  template<typename In> void readBin(In& f) {
     unsigned s;
     fRead(f,s);
     resize(s);
     for(size_t i=0; i<s; ++i) MyBase::operator[](i).readBin(f);
   }
 
-  void readBinWithAlignment(FILE* f) {
+  template<typename In> void readBinWithAlignment(In& f) {
     unsigned s;
     fRead(f,s);
     resize(s);
@@ -170,7 +174,9 @@ public:
   Data data;
   std::vector<OFF_T> srcOffsets;
 
-  FILE *os,*ot;
+  // the source tree and the target candidates, mapped
+  util::scoped_memory srcMem, tgtMem;
+  MapCursor os,ot;
   WordVoc sv;
   WordVoc tv;
 
@@ -180,13 +186,20 @@ public:
   bool needwordalign, haswordAlign;
   bool printwordalign;
 
-  PDTimp() : os(0),ot(0), printwordalign(false) {
+  // the decoded trees of how many first words FreeMemory() keeps, the ones
+  // used last; lastUse holds the number of the call to FreeMemory() after
+  // which a first word was used
+  size_t nodeCacheSize;
+  unsigned freeCount;
+  std::vector<unsigned> lastUse;
+  std::vector<LabelId> loaded;
+
+  PDTimp() : printwordalign(false), nodeCacheSize(0), freeCount(0) {
     PTF::setDefault(InvalidOffT);
   }
   ~PDTimp() {
-    if(os) fClose(os);
-    if(ot) fClose(ot);
-    FreeMemory();
+    FreeNodes(0);
+    pPool.reset();
   }
 
   inline void NeedAlignmentInfo(bool a) {
@@ -210,8 +223,35 @@ public:
   };
 
   void FreeMemory() {
-    for(Data::iterator i=data.begin(); i!=data.end(); ++i) (*i).free();
     pPool.reset();
+    FreeNodes(nodeCacheSize);
+    ++freeCount;
+  }
+
+  // frees the trees of all but the keep first words used last
+  void FreeNodes(size_t keep) {
+    if(loaded.size()<=keep) return;
+    std::vector<std::pair<unsigned,LabelId> > byUse;
+    byUse.reserve(loaded.size());
+    for(size_t i=0; i<loaded.size(); ++i)
+      byUse.push_back(std::make_pair(lastUse[loaded[i]],loaded[i]));
+    if(keep) {
+      std::nth_element(byUse.begin(),byUse.begin()+keep,byUse.end(),
+                       std::greater<std::pair<unsigned,LabelId> >());
+    }
+    loaded.resize(keep);
+    for(size_t i=0; i<byUse.size(); ++i) {
+      if(i<keep) loaded[i]=byUse[i].second;
+      else data[byUse[i].second].free();
+    }
+  }
+
+  // the tree of first word wi, decoded on first use; requires data[wi]
+  PTF const* Node(LabelId wi) {
+    CPT &node=data[wi];
+    if(!node.getPtr()) loaded.push_back(wi);
+    lastUse[wi]=freeCount;
+    return node;
   }
 
   int Read(const std::string& fn);
@@ -220,15 +260,17 @@ public:
     if(f.empty()) return;
     if(f[0]>=data.size()) return;
     if(!data[f[0]]) return;
-    assert(data[f[0]]->findKey(f[0])<data[f[0]]->size());
-    OFF_T tCandOffset=data[f[0]]->find(f);
+    PTF const* node=Node(f[0]);
+    assert(node->findKey(f[0])<node->size());
+    OFF_T tCandOffset=node->find(f);
     if(tCandOffset==InvalidOffT) return;
-    fSeek(ot,tCandOffset);
+    MapCursor c(ot);
+    fSeek(c,tCandOffset);
 
     if (HasAlignmentInfo())
-      tgtCands.readBinWithAlignment(ot);
+      tgtCands.readBinWithAlignment(c);
     else
-      tgtCands.readBin(ot);
+      tgtCands.readBin(c);
   }
 
   typedef PhraseDictionaryTree::PrefixPtr PPtr;
@@ -240,11 +282,12 @@ public:
     if(p.imp->isRoot()) return;
     OFF_T tCandOffset=p.imp->ptr()->getData(p.imp->idx);
     if(tCandOffset==InvalidOffT) return;
-    fSeek(ot,tCandOffset);
+    MapCursor c(ot);
+    fSeek(c,tCandOffset);
     if (HasAlignmentInfo())
-      tgtCands.readBinWithAlignment(ot);
+      tgtCands.readBinWithAlignment(c);
     else
-      tgtCands.readBin(ot);
+      tgtCands.readBin(c);
   }
 
   void PrintTgtCand(const TgtCands& tcands,std::ostream& out) const;
@@ -290,10 +333,11 @@ public:
     if(wi==InvalidLabelId) return PPtr(); // unknown word
     else if(p.imp->isRoot()) {
       if(wi<data.size() && data[wi]) {
-        const void* ptr = data[wi]->findKeyPtr(wi);
+        PTF const* node=Node(wi);
+        const void* ptr = node->findKeyPtr(wi);
         UTIL_THROW_IF2(ptr == NULL, "Error");
 
-        return PPtr(pPool.get(PPimp(data[wi],data[wi]->findKey(wi),0)));
+        return PPtr(pPool.get(PPimp(node,node->findKey(wi),0)));
       }
     } else if(PTF const* nextP=p.imp->ptr()->getPtr(p.imp->idx)) {
       return PPtr(pPool.get(PPimp(nextP,nextP->findKey(wi),0)));
@@ -340,12 +384,14 @@ int PDTimp::Read(const std::string& fn)
   fReadVector(ii,srcOffsets);
   fClose(ii);
 
-  os=fOpen(ifs.c_str(),"rb");
-  ot=fOpen(ift.c_str(),"rb");
+  FreeNodes(0);
+  os=fMapRead(ifs,srcMem);
+  ot=fMapRead(ift,tgtMem);
 
   data.resize(srcOffsets.size());
   for(size_t i=0; i<data.size(); ++i)
     data[i]=CPT(os,srcOffsets[i]);
+  lastUse.assign(data.size(),0);
 
   sv.Read(ifsv);
   tv.Read(iftv);
@@ -409,6 +455,11 @@ void PhraseDictionaryTree::FreeMemory() const
   imp->FreeMemory();
 }
 
+void PhraseDictionaryTree::SetNodeCacheSize(size_t n)
+{
+  imp->nodeCacheSize=n;
+}
+
 
 void PhraseDictionaryTree::
 GetTargetCandidates(const std::vector<std::string>& src,
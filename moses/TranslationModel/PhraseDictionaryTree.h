@@ -71,9 +71,13 @@ public:
 
   int Read(const std::string& fileNamePrefix);
 
-  // free memory used by the prefix tree etc.
+  // free memory used by the prefix tree etc., except for the decoded
+  // trees of the SetNodeCacheSize() first words used last
   void FreeMemory() const;
 
+  // how many decoded trees FreeMemory() keeps, 0 by default
+  void SetNodeCacheSize(size_t n);
+
 
   /**************************************
    *   access with full source phrase   *
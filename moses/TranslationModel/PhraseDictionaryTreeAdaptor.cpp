@@ -27,6 +27,7 @@ namespace Moses
 PhraseDictionaryTreeAdaptor::
 PhraseDictionaryTreeAdaptor(const std::string &line)
   : PhraseDictionary(line)
+  , m_nodeCacheSize(10000)
 {
   ReadParameters();
 }
@@ -40,14 +41,21 @@ void PhraseDictionaryTreeAdaptor::Load()
   SetFeaturesToApply();
 }
 
+void PhraseDictionaryTreeAdaptor::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "node-cache") {
+    m_nodeCacheSize = Scan<size_t>(value);
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 void PhraseDictionaryTreeAdaptor::InitializeForInput(InputType const& source)
 {
   const StaticData &staticData = StaticData::Instance();
 
   ReduceCache();
 
-  PDTAimp *obj = new PDTAimp(this);
-
   vector<float> weight = staticData.GetWeights(this);
   if(m_numScoreComponents!=weight.size()) {
     std::stringstream strme;
@@ -55,14 +63,20 @@ void PhraseDictionaryTreeAdaptor::InitializeForInput(InputType const& source)
                 << " " << m_numScoreComponents);
   }
 
-  obj->Create(m_input, m_output, m_filePath, weight);
+  // the table of a thread is opened once, and keeps its decoded nodes
+  // between sentences
+  PDTAimp *obj = m_implementation.get();
+  if (!obj) {
+    obj = new PDTAimp(this);
+    obj->Create(m_input, m_output, m_filePath, weight);
+    obj->m_dict->SetNodeCacheSize(m_nodeCacheSize);
+    m_implementation.reset(obj);
+  }
 
   obj->CleanUp();
   // caching only required for confusion net
   if(ConfusionNet const* cn=dynamic_cast<ConfusionNet const*>(&source))
     obj->CacheSource(*cn);
-
-  m_implementation.reset(obj);
 }
 
 void PhraseDictionaryTreeAdaptor::CleanUpAfterSentenceProcessing(InputType const& source)
@@ -78,6 +92,56 @@ PhraseDictionaryTreeAdaptor::GetTargetPhraseCollectionNonCacheLEGACY(Phrase cons
   return ret;
 }
 
+void PhraseDictionaryTreeAdaptor::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
+{
+  const PDTAimp &imp = GetImplementation();
+  InputPathList::const_iterator iter;
+  for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
+    InputPath &inputPath = **iter;
+    const Phrase &phrase = inputPath.GetPhrase();
+    const InputPath *prevPath = inputPath.GetPrevPath();
+
+    // a NULL prefix is the root for the first word, but a dead end after it
+    const PDTAimp::PPtr *prefix = NULL;
+    if (prevPath) {
+      prefix = static_cast<const PDTAimp::PPtr*>(prevPath->GetPtNode(*this));
+      if (!prefix) {
+        inputPath.SetTargetPhrases(*this, NULL, NULL);
+        continue;
+      }
+    }
+
+    // backoff
+    if (!SatisfyBackoff(inputPath)) {
+      continue;
+    }
+
+    const PDTAimp::PPtr *ptNode = imp.ExtendPrefix(prefix, phrase.GetWord(phrase.GetSize() - 1));
+    if (!ptNode) {
+      inputPath.SetTargetPhrases(*this, NULL, NULL);
+      continue;
+    }
+
+    const TargetPhraseCollection *targetPhrases;
+    if (m_maxCacheSize) {
+      // see PhraseDictionary::GetTargetPhraseCollectionLEGACY()
+      size_t hash = hash_value(phrase);
+      bool found;
+      targetPhrases = GetFromCache(hash, found);
+      if (!found) {
+        targetPhrases = imp.GetTargetPhraseCollection(phrase, ptNode);
+        if (targetPhrases) {
+          targetPhrases = new TargetPhraseCollection(*targetPhrases);
+        }
+        AddToCache(hash, targetPhrases);
+      }
+    } else {
+      targetPhrases = imp.GetTargetPhraseCollection(phrase, ptNode);
+    }
+    inputPath.SetTargetPhrases(*this, targetPhrases, ptNode);
+  }
+}
+
 void PhraseDictionaryTreeAdaptor::EnableCache()
 {
   GetImplementation().useCache=1;
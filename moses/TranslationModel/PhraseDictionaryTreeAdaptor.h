@@ -43,10 +43,14 @@ class PhraseDictionaryTreeAdaptor : public PhraseDictionary
   PDTAimp& GetImplementation();
   const PDTAimp& GetImplementation() const;
 
+  //! first words whose decoded trees each thread keeps between sentences
+  size_t m_nodeCacheSize;
+
 public:
   PhraseDictionaryTreeAdaptor(const std::string &line);
   virtual ~PhraseDictionaryTreeAdaptor();
   void Load();
+  void SetParameter(const std::string& key, const std::string& value);
 
   // enable/disable caching
   // you enable caching if you request the target candidates for a source phrase multiple times
@@ -61,6 +65,10 @@ public:
   // returns null pointer if nothing found
   TargetPhraseCollection const* GetTargetPhraseCollectionNonCacheLEGACY(Phrase const &src) const;
 
+  //! extends the tree node of each path's prefix by its last word, instead
+  //! of walking from the root for every span
+  void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
+
   void InitializeForInput(InputType const& source);
   void CleanUpAfterSentenceProcessing(InputType const& source);
 
@@ -0,0 +1,286 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "ChartRuleLookupManagerProbing.h"
+
+#include "moses/ChartParser.h"
+#include "moses/InputType.h"
+#include "moses/InputPath.h"
+#include "moses/ChartParserCallback.h"
+#include "moses/StaticData.h"
+#include "moses/NonTerminal.h"
+#include "moses/ChartCellCollection.h"
+#include "moses/FactorCollection.h"
+#include "moses/TargetPhraseCollection.h"
+#include "ProbingPT.h"
+#include "quering.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+ChartRuleLookupManagerProbing::ChartRuleLookupManagerProbing(
+  const ChartParser &parser,
+  const ChartCellCollectionBase &cellColl,
+  const ProbingPT &ruleTable)
+  : ChartRuleLookupManagerCYKPlus(parser, cellColl)
+  , m_ruleTable(ruleTable)
+  , m_engine(ruleTable.GetEngine())
+{
+  size_t sourceSize = parser.GetSize();
+
+  m_completedRules.resize(sourceSize);
+
+  // invert the soft matches: a cell labelled c can fill the non-terminals
+  // of rules whose label soft-matches c
+  const std::vector<std::vector<Word> > &softMatchingMap = StaticData::Instance().GetSoftMatches();
+  const std::vector<Word> &labels = ruleTable.GetTargetNonTerminals();
+  for (size_t i = 0; i < labels.size() && !softMatchingMap.empty(); ++i) {
+    size_t label = labels[i][0]->GetId();
+    if (label >= softMatchingMap.size()) continue;
+    const std::vector<Word> &softMatches = softMatchingMap[label];
+    for (size_t j = 0; j < softMatches.size(); ++j) {
+      size_t matched = softMatches[j][0]->GetId();
+      if (m_softMatchedBy.size() <= matched) {
+        m_softMatchedBy.resize(matched + 1);
+      }
+      m_softMatchedBy[matched].push_back(labels[i]);
+    }
+  }
+}
+
+ChartRuleLookupManagerProbing::~ChartRuleLookupManagerProbing()
+{
+  for (RuleMap::iterator iter = m_rules.begin(); iter != m_rules.end(); ++iter) {
+    delete iter->second;
+  }
+}
+
+void ChartRuleLookupManagerProbing::GetChartRuleCollection(
+  const InputPath &inputPath,
+  size_t lastPos,
+  ChartParserCallback &outColl)
+{
+  const WordsRange &range = inputPath.GetWordsRange();
+  size_t startPos = range.GetStartPos();
+  size_t absEndPos = range.GetEndPos();
+
+  m_lastPos = lastPos;
+  m_stackVec.clear();
+  m_stackScores.clear();
+  m_sourceWords.clear();
+  m_outColl = &outColl;
+  m_unaryPos = absEndPos-1; // rules ending in this position are unary and should not be added to collection
+
+  // create/update data structure to quickly look up all chart cells that match start position and label.
+  UpdateCompressedMatrix(startPos, absEndPos, lastPos);
+
+  // all rules starting with terminal
+  if (startPos == absEndPos) {
+    GetTerminalExtension(0, startPos);
+  }
+  // all rules starting with nonterminal
+  else if (absEndPos > startPos) {
+    GetNonTerminalExtension(0, startPos);
+  }
+
+  // copy temporarily stored rules to out collection
+  CompletedRuleCollection & rules = m_completedRules[absEndPos];
+  for (vector<CompletedRule*>::const_iterator iter = rules.begin(); iter != rules.end(); ++iter) {
+    outColl.Add((*iter)->GetTPC(), (*iter)->GetStackVector(), range);
+  }
+
+  rules.Clear();
+
+}
+
+// Create/update compressed matrix that stores all valid ChartCellLabels for a given start position and label.
+void ChartRuleLookupManagerProbing::UpdateCompressedMatrix(size_t startPos,
+    size_t origEndPos,
+    size_t lastPos)
+{
+
+  std::vector<size_t> endPosVec;
+  size_t numNonTerms = FactorCollection::Instance().GetNumNonTerminals();
+  m_compressedMatrixVec.resize(lastPos+1);
+
+  // we only need to update cell at [startPos, origEndPos-1] for initial lookup
+  if (startPos < origEndPos) {
+    endPosVec.push_back(origEndPos-1);
+  }
+
+  // update all cells starting from startPos+1 for lookup of rule extensions
+  else if (startPos == origEndPos) {
+    startPos++;
+    for (size_t endPos = startPos; endPos <= lastPos; endPos++) {
+      endPosVec.push_back(endPos);
+    }
+    //re-use data structure for cells with later start position, but remove chart cells that would break max-chart-span
+    for (size_t pos = startPos+1; pos <= lastPos; pos++) {
+      CompressedMatrix & cellMatrix = m_compressedMatrixVec[pos];
+      cellMatrix.resize(numNonTerms);
+      for (size_t i = 0; i < numNonTerms; i++) {
+        if (!cellMatrix[i].empty() && cellMatrix[i].back().endPos > lastPos) {
+          cellMatrix[i].pop_back();
+        }
+      }
+    }
+  }
+
+  if (startPos > lastPos) {
+    return;
+  }
+
+  // populate compressed matrix with all chart cells that start at current start position
+  CompressedMatrix & cellMatrix = m_compressedMatrixVec[startPos];
+  cellMatrix.clear();
+  cellMatrix.resize(numNonTerms);
+  for (std::vector<size_t>::iterator p = endPosVec.begin(); p != endPosVec.end(); ++p) {
+
+    size_t endPos = *p;
+    // target non-terminal labels for the span
+    const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+
+    if (targetNonTerms.GetSize() == 0) {
+      continue;
+    }
+
+    // source non-terminal labels for the span
+    const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
+    if (inputPath.GetNonTerminalSet().size() == 0) {
+      continue;
+    }
+
+    const std::vector<size_t> &labelIds = targetNonTerms.GetLabelIds();
+    for (std::vector<size_t>::const_iterator i = labelIds.begin(); i != labelIds.end(); ++i) {
+      const ChartCellLabel *cellLabel = targetNonTerms.Find(*i);
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[*i].push_back(ChartCellCache(endPos, cellLabel, score));
+    }
+  }
+}
+
+const TargetPhraseCollection *ChartRuleLookupManagerProbing::GetRuleCollection(uint64_t key)
+{
+  RuleMap::const_iterator iter = m_rules.find(key);
+  if (iter != m_rules.end()) {
+    return iter->second;
+  }
+
+  Phrase sourceRHS(m_sourceWords.size());
+  for (size_t i = 0; i < m_sourceWords.size(); ++i) {
+    sourceRHS.AddWord(*m_sourceWords[i]);
+  }
+  TargetPhraseCollection *tpc = m_ruleTable.CreateRuleCollection(sourceRHS, key, m_sourceWords.size(), m_buffer);
+  m_rules[key] = tpc;
+  return tpc;
+}
+
+uint64_t ChartRuleLookupManagerProbing::GetNonTerminalId(const Word &sourceLabel, const Word &targetLabel)
+{
+  std::pair<const Factor*, const Factor*> labels(sourceLabel[0], targetLabel[0]);
+  NonTerminalIdMap::const_iterator iter = m_nonTerminalIds.find(labels);
+  if (iter != m_nonTerminalIds.end()) {
+    return iter->second;
+  }
+  uint64_t id = m_ruleTable.GetNonTerminalProbingId(sourceLabel, targetLabel);
+  m_nonTerminalIds[labels] = id;
+  return id;
+}
+
+// if a (partial) rule matches, add it to list completed rules (if non-unary and non-empty), and try find expansions that have this partial rule as prefix.
+void ChartRuleLookupManagerProbing::AddAndExtend(
+  uint64_t key,
+  size_t endPos)
+{
+  // add target phrase collection (except if rule is empty or a unary non-terminal rule)
+  if ((m_stackVec.empty() || endPos != m_unaryPos) && m_engine.contains(ruleMarkerKey(key))) {
+    const TargetPhraseCollection *tpc = GetRuleCollection(key);
+    if (tpc && !tpc->IsEmpty()) {
+      m_completedRules[endPos].Add(*tpc, m_stackVec, m_stackScores, *m_outColl);
+    }
+  }
+
+  // get all further extensions of rule (until reaching end of sentence or max-chart-span)
+  if (endPos < m_lastPos && m_engine.contains(prefixMarkerKey(key))) {
+    GetTerminalExtension(key, endPos+1);
+    GetNonTerminalExtension(key, endPos+1);
+  }
+}
+
+// extend a partial rule with the source word at a given position
+void ChartRuleLookupManagerProbing::GetTerminalExtension(
+  uint64_t key,
+  size_t pos)
+{
+  const Word &sourceWord = GetSourceAt(pos).GetLabel();
+  uint64_t probingId;
+  if (!m_ruleTable.GetSourceProbingId(sourceWord, probingId)) {
+    return;
+  }
+
+  m_sourceWords.push_back(&sourceWord);
+  AddAndExtend(extendKey(key, probingId, m_sourceWords.size() - 1), pos);
+  m_sourceWords.pop_back();
+}
+
+// extend a partial rule with all non-terminals for a variable span (starting from startPos)
+void ChartRuleLookupManagerProbing::GetNonTerminalExtension(
+  uint64_t key,
+  size_t startPos)
+{
+  const CompressedMatrix &compressedMatrix = m_compressedMatrixVec[startPos];
+  const size_t symbolPos = m_sourceWords.size();
+
+  // make room for back pointer
+  m_stackVec.push_back(NULL);
+  m_stackScores.push_back(0);
+  m_sourceWords.push_back(NULL);
+
+  for (size_t label = 0; label < compressedMatrix.size(); ++label) {
+    const CompressedColumn &matches = compressedMatrix[label];
+    for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+      m_stackVec.back() = match->cellLabel;
+      m_stackScores.back() = match->score;
+
+      const NonTerminalSet &sourceLabels = GetParser().GetInputPath(startPos, match->endPos).GetNonTerminalSet();
+      const Word &targetLabel = match->cellLabel->GetLabel();
+      const std::vector<Word> *softMatches = (label < m_softMatchedBy.size() && !m_softMatchedBy[label].empty())
+                                             ? &m_softMatchedBy[label] : NULL;
+
+      for (NonTerminalSet::const_iterator source = sourceLabels.begin(); source != sourceLabels.end(); ++source) {
+        m_sourceWords.back() = &*source;
+        AddAndExtend(extendKey(key, GetNonTerminalId(*source, targetLabel), symbolPos), match->endPos);
+        if (softMatches) {
+          for (std::vector<Word>::const_iterator soft = softMatches->begin(); soft != softMatches->end(); ++soft) {
+            AddAndExtend(extendKey(key, GetNonTerminalId(*source, *soft), symbolPos), match->endPos);
+          }
+        }
+      }
+    }
+  }
+
+  // remove last back pointer
+  m_stackVec.pop_back();
+  m_stackScores.pop_back();
+  m_sourceWords.pop_back();
+}
+
+}  // namespace Moses
@@ -0,0 +1,109 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerCYKPlus.h"
+#include "moses/TranslationModel/CYKPlusParser/CompletedRuleCollection.h"
+#include "line_splitter.hh"
+
+class QueryEngine;
+
+namespace Moses
+{
+
+class ChartParserCallback;
+class Factor;
+class ProbingPT;
+class Word;
+
+/** Implementation of ChartRuleLookupManager for hierarchical ProbingPT tables.
+ *
+ *  Works like ChartRuleLookupManagerMemory, but a partial rule is the hash
+ *  key of its symbols instead of a trie node: the table has a marker for every
+ *  prefix of a right hand side, which says whether to go on extending, and
+ *  one for every right hand side, which says whether to look up its rules.
+ *  A non-terminal is extended with the source labels of its span and the
+ *  target labels of the chart cells (and the labels that soft-match them).
+ */
+class ChartRuleLookupManagerProbing : public ChartRuleLookupManagerCYKPlus
+{
+public:
+  typedef std::vector<ChartCellCache> CompressedColumn;
+  typedef std::vector<CompressedColumn> CompressedMatrix;
+
+  ChartRuleLookupManagerProbing(const ChartParser &parser,
+                                const ChartCellCollectionBase &cellColl,
+                                const ProbingPT &ruleTable);
+
+  ~ChartRuleLookupManagerProbing();
+
+  virtual void GetChartRuleCollection(
+    const InputPath &inputPath,
+    size_t lastPos, // last position to consider if using lookahead
+    ChartParserCallback &outColl);
+
+private:
+  void GetTerminalExtension(uint64_t key, size_t pos);
+
+  void GetNonTerminalExtension(uint64_t key, size_t startPos);
+
+  void AddAndExtend(uint64_t key, size_t endPos);
+
+  void UpdateCompressedMatrix(size_t startPos,
+                              size_t endPos,
+                              size_t lastPos);
+
+  //! the rules of the current right hand side, NULL if none
+  const TargetPhraseCollection *GetRuleCollection(uint64_t key);
+
+  uint64_t GetNonTerminalId(const Word &sourceLabel, const Word &targetLabel);
+
+  const ProbingPT &m_ruleTable;
+  const QueryEngine &m_engine;
+
+  // target labels that soft-match a label, by id of the label
+  std::vector<std::vector<Word> > m_softMatchedBy;
+
+  // temporary storage of completed rules (one collection per end position; all rules collected consecutively start from the same position)
+  std::vector<CompletedRuleCollection> m_completedRules;
+
+  size_t m_lastPos;
+  size_t m_unaryPos;
+
+  std::vector<float> m_stackScores;
+  std::vector<const Word*> m_sourceWords; //!< symbols of the partial rule
+  ChartParserCallback* m_outColl;
+
+  std::vector<CompressedMatrix> m_compressedMatrixVec;
+
+  // rules looked up for this sentence, by key of their right hand side
+  typedef boost::unordered_map<uint64_t, TargetPhraseCollection*> RuleMap;
+  RuleMap m_rules;
+
+  typedef boost::unordered_map<std::pair<const Factor*, const Factor*>, uint64_t> NonTerminalIdMap;
+  NonTerminalIdMap m_nonTerminalIds;
+
+  std::vector<target_text> m_buffer;
+};
+
+}  // namespace Moses
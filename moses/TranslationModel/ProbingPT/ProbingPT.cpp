@@ -2,9 +2,14 @@
 #include "ProbingPT.h"
 #include "moses/StaticData.h"
 #include "moses/FactorCollection.h"
-#include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerSkeleton.h"
+#include "moses/MemoryReport.h"
+#include "moses/InputPath.h"
+#include "moses/LM/PrecomputedScores.h"
+#include "ChartRuleLookupManagerProbing.h"
 #include "quering.hh"
 
+#include <set>
+
 using namespace std;
 
 namespace Moses
@@ -14,9 +19,6 @@ ProbingPT::ProbingPT(const std::string &line)
   ,m_engine(NULL)
 {
   ReadParameters();
-
-  assert(m_input.size() == 1);
-  assert(m_output.size() == 1);
 }
 
 ProbingPT::~ProbingPT()
@@ -28,36 +30,47 @@ void ProbingPT::Load()
 {
   SetFeaturesToApply();
 
-  m_engine = new QueryEngine(m_filePath.c_str());
-
-  m_unkId = 456456546456;
+  m_engine = new QueryEngine(m_filePath.c_str(), m_mmapAdvice);
+  m_lmFingerprint = m_engine->getLMFingerprint();
 
-  // source vocab
+  // source vocab: the ids are the hashes of the words, so only which ones
+  // are known needs to be kept
   const std::map<uint64_t, std::string> &sourceVocab = m_engine->getSourceVocab();
   std::map<uint64_t, std::string>::const_iterator iterSource;
   for (iterSource = sourceVocab.begin(); iterSource != sourceVocab.end(); ++iterSource) {
-    const string &wordStr = iterSource->second;
-    const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
-
-    uint64_t probingId = iterSource->first;
-
-    SourceVocabMap::value_type entry(factor, probingId);
-    m_sourceVocabMap.insert(entry);
-
+    m_sourceIds.insert(iterSource->first);
   }
 
-  // target vocab
+  // target vocab, made into words with all their factors once
   const std::map<unsigned int, std::string> &probingVocab = m_engine->getVocab();
+  if (!probingVocab.empty()) {
+    m_targetWords.resize(probingVocab.rbegin()->first + 1);
+  }
   std::map<unsigned int, std::string>::const_iterator iter;
   for (iter = probingVocab.begin(); iter != probingVocab.end(); ++iter) {
-    const string &wordStr = iter->second;
-    const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
-
-    unsigned int probingId = iter->first;
-
-    TargetVocabMap::value_type entry(factor, probingId);
-    m_vocabMap.insert(entry);
+    StringPiece wordStr(iter->second);
+    Word &word = m_targetWords[iter->first];
+    if (m_engine->isHierarchical() && wordStr.size() >= 2
+        && wordStr[0] == '[' && wordStr[wordStr.size() - 1] == ']') {
+      // [X] as left hand side, [X][Y] as non-terminal with target label Y
+      size_t nextPos = wordStr.find('[', 1);
+      StringPiece label = (nextPos == StringPiece::npos)
+                          ? wordStr.substr(1, wordStr.size() - 2)
+                          : wordStr.substr(nextPos + 1, wordStr.size() - nextPos - 2);
+      word.CreateFromString(Output, m_output, label, true);
+      if (nextPos != StringPiece::npos
+          && std::find(m_targetNonTerminals.begin(), m_targetNonTerminals.end(), word) == m_targetNonTerminals.end()) {
+        m_targetNonTerminals.push_back(word);
+      }
+    } else {
+      word.CreateFromString(Output, m_output, wordStr, false);
+    }
+  }
 
+  // labels of hierarchical rules
+  const std::vector<std::string> &sourceLHS = m_engine->getSourceLHS();
+  for (size_t i = 0; i < sourceLHS.size(); ++i) {
+    m_sourceLHSIds.push_back(getHash(sourceLHS[i]));
   }
 }
 
@@ -66,9 +79,24 @@ void ProbingPT::InitializeForInput(InputType const& source)
   ReduceCache();
 }
 
+void ProbingPT::ReportMemory(MemoryUsage &usage) const
+{
+  PhraseDictionary::ReportMemory(usage);
+  if (m_engine == NULL) return;
+  usage.AddMapped(m_engine->getBinaryData(), m_engine->getBinarySize());
+  usage.AddMapped(m_engine->getTableData(), m_engine->getTableSize());
+}
+
 void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
-  CacheColl &cache = GetCache();
+  // the paths missing from the cache are looked up together, so the engine
+  // can prefetch all their entries first; a phrase seen twice is looked up once
+  std::vector<InputPath*> paths;
+  std::vector<size_t> queries; // by path, index into keys
+  std::vector<uint64_t> keys;
+  std::vector<const Phrase*> sources; // by query
+  std::vector<size_t> hashes; // by query
+  std::map<size_t, size_t> queryByHash;
 
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
@@ -79,74 +107,169 @@ void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQue
       continue;
     }
 
-    TargetPhraseCollection *tpColl = CreateTargetPhrase(sourcePhrase);
-
-    // add target phrase to phrase-table cache
     size_t hash = hash_value(sourcePhrase);
-    std::pair<const TargetPhraseCollection*, clock_t> value(tpColl, clock());
-    cache[hash] = value;
+    bool found = false;
+    if (m_frozenWeights) {
+      // the cached collection is scored with the same weights
+      const TargetPhraseCollection *tpColl = GetFromCache(hash, found);
+      if (found) {
+        inputPath.SetTargetPhrases(*this, tpColl, NULL);
+        continue;
+      }
+    }
+
+    std::map<size_t, size_t>::const_iterator query = queryByHash.find(hash);
+    if (query != queryByHash.end()) {
+      paths.push_back(&inputPath);
+      queries.push_back(query->second);
+      continue;
+    }
 
-    inputPath.SetTargetPhrases(*this, tpColl, NULL);
+    bool ok;
+    uint64_t key = GetSourceKey(sourcePhrase, ok);
+    if (!ok) {
+      // source phrase contains a word unknown in the pt.
+      // We know immediately there's no translation for it
+      AddToCache(hash, NULL);
+      inputPath.SetTargetPhrases(*this, NULL, NULL);
+      continue;
+    }
+    queryByHash[hash] = keys.size();
+    paths.push_back(&inputPath);
+    queries.push_back(keys.size());
+    keys.push_back(key);
+    sources.push_back(&sourcePhrase);
+    hashes.push_back(hash);
   }
-}
 
-std::vector<uint64_t> ProbingPT::ConvertToProbingSourcePhrase(const Phrase &sourcePhrase, bool &ok) const
-{
-  size_t size = sourcePhrase.GetSize();
-  std::vector<uint64_t> ret(size);
-  for (size_t i = 0; i < size; ++i) {
-    const Factor *factor = sourcePhrase.GetFactor(i, m_input[0]);
-    uint64_t probingId = GetSourceProbingId(factor);
-    if (probingId == m_unkId) {
-      ok = false;
-      return ret;
+  if (keys.empty()) {
+    return;
+  }
+
+  // probe all buckets, then decode the hits in file order
+  for (size_t i = 0; i < keys.size(); ++i) {
+    m_engine->prefetch(keys[i]);
+  }
+  std::vector<const Entry*> entries(keys.size(), NULL);
+  std::vector<std::pair<uint64_t, size_t> > hits;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const Entry *entry;
+    // entries without target data are markers of hierarchical tables
+    if (m_engine->find(keys[i], entry) && entry->bytes_toread) {
+      entries[i] = entry;
+      hits.push_back(std::make_pair(entry->GetValue(), i));
+      m_engine->willNeed(entry);
+    }
+  }
+  std::sort(hits.begin(), hits.end());
+
+  std::vector<const TargetPhraseCollection*> tpColls(keys.size(), NULL);
+  std::vector<target_text> buffer;
+  for (size_t i = 0; i < hits.size(); ++i) {
+    size_t query = hits[i].second;
+    TargetPhraseCollection *tpColl = new TargetPhraseCollection();
+    AddTargetPhrases(*tpColl, *sources[query], entries[query], buffer);
+    if (m_frozenWeights) {
+      // kept for later sentences, so sort it once for all of them
+      tpColl->Sort(true, m_tableLimit);
     } else {
-      ret[i] = probingId;
+      tpColl->Prune(true, m_tableLimit);
     }
+    tpColls[query] = tpColl;
   }
 
-  ok = true;
-  return ret;
+  // add target phrase to phrase-table cache
+  for (size_t query = 0; query < keys.size(); ++query) {
+    AddToCache(hashes[query], tpColls[query]);
+  }
+  for (size_t i = 0; i < paths.size(); ++i) {
+    paths[i]->SetTargetPhrases(*this, tpColls[queries[i]], NULL);
+  }
 }
 
-TargetPhraseCollection *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase) const
+bool ProbingPT::GetSourceProbingId(const Word &word, uint64_t &probingId) const
 {
-  // create a target phrase from the 1st word of the source, prefix with 'ProbingPT:'
-  assert(sourcePhrase.GetSize());
-
-  bool ok;
-  vector<uint64_t> probingSource = ConvertToProbingSourcePhrase(sourcePhrase, ok);
-  if (!ok) {
-    // source phrase contains a word unknown in the pt.
-    // We know immediately there's no translation for it
-    return NULL;
+  // the ids are the hashes of the words as written in the table
+  if (m_input.size() == 1) {
+    const Factor *factor = word.GetFactor(m_input[0]);
+    if (factor == NULL) return false;
+    probingId = getHash(factor->GetString());
+  } else {
+    const std::string &factorDelimiter = StaticData::Instance().GetFactorDelimiter();
+    std::string str;
+    for (size_t i = 0; i < m_input.size(); ++i) {
+      const Factor *factor = word.GetFactor(m_input[i]);
+      if (factor == NULL) return false;
+      if (i) str += factorDelimiter;
+      StringPiece factorStr = factor->GetString();
+      str.append(factorStr.data(), factorStr.size());
+    }
+    probingId = getHash(str);
   }
+  return m_sourceIds.find(probingId) != m_sourceIds.end();
+}
 
-  std::pair<bool, std::vector<target_text> > query_result;
-
-  TargetPhraseCollection *tpColl = NULL;
-
-  //Actual lookup
-  query_result = m_engine->query(probingSource);
+uint64_t ProbingPT::GetNonTerminalProbingId(const Word &sourceLabel, const Word &targetLabel) const
+{
+  StringPiece source = sourceLabel.GetString(0);
+  StringPiece target = targetLabel.GetString(0);
+  std::string str;
+  str.reserve(source.size() + target.size() + 4);
+  str += '[';
+  str.append(source.data(), source.size());
+  str += "][";
+  str.append(target.data(), target.size());
+  str += ']';
+  return getHash(str);
+}
 
-  if (query_result.first) {
-    //m_engine->printTargetInfo(query_result.second);
-    tpColl = new TargetPhraseCollection();
+uint64_t ProbingPT::GetSourceKey(const Phrase &sourcePhrase, bool &ok) const
+{
+  uint64_t key = 0;
+  for (size_t i = 0; i < sourcePhrase.GetSize(); ++i) {
+    uint64_t probingId;
+    if (!GetSourceProbingId(sourcePhrase.GetWord(i), probingId)) {
+      ok = false;
+      return 0;
+    }
+    key = extendKey(key, probingId, i);
+  }
 
-    const std::vector<target_text> &probingTargetPhrases = query_result.second;
-    for (size_t i = 0; i < probingTargetPhrases.size(); ++i) {
-      const target_text &probingTargetPhrase = probingTargetPhrases[i];
-      TargetPhrase *tp = CreateTargetPhrase(sourcePhrase, probingTargetPhrase);
+  ok = true;
+  return key;
+}
 
-      tpColl->Add(tp);
+TargetPhraseCollection *ProbingPT::CreateRuleCollection(const Phrase &sourceRHS,
+    uint64_t rhsKey, size_t rhsSize,
+    std::vector<target_text> &buffer) const
+{
+  // the left hand side label is the last symbol of the source
+  TargetPhraseCollection *tpColl = NULL;
+  for (size_t i = 0; i < m_sourceLHSIds.size(); ++i) {
+    const Entry *entry;
+    if (!m_engine->find(extendKey(rhsKey, m_sourceLHSIds[i], rhsSize), entry) || !entry->bytes_toread) {
+      continue;
     }
-
-    tpColl->Prune(true, m_tableLimit);
+    if (tpColl == NULL) {
+      tpColl = new TargetPhraseCollection();
+    }
+    AddTargetPhrases(*tpColl, sourceRHS, entry, buffer);
+  }
+  if (tpColl) {
+    tpColl->Sort(true, m_tableLimit);
   }
-
   return tpColl;
 }
 
+void ProbingPT::AddTargetPhrases(TargetPhraseCollection &tpColl, const Phrase &sourcePhrase,
+                                 const Entry *entry, std::vector<target_text> &buffer) const
+{
+  size_t count = m_engine->decode(entry, buffer);
+  for (size_t i = 0; i < count; ++i) {
+    tpColl.Add(CreateTargetPhrase(sourcePhrase, buffer[i]));
+  }
+}
+
 TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const
 {
   const std::vector<unsigned int> &probingPhrase = probingTargetPhrase.target_phrase;
@@ -154,67 +277,62 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
 
   TargetPhrase *tp = new TargetPhrase(this);
 
+  // the left hand side label ends the target of hierarchical rules
+  if (m_engine->isHierarchical() && size) {
+    --size;
+    UTIL_THROW_IF2(probingPhrase[size] >= m_targetWords.size(),
+                   "Unknown target word id " << probingPhrase[size] << " in " << m_filePath);
+    tp->SetTargetLHS(new Word(m_targetWords[probingPhrase[size]]));
+  }
+
   // words
   for (size_t i = 0; i < size; ++i) {
-    uint64_t probingId = probingPhrase[i];
-    const Factor *factor = GetTargetFactor(probingId);
-    assert(factor);
-
-    Word &word = tp->AddWord();
-    word.SetFactor(m_output[0], factor);
+    unsigned int probingId = probingPhrase[i];
+    UTIL_THROW_IF2(probingId >= m_targetWords.size(),
+                   "Unknown target word id " << probingId << " in " << m_filePath);
+    tp->AddWord(m_targetWords[probingId]);
   }
 
-  // score for this phrase table
+  // score for this phrase table, followed by those of the LM it was binarized for
   vector<float> scores = probingTargetPhrase.prob;
+  if (m_lmFingerprint && scores.size() >= PrecomputedLMScorer::kNumScores) {
+    size_t numTableScores = scores.size() - PrecomputedLMScorer::kNumScores;
+    SetLMScores(*tp, &scores[numTableScores]);
+    scores.resize(numTableScores);
+  }
   std::transform(scores.begin(), scores.end(), scores.begin(),TransformScore);
   tp->GetScoreBreakdown().PlusEquals(this, scores);
 
-  // alignment
-  /*
+  // alignment, as source and target position pairs
   const std::vector<unsigned char> &alignments = probingTargetPhrase.word_all1;
-
-  AlignmentInfo &aligns = tp->GetAlignTerm();
-  for (size_t i = 0; i < alignS.size(); i += 2 ) {
-    aligns.Add((size_t) alignments[i], (size_t) alignments[i+1]);
+  if (!alignments.empty()) {
+    std::set<std::pair<size_t, size_t> > alignTerm, alignNonTerm;
+    for (size_t i = 0; i + 1 < alignments.size(); i += 2) {
+      std::pair<size_t, size_t> point(alignments[i], alignments[i + 1]);
+      if (point.second < size && tp->GetWord(point.second).IsNonTerminal()) {
+        alignNonTerm.insert(point);
+      } else {
+        alignTerm.insert(point);
+      }
+    }
+    tp->SetAlignTerm(alignTerm);
+    tp->SetAlignNonTerm(alignNonTerm);
   }
-  */
 
   // score of all other ff when this rule is being loaded
   tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
   return tp;
 }
 
-const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
-{
-  TargetVocabMap::right_map::const_iterator iter;
-  iter = m_vocabMap.right.find(probingId);
-  if (iter != m_vocabMap.right.end()) {
-    return iter->second;
-  } else {
-    // not in mapping. Must be UNK
-    return NULL;
-  }
-}
-
-uint64_t ProbingPT::GetSourceProbingId(const Factor *factor) const
-{
-  SourceVocabMap::left_map::const_iterator iter;
-  iter = m_sourceVocabMap.left.find(factor);
-  if (iter != m_sourceVocabMap.left.end()) {
-    return iter->second;
-  } else {
-    // not in mapping. Must be UNK
-    return m_unkId;
-  }
-}
-
 ChartRuleLookupManager *ProbingPT::CreateRuleLookupManager(
-  const ChartParser &,
-  const ChartCellCollectionBase &,
+  const ChartParser &parser,
+  const ChartCellCollectionBase &cellCollection,
   std::size_t)
 {
-  abort();
-  return NULL;
+  UTIL_THROW_IF2(!m_engine->isHierarchical(),
+                 GetScoreProducerDescription() << ": " << m_filePath
+                 << " is not a table of hierarchical rules");
+  return new ChartRuleLookupManagerProbing(parser, cellCollection, *this);
 }
 
 TO_STRING_BODY(ProbingPT);
@@ -1,11 +1,13 @@
 
 #pragma once
 
-#include <boost/bimap.hpp>
+#include <boost/unordered_set.hpp>
 #include "../PhraseDictionary.h"
+#include "moses/Word.h"
 
 class QueryEngine;
-class target_text;
+struct target_text;
+struct Entry;
 
 namespace Moses
 {
@@ -13,6 +15,10 @@ class ChartParser;
 class ChartCellCollectionBase;
 class ChartRuleLookupManager;
 
+/** Phrase table in a probing hash table (binarized with CreateProbingPT).
+ *  Source and target words may have several factors. Tables of hierarchical
+ *  or syntax rules are decoded with ChartRuleLookupManagerProbing.
+ */
 class ProbingPT : public PhraseDictionary
 {
   friend std::ostream& operator<<(std::ostream&, const ProbingPT&);
@@ -28,32 +34,51 @@ public:
   // for phrase-based model
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
+  void ReportMemory(MemoryUsage &usage) const;
+
   // for syntax/hiero model (CKY+ decoding)
   virtual ChartRuleLookupManager *CreateRuleLookupManager(
     const ChartParser &,
     const ChartCellCollectionBase &,
     std::size_t);
 
+  const QueryEngine &GetEngine() const {
+    return *m_engine;
+  }
+
+  //! the labels of the non-terminals on the target side of the rules
+  const std::vector<Word> &GetTargetNonTerminals() const {
+    return m_targetNonTerminals;
+  }
+
+  //! the vocabulary id of a source word, false if the table doesn't know it
+  bool GetSourceProbingId(const Word &word, uint64_t &probingId) const;
+  //! the vocabulary id of the source symbol of a non-terminal, "[S][T]"
+  uint64_t GetNonTerminalProbingId(const Word &sourceLabel, const Word &targetLabel) const;
+
+  /** the rules of all labels whose right hand side has key rhsKey and
+   *  rhsSize symbols, sorted; NULL if there are none. buffer is for decoding
+   *  and may be reused across calls. */
+  TargetPhraseCollection *CreateRuleCollection(const Phrase &sourceRHS,
+      uint64_t rhsKey, size_t rhsSize,
+      std::vector<target_text> &buffer) const;
+
   TO_STRING();
 
 
 protected:
   QueryEngine *m_engine;
 
-  typedef boost::bimap<const Factor *, uint64_t> SourceVocabMap;
-  mutable SourceVocabMap m_sourceVocabMap;
+  boost::unordered_set<uint64_t> m_sourceIds; //!< the source vocabulary
+  std::vector<Word> m_targetWords;            //!< by probing id
+  std::vector<Word> m_targetNonTerminals;
+  std::vector<uint64_t> m_sourceLHSIds;       //!< labels of hierarchical rules
 
-  typedef boost::bimap<const Factor *, unsigned int> TargetVocabMap;
-  mutable TargetVocabMap m_vocabMap;
+  uint64_t GetSourceKey(const Phrase &sourcePhrase, bool &ok) const;
 
-  TargetPhraseCollection *CreateTargetPhrase(const Phrase &sourcePhrase) const;
+  void AddTargetPhrases(TargetPhraseCollection &tpColl, const Phrase &sourcePhrase,
+                        const Entry *entry, std::vector<target_text> &buffer) const;
   TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const;
-  const Factor *GetTargetFactor(uint64_t probingId) const;
-  uint64_t GetSourceProbingId(const Factor *factor) const;
-
-  std::vector<uint64_t> ConvertToProbingSourcePhrase(const Phrase &sourcePhrase, bool &ok) const;
-
-  uint64_t m_unkId;
 };
 
 }  // namespace Moses
@@ -1,74 +1,173 @@
 #include "huffmanish.hh"
 
-Huffman::Huffman (const char * filepath)
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
+
+namespace
 {
-  //Read the file
-  util::FilePiece filein(filepath);
+typedef std::map<std::string, unsigned int> WordCounts;
+typedef std::map<std::vector<unsigned char>, unsigned int> AlignmentCounts;
 
-  //Init uniq_lines to zero;
-  uniq_lines = 0;
+void countLine(const line_text &linein, WordCounts &target_phrase_words, AlignmentCounts &word_all1)
+{
+  //For target phrase:
+  util::TokenIter<util::SingleCharacter> it(linein.target_phrase, util::SingleCharacter(' '));
+  while (it) {
+    //Increment the count, new entries start at zero
+    target_phrase_words[it->as_string()]++;
+    it++;
+  }
 
-  line_text prev_line; //Check for unique lines.
-  int num_lines = 0 ;
+  //For word allignment 1
+  word_all1[splitWordAll1(linein.word_all1)]++;
+}
 
-  while (true) {
-    line_text new_line;
+template <class Counts> void addCounts(Counts &to, const Counts &from)
+{
+  for (typename Counts::const_iterator it = from.begin(); it != from.end(); ++it) {
+    to[it->first] += it->second;
+  }
+}
 
-    num_lines++;
+#ifdef WITH_THREADS
+//Counts the lines [begin, end) of a batch on a pool thread, into maps of its own
+class CountTask : public Moses::Task
+{
+public:
+  CountTask(const std::vector<std::string> &lines, size_t begin, size_t end)
+    : m_lines(lines), m_begin(begin), m_end(end), m_done(false) {}
 
+  void Run() {
     try {
-      //Process line read
-      new_line = splitLine(filein.ReadLine());
-      count_elements(new_line); //Counts the number of elements, adds new and increments counters.
-
-    } catch (util::EndOfFileException e) {
-      std::cerr << "Unique entries counted: ";
-      break;
+      for (size_t i = m_begin; i < m_end; ++i) {
+        countLine(splitLine(m_lines[i]), m_words, m_alignments);
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
     }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
 
-    if (new_line.source_phrase == prev_line.source_phrase) {
-      continue;
-    } else {
-      uniq_lines++;
-      prev_line = new_line;
-    }
+  //Returns the error message if counting threw
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
   }
 
-  std::cerr << uniq_lines << std::endl;
+  const WordCounts &GetWords() const {
+    return m_words;
+  }
+  const AlignmentCounts &GetAlignments() const {
+    return m_alignments;
+  }
+
+private:
+  const std::vector<std::string> &m_lines;
+  size_t m_begin, m_end;
+  WordCounts m_words;
+  AlignmentCounts m_alignments;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+#endif
 }
 
-void Huffman::count_elements(line_text linein)
+Huffman::Huffman (const char * filepath, size_t threads)
 {
-  //For target phrase:
-  util::TokenIter<util::SingleCharacter> it(linein.target_phrase, util::SingleCharacter(' '));
-  while (it) {
-    //Check if we have that entry
-    std::map<std::string, unsigned int>::iterator mapiter;
-    mapiter = target_phrase_words.find(it->as_string());
+  //Read the file. With threads, the lines of a batch are counted on the pool
+  //while the reader gets the next one.
+  util::LineBatchReader filein(util::OpenReadOrThrow(filepath), 65536);
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (threads > 1) {
+    pool.reset(new Moses::ThreadPool(threads));
+  }
+#endif
 
-    if (mapiter != target_phrase_words.end()) {
-      //If the element is found, increment the count.
-      mapiter->second++;
-    } else {
-      //Else create a new entry;
-      target_phrase_words.insert(std::pair<std::string, unsigned int>(it->as_string(), 1));
+  //Init uniq_lines to zero;
+  uniq_lines = 0;
+  hierarchical = false;
+  marker_entries = 0;
+
+  std::string prev_source; //Check for unique lines.
+  std::vector<std::string> lines;
+
+  while (filein.Next(lines)) {
+    bool counted = false;
+#ifdef WITH_THREADS
+    if (pool) {
+      const size_t numTasks = std::min(lines.size(), threads);
+      std::vector<boost::shared_ptr<CountTask> > tasks;
+      for (size_t t = 0; t < numTasks; ++t) {
+        tasks.push_back(boost::shared_ptr<CountTask>(
+                          new CountTask(lines, lines.size() * t / numTasks,
+                                        lines.size() * (t + 1) / numTasks)));
+        pool->Submit(tasks.back());
+      }
+      //Wait for every task before merging, they all reference lines
+      std::string error;
+      for (size_t t = 0; t < numTasks; ++t) {
+        const std::string &taskError = tasks[t]->Wait();
+        if (error.empty()) error = taskError;
+      }
+      UTIL_THROW_IF2(!error.empty(), error);
+      for (size_t t = 0; t < numTasks; ++t) {
+        addCounts(target_phrase_words, tasks[t]->GetWords());
+        addCounts(word_all1, tasks[t]->GetAlignments());
+      }
+      counted = true;
     }
-    it++;
-  }
+#endif
 
-  //For word allignment 1
-  std::map<std::vector<unsigned char>, unsigned int>::iterator mapiter3;
-  std::vector<unsigned char> numbers = splitWordAll1(linein.word_all1);
-  mapiter3 = word_all1.find(numbers);
+    for (size_t i = 0; i < lines.size(); ++i) {
+      //Process line read
+      line_text new_line = splitLine(lines[i]);
+      if (!counted) {
+        count_elements(new_line); //Counts the number of elements, adds new and increments counters.
+      }
 
-  if (mapiter3 != word_all1.end()) {
-    //If the element is found, increment the count.
-    mapiter3->second++;
-  } else {
-    //Else create a new entry;
-    word_all1.insert(std::pair<std::vector<unsigned char>, unsigned int>(numbers, 1));
+      if (uniq_lines && new_line.source_phrase == prev_source) {
+        continue;
+      }
+      if (uniq_lines == 0) {
+        hierarchical = isHierarchical(new_line.source_phrase);
+      }
+      if (hierarchical) {
+        //The prefixes and the right hand side, without the label
+        for (util::TokenIter<util::SingleCharacter, true> it(new_line.source_phrase, util::SingleCharacter(' ')); it; it++) {
+          marker_entries++;
+        }
+        marker_entries--;
+      }
+      uniq_lines++;
+      prev_source.assign(new_line.source_phrase.data(), new_line.source_phrase.size());
+    }
   }
 
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+  std::cerr << "Unique entries counted: " << uniq_lines << std::endl;
+}
+
+void Huffman::count_elements(line_text linein)
+{
+  countLine(linein, target_phrase_words, word_all1);
 }
 
 //Assigns huffman values for each unique element
@@ -138,12 +237,12 @@ void Huffman::serialize_maps(const char * dirname)
   os2.close();
 }
 
-std::vector<unsigned char> Huffman::full_encode_line(line_text line)
+std::vector<unsigned char> Huffman::full_encode_line(line_text line, const std::vector<float> *extra_scores) const
 {
-  return vbyte_encode_line((encode_line(line)));
+  return vbyte_encode_line((encode_line(line, extra_scores)));
 }
 
-std::vector<unsigned int> Huffman::encode_line(line_text line)
+std::vector<unsigned int> Huffman::encode_line(line_text line, const std::vector<float> *extra_scores) const
 {
   std::vector<unsigned int> retvector;
 
@@ -165,6 +264,12 @@ std::vector<unsigned int> Huffman::encode_line(line_text line)
     retvector.push_back(reinterpret_float(&num));
     probit++;
   }
+  if (extra_scores) {
+    for (size_t i = 0; i < extra_scores->size(); i++) {
+      float num = (*extra_scores)[i];
+      retvector.push_back(reinterpret_float(&num));
+    }
+  }
   //Add a zero;
   retvector.push_back(0);
 
@@ -307,6 +412,61 @@ target_text HuffmanDecoder::decode_line (std::vector<unsigned int> input, int nu
 
 }
 
+namespace {
+
+//Reads one variable byte encoded number and advances p past it
+inline unsigned int read_vbyte(const unsigned char *&p, const unsigned char *end)
+{
+  unsigned int value = 0;
+  unsigned char shift = 0;
+  while (p != end) {
+    unsigned char byte = *p++;
+    value |= (byte & 0x7f) << shift;
+    if ((byte >> 7) != 1) break;
+    shift += 7;
+  }
+  return value;
+}
+
+}
+
+size_t HuffmanDecoder::decode_entry (const unsigned char *begin, const unsigned char *end,
+                                     int num_scores, std::vector<target_text> &out) const
+{
+  //Every target phrase is: word ids, 0, num_scores scores, 0, alignment id, 0
+  const unsigned char *p = begin;
+  size_t count = 0;
+  while (p != end) {
+    if (count == out.size()) {
+      out.resize(count + 1);
+    }
+    target_text &text = out[count];
+    text.target_phrase.clear();
+    text.prob.clear();
+
+    unsigned int num;
+    while (p != end && (num = read_vbyte(p, end)) != 0) {
+      text.target_phrase.push_back(num);
+    }
+    for (int i = 0; i < num_scores && p != end; i++) {
+      unsigned int bits = read_vbyte(p, end);
+      text.prob.push_back(reinterpret_uint(&bits));
+    }
+    read_vbyte(p, end); //The zero after the scores
+    unsigned int wAll = read_vbyte(p, end);
+    read_vbyte(p, end); //The final zero
+
+    std::map<unsigned int, std::vector<unsigned char> >::const_iterator align = lookup_word_all1.find(wAll);
+    if (align != lookup_word_all1.end()) {
+      text.word_all1.assign(align->second.begin(), align->second.end());
+    } else {
+      text.word_all1.clear();
+    }
+    count++;
+  }
+  return count;
+}
+
 inline std::string HuffmanDecoder::getTargetWordFromID(unsigned int id)
 {
   return lookup_target_phrase.find(id)->second;
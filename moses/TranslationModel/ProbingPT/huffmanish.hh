@@ -28,6 +28,8 @@ struct sort_pair_vec {
 
 class Huffman {
     unsigned long uniq_lines; //Unique lines in the file.
+    bool hierarchical; //Whether the source phrases end with a label
+    unsigned long marker_entries; //Upper bound on the markers of hierarchical tables
 
     //Containers used when counting the occurence of a given phrase
     std::map<std::string, unsigned int> target_phrase_words;
@@ -46,16 +48,20 @@ class Huffman {
     std::map<unsigned int, std::vector<unsigned char> > lookup_word_all1;
 
     public:
-        Huffman (const char *);
+        //The count pass over the table; target words and alignments are counted
+        //on the given number of threads
+        Huffman (const char *, size_t threads = 1);
         void count_elements (line_text line);
         void assign_values();
         void serialize_maps(const char * dirname);
         void produce_lookups();
 
-        std::vector<unsigned int> encode_line(line_text line);
+        //extra_scores are stored after those of the line, as they are
+        //Only reads the codes, so lines can be encoded on several threads
+        std::vector<unsigned int> encode_line(line_text line, const std::vector<float> *extra_scores = NULL) const;
 
         //encode line + variable byte ontop
-        std::vector<unsigned char> full_encode_line(line_text line);
+        std::vector<unsigned char> full_encode_line(line_text line, const std::vector<float> *extra_scores = NULL) const;
 
         //Getters
         const std::map<unsigned int, std::string> get_target_lookup_map() const{
@@ -68,6 +74,14 @@ class Huffman {
         unsigned long getUniqLines() {
             return uniq_lines;
         }
+
+        bool isHierarchicalTable() const {
+            return hierarchical;
+        }
+
+        unsigned long getMarkerEntries() const {
+            return marker_entries;
+        }
 };
 
 class HuffmanDecoder {
@@ -94,6 +108,13 @@ public:
 
     //Variable byte decodes a all target phrases contained here and then passes them to decode_line
     std::vector<target_text> full_decode_line (std::vector<unsigned char> lines, int num_scores);
+
+    //Decodes the target phrases of [begin, end) directly into out, reusing
+    //the target_text objects and their buffers already there, so that once
+    //they have grown nothing is allocated. Returns the number of target
+    //phrases; out may hold more, which are left over from earlier calls.
+    size_t decode_entry (const unsigned char *begin, const unsigned char *end,
+                         int num_scores, std::vector<target_text> &out) const;
 };
 
 std::string getTargetWordsFromIDs(std::vector<unsigned int> ids, std::map<unsigned int, std::string> * lookup_target_phrase);
@@ -52,3 +52,12 @@ std::vector<unsigned char> splitWordAll1(StringPiece textin)
 
 }
 
+
+bool isHierarchical(StringPiece source_phrase)
+{
+  StringPiece last;
+  for (util::TokenIter<util::SingleCharacter, true> it(source_phrase, util::SingleCharacter(' ')); it; it++) {
+    last = *it;
+  }
+  return last.size() >= 2 && last[0] == '[' && last[last.size() - 1] == ']';
+}
@@ -29,3 +29,7 @@ struct target_text {
 line_text splitLine(StringPiece textin);
 
 std::vector<unsigned char> splitWordAll1(StringPiece textin);
+
+//Whether a source phrase ends with a left hand side label, as in hierarchical
+//and syntax rule tables: "a [X][X] b [X]"
+bool isHierarchical(StringPiece source_phrase);
@@ -1,5 +1,14 @@
 #include "probing_hash_utils.hh"
 
+uint64_t getKey(const std::vector<uint64_t> &source_phrase)
+{
+  uint64_t key = 0;
+  for (size_t i = 0; i < source_phrase.size(); i++) {
+    key = extendKey(key, source_phrase[i], i);
+  }
+  return key;
+}
+
 //Read table from disk, return memory map location
 char * readTable(const char * filename, size_t size)
 {
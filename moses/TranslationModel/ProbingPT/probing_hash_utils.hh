@@ -6,6 +6,7 @@
 #include <boost/functional/hash.hpp>
 #include <fcntl.h>
 #include <fstream>
+#include <vector>
 
 
 //Hash table entry
@@ -32,6 +33,30 @@ struct Entry {
 //Define table
 typedef util::ProbingHashTable<Entry, boost::hash<uint64_t> > Table;
 
+//The key of a source phrase is the sum of the vocabulary ids of its words,
+//each shifted by its position. This adds the word at position pos.
+inline uint64_t extendKey(uint64_t key, uint64_t id, size_t pos)
+{
+  return key + (id << pos);
+}
+
+uint64_t getKey(const std::vector<uint64_t> &source_phrase);
+
+//Hierarchical tables also mark the right hand sides of their rules (without
+//the left hand side label, which ends the source phrase): one entry for each
+//proper prefix, so that a chart lookup knows when to stop extending, and one
+//for the right hand side itself, so that it knows when to look up the rules
+//of all labels. These entries have no target data.
+inline uint64_t prefixMarkerKey(uint64_t key)
+{
+  return key ^ 0x9e3779b97f4a7c15ULL;
+}
+
+inline uint64_t ruleMarkerKey(uint64_t key)
+{
+  return key ^ 0xc2b2ae3d27d4eb4fULL;
+}
+
 void serialize_table(char *mem, size_t size, const char * filename);
 
 char * readTable(const char * filename, size_t size);
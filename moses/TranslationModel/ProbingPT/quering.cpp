@@ -1,5 +1,7 @@
 #include "quering.hh"
 
+#include <utility>
+
 unsigned char * read_binary_file(const char * filename, size_t filesize)
 {
   //Get filesize
@@ -23,7 +25,7 @@ unsigned char * read_binary_file(const char * filename, size_t filesize)
   return map;
 }
 
-QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
+QueryEngine::QueryEngine(const char * filepath, int advice) : decoder(filepath)
 {
 
   //Create filepaths
@@ -61,17 +63,36 @@ QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
     is_reordering = true;
     std::cerr << "WARNING. REORDERING TABLES NOT SUPPORTED YET." << std::endl;
   }
+  //is it a hierarchical table (missing in older tables)
+  is_hierarchical = false;
+  if (getline(config, line)) {
+    is_hierarchical = (line == "true");
+  }
+  //the fingerprint of the LM whose scores follow those of the table (missing in older tables)
+  lm_fingerprint = 0;
+  if (getline(config, line)) {
+    std::istringstream(line) >> lm_fingerprint;
+  }
   config.close();
 
+  if (is_hierarchical) {
+    std::ifstream lhsfile((basepath + "/source_lhs").c_str());
+    while (getline(lhsfile, line)) {
+      source_lhs.push_back(line);
+    }
+  }
+
   //Mmap binary table
   struct stat filestatus;
   stat(path_to_data_bin.c_str(), &filestatus);
   binary_filesize = filestatus.st_size;
   binary_mmaped = read_binary_file(path_to_data_bin.c_str(), binary_filesize);
+  util::AdviseMapping(binary_mmaped, binary_filesize, advice);
 
   //Read hashtable
-  size_t table_filesize = Table::Size(tablesize, 1.2);
+  table_filesize = Table::Size(tablesize, 1.2);
   mem = readTable(path_to_hashtable.c_str(), table_filesize);
+  util::AdviseMapping(mem, table_filesize, advice);
   Table table_init(mem, table_filesize);
   table = table_init;
 
@@ -93,31 +114,12 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64
   const Entry * entry;
   //TOO SLOW
   //uint64_t key = util::MurmurHashNative(&source_phrase[0], source_phrase.size());
-  uint64_t key = 0;
-  for (int i = 0; i < source_phrase.size(); i++) {
-    key += (source_phrase[i] << i);
-  }
-
+  uint64_t key = getKey(source_phrase);
 
   found = table.Find(key, entry);
 
   if (found) {
-    //The phrase that was searched for was found! We need to get the translation entries.
-    //We will read the largest entry in bytes and then filter the unnecesarry with functions
-    //from line_splitter
-    uint64_t initial_index = entry -> GetValue();
-    unsigned int bytes_toread = entry -> bytes_toread;
-
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
-    }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
-
+    translation_entries = decode_entry(entry);
   }
 
   std::pair<bool, std::vector<target_text> > output (found, translation_entries);
@@ -126,6 +128,14 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64
 
 }
 
+std::vector<target_text> QueryEngine::decode_entry(const Entry *entry)
+{
+  //The phrase that was searched for was found! We need to get the translation entries.
+  std::vector<target_text> translation_entries;
+  translation_entries.resize(decode(entry, translation_entries));
+  return translation_entries;
+}
+
 std::pair<bool, std::vector<target_text> > QueryEngine::query(StringPiece source_phrase)
 {
   bool found;
@@ -135,33 +145,14 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(StringPiece source
   std::vector<uint64_t> source_phrase_vid = getVocabIDs(source_phrase);
   //TOO SLOW
   //uint64_t key = util::MurmurHashNative(&source_phrase_vid[0], source_phrase_vid.size());
-  uint64_t key = 0;
-  for (int i = 0; i < source_phrase_vid.size(); i++) {
-    key += (source_phrase_vid[i] << i);
-  }
+  uint64_t key = getKey(source_phrase_vid);
 
   found = table.Find(key, entry);
 
 
   if (found) {
-    //The phrase that was searched for was found! We need to get the translation entries.
-    //We will read the largest entry in bytes and then filter the unnecesarry with functions
-    //from line_splitter
-    uint64_t initial_index = entry -> GetValue();
-    unsigned int bytes_toread = entry -> bytes_toread;
-    //At the end of the file we can't readd + largest_entry cause we get a segfault.
-    std::cerr << "Entry size is bytes is: " << bytes_toread << std::endl;
-
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
-    }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
-
+    std::cerr << "Entry size is bytes is: " << entry->bytes_toread << std::endl;
+    translation_entries = decode_entry(entry);
   }
 
   std::pair<bool, std::vector<target_text> > output (found, translation_entries);
@@ -5,6 +5,7 @@
 #include "hash.hh" //Includes line splitter
 #include <sys/stat.h> //For finding size of file
 #include "vocabid.hh"
+#include "util/mmap.hh"
 #include <algorithm> //toLower
 #define API_VERSION 3
 
@@ -25,11 +26,54 @@ class QueryEngine {
     size_t table_filesize;
     int num_scores;
     bool is_reordering;
+    bool is_hierarchical;
+    uint64_t lm_fingerprint; //PrecomputedLMScorer::Fingerprint() of the LM scored in the table, 0 for none
+    std::vector<std::string> source_lhs; //Labels of the left hand sides of hierarchical tables
+
+    std::vector<target_text> decode_entry(const Entry *entry);
     public:
-        QueryEngine (const char *);
+        QueryEngine (const char *, int advice = 0); //advice: util::Advice flags for the mapped files
         ~QueryEngine();
         std::pair<bool, std::vector<target_text> > query(StringPiece source_phrase);
         std::pair<bool, std::vector<target_text> > query(std::vector<uint64_t> source_phrase);
+
+        //The lookup primitives for the decoder. Keys are made with getKey() and
+        //extendKey() from the vocabulary ids of the source words (getHash()).
+        //Finding entries and decoding them into a reused vector doesn't allocate.
+        bool find(uint64_t key, const Entry *&entry) const {
+            return table.Find(key, entry);
+        }
+        bool contains(uint64_t key) const {
+            const Entry *entry;
+            return table.Find(key, entry);
+        }
+        //Hint that the bucket of key will be probed soon
+        void prefetch(uint64_t key) const {
+            table.Prefetch(key);
+        }
+        //Hint that the target data of entry will be decoded soon
+        void willNeed(const Entry *entry) const {
+            util::AdviseMapping(binary_mmaped + entry->GetValue(), entry->bytes_toread, util::ADVISE_WILLNEED);
+        }
+        //Decodes the target phrases of entry into out[0, returned count); see
+        //HuffmanDecoder::decode_entry()
+        size_t decode(const Entry *entry, std::vector<target_text> &out) const {
+            const unsigned char *begin = binary_mmaped + entry->GetValue();
+            return decoder.decode_entry(begin, begin + entry->bytes_toread, num_scores, out);
+        }
+
+        bool isHierarchical() const {
+            return is_hierarchical;
+        }
+        //The last PrecomputedLMScorer::kNumScores scores are of the LM with
+        //this fingerprint, if it isn't 0
+        uint64_t getLMFingerprint() const {
+            return lm_fingerprint;
+        }
+        const std::vector<std::string> &getSourceLHS() const {
+            return source_lhs;
+        }
+
         void printTargetInfo(std::vector<target_text> target_phrases);
         const std::map<unsigned int, std::string> getVocab() const
         { return decoder.get_target_lookup_map(); }
@@ -38,6 +82,12 @@ class QueryEngine {
             return source_vocabids;
         }
 
+        //the mapped files: target data and hash table
+        const void *getBinaryData() const { return binary_mmaped; }
+        size_t getBinarySize() const { return binary_filesize; }
+        const void *getTableData() const { return mem; }
+        size_t getTableSize() const { return table_filesize; }
+
 };
 
 
@@ -1,5 +1,17 @@
 #include "storing.hh"
 
+#include <algorithm>
+#include <set>
+#include <boost/scoped_ptr.hpp>
+
+#include "moses/LM/PrecomputedScores.h"
+#include "util/exception.hh"
+#include "util/line_batch_reader.hh"
+
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
+
 BinaryFileWriter::BinaryFileWriter (std::string basepath) : os ((basepath + "/binfile.dat").c_str(), std::ios::binary)
 {
   binfile.reserve(10000); //Reserve part of the vector to avoid realocation
@@ -38,124 +50,264 @@ BinaryFileWriter::~BinaryFileWriter ()
   binfile.clear();
 }
 
+namespace {
+
+//Puts the target data of a source phrase into the table. The key is the sum
+//of hashes of individual words bitshifted by their position in the phrase.
+//Probably not entirerly correct, but fast and seems to work fine in practise.
+void insertEntry(Table &table, StringPiece source_phrase, uint64_t start, unsigned int bytes,
+                 bool hierarchical, std::set<std::string> &source_lhs)
+{
+  std::vector<uint64_t> vocabid_source = getVocabIDs(source_phrase);
+
+  Entry pesho;
+  pesho.value = start;
+  pesho.key = getKey(vocabid_source);
+  pesho.bytes_toread = bytes;
+  table.Insert(pesho);
+
+  if (!hierarchical || vocabid_source.empty()) {
+    return;
+  }
+
+  //Markers of the right hand side and its prefixes, see probing_hash_utils.hh.
+  //Rules that differ only in their label share them.
+  Entry marker;
+  marker.value = 0;
+  marker.bytes_toread = 0;
+  Table::MutableIterator existing;
+  uint64_t key = 0;
+  size_t rhs_size = vocabid_source.size() - 1;
+  for (size_t i = 0; i < rhs_size; i++) {
+    key = extendKey(key, vocabid_source[i], i);
+    marker.key = (i + 1 < rhs_size) ? prefixMarkerKey(key) : ruleMarkerKey(key);
+    table.FindOrInsert(marker, existing);
+  }
+
+  StringPiece lhs;
+  for (util::TokenIter<util::SingleCharacter, true> it(source_phrase, util::SingleCharacter(' ')); it; it++) {
+    lhs = *it;
+  }
+  source_lhs.insert(lhs.as_string());
+}
+
+//Encodes a line, with the LM scores of its target phrase if there is a scorer
+std::vector<unsigned char> encodeLine(const Huffman &huffmanEncoder, const line_text &line,
+                                      const Moses::PrecomputedLMScorer *lm_scorer, std::vector<float> &lm_scores)
+{
+  if (!lm_scorer) {
+    return huffmanEncoder.full_encode_line(line);
+  }
+  lm_scorer->Score(line.target_phrase, &lm_scores[0]);
+  return huffmanEncoder.full_encode_line(line, &lm_scores);
+}
+
+//Encodes the lines [begin, end) of a batch
+void encodeLines(const Huffman &huffmanEncoder, const Moses::PrecomputedLMScorer *lm_scorer,
+                 const std::vector<std::string> &lines, size_t begin, size_t end,
+                 std::vector<std::vector<unsigned char> > &encoded)
+{
+  std::vector<float> lm_scores(lm_scorer ? Moses::PrecomputedLMScorer::kNumScores : 0);
+  for (size_t i = begin; i < end; ++i) {
+    encoded[i] = encodeLine(huffmanEncoder, splitLine(lines[i]), lm_scorer, lm_scores);
+  }
+}
+
+#ifdef WITH_THREADS
+//Encodes the lines [begin, end) of a batch on a pool thread
+class EncodeTask : public Moses::Task
+{
+public:
+  EncodeTask(const Huffman &huffmanEncoder, const Moses::PrecomputedLMScorer *lm_scorer,
+             const std::vector<std::string> &lines, size_t begin, size_t end,
+             std::vector<std::vector<unsigned char> > &encoded)
+    : m_huffmanEncoder(huffmanEncoder), m_lm_scorer(lm_scorer), m_lines(lines)
+    , m_begin(begin), m_end(end), m_encoded(encoded), m_done(false) {}
+
+  void Run() {
+    try {
+      encodeLines(m_huffmanEncoder, m_lm_scorer, m_lines, m_begin, m_end, m_encoded);
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  //Returns the error message if encoding threw
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
+  }
+
+private:
+  const Huffman &m_huffmanEncoder;
+  const Moses::PrecomputedLMScorer *m_lm_scorer;
+  const std::vector<std::string> &m_lines;
+  size_t m_begin, m_end;
+  std::vector<std::vector<unsigned char> > &m_encoded;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+#endif
+
+}
+
 void createProbingPT(const char * phrasetable_path, const char * target_path,
-                     const char * num_scores, const char * is_reordering)
+                     const char * num_scores, const char * is_reordering,
+                     const char * lm_path, size_t lm_factor, size_t threads)
 {
   //Get basepath and create directory if missing
   std::string basepath(target_path);
   mkdir(basepath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
 
   //Set up huffman and serialize decoder maps.
-  Huffman huffmanEncoder(phrasetable_path); //initialize
+  Huffman huffmanEncoder(phrasetable_path, threads); //initialize
   huffmanEncoder.assign_values();
   huffmanEncoder.produce_lookups();
   huffmanEncoder.serialize_maps(target_path);
 
-  //Get uniq lines:
+  //Get uniq lines, and room for the markers of hierarchical tables:
   unsigned long uniq_entries = huffmanEncoder.getUniqLines();
+  bool hierarchical = huffmanEncoder.isHierarchicalTable();
+  unsigned long table_entries = uniq_entries + huffmanEncoder.getMarkerEntries();
+  std::set<std::string> source_lhs;
+
+  //Phrase-internal LM scores
+  boost::scoped_ptr<Moses::PrecomputedLMScorer> lm_scorer;
+  size_t num_lm_scores = 0;
+  if (lm_path) {
+    lm_scorer.reset(new Moses::PrecomputedLMScorer(lm_path, lm_factor, hierarchical));
+    num_lm_scores = Moses::PrecomputedLMScorer::kNumScores;
+  }
 
   //Source phrase vocabids
   std::map<uint64_t, std::string> source_vocabids;
 
-  //Read the file
-  util::FilePiece filein(phrasetable_path);
+  //Read the file. The lines of a batch are encoded on the pool, then
+  //written and entered in the table in order.
+  util::LineBatchReader filein(util::OpenReadOrThrow(phrasetable_path), 65536);
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (threads > 1) {
+    pool.reset(new Moses::ThreadPool(threads));
+  }
+#endif
 
-  //Init the probing hash table
-  size_t size = Table::Size(uniq_entries, 1.2);
-  char * mem = new char[size];
-  memset(mem, 0, size);
+  //Init the probing hash table. It is built directly in a shared mapping
+  //of the output file so the kernel can write finished pages back instead
+  //of the whole table having to fit in memory.
+  size_t size = Table::Size(table_entries, 1.2);
+  util::scoped_fd table_file;
+  char * mem = static_cast<char *>(util::MapZeroedWrite((basepath + "/probing_hash.dat").c_str(), size, table_file));
+  util::scoped_mmap table_mem(mem, size);
   Table table(mem, size);
 
   BinaryFileWriter binfile(basepath); //Init the binary file writer.
 
-  line_text prev_line; //Check if the source phrase of the previous line is the same
+  std::string prev_source; //Check if the source phrase of the previous line is the same
+  bool first = true;
 
   //Keep track of the size of each group of target phrases
   uint64_t entrystartidx = 0;
-  //uint64_t line_num = 0;
 
+  std::vector<std::string> lines;
+  std::vector<std::vector<unsigned char> > encoded;
 
   //Read everything and processs
-  while(true) {
-    try {
+  while (filein.Next(lines)) {
+    encoded.resize(lines.size());
+#ifdef WITH_THREADS
+    if (pool) {
+      const size_t numTasks = std::min(lines.size(), threads);
+      std::vector<boost::shared_ptr<EncodeTask> > tasks;
+      for (size_t t = 0; t < numTasks; ++t) {
+        tasks.push_back(boost::shared_ptr<EncodeTask>(
+                          new EncodeTask(huffmanEncoder, lm_scorer.get(), lines,
+                                         lines.size() * t / numTasks,
+                                         lines.size() * (t + 1) / numTasks, encoded)));
+        pool->Submit(tasks.back());
+      }
+      //Wait for every task before writing, they all reference lines
+      std::string error;
+      for (size_t t = 0; t < numTasks; ++t) {
+        const std::string &taskError = tasks[t]->Wait();
+        if (error.empty()) error = taskError;
+      }
+      UTIL_THROW_IF2(!error.empty(), error);
+    } else {
+      encodeLines(huffmanEncoder, lm_scorer.get(), lines, 0, lines.size(), encoded);
+    }
+#else
+    encodeLines(huffmanEncoder, lm_scorer.get(), lines, 0, lines.size(), encoded);
+#endif
+
+    for (size_t i = 0; i < lines.size(); ++i) {
       //Process line read
-      line_text line;
-      line = splitLine(filein.ReadLine());
+      line_text line = splitLine(lines[i]);
       //Add source phrases to vocabularyIDs
       add_to_map(&source_vocabids, line.source_phrase);
 
-      if ((binfile.dist_from_start + binfile.extra_counter) == 0) {
-        prev_line = line; //For the first iteration assume the previous line is
-      } //The same as this one.
-
-      if (line.source_phrase != prev_line.source_phrase) {
-
-        //Create a new entry even
+      if (first) {
+        //For the first line assume the previous line is the same as this one.
+        prev_source.assign(line.source_phrase.data(), line.source_phrase.size());
+        first = false;
+      }
 
+      if (line.source_phrase != prev_source) {
         //Create an entry for the previous source phrase:
-        Entry pesho;
-        pesho.value = entrystartidx;
-        //The key is the sum of hashes of individual words bitshifted by their position in the phrase.
-        //Probably not entirerly correct, but fast and seems to work fine in practise.
-        pesho.key = 0;
-        std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-        for (int i = 0; i < vocabid_source.size(); i++) {
-          pesho.key += (vocabid_source[i] << i);
-        }
-        pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
-
-        //Put into table
-        table.Insert(pesho);
+        insertEntry(table, prev_source, entrystartidx,
+                    binfile.dist_from_start + binfile.extra_counter - entrystartidx,
+                    hierarchical, source_lhs);
 
         entrystartidx = binfile.dist_from_start + binfile.extra_counter; //Designate start idx for new entry
-
-        //Encode a line and write it to disk.
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
-
-        //Set prevLine
-        prev_line = line;
-
-      } else {
-        //If we still have the same line, just append to it:
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
+        prev_source.assign(line.source_phrase.data(), line.source_phrase.size());
       }
 
-    } catch (util::EndOfFileException e) {
-      std::cerr << "Reading phrase table finished, writing remaining files to disk." << std::endl;
-      binfile.flush();
-
-      //After the final entry is constructed we need to add it to the phrase_table
-      //Create an entry for the previous source phrase:
-      Entry pesho;
-      pesho.value = entrystartidx;
-      //The key is the sum of hashes of individual words. Probably not entirerly correct, but fast
-      pesho.key = 0;
-      std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-      for (int i = 0; i < vocabid_source.size(); i++) {
-        pesho.key += (vocabid_source[i] << i);
-      }
-      pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
-      //Put into table
-      table.Insert(pesho);
-
-      break;
+      //Write the encoded line to disk.
+      binfile.write(&encoded[i]);
     }
   }
 
-  serialize_table(mem, size, (basepath + "/probing_hash.dat").c_str());
+  std::cerr << "Reading phrase table finished, writing remaining files to disk." << std::endl;
+  binfile.flush();
+
+  //After the final entry is constructed we need to add it to the phrase_table
+  //Create an entry for the previous source phrase:
+  insertEntry(table, prev_source, entrystartidx,
+              binfile.dist_from_start + binfile.extra_counter - entrystartidx,
+              hierarchical, source_lhs);
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+
+  util::SyncOrThrow(mem, size);
+  table_mem.reset();
 
   serialize_map(&source_vocabids, (basepath + "/source_vocabids").c_str());
 
-  delete[] mem;
+  //Labels of the left hand sides, one per line
+  if (hierarchical) {
+    std::ofstream lhsfile((basepath + "/source_lhs").c_str());
+    for (std::set<std::string>::const_iterator it = source_lhs.begin(); it != source_lhs.end(); ++it) {
+      lhsfile << *it << '\n';
+    }
+  }
 
   //Write configfile
   std::ofstream configfile;
   configfile.open((basepath + "/config").c_str());
   configfile << API_VERSION << '\n';
-  configfile << uniq_entries << '\n';
-  configfile << num_scores << '\n';
+  configfile << table_entries << '\n';
+  configfile << atoi(num_scores) + num_lm_scores << '\n';
   configfile << is_reordering << '\n';
+  configfile << (hierarchical ? "true" : "false") << '\n';
+  configfile << (lm_scorer ? lm_scorer->GetFingerprint() : 0) << '\n';
   configfile.close();
 }
@@ -11,11 +11,17 @@
 
 #include "util/file_piece.hh"
 #include "util/file.hh"
+#include "util/mmap.hh"
 #include "vocabid.hh"
 #define API_VERSION 3
 
+//With lm_path, the phrase-internal scores of that KenLM model on target factor
+//lm_factor are stored after those of each line, see PrecomputedLMScorer.
+//Both passes over the table, counting and encoding, run on the given number
+//of threads; the output does not depend on it.
 void createProbingPT(const char * phrasetable_path, const char * target_path,
-    const char * num_scores, const char * is_reordering);
+    const char * num_scores, const char * is_reordering,
+    const char * lm_path = NULL, size_t lm_factor = 0, size_t threads = 1);
 
 class BinaryFileWriter {
     std::vector<unsigned char> binfile;
@@ -28,6 +28,7 @@
 #include <cstdlib>
 #include <boost/algorithm/string/predicate.hpp>
 #include "Trie.h"
+#include "RuleTableParser.h"
 #include "moses/FactorCollection.h"
 #include "moses/Word.h"
 #include "moses/Util.h"
@@ -146,109 +147,36 @@ bool RuleTableLoaderStandard::Load(FormatType format
                                    , const std::vector<FactorType> &input
                                    , const std::vector<FactorType> &output
                                    , const std::string &inFile
-                                   , size_t /* tableLimit */
+                                   , size_t tableLimit
                                    , RuleTableTrie &ruleTable)
 {
   PrintUserTime(string("Start loading text phrase table. ") + (format==MosesFormat?"Moses":"Hiero") + " format");
 
-  const StaticData &staticData = StaticData::Instance();
-
-  string lineOrig;
-  size_t count = 0;
-
   std::ostream *progress = NULL;
   IFVERBOSE(1) progress = &std::cerr;
   util::FilePiece in(inFile.c_str(), progress);
 
-  // reused variables
-  vector<float> scoreVector;
-  StringPiece line;
-  std::string hiero_before, hiero_after;
-
-  double_conversion::StringToDoubleConverter converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan");
-
-  while(true) {
-    try {
-      line = in.ReadLine();
-    } catch (const util::EndOfFileException &e) {
-      break;
-    }
-
-    if (format == HieroFormat) { // inefficiently reformat line
-      hiero_before.assign(line.data(), line.size());
-      ReformatHieroRule(hiero_before, hiero_after);
-      line = hiero_after;
-    }
-
-    util::TokenIter<util::MultiCharacter> pipes(line, "|||");
-    StringPiece sourcePhraseString(*pipes);
-    StringPiece targetPhraseString(*++pipes);
-    StringPiece scoreString(*++pipes);
-
-    StringPiece alignString;
-    if (++pipes) {
-      StringPiece temp(*pipes);
-      alignString = temp;
-    }
-
-    bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
-    if (isLHSEmpty && !staticData.IsWordDeletionEnabled()) {
-      TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
-      continue;
-    }
-
-    scoreVector.clear();
-    for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
-      int processed;
-      float score = converter.StringToFloat(s->data(), s->length(), &processed);
-      UTIL_THROW_IF2(isnan(score), "Bad score " << *s << " on line " << count);
-      scoreVector.push_back(FloorScore(TransformScore(score)));
-    }
-    const size_t numScoreComponents = ruleTable.GetNumScoreComponents();
-    if (scoreVector.size() != numScoreComponents) {
-      UTIL_THROW2("Size of scoreVector != number (" << scoreVector.size() << "!="
-                  << numScoreComponents << ") of score components on line " << count);
-    }
-
-    // parse source & find pt node
-
-    // constituent labels
-    Word *sourceLHS = NULL;
-    Word *targetLHS;
-
-    // create target phrase obj
-    TargetPhrase *targetPhrase = new TargetPhrase(&ruleTable);
-    targetPhrase->CreateFromString(Output, output, targetPhraseString, &targetLHS);
-    // source
-    Phrase sourcePhrase;
-    sourcePhrase.CreateFromString(Input, input, sourcePhraseString, &sourceLHS);
-
-    // rest of target phrase
-    targetPhrase->SetAlignmentInfo(alignString);
-    targetPhrase->SetTargetLHS(targetLHS);
-
-    ++pipes;  // skip over counts field
+  RuleTableParser parser(input, output, ruleTable, StaticData::Instance().ThreadCount());
+  RuleTableParser::Reformatter reformat = NULL;
+  if (format == HieroFormat) { // inefficiently reformat line
+    reformat = &ReformatHieroRule;
+  }
 
-    if (++pipes) {
-      StringPiece sparseString(*pipes);
-      targetPhrase->SetSparseScore(&ruleTable, sparseString);
-    }
+  vector<ParsedRule> rules;
+  while (parser.ReadRules(in, rules, reformat)) {
+    for (size_t i = 0; i < rules.size(); ++i) {
+      ParsedRule &rule = rules[i];
+      TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(ruleTable, rule.sourcePhrase, *rule.targetPhrase, rule.sourceLHS);
+      phraseColl.Add(rule.targetPhrase);
+      // keep collections of frequent source phrases near the table limit
+      // while loading; SortAndPrune() cuts them down to it in the end
+      if (tableLimit && phraseColl.GetSize() >= 2 * tableLimit) {
+        phraseColl.Prune(true, tableLimit);
+      }
 
-    if (++pipes) {
-      StringPiece propertiesString(*pipes);
-      targetPhrase->SetProperties(propertiesString);
+      // not implemented correctly in memory pt. just delete it for now
+      delete rule.sourceLHS;
     }
-
-    targetPhrase->GetScoreBreakdown().Assign(&ruleTable, scoreVector);
-    targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
-
-    TargetPhraseCollection &phraseColl = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase, *targetPhrase, sourceLHS);
-    phraseColl.Add(targetPhrase);
-
-    // not implemented correctly in memory pt. just delete it for now
-    delete sourceLHS;
-
-    count++;
   }
 
   // sort and prune each target phrase collection
@@ -80,7 +80,8 @@ namespace Moses
 
 PhraseDictionaryFuzzyMatch::PhraseDictionaryFuzzyMatch(const std::string &line)
   :PhraseDictionary(line)
-  ,m_config(3)
+  ,m_config(4)
+  ,m_threads(1)
   ,m_FuzzyMatchWrapper(NULL)
 {
   ReadParameters();
@@ -95,7 +96,8 @@ void PhraseDictionaryFuzzyMatch::Load()
 {
   SetFeaturesToApply();
 
-  m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2]);
+  m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2],
+      m_config[3], m_threads);
 }
 
 ChartRuleLookupManager *PhraseDictionaryFuzzyMatch::CreateRuleLookupManager(
@@ -116,6 +118,10 @@ SetParameter(const std::string& key, const std::string& value)
     m_config[1] = value;
   } else if (key == "alignment") {
     m_config[2] = value;
+  } else if (key == "image") {
+    m_config[3] = value;
+  } else if (key == "threads") {
+    m_threads = Scan<size_t>(value);
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
@@ -188,21 +194,24 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(InputType const& inputSenten
 
   string dirNameStr(dirName);
 
-  string inFileName(dirNameStr + "/in");
-
-  ofstream inFile(inFileName.c_str());
-
+  // the input without <s> and </s>
+  ostringstream input;
   for (size_t i = 1; i < inputSentence.GetSize() - 1; ++i) {
-    inFile << inputSentence.GetWord(i);
+    input << inputSentence.GetWord(i);
   }
-  inFile << endl;
-  inFile.close();
 
   long translationId = inputSentence.GetTranslationId();
-  string ptFileName = m_FuzzyMatchWrapper->Extract(translationId, dirNameStr);
+  string ptFileName = m_FuzzyMatchWrapper->Extract(translationId, input.str(), dirNameStr);
 
   // populate with rules for this sentence
-  PhraseDictionaryNodeMemory &rootNode = m_collection[translationId];
+  PhraseDictionaryNodeMemory *rootNodePtr;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_collectionMutex);
+#endif
+    rootNodePtr = &m_collection[translationId];
+  }
+  PhraseDictionaryNodeMemory &rootNode = *rootNodePtr;
   FormatType format = MosesFormat;
 
   // data from file
@@ -299,7 +308,7 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(InputType const& inputSenten
   // sort and prune each target phrase collection
   SortAndPrune(rootNode);
 
-  //removedirectoryrecursively(dirName);
+  removedirectoryrecursively(dirName);
 }
 
 TargetPhraseCollection &PhraseDictionaryFuzzyMatch::GetOrCreateTargetPhraseCollection(PhraseDictionaryNodeMemory &rootNode
@@ -316,7 +325,6 @@ PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetOrCreateNode(PhraseDi
     , const TargetPhrase &target
     , const Word *sourceLHS)
 {
-  cerr << source << endl << target << endl;
   const size_t size = source.GetSize();
 
   const AlignmentInfo &alignmentInfo = target.GetAlignNonTerm();
@@ -368,11 +376,17 @@ void PhraseDictionaryFuzzyMatch::SortAndPrune(PhraseDictionaryNodeMemory &rootNo
 
 void PhraseDictionaryFuzzyMatch::CleanUpAfterSentenceProcessing(const InputType &source)
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_collectionMutex);
+#endif
   m_collection.erase(source.GetTranslationId());
 }
 
 const PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(long translationId) const
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_collectionMutex);
+#endif
   std::map<long, PhraseDictionaryNodeMemory>::const_iterator iter = m_collection.find(translationId);
   UTIL_THROW_IF2(iter == m_collection.end(),
                  "Couldn't find root node for input: " << translationId);
@@ -381,6 +395,9 @@ const PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(long t
 PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(const InputType &source)
 {
   long transId = source.GetTranslationId();
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_collectionMutex);
+#endif
   std::map<long, PhraseDictionaryNodeMemory>::iterator iter = m_collection.find(transId);
   UTIL_THROW_IF2(iter == m_collection.end(),
                  "Couldn't find root node for input: " << transId);
@@ -27,6 +27,10 @@
 #include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
 #include "moses/TranslationModel/PhraseDictionaryMemory.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 class PhraseDictionaryNodeMemory;
@@ -73,7 +77,12 @@ protected:
   PhraseDictionaryNodeMemory &GetRootNode(const InputType &source);
 
   std::map<long, PhraseDictionaryNodeMemory> m_collection;
-  std::vector<std::string> m_config;
+#ifdef WITH_THREADS
+  //! sentences decoded at the same time add and remove their rule tables
+  mutable boost::mutex m_collectionMutex;
+#endif
+  std::vector<std::string> m_config; //!< source, target, alignment, image
+  size_t m_threads; //!< for the edit distances of one sentence
 
   tmmt::FuzzyMatchWrapper *m_FuzzyMatchWrapper;
 
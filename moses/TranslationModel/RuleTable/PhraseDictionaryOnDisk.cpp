@@ -23,11 +23,15 @@
 #include "moses/StaticData.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/InputPath.h"
+#include "moses/MemoryReport.h"
 #include "moses/TranslationModel/CYKPlusParser/DotChartOnDisk.h"
 #include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerOnDisk.h"
 
 #include "OnDiskPt/OnDiskWrapper.h"
 #include "OnDiskPt/Word.h"
+#include "util/mmap.hh"
+
+#include <algorithm>
 
 using namespace std;
 
@@ -78,10 +82,23 @@ const OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation() const
   return *dict;
 }
 
+void PhraseDictionaryOnDisk::ReportMemory(MemoryUsage &usage) const
+{
+  PhraseDictionary::ReportMemory(usage);
+  const OnDiskPt::OnDiskWrapper *wrapper = m_implementation.get();
+  if (wrapper == NULL) return;
+  usage.AddMapped(wrapper->GetMemSource(), wrapper->GetMemSourceSize());
+  usage.AddMapped(wrapper->GetMemTargetInd(), wrapper->GetMemTargetIndSize());
+  usage.AddMapped(wrapper->GetMemTargetColl(), wrapper->GetMemTargetCollSize());
+}
+
 void PhraseDictionaryOnDisk::InitializeForInput(InputType const& source)
 {
   ReduceCache();
 
+  // the table is read-only: a thread loads it (and its vocabulary) once
+  if (m_implementation.get()) return;
+
   OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
   obj->BeginLoad(m_filePath);
 
@@ -106,10 +123,32 @@ void PhraseDictionaryOnDisk::InitializeForInput(InputType const& source)
 
 void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
+  OnDiskPt::OnDiskWrapper &wrapper = const_cast<OnDiskPt::OnDiskWrapper&>(GetImplementation());
+
+  // walk the source tree for all paths first, asking for the target phrases
+  // of the nodes found, then read those in file order
+  std::vector<std::pair<uint64_t, InputPath*> > found;
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
     InputPath &inputPath = **iter;
-    GetTargetPhraseCollectionBatch(inputPath);
+    const OnDiskPt::PhraseNode *ptNode = FindSourceNode(inputPath);
+    if (ptNode == NULL) continue;
+
+    const uint64_t filePos = ptNode->GetValue();
+    if (filePos && filePos < wrapper.GetMemTargetCollSize()) {
+      util::AdviseMapping(wrapper.GetMemTargetColl() + filePos,
+                          std::min<uint64_t>(util::SizePage(), wrapper.GetMemTargetCollSize() - filePos),
+                          util::ADVISE_WILLNEED);
+    }
+    found.push_back(std::make_pair(filePos, &inputPath));
+  }
+
+  std::sort(found.begin(), found.end());
+  for (size_t i = 0; i < found.size(); ++i) {
+    InputPath &inputPath = *found[i].second;
+    const OnDiskPt::PhraseNode *ptNode = static_cast<const OnDiskPt::PhraseNode*>(inputPath.GetPtNode(*this));
+    const TargetPhraseCollection *targetPhrases = GetTargetPhraseCollection(ptNode);
+    inputPath.SetTargetPhrases(*this, targetPhrases, ptNode);
   }
 
   // delete nodes that's been saved
@@ -121,7 +160,7 @@ void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(const InputPathList
 
 }
 
-void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(InputPath &inputPath) const
+const OnDiskPt::PhraseNode *PhraseDictionaryOnDisk::FindSourceNode(InputPath &inputPath) const
 {
   OnDiskPt::OnDiskWrapper &wrapper = const_cast<OnDiskPt::OnDiskWrapper&>(GetImplementation());
   const Phrase &phrase = inputPath.GetPhrase();
@@ -139,54 +178,37 @@ void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(InputPath &inputPath
 
   // backoff
   if (!SatisfyBackoff(inputPath)) {
-    return;
+    return NULL;
   }
 
+  const OnDiskPt::PhraseNode *ptNode = NULL;
   if (prevPtNode) {
     Word lastWord = phrase.GetWord(phrase.GetSize() - 1);
     lastWord.OnlyTheseFactors(m_inputFactors);
     OnDiskPt::Word *lastWordOnDisk = wrapper.ConvertFromMoses(m_input, lastWord);
 
-    if (lastWordOnDisk == NULL) {
-      // OOV according to this phrase table. Not possible to extend
-      inputPath.SetTargetPhrases(*this, NULL, NULL);
-    } else {
-      const OnDiskPt::PhraseNode *ptNode = prevPtNode->GetChild(*lastWordOnDisk, wrapper);
-      if (ptNode) {
-        const TargetPhraseCollection *targetPhrases = GetTargetPhraseCollection(ptNode);
-        inputPath.SetTargetPhrases(*this, targetPhrases, ptNode);
-      } else {
-        inputPath.SetTargetPhrases(*this, NULL, NULL);
-      }
-
+    // NULL if OOV according to this phrase table. Not possible to extend
+    if (lastWordOnDisk != NULL) {
+      ptNode = prevPtNode->GetChild(*lastWordOnDisk, wrapper);
       delete lastWordOnDisk;
     }
+    inputPath.SetTargetPhrases(*this, NULL, ptNode);
   }
+  return ptNode;
 }
 
 const TargetPhraseCollection *PhraseDictionaryOnDisk::GetTargetPhraseCollection(const OnDiskPt::PhraseNode *ptNode) const
 {
   const TargetPhraseCollection *ret;
 
-  CacheColl &cache = GetCache();
   size_t hash = (size_t) ptNode->GetFilePos();
 
-  CacheColl::iterator iter;
-
-  iter = cache.find(hash);
-
-  if (iter == cache.end()) {
+  bool found;
+  ret = GetFromCache(hash, found);
+  if (!found) {
     // not in cache, need to look up from phrase table
     ret = GetTargetPhraseCollectionNonCache(ptNode);
-
-    std::pair<const TargetPhraseCollection*, clock_t> value(ret, clock());
-    cache[hash] = value;
-  } else {
-    // in cache. just use it
-    std::pair<const TargetPhraseCollection*, clock_t> &value = iter->second;
-    value.second = clock();
-
-    ret = value.first;
+    AddToCache(hash, ret);
   }
 
   return ret;
@@ -62,7 +62,9 @@ protected:
   OnDiskPt::OnDiskWrapper &GetImplementation();
   const OnDiskPt::OnDiskWrapper &GetImplementation() const;
 
-  void GetTargetPhraseCollectionBatch(InputPath &inputPath) const;
+  //! the node of the path's phrase in the source tree, NULL if there is
+  //! none; kept on the path, for the paths extending it
+  const OnDiskPt::PhraseNode *FindSourceNode(InputPath &inputPath) const;
 
 public:
   PhraseDictionaryOnDisk(const std::string &line);
@@ -78,6 +80,9 @@ public:
   virtual void InitializeForInput(InputType const& source);
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
+  //! the files mapped by this thread's wrapper, if any
+  void ReportMemory(MemoryUsage &usage) const;
+
   const TargetPhraseCollection *GetTargetPhraseCollection(const OnDiskPt::PhraseNode *ptNode) const;
   const TargetPhraseCollection *GetTargetPhraseCollectionNonCache(const OnDiskPt::PhraseNode *ptNode) const;
 
@@ -0,0 +1,252 @@
+/***********************************************************************
+  Moses - statistical machine translation system
+  Copyright (C) 2006-2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "RuleTableParser.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/ThreadPool.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
+#include "util/double-conversion/double-conversion.h"
+#include "util/exception.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+namespace Moses
+{
+
+namespace
+{
+
+// Number of lines parsed by one task.
+const size_t RULE_TABLE_BLOCK_SIZE = 10000;
+
+class ParseBlockTask : public Task
+{
+public:
+  ParseBlockTask(const RuleTableParser &parser, size_t firstLine)
+    : m_parser(parser)
+    , m_firstLine(firstLine) {
+    m_lines.reserve(RULE_TABLE_BLOCK_SIZE);
+  }
+
+  std::vector<std::string> &Lines() {
+    return m_lines;
+  }
+  std::vector<ParsedRule> &Rules() {
+    return m_rules;
+  }
+  const std::string &Error() const {
+    return m_error;
+  }
+
+  void Run() {
+    // exceptions must not escape a worker thread; they are rethrown by
+    // the reading thread
+    try {
+      m_rules.reserve(m_lines.size());
+      for (size_t i = 0; i < m_lines.size(); ++i) {
+        m_rules.push_back(ParsedRule());
+        if (!m_parser.Parse(m_lines[i], m_firstLine + i, m_rules.back())) {
+          m_rules.pop_back();
+        }
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    std::vector<std::string>().swap(m_lines);
+  }
+
+private:
+  const RuleTableParser &m_parser;
+  size_t m_firstLine;
+  std::vector<std::string> m_lines;
+  std::vector<ParsedRule> m_rules;
+  std::string m_error;
+};
+
+bool ReadLine(util::FilePiece &in, StringPiece &line)
+{
+  try {
+    line = in.ReadLine();
+  } catch (const util::EndOfFileException &e) {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+RuleTableParser::RuleTableParser(const std::vector<FactorType> &input,
+                                 const std::vector<FactorType> &output,
+                                 const PhraseDictionary &ff,
+                                 size_t threads)
+  : m_input(input)
+  , m_output(output)
+  , m_ff(ff)
+  , m_threads(threads)
+  , m_lineNum(0)
+  , m_wordDeletionEnabled(StaticData::Instance().IsWordDeletionEnabled())
+{
+#ifndef WITH_THREADS
+  m_threads = 1;
+#endif
+  if (m_threads == 0) m_threads = 1;
+}
+
+bool RuleTableParser::ReadRules(util::FilePiece &in,
+                                std::vector<ParsedRule> &rules,
+                                Reformatter reformat)
+{
+  rules.clear();
+  StringPiece line;
+  std::string reformatted;
+
+  if (m_threads == 1) {
+    bool eof = false;
+    for (size_t i = 0; i < RULE_TABLE_BLOCK_SIZE; ++i, ++m_lineNum) {
+      if (!ReadLine(in, line)) {
+        eof = true;
+        break;
+      }
+      if (reformat) {
+        reformat(line.as_string(), reformatted);
+        line = reformatted;
+      }
+      rules.push_back(ParsedRule());
+      if (!Parse(line, m_lineNum, rules.back())) {
+        rules.pop_back();
+      }
+    }
+    return !eof || !rules.empty();
+  }
+
+  // read a few blocks per thread, parse them in parallel
+  std::vector<boost::shared_ptr<ParseBlockTask> > blocks;
+  bool eof = false;
+  while (!eof && blocks.size() < 4 * m_threads) {
+    boost::shared_ptr<ParseBlockTask> block(new ParseBlockTask(*this, m_lineNum));
+    std::vector<std::string> &lines = block->Lines();
+    while (lines.size() < RULE_TABLE_BLOCK_SIZE) {
+      if (!ReadLine(in, line)) {
+        eof = true;
+        break;
+      }
+      if (reformat) {
+        reformat(line.as_string(), reformatted);
+        lines.push_back(reformatted);
+      } else {
+        lines.push_back(line.as_string());
+      }
+    }
+    m_lineNum += lines.size();
+    if (!lines.empty()) blocks.push_back(block);
+  }
+
+#ifdef WITH_THREADS
+  {
+    ThreadPool pool(std::min(m_threads, blocks.size()));
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      pool.Submit(blocks[i]);
+    }
+    pool.Stop(true);
+  }
+#endif
+
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    UTIL_THROW_IF2(!blocks[i]->Error().empty(), blocks[i]->Error());
+    const std::vector<ParsedRule> &blockRules = blocks[i]->Rules();
+    rules.insert(rules.end(), blockRules.begin(), blockRules.end());
+  }
+  return !eof || !rules.empty();
+}
+
+bool RuleTableParser::Parse(const StringPiece &line, size_t lineNum, ParsedRule &rule) const
+{
+  util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+  StringPiece sourcePhraseString(*pipes);
+  StringPiece targetPhraseString(*++pipes);
+  StringPiece scoreString(*++pipes);
+
+  StringPiece alignString;
+  if (++pipes) {
+    StringPiece temp(*pipes);
+    alignString = temp;
+  }
+
+  bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == std::string::npos);
+  if (isLHSEmpty && !m_wordDeletionEnabled) {
+    TRACE_ERR( m_ff.GetFilePath() << ":" << lineNum << ": pt entry contains empty target, skipping\n");
+    return false;
+  }
+
+  double_conversion::StringToDoubleConverter converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan");
+  std::vector<float> scoreVector;
+  for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
+    int processed;
+    float score = converter.StringToFloat(s->data(), s->length(), &processed);
+    UTIL_THROW_IF2(std::isnan(score), "Bad score " << *s << " on line " << lineNum);
+    scoreVector.push_back(FloorScore(TransformScore(score)));
+  }
+  const size_t numScoreComponents = m_ff.GetNumScoreComponents();
+  if (scoreVector.size() != numScoreComponents) {
+    UTIL_THROW2("Size of scoreVector != number (" << scoreVector.size() << "!="
+                << numScoreComponents << ") of score components on line " << lineNum);
+  }
+
+  // constituent labels
+  Word *targetLHS;
+
+  // create target phrase obj
+  TargetPhrase *targetPhrase = new TargetPhrase(&m_ff);
+  targetPhrase->CreateFromString(Output, m_output, targetPhraseString, &targetLHS);
+  // source
+  rule.sourcePhrase.CreateFromString(Input, m_input, sourcePhraseString, &rule.sourceLHS);
+
+  // rest of target phrase
+  targetPhrase->SetAlignmentInfo(alignString);
+  targetPhrase->SetTargetLHS(targetLHS);
+
+  ++pipes;  // skip over counts field
+
+  if (++pipes) {
+    StringPiece sparseString(*pipes);
+    targetPhrase->SetSparseScore(&m_ff, sparseString);
+  }
+
+  if (++pipes) {
+    StringPiece propertiesString(*pipes);
+    targetPhrase->SetProperties(propertiesString);
+  }
+
+  targetPhrase->GetScoreBreakdown().Assign(&m_ff, scoreVector);
+  targetPhrase->EvaluateInIsolation(rule.sourcePhrase, m_ff.GetFeaturesToApply());
+
+  rule.targetPhrase = targetPhrase;
+  return true;
+}
+
+}  // namespace Moses
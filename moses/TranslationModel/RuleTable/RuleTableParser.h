@@ -0,0 +1,87 @@
+/***********************************************************************
+  Moses - statistical machine translation system
+  Copyright (C) 2006-2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "moses/Phrase.h"
+#include "moses/TypeDef.h"
+#include "util/string_piece.hh"
+
+namespace util
+{
+class FilePiece;
+}
+
+namespace Moses
+{
+
+class PhraseDictionary;
+class TargetPhrase;
+class Word;
+
+//! A rule read from a text rule table, scored and ready to go into a trie.
+struct ParsedRule {
+  ParsedRule() : sourceLHS(NULL), targetPhrase(NULL) {}
+  Phrase sourcePhrase;
+  Word *sourceLHS;            //!< owned by the caller once returned
+  TargetPhrase *targetPhrase; //!< owned by the caller once returned
+};
+
+/** Parses the lines of a Moses-format text rule table into TargetPhrase
+ *  objects.  Parsing (creating the phrases, scoring, EvaluateInIsolation)
+ *  is done for blocks of lines on several threads; the rules are returned
+ *  in file order so that the caller can add them to its rule trie, which
+ *  isn't thread-safe, on a single thread.
+ */
+class RuleTableParser
+{
+public:
+  //! for reformatting lines of other formats into Moses format
+  typedef void (*Reformatter)(const std::string &in, std::string &out);
+
+  RuleTableParser(const std::vector<FactorType> &input,
+                  const std::vector<FactorType> &output,
+                  const PhraseDictionary &ff,
+                  size_t threads);
+
+  /** Clears rules and fills it with the rules of the next lines of in.
+   *  Returns false once the end of the file has been reached and there
+   *  are no more rules.
+   */
+  bool ReadRules(util::FilePiece &in, std::vector<ParsedRule> &rules,
+                 Reformatter reformat = NULL);
+
+  /** Parses a single line.  Returns false if the line is to be skipped.
+   *  Thread-safe.
+   */
+  bool Parse(const StringPiece &line, size_t lineNum, ParsedRule &rule) const;
+
+private:
+  const std::vector<FactorType> &m_input;
+  const std::vector<FactorType> &m_output;
+  const PhraseDictionary &m_ff;
+  size_t m_threads;
+  size_t m_lineNum;
+  bool m_wordDeletionEnabled;
+};
+
+}  // namespace Moses
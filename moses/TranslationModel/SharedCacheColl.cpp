@@ -0,0 +1,305 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include "SharedCacheColl.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TargetPhraseCollection.h"
+
+#ifdef WITH_THREADS
+#define SCOPED_LOCK(m) boost::mutex::scoped_lock lock(m)
+#else
+#define SCOPED_LOCK(m)
+#endif
+
+namespace Moses
+{
+
+#ifdef WITH_THREADS
+namespace
+{
+// guards ThreadRecord::owner between a thread's exit and the cache's
+// destruction, which may happen in either order
+boost::mutex s_ownerMutex;
+}
+#endif
+
+SharedCacheColl::SharedCacheColl(size_t maxBytes)
+  : m_maxBytesPerShard(maxBytes / NUM_SHARDS)
+#ifdef WITH_THREADS
+  , m_threadRecord(&ThreadExit)
+#endif
+  , m_epoch(0)
+{
+#ifndef WITH_THREADS
+  m_threadRecordSingle.owner = this;
+  m_threadRecordSingle.epoch = 0;
+  m_threadRecordSingle.active = false;
+  m_threadRecords.push_back(&m_threadRecordSingle);
+#endif
+}
+
+SharedCacheColl::~SharedCacheColl()
+{
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    boost::unordered_map<size_t, Entry>::iterator iter;
+    for (iter = m_shards[i].entries.begin(); iter != m_shards[i].entries.end(); ++iter) {
+      delete iter->second.tpc;
+    }
+  }
+  for (size_t i = 0; i < m_retired.size(); ++i) {
+    delete m_retired[i].second;
+  }
+#ifdef WITH_THREADS
+  // the records of other threads are deleted when they exit, this
+  // thread's one here, once no longer listed
+  {
+    boost::mutex::scoped_lock ownerLock(s_ownerMutex);
+    boost::mutex::scoped_lock lock(m_epochMutex);
+    for (size_t i = 0; i < m_threadRecords.size(); ++i) {
+      m_threadRecords[i]->owner = NULL;
+    }
+    m_threadRecords.clear();
+  }
+  delete m_threadRecord.release();
+#endif
+}
+
+SharedCacheColl::ThreadRecord *SharedCacheColl::GetThreadRecord()
+{
+#ifdef WITH_THREADS
+  ThreadRecord *record = m_threadRecord.get();
+  if (record == NULL) {
+    record = new ThreadRecord;
+    record->owner = this;
+    record->epoch = 0;
+    record->active = false;
+    {
+      SCOPED_LOCK(m_epochMutex);
+      m_threadRecords.push_back(record);
+    }
+    m_threadRecord.reset(record);
+  }
+  return record;
+#else
+  return &m_threadRecordSingle;
+#endif
+}
+
+void SharedCacheColl::ThreadExit(ThreadRecord *record)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock ownerLock(s_ownerMutex);
+  SharedCacheColl *owner = record->owner;
+  if (owner) {
+    boost::mutex::scoped_lock lock(owner->m_epochMutex);
+    std::vector<ThreadRecord*> &records = owner->m_threadRecords;
+    records.erase(std::remove(records.begin(), records.end(), record), records.end());
+  }
+#endif
+  delete record;
+}
+
+void SharedCacheColl::EnterSentence()
+{
+  // only the thread itself changes active, so it may read it unlocked
+  ThreadRecord *record = GetThreadRecord();
+  if (record->active) return;
+  SCOPED_LOCK(m_epochMutex);
+  record->epoch = m_epoch;
+  record->active = true;
+}
+
+const TargetPhraseCollection *SharedCacheColl::Get(size_t key, bool &found)
+{
+  // register the thread before it can obtain any pointer
+  EnterSentence();
+
+  Shard &shard = GetShard(key);
+  SCOPED_LOCK(shard.mutex);
+  boost::unordered_map<size_t, Entry>::iterator iter = shard.entries.find(key);
+  if (iter == shard.entries.end()) {
+    ++shard.misses;
+    found = false;
+    return NULL;
+  }
+  ++shard.hits;
+  iter->second.referenced = true;
+  found = true;
+  return iter->second.tpc;
+}
+
+void SharedCacheColl::Add(size_t key, const TargetPhraseCollection *tpc)
+{
+  EnterSentence();
+
+  const TargetPhraseCollection *replaced = NULL;
+  {
+    Shard &shard = GetShard(key);
+    SCOPED_LOCK(shard.mutex);
+    Entry entry;
+    entry.tpc = tpc;
+    entry.bytes = EstimateSize(tpc);
+    entry.referenced = true;
+
+    boost::unordered_map<size_t, Entry>::iterator iter = shard.entries.find(key);
+    if (iter != shard.entries.end()) {
+      // another thread (or an earlier lookup) got there first
+      replaced = iter->second.tpc;
+      shard.bytes -= iter->second.bytes;
+      entry.ringPos = iter->second.ringPos;
+      iter->second = entry;
+    } else {
+      entry.ringPos = shard.ring.size();
+      shard.ring.push_back(key);
+      shard.entries[key] = entry;
+    }
+    shard.bytes += entry.bytes;
+    Evict(shard);
+  }
+  if (replaced) Retire(replaced);
+}
+
+void SharedCacheColl::Evict(Shard &shard)
+{
+  std::vector<const TargetPhraseCollection*> evicted;
+  while (shard.bytes > m_maxBytesPerShard && shard.ring.size() > 1) {
+    if (shard.hand >= shard.ring.size()) shard.hand = 0;
+    size_t key = shard.ring[shard.hand];
+    Entry &entry = shard.entries[key];
+    if (entry.referenced) {
+      // second chance
+      entry.referenced = false;
+      ++shard.hand;
+      continue;
+    }
+    evicted.push_back(entry.tpc);
+    shard.bytes -= entry.bytes;
+    shard.entries.erase(key);
+
+    // move the last key into the free slot
+    size_t last = shard.ring.back();
+    shard.ring.pop_back();
+    if (shard.hand < shard.ring.size()) {
+      shard.ring[shard.hand] = last;
+      shard.entries[last].ringPos = shard.hand;
+    }
+  }
+  for (size_t i = 0; i < evicted.size(); ++i) {
+    Retire(evicted[i]);
+  }
+}
+
+void SharedCacheColl::Retire(const TargetPhraseCollection *tpc)
+{
+  if (tpc == NULL) return;
+  SCOPED_LOCK(m_epochMutex);
+  m_retired.push_back(std::make_pair(m_epoch, tpc));
+}
+
+void SharedCacheColl::EndOfSentence()
+{
+  ThreadRecord *record = GetThreadRecord();
+
+  std::vector<const TargetPhraseCollection*> toDelete;
+  {
+    SCOPED_LOCK(m_epochMutex);
+    ++m_epoch;
+    record->active = false;
+
+    // a collection retired before the oldest sentence still using the
+    // cache started cannot be held by anyone
+    size_t minEpoch = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < m_threadRecords.size(); ++i) {
+      if (m_threadRecords[i]->active) {
+        minEpoch = std::min(minEpoch, m_threadRecords[i]->epoch);
+      }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < m_retired.size(); ++i) {
+      if (m_retired[i].first < minEpoch) {
+        toDelete.push_back(m_retired[i].second);
+      } else {
+        m_retired[kept++] = m_retired[i];
+      }
+    }
+    m_retired.resize(kept);
+  }
+  for (size_t i = 0; i < toDelete.size(); ++i) {
+    delete toDelete[i];
+  }
+}
+
+size_t SharedCacheColl::GetHits() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    SCOPED_LOCK(m_shards[i].mutex);
+    ret += m_shards[i].hits;
+  }
+  return ret;
+}
+
+size_t SharedCacheColl::GetMisses() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    SCOPED_LOCK(m_shards[i].mutex);
+    ret += m_shards[i].misses;
+  }
+  return ret;
+}
+
+size_t SharedCacheColl::GetBytes() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    SCOPED_LOCK(m_shards[i].mutex);
+    ret += m_shards[i].bytes;
+  }
+  return ret;
+}
+
+size_t SharedCacheColl::GetSize() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    SCOPED_LOCK(m_shards[i].mutex);
+    ret += m_shards[i].entries.size();
+  }
+  return ret;
+}
+
+size_t SharedCacheColl::EstimateSize(const TargetPhraseCollection *tpc)
+{
+  size_t ret = sizeof(Entry) + 2 * sizeof(size_t);
+  if (tpc == NULL) return ret;
+  ret += sizeof(TargetPhraseCollection);
+  TargetPhraseCollection::const_iterator iter;
+  for (iter = tpc->begin(); iter != tpc->end(); ++iter) {
+    const TargetPhrase &tp = **iter;
+    ret += sizeof(const TargetPhrase*) + sizeof(TargetPhrase)
+           + tp.GetSize() * sizeof(Word)
+           + tp.GetScoreBreakdown().GetScoresVector().size() * sizeof(float);
+  }
+  return ret;
+}
+
+}
@@ -0,0 +1,132 @@
+// -*- c++ -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#pragma once
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Moses
+{
+class TargetPhraseCollection;
+
+/** Process-wide cache of target phrase collections, shared by all decoder
+ *  threads of one phrase table.
+ *
+ *  The cache is split into shards by key, each with its own lock. Each shard
+ *  gets an equal slice of a memory budget and, when over it, evicts with the
+ *  CLOCK (second chance) algorithm, so there is no sorting pass.
+ *
+ *  Evicted collections may still be used by sentences in flight in other
+ *  threads, so they are not deleted straight away but retired. A thread calls
+ *  EndOfSentence() once it holds no more pointers obtained from the cache;
+ *  retired collections are deleted once every thread that was in a sentence
+ *  when the collection was retired has done so. Threads between sentences,
+ *  or that have exited, hold nothing and do not delay reclamation.
+ */
+class SharedCacheColl
+{
+public:
+  explicit SharedCacheColl(size_t maxBytes);
+  ~SharedCacheColl();
+
+  //! cached collection for key, found is false if there is none
+  const TargetPhraseCollection *Get(size_t key, bool &found);
+
+  //! takes ownership of tpc
+  void Add(size_t key, const TargetPhraseCollection *tpc);
+
+  //! the calling thread no longer uses collections it got from the cache
+  void EndOfSentence();
+
+  size_t GetHits() const;
+  size_t GetMisses() const;
+  size_t GetBytes() const;
+  //! number of cached collections
+  size_t GetSize() const;
+
+  //! rough number of bytes used by a collection
+  static size_t EstimateSize(const TargetPhraseCollection *tpc);
+
+private:
+  struct Entry {
+    const TargetPhraseCollection *tpc;
+    size_t bytes;
+    size_t ringPos;
+    bool referenced;
+  };
+
+  struct Shard {
+#ifdef WITH_THREADS
+    mutable boost::mutex mutex;
+#endif
+    boost::unordered_map<size_t, Entry> entries;
+    std::vector<size_t> ring; //!< keys in clock order
+    size_t hand;
+    size_t bytes;
+    size_t hits;
+    size_t misses;
+    Shard() : hand(0), bytes(0), hits(0), misses(0) {}
+  };
+
+  static const size_t NUM_SHARDS = 16;
+  Shard m_shards[NUM_SHARDS];
+  size_t m_maxBytesPerShard;
+
+  Shard &GetShard(size_t key) {
+    return m_shards[(key >> 8) % NUM_SHARDS];
+  }
+
+  //! make room in shard, called with the shard lock held
+  void Evict(Shard &shard);
+  void Retire(const TargetPhraseCollection *tpc);
+
+  //! a thread's place in epoch-based reclamation
+  struct ThreadRecord {
+    SharedCacheColl *owner; //!< NULL once the cache is gone
+    size_t epoch; //!< m_epoch when its current sentence started using the cache
+    bool active; //!< in a sentence, may hold pointers from the cache
+  };
+  //! mark the calling thread as in a sentence, registering it if new
+  void EnterSentence();
+  ThreadRecord *GetThreadRecord();
+  //! thread_specific_ptr cleanup: unregister on thread exit
+  static void ThreadExit(ThreadRecord *record);
+
+  // epoch-based reclamation
+#ifdef WITH_THREADS
+  boost::mutex m_epochMutex;
+  boost::thread_specific_ptr<ThreadRecord> m_threadRecord;
+#else
+  ThreadRecord m_threadRecordSingle;
+#endif
+  size_t m_epoch;
+  std::vector<ThreadRecord*> m_threadRecords; //!< the live threads that used the cache
+  std::vector<std::pair<size_t, const TargetPhraseCollection*> > m_retired;
+
+  SharedCacheColl(const SharedCacheColl &);
+  void operator=(const SharedCacheColl &);
+};
+
+}
@@ -5,8 +5,6 @@
 // 
 // (c) 2010-2012 Ulrich Germann
 
-// to do: multi-threading
-
 #include <queue>
 #include <iomanip>
 #include <vector>
@@ -71,6 +69,9 @@ public:
   countlist_t & LEX;
   size_t  offset;
   size_t    skip;
+  // per-sentence word counts; allocated once per thread and cleared
+  // after each sentence, since the vocabularies can be large
+  vector<ushort> cnt1, cnt2;
   Counter(countlist_t& lex, size_t o, size_t s) 
     : LEX(lex), offset(o), skip(s) {}
   void processSentence(id_type sid);
@@ -220,8 +221,8 @@ processSentence(id_type sid)
   Token const* e1 = T1.sntEnd(sid);
   Token const* s2 = T2.sntStart(sid);
   Token const* e2 = T2.sntEnd(sid);
-  vector<ushort> cnt1(V1.ksize(),0);
-  vector<ushort> cnt2(V2.ksize(),0);
+  if (cnt1.size() != V1.ksize()) cnt1.assign(V1.ksize(),0);
+  if (cnt2.size() != V2.ksize()) cnt2.assign(V2.ksize(),0);
   for (Token const* x = s1; x < e1; ++x) 
     ++cnt1.at(x->id());
   for (Token const* x = s2; x < e2; ++x) 
@@ -264,6 +265,9 @@ processSentence(id_type sid)
        i < check2.size(); 
        i = check2.find_next(i))
     CNT[wpair(0,(s2+i)->id())].a++;
+
+  for (Token const* x = s1; x < e1; ++x) cnt1[x->id()] = 0;
+  for (Token const* x = s2; x < e2; ++x) cnt2[x->id()] = 0;
 }
 
 // void
@@ -39,6 +39,7 @@ namespace po=boost::program_options;
 int with_pfas;
 int with_dcas;
 int with_sfas;
+size_t num_threads; // threads per suffix array for sorting
 
 bool incremental = false; // build / grow vocabs automatically
 bool is_conll    = false; // text or conll format?
@@ -366,7 +367,7 @@ build_mmTSA(string infile, string outfile)
   boost::shared_ptr<mmTtrack<Token> > T(new mmTtrack<Token>(infile));
   bdBitset filter;
   filter.resize(T->size(),true);
-  imTSA<Token> S(T,&filter,(quiet?NULL:&cerr));
+  imTSA<Token> S(T,&filter,(quiet?NULL:&cerr),num_threads);
   S.save_as_mm_tsa(outfile);
   exit(0);
 }
@@ -468,6 +469,9 @@ interpret_args(int ac, char* av[])
     ("unk,u", po::value<string>(&UNK)->default_value("UNK"),
      "label for unknown tokens")
 
+    ("threads,t", po::value<size_t>(&num_threads)->default_value(1),
+     "sort each suffix array on <N> threads")
+
     // ("map,m", po::value<string>(&vmap), 
     // "map words to word classes for indexing")
     
@@ -0,0 +1,629 @@
+// -*- c++ -*-
+// Significance filtering of phrase tables as in H. Johnson et al. (2007),
+// "Improving Translation Quality by Discarding Most of the Phrasetable",
+// on the memory-mapped corpus tracks and suffix arrays built by mtt-build
+// (the indexes mmsapt uses). Drop-in replacement for
+// contrib/sigtest-filter/filter-pt, which needs SALM.
+//
+// The phrase table is cut into blocks at source phrase boundaries; worker
+// threads filter whole blocks and write them out in input order.
+// Sentence id sets of frequent phrases are kept in an LRU cache shared by
+// all workers, so the target phrases that recur under many source phrases
+// are looked up only once, and each source phrase is looked up only once
+// for all its translation options.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <unistd.h>
+
+#include "ug_mm_ttrack.h"
+#include "ug_mm_tsa.h"
+#include "tpt_tokenindex.h"
+#include "ug_corpus_token.h"
+#include "ug_lru_cache.h"
+
+using namespace std;
+using namespace ugdiss;
+typedef L2R_Token<SimpleWordId> Token;
+typedef vector<id_type> SidSet;  // sorted, unique sentence ids
+typedef boost::shared_ptr<SidSet const> SidSetPtr;
+
+// sets of fewer sentences are recomputed rather than cached
+size_t const MINIMUM_SIZE_TO_KEEP = 10000;
+string const SEPARATOR = " ||| ";
+
+double const ALPHA_PLUS_EPS  = -1000.0; // dummy value
+double const ALPHA_MINUS_EPS = -2000.0; // dummy value
+
+// configuration params
+size_t pfe_filter_limit = 0;            // 0 = don't filter anything based on P(f|e)
+bool print_cooc_counts = false;         // add cooc counts to phrase table?
+bool print_neglog_significance = false; // add -log(p) to phrase table?
+double sig_filter_limit = 0;            // keep phrase pairs with -log(sig) > sig_filter_limit
+bool pef_filter_only = false;           // only filter based on pef
+bool hierarchical = false;
+int pfe_index = 2;
+size_t block_size = 100000;             // phrase table lines per block
+
+size_t num_lines = 0;                   // sentences in the bitext
+
+SidSetPtr const no_sentences(new SidSet());
+
+// --------------------------------------------------------------------------
+// One side of the bitext: token track, vocabulary and suffix array, and
+// the cache of sentence id sets of its phrases.
+
+class Corpus
+{
+  boost::shared_ptr<mmTtrack<Token> > T;
+  TokenIndex V;
+  mmTSA<Token> I;
+  mutable lru_cache::LRU_Cache< ::uint64_t, SidSet const> m_cache;
+
+  SidSetPtr lookup_terminals(vector<id_type> const& phrase) const;
+
+public:
+  Corpus() : T(new mmTtrack<Token>()) {}
+
+  void open(string const& bname, size_t const max_cache);
+  size_t size() const { return T->size(); }
+  void cache_stats(size_t& hits, size_t& misses) const;
+
+  // sentences that contain /phrase/; for hierarchical rules, sentences that
+  // contain all its sequences of terminals. NULL if there are no terminals.
+  SidSetPtr lookup(string const& phrase) const;
+};
+
+void
+Corpus::
+open(string const& bname, size_t const max_cache)
+{
+  T->open(bname+".mct");
+  V.open(bname+".tdx"); V.iniReverseIndex();
+  I.open(bname+".sfa",T);
+  m_cache.reserve(max_cache ? max_cache : 100000);
+}
+
+void
+Corpus::
+cache_stats(size_t& hits, size_t& misses) const
+{
+  size_t evictions;
+  m_cache.stats(hits,misses,evictions);
+}
+
+SidSetPtr
+Corpus::
+lookup_terminals(vector<id_type> const& phrase) const
+{
+  TSA<Token>::tree_iterator m(&I);
+  for (size_t i = 0; i < phrase.size(); ++i)
+    if (!m.extend(phrase[i])) return no_sentences;
+
+  ::uint64_t const pid = m.getPid();
+  SidSetPtr cached = m_cache.get(pid);
+  if (cached) return cached;
+
+  boost::shared_ptr<SidSet> ret(new SidSet());
+  if (m.approxOccurrenceCount() * 32 > size())
+    {
+      // frequent phrase: marking a bit per sentence is cheaper than sorting
+      boost::dynamic_bitset< ::uint64_t> check;
+      m.markSentences(check);
+      ret->reserve(check.count());
+      for (size_t s = check.find_first(); s < check.size(); s = check.find_next(s))
+        ret->push_back(s);
+    }
+  else
+    {
+      char const* p = m.lower_bound(-1);
+      char const* const q = m.upper_bound(-1);
+      id_type sid; ushort off;
+      while (p < q)
+        {
+          p = I.readSid(p,q,sid);
+          p = I.readOffset(p,q,off);
+          ret->push_back(sid);
+        }
+      sort(ret->begin(),ret->end());
+      ret->erase(unique(ret->begin(),ret->end()),ret->end());
+    }
+  if (ret->size() >= MINIMUM_SIZE_TO_KEEP)
+    m_cache.set(pid,ret);
+  return ret;
+}
+
+SidSetPtr
+Corpus::
+lookup(string const& phrase) const
+{
+  // we search for hierarchical rules by stripping away the non-terminals
+  // (and the left hand side) and looking for the sequences of terminals
+  // in between; sentences must contain all of them.
+  vector<vector<id_type> > seqs(1);
+  istringstream buf(phrase);
+  for (string w; buf >> w;)
+    {
+      if (hierarchical && w.size() > 1 && w[0] == '[' && w[w.size()-1] == ']')
+        {
+          if (seqs.back().size()) seqs.push_back(vector<id_type>());
+          continue;
+        }
+      seqs.back().push_back(V[w]);
+    }
+  if (seqs.back().empty()) seqs.pop_back();
+  if (seqs.empty()) return SidSetPtr();
+
+  SidSetPtr ret = lookup_terminals(seqs[0]);
+  for (size_t i = 1; i < seqs.size() && ret->size(); ++i)
+    {
+      SidSetPtr other = lookup_terminals(seqs[i]);
+      boost::shared_ptr<SidSet> both(new SidSet());
+      set_intersection(ret->begin(),ret->end(),other->begin(),other->end(),
+                       back_inserter(*both));
+      ret = both;
+    }
+  return ret;
+}
+
+Corpus e_corpus;
+Corpus f_corpus;
+
+// --------------------------------------------------------------------------
+
+// number of sentences in both sets
+size_t
+count_common(SidSet const& a, SidSet const& b)
+{
+  if (a.size() > b.size()) return count_common(b,a);
+  size_t ret = 0;
+  if (a.size() * 16 < b.size())
+    {
+      // look the few up in the many
+      SidSet::const_iterator m = b.begin();
+      for (SidSet::const_iterator i = a.begin(); i != a.end(); ++i)
+        {
+          m = lower_bound(m,b.end(),*i);
+          if (m == b.end()) break;
+          if (*m == *i) ++ret;
+        }
+      return ret;
+    }
+  SidSet::const_iterator i = a.begin(), k = b.begin();
+  while (i != a.end() && k != b.end())
+    {
+      if      (*i < *k) ++i;
+      else if (*k < *i) ++k;
+      else { ++ret; ++i; ++k; }
+    }
+  return ret;
+}
+
+// 2x2 (one-sided) Fisher's exact test
+// see B. Moore. (2004) On Log Likelihood and the Significance of Rare Events
+double
+fisher_exact(int cfe, int ce, int cf)
+{
+  assert(cfe <= ce);
+  assert(cfe <= cf);
+
+  int a = cfe;
+  int b = (cf - cfe);
+  int c = (ce - cfe);
+  int d = (num_lines - ce - cf + cfe);
+  int n = a + b + c + d;
+
+  double cp = exp(lgamma(1+a+c) + lgamma(1+b+d) + lgamma(1+a+b) + lgamma(1+c+d)
+                  - lgamma(1+n) - lgamma(1+a) - lgamma(1+b) - lgamma(1+c)
+                  - lgamma(1+d));
+  double total_p = 0.0;
+  int tc = min(b,c);
+  for (int i=0; i<=tc; i++)
+    {
+      total_p += cp;
+      double coef = (double)(b)*(double)(c)/(double)(a+1)/(double)(d+1);
+      cp *= coef;
+      ++a;
+      --c;
+      ++d;
+      --b;
+    }
+  return total_p;
+}
+
+// --------------------------------------------------------------------------
+
+struct PTEntry
+{
+  PTEntry(string const& str, int index);
+  string f_phrase;
+  string e_phrase;
+  string extra;
+  string scores;
+  float pfe;
+  int cf;
+  int ce;
+  int cfe;
+  float nlog_pte;
+  void set_cooc_stats(int _cef, int _cf, int _ce, float nlp)
+  {
+    cfe = _cef;
+    cf = _cf;
+    ce = _ce;
+    nlog_pte = nlp;
+  }
+};
+
+PTEntry::
+PTEntry(string const& str, int index)
+  : cf(0), ce(0), cfe(0), nlog_pte(0.0)
+{
+  size_t pos = 0;
+  size_t nextPos = str.find(SEPARATOR, pos);
+  f_phrase = str.substr(pos,nextPos);
+
+  pos = nextPos + SEPARATOR.size();
+  nextPos = str.find(SEPARATOR, pos);
+  e_phrase = str.substr(pos,nextPos-pos);
+
+  pos = nextPos + SEPARATOR.size();
+  nextPos = str.find(SEPARATOR, pos);
+  if (nextPos < str.size())
+    {
+      scores = str.substr(pos,nextPos-pos);
+      extra = str.substr(nextPos + SEPARATOR.size());
+    }
+  else scores = str.substr(pos);
+
+  // the index-th score, counting from 0
+  istringstream buf(scores);
+  for (int i = 0; i <= index && buf >> pfe; ++i);
+  if (!buf) pfe = 0;
+}
+
+struct PfeComparer
+{
+  bool operator()(PTEntry const* a, PTEntry const* b) const
+  {
+    return a->pfe > b->pfe;
+  }
+};
+
+ostream&
+operator<<(ostream& os, PTEntry const& pp)
+{
+  os << pp.f_phrase << " ||| " << pp.e_phrase;
+  os << " ||| " << pp.scores;
+  if (pp.extra.size()>0) os << " ||| " << pp.extra;
+  if (print_cooc_counts) os << " ||| " << pp.cfe << " " << pp.cf << " " << pp.ce;
+  if (print_neglog_significance) os << " ||| " << pp.nlog_pte;
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+// filtered lines of a block, and what was removed from it
+struct BlockStats
+{
+  size_t lines, nremoved_pfefilter, nremoved_sigfilter;
+  BlockStats() : lines(0), nremoved_pfefilter(0), nremoved_sigfilter(0) {}
+};
+
+// input: unordered list of translation options for a single source phrase;
+// removes the ones that don't pass the filters
+void
+compute_cooc_stats_and_filter(vector<PTEntry*>& options, BlockStats& stats)
+{
+  if (pfe_filter_limit > 0 && options.size() > pfe_filter_limit)
+    {
+      stats.nremoved_pfefilter += (options.size() - pfe_filter_limit);
+      nth_element(options.begin(), options.begin() + pfe_filter_limit,
+                  options.end(), PfeComparer());
+      for (size_t i = pfe_filter_limit; i < options.size(); ++i)
+        delete options[i];
+      options.resize(pfe_filter_limit);
+    }
+
+  if (pef_filter_only || options.empty())
+    return;
+
+  SidSetPtr fset = f_corpus.lookup(options.front()->f_phrase);
+  size_t k = 0;
+  for (size_t i = 0; i < options.size(); ++i)
+    {
+      PTEntry* pp = options[i];
+      SidSetPtr eset = e_corpus.lookup(pp->e_phrase);
+      if (fset && eset)
+        {
+          size_t const cf = fset->size();
+          size_t const ce = eset->size();
+          size_t const cfe = count_common(*fset,*eset);
+          pp->set_cooc_stats(cfe, cf, ce, -log(fisher_exact(cfe, cf, ce)));
+        }
+      else // a side without terminals can't be tested; keep the pair
+        pp->set_cooc_stats(0, 0, 0, numeric_limits<float>::infinity());
+
+      if (pp->nlog_pte < sig_filter_limit)
+        {
+          delete pp;
+          ++stats.nremoved_sigfilter;
+        }
+      else options[k++] = pp;
+    }
+  options.resize(k);
+}
+
+void
+filter_block(vector<string> const& lines, ostream& out, BlockStats& stats)
+{
+  vector<PTEntry*> options;
+  for (size_t i = 0; i <= lines.size(); ++i)
+    {
+      PTEntry* pp = NULL;
+      if (i < lines.size())
+        {
+          if (lines[i].empty()) continue;
+          pp = new PTEntry(lines[i], pfe_index);
+          ++stats.lines;
+          if (options.empty() || options.front()->f_phrase == pp->f_phrase)
+            {
+              options.push_back(pp);
+              continue;
+            }
+        }
+      compute_cooc_stats_and_filter(options, stats);
+      for (size_t k = 0; k < options.size(); ++k)
+        {
+          out << *options[k] << '\n';
+          delete options[k];
+        }
+      options.clear();
+      if (pp) options.push_back(pp);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// Hands out blocks of about block_size lines that never split the
+// translation options of a source phrase, and writes the filtered blocks
+// in the order they were read.
+class BlockQueue
+{
+  istream& m_in;
+  ostream& m_out;
+  string m_pending; // first line of the next block
+  bool m_eof;
+  size_t m_read, m_written;
+  BlockStats m_total;
+  boost::mutex m_in_lock, m_out_lock;
+  boost::condition_variable m_turn;
+
+  void progress(size_t const before);
+
+public:
+  BlockQueue(istream& in, ostream& out)
+    : m_in(in), m_out(out), m_eof(!getline(in,m_pending)), m_read(0), m_written(0)
+  { }
+
+  // the next block and its number; false at the end of the input
+  bool next(vector<string>& lines, size_t& id);
+  void write(size_t const id, string const& text, BlockStats const& stats);
+  BlockStats const& total() const { return m_total; }
+};
+
+bool
+BlockQueue::
+next(vector<string>& lines, size_t& id)
+{
+  boost::lock_guard<boost::mutex> lock(m_in_lock);
+  lines.clear();
+  if (m_eof) return false;
+  lines.push_back(m_pending);
+  string f = m_pending.substr(0, m_pending.find(SEPARATOR));
+  while (!(m_eof = !getline(m_in,m_pending)))
+    {
+      if (m_pending.compare(0, f.size(), f) != 0
+          || m_pending.compare(f.size(), SEPARATOR.size(), SEPARATOR) != 0)
+        {
+          if (lines.size() >= block_size) break;
+          f = m_pending.substr(0, m_pending.find(SEPARATOR));
+        }
+      lines.push_back(m_pending);
+    }
+  id = m_read++;
+  return true;
+}
+
+void
+BlockQueue::
+write(size_t const id, string const& text, BlockStats const& stats)
+{
+  boost::unique_lock<boost::mutex> lock(m_out_lock);
+  while (id != m_written) m_turn.wait(lock);
+  m_out << text << flush;
+  size_t const before = m_total.lines;
+  m_total.lines += stats.lines;
+  m_total.nremoved_pfefilter += stats.nremoved_pfefilter;
+  m_total.nremoved_sigfilter += stats.nremoved_sigfilter;
+  progress(before);
+  ++m_written;
+  m_turn.notify_all();
+}
+
+void
+print_stats(BlockStats const& s)
+{
+  float pfefper = (100.0*(float)s.nremoved_pfefilter)/(float)s.lines;
+  float sigfper = (100.0*(float)s.nremoved_sigfilter)/(float)s.lines;
+  cerr << "------------------------------------------------------\n"
+       << "  unfiltered phrases pairs: " << s.lines << "\n"
+       << "\n"
+       << "     P(f|e) filter [first]: " << s.nremoved_pfefilter << "   (" << pfefper << "%)\n"
+       << "       significance filter: " << s.nremoved_sigfilter << "   (" << sigfper << "%)\n"
+       << "            TOTAL FILTERED: " << (s.nremoved_pfefilter + s.nremoved_sigfilter) << "   (" << (sigfper + pfefper) << "%)\n"
+       << "\n"
+       << "     FILTERED phrase pairs: " << (s.lines - s.nremoved_pfefilter - s.nremoved_sigfilter) << "   (" << (100.0-sigfper - pfefper) << "%)\n"
+       << "------------------------------------------------------\n";
+}
+
+void
+BlockQueue::
+progress(size_t const before)
+{
+  // CALLER MUST LOCK m_out_lock
+  for (size_t n = (before / 10000 + 1) * 10000; n <= m_total.lines; n += 10000)
+    {
+      cerr << ".";
+      if (n % 500000 == 0) cerr << "[n:" << n << "]\n";
+      if (n % 10000000 == 0) print_stats(m_total);
+    }
+}
+
+void
+worker(BlockQueue* Q)
+{
+  vector<string> lines;
+  size_t id;
+  while (Q->next(lines,id))
+    {
+      ostringstream out;
+      BlockStats stats;
+      filter_block(lines, out, stats);
+      Q->write(id, out.str(), stats);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void
+usage()
+{
+  cerr << "\nFilter phrase table using significance testing as described\n"
+       << "in H. Johnson, et al. (2007) Improving Translation Quality\n"
+       << "by Discarding Most of the Phrasetable. EMNLP 2007.\n"
+       << "\nUsage:\n"
+       << "\n  mtt-sigtest-filter -e corpus.L2 -f corpus.L1\n"
+       << "      [-c] [-p] [-l threshold] [-n num] [-t num] < PHRASE-TABLE > FILTERED-PHRASE-TABLE\n\n"
+       << "   -e/-f are the base names of the target/source side of the bitext\n"
+       << "   as indexed by mtt-build (<base>.mct, <base>.sfa, <base>.tdx)\n\n"
+       << "   [-l threshold] >0.0, a+e, or a-e: keep values that have a -log significance > this\n"
+       << "   [-n num      ] 0, 1...: 0=no filtering, >0 sort by P(e|f) and keep the top num elements\n"
+       << "   [-c          ] add the cooccurence counts to the phrase table\n"
+       << "   [-p          ] add -log(significance) to the phrasetable\n"
+       << "   [-h          ] filter hierarchical rule table\n"
+       << "   [-i num      ] index of P(f|e) among the scores, from 0 (default 2)\n"
+       << "   [-t num      ] use num threads\n"
+       << "   [-b num      ] lines per block of work (default 100000)\n"
+       << "   [-m num      ] cache the sentences of num frequent phrases per side (default 100000)\n";
+  exit(1);
+}
+
+int
+main(int argc, char * argv[])
+{
+  int c;
+  char const* efile=0;
+  char const* ffile=0;
+  int threads = 1;
+  size_t max_cache = 0;
+  while ((c = getopt(argc, argv, "cpf:e:i:n:t:l:m:b:h")) != -1)
+    {
+      switch (c)
+        {
+        case 'e': efile = optarg; break;
+        case 'f': ffile = optarg; break;
+        case 'i': pfe_index = atoi(optarg); break;
+        case 'n':
+          pfe_filter_limit = atoi(optarg);
+          cerr << "P(f|e) filter limit: " << pfe_filter_limit << endl;
+          break;
+        case 't':
+          threads = max(1, atoi(optarg));
+          cerr << "Using threads: " << threads << endl;
+          break;
+        case 'm':
+          max_cache = atoi(optarg);
+          cerr << "Using max phrases in caches: " << max_cache << endl;
+          break;
+        case 'b': block_size = max(1, atoi(optarg)); break;
+        case 'c': print_cooc_counts = true; break;
+        case 'p': print_neglog_significance = true; break;
+        case 'h': hierarchical = true; break;
+        case 'l':
+          cerr << "-l = " << optarg << "\n";
+          if (strcmp(optarg,"a+e") == 0)
+            sig_filter_limit = ALPHA_PLUS_EPS;
+          else if (strcmp(optarg,"a-e") == 0)
+            sig_filter_limit = ALPHA_MINUS_EPS;
+          else
+            {
+              char *x;
+              sig_filter_limit = strtod(optarg, &x);
+              if (sig_filter_limit < 0.0)
+                {
+                  cerr << "Filter limit (-l) must be either 'a+e', 'a-e' or a real number >= 0.0\n";
+                  usage();
+                }
+            }
+          break;
+        default:
+          usage();
+        }
+    }
+
+  if (sig_filter_limit == 0.0) pef_filter_only = true;
+  if (optind != argc || ((!efile || !ffile) && !pef_filter_only))
+    usage();
+
+  if (!pef_filter_only)
+    {
+      e_corpus.open(efile, max_cache);
+      f_corpus.open(ffile, max_cache);
+      if (e_corpus.size() != f_corpus.size())
+        {
+          cerr << "Number of lines in e-corpus != number of lines in f-corpus!\n";
+          usage();
+        }
+      num_lines = e_corpus.size();
+      cerr << "Training corpus: " << num_lines << " lines\n";
+      double p_111 = -log(fisher_exact(1,1,1));
+      cerr << "\\alpha = " << p_111 << "\n";
+      if (sig_filter_limit == ALPHA_MINUS_EPS)
+        sig_filter_limit = p_111 - 0.001;
+      else if (sig_filter_limit == ALPHA_PLUS_EPS)
+        sig_filter_limit = p_111 + 0.001;
+      cerr << "Sig filter threshold is = " << sig_filter_limit << "\n";
+    }
+  else
+    cerr << "Filtering using P(e|f) only. n=" << pfe_filter_limit << endl;
+
+  ios_base::sync_with_stdio(false);
+
+  BlockQueue Q(cin,cout);
+  boost::thread_group workers;
+  for (int i = 0; i < threads; ++i)
+    workers.create_thread(boost::bind(worker,&Q));
+  workers.join_all();
+
+  cerr << "\n\n";
+  print_stats(Q.total());
+  if (!pef_filter_only)
+    {
+      size_t hits, misses;
+      f_corpus.cache_stats(hits,misses);
+      cerr << "source phrase cache: " << hits << " hits, " << misses << " misses\n";
+      e_corpus.cache_stats(hits,misses);
+      cerr << "target phrase cache: " << hits << " hits, " << misses << " misses\n";
+    }
+}
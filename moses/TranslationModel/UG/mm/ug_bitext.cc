@@ -83,11 +83,56 @@ namespace Moses
       my_aln.reserve(1); 
     }
 
+    void
+    pstats::
+    write(ostream& out) const
+    {
+      binwrite(out, ::uint64_t(raw_cnt));
+      binwrite(out, ::uint64_t(sample_cnt));
+      binwrite(out, ::uint64_t(good));
+      binwrite(out, ::uint64_t(sum_pairs));
+      for (int i = 0; i <= Moses::LRModel::NONE; ++i)
+	{
+	  binwrite(out, ofwd[i]);
+	  binwrite(out, obwd[i]);
+	}
+      binwrite(out, ::uint64_t(trg.size()));
+      for (trg_map_t::const_iterator m = trg.begin(); m != trg.end(); ++m)
+	{
+	  binwrite(out, m->first);
+	  m->second.write(out);
+	}
+    }
+
+    void
+    pstats::
+    read(istream& in)
+    {
+      ::uint64_t x; 
+      binread(in, x); raw_cnt = x;
+      binread(in, x); sample_cnt = x;
+      binread(in, x); good = x;
+      binread(in, x); sum_pairs = x;
+      for (int i = 0; i <= Moses::LRModel::NONE; ++i)
+	{
+	  binread(in, ofwd[i]);
+	  binread(in, obwd[i]);
+	}
+      ::uint64_t n, pid; 
+      binread(in, n);
+      for (::uint64_t i = 0; i < n && in; ++i)
+	{
+	  binread(in, pid);
+	  trg[pid].read(in);
+	}
+    }
+
     jstats::
     jstats(jstats const& other)
     {
       my_rcnt = other.rcnt();
       my_wcnt = other.wcnt();
+      my_cnt2 = other.cnt2();
       my_aln  = other.aln();
       for (int i = 0; i <= Moses::LRModel::NONE; i++)
 	{
@@ -180,6 +225,52 @@ namespace Moses
       return my_wcnt >= 0;
     }
 
+    void
+    jstats::
+    write(ostream& out) const
+    {
+      binwrite(out, my_rcnt);
+      binwrite(out, my_wcnt);
+      binwrite(out, my_cnt2);
+      for (int i = 0; i <= Moses::LRModel::NONE; ++i)
+	{
+	  binwrite(out, ofwd[i]);
+	  binwrite(out, obwd[i]);
+	}
+      binwrite(out, ::uint64_t(my_aln.size()));
+      for (size_t i = 0; i < my_aln.size(); ++i)
+	{
+	  binwrite(out, ::uint64_t(my_aln[i].first));
+	  binwrite(out, string(my_aln[i].second.begin(), my_aln[i].second.end()));
+	}
+    }
+
+    void
+    jstats::
+    read(istream& in)
+    {
+      binread(in, my_rcnt);
+      binread(in, my_wcnt);
+      binread(in, my_cnt2);
+      for (int i = 0; i <= Moses::LRModel::NONE; ++i)
+	{
+	  binread(in, ofwd[i]);
+	  binread(in, obwd[i]);
+	}
+      ::uint64_t n, cnt; 
+      binread(in, n);
+      if (!in) return;
+      my_aln.resize(n);
+      string a;
+      for (size_t i = 0; i < n && in; ++i)
+	{
+	  binread(in, cnt);
+	  binread(in, a);
+	  my_aln[i].first = cnt;
+	  my_aln[i].second.assign(a.begin(), a.end());
+	}
+    }
+
     
     float 
     lbop(size_t const tries, size_t const succ, float const confidence)
@@ -14,7 +14,7 @@
 //   data in to memory sequentially
 //
 // - use multiple agendas for better load balancing and to avoid 
-//   competition for locks
+//   competition for locks (done, see UG_BITEXT_WORKERS_PER_AGENDA)
 // 
 
 
@@ -25,6 +25,7 @@
 #include <cassert>
 #include <iomanip>
 #include <algorithm>
+#include <unistd.h>
 
 #include <boost/unordered_map.hpp>
 #include <boost/foreach.hpp>
@@ -57,6 +58,15 @@
 #include "ug_lexical_reordering.h"
 
 #define PSTATS_CACHE_THRESHOLD 50
+// workers get into each other's way beyond this many per agenda,
+// so larger worker pools are split into several agendas
+#define UG_BITEXT_WORKERS_PER_AGENDA 4
+// phrases occurring more often than this are sampled from a cached,
+// stratified list of their occurrences instead of walking the whole
+// suffix array range (see agenda::job::step())
+#define UG_BITEXT_OCC_CACHE_THRESHOLD 10000
+#define UG_BITEXT_OCC_CACHE_SIZE 1000   // max. number of cached phrases
+#define UG_BITEXT_OCC_SAMPLE_SIZE 65536 // max. occurrences kept per phrase
 
 using namespace ugdiss;
 using namespace std;
@@ -112,6 +122,10 @@ namespace Moses {
       bool valid();
       uint32_t dcnt_fwd(PhraseOrientation const idx) const;
       uint32_t dcnt_bwd(PhraseOrientation const idx) const;
+
+      // serialization for the persistent pstats cache
+      void write(ostream& out) const;
+      void read(istream& in);
     };
 
     struct 
@@ -149,6 +163,11 @@ namespace Moses {
 	  vector<uchar> const& a, 
 	  uint32_t      const cnt2,
 	  uint32_t fwd_o, uint32_t bwd_o);
+
+      // serialization of finished statistics (in_progress == 0) for the
+      // persistent pstats cache
+      void write(ostream& out) const;
+      void read(istream& in);
     };
     
 
@@ -474,11 +493,10 @@ namespace Moses {
       // stores the list of unfinished jobs;
       // maintains a pool of workers and assigns the jobs to them
       
-      // to be done: work with multiple agendas for faster lookup
-      // (multiplex jobs); not sure if an agenda having more than 
-      // four or so workers is efficient, because workers get into 
-      // each other's way. 
-      mutable sptr<agenda> ag; 
+      // Jobs are multiplexed over several agendas, each with at most
+      // UG_BITEXT_WORKERS_PER_AGENDA workers, because workers on one 
+      // agenda get into each other's way. 
+      mutable vector<sptr<agenda> > m_agendas; 
       
       sptr<Ttrack<char> >  Tx; // word alignments
       sptr<Ttrack<Token> > T1; // token track
@@ -519,11 +537,35 @@ namespace Moses {
       size_t default_sample_size;
       size_t num_workers;
       size_t m_pstats_cache_threshold;
+      mutable size_t m_next_agenda;
+
+      // persistent pstats cache (see open_pstats_cache): the file new
+      // entries are appended to, and cached entries not yet written
+      typedef vector<pair< ::uint64_t, sptr<pstats> > > unsaved_t;
+      mutable sptr<ofstream> m_pstats_file;
+      mutable unsaved_t m_pstats_unsaved1, m_pstats_unsaved2;
+      string pstats_cache_header() const;
+      void save_pstats() const; // caller must hold this->lock
       mutable pplist_cache_t m_pplist_cache1, m_pplist_cache2;
+
+      // occurrences (sid, offset) of a frequent phrase, in stratified order
+      struct occurrences 
+      {
+	size_t raw_cnt; // total number of occurrences
+	vector<pair<uint32_t,uint16_t> > pos; 
+      };
+      typedef lru_cache::LRU_Cache< ::uint64_t, occurrences> occ_cache_t;
+      mutable occ_cache_t m_occ_cache1, m_occ_cache2;
     private:
       sptr<pstats> 
       prep2(iter const& phrase, size_t const max_sample,
 	    SamplingBias const* const bias) const;
+
+      // the agenda that gets the next job; caller must hold this->lock
+      agenda& next_agenda() const;
+
+      // runs the job (num_workers <= 1) or waits for the workers to finish it
+      void wait_for(sptr<pstats> const& ret) const;
     public:
       Bitext(size_t const max_sample =1000, 
 	     size_t const xnum_workers =16);
@@ -538,6 +580,8 @@ namespace Moses {
 	     size_t const max_sample=1000,
 	     size_t const xnum_workers=16);
 	     
+      virtual ~Bitext();
+
       virtual void open(string const base, string const L1, string const L2) = 0;
       
       // sptr<pstats> lookup(Phrase const& phrase, size_t factor) const;
@@ -558,6 +602,14 @@ namespace Moses {
       void   setDefaultSampleSize(size_t const max_samples);
       size_t getDefaultSampleSize() const;
 
+      // Loads the phrase statistics cached in /fname/ by earlier runs into
+      // cache1/cache2 and, unless /read_only/, appends newly cached 
+      // statistics to it as they are completed.  The file is only valid 
+      // for the same static bitext and default sample size; a mismatch is
+      // reported and the file ignored (read_only) or started afresh. 
+      // Several processes may read one file, but only one may write it.
+      void open_pstats_cache(string const& fname, bool const read_only);
+
       string toString(::uint64_t pid, int isL2) const;
 
       virtual size_t revision() const { return 0; }
@@ -642,6 +694,9 @@ namespace Moses {
       : default_sample_size(max_sample)
       , num_workers(xnum_workers)
       , m_pstats_cache_threshold(PSTATS_CACHE_THRESHOLD)
+      , m_next_agenda(0)
+      , m_occ_cache1(UG_BITEXT_OCC_CACHE_SIZE)
+      , m_occ_cache2(UG_BITEXT_OCC_CACHE_SIZE)
     { }
 
     template<typename Token>
@@ -659,6 +714,9 @@ namespace Moses {
       , default_sample_size(max_sample)
       , num_workers(xnum_workers)
       , m_pstats_cache_threshold(PSTATS_CACHE_THRESHOLD)
+      , m_next_agenda(0)
+      , m_occ_cache1(UG_BITEXT_OCC_CACHE_SIZE)
+      , m_occ_cache2(UG_BITEXT_OCC_CACHE_SIZE)
     { }
 
     // agenda is a pool of jobs 
@@ -673,11 +731,16 @@ namespace Moses {
 #if UG_BITEXT_TRACK_ACTIVE_THREADS
 	static ThreadSafeCounter active;
 #endif
-	boost::mutex lock; 
+	mutable boost::mutex lock; 
 	friend class agenda;
 	boost::taus88 rnd;  // every job has its own pseudo random generator 
 	double rnddenom;    // denominator for scaling random sampling
 	size_t min_diverse; // minimum number of distinct translations
+	occ_cache_t* occ_cache;   // non-NULL if sampling from occurrence list
+	::uint64_t   occ_pid;     // key of the phrase in *occ_cache
+	sptr<occurrences const> occ; 
+	size_t       occ_next;    // next position in occ->pos
+	void fill_occurrences(); // caller must hold the job lock
       public:
 	size_t         workers; // how many workers are working on this job?
 	sptr<TSA<Token> const> root; // root of the underlying suffix array
@@ -696,7 +759,7 @@ namespace Moses {
 	bool done() const;
 	job(typename TSA<Token>::tree_iterator const& m, 
 	    sptr<TSA<Token> > const& r, size_t maxsmpl, bool isfwd, 
-	    SamplingBias const* const bias);
+	    SamplingBias const* const bias, occ_cache_t* const oc = NULL);
 	~job();
       };
     public:      
@@ -735,6 +798,21 @@ namespace Moses {
     step(::uint64_t & sid, ::uint64_t & offset)
     {
       boost::lock_guard<boost::mutex> jguard(lock);
+      if (occ_cache)
+	{
+	  // The occurrence list is in stratified random order, so we
+	  // simply take the next one: O(1) per sample.
+	  if (!occ) fill_occurrences();
+	  if (occ_next == occ->pos.size()) return false;
+	  boost::lock_guard<boost::mutex> sguard(stats->lock);
+	  if (stats->good >= max_samples && stats->trg.size() >= min_diverse)
+	    return false;
+	  sid    = occ->pos[occ_next].first;
+	  offset = occ->pos[occ_next].second;
+	  ++occ_next;
+	  stats->sample_cnt++;
+	  return true;
+	}
       bool ret = (max_samples == 0) && (next < stop);
       if (ret)
 	{
@@ -949,6 +1027,50 @@ namespace Moses {
 	}
     }
 
+    // Reads all occurrences of the phrase once, sorts them by corpus
+    // position and stores them in bit-reversed index order: every prefix
+    // of the list is then spread evenly over the corpus (a stratified
+    // sample), so only the first UG_BITEXT_OCC_SAMPLE_SIZE are kept.
+    template<typename Token>
+    void
+    Bitext<Token>::
+    agenda::
+    job::
+    fill_occurrences()
+    {
+      occ = occ_cache->get(occ_pid);
+      if (!occ)
+	{
+	  vector<pair<uint32_t,uint16_t> > all;
+	  for (char const* x = next; x < stop;)
+	    {
+	      ::uint64_t sid, off;
+	      x = root->readSid(x,stop,sid);
+	      x = root->readOffset(x,stop,off);
+	      all.push_back(pair<uint32_t,uint16_t>(sid,off));
+	    }
+	  sort(all.begin(),all.end());
+	  sptr<occurrences> o(new occurrences);
+	  o->raw_cnt = all.size();
+	  size_t bits = 0; 
+	  while ((size_t(1) << bits) < all.size()) ++bits;
+	  o->pos.reserve(min(all.size(), size_t(UG_BITEXT_OCC_SAMPLE_SIZE)));
+	  for (size_t i = 0; (i >> bits) == 0; ++i)
+	    {
+	      size_t r = 0;
+	      for (size_t b = 0; b < bits; ++b)
+		if (i & (size_t(1) << b)) r |= size_t(1) << (bits - b - 1);
+	      if (r >= all.size()) continue;
+	      o->pos.push_back(all[r]);
+	      if (o->pos.size() == UG_BITEXT_OCC_SAMPLE_SIZE) break;
+	    }
+	  occ_cache->set(occ_pid, o);
+	  occ = o;
+	}
+      boost::lock_guard<boost::mutex> sguard(stats->lock);
+      stats->raw_cnt = occ->raw_cnt;
+    }
+
     template<typename Token>
     Bitext<Token>::
     agenda::
@@ -968,10 +1090,14 @@ namespace Moses {
     job::
     job(typename TSA<Token>::tree_iterator const& m, 
 	sptr<TSA<Token> > const& r, size_t maxsmpl, 
-	bool isfwd, SamplingBias const* const sntbias)
+	bool isfwd, SamplingBias const* const sntbias, 
+	occ_cache_t* const oc)
       : rnd(0)
       , rnddenom(rnd.max() + 1.)
       , min_diverse(10)
+      , occ_cache(oc)
+      , occ_pid(m.getPid())
+      , occ_next(0)
       , workers(0)
       , root(r)
       , next(m.lower_bound(-1))
@@ -1015,10 +1141,19 @@ namespace Moses {
       boost::unique_lock<boost::mutex> lk(this->lock);
       static boost::posix_time::time_duration nodelay(0,0,0,0); 
       bool fwd = phrase.root == bt.I1.get();
-      sptr<job> j(new job(phrase, fwd ? bt.I1 : bt.I2, max_samples, fwd, bias));
+      occ_cache_t* oc = NULL;
+      if (bias == NULL && max_samples && 
+	  phrase.approxOccurrenceCount() > UG_BITEXT_OCC_CACHE_THRESHOLD)
+	oc = fwd ? &bt.m_occ_cache1 : &bt.m_occ_cache2;
+      sptr<job> j(new job(phrase, fwd ? bt.I1 : bt.I2, max_samples, fwd, bias, oc));
       j->stats->register_worker();
       
-      joblist.push_back(j);
+      // jobs that will look at every occurrence are short; serve them 
+      // first so small lookups don't wait behind heavy ones
+      if (j->stats->raw_cnt <= max_samples)
+	joblist.push_front(j);
+      else 
+	joblist.push_back(j);
       if (joblist.size() == 1)
 	{
 	  size_t i = 0;
@@ -1500,12 +1635,8 @@ namespace Moses {
 	  SamplingBias const* const bias) const
     {
       boost::lock_guard<boost::mutex> guard(this->lock);
-      if (!ag) 
-	{
-	  ag.reset(new agenda(*this));
-	  if (this->num_workers > 1)
-	    ag->add_workers(this->num_workers);
-	}
+      agenda& ag = next_agenda();
+      if (m_pstats_file) save_pstats();
       sptr<pstats> ret;
 #if 1
       // use pcache only for plain sentence input
@@ -1529,8 +1660,11 @@ namespace Moses {
 	      // cerr << "NEW FREQUENT PHRASE: "
 	      // << phrase.str(V1.get()) << " " << phrase.approxOccurrenceCount()  
 	      // << " at " << __FILE__ << ":" << __LINE__ << endl;
-	      foo.first->second = ag->add_job(phrase, max_sample,NULL);
+	      foo.first->second = ag.add_job(phrase, max_sample,NULL);
 	      assert(foo.first->second);
+	      if (m_pstats_file)
+		(&cache == &cache1 ? m_pstats_unsaved1 : m_pstats_unsaved2)
+		  .push_back(make_pair(pid, foo.first->second));
 	    }
 	  assert(foo.first->second);
 	  ret = foo.first->second;
@@ -1538,7 +1672,7 @@ namespace Moses {
 	}
       else 
 #endif
-	ret = ag->add_job(phrase, max_sample,bias);
+	ret = ag.add_job(phrase, max_sample,bias);
       assert(ret);
       return ret;
     }
@@ -1668,15 +1802,7 @@ namespace Moses {
     {
       sptr<pstats> ret = prep2(phrase, this->default_sample_size, bias);
       assert(ret);
-      boost::lock_guard<boost::mutex> guard(this->lock);
-      if (this->num_workers <= 1)
-	typename agenda::worker(*this->ag)();
-      else 
-	{
-	  boost::unique_lock<boost::mutex> lock(ret->lock);
-	  while (ret->in_progress)
-	    ret->ready.wait(lock);
-	}
+      wait_for(ret);
       return ret;
     }
 
@@ -1687,16 +1813,173 @@ namespace Moses {
 	   SamplingBias const* const bias) const
     {
       sptr<pstats> ret = prep2(phrase, max_sample);
+      wait_for(ret);
+      return ret;
+    }
+
+    template<typename Token>
+    Bitext<Token>::
+    ~Bitext()
+    {
       boost::lock_guard<boost::mutex> guard(this->lock);
+      if (m_pstats_file) save_pstats();
+      IFVERBOSE(1)
+	{
+	  size_t hits1, misses1, evicted1, hits2, misses2, evicted2;
+	  m_pplist_cache1.stats(hits1, misses1, evicted1);
+	  m_pplist_cache2.stats(hits2, misses2, evicted2);
+	  if (hits1 + misses1 + hits2 + misses2)
+	    cerr << "Phrase pair list cache: " << hits1 + hits2 << " hits, "
+		 << misses1 + misses2 << " misses, " << evicted1 + evicted2 
+		 << " evictions" << endl;
+	}
+    }
+
+    template<typename Token>
+    string
+    Bitext<Token>::
+    pstats_cache_header() const
+    {
+      // identifies the bitext and sampling setup the statistics are from
+      ostringstream buf;
+      buf << "mmsapt-pstats-1 " << default_sample_size
+	  << " " << T1->size() << " " << T1->numTokens()
+	  << " " << T2->size() << " " << T2->numTokens();
+      return buf.str();
+    }
+
+    template<typename Token>
+    void
+    Bitext<Token>::
+    open_pstats_cache(string const& fname, bool const read_only)
+    {
+      boost::lock_guard<boost::mutex> guard(this->lock);
+      string const header = pstats_cache_header();
+      ::uint64_t good_size = 0; // end of the last complete record
+      size_t loaded = 0;
+      {
+	ifstream in(fname.c_str(), ios::binary);
+	string h; 
+	if (in) binread(in, h);
+	if (in && h == header) 
+	  {
+	    good_size = in.tellg();
+	    string rec; 
+	    // every record is one length-prefixed string, so a record cut 
+	    // short by a crash is detected and dropped
+	    for (binread(in, rec); in; binread(in, rec))
+	      {
+		istringstream r(rec);
+		uchar side; ::uint64_t pid;
+		binread(r, side);
+		binread(r, pid);
+		sptr<pstats> ps(new pstats());
+		ps->read(r);
+		if (!r) break;
+		(side ? cache2 : cache1)[pid] = ps;
+		good_size = in.tellg();
+		++loaded;
+	      }
+	  }
+	else if (in)
+	  cerr << "Ignoring pstats cache " << fname << ": it was built for "
+	       << "a different bitext or sample size" << endl;
+      }
+      VERBOSE(1, "Loaded " << loaded << " cached phrase statistics from " 
+	      << fname << endl);
+      if (read_only) return;
+      if (good_size)
+	{
+	  UTIL_THROW_IF2(truncate(fname.c_str(), good_size) != 0,
+			 "Cannot truncate pstats cache " << fname);
+	  m_pstats_file.reset(new ofstream(fname.c_str(), ios::binary|ios::app));
+	}
+      else 
+	{
+	  m_pstats_file.reset(new ofstream(fname.c_str(), ios::binary|ios::trunc));
+	  binwrite(*m_pstats_file, header);
+	}
+      UTIL_THROW_IF2(!*m_pstats_file, "Cannot write pstats cache " << fname);
+    }
+
+    template<typename Token>
+    void
+    Bitext<Token>::
+    save_pstats() const
+    {
+      size_t saved = 0;
+      for (int side = 0; side < 2; ++side)
+	{
+	  unsaved_t& todo = side ? m_pstats_unsaved2 : m_pstats_unsaved1;
+	  for (size_t i = 0; i < todo.size(); )
+	    {
+	      pstats& ps = *todo[i].second;
+	      {
+		boost::lock_guard<boost::mutex> psguard(ps.lock);
+		if (ps.in_progress) { ++i; continue; }
+	      }
+	      ostringstream rec;
+	      binwrite(rec, uchar(side));
+	      binwrite(rec, todo[i].first);
+	      ps.write(rec);
+	      binwrite(*m_pstats_file, rec.str());
+	      todo[i].swap(todo.back());
+	      todo.pop_back();
+	      ++saved;
+	    }
+	}
+      if (saved) m_pstats_file->flush();
+    }
+
+    template<typename Token>
+    typename Bitext<Token>::agenda&
+    Bitext<Token>::
+    next_agenda() const
+    {
+      if (m_agendas.empty())
+	{
+	  // one agenda per UG_BITEXT_WORKERS_PER_AGENDA workers; a 
+	  // single-threaded bitext has one agenda and no workers
+	  size_t n = this->num_workers;
+	  size_t num_agendas = n > 1 ? (n + UG_BITEXT_WORKERS_PER_AGENDA - 1)
+	    / UG_BITEXT_WORKERS_PER_AGENDA : 1;
+	  for (size_t i = 0; i < num_agendas; ++i)
+	    {
+	      m_agendas.push_back(sptr<agenda>(new agenda(*this)));
+	      // spread the workers as evenly as possible
+	      size_t share = n / num_agendas + (i < n % num_agendas ? 1 : 0);
+	      if (n > 1) m_agendas.back()->add_workers(share);
+	    }
+	}
+      // round robin; the agendas balance out within a few jobs 
+      agenda& ret = *m_agendas[m_next_agenda];
+      m_next_agenda = (m_next_agenda + 1) % m_agendas.size();
+      return ret;
+    }
+
+    template<typename Token>
+    void
+    Bitext<Token>::
+    wait_for(sptr<pstats> const& ret) const
+    {
+      // The bitext lock is not held here: waiting under it would make
+      // every other decoder thread's lookup queue behind this one.
       if (this->num_workers <= 1)
-	typename agenda::worker(*this->ag)();
+	{
+	  agenda* ag;
+	  { 
+	    boost::lock_guard<boost::mutex> guard(this->lock);
+	    ag = m_agendas[0].get();
+	  }
+	  typename agenda::worker w(*ag);
+	  w();
+	}
       else 
 	{
 	  boost::unique_lock<boost::mutex> lock(ret->lock);
 	  while (ret->in_progress)
 	    ret->ready.wait(lock);
 	}
-      return ret;
     }
 
     template<typename Token>
@@ -1725,6 +2008,11 @@ namespace Moses {
     job::
     done() const
     { 
+      if (occ_cache)
+	{
+	  boost::lock_guard<boost::mutex> jguard(lock);
+	  if (occ && occ_next == occ->pos.size()) return true;
+	}
       return (max_samples && stats->good >= max_samples) || next == stop; 
     }
 
@@ -3,15 +3,14 @@
 #ifndef _ug_im_tsa_h
 #define _ug_im_tsa_h
 
-// TO DO:
-// - multi-threaded sorting during TSA construction (currently painfully slow!)
-
 #include <iostream>
+#include <algorithm>
 
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/dynamic_bitset.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 
 #include "tpt_tightindex.h"
 #include "tpt_tokenindex.h"
@@ -54,7 +53,8 @@ namespace ugdiss
     imTSA();
     imTSA(boost::shared_ptr<Ttrack<TOKEN> const> c, 
 	  bdBitset const* filt, 
-	  ostream* log = NULL);
+	  ostream* log = NULL,
+	  size_t const num_threads = 1);
 
     imTSA(imTSA<TOKEN> const& prior, 
 	  boost::shared_ptr<imTtrack<TOKEN> const> const&   crp,
@@ -93,6 +93,69 @@ namespace ugdiss
 
   };
 
+  // Sorts the sections of the suffix array (one per first token id)
+  // in parallel. Sections are independent, so worker threads simply
+  // take the next unsorted section, largest first, until none are left.
+  template<typename TOKEN>
+  class
+  imTSA_section_sorter
+  {
+    typedef typename Ttrack<TOKEN>::Position cpos;
+    vector<cpos>& sufa;
+    vector<filepos_type> const& index;
+    vector<id_type> order; // section ids, largest first
+    size_t next;
+    boost::mutex lock;
+    typename ttrack::Position::LESS<Ttrack<TOKEN> > sorter;
+
+    bool
+    bigger(id_type const a, id_type const b) const
+    { return index[a+1] - index[a] > index[b+1] - index[b]; }
+
+    struct by_size
+    {
+      imTSA_section_sorter const& s;
+      by_size(imTSA_section_sorter const& sx) : s(sx) {}
+      bool operator()(id_type const a, id_type const b) const
+      { return s.bigger(a,b); }
+    };
+
+  public:
+    imTSA_section_sorter(vector<cpos>& sa, vector<filepos_type> const& idx,
+			 Ttrack<TOKEN> const* c)
+      : sufa(sa), index(idx), next(0), sorter(c)
+    {
+      for (size_t i = 0; i + 1 < index.size(); ++i)
+	if (index[i+1] - index[i] > 1) order.push_back(i);
+      sort(order.begin(), order.end(), by_size(*this));
+    }
+
+    void
+    operator()()
+    {
+      while (true)
+	{
+	  id_type i;
+	  {
+	    boost::lock_guard<boost::mutex> guard(lock);
+	    if (next == order.size()) return;
+	    i = order[next++];
+	  }
+	  sort(sufa.begin()+index[i], sufa.begin()+index[i+1], sorter);
+	}
+    }
+
+    void
+    run(size_t const num_threads)
+    {
+      boost::thread_group workers;
+      for (size_t t = 1; t < num_threads; ++t)
+	workers.create_thread(boost::ref(*this));
+      (*this)();
+      workers.join_all();
+    }
+  };
+
   template<typename TOKEN>
   class
   imTSA<TOKEN>::
@@ -140,7 +203,8 @@ namespace ugdiss
   // specified in filter
   template<typename TOKEN>
   imTSA<TOKEN>::
-  imTSA(boost::shared_ptr<Ttrack<TOKEN> const> c, bdBitset const* filter, ostream* log)
+  imTSA(boost::shared_ptr<Ttrack<TOKEN> const> c, bdBitset const* filter, ostream* log,
+	size_t const num_threads)
   {
     assert(c);
     this->corpus = c;
@@ -203,14 +267,20 @@ namespace ugdiss
     typename ttrack::Position::LESS<Ttrack<TOKEN> > sorter(c.get());
     for (size_t i = 0; i < wcnt.size(); i++)
       {
+        index[i+1] = index[i]+wcnt[i];
+        assert(index[i+1]==tmp[i]); // sanity check
+        if (num_threads > 1) continue;
         if (log && wcnt[i] > 5000)
           *log << "sorting " << wcnt[i] 
                << " entries starting with id " << i << "." << endl;
-        index[i+1] = index[i]+wcnt[i];
-        assert(index[i+1]==tmp[i]); // sanity check
         if (wcnt[i]>1)
           sort(sufa.begin()+index[i],sufa.begin()+index[i+1],sorter);
       }
+    if (num_threads > 1)
+      {
+        if (log) *log << "sorting on " << num_threads << " threads" << endl;
+        imTSA_section_sorter<TOKEN>(sufa, index, c.get()).run(num_threads);
+      }
     this->startArray = reinterpret_cast<char const*>(&(*sufa.begin()));
     this->endArray   = reinterpret_cast<char const*>(&(*sufa.end()));
     this->numTokens  = sufa.size();
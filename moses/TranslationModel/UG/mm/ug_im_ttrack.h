@@ -193,7 +193,9 @@ namespace ugdiss
   boost::shared_ptr<imTtrack<TOKEN> > 
   append(boost::shared_ptr<imTtrack<TOKEN> > const& crp, vector<TOKEN> const & snt)
   {
-#if 1
+    // The token count check walks the entire corpus, which made every 
+    // update linear in the size of the dynamic corpus; debugging only.
+#if 0
     if (crp) crp->m_check_token_count();
 #endif
     boost::shared_ptr<imTtrack<TOKEN> > ret;
@@ -204,15 +206,19 @@ namespace ugdiss
       }
     else if (crp->myData->capacity() == crp->size())
       {
+	// Readers of the old track may still be using it, so copy into a
+	// new one; grow geometrically to keep the copying amortized O(1).
   	ret.reset(new imTtrack<TOKEN>());
-	ret->myData->reserve(crp->size() + IMTTRACK_INCREMENT_SIZE);
-	copy(crp->myData->begin(),crp->myData->end(),ret->myData->begin());
+	ret->myData->reserve(max(2 * crp->size(), 
+				 crp->size() + IMTTRACK_INCREMENT_SIZE));
+	ret->myData->assign(crp->myData->begin(),crp->myData->end());
+	ret->numToks = crp->numToks;
       }
     else ret = crp;
     ret->myData->push_back(snt);
     ret->numToks += snt.size();
 
-#if 1
+#if 0
     ret->m_check_token_count();
 #endif
     return ret;
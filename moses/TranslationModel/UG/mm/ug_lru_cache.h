@@ -5,23 +5,35 @@
 #include <algorithm>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
 #include <sys/time.h>
+#include <stdint.h>
 
 
 #ifndef sptr
 #define sptr boost::shared_ptr
 #endif
 
+// Number of independently locked segments of an LRU_Cache. Every hit
+// updates the recency queue, i.e., needs exclusive access, so a single
+// lock makes all decoder threads queue up behind each other.
+#ifndef LRU_CACHE_SEGMENTS
+#define LRU_CACHE_SEGMENTS 16
+#endif
+
 namespace lru_cache
 {
   using namespace std;
   using namespace boost;
 
+  // Keys are spread over LRU_CACHE_SEGMENTS segments, each with its own
+  // lock, recency queue and share of the capacity, so eviction is LRU
+  // within the key's segment (an approximation of global LRU).
   template<typename KEY, typename VAL>
   class LRU_Cache
   {
   public:
-    typedef unordered_map<KEY,uint32_t> map_t;
+    typedef boost::unordered_map<KEY,uint32_t> map_t;
   private:
     struct Record
     {
@@ -30,77 +42,152 @@ namespace lru_cache
       // timeval      tstamp; // time stamp
       typename boost::shared_ptr<VAL> ptr; // cached shared ptr
     };
-    
-    mutable boost::shared_mutex m_lock;
-    uint32_t m_qfront, m_qback;
-    vector<Record> m_recs; 
-    map_t m_idx;
-
-    void 
-    update_queue(KEY const& key, uint32_t const p)
+
+    class Segment
+    {
+      uint32_t m_qfront, m_qback;
+      vector<Record> m_recs;
+      map_t m_idx;
+
+      void
+      update_queue(KEY const& key, uint32_t const p)
+      {
+	// CALLER MUST LOCK!
+	// "remove" item in slot p from it's current position of the
+	// queue (which is different from the slot position) and move it
+	// to the end
+	Record& r = m_recs[p];
+	if (m_recs.size() == 1)
+	  r.next = r.prev = m_qback = m_qfront = 0;
+
+	if (r.key != key || p == m_qback) return;
+
+	if (m_qfront == p)
+	  m_qfront = m_recs[r.next].prev = r.next;
+	else
+	  {
+	    m_recs[r.prev].next = r.next;
+	    m_recs[r.next].prev = r.prev;
+	  }
+	r.prev = m_qback;
+	m_recs[r.prev].next = m_qback = r.next = p;
+      }
+
+    public:
+      boost::mutex lock;
+      size_t hits, misses, evictions;
+
+      Segment() : m_qfront(0), m_qback(0), hits(0), misses(0), evictions(0) {}
+      size_t capacity() const { return m_recs.capacity(); }
+      void reserve(size_t s) { m_recs.reserve(s); }
+
+      // CALLER MUST LOCK (get and set)!
+      sptr<VAL>
+      get(KEY const& key)
+      {
+	typename map_t::const_iterator i = m_idx.find(key);
+	if (i == m_idx.end()) { ++misses; return sptr<VAL>(); }
+	++hits;
+	update_queue(key,i->second);
+	return m_recs[i->second].ptr;
+      }
+
+      void
+      set(KEY const& key, sptr<VAL> const& ptr)
+      {
+	pair<typename map_t::iterator,bool> foo;
+	foo = m_idx.insert(make_pair(key,m_recs.size()));
+
+	uint32_t p = foo.first->second;
+	if (foo.second) // was not in the cache
+	  {
+	    if (m_recs.size() < m_recs.capacity())
+	      m_recs.push_back(Record());
+	    else
+	      {
+		foo.first->second = p = m_qfront;
+		m_idx.erase(m_recs[p].key);
+		++evictions;
+	      }
+	    m_recs[p].key = key;
+	  }
+	update_queue(key,p);
+	m_recs[p].ptr = ptr;
+      }
+    };
+
+    vector<sptr<Segment> > m_segments;
+
+    Segment&
+    segment(KEY const& key) const
     {
-      // CALLER MUST LOCK!
-      // "remove" item in slot p from it's current position of the 
-      // queue (which is different from the slot position) and move it 
-      // to the end
-      Record& r = m_recs[p];
-      if (m_recs.size() == 1)
-	r.next = r.prev = m_qback = m_qfront = 0;
-    
-      if (r.key != key || p == m_qback) return;
-  
-      if (m_qfront == p)
-	m_qfront = m_recs[r.next].prev = r.next;
-      else
+      // mix the hash: phrase ids keep the phrase length in the low bits
+      ::uint64_t h = boost::hash<KEY>()(key) * 0x9E3779B97F4A7C15ULL;
+      return *m_segments[(h >> 32) % m_segments.size()];
+    }
+
+    static size_t
+    share(size_t const s, size_t const n) { return max(size_t(1), (s + n - 1) / n); }
+
+  public:
+    LRU_Cache(size_t capacity=1, size_t const segments=LRU_CACHE_SEGMENTS)
+    {
+      m_segments.resize(max(size_t(1), segments));
+      for (size_t i = 0; i < m_segments.size(); ++i)
+	m_segments[i].reset(new Segment());
+      reserve(capacity);
+    }
+
+    size_t
+    capacity() const
+    {
+      size_t ret = 0;
+      for (size_t i = 0; i < m_segments.size(); ++i)
 	{
-	  m_recs[r.prev].next = r.next;
-	  m_recs[r.next].prev = r.prev;
+	  boost::lock_guard<boost::mutex> guard(m_segments[i]->lock);
+	  ret += m_segments[i]->capacity();
 	}
-      r.prev = m_qback;
-      m_recs[r.prev].next = m_qback = r.next = p;
+      return ret;
     }
 
-  public:
-    LRU_Cache(size_t capacity=1) : m_qfront(0), m_qback(0) { reserve(capacity); }
-    size_t capacity() const { return m_recs.capacity(); }
-    void reserve(size_t s) { m_recs.reserve(s); }
+    void
+    reserve(size_t s)
+    {
+      for (size_t i = 0; i < m_segments.size(); ++i)
+	{
+	  boost::lock_guard<boost::mutex> guard(m_segments[i]->lock);
+	  m_segments[i]->reserve(share(s, m_segments.size()));
+	}
+    }
 
-    sptr<VAL> 
-    get(KEY const& key) 
+    sptr<VAL>
+    get(KEY const& key)
     {
-      uint32_t p;
-      { // brackets needed for lock scoping
-	boost::shared_lock<boost::shared_mutex> rlock(m_lock);
-	typename map_t::const_iterator i = m_idx.find(key);
-	if (i == m_idx.end()) return sptr<VAL>();
-	p = i->second;
-      }
-      boost::lock_guard<boost::shared_mutex> guard(m_lock);
-      update_queue(key,p);
-      return m_recs[p].ptr;
+      Segment& s = segment(key);
+      boost::lock_guard<boost::mutex> guard(s.lock);
+      return s.get(key);
     }
 
     void
     set(KEY const& key, sptr<VAL> const& ptr)
     {
-      boost::lock_guard<boost::shared_mutex> lock(m_lock);
-      pair<typename map_t::iterator,bool> foo;
-      foo = m_idx.insert(make_pair(key,m_recs.size()));
-      
-      uint32_t p = foo.first->second;
-      if (foo.second) // was not in the cache
+      Segment& s = segment(key);
+      boost::lock_guard<boost::mutex> guard(s.lock);
+      s.set(key,ptr);
+    }
+
+    // usage counters, summed over all segments
+    void
+    stats(size_t& hits, size_t& misses, size_t& evictions) const
+    {
+      hits = misses = evictions = 0;
+      for (size_t i = 0; i < m_segments.size(); ++i)
 	{
-	  if (m_recs.size() < m_recs.capacity())
-	    m_recs.push_back(Record());
-	  else 
-	    {
-	      foo.first->second = p = m_qfront;
-	      m_idx.erase(m_recs[p].key);
-	    }
-	  m_recs[p].key = key;
+	  boost::lock_guard<boost::mutex> guard(m_segments[i]->lock);
+	  hits      += m_segments[i]->hits;
+	  misses    += m_segments[i]->misses;
+	  evictions += m_segments[i]->evictions;
 	}
-      update_queue(key,p);
-      m_recs[p].ptr = ptr;
     }
   };
 }
@@ -4,6 +4,7 @@
 #include <boost/tokenizer.hpp>
 #include <algorithm>
 #include "moses/TranslationModel/UG/mm/ug_phrasepair.h"
+#include "moses/ContextScope.h"
 #include "util/exception.hh"
 #include <set>
 
@@ -192,6 +193,11 @@ namespace Moses
     if ((m = param.find("extra")) != param.end()) 
       extra_data = m->second;
 
+    if ((m = param.find("pstats-cache")) != param.end()) 
+      m_pstats_cache_file = m->second;
+    dflt = pair<string,string>("pstats-cache-readonly","false");
+    m_pstats_cache_readonly = Scan<bool>(param.insert(dflt).first->second);
+
     dflt = pair<string,string>("tuneable","true");
     m_tuneable = Scan<bool>(param.insert(dflt).first->second.c_str());
 
@@ -224,6 +230,8 @@ namespace Moses
     known_parameters.push_back("pbwd");
     known_parameters.push_back("pfwd");
     known_parameters.push_back("prov");
+    known_parameters.push_back("pstats-cache");
+    known_parameters.push_back("pstats-cache-readonly");
     known_parameters.push_back("rare");
     known_parameters.push_back("sample");
     known_parameters.push_back("smooth");
@@ -404,6 +412,8 @@ namespace Moses
     btfix.num_workers = this->m_workers;
     btfix.open(bname, L1, L2);
     btfix.setDefaultSampleSize(m_default_sample_size);
+    if (m_pstats_cache_file.size())
+      btfix.open_pstats_cache(m_pstats_cache_file, m_pstats_cache_readonly);
     // shards.push_back(btfix);
     
     btdyn.reset(new imbitext(btfix.V1, btfix.V2, m_default_sample_size));
@@ -435,8 +445,18 @@ namespace Moses
     vector<string> S1(1,s1);
     vector<string> S2(1,s2);
     vector<string> ALN(1,a);
+    // Updates are serialized by m_update_lock; the new dynamic bitext is
+    // built without holding this->lock, so lookups in other threads keep
+    // using the current one instead of waiting for the index merge.
+    boost::lock_guard<boost::mutex> update_guard(m_update_lock);
+    sptr<imBitext<Token> > dyn;
+    { // braces are needed for scoping mutex lock guard!
+      boost::lock_guard<boost::mutex> guard(this->lock);
+      dyn = btdyn;
+    }
+    dyn = dyn->add(S1,S2,ALN);
     boost::lock_guard<boost::mutex> guard(this->lock);
-    btdyn = btdyn->add(S1,S2,ALN);
+    btdyn = dyn;
   }
 
 
@@ -562,6 +582,10 @@ namespace Moses
     ::uint64_t phrasekey = (mfix.size() == sphrase.size() ? (mfix.getPid()<<1) 
 			  : (mdyn.getPid()<<1)+1);
     size_t revision = dyn->revision();
+    // samples biased towards the documents of a scope are particular to
+    // the scope, so they bypass the cache that all inputs share
+    sptr<DocumentBias> bias = GetContextBias();
+    if (!bias)
     {
       boost::lock_guard<boost::mutex> guard(this->lock);
       tpc_cache_t::iterator c = m_cache.find(phrasekey);
@@ -584,7 +608,7 @@ namespace Moses
     // for btfix.
     sptr<pstats> sfix,sdyn;
     if (mfix.size() == sphrase.size()) 
-      sfix = btfix.lookup(mfix);
+      sfix = btfix.lookup(mfix, bias.get());
     if (mdyn.size() == sphrase.size()) sdyn = dyn->lookup(mdyn);
 
     vector<PhrasePair<Token> > ppfix,ppdyn;
@@ -640,10 +664,29 @@ namespace Moses
 
     // put the result in the cache and return
     boost::lock_guard<boost::mutex> guard(this->lock);
-    m_cache[phrasekey] = ret;
+    if (!bias) m_cache[phrasekey] = ret;
     return encache(ret);
   }
 
+  sptr<DocumentBias>
+  Mmsapt::
+  GetContextBias() const
+  {
+    sptr<ContextScope> scope = ContextScope::Current();
+    if (!scope || !btfix.m_sid2docid) return sptr<DocumentBias>();
+    sptr<map<string,float> const> weights = scope->GetContextWeights();
+    if (!weights || weights->empty()) return sptr<DocumentBias>();
+
+    sptr<ContextBias> cb = scope->Get<ContextBias>(this, true);
+    boost::lock_guard<boost::mutex> guard(cb->lock);
+    if (cb->weights != weights) 
+      { // new weights for the scope
+	cb->bias = btfix.setupDocumentBias(*weights);
+	cb->weights = weights;
+      }
+    return cb->bias;
+  }
+
   size_t 
   Mmsapt::
   SetTableLimit(size_t limit)
@@ -64,6 +64,8 @@ namespace Moses
     mmbitext btfix; 
     sptr<imbitext> btdyn; 
     string bname,extra_data,bias_file;
+    string m_pstats_cache_file; // persistent cache of sampling results
+    bool m_pstats_cache_readonly;
     string L1;
     string L2;
     float  m_lbop_conf; // confidence level for lbop smoothing
@@ -126,6 +128,7 @@ namespace Moses
     // PScoreLogCounts<Token>   add_logcounts_dyn;
     void init(string const& line);
     mutable boost::mutex lock;
+    boost::mutex m_update_lock; // serializes updates of the dynamic bitext
     bool withPbwd;
     bool poolCounts;
     vector<FactorType> ofactor;
@@ -162,6 +165,20 @@ namespace Moses
 
     typedef map<typename ::uint64_t, TargetPhraseCollectionWrapper*> tpc_cache_t;
     mutable tpc_cache_t m_cache;
+
+    // the document bias of the context weights of a ContextScope; the
+    // scope keeps one per Mmsapt
+    struct ContextBias
+    {
+      boost::mutex lock;
+      sptr<map<string,float> const> weights;
+      sptr<DocumentBias> bias;
+    };
+
+    // bias of the scope of the input decoded on this thread, NULL if the
+    // scope has no context weights or the bitext no document map
+    sptr<DocumentBias>
+    GetContextBias() const;
     mutable vector<TargetPhraseCollectionWrapper*> m_history;
     // phrase table feature weights for alignment:
     vector<float> feature_weights; 
@@ -229,6 +246,10 @@ namespace Moses
 
     void
     Load(bool with_checks);
+
+    // phrase scores follow the context and the dynamic updates
+    bool
+    DependsOnSourceContext() const { return true; }
     
     // returns the prior table limit
     size_t SetTableLimit(size_t limit);
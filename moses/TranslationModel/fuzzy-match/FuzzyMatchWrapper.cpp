@@ -15,12 +15,18 @@
 #include "moses/StaticData.h"
 #include "util/file.hh"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
 namespace tmmt
 {
 
-FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath)
+FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath,
+                                     const std::string &imagePath, size_t threads)
   :basic_flag(false)
   ,lsed_flag(true)
   ,refined_flag(true)
@@ -30,9 +36,10 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   ,multiple_flag(true)
   ,multiple_slack(0)
   ,multiple_max(100)
+  ,m_threads(threads ? threads : 1)
 {
   cerr << "creating suffix array" << endl;
-  suffixArray = new tmmt::SuffixArray( sourcePath );
+  suffixArray = new tmmt::SuffixArray( sourcePath, imagePath );
 
   //cerr << "loading source data" << endl;
   //load_corpus(sourcePath, source);
@@ -49,13 +56,13 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   cerr << "loading completed" << endl;
 }
 
-string FuzzyMatchWrapper::Extract(long translationId, const string &dirNameStr)
+string FuzzyMatchWrapper::Extract(long translationId, const string &input, const string &dirNameStr)
 {
   const Moses::StaticData &staticData = Moses::StaticData::Instance();
 
   WordIndex wordIndex;
 
-  string fuzzyMatchFile = ExtractTM(wordIndex, translationId, dirNameStr);
+  string fuzzyMatchFile = ExtractTM(wordIndex, translationId, input, dirNameStr);
 
   // create extrac files
   create_xml(fuzzyMatchFile);
@@ -86,18 +93,15 @@ string FuzzyMatchWrapper::Extract(long translationId, const string &dirNameStr)
   return fuzzyMatchFile + ".pt.gz";
 }
 
-string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const string &dirNameStr)
+string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const string &sentence, const string &dirNameStr)
 {
   const std::vector< std::vector< WORD_ID > > &source = suffixArray->GetCorpus();
 
-  string inputPath = dirNameStr + "/in";
   string fuzzyMatchFile = dirNameStr + "/fuzzyMatchFile";
   ofstream fuzzyMatchStream(fuzzyMatchFile.c_str());
 
   vector< vector< WORD_ID > > input;
-  load_corpus(inputPath, input);
-
-  assert(input.size() == 1);
+  input.push_back( GetVocabulary().Tokenize( sentence.c_str() ) );
   size_t sentenceInd = 0;
 
   clock_t start_clock = clock();
@@ -117,12 +121,12 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
   for(size_t start=0; start<input[sentenceInd].size(); start++) {
     SuffixArray::INDEX prior_first_match = 0;
     SuffixArray::INDEX prior_last_match = suffixArray->GetSize()-1;
-    vector< string > substring;
+    vector< WORD_ID > substring;
     bool stillMatched = true;
     vector< pair< SuffixArray::INDEX, SuffixArray::INDEX > > matchedAtThisStart;
     //cerr << "start: " << start;
     for(int word=start; stillMatched && word<input[sentenceInd].size(); word++) {
-      substring.push_back( GetVocabulary().GetWord( input[sentenceInd][word] ) );
+      substring.push_back( input[sentenceInd][word] );
 
       // only look up, if needed (i.e. no unnecessary short gram lookups)
       //				if (! word-start+1 <= short_match_max_length( input_length ) )
@@ -323,13 +327,14 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
 
   // do not try to find the best ... report multiple matches
   if (multiple_flag) {
+    vector< unsigned int > costs;
+    vector< string > paths;
+    sed_all( input[sentenceInd], best_tm, true, costs, paths );
     for(int si=0; si<best_tm.size(); si++) {
       int s = best_tm[si];
-      string path;
-      sed( input[sentenceInd], source[s], path, true );
       const vector<WORD_ID> &sourceSentence = source[s];
       vector<SentenceAlignment> &targets = targetAndAlignment[s];
-      create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, path, fuzzyMatchStream);
+      create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, paths[si], fuzzyMatchStream);
 
     }
   } // if (multiple_flag)
@@ -341,14 +346,14 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     unsigned int best_letter_cost;
     if (lsed_flag) {
       best_letter_cost = compute_length( input[sentenceInd] ) * min_match / 100 + 1;
+      vector< unsigned int > costs;
+      vector< string > paths;
+      sed_all( input[sentenceInd], best_tm, true, costs, paths );
       for(size_t si=0; si<best_tm.size(); si++) {
-        int s = best_tm[si];
-        string path;
-        unsigned int letter_cost = sed( input[sentenceInd], source[s], path, true );
-        if (letter_cost < best_letter_cost) {
-          best_letter_cost = letter_cost;
-          best_path = path;
-          best_match = s;
+        if (costs[si] < best_letter_cost) {
+          best_letter_cost = costs[si];
+          best_path = paths[si];
+          best_match = best_tm[si];
         }
       }
     }
@@ -686,6 +691,36 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
   return final;
 }
 
+void FuzzyMatchWrapper::sed_all( const vector< WORD_ID > &a, const vector< int > &tms, bool use_letter_sed,
+                                 vector< unsigned int > &costs, vector< string > &paths )
+{
+  costs.assign( tms.size(), 0 );
+  paths.assign( tms.size(), "" );
+  size_t threads = min( m_threads, tms.size() );
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    // the letter edit distances of the word pairs are cached under a lock
+    boost::thread_group group;
+    for (size_t t = 0; t < threads; ++t) {
+      group.create_thread(boost::bind(&FuzzyMatchWrapper::sed_range, this, &a, &tms, use_letter_sed,
+                                      t, threads, &costs, &paths));
+    }
+    group.join_all();
+    return;
+  }
+#endif
+  sed_range( &a, &tms, use_letter_sed, 0, 1, &costs, &paths );
+}
+
+void FuzzyMatchWrapper::sed_range( const vector< WORD_ID > *a, const vector< int > *tms, bool use_letter_sed,
+                                   size_t begin, size_t step, vector< unsigned int > *costs, vector< string > *paths )
+{
+  const std::vector< std::vector< WORD_ID > > &source = suffixArray->GetCorpus();
+  for (size_t i = begin; i < tms->size(); i += step) {
+    (*costs)[i] = sed( *a, source[ (*tms)[i] ], (*paths)[i], use_letter_sed );
+  }
+}
+
 /* utlility function: compute length of sentence in characters
  (spaces do not count) */
 
@@ -28,9 +28,13 @@ struct SentenceAlignment;
 class FuzzyMatchWrapper
 {
 public:
-  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment);
+  //! imagePath, if given, keeps a binary suffix array of the source;
+  //! threads compute the edit distances of the best matches
+  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment,
+                    const std::string &imagePath = "", size_t threads = 1);
 
-  std::string Extract(long translationId, const std::string &dirNameStr);
+  //! writes the rule table of input to dirNameStr, returns its path
+  std::string Extract(long translationId, const std::string &input, const std::string &dirNameStr);
 
 protected:
   // tm-mt
@@ -45,6 +49,7 @@ protected:
   int multiple_flag;
   int multiple_slack;
   int multiple_max;
+  size_t m_threads;
 
   typedef std::map< WORD_ID,std::vector< int > > WordIndex;
 
@@ -68,6 +73,11 @@ protected:
   unsigned int compute_length( const std::vector< tmmt::WORD_ID > &sentence );
   unsigned int letter_sed( WORD_ID aIdx, WORD_ID bIdx );
   unsigned int sed( const std::vector< WORD_ID > &a, const std::vector< WORD_ID > &b, std::string &best_path, bool use_letter_sed );
+  //! sed() of a with each of the tm sentences, on m_threads threads
+  void sed_all( const std::vector< WORD_ID > &a, const std::vector< int > &tms, bool use_letter_sed,
+                std::vector< unsigned int > &costs, std::vector< std::string > &paths );
+  void sed_range( const std::vector< WORD_ID > *a, const std::vector< int > *tms, bool use_letter_sed,
+                  size_t begin, size_t step, std::vector< unsigned int > *costs, std::vector< std::string > *paths );
   void init_short_matches(WordIndex &wordIndex, long translationId, const std::vector< WORD_ID > &input );
   int short_match_max_length( int input_length );
   void add_short_matches(WordIndex &wordIndex, long translationId, std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost );
@@ -76,7 +86,7 @@ protected:
 
   void create_extract(int sentenceInd, int cost, const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string &inputStr, const std::string  &path, std::ofstream &outputFile);
 
-  std::string ExtractTM(WordIndex &wordIndex, long translationId, const std::string &inputPath);
+  std::string ExtractTM(WordIndex &wordIndex, long translationId, const std::string &input, const std::string &dirNameStr);
   Vocabulary &GetVocabulary() {
     return suffixArray->GetVocabulary();
   }
@@ -1,18 +1,52 @@
 #include "SuffixArray.h"
 #include <string>
 #include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <cstring>
 
+#include "util/exception.hh"
+#include "util/file.hh"
+
 using namespace std;
 
 namespace tmmt
 {
 
-SuffixArray::SuffixArray( string fileName )
+namespace
+{
+// layout of an image: this header, m_sentence, m_array, m_index,
+// m_wordInSentence, m_sentenceLength, then the words of the vocabulary,
+// each followed by a NUL
+struct ImageHeader {
+  char magic[8];
+  uint64_t sourceSize; //!< of the text it was built from
+  uint64_t size;
+  uint64_t sentenceCount;
+  uint64_t vocabBytes;
+};
+const char kImageMagic[8] = {'t', 'm', 'm', 't', 's', 'a', sizeof(size_t), '1'};
+}
+
+SuffixArray::SuffixArray( string fileName, const string &imagePath )
+  : m_buffer(NULL)
 {
   m_vcb.StoreIfNew( "<uNk>" );
   m_endOfSentence = m_vcb.StoreIfNew( "<s>" );
 
+  uint64_t sourceSize;
+  {
+    util::scoped_fd fd(util::OpenReadOrThrow(fileName.c_str()));
+    sourceSize = util::SizeOrThrow(fd.get());
+  }
+  if (!imagePath.empty() && LoadImage( imagePath, sourceSize )) return;
+
+  Build( fileName );
+  if (!imagePath.empty()) SaveImage( imagePath, sourceSize );
+}
+
+void SuffixArray::Build( const string &fileName )
+{
   ifstream extractFile;
 
   // count the number of words first;
@@ -58,6 +92,7 @@ SuffixArray::SuffixArray( string fileName )
       m_array[ wordIndex++ ] = *i;
     }
     m_index[ wordIndex ] = wordIndex;
+    m_sentence[ wordIndex ] = sentenceId; // lets an image restore the corpus
     m_array[ wordIndex++ ] = m_endOfSentence;
     m_sentenceLength[ sentenceId++ ] = words.size();
   }
@@ -69,9 +104,93 @@ SuffixArray::SuffixArray( string fileName )
   m_buffer = (INDEX*) calloc( sizeof( INDEX ), m_size );
   Sort( 0, m_size-1 );
   free( m_buffer );
+  m_buffer = NULL;
   cerr << "done sorting" << endl;
 }
 
+bool SuffixArray::LoadImage( const string &imagePath, uint64_t sourceSize )
+{
+  if (access(imagePath.c_str(), R_OK)) return false;
+  util::scoped_fd file(util::OpenReadOrThrow(imagePath.c_str()));
+  const int fd = file.get();
+  uint64_t fileSize = util::SizeOrThrow(fd);
+  if (fileSize < sizeof(ImageHeader)) return false;
+  util::MapRead(util::POPULATE_OR_LAZY, fd, 0, fileSize, m_image);
+
+  const ImageHeader &header = *reinterpret_cast<const ImageHeader*>(m_image.get());
+  if (memcmp(header.magic, kImageMagic, sizeof(kImageMagic)) || header.sourceSize != sourceSize) {
+    cerr << imagePath << " is not an index of this translation memory, rebuilding it" << endl;
+    m_image.reset();
+    return false;
+  }
+  const uint64_t size = header.size, count = header.sentenceCount;
+  UTIL_THROW_IF2(fileSize != sizeof(ImageHeader) + size * (sizeof(size_t) + sizeof(WORD_ID) + sizeof(INDEX) + 1)
+                 + count + header.vocabBytes, imagePath << " is truncated");
+
+  // the arrays are only read
+  char *data = reinterpret_cast<char*>(m_image.get()) + sizeof(ImageHeader);
+  m_size = size;
+  m_sentence = reinterpret_cast<size_t*>(data);
+  m_array = reinterpret_cast<WORD_ID*>(m_sentence + size);
+  m_index = reinterpret_cast<INDEX*>(m_array + size);
+  m_wordInSentence = reinterpret_cast<char*>(m_index + size);
+  m_sentenceLength = m_wordInSentence + size;
+
+  // the ids of the image are the order of its vocabulary
+  const char *word = m_sentenceLength + count, *end = word + header.vocabBytes;
+  for (WORD_ID id = 0; word < end; ++id) {
+    const size_t length = strlen(word);
+    UTIL_THROW_IF2(m_vcb.StoreIfNew(string(word, length)) != id, imagePath << " has a corrupt vocabulary");
+    word += length + 1;
+  }
+
+  // every sentence ends with <s>
+  corpus.resize(count);
+  for (INDEX pos = 0, start = 0; pos < m_size; ++pos) {
+    if (pos + 1 == m_size || m_sentence[pos + 1] != m_sentence[pos]) {
+      corpus[m_sentence[pos]].assign(m_array + start, m_array + pos);
+      start = pos + 1;
+    }
+  }
+  cerr << "mapped suffix array " << imagePath << ": " << m_size << " words, " << count << " sentences" << endl;
+  return true;
+}
+
+void SuffixArray::SaveImage( const string &imagePath, uint64_t sourceSize ) const
+{
+  string vocab;
+  for (size_t id = 0; id < m_vcb.vocab.size(); ++id) {
+    vocab += m_vcb.vocab[id];
+    vocab += '\0';
+  }
+
+  ImageHeader header;
+  memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.sourceSize = sourceSize;
+  header.size = m_size;
+  header.sentenceCount = corpus.size();
+  header.vocabBytes = vocab.size();
+
+  // write next to the image and rename, so that other processes never
+  // map a half-written one
+  char pid[32];
+  snprintf(pid, sizeof(pid), "%d", (int)getpid());
+  string tmpPath = imagePath + ".tmp." + pid;
+  {
+    util::scoped_fd fd(util::CreateOrThrow(tmpPath.c_str()));
+    util::WriteOrThrow(fd.get(), &header, sizeof(header));
+    util::WriteOrThrow(fd.get(), m_sentence, m_size * sizeof(size_t));
+    util::WriteOrThrow(fd.get(), m_array, m_size * sizeof(WORD_ID));
+    util::WriteOrThrow(fd.get(), m_index, m_size * sizeof(INDEX));
+    util::WriteOrThrow(fd.get(), m_wordInSentence, m_size);
+    util::WriteOrThrow(fd.get(), m_sentenceLength, corpus.size());
+    util::WriteOrThrow(fd.get(), vocab.data(), vocab.size());
+  }
+  UTIL_THROW_IF2(rename(tmpPath.c_str(), imagePath.c_str()),
+                 "Cannot rename " << tmpPath << " to " << imagePath);
+  cerr << "wrote suffix array " << imagePath << endl;
+}
+
 // good ol' quick sort
 void SuffixArray::Sort(INDEX start, INDEX end)
 {
@@ -105,8 +224,12 @@ void SuffixArray::Sort(INDEX start, INDEX end)
 
 SuffixArray::~SuffixArray()
 {
+  if (m_image.get()) return; // the arrays are in the image
   free(m_index);
   free(m_array);
+  free(m_wordInSentence);
+  free(m_sentence);
+  free(m_sentenceLength);
 }
 
 int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
@@ -124,36 +247,44 @@ int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
   return CompareWord( m_array[ a+offset ], m_array[ b+offset ] );
 }
 
-inline int SuffixArray::CompareWord( WORD_ID a, WORD_ID b ) const
+vector< WORD_ID > SuffixArray::ToIds( const vector< WORD > &phrase )
 {
-  // cerr << "c(" << m_vcb.GetWord(a) << ":" << m_vcb.GetWord(b) << ")=" << m_vcb.GetWord(a).compare( m_vcb.GetWord(b) ) << endl;
-  return m_vcb.GetWord(a).compare( m_vcb.GetWord(b) );
+  vector< WORD_ID > ids( phrase.size() );
+  for(size_t i=0; i<phrase.size(); i++) {
+    ids[i] = m_vcb.GetWordID( phrase[i] );
+  }
+  return ids;
 }
 
 int SuffixArray::Count( const vector< WORD > &phrase )
 {
   INDEX dummy;
-  return LimitedCount( phrase, m_size, dummy, dummy, 0, m_size-1 );
+  return LimitedCount( ToIds( phrase ), m_size, dummy, dummy, 0, m_size-1 );
 }
 
 bool SuffixArray::MinCount( const vector< WORD > &phrase, INDEX min )
 {
   INDEX dummy;
-  return LimitedCount( phrase, min, dummy, dummy, 0, m_size-1 ) >= min;
+  return LimitedCount( ToIds( phrase ), min, dummy, dummy, 0, m_size-1 ) >= min;
 }
 
 bool SuffixArray::Exists( const vector< WORD > &phrase )
 {
   INDEX dummy;
-  return LimitedCount( phrase, 1, dummy, dummy, 0, m_size-1 ) == 1;
+  return LimitedCount( ToIds( phrase ), 1, dummy, dummy, 0, m_size-1 ) == 1;
 }
 
 int SuffixArray::FindMatches( const vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
+{
+  return LimitedCount( ToIds( phrase ), m_size, firstMatch, lastMatch, search_start, search_end );
+}
+
+int SuffixArray::FindMatches( const vector< WORD_ID > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
 {
   return LimitedCount( phrase, m_size, firstMatch, lastMatch, search_start, search_end );
 }
 
-int SuffixArray::LimitedCount( const vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
+int SuffixArray::LimitedCount( const vector< WORD_ID > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start, INDEX search_end )
 {
   // cerr << "FindFirst\n";
   INDEX start = search_start;
@@ -176,7 +307,7 @@ int SuffixArray::LimitedCount( const vector< WORD > &phrase, INDEX min, INDEX &f
   return matchCount;
 }
 
-SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX start, INDEX end, int direction )
+SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD_ID > &phrase, INDEX start, INDEX end, int direction )
 {
   end += direction;
   while(true) {
@@ -195,7 +326,7 @@ SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX st
   }
 }
 
-SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &start, INDEX &end )
+SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD_ID > &phrase, INDEX &start, INDEX &end )
 {
   while(true) {
     INDEX mid = ( start + end + 1 )/2;
@@ -212,11 +343,11 @@ SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &
   }
 }
 
-int SuffixArray::Match( const vector< WORD > &phrase, INDEX index )
+int SuffixArray::Match( const vector< WORD_ID > &phrase, INDEX index )
 {
   INDEX pos = m_index[ index ];
   for(INDEX i=0; i<phrase.size() && i+pos<m_size; i++) {
-    int match = CompareWord( m_vcb.GetWordID( phrase[i] ), m_array[ pos+i ] );
+    int match = CompareWord( phrase[i], m_array[ pos+i ] );
     // cerr << "{" << index << "+" << i << "," << pos+i << ":" << match << "}" << endl;
     if (match != 0)
       return match;
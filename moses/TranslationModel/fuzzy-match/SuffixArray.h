@@ -1,4 +1,5 @@
 #include "Vocabulary.h"
+#include "util/mmap.hh"
 
 #pragma once
 
@@ -7,6 +8,11 @@
 namespace tmmt
 {
 
+/** Suffix array of the source side of the translation memory. Suffixes
+ *  are ordered by word id, not by spelling, so that searches compare
+ *  integers. With an image path the array is built once, written there
+ *  and memory mapped on later loads.
+ */
 class SuffixArray
 {
 public:
@@ -24,22 +30,31 @@ private:
   WORD_ID m_endOfSentence;
   Vocabulary m_vcb;
   INDEX m_size;
+  util::scoped_memory m_image; //!< holds the arrays if they were mapped
+
+  void Build( const std::string &fileName );
+  bool LoadImage( const std::string &imagePath, uint64_t sourceSize );
+  void SaveImage( const std::string &imagePath, uint64_t sourceSize ) const;
+  std::vector< WORD_ID > ToIds( const std::vector< WORD > &phrase );
 
 public:
-  SuffixArray( std::string fileName );
+  SuffixArray( std::string fileName, const std::string &imagePath = "" );
   ~SuffixArray();
 
   void Sort(INDEX start, INDEX end);
   int CompareIndex( INDEX a, INDEX b ) const;
-  inline int CompareWord( WORD_ID a, WORD_ID b ) const;
+  inline int CompareWord( WORD_ID a, WORD_ID b ) const {
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+  }
   int Count( const std::vector< WORD > &phrase );
   bool MinCount( const std::vector< WORD > &phrase, INDEX min );
   bool Exists( const std::vector< WORD > &phrase );
   int FindMatches( const std::vector< WORD > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = 0, INDEX search_end = -1 );
-  int LimitedCount( const std::vector< WORD > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = -1, INDEX search_end = 0 );
-  INDEX FindFirst( const std::vector< WORD > &phrase, INDEX &start, INDEX &end );
-  INDEX FindLast( const std::vector< WORD > &phrase, INDEX start, INDEX end, int direction );
-  int Match( const std::vector< WORD > &phrase, INDEX index );
+  int FindMatches( const std::vector< WORD_ID > &phrase, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = 0, INDEX search_end = -1 );
+  int LimitedCount( const std::vector< WORD_ID > &phrase, INDEX min, INDEX &firstMatch, INDEX &lastMatch, INDEX search_start = -1, INDEX search_end = 0 );
+  INDEX FindFirst( const std::vector< WORD_ID > &phrase, INDEX &start, INDEX &end );
+  INDEX FindLast( const std::vector< WORD_ID > &phrase, INDEX start, INDEX end, int direction );
+  int Match( const std::vector< WORD_ID > &phrase, INDEX index );
   void List( INDEX start, INDEX end );
   inline INDEX GetPosition( INDEX index ) {
     return m_index[ index ];
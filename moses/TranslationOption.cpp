@@ -48,6 +48,16 @@ TranslationOption::TranslationOption(const WordsRange &wordsRange
 {
 }
 
+TranslationOption::TranslationOption(const TranslationOption &copy
+                                     , const WordsRange &wordsRange
+                                     , const InputPath *inputPath)
+  : m_targetPhrase(copy.m_targetPhrase)
+  , m_inputPath(inputPath)
+  , m_sourceWordsRange(wordsRange)
+  , m_futureScore(copy.m_futureScore)
+{
+}
+
 bool TranslationOption::IsCompatible(const Phrase& phrase, const std::vector<FactorType>& featuresToCheck) const
 {
   if (featuresToCheck.size() == 1) {
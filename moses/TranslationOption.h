@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/functional/hash.hpp>
 #include "WordsBitmap.h"
 #include "WordsRange.h"
+#include "SentenceArena.h"
 #include "Phrase.h"
 #include "TargetPhrase.h"
 #include "Hypothesis.h"
@@ -90,10 +91,24 @@ public:
 
   explicit TranslationOption(); // For initial hypo that does translate nothing
 
+  // from the sentence's arena, see SentenceArena
+  static void *operator new(std::size_t size) {
+    return SentenceArena::Allocate(size);
+  }
+  static void operator delete(void *ptr) {
+    SentenceArena::Free(ptr);
+  }
+
   /** constructor. Used by initial translation step */
   TranslationOption(const WordsRange &wordsRange
                     , const TargetPhrase &targetPhrase);
 
+  /** copy of an option for the same source words at another position or
+   *  in another input (see TranslationOptionCache) */
+  TranslationOption(const TranslationOption &copy
+                    , const WordsRange &wordsRange
+                    , const InputPath *inputPath);
+
   /** returns true if all feature types in featuresToCheck are compatible between the two phrases */
   bool IsCompatible(const Phrase& phrase, const std::vector<FactorType>& featuresToCheck) const;
 
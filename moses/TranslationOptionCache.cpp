@@ -0,0 +1,136 @@
+#include "TranslationOptionCache.h"
+#include "DecodeProfile.h"
+#include "Phrase.h"
+#include "TranslationOption.h"
+#include "TranslationOptionList.h"
+#include "Util.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TranslationOptionCache::TranslationOptionCache(size_t maxSpans)
+  : m_maxSpans(maxSpans)
+{
+}
+
+TranslationOptionCache::~TranslationOptionCache()
+{
+  Clear();
+}
+
+std::string TranslationOptionCache::Key(const Phrase &source)
+{
+  // factors are unique per string, so their addresses will do
+  string key;
+  key.reserve(source.GetSize() * MAX_NUM_FACTORS * sizeof(const Factor*));
+  for (size_t pos = 0; pos < source.GetSize(); ++pos) {
+    const Word &word = source.GetWord(pos);
+    for (size_t f = 0; f < MAX_NUM_FACTORS; ++f) {
+      const Factor *factor = word[f];
+      key.append(reinterpret_cast<const char*>(&factor), sizeof(factor));
+    }
+  }
+  return key;
+}
+
+bool TranslationOptionCache::Get(const std::string &key, const FVector &weights,
+                                 const WordsRange &range, const InputPath &inputPath,
+                                 TranslationOptionList &options, bool &unknown)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Index::iterator found = m_index.find(key);
+  if (found != m_index.end() && *found->second->weights != weights) {
+    Erase(found->second);
+    found = m_index.end();
+  }
+  if (found == m_index.end()) {
+    DecodeProfile::Count(DecodeProfile::OptionCacheMisses);
+    return false;
+  }
+  m_spans.splice(m_spans.begin(), m_spans, found->second);
+  const Span &span = *found->second;
+  for (size_t i = 0; i < span.options.size(); ++i) {
+    options.Add(new TranslationOption(*span.options[i], range, &inputPath));
+  }
+  unknown = span.unknown;
+  DecodeProfile::Count(DecodeProfile::OptionCacheHits);
+  return true;
+}
+
+void TranslationOptionCache::Put(const std::string &key, const FVector &weights,
+                                 const TranslationOptionList &options, bool unknown)
+{
+  if (m_maxSpans == 0) return;
+
+  Span span;
+  span.key = key;
+  span.unknown = unknown;
+  span.options.reserve(options.size());
+  // the copies outlive the sentence
+  SentenceArena::Scope noArena(NULL);
+  for (TranslationOptionList::const_iterator i = options.begin(); i != options.end(); ++i) {
+    span.options.push_back(new TranslationOption(**i, (*i)->GetSourceWordsRange(), NULL));
+  }
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Index::iterator found = m_index.find(key);
+  if (found != m_index.end()) {
+    if (*found->second->weights == weights) {
+      // another thread got there first
+      RemoveAllInColl(span.options);
+      return;
+    }
+    Erase(found->second);
+  }
+  m_spans.push_front(Span());
+  m_spans.front().key.swap(span.key);
+  m_spans.front().options.swap(span.options);
+  m_spans.front().unknown = unknown;
+  m_spans.front().weights = Weights(weights);
+  m_index[key] = m_spans.begin();
+  while (m_spans.size() > m_maxSpans) {
+    Erase(--m_spans.end());
+  }
+}
+
+void TranslationOptionCache::Invalidate()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Clear();
+}
+
+void TranslationOptionCache::Erase(Spans::iterator span)
+{
+  RemoveAllInColl(span->options);
+  m_index.erase(span->key);
+  m_spans.erase(span);
+}
+
+//! with m_mutex held
+const boost::shared_ptr<const FVector> &TranslationOptionCache::Weights(const FVector &weights)
+{
+  if (!m_weights || *m_weights != weights) {
+    m_weights.reset(new FVector(weights));
+  }
+  return m_weights;
+}
+
+void TranslationOptionCache::Clear()
+{
+  for (Spans::iterator i = m_spans.begin(); i != m_spans.end(); ++i) {
+    RemoveAllInColl(i->options);
+  }
+  m_spans.clear();
+  m_index.clear();
+  m_weights.reset();
+}
+
+}
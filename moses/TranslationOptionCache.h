@@ -0,0 +1,91 @@
+// -*- c++ -*-
+#pragma once
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "FeatureVector.h"
+
+namespace Moses
+{
+
+class InputPath;
+class Phrase;
+class TranslationOption;
+class TranslationOptionList;
+class WordsRange;
+
+/** Cache of the translation options of source spans, for inputs that
+ *  share phrases with earlier ones (repeated segments, retried requests).
+ *  An entry holds the options of one span as they are before pruning:
+ *  looked up, generated and evaluated in isolation and with the source
+ *  context. Only pruning, sorting and the future score matrix are redone.
+ *
+ *  Keys are the factors of the span, so an entry is used wherever the
+ *  same words occur. That is only right if no feature looks beyond the
+ *  span (FeatureFunction::DependsOnSourceContext()); StaticData doesn't
+ *  create the cache otherwise. The weighted future scores of the options
+ *  are stored too, so each entry records the weights it was made with and
+ *  is only used, or kept, for those weights. Callers pass the weights of
+ *  their sentence to Get() and Put(), which check them under the lock, so
+ *  sentences decoded with different weights at the same time never see
+ *  each other's options.
+ *
+ *  Spans are evicted least recently used first.
+ */
+class TranslationOptionCache
+{
+public:
+  explicit TranslationOptionCache(size_t maxSpans);
+  ~TranslationOptionCache();
+
+  static std::string Key(const Phrase &source);
+
+  /** true if key is cached for weights; then adds copies of its options,
+   *  moved to range and inputPath, to options and sets unknown if they
+   *  were created by the unknown word handler. An entry made with other
+   *  weights is dropped */
+  bool Get(const std::string &key, const FVector &weights,
+           const WordsRange &range, const InputPath &inputPath,
+           TranslationOptionList &options, bool &unknown);
+
+  //! options of key evaluated with weights; replaces an entry for other weights
+  void Put(const std::string &key, const FVector &weights,
+           const TranslationOptionList &options, bool unknown);
+
+  void Invalidate();
+
+private:
+  struct Span {
+    std::string key;
+    std::vector<TranslationOption*> options;
+    bool unknown;
+    boost::shared_ptr<const FVector> weights;
+  };
+  typedef std::list<Span> Spans;
+  typedef boost::unordered_map<std::string, Spans::iterator> Index;
+
+  void Clear();
+  void Erase(Spans::iterator span);
+  const boost::shared_ptr<const FVector> &Weights(const FVector &weights);
+
+  Spans m_spans; //!< most recently used first
+  Index m_index;
+  size_t m_maxSpans;
+  //! weights of the latest entry, shared by the entries made with them
+  boost::shared_ptr<const FVector> m_weights;
+
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
+}
@@ -35,17 +35,125 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeStepGeneration.h"
 #include "DecodeGraph.h"
 #include "InputPath.h"
+#include "DecodeProfile.h"
+#include "TranslationOptionCache.h"
+#include "ContextScope.h"
+#include "ThreadPool.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/FF/UnknownWordPenaltyProducer.h"
 #include "moses/FF/LexicalReordering/LexicalReordering.h"
 #include "moses/FF/InputFeature.h"
+#include "moses/FF/ConstrainedDecoding.h"
 #include "util/exception.hh"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 using namespace std;
 
 namespace Moses
 {
 
+#ifdef WITH_THREADS
+namespace
+{
+//! runs a function for every step-th start position on a pool thread
+class StartPositionTask : public Task
+{
+public:
+  StartPositionTask(const boost::function<void(size_t)> &fn, size_t first, size_t step, size_t end,
+                    const boost::shared_ptr<ContextScope> &scope)
+    : m_fn(fn), m_first(first), m_step(step), m_end(end), m_scope(scope), m_done(false) {}
+
+  void Run() {
+    // feature functions may look up the document of the input
+    ContextScope::SetCurrent(m_scope);
+    try {
+      for (size_t sPos = m_first; sPos < m_end; sPos += m_step) {
+        m_fn(sPos);
+      }
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+    ContextScope::SetCurrent(boost::shared_ptr<ContextScope>());
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  //! returns the error message if fn threw
+  const std::string &Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    return m_error;
+  }
+
+private:
+  const boost::function<void(size_t)> &m_fn;
+  size_t m_first, m_step, m_end;
+  boost::shared_ptr<ContextScope> m_scope;
+  bool m_done;
+  std::string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+}
+#endif
+
+namespace
+{
+/** target phrases made by the unknown word handler, scored in isolation,
+ *  keyed on the factors of the source. Markup-heavy input has the same
+ *  numbers and placeholders in many sentences; this scores each once per
+ *  process. The scores are weighted, so a change of weights empties it. */
+class UnknownWordCache
+{
+public:
+  //! NULL if the source isn't cached with these weights
+  boost::shared_ptr<const TargetPhrase> Get(const string &key, const FVector &weights) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (!(weights == m_weights)) {
+      m_phrases.clear();
+      m_weights = weights;
+      return boost::shared_ptr<const TargetPhrase>();
+    }
+    Phrases::const_iterator found = m_phrases.find(key);
+    return found == m_phrases.end() ? boost::shared_ptr<const TargetPhrase>() : found->second;
+  }
+
+  void Put(const string &key, const FVector &weights, const TargetPhrase &targetPhrase) {
+    boost::shared_ptr<const TargetPhrase> copy(new TargetPhrase(targetPhrase));
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (!(weights == m_weights)) return;
+    if (m_phrases.size() >= kMaxSize) m_phrases.clear();
+    m_phrases[key] = copy;
+  }
+
+  void Clear() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_phrases.clear();
+  }
+
+private:
+  static const size_t kMaxSize = 100000;
+  typedef boost::unordered_map<string, boost::shared_ptr<const TargetPhrase> > Phrases;
+  Phrases m_phrases;
+  FVector m_weights;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
+UnknownWordCache s_unknownWordCache;
+}
+
 /** helper for pruning */
 // bool CompareTranslationOption(const TranslationOption *a, const TranslationOption *b)
 // {
@@ -63,7 +171,20 @@ TranslationOptionCollection(InputType const& src,
   , m_futureScore(src.GetSize())
   , m_maxNoTransOptPerCoverage(maxNoTransOptPerCoverage)
   , m_translationOptionThreshold(translationOptionThreshold)
+#ifdef WITH_THREADS
+  , m_poolChecked(false)
+#endif
 {
+  // A dead prefix can only be pruned if every phrase dictionary can tell
+  // that it has no entry with it.
+  BOOST_FOREACH(PhraseDictionary* pd, PhraseDictionary::GetColl()) {
+    if (!pd->ProvidesPrefixCheck()) {
+      m_prefixCheckers.clear();
+      break;
+    }
+    m_prefixCheckers.push_back(pd);
+  }
+
   // create 2-d vector
   size_t size = src.GetSize();
   for (size_t sPos = 0 ; sPos < size ; ++sPos) {
@@ -88,29 +209,105 @@ TranslationOptionCollection::
 
 void
 TranslationOptionCollection::
-Prune()
+FinishOptions()
 {
+  vector<pair<size_t, size_t> > counts(m_source.GetSize());
+  // looked up here, as the weight setting is that of the decoding thread
+  const ConstrainedDecoding *forcing = ConstrainedDecoding::GetForcing();
+  const vector<Phrase> *refs = forcing ? &forcing->GetReferences(m_source.GetTranslationId()) : NULL;
+  ForEachStartPosition(boost::bind(&TranslationOptionCollection::FinishStartPosition, this, _1, refs, &counts));
+
   static float no_th = -std::numeric_limits<float>::infinity();
+  if (m_maxNoTransOptPerCoverage != 0 || m_translationOptionThreshold != no_th) {
+    // bookkeeping for how many options used, pruned
+    size_t total = 0;
+    size_t totalPruned = 0;
+    for (size_t sPos = 0 ; sPos < counts.size() ; ++sPos) {
+      total       += counts[sPos].first;
+      totalPruned += counts[sPos].second;
+    }
+    VERBOSE(2,"       Total translation options: " << total << std::endl
+            << "Total translation options pruned: " << totalPruned << std::endl);
+  }
 
-  if (m_maxNoTransOptPerCoverage == 0 && m_translationOptionThreshold == no_th)
-    return;
+  CalcFutureScore(); // future score matrix
+}
 
-  // bookkeeping for how many options used, pruned
-  size_t total = 0;
-  size_t totalPruned = 0;
+void
+TranslationOptionCollection::
+FinishStartPosition(size_t sPos, const vector<Phrase> *refs, vector<pair<size_t, size_t> > *counts)
+{
+  static float no_th = -std::numeric_limits<float>::infinity();
+  static TranslationOption::Better cmp;
+  const bool prune = m_maxNoTransOptPerCoverage != 0 || m_translationOptionThreshold != no_th;
 
-  // loop through all spans
-  size_t size = m_source.GetSize();
-  for (size_t sPos = 0 ; sPos < size; ++sPos) {
-    BOOST_FOREACH(TranslationOptionList& fullList, m_collection[sPos]) {
-      total       += fullList.size();
-      totalPruned += fullList.SelectNBest(m_maxNoTransOptPerCoverage);
-      totalPruned += fullList.PruneByThreshold(m_translationOptionThreshold);
+  BOOST_FOREACH(TranslationOptionList& tol, m_collection[sPos]) {
+    if (refs) {
+      ConstrainedDecoding::RemoveUnreachable(*refs, tol);
+    }
+    // pruning: only keep the top n (m_maxNoTransOptPerCoverage) elements
+    if (prune) {
+      (*counts)[sPos].first  += tol.size();
+      (*counts)[sPos].second += tol.SelectNBest(m_maxNoTransOptPerCoverage);
+      (*counts)[sPos].second += tol.PruneByThreshold(m_translationOptionThreshold);
     }
+    // sorted for cube pruning
+    std::sort(tol.begin(), tol.end(), cmp);
   }
 
-  VERBOSE(2,"       Total translation options: " << total << std::endl
-          << "Total translation options pruned: " << totalPruned << std::endl);
+  // cached lexical reordering costs
+  typedef StatefulFeatureFunction sfFF;
+  BOOST_FOREACH(sfFF const* ff, sfFF::GetStatefulFeatureFunctions()) {
+    if (typeid(*ff) != typeid(LexicalReordering)) continue;
+    LexicalReordering const& lr = static_cast<const LexicalReordering&>(*ff);
+    BOOST_FOREACH(TranslationOptionList& tol, m_collection[sPos])
+    lr.SetCache(tol);
+  }
+}
+
+void
+TranslationOptionCollection::
+ForEachStartPosition(const boost::function<void(size_t)> &fn)
+{
+  const size_t size = m_source.GetSize();
+#ifdef WITH_THREADS
+  const StaticData &staticData = StaticData::Instance();
+  if (!m_poolChecked) {
+    m_poolChecked = true;
+    // verbose logging and the profile of the sentence belong to this thread
+    bool threadSafe = staticData.UseSearchThreads(size) && staticData.GetVerboseLevel() < 2
+                      && !DecodeProfile::IsEnabled() && size > 1;
+    const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+    for (size_t i = 0; threadSafe && i < ffs.size(); ++i) {
+      threadSafe = ffs[i]->CanEvaluateOnAnyThread();
+    }
+    if (threadSafe) {
+      m_pool.reset(new ThreadPool(staticData.GetSearchThreads()));
+    }
+  }
+  if (m_pool) {
+    // positions are dealt round robin: the spans of the last ones are short
+    const size_t numTasks = std::min(size, staticData.GetSearchThreads() * 2);
+    const boost::shared_ptr<ContextScope> scope = ContextScope::Current();
+    std::vector<boost::shared_ptr<StartPositionTask> > tasks;
+    for (size_t t = 0; t < numTasks; ++t) {
+      tasks.push_back(boost::shared_ptr<StartPositionTask>(
+                        new StartPositionTask(fn, t, numTasks, size, scope)));
+      m_pool->Submit(tasks.back());
+    }
+    // wait for every task before reporting, they all reference fn
+    std::string error;
+    for (size_t t = 0; t < numTasks; ++t) {
+      const std::string &taskError = tasks[t]->Wait();
+      if (error.empty()) error = taskError;
+    }
+    UTIL_THROW_IF2(!error.empty(), error);
+    return;
+  }
+#endif
+  for (size_t sPos = 0 ; sPos < size ; ++sPos) {
+    fn(sPos);
+  }
 }
 
 /** Force a creation of a translation option where there are none for a
@@ -158,6 +355,13 @@ ProcessUnknownWord()
   }
 }
 
+void
+TranslationOptionCollection::
+ClearUnknownWordCache()
+{
+  s_unknownWordCache.Clear();
+}
+
 /** special handling of ONE unknown words. Either add temporarily add word to
  * translation table, or drop the translation.  This function should be
  * called by the ProcessOneUnknownWord() in the inherited class At the
@@ -181,6 +385,19 @@ ProcessOneUnknownWord(const InputPath &inputPath, size_t sourcePos,
   unknownWordPenaltyProducer = UnknownWordPenaltyProducer::Instance();
   float unknownScore = FloorScore(TransformScore(0));
   const Word &sourceWord = inputPath.GetPhrase().GetWord(0);
+  const Phrase &sourcePhrase = inputPath.GetPhrase();
+  m_unksrcs.push_back(&sourcePhrase);
+  WordsRange range(sourcePos, sourcePos + length - 1);
+
+  const FVector &weights = staticData.GetAllWeights().GetScoresVector();
+  const string key = TranslationOptionCache::Key(sourcePhrase);
+  boost::shared_ptr<const TargetPhrase> cached = s_unknownWordCache.Get(key, weights);
+  if (cached) {
+    TranslationOption *transOpt = new TranslationOption(range, *cached);
+    transOpt->SetInputPath(inputPath);
+    Add(transOpt);
+    return;
+  }
 
   // hack. Once the OOV FF is a phrase table, get rid of this
   PhraseDictionary *firstPt = NULL;
@@ -232,12 +449,8 @@ ProcessOneUnknownWord(const InputPath &inputPath, size_t sourcePos,
 
   targetPhrase.GetScoreBreakdown().Assign(&unknownWordPenaltyProducer, unknownScore);
 
-  // source phrase
-  const Phrase &sourcePhrase = inputPath.GetPhrase();
-  m_unksrcs.push_back(&sourcePhrase);
-  WordsRange range(sourcePos, sourcePos + length - 1);
-
   targetPhrase.EvaluateInIsolation(sourcePhrase);
+  s_unknownWordCache.Put(key, weights, targetPhrase);
 
   TranslationOption *transOpt = new TranslationOption(range, targetPhrase);
   transOpt->SetInputPath(inputPath);
@@ -381,10 +594,7 @@ CreateTranslationOptions()
   ProcessUnknownWord();
   EvaluateWithSourceContext();
   VERBOSE(3,"Translation Option Collection\n " << *this << endl);
-  Prune();
-  Sort();
-  CalcFutureScore(); // future score matrix
-  CacheLexReordering(); // Cached lex reodering costs
+  FinishOptions();
 }
 
 
@@ -422,6 +632,24 @@ CreateTranslationOptionsForRange
       const DecodeStep *dstep = *d;
       PartialTranslOptColl* newPtoc = new PartialTranslOptColl;
 
+      if (StaticData::Instance().GetLazyFactorExpansion()) {
+        if (const Tstep *tstep = dynamic_cast<const Tstep*>(dstep)) {
+          const PhraseDictionary &pdict = *tstep->GetPhraseDictionaryFeature();
+          tstep->ProcessLazy(*oldPtoc, *newPtoc, adhereTableLimit,
+                             inputPath.GetTargetPhrases(pdict));
+        } else {
+          const Gstep *genStep = dynamic_cast<const Gstep*>(dstep);
+          UTIL_THROW_IF2(!genStep, "Decode steps must be either "
+                         << "Translation or Generation Steps!");
+          genStep->ProcessLazy(*oldPtoc, *newPtoc);
+        }
+        totalEarlyPruned += newPtoc->GetPrunedCount();
+        delete oldPtoc;
+        oldPtoc = newPtoc;
+        indexStep++;
+        continue;
+      }
+
       // go thru each intermediate trans opt just created
       const vector<TranslationOption*>& partTransOptList = oldPtoc->GetList();
       vector<TranslationOption*>::const_iterator pto;
@@ -497,14 +725,18 @@ void
 TranslationOptionCollection::
 EvaluateWithSourceContext()
 {
-  const size_t size = m_source.GetSize();
-  for (size_t sPos = 0 ; sPos < size ; ++sPos) {
-    BOOST_FOREACH(TranslationOptionList& tol, m_collection[sPos]) {
-      typedef TranslationOptionList::const_iterator to_iter;
-      for(to_iter i = tol.begin() ; i != tol.end() ; ++i)
-        (*i)->EvaluateWithSourceContext(m_source);
-      EvaluateTranslationOptionListWithSourceContext(tol);
-    }
+  ForEachStartPosition(boost::bind(&TranslationOptionCollection::EvaluateStartPosition, this, _1));
+}
+
+void
+TranslationOptionCollection::
+EvaluateStartPosition(size_t sPos)
+{
+  BOOST_FOREACH(TranslationOptionList& tol, m_collection[sPos]) {
+    typedef TranslationOptionList::const_iterator to_iter;
+    for(to_iter i = tol.begin() ; i != tol.end() ; ++i)
+      (*i)->EvaluateWithSourceContext(m_source);
+    EvaluateTranslationOptionListWithSourceContext(tol);
   }
 }
 
@@ -517,32 +749,13 @@ void TranslationOptionCollection::EvaluateTranslationOptionListWithSourceContext
   for (size_t i = 0; i < ffs.size(); ++i) {
     const FeatureFunction &ff = *ffs[i];
     if (! staticData.IsFeatureFunctionIgnored(ff)) {
+      DecodeProfile::Scope scope(ff, DecodeProfile::WithSourceContext);
       ff.EvaluateTranslationOptionListWithSourceContext(m_source, translationOptionList);
     }
   }
 
 }
 
-void
-TranslationOptionCollection::
-Sort()
-{
-  static TranslationOption::Better cmp;
-  size_t size = m_source.GetSize();
-  for (size_t sPos = 0 ; sPos < size; ++sPos) {
-    BOOST_FOREACH(TranslationOptionList& tol, m_collection.at(sPos)) {
-      // cerr << sPos << ": " << tol.size() << " "
-      // << __FILE__ << ":" << __LINE__ << endl;
-      // size_t nulls=0;
-      // BOOST_FOREACH(TranslationOption const* t, tol)
-      //   if (t == NULL) ++nulls;
-      // cerr << nulls << " null pointers ;"
-      // << __FILE__ << ":" << __LINE__ << endl;
-      std::sort(tol.begin(), tol.end(), cmp);
-    }
-  }
-}
-
 /** Check if this range overlaps with any XML options. This doesn't need to be an exact match, only an overlap.
  * by default, we don't support XML options. subclasses need to override this function.
  * called by CreateTranslationOptionsForRange()
@@ -618,22 +831,6 @@ operator<<(std::ostream& out, const TranslationOptionCollection& coll)
   return out;
 }
 
-void
-TranslationOptionCollection::
-CacheLexReordering()
-{
-  size_t const stop = m_source.GetSize();
-  typedef StatefulFeatureFunction sfFF;
-  BOOST_FOREACH(sfFF const* ff, sfFF::GetStatefulFeatureFunctions()) 
-    {
-      if (typeid(*ff) != typeid(LexicalReordering)) continue;
-      LexicalReordering const& lr = static_cast<const LexicalReordering&>(*ff);
-      for (size_t s = 0 ; s < stop ; s++) 
-	BOOST_FOREACH(TranslationOptionList& tol, m_collection[s]) 
-	  lr.SetCache(tol);
-    }
-}
-
 //! list of trans opt for a particular span
 TranslationOptionList*
 TranslationOptionCollection::
@@ -655,6 +852,17 @@ GetTranslationOptionList(size_t sPos, size_t ePos) const
   return idx < tol.size() ? &tol[idx] : NULL;
 }
 
+bool
+TranslationOptionCollection::
+PrefixExists(const Phrase &phrase) const
+{
+  if (m_prefixCheckers.empty()) return true;
+  BOOST_FOREACH(const PhraseDictionary* pd, m_prefixCheckers) {
+    if (pd->PrefixExists(phrase)) return true;
+  }
+  return false;
+}
+
 void
 TranslationOptionCollection::
 GetTargetPhraseCollectionBatch()
@@ -667,6 +875,7 @@ GetTargetPhraseCollectionBatch()
       const Tstep* tstep = dynamic_cast<const Tstep *>(*i);
       if (tstep) {
         const PhraseDictionary &pdict = *tstep->GetPhraseDictionaryFeature();
+        DecodeProfile::Scope scope(pdict, DecodeProfile::Lookup);
         pdict.GetTargetPhraseCollectionBatch(m_inputPathQueue);
       }
     }
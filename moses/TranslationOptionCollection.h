@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_TranslationOptionCollection_h
 
 #include <list>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include "TypeDef.h"
 #include "TranslationOption.h"
@@ -46,6 +48,7 @@ class Word;
 class DecodeGraph;
 class PhraseDictionary;
 class InputPath;
+class ThreadPool;
 
 /** Contains all phrase translations applicable to current input type (a sentence or confusion network).
  * A key insight into efficient decoding is that various input
@@ -72,6 +75,11 @@ protected:
   const float				m_translationOptionThreshold; /*< threshold for translation options with regard to best option for input span */
   std::vector<const Phrase*> m_unksrcs;
   InputPathList m_inputPathQueue;
+  std::vector<const PhraseDictionary*> m_prefixCheckers; /*< set only if every phrase dictionary provides a prefix check */
+#ifdef WITH_THREADS
+  boost::scoped_ptr<ThreadPool> m_pool; /*< -search-threads workers for the start positions, see ForEachStartPosition() */
+  bool m_poolChecked;
+#endif
 
   TranslationOptionCollection(InputType const& src, size_t maxNoTransOptPerCoverage,
                               float translationOptionThreshold);
@@ -83,11 +91,20 @@ protected:
   //! special handling of ONE unknown words.
   virtual void ProcessOneUnknownWord(const InputPath &inputPath, size_t sourcePos, size_t length = 1, const ScorePair *inputScores = NULL);
 
-  //! pruning: only keep the top n (m_maxNoTransOptPerCoverage) elements */
-  void Prune();
+  //! runs fn for every start position of the input, on the -search-threads
+  //! workers if every feature function can be evaluated on any thread
+  void ForEachStartPosition(const boost::function<void(size_t)> &fn);
+
+  //! prunes (only keeps the top m_maxNoTransOptPerCoverage) and sorts the
+  //! options of every span, caches their lexical reordering scores, then
+  //! computes the future cost matrix
+  void FinishOptions();
 
-  //! sort all trans opt in each list for cube pruning */
-  void Sort();
+  //! FinishOptions() for the spans starting at sPos; counts the options
+  //! before pruning and the pruned ones. Options that can't be part of one
+  //! of refs are dropped first, if given (forced decoding)
+  void FinishStartPosition(size_t sPos, const std::vector<Phrase> *refs,
+                           std::vector<std::pair<size_t, size_t> > *counts);
 
 public:
   // is there any good reason not to make these public? UG
@@ -107,9 +124,10 @@ protected:
 
   void EvaluateWithSourceContext();
 
-  void EvaluateTranslationOptionListWithSourceContext(TranslationOptionList&);
+  //! EvaluateWithSourceContext() for the spans starting at sPos
+  void EvaluateStartPosition(size_t sPos);
 
-  void CacheLexReordering();
+  void EvaluateTranslationOptionListWithSourceContext(TranslationOptionList&);
 
   void GetTargetPhraseCollectionBatch();
 
@@ -123,6 +141,10 @@ protected:
 
   void SetInputScore(const InputPath &inputPath, PartialTranslOptColl &oldPtoc);
 
+  //! false if no phrase dictionary has an entry starting with phrase, so an
+  //! input path with this phrase needn't be extended
+  bool PrefixExists(const Phrase &phrase) const;
+
 public:
   virtual ~TranslationOptionCollection();
 
@@ -136,6 +158,10 @@ public:
     return m_unksrcs;
   }
 
+  //! forget the target phrases of unknown words kept from earlier inputs,
+  //! e.g. after a model was reloaded
+  static void ClearUnknownWordCache();
+
   //! Create all possible translations from the phrase tables
   virtual void CreateTranslationOptions();
 
@@ -11,7 +11,6 @@
 #include "FF/InputFeature.h"
 #include "TranslationModel/PhraseDictionaryTreeAdaptor.h"
 #include "util/exception.hh"
-#include <boost/foreach.hpp>
 
 using namespace std;
 
@@ -26,14 +25,6 @@ TranslationOptionCollectionConfusionNet(const ConfusionNet &input,
   : TranslationOptionCollection(input, maxNoTransOptPerCoverage,
                                 translationOptionThreshold)
 {
-  // Prefix checkers are phrase dictionaries that provide a prefix check
-  // to indicate that a phrase table entry with a given prefix exists.
-  // If no entry with the given prefix exists, there is no point in
-  // expanding it further.
-  vector<PhraseDictionary*> prefixCheckers;
-  BOOST_FOREACH(PhraseDictionary* pd, PhraseDictionary::GetColl())
-  if (pd->ProvidesPrefixCheck()) prefixCheckers.push_back(pd);
-
   const InputFeature &inputFeature = InputFeature::Instance();
   UTIL_THROW_IF2(&inputFeature == NULL, "Input feature must be specified");
 
@@ -103,10 +94,9 @@ TranslationOptionCollectionConfusionNet(const ConfusionNet &input,
           Phrase subphrase(prevPhrase);
           subphrase.AddWord(word);
 
-          bool OK = prefixCheckers.size() == 0;
-          for (size_t k = 0; !OK && k < prefixCheckers.size(); ++k)
-            OK = prefixCheckers[k]->PrefixExists(subphrase);
-          if (!OK) continue;
+          // If no phrase table entry starts with subphrase, there is no
+          // point in expanding it further.
+          if (!PrefixExists(subphrase)) continue;
 
           const ScorePair &scores = col[i].second;
           ScorePair *inputScore = new ScorePair(*prevInputScore);
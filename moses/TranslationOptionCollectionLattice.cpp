@@ -107,6 +107,12 @@ void TranslationOptionCollectionLattice::Extend(const InputPath &prevPath, const
     Phrase subphrase(prevPhrase);
     subphrase.AddWord(word);
 
+    // no phrase table entry starts with subphrase, nor with any path
+    // through the lattice that extends it
+    if (!PrefixExists(subphrase)) {
+      continue;
+    }
+
     const ScorePair &scores = col[i].second;
     ScorePair *inputScore = new ScorePair(*prevInputScore);
     inputScore->PlusEquals(scores);
@@ -157,16 +163,8 @@ void TranslationOptionCollectionLattice::CreateTranslationOptions()
     }
   }
 
-  // Prune
-  Prune();
-
-  Sort();
-
-  // future score matrix
-  CalcFutureScore();
-
-  // Cached lex reodering costs
-  CacheLexReordering();
+  // prune, sort, future score matrix and cached lex reordering costs
+  FinishOptions();
 
 }
 
@@ -23,10 +23,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Sentence.h"
 #include "DecodeStep.h"
 #include "DecodeStepTranslation.h"
+#include "DecodeGraph.h"
 #include "FactorCollection.h"
 #include "WordsRange.h"
+#include "StaticData.h"
+#include "TranslationOptionCache.h"
+#include <algorithm>
 #include <list>
 
+#include <boost/bind.hpp>
+
 using namespace std;
 
 namespace Moses
@@ -36,8 +42,10 @@ TranslationOptionCollectionText::TranslationOptionCollectionText(Sentence const
   : TranslationOptionCollection(input, maxNoTransOptPerCoverage, translationOptionThreshold)
 {
   size_t size = input.GetSize();
+  // no options are collected for longer spans, see m_collection
+  size_t maxSize = std::min(size, StaticData::Instance().GetMaxPhraseLength());
   m_inputPathMatrix.resize(size);
-  for (size_t phaseSize = 1; phaseSize <= size; ++phaseSize) {
+  for (size_t phaseSize = 1; phaseSize <= maxSize; ++phaseSize) {
     for (size_t startPos = 0; startPos < size - phaseSize + 1; ++startPos) {
       size_t endPos = startPos + phaseSize -1;
       vector<InputPath*> &vec = m_inputPathMatrix[startPos];
@@ -159,10 +167,118 @@ InputPath &TranslationOptionCollectionText::GetInputPath(size_t startPos, size_t
 
 void TranslationOptionCollectionText::CreateTranslationOptions()
 {
+  TranslationOptionCache *cache = StaticData::Instance().GetTranslationOptionCache();
+  if (cache) {
+    CreateCachedTranslationOptions(*cache);
+    return;
+  }
   GetTargetPhraseCollectionBatch();
   TranslationOptionCollection::CreateTranslationOptions();
 }
 
+/** as TranslationOptionCollection::CreateTranslationOptions(), but the
+ * options of spans found in the cache are copied from there, and those of
+ * the other spans are added to it before they are pruned. Spans that
+ * overlap XML options are neither.
+ */
+void TranslationOptionCollectionText::CreateCachedTranslationOptions(TranslationOptionCache &cache)
+{
+  const StaticData &staticData = StaticData::Instance();
+  // a copy, so that all spans of the sentence are looked up and stored
+  // with the same weights
+  const FVector weights = staticData.GetAllWeights().GetScoresVector();
+
+  const size_t size = m_source.GetSize();
+
+  // by start position and length - 1, like m_collection. An empty key
+  // means not to cache the span
+  vector<vector<string> > keys(size);
+  vector<vector<bool> > cached(size);
+  vector<bool> unknown(size, false); // handled as an unknown word
+  bool allCached = true;
+  for (size_t sPos = 0 ; sPos < size ; ++sPos) {
+    keys[sPos].resize(m_collection[sPos].size());
+    cached[sPos].resize(m_collection[sPos].size(), false);
+    for (size_t i = 0 ; i < m_collection[sPos].size() ; ++i) {
+      size_t ePos = sPos + i;
+      if (!HasXmlOptionsOverlappingRange(sPos, ePos)) {
+        const InputPath &inputPath = GetInputPath(sPos, ePos);
+        bool unknownWord = false;
+        keys[sPos][i] = TranslationOptionCache::Key(inputPath.GetPhrase());
+        cached[sPos][i] = cache.Get(keys[sPos][i], weights, inputPath.GetWordsRange(), inputPath,
+                                    m_collection[sPos][i], unknownWord);
+        if (i == 0) unknown[sPos] = unknownWord;
+      }
+      allCached = allCached && cached[sPos][i];
+    }
+  }
+
+  if (!allCached) {
+    GetTargetPhraseCollectionBatch();
+  }
+
+  // loop over all decoding graphs, each generates translation options
+  const vector <DecodeGraph*> &decodeGraphList = staticData.GetDecodeGraphs();
+  for (size_t gidx = 0 ; gidx < decodeGraphList.size() ; gidx++) {
+    const DecodeGraph& dg = *decodeGraphList[gidx];
+    size_t backoff = dg.GetBackoff();
+    for (size_t sPos = 0 ; sPos < size; sPos++) {
+      for (size_t i = 0 ; i < m_collection[sPos].size() ; ++i) {
+        if (cached[sPos][i]) continue;
+        if (gidx && backoff && (i + 1 <= backoff || m_collection[sPos][i].size() > 0)) {
+          continue;
+        }
+        CreateTranslationOptionsForRange(dg, sPos, sPos + i, true, gidx);
+      }
+    }
+  }
+
+  // unknown words, see TranslationOptionCollection::ProcessUnknownWord()
+  for (size_t gidx = 0 ; gidx < decodeGraphList.size() ; gidx++) {
+    for (size_t pos = 0 ; pos < size ; ++pos) {
+      if (!cached[pos][0] && m_collection[pos][0].size() == 0) {
+        CreateTranslationOptionsForRange(*decodeGraphList[gidx], pos, pos, false, gidx);
+      }
+    }
+  }
+  bool alwaysCreateDirectTranslationOption = staticData.IsAlwaysCreateDirectTranslationOption();
+  for (size_t pos = 0 ; pos < size ; ++pos) {
+    if (!cached[pos][0]
+        && (m_collection[pos][0].size() == 0 || alwaysCreateDirectTranslationOption)) {
+      ProcessUnknownWord(pos);
+      unknown[pos] = true;
+    }
+  }
+  m_unksrcs.clear();
+  for (size_t pos = 0 ; pos < size ; ++pos) {
+    if (unknown[pos]) m_unksrcs.push_back(&GetInputPath(pos, pos).GetPhrase());
+  }
+
+  ForEachStartPosition(boost::bind(&TranslationOptionCollectionText::EvaluateUncached, this, _1, &cached));
+  for (size_t sPos = 0 ; sPos < size ; ++sPos) {
+    for (size_t i = 0 ; i < m_collection[sPos].size() ; ++i) {
+      if (!cached[sPos][i] && !keys[sPos][i].empty()) {
+        cache.Put(keys[sPos][i], weights, m_collection[sPos][i], i == 0 && unknown[sPos]);
+      }
+    }
+  }
+
+  VERBOSE(3,"Translation Option Collection\n " << *this << endl);
+  FinishOptions();
+}
+
+void TranslationOptionCollectionText::EvaluateUncached(size_t sPos, const vector<vector<bool> > *cached)
+{
+  for (size_t i = 0 ; i < m_collection[sPos].size() ; ++i) {
+    if ((*cached)[sPos][i]) continue;
+    TranslationOptionList &tol = m_collection[sPos][i];
+    for (TranslationOptionList::const_iterator to = tol.begin() ; to != tol.end() ; ++to) {
+      (*to)->EvaluateWithSourceContext(m_source);
+    }
+    EvaluateTranslationOptionListWithSourceContext(tol);
+  }
+}
+
 /** create translation options that exactly cover a specific input span.
  * Called by CreateTranslationOptions() and ProcessUnknownWord()
  * \param decodeGraph list of decoding steps
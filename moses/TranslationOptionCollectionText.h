@@ -31,6 +31,7 @@ namespace Moses
 {
 
 class Sentence;
+class TranslationOptionCache;
 
 /** Holds all translation options, for all spans, of a particular sentence input
  * Inherited from TranslationOptionCollection.
@@ -45,6 +46,11 @@ protected:
 
   InputPath &GetInputPath(size_t startPos, size_t endPos);
 
+  void CreateCachedTranslationOptions(TranslationOptionCache &cache);
+
+  //! EvaluateStartPosition() for the spans starting at sPos that were not in the cache
+  void EvaluateUncached(size_t sPos, const std::vector<std::vector<bool> > *cached);
+
 public:
   void ProcessUnknownWord(size_t sourcePos);
 
@@ -83,5 +83,21 @@ PruneByThreshold(float const th)
   return old_size - m_coll.size();
 }
 
+size_t
+TranslationOptionList::
+RemoveIf(const boost::function<bool(const TranslationOption*)> &drop)
+{
+  size_t kept = 0;
+  for (size_t i = 0; i < m_coll.size(); ++i) {
+    if (drop(m_coll[i])) {
+      delete m_coll[i];
+    } else {
+      m_coll[kept++] = m_coll[i];
+    }
+  }
+  size_t ret = m_coll.size() - kept;
+  m_coll.resize(kept);
+  return ret;
+}
 
 } // namespace
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <vector>
+#include <boost/function.hpp>
 #include "util/exception.hh"
 #include <iostream>
 #include "Util.h"
@@ -68,5 +69,9 @@ public:
   size_t SelectNBest(size_t const N);
   size_t PruneByThreshold(float const th);
 
+  //! deletes the options for which drop is true, keeping the order of
+  //! the others; returns the number deleted
+  size_t RemoveIf(const boost::function<bool(const TranslationOption*)> &drop);
+
 };
 }
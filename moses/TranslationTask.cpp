@@ -7,7 +7,13 @@
 #include "moses/Util.h"
 #include "moses/InputType.h"
 #include "moses/OutputCollector.h"
+#include "moses/TranslationCache.h"
+#include "moses/ContextScope.h"
+#include "moses/DecodeProfile.h"
+#include "moses/MemoryReport.h"
 #include "moses/Incremental.h"
+#include "moses/TrellisPathList.h"
+#include "moses/FF/ConstrainedDecoding.h"
 #include "mbr.h"
 
 #include "moses/Syntax/F2S/RuleMatcherCallback.h"
@@ -37,11 +43,96 @@ TranslationTask
 ::TranslationTask(boost::shared_ptr<InputType> const& source, 
 		  boost::shared_ptr<IOWrapper> const& ioWrapper)
   : m_source(source) , m_ioWrapper(ioWrapper)
-{ }
+{
+  // an input of its own is a document of its own
+  if (m_source && !m_source->GetScope())
+    m_source->SetScope(boost::shared_ptr<ContextScope>(new ContextScope));
+}
 
 TranslationTask::~TranslationTask()
 { }
 
+std::string TranslationTask::CacheKey() const
+{
+  const StaticData &staticData = StaticData::Instance();
+  if (!staticData.GetTranslationCache()) return "";
+
+  // only plain sentences; markup may carry options or update models
+  if (m_source->GetType() != SentenceInput) return "";
+  const Sentence &sentence = static_cast<const Sentence&>(*m_source);
+  if (sentence.HasMarkup() || staticData.ContinuePartialTranslation()) return "";
+
+  // only the single-best translation is cached
+  IOWrapper &io = *m_ioWrapper;
+  if (!io.GetSingleBestOutputCollector()
+      || io.GetWordGraphCollector()
+      || io.GetSearchGraphOutputCollector()
+      || io.GetNBestOutputCollector()
+      || io.GetLatticeSamplesCollector()
+      || io.GetDetailedTranslationCollector()
+      || io.GetDetailTreeFragmentsOutputCollector()
+      || io.GetUnknownsCollector()
+      || io.GetAlignmentInfoCollector()
+      || staticData.GetOutputSearchGraphSLF()
+      || staticData.GetOutputSearchGraphHypergraph()
+      || staticData.PrintAllDerivations()) return "";
+  const PARAM_VEC *params = staticData.GetParameter().GetParam("print-id");
+  if (params && params->size() && Scan<bool>(params->at(0))) return "";
+
+  return "cmd\t" + TranslationCache::Normalize(sentence.GetStringRep(staticData.GetInputFactorOrder()));
+}
+
+const ConstrainedDecoding *TranslationTask::RunCoarsePass()
+{
+  const StaticData &staticData = StaticData::Instance();
+
+  const ConstrainedDecoding *constraint = NULL;
+  const std::vector<const StatefulFeatureFunction*> &sfs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (size_t i = 0; i < sfs.size() && !constraint; ++i) {
+    constraint = dynamic_cast<const ConstrainedDecoding*>(sfs[i]);
+  }
+  UTIL_THROW_IF2(!constraint, "-coarse-to-fine needs a ConstrainedDecoding feature to restrict the second pass");
+
+  // the managers take the weights from the input; the coarse pass ignores
+  // its own weights
+  const bool specifiesWeightSetting = m_source->GetSpecifiesWeightSetting();
+  const std::string weightSetting = m_source->GetWeightSetting();
+  const boost::shared_ptr<const ScoreComponentCollection> requestWeights = m_source->GetRequestWeights();
+  m_source->SetSpecifiesWeightSetting(true);
+  m_source->SetWeightSetting(staticData.GetCoarseToFineWeightSetting());
+  m_source->SetRequestWeights(boost::shared_ptr<const ScoreComponentCollection>());
+
+  std::vector<Phrase> translations;
+  const size_t nBestSize = staticData.GetCoarseToFineNBestSize();
+  if (!staticData.IsSyntax()) {
+    Manager manager(*m_source);
+    manager.Decode();
+    TrellisPathList nBestList;
+    manager.CalcNBest(nBestSize, nBestList, true);
+    for (TrellisPathList::const_iterator path = nBestList.begin(); path != nBestList.end(); ++path) {
+      translations.push_back((*path)->GetTargetPhrase());
+    }
+  } else {
+    ChartManager manager(*m_source);
+    manager.Decode();
+    std::vector<boost::shared_ptr<ChartKBestExtractor::Derivation> > nBestList;
+    manager.CalcNBest(nBestSize, nBestList, true);
+    for (size_t i = 0; i < nBestList.size(); ++i) {
+      translations.push_back(ChartKBestExtractor::GetOutputPhrase(*nBestList[i]));
+    }
+  }
+  VERBOSE(2, "Line " << m_source->GetTranslationId() << ": coarse pass found "
+          << translations.size() << " translations" << endl);
+
+  m_source->SetSpecifiesWeightSetting(specifiesWeightSetting);
+  m_source->SetWeightSetting(weightSetting);
+  m_source->SetRequestWeights(requestWeights);
+  staticData.SelectWeights(*m_source);
+
+  constraint->SetConstraints(m_source->GetTranslationId(), translations);
+  return constraint;
+}
+
 void TranslationTask::Run()
 {
   UTIL_THROW_IF2(!m_source || !m_ioWrapper,
@@ -63,55 +154,83 @@ void TranslationTask::Run()
 #endif
 
 
+  DecodeProfile::BeginSentence();
+
+  // a cached translation needs no search at all
+  TranslationCache *cache = staticData.GetTranslationCache();
+  const std::string cacheKey = CacheKey();
+  std::string cached;
+  if (!cacheKey.empty() && cache->Get(cacheKey, cached)) {
+    m_ioWrapper->GetSingleBestOutputCollector()->Write(translationId, cached);
+    VERBOSE(1, "Line " << translationId << ": Translation taken from the cache" << endl);
+    DecodeProfile::EndSentence(translationId, translationTime.get_elapsed_time());
+    return;
+  }
+
   // execute the translation
   // note: this executes the search, resulting in a search graph
   //       we still need to apply the decision rule (MAP, MBR, ...)
   Timer initTime;
   initTime.start();
 
+  // the first pass of coarse-to-fine decoding restricts the search of the second
+  const ConstrainedDecoding *coarseConstraint = NULL;
+  if (staticData.IsCoarseToFine()) {
+    coarseConstraint = RunCoarsePass();
+  }
+
   // which manager
   boost::scoped_ptr<BaseManager> manager;
-
-  if (!staticData.IsSyntax()) {
-    // phrase-based
-    manager.reset(new Manager(*m_source));
-  } else if (staticData.GetSearchAlgorithm() == SyntaxF2S ||
-             staticData.GetSearchAlgorithm() == SyntaxT2S) {
-    // STSG-based tree-to-string / forest-to-string decoding (ask Phil Williams)
-    typedef Syntax::F2S::RuleMatcherCallback Callback;
-    typedef Syntax::F2S::RuleMatcherHyperTree<Callback> RuleMatcher;
-    manager.reset(new Syntax::F2S::Manager<RuleMatcher>(*m_source));
-  } else if (staticData.GetSearchAlgorithm() == SyntaxS2T) {
-    // new-style string-to-tree decoding (ask Phil Williams)
-    S2TParsingAlgorithm algorithm = staticData.GetS2TParsingAlgorithm();
-    if (algorithm == RecursiveCYKPlus) {
-      typedef Syntax::S2T::EagerParserCallback Callback;
-      typedef Syntax::S2T::RecursiveCYKPlusParser<Callback> Parser;
-      manager.reset(new Syntax::S2T::Manager<Parser>(*m_source));
-    } else if (algorithm == Scope3) {
-      typedef Syntax::S2T::StandardParserCallback Callback;
-      typedef Syntax::S2T::Scope3Parser<Callback> Parser;
-      manager.reset(new Syntax::S2T::Manager<Parser>(*m_source));
+  {
+    DecodeProfile::OverheadScope setup(DecodeProfile::Setup);
+
+    if (!staticData.IsSyntax()) {
+      // phrase-based
+      manager.reset(new Manager(*m_source));
+    } else if (staticData.GetSearchAlgorithm() == SyntaxF2S ||
+               staticData.GetSearchAlgorithm() == SyntaxT2S) {
+      // STSG-based tree-to-string / forest-to-string decoding (ask Phil Williams)
+      typedef Syntax::F2S::RuleMatcherCallback Callback;
+      typedef Syntax::F2S::RuleMatcherHyperTree<Callback> RuleMatcher;
+      manager.reset(new Syntax::F2S::Manager<RuleMatcher>(*m_source));
+    } else if (staticData.GetSearchAlgorithm() == SyntaxS2T) {
+      // new-style string-to-tree decoding (ask Phil Williams)
+      S2TParsingAlgorithm algorithm = staticData.GetS2TParsingAlgorithm();
+      if (algorithm == RecursiveCYKPlus) {
+        typedef Syntax::S2T::EagerParserCallback Callback;
+        typedef Syntax::S2T::RecursiveCYKPlusParser<Callback> Parser;
+        manager.reset(new Syntax::S2T::Manager<Parser>(*m_source));
+      } else if (algorithm == Scope3) {
+        typedef Syntax::S2T::StandardParserCallback Callback;
+        typedef Syntax::S2T::Scope3Parser<Callback> Parser;
+        manager.reset(new Syntax::S2T::Manager<Parser>(*m_source));
+      } else {
+        UTIL_THROW2("ERROR: unhandled S2T parsing algorithm");
+      }
+    } else if (staticData.GetSearchAlgorithm() == SyntaxT2S_SCFG) {
+      // SCFG-based tree-to-string decoding (ask Phil Williams)
+      typedef Syntax::F2S::RuleMatcherCallback Callback;
+      typedef Syntax::T2S::RuleMatcherSCFG<Callback> RuleMatcher;
+      manager.reset(new Syntax::T2S::Manager<RuleMatcher>(*m_source));
+    } else if (staticData.GetSearchAlgorithm() == ChartIncremental) {
+      // Ken's incremental decoding
+      manager.reset(new Incremental::Manager(*m_source));
     } else {
-      UTIL_THROW2("ERROR: unhandled S2T parsing algorithm");
+      // original SCFG manager
+      manager.reset(new ChartManager(*m_source));
     }
-  } else if (staticData.GetSearchAlgorithm() == SyntaxT2S_SCFG) {
-    // SCFG-based tree-to-string decoding (ask Phil Williams)
-    typedef Syntax::F2S::RuleMatcherCallback Callback;
-    typedef Syntax::T2S::RuleMatcherSCFG<Callback> RuleMatcher;
-    manager.reset(new Syntax::T2S::Manager<RuleMatcher>(*m_source));
-  } else if (staticData.GetSearchAlgorithm() == ChartIncremental) {
-    // Ken's incremental decoding
-    manager.reset(new Incremental::Manager(*m_source));
-  } else {
-    // original SCFG manager
-    manager.reset(new ChartManager(*m_source));
   }
 
   VERBOSE(1, "Line " << translationId << ": Initialize search took " 
 	  << initTime << " seconds total" << endl);
 
   manager->Decode();
+  if (coarseConstraint) {
+    coarseConstraint->ClearConstraints(translationId);
+  }
+  if (manager->WasDegraded()) {
+    TRACE_ERR("Line " << translationId << ": -time-budget exceeded, search limits were tightened" << endl);
+  }
 
   OutputCollector* ocoll;
   // we are done with search, let's look what we got
@@ -119,7 +238,17 @@ void TranslationTask::Run()
   additionalReportingTime.start();
 
   boost::shared_ptr<IOWrapper> const& io = m_ioWrapper;
-  manager->OutputBest(io->GetSingleBestOutputCollector());
+  if (cacheKey.empty() || manager->WasDegraded()) {
+    manager->OutputBest(io->GetSingleBestOutputCollector());
+  } else {
+    // catch the output to put it in the cache as well
+    std::ostringstream best, debug;
+    OutputCollector capture(&best, &debug);
+    capture.SetNextOutput(translationId);
+    manager->OutputBest(&capture);
+    cache->Put(cacheKey, best.str());
+    io->GetSingleBestOutputCollector()->Write(translationId, best.str(), debug.str());
+  }
 
   // output word graph
   manager->OutputWordGraph(io->GetWordGraphCollector());
@@ -158,13 +287,19 @@ void TranslationTask::Run()
 
   // report additional statistics
   manager->CalcDecoderStatistics();
+  {
+    DecodeProfile::OverheadScope cleanup(DecodeProfile::Cleanup);
+    manager.reset();
+  }
   VERBOSE(1, "Line " << translationId << ": Additional reporting took " 
 	  << additionalReportingTime << " seconds total" << endl);
   VERBOSE(1, "Line " << translationId << ": Translation took " 
 	  << translationTime << " seconds total" << endl);
   IFVERBOSE(2) {
     PrintUserTime("Sentence Decoding Time:");
+    MemoryReport::Print(std::cerr);
   }
+  DecodeProfile::EndSentence(translationId, translationTime.get_elapsed_time());
 }
 
 }
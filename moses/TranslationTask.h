@@ -19,6 +19,7 @@
 
 namespace Moses
 {
+class ConstrainedDecoding;
 class InputType;
 class OutputCollector;
 
@@ -80,6 +81,14 @@ public:
   virtual void Run();
 
 private:
+  //! key of the input in the translation cache, empty if the result must
+  //! not come from or go into the cache
+  std::string CacheKey() const;
+
+  //! first pass of -coarse-to-fine: decodes with the coarse weight setting
+  //! and constrains the returned feature to the n-best translations found
+  const ConstrainedDecoding *RunCoarsePass();
+
   boost::shared_ptr<Moses::InputType> m_source; 
   boost::shared_ptr<Moses::IOWrapper> m_ioWrapper;
 
@@ -29,157 +29,145 @@ using namespace std;
 namespace Moses
 {
 TrellisPath::TrellisPath(const Hypothesis *hypo)
-  :	m_prevEdgeChanged(NOT_FOUND)
+  : m_root(hypo)
+  , m_prevEdgeChanged(NOT_FOUND)
 {
-  m_scoreBreakdown					= hypo->GetScoreBreakdown();
   m_totalScore = hypo->GetTotalScore();
+}
 
-  // enumerate path using prevHypo
-  while (hypo != NULL) {
-    m_path.push_back(hypo);
-    hypo = hypo->GetPrevHypo();
-  }
+TrellisPath::TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc)
+  : m_root(copy.m_root)
+  , m_prevEdgeChanged(edgeIndex)
+{
+  // the parent deviates before edgeIndex only, so the edge replaced by arc is
+  // on the best path back from there and arc is the only new non-winner
+  m_deviations.reserve(copy.m_deviations.size() + 1);
+  m_deviations = copy.m_deviations;
+  m_deviations.push_back(std::make_pair(edgeIndex, arc));
+
+  // same order of operations as summing over the whole path
+  m_totalScore = copy.m_totalScore - arc->GetWinningHypo()->GetTotalScore() + arc->GetTotalScore();
 }
 
-void TrellisPath::InitScore()
+TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
+  : m_prevEdgeChanged(NOT_FOUND)
 {
-  m_totalScore		= m_path[0]->GetWinningHypo()->GetTotalScore();
-  m_scoreBreakdown= m_path[0]->GetWinningHypo()->GetScoreBreakdown();
+  m_path.resize(edges.size());
+  copy(edges.rbegin(),edges.rend(),m_path.begin());
 
-  //calc score
-  size_t sizePath = m_path.size();
-  for (size_t pos = 0 ; pos < sizePath ; pos++) {
-    const Hypothesis *hypo = m_path[pos];
-    const Hypothesis *winningHypo = hypo->GetWinningHypo();
-    if (hypo != winningHypo) {
-      m_totalScore = m_totalScore - winningHypo->GetTotalScore() + hypo->GetTotalScore();
-      m_scoreBreakdown.MinusEquals(winningHypo->GetScoreBreakdown());
-      m_scoreBreakdown.PlusEquals(hypo->GetScoreBreakdown());
+  m_root = m_path[0]->GetWinningHypo();
+  for (size_t pos = 0 ; pos < m_path.size() ; ++pos) {
+    const Hypothesis *expected = pos ? m_path[pos - 1]->GetPrevHypo() : m_root;
+    if (m_path[pos] != expected) {
+      m_deviations.push_back(std::make_pair(pos, m_path[pos]));
     }
   }
-
-
+  m_totalScore = CalcTotalScore();
 }
 
-TrellisPath::TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc)
-  :m_prevEdgeChanged(edgeIndex)
+const Hypothesis *TrellisPath::GetFirstEdge(size_t &dev) const
 {
-  m_path.reserve(copy.m_path.size());
-  for (size_t currEdge = 0 ; currEdge < edgeIndex ; currEdge++) {
-    // copy path from parent
-    m_path.push_back(copy.m_path[currEdge]);
+  dev = 0;
+  if (!m_deviations.empty() && m_deviations[0].first == 0) {
+    return m_deviations[dev++].second;
   }
+  return m_root;
+}
 
-  // 1 deviation
-  m_path.push_back(arc);
-
-  // rest of path comes from following best path backwards
-  const Hypothesis *prevHypo = arc->GetPrevHypo();
-  while (prevHypo != NULL) {
-    m_path.push_back(prevHypo);
-    prevHypo = prevHypo->GetPrevHypo();
+const Hypothesis *TrellisPath::GetNextEdge(const Hypothesis *edge, size_t pos, size_t &dev) const
+{
+  if (dev < m_deviations.size() && m_deviations[dev].first == pos + 1) {
+    return m_deviations[dev++].second;
   }
-
-  InitScore();
+  return edge->GetPrevHypo();
 }
 
-TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
-  :m_prevEdgeChanged(NOT_FOUND)
+float TrellisPath::CalcTotalScore() const
 {
-  m_path.resize(edges.size());
-  copy(edges.rbegin(),edges.rend(),m_path.begin());
-  InitScore();
-
-
+  // all edges that are not deviations are winners, they add nothing
+  float totalScore = m_root->GetTotalScore();
+  for (size_t dev = 0 ; dev < m_deviations.size() ; ++dev) {
+    const Hypothesis *hypo = m_deviations[dev].second;
+    const Hypothesis *winningHypo = hypo->GetWinningHypo();
+    if (hypo != winningHypo) {
+      totalScore = totalScore - winningHypo->GetTotalScore() + hypo->GetTotalScore();
+    }
+  }
+  return totalScore;
 }
 
+const std::vector<const Hypothesis *> &TrellisPath::GetEdges() const
+{
+  if (m_path.empty()) {
+    size_t dev;
+    size_t pos = 0;
+    for (const Hypothesis *edge = GetFirstEdge(dev) ; edge != NULL ; edge = GetNextEdge(edge, pos++, dev)) {
+      m_path.push_back(edge);
+    }
+  }
+  return m_path;
+}
 
-void TrellisPath::CreateDeviantPaths(TrellisPathCollection &pathColl) const
+const ScoreComponentCollection &TrellisPath::GetScoreBreakdown() const
 {
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
+  if (!m_scoreBreakdown) {
+    ScoreComponentCollection *scoreBreakdown = new ScoreComponentCollection(m_root->GetScoreBreakdown());
+    m_scoreBreakdown.reset(scoreBreakdown);
+    for (size_t dev = 0 ; dev < m_deviations.size() ; ++dev) {
+      const Hypothesis *hypo = m_deviations[dev].second;
+      const Hypothesis *winningHypo = hypo->GetWinningHypo();
+      if (hypo != winningHypo) {
+        scoreBreakdown->MinusEquals(winningHypo->GetScoreBreakdown());
+        scoreBreakdown->PlusEquals(hypo->GetScoreBreakdown());
       }
     }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
   }
+  return *m_scoreBreakdown;
 }
 
-void TrellisPath::CreateDeviantPaths(TrellisPathList &pathColl) const
+template <class Coll>
+void TrellisPath::AddDeviantPaths(Coll &pathColl) const
 {
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
-      }
+  // wiggle 1 of the edges after the last one changed, or any of a pure path.
+  // Walks the edges without making the list of them.
+  size_t dev;
+  size_t pos = 0;
+  for (const Hypothesis *edge = GetFirstEdge(dev) ; edge != NULL ; edge = GetNextEdge(edge, pos++, dev)) {
+    if (m_prevEdgeChanged != NOT_FOUND && pos <= m_prevEdgeChanged) continue;
+
+    const ArcList *pAL = edge->GetArcList();
+    if (!pAL) continue;
+    const ArcList &arcList = *pAL;
+
+    // every possible Arc to replace this edge
+    ArcList::const_iterator iterArc;
+    for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
+      const Hypothesis *arc = *iterArc;
+      TrellisPath *deviantPath = new TrellisPath(*this, pos, arc);
+      pathColl.Add(deviantPath);
     }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
   }
 }
 
+void TrellisPath::CreateDeviantPaths(TrellisPathCollection &pathColl) const
+{
+  AddDeviantPaths(pathColl);
+}
+
+void TrellisPath::CreateDeviantPaths(TrellisPathList &pathColl) const
+{
+  AddDeviantPaths(pathColl);
+}
+
 Phrase TrellisPath::GetTargetPhrase() const
 {
   Phrase targetPhrase(ARRAY_SIZE_INCR);
 
-  int numHypo = (int) m_path.size();
+  const std::vector<const Hypothesis *> &edges = GetEdges();
+  int numHypo = (int) edges.size();
   for (int node = numHypo - 2 ; node >= 0 ; --node) {
     // don't do the empty hypo - waste of time and decode step id is invalid
-    const Hypothesis &hypo = *m_path[node];
+    const Hypothesis &hypo = *edges[node];
     const Phrase &currTargetPhrase = hypo.GetCurrTargetPhrase();
 
     targetPhrase.Append(currTargetPhrase);
@@ -212,8 +200,9 @@ WordsRange TrellisPath::GetTargetWordsRange(const Hypothesis &hypo) const
 {
   size_t startPos = 0;
 
-  for (int indEdge = (int) m_path.size() - 1 ; indEdge >= 0 ; --indEdge) {
-    const Hypothesis *currHypo = m_path[indEdge];
+  const std::vector<const Hypothesis *> &edges = GetEdges();
+  for (int indEdge = (int) edges.size() - 1 ; indEdge >= 0 ; --indEdge) {
+    const Hypothesis *currHypo = edges[indEdge];
     size_t endPos = startPos + currHypo->GetCurrTargetLength() - 1;
 
     if (currHypo == &hypo) {
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <iostream>
 #include <vector>
 #include <limits>
+#include <boost/shared_ptr.hpp>
 #include "Hypothesis.h"
 #include "TypeDef.h"
 
@@ -38,6 +39,12 @@ class TrellisPathList;
  *	to reach a final translation. For the best translation, this consist of all hypotheses, for the other
  *	n-best paths, the node on the path can consist of hypotheses or arcs.
  *  Used by phrase-based decoding
+ *
+ *  A path is kept as the arcs where it deviates from the best path back
+ *  from its last hypothesis; the rest follows the back pointers of the
+ *  hypotheses, which all paths share. The list of edges and the score
+ *  breakdown are only made for the paths that are asked for them, most
+ *  contenders for an n-best list are pruned without.
  */
 class TrellisPath
 {
@@ -45,18 +52,31 @@ class TrellisPath
   friend class Manager;
 
 protected:
-  std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
+  //! (edge index, arc used instead of the hypothesis there), by index
+  typedef std::vector<std::pair<size_t, const Hypothesis*> > Deviations;
+
+  const Hypothesis *m_root; //< the first edge, unless a deviation replaces it
+  Deviations m_deviations;
   size_t		m_prevEdgeChanged; /**< the last node that was wiggled to create this path
 																	, or NOT_FOUND if this path is the best trans so consist of only hypos
 															 */
 
-  ScoreComponentCollection	m_scoreBreakdown;
   float m_totalScore;
 
+  mutable std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs, empty until needed
+  mutable boost::shared_ptr<const ScoreComponentCollection> m_scoreBreakdown;
+
   //Used by Manager::LatticeSample()
   explicit TrellisPath(const std::vector<const Hypothesis*> edges);
 
-  void InitScore();
+  //! the first edge; dev is the index of the next deviation to apply
+  const Hypothesis *GetFirstEdge(size_t &dev) const;
+  //! the edge after edge, which is at pos
+  const Hypothesis *GetNextEdge(const Hypothesis *edge, size_t pos, size_t &dev) const;
+
+  float CalcTotalScore() const;
+
+  template <class Coll> void AddDeviantPaths(Coll &pathColl) const;
 
 public:
   TrellisPath(); // not implemented
@@ -77,12 +97,10 @@ public:
   /** list of each hypo/arcs in path. For anything other than the best hypo, it is not possible just to follow the
   	* m_prevHypo variable in the hypothesis object
   	*/
-  inline const std::vector<const Hypothesis *> &GetEdges() const {
-    return m_path;
-  }
+  const std::vector<const Hypothesis *> &GetEdges() const;
 
   inline size_t GetSize() const {
-    return m_path.size();
+    return GetEdges().size();
   }
 
   //! create a set of next best paths by wiggling 1 of the node at a time.
@@ -91,9 +109,7 @@ public:
   //! create a list of next best paths by wiggling 1 of the node at a time.
   void CreateDeviantPaths(TrellisPathList &pathColl) const;
 
-  inline const ScoreComponentCollection &GetScoreBreakdown() const {
-    return m_scoreBreakdown;
-  }
+  const ScoreComponentCollection &GetScoreBreakdown() const;
 
   //! get target words range of the hypo within n-best trellis. not necessarily the same as hypo.GetCurrTargetWordsRange()
   WordsRange GetTargetWordsRange(const Hypothesis &hypo) const;
@@ -108,9 +124,9 @@ public:
 // friend
 inline std::ostream& operator<<(std::ostream& out, const TrellisPath& path)
 {
-  const size_t sizePath = path.m_path.size();
-  for (int pos = (int) sizePath - 1 ; pos >= 0 ; pos--) {
-    const Hypothesis *edge = path.m_path[pos];
+  const std::vector<const Hypothesis *> &edges = path.GetEdges();
+  for (int pos = (int) edges.size() - 1 ; pos >= 0 ; pos--) {
+    const Hypothesis *edge = edges[pos];
     const WordsRange &sourceRange = edge->GetCurrSourceWordsRange();
     out << edge->GetId() << " " << sourceRange.GetStartPos() << "-" << sourceRange.GetEndPos() << ", ";
   }
@@ -0,0 +1,56 @@
+// -*- c++ -*-
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "FactorCollection.h"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** Maps terminal factors to the ids of a model's own vocabulary through a
+ *  table indexed by Factor::GetId(), which is the decoder's dense id of a
+ *  word. The table is filled once at load time, creating the factors of
+ *  all words of the model, so that lookups during decoding neither build
+ *  strings nor hash them. Words the model doesn't know map to the unknown
+ *  id given to the constructor, as do non-terminals and factors created
+ *  after loading.
+ *  Read-only after loading, so threads share it without locks.
+ */
+template <class Id> class VocabRemap
+{
+public:
+  explicit VocabRemap(Id unknown = Id()) : m_unknown(unknown) {}
+
+  //! the first id given to a word wins
+  void Add(const StringPiece &word, Id id) {
+    size_t index = FactorCollection::Instance().AddFactor(word)->GetId() - moses_MaxNumNonterminals;
+    if (index >= m_ids.size()) {
+      m_ids.resize(index + 1, m_unknown);
+    }
+    if (m_ids[index] == m_unknown) {
+      m_ids[index] = id;
+    }
+  }
+
+  Id Lookup(const Factor *factor) const {
+    size_t index = factor->GetId() - moses_MaxNumNonterminals;
+    return index < m_ids.size() ? m_ids[index] : m_unknown;
+  }
+
+  bool Empty() const {
+    return m_ids.empty();
+  }
+
+  Id GetUnknown() const {
+    return m_unknown;
+  }
+
+private:
+  std::vector<Id> m_ids;
+  Id m_unknown;
+};
+
+}
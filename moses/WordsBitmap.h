@@ -28,6 +28,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "WordsRange.h"
 
@@ -36,72 +38,140 @@ namespace Moses
 typedef unsigned long WordsBitmapID;
 
 /** vector of boolean used to represent whether a word has been translated or not
+ *
+ * The coverage is stored as a bit vector of 64-bit blocks. Inputs of up to
+ * 256 words use inline storage, so that creating or copying a bitmap does
+ * not allocate; only longer inputs fall back to the heap. Unused bits of the
+ * last block are always zero, so blocks can be compared and hashed directly.
 */
 class WordsBitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap);
+public:
+  typedef uint64_t Block;
+  static const size_t BLOCK_BITS = 64;
+  static const size_t INLINE_BLOCKS = 4; //!< inputs up to 256 words are stored inline
+
 protected:
   const size_t m_size; /**< number of words in sentence */
-  bool	*m_bitmap;	/**< ticks of words that have been done */
+  const size_t m_numBlocks; /**< number of blocks in use */
+  Block *m_bitmap;	/**< ticks of words that have been done. points to m_inline for short inputs */
+  Block m_inline[INLINE_BLOCKS];
+  mutable size_t m_hash; /**< cached hash of the bitmap, 0 if not computed yet */
 
   WordsBitmap(); // not implemented
+  WordsBitmap &operator=(const WordsBitmap &); // not implemented
+
+  static size_t NumBlocks(size_t size) {
+    return (size + BLOCK_BITS - 1) / BLOCK_BITS;
+  }
+
+  static size_t PopCount(Block b) {
+#ifdef __GNUC__
+    return __builtin_popcountll(b);
+#else
+    size_t ret = 0;
+    for (; b; b &= b - 1) ++ret;
+    return ret;
+#endif
+  }
+
+  //! index of the lowest set bit, b must not be 0
+  static size_t LowestBit(Block b) {
+#ifdef __GNUC__
+    return __builtin_ctzll(b);
+#else
+    size_t ret = 0;
+    for (; !(b & 1); b >>= 1) ++ret;
+    return ret;
+#endif
+  }
+
+  //! index of the highest set bit, b must not be 0
+  static size_t HighestBit(Block b) {
+#ifdef __GNUC__
+    return BLOCK_BITS - 1 - __builtin_clzll(b);
+#else
+    size_t ret = 0;
+    for (; b >>= 1; ) ++ret;
+    return ret;
+#endif
+  }
+
+  //! mask of the bits in use in block i
+  Block UsedMask(size_t i) const {
+    size_t rest = m_size - i * BLOCK_BITS;
+    return rest >= BLOCK_BITS ? ~Block(0) : ((Block(1) << rest) - 1);
+  }
+
+  //! mask of bits [start, end] within one block, 0 <= start <= end < 64
+  static Block RangeMask(size_t start, size_t end) {
+    Block upper = (end + 1 == BLOCK_BITS) ? ~Block(0) : ((Block(1) << (end + 1)) - 1);
+    return upper & ~((Block(1) << start) - 1);
+  }
+
+  void Allocate() {
+    m_bitmap = (m_numBlocks <= INLINE_BLOCKS)
+               ? m_inline : (Block*) malloc(sizeof(Block) * m_numBlocks);
+  }
 
   //! set all elements to false
   void Initialize() {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      m_bitmap[pos] = false;
-    }
+    std::memset(m_bitmap, 0, sizeof(Block) * m_numBlocks);
+    m_hash = 0;
   }
 
   //sets elements by vector
-  void Initialize(std::vector<bool> vector) {
-    size_t vector_size = vector.size();
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (pos < vector_size && vector[pos] == true) m_bitmap[pos] = true;
-      else m_bitmap[pos] = false;
+  void Initialize(const std::vector<bool> &vector) {
+    Initialize();
+    size_t end = std::min(vector.size(), m_size);
+    for (size_t pos = 0 ; pos < end ; pos++) {
+      if (vector[pos]) SetValue(pos, true);
     }
   }
 
 
 public:
   //! create WordsBitmap of length size and initialise with vector
-  WordsBitmap(size_t size, std::vector<bool> initialize_vector)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+  WordsBitmap(size_t size, const std::vector<bool> &initialize_vector)
+    :m_size	(size)
+    ,m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize(initialize_vector);
   }
   //! create WordsBitmap of length size and initialise
   WordsBitmap(size_t size)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size)
+    ,m_numBlocks(NumBlocks(size)) {
+    Allocate();
     Initialize();
   }
   //! deep copy
   WordsBitmap(const WordsBitmap &copy)
-    :m_size	(copy.m_size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * m_size);
-    for (size_t pos = 0 ; pos < copy.m_size ; pos++) {
-      m_bitmap[pos] = copy.GetValue(pos);
-    }
+    :m_size	(copy.m_size)
+    ,m_numBlocks(copy.m_numBlocks)
+    ,m_hash(copy.m_hash) {
+    Allocate();
+    std::memcpy(m_bitmap, copy.m_bitmap, sizeof(Block) * m_numBlocks);
   }
   ~WordsBitmap() {
-    free(m_bitmap);
+    if (m_bitmap != m_inline) free(m_bitmap);
   }
   //! count of words translated
   size_t GetNumWordsCovered() const {
     size_t count = 0;
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (m_bitmap[pos])
-        count++;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      count += PopCount(m_bitmap[i]);
     }
     return count;
   }
 
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      Block gaps = ~m_bitmap[i] & UsedMask(i);
+      if (gaps) {
+        return i * BLOCK_BITS + LowestBit(gaps);
       }
     }
     // no starting pos
@@ -109,11 +179,61 @@ public:
   }
 
 
+  //! position of 1st word not yet translated at or after pos, or NOT_FOUND
+  size_t GetFirstGapPos(size_t pos) const {
+    for (size_t i = pos / BLOCK_BITS ; i < m_numBlocks ; i++) {
+      Block gaps = ~m_bitmap[i] & UsedMask(i);
+      if (i == pos / BLOCK_BITS) gaps &= ~Block(0) << (pos % BLOCK_BITS);
+      if (gaps) {
+        return i * BLOCK_BITS + LowestBit(gaps);
+      }
+    }
+    return NOT_FOUND;
+  }
+
+  //! position of 1st word not yet translated at or after pos that is set
+  //! in allowed, a bitmap of the same size, or NOT_FOUND
+  size_t GetFirstGapPos(size_t pos, const WordsBitmap &allowed) const {
+    for (size_t i = pos / BLOCK_BITS ; i < m_numBlocks ; i++) {
+      Block gaps = ~m_bitmap[i] & allowed.m_bitmap[i] & UsedMask(i);
+      if (i == pos / BLOCK_BITS) gaps &= ~Block(0) << (pos % BLOCK_BITS);
+      if (gaps) {
+        return i * BLOCK_BITS + LowestBit(gaps);
+      }
+    }
+    return NOT_FOUND;
+  }
+
+  //! position of 1st translated word at or after pos, or NOT_FOUND
+  size_t GetFirstCoveredPos(size_t pos) const {
+    for (size_t i = pos / BLOCK_BITS ; i < m_numBlocks ; i++) {
+      Block covered = m_bitmap[i];
+      if (i == pos / BLOCK_BITS) covered &= ~Block(0) << (pos % BLOCK_BITS);
+      if (covered) {
+        return i * BLOCK_BITS + LowestBit(covered);
+      }
+    }
+    return NOT_FOUND;
+  }
+
+  //! count of words translated between 2 positions, inclusive
+  size_t GetNumWordsCovered(size_t startPos, size_t endPos) const {
+    if (endPos < startPos) return 0;
+    size_t count = 0;
+    size_t first = startPos / BLOCK_BITS, last = endPos / BLOCK_BITS;
+    for (size_t i = first; i <= last; ++i) {
+      count += PopCount(m_bitmap[i] & RangeMask(i == first ? startPos % BLOCK_BITS : 0,
+                                                 i == last ? endPos % BLOCK_BITS : BLOCK_BITS - 1));
+    }
+    return count;
+  }
+
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i-- > 0 ; ) {
+      Block gaps = ~m_bitmap[i] & UsedMask(i);
+      if (gaps) {
+        return i * BLOCK_BITS + HighestBit(gaps);
       }
     }
     // no starting pos
@@ -123,9 +243,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i-- > 0 ; ) {
+      if (m_bitmap[i]) {
+        return i * BLOCK_BITS + HighestBit(m_bitmap[i]);
       }
     }
     // no starting pos
@@ -136,17 +256,27 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return m_bitmap[pos];
+    return (m_bitmap[pos / BLOCK_BITS] >> (pos % BLOCK_BITS)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    m_bitmap[pos] = value;
+    Block bit = Block(1) << (pos % BLOCK_BITS);
+    if (value) m_bitmap[pos / BLOCK_BITS] |= bit;
+    else m_bitmap[pos / BLOCK_BITS] &= ~bit;
+    m_hash = 0;
   }
   //! set value between 2 positions, inclusive
   void
   SetValue( size_t startPos, size_t endPos, bool value ) {
-    for(size_t pos = startPos ; pos <= endPos ; pos++)
-      m_bitmap[pos] = value;
+    if (endPos < startPos) return;
+    size_t first = startPos / BLOCK_BITS, last = endPos / BLOCK_BITS;
+    for (size_t i = first; i <= last; ++i) {
+      Block mask = RangeMask(i == first ? startPos % BLOCK_BITS : 0,
+                             i == last ? endPos % BLOCK_BITS : BLOCK_BITS - 1);
+      if (value) m_bitmap[i] |= mask;
+      else m_bitmap[i] &= ~mask;
+    }
+    m_hash = 0;
   }
 
   void
@@ -160,8 +290,13 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const WordsRange &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos(), endPos = compare.GetEndPos();
+    if (endPos < startPos) return false;
+    size_t first = startPos / BLOCK_BITS, last = endPos / BLOCK_BITS;
+    for (size_t i = first; i <= last; ++i) {
+      Block mask = RangeMask(i == first ? startPos % BLOCK_BITS : 0,
+                             i == last ? endPos % BLOCK_BITS : BLOCK_BITS - 1);
+      if (m_bitmap[i] & mask)
         return true;
     }
     return false;
@@ -183,16 +318,40 @@ public:
     if (thisSize != compareSize) {
       return (thisSize < compareSize) ? -1 : 1;
     }
-    return std::memcmp(m_bitmap, compare.m_bitmap, thisSize * sizeof(bool));
+    for (size_t i = 0; i < m_numBlocks; ++i) {
+      if (m_bitmap[i] != compare.m_bitmap[i]) {
+        return (m_bitmap[i] < compare.m_bitmap[i]) ? -1 : 1;
+      }
+    }
+    return 0;
   }
 
   bool operator< (const WordsBitmap &compare) const {
     return Compare(compare) < 0;
   }
 
+  bool operator== (const WordsBitmap &compare) const {
+    if (m_size != compare.m_size) return false;
+    if (m_hash && compare.m_hash && m_hash != compare.m_hash) return false;
+    return std::memcmp(m_bitmap, compare.m_bitmap, sizeof(Block) * m_numBlocks) == 0;
+  }
+
+  //! hash of size and coverage, computed once and cached until the bitmap changes
+  size_t hash() const {
+    if (m_hash == 0) {
+      size_t seed = m_size;
+      for (size_t i = 0; i < m_numBlocks; ++i) {
+        // boost::hash_combine
+        seed ^= (size_t) (m_bitmap[i] ^ (m_bitmap[i] >> 32)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      }
+      m_hash = seed ? seed : 1;
+    }
+    return m_hash;
+  }
+
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
+    while (l && !GetValue(l-1)) {
       --l;
     }
     return l;
@@ -200,7 +359,7 @@ public:
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
     if (r+1 == m_size) return r;
-    while (r+1 < m_size && !m_bitmap[r+1]) {
+    while (r+1 < m_size && !GetValue(r+1)) {
       ++r;
     }
     return r;
@@ -254,6 +413,11 @@ public:
   TO_STRING();
 };
 
+inline size_t hash_value(const WordsBitmap &bitmap)
+{
+  return bitmap.hash();
+}
+
 // friend
 inline std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap)
 {
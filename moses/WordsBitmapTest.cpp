@@ -0,0 +1,125 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include "WordsBitmap.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(words_bitmap)
+
+BOOST_AUTO_TEST_CASE(gaps_short)
+{
+  WordsBitmap bitmap(10);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), 0);
+  BOOST_CHECK_EQUAL(bitmap.GetLastGapPos(), 9);
+  BOOST_CHECK_EQUAL(bitmap.GetLastPos(), NOT_FOUND);
+
+  bitmap.SetValue(0, 2, true);
+  bitmap.SetValue(9, true);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(), 4);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), 3);
+  BOOST_CHECK_EQUAL(bitmap.GetLastGapPos(), 8);
+  BOOST_CHECK_EQUAL(bitmap.GetLastPos(), 9);
+  BOOST_CHECK(bitmap.Overlap(WordsRange(2,4)));
+  BOOST_CHECK(!bitmap.Overlap(WordsRange(3,8)));
+
+  bitmap.SetValue(3, 8, true);
+  BOOST_CHECK(bitmap.IsComplete());
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), NOT_FOUND);
+  BOOST_CHECK_EQUAL(bitmap.GetLastGapPos(), NOT_FOUND);
+}
+
+BOOST_AUTO_TEST_CASE(gaps_across_blocks)
+{
+  // longer than the inline storage
+  WordsBitmap bitmap(300);
+  bitmap.SetValue(0, 199, true);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(), 200);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), 200);
+  BOOST_CHECK_EQUAL(bitmap.GetLastPos(), 199);
+  BOOST_CHECK(bitmap.Overlap(WordsRange(60,70)));
+  BOOST_CHECK(!bitmap.Overlap(WordsRange(200,299)));
+
+  bitmap.SetValue(63, 130, false);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), 63);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(), 200 - 68);
+  BOOST_CHECK(bitmap.GetValue(62));
+  BOOST_CHECK(!bitmap.GetValue(63));
+  BOOST_CHECK(!bitmap.GetValue(130));
+  BOOST_CHECK(bitmap.GetValue(131));
+
+  WordsBitmap copy(bitmap);
+  BOOST_CHECK(copy == bitmap);
+  BOOST_CHECK_EQUAL(copy.Compare(bitmap), 0);
+  BOOST_CHECK_EQUAL(hash_value(copy), hash_value(bitmap));
+  copy.SetValue(299, true);
+  BOOST_CHECK(!(copy == bitmap));
+  BOOST_CHECK(copy.Compare(bitmap) != 0);
+  BOOST_CHECK_EQUAL(copy.GetLastPos(), 299);
+}
+
+BOOST_AUTO_TEST_CASE(range_scans)
+{
+  WordsBitmap bitmap(150);
+  bitmap.SetValue(10, 69, true);
+  bitmap.SetValue(128, 140, true);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(0), 0);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(10), 70);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(128), 141);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(150), NOT_FOUND);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstCoveredPos(0), 10);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstCoveredPos(70), 128);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstCoveredPos(141), NOT_FOUND);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(0, 149), 73);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(60, 130), 13);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(70, 127), 0);
+
+  bitmap.SetValue(141, 149, true);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(128), NOT_FOUND);
+}
+
+BOOST_AUTO_TEST_CASE(masked_gaps)
+{
+  WordsBitmap bitmap(150), allowed(150);
+  bitmap.SetValue(10, 69, true);
+  allowed.SetValue(5, 80, true);
+  allowed.SetValue(140, true);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(0, allowed), 5);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(10, allowed), 70);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(81, allowed), 140);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(141, allowed), NOT_FOUND);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(150, allowed), NOT_FOUND);
+}
+
+BOOST_AUTO_TEST_CASE(initialize_from_vector)
+{
+  vector<bool> init(5, false);
+  init[1] = true;
+  init[4] = true;
+  WordsBitmap bitmap(70, init);
+  BOOST_CHECK_EQUAL(bitmap.GetNumWordsCovered(), 2);
+  BOOST_CHECK_EQUAL(bitmap.GetFirstGapPos(), 0);
+  BOOST_CHECK_EQUAL(bitmap.GetLastPos(), 4);
+  BOOST_CHECK_EQUAL(bitmap.GetLastGapPos(), 69);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
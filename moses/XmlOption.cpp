@@ -99,6 +99,19 @@ bool isXmlTag(const string& tag, const std::string& lbrackStr, const std::string
            (tag[lbrackStr.length()] >= 'A' && tag[lbrackStr.length()] <= 'Z')));
 }
 
+//! number of words in str, as Tokenize(str).size() but without copying them
+static size_t CountWords(const string& str)
+{
+  size_t count = 0;
+  bool inWord = false;
+  for (size_t i = 0; i < str.size(); ++i) {
+    bool isDelimiter = (str[i] == ' ' || str[i] == '\t');
+    if (!isDelimiter && !inWord) ++count;
+    inWord = !isDelimiter;
+  }
+  return count;
+}
+
 /**
  * Split up the input character string into tokens made up of
  * either XML tags or text.
@@ -206,7 +219,8 @@ bool ProcessAndStripXMLTags(string &line, vector<XmlOption*> &res, ReorderingCon
         cleanLine += " ";
       }
       cleanLine += xmlTokens[xmlTokenPos]; // add to output
-      wordPos = Tokenize(cleanLine).size(); // count all the words
+      // words never join across the boundary, so count the new ones only
+      wordPos += CountWords(xmlTokens[xmlTokenPos]);
     }
 
     // process xml tag
@@ -12,6 +12,7 @@
 #include "moses/TrellisPath.h"
 #include "moses/StaticData.h"
 #include "moses/Util.h"
+#include "moses/ThreadPool.h"
 #include "mbr.h"
 
 using namespace std ;
@@ -35,21 +36,18 @@ using namespace Moses;
 int BLEU_ORDER = 4;
 int SMOOTH = 1;
 float min_interval = 1e-4;
-void extract_ngrams(const vector<const Factor* >& sentence, map < vector < const Factor* >, int >  & allngrams)
+void extract_ngrams(const vector<const Factor* >& sentence, NgramCounts & allngrams)
 {
   vector< const Factor* > ngram;
   for (int k = 0; k < BLEU_ORDER; k++) {
     for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      for ( int j = i; j<= i+k; j++) {
-        ngram.push_back(sentence[j]);
-      }
+      ngram.assign(sentence.begin() + i, sentence.begin() + i + k + 1);
       ++allngrams[ngram];
-      ngram.clear();
     }
   }
 }
 
-float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp,  vector < map < vector < const Factor *>, int > > & ngram_stats )
+float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp, const vector<NgramCounts> & ngram_stats )
 {
   int comps_n = 2*BLEU_ORDER+1;
   vector<int> comps(comps_n);
@@ -62,12 +60,12 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
     comps[2*i+1] = max(hyp_length-i,0);
   }
 
-  map< vector < const Factor * > ,int > & hyp_ngrams = ngram_stats[hyp] ;
-  map< vector < const Factor * >, int > & ref_ngrams = ngram_stats[ref] ;
+  const NgramCounts & hyp_ngrams = ngram_stats[hyp] ;
+  const NgramCounts & ref_ngrams = ngram_stats[ref] ;
 
-  for (map< vector< const Factor * >, int >::iterator it = hyp_ngrams.begin();
+  for (NgramCounts::const_iterator it = hyp_ngrams.begin();
        it != hyp_ngrams.end(); it++) {
-    map< vector< const Factor * >, int >::iterator ref_it = ref_ngrams.find(it->first);
+    NgramCounts::const_iterator ref_it = ref_ngrams.find(it->first);
     if(ref_it != ref_ngrams.end()) {
       comps[2* (it->first.size()-1)] += min(ref_it->second,it->second);
     }
@@ -89,6 +87,55 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
   return exp(logbleu);
 }
 
+namespace
+{
+//! Expected loss of candidates [begin, end), keeping the lowest. A candidate
+//! is dropped as soon as its loss exceeds the lowest one found so far.
+class MBRLossTask : public Task
+{
+public:
+  MBRLossTask(const vector< vector<const Factor*> > &translations,
+              const vector<NgramCounts> &ngramStats,
+              const vector<float> &posteriors, size_t begin, size_t end)
+    : m_translations(translations), m_ngramStats(ngramStats)
+    , m_posteriors(posteriors), m_begin(begin), m_end(end)
+    , m_minLoss(1000000), m_minIdx(-1) {}
+
+  void Run() {
+    for (size_t i = m_begin; i < m_end; i++) {
+      float weightedLossCumul = 0;
+      for (size_t j = 0; j < m_translations.size(); j++) {
+        if ( i != j) {
+          float bleu = calculate_score(m_translations, j, i, m_ngramStats);
+          weightedLossCumul += ( 1 - bleu) * m_posteriors[j];
+          if (weightedLossCumul > m_minLoss)
+            break;
+        }
+      }
+      if (weightedLossCumul < m_minLoss) {
+        m_minLoss = weightedLossCumul;
+        m_minIdx = i;
+      }
+    }
+  }
+
+  float GetMinLoss() const {
+    return m_minLoss;
+  }
+  int GetMinIdx() const {
+    return m_minIdx;
+  }
+
+private:
+  const vector< vector<const Factor*> > &m_translations;
+  const vector<NgramCounts> &m_ngramStats;
+  const vector<float> &m_posteriors;
+  size_t m_begin, m_end;
+  float m_minLoss;
+  int m_minIdx;
+};
+}
+
 const TrellisPath doMBR(const TrellisPathList& nBestList)
 {
   float marginal = 0;
@@ -96,7 +143,7 @@ const TrellisPath doMBR(const TrellisPathList& nBestList)
   vector<float> joint_prob_vec;
   vector< vector<const Factor*> > translations;
   float joint_prob;
-  vector< map < vector <const Factor *>, int > > ngram_stats;
+  vector<NgramCounts> ngram_stats;
 
   TrellisPathList::const_iterator iter;
 
@@ -109,6 +156,8 @@ const TrellisPath doMBR(const TrellisPathList& nBestList)
     if (maxScore < score) maxScore = score;
   }
 
+  ngram_stats.reserve(nBestList.GetSize());
+  translations.reserve(nBestList.GetSize());
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     joint_prob = UntransformScore(StaticData::Instance().GetMBRScale() * path.GetScoreBreakdown().GetWeightedScore() - maxScore);
@@ -116,41 +165,49 @@ const TrellisPath doMBR(const TrellisPathList& nBestList)
     joint_prob_vec.push_back(joint_prob);
 
     // get words in translation
-    vector<const Factor*> translation;
-    GetOutputFactors(path, translation);
+    translations.push_back(vector<const Factor*>());
+    GetOutputFactors(path, translations.back());
 
     // collect n-gram counts
-    map < vector < const Factor *>, int > counts;
-    extract_ngrams(translation,counts);
+    ngram_stats.push_back(NgramCounts());
+    extract_ngrams(translations.back(), ngram_stats.back());
+  }
+  for (size_t j = 0; j < joint_prob_vec.size(); ++j) {
+    joint_prob_vec[j] /= marginal;
+  }
 
-    ngram_stats.push_back(counts);
-    translations.push_back(translation);
+  /* Main MBR computation done here, on slices of the candidates in
+     parallel with -search-threads. Taking the first of the slices' minima
+     gives the same candidate as a single pass. */
+  const size_t size = nBestList.GetSize();
+  size_t numTasks = 1;
+#ifdef WITH_THREADS
+  numTasks = std::max<size_t>(1, std::min(StaticData::Instance().GetSearchThreads(), size / 16));
+#endif
+  vector<boost::shared_ptr<MBRLossTask> > tasks;
+  for (size_t t = 0; t < numTasks; ++t) {
+    tasks.push_back(boost::shared_ptr<MBRLossTask>(
+                      new MBRLossTask(translations, ngram_stats, joint_prob_vec,
+                                      size * t / numTasks, size * (t + 1) / numTasks)));
   }
+#ifdef WITH_THREADS
+  if (numTasks > 1) {
+    ThreadPool pool(numTasks);
+    for (size_t t = 0; t < numTasks; ++t) {
+      pool.Submit(tasks[t]);
+    }
+    pool.Stop(true);
+  } else
+#endif
+    tasks[0]->Run();
 
-  vector<float> mbr_loss;
-  float bleu, weightedLoss;
-  float weightedLossCumul = 0;
   float minMBRLoss = 1000000;
   int minMBRLossIdx = -1;
-
-  /* Main MBR computation done here */
-  iter = nBestList.begin();
-  for (unsigned int i = 0; i < nBestList.GetSize(); i++) {
-    weightedLossCumul = 0;
-    for (unsigned int j = 0; j < nBestList.GetSize(); j++) {
-      if ( i != j) {
-        bleu = calculate_score(translations, j, i,ngram_stats );
-        weightedLoss = ( 1 - bleu) * ( joint_prob_vec[j]/marginal);
-        weightedLossCumul += weightedLoss;
-        if (weightedLossCumul > minMBRLoss)
-          break;
-      }
-    }
-    if (weightedLossCumul < minMBRLoss) {
-      minMBRLoss = weightedLossCumul;
-      minMBRLossIdx = i;
+  for (size_t t = 0; t < numTasks; ++t) {
+    if (tasks[t]->GetMinIdx() != -1 && tasks[t]->GetMinLoss() < minMBRLoss) {
+      minMBRLoss = tasks[t]->GetMinLoss();
+      minMBRLossIdx = tasks[t]->GetMinIdx();
     }
-    iter++;
   }
   /* Find sentence that minimises Bayes Risk under 1- BLEU loss */
   return nBestList.at(minMBRLossIdx);
@@ -22,7 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_cmd_mbr_h
 #define moses_cmd_mbr_h
 
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+//! n-gram counts of one translation
+typedef boost::unordered_map<std::vector<const Moses::Factor*>, int> NgramCounts;
+
 const Moses::TrellisPath doMBR(const Moses::TrellisPathList& nBestList);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <const Moses::Factor*> &translation);
-float calculate_score(const std::vector< std::vector<const Moses::Factor*> > & sents, int ref, int hyp,  std::vector < std::map < std::vector < const Moses::Factor *>, int > > & ngram_stats );
+float calculate_score(const std::vector< std::vector<const Moses::Factor*> > & sents, int ref, int hyp, const std::vector<NgramCounts> & ngram_stats );
 #endif
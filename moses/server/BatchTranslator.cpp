@@ -0,0 +1,84 @@
+#include "BatchTranslator.h"
+#include "TranslationRequest.h"
+
+namespace MosesServer
+{
+
+  using namespace std;
+  using namespace Moses;
+
+  BatchTranslator::
+  BatchTranslator(Translator& translator)
+    : m_translator(translator)
+  {
+    this->_signature = "S:S";
+    this->_help = "Translates an array of segments (\"segments\") in one call";
+  }
+
+  void
+  BatchTranslator::
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP)
+  {
+    typedef std::map<std::string, xmlrpc_c::value> params_t;
+    paramList.verifyEnd(1);
+    params_t const params = paramList.getStruct(0);
+    params_t::const_iterator si = params.find("segments");
+    if (si == params.end())
+      throw xmlrpc_c::fault("Missing segments", xmlrpc_c::fault::CODE_PARSE);
+    vector<xmlrpc_c::value> const segments
+      = xmlrpc_c::value_array(si->second).vectorValueValue();
+
+    params_t defaults = params;
+    defaults.erase("segments");
+    if (defaults.find("priority") == defaults.end())
+      defaults["priority"] = xmlrpc_c::value_int(TranslationRequest::BULK);
+
+    // one condition variable for the whole batch; each request signals
+    // it when it's done
+    boost::condition_variable cond;
+    boost::mutex mut;
+    vector<boost::shared_ptr<TranslationRequest> > tasks(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i)
+      {
+	params_t p = defaults;
+	if (segments[i].type() == xmlrpc_c::value::TYPE_STRING)
+	  p["text"] = segments[i];
+	else
+	  {
+	    params_t const s = xmlrpc_c::value_struct(segments[i]);
+	    for (params_t::const_iterator m = s.begin(); m != s.end(); ++m)
+	      p[m->first] = m->second;
+	  }
+	tasks[i] = TranslationRequest::create(p, cond, mut);
+      }
+
+    // keep at most one segment per decoder thread in the queue; submit
+    // the next one whenever one finishes
+    size_t const window = max(size_t(1), m_translator.GetNumThreads());
+    size_t submitted = 0, finished = 0;
+    while (finished < tasks.size())
+      {
+	while (submitted < tasks.size() && submitted - finished < window)
+	  m_translator.Schedule(tasks[submitted++]);
+	boost::unique_lock<boost::mutex> lock(mut);
+	while (true)
+	  {
+	    size_t done = 0;
+	    for (size_t i = 0; i < submitted; ++i)
+	      if (tasks[i]->IsDone()) ++done;
+	    if (done > finished) { finished = done; break; }
+	    cond.wait(lock);
+	  }
+      }
+
+    vector<xmlrpc_c::value> results;
+    results.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i)
+      results.push_back(xmlrpc_c::value_struct(tasks[i]->GetRetData()));
+    params_t ret;
+    ret["results"] = xmlrpc_c::value_array(results);
+    *retvalP = xmlrpc_c::value_struct(ret);
+  }
+
+}
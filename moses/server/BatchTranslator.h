@@ -0,0 +1,36 @@
+// -*- c++ -*-
+#pragma once
+
+#include "Translator.h"
+#include <xmlrpc-c/base.hpp>
+#include <xmlrpc-c/registry.hpp>
+#include <xmlrpc-c/server_abyss.hpp>
+
+namespace MosesServer
+{
+  // Translates many segments with one RPC. The request is a struct
+  // with an array "segments"; each element is either a string (the
+  // text) or a struct with the same parameters as a "translate"
+  // request. All other members of the top-level struct are defaults
+  // for every segment. The response is a struct with an array
+  // "results" of the "translate" responses, in input order; segments
+  // that were dropped (see Translator) have a member "error" instead.
+  //
+  // The segments are scheduled by the Translator, in the bulk priority
+  // class unless a "priority" is given, and no more than one per
+  // decoder thread is queued at any time, so that a large batch does
+  // not shut out single requests of the same class either.
+  class
+  // MosesServer::
+  BatchTranslator : public xmlrpc_c::method
+  {
+  public:
+    BatchTranslator(Translator& translator);
+
+    void execute(xmlrpc_c::paramList const& paramList,
+		 xmlrpc_c::value *   const  retvalP);
+  private:
+    Translator& m_translator;
+  };
+
+}
@@ -0,0 +1,493 @@
+#include "BinaryServer.h"
+#include "TranslationRequest.h"
+#include "util/exception.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <boost/bind.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace MosesServer
+{
+  using namespace std;
+
+  namespace
+  {
+    typedef std::map<std::string, xmlrpc_c::value> params_t;
+
+    // larger frames are taken for garbage and close the connection
+    size_t const kMaxFrame = size_t(1) << 26;
+    // stop reading from a client that doesn't read its responses
+    size_t const kMaxPendingOutput = size_t(1) << 22;
+    // of arrays and structs within each other
+    size_t const kMaxDepth = 64;
+
+    void
+    put_uint32(string& out, uint32_t x)
+    {
+      char b[4] = { char(x >> 24), char(x >> 16), char(x >> 8), char(x) };
+      out.append(b, 4);
+    }
+
+    void
+    put_uint64(string& out, uint64_t x)
+    {
+      put_uint32(out, uint32_t(x >> 32));
+      put_uint32(out, uint32_t(x));
+    }
+
+    void
+    put_string(string& out, string const& s)
+    {
+      put_uint32(out, s.size());
+      out += s;
+    }
+
+    uint32_t
+    get_uint32(char const* p)
+    {
+      unsigned char const* u = reinterpret_cast<unsigned char const*>(p);
+      return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16)
+	| (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+    }
+
+    uint64_t
+    get_uint64(char const* p)
+    {
+      return (uint64_t(get_uint32(p)) << 32) | get_uint32(p + 4);
+    }
+
+    bool
+    get_count(char const* data, size_t size, size_t& pos, uint32_t& n)
+    {
+      if (size - pos < 4) return false;
+      n = get_uint32(data + pos);
+      pos += 4;
+      return true;
+    }
+
+    bool
+    get_string(char const* data, size_t size, size_t& pos, string& s)
+    {
+      uint32_t n;
+      if (!get_count(data, size, pos, n) || size - pos < n) return false;
+      s.assign(data + pos, n);
+      pos += n;
+      return true;
+    }
+
+    bool
+    decode(char const* data, size_t size, size_t& pos,
+	   xmlrpc_c::value& v, size_t depth)
+    {
+      if (pos >= size || depth > kMaxDepth) return false;
+      switch (data[pos++])
+	{
+	case 'n':
+	  v = xmlrpc_c::value_nil();
+	  return true;
+	case 'b':
+	  if (size - pos < 1) return false;
+	  v = xmlrpc_c::value_boolean(data[pos++] != 0);
+	  return true;
+	case 'i':
+	  if (size - pos < 4) return false;
+	  v = xmlrpc_c::value_int(int32_t(get_uint32(data + pos)));
+	  pos += 4;
+	  return true;
+	case 'I':
+	  if (size - pos < 8) return false;
+	  v = xmlrpc_c::value_i8(int64_t(get_uint64(data + pos)));
+	  pos += 8;
+	  return true;
+	case 'd':
+	  {
+	    if (size - pos < 8) return false;
+	    uint64_t bits = get_uint64(data + pos);
+	    double d;
+	    memcpy(&d, &bits, sizeof(d));
+	    v = xmlrpc_c::value_double(d);
+	    pos += 8;
+	    return true;
+	  }
+	case 's':
+	  {
+	    string s;
+	    if (!get_string(data, size, pos, s)) return false;
+	    v = xmlrpc_c::value_string(s);
+	    return true;
+	  }
+	case 'a':
+	  {
+	    uint32_t n;
+	    // every value takes at least a byte
+	    if (!get_count(data, size, pos, n) || n > size - pos) return false;
+	    vector<xmlrpc_c::value> a(n);
+	    for (uint32_t i = 0; i < n; ++i)
+	      if (!decode(data, size, pos, a[i], depth + 1)) return false;
+	    v = xmlrpc_c::value_array(a);
+	    return true;
+	  }
+	case 'm':
+	  {
+	    uint32_t n;
+	    if (!get_count(data, size, pos, n) || n > size - pos) return false;
+	    params_t m;
+	    for (uint32_t i = 0; i < n; ++i)
+	      {
+		string key;
+		if (!get_string(data, size, pos, key)) return false;
+		if (!decode(data, size, pos, m[key], depth + 1)) return false;
+	      }
+	    v = xmlrpc_c::value_struct(m);
+	    return true;
+	  }
+	default:
+	  return false;
+	}
+    }
+
+    void
+    set_non_blocking(int fd)
+    {
+      int flags = fcntl(fd, F_GETFL, 0);
+      UTIL_THROW_IF(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1,
+		    util::ErrnoException, "fcntl failed");
+    }
+
+    int
+    listen_on(int port)
+    {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      UTIL_THROW_IF(fd == -1, util::ErrnoException, "socket failed");
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      struct sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+      UTIL_THROW_IF(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1,
+		    util::ErrnoException, "bind to port " << port << " failed");
+      UTIL_THROW_IF(listen(fd, 64) == -1, util::ErrnoException, "listen failed");
+      set_non_blocking(fd);
+      return fd;
+    }
+
+    // false if the connection should be closed
+    bool
+    write_out(int fd, string& out, size_t& written)
+    {
+      while (written < out.size())
+	{
+	  ssize_t put = write(fd, out.data() + written, out.size() - written);
+	  if (put < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	  written += put;
+	}
+      out.clear();
+      written = 0;
+      return true;
+    }
+  }
+
+  BinaryServer::
+  BinaryServer(Translator& translator, int port)
+    : m_translator(translator), m_listener(listen_on(port))
+    , m_nextConnection(0)
+  {
+    UTIL_THROW_IF(pipe(m_wake) == -1, util::ErrnoException, "pipe failed");
+    set_non_blocking(m_wake[0]);
+    set_non_blocking(m_wake[1]);
+  }
+
+  void
+  BinaryServer::
+  Encode(xmlrpc_c::value const& v, string& out)
+  {
+    switch (v.type())
+      {
+      case xmlrpc_c::value::TYPE_NIL:
+	out += 'n';
+	break;
+      case xmlrpc_c::value::TYPE_BOOLEAN:
+	out += 'b';
+	out += char(bool(xmlrpc_c::value_boolean(v)) ? 1 : 0);
+	break;
+      case xmlrpc_c::value::TYPE_INT:
+	out += 'i';
+	put_uint32(out, uint32_t(int(xmlrpc_c::value_int(v))));
+	break;
+      case xmlrpc_c::value::TYPE_I8:
+	out += 'I';
+	put_uint64(out, uint64_t(xmlrpc_int64(xmlrpc_c::value_i8(v))));
+	break;
+      case xmlrpc_c::value::TYPE_DOUBLE:
+	{
+	  double d = xmlrpc_c::value_double(v);
+	  uint64_t bits;
+	  memcpy(&bits, &d, sizeof(d));
+	  out += 'd';
+	  put_uint64(out, bits);
+	  break;
+	}
+      case xmlrpc_c::value::TYPE_STRING:
+	out += 's';
+	put_string(out, xmlrpc_c::value_string(v));
+	break;
+      case xmlrpc_c::value::TYPE_ARRAY:
+	{
+	  vector<xmlrpc_c::value> const a = xmlrpc_c::value_array(v).vectorValueValue();
+	  out += 'a';
+	  put_uint32(out, a.size());
+	  for (size_t i = 0; i < a.size(); ++i) Encode(a[i], out);
+	  break;
+	}
+      case xmlrpc_c::value::TYPE_STRUCT:
+	{
+	  params_t const m = xmlrpc_c::value_struct(v);
+	  out += 'm';
+	  put_uint32(out, m.size());
+	  for (params_t::const_iterator i = m.begin(); i != m.end(); ++i)
+	    {
+	      put_string(out, i->first);
+	      Encode(i->second, out);
+	    }
+	  break;
+	}
+      default:
+	UTIL_THROW2("No binary form for XML-RPC values of type " << v.type());
+      }
+  }
+
+  bool
+  BinaryServer::
+  Decode(char const* data, size_t size, size_t& pos, xmlrpc_c::value& v)
+  {
+    return decode(data, size, pos, v, 0);
+  }
+
+  void
+  BinaryServer::
+  Respond(Connection& conn, uint32_t id, params_t const& response)
+  {
+    size_t const start = conn.out.size();
+    put_uint32(conn.out, 0); // length, filled in below
+    put_uint32(conn.out, id);
+    try
+      {
+	Encode(xmlrpc_c::value_struct(response), conn.out);
+      }
+    catch (util::Exception const& e)
+      {
+	conn.out.resize(start + 8);
+	params_t error;
+	error["error"] = xmlrpc_c::value_string(e.what());
+	Encode(xmlrpc_c::value_struct(error), conn.out);
+      }
+    uint32_t const len = conn.out.size() - start - 4;
+    string buf;
+    put_uint32(buf, len);
+    conn.out.replace(start, 4, buf);
+  }
+
+  bool
+  BinaryServer::
+  Process(uint64_t connection, Connection& conn)
+  {
+    size_t begin = 0;
+    while (conn.in.size() - begin >= 4)
+      {
+	uint32_t const len = get_uint32(conn.in.data() + begin);
+	if (len < 4 || len > kMaxFrame) return false;
+	if (conn.in.size() - begin - 4 < len) break;
+	char const* frame = conn.in.data() + begin + 4;
+	begin += 4 + len;
+
+	uint32_t const id = get_uint32(frame);
+	size_t pos = 4;
+	xmlrpc_c::value v;
+	if (!Decode(frame, len, pos, v) || pos != len
+	    || v.type() != xmlrpc_c::value::TYPE_STRUCT)
+	  return false;
+	params_t const params = xmlrpc_c::value_struct(v);
+
+	// checked here, as TranslationRequest::Run() would throw on the
+	// decoder thread
+	params_t::const_iterator si = params.find("text");
+	if (si == params.end() || si->second.type() != xmlrpc_c::value::TYPE_STRING)
+	  {
+	    params_t error;
+	    error["error"] = xmlrpc_c::value_string("Missing source text");
+	    Respond(conn, id, error);
+	    continue;
+	  }
+
+	Pending p;
+	p.connection = connection;
+	p.id = id;
+	p.request = TranslationRequest::create(params, m_cond, m_lock);
+	{
+	  boost::lock_guard<boost::mutex> guard(m_lock);
+	  m_pending.push_back(p);
+	}
+	// outside the lock: a request dropped right away is done at once
+	m_translator.Schedule(p.request);
+      }
+    conn.in.erase(0, begin);
+    return true;
+  }
+
+  void
+  BinaryServer::
+  Collect()
+  {
+    // the requests signal m_cond with m_lock held when they are done, so
+    // no notification is missed between the scan and the wait
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    while (true)
+      {
+	size_t kept = 0;
+	bool done = false;
+	for (size_t i = 0; i < m_pending.size(); ++i)
+	  {
+	    if (m_pending[i].request->IsDone())
+	      {
+		m_done.push_back(m_pending[i]);
+		done = true;
+	      }
+	    else m_pending[kept++] = m_pending[i];
+	  }
+	m_pending.resize(kept);
+	if (done)
+	  {
+	    // if the pipe is full, Run() has a wake-up waiting anyway
+	    char c = 0;
+	    if (write(m_wake[1], &c, 1) < 0) { }
+	  }
+	m_cond.wait(lock);
+      }
+  }
+
+  void
+  BinaryServer::
+  Answer()
+  {
+    char buf[256];
+    while (read(m_wake[0], buf, sizeof(buf)) > 0) { }
+    deque<Pending> done;
+    {
+      boost::lock_guard<boost::mutex> guard(m_lock);
+      done.swap(m_done);
+    }
+    for (size_t i = 0; i < done.size(); ++i)
+      {
+	map<uint64_t, Connection>::iterator c = m_connections.find(done[i].connection);
+	// the client may have gone
+	if (c == m_connections.end()) continue;
+	Respond(c->second, done[i].id, done[i].request->GetRetData());
+      }
+  }
+
+  void
+  BinaryServer::
+  Run()
+  {
+    boost::thread collector(boost::bind(&BinaryServer::Collect, this));
+    vector<struct pollfd> fds;
+    vector<uint64_t> ids;
+    while (true)
+      {
+	fds.resize(m_connections.size() + 2);
+	ids.clear();
+	fds[0].fd = m_listener;
+	fds[0].events = POLLIN;
+	fds[1].fd = m_wake[0];
+	fds[1].events = POLLIN;
+	size_t k = 2;
+	for (map<uint64_t, Connection>::iterator c = m_connections.begin();
+	     c != m_connections.end(); ++c, ++k)
+	  {
+	    Connection const& conn = c->second;
+	    fds[k].fd = conn.fd;
+	    fds[k].events = (conn.out.size() > kMaxPendingOutput ? 0 : POLLIN)
+	      | (conn.out.empty() ? 0 : POLLOUT);
+	    fds[k].revents = 0;
+	    ids.push_back(c->first);
+	  }
+	if (poll(&fds[0], fds.size(), -1) == -1)
+	  {
+	    UTIL_THROW_IF(errno != EINTR, util::ErrnoException, "poll failed");
+	    continue;
+	  }
+
+	if (fds[1].revents & POLLIN) Answer();
+
+	for (size_t i = 0; i < ids.size(); ++i)
+	  {
+	    short const revents = fds[i + 2].revents;
+	    Connection& conn = m_connections[ids[i]];
+	    bool keep = true;
+	    if (revents & POLLIN)
+	      {
+		char buf[65536];
+		while (keep && conn.out.size() <= kMaxPendingOutput)
+		  {
+		    ssize_t got = read(conn.fd, buf, sizeof(buf));
+		    if (got > 0)
+		      {
+			conn.in.append(buf, got);
+			keep = Process(ids[i], conn);
+		      }
+		    else
+		      {
+			if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			  keep = false;
+			break;
+		      }
+		  }
+	      }
+	    if (revents & (POLLERR | POLLNVAL)) keep = false;
+	    if ((revents & POLLHUP) && !(revents & POLLIN)) keep = false;
+	    if (!keep)
+	      {
+		close(conn.fd);
+		m_connections.erase(ids[i]);
+	      }
+	  }
+
+	// responses that are ready now go out in one write per connection,
+	// including those just answered
+	for (map<uint64_t, Connection>::iterator c = m_connections.begin();
+	     c != m_connections.end(); )
+	  {
+	    Connection& conn = c->second;
+	    if (!conn.out.empty() && !write_out(conn.fd, conn.out, conn.written))
+	      {
+		close(conn.fd);
+		m_connections.erase(c++);
+	      }
+	    else ++c;
+	  }
+
+	if (fds[0].revents & POLLIN)
+	  {
+	    int fd;
+	    while ((fd = accept(m_listener, NULL, NULL)) != -1)
+	      {
+		set_non_blocking(fd);
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		m_connections[m_nextConnection++] = Connection(fd);
+	      }
+	  }
+      }
+  }
+
+}
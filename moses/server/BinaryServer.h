@@ -0,0 +1,100 @@
+// -*- c++ -*-
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <xmlrpc-c/base.hpp>
+#include "Translator.h"
+
+namespace MosesServer
+{
+  class TranslationRequest;
+
+  // Serves "translate" requests over plain TCP, without XML or HTTP, for
+  // clients that send many short segments (see
+  // scripts/server/moses-binary-client.py). The requests and responses
+  // are the same structs as those of the XML-RPC method and go through
+  // the same Translator queues and TranslationRequest.
+  //
+  // A frame is a 4-byte length of the rest of the frame, a 4-byte
+  // request id chosen by the client and one value, all integers big
+  // endian. A value is a type byte followed by
+  //   'n'  nothing
+  //   'b'  1 byte, 0 or 1
+  //   'i'  a 4-byte signed integer
+  //   'I'  an 8-byte signed integer
+  //   'd'  an 8-byte IEEE double
+  //   's'  a 4-byte length and that many bytes of UTF-8
+  //   'a'  a 4-byte count and that many values
+  //   'm'  a 4-byte count and that many pairs of a key (length and
+  //        bytes, as for 's' without the type byte) and a value.
+  // A request frame holds a struct of the parameters of a "translate"
+  // request; the response frame has the same id and the response
+  // struct, or a struct with "error" if the request was dropped.
+  //
+  // A client can send any number of requests on one connection without
+  // waiting for the responses, which come back as soon as they are done,
+  // not necessarily in order. All connections are served by one thread
+  // with poll(); a second one collects the finished requests.
+  class
+  // MosesServer::
+  BinaryServer
+  {
+  public:
+    // listens on port right away; throws if that fails
+    BinaryServer(Translator& translator, int port);
+
+    // serves until the process ends
+    void Run();
+
+    // appends the binary form of v to out; throws for types without one
+    static void Encode(xmlrpc_c::value const& v, std::string& out);
+
+    // the value at data + pos, advancing pos past it; false if it is
+    // malformed or ends beyond size
+    static bool Decode(char const* data, size_t size, size_t& pos,
+		       xmlrpc_c::value& v);
+
+  private:
+    struct Connection
+    {
+      int fd;
+      std::string in, out;
+      size_t written;
+      Connection(int f = -1) : fd(f), written(0) { }
+    };
+
+    // a request being decoded, and the connection to answer on
+    struct Pending
+    {
+      uint64_t connection;
+      uint32_t id;
+      boost::shared_ptr<TranslationRequest> request;
+    };
+
+    void Collect();
+    bool Process(uint64_t connection, Connection& conn);
+    void Respond(Connection& conn, uint32_t id,
+		 std::map<std::string, xmlrpc_c::value> const& response);
+    void Answer();
+
+    Translator& m_translator;
+    int m_listener;
+    int m_wake[2]; // pipe on which Collect() wakes up Run()
+
+    std::map<uint64_t, Connection> m_connections;
+    uint64_t m_nextConnection;
+
+    // shared by all requests of the server, they notify it when done
+    boost::mutex m_lock;
+    boost::condition_variable m_cond;
+    std::vector<Pending> m_pending;
+    std::deque<Pending> m_done;
+  };
+
+}
@@ -0,0 +1,33 @@
+#include "Metrics.h"
+#include "moses/DecodeProfile.h"
+#include "moses/MemoryReport.h"
+
+namespace MosesServer
+{
+  using namespace std;
+  using Moses::DecodeProfile;
+  using Moses::MemoryReport;
+
+  Metrics::
+  Metrics(Translator const& translator)
+    : m_translator(translator)
+  {
+    this->_signature = "S:";
+    this->_help = "Returns the request metrics, the decoder profile totals and the memory usage in Prometheus text format";
+  }
+
+  void
+  Metrics::
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP)
+  {
+    paramList.verifyEnd(0);
+    map<string, xmlrpc_c::value> ret;
+    ret["enabled"] = xmlrpc_c::value_boolean(DecodeProfile::IsEnabled());
+    ret["text"] = xmlrpc_c::value_string(m_translator.GetMetrics()
+					 + DecodeProfile::GetTotals());
+    ret["memory"] = xmlrpc_c::value_string(MemoryReport::GetMetrics());
+    *retvalP = xmlrpc_c::value_struct(ret);
+  }
+
+}
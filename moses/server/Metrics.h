@@ -0,0 +1,29 @@
+// -*- c++ -*-
+#pragma once
+
+#include <xmlrpc-c/base.hpp>
+#include <xmlrpc-c/registry.hpp>
+#include <xmlrpc-c/server_abyss.hpp>
+#include "Translator.h"
+
+namespace MosesServer
+{
+  // Reports the request metrics of the server (Translator::GetMetrics)
+  // and the decoder profile totals (-profile) in Prometheus text format,
+  // under the key "text", and the memory of the features and the process
+  // (see MemoryReport) under "memory", with or without -profile.
+  class
+  // MosesServer::
+  Metrics : public xmlrpc_c::method
+  {
+  public:
+    Metrics(Translator const& translator);
+
+    void execute(xmlrpc_c::paramList const& paramList,
+		 xmlrpc_c::value *   const  retvalP);
+
+  private:
+    Translator const& m_translator;
+  };
+
+}
@@ -0,0 +1,61 @@
+#include "ModelReloader.h"
+#include "moses/FF/FeatureFunction.h"
+#include "moses/StaticData.h"
+#include "moses/TranslationCache.h"
+#include "moses/TranslationOptionCache.h"
+#include "moses/TranslationOptionCollection.h"
+#include "moses/Timer.h"
+#include "util/exception.hh"
+
+namespace MosesServer
+{
+  using namespace std;
+  using Moses::FeatureFunction;
+
+  ModelReloader::
+  ModelReloader()
+  {
+    this->_signature = "S:S";
+    this->_help = "Reloads the model of a feature function without stopping translation";
+  }
+
+  void
+  ModelReloader::
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP)
+  {
+    typedef std::map<std::string, xmlrpc_c::value> params_t;
+    paramList.verifyEnd(1);
+    params_t const params = paramList.getStruct(0);
+    params_t::const_iterator si = params.find("name");
+    if (si == params.end())
+      throw xmlrpc_c::fault("Missing feature name", xmlrpc_c::fault::CODE_PARSE);
+    string name = xmlrpc_c::value_string(si->second);
+    string path;
+    if ((si = params.find("path")) != params.end())
+      path = xmlrpc_c::value_string(si->second);
+
+    Moses::Timer timer;
+    timer.start();
+    try {
+      FeatureFunction::FindFeatureFunction(name).Reload(path);
+    } catch (const string &e) {
+      throw xmlrpc_c::fault(e, xmlrpc_c::fault::CODE_PARSE);
+    } catch (const util::Exception &e) {
+      throw xmlrpc_c::fault(e.what(), xmlrpc_c::fault::CODE_INTERNAL);
+    }
+    // cached translations, options and unknown words are from the old model
+    Moses::TranslationCache* cache = Moses::StaticData::Instance().GetTranslationCache();
+    if (cache) cache->Invalidate(name + "=" + path);
+    Moses::TranslationOptionCache* optionCache
+      = Moses::StaticData::Instance().GetTranslationOptionCache();
+    if (optionCache) optionCache->Invalidate();
+    Moses::TranslationOptionCollection::ClearUnknownWordCache();
+
+    map<string, xmlrpc_c::value> ret;
+    ret["name"] = xmlrpc_c::value_string(name);
+    ret["seconds"] = xmlrpc_c::value_double(timer.get_elapsed_time());
+    *retvalP = xmlrpc_c::value_struct(ret);
+  }
+
+}
@@ -0,0 +1,24 @@
+// -*- c++ -*-
+#pragma once
+
+#include <xmlrpc-c/base.hpp>
+#include <xmlrpc-c/registry.hpp>
+#include <xmlrpc-c/server_abyss.hpp>
+
+namespace MosesServer
+{
+  // Reloads the model of one feature function (FeatureFunction::Reload)
+  // while the server keeps translating. Parameters: "name", the feature's
+  // name, e.g. LM0, and optionally "path", the new model file.
+  class
+  // MosesServer::
+  ModelReloader : public xmlrpc_c::method
+  {
+  public:
+    ModelReloader();
+
+    void execute(xmlrpc_c::paramList const& paramList,
+		 xmlrpc_c::value *   const  retvalP);
+  };
+
+}
@@ -0,0 +1,23 @@
+#include "ServerStats.h"
+
+namespace MosesServer
+{
+
+  ServerStats::
+  ServerStats(Translator const& translator)
+    : m_translator(translator)
+  {
+    this->_signature = "S:";
+    this->_help = "Returns request statistics per priority class";
+  }
+
+  void
+  ServerStats::
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP)
+  {
+    paramList.verifyEnd(0);
+    *retvalP = m_translator.GetStats();
+  }
+
+}
@@ -0,0 +1,26 @@
+// -*- c++ -*-
+#pragma once
+
+#include "Translator.h"
+#include <xmlrpc-c/base.hpp>
+#include <xmlrpc-c/registry.hpp>
+#include <xmlrpc-c/server_abyss.hpp>
+
+namespace MosesServer
+{
+  // Reports the Translator's queue lengths, dropped requests and
+  // latency histograms per priority class.
+  class
+  // MosesServer::
+  ServerStats : public xmlrpc_c::method
+  {
+  public:
+    ServerStats(Translator const& translator);
+
+    void execute(xmlrpc_c::paramList const& paramList,
+		 xmlrpc_c::value *   const  retvalP);
+  private:
+    Translator const& m_translator;
+  };
+
+}
@@ -1,5 +1,9 @@
 #include "TranslationRequest.h"
 #include <boost/foreach.hpp>
+#include "moses/TranslationCache.h"
+#include "moses/DecodeProfile.h"
+#include "moses/StreamingDecoder.h"
+#include "util/usage.hh"
 
 namespace MosesServer
 {
@@ -26,9 +30,19 @@ namespace MosesServer
   create(xmlrpc_c::paramList const& paramList, 
 	 boost::condition_variable& cond, 
 	 boost::mutex& mut)
+  {
+    paramList.verifyEnd(1);
+    return create(paramList.getStruct(0), cond, mut);
+  }
+
+  boost::shared_ptr<TranslationRequest>
+  TranslationRequest::
+  create(std::map<std::string, xmlrpc_c::value> const& params,
+	 boost::condition_variable& cond, 
+	 boost::mutex& mut)
   {
     boost::shared_ptr<TranslationRequest> ret;
-    ret.reset(new TranslationRequest(paramList,cond, mut));
+    ret.reset(new TranslationRequest(params,cond, mut));
     ret->m_self = ret;
     return ret;
   }
@@ -37,9 +51,27 @@ namespace MosesServer
   TranslationRequest::
   Run() 
   {
-    parse_request(m_paramList.getStruct(0));
+    m_started = util::WallTime();
+    m_phaseTime[QUEUE] = m_started - m_received;
+    parse_request(m_params);
+    m_phaseTime[PARSE] = util::WallTime() - m_started;
+    Moses::DecodeProfile::BeginSentence();
       
     Moses::StaticData const& SD = Moses::StaticData::Instance();
+
+    Moses::TranslationCache* cache = SD.GetTranslationCache();
+    string const key = cache_key();
+    string cached;
+    if (key.size() && cache->Get(key, cached))
+      {
+	XVERBOSE(1,"Output (cached): " << cached << endl);
+	m_cached = true;
+	m_retData["text"] = xmlrpc_c::value_string(cached);
+	m_retData["cached"] = xmlrpc_c::value_boolean(true);
+	add_profile();
+	finish();
+	return;
+      }
       
     //Make sure alternative paths are retained, if necessary
     if (m_withGraphInfo || m_nbestSize>0) 
@@ -50,16 +82,71 @@ namespace MosesServer
       
     if (SD.IsSyntax()) 
       run_chart_decoder();
+    else if (m_streaming)
+      run_streaming_decoder();
     else 
       run_phrase_decoder();
       
     XVERBOSE(1,"Output: " << out.str() << endl);
+    if (m_degraded) 
+      m_retData["degraded"] = xmlrpc_c::value_boolean(true);
+    else if (key.size())
+      cache->Put(key, xmlrpc_c::value_string(m_retData["text"]));
+    add_profile();
+    finish();
+  }
+
+  void
+  TranslationRequest::
+  add_profile()
+  {
+    if (!Moses::DecodeProfile::IsEnabled()) return;
+    m_retData["profile"] = xmlrpc_c::value_string
+      (Moses::DecodeProfile::EndSentence(0, util::WallTime() - m_started));
+  }
+
+  void
+  TranslationRequest::
+  Cancel(std::string const& reason)
+  {
+    m_started = util::WallTime();
+    m_phaseTime[QUEUE] = m_started - m_received;
+    m_error = reason;
+    m_retData["error"] = xmlrpc_c::value_string(reason);
+    finish();
+  }
+
+  char const*
+  TranslationRequest::
+  PhaseName(Phase phase)
+  {
+    static char const* names[NUM_PHASES] 
+      = { "parse", "queue", "options", "search", "nbest", "pack", "total" };
+    return names[phase];
+  }
+
+  void
+  TranslationRequest::
+  add_timings()
+  {
+    std::map<std::string, xmlrpc_c::value> timings;
+    for (size_t i = 0; i < NUM_PHASES; ++i)
+      timings[PhaseName(Phase(i))] = xmlrpc_c::value_double(m_phaseTime[i] * 1000);
+    m_retData["timings"] = xmlrpc_c::value_struct(timings);
+  }
+
+  void
+  TranslationRequest::
+  finish()
+  {
+    m_finished = util::WallTime();
+    m_phaseTime[TOTAL] = m_finished - m_received;
+    if (m_withTimings) add_timings();
     {
       boost::lock_guard<boost::mutex> lock(m_mutex);
       m_done = true;
     }
     m_cond.notify_one();
-    
   }
     
   /// add phrase alignment information from a Hypothesis
@@ -225,24 +312,38 @@ namespace MosesServer
   }
   
   TranslationRequest::
-  TranslationRequest(xmlrpc_c::paramList const& paramList,
+  TranslationRequest(std::map<std::string, xmlrpc_c::value> const& params,
 		  boost::condition_variable& cond, boost::mutex& mut)
-    : m_cond(cond), m_mutex(mut), m_done(false), m_paramList(paramList)
-  { }
+    : m_cond(cond), m_mutex(mut), m_done(false), m_params(params)
+    , m_priority(NORMAL), m_received(util::WallTime())
+    , m_started(0), m_finished(0), m_deadline(0), m_degraded(false)
+    , m_cached(false), m_withTimings(check(params, "timings"))
+    , m_phaseTime(NUM_PHASES, 0.0)
+  { 
+    typedef std::map<std::string, xmlrpc_c::value> params_t;
+    params_t::const_iterator si = params.find("priority");
+    if (si != params.end())
+      {
+	int p = xmlrpc_c::value_int(si->second);
+	m_priority = std::min(size_t(std::max(p, 0)), size_t(NUM_PRIORITIES - 1));
+      }
+    // deadline in milliseconds after the request was received
+    si = params.find("deadline");
+    if (si != params.end())
+      m_deadline = m_received + xmlrpc_c::value_int(si->second) / 1000.0;
+  }
 
   void
   TranslationRequest::
   parse_request(std::map<std::string, xmlrpc_c::value> const& params)
   { // parse XMLRPC request
-    // params_t const params = m_paramList.getStruct(0);
-    m_paramList.verifyEnd(1); // ??? UG
-    
     // source text must be given, or we don't know what to translate
     typedef std::map<std::string, xmlrpc_c::value> params_t;
     params_t::const_iterator si = params.find("text");
     if (si == params.end()) 
       throw xmlrpc_c::fault("Missing source text", xmlrpc_c::fault::CODE_PARSE);
     m_source_string = xmlrpc_c::value_string(si->second);
+    StaticData::Instance().GetInputProcessing().Process(m_source_string);
     XVERBOSE(1,"Input: " << m_source_string << endl);
     
     m_withAlignInfo       = check(params, "align");
@@ -252,6 +353,38 @@ namespace MosesServer
     m_reportAllFactors    = check(params, "report-all-factors");
     m_nbestDistinct       = check(params, "nbest-distinct");
     m_withScoreBreakdown  = check(params, "add-score-breakdown");
+    m_streamEnd           = check(params, "stream-end");
+    m_streaming           = m_streamEnd || check(params, "stream");
+
+    // several systems may be served from one model: they are alternate
+    // weight settings that share the feature functions
+    si = params.find("system");
+    if (si != params.end())
+      m_system = xmlrpc_c::value_string(si->second);
+
+    // a weight profile for this request: {feature: [weights]}, sparse
+    // features take a single value; the others keep the system's weights
+    si = params.find("weights");
+    if (si != params.end())
+      {
+	std::map<std::string, xmlrpc_c::value> const tmp
+	  = xmlrpc_c::value_struct(si->second);
+	std::map<std::string, std::vector<float> > weights;
+	typedef std::map<std::string, xmlrpc_c::value>::value_type item;
+	BOOST_FOREACH(item const& x, tmp)
+	  {
+	    std::vector<float> &w = weights[x.first];
+	    if (x.second.type() == xmlrpc_c::value::TYPE_ARRAY)
+	      {
+		std::vector<xmlrpc_c::value> const v
+		  = xmlrpc_c::value_array(x.second).vectorValueValue();
+		for (size_t i = 0; i < v.size(); ++i)
+		  w.push_back(xmlrpc_c::value_double(v[i]));
+	      }
+	    else w.push_back(xmlrpc_c::value_double(x.second));
+	  }
+	m_weights = StaticData::Instance().CreateRequestWeights(m_system, weights);
+      }
     
     si = params.find("lambda");
     if (si != params.end()) 
@@ -273,16 +406,49 @@ namespace MosesServer
 	  }
       }
     
-    // // biased sampling for suffix-array-based sampling phrase table?
-    // if ((si = params.find("bias")) != params.end())
-    //   { 
-    // 	std::vector<xmlrpc_c::value> tmp 
-    // 	  = xmlrpc_c::value_array(si->second).cvalue();
-    // 	for (size_t i = 1; i < tmp.size(); i += 2)
-    // 	  m_bias[xmlrpc_c::value_int(tmp[i-1])] = xmlrpc_c::value_double(tmp[i]);
-    //   }
+    // requests with the same session id share their document-level state
+    si = params.find("session-id");
+    if (si != params.end())
+      {
+	double timeout = 1800;
+	const Moses::PARAM_VEC *p 
+	  = Moses::StaticData::Instance().GetParameter().GetParam("session-timeout");
+	if (p && p->size()) timeout = Moses::Scan<double>(p->at(0));
+	m_scope = Moses::ContextScope::ForSession(xmlrpc_c::value_string(si->second), timeout);
+      }
+    else m_scope.reset(new Moses::ContextScope);
+
+    // document weights for biased sampling in suffix-array phrase tables;
+    // they stay with the session
+    if ((si = params.find("context-weights")) != params.end())
+      {
+	std::map<std::string, xmlrpc_c::value> const tmp
+	  = xmlrpc_c::value_struct(si->second);
+	std::map<std::string, float> weights;
+	typedef std::map<std::string, xmlrpc_c::value>::value_type item;
+	BOOST_FOREACH(item const& x, tmp)
+	  weights[x.first] = xmlrpc_c::value_double(x.second);
+	m_scope->SetContextWeights(weights);
+      }
   } // end of Translationtask::parse_request()
 
+  string
+  TranslationRequest::
+  cache_key() const
+  {
+    if (!Moses::StaticData::Instance().GetTranslationCache()) return "";
+    if (m_withAlignInfo || m_withWordAlignInfo || m_withGraphInfo || m_withTopts
+	|| m_withScoreBreakdown || m_nbestSize || check(m_params, "lambda")
+	|| check(m_params, "session-id") || check(m_params, "context-weights")
+	|| check(m_params, "weights") || m_streaming)
+      return "";
+    // markup may carry options or update models
+    if (m_source_string.find('<') != string::npos) return "";
+    return string("server\t") + m_system + "\t"
+      + (m_reportAllFactors ? "all-factors\t" : "\t")
+      + Moses::TranslationCache::Normalize(m_source_string);
+  }
+
 
   void
   TranslationRequest::
@@ -291,15 +457,27 @@ namespace MosesServer
     Moses::TreeInput tinput; 
     istringstream buf(m_source_string + "\n");
     tinput.Read(buf, StaticData::Instance().GetInputFactorOrder());
+    tinput.SetScope(m_scope);
+    if (m_system.size()) {
+      tinput.SetWeightSetting(m_system);
+      tinput.SetSpecifiesWeightSetting(true);
+    }
+    tinput.SetRequestWeights(m_weights);
     
     Moses::ChartManager manager(tinput);
+    manager.SetDeadline(m_deadline);
     manager.Decode();
+    m_degraded = manager.WasDegraded();
+    m_phaseTime[OPTIONS] = manager.GetOptionsTime();
+    m_phaseTime[SEARCH] = manager.GetSearchTime();
     
+    double const start = util::WallTime();
     const Moses::ChartHypothesis *hypo = manager.GetBestHypothesis();
     ostringstream out;
     outputChartHypo(out,hypo);
     
     m_target_string = out.str();
+    StaticData::Instance().GetOutputProcessing().ProcessLines(m_target_string);
     m_retData["text"] = xmlrpc_c::value_string(m_target_string);
     
     if (m_withGraphInfo) 
@@ -308,6 +486,7 @@ namespace MosesServer
 	manager.OutputSearchGraphMoses(sgstream);
 	m_retData["sg"] =  xmlrpc_c::value_string(sgstream.str());
       }
+    m_phaseTime[PACK] = util::WallTime() - start;
   } // end of TranslationRequest::run_chart_decoder()
   
   void
@@ -319,7 +498,9 @@ namespace MosesServer
     ostringstream target;
     BOOST_REVERSE_FOREACH(Hypothesis const* e, edges)
       output_phrase(target, e->GetCurrTargetPhrase());
-    dest[key] = xmlrpc_c::value_string(target.str());
+    string text = target.str();
+    StaticData::Instance().GetOutputProcessing().Process(text);
+    dest[key] = xmlrpc_c::value_string(text);
   
     if (m_withAlignInfo)
       { // phrase alignment, if requested
@@ -352,19 +533,67 @@ namespace MosesServer
   }
 
 
+  namespace
+  {
+    // the StreamingDecoder of a session is kept in its scope under this
+    char const streaming_decoder_key = 0;
+  }
+
+  void
+  TranslationRequest::
+  run_streaming_decoder()
+  {
+    // without a session-id the scope is the request's own, and the text
+    // is translated as a sentence of its own
+    boost::shared_ptr<Moses::StreamingDecoder> decoder
+      = m_scope->Get<Moses::StreamingDecoder>(&streaming_decoder_key, true);
+    Moses::StreamingDecoder::Settings settings;
+    settings.scope = m_scope;
+    settings.weightSetting = m_system;
+    settings.weights = m_weights;
+
+    string text;
+    if (m_streamEnd || !check(m_params, "session-id"))
+      text = decoder->Finish(m_source_string, settings);
+    else 
+      {
+	text = decoder->Add(m_source_string, settings);
+	m_retData["pending"] = xmlrpc_c::value_string(decoder->GetPending());
+      }
+    StaticData::Instance().GetOutputProcessing().Process(text);
+    m_retData["text"] = xmlrpc_c::value_string(text);
+  }
+
   void
   TranslationRequest::
   run_phrase_decoder()
   {
-    Manager manager(Sentence(0, m_source_string));
-    // if (m_bias.size()) manager.SetBias(&m_bias);
+    Sentence sentence(0, m_source_string);
+    sentence.SetScope(m_scope);
+    if (m_system.size()) {
+      sentence.SetWeightSetting(m_system);
+      sentence.SetSpecifiesWeightSetting(true);
+    }
+    sentence.SetRequestWeights(m_weights);
+    Manager manager(sentence);
+    manager.SetDeadline(m_deadline);
     manager.Decode();
+    m_degraded = manager.WasDegraded();
+    m_phaseTime[OPTIONS] = manager.GetOptionsTime();
+    m_phaseTime[SEARCH] = manager.GetSearchTime();
     
+    double const start = util::WallTime();
     pack_hypothesis(manager.GetBestHypothesis(), "text", m_retData);
     
     if (m_withGraphInfo) insertGraphInfo(manager,m_retData);
     if (m_withTopts) insertTranslationOptions(manager,m_retData);
-    if (m_nbestSize) outputNBest(manager, m_retData);
+    double const packed = util::WallTime();
+    m_phaseTime[PACK] = packed - start;
+    if (m_nbestSize) 
+      {
+	outputNBest(manager, m_retData);
+	m_phaseTime[NBEST] = util::WallTime() - packed;
+      }
     
     (const_cast<StaticData&>(Moses::StaticData::Instance()))
       .SetOutputSearchGraph(false); 
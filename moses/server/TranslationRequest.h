@@ -18,6 +18,7 @@
 #include "moses/TranslationModel/PhraseDictionaryMultiModel.h"
 #include "moses/TreeInput.h"
 #include "moses/TranslationTask.h"
+#include "moses/ContextScope.h"
 #include <boost/shared_ptr.hpp>
 
 #include <xmlrpc-c/base.hpp>
@@ -30,11 +31,15 @@ namespace MosesServer
     boost::mutex& m_mutex;
     bool m_done;
 
-    xmlrpc_c::paramList const& m_paramList;
+    std::map<std::string, xmlrpc_c::value> const m_params;
     std::map<std::string, xmlrpc_c::value> m_retData;
-    std::map<uint32_t,float> m_bias; // for biased sampling
+    // the session of the request, or a scope of its own
+    boost::shared_ptr<Moses::ContextScope> m_scope;
     
     std::string m_source_string, m_target_string;
+    std::string m_system; //!< alternate weight setting to decode with
+    //! weights of the request ("weights"), NULL for those of the system
+    boost::shared_ptr<const Moses::ScoreComponentCollection> m_weights;
     bool m_withAlignInfo;
     bool m_withWordAlignInfo;
     bool m_withGraphInfo;
@@ -42,19 +47,52 @@ namespace MosesServer
     bool m_reportAllFactors;
     bool m_nbestDistinct;
     bool m_withScoreBreakdown;
+    bool m_streaming;  // "stream": a chunk of a sentence still arriving
+    bool m_streamEnd;  // "stream-end": the chunk ends the sentence
     size_t m_nbestSize;
 
+    // scheduling; times are util::WallTime() seconds
+    size_t m_priority;
+    double m_received, m_started, m_finished;
+    double m_deadline; // 0 for none
+    bool m_degraded;   // decoded greedily because the deadline passed
+    bool m_cached;     // answered from the translation cache
+    bool m_withTimings; // "timings": report the phase times
+    std::vector<double> m_phaseTime; // seconds, see GetPhaseTime()
+    std::string m_error;
+    
+    void
+    finish();
+
+    // the phase times in milliseconds as "timings"
+    void
+    add_timings();
+
+    // the sentence profile as "profile", if -profile is on
+    void
+    add_profile();
+
     void 
     parse_request();
 
     void
     parse_request(std::map<std::string, xmlrpc_c::value> const& req);
+
+    // key in the translation cache, empty if the request asks for more
+    // than the translation
+    std::string
+    cache_key() const;
     
     virtual void
     run_chart_decoder();
 
     virtual void
     run_phrase_decoder();
+
+    // adds the text to the sentence of the session, see
+    // Moses::StreamingDecoder
+    void
+    run_streaming_decoder();
     
     void 
     pack_hypothesis(std::vector<Moses::Hypothesis const* > const& edges, 
@@ -91,24 +129,72 @@ namespace MosesServer
     insertTranslationOptions(Moses::Manager& manager, 
 			     std::map<std::string, xmlrpc_c::value>& retData);
   protected:
-    TranslationRequest(xmlrpc_c::paramList const& paramList, 
+    TranslationRequest(std::map<std::string, xmlrpc_c::value> const& params,
 		    boost::condition_variable& cond, 
 		    boost::mutex& mut);
 
   public:
 
+    // priority classes, "priority" parameter of a request
+    enum { INTERACTIVE = 0, NORMAL = 1, BULK = 2, NUM_PRIORITIES = 3 };
+
+    // where the time of a request goes: reading its parameters, waiting
+    // in the queue, collecting translation options, the search, the
+    // n-best list and building the response (best translation, search
+    // graph, options); TOTAL is from receipt to the response.
+    // Decoding the XML-RPC message itself happens before the request is
+    // created and is not included.
+    enum Phase { PARSE, QUEUE, OPTIONS, SEARCH, NBEST, PACK, TOTAL, NUM_PHASES };
+
+    static char const*
+    PhaseName(Phase phase);
+
     static
     boost::shared_ptr<TranslationRequest>
     create(xmlrpc_c::paramList const& paramList, 
 	   boost::condition_variable& cond, 
 	   boost::mutex& mut);
     
+    // for one segment of a batch request; params as for "translate"
+    static
+    boost::shared_ptr<TranslationRequest>
+    create(std::map<std::string, xmlrpc_c::value> const& params,
+	   boost::condition_variable& cond, 
+	   boost::mutex& mut);
+    
     
     virtual bool 
     DeleteAfterExecution() { return false; }
     
     bool 
     IsDone() const { return m_done; }
+
+    size_t
+    GetPriority() const { return m_priority; }
+
+    double
+    GetDeadline() const { return m_deadline; }
+
+    double
+    GetWaitTime() const { return m_started - m_received; }
+
+    double
+    GetLatency() const { return m_finished - m_received; }
+
+    // seconds spent in phase; 0 for phases the request skipped
+    double
+    GetPhaseTime(Phase phase) const { return m_phaseTime[phase]; }
+
+    bool
+    WasCached() const { return m_cached; }
+
+    // non-empty if the request was dropped without decoding
+    std::string const&
+    GetError() const { return m_error; }
+
+    // drop the request without decoding it
+    void
+    Cancel(std::string const& reason);
     
     std::map<std::string, xmlrpc_c::value> const& 
     GetRetData() { return m_retData; }
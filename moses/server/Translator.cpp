@@ -1,5 +1,7 @@
+#include <sstream>
 #include "Translator.h"
 #include "TranslationRequest.h"
+#include "util/usage.hh"
 
 namespace MosesServer
 {
@@ -7,9 +9,51 @@ namespace MosesServer
   using namespace std;
   using namespace Moses;
 
+  namespace 
+  {
+    size_t const NUM_LATENCY_BUCKETS = 18; // up to about two minutes
+
+    size_t 
+    latency_bucket(double seconds)
+    {
+      size_t i = 0;
+      for (double ms = seconds * 1000; ms >= 1 && i + 1 < NUM_LATENCY_BUCKETS; ms /= 2)
+	++i;
+      return i;
+    }
+
+    char const* const class_names[] = { "interactive", "normal", "bulk" };
+  }
+
+  Translator::
+  ClassStats::
+  ClassStats()
+    : phases(TranslationRequest::NUM_PHASES, vector<size_t>(NUM_LATENCY_BUCKETS, 0))
+    , seconds(TranslationRequest::NUM_PHASES, 0.0)
+    , completed(0), cached(0), expired(0), shed(0)
+  { }
+
+  void
   Translator::
-  Translator(size_t numThreads) 
-    : m_threadPool(numThreads) 
+  ClassStats::
+  add(TranslationRequest const& req)
+  {
+    ++completed;
+    if (req.WasCached()) ++cached;
+    for (size_t i = 0; i < phases.size(); ++i)
+      {
+	double const t = req.GetPhaseTime(TranslationRequest::Phase(i));
+	++phases[i][latency_bucket(t)];
+	seconds[i] += t;
+      }
+  }
+
+  Translator::
+  Translator(size_t numThreads, size_t maxQueued) 
+    : m_threadPool(numThreads), m_numThreads(numThreads)
+    , m_maxQueued(maxQueued)
+    , m_queues(TranslationRequest::NUM_PRIORITIES), m_queued(0), m_active(0)
+    , m_stats(TranslationRequest::NUM_PRIORITIES)
   {
     // signature and help strings are documentation -- the client
     // can query this information with a system.methodSignature and
@@ -27,11 +71,157 @@ namespace MosesServer
     boost::mutex mut;
     boost::shared_ptr<TranslationRequest> task 
       = TranslationRequest::create(paramList,cond,mut);
-    m_threadPool.Submit(task);
+    Schedule(task);
     boost::unique_lock<boost::mutex> lock(mut);
     while (!task->IsDone()) 
       cond.wait(lock);
+    if (task->GetError().size())
+      throw xmlrpc_c::fault(task->GetError(), 
+			    xmlrpc_c::fault::CODE_REQUEST_REFUSED);
     *retvalP = xmlrpc_c::value_struct(task->GetRetData());
   }
+
+  void
+  Translator::
+  Schedule(boost::shared_ptr<TranslationRequest> const& req)
+  {
+    size_t const p = req->GetPriority();
+    {
+      boost::lock_guard<boost::mutex> guard(m_lock);
+      if (m_maxQueued && m_queued >= m_maxQueued)
+	{
+	  // make room by dropping the newest request of the least
+	  // urgent class that is less urgent than this one
+	  size_t victim = m_queues.size() - 1;
+	  while (victim > p && m_queues[victim].empty()) --victim;
+	  if (victim == p)
+	    {
+	      ++m_stats[p].shed;
+	      req->Cancel("Server overloaded");
+	      return;
+	    }
+	  ++m_stats[victim].shed;
+	  m_queues[victim].back()->Cancel("Server overloaded");
+	  m_queues[victim].pop_back();
+	  --m_queued;
+	}
+      m_queues[p].push_back(req);
+      ++m_queued;
+    }
+    m_threadPool.Submit(boost::shared_ptr<Task>(new Dispatcher(*this)));
+  }
+
+  void
+  Translator::
+  RunNext()
+  {
+    boost::shared_ptr<TranslationRequest> req;
+    {
+      boost::lock_guard<boost::mutex> guard(m_lock);
+      for (size_t p = 0; !req && p < m_queues.size(); ++p)
+	{
+	  if (m_queues[p].empty()) continue;
+	  req = m_queues[p].front();
+	  m_queues[p].pop_front();
+	  --m_queued;
+	}
+      // a request dropped to make room leaves a spare dispatcher
+      if (!req) return;
+      if (req->GetDeadline() > 0 && util::WallTime() > req->GetDeadline())
+	{
+	  ++m_stats[req->GetPriority()].expired;
+	  req->Cancel("Deadline passed before decoding started");
+	  return;
+	}
+      ++m_active;
+    }
+    req->Run();
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    --m_active;
+    m_stats[req->GetPriority()].add(*req);
+  }
+
+  xmlrpc_c::value
+  Translator::
+  GetStats() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    map<string, xmlrpc_c::value> ret;
+    for (size_t p = 0; p < m_stats.size(); ++p)
+      {
+	ClassStats const& s = m_stats[p];
+	map<string, xmlrpc_c::value> x, phases;
+	for (size_t k = 0; k < s.phases.size(); ++k)
+	  {
+	    vector<xmlrpc_c::value> h;
+	    for (size_t i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+	      h.push_back(xmlrpc_c::value_int(s.phases[k][i]));
+	    phases[TranslationRequest::PhaseName(TranslationRequest::Phase(k))]
+	      = xmlrpc_c::value_array(h);
+	  }
+	x["queued"]    = xmlrpc_c::value_int(m_queues[p].size());
+	x["completed"] = xmlrpc_c::value_int(s.completed);
+	x["cached"]    = xmlrpc_c::value_int(s.cached);
+	x["expired"]   = xmlrpc_c::value_int(s.expired);
+	x["shed"]      = xmlrpc_c::value_int(s.shed);
+	x["wait-ms"]    = phases["queue"];
+	x["latency-ms"] = phases["total"];
+	x["phase-ms"]   = xmlrpc_c::value_struct(phases);
+	ret[class_names[p]] = xmlrpc_c::value_struct(x);
+      }
+    ret["active-threads"] = xmlrpc_c::value_int(m_active);
+    ret["threads"] = xmlrpc_c::value_int(m_numThreads);
+    return xmlrpc_c::value_struct(ret);
+  }
+
+  string
+  Translator::
+  GetMetrics() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    ostringstream queued, requests, hist;
+    for (size_t p = 0; p < m_stats.size(); ++p)
+      {
+	ClassStats const& s = m_stats[p];
+	string const cls = string("class=\"") + class_names[p] + "\"";
+	queued << "moses_server_queued{" << cls << "} " << m_queues[p].size() << "\n";
+	requests << "moses_server_requests_total{" << cls << ",result=\"decoded\"} " 
+		 << s.completed - s.cached << "\n"
+		 << "moses_server_requests_total{" << cls << ",result=\"cached\"} " 
+		 << s.cached << "\n"
+		 << "moses_server_requests_total{" << cls << ",result=\"expired\"} " 
+		 << s.expired << "\n"
+		 << "moses_server_requests_total{" << cls << ",result=\"shed\"} " 
+		 << s.shed << "\n";
+	for (size_t k = 0; k < s.phases.size(); ++k)
+	  {
+	    string const labels = cls + ",phase=\"" 
+	      + TranslationRequest::PhaseName(TranslationRequest::Phase(k)) + "\"";
+	    size_t count = 0;
+	    for (size_t i = 0; i + 1 < NUM_LATENCY_BUCKETS; ++i)
+	      {
+		count += s.phases[k][i];
+		hist << "moses_server_phase_seconds_bucket{" << labels 
+		     << ",le=\"" << (1 << i) / 1000.0 << "\"} " << count << "\n";
+	      }
+	    count += s.phases[k][NUM_LATENCY_BUCKETS - 1];
+	    hist << "moses_server_phase_seconds_bucket{" << labels 
+		 << ",le=\"+Inf\"} " << count << "\n"
+		 << "moses_server_phase_seconds_sum{" << labels << "} " 
+		 << s.seconds[k] << "\n"
+		 << "moses_server_phase_seconds_count{" << labels << "} " 
+		 << count << "\n";
+	  }
+      }
+    ostringstream out;
+    out << "# TYPE moses_server_threads gauge\n"
+	<< "moses_server_threads " << m_numThreads << "\n"
+	<< "# TYPE moses_server_active_threads gauge\n"
+	<< "moses_server_active_threads " << m_active << "\n"
+	<< "# TYPE moses_server_queued gauge\n" << queued.str()
+	<< "# TYPE moses_server_requests_total counter\n" << requests.str()
+	<< "# TYPE moses_server_phase_seconds histogram\n" << hist.str();
+    return out.str();
+  }
   
 }
@@ -1,7 +1,11 @@
 // -*- c++ -*-
 #pragma once
 
+#include <deque>
+#include <string>
+#include <vector>
 #include "moses/ThreadPool.h"
+#include <boost/shared_ptr.hpp>
 #include <xmlrpc-c/base.hpp>
 #include <xmlrpc-c/registry.hpp>
 #include <xmlrpc-c/server_abyss.hpp>
@@ -10,17 +14,69 @@
 #endif
 namespace MosesServer
 {
+  class TranslationRequest;
+
+  // Requests are queued by priority class; each free decoder thread
+  // takes the oldest request of the most urgent class. Requests whose
+  // deadline has passed by then are dropped, and if more than
+  // maxQueued requests are waiting (0: no limit), the newest request of
+  // a less urgent class is dropped to make room, or, if there is none,
+  // the new request is refused.
   class 
   // MosesServer::
   Translator : public xmlrpc_c::method
   {
   public:
-    Translator(size_t numThreads = 10);
+    Translator(size_t numThreads = 10, size_t maxQueued = 0);
     
     void execute(xmlrpc_c::paramList const& paramList,
 		 xmlrpc_c::value *   const  retvalP);
+
+    // queue a request for decoding; if it is dropped instead, it is
+    // done with an error (TranslationRequest::GetError())
+    void Schedule(boost::shared_ptr<TranslationRequest> const& req);
+
+    size_t GetNumThreads() const { return m_numThreads; }
+
+    // queue lengths, drop counts and latency histograms per class
+    xmlrpc_c::value GetStats() const;
+
+    // the same, with the busy threads and the histograms of every
+    // request phase, in Prometheus text format
+    std::string GetMetrics() const;
+
   private:
+    // Histograms of the time of each TranslationRequest::Phase; bucket
+    // i counts times below 2^i ms (the last one everything above).
+    struct ClassStats
+    {
+      std::vector<std::vector<size_t> > phases;
+      std::vector<double> seconds; // sum per phase
+      size_t completed, cached, expired, shed;
+      ClassStats();
+      void add(TranslationRequest const& req);
+    };
+
+    // one is submitted to the pool per queued request
+    class Dispatcher : public Moses::Task
+    {
+      Translator& m_translator;
+    public:
+      Dispatcher(Translator& translator) : m_translator(translator) {}
+      void Run() { m_translator.RunNext(); }
+    };
+
+    void RunNext();
+
     Moses::ThreadPool m_threadPool;
+    size_t m_numThreads;
+    size_t m_maxQueued;
+
+    mutable boost::mutex m_lock; // for the queues and statistics
+    std::vector<std::deque<boost::shared_ptr<TranslationRequest> > > m_queues;
+    size_t m_queued;
+    size_t m_active; // requests being decoded
+    std::vector<ClassStats> m_stats;
   };
   
 }
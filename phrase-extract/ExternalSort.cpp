@@ -0,0 +1,265 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "ExternalSort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <zlib.h>
+
+#include "util/exception.hh"
+#include "util/fake_ofstream.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+namespace MosesTraining
+{
+
+namespace
+{
+
+template <class Iterator, class Less>
+void SortRange(Iterator begin, Iterator end, Less less)
+{
+  std::sort(begin, end, less);
+}
+
+// Writes a gzipped temporary run; gzip level 1, the runs are read once.
+class RunWriter
+{
+public:
+  explicit RunWriter(const std::string &tempDir)
+    : m_fd(util::MakeTemp(tempDir + "/moses-sort-")) {
+    m_gz = gzdopen(util::DupOrThrow(m_fd.get()), "wb1");
+    UTIL_THROW_IF2(!m_gz, "Could not write a temporary run in " << tempDir);
+  }
+
+  ~RunWriter() {
+    if (m_gz) gzclose(m_gz);
+  }
+
+  void Write(const std::string &line) {
+    UTIL_THROW_IF2((!line.empty() && gzwrite(m_gz, line.data(), line.size()) <= 0)
+                   || gzputc(m_gz, '\n') < 0, "Writing a temporary run failed");
+  }
+
+  //! the run's file descriptor, at its beginning
+  int Finish() {
+    UTIL_THROW_IF2(gzclose(m_gz) != Z_OK, "Writing a temporary run failed");
+    m_gz = NULL;
+    util::SeekOrThrow(m_fd.get(), 0);
+    return m_fd.release();
+  }
+
+private:
+  util::scoped_fd m_fd;
+  gzFile m_gz;
+};
+
+class OutWriter
+{
+public:
+  explicit OutWriter(util::FakeOFStream &out) : m_out(out) {}
+
+  void Write(const std::string &line) {
+    m_out << line << '\n';
+  }
+
+private:
+  util::FakeOFStream &m_out;
+};
+
+// The smallest head comes first; ties go to the earlier run.
+struct GreaterHead {
+  bool operator()(const std::pair<const std::string*, size_t> &a,
+                  const std::pair<const std::string*, size_t> &b) const {
+    int cmp = a.first->compare(*b.first);
+    return cmp > 0 || (cmp == 0 && a.second > b.second);
+  }
+};
+
+}
+
+struct ExternalSort::LessLine {
+  explicit LessLine(const std::vector<char> &data) : m_data(data.empty() ? NULL : &data[0]) {}
+
+  bool operator()(const Line &a, const Line &b) const {
+    if (a.prefix != b.prefix) return a.prefix < b.prefix;
+    int cmp = memcmp(m_data + a.offset, m_data + b.offset, std::min(a.size, b.size));
+    return cmp < 0 || (cmp == 0 && a.size < b.size);
+  }
+
+  const char *m_data;
+};
+
+ExternalSort::ExternalSort(const Options &options)
+  : m_options(options)
+{
+  if (m_options.batchSize < 2) m_options.batchSize = 2;
+  if (m_options.threads < 1) m_options.threads = 1;
+}
+
+ExternalSort::~ExternalSort()
+{
+  for (size_t i = 0; i < m_runs.size(); ++i) {
+    util::scoped_fd close(m_runs[i]);
+  }
+}
+
+void ExternalSort::Add(const std::string &line)
+{
+  Line entry;
+  entry.prefix = 0;
+  for (size_t i = 0; i < sizeof(entry.prefix); ++i) {
+    entry.prefix = (entry.prefix << 8) | (i < line.size() ? static_cast<unsigned char>(line[i]) : 0);
+  }
+  entry.offset = m_data.size();
+  entry.size = line.size();
+  m_lines.push_back(entry);
+  m_data.insert(m_data.end(), line.begin(), line.end());
+  if (m_data.size() + m_lines.size() * sizeof(Line) >= m_options.memory) {
+    WriteRun();
+  }
+}
+
+void ExternalSort::SortBuffer()
+{
+  const LessLine less(m_data);
+
+  // sort slices on their own threads, then merge neighbouring slices
+  size_t slices = std::min(m_options.threads, std::max<size_t>(1, m_lines.size() / 10000));
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= slices; ++i) {
+    bounds.push_back(m_lines.size() * i / slices);
+  }
+#ifdef WITH_THREADS
+  if (slices > 1) {
+    boost::thread_group threads;
+    for (size_t i = 0; i < slices; ++i) {
+      threads.create_thread(boost::bind(&SortRange<std::vector<Line>::iterator, LessLine>,
+                                        m_lines.begin() + bounds[i], m_lines.begin() + bounds[i + 1], less));
+    }
+    threads.join_all();
+  } else
+#endif
+    for (size_t i = 0; i < slices; ++i) {
+      SortRange(m_lines.begin() + bounds[i], m_lines.begin() + bounds[i + 1], less);
+    }
+
+  for (size_t width = 1; width < slices; width *= 2) {
+    for (size_t i = 0; i + width < slices; i += 2 * width) {
+      std::inplace_merge(m_lines.begin() + bounds[i],
+                         m_lines.begin() + bounds[i + width],
+                         m_lines.begin() + bounds[std::min(i + 2 * width, slices)],
+                         less);
+    }
+  }
+}
+
+template <class Writer> void ExternalSort::WriteBuffer(Writer &out)
+{
+  SortBuffer();
+  std::string line, last;
+  for (size_t i = 0; i < m_lines.size(); ++i) {
+    const char *begin = m_data.empty() ? NULL : &m_data[m_lines[i].offset];
+    line.assign(begin, m_lines[i].size);
+    if (m_options.unique && i && line == last) continue;
+    out.Write(line);
+    if (m_options.unique) last.swap(line);
+  }
+  std::vector<char>().swap(m_data);
+  std::vector<Line>().swap(m_lines);
+}
+
+void ExternalSort::WriteRun()
+{
+  if (m_lines.empty()) return;
+  RunWriter run(m_options.tempDir);
+  WriteBuffer(run);
+  m_runs.push_back(run.Finish());
+}
+
+void ExternalSort::Finish(util::FakeOFStream &out)
+{
+  OutWriter writer(out);
+
+  if (m_runs.empty()) {
+    // everything fit into memory
+    WriteBuffer(writer);
+    return;
+  }
+
+  WriteRun();
+  // merge batches of the oldest runs until one batch is left
+  while (m_runs.size() > m_options.batchSize) {
+    std::vector<int> batch(m_runs.begin(), m_runs.begin() + m_options.batchSize);
+    m_runs.erase(m_runs.begin(), m_runs.begin() + m_options.batchSize);
+    RunWriter run(m_options.tempDir);
+    Merge(batch, run);
+    m_runs.push_back(run.Finish());
+  }
+  std::vector<int> batch;
+  batch.swap(m_runs);
+  Merge(batch, writer);
+}
+
+template <class Writer> void ExternalSort::Merge(const std::vector<int> &runs, Writer &out)
+{
+  // the readers take ownership of the runs
+  boost::ptr_vector<util::LineBatchReader> readers;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    readers.push_back(new util::LineBatchReader(runs[i], 1024, 2));
+  }
+
+  std::vector<std::string> heads(runs.size());
+  std::priority_queue<std::pair<const std::string*, size_t>,
+      std::vector<std::pair<const std::string*, size_t> >, GreaterHead> queue;
+  for (size_t i = 0; i < readers.size(); ++i) {
+    if (readers[i].ReadLine(heads[i])) {
+      queue.push(std::make_pair(&heads[i], i));
+    }
+  }
+
+  std::string last;
+  bool any = false;
+  while (!queue.empty()) {
+    const size_t i = queue.top().second;
+    queue.pop();
+    if (!m_options.unique || !any || heads[i] != last) {
+      out.Write(heads[i]);
+      if (m_options.unique) last = heads[i];
+      any = true;
+    }
+    if (readers[i].ReadLine(heads[i])) {
+      queue.push(std::make_pair(&heads[i], i));
+    }
+  }
+}
+
+}
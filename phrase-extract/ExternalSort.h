@@ -0,0 +1,93 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util
+{
+class FakeOFStream;
+}
+
+namespace MosesTraining
+{
+
+/** Sorts text lines in byte order, the order of LC_ALL=C sort, using
+ *  temporary files when they don't fit into memory. A full buffer is sorted
+ *  on several threads and written as a gzipped run; the runs are merged
+ *  batchSize at a time. With unique, repeated lines are dropped as soon as
+ *  they meet, in the buffer or in the merge, so duplicate extracts don't
+ *  make it into the runs.
+ */
+class ExternalSort
+{
+public:
+  struct Options {
+    Options()
+      : memory(512 << 20), batchSize(16), threads(1), unique(false), tempDir("/tmp") {}
+
+    size_t memory;       //!< bytes of lines held before a run is written
+    size_t batchSize;    //!< runs merged at once
+    size_t threads;      //!< threads sorting a buffer
+    bool unique;         //!< output repeated lines once
+    std::string tempDir;
+  };
+
+  explicit ExternalSort(const Options &options);
+  ~ExternalSort();
+
+  void Add(const std::string &line);
+
+  //! writes the sorted lines, each followed by a newline
+  void Finish(util::FakeOFStream &out);
+
+private:
+  //! a line in m_data; the first bytes, big endian, decide most comparisons
+  struct Line {
+    uint64_t prefix;
+    size_t offset, size;
+  };
+  struct LessLine;
+
+  //! sorts m_lines, on several threads
+  void SortBuffer();
+  //! writes the sorted buffer
+  template <class Writer> void WriteBuffer(Writer &out);
+  void WriteRun();
+
+  template <class Writer> void Merge(const std::vector<int> &runs, Writer &out);
+
+  Options m_options;
+
+  std::vector<char> m_data;
+  std::vector<Line> m_lines;
+
+  //! file descriptors of the runs, at their beginning
+  std::vector<int> m_runs;
+
+  // not copyable
+  ExternalSort(const ExternalSort &);
+  void operator=(const ExternalSort &);
+};
+
+}
@@ -21,7 +21,9 @@
 #include "ExtractionPhrasePair.h"
 #include "tables-core.h"
 #include "score.h"
+#include "PropertiesIterator.h"
 #include "moses/Util.h"
+#include "util/tokenize_piece.hh"
 
 #include <cstdlib>
 
@@ -223,26 +225,12 @@ void ExtractionPhrasePair::Clear()
 }
 
 
-void ExtractionPhrasePair::AddProperties( const std::string &propertiesString, float count )
+void ExtractionPhrasePair::AddProperties( const StringPiece &propertiesString, float count )
 {
-  if (propertiesString.empty()) {
-    return;
-  }
-
-  vector<std::string> toks;
-  Moses::TokenizeMultiCharSeparator(toks, propertiesString, "{{");
-  for (size_t i = 1; i < toks.size(); ++i) {
-    std::string &tok = toks[i];
-    if (tok.empty()) {
-      continue;
-    }
-    size_t endPos = tok.rfind("}");
-    tok = tok.substr(0, endPos - 1);
-
-    vector<std::string> keyValue = Moses::TokenizeFirstOnly(tok, " ");
-    if (keyValue.size() == 2) {
-      AddProperty(keyValue[0], keyValue[1], count);
-    } 
+  PropertiesIterator property(propertiesString);
+  StringPiece key, value;
+  while (property.Next(key, value)) {
+    AddProperty(key, value, count);
   }
 }
 
@@ -336,6 +324,15 @@ std::string ExtractionPhrasePair::CollectAllLabelsSeparateLHSAndRHS(const std::s
     return "";
   }
 
+  // the label sets are all counted with the left-hand side of the rule
+  std::string ruleTargetLhs = vcbT.getWord(m_phraseTarget->back());
+  ruleTargetLhs.erase(ruleTargetLhs.begin());  // strip square brackets
+  ruleTargetLhs.erase(ruleTargetLhs.size()-1);
+  boost::unordered_map<std::string,float>* &jointCounts = jointCountsRulesTargetLHSAndLabelsLHS[ruleTargetLhs];
+  if ( jointCounts == NULL ) {
+    jointCounts = new boost::unordered_map<std::string,float>;
+  }
+
   std::string lhs="", rhs="", currentRhs="";
   float currentRhsCount = 0.0;
   std::list< std::pair<std::string,float> > lhsGivenCurrentRhsCounts;
@@ -359,11 +356,8 @@ std::string ExtractionPhrasePair::CollectAllLabelsSeparateLHSAndRHS(const std::s
 
       if ( iter!=allPropertyValues->begin() ) {
         if ( !currentRhs.empty() ) {
-          istringstream tokenizer(currentRhs);
-          std::string rhsLabel;
-          while ( tokenizer.peek() != EOF ) {
-            tokenizer >> rhsLabel;
-            labelSet.insert(rhsLabel);
+          for (util::TokenIter<util::SingleCharacter, true> rhsLabel(currentRhs, ' '); rhsLabel; ++rhsLabel) {
+            labelSet.insert(rhsLabel->as_string());
           }
           oss << " " << currentRhs << " " << currentRhsCount;
         }
@@ -376,30 +370,8 @@ std::string ExtractionPhrasePair::CollectAllLabelsSeparateLHSAndRHS(const std::s
             oss << " " << iter2->first << " " << iter2->second;
 
             // update countsLabelsLHS and jointCountsRulesTargetLHSAndLabelsLHS
-            std::string ruleTargetLhs = vcbT.getWord(m_phraseTarget->back());
-            ruleTargetLhs.erase(ruleTargetLhs.begin());  // strip square brackets
-            ruleTargetLhs.erase(ruleTargetLhs.size()-1);
-
-            std::pair< boost::unordered_map<std::string,float>::iterator, bool > insertedCountsLabelsLHS =
-              countsLabelsLHS.insert(std::pair<std::string,float>(iter2->first,iter2->second));
-            if (!insertedCountsLabelsLHS.second) {
-              (insertedCountsLabelsLHS.first)->second += iter2->second;
-            }
-
-            boost::unordered_map<std::string, boost::unordered_map<std::string,float>* >::iterator jointCountsRulesTargetLHSAndLabelsLHSIter =
-              jointCountsRulesTargetLHSAndLabelsLHS.find(ruleTargetLhs);
-            if ( jointCountsRulesTargetLHSAndLabelsLHSIter == jointCountsRulesTargetLHSAndLabelsLHS.end() ) {
-              boost::unordered_map<std::string,float>* jointCounts = new boost::unordered_map<std::string,float>;
-              jointCounts->insert(std::pair<std::string,float>(iter2->first,iter2->second));
-              jointCountsRulesTargetLHSAndLabelsLHS.insert(std::pair<std::string,boost::unordered_map<std::string,float>* >(ruleTargetLhs,jointCounts));
-            } else {
-              boost::unordered_map<std::string,float>* jointCounts = jointCountsRulesTargetLHSAndLabelsLHSIter->second;
-              std::pair< boost::unordered_map<std::string,float>::iterator, bool > insertedJointCounts =
-                jointCounts->insert(std::pair<std::string,float>(iter2->first,iter2->second));
-              if (!insertedJointCounts.second) {
-                (insertedJointCounts.first)->second += iter2->second;
-              }
-            }
+            countsLabelsLHS[iter2->first] += iter2->second;
+            (*jointCounts)[iter2->first] += iter2->second;
 
           }
         }
@@ -416,11 +388,8 @@ std::string ExtractionPhrasePair::CollectAllLabelsSeparateLHSAndRHS(const std::s
   }
 
   if ( !currentRhs.empty() ) {
-    istringstream tokenizer(currentRhs);
-    std::string rhsLabel;
-    while ( tokenizer.peek() != EOF ) {
-      tokenizer >> rhsLabel;
-      labelSet.insert(rhsLabel);
+    for (util::TokenIter<util::SingleCharacter, true> rhsLabel(currentRhs, ' '); rhsLabel; ++rhsLabel) {
+      labelSet.insert(rhsLabel->as_string());
     }
     oss << " " << currentRhs << " " << currentRhsCount;
   }
@@ -433,30 +402,8 @@ std::string ExtractionPhrasePair::CollectAllLabelsSeparateLHSAndRHS(const std::s
       oss << " " << iter2->first << " " << iter2->second;
 
       // update countsLabelsLHS and jointCountsRulesTargetLHSAndLabelsLHS
-      std::string ruleTargetLhs = vcbT.getWord(m_phraseTarget->back());
-      ruleTargetLhs.erase(ruleTargetLhs.begin());  // strip square brackets
-      ruleTargetLhs.erase(ruleTargetLhs.size()-1);
-
-      std::pair< boost::unordered_map<std::string,float>::iterator, bool > insertedCountsLabelsLHS =
-        countsLabelsLHS.insert(std::pair<std::string,float>(iter2->first,iter2->second));
-      if (!insertedCountsLabelsLHS.second) {
-        (insertedCountsLabelsLHS.first)->second += iter2->second;
-      }
-
-      boost::unordered_map<std::string, boost::unordered_map<std::string,float>* >::iterator jointCountsRulesTargetLHSAndLabelsLHSIter =
-        jointCountsRulesTargetLHSAndLabelsLHS.find(ruleTargetLhs);
-      if ( jointCountsRulesTargetLHSAndLabelsLHSIter == jointCountsRulesTargetLHSAndLabelsLHS.end() ) {
-        boost::unordered_map<std::string,float>* jointCounts = new boost::unordered_map<std::string,float>;
-        jointCounts->insert(std::pair<std::string,float>(iter2->first,iter2->second));
-        jointCountsRulesTargetLHSAndLabelsLHS.insert(std::pair<std::string,boost::unordered_map<std::string,float>* >(ruleTargetLhs,jointCounts));
-      } else {
-        boost::unordered_map<std::string,float>* jointCounts = jointCountsRulesTargetLHSAndLabelsLHSIter->second;
-        std::pair< boost::unordered_map<std::string,float>::iterator, bool > insertedJointCounts =
-          jointCounts->insert(std::pair<std::string,float>(iter2->first,iter2->second));
-        if (!insertedJointCounts.second) {
-          (insertedJointCounts.first)->second += iter2->second;
-        }
-      }
+      countsLabelsLHS[iter2->first] += iter2->second;
+      (*jointCounts)[iter2->first] += iter2->second;
 
     }
   }
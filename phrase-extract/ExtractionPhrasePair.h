@@ -19,6 +19,7 @@
 
 #pragma once
 #include "tables-core.h"
+#include "util/string_piece.hh"
 
 #include <vector>
 #include <set>
@@ -142,27 +143,28 @@ public:
   void UpdateVocabularyFromValueTokens(const std::string& propertyKey,
                                        std::set<std::string>& vocabulary) const;
 
-  void AddProperties(const std::string &str, float count);
+  void AddProperties(const StringPiece &str, float count);
 
-  void AddProperty(const std::string &key, const std::string &value, float count) {
+  void AddProperty(const StringPiece &key, const StringPiece &value, float count) {
+    std::string keyString(key.data(), key.size());
     std::map<std::string,
-      std::pair< PROPERTY_VALUES*, LAST_PROPERTY_VALUE* > >::iterator iter = m_properties.find(key);
+      std::pair< PROPERTY_VALUES*, LAST_PROPERTY_VALUE* > >::iterator iter = m_properties.find(keyString);
     if ( iter == m_properties.end() ) {
       // key not found: insert property key and value
       PROPERTY_VALUES *propertyValues = new PROPERTY_VALUES();
-      std::pair<LAST_PROPERTY_VALUE,bool> insertedProperty = propertyValues->insert( std::pair<std::string,float>(value,count) );
+      std::pair<LAST_PROPERTY_VALUE,bool> insertedProperty = propertyValues->insert( std::pair<std::string,float>(value.as_string(),count) );
       LAST_PROPERTY_VALUE *lastPropertyValue = new LAST_PROPERTY_VALUE(insertedProperty.first);
-      m_properties[key] = std::pair< PROPERTY_VALUES*, LAST_PROPERTY_VALUE* >(propertyValues, lastPropertyValue);
+      m_properties[keyString] = std::pair< PROPERTY_VALUES*, LAST_PROPERTY_VALUE* >(propertyValues, lastPropertyValue);
     } else {
       LAST_PROPERTY_VALUE *lastPropertyValue = (iter->second).second;
-      if ( (*lastPropertyValue)->first == value ) { // same property key-value pair has been seen right before
+      if ( StringPiece((*lastPropertyValue)->first) == value ) { // same property key-value pair has been seen right before
         // property key-value pair exists already: add count
         (*lastPropertyValue)->second += count;
       } else { // need to check whether the property key-value pair has appeared before (insert if not)
         // property key exists, but not in combination with this value:
         // add new value with count
         PROPERTY_VALUES *propertyValues = (iter->second).first;
-        std::pair<LAST_PROPERTY_VALUE,bool> insertedProperty = propertyValues->insert( std::pair<std::string,float>(value,count) );
+        std::pair<LAST_PROPERTY_VALUE,bool> insertedProperty = propertyValues->insert( std::pair<std::string,float>(value.as_string(),count) );
         if ( !insertedProperty.second ) { // property value for this key appeared before: add count
           insertedProperty.first->second += count;
         }
@@ -0,0 +1,196 @@
+#include "OrderedBlockWriter.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "util/exception.hh"
+
+namespace MosesTraining
+{
+
+namespace
+{
+// Formats block, returning false with the message in error if it throws.
+bool FormatBlock(OrderedBlockWriter::Block &block, std::string &text, std::string &error)
+{
+  try {
+    std::ostringstream out;
+    block.Format(out);
+    text = out.str();
+    return true;
+  } catch (const std::exception &e) {
+    error = e.what();
+  } catch (...) {
+    error = "unknown error";
+  }
+  return false;
+}
+
+// The message of the block as it is, without where it is rethrown.
+void ThrowIfError(const std::string &error)
+{
+  if (error.empty()) return;
+  util::Exception e;
+  e << error;
+  throw e;
+}
+
+bool CommitBlock(OrderedBlockWriter::Block &block, std::string &error)
+{
+  try {
+    block.Commit();
+    return true;
+  } catch (const std::exception &e) {
+    error = e.what();
+  } catch (...) {
+    error = "unknown error";
+  }
+  return false;
+}
+}
+
+#ifdef WITH_THREADS
+
+class OrderedBlockWriter::Job : public Moses::Task
+{
+public:
+  Job(OrderedBlockWriter &writer, Block *block) : m_writer(writer), m_block(block), m_done(false) {}
+
+  void Run() {
+    FormatBlock(*m_block, m_text, m_error);
+    {
+      boost::lock_guard<boost::mutex> lock(m_writer.m_mutex);
+      m_done = true;
+    }
+    m_writer.m_changed.notify_all();
+  }
+
+private:
+  friend class OrderedBlockWriter;
+
+  OrderedBlockWriter &m_writer;
+  boost::scoped_ptr<Block> m_block;
+  std::string m_text;
+  std::string m_error;
+  bool m_done;
+};
+
+OrderedBlockWriter::OrderedBlockWriter(std::ostream &out, size_t threads)
+  : m_noOutput(NULL)
+  , m_out(out)
+  , m_finished(false)
+  , m_maxPending(4 * std::max<size_t>(threads, 1))
+  , m_pool(new Moses::ThreadPool(std::max<size_t>(threads, 1)))
+  , m_writer(boost::bind(&OrderedBlockWriter::Write, this))
+{
+}
+
+OrderedBlockWriter::OrderedBlockWriter(size_t threads)
+  : m_noOutput(NULL)
+  , m_out(m_noOutput)
+  , m_finished(false)
+  , m_maxPending(4 * std::max<size_t>(threads, 1))
+  , m_pool(new Moses::ThreadPool(std::max<size_t>(threads, 1)))
+  , m_writer(boost::bind(&OrderedBlockWriter::Write, this))
+{
+}
+
+OrderedBlockWriter::~OrderedBlockWriter()
+{
+  if (!m_finished) {
+    try {
+      Finish();
+    } catch (const util::Exception &) {
+      // reported by Finish() when called before
+    }
+  }
+}
+
+void OrderedBlockWriter::Add(Block *block)
+{
+  boost::shared_ptr<Job> job(new Job(*this, block));
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while (m_pending.size() >= m_maxPending) m_changed.wait(lock);
+    m_pending.push_back(job);
+  }
+  m_pool->Submit(job);
+}
+
+void OrderedBlockWriter::Write()
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while (true) {
+    while (!(m_pending.empty() ? m_finished : m_pending.front()->m_done)) {
+      m_changed.wait(lock);
+    }
+    if (m_pending.empty()) return;
+    boost::shared_ptr<Job> job(m_pending.front());
+    m_pending.pop_front();
+    m_changed.notify_all();
+    lock.unlock();
+    if (m_error.empty()) {
+      if (!job->m_error.empty()) {
+        m_error = job->m_error;
+      } else if (CommitBlock(*job->m_block, m_error)) {
+        m_out.write(job->m_text.data(), job->m_text.size());
+      }
+    }
+    job.reset();
+    lock.lock();
+  }
+}
+
+void OrderedBlockWriter::Finish()
+{
+  m_pool->Stop(true);
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_finished = true;
+  }
+  m_changed.notify_all();
+  m_writer.join();
+  m_out.flush();
+  ThrowIfError(m_error);
+}
+
+#else
+
+OrderedBlockWriter::OrderedBlockWriter(std::ostream &out, size_t)
+  : m_noOutput(NULL)
+  , m_out(out)
+  , m_finished(false)
+{
+}
+
+OrderedBlockWriter::OrderedBlockWriter(size_t)
+  : m_noOutput(NULL)
+  , m_out(m_noOutput)
+  , m_finished(false)
+{
+}
+
+OrderedBlockWriter::~OrderedBlockWriter() {}
+
+void OrderedBlockWriter::Add(Block *block)
+{
+  boost::scoped_ptr<Block> owned(block);
+  std::string text;
+  if (!m_error.empty()) return;
+  if (FormatBlock(*block, text, m_error) && CommitBlock(*block, m_error)) {
+    m_out.write(text.data(), text.size());
+  }
+}
+
+void OrderedBlockWriter::Finish()
+{
+  m_finished = true;
+  m_out.flush();
+  ThrowIfError(m_error);
+}
+
+#endif
+
+}
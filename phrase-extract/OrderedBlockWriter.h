@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <ostream>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "moses/ThreadPool.h"
+#endif
+
+namespace MosesTraining
+{
+
+/** Formats blocks of output on worker threads and writes them to a stream
+ *  in the order they were added, from one more thread, so the formatting,
+ *  the compression of the output and the reading of the input (e.g. with
+ *  util::LineBatchReader) all overlap. The output does not depend on the
+ *  number of threads. At most a few blocks per thread are held in memory;
+ *  Add() waits for the writer beyond that. Without threads, a block is
+ *  formatted and written when it is added.
+ */
+class OrderedBlockWriter : boost::noncopyable
+{
+public:
+  /** A piece of work whose output is written as one. Blocks are formatted
+   *  concurrently, so Format() must only read shared state. */
+  class Block
+  {
+  public:
+    virtual ~Block() {}
+    virtual void Format(std::ostream &out) = 0;
+
+    /** Called after Format(), one block at a time and in the order they
+     *  were added, just before the output is written: the place to update
+     *  totals over the whole input or print warnings. */
+    virtual void Commit() {}
+  };
+
+  OrderedBlockWriter(std::ostream &out, size_t threads);
+  //! for blocks that write to several outputs of their own, in Commit()
+  explicit OrderedBlockWriter(size_t threads);
+  //! call Finish() before, which reports the errors
+  ~OrderedBlockWriter();
+
+  //! takes ownership of block
+  void Add(Block *block);
+
+  /** Writes the remaining blocks. Throws util::Exception with the message
+   *  of the first block that threw; nothing after it is written. */
+  void Finish();
+
+private:
+  std::ostream m_noOutput;
+  std::ostream &m_out;
+  std::string m_error;
+  bool m_finished;
+
+#ifdef WITH_THREADS
+  class Job;
+
+  void Done();
+  void Write();
+
+  size_t m_maxPending;
+  std::deque<boost::shared_ptr<Job> > m_pending;
+  boost::mutex m_mutex;
+  boost::condition_variable m_changed;
+  boost::scoped_ptr<Moses::ThreadPool> m_pool;
+  boost::thread m_writer;
+#endif
+};
+
+}
@@ -23,9 +23,15 @@
 #include <limits>
 #include <vector>
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/string_piece_hash.hh"
+#include "util/tokenize_piece.hh"
 #include "moses/Util.h"
 #include "phrase-extract/InputFileStream.h"
 #include "phrase-extract/OutputFileStream.h"
+#include "phrase-extract/PropertiesIterator.h"
 
 
 namespace MosesTraining
@@ -47,7 +53,7 @@ void PropertiesConsolidator::ActivateSourceLabelsProcessing(const std::string &s
     } catch (const std::exception &e) {
       UTIL_THROW2("Error reading source label set file " << sourceLabelSetFile << " .");
     }
-    std::pair< std::map<std::string,size_t>::iterator, bool > inserted = m_sourceLabels.insert( std::pair<std::string,size_t>(label,index) );
+    std::pair< boost::unordered_map<std::string,size_t>::iterator, bool > inserted = m_sourceLabels.insert( std::pair<std::string,size_t>(label,index) );
     UTIL_THROW_IF2(!inserted.second,"Source label set file " << sourceLabelSetFile << " should contain each syntactic label only once.");
   }
 
@@ -73,7 +79,7 @@ void PropertiesConsolidator::ActivatePartsOfSpeechProcessing(const std::string &
     } catch (const std::exception &e) {
       UTIL_THROW2("Error reading part-of-speech vocabulary file " << partsOfSpeechFile << " .");
     }
-    std::pair< std::map<std::string,size_t>::iterator, bool > inserted = m_partsOfSpeechVocabulary.insert( std::pair<std::string,size_t>(label,index) );
+    std::pair< boost::unordered_map<std::string,size_t>::iterator, bool > inserted = m_partsOfSpeechVocabulary.insert( std::pair<std::string,size_t>(label,index) );
     UTIL_THROW_IF2(!inserted.second,"Part-of-speech vocabulary file " << partsOfSpeechFile << " should contain each POS tag only once.");
   }
 
@@ -83,160 +89,161 @@ void PropertiesConsolidator::ActivatePartsOfSpeechProcessing(const std::string &
 }
 
 
-void PropertiesConsolidator::ProcessPropertiesString(const std::string &propertiesString, Moses::OutputFileStream& out) const
+void PropertiesConsolidator::ProcessPropertiesString(const StringPiece &propertiesString, std::ostream& out) const
 {
-  if ( propertiesString.empty() ) {
-    return;
-  }
+  PropertiesIterator property(propertiesString);
+  StringPiece key, value;
+  while (property.Next(key, value)) {
 
-  std::vector<std::string> toks;
-  Moses::TokenizeMultiCharSeparator(toks, propertiesString, "{{");
-  for (size_t i = 1; i < toks.size(); ++i) {
-    std::string &tok = toks[i];
-    if (tok.empty()) {
-      continue;
-    }
-    size_t endPos = tok.rfind("}");
-    tok = tok.substr(0, endPos - 1);
-    std::vector<std::string> keyValue = Moses::TokenizeFirstOnly(tok, " ");
-    assert(keyValue.size() == 2);
-
-    if ( !keyValue[0].compare("SourceLabels") ) {
+    if ( key == "SourceLabels" ) {
 
       if ( m_sourceLabelsFlag ) {
 
         // SourceLabels property: replace strings with vocabulary indices
-        out << " {{" << keyValue[0];
-        ProcessSourceLabelsPropertyValue(keyValue[1], out);
+        out << " {{" << key;
+        ProcessSourceLabelsPropertyValue(value, out);
         out << "}}";
 
       } else { // don't process SourceLabels property
-        out << " {{" << keyValue[0] << " " << keyValue[1] << "}}";
+        out << " {{" << key << " " << value << "}}";
       }
 
-    } else if ( !keyValue[0].compare("POS") ) {
+    } else if ( key == "POS" ) {
 
 /* DO NOTHING (property is not registered in the decoder at the moment)
       if ( m_partsOfSpeechFlag ) {
 
         // POS property: replace strings with vocabulary indices
-        out << " {{" << keyValue[0];
-        ProcessPOSPropertyValue(keyValue[1], out);
+        out << " {{" << key;
+        ProcessPOSPropertyValue(value, out);
         out << "}}";
 
       } else { // don't process POS property
-        out << " {{" << keyValue[0] << " " << keyValue[1] << "}}";
+        out << " {{" << key << " " << value << "}}";
       }
 */
 
     } else {
 
       // output other property
-      out << " {{" << keyValue[0] << " " << keyValue[1] << "}}";
+      out << " {{" << key << " " << value << "}}";
     }
   }
 }
 
 
-void PropertiesConsolidator::ProcessSourceLabelsPropertyValue(const std::string &value, Moses::OutputFileStream& out) const
+namespace
+{
+
+typedef util::TokenIter<util::AnyCharacter, true> ValueTokenIter;
+
+// Copies the token of a property value with a terminating NUL for strtoul
+// and strtod; false if there is none or it is too long to be a number.
+bool CopyToken(const ValueTokenIter &token, char (&buffer)[64])
+{
+  if (!token || token->size() >= sizeof(buffer)) return false;
+  memcpy(buffer, token->data(), token->size());
+  buffer[token->size()] = '\0';
+  return true;
+}
+
+// Read the next token of a property value as a number.
+bool ReadCount(ValueTokenIter &token, size_t &count)
+{
+  char buffer[64], *end;
+  if (!CopyToken(token, buffer)) return false;
+  count = strtoul(buffer, &end, 10);
+  ++token;
+  return end != buffer;
+}
+
+bool ReadCount(ValueTokenIter &token, double &count)
+{
+  char buffer[64], *end;
+  if (!CopyToken(token, buffer)) return false;
+  count = strtod(buffer, &end);
+  ++token;
+  return end != buffer;
+}
+
+}
+
+
+void PropertiesConsolidator::ProcessSourceLabelsPropertyValue(const StringPiece &value, std::ostream& out) const
 {
   // SourceLabels property: replace strings with vocabulary indices
-  std::istringstream tokenizer(value);
+  ValueTokenIter token(value, util::AnyCharacter(" \t"));
 
   size_t nNTs;
-  double totalCount;
-
-  if (! (tokenizer >> nNTs)) { // first token: number of non-terminals (incl. left-hand side)
+  if (! ReadCount(token, nNTs)) { // first token: number of non-terminals (incl. left-hand side)
     UTIL_THROW2("Not able to read number of non-terminals from SourceLabels property. "
                 << "Flawed SourceLabels property?");
   }
   assert( nNTs > 0 );
   out << " " << nNTs;
 
-  if (! (tokenizer >> totalCount)) { // second token: overall rule count
+  double totalCount;
+  if (! ReadCount(token, totalCount)) { // second token: overall rule count
     UTIL_THROW2("Not able to read overall rule count from SourceLabels property. "
                 << "Flawed SourceLabels property?");
   }
   assert( totalCount > 0.0 );
   out << " " << totalCount;
 
-  while (tokenizer.peek() != EOF) {
-    try {
-
-      size_t numberOfLHSsGivenRHS = std::numeric_limits<std::size_t>::max();
-
-      std::string token;
-
-      if (nNTs > 1) { // rule has right-hand side non-terminals, i.e. it's a hierarchical rule
-        for (size_t i=0; i<nNTs-1; ++i) { // RHS source non-terminal labels
-          tokenizer >> token; // RHS source non-terminal label
-          std::map<std::string,size_t>::const_iterator found = m_sourceLabels.find(token);
-          UTIL_THROW_IF2(found == m_sourceLabels.end(), "Label \"" << token << "\" from the phrase table not found in given label set.");
-          out << " " << found->second;
-        }
-
-        tokenizer >> token; // sourceLabelsRHSCount
-        out << " " << token;
+  while (token) {
+    size_t numberOfLHSsGivenRHS = std::numeric_limits<std::size_t>::max();
 
-        tokenizer >> numberOfLHSsGivenRHS;
-        out << " " << numberOfLHSsGivenRHS;
+    if (nNTs > 1) { // rule has right-hand side non-terminals, i.e. it's a hierarchical rule
+      for (size_t i=0; i<nNTs-1; ++i) { // RHS source non-terminal labels
+        UTIL_THROW_IF2(!token, "Flawed item in SourceLabels property?");
+        boost::unordered_map<std::string,size_t>::const_iterator found = FindStringPiece(m_sourceLabels, *token);
+        UTIL_THROW_IF2(found == m_sourceLabels.end(), "Label \"" << *token << "\" from the phrase table not found in given label set.");
+        out << " " << found->second;
+        ++token;
       }
 
-      for (size_t i=0; i<numberOfLHSsGivenRHS && tokenizer.peek()!=EOF; ++i) { // LHS source non-terminal labels seen with this RHS
-        tokenizer >> token; // LHS source non-terminal label
-        std::map<std::string,size_t>::const_iterator found = m_sourceLabels.find(token);
-        UTIL_THROW_IF2(found == m_sourceLabels.end() ,"Label \"" << token << "\" from the phrase table not found in given label set.");
-        out << " " << found->second;
+      UTIL_THROW_IF2(!token, "Flawed item in SourceLabels property?");
+      out << " " << *token; // sourceLabelsRHSCount
+      ++token;
 
-        tokenizer >> token; // ruleSourceLabelledCount
-        out << " " << token;
-      }
+      UTIL_THROW_IF2(!ReadCount(token, numberOfLHSsGivenRHS), "Flawed item in SourceLabels property?");
+      out << " " << numberOfLHSsGivenRHS;
+    }
 
-    } catch (const std::exception &e) {
-      UTIL_THROW2("Flawed item in SourceLabels property?");
+    for (size_t i=0; i<numberOfLHSsGivenRHS && token; ++i) { // LHS source non-terminal labels seen with this RHS
+      boost::unordered_map<std::string,size_t>::const_iterator found = FindStringPiece(m_sourceLabels, *token);
+      UTIL_THROW_IF2(found == m_sourceLabels.end() ,"Label \"" << *token << "\" from the phrase table not found in given label set.");
+      out << " " << found->second;
+      ++token;
+
+      UTIL_THROW_IF2(!token, "Flawed item in SourceLabels property?");
+      out << " " << *token; // ruleSourceLabelledCount
+      ++token;
     }
   }
 }
 
 
-void PropertiesConsolidator::ProcessPOSPropertyValue(const std::string &value, Moses::OutputFileStream& out) const
+void PropertiesConsolidator::ProcessPOSPropertyValue(const StringPiece &value, std::ostream& out) const
 {
-  std::istringstream tokenizer(value);
-  while (tokenizer.peek() != EOF) {
-    std::string token;
-    tokenizer >> token;
-    std::map<std::string,size_t>::const_iterator found = m_partsOfSpeechVocabulary.find(token);
-    UTIL_THROW_IF2(found == m_partsOfSpeechVocabulary.end() ,"Part-of-speech \"" << token << "\" from the phrase table not found in given part-of-speech vocabulary.");
+  for (ValueTokenIter token(value, util::AnyCharacter(" \t")); token; ++token) {
+    boost::unordered_map<std::string,size_t>::const_iterator found = FindStringPiece(m_partsOfSpeechVocabulary, *token);
+    UTIL_THROW_IF2(found == m_partsOfSpeechVocabulary.end() ,"Part-of-speech \"" << *token << "\" from the phrase table not found in given part-of-speech vocabulary.");
     out << " " << found->second;
   }
 }
 
 
-bool PropertiesConsolidator::GetPOSPropertyValueFromPropertiesString(const std::string &propertiesString, std::vector<std::string>& out) const
+bool PropertiesConsolidator::GetPOSPropertyValueFromPropertiesString(const StringPiece &propertiesString, std::vector<std::string>& out) const
 {
   out.clear();
-  if ( propertiesString.empty() ) {
-    return false;
-  }
 
-  std::vector<std::string> toks;
-  Moses::TokenizeMultiCharSeparator(toks, propertiesString, "{{");
-  for (size_t i = 1; i < toks.size(); ++i) {
-    std::string &tok = toks[i];
-    if (tok.empty()) {
-      continue;
-    }
-    size_t endPos = tok.rfind("}");
-    tok = tok.substr(0, endPos - 1);
-    std::vector<std::string> keyValue = Moses::TokenizeFirstOnly(tok, " ");
-    assert(keyValue.size() == 2);
-
-    if ( !keyValue[0].compare("POS") ) {
-      std::istringstream tokenizer(keyValue[1]);
-      while (tokenizer.peek() != EOF) {
-        std::string token;
-        tokenizer >> token;
-        out.push_back(token);
+  PropertiesIterator property(propertiesString);
+  StringPiece key, value;
+  while (property.Next(key, value)) {
+    if ( key == "POS" ) {
+      for (ValueTokenIter token(value, util::AnyCharacter(" \t")); token; ++token) {
+        out.push_back(token->as_string());
       }
       return true;
     }
@@ -247,4 +254,3 @@ bool PropertiesConsolidator::GetPOSPropertyValueFromPropertiesString(const std::
 
 
 }  // namespace MosesTraining
-
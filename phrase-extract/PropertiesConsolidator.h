@@ -21,9 +21,11 @@
 #pragma once
 
 #include <string>
-#include <map>
 #include <vector>
 
+#include <boost/unordered_map.hpp>
+
+#include "util/string_piece.hh"
 #include "OutputFileStream.h"
 
 
@@ -34,24 +36,24 @@ class PropertiesConsolidator
 {
 public:
 
-  PropertiesConsolidator() : m_sourceLabelsFlag(false) {};
+  PropertiesConsolidator() : m_sourceLabelsFlag(false), m_partsOfSpeechFlag(false) {};
 
   void ActivateSourceLabelsProcessing(const std::string &sourceLabelSetFile);
   void ActivatePartsOfSpeechProcessing(const std::string &partsOfSpeechFile);
 
-  bool GetPOSPropertyValueFromPropertiesString(const std::string &propertiesString, std::vector<std::string>& out) const;
+  bool GetPOSPropertyValueFromPropertiesString(const StringPiece &propertiesString, std::vector<std::string>& out) const;
 
-  void ProcessPropertiesString(const std::string &propertiesString, Moses::OutputFileStream& out) const;
+  void ProcessPropertiesString(const StringPiece &propertiesString, std::ostream& out) const;
 
 protected:
 
-  void ProcessSourceLabelsPropertyValue(const std::string &value, Moses::OutputFileStream& out) const;
-  void ProcessPOSPropertyValue(const std::string &value, Moses::OutputFileStream& out) const;
+  void ProcessSourceLabelsPropertyValue(const StringPiece &value, std::ostream& out) const;
+  void ProcessPOSPropertyValue(const StringPiece &value, std::ostream& out) const;
 
   bool m_sourceLabelsFlag;
-  std::map<std::string,size_t> m_sourceLabels;
+  boost::unordered_map<std::string,size_t> m_sourceLabels;
   bool m_partsOfSpeechFlag;
-  std::map<std::string,size_t> m_partsOfSpeechVocabulary;
+  boost::unordered_map<std::string,size_t> m_partsOfSpeechVocabulary;
 
 };
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "util/string_piece.hh"
+
+namespace MosesTraining
+{
+
+/** Steps through the "{{key value}}" items of the properties field of an
+ *  extract file or phrase table line, without copying them. Anything before
+ *  the first "{{" is ignored, as are empty items and items without a value.
+ */
+class PropertiesIterator
+{
+public:
+  explicit PropertiesIterator(const StringPiece &properties)
+    : m_rest(properties)
+    , m_more(true) {
+    NextItem();
+  }
+
+  //! false after the last item
+  bool Next(StringPiece &key, StringPiece &value) {
+    while (m_more) {
+      StringPiece item = NextItem();
+      if (item.empty()) {
+        continue;
+      }
+      // strip the closing "}}" and whatever follows it
+      size_t endPos = item.rfind('}');
+      if (endPos != StringPiece::npos && endPos > 0) {
+        item = item.substr(0, endPos - 1);
+      }
+      size_t space = item.find(' ');
+      if (space == StringPiece::npos) {
+        continue;
+      }
+      key = item.substr(0, space);
+      value = item.substr(space + 1);
+      return true;
+    }
+    return false;
+  }
+
+private:
+  StringPiece m_rest;
+  bool m_more;
+
+  StringPiece NextItem() {
+    size_t pos = m_rest.find(StringPiece("{{", 2));
+    if (pos == StringPiece::npos) {
+      m_more = false;
+      return m_rest;
+    }
+    StringPiece item = m_rest.substr(0, pos);
+    m_rest = m_rest.substr(pos + 2);
+    return item;
+  }
+};
+
+}  // namespace MosesTraining
@@ -0,0 +1,98 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2009 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Binarize a lexical translation table (lex.e2f, lex.f2e, or a GIZA++ model 1
+// table with its vocabularies) for score, score-stsg and Model1Feature.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "moses/MappedLexicalTable.h"
+#include "moses/Util.h"
+#include "InputFileStream.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace
+{
+
+// GIZA++ vocabulary: "id word count", id 0 is the empty word
+void loadVocabulary(const string &fileName, vector<string> &vocab)
+{
+  Moses::InputFileStream in(fileName);
+  if (in.fail()) {
+    cerr << "ERROR: could not open vocabulary file " << fileName << endl;
+    exit(1);
+  }
+  vocab.assign(1, "GIZANULL");
+  string line;
+  while (getline(in, line)) {
+    vector<string> token;
+    Moses::Tokenize(token, line);
+    if (token.size() != 3) continue;
+    size_t id = Moses::Scan<size_t>(token[0]);
+    if (id == 0) continue;
+    if (vocab.size() <= id) vocab.resize(id + 1);
+    vocab[id] = token[1];
+  }
+}
+
+void usage()
+{
+  cerr << "syntax: binarize-lex [--first-vocab FILE --second-vocab FILE] lex-table binary-table" << endl
+       << "  the vocabularies are for tables of GIZA++ word ids (e.g. *.t1.5 with" << endl
+       << "  source and target *.vcb, for Model1Feature)" << endl;
+  exit(1);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  vector<string> firstVocab, secondVocab;
+  vector<string> files;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--first-vocab") == 0 && i + 1 < argc) {
+      loadVocabulary(argv[++i], firstVocab);
+    } else if (strcmp(argv[i], "--second-vocab") == 0 && i + 1 < argc) {
+      loadVocabulary(argv[++i], secondVocab);
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      usage();
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.size() != 2 || firstVocab.empty() != secondVocab.empty()) {
+    usage();
+  }
+
+  try {
+    Moses::MappedLexicalTable::Create(files[0], files[1],
+                                      firstVocab.empty() ? NULL : &firstVocab,
+                                      secondVocab.empty() ? NULL : &secondVocab);
+  } catch (const util::Exception &e) {
+    cerr << "ERROR: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -23,7 +23,8 @@
 #include <string>
 #include <iostream>
 #include <cstdlib>
-#include "InputFileStream.h"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
 #include "OutputFileStream.h"
 
 using namespace std;
@@ -52,13 +53,10 @@ vector< string > splitLine(const char *line)
   return item;
 }
 
-bool getLine( istream &fileP, vector< string > &item )
+bool getLine( util::LineBatchReader &fileP, vector< string > &item )
 {
-  if (fileP.eof())
-    return false;
-
   string line;
-  if (getline(fileP, line)) {
+  if (fileP.ReadLine(line)) {
     item = splitLine(line.c_str());
     return true;
   } else {
@@ -72,15 +70,8 @@ int main(int argc, char* argv[])
   cerr << "Starting..." << endl;
 
   char* &fileNameDirect = argv[1];
-  Moses::InputFileStream fileDirect(fileNameDirect);
-
-
-  //fileDirect.open(fileNameDirect);
-  if (fileDirect.fail()) {
-    cerr << "ERROR: could not open extract file " << fileNameDirect << endl;
-    exit(1);
-  }
-  istream &fileDirectP = fileDirect;
+  // read and decompressed in the background
+  util::LineBatchReader fileDirectP(util::OpenReadOrThrow(fileNameDirect));
 
   char* &fileNameConsolidated = argv[2];
   ostream *fileConsolidated;
@@ -119,7 +110,7 @@ int main(int argc, char* argv[])
                         << prob << " ||| "                 // prob
                         << itemDirect[2] << "||| "        // alignment
                         << itemDirect[4] << " " << countEF // counts
-                        << " ||| " << endl;
+                        << " ||| " << '\n';
   }
 
   fileConsolidated->flush();
@@ -21,8 +21,11 @@
 #include <string>
 
 #include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
 #include "moses/Util.h"
 #include "InputFileStream.h"
+#include "OrderedBlockWriter.h"
 #include "OutputFileStream.h"
 #include "PropertiesConsolidator.h"
 
@@ -47,11 +50,15 @@ std::vector< float > countOfCounts;
 std::vector< float > goodTuringDiscount;
 float kneserNey_D1, kneserNey_D2, kneserNey_D3, totalCount = -1;
 
+size_t threads = 1;
+// line pairs consolidated by one thread at a time
+const size_t kBlockLines = 4096;
+
 
 void processFiles( const std::string&, const std::string&, const std::string&, const std::string&, const std::string&, const std::string& );
 void loadCountOfCounts( const std::string& );
+void processLine( const std::vector< std::string >&, const std::vector< std::string >&, int, const MosesTraining::PropertiesConsolidator&, std::ostream& );
 void breakdownCoreAndSparse( const std::string &combined, std::string &core, std::string &sparse );
-bool getLine( Moses::InputFileStream &file, std::vector< std::string > &item );
 
 
 inline float maybeLogProb( float a )
@@ -72,7 +79,8 @@ int main(int argc, char* argv[])
             << "consolidating direct and indirect rule tables" << std::endl;
 
   if (argc < 4) {
-    std::cerr << "syntax: consolidate phrase-table.direct phrase-table.indirect phrase-table.consolidated [--Hierarchical] [--OnlyDirect] [--PhraseCount] [--GoodTuring counts-of-counts-file] [--KneserNey counts-of-counts-file] [--LowCountFeature] [--SourceLabels source-labels-file] [--PartsOfSpeech parts-of-speech-file] [--MinScore id:threshold[,id:threshold]*]" << std::endl;
+    std::cerr << "syntax: consolidate phrase-table.direct phrase-table.indirect phrase-table.consolidated [--Hierarchical] [--OnlyDirect] [--PhraseCount] [--GoodTuring counts-of-counts-file] [--KneserNey counts-of-counts-file] [--LowCountFeature] [--SourceLabels source-labels-file] [--PartsOfSpeech parts-of-speech-file] [--MinScore id:threshold[,id:threshold]*] [--Threads n]" << std::endl
+              << "phrase-table.consolidated may be - for stdout" << std::endl;
     exit(1);
   }
   const std::string fileNameDirect = argv[1];
@@ -165,6 +173,16 @@ int main(int argc, char* argv[])
           UTIL_THROW2("MinScore currently only supported for indirect (0) and direct (2) phrase translation probabilities");
         }
       }
+    } else if (strcmp(argv[i],"--Threads") == 0 ||
+               strcmp(argv[i],"--threads") == 0 ||
+               strcmp(argv[i],"-threads") == 0) {
+      UTIL_THROW_IF2(i+1==argc, "specify the number of threads!");
+      threads = Moses::Scan<size_t>(argv[++i]);
+#ifndef WITH_THREADS
+      UTIL_THROW_IF2(threads > 1, "consolidate was compiled without threads");
+#endif
+      if (threads == 0) threads = 1;
+      std::cerr << "consolidating with " << threads << " threads" << std::endl;
     } else {
       UTIL_THROW2("unknown option " << argv[i]);
     }
@@ -214,26 +232,56 @@ void loadCountOfCounts( const std::string& fileNameCountOfCounts )
 }
 
 
-void processFiles( const std::string& fileNameDirect, 
-                   const std::string& fileNameIndirect, 
-                   const std::string& fileNameConsolidated, 
-                   const std::string& fileNameCountOfCounts, 
-                   const std::string& fileNameSourceLabelSet, 
+/** A run of consecutive line pairs of the direct and indirect tables. Every
+ *  pair is consolidated on its own, so blocks can end anywhere. */
+class ConsolidateBlock : public MosesTraining::OrderedBlockWriter::Block
+{
+public:
+  ConsolidateBlock(const MosesTraining::PropertiesConsolidator &propertiesConsolidator, int firstLine)
+    : m_propertiesConsolidator(propertiesConsolidator)
+    , m_firstLine(firstLine) {
+  }
+
+  std::vector< std::string > m_direct, m_indirect;
+
+  void Format(std::ostream &out) {
+    std::vector< std::string > itemDirect, itemIndirect;
+    for (size_t j=0; j<m_direct.size(); ++j) {
+      itemDirect.clear();
+      itemIndirect.clear();
+      Moses::TokenizeMultiCharSeparator(itemDirect, m_direct[j], " ||| ");
+      Moses::TokenizeMultiCharSeparator(itemIndirect, m_indirect[j], " ||| ");
+      processLine( itemDirect, itemIndirect, m_firstLine + (int)j, m_propertiesConsolidator, out );
+    }
+  }
+
+private:
+  const MosesTraining::PropertiesConsolidator &m_propertiesConsolidator;
+  int m_firstLine;
+};
+
+
+void processFiles( const std::string& fileNameDirect,
+                   const std::string& fileNameIndirect,
+                   const std::string& fileNameConsolidated,
+                   const std::string& fileNameCountOfCounts,
+                   const std::string& fileNameSourceLabelSet,
                    const std::string& fileNamePartsOfSpeechVocabulary )
 {
   if (goodTuringFlag || kneserNeyFlag)
     loadCountOfCounts( fileNameCountOfCounts );
 
-  // open input files
-  Moses::InputFileStream fileDirect(fileNameDirect);
-  UTIL_THROW_IF2(fileDirect.fail(), "could not open phrase table file " << fileNameDirect);
-  Moses::InputFileStream fileIndirect(fileNameIndirect);
-  UTIL_THROW_IF2(fileIndirect.fail(), "could not open phrase table file " << fileNameIndirect);
+  // open input files; both are read and decompressed in the background
+  util::LineBatchReader fileDirect(util::OpenReadOrThrow(fileNameDirect.c_str()));
+  util::LineBatchReader fileIndirect(util::OpenReadOrThrow(fileNameIndirect.c_str()));
 
   // open output file: consolidated phrase table
   Moses::OutputFileStream fileConsolidated;
-  bool success = fileConsolidated.Open(fileNameConsolidated);
-  UTIL_THROW_IF2(!success, "could not open output file " << fileNameConsolidated);
+  if (fileNameConsolidated != "-") {
+    bool success = fileConsolidated.Open(fileNameConsolidated);
+    UTIL_THROW_IF2(!success, "could not open output file " << fileNameConsolidated);
+  }
+  std::ostream &out = fileNameConsolidated == "-" ? std::cout : fileConsolidated;
 
   // create properties consolidator
   // (in case any additional phrase property requires further processing)
@@ -246,185 +294,207 @@ void processFiles( const std::string& fileNameDirect,
   }
 
   // loop through all extracted phrase translations
+  MosesTraining::OrderedBlockWriter writer(out, threads);
+  ConsolidateBlock *block = NULL;
   int i=0;
   while(true) {
     i++;
     if (i%100000 == 0) std::cerr << "." << std::flush;
 
-    std::vector< std::string > itemDirect, itemIndirect;
-    if (! getLine(fileIndirect, itemIndirect) ||
-        ! getLine(fileDirect, itemDirect))
+    std::string lineDirect, lineIndirect;
+    if (! fileIndirect.ReadLine(lineIndirect) ||
+        ! fileDirect.ReadLine(lineDirect))
       break;
 
-    // direct: target source alignment probabilities
-    // indirect: source target probabilities
-
-    // consistency checks
-    UTIL_THROW_IF2(itemDirect[0].compare( itemIndirect[0] ) != 0, 
-                   "target phrase does not match in line " << i << ": '" << itemDirect[0] << "' != '" << itemIndirect[0] << "'");
-    UTIL_THROW_IF2(itemDirect[1].compare( itemIndirect[1] ) != 0, 
-                   "source phrase does not match in line " << i << ": '" << itemDirect[1] << "' != '" << itemIndirect[1] << "'");
-
-    // SCORES ...
-    std::string directScores, directSparseScores, indirectScores, indirectSparseScores;
-    breakdownCoreAndSparse( itemDirect[3], directScores, directSparseScores );
-    breakdownCoreAndSparse( itemIndirect[3], indirectScores, indirectSparseScores );
-
-    std::vector<std::string> directCounts;
-    Moses::Tokenize( directCounts, itemDirect[4] );
-    std::vector<std::string> indirectCounts;
-    Moses::Tokenize( indirectCounts, itemIndirect[4] );
-    float countF = Moses::Scan<float>(directCounts[0]);
-    float countE = Moses::Scan<float>(indirectCounts[0]);
-    float countEF = Moses::Scan<float>(indirectCounts[1]);
-    float n1_F, n1_E;
-    if (kneserNeyFlag) {
-      n1_F = Moses::Scan<float>(directCounts[2]);
-      n1_E = Moses::Scan<float>(indirectCounts[2]);
+    if (!block) block = new ConsolidateBlock(propertiesConsolidator, i);
+    block->m_direct.push_back(lineDirect);
+    block->m_indirect.push_back(lineIndirect);
+    if (block->m_direct.size() == kBlockLines) {
+      writer.Add(block);
+      block = NULL;
     }
+  }
+  if (block) writer.Add(block);
+  writer.Finish();
 
-    // Good Turing discounting
-    float adjustedCountEF = countEF;
-    if (goodTuringFlag && countEF+0.99999 < goodTuringDiscount.size()-1)
-      adjustedCountEF *= goodTuringDiscount[(int)(countEF+0.99998)];
-    float adjustedCountEF_indirect = adjustedCountEF;
-
-    // Kneser Ney discounting [Foster et al, 2006]
-    if (kneserNeyFlag) {
-      float D = kneserNey_D3;
-      if (countEF < 2) D = kneserNey_D1;
-      else if (countEF < 3) D = kneserNey_D2;
-      if (D > countEF) D = countEF - 0.01; // sanity constraint
-
-      float p_b_E = n1_E / totalCount; // target phrase prob based on distinct
-      float alpha_F = D * n1_F / countF; // available mass
-      adjustedCountEF = countEF - D + countF * alpha_F * p_b_E;
-
-      // for indirect
-      float p_b_F = n1_F / totalCount; // target phrase prob based on distinct
-      float alpha_E = D * n1_E / countE; // available mass
-      adjustedCountEF_indirect = countEF - D + countE * alpha_E * p_b_F;
-    }
+  if (fileNameConsolidated != "-") {
+    fileConsolidated.Close();
+  } else {
+    std::cout.flush();
+  }
+}
 
-    // drop due to MinScore thresholding
-    if ((minScore0 > 0 && adjustedCountEF_indirect/countE < minScore0) ||
-        (minScore2 > 0 && adjustedCountEF         /countF < minScore2)) {
-      continue;
-    }
 
-    // output phrase pair
-    fileConsolidated << itemDirect[0] << " ||| ";
-
-    if (partsOfSpeechFlag) {
-      // write POS factor from property
-      std::vector<std::string> targetTokens;
-      Moses::Tokenize( targetTokens, itemDirect[1] );
-      std::vector<std::string> propertyValuePOS;
-      propertiesConsolidator.GetPOSPropertyValueFromPropertiesString(itemDirect[5], propertyValuePOS);
-      size_t targetTerminalIndex = 0;
-      for (std::vector<std::string>::const_iterator targetTokensIt=targetTokens.begin();
-           targetTokensIt!=targetTokens.end(); ++targetTokensIt) {
-        fileConsolidated << *targetTokensIt;
-        if (!isNonTerminal(*targetTokensIt)) {
-          assert(propertyValuePOS.size() > targetTerminalIndex);
-          fileConsolidated << "|" << propertyValuePOS[targetTerminalIndex];
-          ++targetTerminalIndex;
-        }
-        fileConsolidated << " ";
-      }
-      fileConsolidated << "|||";
+void processLine( const std::vector< std::string > &itemDirect,
+                  const std::vector< std::string > &itemIndirect,
+                  int i,
+                  const MosesTraining::PropertiesConsolidator &propertiesConsolidator,
+                  std::ostream &fileConsolidated )
+{
+  // direct: target source alignment probabilities
+  // indirect: source target probabilities
+
+  // consistency checks
+  UTIL_THROW_IF2(itemDirect[0].compare( itemIndirect[0] ) != 0, 
+                 "target phrase does not match in line " << i << ": '" << itemDirect[0] << "' != '" << itemIndirect[0] << "'");
+  UTIL_THROW_IF2(itemDirect[1].compare( itemIndirect[1] ) != 0, 
+                 "source phrase does not match in line " << i << ": '" << itemDirect[1] << "' != '" << itemIndirect[1] << "'");
+
+  // SCORES ...
+  std::string directScores, directSparseScores, indirectScores, indirectSparseScores;
+  breakdownCoreAndSparse( itemDirect[3], directScores, directSparseScores );
+  breakdownCoreAndSparse( itemIndirect[3], indirectScores, indirectSparseScores );
+
+  std::vector<std::string> directCounts;
+  Moses::Tokenize( directCounts, itemDirect[4] );
+  std::vector<std::string> indirectCounts;
+  Moses::Tokenize( indirectCounts, itemIndirect[4] );
+  float countF = Moses::Scan<float>(directCounts[0]);
+  float countE = Moses::Scan<float>(indirectCounts[0]);
+  float countEF = Moses::Scan<float>(indirectCounts[1]);
+  float n1_F, n1_E;
+  if (kneserNeyFlag) {
+    n1_F = Moses::Scan<float>(directCounts[2]);
+    n1_E = Moses::Scan<float>(indirectCounts[2]);
+  }
 
-    } else {
+  // Good Turing discounting
+  float adjustedCountEF = countEF;
+  if (goodTuringFlag && countEF+0.99999 < goodTuringDiscount.size()-1)
+    adjustedCountEF *= goodTuringDiscount[(int)(countEF+0.99998)];
+  float adjustedCountEF_indirect = adjustedCountEF;
+
+  // Kneser Ney discounting [Foster et al, 2006]
+  if (kneserNeyFlag) {
+    float D = kneserNey_D3;
+    if (countEF < 2) D = kneserNey_D1;
+    else if (countEF < 3) D = kneserNey_D2;
+    if (D > countEF) D = countEF - 0.01; // sanity constraint
+
+    float p_b_E = n1_E / totalCount; // target phrase prob based on distinct
+    float alpha_F = D * n1_F / countF; // available mass
+    adjustedCountEF = countEF - D + countF * alpha_F * p_b_E;
+
+    // for indirect
+    float p_b_F = n1_F / totalCount; // target phrase prob based on distinct
+    float alpha_E = D * n1_E / countE; // available mass
+    adjustedCountEF_indirect = countEF - D + countE * alpha_E * p_b_F;
+  }
 
-      fileConsolidated << itemDirect[1] << " |||";
-    }
+  // drop due to MinScore thresholding
+  if ((minScore0 > 0 && adjustedCountEF_indirect/countE < minScore0) ||
+      (minScore2 > 0 && adjustedCountEF         /countF < minScore2)) {
+    return;
+  }
 
+  // output phrase pair
+  fileConsolidated << itemDirect[0] << " ||| ";
 
-    // prob indirect
-    if (!onlyDirectFlag) {
-      fileConsolidated << " " << maybeLogProb(adjustedCountEF_indirect/countE);
-      fileConsolidated << " " << indirectScores;
+  if (partsOfSpeechFlag) {
+    // write POS factor from property
+    std::vector<std::string> targetTokens;
+    Moses::Tokenize( targetTokens, itemDirect[1] );
+    std::vector<std::string> propertyValuePOS;
+    propertiesConsolidator.GetPOSPropertyValueFromPropertiesString(itemDirect[5], propertyValuePOS);
+    size_t targetTerminalIndex = 0;
+    for (std::vector<std::string>::const_iterator targetTokensIt=targetTokens.begin();
+         targetTokensIt!=targetTokens.end(); ++targetTokensIt) {
+      fileConsolidated << *targetTokensIt;
+      if (!isNonTerminal(*targetTokensIt)) {
+        assert(propertyValuePOS.size() > targetTerminalIndex);
+        fileConsolidated << "|" << propertyValuePOS[targetTerminalIndex];
+        ++targetTerminalIndex;
+      }
+      fileConsolidated << " ";
     }
+    fileConsolidated << "|||";
 
-    // prob direct
-    fileConsolidated << " " << maybeLogProb(adjustedCountEF/countF);
-    fileConsolidated << " " << directScores;
+  } else {
 
-    // phrase count feature
-    if (phraseCountFlag) {
-      fileConsolidated << " " << maybeLogProb(2.718);
-    }
+    fileConsolidated << itemDirect[1] << " |||";
+  }
 
-    // low count feature
-    if (lowCountFlag) {
-      fileConsolidated << " " << maybeLogProb(std::exp(-1.0/countEF));
-    }
 
-    // count bin feature (as a core feature)
-    if (countBin.size()>0 && !sparseCountBinFeatureFlag) {
-      bool foundBin = false;
-      for(size_t i=0; i < countBin.size(); i++) {
-        if (!foundBin && countEF <= countBin[i]) {
-          fileConsolidated << " " << maybeLogProb(2.718);
-          foundBin = true;
-        } else {
-          fileConsolidated << " " << maybeLogProb(1);
-        }
+  // prob indirect
+  if (!onlyDirectFlag) {
+    fileConsolidated << " " << maybeLogProb(adjustedCountEF_indirect/countE);
+    fileConsolidated << " " << indirectScores;
+  }
+
+  // prob direct
+  fileConsolidated << " " << maybeLogProb(adjustedCountEF/countF);
+  fileConsolidated << " " << directScores;
+
+  // phrase count feature
+  if (phraseCountFlag) {
+    fileConsolidated << " " << maybeLogProb(2.718);
+  }
+
+  // low count feature
+  if (lowCountFlag) {
+    fileConsolidated << " " << maybeLogProb(std::exp(-1.0/countEF));
+  }
+
+  // count bin feature (as a core feature)
+  if (countBin.size()>0 && !sparseCountBinFeatureFlag) {
+    bool foundBin = false;
+    for(size_t i=0; i < countBin.size(); i++) {
+      if (!foundBin && countEF <= countBin[i]) {
+        fileConsolidated << " " << maybeLogProb(2.718);
+        foundBin = true;
+      } else {
+        fileConsolidated << " " << maybeLogProb(1);
       }
-      fileConsolidated << " " << maybeLogProb( foundBin ? 1 : 2.718 );
     }
+    fileConsolidated << " " << maybeLogProb( foundBin ? 1 : 2.718 );
+  }
 
-    // alignment
-    fileConsolidated << " |||";
-    if (!itemDirect[2].empty()) {
-      fileConsolidated << " " << itemDirect[2];;
-    }
+  // alignment
+  fileConsolidated << " |||";
+  if (!itemDirect[2].empty()) {
+    fileConsolidated << " " << itemDirect[2];;
+  }
 
-    // counts, for debugging
-    fileConsolidated << " ||| " << countE << " " << countF << " " << countEF;
-
-    // sparse features
-    fileConsolidated << " |||";
-    if (directSparseScores.compare("") != 0)
-      fileConsolidated << " " << directSparseScores;
-    if (indirectSparseScores.compare("") != 0)
-      fileConsolidated << " " << indirectSparseScores;
-
-    // count bin feature (as a sparse feature)
-    if (sparseCountBinFeatureFlag) {
-      bool foundBin = false;
-      for(size_t i=0; i < countBin.size(); i++) {
-        if (!foundBin && countEF <= countBin[i]) {
-          fileConsolidated << " cb_";
-          if (i == 0 && countBin[i] > 1)
-            fileConsolidated << "1_";
-          else if (i > 0 && countBin[i-1]+1 < countBin[i])
-            fileConsolidated << (countBin[i-1]+1) << "_";
-          fileConsolidated << countBin[i] << " 1";
-          foundBin = true;
-        }
-      }
-      if (!foundBin) {
-        fileConsolidated << " cb_max 1";
+  // counts, for debugging
+  fileConsolidated << " ||| " << countE << " " << countF << " " << countEF;
+
+  // sparse features
+  fileConsolidated << " |||";
+  if (directSparseScores.compare("") != 0)
+    fileConsolidated << " " << directSparseScores;
+  if (indirectSparseScores.compare("") != 0)
+    fileConsolidated << " " << indirectSparseScores;
+
+  // count bin feature (as a sparse feature)
+  if (sparseCountBinFeatureFlag) {
+    bool foundBin = false;
+    for(size_t i=0; i < countBin.size(); i++) {
+      if (!foundBin && countEF <= countBin[i]) {
+        fileConsolidated << " cb_";
+        if (i == 0 && countBin[i] > 1)
+          fileConsolidated << "1_";
+        else if (i > 0 && countBin[i-1]+1 < countBin[i])
+          fileConsolidated << (countBin[i-1]+1) << "_";
+        fileConsolidated << countBin[i] << " 1";
+        foundBin = true;
       }
     }
-
-    // arbitrary key-value pairs
-    fileConsolidated << " |||";
-    if (itemDirect.size() >= 6) {
-      propertiesConsolidator.ProcessPropertiesString(itemDirect[5], fileConsolidated);
+    if (!foundBin) {
+      fileConsolidated << " cb_max 1";
     }
+  }
 
-    if (countsProperty) {
-      fileConsolidated << " {{Counts " << countE << " " << countF << " " << countEF << "}}";
-    }
+  // arbitrary key-value pairs
+  fileConsolidated << " |||";
+  if (itemDirect.size() >= 6) {
+    propertiesConsolidator.ProcessPropertiesString(itemDirect[5], fileConsolidated);
+  }
 
-    fileConsolidated << std::endl;
+  if (countsProperty) {
+    fileConsolidated << " {{Counts " << countE << " " << countF << " " << countEF << "}}";
   }
 
-  fileDirect.Close();
-  fileIndirect.Close();
-  fileConsolidated.Close();
+  fileConsolidated << '\n';
 }
 
 
@@ -446,18 +516,3 @@ void breakdownCoreAndSparse( const std::string &combined, std::string &core, std
   if (sparse.size() > 0 ) sparse = sparse.substr(1);
 }
 
-
-bool getLine( Moses::InputFileStream &file, std::vector< std::string > &item )
-{
-  if (file.eof())
-    return false;
-
-  std::string line;
-  if (!getline(file, line))
-    return false;
-
-  Moses::TokenizeMultiCharSeparator(item, line, " ||| ");
-
-  return true;
-}
-
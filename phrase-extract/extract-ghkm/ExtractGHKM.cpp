@@ -20,19 +20,14 @@
 #include "ExtractGHKM.h"
 
 #include "Alignment.h"
-#include "AlignmentGraph.h"
 #include "Exception.h"
+#include "ExtractTask.h"
 #include "InputFileStream.h"
-#include "Node.h"
 #include "OutputFileStream.h"
 #include "Options.h"
 #include "ParseTree.h"
 #include "PhraseOrientation.h"
-#include "ScfgRule.h"
-#include "ScfgRuleWriter.h"
 #include "Span.h"
-#include "StsgRule.h"
-#include "StsgRuleWriter.h"
 #include "SyntaxTree.h"
 #include "tables-core.h"
 #include "XmlException.h"
@@ -40,6 +35,7 @@
 #include "XmlTreeParser.h"
 
 #include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <cassert>
 #include <cstdlib>
@@ -134,9 +130,13 @@ int ExtractGHKM::Main(int argc, char *argv[])
   std::string alignmentLine;
   Alignment alignment;
   XmlTreeParser targetXmlTreeParser(targetLabelSet, targetTopLabelSet);
-  ScfgRuleWriter scfgWriter(fwdExtractStream, invExtractStream, options);
-  StsgRuleWriter stsgWriter(fwdExtractStream, invExtractStream, options);
   size_t lineNum = options.sentenceOffset;
+
+  // Tasks whose rules have not been written yet.  With more than one thread,
+  // a batch of sentences is extracted in parallel and then written in corpus
+  // order.
+  std::vector<boost::shared_ptr<ExtractTask> > tasks;
+  const size_t batchSize = 1000;
   while (true) {
     std::getline(targetStream, targetLine);
     std::getline(sourceStream, sourceLine);
@@ -172,16 +172,16 @@ int ExtractGHKM::Main(int argc, char *argv[])
 
 
     // Parse source tree and construct a SyntaxTree object.
-    MosesTraining::SyntaxTree sourceSyntaxTree;
+    std::auto_ptr<MosesTraining::SyntaxTree> sourceSyntaxTree(new MosesTraining::SyntaxTree());
     MosesTraining::SyntaxNode *sourceSyntaxTreeRoot=NULL;
 
     if (options.sourceLabels) {
       try {
-        if (!ProcessAndStripXMLTags(sourceLine, sourceSyntaxTree, sourceLabelSet, sourceTopLabelSet, false)) {
+        if (!ProcessAndStripXMLTags(sourceLine, *sourceSyntaxTree, sourceLabelSet, sourceTopLabelSet, false)) {
           throw Exception("");
         }
-        sourceSyntaxTree.ConnectNodes();
-        sourceSyntaxTreeRoot = sourceSyntaxTree.GetTop();
+        sourceSyntaxTree->ConnectNodes();
+        sourceSyntaxTreeRoot = sourceSyntaxTree->GetTop();
         assert(sourceSyntaxTreeRoot);
       } catch (const Exception &e) {
         std::ostringstream oss;
@@ -241,84 +241,20 @@ int ExtractGHKM::Main(int argc, char *argv[])
       CollectWordLabelCounts(*sourceParseTree, options, sourceWordCount, sourceWordLabel);
     }
 
-    // Form an alignment graph from the target tree, source words, and
-    // alignment.
-    AlignmentGraph graph(targetParseTree.get(), sourceTokens, alignment);
-
-    // Extract minimal rules, adding each rule to its root node's rule set.
-    graph.ExtractMinimalRules(options);
-
-    // Extract composed rules.
-    if (!options.minimal) {
-      graph.ExtractComposedRules(options);
-    }
-
-    // Initialize phrase orientation scoring object
-    PhraseOrientation phraseOrientation( sourceTokens.size(), targetXmlTreeParser.GetWords().size(), alignment);
-
-    // Write the rules, subject to scope pruning.
-    const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
-    for (std::vector<Node *>::const_iterator p = targetNodes.begin();
-         p != targetNodes.end(); ++p) {
-
-      const std::vector<const Subgraph *> &rules = (*p)->GetRules();
-
-      Moses::GHKM::PhraseOrientation::REO_CLASS l2rOrientation=Moses::GHKM::PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=Moses::GHKM::PhraseOrientation::REO_CLASS_UNKNOWN;
-      if (options.phraseOrientation && !rules.empty()) {
-        int sourceSpanBegin = *((*p)->GetSpan().begin());
-        int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
-        l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,Moses::GHKM::PhraseOrientation::REO_DIR_L2R);
-        r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,Moses::GHKM::PhraseOrientation::REO_DIR_R2L);
-        // std::cerr << "span " << sourceSpanBegin << " " << sourceSpanEnd << std::endl;
-        // std::cerr << "phraseOrientation " << phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd) << std::endl;
-      }
-
-      for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
-           q != rules.end(); ++q) {
-        // STSG output.
-        if (options.stsg) {
-          StsgRule rule(**q);
-          if (rule.Scope() <= options.maxScope) {
-            stsgWriter.Write(rule);
-          }
-          continue;
-        }
-        // SCFG output.
-        ScfgRule *r = 0;
-        if (options.sourceLabels) {
-          r = new ScfgRule(**q, &sourceSyntaxTree);
-        } else {
-          r = new ScfgRule(**q);
-        }
-        // TODO Can scope pruning be done earlier?
-        if (r->Scope() <= options.maxScope) {
-          scfgWriter.Write(*r,lineNum,false);
-          if (options.treeFragments) {
-            fwdExtractStream << " {{Tree ";
-            (*q)->PrintTree(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.partsOfSpeech) {
-            fwdExtractStream << " {{POS";
-            (*q)->PrintPartsOfSpeech(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.phraseOrientation) {
-            fwdExtractStream << " {{Orientation ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,l2rOrientation);
-            fwdExtractStream << " ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,r2lOrientation);
-            fwdExtractStream << "}}";
-            phraseOrientation.IncrementPriorCount(Moses::GHKM::PhraseOrientation::REO_DIR_L2R,l2rOrientation,1);
-            phraseOrientation.IncrementPriorCount(Moses::GHKM::PhraseOrientation::REO_DIR_R2L,r2lOrientation,1);
-          }
-          fwdExtractStream << std::endl;
-          invExtractStream << std::endl;
-        }
-        delete r;
+    boost::shared_ptr<ExtractTask> task(new ExtractTask(
+        lineNum, targetParseTree, sourceSyntaxTree, sourceTokens,
+        targetXmlTreeParser.GetWords().size(), alignment, options));
+    if (options.numThreads > 1) {
+      tasks.push_back(task);
+      if (tasks.size() == batchSize) {
+        ExtractBatch(tasks, options.numThreads, fwdExtractStream, invExtractStream);
       }
+    } else {
+      task->Run();
+      task->Write(fwdExtractStream, invExtractStream);
     }
   }
+  ExtractBatch(tasks, options.numThreads, fwdExtractStream, invExtractStream);
 
   if (options.phraseOrientation) {
     std::string phraseOrientationPriorsFileName = options.extractFile + std::string(".phraseOrientationPriors");
@@ -493,6 +429,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
    "output STSG rules (default is SCFG)")
   ("T2S",
    "enable tree-to-string rule extraction (string-to-tree is assumed by default)")
+  ("Threads",
+   po::value(&options.numThreads)->default_value(options.numThreads),
+   "set number of threads extracting rules in parallel")
   ("TreeFragments",
    "output parse tree information")
   ("SourceLabels",
@@ -641,6 +580,33 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   }
 }
 
+void ExtractGHKM::ExtractBatch(
+  std::vector<boost::shared_ptr<ExtractTask> > &tasks,
+  int numThreads, std::ostream &fwd, std::ostream &inv) const
+{
+  if (tasks.empty()) {
+    return;
+  }
+#ifdef WITH_THREADS
+  Moses::ThreadPool pool(numThreads);
+  for (std::vector<boost::shared_ptr<ExtractTask> >::const_iterator p =
+         tasks.begin(); p != tasks.end(); ++p) {
+    pool.Submit(*p);
+  }
+  pool.Stop(true);
+#else
+  for (std::vector<boost::shared_ptr<ExtractTask> >::const_iterator p =
+         tasks.begin(); p != tasks.end(); ++p) {
+    (*p)->Run();
+  }
+#endif
+  for (std::vector<boost::shared_ptr<ExtractTask> >::const_iterator p =
+         tasks.begin(); p != tasks.end(); ++p) {
+    (*p)->Write(fwd, inv);
+  }
+  tasks.clear();
+}
+
 void ExtractGHKM::Error(const std::string &msg) const
 {
   std::cerr << GetName() << ": " << msg << std::endl;
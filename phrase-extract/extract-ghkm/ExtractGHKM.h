@@ -25,6 +25,8 @@
 #include <string>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 namespace Moses
 {
 
@@ -33,6 +35,7 @@ class OutputFileStream;
 namespace GHKM
 {
 
+class ExtractTask;
 struct Options;
 class ParseTree;
 
@@ -81,6 +84,9 @@ private:
 
   void ProcessOptions(int, char *[], Options &) const;
 
+  void ExtractBatch(std::vector<boost::shared_ptr<ExtractTask> > &,
+                    int, std::ostream &, std::ostream &) const;
+
   std::string m_name;
 };
 
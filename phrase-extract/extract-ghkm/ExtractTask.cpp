@@ -0,0 +1,132 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "ExtractTask.h"
+
+#include "AlignmentGraph.h"
+#include "Node.h"
+#include "Options.h"
+#include "ScfgRule.h"
+#include "ScfgRuleWriter.h"
+#include "StsgRule.h"
+#include "StsgRuleWriter.h"
+#include "Subgraph.h"
+
+namespace Moses
+{
+namespace GHKM
+{
+
+void ExtractTask::Run()
+{
+  // Form an alignment graph from the target tree, source words, and
+  // alignment.
+  AlignmentGraph graph(m_targetParseTree.get(), m_sourceTokens, m_alignment);
+
+  // Extract minimal rules, adding each rule to its root node's rule set.
+  graph.ExtractMinimalRules(m_options);
+
+  // Extract composed rules.
+  if (!m_options.minimal) {
+    graph.ExtractComposedRules(m_options);
+  }
+
+  // Initialize phrase orientation scoring object
+  PhraseOrientation phraseOrientation(m_sourceTokens.size(), m_numTargetWords, m_alignment);
+
+  ScfgRuleWriter scfgWriter(m_fwd, m_inv, m_options);
+  StsgRuleWriter stsgWriter(m_fwd, m_inv, m_options);
+
+  // Write the rules, subject to scope pruning.
+  const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
+  for (std::vector<Node *>::const_iterator p = targetNodes.begin();
+       p != targetNodes.end(); ++p) {
+
+    const std::vector<const Subgraph *> &rules = (*p)->GetRules();
+
+    PhraseOrientation::REO_CLASS l2rOrientation=PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=PhraseOrientation::REO_CLASS_UNKNOWN;
+    if (m_options.phraseOrientation && !rules.empty()) {
+      int sourceSpanBegin = *((*p)->GetSpan().begin());
+      int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
+      l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_L2R);
+      r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_R2L);
+    }
+
+    for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
+         q != rules.end(); ++q) {
+      // STSG output.
+      if (m_options.stsg) {
+        StsgRule rule(**q);
+        if (rule.Scope() <= m_options.maxScope) {
+          stsgWriter.Write(rule);
+        }
+        continue;
+      }
+      // SCFG output.
+      ScfgRule *r = 0;
+      if (m_options.sourceLabels) {
+        r = new ScfgRule(**q, m_sourceSyntaxTree.get());
+      } else {
+        r = new ScfgRule(**q);
+      }
+      // TODO Can scope pruning be done earlier?
+      if (r->Scope() <= m_options.maxScope) {
+        scfgWriter.Write(*r,m_lineNum,false);
+        if (m_options.treeFragments) {
+          m_fwd << " {{Tree ";
+          (*q)->PrintTree(m_fwd);
+          m_fwd << "}}";
+        }
+        if (m_options.partsOfSpeech) {
+          m_fwd << " {{POS";
+          (*q)->PrintPartsOfSpeech(m_fwd);
+          m_fwd << "}}";
+        }
+        if (m_options.phraseOrientation) {
+          m_fwd << " {{Orientation ";
+          phraseOrientation.WriteOrientation(m_fwd,l2rOrientation);
+          m_fwd << " ";
+          phraseOrientation.WriteOrientation(m_fwd,r2lOrientation);
+          m_fwd << "}}";
+          m_orientations.push_back(OrientationPair(l2rOrientation, r2lOrientation));
+        }
+        m_fwd << std::endl;
+        m_inv << std::endl;
+      }
+      delete r;
+    }
+  }
+}
+
+void ExtractTask::Write(std::ostream &fwd, std::ostream &inv)
+{
+  fwd << m_fwd.str();
+  inv << m_inv.str();
+
+  // The prior counts are static members of PhraseOrientation, so they are
+  // only updated here and not while the rules are extracted.
+  for (std::vector<OrientationPair>::const_iterator p = m_orientations.begin();
+       p != m_orientations.end(); ++p) {
+    PhraseOrientation::IncrementPriorCount(PhraseOrientation::REO_DIR_L2R,p->first,1);
+    PhraseOrientation::IncrementPriorCount(PhraseOrientation::REO_DIR_R2L,p->second,1);
+  }
+}
+
+}  // namespace GHKM
+}  // namespace Moses
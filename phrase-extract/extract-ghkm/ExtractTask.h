@@ -0,0 +1,92 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include "Alignment.h"
+#include "ParseTree.h"
+#include "PhraseOrientation.h"
+#include "SyntaxTree.h"
+
+#include "moses/ThreadPool.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Moses
+{
+namespace GHKM
+{
+
+struct Options;
+
+// Extracts the rules of one sentence pair.  The sentence's trees are parsed
+// beforehand (parsing updates the global label sets), so Run() only touches
+// the task's own data and can be executed on any thread.  The rules are
+// buffered until Write() appends them to the extract files.
+class ExtractTask : public Moses::Task
+{
+public:
+  ExtractTask(size_t lineNum,
+              std::auto_ptr<ParseTree> targetParseTree,
+              std::auto_ptr<MosesTraining::SyntaxTree> sourceSyntaxTree,
+              const std::vector<std::string> &sourceTokens,
+              size_t numTargetWords,
+              const Alignment &alignment,
+              const Options &options)
+    : m_lineNum(lineNum)
+    , m_targetParseTree(targetParseTree)
+    , m_sourceSyntaxTree(sourceSyntaxTree)
+    , m_sourceTokens(sourceTokens)
+    , m_numTargetWords(numTargetWords)
+    , m_alignment(alignment)
+    , m_options(options) {}
+
+  void Run();
+
+  // Write the buffered rules and add their phrase orientations to the
+  // prior counts.  Must be called in corpus order, on one thread.
+  void Write(std::ostream &fwd, std::ostream &inv);
+
+private:
+  typedef std::pair<PhraseOrientation::REO_CLASS,
+                    PhraseOrientation::REO_CLASS> OrientationPair;
+
+  // Disallow copying
+  ExtractTask(const ExtractTask &);
+  ExtractTask &operator=(const ExtractTask &);
+
+  size_t m_lineNum;
+  std::auto_ptr<ParseTree> m_targetParseTree;
+  std::auto_ptr<MosesTraining::SyntaxTree> m_sourceSyntaxTree;
+  std::vector<std::string> m_sourceTokens;
+  size_t m_numTargetWords;
+  Alignment m_alignment;
+  const Options &m_options;
+
+  std::ostringstream m_fwd;
+  std::ostringstream m_inv;
+  std::vector<OrientationPair> m_orientations;
+};
+
+}  // namespace GHKM
+}  // namespace Moses
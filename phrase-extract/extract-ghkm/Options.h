@@ -38,6 +38,7 @@ public:
     , maxRuleSize(3)
     , maxScope(3)
     , minimal(false)
+    , numThreads(1)
     , partsOfSpeech(false)
     , partsOfSpeechFactor(false)
     , pcfg(false)
@@ -69,6 +70,7 @@ public:
   int maxRuleSize;
   int maxScope;
   bool minimal;
+  int numThreads;
   bool partsOfSpeech;
   bool partsOfSpeechFactor;
   bool pcfg;
@@ -18,13 +18,22 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <deque>
 #include <limits>
 
+#include <boost/shared_ptr.hpp>
+
 #include "SentenceAlignment.h"
 #include "tables-core.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 #include "PhraseExtractionOptions.h"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
 
 using namespace std;
 using namespace MosesTraining;
@@ -83,7 +92,7 @@ bool flexScoreFlag = false;
 namespace MosesTraining
 {
 
-class ExtractTask
+class ExtractTask : public Moses::Task
 {
 public:
   ExtractTask(size_t id, SentenceAlignment &sentence,PhraseExtractionOptions &initoptions, Moses::OutputFileStream &extractFile, Moses::OutputFileStream &extractFileInv,Moses::OutputFileStream &extractFileOrientation, Moses::OutputFileStream &extractFileContext, Moses::OutputFileStream &extractFileContextInv):
@@ -94,7 +103,10 @@ public:
     m_extractFileOrientation(extractFileOrientation),
     m_extractFileContext(extractFileContext),
     m_extractFileContextInv(extractFileContextInv) {}
+  //! extract the phrases of the sentence, keeping them in memory
   void Run();
+  //! append the extracted phrases to the output files
+  void Write();
 private:
   vector< string > m_extractedPhrases;
   vector< string > m_extractedPhrasesInv;
@@ -117,6 +129,26 @@ private:
   Moses::OutputFileStream &m_extractFileContext;
   Moses::OutputFileStream &m_extractFileContextInv;
 };
+
+#ifdef WITH_THREADS
+// number of sentences extracted in parallel before their phrases are written
+const size_t EXTRACT_BATCH_SIZE = 1000;
+
+// Extract a batch of sentences in parallel, then write their phrases in
+// corpus order so that the output does not depend on the number of threads.
+void extractBatch(vector< boost::shared_ptr<ExtractTask> > &tasks, int thread_count)
+{
+  Moses::ThreadPool pool(thread_count);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    pool.Submit(tasks[i]);
+  }
+  pool.Stop(true);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Write();
+  }
+  tasks.clear();
+}
+#endif
 }
 
 int main(int argc, char* argv[])
@@ -126,7 +158,7 @@ int main(int argc, char* argv[])
 
   if (argc < 6) {
     cerr << "syntax: extract en de align extract max-length [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ] ";
-    cerr<<"| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ]\n";
+    cerr<<"| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename | --Threads n ]\n";
     exit(1);
   }
 
@@ -140,6 +172,9 @@ int main(int argc, char* argv[])
   const char* const &fileNameA = argv[3];
   const string fileNameExtract = string(argv[4]);
   PhraseExtractionOptions options(atoi(argv[5]));
+#ifdef WITH_THREADS
+  int thread_count = 1;
+#endif
 
   for(int i=6; i<argc; i++) {
     if (strcmp(argv[i],"--OnlyOutputSpanInfo") == 0) {
@@ -158,6 +193,19 @@ int main(int argc, char* argv[])
         exit(1);
       }
       sentenceOffset = atoi(argv[++i]);
+    } else if (strcmp(argv[i],"-threads") == 0 ||
+               strcmp(argv[i],"--threads") == 0 ||
+               strcmp(argv[i],"--Threads") == 0) {
+      if (i+1 >= argc) {
+        cerr << "extract: syntax error, used switch --Threads without a number" << endl;
+        exit(1);
+      }
+#ifdef WITH_THREADS
+      thread_count = atoi(argv[++i]);
+#else
+      cerr << "thread support not compiled in." << '\n';
+      exit(1);
+#endif
     } else if (strcmp(argv[i], "--GZOutput") == 0) {
       options.initGzOutput(true);
     } else if (strcmp(argv[i], "--InstanceWeights") == 0) {
@@ -238,10 +286,19 @@ int main(int argc, char* argv[])
     options.initWordType(REO_MSD);
   }
 
+#ifdef WITH_THREADS
+  // span info is printed to stdout while the phrases are extracted
+  if (options.isOnlyOutputSpanInfo() && thread_count > 1) {
+    cerr << "extract: --OnlyOutputSpanInfo runs single-threaded" << endl;
+    thread_count = 1;
+  }
+#endif
+
   // open input files
-  Moses::InputFileStream eFile(fileNameE);
-  Moses::InputFileStream fFile(fileNameF);
-  Moses::InputFileStream aFile(fileNameA);
+  // each read and decompressed ahead on its own thread
+  util::LineBatchStream eFile(util::OpenReadOrThrow(fileNameE));
+  util::LineBatchStream fFile(util::OpenReadOrThrow(fileNameF));
+  util::LineBatchStream aFile(util::OpenReadOrThrow(fileNameA));
 
   istream *eFileP = &eFile;
   istream *fFileP = &fFile;
@@ -275,6 +332,10 @@ int main(int argc, char* argv[])
 
   string englishString, foreignString, alignmentString, weightString;
 
+  // sentences still referenced by the tasks of the current batch
+  deque<SentenceAlignment> sentences;
+  vector< boost::shared_ptr<ExtractTask> > tasks;
+
   while(getline(*eFileP, englishString)) {
     i++;
     if (i%10000 == 0) cerr << "." << flush;
@@ -285,7 +346,8 @@ int main(int argc, char* argv[])
       getline(*iwFileP, weightString);
     }
 
-    SentenceAlignment sentence;
+    sentences.push_back(SentenceAlignment());
+    SentenceAlignment &sentence = sentences.back();
     // cout << "read in: " << englishString << " & " << foreignString << " & " << alignmentString << endl;
     //az: output src, tgt, and alingment line
     if (options.isOnlyOutputSpanInfo()) {
@@ -302,17 +364,30 @@ int main(int argc, char* argv[])
       if (options.placeholders.size()) {
         sentence.invertAlignment();
       }
-      ExtractTask *task = new ExtractTask(i-1, sentence, options, extractFile , extractFileInv, extractFileOrientation, extractFileContext, extractFileContextInv);
-      task->Run();
-      delete task;
-
+      boost::shared_ptr<ExtractTask> task(new ExtractTask(i-1, sentence, options, extractFile , extractFileInv, extractFileOrientation, extractFileContext, extractFileContextInv));
+#ifdef WITH_THREADS
+      if (thread_count > 1) {
+        tasks.push_back(task);
+      } else
+#endif
+      {
+        task->Run();
+        task->Write();
+      }
     }
     if (options.isOnlyOutputSpanInfo()) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
+#ifdef WITH_THREADS
+    if (tasks.size() >= EXTRACT_BATCH_SIZE) {
+      extractBatch(tasks, thread_count);
+    }
+#endif
+    if (tasks.empty()) {
+      sentences.clear();
+    }
   }
-
-  eFile.Close();
-  fFile.Close();
-  aFile.Close();
+#ifdef WITH_THREADS
+  extractBatch(tasks, thread_count);
+#endif
 
   //az: only close if we actually opened it
   if (!options.isOnlyOutputSpanInfo()) {
@@ -337,6 +412,10 @@ namespace MosesTraining
 void ExtractTask::Run()
 {
   extract(m_sentence);
+}
+
+void ExtractTask::Write()
+{
   writePhrasesToFile();
   m_extractedPhrases.clear();
   m_extractedPhrasesInv.clear();
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <cstdlib>
+#include <sstream>
+#include <vector>
 #include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "Main.h"
 #include "InputFileStream.h"
@@ -9,11 +12,90 @@
 #include "AlignedSentenceSyntax.h"
 #include "Parameter.h"
 #include "Rules.h"
+#include "moses/ThreadPool.h"
 
 using namespace std;
 
 bool g_debug = false;
 
+// Extracts the rules of one sentence pair and keeps them, formatted, until
+// they are written in corpus order.
+class ExtractTask : public Moses::Task
+{
+public:
+  ExtractTask(int lineNum, const string &lineSource, const string &lineTarget,
+              const string &lineAlignment, const Parameter &params)
+    :m_lineNum(lineNum)
+    ,m_lineSource(lineSource)
+    ,m_lineTarget(lineTarget)
+    ,m_lineAlignment(lineAlignment)
+    ,m_params(params)
+  {}
+
+  void Run() {
+    AlignedSentence *alignedSentence;
+
+    if (m_params.sourceSyntax || m_params.targetSyntax) {
+      alignedSentence = new AlignedSentenceSyntax(m_lineNum, m_lineSource, m_lineTarget, m_lineAlignment);
+    } else {
+      alignedSentence = new AlignedSentence(m_lineNum, m_lineSource, m_lineTarget, m_lineAlignment);
+    }
+
+    alignedSentence->Create(m_params);
+    //cerr << alignedSentence->Debug();
+
+    Rules rules(*alignedSentence);
+    rules.Extend(m_params);
+    rules.Consolidate(m_params);
+    //cerr << rules.Debug();
+
+    ostringstream extract, extractInv;
+    rules.Output(extract, true, m_params);
+    rules.Output(extractInv, false, m_params);
+    m_extract = extract.str();
+    m_extractInv = extractInv.str();
+
+    delete alignedSentence;
+  }
+
+  void Write(ostream &extractFile, ostream &extractInvFile) const {
+    extractFile << m_extract;
+    extractInvFile << m_extractInv;
+  }
+
+private:
+  int m_lineNum;
+  string m_lineSource, m_lineTarget, m_lineAlignment;
+  const Parameter &m_params;
+  string m_extract, m_extractInv;
+};
+
+// number of sentences extracted in parallel before their rules are written
+const size_t kBatchSize = 1000;
+
+void ExtractBatch(vector<boost::shared_ptr<ExtractTask> > &tasks, int numThreads,
+                  ostream &extractFile, ostream &extractInvFile)
+{
+#ifdef WITH_THREADS
+  if (numThreads > 1) {
+    Moses::ThreadPool pool(numThreads);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      pool.Submit(tasks[i]);
+    }
+    pool.Stop(true);
+  } else
+#endif
+  {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]->Run();
+    }
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Write(extractFile, extractInvFile);
+  }
+  tasks.clear();
+}
+
 int main(int argc, char** argv)
 {
   cerr << "Starting" << endl;
@@ -58,7 +140,9 @@ int main(int argc, char** argv)
   ("ScopeSpan", po::value<string>()->default_value(params.scopeSpanStr), "Min and max span for rules of each scope. Format is min,max:min,max...")
 
   ("NonTermConsecSource", "Allow consecutive non-terms on the source side")
-  ("NonTermConsecSourceMixedSyntax", po::value<int>()->default_value(params.nonTermConsecSourceMixedSyntax), "In mixed syntax mode, what nt can be consecutive. 0=don't allow consec nt. 1(default)=hiero+syntax. 2=syntax+syntax. 3=always allow");
+  ("NonTermConsecSourceMixedSyntax", po::value<int>()->default_value(params.nonTermConsecSourceMixedSyntax), "In mixed syntax mode, what nt can be consecutive. 0=don't allow consec nt. 1(default)=hiero+syntax. 2=syntax+syntax. 3=always allow")
+
+  ("Threads", po::value<int>()->default_value(params.numThreads), "Number of sentences extracted in parallel. The output does not depend on it");
 
 
   po::variables_map vm;
@@ -120,6 +204,14 @@ int main(int argc, char** argv)
   if (vm.count("NonTermConsecSource")) params.nonTermConsecSource = true;
   if (vm.count("NonTermConsecSourceMixedSyntax")) params.nonTermConsecSourceMixedSyntax = vm["NonTermConsecSourceMixedSyntax"].as<int>();
 
+  if (vm.count("Threads")) params.numThreads = vm["Threads"].as<int>();
+#ifndef WITH_THREADS
+  if (params.numThreads > 1) {
+    std::cerr << "ERROR: thread support not compiled in" << std::endl;
+    return EXIT_FAILURE;
+  }
+#endif
+
 
   // input files;
   string pathTarget = argv[1];
@@ -143,18 +235,16 @@ int main(int argc, char** argv)
   // MAIN LOOP
   int lineNum = 1;
   string lineTarget, lineSource, lineAlignment;
+  vector<boost::shared_ptr<ExtractTask> > tasks;
   while (getline(strmTarget, lineTarget)) {
     if (lineNum % 10000 == 0) {
       cerr << lineNum << " ";
     }
 
-    bool success;
-    success = getline(strmSource, lineSource);
-    if (!success) {
+    if (!getline(strmSource, lineSource)) {
       throw "Couldn't read source";
     }
-    success = getline(strmAlignment, lineAlignment);
-    if (!success) {
+    if (!getline(strmAlignment, lineAlignment)) {
       throw "Couldn't read alignment";
     }
 
@@ -164,29 +254,15 @@ int main(int argc, char** argv)
     cerr << "lineAlignment=" << lineAlignment << endl;
     */
 
-    AlignedSentence *alignedSentence;
-
-    if (params.sourceSyntax || params.targetSyntax) {
-      alignedSentence = new AlignedSentenceSyntax(lineNum, lineSource, lineTarget, lineAlignment);
-    } else {
-      alignedSentence = new AlignedSentence(lineNum, lineSource, lineTarget, lineAlignment);
+    tasks.push_back(boost::shared_ptr<ExtractTask>(
+                      new ExtractTask(lineNum, lineSource, lineTarget, lineAlignment, params)));
+    if (tasks.size() >= kBatchSize) {
+      ExtractBatch(tasks, params.numThreads, extractFile, extractInvFile);
     }
 
-    alignedSentence->Create(params);
-    //cerr << alignedSentence->Debug();
-
-    Rules rules(*alignedSentence);
-    rules.Extend(params);
-    rules.Consolidate(params);
-    //cerr << rules.Debug();
-
-    rules.Output(extractFile, true, params);
-    rules.Output(extractInvFile, false, params);
-
-    delete alignedSentence;
-
     ++lineNum;
   }
+  ExtractBatch(tasks, params.numThreads, extractFile, extractInvFile);
 
   if (!params.gluePath.empty()) {
     Moses::OutputFileStream glueFile(params.gluePath);
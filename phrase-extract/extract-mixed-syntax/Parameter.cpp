@@ -48,6 +48,8 @@ Parameter::Parameter()
   ,numTargetFactors(1)
 
   ,nonTermConsecSourceMixedSyntax(1)
+
+  ,numThreads(1)
 {}
 
 Parameter::~Parameter()
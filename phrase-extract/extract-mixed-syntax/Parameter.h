@@ -57,6 +57,8 @@ public:
 
   int nonTermConsecSourceMixedSyntax;
 
+  int numThreads;
+
   std::string scopeSpanStr;
   std::vector<std::pair<int,int> > scopeSpan;
 
@@ -5,7 +5,10 @@
  *      Author: hieu
  */
 
+#include <algorithm>
+#include <map>
 #include <sstream>
+#include <vector>
 #include "Rules.h"
 #include "ConsistentPhrase.h"
 #include "ConsistentPhrases.h"
@@ -179,17 +182,26 @@ void Rules::MergeRules(const Parameter &params)
 {
   typedef std::set<Rule*, CompareRules> MergeRules;
 
+  // m_keepRules is ordered by address, so add up the counts of each merged
+  // rule in sorted order to get the same rounding on every run
+  std::map<Rule*, std::vector<float> > counts;
   std::set<Rule*>::const_iterator iterOrig;
   for (iterOrig = m_keepRules.begin(); iterOrig != m_keepRules.end(); ++iterOrig) {
     Rule *origRule = *iterOrig;
 
     pair<MergeRules::iterator, bool> inserted = m_mergeRules.insert(origRule);
-    if (!inserted.second) {
-      // already there, just add count
-      Rule &rule = **inserted.first;
-      float newCount = rule.GetCount() + origRule->GetCount();
-      rule.SetCount(newCount);
+    counts[*inserted.first].push_back(origRule->GetCount());
+  }
+
+  std::map<Rule*, std::vector<float> >::iterator iterCounts;
+  for (iterCounts = counts.begin(); iterCounts != counts.end(); ++iterCounts) {
+    std::vector<float> &ruleCounts = iterCounts->second;
+    std::sort(ruleCounts.begin(), ruleCounts.end());
+    float count = 0;
+    for (size_t i = 0; i < ruleCounts.size(); ++i) {
+      count += ruleCounts[i];
     }
+    iterCounts->first->SetCount(count);
   }
 }
 
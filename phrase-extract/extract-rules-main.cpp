@@ -31,6 +31,9 @@
 #include <vector>
 #include <limits>
 
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+
 #ifdef WIN32
 // Include Visual Leak Detector
 //#include <vld.h>
@@ -47,13 +50,15 @@
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 
+#include "moses/ThreadPool.h"
+
 using namespace std;
 using namespace MosesTraining;
 
 typedef vector< int > LabelIndex;
 typedef map< int, int > WordIndex;
 
-class ExtractTask
+class ExtractTask : public Moses::Task
 {
 private:
   SentenceAlignmentWithSyntax &m_sentence;
@@ -65,11 +70,17 @@ private:
 
   vector< ExtractedRule > m_extractedRules;
 
+  // formatted rules, kept until Write()
+  string m_out;
+  string m_outInv;
+  string m_outContext;
+  string m_outContextInv;
+
   // main functions
   void extractRules();
   void addRuleToCollection(ExtractedRule &rule);
   void consolidateRules();
-  void writeRulesToFile();
+  void formatRules();
 
   // subs
   void addRule( int, int, int, int, int, RuleExist &ruleExist);
@@ -101,10 +112,33 @@ public:
     m_extractFileInv(extractFileInv),
     m_extractFileContext(extractFileContext),
     m_extractFileContextInv(extractFileContextInv) {}
+  //! extract the rules of the sentence and format them in memory
   void Run();
+  //! append the formatted rules to the output files
+  void Write();
 
 };
 
+#ifdef WITH_THREADS
+// number of sentences extracted in parallel before their rules are written
+const size_t EXTRACT_BATCH_SIZE = 1000;
+
+// Extract a batch of sentences in parallel, then write their rules in
+// corpus order so that the output does not depend on the number of threads.
+void extractBatch(vector< boost::shared_ptr<ExtractTask> > &tasks, int thread_count)
+{
+  Moses::ThreadPool pool(thread_count);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    pool.Submit(tasks[i]);
+  }
+  pool.Stop(true);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Write();
+  }
+  tasks.clear();
+}
+#endif
+
 // stats for glue grammar and unknown word label probabilities
 void collectWordLabelCounts(SentenceAlignmentWithSyntax &sentence );
 void writeGlueGrammar(const string &, RuleExtractionOptions &options, set< string > &targetLabelCollection, map< string, int > &targetTopLabelCollection);
@@ -140,7 +174,8 @@ int main(int argc, char* argv[])
          << " | --UnpairedExtractFormat"
          << " | --ConditionOnTargetLHS ]"
          << " | --BoundaryRules[" << options.boundaryRules << "]"
-         << " | --FlexibilityScore\n";
+         << " | --FlexibilityScore"
+         << " | --Threads NUM\n";
 
     exit(1);
   }
@@ -326,6 +361,14 @@ int main(int argc, char* argv[])
   size_t i=sentenceOffset;
   string targetString, sourceString, alignmentString;
 
+  // sentences still referenced by the tasks of the current batch
+  boost::ptr_vector< SentenceAlignmentWithSyntax > sentences;
+  vector< boost::shared_ptr<ExtractTask> > tasks;
+#ifdef WITH_THREADS
+  // span info is printed while extracting, so it needs one sentence at a time
+  if (options.onlyOutputSpanInfo) thread_count = 1;
+#endif
+
   while(getline(*tFileP, targetString)) {
     i++;
 
@@ -334,9 +377,11 @@ int main(int argc, char* argv[])
 
     if (i%1000 == 0) cerr << i << " " << flush;
 
-    SentenceAlignmentWithSyntax sentence
-    (targetLabelCollection, sourceLabelCollection,
-     targetTopLabelCollection, sourceTopLabelCollection, options);
+    // the label collections are updated here, in corpus order
+    sentences.push_back(new SentenceAlignmentWithSyntax
+                        (targetLabelCollection, sourceLabelCollection,
+                         targetTopLabelCollection, sourceTopLabelCollection, options));
+    SentenceAlignmentWithSyntax &sentence = sentences.back();
     //az: output src, tgt, and alingment line
     if (options.onlyOutputSpanInfo) {
       cout << "LOG: SRC: " << sourceString << endl;
@@ -349,12 +394,30 @@ int main(int argc, char* argv[])
       if (options.unknownWordLabelFlag) {
         collectWordLabelCounts(sentence);
       }
-      ExtractTask *task = new ExtractTask(sentence, options, extractFile, extractFileInv, extractFileContext, extractFileContextInv);
-      task->Run();
-      delete task;
+      boost::shared_ptr<ExtractTask> task(new ExtractTask(sentence, options, extractFile, extractFileInv, extractFileContext, extractFileContextInv));
+#ifdef WITH_THREADS
+      if (thread_count > 1) {
+        tasks.push_back(task);
+      } else
+#endif
+      {
+        task->Run();
+        task->Write();
+      }
     }
     if (options.onlyOutputSpanInfo) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
+#ifdef WITH_THREADS
+    if (tasks.size() >= EXTRACT_BATCH_SIZE) {
+      extractBatch(tasks, thread_count);
+    }
+#endif
+    if (tasks.empty()) {
+      sentences.clear();
+    }
   }
+#ifdef WITH_THREADS
+  extractBatch(tasks, thread_count);
+#endif
 
   tFile.Close();
   sFile.Close();
@@ -381,10 +444,22 @@ void ExtractTask::Run()
 {
   extractRules();
   consolidateRules();
-  writeRulesToFile();
+  formatRules();
   m_extractedRules.clear();
 }
 
+void ExtractTask::Write()
+{
+  m_extractFile << m_out;
+  m_extractFileInv << m_outInv;
+  m_extractFileContext << m_outContext;
+  m_extractFileContextInv << m_outContextInv;
+  m_out.clear();
+  m_outInv.clear();
+  m_outContext.clear();
+  m_outContextInv.clear();
+}
+
 void ExtractTask::extractRules()
 {
   int countT = m_sentence.target.size();
@@ -1051,7 +1126,7 @@ void ExtractTask::consolidateRules()
   }
 }
 
-void ExtractTask::writeRulesToFile()
+void ExtractTask::formatRules()
 {
   vector<ExtractedRule>::const_iterator rule;
   ostringstream out;
@@ -1108,10 +1183,10 @@ void ExtractTask::writeRulesToFile()
       }
     }
   }
-  m_extractFile << out.str();
-  m_extractFileInv << outInv.str();
-  m_extractFileContext << outContext.str();
-  m_extractFileContextInv << outContextInv.str();
+  m_out = out.str();
+  m_outInv = outInv.str();
+  m_outContext = outContext.str();
+  m_outContextInv = outContextInv.str();
 }
 
 void writeGlueGrammar( const string & fileName, RuleExtractionOptions &options, set< string > &targetLabelCollection, map< string, int > &targetTopLabelCollection )
@@ -0,0 +1,296 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2009 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Filters a phrase table or lexicalized reordering table for a test set:
+// only entries whose source phrase occurs in the test set (up to a maximum
+// length) are kept.  This is the non-hierarchical filtering step of
+// scripts/training/filter-model-given-input.pl.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+#include "moses/ThreadPool.h"
+
+namespace
+{
+
+// Number of table lines filtered by one task.
+const size_t FILTER_BLOCK_SIZE = 10000;
+
+typedef boost::unordered_set<std::string> PhraseSet;
+
+struct FilterOptions {
+  FilterOptions() : maxLength(10), threads(1) {
+    factors.push_back(0);
+  }
+  size_t maxLength;
+  size_t threads;
+  std::vector<size_t> factors;
+  std::vector<std::pair<size_t, float> > minScores;
+};
+
+// Projects a test word onto the factors used by the table.
+void AppendFactors(const StringPiece &word, const std::vector<size_t> &factors,
+                   std::string &phrase)
+{
+  std::vector<StringPiece> wordFactors;
+  for (util::TokenIter<util::SingleCharacter> f(word, '|'); f; ++f) {
+    wordFactors.push_back(*f);
+  }
+  for (size_t i = 0; i < factors.size(); ++i) {
+    if (i > 0) phrase += '|';
+    if (factors[i] < wordFactors.size()) {
+      phrase.append(wordFactors[factors[i]].data(), wordFactors[factors[i]].size());
+    }
+  }
+}
+
+// Adds every phrase of up to maxLength words in the test set.
+void CollectPhrases(const char *testFile, const FilterOptions &options,
+                    PhraseSet &phrases)
+{
+  util::FilePiece test(testFile);
+  StringPiece line;
+  std::vector<std::string> words;
+  while (test.ReadLineOrEOF(line)) {
+    words.clear();
+    for (util::TokenIter<util::SingleCharacter, true> w(line, ' '); w; ++w) {
+      words.push_back(std::string());
+      AppendFactors(*w, options.factors, words.back());
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+      std::string phrase = words[i];
+      phrases.insert(phrase);
+      for (size_t j = i + 1; j < words.size() && j - i < options.maxLength; ++j) {
+        phrase += ' ';
+        phrase += words[j];
+        phrases.insert(phrase);
+      }
+    }
+  }
+}
+
+// Whether an entry survives the --MinScore thresholds.  As in the perl
+// script, entries with fewer than three fields after the source phrase
+// (reordering tables) are not subject to thresholds.
+bool PassesMinScores(const StringPiece &rest, const FilterOptions &options)
+{
+  if (options.minScores.empty()) return true;
+  std::vector<StringPiece> fields;
+  for (util::TokenIter<util::MultiCharacter> f(rest, "|||"); f; ++f) {
+    fields.push_back(*f);
+  }
+  if (fields.size() <= 2) return true;
+  std::vector<float> scores;
+  for (util::TokenIter<util::SingleCharacter, true> s(fields[1], ' '); s; ++s) {
+    scores.push_back(std::atof(s->as_string().c_str()));
+  }
+  for (size_t i = 0; i < options.minScores.size(); ++i) {
+    const size_t id = options.minScores[i].first;
+    if (id < scores.size() && scores[id] < options.minScores[i].second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class FilterTask : public Moses::Task
+{
+public:
+  FilterTask(const PhraseSet &phrases, const FilterOptions &options)
+    : m_phrases(phrases)
+    , m_options(options)
+    , m_used(0) {
+    m_lines.reserve(FILTER_BLOCK_SIZE);
+  }
+
+  std::vector<std::string> &Lines() {
+    return m_lines;
+  }
+
+  void Run() {
+    std::string source;
+    for (size_t i = 0; i < m_lines.size(); ++i) {
+      const std::string &line = m_lines[i];
+      const size_t pos = line.find(" ||| ");
+      if (pos == std::string::npos) continue;
+      size_t end = pos;
+      while (end > 0 && line[end-1] == ' ') --end;
+      source.assign(line, 0, end);
+      if (m_phrases.find(source) == m_phrases.end()) continue;
+      if (!PassesMinScores(StringPiece(line).substr(pos + 5), m_options)) continue;
+      m_output += line;
+      m_output += '\n';
+      ++m_used;
+    }
+    std::vector<std::string>().swap(m_lines);
+  }
+
+  size_t Write(std::FILE *out) const {
+    std::fwrite(m_output.data(), 1, m_output.size(), out);
+    return m_used;
+  }
+
+private:
+  const PhraseSet &m_phrases;
+  const FilterOptions &m_options;
+  std::vector<std::string> m_lines;
+  std::string m_output;
+  size_t m_used;
+};
+
+// Filters a batch of blocks, in parallel if threads were requested, and
+// writes them in table order.  Returns the number of entries kept.
+size_t FilterBatch(std::vector<boost::shared_ptr<FilterTask> > &batch,
+                   size_t threads)
+{
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    Moses::ThreadPool pool(threads);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      pool.Submit(batch[i]);
+    }
+    pool.Stop(true);
+  } else
+#endif
+  {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      batch[i]->Run();
+    }
+  }
+  size_t used = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    used += batch[i]->Write(stdout);
+  }
+  batch.clear();
+  return used;
+}
+
+void ParseMinScores(const std::string &arg, FilterOptions &options)
+{
+  for (util::TokenIter<util::SingleCharacter> p(arg, ','); p; ++p) {
+    const std::string setting = p->as_string();
+    const size_t pos = setting.find(':');
+    UTIL_THROW_IF2(pos == std::string::npos, "faulty MinScore setting '" << setting << "' in '" << arg << "'");
+    options.minScores.push_back(std::make_pair(
+                                  size_t(std::atoi(setting.substr(0, pos).c_str())),
+                                  float(std::atof(setting.substr(pos + 1).c_str()))));
+  }
+}
+
+void ParseFactors(const std::string &arg, FilterOptions &options)
+{
+  options.factors.clear();
+  for (util::TokenIter<util::SingleCharacter> p(arg, ','); p; ++p) {
+    options.factors.push_back(std::atoi(p->as_string().c_str()));
+  }
+  UTIL_THROW_IF2(options.factors.empty(), "faulty Factors setting '" << arg << "'");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    std::cerr << "syntax: filter-phrase-table test-set [table] [--MaxLength n] [--Factors f1,f2,...] [--MinScore id:threshold[,id:threshold]*] [--Threads n] > filtered-table" << std::endl;
+    std::cerr << "reads the table from standard input if no table file is given" << std::endl;
+    return 1;
+  }
+
+  FilterOptions options;
+  const char *testFile = argv[1];
+  const char *tableFile = NULL;
+  for (int i = 2; i < argc; ++i) {
+    if (strcmp(argv[i], "--MaxLength") == 0 && i+1 < argc) {
+      options.maxLength = std::atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--Factors") == 0 && i+1 < argc) {
+      ParseFactors(argv[++i], options);
+    } else if (strcmp(argv[i], "--MinScore") == 0 && i+1 < argc) {
+      ParseMinScores(argv[++i], options);
+    } else if (strcmp(argv[i], "--Threads") == 0 && i+1 < argc) {
+      options.threads = std::atoi(argv[++i]);
+#ifndef WITH_THREADS
+      if (options.threads > 1) {
+        std::cerr << "warning: compiled without threading support, using 1 thread" << std::endl;
+        options.threads = 1;
+      }
+#endif
+    } else if (argv[i][0] != '-' && tableFile == NULL) {
+      tableFile = argv[i];
+    } else {
+      std::cerr << "unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  UTIL_THROW_IF2(options.maxLength == 0, "MaxLength must be positive");
+  if (options.threads == 0) options.threads = 1;
+
+  PhraseSet phrases;
+  CollectPhrases(testFile, options, phrases);
+  std::cerr << phrases.size() << " distinct test set phrases of up to " << options.maxLength << " words" << std::endl;
+
+  // the perl script relied on zcat; FilePiece decompresses by itself
+  util::FilePiece table(tableFile ? util::OpenReadOrThrow(tableFile) : 0,
+                        tableFile ? tableFile : "stdin");
+
+  const size_t batchSize = options.threads * 4;
+  std::vector<boost::shared_ptr<FilterTask> > batch;
+  size_t used = 0, total = 0;
+  StringPiece line;
+  bool eof = false;
+  while (!eof) {
+    boost::shared_ptr<FilterTask> task(new FilterTask(phrases, options));
+    std::vector<std::string> &lines = task->Lines();
+    while (lines.size() < FILTER_BLOCK_SIZE) {
+      if (!table.ReadLineOrEOF(line)) {
+        eof = true;
+        break;
+      }
+      lines.push_back(line.as_string());
+    }
+    total += lines.size();
+    if (!lines.empty()) batch.push_back(task);
+    if (batch.size() >= batchSize || eof) {
+      used += FilterBatch(batch, options.threads);
+    }
+  }
+  std::fflush(stdout);
+
+  if (total == 0) {
+    std::cerr << "No phrases found in " << (tableFile ? tableFile : "stdin") << "!" << std::endl;
+    return 1;
+  }
+  std::fprintf(stderr, "%lu of %lu phrases pairs used (%.2f%%) - note: max length %lu\n",
+               (unsigned long) used, (unsigned long) total, 100.0 * used / total,
+               (unsigned long) options.maxLength);
+  return 0;
+}
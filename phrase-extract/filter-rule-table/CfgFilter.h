@@ -20,7 +20,7 @@ public:
   virtual ~CfgFilter() {}
 
   // Read a rule table from 'in' and filter it according to the test sentences.
-  virtual void Filter(std::istream &in, std::ostream &out) = 0;
+  virtual void Filter(std::istream &in, std::ostream &out) const = 0;
 
 protected:
 };
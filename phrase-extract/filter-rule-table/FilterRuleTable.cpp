@@ -19,6 +19,7 @@
 
 #include "ForestTsgFilter.h"
 #include "Options.h"
+#include "ParallelFilter.h"
 #include "StringCfgFilter.h"
 #include "StringForest.h"
 #include "StringForestParser.h"
@@ -32,6 +33,25 @@ namespace Syntax
 namespace FilterRuleTable
 {
 
+namespace
+{
+
+// Filters the rule table on standard input, using multiple threads if
+// requested.
+template<typename FilterType>
+void RunFilter(const FilterType &filter, const Options &options)
+{
+#ifdef WITH_THREADS
+  if (options.numThreads > 1) {
+    FilterInParallel(filter, std::cin, std::cout, options.numThreads);
+    return;
+  }
+#endif
+  filter.Filter(std::cin, std::cout);
+}
+
+}  // namespace
+
 int FilterRuleTable::Main(int argc, char *argv[])
 {
   enum TestSentenceFormat {
@@ -80,7 +100,7 @@ int FilterRuleTable::Main(int argc, char *argv[])
     std::vector<boost::shared_ptr<std::string> > testStrings;
     ReadTestSet(testStream, testStrings);
     StringCfgFilter filter(testStrings);
-    filter.Filter(std::cin, std::cout);
+    RunFilter(filter, options);
   } else if (testSentenceFormat == kTree) {
     std::vector<boost::shared_ptr<StringTree> > testTrees;
     ReadTestSet(testStream, testTrees);
@@ -88,10 +108,10 @@ int FilterRuleTable::Main(int argc, char *argv[])
       // TODO Implement TreeCfgFilter
       Warn("tree/cfg filtering algorithm not implemented: input will be copied unchanged to output");
       TreeCfgFilter filter(testTrees);
-      filter.Filter(std::cin, std::cout);
+      RunFilter(filter, options);
     } else if (sourceSideRuleFormat == kTsg) {
       TreeTsgFilter filter(testTrees);
-      filter.Filter(std::cin, std::cout);
+      RunFilter(filter, options);
     } else {
       assert(false);
     }
@@ -100,7 +120,7 @@ int FilterRuleTable::Main(int argc, char *argv[])
     ReadTestSet(testStream, testForests);
     assert(sourceSideRuleFormat == kTsg);
     ForestTsgFilter filter(testForests);
-    filter.Filter(std::cin, std::cout);
+    RunFilter(filter, options);
   }
 
   return 0;
@@ -178,6 +198,12 @@ void FilterRuleTable::ProcessOptions(int argc, char *argv[],
 
   // Declare the command line options that are visible to the user.
   po::options_description visible(usageTop.str());
+  visible.add_options()
+  ("help", "print this help message and exit")
+  ("Threads",
+   po::value(&options.numThreads)->default_value(options.numThreads),
+   "filter with the given number of threads")
+  ;
 
   // Declare the command line options that are hidden from the user
   // (these are used as positional options).
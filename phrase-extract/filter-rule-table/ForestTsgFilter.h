@@ -52,10 +52,12 @@ private:
   typedef std::vector<InnerMap> IdToSentenceMap;
 
   // Forest-specific implementation of virtual function.
-  bool MatchFragment(const IdTree &, const std::vector<IdTree *> &);
+  bool MatchFragment(const IdTree &, const std::vector<IdTree *> &) const;
 
   // Try to match a fragment against a specific vertex of a test forest.
-  bool MatchFragment(const IdTree &, const IdForest::Vertex &);
+  // The counter is incremented on every call (see kMatchLimit).
+  bool MatchFragment(const IdTree &, const IdForest::Vertex &,
+                     std::size_t &) const;
 
   // Convert a StringForest to an IdForest (wrt m_testVocab).  Inserts symbols
   // into m_testVocab.
@@ -63,7 +65,6 @@ private:
 
   std::vector<boost::shared_ptr<IdForest> > m_sentences;
   IdToSentenceMap m_idToSentence;
-  std::size_t m_matchCount;
 };
 
 }  // namespace FilterRuleTable
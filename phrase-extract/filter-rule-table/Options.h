@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace MosesTraining
@@ -11,11 +12,14 @@ namespace FilterRuleTable
 
 struct Options {
 public:
-  Options() {}
+  Options() : numThreads(1) {}
 
   // Positional options
   std::string model;
   std::string testSetFile;
+
+  // All other options
+  std::size_t numThreads;
 };
 
 }  // namespace FilterRuleTable
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "moses/ThreadPool.h"
+
+namespace MosesTraining
+{
+namespace Syntax
+{
+namespace FilterRuleTable
+{
+
+#ifdef WITH_THREADS
+
+// Filters one block of rule table lines.  The filter's Filter() method must
+// be const and thread-safe.
+template<typename FilterType>
+class FilterBlockTask : public Moses::Task
+{
+public:
+  FilterBlockTask(const FilterType &filter, std::string &block)
+    : m_filter(filter)
+    , m_done(false) {
+    m_block.swap(block);
+  }
+
+  void Run() {
+    std::istringstream in(m_block);
+    m_filter.Filter(in, m_output);
+    std::string().swap(m_block);
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  // Blocks until Run() has finished, then writes the filtered block.
+  void Write(std::ostream &out) {
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (!m_done) {
+        m_cond.wait(lock);
+      }
+    }
+    out << m_output.str();
+  }
+
+private:
+  const FilterType &m_filter;
+  std::string m_block;
+  std::ostringstream m_output;
+  bool m_done;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+
+// Reads the rule table in blocks of blockSize lines and filters the blocks
+// on numThreads threads.  At most 2*numThreads blocks are held in memory at
+// once and the output is written in input order.
+template<typename FilterType>
+void FilterInParallel(const FilterType &filter, std::istream &in,
+                      std::ostream &out, std::size_t numThreads,
+                      std::size_t blockSize = 10000)
+{
+  typedef FilterBlockTask<FilterType> Task;
+
+  Moses::ThreadPool pool(numThreads);
+  std::deque<boost::shared_ptr<Task> > pending;
+  const std::size_t maxPending = 2 * numThreads;
+
+  std::string block;
+  std::string line;
+  std::size_t numLines = 0;
+  bool eof = false;
+  while (!eof) {
+    eof = !std::getline(in, line);
+    if (!eof) {
+      block += line;
+      block += '\n';
+      if (++numLines < blockSize) {
+        continue;
+      }
+    }
+    if (!block.empty()) {
+      boost::shared_ptr<Task> task(new Task(filter, block));
+      pending.push_back(task);
+      pool.Submit(task);
+      block.clear();
+      numLines = 0;
+    }
+    while (pending.size() > maxPending || (eof && !pending.empty())) {
+      pending.front()->Write(out);
+      pending.pop_front();
+    }
+  }
+  pool.Stop(true);
+}
+
+#endif  // WITH_THREADS
+
+}  // namespace FilterRuleTable
+}  // namespace Syntax
+}  // namespace MosesTraining
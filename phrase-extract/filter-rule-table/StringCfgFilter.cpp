@@ -50,7 +50,7 @@ StringCfgFilter::StringCfgFilter(
   }
 }
 
-void StringCfgFilter::Filter(std::istream &in, std::ostream &out)
+void StringCfgFilter::Filter(std::istream &in, std::ostream &out) const
 {
   const util::MultiCharacter fieldDelimiter("|||");
   const util::AnyCharacter symbolDelimiter(" \t");
@@ -16,7 +16,7 @@ TreeCfgFilter::TreeCfgFilter(
 {
 }
 
-void TreeCfgFilter::Filter(std::istream &in, std::ostream &out)
+void TreeCfgFilter::Filter(std::istream &in, std::ostream &out) const
 {
   // TODO Implement filtering!
   std::string line;
@@ -30,7 +30,7 @@ class TreeCfgFilter : public CfgFilter {
   // Initialize the filter for a given set of test sentences.
   TreeCfgFilter(const std::vector<boost::shared_ptr<StringTree> > &);
 
-  void Filter(std::istream &in, std::ostream &out);
+  void Filter(std::istream &in, std::ostream &out) const;
 };
 
 }  // namespace FilterRuleTable
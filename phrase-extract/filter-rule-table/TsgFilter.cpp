@@ -47,7 +47,7 @@ namespace FilterRuleTable
 // 24.1M    Number of rules requiring full tree matching test
 //  6.7M    Number of rules retained after filtering
 //
-void TsgFilter::Filter(std::istream &in, std::ostream &out)
+void TsgFilter::Filter(std::istream &in, std::ostream &out) const
 {
   const util::MultiCharacter delimiter("|||");
 
@@ -108,7 +108,7 @@ void TsgFilter::Filter(std::istream &in, std::ostream &out)
 
 TsgFilter::IdTree *TsgFilter::BuildTree(
   const std::vector<TreeFragmentToken> &tokens, int &i,
-  std::vector<IdTree *> &leaves)
+  std::vector<IdTree *> &leaves) const
 {
   // The subtree starting at tokens[i] is either:
   // 1. a single non-variable symbol (like NP or dog), or
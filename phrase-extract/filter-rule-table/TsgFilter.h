@@ -24,7 +24,7 @@ public:
   virtual ~TsgFilter() {}
 
   // Read a rule table from 'in' and filter it according to the test sentences.
-  void Filter(std::istream &in, std::ostream &out);
+  void Filter(std::istream &in, std::ostream &out) const;
 
 protected:
   // Maps symbols (terminals and non-terminals) from strings to integers.
@@ -40,11 +40,12 @@ protected:
   // pointers to the fragment's leaves.  If the build fails then i and leaves
   // are undefined.
   IdTree *BuildTree(const std::vector<TreeFragmentToken> &tokens, int &i,
-                    std::vector<IdTree *> &leaves);
+                    std::vector<IdTree *> &leaves) const;
 
   // Try to match a fragment.  The implementation depends on whether the test
   // sentences are trees or forests.
-  virtual bool MatchFragment(const IdTree &, const std::vector<IdTree *> &) = 0;
+  virtual bool MatchFragment(const IdTree &,
+                             const std::vector<IdTree *> &) const = 0;
 
   // The symbol vocabulary of the test sentences.
   Vocabulary m_testVocab;
@@ -6,7 +6,6 @@
 #include <cstdio>
 #include <sstream>
 #include <string>
-#include "zlib.h"
 
 #include "reordering_classes.h"
 
@@ -273,81 +272,68 @@ void ScorerLR::createConstSmoothing(double weight, vector<double>& smoothing) co
   }
 }
 
-void Model::score_fe(const string& f, const string& e)
+namespace
+{
+// appends the normalised, smoothed scores as "%f " each
+void appendScores(const Scorer &scorer, const vector<double> &counts,
+                  const vector<double> &smoothing, string &out)
+{
+  vector<double> scores;
+  scorer.score(counts, scores);
+  double sum = 0;
+  for(size_t i=0; i<scores.size(); ++i) {
+    scores[i] += smoothing[i];
+    sum += scores[i];
+  }
+  char buffer[64];
+  for(size_t i=0; i<scores.size(); ++i) {
+    snprintf(buffer, sizeof(buffer), "%f ", scores[i]/sum);
+    out += buffer;
+  }
+}
+}
+
+void Model::score_fe(const ModelScore& counts, const string& f, const string& e, string& out) const
 {
   if (!fe)    //Make sure we do not do anything if it is not a fe model
     return;
-  fprintf(file,"%s ||| %s ||| ",f.c_str(),e.c_str());
+  out += f;
+  out += " ||| ";
+  out += e;
+  out += " ||| ";
   //condition on the previous phrase
   if (previous) {
-    vector<double> scores;
-    scorer->score(modelscore->get_scores_fe_prev(), scores);
-    double sum = 0;
-    for(size_t i=0; i<scores.size(); ++i) {
-      scores[i] += smoothing_prev[i];
-      sum += scores[i];
-    }
-    for(size_t i=0; i<scores.size(); ++i) {
-      fprintf(file,"%f ",scores[i]/sum);
-    }
-    //fprintf(file, "||| ");
+    appendScores(*scorer, counts.get_scores_fe_prev(), smoothing_prev, out);
   }
   //condition on the next phrase
   if (next) {
-    vector<double> scores;
-    scorer->score(modelscore->get_scores_fe_next(), scores);
-    double sum = 0;
-    for(size_t i=0; i<scores.size(); ++i) {
-      scores[i] += smoothing_next[i];
-      sum += scores[i];
-    }
-    for(size_t i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
-    }
+    appendScores(*scorer, counts.get_scores_fe_next(), smoothing_next, out);
   }
-  fprintf(file,"\n");
+  out += '\n';
 }
 
-void Model::score_f(const string& f)
+void Model::score_f(const ModelScore& counts, const string& f, string& out) const
 {
   if (fe)      //Make sure we do not do anything if it is not a f model
     return;
-  fprintf(file, "%s ||| ", f.c_str());
+  out += f;
+  out += " ||| ";
   //condition on the previous phrase
   if (previous) {
-    vector<double> scores;
-    scorer->score(modelscore->get_scores_f_prev(), scores);
-    double sum = 0;
-    for(size_t i=0; i<scores.size(); ++i) {
-      scores[i] += smoothing_prev[i];
-      sum += scores[i];
-    }
-    for(size_t i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
-    }
-    //fprintf(file, "||| ");
+    appendScores(*scorer, counts.get_scores_f_prev(), smoothing_prev, out);
   }
   //condition on the next phrase
   if (next) {
-    vector<double> scores;
-    scorer->score(modelscore->get_scores_f_next(), scores);
-    double sum = 0;
-    for(size_t i=0; i<scores.size(); ++i) {
-      scores[i] += smoothing_next[i];
-      sum += scores[i];
-    }
-    for(size_t i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
-    }
+    appendScores(*scorer, counts.get_scores_f_next(), smoothing_next, out);
   }
-  fprintf(file, "\n");
+  out += '\n';
 }
 
 Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang, const string& fn)
-  : modelscore(ms), scorer(sc), filename(fn)
+  : modelscore(ms), scorer(sc), filename(fn + ".gz")
 {
 
-  file = fopen(filename.c_str(),"w");
+  file = gzopen(filename.c_str(), "wb");
   if (!file) {
     cerr << "Could not open the model output file: " << filename << endl;
     exit(1);
@@ -373,26 +359,25 @@ Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang,
 
 Model::~Model()
 {
-  fclose(file);
-  delete modelscore;
+  close();
   delete scorer;
 }
 
-void Model::zipFile()
+void Model::write(const string& out)
 {
-  fclose(file);
-  file = fopen(filename.c_str(), "rb");
-  gzFile gzfile = gzopen((filename+".gz").c_str(),"wb");
-  char inbuffer[128];
-  int num_read;
-  while ((num_read = fread(inbuffer, 1, sizeof(inbuffer), file)) > 0) {
-    gzwrite(gzfile, inbuffer, num_read);
+  if (!out.empty() && gzwrite(file, out.data(), out.size()) != static_cast<int>(out.size())) {
+    cerr << "Could not write the model output file: " << filename << endl;
+    exit(1);
   }
-  fclose(file);
-  gzclose(gzfile);
+}
 
-  //Remove the unzipped file
-  remove(filename.c_str());
+void Model::close()
+{
+  if (file && gzclose(file) != Z_OK) {
+    cerr << "Could not write the model output file: " << filename << endl;
+    exit(1);
+  }
+  file = NULL;
 }
 
 void Model::split_config(const string& config, string& dir, string& lang, string& orient)
@@ -12,6 +12,8 @@
 #include <string>
 #include <fstream>
 
+#include "zlib.h"
+
 #include "util/string_piece.hh"
 
 
@@ -116,13 +118,16 @@ public:
 //Contains a modelscore and scorer (which can be of different model types (mslr, msd...)),
 //and file handling.
 //This class also keeps track of bidirectionality, and which language to condition on
+//The modelscore, which may be shared by several models, only holds the counts
+//for the smoothing; the scores are computed from counts passed in, so that
+//several threads can score at once.
 class Model
 {
 private:
   ModelScore* modelscore;
   Scorer* scorer;
 
-  std::FILE* file;
+  gzFile file;
   std::string filename;
 
   bool fe;
@@ -141,8 +146,12 @@ public:
   static Model* createModel(ModelScore*, const std::string&, const std::string&);
   void createSmoothing(double w);
   void createConstSmoothing(double w);
-  void score_fe(const std::string& f, const std::string& e);
-  void score_f(const std::string& f);
-  void zipFile();
+  //! append the line of the table for f and e, if conditioned on both
+  void score_fe(const ModelScore& counts, const std::string& f, const std::string& e, std::string& out) const;
+  //! append the line of the table for f, if conditioned on f only
+  void score_f(const ModelScore& counts, const std::string& f, std::string& out) const;
+  //! write lines to the (compressed) table
+  void write(const std::string& out);
+  void close();
 };
 
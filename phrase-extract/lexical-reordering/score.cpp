@@ -14,19 +14,145 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <boost/shared_ptr.hpp>
+
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/file_piece.hh"
+#include "util/line_batch_reader.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
 
-#include "InputFileStream.h"
+#include "OrderedBlockWriter.h"
 #include "reordering_classes.h"
 
 using namespace std;
+using namespace MosesTraining;
 
 void split_line(const StringPiece& line, StringPiece& foreign, StringPiece& english, StringPiece& wbe, StringPiece& phrase, StringPiece& hier, float& weight);
 void get_orientations(const StringPiece& pair, StringPiece& previous, StringPiece& next);
 
+namespace
+{
+
+// lines per block, extended to the end of the last source phrase
+const size_t kBlockLines = 10000;
+
+// The models and how to count for them, shared by the blocks.
+struct Models {
+  vector<Model*> models;
+  // model type (hier, phrase or wbe) of each model
+  vector<string> names;
+  // orientation counts class (mslr, msd...) of each model type
+  map<string,string> countTypes;
+  bool hier, phrase, wbe;
+};
+
+// Source phrase of an extract line.
+StringPiece sourcePhrase(const StringPiece& line)
+{
+  size_t end = line.find(" ||| ");
+  return end == StringPiece::npos ? line : line.substr(0, end);
+}
+
+// The lines of a run of whole source phrases, scored from counts of its own:
+// nothing but the smoothing is summed over the whole extract file.
+class ScoreBlock : public OrderedBlockWriter::Block
+{
+public:
+  explicit ScoreBlock(Models& models) : m_models(models) {}
+
+  vector<string> lines;
+
+  void Format(ostream&) {
+    typedef map<string, boost::shared_ptr<ModelScore> > Counts;
+    Counts counts;
+    for(map<string,string>::const_iterator it = m_models.countTypes.begin(); it != m_models.countTypes.end(); ++it) {
+      counts[it->first].reset(ModelScore::createModelScore(it->second));
+    }
+    ModelScore* hierCounts = m_models.hier ? counts["hier"].get() : NULL;
+    ModelScore* phraseCounts = m_models.phrase ? counts["phrase"].get() : NULL;
+    ModelScore* wbeCounts = m_models.wbe ? counts["wbe"].get() : NULL;
+    const vector<Model*>& models = m_models.models;
+    vector<const ModelScore*> modelCounts;
+    for (size_t i=0; i<models.size(); ++i) {
+      modelCounts.push_back(counts[m_models.names[i]].get());
+    }
+    m_out.assign(models.size(), string());
+
+    StringPiece e,f,w,p,h;
+    StringPiece prev, next;
+    string f_current,e_current;
+    for (size_t l=0; l<lines.size(); ++l) {
+      float weight = 1;
+      split_line(lines[l],f,e,w,p,h,weight);
+
+      if (l == 0) {
+        f_current = f.as_string();
+        e_current = e.as_string();
+      } else if (f.compare(f_current) != 0 || e.compare(e_current) != 0) {
+        //fe - score
+        for (size_t i=0; i<models.size(); ++i) {
+          models[i]->score_fe(*modelCounts[i],f_current,e_current,m_out[i]);
+        }
+        //reset
+        for(Counts::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+          it->second->reset_fe();
+        }
+
+        if (f.compare(f_current) != 0) {
+          //f - score
+          for (size_t i=0; i<models.size(); ++i) {
+            models[i]->score_f(*modelCounts[i],f_current,m_out[i]);
+          }
+          //reset
+          for(Counts::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+            it->second->reset_f();
+          }
+          f_current.assign(f.data(), f.size());
+        }
+        e_current.assign(e.data(), e.size());
+      }
+
+      // uppdate counts
+      if (hierCounts) {
+        get_orientations(h, prev, next);
+        hierCounts->add_example(prev,next,weight);
+      }
+      if (phraseCounts) {
+        get_orientations(p, prev, next);
+        phraseCounts->add_example(prev,next,weight);
+      }
+      if (wbeCounts) {
+        get_orientations(w, prev, next);
+        wbeCounts->add_example(prev,next,weight);
+      }
+    }
+    //Score the last phrases
+    if (!lines.empty()) {
+      for (size_t i=0; i<models.size(); ++i) {
+        models[i]->score_fe(*modelCounts[i],f_current,e_current,m_out[i]);
+      }
+      for (size_t i=0; i<models.size(); ++i) {
+        models[i]->score_f(*modelCounts[i],f_current,m_out[i]);
+      }
+    }
+    vector<string>().swap(lines);
+  }
+
+  void Commit() {
+    for (size_t i=0; i<m_models.models.size(); ++i) {
+      m_models.models[i]->write(m_out[i]);
+    }
+  }
+
+private:
+  Models& m_models;
+  vector<string> m_out;
+};
+
+}
+
 class FileFormatException : public util::Exception
 {
 public:
@@ -43,7 +169,7 @@ int main(int argc, char* argv[])
        << "scores lexical reordering models of several types (hierarchical, phrase-based and word-based-extraction\n";
 
   if (argc < 3) {
-    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+\n";
+    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+ [--SmoothWithCounts] [--Threads n]\n";
     exit(1);
   }
 
@@ -51,14 +177,15 @@ int main(int argc, char* argv[])
   double smoothingValue = atof(argv[2]);
   string filepath = argv[3];
 
-  util::FilePiece eFile(extractFileName);
-
   bool smoothWithCounts = false;
+  size_t threads = 1;
   map<string,ModelScore*> modelScores;
-  vector<Model*> models;
-  bool hier = false;
-  bool phrase = false;
-  bool wbe = false;
+  Models scoring;
+  scoring.hier = scoring.phrase = scoring.wbe = false;
+  vector<Model*>& models = scoring.models;
+  bool& hier = scoring.hier;
+  bool& phrase = scoring.phrase;
+  bool& wbe = scoring.wbe;
 
   StringPiece e,f,w,p,h;
   StringPiece prev, next;
@@ -67,6 +194,8 @@ int main(int argc, char* argv[])
   while (i<argc) {
     if (strcmp(argv[i],"--SmoothWithCounts") == 0) {
       smoothWithCounts = true;
+    } else if (strcmp(argv[i],"--Threads") == 0 && i+1 < argc) {
+      threads = atoi(argv[++i]);
     } else if (strcmp(argv[i],"--model") == 0) {
       if (i+1 >= argc) {
         cerr << "score: syntax error, no model information provided to the option" << argv[i] << endl;
@@ -76,6 +205,7 @@ int main(int argc, char* argv[])
       string m,t;
       is >> m >> t;
       modelScores[m] = ModelScore::createModelScore(t);
+      scoring.countTypes[m] = t;
       if (m.compare("hier") == 0) {
         hier = true;
       } else if (m.compare("phrase") == 0) {
@@ -94,6 +224,7 @@ int main(int argc, char* argv[])
       //Store all models
       while (is >> config) {
         models.push_back(Model::createModel(modelScores[m],config,filepath));
+        scoring.names.push_back(m);
       }
     } else {
       cerr << "illegal option given to lexical reordering model score\n";
@@ -142,72 +273,23 @@ int main(int argc, char* argv[])
   }
 
   ////////////////////////////////////
-  //calculate scores for reordering table
-  string f_current,e_current;
-  bool first = true;
-  while (true) {
-    StringPiece line;
-    try {
-      line = eFile.ReadLine();
-    } catch (util::EndOfFileException &e) {
-      break;
-    }
-    float weight = 1;
-    split_line(line,f,e,w,p,h,weight);
-
-    if (first) {
-      f_current = f.as_string(); //FIXME: Avoid the copy.
-      e_current = e.as_string();
-      first = false;
-    } else if (f.compare(f_current) != 0 || e.compare(e_current) != 0) {
-      //fe - score
-      for (size_t i=0; i<models.size(); ++i) {
-        models[i]->score_fe(f_current,e_current);
-      }
-      //reset
-      for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
-        it->second->reset_fe();
-      }
-
-      if (f.compare(f_current) != 0) {
-        //f - score
-        for (size_t i=0; i<models.size(); ++i) {
-          models[i]->score_f(f_current);
-        }
-        //reset
-        for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
-          it->second->reset_f();
-        }
-      }
-      f_current = f.as_string();
-      e_current = e.as_string();
+  //calculate scores for reordering table, in blocks of whole source phrases
+  util::LineBatchReader eFile(util::OpenReadOrThrow(extractFileName));
+  OrderedBlockWriter writer(threads);
+  ScoreBlock* block = new ScoreBlock(scoring);
+  string line;
+  while (eFile.ReadLine(line)) {
+    if (block->lines.size() >= kBlockLines && sourcePhrase(line) != sourcePhrase(block->lines.back())) {
+      writer.Add(block);
+      block = new ScoreBlock(scoring);
     }
-
-    // uppdate counts
-    if (hier) {
-      get_orientations(h, prev, next);
-      modelScores["hier"]->add_example(prev,next,weight);
-    }
-    if (phrase) {
-      get_orientations(p, prev, next);
-      modelScores["phrase"]->add_example(prev,next,weight);
-    }
-    if (wbe) {
-      get_orientations(w, prev, next);
-      modelScores["wbe"]->add_example(prev,next,weight);
-    }
-  }
-  //Score the last phrases
-  for (size_t i=0; i<models.size(); ++i) {
-    models[i]->score_fe(f_current,e_current);
-  }
-  for (size_t i=0; i<models.size(); ++i) {
-    models[i]->score_f(f_current);
+    block->lines.push_back(line);
   }
+  writer.Add(block);
+  writer.Finish();
 
-  //Zip all files
   for (size_t i=0; i<models.size(); ++i) {
-    models[i]->zipFile();
+    models[i]->close();
   }
 
   return 0;
@@ -0,0 +1,126 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Sorts lines like LC_ALL=C sort, taking the options the training scripts
+// pass to sort. Input may be gzipped, bzipped or xzipped.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ExternalSort.h"
+#include "util/exception.hh"
+#include "util/fake_ofstream.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+#include "util/usage.hh"
+
+using namespace std;
+using namespace MosesTraining;
+
+namespace
+{
+
+void usage()
+{
+  cerr << "syntax: moses-sort [-u] [-T dir] [-S size] [--parallel=n] [--batch-size=n] [-o output] [file ...]" << endl
+       << "  sorts lines in byte order (as LC_ALL=C sort), reading stdin if no file is given" << endl
+       << "  --compress-program is accepted and ignored, temporary files are always gzipped" << endl;
+  exit(1);
+}
+
+// value of an option given as "-x value", "--xx value" or "--xx=value"
+bool optionValue(int argc, char **argv, int &i, const char *shortName, const char *longName, string &value)
+{
+  string arg(argv[i]);
+  const string longPrefix = string(longName) + "=";
+  if (arg.compare(0, longPrefix.size(), longPrefix) == 0) {
+    value = arg.substr(longPrefix.size());
+    return true;
+  }
+  if (arg == longName || (shortName && arg == shortName)) {
+    if (++i == argc) usage();
+    value = argv[i];
+    return true;
+  }
+  // "-S10G"
+  if (shortName && arg.size() > 2 && arg.compare(0, 2, shortName) == 0) {
+    value = arg.substr(2);
+    return true;
+  }
+  return false;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  ExternalSort::Options options;
+  string outputFile;
+  vector<string> inputFiles;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      string value;
+      if (strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--unique") == 0) {
+        options.unique = true;
+      } else if (optionValue(argc, argv, i, "-T", "--temporary-directory", value)) {
+        options.tempDir = value;
+      } else if (optionValue(argc, argv, i, "-S", "--buffer-size", value)) {
+        options.memory = util::ParseSize(value);
+      } else if (optionValue(argc, argv, i, NULL, "--parallel", value)) {
+        options.threads = atoi(value.c_str());
+      } else if (optionValue(argc, argv, i, NULL, "--batch-size", value)) {
+        options.batchSize = atoi(value.c_str());
+      } else if (optionValue(argc, argv, i, NULL, "--compress-program", value)) {
+        // runs are gzipped by zlib
+      } else if (optionValue(argc, argv, i, "-o", "--output", value)) {
+        outputFile = value;
+      } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+        cerr << "moses-sort: unknown option " << argv[i] << endl;
+        usage();
+      } else {
+        inputFiles.push_back(argv[i]);
+      }
+    }
+    if (inputFiles.empty()) inputFiles.push_back("-");
+
+    ExternalSort sorter(options);
+    string line;
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+      int fd = inputFiles[i] == "-" ? util::DupOrThrow(0) : util::OpenReadOrThrow(inputFiles[i].c_str());
+      util::LineBatchReader in(fd);
+      while (in.ReadLine(line)) {
+        sorter.Add(line);
+      }
+    }
+
+    util::scoped_fd output(outputFile.empty() ? util::DupOrThrow(1) : util::CreateOrThrow(outputFile.c_str()));
+    {
+      util::FakeOFStream out(output.get());
+      sorter.Finish(out);
+    }
+  } catch (const std::exception &e) {
+    cerr << "moses-sort: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
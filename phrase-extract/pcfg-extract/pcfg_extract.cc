@@ -25,6 +25,12 @@
 
 #include "syntax-common/exception.h"
 
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+
+#include "OrderedBlockWriter.h"
+
 #include "pcfg-common/pcfg.h"
 #include "pcfg-common/pcfg_tree.h"
 #include "pcfg-common/syntax_tree.h"
@@ -32,6 +38,7 @@
 #include "pcfg-common/xml_tree_parser.h"
 
 #include <boost/program_options.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #include <cassert>
 #include <cstdlib>
@@ -40,6 +47,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -47,6 +55,64 @@ namespace MosesTraining {
 namespace Syntax {
 namespace PCFG {
 
+namespace {
+// Lines parsed by one thread at a time.
+const std::size_t kBlockLines = 1000;
+}
+
+// A batch of input lines.  The trees are parsed in parallel by Format() and
+// their rules extracted in input order by Commit(), so that non-terminals
+// are numbered as they would be by a single thread.
+class PcfgExtract::Block : public OrderedBlockWriter::Block {
+ public:
+  Block(const PcfgExtract &tool, const RuleExtractor &rule_extractor,
+        RuleCollection &rule_collection, std::size_t first_line_num)
+      : tool_(tool)
+      , rule_extractor_(rule_extractor)
+      , rule_collection_(rule_collection)
+      , first_line_num_(first_line_num) {}
+
+  std::vector<std::string> lines;
+
+  void Format(std::ostream &) {
+    XmlTreeParser parser;
+    std::auto_ptr<PcfgTree> tree;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+      const std::size_t line_num = first_line_num_ + i;
+      try {
+        tree = parser.Parse(lines[i]);
+      } catch (Exception &e) {
+        std::ostringstream msg;
+        msg << "line " << line_num << ": " << e.msg();
+        throw std::runtime_error(msg.str());
+      }
+      trees_.push_back(tree.release());
+      line_nums_.push_back(line_num);
+    }
+    std::vector<std::string>().swap(lines);
+  }
+
+  void Commit() {
+    for (std::size_t i = 0; i < trees_.size(); ++i) {
+      if (trees_.is_null(i)) {
+        std::ostringstream msg;
+        msg << "no tree at line " << line_nums_[i];
+        tool_.Warn(msg.str());
+        continue;
+      }
+      rule_extractor_.Extract(trees_[i], rule_collection_);
+    }
+  }
+
+ private:
+  const PcfgExtract &tool_;
+  const RuleExtractor &rule_extractor_;
+  RuleCollection &rule_collection_;
+  const std::size_t first_line_num_;
+  boost::ptr_vector<boost::nullable<PcfgTree> > trees_;
+  std::vector<std::size_t> line_nums_;
+};
+
 int PcfgExtract::Main(int argc, char *argv[]) {
   // Process command-line options.
   Options options;
@@ -56,26 +122,30 @@ int PcfgExtract::Main(int argc, char *argv[]) {
   Vocabulary non_term_vocab;
   RuleExtractor rule_extractor(non_term_vocab);
   RuleCollection rule_collection;
-  XmlTreeParser parser;
+  util::LineBatchReader input(util::DupOrThrow(0));
   std::string line;
   std::size_t line_num = 0;
-  std::auto_ptr<PcfgTree> tree;
-  while (std::getline(std::cin, line)) {
-    ++line_num;
-    try {
-      tree = parser.Parse(line);
-    } catch (Exception &e) {
-      std::ostringstream msg;
-      msg << "line " << line_num << ": " << e.msg();
-      Error(msg.str());
+  Block *block = NULL;
+  try {
+    // Nothing is written: the blocks only hand their trees back in order.
+    OrderedBlockWriter parsed(std::cout, options.num_threads);
+    while (input.ReadLine(line)) {
+      ++line_num;
+      if (!block) {
+        block = new Block(*this, rule_extractor, rule_collection, line_num);
+      }
+      block->lines.push_back(line);
+      if (block->lines.size() == kBlockLines) {
+        parsed.Add(block);
+        block = NULL;
+      }
     }
-    if (!tree.get()) {
-      std::ostringstream msg;
-      msg << "no tree at line " << line_num;
-      Warn(msg.str());
-      continue;
+    if (block) {
+      parsed.Add(block);
     }
-    rule_extractor.Extract(*tree, rule_collection);
+    parsed.Finish();
+  } catch (const util::Exception &e) {
+    Error(e.what());
   }
 
   // Score rules and write PCFG to output.
@@ -97,6 +167,9 @@ void PcfgExtract::ProcessOptions(int argc, char *argv[],
   po::options_description visible(usage_top.str());
   visible.add_options()
     ("help", "print help message and exit")
+    ("threads", po::value(&options.num_threads)->
+                    default_value(options.num_threads),
+     "number of threads parsing trees")
   ;
 
   // Declare the command line options that are hidden from the user
@@ -38,6 +38,8 @@ public:
   PcfgExtract() : Tool("pcfg-extract") {}
   virtual int Main(int, char *[]);
 private:
+  class Block;
+
   void ProcessOptions(int, char *[], Options &) const;
 };
 
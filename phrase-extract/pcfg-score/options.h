@@ -31,7 +31,9 @@ namespace PCFG
 {
 
 struct Options {
+  Options() : num_threads(1) {}
   std::string pcfg_file;
+  int num_threads;
 };
 
 }  // namespace PCFG
@@ -26,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "options.h"
@@ -33,18 +34,86 @@
 
 #include <boost/program_options.hpp>
 
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
+
 #include "syntax-common/exception.h"
 
+#include "OrderedBlockWriter.h"
+
 #include "pcfg-common/pcfg.h"
 #include "pcfg-common/pcfg_tree.h"
 #include "pcfg-common/syntax_tree.h"
 #include "pcfg-common/typedef.h"
 #include "pcfg-common/xml_tree_parser.h"
+#include "pcfg-common/xml_tree_writer.h"
 
 namespace MosesTraining {
 namespace Syntax {
 namespace PCFG {
 
+namespace {
+// Lines parsed by one thread at a time.
+const std::size_t kBlockLines = 1000;
+}
+
+// A batch of input lines, which are parsed and scored by one thread.
+class PcfgScore::Block : public OrderedBlockWriter::Block {
+ public:
+  Block(const PcfgScore &tool, const TreeScorer &scorer,
+        std::size_t first_line_num)
+      : tool_(tool)
+      , scorer_(scorer)
+      , first_line_num_(first_line_num) {}
+
+  std::vector<std::string> lines;
+
+  void Format(std::ostream &out) {
+    XmlTreeParser parser;
+    XmlTreeWriter<PcfgTree> writer;
+    std::auto_ptr<PcfgTree> tree;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+      const std::string &line = lines[i];
+      const std::size_t line_num = first_line_num_ + i;
+      try {
+        tree = parser.Parse(line);
+      } catch (Exception &e) {
+        std::ostringstream msg;
+        msg << "line " << line_num << ": " << e.msg();
+        throw std::runtime_error(msg.str());
+      }
+      if (!tree.get()) {
+        std::ostringstream msg;
+        msg << "no tree at line " << line_num;
+        warnings_.push_back(msg.str());
+        out << line << '\n';
+        continue;
+      }
+      if (!scorer_.Score(*tree)) {
+        std::ostringstream msg;
+        msg << "failed to score tree at line " << line_num;
+        warnings_.push_back(msg.str());
+        out << line << '\n';
+        continue;
+      }
+      writer.Write(*tree, out);
+    }
+  }
+
+  void Commit() {
+    for (std::size_t i = 0; i < warnings_.size(); ++i) {
+      tool_.Warn(warnings_[i]);
+    }
+  }
+
+ private:
+  const PcfgScore &tool_;
+  const TreeScorer &scorer_;
+  const std::size_t first_line_num_;
+  std::vector<std::string> warnings_;
+};
+
 int PcfgScore::Main(int argc, char *argv[]) {
   // Process command-line options.
   Options options;
@@ -59,37 +128,32 @@ int PcfgScore::Main(int argc, char *argv[]) {
   Vocabulary non_term_vocab;
   pcfg.Read(pcfg_stream, non_term_vocab);
 
-  // Score corpus according to PCFG.
+  // Score corpus according to PCFG, in batches of lines that are parsed
+  // and scored in parallel and written in order.
   TreeScorer scorer(pcfg, non_term_vocab);
-  XmlTreeParser parser;
-  XmlTreeWriter<PcfgTree> writer;
+  util::LineBatchReader input(util::DupOrThrow(0));
+  OrderedBlockWriter output(std::cout, options.num_threads);
   std::string line;
   std::size_t line_num = 0;
-  std::auto_ptr<PcfgTree> tree;
-  while (std::getline(std::cin, line)) {
-    ++line_num;
-    try {
-      tree = parser.Parse(line);
-    } catch (Exception &e) {
-      std::ostringstream msg;
-      msg << "line " << line_num << ": " << e.msg();
-      Error(msg.str());
-    }
-    if (!tree.get()) {
-      std::ostringstream msg;
-      msg << "no tree at line " << line_num;
-      Warn(msg.str());
-      std::cout << line << std::endl;
-      continue;
+  Block *block = NULL;
+  try {
+    while (input.ReadLine(line)) {
+      ++line_num;
+      if (!block) {
+        block = new Block(*this, scorer, line_num);
+      }
+      block->lines.push_back(line);
+      if (block->lines.size() == kBlockLines) {
+        output.Add(block);
+        block = NULL;
+      }
     }
-    if (!scorer.Score(*tree)) {
-      std::ostringstream msg;
-      msg << "failed to score tree at line " << line_num;
-      Warn(msg.str());
-      std::cout << line << std::endl;
-      continue;
+    if (block) {
+      output.Add(block);
     }
-    writer.Write(*tree, std::cout);
+    output.Finish();
+  } catch (const util::Exception &e) {
+    Error(e.what());
   }
 
   return 0;
@@ -106,6 +170,9 @@ void PcfgScore::ProcessOptions(int argc, char *argv[], Options &options) const {
   po::options_description visible(usage_top.str());
   visible.add_options()
     ("help", "print help message and exit")
+    ("threads", po::value(&options.num_threads)->
+                    default_value(options.num_threads),
+     "number of threads parsing and scoring trees")
   ;
 
   // Declare the command line options that are hidden from the user
@@ -38,6 +38,8 @@ public:
   PcfgScore() : Tool("pcfg-score") {}
   virtual int Main(int, char *[]);
 private:
+  class Block;
+
   void ProcessOptions(int, char *[], Options &) const;
 };
 
@@ -32,9 +32,12 @@
 #include "ExtractionPhrasePair.h"
 #include "score.h"
 #include "InputFileStream.h"
+#include "OrderedBlockWriter.h"
 #include "OutputFileStream.h"
 
 #include "moses/Util.h"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
 
 using namespace boost::algorithm;
 using namespace MosesTraining;
@@ -92,6 +95,7 @@ std::vector<float> orientationClassPriorsR2L(4,0); // mono swap dleft dright
 
 Vocabulary vcbT;
 Vocabulary vcbS;
+WORD_ID nullWordS = 0;
 
 } // namespace
 
@@ -110,6 +114,9 @@ void writeLabelSet( const std::set<std::string> &labelSet, const std::string &fi
 void processPhrasePairs( std::vector< ExtractionPhrasePair* > &phrasePairsWithSameSource, std::ostream &phraseTableFile,
                          const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb );
 void outputPhrasePair(const ExtractionPhrasePair &phrasePair, float, int, std::ostream &phraseTableFile, const ScoreFeatureManager &featureManager, const MaybeLog &maybeLog );
+void countPhrasePair( const ExtractionPhrasePair &phrasePair );
+bool isBelowMinCountHierarchical( const ExtractionPhrasePair &phrasePair );
+std::string collectLabels( const ExtractionPhrasePair &phrasePair, const std::string &propertyKey );
 double computeLexicalTranslation( const PHRASE *phraseSource, const PHRASE *phraseTarget, const ALIGNMENT *alignmentTargetToSource );
 double computeUnalignedPenalty( const ALIGNMENT *alignmentTargetToSource );
 std::set<std::string> functionWordList;
@@ -122,6 +129,56 @@ void printTargetPhrase( const PHRASE *phraseSource, const PHRASE *phraseTarget,
 void invertAlignment( const PHRASE *phraseSource, const PHRASE *phraseTarget, const ALIGNMENT *inTargetToSourceAlignment, ALIGNMENT *outSourceToTargetAlignment );
 size_t NumNonTerminal(const PHRASE *phraseSource);
 
+namespace
+{
+// Extract lines scored by one thread at a time (rounded up to whole groups).
+const size_t kBlockLines = 1000;
+
+// Consecutive groups of phrase pairs with the same source, which are scored
+// by one thread. The totals over the whole input (count of counts and the
+// label sets and counts) are only added to in Commit(), in input order.
+class ScoreBlock : public OrderedBlockWriter::Block
+{
+public:
+  ScoreBlock(const ScoreFeatureManager &featureManager, const MaybeLog &maybeLogProb)
+    : m_featureManager(featureManager)
+    , m_maybeLogProb(maybeLogProb) {}
+
+  ~ScoreBlock() {
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+      for (size_t j = 0; j < m_groups[i].size(); ++j) {
+        delete m_groups[i][j];
+      }
+    }
+  }
+
+  // Takes the phrase pairs over, leaving phrasePairs empty.
+  void AddGroup(std::vector< ExtractionPhrasePair* > &phrasePairs) {
+    m_groups.resize(m_groups.size()+1);
+    m_groups.back().swap(phrasePairs);
+  }
+
+  void Format(std::ostream &out) {
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+      processPhrasePairs(m_groups[i], out, m_featureManager, m_maybeLogProb);
+    }
+  }
+
+  void Commit() {
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+      for (size_t j = 0; j < m_groups[i].size(); ++j) {
+        countPhrasePair(*m_groups[i][j]);
+      }
+    }
+  }
+
+private:
+  const ScoreFeatureManager &m_featureManager;
+  const MaybeLog &m_maybeLogProb;
+  std::vector< std::vector< ExtractionPhrasePair* > > m_groups;
+};
+}
+
 
 int main(int argc, char* argv[])
 {
@@ -130,7 +187,7 @@ int main(int argc, char* argv[])
 
   ScoreFeatureManager featureManager;
   if (argc < 4) {
-    std::cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--NoWordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--PartsOfSpeech] [--PCFG] [--TreeFragments] [--SourceLabels] [--SourceLabelCountsLHS] [--TargetPreferenceLabels] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--CrossedNonTerm]" << std::endl;
+    std::cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--NoWordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--PartsOfSpeech] [--PCFG] [--TreeFragments] [--SourceLabels] [--SourceLabelCountsLHS] [--TargetPreferenceLabels] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--CrossedNonTerm] [--Threads num]" << std::endl;
     std::cerr << featureManager.usage() << std::endl;
     exit(1);
   }
@@ -148,6 +205,7 @@ int main(int argc, char* argv[])
   std::string fileNameLeftHandSideRuleTargetTargetPreferenceLabelCounts;
   std::string fileNamePhraseOrientationPriors;
   std::vector<std::string> featureArgs; // all unknown args passed to feature manager
+  size_t numThreads = 1;
 
   for(int i=4; i<argc; i++) {
     if (strcmp(argv[i],"inverse") == 0 || strcmp(argv[i],"--Inverse") == 0) {
@@ -253,6 +311,16 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--NonTermContextTarget") == 0) {
       nonTermContextTarget = true;
       std::cerr << "non-term context (target)" << std::endl;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+      if (i+1==argc) {
+        std::cerr << "ERROR: specify the number of threads!" << std::endl;
+        exit(1);
+      }
+      numThreads = Moses::Scan<size_t>( argv[++i] );
+      if (numThreads == 0) {
+        numThreads = 1;
+      }
+      std::cerr << "scoring on " << numThreads << " threads" << std::endl;
     } else {
       featureArgs.push_back(argv[i]);
       ++i;
@@ -273,6 +341,7 @@ int main(int argc, char* argv[])
   // lexical translation table
   if (lexFlag) {
     lexTable.load( fileNameLex );
+    nullWordS = vcbS.getWordID("NULL");
   }
 
   // function word list
@@ -289,13 +358,16 @@ int main(int argc, char* argv[])
     loadOrientationPriors(fileNamePhraseOrientationPriors,orientationClassPriorsL2R,orientationClassPriorsR2L);
   }
 
-  // sorted phrase extraction file
-  Moses::InputFileStream extractFile(fileNameExtract);
-
-  if (extractFile.fail()) {
+  // sorted phrase extraction file, read and decompressed ahead on a
+  // background thread
+  int extractFd = -1;
+  try {
+    extractFd = util::OpenReadOrThrow(fileNameExtract.c_str());
+  } catch (const util::Exception &e) {
     std::cerr << "ERROR: could not open extract file " << fileNameExtract << std::endl;
     exit(1);
   }
+  util::LineBatchStream extractFile(extractFd);
 
   // output file: phrase translation table
   std::ostream *phraseTableFile;
@@ -313,6 +385,12 @@ int main(int argc, char* argv[])
     phraseTableFile = outputFile;
   }
 
+  // groups of phrase pairs with the same source are scored in parallel, in
+  // blocks of whole groups, and written in order
+  OrderedBlockWriter writer(*phraseTableFile, numThreads);
+  ScoreBlock *block = new ScoreBlock(featureManager, maybeLogProb);
+  size_t blockLines = 0;
+
   // loop through all extracted phrase translations
   std::string line, lastLine;
   lastLine[0] = '\0';
@@ -329,6 +407,7 @@ int main(int argc, char* argv[])
   int i=0;
   if ( getline(extractFile, line) ) {
     ++i;
+    ++blockLines;
     tmpPhraseSource = new PHRASE();
     tmpPhraseTarget = new PHRASE();
     tmpTargetToSourceAlignment = new ALIGNMENT();
@@ -354,6 +433,7 @@ int main(int argc, char* argv[])
     if ( ++i % 100000 == 0 ) {
       std::cerr << "." << std::flush;
     }
+    ++blockLines;
 
     // identical to last line? just add count
     if (line == lastLine) {
@@ -410,12 +490,12 @@ int main(int argc, char* argv[])
 
       if ( !phrasePairsWithSameSource.empty() &&
            !sourceMatch ) {
-        processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
-        for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
-              iter!=phrasePairsWithSameSource.end(); ++iter) {
-          delete *iter;
+        block->AddGroup( phrasePairsWithSameSource );
+        if ( blockLines >= kBlockLines ) {
+          writer.Add( block );
+          block = new ScoreBlock(featureManager, maybeLogProb);
+          blockLines = 0;
         }
-        phrasePairsWithSameSource.clear();
         if ( hierarchicalFlag ) {
           phrasePairsWithSameSourceAndTarget.clear();
         }
@@ -442,12 +522,14 @@ int main(int argc, char* argv[])
 
   }
 
-  processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
-  for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
-        iter!=phrasePairsWithSameSource.end(); ++iter) {
-    delete *iter;
+  block->AddGroup( phrasePairsWithSameSource );
+  writer.Add( block );
+  try {
+    writer.Finish();
+  } catch (const util::Exception &e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    exit(1);
   }
-  phrasePairsWithSameSource.clear();
 
 
   phraseTableFile->flush();
@@ -683,15 +765,6 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
 
   std::map< std::string, float > domainCount;
 
-  // collect count of count statistics
-  if (goodTuringFlag || kneserNeyFlag) {
-    totalDistinct++;
-    int countInt = count + 0.99999;
-    if ((countInt <= COC_MAX) &&
-        (countInt > 0))
-      countOfCounts[ countInt ]++;
-  }
-
   // compute PCFG score
   float pcfgScore = 0;
   if (pcfgFlag && !inverseFlag) {
@@ -703,11 +776,8 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
   const PHRASE *phraseTarget = phrasePair.GetTarget();
 
   // do not output if hierarchical and count below threshold
-  if (hierarchicalFlag && count < minCountHierarchical) {
-    for(size_t j=0; j<phraseSource->size()-1; ++j) {
-      if (isNonTerminal(vcbS.getWord( phraseSource->at(j) )))
-        return;
-    }
+  if (isBelowMinCountHierarchical(phrasePair)) {
+    return;
   }
 
   // source phrase (unless inverse)
@@ -829,7 +899,6 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
 
   // parts-of-speech
   if (partsOfSpeechFlag && !inverseFlag) {
-    phrasePair.UpdateVocabularyFromValueTokens("POS", partsOfSpeechSet);
     const std::string *bestPartOfSpeech = phrasePair.FindBestPropertyValue("POS");
     if (bestPartOfSpeech) {
       phraseTableFile << " {{POS " << *bestPartOfSpeech << "}}";
@@ -845,12 +914,7 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
     }
     // source syntax labels
     if (sourceSyntaxLabelsFlag) {
-      std::string sourceLabelCounts;
-      sourceLabelCounts = phrasePair.CollectAllLabelsSeparateLHSAndRHS("SourceLabels",
-                          sourceLabelSet,
-                          sourceLHSCounts,
-                          targetLHSAndSourceLHSJointCounts,
-                          vcbT);
+      std::string sourceLabelCounts = collectLabels(phrasePair, "SourceLabels");
       if ( !sourceLabelCounts.empty() ) {
         phraseTableFile << " {{SourceLabels "
                         << phraseSource->size() // for convenience: number of symbols in this rule (incl. left hand side NT)
@@ -862,12 +926,7 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
     }
     // target preference labels
     if (targetPreferenceLabelsFlag) {
-      std::string targetPreferenceLabelCounts;
-      targetPreferenceLabelCounts = phrasePair.CollectAllLabelsSeparateLHSAndRHS("TargetPreferences",
-                                    targetPreferenceLabelSet,
-                                    targetPreferenceLHSCounts,
-                                    ruleTargetLHSAndTargetPreferenceLHSJointCounts,
-                                    vcbT);
+      std::string targetPreferenceLabelCounts = collectLabels(phrasePair, "TargetPreferences");
       if ( !targetPreferenceLabelCounts.empty() ) {
         phraseTableFile << " {{TargetPreferences "
                         << nNTs // for convenience: number of non-terminal symbols in this rule (incl. left hand side NT)
@@ -919,6 +978,71 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
   phraseTableFile << std::endl;
 }
 
+bool isBelowMinCountHierarchical( const ExtractionPhrasePair &phrasePair )
+{
+  if (!hierarchicalFlag || phrasePair.GetCount() >= minCountHierarchical) {
+    return false;
+  }
+  const PHRASE *phraseSource = phrasePair.GetSource();
+  for(size_t j=0; j<phraseSource->size()-1; ++j) {
+    if (isNonTerminal(vcbS.getWord( phraseSource->at(j) )))
+      return true;
+  }
+  return false;
+}
+
+// The label counts of a rule as printed, without adding to the totals.
+std::string collectLabels( const ExtractionPhrasePair &phrasePair, const std::string &propertyKey )
+{
+  std::set<std::string> labelSet;
+  boost::unordered_map<std::string,float> countsLHS;
+  boost::unordered_map<std::string, boost::unordered_map<std::string,float>* > jointCounts;
+  std::string labelCounts = phrasePair.CollectAllLabelsSeparateLHSAndRHS(propertyKey,
+                            labelSet, countsLHS, jointCounts, vcbT);
+  for (boost::unordered_map<std::string, boost::unordered_map<std::string,float>* >::const_iterator iter=jointCounts.begin();
+       iter!=jointCounts.end(); ++iter) {
+    delete iter->second;
+  }
+  return labelCounts;
+}
+
+// Adds a phrase pair to the count of counts and the label sets and counts
+// that are written after the phrase table, in the same order and with the
+// same values as outputPhrasePair() without threads did.
+void countPhrasePair( const ExtractionPhrasePair &phrasePair )
+{
+  // collect count of count statistics
+  if (goodTuringFlag || kneserNeyFlag) {
+    totalDistinct++;
+    int countInt = phrasePair.GetCount() + 0.99999;
+    if ((countInt <= COC_MAX) &&
+        (countInt > 0))
+      countOfCounts[ countInt ]++;
+  }
+
+  if (inverseFlag || isBelowMinCountHierarchical(phrasePair)) {
+    return;
+  }
+
+  if (partsOfSpeechFlag) {
+    phrasePair.UpdateVocabularyFromValueTokens("POS", partsOfSpeechSet);
+  }
+  if (sourceSyntaxLabelsFlag) {
+    phrasePair.CollectAllLabelsSeparateLHSAndRHS("SourceLabels",
+        sourceLabelSet,
+        sourceLHSCounts,
+        targetLHSAndSourceLHSJointCounts,
+        vcbT);
+  }
+  if (targetPreferenceLabelsFlag) {
+    phrasePair.CollectAllLabelsSeparateLHSAndRHS("TargetPreferences",
+        targetPreferenceLabelSet,
+        targetPreferenceLHSCounts,
+        ruleTargetLHSAndTargetPreferenceLHSJointCounts,
+        vcbT);
+  }
+}
+
 size_t NumNonTerminal(const PHRASE *phraseSource)
 {
   size_t nNTs = 0;
@@ -1115,7 +1239,7 @@ double computeLexicalTranslation( const PHRASE *phraseSource, const PHRASE *phra
 {
   // lexical translation probability
   double lexScore = 1.0;
-  int null = vcbS.getWordID("NULL");
+  int null = nullWordS;
   // all target words have to be explained
   for(size_t ti=0; ti<alignmentTargetToSource->size(); ti++) {
     const std::set< size_t > & srcIndices = alignmentTargetToSource->at(ti);
@@ -1138,6 +1262,13 @@ double computeLexicalTranslation( const PHRASE *phraseSource, const PHRASE *phra
 void LexicalTable::load( const std::string &fileName )
 {
   std::cerr << "Loading lexical translation table from " << fileName;
+  if (Moses::MappedLexicalTable::IsMapped(fileName)) {
+    mappedTable.Load(fileName);
+    mapped = true;
+    vcbS.storeIfNew( "NULL" );
+    std::cerr << " (binary, " << mappedTable.Size() << " entries)" << std::endl;
+    return;
+  }
   Moses::InputFileStream inFile(fileName);
   if (inFile.fail()) {
     std::cerr << " - ERROR: could not open file" << std::endl;
@@ -1162,11 +1293,18 @@ void LexicalTable::load( const std::string &fileName )
     double prob = Moses::Scan<double>( token[2] );
     WORD_ID wordT = vcbT.storeIfNew( token[0] );
     WORD_ID wordS = vcbS.storeIfNew( token[1] );
-    ltable[ wordS ][ wordT ] = prob;
+    ltable[ Key( wordS, wordT ) ] = prob;
   }
   std::cerr << std::endl;
 }
 
+double LexicalTable::mappedLookup( WORD_ID wordS, WORD_ID wordT ) const
+{
+  float prob;
+  if (!mappedTable.Find( vcbT.getWord( wordT ), vcbS.getWord( wordS ), prob )) return 1.0;
+  return prob;
+}
+
 
 void printSourcePhrase(const PHRASE *phraseSource, const PHRASE *phraseTarget,
                        const ALIGNMENT *targetToSourceAlignment, std::ostream &out)
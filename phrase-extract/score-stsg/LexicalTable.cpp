@@ -15,6 +15,7 @@ namespace ScoreStsg
 LexicalTable::LexicalTable(Vocabulary &srcVocab, Vocabulary &tgtVocab)
   : m_srcVocab(srcVocab)
   , m_tgtVocab(tgtVocab)
+  , m_isMapped(false)
 {
 }
 
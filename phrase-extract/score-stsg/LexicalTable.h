@@ -6,6 +6,8 @@
 
 #include <boost/unordered_map.hpp>
 
+#include "moses/MappedLexicalTable.h"
+
 #include "Vocabulary.h"
 
 namespace MosesTraining
@@ -22,7 +24,17 @@ public:
 
   void Load(std::istream &);
 
-  double PermissiveLookup(Vocabulary::IdType s, Vocabulary::IdType t) {
+  // Map a table written by binarize-lex instead of loading the text.
+  void LoadMapped(const std::string &path) {
+    m_mapped.Load(path);
+    m_isMapped = true;
+  }
+
+  bool IsMapped() const {
+    return m_isMapped;
+  }
+
+  double PermissiveLookup(Vocabulary::IdType s, Vocabulary::IdType t) const {
     OuterMap::const_iterator p = m_table.find(s);
     if (p == m_table.end()) {
       return 1.0;
@@ -32,6 +44,12 @@ public:
     return q == inner.end() ? 1.0 : q->second;
   }
 
+  // For mapped tables, which are keyed by the words.
+  double PermissiveLookup(const StringPiece &s, const StringPiece &t) const {
+    float prob;
+    return m_mapped.Find(t, s, prob) ? prob : 1.0;
+  }
+
 private:
   typedef boost::unordered_map<Vocabulary::IdType, double> InnerMap;
   typedef boost::unordered_map<Vocabulary::IdType, InnerMap> OuterMap;
@@ -39,6 +57,8 @@ private:
   Vocabulary &m_srcVocab;
   Vocabulary &m_tgtVocab;
   OuterMap m_table;
+  Moses::MappedLexicalTable m_mapped;
+  bool m_isMapped;
 };
 
 }  // namespace ScoreStsg
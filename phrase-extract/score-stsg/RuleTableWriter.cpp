@@ -56,7 +56,7 @@ void RuleTableWriter::WriteLine(const TokenizedRuleHalf &source,
     m_out << " " << distinctCount;
   }
   m_out << " |||";
-  m_out << std::endl;
+  m_out << '\n';
 }
 
 void RuleTableWriter::WriteRuleHalf(const TokenizedRuleHalf &half)
@@ -7,15 +7,20 @@
 #include <iterator>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 #include <boost/program_options.hpp>
 
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/line_batch_reader.hh"
 #include "util/string_piece.hh"
 #include "util/string_piece_hash.hh"
 #include "util/tokenize_piece.hh"
 
 #include "InputFileStream.h"
+#include "OrderedBlockWriter.h"
 #include "OutputFileStream.h"
 
 #include "syntax-common/exception.h"
@@ -34,10 +39,75 @@ namespace ScoreStsg
 
 const int ScoreStsg::kCountOfCountsMax = 10;
 
+namespace
+{
+// Extract lines scored by one thread at a time (rounded up to whole groups).
+const std::size_t kBlockLines = 10000;
+}
+
+// Consecutive rule groups, which are scored by one thread.
+class ScoreStsg::Block : public OrderedBlockWriter::Block
+{
+public:
+  Block(const ScoreStsg &scorer) : m_scorer(scorer), m_numLines(0) {}
+
+  // Starts a new rule group at line lineNum.
+  RuleGroup &AddGroup(const StringPiece &source, std::size_t lineNum) {
+    m_groups.resize(m_groups.size()+1);
+    m_startLines.push_back(lineNum);
+    m_groups.back().SetNewSource(source);
+    return m_groups.back();
+  }
+
+  RuleGroup &LastGroup() {
+    return m_groups.back();
+  }
+
+  void AddLine() {
+    ++m_numLines;
+  }
+
+  std::size_t GetNumLines() const {
+    return m_numLines;
+  }
+
+  void Format(std::ostream &out) {
+    RuleTableWriter writer(m_scorer.m_options, out);
+    for (std::size_t i = 0; i < m_groups.size(); ++i) {
+      try {
+        m_scorer.ProcessRuleGroup(m_groups[i], writer, m_sourceHalf,
+                                  m_targetHalf, m_tgtToSrc);
+      } catch (const Exception &e) {
+        Fail(i, e.msg());
+      } catch (const std::exception &e) {
+        Fail(i, e.what());
+      }
+    }
+  }
+
+private:
+  void Fail(std::size_t i, const std::string &what) const {
+    std::size_t end = i+1 < m_startLines.size() ? m_startLines[i+1]-1
+                      : m_startLines[0]+m_numLines-1;
+    std::ostringstream msg;
+    msg << "failed to process rule group at lines " << m_startLines[i]
+        << "-" << end << ": " << what;
+    throw std::runtime_error(msg.str());
+  }
+
+  const ScoreStsg &m_scorer;
+  std::vector<RuleGroup> m_groups;
+  std::vector<std::size_t> m_startLines;
+  std::size_t m_numLines;
+  TokenizedRuleHalf m_sourceHalf;
+  TokenizedRuleHalf m_targetHalf;
+  ALIGNMENT m_tgtToSrc;
+};
+
 ScoreStsg::ScoreStsg()
   : m_name("score-stsg")
   , m_lexTable(m_srcVocab, m_tgtVocab)
-  , m_countOfCounts(kCountOfCountsMax, 0)
+  , m_countOfCounts(kCountOfCountsMax+1, 0)
   , m_totalDistinct(0)
 {
 }
@@ -47,8 +117,9 @@ int ScoreStsg::Main(int argc, char *argv[])
   // Process command-line options.
   ProcessOptions(argc, argv, m_options);
 
-  // Open input files.
-  Moses::InputFileStream extractStream(m_options.extractFile);
+  // Open input files.  The extract file is read in the background.
+  util::LineBatchReader extractStream(
+    util::OpenReadOrThrow(m_options.extractFile.c_str()));
   Moses::InputFileStream lexStream(m_options.lexFile);
 
   // Open output files.
@@ -61,52 +132,73 @@ int ScoreStsg::Main(int argc, char *argv[])
 
   // Load lexical table.
   if (!m_options.noLex) {
-    m_lexTable.Load(lexStream);
+    if (Moses::MappedLexicalTable::IsMapped(m_options.lexFile)) {
+      m_lexTable.LoadMapped(m_options.lexFile);
+    } else {
+      m_lexTable.Load(lexStream);
+    }
   }
 
+  // Rule groups are scored in parallel, in blocks of whole groups, and
+  // written in order.
   const util::MultiCharacter delimiter("|||");
   std::size_t lineNum = 0;
-  std::size_t startLine= 0;
   std::string line;
   std::string tmp;
-  RuleGroup ruleGroup;
-  RuleTableWriter ruleTableWriter(m_options, outStream);
-
-  while (std::getline(extractStream, line)) {
-    ++lineNum;
-
-    // Tokenize the input line.
-    util::TokenIter<util::MultiCharacter> it(line, delimiter);
-    StringPiece source = *it++;
-    StringPiece target = *it++;
-    StringPiece ntAlign = *it++;
-    StringPiece fullAlign = *it++;
-    it->CopyToString(&tmp);
-    int count = std::atoi(tmp.c_str());
-    double treeScore = 0.0f;
-    if (m_options.treeScore && !m_options.inverse) {
-      ++it;
+  OrderedBlockWriter writer(outStream, m_options.numThreads);
+  Block *block = NULL;
+
+  try {
+    while (extractStream.ReadLine(line)) {
+      ++lineNum;
+
+      // Tokenize the input line.
+      util::TokenIter<util::MultiCharacter> it(line, delimiter);
+      StringPiece source = *it++;
+      StringPiece target = *it++;
+      StringPiece ntAlign = *it++;
+      StringPiece fullAlign = *it++;
       it->CopyToString(&tmp);
-      treeScore = std::atof(tmp.c_str());
-    }
+      int count = std::atoi(tmp.c_str());
+      double treeScore = 0.0f;
+      if (m_options.treeScore && !m_options.inverse) {
+        ++it;
+        it->CopyToString(&tmp);
+        treeScore = std::atof(tmp.c_str());
+      }
 
-    // If this is the first line or if source has changed since the last
-    // line then process the current rule group and start a new one.
-    if (source != ruleGroup.GetSource()) {
-      if (lineNum > 1) {
-        ProcessRuleGroupOrDie(ruleGroup, ruleTableWriter, startLine, lineNum-1);
+      // If this is the first line or if source has changed since the last
+      // line then finish the current rule group and start a new one, in a
+      // new block if the current one is full.
+      if (!block || source != block->LastGroup().GetSource()) {
+        if (block) {
+          UpdateCountOfCounts(block->LastGroup());
+          if (block->GetNumLines() >= kBlockLines) {
+            writer.Add(block);
+            block = NULL;
+          }
+        }
+        if (!block) {
+          block = new Block(*this);
+        }
+        block->AddGroup(source, lineNum);
       }
-      startLine = lineNum;
-      ruleGroup.SetNewSource(source);
+
+      // Add the rule to the current rule group.
+      block->LastGroup().AddRule(target, ntAlign, fullAlign, count, treeScore);
+      block->AddLine();
     }
 
-    // Add the rule to the current rule group.
-    ruleGroup.AddRule(target, ntAlign, fullAlign, count, treeScore);
+    // Process the final rule group.
+    if (block) {
+      UpdateCountOfCounts(block->LastGroup());
+      writer.Add(block);
+    }
+    writer.Finish();
+  } catch (const util::Exception &e) {
+    Error(e.what());
   }
 
-  // Process the final rule group.
-  ProcessRuleGroupOrDie(ruleGroup, ruleTableWriter, startLine, lineNum);
-
   // Write count of counts file.
   if (m_options.goodTuring || m_options.kneserNey) {
     // Kneser-Ney needs the total number of distinct rules.
@@ -120,7 +212,8 @@ int ScoreStsg::Main(int argc, char *argv[])
   return 0;
 }
 
-void ScoreStsg::TokenizeRuleHalf(const std::string &s, TokenizedRuleHalf &half)
+void ScoreStsg::TokenizeRuleHalf(const std::string &s,
+                                 TokenizedRuleHalf &half) const
 {
   // Copy s to half.string, but strip any leading or trailing whitespace.
   std::size_t start = s.find_first_not_of(" \t");
@@ -161,56 +254,44 @@ void ScoreStsg::TokenizeRuleHalf(const std::string &s, TokenizedRuleHalf &half)
   }
 }
 
-void ScoreStsg::ProcessRuleGroupOrDie(const RuleGroup &group,
-                                      RuleTableWriter &writer,
-                                      std::size_t start,
-                                      std::size_t end)
+void ScoreStsg::UpdateCountOfCounts(const RuleGroup &group)
 {
-  try {
-    ProcessRuleGroup(group, writer);
-  } catch (const Exception &e) {
-    std::ostringstream msg;
-    msg << "failed to process rule group at lines " << start << "-" << end
-        << ": " << e.msg();
-    Error(msg.str());
-  } catch (const std::exception &e) {
-    std::ostringstream msg;
-    msg << "failed to process rule group at lines " << start << "-" << end
-        << ": " << e.what();
-    Error(msg.str());
+  if (!m_options.goodTuring && !m_options.kneserNey) {
+    return;
+  }
+  for (RuleGroup::ConstIterator p = group.Begin(); p != group.End(); ++p) {
+    ++m_totalDistinct;
+    int countInt = p->count + 0.99999;
+    if (countInt <= kCountOfCountsMax) {
+      ++m_countOfCounts[countInt];
+    }
   }
 }
 
 void ScoreStsg::ProcessRuleGroup(const RuleGroup &group,
-                                 RuleTableWriter &writer)
+                                 RuleTableWriter &writer,
+                                 TokenizedRuleHalf &sourceHalf,
+                                 TokenizedRuleHalf &targetHalf,
+                                 ALIGNMENT &tgtToSrc) const
 {
   const std::size_t totalCount = group.GetTotalCount();
   const std::size_t distinctCount = group.GetSize();
 
-  TokenizeRuleHalf(group.GetSource(), m_sourceHalf);
+  TokenizeRuleHalf(group.GetSource(), sourceHalf);
 
-  const bool fullyLexical = m_sourceHalf.IsFullyLexical();
+  const bool fullyLexical = sourceHalf.IsFullyLexical();
 
   // Process each distinct rule in turn.
   for (RuleGroup::ConstIterator p = group.Begin(); p != group.End(); ++p) {
     const RuleGroup::DistinctRule &rule = *p;
 
-    // Update count of count statistics.
-    if (m_options.goodTuring || m_options.kneserNey) {
-      ++m_totalDistinct;
-      int countInt = rule.count + 0.99999;
-      if (countInt <= kCountOfCountsMax) {
-        ++m_countOfCounts[countInt];
-      }
-    }
-
     // If the rule is not fully lexical then discard it if the count is below
     // the threshold value.
     if (!fullyLexical && rule.count < m_options.minCountHierarchical) {
       continue;
     }
 
-    TokenizeRuleHalf(rule.target, m_targetHalf);
+    TokenizeRuleHalf(rule.target, targetHalf);
 
     // Find the most frequent alignment (if there's a tie, take the first one).
     std::vector<std::pair<std::string, int> >::const_iterator q =
@@ -222,21 +303,21 @@ void ScoreStsg::ProcessRuleGroup(const RuleGroup &group,
       }
     }
     const std::string &bestAlignment = bestAlignmentAndCount->first;
-    ParseAlignmentString(bestAlignment, m_targetHalf.frontierSymbols.size(),
-                         m_tgtToSrc);
+    ParseAlignmentString(bestAlignment, targetHalf.frontierSymbols.size(),
+                         tgtToSrc);
 
     // Compute the lexical translation probability.
-    double lexProb = ComputeLexProb(m_sourceHalf.frontierSymbols,
-                                    m_targetHalf.frontierSymbols, m_tgtToSrc);
+    double lexProb = ComputeLexProb(sourceHalf.frontierSymbols,
+                                    targetHalf.frontierSymbols, tgtToSrc);
 
     // Write a line to the rule table.
-    writer.WriteLine(m_sourceHalf, m_targetHalf, bestAlignment, lexProb,
+    writer.WriteLine(sourceHalf, targetHalf, bestAlignment, lexProb,
                      rule.treeScore, p->count, totalCount, distinctCount);
   }
 }
 
 void ScoreStsg::ParseAlignmentString(const std::string &s, int numTgtWords,
-                                     ALIGNMENT &tgtToSrc)
+                                     ALIGNMENT &tgtToSrc) const
 {
   tgtToSrc.clear();
   tgtToSrc.resize(numTgtWords);
@@ -270,7 +351,7 @@ void ScoreStsg::ParseAlignmentString(const std::string &s, int numTgtWords,
 
 double ScoreStsg::ComputeLexProb(const std::vector<RuleSymbol> &sourceFrontier,
                                  const std::vector<RuleSymbol> &targetFrontier,
-                                 const ALIGNMENT &tgtToSrc)
+                                 const ALIGNMENT &tgtToSrc) const
 {
   double lexScore = 1.0;
   for (std::size_t i = 0; i < targetFrontier.size(); ++i) {
@@ -288,6 +369,11 @@ double ScoreStsg::ComputeLexProb(const std::vector<RuleSymbol> &sourceFrontier,
       double thisWordScore = 0.0;
       for (std::set<std::size_t>::const_iterator p = srcIndices.begin();
            p != srcIndices.end(); ++p) {
+        if (m_lexTable.IsMapped()) {
+          thisWordScore += m_lexTable.PermissiveLookup(
+                             sourceFrontier[*p].value, targetFrontier[i].value);
+          continue;
+        }
         Vocabulary::IdType srcId =
           m_srcVocab.Lookup(sourceFrontier[*p].value,
                             StringPieceCompatibleHash(),
@@ -353,6 +439,9 @@ void ScoreStsg::ProcessOptions(int argc, char *argv[], Options &options) const
    "do not output word alignments")
   ("PCFG",
    "synonym for TreeScore (included for compatibility with score)")
+  ("Threads",
+   po::value(&options.numThreads)->default_value(options.numThreads),
+   "set number of threads scoring rule groups in parallel")
   ("TreeScore",
    "include pre-computed tree score from extract")
   ("UnpairedExtractFormat",
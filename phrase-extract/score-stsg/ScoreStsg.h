@@ -39,25 +39,29 @@ public:
 private:
   static const int kCountOfCountsMax;
 
+  class Block;
+
   double ComputeLexProb(const std::vector<RuleSymbol> &,
                         const std::vector<RuleSymbol> &,
-                        const ALIGNMENT &);
+                        const ALIGNMENT &) const;
 
   void Error(const std::string &) const;
 
   void OpenOutputFileOrDie(const std::string &, Moses::OutputFileStream &);
 
   void ParseAlignmentString(const std::string &, int,
-                            ALIGNMENT &);
+                            ALIGNMENT &) const;
 
   void ProcessOptions(int, char *[], Options &) const;
 
-  void ProcessRuleGroup(const RuleGroup &, RuleTableWriter &);
+  // Scores the rules of a group, with the scratch space of a block.
+  void ProcessRuleGroup(const RuleGroup &, RuleTableWriter &,
+                        TokenizedRuleHalf &, TokenizedRuleHalf &,
+                        ALIGNMENT &) const;
 
-  void ProcessRuleGroupOrDie(const RuleGroup &, RuleTableWriter &,
-                             std::size_t, std::size_t);
+  void TokenizeRuleHalf(const std::string &, TokenizedRuleHalf &) const;
 
-  void TokenizeRuleHalf(const std::string &, TokenizedRuleHalf &);
+  void UpdateCountOfCounts(const RuleGroup &);
 
   std::string m_name;
   Options m_options;
@@ -66,9 +70,6 @@ private:
   LexicalTable m_lexTable;
   std::vector<int> m_countOfCounts;
   int m_totalDistinct;
-  TokenizedRuleHalf m_sourceHalf;
-  TokenizedRuleHalf m_targetHalf;
-  ALIGNMENT m_tgtToSrc;
 };
 
 }  // namespace ScoreStsg
@@ -20,22 +20,34 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+
+#include "moses/MappedLexicalTable.h"
 
 namespace MosesTraining
 {
 class LexicalTable
 {
 public:
-  std::map< WORD_ID, std::map< WORD_ID, double > > ltable;
+  LexicalTable() : mapped(false) {}
   void load( const std::string &filePath );
-  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) {
-    // cout << endl << vcbS.getWord( wordS ) << "-" << vcbT.getWord( wordT ) << ":";
-    if (ltable.find( wordS ) == ltable.end()) return 1.0;
-    if (ltable[ wordS ].find( wordT ) == ltable[ wordS ].end()) return 1.0;
-    // cout << ltable[ wordS ][ wordT ];
-    return ltable[ wordS ][ wordT ];
+  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) const {
+    if (mapped) return mappedLookup( wordS, wordT );
+    boost::unordered_map< uint64_t, double >::const_iterator it = ltable.find( Key( wordS, wordT ) );
+    if (it == ltable.end()) return 1.0;
+    return it->second;
+  }
+private:
+  // both word ids packed into one key, so that a lookup is a single hash probe
+  static uint64_t Key( WORD_ID wordS, WORD_ID wordT ) {
+    return (static_cast<uint64_t>(wordS) << 32) | wordT;
   }
+  // binary tables (binarize-lex) are keyed by the words, not the ids
+  double mappedLookup( WORD_ID wordS, WORD_ID wordT ) const;
+  boost::unordered_map< uint64_t, double > ltable;
+  Moses::MappedLexicalTable mappedTable;
+  bool mapped;
 };
 
 // other functions *********************************************
@@ -38,6 +38,18 @@ bool isNonTerminal( const WORD &symbol )
   return symbol.substr(0, 1) == "[" && symbol.substr(symbol.size()-1, 1) == "]";
 }
 
+Vocabulary::Vocabulary()
+  : chunks( new WORD*[ MAX_CHUNKS ]() )
+  , numWords( 0 )
+{
+}
+
+Vocabulary::~Vocabulary()
+{
+  for( WORD_ID i = 0; i < MAX_CHUNKS && chunks[ i ]; ++i )
+    delete [] chunks[ i ];
+}
+
 WORD_ID Vocabulary::storeIfNew( const WORD& word )
 {
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
@@ -45,8 +57,12 @@ WORD_ID Vocabulary::storeIfNew( const WORD& word )
   if( i != lookup.end() )
     return i->second;
 
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  WORD_ID id = numWords;
+  WORD *&chunk = chunks[ id >> CHUNK_BITS ];
+  if( !chunk )
+    chunk = new WORD[ CHUNK_SIZE ];
+  chunk[ id & (CHUNK_SIZE-1) ] = word;
+  ++numWords;
   lookup[ word ] = id;
   return id;
 }
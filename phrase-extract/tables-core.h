@@ -11,6 +11,10 @@
 #include <queue>
 #include <map>
 #include <cmath>
+#include <vector>
+
+#include <boost/scoped_array.hpp>
+#include <boost/utility.hpp>
 
 extern std::vector<std::string> tokenize( const char*);
 
@@ -20,16 +24,29 @@ namespace MosesTraining
 typedef std::string WORD;
 typedef unsigned int WORD_ID;
 
-class Vocabulary
+// The words are kept in fixed-size chunks that never move, so getWord() may
+// be called on other threads while storeIfNew() adds words (for ids handed
+// to those threads after they were stored).
+class Vocabulary : boost::noncopyable
 {
 public:
+  Vocabulary();
+  ~Vocabulary();
   std::map<WORD, WORD_ID>  lookup;
-  std::vector< WORD > vocab;
   WORD_ID storeIfNew( const WORD& );
   WORD_ID getWordID( const WORD& );
   inline WORD &getWord( const WORD_ID id ) {
-    return vocab[ id ];
+    return chunks[ id >> CHUNK_BITS ][ id & (CHUNK_SIZE-1) ];
+  }
+  inline WORD_ID size() const {
+    return numWords;
   }
+private:
+  static const unsigned int CHUNK_BITS = 16;
+  static const WORD_ID CHUNK_SIZE = 1 << CHUNK_BITS;
+  static const WORD_ID MAX_CHUNKS = 1 << (32 - CHUNK_BITS);
+  boost::scoped_array< WORD* > chunks;
+  WORD_ID numWords;
 };
 
 typedef std::vector< WORD_ID > PHRASE;
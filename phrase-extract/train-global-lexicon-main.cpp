@@ -0,0 +1,352 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2009 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Train the weights of GlobalLexicalModel: for each target word, a logistic
+// regression that predicts whether the word is in the target sentence from
+// the source words of the sentence, as train-global-lexicon-model.perl does
+// with MegaM. The features of a target word are the source words it
+// co-occurs with, plus **BIAS**. The target words are trained in parallel;
+// the corpus is kept in memory as word ids only.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <stdint.h>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+#include "util/exception.hh"
+#include "util/string_piece_hash.hh"
+#include "util/tokenize_piece.hh"
+#include "InputFileStream.h"
+#include "OrderedBlockWriter.h"
+#include "OutputFileStream.h"
+
+using namespace std;
+using namespace MosesTraining;
+
+namespace
+{
+
+typedef uint32_t WordId;
+
+class Vocabulary
+{
+public:
+  WordId Add(const StringPiece &word) {
+    Map::const_iterator it = FindStringPiece(m_ids, word);
+    if (it != m_ids.end()) return it->second;
+    WordId id = m_words.size();
+    m_words.push_back(word.as_string());
+    m_ids[m_words.back()] = id;
+    return id;
+  }
+  const string &GetWord(WordId id) const {
+    return m_words[id];
+  }
+  size_t Size() const {
+    return m_words.size();
+  }
+
+private:
+  typedef boost::unordered_map<string, WordId> Map;
+  Map m_ids;
+  vector<string> m_words;
+};
+
+// Lists of ids, e.g. the words of each sentence, in one array.
+struct Lists {
+  vector<WordId> items;
+  vector<size_t> begin;
+
+  Lists() : begin(1, 0) {}
+  size_t Size() const {
+    return begin.size() - 1;
+  }
+  const WordId *Begin(size_t i) const {
+    return Data() + begin[i];
+  }
+  const WordId *End(size_t i) const {
+    return Data() + begin[i + 1];
+  }
+  const WordId *Data() const {
+    return items.empty() ? NULL : &items[0];
+  }
+
+  // the inverted lists: from each item to the lists it is in, in order
+  void Invert(size_t numItems, Lists &inverted) const {
+    inverted.begin.assign(numItems + 1, 0);
+    for (size_t i = 0; i < items.size(); ++i) ++inverted.begin[items[i] + 1];
+    for (size_t i = 0; i < numItems; ++i) inverted.begin[i + 1] += inverted.begin[i];
+    inverted.items.resize(items.size());
+    vector<size_t> fill(inverted.begin.begin(), inverted.begin.end() - 1);
+    for (size_t list = 0; list < Size(); ++list) {
+      for (const WordId *it = Begin(list); it != End(list); ++it) {
+        inverted.items[fill[*it]++] = list;
+      }
+    }
+  }
+};
+
+// the distinct words of line, sorted by id, as the next list
+void AddSentence(const string &line, Vocabulary &vocab, Lists &sentences)
+{
+  size_t start = sentences.items.size();
+  for (util::TokenIter<util::SingleCharacter, true> it(line, ' '); it; ++it) {
+    sentences.items.push_back(vocab.Add(*it));
+  }
+  vector<WordId>::iterator begin = sentences.items.begin() + start;
+  sort(begin, sentences.items.end());
+  sentences.items.erase(unique(begin, sentences.items.end()), sentences.items.end());
+  sentences.begin.push_back(sentences.items.size());
+}
+
+struct Options {
+  size_t iterations;
+  double l2;
+  size_t threads;
+};
+
+struct Corpus {
+  Vocabulary sourceVocab, targetVocab;
+  Lists source, target;
+  // sentences of each word
+  Lists sourceIndex, targetIndex;
+};
+
+// Per-thread buffers the size of the corpus and vocabulary, kept so that
+// every target word only costs time in the sentences it is trained on.
+struct Scratch {
+  // training example of each sentence, -1 if none
+  vector<int> example;
+  vector<char> isFeature;
+
+  explicit Scratch(const Corpus &corpus)
+    : example(corpus.source.Size(), -1)
+    , isFeature(corpus.sourceVocab.Size(), 0) {}
+};
+
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<Scratch> g_scratch;
+#else
+boost::scoped_ptr<Scratch> g_scratch;
+#endif
+
+inline double Sigmoid(double z)
+{
+  return 1.0 / (1.0 + exp(-z));
+}
+
+/* Trains the model of target word e by coordinate descent with Newton steps,
+ * appending "e feature weight" to out. The examples are the sentences with
+ * at least one feature; the others only have the bias and are counted, not
+ * stored. */
+void TrainWord(const Corpus &corpus, const Options &options, WordId e, string &out)
+{
+  if (!g_scratch.get()) g_scratch.reset(new Scratch(corpus));
+  vector<int> &example = g_scratch->example;
+  vector<char> &isFeature = g_scratch->isFeature;
+
+  // the features: source words of the sentences with e
+  vector<WordId> features;
+  const WordId *positive = corpus.targetIndex.Begin(e);
+  const WordId *positiveEnd = corpus.targetIndex.End(e);
+  for (const WordId *s = positive; s != positiveEnd; ++s) {
+    for (const WordId *f = corpus.source.Begin(*s); f != corpus.source.End(*s); ++f) {
+      if (!isFeature[*f]) {
+        isFeature[*f] = 1;
+        features.push_back(*f);
+      }
+    }
+  }
+  sort(features.begin(), features.end());
+
+  // the examples: sentences with a feature
+  vector<WordId> sentences;
+  for (size_t i = 0; i < features.size(); ++i) {
+    isFeature[features[i]] = 0;
+    const WordId *s = corpus.sourceIndex.Begin(features[i]);
+    for (; s != corpus.sourceIndex.End(features[i]); ++s) {
+      if (example[*s] < 0) {
+        example[*s] = sentences.size();
+        sentences.push_back(*s);
+      }
+    }
+  }
+  vector<char> label(sentences.size(), 0);
+  // sentences with the bias only, and how many of them have e
+  double biasOnly = corpus.source.Size() - sentences.size();
+  double biasOnlyPositive = 0;
+  for (const WordId *s = positive; s != positiveEnd; ++s) {
+    if (example[*s] < 0) {
+      ++biasOnlyPositive;
+    } else {
+      label[example[*s]] = 1;
+    }
+  }
+
+  vector<double> margin(sentences.size(), 0.0);
+  vector<double> weight(features.size(), 0.0);
+  double bias = 0;
+  for (size_t iteration = 0; iteration < options.iterations; ++iteration) {
+    double maxStep = 0;
+
+    // the bias, not regularised
+    {
+      double p = Sigmoid(bias);
+      double gradient = biasOnly * p - biasOnlyPositive;
+      double hessian = biasOnly * p * (1 - p);
+      for (size_t i = 0; i < margin.size(); ++i) {
+        double q = Sigmoid(margin[i]);
+        gradient += q - label[i];
+        hessian += q * (1 - q);
+      }
+      if (hessian > 0) {
+        double step = max(-1.0, min(1.0, -gradient / hessian));
+        bias += step;
+        for (size_t i = 0; i < margin.size(); ++i) margin[i] += step;
+        maxStep = max(maxStep, fabs(step));
+      }
+    }
+
+    for (size_t j = 0; j < features.size(); ++j) {
+      const WordId *begin = corpus.sourceIndex.Begin(features[j]);
+      const WordId *end = corpus.sourceIndex.End(features[j]);
+      double gradient = options.l2 * weight[j];
+      double hessian = options.l2;
+      for (const WordId *s = begin; s != end; ++s) {
+        size_t i = example[*s];
+        double q = Sigmoid(margin[i]);
+        gradient += q - label[i];
+        hessian += q * (1 - q);
+      }
+      if (hessian <= 0) continue;
+      double step = max(-1.0, min(1.0, -gradient / hessian));
+      weight[j] += step;
+      for (const WordId *s = begin; s != end; ++s) margin[example[*s]] += step;
+      maxStep = max(maxStep, fabs(step));
+    }
+
+    if (maxStep < 1e-4) break;
+  }
+
+  for (size_t i = 0; i < sentences.size(); ++i) example[sentences[i]] = -1;
+
+  const string &word = corpus.targetVocab.GetWord(e);
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%g", bias);
+  out += word + " **BIAS** " + buffer + "\n";
+  for (size_t j = 0; j < features.size(); ++j) {
+    snprintf(buffer, sizeof(buffer), "%g", weight[j]);
+    out += word + " " + corpus.sourceVocab.GetWord(features[j]) + " " + buffer + "\n";
+  }
+}
+
+// A run of target words, trained on one thread.
+class TrainBlock : public OrderedBlockWriter::Block
+{
+public:
+  TrainBlock(const Corpus &corpus, const Options &options, WordId begin, WordId end)
+    : m_corpus(corpus), m_options(options), m_begin(begin), m_end(end) {}
+
+  void Format(ostream &out) {
+    string text;
+    for (WordId e = m_begin; e < m_end; ++e) {
+      TrainWord(m_corpus, m_options, e, text);
+    }
+    out << text;
+  }
+
+private:
+  const Corpus &m_corpus;
+  const Options &m_options;
+  WordId m_begin, m_end;
+};
+
+// target words per block
+const WordId kBlockWords = 16;
+
+void usage()
+{
+  cerr << "syntax: train-global-lexicon corpus.f corpus.e model [--Threads n] [--Iterations n] [--L2 weight]" << endl
+       << "  trains the weights of GlobalLexicalModel; the model is compressed if it ends in .gz" << endl;
+  exit(1);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  options.iterations = 100;
+  options.l2 = 1.0;
+  options.threads = 1;
+  vector<string> files;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--Threads") == 0 && i + 1 < argc) {
+      options.threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--Iterations") == 0 && i + 1 < argc) {
+      options.iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--L2") == 0 && i + 1 < argc) {
+      options.l2 = atof(argv[++i]);
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      usage();
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.size() != 3) usage();
+
+  Corpus corpus;
+  {
+    Moses::InputFileStream sourceFile(files[0]);
+    Moses::InputFileStream targetFile(files[1]);
+    string sourceLine, targetLine;
+    while (getline(sourceFile, sourceLine)) {
+      UTIL_THROW_IF2(!getline(targetFile, targetLine),
+                     files[1] << " has fewer lines than " << files[0]);
+      AddSentence(sourceLine, corpus.sourceVocab, corpus.source);
+      AddSentence(targetLine, corpus.targetVocab, corpus.target);
+    }
+    UTIL_THROW_IF2(getline(targetFile, targetLine),
+                   files[1] << " has more lines than " << files[0]);
+  }
+  corpus.source.Invert(corpus.sourceVocab.Size(), corpus.sourceIndex);
+  corpus.target.Invert(corpus.targetVocab.Size(), corpus.targetIndex);
+  cerr << corpus.source.Size() << " sentences, " << corpus.sourceVocab.Size()
+       << " source and " << corpus.targetVocab.Size() << " target words" << endl;
+
+  Moses::OutputFileStream model(files[2]);
+  OrderedBlockWriter writer(model, options.threads);
+  for (WordId e = 0; e < corpus.targetVocab.Size(); e += kBlockWords) {
+    WordId end = min<WordId>(e + kBlockWords, corpus.targetVocab.Size());
+    writer.Add(new TrainBlock(corpus, options, e, end));
+  }
+  writer.Finish();
+  model.Close();
+}
@@ -0,0 +1,683 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+/* Microbenchmarks of the decoder's hot paths, reporting ns/op and
+ * allocations/op. Without arguments only the model-free benchmarks run
+ * (WordsBitmap, ScoreComponentCollection, FactorCollection, the hashes of
+ * util for each kernel variant the CPU runs); given a
+ * moses.ini and input (the usual moses arguments) it decodes each input
+ * sentence once and then times phrase table lookups, LM scoring and stack
+ * insertion on the options and hypotheses of that search. Every
+ * benchmark is run --repeats times and the fastest run is reported.
+ *
+ * "bjam regression-testing//benchmark" runs it on the fixed model in
+ * regression-testing/benchmark.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "moses/FactorCollection.h"
+#include "moses/FF/StatefulFeatureFunction.h"
+#include "moses/FF/StatelessFeatureFunction.h"
+#include "moses/Hypothesis.h"
+#include "moses/HypothesisStackNormal.h"
+#include "moses/LM/Base.h"
+#include "moses/Manager.h"
+#include "moses/Parameter.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/Sentence.h"
+#include "moses/StaticData.h"
+#include "moses/TranslationModel/CompactPT/PhraseDictionaryCompact.h"
+#include "moses/TranslationOptionCollection.h"
+#include "moses/Util.h"
+#include "moses/WordsBitmap.h"
+#include "moses/WordsRange.h"
+#include "util/cpu_features.hh"
+#include "util/crc32c.hh"
+#include "util/murmur_hash.hh"
+#include "util/usage.hh"
+
+using namespace std;
+using namespace Moses;
+
+// every allocation of the process, on all threads
+static size_t g_allocations = 0;
+
+void *operator new(size_t size)
+{
+  __sync_fetch_and_add(&g_allocations, 1);
+  void *ret = malloc(size ? size : 1);
+  if (!ret) throw std::bad_alloc();
+  return ret;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+  free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+  free(ptr);
+}
+
+namespace
+{
+
+// keeps results alive so the compiler cannot drop the work
+volatile size_t g_sink;
+
+// deterministic pseudo-random numbers, so every run does the same work
+class Random
+{
+public:
+  Random(unsigned seed) : m_state(seed) {}
+  size_t Next(size_t n) {
+    m_state = m_state * 1103515245 + 12345;
+    return (m_state >> 16) % n;
+  }
+private:
+  unsigned m_state;
+};
+
+/** time and allocations of the timed parts of one run */
+class Stopwatch
+{
+public:
+  Stopwatch() : m_seconds(0), m_allocations(0), m_start(0), m_startAllocations(0) {}
+  void Start() {
+    m_startAllocations = g_allocations;
+    m_start = util::WallTime();
+  }
+  void Stop() {
+    m_seconds += util::WallTime() - m_start;
+    m_allocations += g_allocations - m_startAllocations;
+  }
+  double GetSeconds() const {
+    return m_seconds;
+  }
+  size_t GetAllocations() const {
+    return m_allocations;
+  }
+private:
+  double m_seconds;
+  size_t m_allocations;
+  double m_start;
+  size_t m_startAllocations;
+};
+
+struct Result {
+  size_t ops;
+  double seconds;
+  size_t allocations;
+  Result() : ops(0), seconds(0), allocations(0) {}
+  void Add(const Result &other) {
+    ops += other.ops;
+    seconds += other.seconds;
+    allocations += other.allocations;
+  }
+};
+
+size_t g_repeats = 5;
+
+/** runs body(watch) g_repeats times, body returns its number of operations.
+ *  Returns the fastest run. */
+template <class Body>
+Result Measure(Body &body)
+{
+  Result best;
+  for (size_t i = 0; i < g_repeats; ++i) {
+    Stopwatch watch;
+    size_t ops = body(watch);
+    if (i == 0 || watch.GetSeconds() < best.seconds) {
+      best.ops = ops;
+      best.seconds = watch.GetSeconds();
+      best.allocations = watch.GetAllocations();
+    }
+  }
+  return best;
+}
+
+void Report(const string &name, const Result &result)
+{
+  if (result.ops == 0) {
+    printf("%-48s %12s\n", name.c_str(), "no ops");
+    return;
+  }
+  printf("%-48s %12.1f ns/op %10.3f allocs/op %12lu ops\n", name.c_str(),
+         result.seconds * 1e9 / result.ops,
+         double(result.allocations) / result.ops,
+         (unsigned long) result.ops);
+}
+
+////////////////////////////////////////////////////////////////////////
+// model-free benchmarks
+
+/** the coverage updates and tests of a hypothesis expansion */
+struct WordsBitmapBench {
+  vector<WordsRange> ranges;
+  explicit WordsBitmapBench(size_t size) {
+    Random random(1);
+    for (size_t i = 0; i < 4096; ++i) {
+      size_t start = random.Next(size), len = 1 + random.Next(4);
+      ranges.push_back(WordsRange(start, min(size - 1, start + len - 1)));
+    }
+  }
+  size_t operator()(Stopwatch &watch) {
+    const size_t size = 40, rounds = 256;
+    size_t sink = 0;
+    watch.Start();
+    for (size_t r = 0; r < rounds; ++r) {
+      WordsBitmap *bitmap = new WordsBitmap(size);
+      for (size_t i = 0; i < ranges.size(); ++i) {
+        WordsBitmap next(*bitmap);
+        if (!next.Overlap(ranges[i])) next.SetValue(ranges[i], true);
+        sink += next.GetFirstGapPos() + next.GetNumWordsCovered() + next.Compare(*bitmap);
+        if (next.IsComplete() || i % 8 == 0) {
+          delete bitmap;
+          bitmap = next.IsComplete() ? new WordsBitmap(size) : new WordsBitmap(next);
+        }
+      }
+      delete bitmap;
+    }
+    watch.Stop();
+    g_sink = sink;
+    return rounds * ranges.size();
+  }
+};
+
+struct PlusEqualsBench {
+  vector<ScoreComponentCollection> scores;
+  explicit PlusEqualsBench(const vector<ScoreComponentCollection> &scores) : scores(scores) {}
+  size_t operator()(Stopwatch &watch) {
+    const size_t rounds = 20000;
+    ScoreComponentCollection sum;
+    watch.Start();
+    for (size_t r = 0; r < rounds; ++r) {
+      sum.PlusEquals(scores[r % scores.size()]);
+    }
+    watch.Stop();
+    g_sink = sum.GetScoresVector().size();
+    return rounds;
+  }
+};
+
+struct InnerProductBench {
+  vector<ScoreComponentCollection> scores;
+  ScoreComponentCollection weights;
+  InnerProductBench(const vector<ScoreComponentCollection> &scores, const ScoreComponentCollection &weights)
+    : scores(scores), weights(weights) {}
+  size_t operator()(Stopwatch &watch) {
+    const size_t rounds = 20000;
+    float sum = 0;
+    watch.Start();
+    for (size_t r = 0; r < rounds; ++r) {
+      sum += scores[r % scores.size()].InnerProduct(weights);
+    }
+    watch.Stop();
+    g_sink = size_t(sum);
+    return rounds;
+  }
+};
+
+/** vectors with random values for every dense feature */
+ScoreComponentCollection RandomScores(Random &random)
+{
+  ScoreComponentCollection ret;
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    vector<float> values(ffs[i]->GetNumScoreComponents());
+    for (size_t j = 0; j < values.size(); ++j) {
+      values[j] = random.Next(1000) / 100.0f - 5;
+    }
+    ret.Assign(ffs[i], values);
+  }
+  return ret;
+}
+
+/** words for AddFactor: mostly known ones, one in eight new on each run */
+struct AddFactorBench {
+  vector<string> known;
+  size_t threads;
+  size_t run;
+  AddFactorBench(size_t threads) : threads(threads), run(0) {
+    Random random(2);
+    for (size_t i = 0; i < 20000; ++i) {
+      ostringstream word;
+      word << "benchmark-word-" << random.Next(5000);
+      known.push_back(word.str());
+      FactorCollection::Instance().AddFactor(known.back());
+    }
+  }
+  static void Add(const vector<string> *words, size_t *sink) {
+    FactorCollection &factors = FactorCollection::Instance();
+    size_t sum = 0;
+    for (size_t i = 0; i < words->size(); ++i) {
+      sum += factors.AddFactor((*words)[i])->GetId();
+    }
+    *sink = sum;
+  }
+  size_t operator()(Stopwatch &watch) {
+    // each thread gets its own copy of the words, with its own new ones
+    vector<vector<string> > words(threads, known);
+    for (size_t t = 0; t < threads; ++t) {
+      for (size_t i = 0; i < words[t].size(); i += 8) {
+        ostringstream word;
+        word << "benchmark-new-" << run << '-' << t << '-' << i;
+        words[t][i] = word.str();
+      }
+    }
+    ++run;
+    vector<size_t> sinks(threads);
+    watch.Start();
+#ifdef WITH_THREADS
+    boost::thread_group group;
+    for (size_t t = 0; t < threads; ++t) {
+      group.create_thread(boost::bind(&AddFactorBench::Add, &words[t], &sinks[t]));
+    }
+    group.join_all();
+#else
+    Add(&words[0], &sinks[0]);
+#endif
+    watch.Stop();
+    g_sink = sinks[0];
+    // wall time per call of one thread: flat if AddFactor scales
+    return known.size();
+  }
+};
+
+/** hashes keys of one length, as the hash tables keyed by strings do */
+template <class Hash> struct HashBench {
+  Hash hash;
+  vector<char> data;
+  size_t length;
+  HashBench(Hash hash, size_t length) : hash(hash), data(length + 4096), length(length) {
+    Random random(4);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = char(random.Next(256));
+  }
+  size_t operator()(Stopwatch &watch) {
+    const size_t rounds = (16 << 20) / (length + 16);
+    uint64_t sink = 0;
+    watch.Start();
+    for (size_t r = 0; r < rounds; ++r) {
+      sink += hash(&data[(r * 61) % 4096], length);
+    }
+    watch.Stop();
+    g_sink = size_t(sink);
+    return rounds;
+  }
+};
+
+struct MurmurHash {
+  uint64_t operator()(const void *data, size_t length) const {
+    return util::MurmurHashNative(data, length);
+  }
+};
+
+struct CRC32CHash {
+  util::CRC32CFunction fn;
+  explicit CRC32CHash(util::CRC32CFunction fn) : fn(fn) {}
+  uint64_t operator()(const void *data, size_t length) const {
+    return fn(data, length, 0);
+  }
+};
+
+/** stands in for the feature functions of a moses.ini when there is none */
+class BenchmarkFeature : public StatelessFeatureFunction
+{
+public:
+  BenchmarkFeature() : StatelessFeatureFunction(20, "BenchmarkFeature") {}
+  bool IsUseable(const FactorMask &mask) const {
+    return true;
+  }
+  void EvaluateWhenApplied(const Hypothesis&, ScoreComponentCollection*) const {}
+  void EvaluateWhenApplied(const ChartHypothesis&, ScoreComponentCollection*) const {}
+  void EvaluateWithSourceContext(const InputType &input
+                                 , const InputPath &inputPath
+                                 , const TargetPhrase &targetPhrase
+                                 , const StackVec *stackVec
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection *estimatedFutureScore) const {}
+  void EvaluateTranslationOptionListWithSourceContext(const InputType &input
+      , const TranslationOptionList &translationOptionList) const {}
+  void EvaluateInIsolation(const Phrase &source
+                           , const TargetPhrase &targetPhrase
+                           , ScoreComponentCollection &scoreBreakdown
+                           , ScoreComponentCollection &estimatedFutureScore) const {}
+};
+
+void RunModelFree(size_t maxThreads)
+{
+  WordsBitmapBench bitmap(40);
+  Report("WordsBitmap copy/SetValue/GetFirstGapPos/Compare", Measure(bitmap));
+
+  Random random(3);
+  vector<ScoreComponentCollection> scores;
+  for (size_t i = 0; i < 64; ++i) {
+    scores.push_back(RandomScores(random));
+  }
+  PlusEqualsBench plusEquals(scores);
+  Report("ScoreComponentCollection::PlusEquals", Measure(plusEquals));
+  InnerProductBench innerProduct(scores, RandomScores(random));
+  Report("ScoreComponentCollection::InnerProduct", Measure(innerProduct));
+
+  for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    AddFactorBench addFactor(threads);
+    ostringstream name;
+    name << "FactorCollection::AddFactor x" << threads << " threads";
+    Report(name.str(), Measure(addFactor));
+  }
+
+  // every CRC32C variant this CPU runs, against MurmurHash
+  printf("CPU features: %s\n", util::CPUFeatureNames(util::CPUFeatures()).c_str());
+  size_t numVariants;
+  const util::KernelVariant<util::CRC32CFunction> *variants = util::CRC32CVariants(numVariants);
+  const size_t lengths[] = {8, 32, 256};
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    ostringstream name;
+    name << "MurmurHashNative " << lengths[l] << " bytes";
+    HashBench<MurmurHash> murmur(MurmurHash(), lengths[l]);
+    Report(name.str(), Measure(murmur));
+    for (size_t v = 0; v < numVariants; ++v) {
+      if ((variants[v].features & util::CPUFeatures()) != variants[v].features) continue;
+      ostringstream crcName;
+      crcName << "CRC32C " << variants[v].name << ' ' << lengths[l] << " bytes";
+      HashBench<CRC32CHash> crc(CRC32CHash(variants[v].fn), lengths[l]);
+      Report(crcName.str(), Measure(crc));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// benchmarks on a decoded sentence
+
+struct CompactLookupBench {
+  const PhraseDictionaryCompact &pt;
+  const Sentence &sentence;
+  CompactLookupBench(const PhraseDictionaryCompact &pt, const Sentence &sentence) : pt(pt), sentence(sentence) {}
+  size_t operator()(Stopwatch &watch) {
+    const size_t maxLength = StaticData::Instance().GetMaxPhraseLength();
+    vector<Phrase> phrases;
+    for (size_t start = 0; start < sentence.GetSize(); ++start) {
+      for (size_t end = start; end < sentence.GetSize() && end - start < maxLength; ++end) {
+        phrases.push_back(sentence.GetSubString(WordsRange(start, end)));
+      }
+    }
+    size_t sink = 0;
+    watch.Start();
+    for (size_t i = 0; i < phrases.size(); ++i) {
+      const TargetPhraseCollection *tpc = pt.GetTargetPhraseCollectionNonCacheLEGACY(phrases[i]);
+      if (tpc) sink += tpc->GetSize();
+    }
+    watch.Stop();
+    const_cast<PhraseDictionaryCompact&>(pt).CleanUpAfterSentenceProcessing(sentence);
+    g_sink = sink;
+    return phrases.size();
+  }
+};
+
+struct LMPhraseBench {
+  const LanguageModel &lm;
+  vector<const Phrase*> phrases;
+  LMPhraseBench(const LanguageModel &lm, const vector<const Phrase*> &phrases) : lm(lm), phrases(phrases) {}
+  size_t operator()(Stopwatch &watch) {
+    float sum = 0;
+    watch.Start();
+    for (size_t i = 0; i < phrases.size(); ++i) {
+      float fullScore, ngramScore;
+      size_t oovCount;
+      lm.CalcScore(*phrases[i], fullScore, ngramScore, oovCount);
+      sum += fullScore;
+    }
+    watch.Stop();
+    g_sink = size_t(sum);
+    return phrases.size();
+  }
+};
+
+struct LMStateBench {
+  const LanguageModel &lm;
+  size_t stateIndex;
+  vector<const Hypothesis*> hypos;
+  LMStateBench(const LanguageModel &lm, size_t stateIndex, const vector<const Hypothesis*> &hypos)
+    : lm(lm), stateIndex(stateIndex), hypos(hypos) {}
+  size_t operator()(Stopwatch &watch) {
+    vector<FFState*> states(hypos.size());
+    ScoreComponentCollection scores;
+    watch.Start();
+    for (size_t i = 0; i < hypos.size(); ++i) {
+      states[i] = lm.EvaluateWhenApplied(*hypos[i], hypos[i]->GetPrevHypo()->GetFFState(stateIndex), &scores);
+    }
+    watch.Stop();
+    RemoveAllInColl(states);
+    return hypos.size();
+  }
+};
+
+/** re-creates the hypotheses of the search and adds them to fresh stacks */
+struct AddPruneBench {
+  Manager &manager;
+  // by number of words covered
+  vector<vector<const Hypothesis*> > hypos;
+  AddPruneBench(Manager &manager, const vector<const Hypothesis*> &searched) : manager(manager) {
+    for (size_t i = 0; i < searched.size(); ++i) {
+      size_t covered = searched[i]->GetWordsBitmap().GetNumWordsCovered();
+      if (hypos.size() <= covered) hypos.resize(covered + 1);
+      hypos[covered].push_back(searched[i]);
+    }
+  }
+  size_t operator()(Stopwatch &watch) {
+    const StaticData &staticData = StaticData::Instance();
+    const SquareMatrix &futureScore = manager.getSntTranslationOptions()->GetFutureScore();
+    size_t ops = 0;
+    for (size_t covered = 0; covered < hypos.size(); ++covered) {
+      vector<Hypothesis*> created;
+      for (size_t i = 0; i < hypos[covered].size(); ++i) {
+        const Hypothesis &hypo = *hypos[covered][i];
+        Hypothesis *copy = Hypothesis::Create(*hypo.GetPrevHypo(), hypo.GetTranslationOption());
+        copy->EvaluateWhenApplied(futureScore);
+        created.push_back(copy);
+      }
+      HypothesisStackNormal stack(manager);
+      stack.SetMaxHypoStackSize(staticData.GetMaxHypoStackSize(), staticData.GetMinHypoStackDiversity());
+      stack.SetBeamWidth(staticData.GetBeamWidth());
+      watch.Start();
+      for (size_t i = 0; i < created.size(); ++i) {
+        stack.AddPrune(created[i]);
+      }
+      watch.Stop();
+      ops += created.size();
+    }
+    return ops;
+  }
+};
+
+/** a whole search with cube pruning, per hypothesis popped from the cubes */
+struct CubePruningBench {
+  const Sentence &sentence;
+  CubePruningBench(const Sentence &sentence) : sentence(sentence) {}
+  size_t operator()(Stopwatch &watch) {
+    Manager manager(sentence);
+    watch.Start();
+    manager.Decode();
+    watch.Stop();
+    return manager.GetSentenceStats().GetNumHyposPopped();
+  }
+};
+
+/** benchmark name -> totals over all sentences, in order of first use */
+class Totals
+{
+public:
+  void Add(const string &name, const Result &result) {
+    size_t i = 0;
+    while (i < m_names.size() && m_names[i] != name) ++i;
+    if (i == m_names.size()) {
+      m_names.push_back(name);
+      m_results.push_back(Result());
+    }
+    m_results[i].Add(result);
+  }
+  void Report() const {
+    for (size_t i = 0; i < m_names.size(); ++i) {
+      ::Report(m_names[i], m_results[i]);
+    }
+  }
+private:
+  vector<string> m_names;
+  vector<Result> m_results;
+};
+
+void RunOnSentence(const Sentence &sentence, Totals &totals)
+{
+  Manager manager(sentence);
+  manager.Decode();
+
+  vector<SearchGraphNode> searchGraph;
+  manager.GetSearchGraph(searchGraph);
+  vector<const Hypothesis*> hypos;
+  for (size_t i = 0; i < searchGraph.size(); ++i) {
+    if (searchGraph[i].hypo->GetPrevHypo()) hypos.push_back(searchGraph[i].hypo);
+  }
+
+  vector<const Phrase*> targetPhrases;
+  const TranslationOptionCollection &options = *manager.getSntTranslationOptions();
+  for (size_t start = 0; start < sentence.GetSize(); ++start) {
+    for (size_t end = start; end < sentence.GetSize(); ++end) {
+      const TranslationOptionList *list = options.GetTranslationOptionList(start, end);
+      if (!list) continue;
+      for (size_t i = 0; i < list->size(); ++i) {
+        targetPhrases.push_back(&list->Get(i)->GetTargetPhrase());
+      }
+    }
+  }
+
+  const vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
+  for (size_t i = 0; i < pts.size(); ++i) {
+    const PhraseDictionaryCompact *compact = dynamic_cast<const PhraseDictionaryCompact*>(pts[i]);
+    if (!compact) continue;
+    CompactLookupBench lookup(*compact, sentence);
+    totals.Add("PhraseDictionaryCompact lookup " + compact->GetScoreProducerDescription(), Measure(lookup));
+  }
+
+  const vector<const StatefulFeatureFunction*> &sfs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (size_t i = 0; i < sfs.size(); ++i) {
+    const LanguageModel *lm = dynamic_cast<const LanguageModel*>(sfs[i]);
+    if (!lm) continue;
+    LMPhraseBench phrases(*lm, targetPhrases);
+    totals.Add("LM phrase scoring " + lm->GetScoreProducerDescription(), Measure(phrases));
+    LMStateBench states(*lm, i, hypos);
+    totals.Add("LM state scoring " + lm->GetScoreProducerDescription(), Measure(states));
+  }
+
+  AddPruneBench addPrune(manager, hypos);
+  totals.Add("HypothesisStackNormal::AddPrune", Measure(addPrune));
+
+  if (StaticData::Instance().GetSearchAlgorithm() == CubePruning) {
+    CubePruningBench cubePruning(sentence);
+    totals.Add("cube pruning search, per pop", Measure(cubePruning));
+  }
+}
+
+void Usage(const char *name)
+{
+  cerr << "Usage: " << name << " [--repeats n] [--threads n] [moses options, e.g. -f moses.ini -i input]\n"
+       "Runs the decoder microbenchmarks, the fastest of n runs (default 5) of each.\n"
+       "FactorCollection::AddFactor is run on 1, 2, 4 ... up to --threads threads\n"
+       "(default 4). Given a moses.ini, also benchmarks phrase table lookups, LM\n"
+       "scoring and stack insertion on each input sentence. With -search-algorithm 1\n"
+       "the cube pruning search is timed per pop.\n";
+  exit(1);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  try {
+    size_t maxThreads = 4;
+    // our options first, the rest goes to moses
+    vector<char*> mosesArgs(1, argv[0]);
+    for (int i = 1; i < argc; ++i) {
+      string arg(argv[i]);
+      if (arg == "--repeats" && i + 1 < argc) {
+        g_repeats = max(1, atoi(argv[++i]));
+      } else if (arg == "--threads" && i + 1 < argc) {
+        maxThreads = max(1, atoi(argv[++i]));
+      } else if (arg == "--help") {
+        Usage(argv[0]);
+      } else {
+        mosesArgs.push_back(argv[i]);
+      }
+    }
+#ifndef WITH_THREADS
+    maxThreads = 1;
+#endif
+
+    if (mosesArgs.size() == 1) {
+      BenchmarkFeature feature;
+      RunModelFree(maxThreads);
+      return 0;
+    }
+
+    Parameter params;
+    if (!params.LoadParam(mosesArgs.size(), &mosesArgs[0])) return 1;
+    if (!StaticData::LoadDataStatic(&params, argv[0])) return 1;
+    RunModelFree(maxThreads);
+
+    const StaticData &staticData = StaticData::Instance();
+    const PARAM_VEC *inputFile = params.GetParam("input-file");
+    std::ifstream file;
+    if (inputFile && inputFile->size()) {
+      file.open(inputFile->at(0).c_str());
+      UTIL_THROW_IF2(!file, "Cannot read " << inputFile->at(0));
+    }
+    istream &in = file.is_open() ? file : cin;
+
+    Totals totals;
+    for (long id = 0; ; ++id) {
+      Sentence sentence;
+      if (!sentence.Read(in, staticData.GetInputFactorOrder())) break;
+      sentence.SetTranslationId(id);
+      RunOnSentence(sentence, totals);
+    }
+    totals.Report();
+  } catch (const std::exception &e) {
+    cerr << "Exception: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
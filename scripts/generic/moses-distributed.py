@@ -0,0 +1,264 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Translates a large input with a set of running moses servers (mosesserver,
+# or moses --server), as an alternative to moses-parallel.pl: the servers
+# keep their models loaded from job to job, and the input is not split into
+# one shard per job up front.
+#
+# The input is read in chunks of --chunk lines, which the connections to
+# the servers (--connections per server) take one at a time, so faster
+# servers simply take more of them.  Once the input is exhausted an idle
+# connection steals a chunk still being translated elsewhere and translates
+# it again; whichever copy is done first is used, so a slow or hung server
+# does not set the finish time.  Chunks of a failing server are handed to
+# the others.  The translations are written to stdout in input order as
+# soon as all chunks before them are done.
+#
+# Chunks are sent with the translate_batch method, so the servers schedule
+# them as bulk requests next to their interactive traffic.
+#
+# usage:
+#   moses-distributed.py --servers host1:8080,host2:8080 < in > out
+#   moses-distributed.py --servers-file servers.txt --param nbest=0 -i in
+
+import argparse
+import sys
+import threading
+import time
+
+try:
+    import xmlrpc.client as xmlrpclib
+except ImportError:
+    import xmlrpclib
+
+PY2 = sys.version_info[0] == 2
+
+
+def server_url(server):
+    if "://" in server:
+        return server
+    return "http://%s/RPC2" % server
+
+
+def parse_value(value):
+    for cast in (int, float):
+        try:
+            return cast(value)
+        except ValueError:
+            pass
+    return value
+
+
+class Coordinator(object):
+    """Hands out chunks of the input and writes the results in order."""
+
+    def __init__(self, infile, outfile, chunk_size, max_attempts):
+        self.infile = infile
+        self.outfile = outfile
+        self.chunk_size = chunk_size
+        self.max_attempts = max_attempts
+        self.lock = threading.Condition()
+        self.next_chunk = 0       # id of the next chunk read from the input
+        self.exhausted = False
+        self.retry = []           # chunks to translate again, oldest first
+        self.running = {}         # chunk id -> [lines, copies in flight, attempts]
+        self.done = {}            # chunk id -> translations, not written yet
+        self.next_output = 0
+        self.alive = 0            # connections still working
+        self.error = None
+
+    def _read_chunk(self):
+        lines = []
+        while len(lines) < self.chunk_size:
+            line = self.infile.readline()
+            if not line:
+                self.exhausted = True
+                break
+            if PY2:
+                line = line.decode("utf-8")
+            lines.append(line.rstrip("\r\n"))
+        if not lines:
+            return None
+        chunk = self.next_chunk
+        self.next_chunk += 1
+        self.running[chunk] = [lines, 0, 0]
+        return chunk
+
+    def take(self):
+        """Returns (chunk id, lines), or None when there is nothing left."""
+        with self.lock:
+            while True:
+                if self.error is not None:
+                    return None
+                chunk = None
+                while self.retry and chunk is None:
+                    chunk = self.retry.pop(0)
+                    if chunk not in self.running:
+                        chunk = None  # a stolen copy was done meanwhile
+                if chunk is None and not self.exhausted:
+                    chunk = self._read_chunk()
+                if chunk is None and self.running:
+                    # steal the oldest chunk that is translated only once
+                    for c in sorted(self.running):
+                        if self.running[c][1] == 1:
+                            chunk = c
+                            break
+                if chunk is not None:
+                    entry = self.running[chunk]
+                    entry[1] += 1
+                    entry[2] += 1
+                    return chunk, entry[0]
+                if not self.running:
+                    return None
+                # everything is in flight twice; wait for a chunk to finish
+                # or fail
+                self.lock.wait(1.0)
+
+    def finish(self, chunk, translations):
+        with self.lock:
+            if chunk in self.running:
+                del self.running[chunk]
+                self.done[chunk] = translations
+                while self.next_output in self.done:
+                    for translation in self.done.pop(self.next_output):
+                        if PY2:
+                            translation = translation.encode("utf-8")
+                        self.outfile.write(translation + "\n")
+                    self.next_output += 1
+                self.outfile.flush()
+            self.lock.notify_all()
+
+    def fail(self, chunk, reason):
+        with self.lock:
+            entry = self.running.get(chunk)
+            if entry is not None:
+                entry[1] -= 1
+                # a copy still in flight may yet succeed
+                if entry[1] == 0:
+                    if entry[2] >= self.max_attempts:
+                        self.error = "chunk %d failed %d times: %s" % (chunk, entry[2], reason)
+                    else:
+                        self.retry.append(chunk)
+            self.lock.notify_all()
+
+    def connection_started(self):
+        with self.lock:
+            self.alive += 1
+
+    def connection_lost(self):
+        with self.lock:
+            self.alive -= 1
+            if self.alive == 0 and (self.running or not self.exhausted) and self.error is None:
+                self.error = "all servers failed"
+            self.lock.notify_all()
+
+
+def worker(coordinator, url, params, max_failures, verbose):
+    proxy = xmlrpclib.ServerProxy(url, allow_none=True)
+    failures = 0
+    try:
+        while True:
+            task = coordinator.take()
+            if task is None:
+                return
+            chunk, lines = task
+            request = dict(params)
+            request["segments"] = lines
+            start = time.time()
+            try:
+                results = proxy.translate_batch(request)["results"]
+                translations = []
+                for result in results:
+                    if "error" in result:
+                        raise RuntimeError(result["error"])
+                    translations.append(result["text"])
+                if len(translations) != len(lines):
+                    raise RuntimeError("%d results for %d segments" % (len(translations), len(lines)))
+            except Exception as e:
+                failures += 1
+                if verbose:
+                    sys.stderr.write("%s: chunk %d failed: %s\n" % (url, chunk, e))
+                coordinator.fail(chunk, "%s: %s" % (url, e))
+                if failures >= max_failures:
+                    sys.stderr.write("%s: giving up after %d failures\n" % (url, failures))
+                    return
+                time.sleep(min(30, 2 ** failures))
+                continue
+            failures = 0
+            if verbose:
+                sys.stderr.write("%s: chunk %d, %d lines in %.2fs\n"
+                                 % (url, chunk, len(lines), time.time() - start))
+            coordinator.finish(chunk, translations)
+    finally:
+        coordinator.connection_lost()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Translate with a set of moses servers, in chunks that are balanced across them.")
+    parser.add_argument("--servers", default="",
+                        help="comma-separated host:port or URLs of the servers")
+    parser.add_argument("--servers-file",
+                        help="file with one server per line")
+    parser.add_argument("--connections", type=int, default=2,
+                        help="chunks in flight per server (default 2); about its decoder threads "
+                        "divided by the chunk size keeps it busy")
+    parser.add_argument("--chunk", type=int, default=20,
+                        help="lines per request (default 20)")
+    parser.add_argument("--attempts", type=int, default=3,
+                        help="times a chunk may be sent before the job fails (default 3)")
+    parser.add_argument("--max-failures", type=int, default=5,
+                        help="consecutive failures after which a connection is given up (default 5)")
+    parser.add_argument("--param", action="append", default=[],
+                        help="key=value passed with every request, e.g. align=true")
+    parser.add_argument("-i", "--input",
+                        help="input file (default stdin)")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    servers = [s for s in args.servers.split(",") if s]
+    if args.servers_file:
+        with open(args.servers_file) as f:
+            servers += [l.strip() for l in f if l.strip() and not l.startswith("#")]
+    if not servers:
+        parser.error("no servers given")
+
+    params = {}
+    for p in args.param:
+        key, sep, value = p.partition("=")
+        if not sep:
+            parser.error("--param needs key=value: " + p)
+        params[key] = parse_value(value)
+
+    infile = open(args.input) if args.input else sys.stdin
+    if not PY2:
+        infile = open(infile.fileno(), encoding="utf-8", closefd=False)
+        outfile = open(sys.stdout.fileno(), "w", encoding="utf-8", closefd=False)
+    else:
+        outfile = sys.stdout
+
+    coordinator = Coordinator(infile, outfile, args.chunk, args.attempts)
+    threads = []
+    for server in servers:
+        for _ in range(args.connections):
+            coordinator.connection_started()
+            t = threading.Thread(target=worker,
+                                 args=(coordinator, server_url(server), params,
+                                       args.max_failures, args.verbose))
+            t.daemon = True
+            t.start()
+            threads.append(t)
+    for t in threads:
+        while t.is_alive():
+            t.join(1.0)
+    outfile.flush()
+
+    if coordinator.error is not None:
+        sys.stderr.write("moses-distributed: %s\n" % coordinator.error)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
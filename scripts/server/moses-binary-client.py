@@ -0,0 +1,246 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Client for the binary protocol of moses --server (-server-binary-port),
+# which carries the same requests as the XML-RPC "translate" method without
+# XML and HTTP; the format is described in moses/server/BinaryServer.h.
+#
+# As a program, translates stdin line by line, keeping up to --window
+# requests in flight on one connection, and writes the translations in
+# input order:
+#   moses-binary-client.py --server localhost:8081 [--param align=true] < in > out
+#
+# As a module:
+#   client = Client("localhost", 8081)
+#   client.translate({"text": "das ist ein haus"})["text"]
+
+import argparse
+import socket
+import struct
+import sys
+
+PY2 = sys.version_info[0] == 2
+
+if PY2:
+    text_type = unicode  # noqa: F821
+    int_types = (int, long)  # noqa: F821
+else:
+    text_type = str
+    int_types = (int,)
+
+
+def encode(value, out):
+    """Appends the binary form of value (None, bool, int, float, string,
+    list or dict with string keys) to the list of byte strings out."""
+    if value is None:
+        out.append(b"n")
+    elif isinstance(value, bool):
+        out.append(b"b\x01" if value else b"b\x00")
+    elif isinstance(value, int_types):
+        if -2 ** 31 <= value < 2 ** 31:
+            out.append(b"i" + struct.pack(">i", value))
+        else:
+            out.append(b"I" + struct.pack(">q", value))
+    elif isinstance(value, float):
+        out.append(b"d" + struct.pack(">d", value))
+    elif isinstance(value, (text_type, bytes)):
+        out.append(b"s")
+        _encode_string(value, out)
+    elif isinstance(value, (list, tuple)):
+        out.append(b"a" + struct.pack(">I", len(value)))
+        for v in value:
+            encode(v, out)
+    elif isinstance(value, dict):
+        out.append(b"m" + struct.pack(">I", len(value)))
+        for k in sorted(value):
+            _encode_string(k, out)
+            encode(value[k], out)
+    else:
+        raise TypeError("no binary form for %r" % (value,))
+
+
+def _encode_string(s, out):
+    if isinstance(s, text_type):
+        s = s.encode("utf-8")
+    out.append(struct.pack(">I", len(s)))
+    out.append(s)
+
+
+def decode(data, pos=0):
+    """Returns the value at data[pos:] and the position after it."""
+    t = data[pos:pos + 1]
+    pos += 1
+    if t == b"n":
+        return None, pos
+    if t == b"b":
+        return data[pos:pos + 1] != b"\x00", pos + 1
+    if t == b"i":
+        return struct.unpack(">i", data[pos:pos + 4])[0], pos + 4
+    if t == b"I":
+        return struct.unpack(">q", data[pos:pos + 8])[0], pos + 8
+    if t == b"d":
+        return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+    if t == b"s":
+        return _decode_string(data, pos)
+    if t == b"a":
+        (n,) = struct.unpack(">I", data[pos:pos + 4])
+        pos += 4
+        ret = []
+        for _ in range(n):
+            v, pos = decode(data, pos)
+            ret.append(v)
+        return ret, pos
+    if t == b"m":
+        (n,) = struct.unpack(">I", data[pos:pos + 4])
+        pos += 4
+        ret = {}
+        for _ in range(n):
+            k, pos = _decode_string(data, pos)
+            ret[k], pos = decode(data, pos)
+        return ret, pos
+    raise ValueError("bad value type %r at %d" % (t, pos - 1))
+
+
+def _decode_string(data, pos):
+    (n,) = struct.unpack(">I", data[pos:pos + 4])
+    pos += 4
+    return data[pos:pos + n].decode("utf-8"), pos + n
+
+
+def frame(request_id, value):
+    parts = [struct.pack(">I", request_id & 0xffffffff)]
+    encode(value, parts)
+    body = b"".join(parts)
+    return struct.pack(">I", len(body)) + body
+
+
+class Client(object):
+    """One connection to a server. Requests may be sent ahead of reading
+    the responses, which arrive in any order."""
+
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buf = b""
+        self.next_id = 0
+
+    def send(self, params):
+        """Sends a request; returns its id."""
+        request_id = self.next_id
+        self.next_id = (self.next_id + 1) & 0xffffffff
+        self.sock.sendall(frame(request_id, params))
+        return request_id
+
+    def send_many(self, requests):
+        """Sends several requests in one write; returns their ids."""
+        ids, frames = [], []
+        for params in requests:
+            ids.append(self.next_id)
+            frames.append(frame(self.next_id, params))
+            self.next_id = (self.next_id + 1) & 0xffffffff
+        self.sock.sendall(b"".join(frames))
+        return ids
+
+    def receive(self):
+        """Returns (id, response) of the next response to arrive."""
+        while True:
+            if len(self.buf) >= 4:
+                (n,) = struct.unpack(">I", self.buf[:4])
+                if len(self.buf) >= 4 + n:
+                    body = self.buf[4:4 + n]
+                    self.buf = self.buf[4 + n:]
+                    (request_id,) = struct.unpack(">I", body[:4])
+                    value, _ = decode(body, 4)
+                    return request_id, value
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                raise EOFError("server closed the connection")
+            self.buf += chunk
+
+    def translate(self, params):
+        request_id = self.send(params)
+        while True:
+            got, response = self.receive()
+            if got == request_id:
+                return response
+
+    def close(self):
+        self.sock.close()
+
+
+def parse_value(value):
+    for cast in (int, float):
+        try:
+            return cast(value)
+        except ValueError:
+            pass
+    return value
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Translate stdin with moses --server over the binary protocol.")
+    parser.add_argument("--server", default="localhost:8081",
+                        help="host:port of -server-binary-port (default localhost:8081)")
+    parser.add_argument("--window", type=int, default=64,
+                        help="requests in flight (default 64)")
+    parser.add_argument("--param", action="append", default=[],
+                        help="key=value passed with every request, e.g. align=true")
+    args = parser.parse_args()
+
+    params = {}
+    for p in args.param:
+        key, sep, value = p.partition("=")
+        if not sep:
+            parser.error("--param needs key=value: " + p)
+        params[key] = parse_value(value)
+
+    host, _, port = args.server.rpartition(":")
+    client = Client(host or "localhost", int(port))
+    if PY2:
+        infile, outfile = sys.stdin, sys.stdout
+    else:
+        infile = open(sys.stdin.fileno(), encoding="utf-8", closefd=False)
+        outfile = open(sys.stdout.fileno(), "w", encoding="utf-8", closefd=False)
+
+    line_of = {}       # request id -> line number
+    done = {}          # line number -> translation, not written yet
+    next_line = next_output = 0
+    status = 0
+    eof = False
+    while not eof or line_of:
+        batch = []
+        while not eof and len(line_of) + len(batch) < args.window:
+            line = infile.readline()
+            if not line:
+                eof = True
+                break
+            if PY2:
+                line = line.decode("utf-8")
+            request = dict(params)
+            request["text"] = line.rstrip("\r\n")
+            batch.append(request)
+        for request_id in client.send_many(batch):
+            line_of[request_id] = next_line
+            next_line += 1
+        if not line_of:
+            break
+        request_id, response = client.receive()
+        n = line_of.pop(request_id)
+        if "error" in response:
+            sys.stderr.write("line %d: %s\n" % (n + 1, response["error"]))
+            status = 1
+        done[n] = response.get("text", "")
+        while next_output in done:
+            translation = done.pop(next_output)
+            if PY2:
+                translation = translation.encode("utf-8")
+            outfile.write(translation + "\n")
+            next_output += 1
+    outfile.flush()
+    client.close()
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -37,6 +37,8 @@ my $ZCAT = "gzip -cd";
 my $opt_hierarchical = 0;
 my $binarizer = undef;
 my $syntax_filter_cmd = "$SCRIPTS_ROOTDIR/../bin/filter-rule-table hierarchical";
+my $phrase_filter_cmd = "$SCRIPTS_ROOTDIR/../bin/filter-phrase-table";
+my $opt_threads = undef; # filter phrase-based tables with $phrase_filter_cmd
 my $min_score = undef;
 my $opt_min_non_initial_rule_count = undef;
 my $opt_gzip = 1; # gzip output files (so far only phrase-based ttable until someone tests remaining models and formats)
@@ -53,6 +55,7 @@ GetOptions(
     "SyntaxFilterCmd=s" => \$syntax_filter_cmd,
     "tempdir=s" => \$tempdir,
     "MinScore=s" => \$min_score,
+    "Threads=i" => \$opt_threads,
     "MinNonInitialRuleCount=i" => \$opt_min_non_initial_rule_count,  # DEPRECATED
 ) or exit(1);
 
@@ -62,7 +65,7 @@ my $config = shift;
 my $input = shift;
 
 if (!defined $dir || !defined $config || !defined $input) {
-  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*] [-SyntaxFilterCmd cmd]\n";
+  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*] [-SyntaxFilterCmd cmd] [-Threads n]\n";
   exit 1;
 }
 $dir = ensure_full_path($dir);
@@ -287,7 +290,7 @@ if ($opt_hierarchical) {
 }
 
 my %PHRASE_USED;
-if ($opt_filter && !$opt_hierarchical) {
+if ($opt_filter && !$opt_hierarchical && !$opt_threads) {
     # get the phrase pairs appearing in the input text, up to the $MAX_LENGTH
     open(INPUT,mk_open_string($input)) or die "Can't read $input";
     while(my $line = <INPUT>) {
@@ -359,6 +362,16 @@ for(my $i=0;$i<=$#TABLE;$i++) {
               print FILE_OUT $line
           }
           close(FILEHANDLE);
+      } elsif ($opt_threads) {
+          my $table_file = ($file !~ /\.gz$/ && -e "$file.gz") ? "$file.gz" : $file;
+          $cmd = "$phrase_filter_cmd $input $table_file --MaxLength $MAX_LENGTH --Factors $factors --Threads $opt_threads";
+          $cmd .= " --MinScore $min_score" if $min_score;
+          print STDERR "Executing: $cmd\n";
+          open(PIPE,"$cmd |") or die "Can't run $cmd";
+          while (my $line = <PIPE>) {
+              print FILE_OUT $line;
+          }
+          close(PIPE) or die "Failed to filter $file";
       } else {
           open(FILE,$openstring) or die "Can't open '$openstring'";
           while(my $entry = <FILE>) {
@@ -53,6 +53,8 @@ use File::Basename;
 use File::Path;
 use File::Spec;
 use Cwd;
+use IO::Handle;
+use IPC::Open2;
 
 my $SCRIPTS_ROOTDIR = $RealBin;
 $SCRIPTS_ROOTDIR =~ s/\/training$//;
@@ -166,6 +168,10 @@ my $___DEV_SYMAL = undef;
 my $dev_symal_abs = undef;
 my $working_dir_abs = undef;
 
+# Keep one decoder running for all iterations (moses -tuning-loop)
+my $___PERSISTENT_DECODER = 0;
+my ($persistent_decoder_pid, $persistent_decoder_in, $persistent_decoder_out);
+
 use Getopt::Long;
 GetOptions(
   "working-dir=s" => \$___WORKING_DIR,
@@ -220,7 +226,8 @@ GetOptions(
   "promix-training=s" => \$__PROMIX_TRAINING,
   "promix-table=s" => \@__PROMIX_TABLES,
   "threads=i" => \$__THREADS,
-  "spe-symal=s" => \$___DEV_SYMAL
+  "spe-symal=s" => \$___DEV_SYMAL,
+  "persistent-decoder" => \$___PERSISTENT_DECODER
 ) or exit(1);
 
 # the 4 required parameters can be supplied on the command line directly
@@ -317,6 +324,11 @@ Options:
                                 (parameter sets factor [0;1] given to current weights)
   --spe-symal=SYMAL      ... Use simulated post-editing when decoding.
                              (SYMAL aligns input to refs)
+  --persistent-decoder   ... Load the models once and keep the decoder
+                             running between iterations (moses -tuning-loop).
+                             Sparse weights not in run*.sparse-weights are
+                             reset. Not with --jobs, --hg-mira,
+                             --lattice-samples or --spe-symal.
 ";
   exit 1;
 }
@@ -324,6 +336,10 @@ Options:
 
 # Check validity of input parameters and set defaults if needed
 
+die "--persistent-decoder can't be used with --jobs, --hg-mira, --lattice-samples or --spe-symal"
+  if $___PERSISTENT_DECODER
+    && ((defined $___JOBS && $___JOBS > 0) || $___HG_MIRA || $___LATTICE_SAMPLES || defined $___DEV_SYMAL);
+
 print STDERR "Using SCRIPTS_ROOTDIR: $SCRIPTS_ROOTDIR\n";
 
 # path of script for filtering phrase tables and running the decoder
@@ -1164,6 +1180,8 @@ else {
   create_config($___CONFIG_ORIG, "./moses.ini", $featlist, $run, $devbleu, $sparse_weights_file);
 }
 
+&stop_persistent_decoder();
+
 # just to be sure that we have the really last finished step marked
 &save_finished_step($finished_step_file, $run);
 
@@ -1275,6 +1293,13 @@ sub run_decoder {
     print STDERR "DECODER_CFG = $decoder_config\n";
     print "decoder_config = $decoder_config\n";
 
+    if ($___PERSISTENT_DECODER) {
+      my $sparse_file = -e "run$run.sparse-weights" ? "run$run.sparse-weights" : "";
+      run_persistent_decoder("run$run.out", $filename, join(" ", values %model_weights), $sparse_file);
+      sanity_check_order_of_lambdas($featlist,$filename);
+      return ($filename, $lsamp_filename, $hypergraph_dir);
+    }
+
     # run the decoder
     my $decoder_cmd;
     my $lsamp_cmd = "";
@@ -1315,6 +1340,34 @@ sub run_decoder {
     return ($filename, $lsamp_filename, $hypergraph_dir);
 }
 
+# Decodes the dev set with the given weights in the decoder started by the
+# first call, which keeps its models loaded for the following iterations.
+sub run_persistent_decoder {
+    my ($outfile, $nbestfile, $weights, $sparse_file) = @_;
+    if (!defined $persistent_decoder_pid) {
+      my $cmd = "$___DECODER $___DECODER_FLAGS -config $___CONFIG";
+      $cmd .= " -inputtype $___INPUTTYPE" if defined($___INPUTTYPE);
+      $cmd .= " -report-segmentation" if $__PROMIX_TRAINING;
+      $cmd .= " -n-best-list $nbestfile $___N_BEST_LIST_SIZE distinct -input-file $___DEV_F -tuning-loop";
+      print STDERR "Starting persistent decoder: $cmd\n";
+      $persistent_decoder_pid = open2($persistent_decoder_out, $persistent_decoder_in, $cmd);
+      $persistent_decoder_in->autoflush(1);
+    }
+    my $command = "$outfile ||| $nbestfile ||| $weights";
+    $command .= " ||| $sparse_file" if $sparse_file ne "";
+    print STDERR "Persistent decoder: $command\n";
+    print $persistent_decoder_in "$command\n";
+    my $done = <$persistent_decoder_out>;
+    die "The persistent decoder died while writing $nbestfile\n" if !defined $done;
+}
+
+sub stop_persistent_decoder {
+    return if !defined $persistent_decoder_pid;
+    close($persistent_decoder_in);
+    close($persistent_decoder_out);
+    waitpid($persistent_decoder_pid, 0);
+    undef $persistent_decoder_pid;
+}
 
 sub insert_ranges_to_featlist {
   my $featlist = shift;
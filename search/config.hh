@@ -23,6 +23,8 @@ class Config {
 
     unsigned int PopLimit() const { return pop_limit_; }
 
+    void SetPopLimit(unsigned int limit) { pop_limit_ = limit; }
+
     const NBestConfig &GetNBest() const { return nbest_; }
 
   private:
@@ -24,6 +24,9 @@ class ContextBase {
 
     unsigned int PopLimit() const { return config_.PopLimit(); }
 
+    // e.g. to search the remaining cells faster when time runs out
+    void SetPopLimit(unsigned int limit) { config_.SetPopLimit(limit); }
+
     Score LMWeight() const { return config_.LMWeight(); }
 
     const Config &GetConfig() const { return config_; }
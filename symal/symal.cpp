@@ -11,8 +11,15 @@
 #include <set>
 #include <algorithm>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include "cmd.h"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
 #define MAX_WORD 10000 // maximum lengthsource/target strings 
@@ -57,12 +64,46 @@ static Enum_T BoolEnum [] = {
 
 // global variables and constants
 
-int* fa; //counters of covered foreign positions
-int* ea; //counters of covered english positions
-int** A; //alignment matrix with information symmetric/direct/inverse alignments
-
 int verbose=0;
 
+//one sentence pair with both directions of its alignment, as in a .bal
+//file: a[j] is the target position (1-based, 0 for none) of source word
+//j, b[i] the source position of target word i.
+
+struct SentencePair {
+  int m,n;
+  int a[MAX_M],b[MAX_N];
+};
+
+//scratch space of one thread for the grow alignments
+
+struct GrowSpace {
+  int* fa; //counters of covered foreign positions
+  int* ea; //counters of covered english positions
+  int** A; //alignment matrix with information symmetric/direct/inverse alignments
+
+  GrowSpace() {
+    fa=new int[MAX_M+1];
+    ea=new int[MAX_N+1];
+    A=new int *[MAX_N+1];
+    for (int i=1; i<=MAX_N; i++) A[i]=new int[MAX_M+1];
+  }
+  ~GrowSpace() {
+    delete [] fa;
+    delete [] ea;
+    for (int i=1; i<=MAX_N; i++) delete [] A[i];
+    delete [] A;
+  }
+
+private:
+  GrowSpace(const GrowSpace&);
+  void operator=(const GrowSpace&);
+};
+
+//alignment points (source, target), 0-based, in the order they are printed
+
+typedef vector<pair<int,int> > Points;
+
 //read an alignment pair from the input stream.
 
 int lc = 0;
@@ -119,30 +160,129 @@ int getals(fstream& inp,int& m, int *a,int& n, int *b)
     return 0;
 };
 
+//GIZA++ alignment files (*.A3.final), read directly instead of through
+//giza2bal.pl. A name that is not a file is run as a command, e.g.
+//"gzip -cd file.gz".
 
-//compute union alignment
-int prunionalignment(fstream& out,int m,int *a,int n,int* b)
+class A3Reader
 {
+public:
+  explicit A3Reader(const char* name) : pipe(false) {
+    file=fopen(name,"r");
+    if (!file) {
+      file=popen(name,"r");
+      pipe=true;
+    }
+    if (!file) {
+      cerr << "cannot open " << name << "\n";
+      exit(1);
+    }
+  }
+  ~A3Reader() {
+    if (pipe) pclose(file);
+    else fclose(file);
+  }
 
-  ostringstream sout;
+  //reads the three lines of the next sentence pair
+  bool Next(string& header,string& sentence,string& alignment) {
+    return GetLine(header) && GetLine(sentence) && GetLine(alignment);
+  }
+
+private:
+  FILE* file;
+  bool pipe;
+
+  bool GetLine(string& line) {
+    line.clear();
+    int c;
+    while ((c=getc(file))!=EOF && c!='\n') line+=(char)c;
+    return c!=EOF || !line.empty();
+  }
+};
+
+void tokenize(const string& line,vector<string>& tokens)
+{
+  tokens.clear();
+  istringstream in(line);
+  string token;
+  while (in >> token) tokens.push_back(token);
+}
+
+//fills al[pos] with the index of the word of alignment ("NULL ({ 1 }) w ({ 2 3 }) ...")
+//that pos is aligned to. Returns the number of words, NULL not counted.
+
+int parsealignment(const string& alignment,int* al,int size,const string& name)
+{
+  vector<string> tokens;
+  tokenize(alignment,tokens);
+  int words=0;
+  size_t t=0;
+  //the first group is the one of NULL
+  if (t<tokens.size() && tokens[t]=="NULL") {
+    for (t+=2; t<tokens.size() && tokens[t]!="})"; t++);
+    t++;
+  }
+  while (t+1<tokens.size()) {
+    words++;
+    for (t+=2; t<tokens.size() && tokens[t]!="})"; t++) {
+      int pos=atoi(tokens[t].c_str());
+      if (pos<1 || pos>size) {
+        cerr << "symal: bad alignment point " << pos << " in line #" << lc << " of " << name << "\n";
+        exit(1);
+      }
+      al[pos]=words;
+    }
+    t++;
+  }
+  return words;
+}
+
+//reads a sentence pair from the two directions, as giza2bal.pl would
+//convert it: dir gives the inverse alignment b, inv the direct one a
+
+int getA3als(A3Reader& dir,A3Reader& inv,SentencePair& sp)
+{
+  string header,dirSentence,dirAlignment,invSentence,invAlignment;
+  if (!dir.Next(header,dirSentence,dirAlignment)) return 0;
+  if (!inv.Next(header,invSentence,invAlignment)) {
+    cerr << "symal: inverse alignment ends before the direct one\n";
+    exit(1);
+  }
+  ++lc;
+
+  vector<string> tokens;
+  tokenize(dirSentence,tokens);
+  sp.n=tokens.size();
+  tokenize(invSentence,tokens);
+  sp.m=tokens.size();
+  assert(sp.n<MAX_N);
+  assert(sp.m<MAX_M);
+
+  std::fill(sp.a,sp.a+sp.m+1,0);
+  std::fill(sp.b,sp.b+sp.n+1,0);
+  int dirWords=parsealignment(dirAlignment,sp.b,sp.n,"the direct alignment");
+  int invWords=parsealignment(invAlignment,sp.a,sp.m,"the inverse alignment");
+
+  if (dirWords!=sp.m || invWords!=sp.n) {
+    cerr << "Sentence mismatch error! Line #" << lc << "\n";
+    sp.m=sp.n=1;
+    sp.a[1]=sp.b[1]=1;
+  }
+  return 1;
+}
+
+
+//compute union alignment
+int prunionalignment(Points& out,int m,int *a,int n,int* b)
+{
 
   for (int j=1; j<=m; j++)
     if (a[j])
-      sout << j-1 << "-" << a[j]-1 << " ";
+      out.push_back(make_pair(j-1,a[j]-1));
 
   for (int i=1; i<=n; i++)
     if (b[i] && a[b[i]]!=i)
-      sout << b[i]-1 <<  "-" << i-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
-
-  out << str;
-  out.flush();
+      out.push_back(make_pair(b[i]-1,i-1));
 
   return 1;
 }
@@ -150,72 +290,36 @@ int prunionalignment(fstream& out,int m,int *a,int n,int* b)
 
 //Compute intersection alignment
 
-int printersect(fstream& out,int m,int *a,int n,int* b)
+int printersect(Points& out,int m,int *a,int n,int* b)
 {
 
-  ostringstream sout;
-
   for (int j=1; j<=m; j++)
     if (a[j] && b[a[j]]==j)
-      sout << j-1 << "-" << a[j]-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
-
-  out << str;
-  out.flush();
+      out.push_back(make_pair(j-1,a[j]-1));
 
   return 1;
 }
 
 //Compute target-to-source alignment
 
-int printtgttosrc(fstream& out,int m,int *a,int n,int* b)
+int printtgttosrc(Points& out,int m,int *a,int n,int* b)
 {
 
-  ostringstream sout;
-
   for (int i=1; i<=n; i++)
     if (b[i])
-      sout << b[i]-1 << "-" << i-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
-
-  out << str;
-  out.flush();
+      out.push_back(make_pair(b[i]-1,i-1));
 
   return 1;
 }
 
 //Compute source-to-target alignment
 
-int printsrctotgt(fstream& out,int m,int *a,int n,int* b)
+int printsrctotgt(Points& out,int m,int *a,int n,int* b)
 {
 
-  ostringstream sout;
-
   for (int j=1; j<=m; j++)
     if (a[j])
-      sout << j-1 << "-" << a[j]-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
-
-  out << str;
-  out.flush();
+      out.push_back(make_pair(j-1,a[j]-1));
 
   return 1;
 }
@@ -226,10 +330,12 @@ int printsrctotgt(fstream& out,int m,int *a,int n,int* b)
 //to represent the grow alignment as the unionalignment of a
 //directed and inverted alignment
 
-int printgrow(fstream& out,int m,int *a,int n,int* b, bool diagonal=false,bool final=false,bool bothuncovered=false)
+int printgrow(Points& out,GrowSpace& space,int m,int *a,int n,int* b, bool diagonal=false,bool final=false,bool bothuncovered=false)
 {
 
-  ostringstream sout;
+  int* fa=space.fa;
+  int* ea=space.ea;
+  int** A=space.A;
 
   vector <pair <int,int> > neighbors; //neighbors
 
@@ -366,8 +472,56 @@ int printgrow(fstream& out,int m,int *a,int n,int* b, bool diagonal=false,bool f
 
 
   for (k=currentpoints.begin(); k!=currentpoints.end(); k++)
-    sout << k->second-1 << "-" << k->first-1 << " ";
+    out.push_back(make_pair(k->second-1,k->first-1));
+
+  return 1;
+}
+
+//symmetrizes batches of sentence pairs, in several threads if asked to
+
+struct Symmetrizer {
+  int alignment;
+  bool diagonal,final,bothuncovered;
+
+  void align(const SentencePair& sp,GrowSpace& space,Points& out) const {
+    int* a=const_cast<int*>(sp.a);
+    int* b=const_cast<int*>(sp.b);
+    out.clear();
+    switch (alignment) {
+    case UNION:
+      prunionalignment(out,sp.m,a,sp.n,b);
+      break;
+    case INTERSECT:
+      printersect(out,sp.m,a,sp.n,b);
+      break;
+    case GROW:
+      printgrow(out,space,sp.m,a,sp.n,b,diagonal,final,bothuncovered);
+      break;
+    case TGTTOSRC:
+      printtgttosrc(out,sp.m,a,sp.n,b);
+      break;
+    case SRCTOTGT:
+      printsrctotgt(out,sp.m,a,sp.n,b);
+      break;
+    }
+  }
+
+  //aligns every step-th sentence pair of the batch, from first on
+  void alignbatch(const vector<SentencePair>* batch,size_t size,vector<Points>* out,size_t first,size_t step) const {
+    GrowSpace space;
+    for (size_t s=first; s<size; s+=step)
+      align((*batch)[s],space,(*out)[s]);
+  }
+};
+
+//writes points as "s-t s-t ...\n"
 
+void printpoints(fstream& out,const Points& points)
+{
+  ostringstream sout;
+
+  for (size_t p=0; p<points.size(); p++)
+    sout << points[p].first << "-" << points[p].second << " ";
 
   //fix the last " "
   string str = sout.str();
@@ -377,12 +531,66 @@ int printgrow(fstream& out,int m,int *a,int n,int* b, bool diagonal=false,bool f
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
-  return 1;
-
-  return 1;
 }
 
+//writes the memory-mapped alignment format of mmsapt (.mam), as
+//symal2mam does from the text output: a header (index start, number of
+//sentences, token count), the points of each sentence as pairs of
+//variable-length integers, and the (32 bit) end offset of every sentence.
+
+class MamWriter
+{
+public:
+  explicit MamWriter(const char* name) : out(name,ios::out|ios::binary) {
+    if (!out.is_open()) {
+      cerr << "cannot open " << name << "\n";
+      exit(1);
+    }
+    writenum(0,8); // place holder for index start
+    writenum(0,4); // place holder for index size
+    writenum(0,4); // place holder for token count
+    index.push_back(out.tellp());
+  }
+
+  void write(const Points& points) {
+    for (size_t p=0; p<points.size(); p++) {
+      writevarint(points[p].first);
+      writevarint(points[p].second);
+    }
+    index.push_back(out.tellp());
+  }
+
+  void close() {
+    const unsigned long long offset=8+4+4;
+    unsigned long long idxStart=out.tellp();
+    for (size_t i=0; i<index.size(); i++)
+      writenum(index[i]-offset,4);
+    out.seekp(0);
+    writenum(idxStart,8);
+    writenum(index.size()-1,4);
+    writenum(0,4);
+    out.close();
+  }
+
+private:
+  fstream out;
+  vector<unsigned long long> index;
+
+  //little-endian
+  void writenum(unsigned long long x,int bytes) {
+    for (int i=0; i<bytes; i++, x>>=8) out.put((char)(x&255));
+  }
+
+  //7 bits per byte, the last one flagged by the high bit
+  void writevarint(unsigned int x) {
+    while (x>=128) {
+      out.put((char)(x%128));
+      x>>=7;
+    }
+    out.put((char)(x|128));
+  }
+};
+
 
 
 //Main file here
@@ -393,10 +601,14 @@ int main(int argc, char** argv)
 
   int alignment=0;
   char* input=(char*)"/dev/stdin";
-  char* output=(char*)"/dev/stdout";
+  char* output=NULL;
+  char* dirfile=NULL;
+  char* invfile=NULL;
+  char* mamfile=NULL;
   int diagonal=false;
   int final=false;
   int bothuncovered=false;
+  int threads=1;
 
 
   DeclareParams("a", CMDENUMTYPE,  &alignment, AlignEnum,
@@ -409,6 +621,10 @@ int main(int argc, char** argv)
                 "both", CMDENUMTYPE,  &bothuncovered, BoolEnum,
                 "i", CMDSTRINGTYPE, &input,
                 "o", CMDSTRINGTYPE, &output,
+                "dir", CMDSTRINGTYPE, &dirfile,
+                "inv", CMDSTRINGTYPE, &invfile,
+                "mam", CMDSTRINGTYPE, &mamfile,
+                "threads", CMDINTTYPE, &threads,
                 "v", CMDENUMTYPE,  &verbose, BoolEnum,
                 "verbose", CMDENUMTYPE,  &verbose, BoolEnum,
 
@@ -416,89 +632,122 @@ int main(int argc, char** argv)
 
   GetParams(&argc, &argv, (char*)NULL);
 
-  if (alignment==0) {
+  if (alignment==0 || (dirfile==NULL)!=(invfile==NULL)) {
     cerr << "usage: symal [-i=<inputfile>] [-o=<outputfile>] -a=[u|i|g] -d=[yes|no] -b=[yes|no] -f=[yes|no] \n"
-         << "Input file or std must be in .bal format (see script giza2bal.pl).\n";
+         << "             [-dir=<A3file> -inv=<A3file>] [-mam=<mamfile>] [-threads=<n>]\n"
+         << "Input file or std must be in .bal format (see script giza2bal.pl),\n"
+         << "unless both directions of the GIZA++ alignment are given with -dir and -inv.\n"
+         << "With -mam, the alignment is also written in mmsapt format; text output\n"
+         << "is then only written if -o is given.\n";
 
     exit(1);
 
   }
 
-  fstream inp(input,ios::in);
-  fstream out(output,ios::out);
-
-  if (!inp.is_open()) {
-    cerr << "cannot open " << input << "\n";
-    exit(1);
+  fstream inp;
+  A3Reader* dir=NULL;
+  A3Reader* inv=NULL;
+  if (dirfile) {
+    dir=new A3Reader(dirfile);
+    inv=new A3Reader(invfile);
+  } else {
+    inp.open(input,ios::in);
+    if (!inp.is_open()) {
+      cerr << "cannot open " << input << "\n";
+      exit(1);
+    }
   }
 
-  if (!out.is_open()) {
-    cerr << "cannot open " << output << "\n";
-    exit(1);
+  fstream out;
+  if (output || !mamfile) {
+    if (!output) output=(char*)"/dev/stdout";
+    out.open(output,ios::out);
+    if (!out.is_open()) {
+      cerr << "cannot open " << output << "\n";
+      exit(1);
+    }
   }
 
+  MamWriter* mam=mamfile ? new MamWriter(mamfile) : NULL;
 
-  int a[MAX_M],b[MAX_N],m,n;
-  fa=new int[MAX_M+1];
-  ea=new int[MAX_N+1];
-
-
-  int sents = 0;
-  A=new int *[MAX_N+1];
-  for (int i=1; i<=MAX_N; i++) A[i]=new int[MAX_M+1];
+  Symmetrizer symmetrizer;
+  symmetrizer.alignment=alignment;
+  symmetrizer.diagonal=diagonal;
+  symmetrizer.final=final;
+  symmetrizer.bothuncovered=bothuncovered;
 
   switch (alignment) {
   case UNION:
     cerr << "symal: computing union alignment\n";
-    while(getals(inp,m,a,n,b)) {
-      prunionalignment(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case INTERSECT:
     cerr << "symal: computing intersect alignment\n";
-    while(getals(inp,m,a,n,b)) {
-      printersect(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case GROW:
     cerr << "symal: computing grow alignment: diagonal ("
          << diagonal << ") final ("<< final << ")"
          <<  "both-uncovered (" << bothuncovered <<")\n";
-
-    while(getals(inp,m,a,n,b))
-      printgrow(out,m,a,n,b,diagonal,final,bothuncovered);
-
     break;
   case TGTTOSRC:
     cerr << "symal: computing target-to-source alignment\n";
-
-    while(getals(inp,m,a,n,b)) {
-      printtgttosrc(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case SRCTOTGT:
     cerr << "symal: computing source-to-target alignment\n";
-
-    while(getals(inp,m,a,n,b)) {
-      printsrctotgt(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   default:
     exit(1);
   }
 
-  delete [] fa;
-  delete [] ea;
-  for (int i=1; i<=MAX_N; i++) delete [] A[i];
-  delete [] A;
+#ifndef WITH_THREADS
+  threads=1;
+#endif
+  if (threads<1) threads=1;
+
+  //sentence pairs are read and written in order, a batch at a time;
+  //the threads align the pairs of a batch in between
+  const size_t batchsize=threads>1 ? 10000 : 1;
+  vector<SentencePair> batch(batchsize);
+  vector<Points> points(batchsize);
+  GrowSpace space;
+  int sents = 0;
+
+  while (true) {
+    size_t size=0;
+    while (size<batchsize) {
+      SentencePair& sp=batch[size];
+      if (dir ? !getA3als(*dir,*inv,sp) : !getals(inp,sp.m,sp.a,sp.n,sp.b)) break;
+      size++;
+    }
+    if (size==0) break;
+
+#ifdef WITH_THREADS
+    if (threads>1) {
+      boost::thread_group group;
+      for (int t=0; t<threads; t++)
+        group.create_thread(boost::bind(&Symmetrizer::alignbatch,&symmetrizer,&batch,size,&points,t,threads));
+      group.join_all();
+    } else
+#endif
+      for (size_t s=0; s<size; s++)
+        symmetrizer.align(batch[s],space,points[s]);
+
+    for (size_t s=0; s<size; s++) {
+      if (out.is_open()) printpoints(out,points[s]);
+      if (mam) mam->write(points[s]);
+    }
+    if (out.is_open()) out.flush();
+    sents+=size;
+  }
+
+  if (alignment!=GROW)
+    cerr << "Sents: " << sents << endl;
+
+  if (mam) {
+    mam->close();
+    delete mam;
+  }
+  delete dir;
+  delete inv;
 
   exit(0);
 }
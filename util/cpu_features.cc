@@ -0,0 +1,69 @@
+#include "util/cpu_features.hh"
+
+#include "util/tokenize_piece.hh"
+
+#include <stdlib.h>
+
+namespace util {
+
+namespace {
+
+const struct {
+  CPUFeature feature;
+  const char *name;
+} kFeatureNames[] = {
+  {kCPUSSE42, "sse4.2"},
+  {kCPUPOPCNT, "popcnt"},
+  {kCPUAVX2, "avx2"},
+  {kCPUBMI2, "bmi2"},
+  {kCPUAVX512F, "avx512f"},
+  {kCPUAVX512BW, "avx512bw"}
+};
+
+const size_t kNumFeatures = sizeof(kFeatureNames) / sizeof(kFeatureNames[0]);
+
+unsigned Detect() {
+  unsigned ret = 0;
+#ifdef UTIL_CPU_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) ret |= kCPUSSE42;
+  if (__builtin_cpu_supports("popcnt")) ret |= kCPUPOPCNT;
+  if (__builtin_cpu_supports("avx2")) ret |= kCPUAVX2;
+#if defined(__clang__) || __GNUC__ >= 5
+  if (__builtin_cpu_supports("bmi2")) ret |= kCPUBMI2;
+  if (__builtin_cpu_supports("avx512f")) ret |= kCPUAVX512F;
+  if (__builtin_cpu_supports("avx512bw")) ret |= kCPUAVX512BW;
+#endif
+#endif
+  const char *mask = getenv("UTIL_CPU_FEATURES");
+  if (mask) {
+    unsigned allowed = 0;
+    for (TokenIter<SingleCharacter, true> name(mask, ','); name; ++name) {
+      for (size_t i = 0; i < kNumFeatures; ++i) {
+        if (*name == kFeatureNames[i].name) allowed |= kFeatureNames[i].feature;
+      }
+    }
+    ret &= allowed;
+  }
+  return ret;
+}
+
+} // namespace
+
+unsigned CPUFeatures() {
+  // Thread-safe in C++11 and harmless to race on before: Detect always gives the same.
+  static const unsigned features = Detect();
+  return features;
+}
+
+std::string CPUFeatureNames(unsigned features) {
+  std::string ret;
+  for (size_t i = 0; i < kNumFeatures; ++i) {
+    if (!(features & kFeatureNames[i].feature)) continue;
+    if (!ret.empty()) ret += ',';
+    ret += kFeatureNames[i].name;
+  }
+  return ret;
+}
+
+} // namespace util
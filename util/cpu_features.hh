@@ -0,0 +1,60 @@
+#ifndef UTIL_CPU_FEATURES_H
+#define UTIL_CPU_FEATURES_H
+
+#include <string>
+
+#include <stddef.h>
+
+/* Runtime selection among variants of a kernel compiled for different
+ * instruction set extensions.  The binary stays portable: variants are
+ * compiled with __attribute__((target(...))) rather than -m flags, and the
+ * best one the CPU supports is picked once.  Every variant must compute
+ * exactly the same result, so the choice never shows in the output.
+ */
+
+// Compilers that support target attributes on x86.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define UTIL_CPU_DISPATCH
+#endif
+
+namespace util {
+
+enum CPUFeature {
+  kCPUSSE42 = 1 << 0,
+  kCPUPOPCNT = 1 << 1,
+  kCPUAVX2 = 1 << 2,
+  kCPUBMI2 = 1 << 3,
+  kCPUAVX512F = 1 << 4,
+  kCPUAVX512BW = 1 << 5
+};
+
+/* The features of this CPU, detected on the first call.  The environment
+ * variable UTIL_CPU_FEATURES restricts them to a comma-separated list of
+ * names as in CPUFeatureNames, or to none with an empty value, to test and
+ * time the fallbacks on a machine that has everything.
+ */
+unsigned CPUFeatures();
+
+// Comma-separated names of features, e.g. "sse4.2,popcnt,avx2".
+std::string CPUFeatureNames(unsigned features);
+
+template <class Fn> struct KernelVariant {
+  // Bitwise or of the CPUFeature values the variant needs.
+  unsigned features;
+  const char *name;
+  Fn fn;
+};
+
+/* The first of variants whose features are all in features.  List the best
+ * variant first and end with one that needs nothing.
+ */
+template <class Fn> const KernelVariant<Fn> &SelectKernel(const KernelVariant<Fn> *variants, size_t count, unsigned features = CPUFeatures()) {
+  for (size_t i = 0; i + 1 < count; ++i) {
+    if ((variants[i].features & features) == variants[i].features) return variants[i];
+  }
+  return variants[count - 1];
+}
+
+} // namespace util
+
+#endif // UTIL_CPU_FEATURES_H
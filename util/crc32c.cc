@@ -0,0 +1,109 @@
+#include "util/crc32c.hh"
+
+#include <cstring>
+
+#ifdef UTIL_CPU_DISPATCH
+#include <x86intrin.h>
+#endif
+
+namespace util {
+
+namespace {
+
+// Reversed Castagnoli polynomial.
+const uint32_t kPolynomial = 0x82f63b78;
+
+// Slicing by 8: kTable[k][b] is the CRC of byte b followed by k zero bytes.
+struct Tables {
+  Tables() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b;
+      for (unsigned i = 0; i < 8; ++i) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      table[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+      for (unsigned k = 1; k < 8; ++k) {
+        table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+      }
+    }
+  }
+  uint32_t table[8][256];
+};
+
+uint32_t CRC32CPortable(const void *data, std::size_t len, uint32_t crc) {
+  // Built on first use, since other static initializers may hash.
+  static const Tables tables;
+  const uint32_t (*t)[256] = tables.table;
+  const uint8_t *p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  for (; len >= 8; len -= 8, p += 8) {
+    uint32_t low = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24));
+    crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+      t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+  }
+  for (; len; --len, ++p) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+  }
+  return ~crc;
+}
+
+#ifdef UTIL_CPU_DISPATCH
+__attribute__((target("sse4.2"))) uint32_t CRC32CSSE42(const void *data, std::size_t len, uint32_t crc) {
+  const uint8_t *p = static_cast<const uint8_t*>(data);
+#if defined(__x86_64__)
+  uint64_t wide = ~crc;
+  for (; len >= 8; len -= 8, p += 8) {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    wide = _mm_crc32_u64(wide, word);
+  }
+  uint32_t narrow = static_cast<uint32_t>(wide);
+#else
+  uint32_t narrow = ~crc;
+#endif
+  for (; len >= 4; len -= 4, p += 4) {
+    uint32_t word;
+    std::memcpy(&word, p, 4);
+    narrow = _mm_crc32_u32(narrow, word);
+  }
+  for (; len; --len, ++p) {
+    narrow = _mm_crc32_u8(narrow, *p);
+  }
+  return ~narrow;
+}
+#endif
+
+const KernelVariant<CRC32CFunction> kVariants[] = {
+#ifdef UTIL_CPU_DISPATCH
+  {kCPUSSE42, "sse4.2", &CRC32CSSE42},
+#endif
+  {0, "portable", &CRC32CPortable}
+};
+
+const std::size_t kNumVariants = sizeof(kVariants) / sizeof(kVariants[0]);
+
+uint32_t CRC32CResolve(const void *data, std::size_t len, uint32_t crc);
+
+// Constant initialized, so this works during static initialization too.
+// Threads racing on the first call all store the same pointer.
+CRC32CFunction selected = &CRC32CResolve;
+
+uint32_t CRC32CResolve(const void *data, std::size_t len, uint32_t crc) {
+  selected = SelectKernel(kVariants, kNumVariants).fn;
+  return selected(data, len, crc);
+}
+
+} // namespace
+
+uint32_t CRC32C(const void *data, std::size_t len, uint32_t crc) {
+  return selected(data, len, crc);
+}
+
+const KernelVariant<CRC32CFunction> *CRC32CVariants(std::size_t &count) {
+  count = kNumVariants;
+  return kVariants;
+}
+
+} // namespace util
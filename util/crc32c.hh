@@ -0,0 +1,26 @@
+#ifndef UTIL_CRC32C_H
+#define UTIL_CRC32C_H
+
+#include "util/cpu_features.hh"
+
+#include <cstddef>
+
+#include <stdint.h>
+
+namespace util {
+
+/* CRC-32C (Castagnoli), with the crc32 instruction of SSE 4.2 where the CPU
+ * has it and tables otherwise.  Both give the same value everywhere, but
+ * MurmurHash remains the hash of anything written to disk.  crc is the
+ * CRC32C of the data before, to hash in pieces.
+ */
+uint32_t CRC32C(const void *data, std::size_t len, uint32_t crc = 0);
+
+typedef uint32_t (*CRC32CFunction)(const void *data, std::size_t len, uint32_t crc);
+
+// All implementations, best first, for tests and benchmarks.
+const KernelVariant<CRC32CFunction> *CRC32CVariants(std::size_t &count);
+
+} // namespace util
+
+#endif // UTIL_CRC32C_H
@@ -0,0 +1,58 @@
+#include "util/crc32c.hh"
+
+#define BOOST_TEST_MODULE CRC32CTest
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace util {
+namespace {
+
+BOOST_AUTO_TEST_CASE(CheckValue) {
+  BOOST_CHECK_EQUAL(0xe3069283U, CRC32C("123456789", 9));
+  BOOST_CHECK_EQUAL(0U, CRC32C("", 0));
+}
+
+BOOST_AUTO_TEST_CASE(Pieces) {
+  const char *text = "The quick brown fox jumps over the lazy dog";
+  std::size_t len = std::strlen(text);
+  for (std::size_t split = 0; split <= len; ++split) {
+    BOOST_CHECK_EQUAL(CRC32C(text, len), CRC32C(text + split, len - split, CRC32C(text, split)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(VariantsAgree) {
+  std::size_t count;
+  const KernelVariant<CRC32CFunction> *variants = CRC32CVariants(count);
+  BOOST_REQUIRE(count >= 1);
+  const CRC32CFunction portable = variants[count - 1].fn;
+  BOOST_CHECK_EQUAL(0, variants[count - 1].features);
+  std::vector<unsigned char> data(100);
+  for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<unsigned char>(i * 37 + 11);
+  for (std::size_t v = 0; v + 1 < count; ++v) {
+    if ((variants[v].features & CPUFeatures()) != variants[v].features) continue;
+    // Every length and alignment around the word sizes.
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+      for (std::size_t len = 0; offset + len <= data.size(); ++len) {
+        BOOST_CHECK_EQUAL(portable(&data[offset], len, 0), variants[v].fn(&data[offset], len, 0));
+        BOOST_CHECK_EQUAL(portable(&data[offset], len, 0x12345678), variants[v].fn(&data[offset], len, 0x12345678));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Select) {
+  int best = 1, fallback = 2;
+  const KernelVariant<int*> variants[] = {
+    {kCPUAVX2 | kCPUBMI2, "avx2", &best},
+    {0, "portable", &fallback}
+  };
+  BOOST_CHECK_EQUAL(&best, SelectKernel(variants, 2, kCPUAVX2 | kCPUBMI2 | kCPUSSE42).fn);
+  BOOST_CHECK_EQUAL(&fallback, SelectKernel(variants, 2, kCPUAVX2).fn);
+  BOOST_CHECK_EQUAL(&fallback, SelectKernel(variants, 2, 0).fn);
+  BOOST_CHECK_EQUAL("avx2,bmi2", CPUFeatureNames(kCPUAVX2 | kCPUBMI2));
+}
+
+} // namespace
+} // namespace util
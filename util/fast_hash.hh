@@ -0,0 +1,116 @@
+#ifndef UTIL_FAST_HASH_H
+#define UTIL_FAST_HASH_H
+
+#include "util/string_piece.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+#include <stdint.h>
+
+/* A hash in the style of wyhash for in-memory hash tables: short keys are
+ * read with a few overlapping loads and mixed with one 64x64->128 bit
+ * multiply, long ones 48 bytes at a time.  It is inline, so keys of a known
+ * length compile down to a handful of instructions.  Values depend on the
+ * endianness of the machine and may change between versions, so anything
+ * written to disk keeps using MurmurHash (lm vocabularies, ProbingPT,
+ * CompactPT).
+ */
+
+namespace util {
+namespace detail {
+
+const uint64_t kFastHashP0 = 0xa0761d6478bd642fULL;
+const uint64_t kFastHashP1 = 0xe7037ed1a0b428dbULL;
+const uint64_t kFastHashP2 = 0x8ebc6af09c88c6e3ULL;
+const uint64_t kFastHashP3 = 0x589965cc75374cc3ULL;
+
+// a * b as 128 bits in low (first) and high (second).
+inline void FastHashMultiply(uint64_t &a, uint64_t &b) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+  a = static_cast<uint64_t>(r);
+  b = static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+  uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+  uint64_t mid = (ll >> 32) + static_cast<uint32_t>(hl) + static_cast<uint32_t>(lh);
+  a = (mid << 32) | static_cast<uint32_t>(ll);
+  b = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
+inline uint64_t FastHashMix(uint64_t a, uint64_t b) {
+  FastHashMultiply(a, b);
+  return a ^ b;
+}
+
+inline uint64_t FastHashRead8(const uint8_t *p) {
+  uint64_t ret;
+  std::memcpy(&ret, p, 8);
+  return ret;
+}
+
+inline uint64_t FastHashRead4(const uint8_t *p) {
+  uint32_t ret;
+  std::memcpy(&ret, p, 4);
+  return ret;
+}
+
+} // namespace detail
+
+inline uint64_t FastHash(const void *key, std::size_t len, uint64_t seed = 0) {
+  using namespace detail;
+  const uint8_t *p = static_cast<const uint8_t*>(key);
+  seed ^= FastHashMix(seed ^ kFastHashP0, kFastHashP1);
+  uint64_t a, b;
+  if (len <= 16) {
+    if (len >= 4) {
+      // Two overlapping pairs of 4 bytes cover 4 to 16 bytes.
+      std::size_t shift = (len >> 3) << 2;
+      a = (FastHashRead4(p) << 32) | FastHashRead4(p + shift);
+      b = (FastHashRead4(p + len - 4) << 32) | FastHashRead4(p + len - 4 - shift);
+    } else if (len > 0) {
+      a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    std::size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = FastHashMix(FastHashRead8(p) ^ kFastHashP1, FastHashRead8(p + 8) ^ seed);
+        see1 = FastHashMix(FastHashRead8(p + 16) ^ kFastHashP2, FastHashRead8(p + 24) ^ see1);
+        see2 = FastHashMix(FastHashRead8(p + 32) ^ kFastHashP3, FastHashRead8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = FastHashMix(FastHashRead8(p) ^ kFastHashP1, FastHashRead8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = FastHashRead8(p + i - 16);
+    b = FastHashRead8(p + i - 8);
+  }
+  a ^= kFastHashP1;
+  b ^= seed;
+  FastHashMultiply(a, b);
+  return FastHashMix(a ^ kFastHashP0 ^ len, b ^ kFastHashP1);
+}
+
+// For hash tables keyed by StringPiece (or anything convertible to it).
+struct FastHashPiece : public std::unary_function<const StringPiece &, std::size_t> {
+  std::size_t operator()(const StringPiece &str) const {
+    return static_cast<std::size_t>(FastHash(str.data(), str.size()));
+  }
+};
+
+} // namespace util
+
+#endif // UTIL_FAST_HASH_H
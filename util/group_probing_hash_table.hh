@@ -0,0 +1,180 @@
+#ifndef UTIL_GROUP_PROBING_HASH_TABLE_H
+#define UTIL_GROUP_PROBING_HASH_TABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace util {
+
+namespace detail {
+
+const std::size_t kGroupSize = 16;
+const uint8_t kGroupEmpty = 0x80;
+
+// Bit i is set where control byte i of the group is tag.
+inline unsigned GroupMatch(const uint8_t *group, uint8_t tag) {
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group)), _mm_set1_epi8(tag)));
+#else
+  unsigned ret = 0;
+  for (std::size_t i = 0; i < kGroupSize; ++i) ret |= static_cast<unsigned>(group[i] == tag) << i;
+  return ret;
+#endif
+}
+
+// Bit i is set where slot i of the group is empty.
+inline unsigned GroupEmpty(const uint8_t *group) {
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group)));
+#else
+  unsigned ret = 0;
+  for (std::size_t i = 0; i < kGroupSize; ++i) ret |= static_cast<unsigned>(group[i] >> 7) << i;
+  return ret;
+#endif
+}
+
+inline unsigned LowestBit(unsigned bits) {
+#if defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  unsigned ret = 0;
+  for (; !(bits & 1); bits >>= 1) ++ret;
+  return ret;
+#endif
+}
+
+} // namespace detail
+
+/* Hash table for lookup-heavy in-memory structures, in the style of Swiss
+ * tables: slots are in groups of 16 with a control byte each, which holds 7
+ * bits of the hash or marks the slot empty.  A lookup compares the 16
+ * control bytes of a group with one SSE2 instruction and only looks at the
+ * entries whose bits match, so a miss rarely touches an entry.  Groups are
+ * probed quadratically.
+ *
+ * Unlike ProbingHashTable this owns its memory and grows by itself, and
+ * needs no invalid key, but cannot be serialized.  Entries are as for
+ * ProbingHashTable (GetKey()); there is no erase.  Insertion invalidates
+ * iterators.
+ */
+template <class EntryT, class HashT, class EqualT = std::equal_to<typename EntryT::Key> > class GroupProbingHashTable {
+  public:
+    typedef EntryT Entry;
+    typedef typename Entry::Key Key;
+    typedef const Entry *ConstIterator;
+    typedef Entry *MutableIterator;
+    typedef HashT Hash;
+    typedef EqualT Equal;
+
+    explicit GroupProbingHashTable(std::size_t initial_size = 0, const Hash &hash_func = Hash(), const Equal &equal_func = Equal())
+      : hash_(hash_func), equal_(equal_func), entries_(0) {
+      std::size_t groups = 1;
+      while (groups * detail::kGroupSize * 7 / 8 <= initial_size) groups *= 2;
+      Allocate(groups);
+    }
+
+    template <class Key> bool Find(const Key key, ConstIterator &out) const {
+      uint64_t hash = hash_(key);
+      const uint8_t tag = Tag(hash);
+      for (std::size_t group = hash >> 7, step = 0;; group += ++step) {
+        group &= mask_;
+        const uint8_t *control = &control_[group * detail::kGroupSize];
+        for (unsigned match = detail::GroupMatch(control, tag); match; match &= match - 1) {
+          ConstIterator i = &slots_[group * detail::kGroupSize + detail::LowestBit(match)];
+          if (equal_(i->GetKey(), key)) { out = i; return true; }
+        }
+        if (detail::GroupEmpty(control)) return false;
+      }
+    }
+
+    template <class Key> bool UnsafeMutableFind(const Key key, MutableIterator &out) {
+      ConstIterator i;
+      if (!Find(key, i)) return false;
+      out = const_cast<MutableIterator>(i);
+      return true;
+    }
+
+    // Assumes that the key is not there yet.
+    template <class T> MutableIterator Insert(const T &t) {
+      if (entries_ >= threshold_) Allocate((mask_ + 1) * 2);
+      ++entries_;
+      return UncheckedInsert(t);
+    }
+
+    // Return true if the value was found (and not inserted), as ProbingHashTable.
+    template <class T> bool FindOrInsert(const T &t, MutableIterator &out) {
+      if (UnsafeMutableFind(t.GetKey(), out)) return true;
+      out = Insert(t);
+      return false;
+    }
+
+    // Hint that the lookup of key will come soon.
+    template <class Key> void Prefetch(const Key key) const {
+#if defined(__GNUC__)
+      std::size_t group = (hash_(key) >> 7) & mask_;
+      __builtin_prefetch(&control_[group * detail::kGroupSize]);
+      __builtin_prefetch(&slots_[group * detail::kGroupSize]);
+#endif
+    }
+
+    std::size_t Size() const { return entries_; }
+
+    void Clear() {
+      std::fill(control_.begin(), control_.end(), detail::kGroupEmpty);
+      entries_ = 0;
+    }
+
+  private:
+    static uint8_t Tag(uint64_t hash) {
+      return static_cast<uint8_t>(hash & 0x7f);
+    }
+
+    // The first empty slot on the probe sequence, which is where Find stops.
+    template <class T> MutableIterator UncheckedInsert(const T &t) {
+      uint64_t hash = hash_(t.GetKey());
+      for (std::size_t group = hash >> 7, step = 0;; group += ++step) {
+        group &= mask_;
+        uint8_t *control = &control_[group * detail::kGroupSize];
+        unsigned empty = detail::GroupEmpty(control);
+        if (!empty) continue;
+        std::size_t slot = detail::LowestBit(empty);
+        control[slot] = Tag(hash);
+        MutableIterator ret = &slots_[group * detail::kGroupSize + slot];
+        *ret = t;
+        return ret;
+      }
+    }
+
+    void Allocate(std::size_t groups) {
+      std::vector<uint8_t> old_control(groups * detail::kGroupSize, detail::kGroupEmpty);
+      std::vector<Entry> old_slots(groups * detail::kGroupSize);
+      control_.swap(old_control);
+      slots_.swap(old_slots);
+      mask_ = groups - 1;
+      // At most 7/8 full, so every probe sequence meets an empty slot.
+      threshold_ = groups * detail::kGroupSize * 7 / 8;
+      for (std::size_t i = 0; i < old_control.size(); ++i) {
+        if (old_control[i] != detail::kGroupEmpty) UncheckedInsert(old_slots[i]);
+      }
+    }
+
+    std::vector<uint8_t> control_;
+    std::vector<Entry> slots_;
+    std::size_t mask_;
+    std::size_t threshold_;
+    Hash hash_;
+    Equal equal_;
+    std::size_t entries_;
+};
+
+} // namespace util
+
+#endif // UTIL_GROUP_PROBING_HASH_TABLE_H
@@ -0,0 +1,114 @@
+#include "util/group_probing_hash_table.hh"
+
+#include "util/fast_hash.hh"
+
+#define BOOST_TEST_MODULE GroupProbingHashTableTest
+#include <boost/test/unit_test.hpp>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util {
+namespace {
+
+struct Entry64 {
+  typedef uint64_t Key;
+  uint64_t key;
+  uint64_t value;
+  Key GetKey() const { return key; }
+};
+
+// Worst case: the low bits, which pick the tag, are all the same.
+struct ShiftedHash {
+  uint64_t operator()(uint64_t key) const { return key << 7; }
+};
+
+template <class Hash> void Random(std::size_t initial) {
+  GroupProbingHashTable<Entry64, Hash> table(initial);
+  std::set<uint64_t> inserted;
+  uint64_t state = 1;
+  for (std::size_t i = 0; i < 20000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t key = state >> 44;
+    Entry64 entry;
+    entry.key = key;
+    entry.value = key * 3;
+    typename GroupProbingHashTable<Entry64, Hash>::MutableIterator it;
+    BOOST_CHECK_EQUAL(inserted.count(key) != 0, table.FindOrInsert(entry, it));
+    BOOST_CHECK_EQUAL(key, it->key);
+    inserted.insert(key);
+  }
+  BOOST_CHECK_EQUAL(inserted.size(), table.Size());
+  for (uint64_t key = 0; key < (1 << 20); key += 37) {
+    typename GroupProbingHashTable<Entry64, Hash>::ConstIterator it = NULL;
+    bool found = table.Find(key, it);
+    BOOST_REQUIRE_EQUAL(inserted.count(key) != 0, found);
+    if (found) BOOST_CHECK_EQUAL(key * 3, it->value);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Grow) {
+  Random<ShiftedHash>(0);
+}
+
+BOOST_AUTO_TEST_CASE(Reserved) {
+  Random<ShiftedHash>(50000);
+}
+
+struct PieceEntry {
+  typedef StringPiece Key;
+  StringPiece key;
+  std::size_t value;
+  Key GetKey() const { return key; }
+};
+
+BOOST_AUTO_TEST_CASE(Strings) {
+  std::vector<std::string> words;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    std::ostringstream word;
+    word << "word" << i;
+    words.push_back(word.str());
+  }
+  GroupProbingHashTable<PieceEntry, FastHashPiece> table;
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    PieceEntry entry;
+    entry.key = words[i];
+    entry.value = i;
+    table.Insert(entry);
+  }
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    const PieceEntry *it = NULL;
+    BOOST_REQUIRE(table.Find(StringPiece(words[i]), it));
+    BOOST_CHECK_EQUAL(i, it->value);
+  }
+  const PieceEntry *it = NULL;
+  BOOST_CHECK(!table.Find(StringPiece("word1000"), it));
+  BOOST_CHECK(!table.Find(StringPiece(""), it));
+  table.Clear();
+  BOOST_CHECK_EQUAL(0U, table.Size());
+  BOOST_CHECK(!table.Find(StringPiece(words[0]), it));
+}
+
+BOOST_AUTO_TEST_CASE(FastHashBytes) {
+  // Every byte matters, at every length the short and long paths handle.
+  unsigned char data[200];
+  for (std::size_t i = 0; i < sizeof(data); ++i) data[i] = static_cast<unsigned char>(i * 7 + 1);
+  std::set<uint64_t> hashes;
+  for (std::size_t len = 0; len <= sizeof(data); ++len) {
+    hashes.insert(FastHash(data, len));
+    for (std::size_t i = 0; i < len; ++i) {
+      uint64_t before = FastHash(data, len);
+      data[i] ^= 0x10;
+      BOOST_CHECK(before != FastHash(data, len));
+      data[i] ^= 0x10;
+    }
+  }
+  BOOST_CHECK_EQUAL(sizeof(data) + 1, hashes.size());
+  BOOST_CHECK(FastHash(data, 10, 1) != FastHash(data, 10, 2));
+}
+
+} // namespace
+} // namespace util
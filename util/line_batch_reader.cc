@@ -0,0 +1,133 @@
+#include "util/line_batch_reader.hh"
+
+#include "util/exception.hh"
+
+#include <boost/bind.hpp>
+
+#include <exception>
+
+namespace util {
+
+namespace {
+const std::size_t kReadSize = 1 << 16;
+} // namespace
+
+LineBatchReader::LineBatchReader(int fd, std::size_t batch_lines, std::size_t queue_batches)
+  : in_(fd), batch_lines_(batch_lines), buffer_pos_(0), eof_(false), current_pos_(0)
+#ifdef WITH_THREADS
+  , queue_(queue_batches), done_(false), stop_(false)
+#endif
+{
+#ifdef WITH_THREADS
+  thread_.reset(new boost::thread(boost::bind(&LineBatchReader::Produce, this)));
+#endif
+}
+
+LineBatchReader::~LineBatchReader() {
+#ifdef WITH_THREADS
+  {
+    boost::unique_lock<boost::mutex> lock(stop_mutex_);
+    stop_ = true;
+  }
+  // The background thread may be waiting for room in the queue.
+  while (!done_) {
+    std::vector<std::string> *batch = queue_.Consume();
+    if (!batch) break;
+    delete batch;
+  }
+  thread_->join();
+#endif
+}
+
+bool LineBatchReader::Next(std::vector<std::string> &lines) {
+  current_.clear();
+  current_pos_ = 0;
+#ifdef WITH_THREADS
+  if (done_) return false;
+  std::vector<std::string> *batch = queue_.Consume();
+  if (!batch) {
+    done_ = true;
+    UTIL_THROW_IF(!error_.empty(), Exception, error_);
+    return false;
+  }
+  lines.swap(*batch);
+  delete batch;
+  return true;
+#else
+  return ReadBatch(lines);
+#endif
+}
+
+bool LineBatchReader::ReadLine(std::string &line) {
+  if (current_pos_ == current_.size()) {
+    std::vector<std::string> lines;
+    if (!Next(lines)) return false;
+    current_.swap(lines);
+  }
+  line.swap(current_[current_pos_++]);
+  return true;
+}
+
+bool LineBatchReader::ReadBatch(std::vector<std::string> &lines) {
+  lines.clear();
+  std::size_t search_from = buffer_pos_;
+  while (lines.size() < batch_lines_) {
+    std::size_t newline = buffer_.find('\n', search_from);
+    if (newline != std::string::npos) {
+      lines.push_back(buffer_.substr(buffer_pos_, newline - buffer_pos_));
+      buffer_pos_ = search_from = newline + 1;
+      continue;
+    }
+    if (eof_) {
+      // last line without a newline
+      if (buffer_pos_ < buffer_.size()) lines.push_back(buffer_.substr(buffer_pos_));
+      buffer_.clear();
+      buffer_pos_ = 0;
+      break;
+    }
+    buffer_.erase(0, buffer_pos_);
+    buffer_pos_ = 0;
+    search_from = buffer_.size();
+    buffer_.resize(search_from + kReadSize);
+    std::size_t got = in_.Read(&buffer_[search_from], kReadSize);
+    buffer_.resize(search_from + got);
+    if (!got) eof_ = true;
+  }
+  return !lines.empty();
+}
+
+#ifdef WITH_THREADS
+bool LineBatchReader::Stopping() {
+  boost::unique_lock<boost::mutex> lock(stop_mutex_);
+  return stop_;
+}
+
+void LineBatchReader::Produce() {
+  try {
+    while (!Stopping()) {
+      std::vector<std::string> *batch = new std::vector<std::string>();
+      if (!ReadBatch(*batch)) {
+        delete batch;
+        break;
+      }
+      queue_.Produce(batch);
+    }
+  } catch (const std::exception &e) {
+    error_ = e.what();
+  }
+  queue_.Produce(NULL);
+}
+#endif
+
+LineBatchStream::LineBatchStream(int fd) : std::istream(&buf_), buf_(fd) {}
+
+LineBatchStream::Buf::int_type LineBatchStream::Buf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  if (!reader_.ReadLine(line_)) return traits_type::eof();
+  line_ += '\n';
+  char *begin = &line_[0];
+  setg(begin, begin, begin + line_.size());
+  return traits_type::to_int_type(*begin);
+}
+
+} // namespace util
@@ -0,0 +1,100 @@
+#ifndef UTIL_LINE_BATCH_READER_H
+#define UTIL_LINE_BATCH_READER_H
+
+#include "util/read_compressed.hh"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include "util/pcqueue.hh"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+namespace util {
+
+/* Reads a file, compressed or not, in batches of lines.  With threads, a
+ * background thread reads and decompresses a few batches ahead of the
+ * consumer, so a tool that parses its input serially is not also waiting
+ * on zlib.  Lines are returned without their newline.  There may only be
+ * one consumer.
+ */
+class LineBatchReader : boost::noncopyable {
+  public:
+    // Takes ownership of fd.
+    explicit LineBatchReader(int fd, std::size_t batch_lines = 4096, std::size_t queue_batches = 4);
+
+    ~LineBatchReader();
+
+    // Replaces lines with the next batch.  False at the end of the file.
+    bool Next(std::vector<std::string> &lines);
+
+    // Next line from the current batch.  False at the end of the file.
+    bool ReadLine(std::string &line);
+
+  private:
+    // Fills lines with up to batch_lines_ lines.  False at the end of the file.
+    bool ReadBatch(std::vector<std::string> &lines);
+
+    ReadCompressed in_;
+    const std::size_t batch_lines_;
+
+    // Read but not yet split into lines.
+    std::string buffer_;
+    std::size_t buffer_pos_;
+    bool eof_;
+
+    std::vector<std::string> current_;
+    std::size_t current_pos_;
+
+#ifdef WITH_THREADS
+    void Produce();
+    bool Stopping();
+
+    // NULL marks the end of the file, or an error in the background thread.
+    PCQueue<std::vector<std::string>*> queue_;
+    // Set by the background thread before it produces NULL.
+    std::string error_;
+    // The consumer has seen NULL.
+    bool done_;
+
+    bool stop_;
+    boost::mutex stop_mutex_;
+
+    boost::scoped_ptr<boost::thread> thread_;
+#endif
+};
+
+// std::istream over a LineBatchReader, for parsers that read from a stream.
+class LineBatchStream : public std::istream {
+  public:
+    // Takes ownership of fd.
+    explicit LineBatchStream(int fd);
+
+  private:
+    class Buf : public std::streambuf {
+      public:
+        explicit Buf(int fd) : reader_(fd) {}
+
+      protected:
+        int_type underflow();
+
+      private:
+        LineBatchReader reader_;
+        std::string line_;
+    };
+
+    Buf buf_;
+};
+
+} // namespace util
+
+#endif // UTIL_LINE_BATCH_READER_H
@@ -0,0 +1,76 @@
+#include "util/line_batch_reader.hh"
+
+#include "util/file.hh"
+
+#define BOOST_TEST_MODULE LineBatchReaderTest
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace util {
+namespace {
+
+// Temporary file holding the numbers below count, one per line, and a last
+// line without a newline.
+int WriteLines(unsigned count) {
+  std::ostringstream text;
+  for (unsigned i = 0; i < count; ++i) text << i << '\n';
+  text << "last";
+  int fd = MakeTemp("line_batch_reader_test");
+  WriteOrThrow(fd, text.str().data(), text.str().size());
+  SeekOrThrow(fd, 0);
+  return fd;
+}
+
+BOOST_AUTO_TEST_CASE(Batches) {
+  LineBatchReader reader(WriteLines(10), 4, 2);
+  std::vector<std::string> lines;
+  BOOST_REQUIRE(reader.Next(lines));
+  BOOST_REQUIRE_EQUAL(4, lines.size());
+  BOOST_CHECK_EQUAL("0", lines[0]);
+  BOOST_CHECK_EQUAL("3", lines[3]);
+  BOOST_REQUIRE(reader.Next(lines));
+  BOOST_REQUIRE(reader.Next(lines));
+  BOOST_REQUIRE_EQUAL(3, lines.size());
+  BOOST_CHECK_EQUAL("8", lines[0]);
+  BOOST_CHECK_EQUAL("last", lines[2]);
+  BOOST_CHECK(!reader.Next(lines));
+  BOOST_CHECK(!reader.Next(lines));
+}
+
+BOOST_AUTO_TEST_CASE(Lines) {
+  LineBatchReader reader(WriteLines(100000), 100, 3);
+  std::string line;
+  for (unsigned i = 0; i < 100000; ++i) {
+    BOOST_REQUIRE(reader.ReadLine(line));
+    std::ostringstream expect;
+    expect << i;
+    BOOST_REQUIRE_EQUAL(expect.str(), line);
+  }
+  BOOST_REQUIRE(reader.ReadLine(line));
+  BOOST_CHECK_EQUAL("last", line);
+  BOOST_CHECK(!reader.ReadLine(line));
+}
+
+BOOST_AUTO_TEST_CASE(StopEarly) {
+  // the background thread is still reading when the reader goes away
+  LineBatchReader reader(WriteLines(100000), 10, 1);
+  std::string line;
+  BOOST_REQUIRE(reader.ReadLine(line));
+  BOOST_CHECK_EQUAL("0", line);
+}
+
+BOOST_AUTO_TEST_CASE(Stream) {
+  LineBatchStream stream(WriteLines(3));
+  std::string line;
+  std::vector<std::string> lines;
+  while (std::getline(stream, line)) lines.push_back(line);
+  BOOST_REQUIRE_EQUAL(4, lines.size());
+  BOOST_CHECK_EQUAL("2", lines[2]);
+  BOOST_CHECK_EQUAL("last", lines[3]);
+}
+
+} // namespace
+} // namespace util
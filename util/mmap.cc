@@ -9,7 +9,9 @@
 #include "util/parallel_read.hh"
 #include "util/scoped.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include <cassert>
 #include <fcntl.h>
@@ -53,6 +55,55 @@ void UnmapOrThrow(void *start, size_t length) {
 #endif
 }
 
+void AdviseMapping(const void *start, std::size_t size, int advice) {
+  if (!size || advice == ADVISE_NONE) return;
+#if !defined(_WIN32) && !defined(_WIN64)
+  // madvise and mlock want page aligned addresses.
+  const std::size_t page = SizePage();
+  uint8_t *begin = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(start) & ~(page - 1));
+  std::size_t length = static_cast<const uint8_t*>(start) + size - begin;
+#  ifdef MADV_HUGEPAGE
+  if (advice & ADVISE_HUGE) madvise(begin, length, MADV_HUGEPAGE);
+#  endif
+#  ifdef MADV_WILLNEED
+  if (advice & (ADVISE_POPULATE | ADVISE_WILLNEED)) madvise(begin, length, MADV_WILLNEED);
+#  endif
+  if (advice & ADVISE_POPULATE) {
+    // WILLNEED only starts readahead; touch every page so decoding never waits on a fault.
+    volatile uint8_t sink = 0;
+    for (std::size_t i = 0; i < length; i += page) sink ^= begin[i];
+  }
+  if (advice & ADVISE_LOCK) {
+    UTIL_THROW_IF(mlock(begin, length), ErrnoException, "mlock failed for size " << length << "; check ulimit -l");
+  }
+#else
+  (void)start;
+#endif
+}
+
+std::size_t ResidentBytes(const void *start, std::size_t size) {
+  if (!size) return 0;
+#if !defined(_WIN32) && !defined(_WIN64)
+  const std::size_t page = SizePage();
+  uint8_t *begin = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(start) & ~(page - 1));
+  std::size_t length = static_cast<const uint8_t*>(start) + size - begin;
+  std::vector<unsigned char> pages((length + page - 1) / page);
+#  if defined(__APPLE__) || defined(__FreeBSD__)
+  if (mincore(begin, length, reinterpret_cast<char*>(&pages[0]))) return size;
+#  else
+  if (mincore(begin, length, &pages[0])) return size;
+#  endif
+  std::size_t resident = 0;
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    if (pages[i] & 1) resident += page;
+  }
+  return std::min(resident, size);
+#else
+  (void)start;
+  return size;
+#endif
+}
+
 scoped_mmap::~scoped_mmap() {
   if (data_ != (void*)-1) {
     try {
@@ -136,7 +187,7 @@ const int kFileFlags =
 #endif
   ;
 
-void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out) {
+void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out, std::ostream *progress) {
   switch (method) {
     case LAZY:
       out.reset(MapOrThrow(size, false, kFileFlags, false, fd, offset), size, scoped_memory::MMAP_ALLOCATED);
@@ -157,7 +208,11 @@ void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scope
       break;
     case PARALLEL_READ:
       out.reset(MallocOrThrow(size), size, scoped_memory::MALLOC_ALLOCATED);
-      ParallelRead(fd, out.get(), size, offset);
+      ParallelRead(fd, out.get(), size, offset, progress);
+      break;
+    case PARALLEL_POPULATE:
+      out.reset(MapOrThrow(size, false, kFileFlags, false, fd, offset), size, scoped_memory::MMAP_ALLOCATED);
+      ParallelPopulate(out.get(), size, progress);
       break;
   }
 }
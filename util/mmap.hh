@@ -3,6 +3,7 @@
 // Utilities for mmaped files.  
 
 #include <cstddef>
+#include <iosfwd>
 #include <limits>
 
 #include <stdint.h>
@@ -96,6 +97,9 @@ typedef enum {
   READ,
   // malloc and read in parallel (recommended for Lustre)
   PARALLEL_READ,
+  // mmap then fault in the pages with several threads.  Shares the page
+  // cache like POPULATE_OR_LAZY but loads large models on fast disks sooner.
+  PARALLEL_POPULATE,
 } LoadMethod;
 
 extern const int kFileFlags;
@@ -103,7 +107,8 @@ extern const int kFileFlags;
 // Wrapper around mmap to check it worked and hide some platform macros.  
 void *MapOrThrow(std::size_t size, bool for_write, int flags, bool prefault, int fd, uint64_t offset = 0);
 
-void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out);
+// progress, if not NULL, shows how far the parallel methods are.
+void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out, std::ostream *progress = NULL);
 
 void MapAnonymous(std::size_t size, scoped_memory &to);
 
@@ -114,6 +119,28 @@ void *MapZeroedWrite(const char *name, std::size_t size, scoped_fd &file);
 // msync wrapper 
 void SyncOrThrow(void *start, size_t length);
 
+// Hints for long-lived read-only mappings of binarized models.  Combine with |.
+typedef enum {
+  ADVISE_NONE = 0,
+  // Ask for transparent huge pages.  Linux only honours this for anonymous
+  // memory and tmpfs/hugetlbfs backed files, so this is best effort.
+  ADVISE_HUGE = 1,
+  // Fault every page in now rather than on first touch during decoding.
+  ADVISE_POPULATE = 2,
+  // Pin the pages with mlock.  Throws if RLIMIT_MEMLOCK is too low.
+  ADVISE_LOCK = 4,
+  // Start reading the pages in the background and return; for ranges that
+  // are about to be used, e.g. the entries of a batch of lookups.
+  ADVISE_WILLNEED = 8
+} Advice;
+
+// Apply Advice flags to an existing mapping.  start need not be page aligned.
+void AdviseMapping(const void *start, std::size_t size, int advice);
+
+// Bytes of [start, start + size) that are in physical memory now, counted in
+// whole pages with mincore.  Returns size where that can't be determined.
+std::size_t ResidentBytes(const void *start, std::size_t size);
+
 // Forward rolling memory map with no overlap.
 class Rolling {
   public:
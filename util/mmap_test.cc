@@ -0,0 +1,22 @@
+#include "util/mmap.hh"
+
+#define BOOST_TEST_MODULE MMapTest
+#include <boost/test/unit_test.hpp>
+
+namespace util {
+namespace {
+
+BOOST_AUTO_TEST_CASE(ResidentTouched) {
+  const std::size_t page = SizePage();
+  scoped_memory mem;
+  MapAnonymous(page * 8, mem);
+  uint8_t *data = static_cast<uint8_t*>(mem.get());
+  for (std::size_t i = 0; i < page * 8; i += page) data[i] = 1;
+  BOOST_CHECK_EQUAL(page * 8, ResidentBytes(data, page * 8));
+  // partial pages count as far as the range goes
+  BOOST_CHECK_EQUAL(page / 2, ResidentBytes(data + page, page / 2));
+  BOOST_CHECK_EQUAL(0U, ResidentBytes(data, 0));
+}
+
+} // namespace
+} // namespace util
@@ -1,6 +1,31 @@
 #include "util/parallel_read.hh"
 
+#include "util/ersatz_progress.hh"
 #include "util/file.hh"
+#include "util/mmap.hh"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#endif
+
+namespace util {
+namespace {
+
+// Start reading [start, start + size) and fault in every page of it.
+void TouchPages(const void *start, std::size_t size) {
+  if (!size) return;
+  const std::size_t page = SizePage();
+  const uint8_t *begin = reinterpret_cast<const uint8_t*>(reinterpret_cast<uintptr_t>(start) & ~(page - 1));
+  const uint8_t *end = static_cast<const uint8_t*>(start) + size;
+#if defined(MADV_WILLNEED)
+  madvise(const_cast<uint8_t*>(begin), end - begin, MADV_WILLNEED);
+#endif
+  volatile uint8_t sink = 0;
+  for (const uint8_t *i = begin; i < end; i += page) sink ^= *i;
+}
+
+} // namespace
+} // namespace util
 
 #ifdef WITH_THREADS
 #include "util/thread_pool.hh"
@@ -30,23 +55,45 @@ class Reader {
     int fd_;
 };
 
+class Populator {
+  public:
+    explicit Populator(int /*unused*/) {}
+
+    struct Request {
+      const void *start;
+      std::size_t size;
+
+      bool operator==(const Request &other) const {
+        return (start == other.start) && (size == other.size);
+      }
+    };
+
+    void operator()(const Request &request) {
+      TouchPages(request.start, request.size);
+    }
+};
+
 } // namespace
 
-void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset) {
+void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset, std::ostream *progress) {
   Reader::Request poison;
   poison.to = NULL;
   poison.size = 0;
   poison.offset = 0;
   unsigned threads = boost::thread::hardware_concurrency();
   if (!threads) threads = 2;
-  ThreadPool<Reader> pool(2 /* don't need much of a queue */, threads, fd, poison);
   const std::size_t kBatch = 1ULL << 25; // 32 MB
+  // A bar for one batch would only be noise.  Declared before the pool so
+  // that it finishes once the pool has been joined.
+  ErsatzProgress bar(amount, amount > kBatch ? progress : NULL, "Reading in parallel");
+  ThreadPool<Reader> pool(2 /* don't need much of a queue */, threads, fd, poison);
   Reader::Request request;
   request.to = to;
   request.size = kBatch;
   request.offset = offset;
   for (; amount > kBatch; amount -= kBatch) {
     pool.Produce(request);
+    bar += kBatch;
     request.to = reinterpret_cast<uint8_t*>(request.to) + kBatch;
     request.offset += kBatch;
   }
@@ -56,14 +103,42 @@ void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset) {
   }
 }
 
+void ParallelPopulate(const void *start, std::size_t size, std::ostream *progress) {
+  Populator::Request poison;
+  poison.start = NULL;
+  poison.size = 0;
+  unsigned threads = boost::thread::hardware_concurrency();
+  if (!threads) threads = 2;
+  // Whole pages so that no two threads fault the same one.
+  const std::size_t kBatch = (1ULL << 25) & ~(SizePage() - 1); // 32 MB
+  ErsatzProgress bar(size, size > kBatch ? progress : NULL, "Populating in parallel");
+  ThreadPool<Populator> pool(threads /* keep every thread busy */, threads, 0, poison);
+  Populator::Request request;
+  request.start = start;
+  request.size = kBatch;
+  for (; size > kBatch; size -= kBatch) {
+    pool.Produce(request);
+    bar += kBatch;
+    request.start = reinterpret_cast<const uint8_t*>(request.start) + kBatch;
+  }
+  request.size = size;
+  if (request.size) {
+    pool.Produce(request);
+  }
+}
+
 } // namespace util
 
 #else // WITH_THREADS
 
 namespace util {
-void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset) {
+void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset, std::ostream * /*progress*/) {
  util::ErsatzPRead(fd, to, amount, offset);
 }
+
+void ParallelPopulate(const void *start, std::size_t size, std::ostream * /*progress*/) {
+  TouchPages(start, size);
+}
 } // namespace util
 
 #endif
@@ -7,10 +7,19 @@
  */
 
 #include <cstddef>
+#include <iosfwd>
 #include <stdint.h>
 
 namespace util {
-void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset);
+// progress, if not NULL, gets an ErsatzProgress bar.
+void ParallelRead(int fd, void *to, std::size_t amount, uint64_t offset, std::ostream *progress = NULL);
+
+/* Fault in the pages of a mapping with several threads, each touching a
+ * chunk at a time.  On local disks and SSDs one thread populating a huge
+ * model waits on one fault after another; many in flight load it several
+ * times faster.
+ */
+void ParallelPopulate(const void *start, std::size_t size, std::ostream *progress = NULL);
 } // namespace util
 
 #endif // UTIL_PARALLEL_READ__
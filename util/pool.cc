@@ -9,6 +9,7 @@ namespace util {
 Pool::Pool() {
   current_ = NULL;
   current_end_ = NULL;
+  allocated_ = 0;
 }
 
 Pool::~Pool() {
@@ -22,12 +23,27 @@ void Pool::FreeAll() {
   free_list_.clear();
   current_ = NULL;
   current_end_ = NULL;
+  allocated_ = 0;
+}
+
+void Pool::Reset() {
+  if (free_list_.empty()) return;
+  // More always leaves the newest block current, so it ends at current_end_.
+  void *keep = free_list_.back();
+  free_list_.pop_back();
+  for (std::vector<void *>::const_iterator i(free_list_.begin()); i != free_list_.end(); ++i) {
+    free(*i);
+  }
+  free_list_.assign(1, keep);
+  current_ = static_cast<uint8_t*>(keep);
+  allocated_ = current_end_ - current_;
 }
 
 void *Pool::More(std::size_t size) {
   std::size_t amount = std::max(static_cast<size_t>(32) << free_list_.size(), size);
   uint8_t *ret = static_cast<uint8_t*>(MallocOrThrow(amount));
   free_list_.push_back(ret);
+  allocated_ += amount;
   current_ = ret + size;
   current_end_ = ret + amount;
   return ret;
@@ -27,6 +27,13 @@ class Pool {
 
     void FreeAll();
 
+    // Forget everything allocated, like FreeAll, but keep the newest (and
+    // largest) block to allocate from again.
+    void Reset();
+
+    // Bytes of the blocks that have been allocated.
+    std::size_t Allocated() const { return allocated_; }
+
   private:
     void *More(std::size_t size);
 
@@ -34,6 +41,8 @@ class Pool {
 
     uint8_t *current_, *current_end_;
 
+    std::size_t allocated_;
+
     // no copying
     Pool(const Pool &);
     Pool &operator=(const Pool &);
@@ -139,6 +139,14 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       }    
     }
 
+    // Hint that the bucket for key will be needed soon so a later Find does
+    // not stall on it.  Several of these can be in flight at once.
+    template <class Key> void Prefetch(const Key key) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(begin_ + (hash_(key) % buckets_));
+#endif
+    }
+
     // Like Find but we're sure it must be there.
     template <class Key> ConstIterator MustFind(const Key key) const {
       for (ConstIterator i(begin_ + (hash_(key) % buckets_));;) {
@@ -302,6 +310,10 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       return backend_.MustFind(key);
     }
 
+    template <class Key> void Prefetch(const Key key) const {
+      backend_.Prefetch(key);
+    }
+
     std::size_t Size() const {
       return backend_.SizeNoSerialization();
     }
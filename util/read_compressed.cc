@@ -24,6 +24,18 @@
 #include <lzma.h>
 #endif
 
+#ifdef WITH_THREADS
+#include "util/pcqueue.hh"
+#include "util/thread_pool.hh"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+#endif
+
 namespace util {
 
 CompressedException::CompressedException() throw() {}
@@ -58,7 +70,9 @@ class ReadBase {
 
 namespace {
 
-ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, std::size_t already_size, bool require_compressed);
+// ahead: decompress on other threads.  Only the reader created first does,
+// the readers it hands over to inherit its threads.
+ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, std::size_t already_size, bool require_compressed, bool ahead = false);
 
 // Completed file that other classes can thunk to.  
 class Complete : public ReadBase {
@@ -130,7 +144,7 @@ template <class Compression> class StreamCompressed : public ReadBase {
         if (!back_.Process()) {
           // reached end, at least for the compressed portion.
           std::size_t ret = static_cast<const uint8_t *>(static_cast<void*>(back_.Stream().next_out)) - static_cast<const uint8_t*>(to);
-          ReplaceThis(ReadFactory(file_.release(), ReadCount(thunk), back_.Stream().next_in, back_.Stream().avail_in, true), thunk);
+          ReplaceThis(ReadFactory(file_.release(), ReadCount(thunk), back_.Stream().next_in, back_.Stream().avail_in, true, false), thunk);
           if (ret) return ret;
           // We did not read anything this round, so clients might think EOF.  Transfer responsibility to the next reader.
           return Current(thunk)->Read(to, amount, thunk);
@@ -343,6 +357,258 @@ class IStreamReader : public ReadBase {
     std::istream &stream_;
 };
 
+#ifdef WITH_THREADS
+// Decompresses on a background thread, a few chunks ahead of the caller, so
+// that parsing and inflating overlap.
+class ReadAhead : public ReadBase {
+  public:
+    // Takes ownership of inner.
+    explicit ReadAhead(ReadBase *inner)
+      : queue_(kChunks), current_(NULL), offset_(0), stop_(false) {
+      ReplaceThis(inner, inner_);
+      ReadCount(inner_) = 0;
+      thread_.reset(new boost::thread(boost::bind(&ReadAhead::Produce, this)));
+    }
+
+    ~ReadAhead() {
+      {
+        boost::unique_lock<boost::mutex> lock(stop_mutex_);
+        stop_ = true;
+      }
+      // The background thread may be waiting for room in the queue.
+      delete current_;
+      current_ = NULL;
+      if (!thread_) return;
+      for (Chunk *chunk; (chunk = queue_.Consume()); ) delete chunk;
+      thread_->join();
+    }
+
+    std::size_t Read(void *to, std::size_t amount, ReadCompressed &thunk) {
+      if (amount == 0) return 0;
+      while (!current_ || offset_ == current_->data.size()) {
+        delete current_;
+        current_ = queue_.Consume();
+        offset_ = 0;
+        if (!current_) {
+          thread_->join();
+          thread_.reset();
+          UTIL_THROW_IF(!error_.empty(), CompressedException, error_);
+          ReplaceThis(new Complete(), thunk);
+          return 0;
+        }
+        ReadCount(thunk) += current_->raw;
+      }
+      std::size_t sending = std::min<std::size_t>(amount, current_->data.size() - offset_);
+      memcpy(to, &current_->data[offset_], sending);
+      offset_ += sending;
+      return sending;
+    }
+
+  private:
+    static const std::size_t kChunks = 4;
+    static const std::size_t kChunkSize = 1 << 20;
+
+    struct Chunk {
+      std::vector<char> data;
+      // compressed bytes read for this chunk
+      uint64_t raw;
+    };
+
+    bool Stopping() {
+      boost::unique_lock<boost::mutex> lock(stop_mutex_);
+      return stop_;
+    }
+
+    void Produce() {
+      try {
+        while (!Stopping()) {
+          uint64_t before = ReadCount(inner_);
+          Chunk *chunk = new Chunk();
+          chunk->data.resize(kChunkSize);
+          chunk->data.resize(inner_.ReadOrEOF(&chunk->data[0], kChunkSize));
+          chunk->raw = ReadCount(inner_) - before;
+          if (chunk->data.empty()) {
+            delete chunk;
+            break;
+          }
+          queue_.Produce(chunk);
+        }
+      } catch (const std::exception &e) {
+        error_ = e.what();
+      }
+      queue_.Produce(NULL);
+    }
+
+    // Only used by the background thread.
+    ReadCompressed inner_;
+
+    // NULL marks the end, or an error in the background thread.
+    PCQueue<Chunk*> queue_;
+    // Set by the background thread before it produces NULL.
+    std::string error_;
+
+    Chunk *current_;
+    std::size_t offset_;
+
+    bool stop_;
+    boost::mutex stop_mutex_;
+
+    boost::scoped_ptr<boost::thread> thread_;
+};
+
+// BGZF (bgzip, tabix, samtools) files are gzip members of at most 64 KB that
+// announce their compressed size in the header, so the blocks can be
+// inflated independently on several threads.
+const std::size_t kBGZFHeader = 18;
+
+// Total size of the block starting with header, or 0 if it is not BGZF.
+std::size_t BGZFBlockSize(const void *header_void, std::size_t length) {
+  const uint8_t *header = static_cast<const uint8_t*>(header_void);
+  if (length < kBGZFHeader) return 0;
+  // gzip, deflate, extra field present
+  if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || !(header[3] & 4)) return 0;
+  std::size_t extra = header[10] | (header[11] << 8);
+  // bgzip writes the BC subfield first
+  if (extra < 6 || header[12] != 'B' || header[13] != 'C' || header[14] != 2 || header[15] != 0) return 0;
+  return (header[16] | (header[17] << 8)) + 1;
+}
+
+class ParallelBGZF : public ReadBase {
+  public:
+    ParallelBGZF(int fd, const void *header, std::size_t header_size)
+      : file_(fd), header_(static_cast<const char*>(header), header_size), input_done_(false), offset_(0),
+        threads_(std::max(1U, std::min(8U, boost::thread::hardware_concurrency()))),
+        pool_(threads_ * 4, threads_, Inflate::Construct(), NULL) {}
+
+    ~ParallelBGZF() {
+      // the workers may still be inflating, pool_ only stops them after this
+      for (std::deque<Block*>::iterator i = pending_.begin(); i != pending_.end(); ++i) {
+        (*i)->Wait();
+        delete *i;
+      }
+    }
+
+    std::size_t Read(void *to, std::size_t amount, ReadCompressed &thunk) {
+      if (amount == 0) return 0;
+      while (true) {
+        Fill(thunk);
+        if (pending_.empty()) {
+          if (header_.empty()) {
+            ReplaceThis(new Complete(), thunk);
+            return 0;
+          }
+          // not BGZF after all, eg. another gzip member appended with cat
+          ReplaceThis(ReadFactory(file_.release(), ReadCount(thunk), header_.data(), header_.size(), true, false), thunk);
+          return Current(thunk)->Read(to, amount, thunk);
+        }
+        Block &front = *pending_.front();
+        front.Wait();
+        UTIL_THROW_IF(!front.error.empty(), GZException, front.error);
+        if (offset_ < front.out.size()) {
+          std::size_t sending = std::min<std::size_t>(amount, front.out.size() - offset_);
+          memcpy(to, &front.out[offset_], sending);
+          offset_ += sending;
+          return sending;
+        }
+        delete pending_.front();
+        pending_.pop_front();
+        offset_ = 0;
+      }
+    }
+
+  private:
+    struct Block {
+      Block() : done(false) {}
+
+      void Wait() {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!done) cond.wait(lock);
+      }
+
+      std::string in, out;
+      std::string error;
+      bool done;
+      boost::mutex mutex;
+      boost::condition_variable cond;
+    };
+
+    class Inflate {
+      public:
+        typedef Block *Request;
+
+        // Inflate keeps no state of its own.
+        struct Construct {};
+        explicit Inflate(Construct) {}
+
+        void operator()(Block *block) {
+          try {
+            Decompress(*block);
+          } catch (const std::exception &e) {
+            block->error = e.what();
+          }
+          boost::unique_lock<boost::mutex> lock(block->mutex);
+          block->done = true;
+          block->cond.notify_all();
+        }
+
+      private:
+        static void Decompress(Block &block) {
+          const uint8_t *trailer = reinterpret_cast<const uint8_t*>(block.in.data() + block.in.size() - 4);
+          std::size_t size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<std::size_t>(trailer[3]) << 24);
+          block.out.resize(size);
+          if (!size) return;
+          GZip gzip(block.in.data(), block.in.size());
+          gzip.SetOutput(&block.out[0], size);
+          while (gzip.Process()) {
+            UTIL_THROW_IF(!gzip.Stream().avail_in, GZException, "Truncated BGZF block");
+          }
+          UTIL_THROW_IF(gzip.Stream().avail_out, GZException, "BGZF block is shorter than its trailer says");
+        }
+    };
+
+    // Reads blocks and queues them for the workers, a few ahead of the caller.
+    void Fill(ReadCompressed &thunk) {
+      while (!input_done_ && pending_.size() < threads_ * 4) {
+        if (header_.size() < kBGZFHeader) {
+          std::size_t have = header_.size();
+          header_.resize(kBGZFHeader);
+          std::size_t got = ReadOrEOF(file_.get(), &header_[have], kBGZFHeader - have);
+          ReadCount(thunk) += got;
+          header_.resize(have + got);
+        }
+        std::size_t size = BGZFBlockSize(header_.data(), header_.size());
+        if (!size) {
+          // end of file, or something else follows
+          input_done_ = true;
+          return;
+        }
+        UTIL_THROW_IF(size < kBGZFHeader + 8, GZException, "Bad BGZF block size " << size);
+        Block *block = new Block();
+        pending_.push_back(block);
+        block->in.swap(header_);
+        block->in.resize(size);
+        std::size_t got = ReadOrEOF(file_.get(), &block->in[kBGZFHeader], size - kBGZFHeader);
+        ReadCount(thunk) += got;
+        UTIL_THROW_IF(got != size - kBGZFHeader, GZException, "Truncated BGZF file");
+        pool_.Produce(block);
+      }
+    }
+
+    scoped_fd file_;
+
+    // Start of the next block.
+    std::string header_;
+    bool input_done_;
+
+    // In file order, the front is being read.
+    std::deque<Block*> pending_;
+    std::size_t offset_;
+
+    const std::size_t threads_;
+    ThreadPool<Inflate> pool_;
+};
+#endif // WITH_THREADS
+
 enum MagicResult {
   UTIL_UNKNOWN, UTIL_GZIP, UTIL_BZIP, UTIL_XZIP
 };
@@ -363,7 +629,7 @@ MagicResult DetectMagic(const void *from_void, std::size_t length) {
   return UTIL_UNKNOWN;
 }
 
-ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, const std::size_t already_size, bool require_compressed) {
+ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, const std::size_t already_size, bool require_compressed, bool ahead) {
   scoped_fd hold(fd);
   std::string header(reinterpret_cast<const char*>(already_data), already_size);
   if (header.size() < ReadCompressed::kMagicSize) {
@@ -376,7 +642,27 @@ ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, co
   if (header.empty()) {
     return new Complete();
   }
-  switch (DetectMagic(&header[0], header.size())) {
+  MagicResult magic = DetectMagic(&header[0], header.size());
+#ifdef WITH_THREADS
+#ifdef HAVE_ZLIB
+  if (ahead && magic == UTIL_GZIP) {
+    if (header.size() < kBGZFHeader) {
+      std::size_t original = header.size();
+      header.resize(kBGZFHeader);
+      std::size_t got = ReadOrEOF(fd, &header[original], kBGZFHeader - original);
+      raw_amount += got;
+      header.resize(original + got);
+    }
+    if (BGZFBlockSize(header.data(), header.size())) {
+      return new ParallelBGZF(hold.release(), header.data(), header.size());
+    }
+  }
+#endif
+  if (ahead && magic != UTIL_UNKNOWN) {
+    return new ReadAhead(ReadFactory(hold.release(), raw_amount, header.data(), header.size(), true, false));
+  }
+#endif
+  switch (magic) {
     case UTIL_GZIP:
 #ifdef HAVE_ZLIB
       return new StreamCompressed<GZip>(hold.release(), header.data(), header.size());
@@ -422,7 +708,7 @@ ReadCompressed::~ReadCompressed() {}
 void ReadCompressed::Reset(int fd) {
   raw_amount_ = 0;
   internal_.reset();
-  internal_.reset(ReadFactory(fd, raw_amount_, NULL, 0, false));
+  internal_.reset(ReadFactory(fd, raw_amount_, NULL, 0, false, true));
 }
 
 void ReadCompressed::Reset(std::istream &in) {
@@ -41,7 +41,8 @@ class ReadCompressed {
     // Must have at least kMagicSize bytes.  
     static bool DetectCompressedMagic(const void *from);
 
-    // Takes ownership of fd.   
+    // Takes ownership of fd.  With threads, compressed files are decompressed
+    // ahead on a background thread, and BGZF (bgzip) files on several.
     explicit ReadCompressed(int fd);
 
     // Try to avoid using this.  Use the fd instead.
@@ -11,6 +11,10 @@
 #include <string>
 #include <cstdlib>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #if defined __MINGW32__
 #include <ctime>
 #include <fcntl.h>
@@ -115,6 +119,54 @@ BOOST_AUTO_TEST_CASE(ReadXZ) {
 #ifdef HAVE_ZLIB
 BOOST_AUTO_TEST_CASE(AppendGZ) {
 }
+
+// One BGZF block as bgzip writes it: a gzip member whose extra field holds
+// the size of the block.
+void WriteBGZFBlock(int fd, const uint8_t *data, std::size_t size) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  BOOST_REQUIRE_EQUAL(Z_OK, deflateInit2(&stream, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY));
+  std::string compressed(deflateBound(&stream, size), 0);
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+  stream.avail_out = compressed.size();
+  BOOST_REQUIRE_EQUAL(Z_STREAM_END, deflate(&stream, Z_FINISH));
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  std::size_t block_size = 18 + compressed.size() + 8;
+  uint8_t header[18] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0,
+    static_cast<uint8_t>((block_size - 1) & 0xff), static_cast<uint8_t>((block_size - 1) >> 8)};
+  WriteOrThrow(fd, header, sizeof(header));
+  WriteOrThrow(fd, compressed.data(), compressed.size());
+  uint32_t crc = crc32(0, data, size);
+  uint8_t trailer[8] = {
+    static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 24),
+    static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 24)};
+  WriteOrThrow(fd, trailer, sizeof(trailer));
+}
+
+BOOST_AUTO_TEST_CASE(ReadBGZF) {
+  std::string data(kSize4 * sizeof(uint32_t), 0);
+  for (uint32_t i = 0; i < kSize4; ++i) {
+    memcpy(&data[i * sizeof(uint32_t)], &i, sizeof(uint32_t));
+  }
+  char name[] = "tempXXXXXX";
+  scoped_fd file(mkstemp(name));
+  BOOST_REQUIRE(file.get() > 0);
+  BOOST_CHECK_EQUAL(0, unlink(name));
+  const uint8_t *from = reinterpret_cast<const uint8_t*>(data.data());
+  for (std::size_t i = 0; i < data.size(); i += 10000) {
+    WriteBGZFBlock(file.get(), from + i, std::min<std::size_t>(10000, data.size() - i));
+  }
+  // bgzip ends with an empty block
+  WriteBGZFBlock(file.get(), from, 0);
+  SeekOrThrow(file.get(), 0);
+
+  ReadCompressed reader(file.release());
+  VerifyRead(reader);
+}
 #endif
 
 BOOST_AUTO_TEST_CASE(IStream) {
@@ -165,6 +165,16 @@ void PrintUsage(std::ostream &out) {
   out << "real:" << WallTime() << '\n';
 }
 
+uint64_t ResidentMemory() {
+#if !defined(_WIN32) && !defined(_WIN64)
+  // the second field of statm is the resident pages
+  std::ifstream statm("/proc/self/statm", std::ios::in);
+  uint64_t size, resident;
+  if (statm >> size >> resident) return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
 /* Adapted from physmem.c in gnulib 831b84c59ef413c57a36b67344467d66a8a2ba70 */
 /* Calculate the size of physical memory.
 
@@ -11,6 +11,9 @@ double WallTime();
 
 void PrintUsage(std::ostream &to);
 
+// Resident set size of the process in bytes.  Zero on unsupported platforms.
+uint64_t ResidentMemory();
+
 // Determine how much physical memory there is.  Return 0 on failure.
 uint64_t GuessPhysicalMemory();
 
@@ -16,6 +16,7 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include "../util/string_piece.hh"
+#include "../util/double-conversion/double-conversion.h"
 #include "../moses/Util.h"
 
 // forward declarations to avoid dependency on VW
@@ -88,6 +89,9 @@ const std::string VW_DEFAULT_PARSER_OPTIONS = " --quiet --hash all --noconstant
 
 /**
  * Produce VW training file (does not use the VW library!)
+ *
+ * Each thread gets its own trainer and file (see ClassifierFactory). Lines
+ * are built in place in one buffer and written as a whole.
  */
 class VWTrainer : public Classifier
 {
@@ -107,9 +111,12 @@ protected:
 
 private:
   boost::iostreams::filtering_ostream m_bfos;
-  std::deque<std::string> m_outputBuffer;
+  std::string m_outputBuffer; //!< the line being built, without its label
+  std::string m_line;
+  double_conversion::DoubleToStringConverter m_converter;
 
-  void WriteBuffer();
+  void AppendFloat(std::string &out, float value);
+  void WriteBuffer(const StringPiece &prefix = StringPiece());
 };
 
 /**
@@ -11,6 +11,7 @@ namespace Discriminative
 {
 
 VWTrainer::VWTrainer(const std::string &outputFile)
+  : m_converter(double_conversion::DoubleToStringConverter::NO_FLAGS, "inf", "nan", 'e', -6, 21, 6, 0)
 {
   if (ends_with(outputFile, ".gz")) {
     m_bfos.push(boost::iostreams::gzip_compressor());
@@ -39,7 +40,7 @@ void VWTrainer::AddLabelIndependentFeature(const StringPiece &name, float value)
     if (! m_outputBuffer.empty())
       WriteBuffer();
 
-    m_outputBuffer.push_back("shared |s");
+    m_outputBuffer = "shared |s";
   }
 
   AddFeature(name, value);
@@ -52,7 +53,7 @@ void VWTrainer::AddLabelDependentFeature(const StringPiece &name, float value)
     if (! m_outputBuffer.empty())
       WriteBuffer();
 
-    m_outputBuffer.push_back("|t");
+    m_outputBuffer = "|t";
   }
 
   AddFeature(name, value);
@@ -60,10 +61,12 @@ void VWTrainer::AddLabelDependentFeature(const StringPiece &name, float value)
 
 void VWTrainer::Train(const StringPiece &label, float loss)
 {
-  m_outputBuffer.push_front(label.as_string() + ":" + SPrint(loss));
+  std::string prefix(label.data(), label.size());
+  prefix += ':';
+  AppendFloat(prefix, loss);
   m_isFirstSource = true;
   m_isFirstTarget = true;
-  WriteBuffer();
+  WriteBuffer(prefix);
 }
 
 float VWTrainer::Predict(const StringPiece &label)
@@ -73,12 +76,45 @@ float VWTrainer::Predict(const StringPiece &label)
 
 void VWTrainer::AddFeature(const StringPiece &name, float value)
 {
-  m_outputBuffer.push_back(EscapeSpecialChars(name.as_string()) + ":" + SPrint(value));
+  // escape as EscapeSpecialChars(), in one pass
+  m_outputBuffer += ' ';
+  for (const char *c = name.data(); c != name.data() + name.size(); ++c) {
+    switch (*c) {
+    case '\\':
+      m_outputBuffer += "_/_";
+      break;
+    case '|':
+      m_outputBuffer += "\\/";
+      break;
+    case ':':
+      m_outputBuffer += "\\;";
+      break;
+    case ' ':
+      m_outputBuffer += "\\_";
+      break;
+    default:
+      m_outputBuffer += *c;
+    }
+  }
+  m_outputBuffer += ':';
+  AppendFloat(m_outputBuffer, value);
+}
+
+void VWTrainer::AppendFloat(std::string &out, float value)
+{
+  char buffer[double_conversion::DoubleToStringConverter::kMaxPrecisionDigits + 8];
+  double_conversion::StringBuilder builder(buffer, sizeof(buffer));
+  m_converter.ToShortestSingle(value, &builder);
+  out.append(buffer, builder.position());
 }
 
-void VWTrainer::WriteBuffer()
+void VWTrainer::WriteBuffer(const StringPiece &prefix)
 {
-  m_bfos << Join(" ", m_outputBuffer.begin(), m_outputBuffer.end()) << "\n";
+  m_line.assign(prefix.data(), prefix.size());
+  if (!m_line.empty() && !m_outputBuffer.empty()) m_line += ' ';
+  m_line += m_outputBuffer;
+  m_line += '\n';
+  m_bfos.write(m_line.data(), m_line.size());
   m_outputBuffer.clear();
 }
 